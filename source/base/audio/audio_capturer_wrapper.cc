@@ -19,14 +19,19 @@
 #include "base/audio/audio_capturer_wrapper.h"
 
 #include "base/audio/audio_capturer.h"
+#include "base/codec/audio_encoder_opus.h"
 #include "base/ipc/ipc_channel_proxy.h"
 #include "build/build_config.h"
 
 namespace base {
 
-AudioCapturerWrapper::AudioCapturerWrapper(std::shared_ptr<IpcChannelProxy> channel_proxy)
+AudioCapturerWrapper::AudioCapturerWrapper(std::shared_ptr<IpcChannelProxy> channel_proxy,
+                                           std::chrono::milliseconds frame_duration,
+                                           int bitrate)
     : channel_proxy_(std::move(channel_proxy)),
-      thread_(std::make_unique<Thread>())
+      thread_(std::make_unique<Thread>()),
+      frame_duration_(frame_duration),
+      bitrate_(bitrate)
 {
     // Nothing
 }
@@ -38,21 +43,41 @@ AudioCapturerWrapper::~AudioCapturerWrapper()
 
 void AudioCapturerWrapper::start()
 {
+    thread_->setQoS(ThreadQoS::AUDIO);
     thread_->start(MessageLoop::Type::ASIO, this);
 }
 
+void AudioCapturerWrapper::setBitrate(int bitrate)
+{
+    std::shared_ptr<TaskRunner> task_runner = thread_->taskRunner();
+    if (!task_runner)
+        return;
+
+    task_runner->postTask([this, bitrate]()
+    {
+        bitrate_ = bitrate;
+
+        if (encoder_ && bitrate_ > 0)
+            if (bitrate_ > 0)
+        encoder_->setBitrate(bitrate_);
+    });
+}
+
 void AudioCapturerWrapper::onBeforeThreadRunning()
 {
-#if defined(OS_WIN)
-    thread_->setPriority(Thread::Priority::HIGHEST);
-#else
-#warning Not implemented
-#endif
+    encoder_ = std::make_unique<AudioEncoderOpus>(frame_duration_);
+    encoder_->setBitrate(bitrate_);
 
     capturer_ = AudioCapturer::create();
     capturer_->start([this](std::unique_ptr<proto::AudioPacket> packet)
     {
-        outgoing_message_.set_allocated_audio_packet(packet.release());
+        proto::AudioPacket* encoded_packet = outgoing_message_.mutable_audio_packet();
+        encoded_packet->Clear();
+
+        // The encoder keeps the samples of an incomplete frame until the next packet.
+        if (!encoder_->encode(*packet, encoded_packet))
+            return;
+
         channel_proxy_->send(base::serialize(outgoing_message_));
     });
 }
@@ -60,6 +85,7 @@ void AudioCapturerWrapper::onBeforeThreadRunning()
 void AudioCapturerWrapper::onAfterThreadRunning()
 {
     capturer_.reset();
+    encoder_.reset();
 }
 
 } // namespace base
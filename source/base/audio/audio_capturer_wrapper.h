@@ -22,19 +22,30 @@
 #include "base/threading/thread.h"
 #include "proto/desktop_internal.pb.h"
 
+#include <chrono>
+
 namespace base {
 
 class AudioCapturer;
+class AudioEncoder;
 class IpcChannelProxy;
 
+// Captures the audio and encodes it with Opus on its own thread. Only the encoded packets are
+// sent to the channel. The capturer drops the silence before the encoder.
 class AudioCapturerWrapper : public Thread::Delegate
 {
 public:
-    explicit AudioCapturerWrapper(std::shared_ptr<IpcChannelProxy> channel_proxy);
+    AudioCapturerWrapper(std::shared_ptr<IpcChannelProxy> channel_proxy,
+                         std::chrono::milliseconds frame_duration,
+                         int bitrate);
     ~AudioCapturerWrapper();
 
     void start();
 
+    // Sets the bitrate of the encoder in bits per second (0 for the default bitrate). Can be
+    // called from any thread after start().
+    void setBitrate(int bitrate);
+
 protected:
     // Thread::Delegate implementation.
     void onBeforeThreadRunning() override;
@@ -44,6 +55,9 @@ private:
     std::shared_ptr<IpcChannelProxy> channel_proxy_;
     std::unique_ptr<Thread> thread_;
     std::unique_ptr<AudioCapturer> capturer_;
+    std::unique_ptr<AudioEncoder> encoder_;
+    const std::chrono::milliseconds frame_duration_;
+    int bitrate_;
     proto::internal::DesktopToService outgoing_message_;
 
     DISALLOW_COPY_AND_ASSIGN(AudioCapturerWrapper);
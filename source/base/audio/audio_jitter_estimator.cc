@@ -0,0 +1,108 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/audio/audio_jitter_estimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace base {
+
+namespace {
+
+// The jitter follows an increase in 4 packets and a decrease in 64 packets.
+const double kJitterAttack = 1.0 / 4;
+const double kJitterDecay = 1.0 / 64;
+
+// The number of jitter deviations covered by the buffer.
+const double kJitterMultiplier = 3.0;
+
+// Each underrun adds 10 ms to the buffer, the extra delay decays by 1/256 of each received packet
+// duration.
+const double kUnderrunStepUs = 10000;
+const double kUnderrunDecay = 1.0 / 256;
+
+// A longer gap between packets is a pause in the audio stream (the host does not send silence),
+// not a network delay.
+const AudioJitterEstimator::Microseconds kPauseThreshold { 500000 };
+
+// Buffered audio is not dropped until it exceeds the target by this amount.
+const AudioJitterEstimator::Microseconds kDropMargin { 40000 };
+
+} // namespace
+
+void AudioJitterEstimator::onPacketReceived(Clock::time_point arrival_time, Microseconds duration)
+{
+    bool paused = true;
+
+    if (last_arrival_time_.has_value())
+    {
+        // A packet is expected to arrive after the duration of the previous one. Any deviation
+        // must be covered by the buffer.
+        const Microseconds deviation =
+            std::chrono::duration_cast<Microseconds>(arrival_time - *last_arrival_time_) -
+            last_duration_;
+
+        paused = deviation > kPauseThreshold;
+        if (!paused)
+        {
+            const double deviation_us = std::abs(static_cast<double>(deviation.count()));
+            const double factor = deviation_us > jitter_us_ ? kJitterAttack : kJitterDecay;
+
+            jitter_us_ += (deviation_us - jitter_us_) * factor;
+        }
+    }
+
+    if (underrun_pending_ && !paused)
+    {
+        underrun_delay_us_ = std::min(
+            underrun_delay_us_ + kUnderrunStepUs, static_cast<double>(kMaxDelay.count()));
+    }
+    else
+    {
+        underrun_delay_us_ = std::max(
+            underrun_delay_us_ - static_cast<double>(duration.count()) * kUnderrunDecay, 0.0);
+    }
+
+    underrun_pending_ = false;
+
+    last_arrival_time_ = arrival_time;
+    last_duration_ = duration;
+}
+
+void AudioJitterEstimator::onUnderrun()
+{
+    underrun_pending_ = true;
+}
+
+AudioJitterEstimator::Microseconds AudioJitterEstimator::targetDelay() const
+{
+    // At least one whole packet must be buffered.
+    const Microseconds base_delay = std::max(kMinDelay, last_duration_);
+    const Microseconds delay = base_delay + Microseconds(
+        static_cast<int64_t>(jitter_us_ * kJitterMultiplier + underrun_delay_us_));
+
+    return std::min(delay, kMaxDelay);
+}
+
+AudioJitterEstimator::Microseconds AudioJitterEstimator::maxDelay() const
+{
+    return targetDelay() + std::max(kDropMargin, last_duration_);
+}
+
+} // namespace base
@@ -0,0 +1,74 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__AUDIO__AUDIO_JITTER_ESTIMATOR_H
+#define BASE__AUDIO__AUDIO_JITTER_ESTIMATOR_H
+
+#include "base/macros_magic.h"
+
+#include <chrono>
+#include <optional>
+
+namespace base {
+
+// Estimates how much audio has to be buffered before playback so that the variance in packet
+// arrival times does not cause underruns. The estimate grows quickly when the network gets worse
+// and shrinks slowly when it gets better.
+class AudioJitterEstimator
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Microseconds = std::chrono::microseconds;
+
+    static constexpr Microseconds kMinDelay { 10000 };
+    static constexpr Microseconds kMaxDelay { 300000 };
+
+    AudioJitterEstimator() = default;
+    ~AudioJitterEstimator() = default;
+
+    // Must be called for each received packet. |duration| is the amount of audio in the packet.
+    void onPacketReceived(Clock::time_point arrival_time, Microseconds duration);
+
+    // Must be called when the playback ran out of buffered audio. The delay is increased when the
+    // next packet arrives, unless the underrun was caused by a pause in the audio stream.
+    void onUnderrun();
+
+    // Returns the amount of audio that should be buffered before the playback starts.
+    Microseconds targetDelay() const;
+
+    // Returns the amount of buffered audio above which the excess audio should be dropped to
+    // reduce the latency.
+    Microseconds maxDelay() const;
+
+private:
+    std::optional<Clock::time_point> last_arrival_time_;
+    Microseconds last_duration_ { 0 };
+
+    // Smoothed deviation of the packet inter-arrival time from the packet duration.
+    double jitter_us_ = 0;
+
+    // Extra delay added after underruns. Decays as packets arrive.
+    double underrun_delay_us_ = 0;
+    bool underrun_pending_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(AudioJitterEstimator);
+};
+
+} // namespace base
+
+#endif // BASE__AUDIO__AUDIO_JITTER_ESTIMATOR_H
@@ -0,0 +1,129 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/audio/audio_jitter_estimator.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+using Clock = AudioJitterEstimator::Clock;
+using Microseconds = AudioJitterEstimator::Microseconds;
+
+const Microseconds kPacketDuration(20000);
+
+// Feeds |count| packets arriving every |interval| starting from |*time|.
+void receivePackets(AudioJitterEstimator* estimator, Clock::time_point* time,
+                    Microseconds interval, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        estimator->onPacketReceived(*time, kPacketDuration);
+        *time += interval;
+    }
+}
+
+} // namespace
+
+TEST(AudioJitterEstimatorTest, SteadyStream)
+{
+    AudioJitterEstimator estimator;
+    Clock::time_point time = Clock::now();
+
+    receivePackets(&estimator, &time, kPacketDuration, 100);
+
+    // Without jitter only one packet is buffered.
+    EXPECT_EQ(estimator.targetDelay(), kPacketDuration);
+    EXPECT_GT(estimator.maxDelay(), estimator.targetDelay());
+}
+
+TEST(AudioJitterEstimatorTest, JitteryStream)
+{
+    AudioJitterEstimator estimator;
+    Clock::time_point time = Clock::now();
+
+    receivePackets(&estimator, &time, kPacketDuration, 10);
+
+    // Packets arrive in pairs: 40 ms gap, then immediately.
+    for (int i = 0; i < 50; ++i)
+    {
+        estimator.onPacketReceived(time, kPacketDuration);
+        estimator.onPacketReceived(time, kPacketDuration);
+        time += kPacketDuration * 2;
+    }
+
+    const Microseconds jittery_delay = estimator.targetDelay();
+    EXPECT_GT(jittery_delay, kPacketDuration * 2);
+    EXPECT_LE(jittery_delay, AudioJitterEstimator::kMaxDelay);
+
+    // When the network gets better the delay decreases slowly.
+    receivePackets(&estimator, &time, kPacketDuration, 10);
+    EXPECT_LT(estimator.targetDelay(), jittery_delay);
+    EXPECT_GT(estimator.targetDelay(), kPacketDuration);
+
+    receivePackets(&estimator, &time, kPacketDuration, 1000);
+    EXPECT_LT(estimator.targetDelay(), kPacketDuration + Microseconds(1000));
+}
+
+TEST(AudioJitterEstimatorTest, MaxDelay)
+{
+    AudioJitterEstimator estimator;
+    Clock::time_point time = Clock::now();
+
+    for (int i = 0; i < 50; ++i)
+    {
+        estimator.onPacketReceived(time, kPacketDuration);
+        estimator.onPacketReceived(time, kPacketDuration);
+        time += Microseconds(400000);
+    }
+
+    EXPECT_EQ(estimator.targetDelay(), AudioJitterEstimator::kMaxDelay);
+}
+
+TEST(AudioJitterEstimatorTest, Underrun)
+{
+    AudioJitterEstimator estimator;
+    Clock::time_point time = Clock::now();
+
+    receivePackets(&estimator, &time, kPacketDuration, 10);
+    const Microseconds delay = estimator.targetDelay();
+
+    // The next packet is late.
+    estimator.onUnderrun();
+    receivePackets(&estimator, &time, kPacketDuration, 1);
+    EXPECT_GT(estimator.targetDelay(), delay);
+}
+
+TEST(AudioJitterEstimatorTest, Pause)
+{
+    AudioJitterEstimator estimator;
+    Clock::time_point time = Clock::now();
+
+    receivePackets(&estimator, &time, kPacketDuration, 10);
+    const Microseconds delay = estimator.targetDelay();
+
+    // The host stopped sending audio for a while. It is not a network problem.
+    estimator.onUnderrun();
+    time += std::chrono::seconds(5);
+    receivePackets(&estimator, &time, kPacketDuration, 1);
+    EXPECT_EQ(estimator.targetDelay(), delay);
+}
+
+} // namespace base
@@ -33,21 +33,23 @@
 
 namespace base {
 
-AudioOutput::AudioOutput(const NeedMoreDataCB& need_more_data_cb)
-    : need_more_data_cb_(need_more_data_cb)
+AudioOutput::AudioOutput(const NeedMoreDataCB& need_more_data_cb, Latency latency)
+    : need_more_data_cb_(need_more_data_cb),
+      latency_(latency)
 {
     // Nothing
 }
 
 // static
-std::unique_ptr<AudioOutput> AudioOutput::create(const NeedMoreDataCB& need_more_data_cb)
+std::unique_ptr<AudioOutput> AudioOutput::create(const NeedMoreDataCB& need_more_data_cb,
+                                                 Latency latency)
 {
 #if defined(OS_WIN)
-    return std::make_unique<AudioOutputWin>(need_more_data_cb);
+    return std::make_unique<AudioOutputWin>(need_more_data_cb, latency);
 #elif defined(OS_MAC)
-    return std::make_unique<AudioOutputMac>(need_more_data_cb);
+    return std::make_unique<AudioOutputMac>(need_more_data_cb, latency);
 #elif defined(OS_LINUX)
-    return std::make_unique<AudioOutputPulse>(need_more_data_cb);
+    return std::make_unique<AudioOutputPulse>(need_more_data_cb, latency);
 #else
     NOTIMPLEMENTED();
     return nullptr;
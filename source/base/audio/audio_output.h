@@ -37,17 +37,32 @@ public:
 
     using NeedMoreDataCB = std::function<size_t(void* data, size_t size)>;
 
-    static std::unique_ptr<AudioOutput> create(const NeedMoreDataCB& need_more_data_cb);
+    enum class Latency
+    {
+        // Output buffer that tolerates scheduling delays of the audio thread.
+        NORMAL,
+
+        // Smallest output buffer the platform can handle reliably. Used when the caller buffers
+        // the audio itself. WASAPI always uses the minimum shared mode buffer, so there is no
+        // difference on Windows.
+        LOW
+    };
+
+    static std::unique_ptr<AudioOutput> create(const NeedMoreDataCB& need_more_data_cb,
+                                               Latency latency = Latency::NORMAL);
 
     virtual bool start() = 0;
     virtual bool stop() = 0;
 
 protected:
-    explicit AudioOutput(const NeedMoreDataCB& need_more_data_cb);
+    AudioOutput(const NeedMoreDataCB& need_more_data_cb, Latency latency);
     void onDataRequest(int16_t* audio_samples, size_t audio_samples_count);
 
+    Latency latency() const { return latency_; }
+
 private:
     NeedMoreDataCB need_more_data_cb_;
+    const Latency latency_;
 };
 
 } // namespace base
@@ -29,8 +29,8 @@
 
 namespace base {
 
-AudioOutputMac::AudioOutputMac(const NeedMoreDataCB& need_more_data_cb)
-    : AudioOutput(need_more_data_cb),
+AudioOutputMac::AudioOutputMac(const NeedMoreDataCB& need_more_data_cb, Latency latency)
+    : AudioOutput(need_more_data_cb, latency),
       stop_event_(WaitableEvent::ResetPolicy::AUTOMATIC, WaitableEvent::InitialState::NOT_SIGNALED)
 {
     memset(convert_data_, 0, sizeof(convert_data_));
@@ -404,8 +404,8 @@ bool AudioOutputMac::setDesiredFormat()
         return false;
     }
 
-    // Try to set buffer size to desired value set to 20ms.
-    const uint16_t kPlayBufDelayFixed = 20;
+    // Try to set buffer size to desired value set to 20ms (10ms in low latency mode).
+    const uint16_t kPlayBufDelayFixed = latency() == Latency::LOW ? 10 : 20;
     UInt32 buf_byte_count = static_cast<UInt32>(
         (stream_format_.mSampleRate / 1000.0) * kPlayBufDelayFixed *
         stream_format_.mChannelsPerFrame * sizeof(Float32));
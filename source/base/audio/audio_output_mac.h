@@ -38,7 +38,7 @@ class SimpleThread;
 class AudioOutputMac : public AudioOutput
 {
 public:
-    explicit AudioOutputMac(const NeedMoreDataCB& need_more_data_cb);
+    AudioOutputMac(const NeedMoreDataCB& need_more_data_cb, Latency latency);
     ~AudioOutputMac();
 
     // AudioOutput implementation.
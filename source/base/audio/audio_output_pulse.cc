@@ -58,8 +58,8 @@ private:
 
 } // namespace
 
-AudioOutputPulse::AudioOutputPulse(const NeedMoreDataCB& need_more_data_cb)
-    : AudioOutput(need_more_data_cb)
+AudioOutputPulse::AudioOutputPulse(const NeedMoreDataCB& need_more_data_cb, Latency latency)
+    : AudioOutput(need_more_data_cb, latency)
 {
     if (initDevice())
         initPlayout();
@@ -287,7 +287,7 @@ bool AudioOutputPulse::initPlayout()
     LATE(pa_stream_set_write_callback)(play_stream_, paStreamWriteCallback, this);
 
     const int kBufferTimeMs = 10;
-    const int kBufferSizeMs = 40;
+    const int kBufferSizeMs = latency() == Latency::LOW ? 20 : 40;
     const int kBytesPerSecond = kSampleRate * kChannels * kBytesPerSample;
     const int kBufferSize = kBytesPerSecond * kBufferSizeMs / 1000LL;
 
@@ -298,10 +298,19 @@ bool AudioOutputPulse::initPlayout()
     pa_buffer_attr.prebuf = -1;
     pa_buffer_attr.tlength = kBufferSize;
 
+    // With PA_STREAM_ADJUST_LATENCY the server sizes its own buffers so that the overall latency
+    // is close to |tlength| instead of adding the sink latency on top of it.
+    pa_stream_flags_t stream_flags = static_cast<pa_stream_flags_t>(0);
+    if (latency() == Latency::LOW)
+    {
+        pa_buffer_attr.minreq = kBytesPerSecond * kBufferTimeMs / 1000LL;
+        stream_flags = PA_STREAM_ADJUST_LATENCY;
+    }
+
     if (LATE(pa_stream_connect_playback)(play_stream_,
                                          nullptr,
                                          &pa_buffer_attr,
-                                         static_cast<pa_stream_flags_t>(0),
+                                         stream_flags,
                                          nullptr,
                                          nullptr))
     {
@@ -45,8 +45,8 @@ const char* sessionStateToString(AudioSessionState state)
 
 } // namespace
 
-AudioOutputWin::AudioOutputWin(const NeedMoreDataCB& need_more_data_cb)
-    : AudioOutput(need_more_data_cb)
+AudioOutputWin::AudioOutputWin(const NeedMoreDataCB& need_more_data_cb, Latency latency)
+    : AudioOutput(need_more_data_cb, latency)
 {
     // Create the event which the audio engine will signal each time a buffer becomes ready to be
     // processed by the client.
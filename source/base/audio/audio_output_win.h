@@ -38,7 +38,7 @@ class AudioOutputWin
       public IAudioSessionEvents
 {
 public:
-    explicit AudioOutputWin(const NeedMoreDataCB& need_more_data_cb);
+    AudioOutputWin(const NeedMoreDataCB& need_more_data_cb, Latency latency);
     ~AudioOutputWin();
 
     // AudioOutput implementation.
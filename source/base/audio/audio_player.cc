@@ -22,8 +22,18 @@
 #include "base/audio/audio_output.h"
 #include "proto/desktop.pb.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace base {
 
+namespace {
+
+const size_t kBytesPerFrame = AudioOutput::kChannels * AudioOutput::kBytesPerSample;
+const size_t kBytesPerSecond = AudioOutput::kSampleRate * kBytesPerFrame;
+
+} // namespace
+
 AudioPlayer::AudioPlayer() = default;
 
 AudioPlayer::~AudioPlayer() = default;
@@ -40,21 +50,49 @@ std::unique_ptr<AudioPlayer> AudioPlayer::create()
 
 void AudioPlayer::addPacket(std::unique_ptr<proto::AudioPacket> packet)
 {
+    const size_t packet_size = packet->data(0).size();
+    const AudioJitterEstimator::Microseconds duration(
+        packet_size * 1000000 / kBytesPerSecond);
+
     std::scoped_lock lock(incoming_queue_lock_);
+    jitter_estimator_.onPacketReceived(AudioJitterEstimator::Clock::now(), duration);
     incoming_queue_.emplace(std::move(packet));
 }
 
 size_t AudioPlayer::onMoreDataRequired(void* data, size_t size)
 {
-    if (work_queue_.empty())
+    size_t target_bytes;
+    size_t max_bytes;
+
     {
+        std::scoped_lock lock(incoming_queue_lock_);
+
+        while (!incoming_queue_.empty())
         {
-            std::scoped_lock lock(incoming_queue_lock_);
-            work_queue_.swap(incoming_queue_);
+            work_queue_bytes_ += incoming_queue_.front()->data(0).size();
+            work_queue_.emplace(std::move(incoming_queue_.front()));
+            incoming_queue_.pop();
         }
 
-        if (work_queue_.empty())
+        target_bytes = bytesForDuration(jitter_estimator_.targetDelay());
+        max_bytes = bytesForDuration(jitter_estimator_.maxDelay());
+    }
+
+    const size_t buffered_bytes = work_queue_bytes_ - source_pos_;
+
+    if (buffering_)
+    {
+        // Wait until there is enough audio to survive the expected jitter.
+        if (buffered_bytes < std::max(target_bytes, size))
             return 0;
+
+        buffering_ = false;
+    }
+    else if (buffered_bytes > max_bytes)
+    {
+        // The network got better than the buffer size expects. Drop the oldest audio to reduce
+        // the latency.
+        dropExcessData(target_bytes);
     }
 
     size_t target_pos = 0;
@@ -79,6 +117,7 @@ size_t AudioPlayer::onMoreDataRequired(void* data, size_t size)
         }
         else
         {
+            work_queue_bytes_ -= packet_data.size();
             work_queue_.pop();
             source_pos_ = 0;
 
@@ -87,13 +126,48 @@ size_t AudioPlayer::onMoreDataRequired(void* data, size_t size)
         }
     }
 
+    if (target_pos < size)
+    {
+        // Underrun. Fill the rest with silence and wait until the buffer is filled again.
+        memset(reinterpret_cast<uint8_t*>(data) + target_pos, 0, size - target_pos);
+        buffering_ = true;
+
+        std::scoped_lock lock(incoming_queue_lock_);
+        jitter_estimator_.onUnderrun();
+    }
+
     return target_pos;
 }
 
+void AudioPlayer::dropExcessData(size_t max_buffered_bytes)
+{
+    // Whole packets are dropped from the head of the queue, the newest packet is always kept.
+    while (work_queue_.size() > 1)
+    {
+        const size_t buffered_bytes = work_queue_bytes_ - source_pos_;
+        const size_t packet_size = work_queue_.front()->data(0).size() - source_pos_;
+
+        if (buffered_bytes - packet_size < max_buffered_bytes)
+            break;
+
+        work_queue_bytes_ -= work_queue_.front()->data(0).size();
+        work_queue_.pop();
+        source_pos_ = 0;
+    }
+}
+
+// static
+size_t AudioPlayer::bytesForDuration(AudioJitterEstimator::Microseconds duration)
+{
+    const size_t frames = static_cast<size_t>(duration.count()) * AudioOutput::kSampleRate / 1000000;
+    return frames * kBytesPerFrame;
+}
+
 bool AudioPlayer::init()
 {
     output_ = AudioOutput::create(std::bind(
-        &AudioPlayer::onMoreDataRequired, this, std::placeholders::_1, std::placeholders::_2));
+        &AudioPlayer::onMoreDataRequired, this, std::placeholders::_1, std::placeholders::_2),
+        AudioOutput::Latency::LOW);
     if (!output_)
     {
         LOG(LS_ERROR) << "AudioOutput::create failed";
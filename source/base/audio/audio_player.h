@@ -20,6 +20,7 @@
 #define BASE__AUDIO__AUDIO_PLAYER_H
 
 #include "base/macros_magic.h"
+#include "base/audio/audio_jitter_estimator.h"
 
 #include <memory>
 #include <mutex>
@@ -33,6 +34,10 @@ namespace base {
 
 class AudioOutput;
 
+// Plays decoded audio packets. The output uses the low latency mode and the amount of buffered
+// audio adapts to the observed packet arrival jitter: the playback starts (and restarts after an
+// underrun) only when enough audio is buffered and the excess audio is dropped when the network
+// gets better.
 class AudioPlayer
 {
 public:
@@ -45,14 +50,22 @@ private:
     AudioPlayer();
     bool init();
     size_t onMoreDataRequired(void* data, size_t size);
+    void dropExcessData(size_t max_buffered_bytes);
+
+    static size_t bytesForDuration(AudioJitterEstimator::Microseconds duration);
 
     std::unique_ptr<AudioOutput> output_;
 
+    // Protected by |incoming_queue_lock_|.
     std::queue<std::unique_ptr<proto::AudioPacket>> incoming_queue_;
+    AudioJitterEstimator jitter_estimator_;
     std::mutex incoming_queue_lock_;
 
+    // Accessed only by the audio thread.
     std::queue<std::unique_ptr<proto::AudioPacket>> work_queue_;
+    size_t work_queue_bytes_ = 0;
     size_t source_pos_ = 0;
+    bool buffering_ = true;
 
     DISALLOW_COPY_AND_ASSIGN(AudioPlayer);
 };
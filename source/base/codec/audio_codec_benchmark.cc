@@ -0,0 +1,118 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/audio_encoder_opus.h"
+#include "base/codec/sinc_resampler.h"
+#include "proto/desktop.pb.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+const int kPacketDurationMs = 10;
+const int kChannels = 2;
+const double kToneFrequency = 440.0;
+
+// Stereo sine tone in 16 bit samples. The capturer delivers packets of this layout.
+proto::AudioPacket createRawPacket(proto::AudioPacket::SamplingRate sampling_rate)
+{
+    const int frames = sampling_rate * kPacketDurationMs / 1000;
+    std::vector<int16_t> samples(static_cast<size_t>(frames * kChannels));
+
+    for (int i = 0; i < frames; ++i)
+    {
+        double value = std::sin(2.0 * M_PI * kToneFrequency * i / sampling_rate);
+        int16_t sample = static_cast<int16_t>(value * 16384.0);
+
+        samples[static_cast<size_t>(i * kChannels)] = sample;
+        samples[static_cast<size_t>(i * kChannels + 1)] = sample;
+    }
+
+    proto::AudioPacket packet;
+    packet.set_encoding(proto::AUDIO_ENCODING_RAW);
+    packet.set_sampling_rate(sampling_rate);
+    packet.set_bytes_per_sample(proto::AudioPacket::BYTES_PER_SAMPLE_2);
+    packet.set_channels(proto::AudioPacket::CHANNELS_STEREO);
+    packet.add_data(samples.data(), samples.size() * sizeof(int16_t));
+
+    return packet;
+}
+
+// range(0) is the sampling rate of the input. Input at 44100 Hz is resampled by the encoder.
+void BM_AudioEncodeOpus(benchmark::State& state)
+{
+    proto::AudioPacket input_packet =
+        createRawPacket(static_cast<proto::AudioPacket::SamplingRate>(state.range(0)));
+    AudioEncoderOpus encoder;
+    proto::AudioPacket output_packet;
+
+    for (auto _ : state)
+    {
+        output_packet.Clear();
+        encoder.encode(input_packet, &output_packet);
+        benchmark::DoNotOptimize(output_packet);
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(input_packet.data(0).size()));
+}
+
+void BM_SincResampler(benchmark::State& state)
+{
+    const int input_rate = proto::AudioPacket::SAMPLING_RATE_44100;
+    const int output_rate = proto::AudioPacket::SAMPLING_RATE_48000;
+    const int output_frames = output_rate * kPacketDurationMs / 1000;
+
+    int position = 0;
+    SincResampler resampler(static_cast<double>(input_rate) / output_rate,
+                            SincResampler::kDefaultRequestSize,
+                            [&position](int frames, float* destination)
+    {
+        for (int i = 0; i < frames; ++i, ++position)
+        {
+            destination[i] = static_cast<float>(
+                std::sin(2.0 * M_PI * kToneFrequency * position / input_rate));
+        }
+    });
+
+    std::vector<float> output(static_cast<size_t>(output_frames));
+
+    for (auto _ : state)
+    {
+        resampler.Resample(output_frames, output.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * output_frames);
+}
+
+BENCHMARK(BM_AudioEncodeOpus)
+    ->Arg(proto::AudioPacket::SAMPLING_RATE_48000)
+    ->Arg(proto::AudioPacket::SAMPLING_RATE_44100)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_SincResampler)->Unit(benchmark::kMicrosecond);
+
+} // namespace
+
+} // namespace base
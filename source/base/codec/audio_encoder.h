@@ -37,6 +37,12 @@ public:
 
     // Returns average bitrate for the stream in bits per second.
     virtual int bitrate() = 0;
+
+    // Sets the bitrate in bits per second that the network can take for the audio.
+    virtual void setBitrate(int bitrate) = 0;
+
+    // Sets the expected percentage of lost packets. The encoder may add redundancy for them.
+    virtual void setPacketLossPercentage(int percentage) = 0;
 };
 
 } // namespace base
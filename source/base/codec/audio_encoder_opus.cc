@@ -24,24 +24,25 @@
 
 #include <opus.h>
 
+#include <algorithm>
+
 namespace base {
 
 namespace {
 
-// Output 64 kb/s bitrate.
-const int kOutputBitrateBps = 64 * 1024;
+// The bitrate is 64 kb/s until the network requires less.
+const int kDefaultBitrateBps = 64 * 1024;
+const int kMinBitrateBps = 8 * 1024;
+const int kMaxBitrateBps = 128 * 1024;
+
+// Packets of 1 or 2 bytes mean that the encoder is in discontinuous transmission (DTX) mode:
+// the input is silence and the packet does not need to be sent.
+const int kMaxDtxPacketSize = 2;
 
 // Opus doesn't support 44100 sampling rate so we always resample to 48kHz.
 const proto::AudioPacket::SamplingRate kOpusSamplingRate =
     proto::AudioPacket::SAMPLING_RATE_48000;
 
-// Opus supports frame sizes of 2.5, 5, 10, 20, 40 and 60 ms. We use 20 ms
-// frames to balance latency and efficiency.
-const std::chrono::milliseconds kFrameSizeMs { 20 };
-
-// Number of samples per frame when using default sampling rate.
-const int kFrameSamples = kOpusSamplingRate * kFrameSizeMs / std::chrono::milliseconds(1000);
-
 const proto::AudioPacket::BytesPerSample kBytesPerSample =
     proto::AudioPacket::BYTES_PER_SAMPLE_2;
 
@@ -50,9 +51,38 @@ bool isSupportedSampleRate(int rate)
     return rate == 44100 || rate == 48000 || rate == 96000 || rate == 192000;
 }
 
+bool isSupportedFrameDuration(std::chrono::milliseconds duration)
+{
+    // 2.5 ms is not a whole number of milliseconds and is not used.
+    static const int kDurations[] = { 5, 10, 20, 40, 60 };
+
+    for (int value : kDurations)
+    {
+        if (duration == std::chrono::milliseconds(value))
+            return true;
+    }
+
+    return false;
+}
+
 } // namespace
 
-AudioEncoderOpus::AudioEncoderOpus() = default;
+// We use 20 ms frames by default to balance latency and efficiency.
+const std::chrono::milliseconds AudioEncoderOpus::kDefaultFrameDuration { 20 };
+
+AudioEncoderOpus::AudioEncoderOpus(std::chrono::milliseconds frame_duration)
+    : bitrate_(kDefaultBitrateBps),
+      frame_duration_(frame_duration)
+{
+    if (!isSupportedFrameDuration(frame_duration_))
+    {
+        LOG(LS_WARNING) << "Unsupported frame duration: " << frame_duration_.count() << " ms";
+        frame_duration_ = kDefaultFrameDuration;
+    }
+
+    frame_samples_ = static_cast<int>(
+        kOpusSamplingRate * frame_duration_ / std::chrono::milliseconds(1000));
+}
 
 AudioEncoderOpus::~AudioEncoderOpus()
 {
@@ -71,13 +101,21 @@ void AudioEncoderOpus::initEncoder()
         return;
     }
 
-    opus_encoder_ctl(encoder_, OPUS_SET_BITRATE(kOutputBitrateBps));
+    opus_encoder_ctl(encoder_, OPUS_SET_BITRATE(bitrate_));
+
+    // Silence is not sent. The decoder fills the gaps with comfort noise.
+    opus_encoder_ctl(encoder_, OPUS_SET_DTX(1));
+
+    // In-band FEC is used only if losses are expected.
+    opus_encoder_ctl(encoder_, OPUS_SET_INBAND_FEC(packet_loss_percentage_ > 0 ? 1 : 0));
+    opus_encoder_ctl(encoder_, OPUS_SET_PACKET_LOSS_PERC(packet_loss_percentage_));
 
-    frame_size_ = sampling_rate_ * kFrameSizeMs / std::chrono::milliseconds(1000);
+    frame_size_ = static_cast<int>(
+        sampling_rate_ * frame_duration_ / std::chrono::milliseconds(1000));
 
     if (sampling_rate_ != kOpusSamplingRate)
     {
-        resample_buffer_.reset(new char[kFrameSamples * kBytesPerSample * channels_]);
+        resample_buffer_.reset(new char[frame_samples_ * kBytesPerSample * channels_]);
         // TODO(sergeyu): Figure out the right buffer size to use per packet instead
         // of using SincResampler::kDefaultRequestSize.
         resampler_.reset(new MultiChannelResampler(
@@ -86,7 +124,7 @@ void AudioEncoderOpus::initEncoder()
             SincResampler::kDefaultRequestSize,
             std::bind(&AudioEncoderOpus::fetchBytesToResample,
                 this, std::placeholders::_1, std::placeholders::_2)));
-        resampler_bus_ = AudioBus::Create(channels_, kFrameSamples);
+        resampler_bus_ = AudioBus::Create(channels_, frame_samples_);
     }
 
     // Drop leftover data because it's for different sampling rate.
@@ -146,7 +184,34 @@ void AudioEncoderOpus::fetchBytesToResample(int /* resampler_frame_delay */, Aud
 
 int AudioEncoderOpus::bitrate()
 {
-    return kOutputBitrateBps;
+    return bitrate_;
+}
+
+void AudioEncoderOpus::setBitrate(int bitrate)
+{
+    bitrate = std::clamp(bitrate, kMinBitrateBps, kMaxBitrateBps);
+    if (bitrate == bitrate_)
+        return;
+
+    bitrate_ = bitrate;
+
+    if (encoder_)
+        opus_encoder_ctl(encoder_, OPUS_SET_BITRATE(bitrate_));
+}
+
+void AudioEncoderOpus::setPacketLossPercentage(int percentage)
+{
+    percentage = std::clamp(percentage, 0, 100);
+    if (percentage == packet_loss_percentage_)
+        return;
+
+    packet_loss_percentage_ = percentage;
+
+    if (encoder_)
+    {
+        opus_encoder_ctl(encoder_, OPUS_SET_INBAND_FEC(packet_loss_percentage_ > 0 ? 1 : 0));
+        opus_encoder_ctl(encoder_, OPUS_SET_PACKET_LOSS_PERC(packet_loss_percentage_));
+    }
 }
 
 bool AudioEncoderOpus::encode(
@@ -197,12 +262,12 @@ bool AudioEncoderOpus::encode(
             resampling_data_ = reinterpret_cast<const char*>(pcm_buffer);
             resampling_data_pos_ = 0;
             resampling_data_size_ = samples_wanted * channels_ * kBytesPerSample;
-            resampler_->Resample(kFrameSamples, resampler_bus_.get());
+            resampler_->Resample(frame_samples_, resampler_bus_.get());
             resampling_data_ = nullptr;
             samples_consumed = resampling_data_pos_ / channels_ / kBytesPerSample;
 
             resampler_bus_->ToInterleaved<SignedInt16SampleTypeTraits>(
-                kFrameSamples, reinterpret_cast<int16_t*>(resample_buffer_.get()));
+                frame_samples_, reinterpret_cast<int16_t*>(resample_buffer_.get()));
             pcm_buffer = reinterpret_cast<int16_t*>(resample_buffer_.get());
         }
         else
@@ -212,11 +277,11 @@ bool AudioEncoderOpus::encode(
 
         // Initialize output buffer.
         std::string* data = output_packet->add_data();
-        data->resize(kFrameSamples * kBytesPerSample * channels_);
+        data->resize(frame_samples_ * kBytesPerSample * channels_);
 
         // Encode.
         unsigned char* buffer = reinterpret_cast<unsigned char*>(std::data(*data));
-        int result = opus_encode(encoder_, pcm_buffer, kFrameSamples, buffer, data->length());
+        int result = opus_encode(encoder_, pcm_buffer, frame_samples_, buffer, data->length());
         if (result < 0)
         {
             LOG(LS_ERROR) << "opus_encode() failed with error code: " << result;
@@ -224,7 +289,11 @@ bool AudioEncoderOpus::encode(
         }
 
         DCHECK_LE(result, static_cast<int>(data->length()));
-        data->resize(result);
+
+        if (result <= kMaxDtxPacketSize)
+            output_packet->mutable_data()->RemoveLast();
+        else
+            data->resize(result);
 
         // Cleanup leftover buffer.
         if (samples_consumed >= leftover_samples_)
@@ -23,6 +23,8 @@
 #include "base/codec/audio_encoder.h"
 #include "proto/desktop.pb.h"
 
+#include <chrono>
+
 struct OpusEncoder;
 
 namespace base {
@@ -33,12 +35,19 @@ class MultiChannelResampler;
 class AudioEncoderOpus : public AudioEncoder
 {
 public:
-    AudioEncoderOpus();
+    // Opus supports frame durations of 2.5, 5, 10, 20, 40 and 60 ms. Shorter frames lower the
+    // latency, longer frames compress better. Unsupported values are replaced by the default.
+    static const std::chrono::milliseconds kDefaultFrameDuration;
+
+    explicit AudioEncoderOpus(
+        std::chrono::milliseconds frame_duration = kDefaultFrameDuration);
     ~AudioEncoderOpus() override;
 
     // AudioEncoder interface.
     bool encode(const proto::AudioPacket& input_packet, proto::AudioPacket* output_packet) override;
     int bitrate() override;
+    void setBitrate(int bitrate) override;
+    void setPacketLossPercentage(int percentage) override;
 
 private:
     void initEncoder();
@@ -49,7 +58,15 @@ private:
     int sampling_rate_ = 0;
     proto::AudioPacket::Channels channels_ = proto::AudioPacket::CHANNELS_STEREO;
     OpusEncoder* encoder_ = nullptr;
+    int bitrate_;
+    int packet_loss_percentage_ = 0;
+
+    std::chrono::milliseconds frame_duration_;
+
+    // Number of samples per frame at the sampling rate of Opus.
+    int frame_samples_ = 0;
 
+    // Number of samples per frame at the input sampling rate.
     int frame_size_ = 0;
     std::unique_ptr<MultiChannelResampler> resampler_;
     std::unique_ptr<char[]> resample_buffer_;
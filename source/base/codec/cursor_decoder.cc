@@ -19,9 +19,13 @@
 #include "base/codec/cursor_decoder.h"
 
 #include "base/logging.h"
+#include "base/codec/delta_filter.h"
+#include "base/codec/cursor_encoder.h"
 #include "base/desktop/mouse_cursor.h"
 #include "proto/desktop.pb.h"
 
+#include <algorithm>
+
 namespace base {
 
 namespace {
@@ -29,6 +33,10 @@ namespace {
 constexpr size_t kMinCacheSize = 2;
 constexpr size_t kMaxCacheSize = 30;
 
+// The cursors received as a difference are compressed when the cache is saved. The ratio is the
+// same as on the host.
+constexpr int kCompressionRatio = 8;
+
 } // namespace
 
 CursorDecoder::CursorDecoder()
@@ -88,8 +96,72 @@ ByteArray CursorDecoder::decompressCursor(const proto::CursorShape& cursor_shape
     return image;
 }
 
+std::shared_ptr<MouseCursor> CursorDecoder::decodeCursor(
+    const proto::CursorShape& cursor_shape) const
+{
+    Size size(cursor_shape.width(), cursor_shape.height());
+    Point hotspot(cursor_shape.hotspot_x(), cursor_shape.hotspot_y());
+
+    if (size.width()  <= 0 || size.width()  > (std::numeric_limits<int16_t>::max() / 2) ||
+        size.height() <= 0 || size.height() > (std::numeric_limits<int16_t>::max() / 2))
+    {
+        LOG(LS_ERROR) << "Cursor dimensions are out of bounds for SetCursor: "
+                      << size.width() << "x" << size.height();
+        return nullptr;
+    }
+
+    ByteArray image = decompressCursor(cursor_shape);
+    if (image.empty())
+    {
+        LOG(LS_WARNING) << "decompressCursor failed";
+        return nullptr;
+    }
+
+    return std::make_shared<MouseCursor>(std::move(image), size, hotspot);
+}
+
+std::shared_ptr<MouseCursor> CursorDecoder::decodeDelta(
+    const proto::CursorShape& cursor_shape) const
+{
+    if (!previous_cursor_ || previous_cursor_->width() != cursor_shape.width() ||
+        previous_cursor_->height() != cursor_shape.height())
+    {
+        LOG(LS_ERROR) << "No previous cursor of size "
+                      << cursor_shape.width() << "x" << cursor_shape.height();
+        return nullptr;
+    }
+
+    ByteArray image = decompressCursor(cursor_shape);
+    const ByteArray& previous_image = previous_cursor_->constImage();
+
+    if (image.empty() || image.size() != previous_image.size())
+    {
+        LOG(LS_WARNING) << "decompressCursor failed";
+        return nullptr;
+    }
+
+    xorDelta(image.data(), previous_image.data(), image.size());
+
+    std::shared_ptr<MouseCursor> mouse_cursor = std::make_shared<MouseCursor>(
+        std::move(image),
+        Size(cursor_shape.width(), cursor_shape.height()),
+        Point(cursor_shape.hotspot_x(), cursor_shape.hotspot_y()));
+
+    // A wrong base gives a wrong image, the hash shows it.
+    if (CursorEncoder::cursorHash(*mouse_cursor) != cursor_shape.hash())
+    {
+        LOG(LS_ERROR) << "Invalid hash of cursor difference";
+        return nullptr;
+    }
+
+    return mouse_cursor;
+}
+
 std::shared_ptr<MouseCursor> CursorDecoder::decode(const proto::CursorShape& cursor_shape)
 {
+    if (cursor_shape.flags() & proto::CursorShape::HASH_CACHE)
+        return decodeWithHash(cursor_shape);
+
     size_t cache_index;
 
     if (cursor_shape.flags() & proto::CursorShape::CACHE)
@@ -106,26 +178,9 @@ std::shared_ptr<MouseCursor> CursorDecoder::decode(const proto::CursorShape& cur
     }
     else
     {
-        Size size(cursor_shape.width(), cursor_shape.height());
-        Point hotspot(cursor_shape.hotspot_x(), cursor_shape.hotspot_y());
-
-        if (size.width()  <= 0 || size.width()  > (std::numeric_limits<int16_t>::max() / 2) ||
-            size.height() <= 0 || size.height() > (std::numeric_limits<int16_t>::max() / 2))
-        {
-            LOG(LS_ERROR) << "Cursor dimensions are out of bounds for SetCursor: "
-                          << size.width() << "x" << size.height();
-            return nullptr;
-        }
-
-        ByteArray image = decompressCursor(cursor_shape);
-        if (image.empty())
-        {
-            LOG(LS_WARNING) << "decompressCursor failed";
+        std::shared_ptr<MouseCursor> mouse_cursor = decodeCursor(cursor_shape);
+        if (!mouse_cursor)
             return nullptr;
-        }
-
-        std::unique_ptr<MouseCursor> mouse_cursor =
-            std::make_unique<MouseCursor>(std::move(image), size, hotspot);
 
         if (cursor_shape.flags() & proto::CursorShape::RESET_CACHE)
         {
@@ -170,9 +225,135 @@ std::shared_ptr<MouseCursor> CursorDecoder::decode(const proto::CursorShape& cur
     return cache_[cache_index];
 }
 
+void CursorDecoder::setHashCache(const proto::CursorCache& cursor_cache)
+{
+    hash_cache_.clear();
+    hash_cache_.reserve(kHashCacheSize + 1);
+
+    for (int i = 0; i < cursor_cache.cursor_size(); ++i)
+    {
+        const proto::CursorShape& cursor_shape = cursor_cache.cursor(i);
+
+        std::shared_ptr<MouseCursor> mouse_cursor = decodeCursor(cursor_shape);
+        if (!mouse_cursor)
+            continue;
+
+        if (CursorEncoder::cursorHash(*mouse_cursor) != cursor_shape.hash())
+        {
+            LOG(LS_WARNING) << "Invalid hash of cached cursor";
+            continue;
+        }
+
+        addToHashCache(cursor_shape.hash(), std::move(mouse_cursor), cursor_shape.data());
+    }
+
+    LOG(LS_INFO) << "Loaded " << hash_cache_.size() << " cursors to hash cache";
+}
+
+std::vector<uint64_t> CursorDecoder::hashCache() const
+{
+    std::vector<uint64_t> hashes;
+    hashes.reserve(hash_cache_.size());
+
+    for (const auto& entry : hash_cache_)
+        hashes.emplace_back(entry.hash);
+
+    return hashes;
+}
+
+void CursorDecoder::hashCacheContents(proto::CursorCache* cursor_cache) const
+{
+    cursor_cache->clear_cursor();
+
+    for (const auto& entry : hash_cache_)
+    {
+        proto::CursorShape* cursor_shape = cursor_cache->add_cursor();
+
+        cursor_shape->set_flags(proto::CursorShape::HASH_CACHE);
+        cursor_shape->set_width(entry.cursor->width());
+        cursor_shape->set_height(entry.cursor->height());
+        cursor_shape->set_hotspot_x(entry.cursor->hotSpotX());
+        cursor_shape->set_hotspot_y(entry.cursor->hotSpotY());
+        cursor_shape->set_data(
+            entry.data.empty() ? compressImage(entry.cursor->constImage()) : entry.data);
+        cursor_shape->set_hash(entry.hash);
+    }
+}
+
+std::shared_ptr<MouseCursor> CursorDecoder::decodeWithHash(const proto::CursorShape& cursor_shape)
+{
+    const uint64_t hash = cursor_shape.hash();
+
+    auto it = std::find_if(hash_cache_.begin(), hash_cache_.end(),
+                           [hash](const HashCacheEntry& entry) { return entry.hash == hash; });
+
+    if (cursor_shape.data().empty())
+    {
+        if (it == hash_cache_.end())
+        {
+            LOG(LS_ERROR) << "Cursor not found in hash cache: " << hash;
+            return nullptr;
+        }
+
+        // The cursor becomes the most recently used in the same way as on the host.
+        HashCacheEntry entry = std::move(*it);
+        hash_cache_.erase(it);
+        hash_cache_.emplace_back(std::move(entry));
+
+        ++taken_from_cache_;
+        previous_cursor_ = hash_cache_.back().cursor;
+        return previous_cursor_;
+    }
+
+    const bool is_delta = cursor_shape.flags() & proto::CursorShape::DELTA;
+
+    std::shared_ptr<MouseCursor> mouse_cursor =
+        is_delta ? decodeDelta(cursor_shape) : decodeCursor(cursor_shape);
+    if (!mouse_cursor)
+        return nullptr;
+
+    // The host sends the image again if it did not know about the cursor.
+    if (it != hash_cache_.end())
+        hash_cache_.erase(it);
+
+    addToHashCache(hash, mouse_cursor, is_delta ? std::string() : cursor_shape.data());
+
+    previous_cursor_ = mouse_cursor;
+    return mouse_cursor;
+}
+
+// static
+std::string CursorDecoder::compressImage(const ByteArray& image)
+{
+    std::string data;
+    data.resize(ZSTD_compressBound(image.size()));
+
+    const size_t ret = ZSTD_compress(
+        data.data(), data.size(), image.data(), image.size(), kCompressionRatio);
+    if (ZSTD_isError(ret))
+    {
+        LOG(LS_WARNING) << "ZSTD_compress failed: " << ZSTD_getErrorName(ret);
+        return std::string();
+    }
+
+    data.resize(ret);
+    return data;
+}
+
+void CursorDecoder::addToHashCache(uint64_t hash,
+                                   std::shared_ptr<MouseCursor> cursor,
+                                   const std::string& data)
+{
+    hash_cache_.push_back({ hash, std::move(cursor), data });
+
+    // Delete the least recently used cursor.
+    if (hash_cache_.size() > kHashCacheSize)
+        hash_cache_.erase(hash_cache_.begin());
+}
+
 int CursorDecoder::cachedCursors() const
 {
-    return static_cast<int>(cache_.size());
+    return static_cast<int>(cache_.size() + hash_cache_.size());
 }
 
 int CursorDecoder::takenCursorsFromCache() const
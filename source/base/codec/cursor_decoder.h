@@ -24,8 +24,11 @@
 #include "base/memory/byte_array.h"
 
 #include <optional>
+#include <string>
+#include <vector>
 
 namespace proto {
+class CursorCache;
 class CursorShape;
 } // namespace proto
 
@@ -39,15 +42,47 @@ public:
     CursorDecoder();
     ~CursorDecoder();
 
+    // The client keeps more cursors than the host expects, so the cursors that were sent before
+    // a configuration change are not lost.
+    static const size_t kHashCacheSize = 512;
+
     std::shared_ptr<MouseCursor> decode(const proto::CursorShape& cursor_shape);
 
+    // Loads the cursors kept from the previous sessions. The cursors with an invalid hash are
+    // skipped.
+    void setHashCache(const proto::CursorCache& cursor_cache);
+
+    // Returns the hashes of the cursors in the cache addressed by hashes, from the oldest to the
+    // newest.
+    std::vector<uint64_t> hashCache() const;
+
+    // Stores the cursors of the cache addressed by hashes to |cursor_cache| to keep them between
+    // sessions.
+    void hashCacheContents(proto::CursorCache* cursor_cache) const;
+
     int cachedCursors() const;
     int takenCursorsFromCache() const;
 
 private:
+    struct HashCacheEntry
+    {
+        uint64_t hash;
+        std::shared_ptr<MouseCursor> cursor;
+        std::string data; // Compressed image. Empty for the cursors received as a difference.
+    };
+
     ByteArray decompressCursor(const proto::CursorShape& cursor_shape) const;
+    std::shared_ptr<MouseCursor> decodeCursor(const proto::CursorShape& cursor_shape) const;
+    std::shared_ptr<MouseCursor> decodeDelta(const proto::CursorShape& cursor_shape) const;
+    std::shared_ptr<MouseCursor> decodeWithHash(const proto::CursorShape& cursor_shape);
+    static std::string compressImage(const ByteArray& image);
+    void addToHashCache(uint64_t hash,
+                        std::shared_ptr<MouseCursor> cursor,
+                        const std::string& data);
 
     std::vector<std::shared_ptr<MouseCursor>> cache_;
+    std::vector<HashCacheEntry> hash_cache_; // The least recently used cursor is the first.
+    std::shared_ptr<MouseCursor> previous_cursor_; // The base of the next difference.
     std::optional<size_t> cache_size_;
     ScopedZstdDStream stream_;
     int taken_from_cache_ = 0;
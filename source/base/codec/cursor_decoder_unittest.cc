@@ -0,0 +1,148 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/cursor_decoder.h"
+#include "base/codec/cursor_encoder.h"
+#include "base/desktop/mouse_cursor.h"
+#include "proto/desktop.pb.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+MouseCursor makeCursor(int frame)
+{
+    const Size size(32, 32);
+
+    ByteArray image(size.width() * size.height() * 4);
+    for (size_t i = 0; i < image.size(); ++i)
+        image[i] = static_cast<uint8_t>(i * 13 + i / 7);
+
+    // Each frame changes a small part of the image, as an animated cursor does.
+    for (int y = 8; y < 12; ++y)
+    {
+        for (int x = 8; x < 12; ++x)
+            image[(y * size.width() + x) * 4] = static_cast<uint8_t>(frame * 31);
+    }
+
+    return MouseCursor(std::move(image), size, Point(1, 2));
+}
+
+std::shared_ptr<MouseCursor> roundTrip(const MouseCursor& mouse_cursor,
+                                       CursorEncoder* encoder,
+                                       CursorDecoder* decoder,
+                                       proto::CursorShape* cursor_shape)
+{
+    cursor_shape->Clear();
+
+    if (!encoder->encode(mouse_cursor, cursor_shape))
+        return nullptr;
+
+    return decoder->decode(*cursor_shape);
+}
+
+bool isEqual(const MouseCursor& first, const MouseCursor& second)
+{
+    return first.size() == second.size() && first.hotSpot() == second.hotSpot() &&
+           first.constImage() == second.constImage();
+}
+
+} // namespace
+
+TEST(CursorDecoderTest, Delta)
+{
+    CursorEncoder encoder;
+    encoder.setHashCache({});
+    encoder.setDeltaEnabled(true);
+
+    CursorDecoder decoder;
+    proto::CursorShape cursor_shape;
+
+    MouseCursor first = makeCursor(1);
+    std::shared_ptr<MouseCursor> decoded = roundTrip(first, &encoder, &decoder, &cursor_shape);
+    ASSERT_TRUE(decoded);
+    EXPECT_FALSE(cursor_shape.flags() & proto::CursorShape::DELTA);
+    EXPECT_TRUE(isEqual(*decoded, first));
+
+    const size_t full_size = cursor_shape.data().size();
+
+    MouseCursor second = makeCursor(2);
+    decoded = roundTrip(second, &encoder, &decoder, &cursor_shape);
+    ASSERT_TRUE(decoded);
+    EXPECT_TRUE(cursor_shape.flags() & proto::CursorShape::DELTA);
+    EXPECT_LT(cursor_shape.data().size(), full_size);
+    EXPECT_TRUE(isEqual(*decoded, second));
+}
+
+TEST(CursorDecoderTest, DeltaAfterCacheHit)
+{
+    CursorEncoder encoder;
+    encoder.setHashCache({});
+    encoder.setDeltaEnabled(true);
+
+    CursorDecoder decoder;
+    proto::CursorShape cursor_shape;
+
+    MouseCursor first = makeCursor(1);
+    MouseCursor second = makeCursor(2);
+    MouseCursor third = makeCursor(3);
+
+    ASSERT_TRUE(roundTrip(first, &encoder, &decoder, &cursor_shape));
+    ASSERT_TRUE(roundTrip(second, &encoder, &decoder, &cursor_shape));
+
+    // The first cursor is taken from the cache and becomes the base of the next difference.
+    std::shared_ptr<MouseCursor> decoded = roundTrip(first, &encoder, &decoder, &cursor_shape);
+    ASSERT_TRUE(decoded);
+    EXPECT_TRUE(cursor_shape.data().empty());
+    EXPECT_TRUE(isEqual(*decoded, first));
+
+    decoded = roundTrip(third, &encoder, &decoder, &cursor_shape);
+    ASSERT_TRUE(decoded);
+    EXPECT_TRUE(cursor_shape.flags() & proto::CursorShape::DELTA);
+    EXPECT_TRUE(isEqual(*decoded, third));
+    EXPECT_EQ(decoder.takenCursorsFromCache(), 1);
+}
+
+TEST(CursorDecoderTest, DeltaCursorIsStoredCompressed)
+{
+    CursorEncoder encoder;
+    encoder.setHashCache({});
+    encoder.setDeltaEnabled(true);
+
+    CursorDecoder decoder;
+    proto::CursorShape cursor_shape;
+
+    MouseCursor first = makeCursor(1);
+    MouseCursor second = makeCursor(2);
+
+    ASSERT_TRUE(roundTrip(first, &encoder, &decoder, &cursor_shape));
+    ASSERT_TRUE(roundTrip(second, &encoder, &decoder, &cursor_shape));
+
+    proto::CursorCache cursor_cache;
+    decoder.hashCacheContents(&cursor_cache);
+
+    // A new session loads both cursors, including the one received as a difference.
+    CursorDecoder other_decoder;
+    other_decoder.setHashCache(cursor_cache);
+    EXPECT_EQ(other_decoder.hashCache(), decoder.hashCache());
+    EXPECT_EQ(other_decoder.hashCache().size(), 2u);
+}
+
+} // namespace base
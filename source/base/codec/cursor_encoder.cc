@@ -19,11 +19,15 @@
 #include "base/codec/cursor_encoder.h"
 
 #include "base/logging.h"
+#include "base/codec/delta_filter.h"
+#include "base/hash64.h"
 #include "base/desktop/mouse_cursor.h"
 #include "proto/desktop.pb.h"
 
 #include <libyuv/compare.h>
 
+#include <algorithm>
+
 namespace base {
 
 namespace {
@@ -62,6 +66,39 @@ CursorEncoder::~CursorEncoder()
     LOG(LS_INFO) << "Dtor";
 }
 
+void CursorEncoder::setHashCache(const std::vector<uint64_t>& client_cache)
+{
+    hash_cache_enabled_ = true;
+
+    // The client does not send more cursors than fit in the cache. If it does, the oldest ones
+    // are dropped on both sides.
+    const size_t count = std::min(client_cache.size(), kHashCacheSize);
+    hash_cache_.assign(client_cache.end() - static_cast<ptrdiff_t>(count), client_cache.end());
+    hash_cache_.reserve(kHashCacheSize + 1);
+
+    LOG(LS_INFO) << "Cursor hash cache enabled (client has " << hash_cache_.size() << " cursors)";
+}
+
+// static
+uint64_t CursorEncoder::cursorHash(const MouseCursor& mouse_cursor)
+{
+    const int32_t values[] = { mouse_cursor.width(), mouse_cursor.height(),
+                               mouse_cursor.hotSpotX(), mouse_cursor.hotSpotY() };
+
+    // The values are hashed in little-endian byte order on all platforms.
+    uint8_t header[sizeof(values)];
+    for (size_t i = 0; i < std::size(values); ++i)
+    {
+        const uint32_t value = static_cast<uint32_t>(values[i]);
+
+        for (size_t j = 0; j < sizeof(uint32_t); ++j)
+            header[i * sizeof(uint32_t) + j] = static_cast<uint8_t>(value >> (j * 8));
+    }
+
+    const ByteArray& image = mouse_cursor.constImage();
+    return hash64(image.data(), image.size(), hash64(header, sizeof(header)));
+}
+
 bool CursorEncoder::compressCursor(
     const MouseCursor& mouse_cursor, proto::CursorShape* cursor_shape) const
 {
@@ -85,6 +122,12 @@ bool CursorEncoder::compressCursor(
         return false;
     }
 
+    return compress(image.data(), image.size(), cursor_shape);
+}
+
+bool CursorEncoder::compress(
+    const uint8_t* data, size_t size, proto::CursorShape* cursor_shape) const
+{
     size_t ret = ZSTD_initCStream(stream_.get(), kCompressionRatio);
     if (ZSTD_isError(ret))
     {
@@ -93,13 +136,10 @@ bool CursorEncoder::compressCursor(
         return false;
     }
 
-    const size_t input_size = image.size();
-    const uint8_t* input_data = image.data();
-
-    const size_t output_size = ZSTD_compressBound(input_size);
+    const size_t output_size = ZSTD_compressBound(size);
     uint8_t* output_data = outputBuffer(cursor_shape, output_size);
 
-    ZSTD_inBuffer input = { input_data, input_size, 0 };
+    ZSTD_inBuffer input = { data, size, 0 };
     ZSTD_outBuffer output = { output_data, output_size, 0 };
 
     while (input.pos < input.size)
@@ -136,6 +176,9 @@ bool CursorEncoder::encode(const MouseCursor& mouse_cursor, proto::CursorShape*
         return false;
     }
 
+    if (hash_cache_enabled_)
+        return encodeWithHash(mouse_cursor, cursor_shape);
+
     // Calculate the hash of the cursor to search in the cache.
     uint32_t hash = libyuv::HashDjb2(mouse_cursor.constImage().data(),
                                      mouse_cursor.constImage().size(),
@@ -187,4 +230,83 @@ bool CursorEncoder::encode(const MouseCursor& mouse_cursor, proto::CursorShape*
     return true;
 }
 
+bool CursorEncoder::encodeWithHash(
+    const MouseCursor& mouse_cursor, proto::CursorShape* cursor_shape)
+{
+    const uint64_t hash = cursorHash(mouse_cursor);
+
+    cursor_shape->set_flags(proto::CursorShape::HASH_CACHE);
+    cursor_shape->set_hash(hash);
+
+    auto it = std::find(hash_cache_.begin(), hash_cache_.end(), hash);
+    if (it != hash_cache_.end())
+    {
+        // The client has the cursor. It becomes the most recently used on both sides.
+        hash_cache_.erase(it);
+        hash_cache_.emplace_back(hash);
+        setPreviousCursor(mouse_cursor);
+        return true;
+    }
+
+    // Set cursor parameters.
+    cursor_shape->set_width(mouse_cursor.width());
+    cursor_shape->set_height(mouse_cursor.height());
+    cursor_shape->set_hotspot_x(mouse_cursor.hotSpotX());
+    cursor_shape->set_hotspot_y(mouse_cursor.hotSpotY());
+
+    if (delta_enabled_ && mouse_cursor.size() == previous_size_)
+    {
+        if (!compressDelta(mouse_cursor, cursor_shape))
+        {
+            LOG(LS_WARNING) << "compressDelta failed";
+            return false;
+        }
+    }
+    else if (!compressCursor(mouse_cursor, cursor_shape))
+    {
+        LOG(LS_WARNING) << "compressCursor failed";
+        return false;
+    }
+
+    hash_cache_.emplace_back(hash);
+
+    // The client removes the least recently used cursor in the same way.
+    if (hash_cache_.size() > kHashCacheSize)
+        hash_cache_.erase(hash_cache_.begin());
+
+    setPreviousCursor(mouse_cursor);
+    return true;
+}
+
+bool CursorEncoder::compressDelta(
+    const MouseCursor& mouse_cursor, proto::CursorShape* cursor_shape)
+{
+    const ByteArray& image = mouse_cursor.constImage();
+    if (image.size() != previous_image_.size())
+    {
+        LOG(LS_WARNING) << "Invalid cursor image buffer";
+        return false;
+    }
+
+    // The pixels that did not change become zeros. Animated cursors usually change only a small
+    // part of the image from frame to frame.
+    delta_ = image;
+    xorDelta(delta_.data(), previous_image_.data(), delta_.size());
+
+    if (!compress(delta_.data(), delta_.size(), cursor_shape))
+        return false;
+
+    cursor_shape->set_flags(cursor_shape->flags() | proto::CursorShape::DELTA);
+    return true;
+}
+
+void CursorEncoder::setPreviousCursor(const MouseCursor& mouse_cursor)
+{
+    if (!delta_enabled_)
+        return;
+
+    previous_size_ = mouse_cursor.size();
+    previous_image_ = mouse_cursor.constImage();
+}
+
 } // namespace base
@@ -21,6 +21,8 @@
 
 #include "base/macros_magic.h"
 #include "base/codec/scoped_zstd_stream.h"
+#include "base/desktop/geometry.h"
+#include "base/memory/byte_array.h"
 
 #include <vector>
 
@@ -38,14 +40,45 @@ public:
     CursorEncoder();
     ~CursorEncoder();
 
+    // Maximum number of cursors in the cache addressed by hashes.
+    static const size_t kHashCacheSize = 256;
+
     bool encode(const MouseCursor& mouse_cursor, proto::CursorShape* cursor_shape);
 
+    // Switches the encoder to the cache addressed by hashes. |client_cache| contains the hashes
+    // of the cursors that the client already has, from the oldest to the newest.
+    void setHashCache(const std::vector<uint64_t>& client_cache);
+
+    // A new cursor of the same size as the previous one is sent as the difference from the
+    // previous image, the unchanged pixels are compressed to almost nothing. Used only with the
+    // cache addressed by hashes (see CURSOR_DELTA).
+    void setDeltaEnabled(bool enabled) { delta_enabled_ = enabled; }
+
+    // Returns the hash of the image, size and hotspot of the cursor. The client computes the
+    // same hash for the cursors in its cache.
+    static uint64_t cursorHash(const MouseCursor& mouse_cursor);
+
 private:
     bool compressCursor(const MouseCursor& mouse_cursor, proto::CursorShape* cursor_shape) const;
+    bool compress(const uint8_t* data, size_t size, proto::CursorShape* cursor_shape) const;
+    bool encodeWithHash(const MouseCursor& mouse_cursor, proto::CursorShape* cursor_shape);
+    bool compressDelta(const MouseCursor& mouse_cursor, proto::CursorShape* cursor_shape);
+    void setPreviousCursor(const MouseCursor& mouse_cursor);
 
     ScopedZstdCStream stream_;
     std::vector<uint32_t> cache_;
 
+    // The order of the hashes is the same as in the cache of the client: the least recently used
+    // cursor is the first.
+    bool hash_cache_enabled_ = false;
+    std::vector<uint64_t> hash_cache_;
+
+    // The last cursor that the client has shown, the next one is sent as the difference from it.
+    bool delta_enabled_ = false;
+    Size previous_size_;
+    ByteArray previous_image_;
+    ByteArray delta_;
+
     DISALLOW_COPY_AND_ASSIGN(CursorEncoder);
 };
 
@@ -0,0 +1,105 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/cursor_encoder.h"
+#include "base/desktop/mouse_cursor.h"
+#include "proto/desktop.pb.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace base {
+
+namespace {
+
+const Size kCursorSize(32, 32);
+
+// More cursors than the encoder cache holds, so every cursor is compressed again.
+const size_t kCursorCount = 40;
+
+std::vector<MouseCursor> createCursors(size_t count)
+{
+    std::vector<MouseCursor> cursors;
+    cursors.reserve(count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        ByteArray image(static_cast<size_t>(
+            kCursorSize.width() * kCursorSize.height() * MouseCursor::kBytesPerPixel));
+
+        // Opaque arrow-like shape on a transparent background.
+        for (int y = 0; y < kCursorSize.height(); ++y)
+        {
+            for (int x = 0; x <= y && x < kCursorSize.width(); ++x)
+            {
+                uint8_t* pixel =
+                    &image[static_cast<size_t>((y * kCursorSize.width() + x) *
+                                               MouseCursor::kBytesPerPixel)];
+                bool border = x == 0 || x == y;
+
+                pixel[0] = border ? 0 : static_cast<uint8_t>(i * 6);
+                pixel[1] = border ? 0 : static_cast<uint8_t>(255 - i * 6);
+                pixel[2] = border ? 0 : 0xFF;
+                pixel[3] = 0xFF;
+            }
+        }
+
+        cursors.emplace_back(std::move(image), kCursorSize, Point(0, 0));
+    }
+
+    return cursors;
+}
+
+void BM_CursorEncodeCacheMiss(benchmark::State& state)
+{
+    std::vector<MouseCursor> cursors = createCursors(kCursorCount);
+    CursorEncoder encoder;
+    proto::CursorShape cursor_shape;
+    size_t index = 0;
+
+    for (auto _ : state)
+    {
+        cursor_shape.Clear();
+        encoder.encode(cursors[index], &cursor_shape);
+        benchmark::DoNotOptimize(cursor_shape);
+
+        index = (index + 1) % cursors.size();
+    }
+}
+
+void BM_CursorEncodeCacheHit(benchmark::State& state)
+{
+    std::vector<MouseCursor> cursors = createCursors(1);
+    CursorEncoder encoder;
+    proto::CursorShape cursor_shape;
+
+    for (auto _ : state)
+    {
+        cursor_shape.Clear();
+        encoder.encode(cursors.front(), &cursor_shape);
+        benchmark::DoNotOptimize(cursor_shape);
+    }
+}
+
+BENCHMARK(BM_CursorEncodeCacheMiss);
+BENCHMARK(BM_CursorEncodeCacheHit);
+
+} // namespace
+
+} // namespace base
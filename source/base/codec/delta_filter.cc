@@ -0,0 +1,74 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/delta_filter.h"
+
+#include <cstring>
+
+namespace base {
+
+void xorDelta(uint8_t* data, const uint8_t* reference, size_t size)
+{
+    size_t i = 0;
+
+    // Whole words are processed first, the compiler turns the loop into SIMD instructions.
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t value;
+        uint64_t reference_value;
+
+        memcpy(&value, data + i, sizeof(value));
+        memcpy(&reference_value, reference + i, sizeof(reference_value));
+
+        value ^= reference_value;
+        memcpy(data + i, &value, sizeof(value));
+    }
+
+    for (; i < size; ++i)
+        data[i] ^= reference[i];
+}
+
+bool isDeltaCheaper(const uint8_t* data, const uint8_t* reference, size_t size)
+{
+    if (size < 2)
+        return false;
+
+    size_t raw_changes = 0;
+    size_t delta_changes = 0;
+
+    uint8_t previous_raw = data[0];
+    uint8_t previous_delta = data[0] ^ reference[0];
+
+    for (size_t i = 1; i < size; ++i)
+    {
+        const uint8_t raw = data[i];
+        const uint8_t delta = raw ^ reference[i];
+
+        raw_changes += raw != previous_raw;
+        delta_changes += delta != previous_delta;
+
+        previous_raw = raw;
+        previous_delta = delta;
+    }
+
+    // The data itself may still be found by zstd in the previous frames, so the delta is used
+    // only if it is clearly simpler.
+    return delta_changes * 2 < raw_changes;
+}
+
+} // namespace base
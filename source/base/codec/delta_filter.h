@@ -0,0 +1,39 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CODEC__DELTA_FILTER_H
+#define BASE__CODEC__DELTA_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace base {
+
+// XORs |data| with |reference| in place. The areas of |data| equal to |reference| become zeros,
+// which compress much better than the pixels themselves. Applying it again restores the data.
+void xorDelta(uint8_t* data, const uint8_t* reference, size_t size);
+
+// Estimates whether the XOR delta of |data| against |reference| compresses better than |data|
+// itself. Compares the number of changes between neighbouring bytes, which approximates the
+// number of literals and matches that zstd has to encode. The delta must be at least twice as
+// simple to be chosen.
+bool isDeltaCheaper(const uint8_t* data, const uint8_t* reference, size_t size);
+
+} // namespace base
+
+#endif // BASE__CODEC__DELTA_FILTER_H
@@ -0,0 +1,66 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/delta_filter.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace base {
+
+TEST(DeltaFilterTest, RoundTrip)
+{
+    std::vector<uint8_t> reference(1001);
+    std::vector<uint8_t> data(reference.size());
+
+    for (size_t i = 0; i < reference.size(); ++i)
+    {
+        reference[i] = static_cast<uint8_t>(i * 7);
+        data[i] = static_cast<uint8_t>(i * 7 + (i % 100 == 0 ? 1 : 0));
+    }
+
+    const std::vector<uint8_t> original = data;
+
+    xorDelta(data.data(), reference.data(), data.size());
+
+    for (size_t i = 0; i < data.size(); ++i)
+        EXPECT_EQ(data[i], i % 100 == 0 ? (original[i] ^ reference[i]) : 0) << i;
+
+    xorDelta(data.data(), reference.data(), data.size());
+    EXPECT_EQ(data, original);
+}
+
+TEST(DeltaFilterTest, Selection)
+{
+    // The text has slightly changed on a gradient background: the delta is almost empty.
+    std::vector<uint8_t> reference(256);
+    for (size_t i = 0; i < reference.size(); ++i)
+        reference[i] = static_cast<uint8_t>(i);
+
+    std::vector<uint8_t> data = reference;
+    data[100] ^= 0x10;
+
+    EXPECT_TRUE(isDeltaCheaper(data.data(), reference.data(), data.size()));
+
+    // A new solid area over a gradient compresses better as is.
+    std::vector<uint8_t> solid(reference.size(), 0xFF);
+    EXPECT_FALSE(isDeltaCheaper(solid.data(), reference.data(), solid.size()));
+}
+
+} // namespace base
@@ -0,0 +1,260 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/palette.h"
+
+#include <array>
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+// The hash table is four times larger than the palette, so the chains stay short.
+const int kTableBits = 10;
+const size_t kTableSize = 1 << kTableBits;
+
+uint32_t readPixel(const uint8_t* pixel, int bytes_per_pixel)
+{
+    switch (bytes_per_pixel)
+    {
+        case 1:
+            return *pixel;
+
+        case 2:
+        {
+            uint16_t value;
+            memcpy(&value, pixel, sizeof(value));
+            return value;
+        }
+
+        default:
+        {
+            uint32_t value;
+            memcpy(&value, pixel, sizeof(value));
+            return value;
+        }
+    }
+}
+
+void writePixel(uint8_t* pixel, uint32_t color, int bytes_per_pixel)
+{
+    switch (bytes_per_pixel)
+    {
+        case 1:
+            *pixel = static_cast<uint8_t>(color);
+            break;
+
+        case 2:
+        {
+            const uint16_t value = static_cast<uint16_t>(color);
+            memcpy(pixel, &value, sizeof(value));
+        }
+        break;
+
+        default:
+            memcpy(pixel, &color, sizeof(color));
+            break;
+    }
+}
+
+class ColorTable
+{
+public:
+    ColorTable() { indexes_.fill(-1); }
+
+    // Returns the index of |color| in the palette or -1 if it is not there.
+    int find(uint32_t color) const
+    {
+        for (size_t slot = hash(color);; slot = (slot + 1) & (kTableSize - 1))
+        {
+            if (indexes_[slot] == -1 || colors_[slot] == color)
+                return indexes_[slot];
+        }
+    }
+
+    void insert(uint32_t color, int index)
+    {
+        size_t slot = hash(color);
+
+        while (indexes_[slot] != -1)
+            slot = (slot + 1) & (kTableSize - 1);
+
+        colors_[slot] = color;
+        indexes_[slot] = static_cast<int16_t>(index);
+    }
+
+private:
+    static size_t hash(uint32_t color)
+    {
+        return static_cast<size_t>((color * 2654435761u) >> (32 - kTableBits));
+    }
+
+    std::array<uint32_t, kTableSize> colors_;
+    std::array<int16_t, kTableSize> indexes_;
+};
+
+} // namespace
+
+int paletteIndexBits(uint32_t palette_size)
+{
+    if (palette_size <= 2)
+        return 1;
+    if (palette_size <= 4)
+        return 2;
+    if (palette_size <= 16)
+        return 4;
+    return 8;
+}
+
+size_t paletteDataSize(int width, int height, int bytes_per_pixel, uint32_t palette_size)
+{
+    const size_t row_size =
+        (static_cast<size_t>(width) * static_cast<size_t>(paletteIndexBits(palette_size)) + 7) / 8;
+
+    return static_cast<size_t>(palette_size) * static_cast<size_t>(bytes_per_pixel) +
+        row_size * static_cast<size_t>(height);
+}
+
+uint32_t encodePalette(const uint8_t* data, int width, int height, int bytes_per_pixel,
+                       uint8_t* output)
+{
+    const size_t pixel_count = static_cast<size_t>(width) * static_cast<size_t>(height);
+    const size_t data_size = pixel_count * static_cast<size_t>(bytes_per_pixel);
+
+    // The 8-bit indices are not smaller than the 8-bit pixels.
+    const uint32_t max_palette_size = bytes_per_pixel == 1 ? 16 : kMaxPaletteSize;
+
+    ColorTable table;
+    uint32_t palette_size = 0;
+
+    // The neighbouring pixels usually have the same color.
+    uint32_t last_color = 0;
+    int last_index = -1;
+
+    for (size_t i = 0; i < pixel_count; ++i)
+    {
+        const uint32_t color = readPixel(data + i * static_cast<size_t>(bytes_per_pixel),
+                                         bytes_per_pixel);
+        if (last_index != -1 && color == last_color)
+            continue;
+
+        int index = table.find(color);
+        if (index == -1)
+        {
+            if (palette_size == max_palette_size)
+                return 0;
+
+            index = static_cast<int>(palette_size++);
+            table.insert(color, index);
+
+            writePixel(output + static_cast<size_t>(index * bytes_per_pixel), color,
+                       bytes_per_pixel);
+        }
+
+        last_color = color;
+        last_index = index;
+    }
+
+    if (!palette_size ||
+        paletteDataSize(width, height, bytes_per_pixel, palette_size) >= data_size)
+    {
+        return 0;
+    }
+
+    const int index_bits = paletteIndexBits(palette_size);
+    uint8_t* pos = output + palette_size * static_cast<uint32_t>(bytes_per_pixel);
+    last_index = -1;
+
+    for (int y = 0; y < height; ++y)
+    {
+        unsigned int bits = 0;
+        int bit_count = 0;
+
+        for (int x = 0; x < width; ++x)
+        {
+            const uint32_t color = readPixel(data, bytes_per_pixel);
+            data += bytes_per_pixel;
+
+            if (last_index == -1 || color != last_color)
+            {
+                last_color = color;
+                last_index = table.find(color);
+            }
+
+            bits = (bits << index_bits) | static_cast<unsigned int>(last_index);
+            bit_count += index_bits;
+
+            if (bit_count == 8)
+            {
+                *pos++ = static_cast<uint8_t>(bits);
+                bits = 0;
+                bit_count = 0;
+            }
+        }
+
+        if (bit_count)
+            *pos++ = static_cast<uint8_t>(bits << (8 - bit_count));
+    }
+
+    return palette_size;
+}
+
+bool decodePalette(const uint8_t* data, int width, int height, int bytes_per_pixel,
+                   uint32_t palette_size, uint8_t* output, int output_stride)
+{
+    if (!palette_size || palette_size > kMaxPaletteSize)
+        return false;
+
+    std::array<uint32_t, kMaxPaletteSize> colors;
+
+    for (uint32_t i = 0; i < palette_size; ++i)
+    {
+        colors[i] = readPixel(data, bytes_per_pixel);
+        data += bytes_per_pixel;
+    }
+
+    const int index_bits = paletteIndexBits(palette_size);
+    const unsigned int index_mask = (1u << index_bits) - 1;
+    const size_t row_size = (static_cast<size_t>(width) * static_cast<size_t>(index_bits) + 7) / 8;
+
+    for (int y = 0; y < height; ++y)
+    {
+        uint8_t* pixel = output;
+
+        for (int x = 0; x < width; ++x)
+        {
+            const int bit_pos = x * index_bits;
+            const unsigned int index =
+                (data[bit_pos / 8] >> (8 - index_bits - bit_pos % 8)) & index_mask;
+
+            if (index >= palette_size)
+                return false;
+
+            writePixel(pixel, colors[index], bytes_per_pixel);
+            pixel += bytes_per_pixel;
+        }
+
+        data += row_size;
+        output += output_stride;
+    }
+
+    return true;
+}
+
+} // namespace base
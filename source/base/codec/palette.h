@@ -0,0 +1,52 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CODEC__PALETTE_H
+#define BASE__CODEC__PALETTE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace base {
+
+// The indexed image is the palette (|palette_size| pixels) followed by the rows of the pixel
+// indices. The indices take 1, 2, 4 or 8 bits depending on the palette size, they are packed from
+// the high bits of a byte and each row starts with a new byte.
+
+const uint32_t kMaxPaletteSize = 256;
+
+// Returns the number of bits in an index for a palette of |palette_size| colors.
+int paletteIndexBits(uint32_t palette_size);
+
+// Returns the size of an indexed |width|x|height| image.
+size_t paletteDataSize(int width, int height, int bytes_per_pixel, uint32_t palette_size);
+
+// Converts the |width|x|height| image in |data| (rows without padding) to the indexed image in
+// |output|, which must have the size of |data|. Returns the palette size or 0 if the image has too
+// many colors for the indexed image to be smaller.
+uint32_t encodePalette(const uint8_t* data, int width, int height, int bytes_per_pixel,
+                       uint8_t* output);
+
+// Converts the indexed image in |data| back to pixels. Returns false if an index is outside the
+// palette.
+bool decodePalette(const uint8_t* data, int width, int height, int bytes_per_pixel,
+                   uint32_t palette_size, uint8_t* output, int output_stride);
+
+} // namespace base
+
+#endif // BASE__CODEC__PALETTE_H
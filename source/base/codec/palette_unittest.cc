@@ -0,0 +1,94 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/palette.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace base {
+
+namespace {
+
+std::vector<uint8_t> createImage(int width, int height, int bytes_per_pixel, uint32_t colors)
+{
+    std::vector<uint8_t> image(static_cast<size_t>(width * height * bytes_per_pixel));
+
+    for (size_t i = 0; i < image.size(); i += static_cast<size_t>(bytes_per_pixel))
+    {
+        const size_t pixel = i / static_cast<size_t>(bytes_per_pixel);
+        const uint32_t color = static_cast<uint32_t>((pixel / 2) % colors) * 0x01010101u;
+        for (int j = 0; j < bytes_per_pixel; ++j)
+            image[i + static_cast<size_t>(j)] = static_cast<uint8_t>(color >> (j * 8));
+    }
+
+    return image;
+}
+
+} // namespace
+
+TEST(PaletteTest, RoundTrip)
+{
+    const int kWidth = 37;
+    const int kHeight = 11;
+
+    for (int bytes_per_pixel : { 1, 2, 4 })
+    {
+        for (uint32_t colors : { 1u, 2u, 3u, 16u, 17u, 200u })
+        {
+            if (bytes_per_pixel == 1 && colors > 16)
+                continue;
+
+            const std::vector<uint8_t> image =
+                createImage(kWidth, kHeight, bytes_per_pixel, colors);
+            std::vector<uint8_t> indexed(image.size());
+
+            const uint32_t palette_size =
+                encodePalette(image.data(), kWidth, kHeight, bytes_per_pixel, indexed.data());
+            ASSERT_EQ(palette_size, colors) << bytes_per_pixel;
+
+            std::vector<uint8_t> decoded(image.size());
+            ASSERT_TRUE(decodePalette(indexed.data(), kWidth, kHeight, bytes_per_pixel,
+                                      palette_size, decoded.data(), kWidth * bytes_per_pixel));
+            EXPECT_EQ(decoded, image) << bytes_per_pixel << " " << colors;
+        }
+    }
+}
+
+TEST(PaletteTest, TooManyColors)
+{
+    std::vector<uint8_t> image = createImage(64, 8, 1, 17);
+    std::vector<uint8_t> indexed(image.size());
+    EXPECT_EQ(encodePalette(image.data(), 64, 8, 1, indexed.data()), 0u);
+
+    image = createImage(64, 16, 4, kMaxPaletteSize + 1);
+    indexed.resize(image.size());
+    EXPECT_EQ(encodePalette(image.data(), 64, 16, 4, indexed.data()), 0u);
+}
+
+TEST(PaletteTest, InvalidIndex)
+{
+    // Three colors use 2-bit indices, the index 3 is outside the palette.
+    const uint8_t data[] = { 0x00, 0x11, 0x22, 0x1B };
+    uint8_t output[4];
+
+    EXPECT_FALSE(decodePalette(data, 4, 1, 1, 3, output, 4));
+}
+
+} // namespace base
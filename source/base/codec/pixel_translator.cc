@@ -18,9 +18,15 @@
 
 #include "base/codec/pixel_translator.h"
 
+#include "base/logging.h"
 #include "base/macros_magic.h"
+#include "base/codec/pixel_translator_avx2.h"
+#include "base/codec/pixel_translator_neon.h"
+#include "base/codec/pixel_translator_sse2.h"
 #include "build/build_config.h"
 
+#include <libyuv/cpu_id.h>
+
 #include <limits>
 
 namespace base {
@@ -29,6 +35,61 @@ namespace {
 
 const int kBlockSize = 16;
 
+using VectorTranslateFunc = int (*)(const PixelFormat& source_format,
+                                    const PixelFormat& target_format,
+                                    const uint8_t* src, int src_stride,
+                                    uint8_t* dst, int dst_stride,
+                                    int width, int height);
+
+// Returns the vectorized function for the translation from 32bpp with 8-bit color components to
+// 16bpp or 8bpp. Returns nullptr if the formats or the processor are not supported.
+VectorTranslateFunc vectorTranslateFunc(const PixelFormat& source_format,
+                                        const PixelFormat& target_format)
+{
+    if (source_format.bytesPerPixel() != 4 || source_format.redMax() != 255 ||
+        source_format.greenMax() != 255 || source_format.blueMax() != 255)
+    {
+        return nullptr;
+    }
+
+    if (target_format.redMax() > 255 || target_format.greenMax() > 255 ||
+        target_format.blueMax() > 255)
+    {
+        return nullptr;
+    }
+
+    const uint8_t bytes_per_pixel = target_format.bytesPerPixel();
+    if (bytes_per_pixel != 2 && bytes_per_pixel != 1)
+        return nullptr;
+
+#if defined(ARCH_CPU_X86_FAMILY)
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
+    {
+        LOG(LS_INFO) << "AVX2 pixel translator loaded";
+
+        return bytes_per_pixel == 2 ?
+            translatePixels_32bppTo16bpp_AVX2 : translatePixels_32bppTo8bpp_AVX2;
+    }
+    else if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+    {
+        LOG(LS_INFO) << "SSE2 pixel translator loaded";
+
+        return bytes_per_pixel == 2 ?
+            translatePixels_32bppTo16bpp_SSE2 : translatePixels_32bppTo8bpp_SSE2;
+    }
+#elif defined(ARCH_CPU_ARM64)
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasNEON))
+    {
+        LOG(LS_INFO) << "NEON pixel translator loaded";
+
+        return bytes_per_pixel == 2 ?
+            translatePixels_32bppTo16bpp_NEON : translatePixels_32bppTo8bpp_NEON;
+    }
+#endif // defined(ARCH_CPU_*)
+
+    return nullptr;
+}
+
 template<typename SourceT, typename TargetT>
 class PixelTranslatorT : public PixelTranslator
 {
@@ -36,7 +97,8 @@ public:
     PixelTranslatorT(const PixelFormat& source_format,
                      const PixelFormat& target_format)
         : source_format_(source_format),
-          target_format_(target_format)
+          target_format_(target_format),
+          vector_func_(vectorTranslateFunc(source_format, target_format))
     {
         red_table_ = std::make_unique<uint32_t[]>(source_format_.redMax() + 1);
         green_table_ = std::make_unique<uint32_t[]>(source_format_.greenMax() + 1);
@@ -79,6 +141,18 @@ public:
                    uint8_t* dst, int dst_stride,
                    int width, int height) override
     {
+        if (vector_func_)
+        {
+            // The vectorized function translates whole blocks only, the rest of each row is
+            // translated below.
+            const int vector_width = vector_func_(
+                source_format_, target_format_, src, src_stride, dst, dst_stride, width, height);
+
+            src += vector_width * sizeof(SourceT);
+            dst += vector_width * sizeof(TargetT);
+            width -= vector_width;
+        }
+
         const int block_count = width / kBlockSize;
         const int partial_width = width - (block_count * kBlockSize);
 
@@ -122,6 +196,7 @@ private:
 
     PixelFormat source_format_;
     PixelFormat target_format_;
+    VectorTranslateFunc vector_func_;
 
     DISALLOW_COPY_AND_ASSIGN(PixelTranslatorT);
 };
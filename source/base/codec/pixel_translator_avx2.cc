@@ -0,0 +1,166 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/pixel_translator_avx2.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif // defined(CC_*)
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+namespace base {
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+namespace {
+
+struct Component
+{
+    Component(uint8_t source_shift, uint16_t target_max, uint8_t target_shift)
+        : source_shift(_mm_cvtsi32_si128(source_shift)),
+          target_max(_mm256_set1_epi16(static_cast<short>(target_max))),
+          target_shift(_mm_cvtsi32_si128(target_shift))
+    {
+        // Nothing
+    }
+
+    const __m128i source_shift;
+    const __m256i target_max;
+    const __m128i target_shift;
+};
+
+class Translator
+{
+public:
+    Translator(const PixelFormat& source_format, const PixelFormat& target_format)
+        : red_(source_format.redShift(), target_format.redMax(), target_format.redShift()),
+          green_(source_format.greenShift(), target_format.greenMax(), target_format.greenShift()),
+          blue_(source_format.blueShift(), target_format.blueMax(), target_format.blueShift())
+    {
+        // Nothing
+    }
+
+    // Translates 16 pixels to 16-bit values. The packing works inside 128-bit lanes, so groups of
+    // 4 values are returned in the order 0, 2, 1, 3.
+    __m256i translate(const uint8_t* src) const
+    {
+        const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+        const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32));
+
+        return _mm256_or_si256(
+            _mm256_or_si256(component(lo, hi, red_), component(lo, hi, green_)),
+            component(lo, hi, blue_));
+    }
+
+private:
+    static __m256i component(__m256i lo, __m256i hi, const Component& component)
+    {
+        const __m256i mask = _mm256_set1_epi32(0xFF);
+
+        // The values are at most 255, so the signed saturation does not change them.
+        __m256i value = _mm256_packs_epi32(
+            _mm256_and_si256(_mm256_srl_epi32(lo, component.source_shift), mask),
+            _mm256_and_si256(_mm256_srl_epi32(hi, component.source_shift), mask));
+
+        // (value * max + 127) / 255, the same rounding as in the generic translator. The division
+        // is exact for all 8-bit values and maximums up to 255.
+        value = _mm256_add_epi16(
+            _mm256_mullo_epi16(value, component.target_max), _mm256_set1_epi16(127));
+        value = _mm256_srli_epi16(_mm256_add_epi16(
+            _mm256_add_epi16(value, _mm256_set1_epi16(1)), _mm256_srli_epi16(value, 8)), 8);
+
+        return _mm256_sll_epi16(value, component.target_shift);
+    }
+
+    const Component red_;
+    const Component green_;
+    const Component blue_;
+};
+
+} // namespace
+
+int translatePixels_32bppTo16bpp_AVX2(const PixelFormat& source_format,
+                                      const PixelFormat& target_format,
+                                      const uint8_t* src, int src_stride,
+                                      uint8_t* dst, int dst_stride,
+                                      int width, int height)
+{
+    const Translator translator(source_format, target_format);
+    const int block_count = width / 16;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t* src_ptr = src;
+        uint8_t* dst_ptr = dst;
+
+        for (int x = 0; x < block_count; ++x)
+        {
+            const __m256i value = _mm256_permute4x64_epi64(translator.translate(src_ptr), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst_ptr), value);
+
+            src_ptr += 64;
+            dst_ptr += 32;
+        }
+
+        src += src_stride;
+        dst += dst_stride;
+    }
+
+    return block_count * 16;
+}
+
+int translatePixels_32bppTo8bpp_AVX2(const PixelFormat& source_format,
+                                     const PixelFormat& target_format,
+                                     const uint8_t* src, int src_stride,
+                                     uint8_t* dst, int dst_stride,
+                                     int width, int height)
+{
+    const Translator translator(source_format, target_format);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    const int block_count = width / 32;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t* src_ptr = src;
+        uint8_t* dst_ptr = dst;
+
+        for (int x = 0; x < block_count; ++x)
+        {
+            const __m256i lo = translator.translate(src_ptr);
+            const __m256i hi = translator.translate(src_ptr + 64);
+
+            const __m256i value = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(lo, hi), order);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst_ptr), value);
+
+            src_ptr += 128;
+            dst_ptr += 32;
+        }
+
+        src += src_stride;
+        dst += dst_stride;
+    }
+
+    return block_count * 32;
+}
+
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+} // namespace base
@@ -0,0 +1,87 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/pixel_translator.h"
+#include "base/desktop/benchmark_frame_source.h"
+#include "base/desktop/frame_simple.h"
+
+#include <benchmark/benchmark.h>
+
+namespace base {
+
+namespace {
+
+const Size kFrameSize(1920, 1080);
+
+PixelFormat targetFormat(int64_t index)
+{
+    switch (index)
+    {
+        case 0:
+            return PixelFormat::ARGB();
+
+        case 1:
+            return PixelFormat::RGB565();
+
+        case 2:
+            return PixelFormat::RGB332();
+
+        case 3:
+            return PixelFormat::RGB222();
+
+        default:
+            return PixelFormat::RGB111();
+    }
+}
+
+void BM_PixelTranslator(benchmark::State& state)
+{
+    BenchmarkFrameSource source(BenchmarkFrameSource::Scene::OFFICE, kFrameSize);
+    const Frame* source_frame = source.nextFrame();
+
+    PixelFormat target_format = targetFormat(state.range(0));
+    std::unique_ptr<FrameSimple> target_frame = FrameSimple::create(kFrameSize, target_format);
+    std::unique_ptr<PixelTranslator> translator =
+        PixelTranslator::create(PixelFormat::ARGB(), target_format);
+
+    if (!target_frame || !translator)
+    {
+        state.SkipWithError("Unable to create translator");
+        return;
+    }
+
+    for (auto _ : state)
+    {
+        translator->translate(source_frame->frameData(), source_frame->stride(),
+                              target_frame->frameData(), target_frame->stride(),
+                              kFrameSize.width(), kFrameSize.height());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            kFrameSize.width() * kFrameSize.height() * 4);
+}
+
+BENCHMARK(BM_PixelTranslator)
+    ->ArgName("format")
+    ->DenseRange(0, 4)
+    ->Unit(benchmark::kMicrosecond);
+
+} // namespace
+
+} // namespace base
@@ -0,0 +1,155 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/pixel_translator_neon.h"
+
+#if defined(ARCH_CPU_ARM64)
+#include <arm_neon.h>
+#endif // defined(ARCH_CPU_ARM64)
+
+namespace base {
+
+#if defined(ARCH_CPU_ARM64)
+
+namespace {
+
+struct Component
+{
+    Component(uint8_t source_shift, uint16_t target_max, uint8_t target_shift)
+        : source_shift(vdupq_n_s32(-static_cast<int32_t>(source_shift))),
+          target_max(vdupq_n_u16(target_max)),
+          target_shift(vdupq_n_s16(static_cast<int16_t>(target_shift)))
+    {
+        // Nothing
+    }
+
+    // NEON shifts right by a variable count using a negative left shift.
+    const int32x4_t source_shift;
+    const uint16x8_t target_max;
+    const int16x8_t target_shift;
+};
+
+class Translator
+{
+public:
+    Translator(const PixelFormat& source_format, const PixelFormat& target_format)
+        : red_(source_format.redShift(), target_format.redMax(), target_format.redShift()),
+          green_(source_format.greenShift(), target_format.greenMax(), target_format.greenShift()),
+          blue_(source_format.blueShift(), target_format.blueMax(), target_format.blueShift())
+    {
+        // Nothing
+    }
+
+    // Translates 8 pixels to 16-bit values.
+    uint16x8_t translate(const uint8_t* src) const
+    {
+        const uint32x4_t lo = vld1q_u32(reinterpret_cast<const uint32_t*>(src));
+        const uint32x4_t hi = vld1q_u32(reinterpret_cast<const uint32_t*>(src + 16));
+
+        return vorrq_u16(vorrq_u16(component(lo, hi, red_), component(lo, hi, green_)),
+                         component(lo, hi, blue_));
+    }
+
+private:
+    static uint16x8_t component(uint32x4_t lo, uint32x4_t hi, const Component& component)
+    {
+        const uint32x4_t mask = vdupq_n_u32(0xFF);
+
+        uint16x8_t value = vcombine_u16(
+            vmovn_u32(vandq_u32(vshlq_u32(lo, component.source_shift), mask)),
+            vmovn_u32(vandq_u32(vshlq_u32(hi, component.source_shift), mask)));
+
+        // (value * max + 127) / 255, the same rounding as in the generic translator. The division
+        // is exact for all 8-bit values and maximums up to 255.
+        value = vmlaq_u16(vdupq_n_u16(127), value, component.target_max);
+        value = vshrq_n_u16(vaddq_u16(vaddq_u16(value, vdupq_n_u16(1)), vshrq_n_u16(value, 8)), 8);
+
+        return vshlq_u16(value, component.target_shift);
+    }
+
+    const Component red_;
+    const Component green_;
+    const Component blue_;
+};
+
+} // namespace
+
+int translatePixels_32bppTo16bpp_NEON(const PixelFormat& source_format,
+                                      const PixelFormat& target_format,
+                                      const uint8_t* src, int src_stride,
+                                      uint8_t* dst, int dst_stride,
+                                      int width, int height)
+{
+    const Translator translator(source_format, target_format);
+    const int block_count = width / 8;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t* src_ptr = src;
+        uint8_t* dst_ptr = dst;
+
+        for (int x = 0; x < block_count; ++x)
+        {
+            vst1q_u16(reinterpret_cast<uint16_t*>(dst_ptr), translator.translate(src_ptr));
+
+            src_ptr += 32;
+            dst_ptr += 16;
+        }
+
+        src += src_stride;
+        dst += dst_stride;
+    }
+
+    return block_count * 8;
+}
+
+int translatePixels_32bppTo8bpp_NEON(const PixelFormat& source_format,
+                                     const PixelFormat& target_format,
+                                     const uint8_t* src, int src_stride,
+                                     uint8_t* dst, int dst_stride,
+                                     int width, int height)
+{
+    const Translator translator(source_format, target_format);
+    const int block_count = width / 16;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t* src_ptr = src;
+        uint8_t* dst_ptr = dst;
+
+        for (int x = 0; x < block_count; ++x)
+        {
+            const uint16x8_t lo = translator.translate(src_ptr);
+            const uint16x8_t hi = translator.translate(src_ptr + 32);
+
+            vst1q_u8(dst_ptr, vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)));
+
+            src_ptr += 64;
+            dst_ptr += 16;
+        }
+
+        src += src_stride;
+        dst += dst_stride;
+    }
+
+    return block_count * 16;
+}
+
+#endif // defined(ARCH_CPU_ARM64)
+
+} // namespace base
@@ -0,0 +1,160 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/pixel_translator_sse2.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <emmintrin.h>
+#endif // defined(CC_*)
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+namespace base {
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+namespace {
+
+struct Component
+{
+    Component(uint8_t source_shift, uint16_t target_max, uint8_t target_shift)
+        : source_shift(_mm_cvtsi32_si128(source_shift)),
+          target_max(_mm_set1_epi16(static_cast<short>(target_max))),
+          target_shift(_mm_cvtsi32_si128(target_shift))
+    {
+        // Nothing
+    }
+
+    const __m128i source_shift;
+    const __m128i target_max;
+    const __m128i target_shift;
+};
+
+class Translator
+{
+public:
+    Translator(const PixelFormat& source_format, const PixelFormat& target_format)
+        : red_(source_format.redShift(), target_format.redMax(), target_format.redShift()),
+          green_(source_format.greenShift(), target_format.greenMax(), target_format.greenShift()),
+          blue_(source_format.blueShift(), target_format.blueMax(), target_format.blueShift())
+    {
+        // Nothing
+    }
+
+    // Translates 8 pixels to 16-bit values.
+    __m128i translate(const uint8_t* src) const
+    {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+
+        return _mm_or_si128(_mm_or_si128(component(lo, hi, red_), component(lo, hi, green_)),
+                            component(lo, hi, blue_));
+    }
+
+private:
+    static __m128i component(__m128i lo, __m128i hi, const Component& component)
+    {
+        const __m128i mask = _mm_set1_epi32(0xFF);
+
+        // The values are at most 255, so the signed saturation does not change them.
+        __m128i value = _mm_packs_epi32(
+            _mm_and_si128(_mm_srl_epi32(lo, component.source_shift), mask),
+            _mm_and_si128(_mm_srl_epi32(hi, component.source_shift), mask));
+
+        // (value * max + 127) / 255, the same rounding as in the generic translator. The division
+        // is exact for all 8-bit values and maximums up to 255.
+        value = _mm_add_epi16(_mm_mullo_epi16(value, component.target_max), _mm_set1_epi16(127));
+        value = _mm_srli_epi16(
+            _mm_add_epi16(_mm_add_epi16(value, _mm_set1_epi16(1)), _mm_srli_epi16(value, 8)), 8);
+
+        return _mm_sll_epi16(value, component.target_shift);
+    }
+
+    const Component red_;
+    const Component green_;
+    const Component blue_;
+};
+
+} // namespace
+
+int translatePixels_32bppTo16bpp_SSE2(const PixelFormat& source_format,
+                                      const PixelFormat& target_format,
+                                      const uint8_t* src, int src_stride,
+                                      uint8_t* dst, int dst_stride,
+                                      int width, int height)
+{
+    const Translator translator(source_format, target_format);
+    const int block_count = width / 8;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t* src_ptr = src;
+        uint8_t* dst_ptr = dst;
+
+        for (int x = 0; x < block_count; ++x)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_ptr), translator.translate(src_ptr));
+
+            src_ptr += 32;
+            dst_ptr += 16;
+        }
+
+        src += src_stride;
+        dst += dst_stride;
+    }
+
+    return block_count * 8;
+}
+
+int translatePixels_32bppTo8bpp_SSE2(const PixelFormat& source_format,
+                                     const PixelFormat& target_format,
+                                     const uint8_t* src, int src_stride,
+                                     uint8_t* dst, int dst_stride,
+                                     int width, int height)
+{
+    const Translator translator(source_format, target_format);
+    const int block_count = width / 16;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t* src_ptr = src;
+        uint8_t* dst_ptr = dst;
+
+        for (int x = 0; x < block_count; ++x)
+        {
+            const __m128i lo = translator.translate(src_ptr);
+            const __m128i hi = translator.translate(src_ptr + 32);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_ptr), _mm_packus_epi16(lo, hi));
+
+            src_ptr += 64;
+            dst_ptr += 16;
+        }
+
+        src += src_stride;
+        dst += dst_stride;
+    }
+
+    return block_count * 16;
+}
+
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+} // namespace base
@@ -0,0 +1,49 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CODEC__PIXEL_TRANSLATOR_SSE2_H
+#define BASE__CODEC__PIXEL_TRANSLATOR_SSE2_H
+
+#include "base/desktop/pixel_format.h"
+#include "build/build_config.h"
+
+namespace base {
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+// The functions must be called only if the processor supports SSE2. The source pixels must be
+// 32bpp with 8-bit color components. Only whole blocks of 8 (16bpp) or 16 (8bpp) pixels are
+// translated. Returns the number of translated pixels in each row.
+
+int translatePixels_32bppTo16bpp_SSE2(const PixelFormat& source_format,
+                                      const PixelFormat& target_format,
+                                      const uint8_t* src, int src_stride,
+                                      uint8_t* dst, int dst_stride,
+                                      int width, int height);
+
+int translatePixels_32bppTo8bpp_SSE2(const PixelFormat& source_format,
+                                     const PixelFormat& target_format,
+                                     const uint8_t* src, int src_stride,
+                                     uint8_t* dst, int dst_stride,
+                                     int width, int height);
+
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+} // namespace base
+
+#endif // BASE__CODEC__PIXEL_TRANSLATOR_SSE2_H
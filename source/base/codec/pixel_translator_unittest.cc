@@ -0,0 +1,180 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/pixel_translator.h"
+#include "base/codec/pixel_translator_avx2.h"
+#include "base/codec/pixel_translator_neon.h"
+#include "base/codec/pixel_translator_sse2.h"
+
+#include <gtest/gtest.h>
+#include <libyuv/cpu_id.h>
+
+#include <random>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+// Not a multiple of any block size, so the remaining pixels of each row are also translated.
+const int kWidth = 123;
+const int kHeight = 7;
+
+std::vector<uint32_t> generateFrame()
+{
+    std::mt19937 engine(5489u);
+    std::vector<uint32_t> frame(kWidth * kHeight);
+
+    for (auto& pixel : frame)
+        pixel = static_cast<uint32_t>(engine());
+
+    return frame;
+}
+
+uint32_t translateComponent(uint32_t value, uint16_t target_max, uint8_t target_shift)
+{
+    return ((value * target_max + 127) / 255) << target_shift;
+}
+
+uint32_t translatePixel(uint32_t pixel, const PixelFormat& target_format)
+{
+    const PixelFormat source_format = PixelFormat::ARGB();
+
+    return translateComponent((pixel >> source_format.redShift()) & 0xFF,
+                              target_format.redMax(), target_format.redShift()) |
+           translateComponent((pixel >> source_format.greenShift()) & 0xFF,
+                              target_format.greenMax(), target_format.greenShift()) |
+           translateComponent((pixel >> source_format.blueShift()) & 0xFF,
+                              target_format.blueMax(), target_format.blueShift());
+}
+
+template<typename TargetT>
+void checkFrame(const std::vector<uint32_t>& source, const std::vector<TargetT>& target,
+                const PixelFormat& target_format, int width)
+{
+    for (int y = 0; y < kHeight; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            ASSERT_EQ(static_cast<TargetT>(translatePixel(source[y * kWidth + x], target_format)),
+                      target[y * kWidth + x]) << "x: " << x << " y: " << y;
+        }
+    }
+}
+
+template<typename TargetT>
+void testTranslator(const PixelFormat& target_format)
+{
+    std::vector<uint32_t> source = generateFrame();
+    std::vector<TargetT> target(kWidth * kHeight);
+
+    std::unique_ptr<PixelTranslator> translator =
+        PixelTranslator::create(PixelFormat::ARGB(), target_format);
+    ASSERT_TRUE(translator);
+
+    translator->translate(reinterpret_cast<const uint8_t*>(source.data()),
+                          kWidth * sizeof(uint32_t),
+                          reinterpret_cast<uint8_t*>(target.data()),
+                          kWidth * sizeof(TargetT),
+                          kWidth, kHeight);
+
+    checkFrame(source, target, target_format, kWidth);
+}
+
+using VectorTranslateFunc = int (*)(const PixelFormat& source_format,
+                                    const PixelFormat& target_format,
+                                    const uint8_t* src, int src_stride,
+                                    uint8_t* dst, int dst_stride,
+                                    int width, int height);
+
+template<typename TargetT>
+void testVectorFunc(VectorTranslateFunc func, const PixelFormat& target_format, int block_size)
+{
+    std::vector<uint32_t> source = generateFrame();
+    std::vector<TargetT> target(kWidth * kHeight);
+
+    int width = func(PixelFormat::ARGB(), target_format,
+                     reinterpret_cast<const uint8_t*>(source.data()),
+                     kWidth * sizeof(uint32_t),
+                     reinterpret_cast<uint8_t*>(target.data()),
+                     kWidth * sizeof(TargetT),
+                     kWidth, kHeight);
+    ASSERT_EQ(width, kWidth / block_size * block_size);
+
+    checkFrame(source, target, target_format, width);
+}
+
+} // namespace
+
+TEST(PixelTranslatorTest, ToRGB565)
+{
+    testTranslator<uint16_t>(PixelFormat::RGB565());
+}
+
+TEST(PixelTranslatorTest, ToRGB332)
+{
+    testTranslator<uint8_t>(PixelFormat::RGB332());
+}
+
+TEST(PixelTranslatorTest, ToRGB222)
+{
+    testTranslator<uint8_t>(PixelFormat::RGB222());
+}
+
+TEST(PixelTranslatorTest, ToRGB111)
+{
+    testTranslator<uint8_t>(PixelFormat::RGB111());
+}
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+TEST(PixelTranslatorTest, SSE2)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+        return;
+
+    testVectorFunc<uint16_t>(translatePixels_32bppTo16bpp_SSE2, PixelFormat::RGB565(), 8);
+    testVectorFunc<uint8_t>(translatePixels_32bppTo8bpp_SSE2, PixelFormat::RGB332(), 16);
+    testVectorFunc<uint8_t>(translatePixels_32bppTo8bpp_SSE2, PixelFormat::RGB111(), 16);
+}
+
+TEST(PixelTranslatorTest, AVX2)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
+        return;
+
+    testVectorFunc<uint16_t>(translatePixels_32bppTo16bpp_AVX2, PixelFormat::RGB565(), 16);
+    testVectorFunc<uint8_t>(translatePixels_32bppTo8bpp_AVX2, PixelFormat::RGB332(), 32);
+    testVectorFunc<uint8_t>(translatePixels_32bppTo8bpp_AVX2, PixelFormat::RGB111(), 32);
+}
+
+#elif defined(ARCH_CPU_ARM64)
+
+TEST(PixelTranslatorTest, NEON)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasNEON))
+        return;
+
+    testVectorFunc<uint16_t>(translatePixels_32bppTo16bpp_NEON, PixelFormat::RGB565(), 8);
+    testVectorFunc<uint8_t>(translatePixels_32bppTo8bpp_NEON, PixelFormat::RGB332(), 16);
+    testVectorFunc<uint8_t>(translatePixels_32bppTo8bpp_NEON, PixelFormat::RGB111(), 16);
+}
+
+#endif // defined(ARCH_CPU_*)
+
+} // namespace base
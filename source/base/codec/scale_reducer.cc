@@ -25,6 +25,15 @@
 
 namespace base {
 
+namespace {
+
+libyuv::FilterMode filterMode(ScaleReducer::Quality quality)
+{
+    return quality == ScaleReducer::Quality::SPEED ? libyuv::kFilterBilinear : libyuv::kFilterBox;
+}
+
+} // namespace
+
 ScaleReducer::ScaleReducer()
 {
     LOG(LS_INFO) << "Ctor";
@@ -35,6 +44,19 @@ ScaleReducer::~ScaleReducer()
     LOG(LS_INFO) << "Dtor";
 }
 
+void ScaleReducer::setQuality(Quality quality)
+{
+    if (quality_ == quality)
+        return;
+
+    LOG(LS_INFO) << "Scale quality changed: " << static_cast<int>(quality);
+
+    quality_ = quality;
+
+    // The frame is scaled again entirely with the new filter.
+    target_frame_.reset();
+}
+
 const Frame* ScaleReducer::scaleFrame(const Frame* source_frame, const Size& target_size)
 {
     DCHECK(source_frame);
@@ -81,18 +103,27 @@ const Frame* ScaleReducer::scaleFrame(const Frame* source_frame, const Size& tar
                           target_frame_->stride(),
                           target_size.width(),
                           target_size.height(),
-                          libyuv::kFilterBox);
+                          filterMode(quality_));
     }
     else
     {
         Region* updated_region = target_frame_->updatedRegion();
         updated_region->clear();
 
+        // The scaled rectangles are extended by a margin and often overlap (e.g. when the caret
+        // and the text around it are changed). They are merged first so that each target pixel
+        // is scaled once.
         for (Region::Iterator it(source_frame->constUpdatedRegion());
              !it.isAtEnd(); it.advance())
         {
-            Rect target_rect = scaledRect(it.rect());
-            target_rect.intersectWith(target_frame_rect);
+            updated_region->addRect(scaledRect(it.rect()));
+        }
+
+        updated_region->intersectWith(target_frame_rect);
+
+        for (Region::Iterator it(*updated_region); !it.isAtEnd(); it.advance())
+        {
+            const Rect target_rect = it.rect();
 
             libyuv::ARGBScaleClip(source_frame->frameData(),
                                   source_frame->stride(),
@@ -106,9 +137,7 @@ const Frame* ScaleReducer::scaleFrame(const Frame* source_frame, const Size& tar
                                   target_rect.y(),
                                   target_rect.width(),
                                   target_rect.height(),
-                                  libyuv::kFilterBox);
-
-            updated_region->addRect(target_rect);
+                                  filterMode(quality_));
         }
     }
 
@@ -34,6 +34,22 @@ public:
     ScaleReducer();
     ~ScaleReducer();
 
+    enum class Quality
+    {
+        // Bilinear filter. Faster, but fine details (e.g. text) are less readable at large
+        // reduction ratios.
+        SPEED,
+
+        // Box filter. Every source pixel contributes to the result (default).
+        QUALITY
+    };
+
+    // Changing the quality causes rescaling of the entire frame on the next call of scaleFrame.
+    void setQuality(Quality quality);
+    Quality quality() const { return quality_; }
+
+    // Scales only the updated region of |source_frame|. The updated region of the returned frame
+    // contains the scaled areas.
     const Frame* scaleFrame(const Frame* source_frame, const Size& target_size);
 
     double scaleFactorX() const { return scale_x_; }
@@ -42,6 +58,7 @@ public:
 private:
     Rect scaledRect(const Rect& source_rect);
 
+    Quality quality_ = Quality::QUALITY;
     std::unique_ptr<Frame> target_frame_;
     Size source_size_;
     Size target_size_;
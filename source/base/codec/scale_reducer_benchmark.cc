@@ -0,0 +1,68 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/scale_reducer.h"
+#include "base/desktop/benchmark_frame_source.h"
+#include "base/desktop/frame.h"
+
+#include <benchmark/benchmark.h>
+
+namespace base {
+
+namespace {
+
+const Size kFrameSize(1920, 1080);
+const Size kTargetSize(1280, 720);
+
+// range(0) is the scene, range(1) is the quality of the reducer.
+void BM_ScaleReducer(benchmark::State& state)
+{
+    BenchmarkFrameSource::Scene scene = static_cast<BenchmarkFrameSource::Scene>(state.range(0));
+    ScaleReducer::Quality quality = static_cast<ScaleReducer::Quality>(state.range(1));
+
+    BenchmarkFrameSource source(scene, kFrameSize);
+    ScaleReducer reducer;
+    reducer.setQuality(quality);
+
+    // The first frame is scaled completely.
+    reducer.scaleFrame(source.nextFrame(), kTargetSize);
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        const Frame* frame = source.nextFrame();
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(reducer.scaleFrame(frame, kTargetSize));
+    }
+
+    state.SetLabel(std::string(BenchmarkFrameSource::sceneName(scene)) +
+                   (quality == ScaleReducer::Quality::SPEED ? "/speed" : "/quality"));
+}
+
+BENCHMARK(BM_ScaleReducer)
+    ->ArgsProduct({ { static_cast<int>(BenchmarkFrameSource::Scene::OFFICE),
+                      static_cast<int>(BenchmarkFrameSource::Scene::VIDEO),
+                      static_cast<int>(BenchmarkFrameSource::Scene::SCROLLING) },
+                    { static_cast<int>(ScaleReducer::Quality::SPEED),
+                      static_cast<int>(ScaleReducer::Quality::QUALITY) } })
+    ->Unit(benchmark::kMicrosecond);
+
+} // namespace
+
+} // namespace base
@@ -91,6 +91,8 @@
 
 #include "base/logging.h"
 
+#include <libyuv/cpu_id.h>
+
 #include <cmath>
 #include <cstring>
 #include <limits>
@@ -98,7 +100,7 @@
 #if defined(ARCH_CPU_X86_FAMILY)
 #include <xmmintrin.h>
 #define CONVOLVE_FUNC Convolve_SSE
-#elif defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON)
+#elif defined(ARCH_CPU_ARM64) || (defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON))
 #include <arm_neon.h>
 #define CONVOLVE_FUNC Convolve_NEON
 #else
@@ -161,7 +163,8 @@ static int CalculateChunkSize(int block_size_, double io_ratio)
 SincResampler::SincResampler(double io_sample_rate_ratio,
                              int request_frames,
                              const ReadCB& read_cb)
-    : io_sample_rate_ratio_(io_sample_rate_ratio),
+    : convolve_func_(convolveFunc()),
+      io_sample_rate_ratio_(io_sample_rate_ratio),
       read_cb_(read_cb),
       request_frames_(request_frames),
       input_buffer_size_(request_frames_ + kKernelSize),
@@ -310,7 +313,7 @@ void SincResampler::Resample(int frames, float* destination)
 
                 // Figure out how much to weight each kernel's "convolution".
                 const double kernel_interpolation_factor = virtual_offset_idx - offset_idx;
-                *destination++ = CONVOLVE_FUNC(input_ptr, k1, k2, kernel_interpolation_factor);
+                *destination++ = convolve_func_(input_ptr, k1, k2, kernel_interpolation_factor);
 
                 // Advance the virtual index.
                 virtual_source_idx_ += io_sample_rate_ratio_;
@@ -358,6 +361,17 @@ double SincResampler::BufferedFrames() const
     return buffer_primed_ ? request_frames_ - virtual_source_idx_ : 0;
 }
 
+// static
+SincResampler::ConvolveFunc SincResampler::convolveFunc()
+{
+#if defined(ARCH_CPU_X86_FAMILY)
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasAVX2) && libyuv::TestCpuFlag(libyuv::kCpuHasFMA3))
+        return Convolve_AVX2;
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+    return CONVOLVE_FUNC;
+}
+
 float SincResampler::Convolve_C(const float* input_ptr, const float* k1,
                                 const float* k2,
                                 double kernel_interpolation_factor)
@@ -420,7 +434,7 @@ float SincResampler::Convolve_SSE(const float* input_ptr, const float* k1,
 
     return result;
 }
-#elif defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON)
+#elif defined(ARCH_CPU_ARM64) || (defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON))
 float SincResampler::Convolve_NEON(const float* input_ptr, const float* k1,
                                    const float* k2,
                                    double kernel_interpolation_factor)
@@ -99,22 +99,39 @@ private:
     void InitializeKernel();
     void UpdateRegions(bool second_load);
 
+    friend class SincResamplerTest;
+
+    using ConvolveFunc = float (*)(const float* input_ptr, const float* k1,
+                                   const float* k2, double kernel_interpolation_factor);
+
+    // Returns the fastest convolution supported by the processor.
+    static ConvolveFunc convolveFunc();
+
     // Compute convolution of |k1| and |k2| over |input_ptr|, resultant sums are
     // linearly interpolated using |kernel_interpolation_factor|.  On x86, the
-    // underlying implementation is chosen at run time based on SSE support.  On
-    // ARM, NEON support is chosen at compile time based on compilation flags.
+    // underlying implementation is chosen at run time based on AVX2 support.  On
+    // ARM64 NEON is always used, on other ARM processors NEON support is chosen at
+    // compile time based on compilation flags.
     static float Convolve_C(const float* input_ptr, const float* k1,
                             const float* k2, double kernel_interpolation_factor);
 #if defined(ARCH_CPU_X86_FAMILY)
     static float Convolve_SSE(const float* input_ptr, const float* k1,
                               const float* k2,
                               double kernel_interpolation_factor);
-#elif defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON)
+    // Implemented in sinc_resampler_avx2.cc. Must be called only if the processor
+    // supports AVX2 and FMA3.
+    static float Convolve_AVX2(const float* input_ptr, const float* k1,
+                               const float* k2,
+                               double kernel_interpolation_factor);
+#elif defined(ARCH_CPU_ARM64) || (defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON))
     static float Convolve_NEON(const float* input_ptr, const float* k1,
                                const float* k2,
                                double kernel_interpolation_factor);
 #endif
 
+    // Convolution selected for the processor when the resampler is created.
+    const ConvolveFunc convolve_func_;
+
     // The ratio of input / output sample rates.
     double io_sample_rate_ratio_;
 
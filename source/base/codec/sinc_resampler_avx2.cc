@@ -0,0 +1,66 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/sinc_resampler.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif // defined(CC_*)
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+namespace base {
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+float SincResampler::Convolve_AVX2(const float* input_ptr, const float* k1,
+                                   const float* k2,
+                                   double kernel_interpolation_factor)
+{
+    __m256 m_sums1 = _mm256_setzero_ps();
+    __m256 m_sums2 = _mm256_setzero_ps();
+
+    // |input_ptr| has no particular alignment and the kernels are only 16-byte aligned, so all the
+    // loads are unaligned. On processors with AVX2 they cost the same as the aligned ones when the
+    // data does not cross a cache line.
+    for (int i = 0; i < kKernelSize; i += 8)
+    {
+        const __m256 m_input = _mm256_loadu_ps(input_ptr + i);
+        m_sums1 = _mm256_fmadd_ps(m_input, _mm256_loadu_ps(k1 + i), m_sums1);
+        m_sums2 = _mm256_fmadd_ps(m_input, _mm256_loadu_ps(k2 + i), m_sums2);
+    }
+
+    // Linearly interpolate the two "convolutions".
+    m_sums1 = _mm256_mul_ps(
+        m_sums1, _mm256_set1_ps(static_cast<float>(1.0 - kernel_interpolation_factor)));
+    m_sums1 = _mm256_fmadd_ps(
+        m_sums2, _mm256_set1_ps(static_cast<float>(kernel_interpolation_factor)), m_sums1);
+
+    // Sum components together.
+    __m128 m_sum = _mm_add_ps(_mm256_castps256_ps128(m_sums1), _mm256_extractf128_ps(m_sums1, 1));
+    m_sum = _mm_add_ps(_mm_movehl_ps(m_sum, m_sum), m_sum);
+    m_sum = _mm_add_ss(m_sum, _mm_shuffle_ps(m_sum, m_sum, 1));
+
+    return _mm_cvtss_f32(m_sum);
+}
+
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+} // namespace base
@@ -0,0 +1,190 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/audio_bus.h"
+#include "base/codec/multi_channel_resampler.h"
+#include "base/codec/sinc_resampler.h"
+#include "base/codec/vector_math.h"
+#include "base/codec/vector_math_avx2.h"
+#include "base/memory/aligned_memory.h"
+
+#include <gtest/gtest.h>
+#include <libyuv/cpu_id.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+const float kEpsilon = 1e-5f;
+
+// Not a multiple of any vector size, so the remaining values are also processed.
+const int kVectorSize = 123;
+
+std::vector<float> generateSamples(size_t count)
+{
+    std::mt19937 engine(5489u);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+    std::vector<float> samples(count);
+    for (auto& sample : samples)
+        sample = distribution(engine);
+
+    return samples;
+}
+
+bool hasAVX2()
+{
+#if defined(ARCH_CPU_X86_FAMILY)
+    return libyuv::TestCpuFlag(libyuv::kCpuHasAVX2) && libyuv::TestCpuFlag(libyuv::kCpuHasFMA3);
+#else
+    return false;
+#endif // defined(ARCH_CPU_X86_FAMILY)
+}
+
+} // namespace
+
+class SincResamplerTest : public testing::Test
+{
+protected:
+    using ConvolveFunc = SincResampler::ConvolveFunc;
+
+    static const int kKernelSize = SincResampler::kKernelSize;
+
+    static float convolveC(const float* input_ptr, const float* k1, const float* k2,
+                           double kernel_interpolation_factor)
+    {
+        return SincResampler::Convolve_C(input_ptr, k1, k2, kernel_interpolation_factor);
+    }
+
+    static void testConvolve(ConvolveFunc func)
+    {
+        // The kernels have the same 16-byte alignment as in the resampler, the input is checked
+        // at every offset within a vector.
+        std::unique_ptr<float[], AlignedFreeDeleter> kernels(
+            static_cast<float*>(alignedAlloc(sizeof(float) * kKernelSize * 2, 16)));
+        std::vector<float> samples = generateSamples(kKernelSize * 3 + 8);
+
+        std::copy(samples.begin(), samples.begin() + kKernelSize * 2, kernels.get());
+        const float* k1 = kernels.get();
+        const float* k2 = k1 + kKernelSize;
+
+        for (int offset = 0; offset < 8; ++offset)
+        {
+            for (double factor : { 0.0, 0.25, 0.5, 1.0 })
+            {
+                const float* input = samples.data() + kKernelSize * 2 + offset;
+                const float expected = convolveC(input, k1, k2, factor);
+                const float result = func(input, k1, k2, factor);
+
+                EXPECT_NEAR(expected, result, kEpsilon) << "offset: " << offset
+                                                        << " factor: " << factor;
+            }
+        }
+    }
+
+#if defined(ARCH_CPU_X86_FAMILY)
+    static ConvolveFunc convolveAVX2() { return SincResampler::Convolve_AVX2; }
+#endif // defined(ARCH_CPU_X86_FAMILY)
+    static ConvolveFunc convolveDefault() { return SincResampler::convolveFunc(); }
+};
+
+TEST_F(SincResamplerTest, Convolve)
+{
+    testConvolve(convolveDefault());
+}
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+TEST_F(SincResamplerTest, ConvolveAVX2)
+{
+    if (!hasAVX2())
+        return;
+
+    testConvolve(convolveAVX2());
+}
+
+TEST(VectorMathTest, AVX2)
+{
+    if (!hasAVX2())
+        return;
+
+    const float kScale = 0.5f;
+    std::vector<float> src = generateSamples(kVectorSize);
+
+    std::vector<float> expected(kVectorSize);
+    for (int i = 0; i < kVectorSize; ++i)
+        expected[i] = src[i] * kScale;
+
+    std::vector<float> dest(kVectorSize);
+    FMUL_AVX2(src.data(), kScale, kVectorSize, dest.data());
+    for (int i = 0; i < kVectorSize; ++i)
+        EXPECT_FLOAT_EQ(expected[i], dest[i]) << "index: " << i;
+
+    for (int i = 0; i < kVectorSize; ++i)
+        expected[i] += src[i] * kScale;
+
+    FMAC_AVX2(src.data(), kScale, kVectorSize, dest.data());
+    for (int i = 0; i < kVectorSize; ++i)
+        EXPECT_NEAR(expected[i], dest[i], kEpsilon) << "index: " << i;
+}
+
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+// Measures the speed of the resampler as it is used by the audio encoder. Disabled by default,
+// run with --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*.
+TEST(MultiChannelResamplerTest, DISABLED_Benchmark)
+{
+    const int kChannels = 2;
+    const int kInputRate = 44100;
+    const int kOutputRate = 48000;
+    const int kFramesPerPacket = kOutputRate / 100;
+    const int kPackets = 100 * 60;
+
+    std::vector<float> samples = generateSamples(SincResampler::kDefaultRequestSize);
+
+    MultiChannelResampler resampler(
+        kChannels,
+        static_cast<double>(kInputRate) / kOutputRate,
+        SincResampler::kDefaultRequestSize,
+        [&](int /* frame_delay */, AudioBus* audio_bus)
+    {
+        for (int i = 0; i < audio_bus->channels(); ++i)
+            std::copy(samples.begin(), samples.end(), audio_bus->channel(i));
+    });
+
+    std::unique_ptr<AudioBus> output = AudioBus::Create(kChannels, kFramesPerPacket);
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < kPackets; ++i)
+        resampler.Resample(kFramesPerPacket, output.get());
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_time);
+
+    std::cout << "Resampled " << kPackets / 100 << " seconds of audio in "
+              << elapsed.count() << " us (AVX2: " << hasAVX2() << ")" << std::endl;
+}
+
+} // namespace base
@@ -0,0 +1,118 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/codec/tile_cache.h"
+
+#include "base/logging.h"
+
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+const uint64_t kHashSeed = 0x9e3779b97f4a7c15ULL;
+const uint64_t kHashPrime = 0xff51afd7ed558ccdULL;
+
+inline uint64_t mix(uint64_t hash, uint64_t value)
+{
+    hash ^= value;
+    hash *= kHashPrime;
+    return hash ^ (hash >> 32);
+}
+
+} // namespace
+
+TileCache::TileCache(size_t capacity, size_t tile_bytes)
+    : capacity_(capacity),
+      tile_bytes_(tile_bytes)
+{
+    DCHECK_GT(capacity_, 0u);
+
+    index_.reserve(capacity_);
+
+    if (tile_bytes_)
+        data_ = std::make_unique<uint8_t[]>(capacity_ * tile_bytes_);
+}
+
+TileCache::~TileCache() = default;
+
+// static
+uint64_t TileCache::hashTile(const uint8_t* data, int stride)
+{
+    static const size_t kRowSize = kTileSize * sizeof(uint32_t);
+    uint64_t hash = kHashSeed;
+
+    for (int y = 0; y < kTileSize; ++y)
+    {
+        for (size_t offset = 0; offset < kRowSize; offset += sizeof(uint64_t))
+        {
+            uint64_t value;
+            memcpy(&value, data + offset, sizeof(value));
+            hash = mix(hash, value);
+        }
+
+        data += stride;
+    }
+
+    return hash;
+}
+
+int TileCache::find(uint64_t hash)
+{
+    auto it = index_.find(hash);
+    if (it == index_.end())
+        return -1;
+
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->slot;
+}
+
+int TileCache::insert(uint64_t hash)
+{
+    int slot = find(hash);
+    if (slot != -1)
+        return slot;
+
+    if (entries_.size() < capacity_)
+    {
+        slot = static_cast<int>(entries_.size());
+    }
+    else
+    {
+        // The slot of the least recently used tile is reused.
+        const Entry& oldest = entries_.back();
+        slot = oldest.slot;
+        index_.erase(oldest.hash);
+        entries_.pop_back();
+    }
+
+    entries_.push_front({ hash, slot });
+    index_.emplace(hash, entries_.begin());
+    return slot;
+}
+
+uint8_t* TileCache::tileData(int slot)
+{
+    DCHECK(data_);
+    DCHECK_GE(slot, 0);
+    DCHECK_LT(static_cast<size_t>(slot), capacity_);
+
+    return data_.get() + static_cast<size_t>(slot) * tile_bytes_;
+}
+
+} // namespace base
@@ -0,0 +1,84 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE__CODEC__TILE_CACHE_H
+#define BASE__CODEC__TILE_CACHE_H
+
+#include "base/macros_magic.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+namespace base {
+
+// Keeps the recently sent tiles of the screen addressed by the hash of their content. The host
+// and the client keep caches of the same capacity and perform the same operations in the same
+// order, so the host knows which tiles the client has without asking it. The host cache stores
+// only the hashes, the client cache also stores the pixels of the tiles.
+class TileCache
+{
+public:
+    // Size of the tile side in pixels. The tiles are aligned to the blocks of Differ.
+    static const int kTileSize = 32;
+
+    // Default number of the tiles in the cache (16 MB of 32 bit pixels on the client).
+    static const size_t kDefaultCapacity = 4096;
+
+    // |tile_bytes| is the size of the pixel data of the tile, 0 if the cache keeps only hashes.
+    TileCache(size_t capacity, size_t tile_bytes);
+    ~TileCache();
+
+    size_t capacity() const { return capacity_; }
+
+    // Calculates the hash of the tile of 32 bit pixels at |data|.
+    static uint64_t hashTile(const uint8_t* data, int stride);
+
+    // Returns the slot of the tile and marks it as recently used, or -1 if the tile is absent.
+    int find(uint64_t hash);
+
+    // Adds the tile and returns its slot. If the cache is full, the least recently used tile is
+    // evicted. If the tile is already in the cache, it is marked as recently used.
+    int insert(uint64_t hash);
+
+    // Pixels of the tile in |slot|.
+    uint8_t* tileData(int slot);
+
+private:
+    struct Entry
+    {
+        uint64_t hash;
+        int slot;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    const size_t capacity_;
+    const size_t tile_bytes_;
+
+    // The most recently used tiles are at the front.
+    EntryList entries_;
+    std::unordered_map<uint64_t, EntryList::iterator> index_;
+    std::unique_ptr<uint8_t[]> data_;
+
+    DISALLOW_COPY_AND_ASSIGN(TileCache);
+};
+
+} // namespace base
+
+#endif // BASE__CODEC__TILE_CACHE_H
@@ -19,8 +19,11 @@
 #include "base/codec/vector_math.h"
 
 #include "base/logging.h"
+#include "base/codec/vector_math_avx2.h"
 #include "build/build_config.h"
 
+#include <libyuv/cpu_id.h>
+
 #include <algorithm>
 
 // NaCl does not allow intrinsics.
@@ -38,7 +41,7 @@
 #define FMUL_FUNC FMUL_C
 #endif
 #define EWMAAndMaxPower_FUNC EWMAAndMaxPower_SSE
-#elif defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON)
+#elif defined(ARCH_CPU_ARM64) || (defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON))
 #include <arm_neon.h>
 #define FMAC_FUNC FMAC_NEON
 #define FMUL_FUNC FMUL_NEON
@@ -188,7 +191,7 @@ std::pair<float, float> EWMAAndMaxPower_SSE(
 }
 #endif
 
-#if defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON)
+#if defined(ARCH_CPU_ARM64) || (defined(ARCH_CPU_ARM_FAMILY) && defined(USE_NEON))
 void FMAC_NEON(const float src[], float scale, int len, float dest[])
 {
     const int rem = len % 4;
@@ -286,12 +289,47 @@ std::pair<float, float> EWMAAndMaxPower_NEON(
 }
 #endif
 
+namespace {
+
+using ScaleFunc = void (*)(const float src[], float scale, int len, float dest[]);
+
+#if defined(ARCH_CPU_X86_FAMILY)
+// On x86 the AVX2 versions are selected at runtime, otherwise the versions chosen at compile time
+// are used.
+bool hasAVX2()
+{
+    return libyuv::TestCpuFlag(libyuv::kCpuHasAVX2) && libyuv::TestCpuFlag(libyuv::kCpuHasFMA3);
+}
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+ScaleFunc fmacFunc()
+{
+#if defined(ARCH_CPU_X86_FAMILY)
+    if (hasAVX2())
+        return FMAC_AVX2;
+#endif // defined(ARCH_CPU_X86_FAMILY)
+    return FMAC_FUNC;
+}
+
+ScaleFunc fmulFunc()
+{
+#if defined(ARCH_CPU_X86_FAMILY)
+    if (hasAVX2())
+        return FMUL_AVX2;
+#endif // defined(ARCH_CPU_X86_FAMILY)
+    return FMUL_FUNC;
+}
+
+} // namespace
+
 void FMAC(const float src[], float scale, int len, float dest[])
 {
     // Ensure |src| and |dest| are 16-byte aligned.
     DCHECK_EQ(0u, reinterpret_cast<uintptr_t>(src) & (kRequiredAlignment - 1));
     DCHECK_EQ(0u, reinterpret_cast<uintptr_t>(dest) & (kRequiredAlignment - 1));
-    return FMAC_FUNC(src, scale, len, dest);
+
+    static const ScaleFunc func = fmacFunc();
+    return func(src, scale, len, dest);
 }
 
 void FMUL(const float src[], float scale, int len, float dest[])
@@ -299,7 +337,9 @@ void FMUL(const float src[], float scale, int len, float dest[])
     // Ensure |src| and |dest| are 16-byte aligned.
     DCHECK_EQ(0u, reinterpret_cast<uintptr_t>(src) & (kRequiredAlignment - 1));
     DCHECK_EQ(0u, reinterpret_cast<uintptr_t>(dest) & (kRequiredAlignment - 1));
-    return FMUL_FUNC(src, scale, len, dest);
+
+    static const ScaleFunc func = fmulFunc();
+    return func(src, scale, len, dest);
 }
 
 std::pair<float, float> EWMAAndMaxPower(
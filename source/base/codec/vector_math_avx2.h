@@ -0,0 +1,38 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CODEC__VECTOR_MATH_AVX2_H
+#define BASE__CODEC__VECTOR_MATH_AVX2_H
+
+#include "build/build_config.h"
+
+namespace base {
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+// The functions must be called only if the processor supports AVX2 and FMA3. |src| and |dest| may
+// have any alignment, so the 16-byte aligned buffers of the SSE versions are accepted as well.
+
+void FMAC_AVX2(const float src[], float scale, int len, float dest[]);
+void FMUL_AVX2(const float src[], float scale, int len, float dest[]);
+
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+} // namespace base
+
+#endif // BASE__CODEC__VECTOR_MATH_AVX2_H
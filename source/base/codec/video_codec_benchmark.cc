@@ -0,0 +1,229 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_decoder.h"
+#include "base/codec/video_encoder_vpx.h"
+#include "base/codec/video_encoder_zstd.h"
+#include "base/codec/zstd_dictionary.h"
+#include "base/desktop/benchmark_frame_source.h"
+#include "base/desktop/frame_simple.h"
+#include "proto/desktop.pb.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace base {
+
+namespace {
+
+const Size kFrameSize(1920, 1080);
+const int kCompressRatio = 8;
+const size_t kDecodePacketCount = 60;
+
+std::unique_ptr<VideoEncoder> createEncoder(proto::VideoEncoding encoding)
+{
+    switch (encoding)
+    {
+        case proto::VIDEO_ENCODING_ZSTD:
+            return VideoEncoderZstd::create(PixelFormat::RGB565(), kCompressRatio);
+
+        case proto::VIDEO_ENCODING_VP8:
+            return VideoEncoderVPX::createVP8();
+
+        case proto::VIDEO_ENCODING_VP9:
+            return VideoEncoderVPX::createVP9();
+
+        default:
+            return nullptr;
+    }
+}
+
+std::string benchmarkLabel(proto::VideoEncoding encoding, BenchmarkFrameSource::Scene scene)
+{
+    std::string label;
+
+    switch (encoding)
+    {
+        case proto::VIDEO_ENCODING_ZSTD:
+            label = "zstd";
+            break;
+
+        case proto::VIDEO_ENCODING_VP8:
+            label = "vp8";
+            break;
+
+        case proto::VIDEO_ENCODING_VP9:
+            label = "vp9";
+            break;
+
+        default:
+            label = "unknown";
+            break;
+    }
+
+    return label + '/' + BenchmarkFrameSource::sceneName(scene);
+}
+
+// range(0) is the encoding, range(1) is the scene.
+void BM_VideoEncode(benchmark::State& state)
+{
+    proto::VideoEncoding encoding = static_cast<proto::VideoEncoding>(state.range(0));
+    BenchmarkFrameSource::Scene scene = static_cast<BenchmarkFrameSource::Scene>(state.range(1));
+
+    std::unique_ptr<VideoEncoder> encoder = createEncoder(encoding);
+    if (!encoder)
+    {
+        state.SkipWithError("Unable to create encoder");
+        return;
+    }
+
+    BenchmarkFrameSource source(scene, kFrameSize);
+    proto::VideoPacket packet;
+    int64_t encoded_bytes = 0;
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        const Frame* frame = source.nextFrame();
+        packet.Clear();
+        state.ResumeTiming();
+
+        encoder->encode(frame, &packet);
+        encoded_bytes += static_cast<int64_t>(packet.ByteSizeLong());
+    }
+
+    state.SetLabel(benchmarkLabel(encoding, scene));
+    state.counters["packet_bytes"] =
+        benchmark::Counter(static_cast<double>(encoded_bytes), benchmark::Counter::kAvgIterations);
+}
+
+// range(0) is the encoding, range(1) is the scene.
+void BM_VideoDecode(benchmark::State& state)
+{
+    proto::VideoEncoding encoding = static_cast<proto::VideoEncoding>(state.range(0));
+    BenchmarkFrameSource::Scene scene = static_cast<BenchmarkFrameSource::Scene>(state.range(1));
+
+    std::unique_ptr<VideoEncoder> encoder = createEncoder(encoding);
+    std::unique_ptr<FrameSimple> frame = FrameSimple::create(kFrameSize, PixelFormat::ARGB());
+    if (!encoder || !frame)
+    {
+        state.SkipWithError("Unable to create encoder");
+        return;
+    }
+
+    // The packets are decoded in the order in which they were encoded. The first packet contains
+    // the whole frame and the format.
+    BenchmarkFrameSource source(scene, kFrameSize);
+    std::vector<proto::VideoPacket> packets(kDecodePacketCount);
+
+    for (size_t i = 0; i < packets.size(); ++i)
+        encoder->encode(source.nextFrame(), &packets[i]);
+
+    std::unique_ptr<VideoDecoder> decoder;
+    size_t index = 0;
+
+    for (auto _ : state)
+    {
+        if (index == 0)
+        {
+            state.PauseTiming();
+            decoder = VideoDecoder::create(encoding);
+            state.ResumeTiming();
+        }
+
+        if (!decoder || !decoder->decode(packets[index], frame.get()))
+        {
+            state.SkipWithError("Unable to decode packet");
+            break;
+        }
+
+        index = (index + 1) % packets.size();
+    }
+
+    state.SetLabel(benchmarkLabel(encoding, scene));
+}
+
+// Small updates of the lossless codec. range(0) is the dictionary, range(1) enables the
+// cross-frame context, range(2) is the scene.
+void BM_ZstdSmallUpdates(benchmark::State& state)
+{
+    std::unique_ptr<VideoEncoderZstd> encoder =
+        VideoEncoderZstd::create(PixelFormat::RGB565(), kCompressRatio);
+    encoder->setDictionary(static_cast<uint32_t>(state.range(0)));
+    encoder->setCrossFrameContext(state.range(1) != 0);
+
+    BenchmarkFrameSource::Scene scene = static_cast<BenchmarkFrameSource::Scene>(state.range(2));
+    BenchmarkFrameSource source(scene, kFrameSize);
+    proto::VideoPacket packet;
+
+    // The first packet contains the whole frame and is not measured.
+    encoder->encode(source.nextFrame(), &packet);
+
+    int64_t encoded_bytes = 0;
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        const Frame* frame = source.nextFrame();
+        packet.Clear();
+        state.ResumeTiming();
+
+        encoder->encode(frame, &packet);
+        encoded_bytes += static_cast<int64_t>(packet.ByteSizeLong());
+    }
+
+    state.SetLabel(std::string(state.range(0) ? "dictionary" : "no dictionary") +
+                   (state.range(1) ? "/context/" : "/") + BenchmarkFrameSource::sceneName(scene));
+    state.counters["packet_bytes"] =
+        benchmark::Counter(static_cast<double>(encoded_bytes), benchmark::Counter::kAvgIterations);
+}
+
+const std::vector<int64_t> kEncodings =
+{
+    proto::VIDEO_ENCODING_ZSTD,
+    proto::VIDEO_ENCODING_VP8,
+    proto::VIDEO_ENCODING_VP9
+};
+
+const std::vector<int64_t> kScenes =
+{
+    static_cast<int64_t>(BenchmarkFrameSource::Scene::OFFICE),
+    static_cast<int64_t>(BenchmarkFrameSource::Scene::VIDEO),
+    static_cast<int64_t>(BenchmarkFrameSource::Scene::SCROLLING)
+};
+
+BENCHMARK(BM_VideoEncode)
+    ->ArgsProduct({ kEncodings, kScenes })
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK(BM_VideoDecode)
+    ->ArgsProduct({ kEncodings, kScenes })
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK(BM_ZstdSmallUpdates)
+    ->ArgsProduct({ { ZSTD_DICTIONARY_NONE, ZSTD_DICTIONARY_UI }, { 0, 1 },
+                    { static_cast<int64_t>(BenchmarkFrameSource::Scene::OFFICE) } })
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+} // namespace
+
+} // namespace base
@@ -18,9 +18,16 @@
 
 #include "base/codec/video_decoder.h"
 
+#include "build/build_config.h"
+
+#include "base/codec/video_decoder_hybrid.h"
 #include "base/codec/video_decoder_vpx.h"
 #include "base/codec/video_decoder_zstd.h"
 
+#if defined(OS_WIN)
+#include "base/codec/video_decoder_h264.h"
+#endif // defined(OS_WIN)
+
 namespace base {
 
 // static
@@ -37,6 +44,14 @@ std::unique_ptr<VideoDecoder> VideoDecoder::create(proto::VideoEncoding encoding
         case proto::VIDEO_ENCODING_ZSTD:
             return VideoDecoderZstd::create();
 
+        case proto::VIDEO_ENCODING_HYBRID:
+            return VideoDecoderHybrid::create();
+
+#if defined(OS_WIN)
+        case proto::VIDEO_ENCODING_H264:
+            return VideoDecoderH264::create();
+#endif // defined(OS_WIN)
+
         default:
             return nullptr;
     }
@@ -0,0 +1,429 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_decoder_h264.h"
+
+#include "base/logging.h"
+#include "base/trace_event.h"
+#include "base/system_error.h"
+#include "base/desktop/frame.h"
+
+#include <libyuv/convert_argb.h>
+
+#include <mfapi.h>
+#include <mferror.h>
+
+using Microsoft::WRL::ComPtr;
+
+namespace base {
+
+VideoDecoderH264::VideoDecoderH264()
+{
+    LOG(LS_INFO) << "Ctor";
+}
+
+VideoDecoderH264::~VideoDecoderH264()
+{
+    LOG(LS_INFO) << "Dtor";
+
+    output_sample_.Reset();
+    transform_.Reset();
+
+    if (mf_started_)
+        MFShutdown();
+}
+
+// static
+std::unique_ptr<VideoDecoderH264> VideoDecoderH264::create()
+{
+    std::unique_ptr<VideoDecoderH264> decoder(new VideoDecoderH264());
+    if (!decoder->initialize())
+        return nullptr;
+
+    return decoder;
+}
+
+bool VideoDecoderH264::decode(const proto::VideoPacket& packet, Frame* frame)
+{
+    TRACE_EVENT("VideoDecoderH264::decode");
+
+    // The encoder can send the encoded frame with the next packet.
+    if (packet.data().empty())
+        return true;
+
+    if (!sendInput(packet.data()))
+        return false;
+
+    bool is_decoded = false;
+
+    // The packet can contain several frames. Only the last one remains in the desktop frame.
+    while (true)
+    {
+        HRESULT hr = readOutput(packet, frame);
+        if (hr == S_OK)
+        {
+            is_decoded = true;
+        }
+        else if (hr == MF_E_TRANSFORM_NEED_MORE_INPUT)
+        {
+            break;
+        }
+        else if (FAILED(hr))
+        {
+            return false;
+        }
+    }
+
+    if (!is_decoded)
+    {
+        LOG(LS_WARNING) << "No video frame decoded";
+        return false;
+    }
+
+    return true;
+}
+
+bool VideoDecoderH264::initialize()
+{
+    HRESULT hr = MFStartup(MF_VERSION, MFSTARTUP_LITE);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "MFStartup failed: " << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    mf_started_ = true;
+
+    MFT_REGISTER_TYPE_INFO input_info = { MFMediaType_Video, MFVideoFormat_H264 };
+    MFT_REGISTER_TYPE_INFO output_info = { MFMediaType_Video, MFVideoFormat_NV12 };
+
+    IMFActivate** activates = nullptr;
+    UINT32 count = 0;
+
+    hr = MFTEnumEx(MFT_CATEGORY_VIDEO_DECODER,
+                   MFT_ENUM_FLAG_SYNCMFT | MFT_ENUM_FLAG_LOCALMFT | MFT_ENUM_FLAG_SORTANDFILTER,
+                   &input_info,
+                   &output_info,
+                   &activates,
+                   &count);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "MFTEnumEx failed: " << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    for (UINT32 i = 0; i < count; ++i)
+    {
+        if (!transform_)
+            activates[i]->ActivateObject(IID_PPV_ARGS(&transform_));
+
+        activates[i]->Release();
+    }
+
+    CoTaskMemFree(activates);
+
+    if (!transform_)
+    {
+        LOG(LS_WARNING) << "No H.264 decoder";
+        return false;
+    }
+
+    ComPtr<IMFAttributes> attributes;
+    hr = transform_->GetAttributes(&attributes);
+    if (SUCCEEDED(hr))
+    {
+        // Without this the decoder buffers several frames before the output.
+        attributes->SetUINT32(MF_LOW_LATENCY, TRUE);
+    }
+
+    ComPtr<IMFMediaType> input_type;
+    hr = MFCreateMediaType(&input_type);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "MFCreateMediaType failed: "
+                        << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    input_type->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+    input_type->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_H264);
+    input_type->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive);
+
+    hr = transform_->SetInputType(0, input_type.Get(), 0);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFTransform::SetInputType failed: "
+                        << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    if (!setOutputType())
+        return false;
+
+    transform_->ProcessMessage(MFT_MESSAGE_NOTIFY_BEGIN_STREAMING, 0);
+    transform_->ProcessMessage(MFT_MESSAGE_NOTIFY_START_OF_STREAM, 0);
+    return true;
+}
+
+bool VideoDecoderH264::setOutputType()
+{
+    for (DWORD index = 0;; ++index)
+    {
+        ComPtr<IMFMediaType> output_type;
+
+        HRESULT hr = transform_->GetOutputAvailableType(0, index, &output_type);
+        if (FAILED(hr))
+        {
+            LOG(LS_WARNING) << "NV12 output is not supported: "
+                            << SystemError::toString(static_cast<DWORD>(hr));
+            return false;
+        }
+
+        GUID subtype = GUID_NULL;
+        if (FAILED(output_type->GetGUID(MF_MT_SUBTYPE, &subtype)) || subtype != MFVideoFormat_NV12)
+            continue;
+
+        hr = transform_->SetOutputType(0, output_type.Get(), 0);
+        if (FAILED(hr))
+        {
+            LOG(LS_WARNING) << "IMFTransform::SetOutputType failed: "
+                            << SystemError::toString(static_cast<DWORD>(hr));
+            return false;
+        }
+
+        UINT32 width = 0;
+        UINT32 height = 0;
+        MFGetAttributeSize(output_type.Get(), MF_MT_FRAME_SIZE, &width, &height);
+
+        image_size_ = Size(static_cast<int32_t>(width), static_cast<int32_t>(height));
+        image_stride_ = static_cast<int>(
+            MFGetAttributeUINT32(output_type.Get(), MF_MT_DEFAULT_STRIDE, width));
+
+        LOG(LS_INFO) << "Decoded image size: " << image_size_ << " (stride: " << image_stride_
+                     << ")";
+        break;
+    }
+
+    MFT_OUTPUT_STREAM_INFO stream_info;
+    memset(&stream_info, 0, sizeof(stream_info));
+
+    HRESULT hr = transform_->GetOutputStreamInfo(0, &stream_info);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFTransform::GetOutputStreamInfo failed: "
+                        << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    output_sample_.Reset();
+    output_buffer_size_ = stream_info.cbSize;
+
+    if (stream_info.dwFlags & MFT_OUTPUT_STREAM_PROVIDES_SAMPLES)
+        return true;
+
+    ComPtr<IMFMediaBuffer> buffer;
+
+    hr = MFCreateMemoryBuffer(output_buffer_size_, &buffer);
+    if (SUCCEEDED(hr))
+        hr = MFCreateSample(&output_sample_);
+    if (SUCCEEDED(hr))
+        hr = output_sample_->AddBuffer(buffer.Get());
+
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "Unable to create output sample: "
+                        << SystemError::toString(static_cast<DWORD>(hr));
+        output_sample_.Reset();
+        return false;
+    }
+
+    return true;
+}
+
+bool VideoDecoderH264::sendInput(const std::string& data)
+{
+    const DWORD data_size = static_cast<DWORD>(data.size());
+
+    ComPtr<IMFMediaBuffer> buffer;
+    HRESULT hr = MFCreateMemoryBuffer(data_size, &buffer);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "MFCreateMemoryBuffer failed: "
+                      << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    BYTE* buffer_data = nullptr;
+    hr = buffer->Lock(&buffer_data, nullptr, nullptr);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "IMFMediaBuffer::Lock failed: "
+                      << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    memcpy(buffer_data, data.data(), data_size);
+    buffer->Unlock();
+    buffer->SetCurrentLength(data_size);
+
+    ComPtr<IMFSample> sample;
+    hr = MFCreateSample(&sample);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "MFCreateSample failed: " << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    sample->AddBuffer(buffer.Get());
+
+    hr = transform_->ProcessInput(0, sample.Get(), 0);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "IMFTransform::ProcessInput failed: "
+                      << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    return true;
+}
+
+HRESULT VideoDecoderH264::readOutput(const proto::VideoPacket& packet, Frame* frame)
+{
+    MFT_OUTPUT_DATA_BUFFER output;
+    memset(&output, 0, sizeof(output));
+
+    output.dwStreamID = 0;
+    output.pSample = output_sample_.Get();
+
+    DWORD status = 0;
+    HRESULT hr = transform_->ProcessOutput(0, 1, &output, &status);
+
+    if (output.pEvents)
+        output.pEvents->Release();
+
+    ComPtr<IMFSample> sample;
+    if (!output_sample_ && output.pSample)
+        sample.Attach(output.pSample);
+    else
+        sample = output_sample_;
+
+    if (hr == MF_E_TRANSFORM_NEED_MORE_INPUT)
+        return hr;
+
+    if (hr == MF_E_TRANSFORM_STREAM_CHANGE)
+    {
+        // The decoder found the size of the image in the stream and changed the output type.
+        if (!setOutputType())
+            return E_FAIL;
+
+        return S_FALSE;
+    }
+
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "IMFTransform::ProcessOutput failed: "
+                      << SystemError::toString(static_cast<DWORD>(hr));
+        return hr;
+    }
+
+    if (!sample || !convertImage(packet, sample.Get(), frame))
+        return E_FAIL;
+
+    return S_OK;
+}
+
+bool VideoDecoderH264::convertImage(
+    const proto::VideoPacket& packet, IMFSample* sample, Frame* frame)
+{
+    Rect frame_rect = Rect::makeSize(frame->size());
+
+    if (image_size_.width() < frame_rect.width() || image_size_.height() < frame_rect.height())
+    {
+        LOG(LS_WARNING) << "Size of the encoded frame doesn't match size in the header";
+        return false;
+    }
+
+    ComPtr<IMFMediaBuffer> buffer;
+    HRESULT hr = sample->ConvertToContiguousBuffer(&buffer);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "IMFSample::ConvertToContiguousBuffer failed: "
+                      << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    BYTE* y_data = nullptr;
+    int stride = image_stride_;
+
+    // The 2D buffer reports the real stride of the image.
+    ComPtr<IMF2DBuffer> buffer_2d;
+    LONG pitch = 0;
+
+    if (SUCCEEDED(buffer.As(&buffer_2d)) && SUCCEEDED(buffer_2d->Lock2D(&y_data, &pitch)))
+    {
+        stride = static_cast<int>(pitch);
+    }
+    else
+    {
+        buffer_2d.Reset();
+
+        hr = buffer->Lock(&y_data, nullptr, nullptr);
+        if (FAILED(hr))
+        {
+            LOG(LS_ERROR) << "IMFMediaBuffer::Lock failed: "
+                          << SystemError::toString(static_cast<DWORD>(hr));
+            return false;
+        }
+    }
+
+    const uint8_t* uv_data = y_data + stride * image_size_.height();
+    bool result = true;
+
+    for (int i = 0; i < packet.dirty_rect_size(); ++i)
+    {
+        const proto::Rect& dirty_rect = packet.dirty_rect(i);
+        Rect rect = Rect::makeXYWH(
+            dirty_rect.x(), dirty_rect.y(), dirty_rect.width(), dirty_rect.height());
+
+        if (!frame_rect.containsRect(rect))
+        {
+            LOG(LS_WARNING) << "The rectangle is outside the screen area";
+            result = false;
+            break;
+        }
+
+        const int y_offset = stride * rect.y() + rect.x();
+        const int uv_offset = stride * (rect.y() / 2) + (rect.x() & ~1);
+
+        libyuv::NV12ToARGB(y_data + y_offset, stride,
+                           uv_data + uv_offset, stride,
+                           frame->frameDataAtPos(rect.topLeft()),
+                           frame->stride(),
+                           rect.width(),
+                           rect.height());
+    }
+
+    if (buffer_2d)
+        buffer_2d->Unlock2D();
+    else
+        buffer->Unlock();
+
+    return result;
+}
+
+} // namespace base
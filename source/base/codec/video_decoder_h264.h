@@ -0,0 +1,71 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CODEC__VIDEO_DECODER_H264_H
+#define BASE__CODEC__VIDEO_DECODER_H264_H
+
+#include "base/macros_magic.h"
+#include "base/codec/video_decoder.h"
+#include "base/desktop/geometry.h"
+
+#include <mfidl.h>
+#include <mftransform.h>
+#include <wrl/client.h>
+
+namespace base {
+
+// H.264 decoder which uses the Media Foundation decoder of the system.
+class VideoDecoderH264 : public VideoDecoder
+{
+public:
+    ~VideoDecoderH264() override;
+
+    // Returns nullptr if the decoder is not available.
+    static std::unique_ptr<VideoDecoderH264> create();
+
+    bool decode(const proto::VideoPacket& packet, Frame* frame) override;
+
+private:
+    VideoDecoderH264();
+
+    bool initialize();
+    bool setOutputType();
+    bool sendInput(const std::string& data);
+
+    // Returns S_OK if the frame was decoded, S_FALSE if the output type was changed,
+    // MF_E_TRANSFORM_NEED_MORE_INPUT if there are no more decoded frames or an error code.
+    HRESULT readOutput(const proto::VideoPacket& packet, Frame* frame);
+    bool convertImage(const proto::VideoPacket& packet, IMFSample* sample, Frame* frame);
+
+    bool mf_started_ = false;
+
+    Microsoft::WRL::ComPtr<IMFTransform> transform_;
+    Microsoft::WRL::ComPtr<IMFSample> output_sample_;
+    DWORD output_buffer_size_ = 0;
+
+    // Size and stride of the decoded NV12 image. The image may be larger than the frame because
+    // the decoder aligns it to the macroblock size.
+    Size image_size_;
+    int image_stride_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoDecoderH264);
+};
+
+} // namespace base
+
+#endif // BASE__CODEC__VIDEO_DECODER_H264_H
@@ -0,0 +1,71 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/codec/video_decoder_hybrid.h"
+
+#include "base/logging.h"
+#include "base/trace_event.h"
+#include "base/codec/video_decoder_vpx.h"
+#include "base/codec/video_decoder_zstd.h"
+
+namespace base {
+
+VideoDecoderHybrid::VideoDecoderHybrid(std::unique_ptr<VideoDecoderVPX> lossy_decoder,
+                                       std::unique_ptr<VideoDecoderZstd> lossless_decoder)
+    : lossy_decoder_(std::move(lossy_decoder)),
+      lossless_decoder_(std::move(lossless_decoder))
+{
+    DCHECK(lossy_decoder_);
+    DCHECK(lossless_decoder_);
+}
+
+VideoDecoderHybrid::~VideoDecoderHybrid() = default;
+
+// static
+std::unique_ptr<VideoDecoderHybrid> VideoDecoderHybrid::create()
+{
+    std::unique_ptr<VideoDecoderVPX> lossy_decoder = VideoDecoderVPX::createVP9();
+    std::unique_ptr<VideoDecoderZstd> lossless_decoder = VideoDecoderZstd::create();
+
+    if (!lossy_decoder || !lossless_decoder)
+        return nullptr;
+
+    return std::unique_ptr<VideoDecoderHybrid>(
+        new VideoDecoderHybrid(std::move(lossy_decoder), std::move(lossless_decoder)));
+}
+
+bool VideoDecoderHybrid::decode(const proto::VideoPacket& packet, Frame* frame)
+{
+    TRACE_EVENT("VideoDecoderHybrid::decode");
+
+    // The VP9 part is absent when there are no motion areas in the frame.
+    if (!packet.data().empty() && !lossy_decoder_->decode(packet, frame))
+    {
+        LOG(LS_WARNING) << "Unable to decode the lossy part of the packet";
+        return false;
+    }
+
+    if (packet.has_lossless_packet() && !lossless_decoder_->decode(packet.lossless_packet(), frame))
+    {
+        LOG(LS_WARNING) << "Unable to decode the lossless part of the packet";
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace base
@@ -19,8 +19,19 @@
 #include "base/codec/video_decoder_zstd.h"
 
 #include "base/logging.h"
+#include "base/trace_event.h"
+#include "base/codec/delta_filter.h"
+#include "base/codec/palette.h"
 #include "base/codec/pixel_translator.h"
+#include "base/codec/tile_cache.h"
+#include "base/codec/zstd_dictionary.h"
 #include "base/desktop/frame_aligned.h"
+#include "base/threading/worker_group.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
 
 namespace base {
 
@@ -43,14 +54,57 @@ Rect parseRect(const proto::Rect& rect)
     return Rect::makeXYWH(rect.x(), rect.y(), rect.width(), rect.height());
 }
 
-} // namespace
+// The host can not make the client allocate larger stream windows than this.
+const int kMinWindowLog = 10;
+const int kMaxWindowLog = 27;
+
+// Number of the threads for the packets that are divided into parts.
+const int kMaxThreadCount = 4;
+
+// The host can not make the client create more streams than this.
+const int64_t kMaxStreamCount = 64;
 
-VideoDecoderZstd::VideoDecoderZstd()
-    : stream_(ZSTD_createDStream())
+// The host can not make the client allocate more memory than this.
+const size_t kMaxTileCacheSize = TileCache::kDefaultCapacity * 4;
+
+const size_t kTileBytes =
+    static_cast<size_t>(TileCache::kTileSize * TileCache::kTileSize) * sizeof(uint32_t);
+
+// Decompresses exactly |size| bytes from the stream.
+bool decompress(ZSTD_DStream* stream, ZSTD_inBuffer* input, uint8_t* data, size_t size)
 {
-    // Nothing
+    ZSTD_outBuffer output = { data, size, 0 };
+
+    while (output.pos < output.size)
+    {
+        const size_t output_pos = output.pos;
+
+        const size_t ret = ZSTD_decompressStream(stream, &output, input);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_WARNING) << "ZSTD_decompressStream failed: " << ZSTD_getErrorName(ret);
+            return false;
+        }
+
+        if (output.pos == output_pos && input->pos == input->size)
+        {
+            LOG(LS_WARNING) << "Not enough data for the rectangles";
+            return false;
+        }
+    }
+
+    return true;
 }
 
+Rect tileRect(const proto::VideoTile& tile)
+{
+    return Rect::makeXYWH(tile.x(), tile.y(), TileCache::kTileSize, TileCache::kTileSize);
+}
+
+} // namespace
+
+VideoDecoderZstd::VideoDecoderZstd() = default;
+
 VideoDecoderZstd::~VideoDecoderZstd() = default;
 
 // static
@@ -61,32 +115,160 @@ std::unique_ptr<VideoDecoderZstd> VideoDecoderZstd::create()
 
 bool VideoDecoderZstd::decode(const proto::VideoPacket& packet, Frame* target_frame)
 {
+    TRACE_EVENT("VideoDecoderZstd::decode");
+
     if (packet.has_format())
     {
         const proto::VideoPacketFormat& format = packet.format();
+        const PixelFormat source_format = parsePixelFormat(format.pixel_format());
 
-        source_frame_ = FrameAligned::create(
-            Size(format.video_rect().width(), format.video_rect().height()),
-            parsePixelFormat(format.pixel_format()), 32);
+        frame_size_ = Size(format.video_rect().width(), format.video_rect().height());
 
-        translator_ = PixelTranslator::create(source_frame_->format(), PixelFormat::ARGB());
-    }
+        // If the pixel format is the same as in the target frame, the data is decompressed
+        // directly into the target frame without an intermediate copy.
+        direct_decode_ = source_format == PixelFormat::ARGB();
+
+        if (direct_decode_)
+        {
+            source_frame_.reset();
+            translator_.reset();
+            reverse_translator_.reset();
+        }
+        else
+        {
+            source_frame_ = FrameAligned::create(frame_size_, source_format, 32);
+            translator_ = PixelTranslator::create(source_format, PixelFormat::ARGB());
+            reverse_translator_ = PixelTranslator::create(PixelFormat::ARGB(), source_format);
+        }
+
+        const size_t tile_cache_size = format.tile_cache_size();
+        if (tile_cache_size > 0 && tile_cache_size <= kMaxTileCacheSize)
+        {
+            tile_cache_ = std::make_unique<TileCache>(tile_cache_size, kTileBytes);
+        }
+        else
+        {
+            if (tile_cache_size > 0)
+                LOG(LS_WARNING) << "Invalid tile cache size: " << tile_cache_size;
+
+            tile_cache_.reset();
+        }
 
-    DCHECK(source_frame_->size() == target_frame->size());
+        const int window_log = static_cast<int>(format.zstd_window_log());
+        if (window_log && (window_log < kMinWindowLog || window_log > kMaxWindowLog))
+        {
+            LOG(LS_WARNING) << "Invalid window size: " << window_log;
+            frame_size_ = Size();
+            return false;
+        }
+
+        // The streams start again with the packet with the format.
+        streams_.clear();
+        dictionary_.clear();
+
+        if (format.zstd_dictionary() != ZSTD_DICTIONARY_NONE)
+        {
+            dictionary_ = createZstdDictionary(format.zstd_dictionary(), source_format);
+            if (dictionary_.empty())
+            {
+                LOG(LS_WARNING) << "Unknown dictionary: " << format.zstd_dictionary();
+                frame_size_ = Size();
+                return false;
+            }
+        }
+
+        window_log_ = window_log;
+    }
 
-    if (!source_frame_ || !translator_)
+    if (frame_size_.isEmpty() ||
+        (!direct_decode_ && (!source_frame_ || !translator_ || !reverse_translator_)))
     {
         LOG(LS_WARNING) << "A packet with image information was not received";
         return false;
     }
 
-    size_t ret = ZSTD_initDStream(stream_.get());
-    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    if (packet.dirty_rect_delta_size() != 0 &&
+        (packet.has_format() || packet.dirty_rect_delta_size() != packet.dirty_rect_size()))
+    {
+        LOG(LS_WARNING) << "Invalid number of the delta flags";
+        return false;
+    }
+
+    if (packet.dirty_rect_palette_size() != 0 &&
+        packet.dirty_rect_palette_size() != packet.dirty_rect_size())
+    {
+        LOG(LS_WARNING) << "Invalid number of the palette sizes";
+        return false;
+    }
+
+    DCHECK(frame_size_ == target_frame->size());
+    DCHECK(target_frame->format() == PixelFormat::ARGB());
+
+    Rect frame_rect = Rect::makeSize(frame_size_);
+
+    // The moved areas are copied before the changes are applied over them.
+    for (int i = 0; i < packet.copy_rect_size(); ++i)
+    {
+        const proto::CopyRect& copy_rect = packet.copy_rect(i);
+        Rect dest_rect = parseRect(copy_rect.dest_rect());
+        Rect source_rect = Rect::makeXYWH(copy_rect.source_x(), copy_rect.source_y(),
+                                          dest_rect.width(), dest_rect.height());
+
+        if (dest_rect.isEmpty() || !frame_rect.containsRect(dest_rect) ||
+            !frame_rect.containsRect(source_rect))
+        {
+            LOG(LS_WARNING) << "The copy rectangle is outside the screen area";
+            return false;
+        }
+
+        target_frame->copyRect(source_rect.topLeft(), dest_rect);
+    }
+
+    if (!readCachedTiles(packet, target_frame))
+        return false;
+
+    if (packet.part_data_size() == 0)
+    {
+        if (!decodeRects(stream(0), packet, packet.data(), 0, packet.dirty_rect_size(),
+                         target_frame))
+        {
+            return false;
+        }
+    }
+    else if (!decodeParts(packet, target_frame))
+    {
+        return false;
+    }
 
-    Rect frame_rect = Rect::makeSize(source_frame_->size());
-    ZSTD_inBuffer input = { packet.data().data(), packet.data().size(), 0 };
+    return storeNewTiles(packet, target_frame);
+}
 
-    for (int i = 0; i < packet.dirty_rect_size(); ++i)
+bool VideoDecoderZstd::decodeRects(ZSTD_DStream* stream,
+                                   const proto::VideoPacket& packet,
+                                   const std::string& data,
+                                   int first_rect,
+                                   int rect_count,
+                                   Frame* target_frame)
+{
+    if (!window_log_)
+    {
+        // Unlike ZSTD_initDStream the reset of the session keeps the dictionary.
+        const size_t ret = ZSTD_DCtx_reset(stream, ZSTD_reset_session_only);
+        DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    }
+    else if (!rect_count)
+    {
+        // The encoder does not write to the stream for a part without rectangles.
+        return true;
+    }
+
+    const Rect frame_rect = Rect::makeSize(frame_size_);
+    Frame* decode_frame = direct_decode_ ? target_frame : source_frame_.get();
+
+    ZSTD_inBuffer input = { data.data(), data.size(), 0 };
+    std::vector<uint8_t> rect_buffer;
+
+    for (int i = first_rect; i < first_rect + rect_count; ++i)
     {
         Rect rect = parseRect(packet.dirty_rect(i));
 
@@ -96,32 +278,81 @@ bool VideoDecoderZstd::decode(const proto::VideoPacket& packet, Frame* target_fr
             return false;
         }
 
-        uint8_t* output_data = source_frame_->frameDataAtPos(rect.x(), rect.y());
-        const size_t output_size =
-            static_cast<size_t>(rect.width() * source_frame_->format().bytesPerPixel());
+        const bool delta = packet.dirty_rect_delta_size() != 0 && packet.dirty_rect_delta(i);
+        const uint32_t palette_size =
+            packet.dirty_rect_palette_size() != 0 ? packet.dirty_rect_palette(i) : 0;
+
+        if (palette_size > kMaxPaletteSize || (delta && palette_size))
+        {
+            LOG(LS_WARNING) << "Invalid encoding of the rectangle";
+            return false;
+        }
+
+        const int bytes_per_pixel = decode_frame->format().bytesPerPixel();
+        const size_t row_size = static_cast<size_t>(rect.width() * bytes_per_pixel);
+
+        if (delta || palette_size)
+        {
+            // The rectangle is unpacked separately, the image still contains the previous pixels.
+            const size_t size = palette_size ?
+                paletteDataSize(rect.width(), rect.height(), bytes_per_pixel, palette_size) :
+                row_size * static_cast<size_t>(rect.height());
+
+            rect_buffer.resize(size);
+
+            if (!decompress(stream, &input, rect_buffer.data(), size))
+                return false;
+        }
+        else
+        {
+            uint8_t* row = decode_frame->frameDataAtPos(rect.topLeft());
+
+            for (int y = 0; y < rect.height(); ++y)
+            {
+                if (!decompress(stream, &input, row, row_size))
+                    return false;
 
-        ZSTD_outBuffer output = { output_data, output_size, 0 };
-        int row_y = 0;
+                row += decode_frame->stride();
+            }
+        }
 
-        while (row_y < rect.height())
+        if (palette_size)
         {
-            ret = ZSTD_decompressStream(stream_.get(), &output, &input);
-            if (ZSTD_isError(ret))
+            if (!decodePalette(rect_buffer.data(), rect.width(), rect.height(), bytes_per_pixel,
+                               palette_size, decode_frame->frameDataAtPos(rect.topLeft()),
+                               decode_frame->stride()))
             {
-                LOG(LS_WARNING) << "ZSTD_decompressStream failed: " << ZSTD_getErrorName(ret);
+                LOG(LS_WARNING) << "Invalid palette index";
                 return false;
             }
+        }
 
-            // If we completely unpacked the row in the rectangle.
-            if (output.pos == output.size)
+        if (delta)
+        {
+            // The source frame may be out of date after the copied areas and cached tiles, so
+            // the previous pixels are taken from the target frame.
+            if (!direct_decode_)
             {
-                ++row_y;
-                output_data += source_frame_->stride();
-                output.dst = output_data;
-                output.pos = 0;
+                reverse_translator_->translate(target_frame->frameDataAtPos(rect.topLeft()),
+                                               target_frame->stride(),
+                                               source_frame_->frameDataAtPos(rect.topLeft()),
+                                               source_frame_->stride(),
+                                               rect.width(),
+                                               rect.height());
+            }
+
+            uint8_t* row = decode_frame->frameDataAtPos(rect.topLeft());
+
+            for (int y = 0; y < rect.height(); ++y)
+            {
+                xorDelta(row, rect_buffer.data() + static_cast<size_t>(y) * row_size, row_size);
+                row += decode_frame->stride();
             }
         }
 
+        if (direct_decode_)
+            continue;
+
         translator_->translate(source_frame_->frameDataAtPos(rect.topLeft()),
                                source_frame_->stride(),
                                target_frame->frameDataAtPos(rect.topLeft()),
@@ -130,6 +361,174 @@ bool VideoDecoderZstd::decode(const proto::VideoPacket& packet, Frame* target_fr
                                rect.height());
     }
 
+    // The next packet continues the stream from the end of this one.
+    if (window_log_ && input.pos != input.size)
+    {
+        LOG(LS_WARNING) << "Extra data after the rectangles";
+        return false;
+    }
+
+    return true;
+}
+
+bool VideoDecoderZstd::decodeParts(const proto::VideoPacket& packet, Frame* target_frame)
+{
+    const int part_count = packet.part_data_size();
+
+    if (packet.part_rect_count_size() != part_count)
+    {
+        LOG(LS_WARNING) << "Invalid number of the parts";
+        return false;
+    }
+
+    std::vector<int> first_rects(static_cast<size_t>(part_count));
+    int64_t rect_count = 0;
+
+    for (int i = 0; i < part_count; ++i)
+    {
+        first_rects[static_cast<size_t>(i)] = static_cast<int>(rect_count);
+        rect_count += packet.part_rect_count(i);
+    }
+
+    if (rect_count != packet.dirty_rect_size())
+    {
+        LOG(LS_WARNING) << "Invalid number of the rectangles in the parts";
+        return false;
+    }
+
+    // The slices of a frame continue the streams of the previous slices.
+    const size_t first_stream = packet.first_part();
+
+    if (static_cast<int64_t>(first_stream) + part_count > kMaxStreamCount)
+    {
+        LOG(LS_WARNING) << "Invalid index of the first part: " << first_stream;
+        return false;
+    }
+
+    // The streams are created before the parallel decoding.
+    stream(first_stream + static_cast<size_t>(part_count - 1));
+
+    if (!workers_)
+    {
+        const int thread_count = static_cast<int>(std::clamp(
+            std::thread::hardware_concurrency(), 1u, static_cast<unsigned int>(kMaxThreadCount)));
+        workers_ = std::make_unique<WorkerGroup>(thread_count);
+    }
+
+    // The parts contain different rectangles, so they are decoded into the frame in parallel.
+    std::atomic<bool> result = true;
+
+    workers_->run(part_count, [&](int index)
+    {
+        if (!decodeRects(streams_[first_stream + static_cast<size_t>(index)].get(),
+                         packet,
+                         packet.part_data(index),
+                         first_rects[static_cast<size_t>(index)],
+                         static_cast<int>(packet.part_rect_count(index)),
+                         target_frame))
+        {
+            result = false;
+        }
+    });
+
+    return result;
+}
+
+ZSTD_DStream* VideoDecoderZstd::stream(size_t index)
+{
+    while (streams_.size() <= index)
+    {
+        ScopedZstdDStream stream(ZSTD_createDStream());
+
+        if (window_log_)
+            ZSTD_DCtx_setParameter(stream.get(), ZSTD_d_windowLogMax, window_log_);
+
+        if (!dictionary_.empty())
+        {
+            ZSTD_DCtx_loadDictionary(stream.get(), dictionary_.data(), dictionary_.size());
+        }
+
+        streams_.emplace_back(std::move(stream));
+    }
+
+    return streams_[index].get();
+}
+
+bool VideoDecoderZstd::readCachedTiles(const proto::VideoPacket& packet, Frame* target_frame)
+{
+    if (packet.cached_tile_size() == 0)
+        return true;
+
+    if (!tile_cache_)
+    {
+        LOG(LS_WARNING) << "A packet with cached tiles without the tile cache";
+        return false;
+    }
+
+    const Rect frame_rect = Rect::makeSize(target_frame->size());
+
+    for (int i = 0; i < packet.cached_tile_size(); ++i)
+    {
+        const proto::VideoTile& tile = packet.cached_tile(i);
+        const Rect rect = tileRect(tile);
+
+        if (!frame_rect.containsRect(rect))
+        {
+            LOG(LS_WARNING) << "The tile is outside the screen area";
+            return false;
+        }
+
+        const int slot = tile_cache_->find(tile.hash());
+        if (slot == -1)
+        {
+            LOG(LS_WARNING) << "The tile is not in the cache";
+            return false;
+        }
+
+        target_frame->copyPixelsFrom(tile_cache_->tileData(slot),
+                                     static_cast<int>(TileCache::kTileSize * sizeof(uint32_t)),
+                                     rect);
+    }
+
+    return true;
+}
+
+bool VideoDecoderZstd::storeNewTiles(const proto::VideoPacket& packet, const Frame* target_frame)
+{
+    if (packet.new_tile_size() == 0)
+        return true;
+
+    if (!tile_cache_)
+    {
+        LOG(LS_WARNING) << "A packet with new tiles without the tile cache";
+        return false;
+    }
+
+    const Rect frame_rect = Rect::makeSize(target_frame->size());
+    const size_t row_size = TileCache::kTileSize * sizeof(uint32_t);
+
+    for (int i = 0; i < packet.new_tile_size(); ++i)
+    {
+        const proto::VideoTile& tile = packet.new_tile(i);
+        const Rect rect = tileRect(tile);
+
+        if (!frame_rect.containsRect(rect))
+        {
+            LOG(LS_WARNING) << "The tile is outside the screen area";
+            return false;
+        }
+
+        const uint8_t* source = target_frame->frameDataAtPos(rect.topLeft());
+        uint8_t* dest = tile_cache_->tileData(tile_cache_->insert(tile.hash()));
+
+        for (int y = 0; y < TileCache::kTileSize; ++y)
+        {
+            memcpy(dest, source, row_size);
+            source += target_frame->stride();
+            dest += row_size;
+        }
+    }
+
     return true;
 }
 
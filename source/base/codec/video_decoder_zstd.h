@@ -22,10 +22,16 @@
 #include "base/macros_magic.h"
 #include "base/codec/scoped_zstd_stream.h"
 #include "base/codec/video_decoder.h"
+#include "base/desktop/geometry.h"
+
+#include <string>
+#include <vector>
 
 namespace base {
 
 class PixelTranslator;
+class TileCache;
+class WorkerGroup;
 
 class VideoDecoderZstd : public VideoDecoder
 {
@@ -39,9 +45,32 @@ public:
 private:
     VideoDecoderZstd();
 
-    ScopedZstdDStream stream_;
+    bool decodeRects(ZSTD_DStream* stream,
+                     const proto::VideoPacket& packet,
+                     const std::string& data,
+                     int first_rect,
+                     int rect_count,
+                     Frame* target_frame);
+    bool decodeParts(const proto::VideoPacket& packet, Frame* target_frame);
+    ZSTD_DStream* stream(size_t index);
+    bool readCachedTiles(const proto::VideoPacket& packet, Frame* target_frame);
+    bool storeNewTiles(const proto::VideoPacket& packet, const Frame* target_frame);
+
     std::unique_ptr<PixelTranslator> translator_;
+    std::unique_ptr<PixelTranslator> reverse_translator_;
     std::unique_ptr<Frame> source_frame_;
+    Size frame_size_;
+    bool direct_decode_ = false;
+    std::unique_ptr<TileCache> tile_cache_;
+
+    // The stream with index N decodes the part N. The packets without parts use the first stream.
+    std::vector<ScopedZstdDStream> streams_;
+
+    // Non-zero if the streams keep their context between the packets (see proto::VideoPacketFormat).
+    int window_log_ = 0;
+    std::string dictionary_;
+
+    std::unique_ptr<WorkerGroup> workers_;
 
     DISALLOW_COPY_AND_ASSIGN(VideoDecoderZstd);
 };
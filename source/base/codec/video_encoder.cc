@@ -28,6 +28,11 @@ VideoEncoder::VideoEncoder(proto::VideoEncoding encoding)
     // Nothing
 }
 
+void VideoEncoder::requestKeyFrame()
+{
+    last_size_ = Size();
+}
+
 void VideoEncoder::fillPacketInfo(const Frame* frame, proto::VideoPacket* packet)
 {
     packet->set_encoding(encoding_);
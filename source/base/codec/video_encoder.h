@@ -20,6 +20,7 @@
 #define BASE__CODEC__VIDEO_ENCODER_H
 
 #include "base/desktop/geometry.h"
+#include "base/desktop/region.h"
 #include "proto/desktop.pb.h"
 
 namespace base {
@@ -34,6 +35,37 @@ public:
 
     virtual void encode(const Frame* frame, proto::VideoPacket* packet) = 0;
 
+    // Sets the target bitrate in kilobits per second. Encoders without rate control ignore it.
+    virtual void setTargetBitrate(uint32_t /* bitrate */) {}
+
+    // Returns the area of the screen that was sent with a reduced quality and should be encoded
+    // again when the screen stops changing. Encoders without such a mode return an empty region.
+    virtual Region lossyRegion() const { return Region(); }
+
+    // The next frame repeats the lossy region of the screen to encode it with the full quality.
+    virtual void setRefreshPending() {}
+
+    // Sets the point in the coordinates of the encoded frame where the user works (the cursor).
+    // Encoders with a region of interest map give more quality around it.
+    virtual void setFocusPoint(const Point& /* point */) {}
+
+    // Makes the encoder spend less processor time on the frames at the cost of the quality or the
+    // size, for example when the computer runs on battery.
+    virtual void setEnergySaving(bool /* enable */) {}
+
+    // The next packet carries the format and can be decoded without the previous packets. It is
+    // used for a client that has missed some packets of the stream.
+    virtual void requestKeyFrame();
+
+    // Returns the identifier of the frame that the encoder keeps as the reference frame (see
+    // proto::VideoPacket). Zero if the encoder does not use the reference frames.
+    virtual uint32_t referenceFrameId() const { return 0; }
+
+    // The next packet depends only on the reference frame. It is cheaper than a key frame for a
+    // client that has the reference frame. Returns false if the encoder does not use the reference
+    // frames, a key frame is needed then.
+    virtual bool requestRecoveryFrame() { return false; }
+
     proto::VideoEncoding encoding() const { return encoding_; }
 
 protected:
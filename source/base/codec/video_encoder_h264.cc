@@ -0,0 +1,660 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/video_encoder_h264.h"
+
+#include "base/logging.h"
+#include "base/trace_event.h"
+#include "base/system_error.h"
+#include "base/desktop/frame.h"
+#include "base/desktop/region.h"
+
+#include <libyuv/convert_from_argb.h>
+
+#include <codecapi.h>
+#include <mfapi.h>
+#include <mferror.h>
+
+#include <algorithm>
+#include <vector>
+
+using Microsoft::WRL::ComPtr;
+
+namespace base {
+
+namespace {
+
+const UINT32 kFrameRate = 30;
+
+// Media Foundation uses 100 nanosecond units for the time.
+const int64_t kTimeUnitsPerSecond = 10000000;
+const int64_t kSampleDuration = kTimeUnitsPerSecond / kFrameRate;
+
+// The target bitrate depends on the frame size. 2 bits per pixel per second give about 4 Mbps for
+// 1920x1080.
+const UINT32 kBitsPerPixel = 2;
+const UINT32 kMinBitrate = 1000 * 1000;
+const UINT32 kMaxBitrate = 20 * 1000 * 1000;
+
+// Since the transport layer is reliable, keyframes should not be necessary.
+const UINT32 kGopSize = 10000;
+
+std::vector<ComPtr<IMFActivate>> enumHardwareEncoders()
+{
+    MFT_REGISTER_TYPE_INFO input_type = { MFMediaType_Video, MFVideoFormat_NV12 };
+    MFT_REGISTER_TYPE_INFO output_type = { MFMediaType_Video, MFVideoFormat_H264 };
+
+    IMFActivate** activates = nullptr;
+    UINT32 count = 0;
+
+    std::vector<ComPtr<IMFActivate>> result;
+
+    HRESULT hr = MFTEnumEx(MFT_CATEGORY_VIDEO_ENCODER,
+                           MFT_ENUM_FLAG_HARDWARE | MFT_ENUM_FLAG_SORTANDFILTER,
+                           &input_type,
+                           &output_type,
+                           &activates,
+                           &count);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "MFTEnumEx failed: " << SystemError::toString(static_cast<DWORD>(hr));
+        return result;
+    }
+
+    for (UINT32 i = 0; i < count; ++i)
+    {
+        result.emplace_back(activates[i]);
+        activates[i]->Release();
+    }
+
+    CoTaskMemFree(activates);
+    return result;
+}
+
+void setCodecValue(ICodecAPI* codec_api, const GUID& api, VARIANT* value, const char* name)
+{
+    HRESULT hr = codec_api->SetValue(&api, value);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "ICodecAPI::SetValue(" << name << ") failed: "
+                        << SystemError::toString(static_cast<DWORD>(hr));
+    }
+}
+
+int roundToTwosMultiple(int x)
+{
+    return x & (~1);
+}
+
+Rect alignRect(const Rect& rect)
+{
+    int x = roundToTwosMultiple(rect.left());
+    int y = roundToTwosMultiple(rect.top());
+    int right = roundToTwosMultiple(rect.right() + 1);
+    int bottom = roundToTwosMultiple(rect.bottom() + 1);
+
+    return Rect::makeLTRB(x, y, right, bottom);
+}
+
+} // namespace
+
+VideoEncoderH264::VideoEncoderH264()
+    : VideoEncoder(proto::VIDEO_ENCODING_H264)
+{
+    HRESULT hr = MFStartup(MF_VERSION, MFSTARTUP_LITE);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "MFStartup failed: " << SystemError::toString(static_cast<DWORD>(hr));
+        return;
+    }
+
+    mf_started_ = true;
+}
+
+VideoEncoderH264::~VideoEncoderH264()
+{
+    destroyTransform();
+
+    if (mf_started_)
+        MFShutdown();
+}
+
+// static
+bool VideoEncoderH264::isSupported()
+{
+    return !enumHardwareEncoders().empty();
+}
+
+// static
+std::unique_ptr<VideoEncoderH264> VideoEncoderH264::create()
+{
+    if (!isSupported())
+    {
+        LOG(LS_WARNING) << "No hardware H.264 encoder";
+        return nullptr;
+    }
+
+    std::unique_ptr<VideoEncoderH264> encoder(new VideoEncoderH264());
+    if (!encoder->mf_started_)
+        return nullptr;
+
+    return encoder;
+}
+
+void VideoEncoderH264::encode(const Frame* frame, proto::VideoPacket* packet)
+{
+    TRACE_EVENT("VideoEncoderH264::encode");
+
+    fillPacketInfo(frame, packet);
+
+    bool is_key_frame = false;
+
+    if (packet->has_format())
+    {
+        if (!createTransform(frame->size()))
+        {
+            LOG(LS_ERROR) << "Unable to create H.264 encoder";
+            destroyTransform();
+            return;
+        }
+
+        is_key_frame = true;
+    }
+
+    if (!transform_)
+        return;
+
+    prepareImage(is_key_frame, frame);
+
+    std::string* data = packet->mutable_data();
+
+    // The encoder is asynchronous and requests the input by the events. The output which is read
+    // while waiting for the request belongs to the previous frames and is sent with this packet.
+    while (!input_requests_)
+    {
+        if (!processEvent(data))
+        {
+            destroyTransform();
+            return;
+        }
+    }
+
+    if (!sendInput())
+    {
+        destroyTransform();
+        return;
+    }
+
+    --input_requests_;
+
+    // In low latency mode the encoder outputs the frame before it requests the next input. If the
+    // next input is requested earlier, the frame will be sent with the next packet.
+    const size_t prev_size = data->size();
+
+    while (!input_requests_ && data->size() == prev_size)
+    {
+        if (!processEvent(data))
+        {
+            destroyTransform();
+            return;
+        }
+    }
+
+    // The decoder always converts the entire image.
+    proto::Rect* rect = packet->add_dirty_rect();
+    rect->set_width(frame->size().width());
+    rect->set_height(frame->size().height());
+}
+
+bool VideoEncoderH264::createTransform(const Size& size)
+{
+    destroyTransform();
+
+    image_size_ = Size(size.width() + (size.width() & 1), size.height() + (size.height() & 1));
+
+    const size_t y_size = static_cast<size_t>(image_size_.width() * image_size_.height());
+    image_buffer_.resize(y_size + y_size / 2);
+
+    // Reset image value to 128 so the image padding is filled with gray.
+    memset(image_buffer_.data(), 128, image_buffer_.size());
+
+    for (const auto& activate : enumHardwareEncoders())
+    {
+        ComPtr<IMFTransform> transform;
+
+        HRESULT hr = activate->ActivateObject(IID_PPV_ARGS(&transform));
+        if (FAILED(hr))
+        {
+            LOG(LS_WARNING) << "IMFActivate::ActivateObject failed: "
+                            << SystemError::toString(static_cast<DWORD>(hr));
+            continue;
+        }
+
+        activate_ = activate;
+        transform_ = transform;
+
+        ComPtr<IMFAttributes> attributes;
+        hr = transform_->GetAttributes(&attributes);
+        if (FAILED(hr))
+        {
+            LOG(LS_WARNING) << "IMFTransform::GetAttributes failed: "
+                            << SystemError::toString(static_cast<DWORD>(hr));
+            destroyTransform();
+            continue;
+        }
+
+        UINT32 is_async = FALSE;
+        attributes->GetUINT32(MF_TRANSFORM_ASYNC, &is_async);
+        if (!is_async)
+        {
+            LOG(LS_WARNING) << "Encoder is not asynchronous";
+            destroyTransform();
+            continue;
+        }
+
+        // Hardware encoders must be unlocked before use.
+        attributes->SetUINT32(MF_TRANSFORM_ASYNC_UNLOCK, TRUE);
+        attributes->SetUINT32(MF_LOW_LATENCY, TRUE);
+
+        hr = transform_.As(&event_generator_);
+        if (FAILED(hr))
+        {
+            LOG(LS_WARNING) << "IMFMediaEventGenerator is not supported: "
+                            << SystemError::toString(static_cast<DWORD>(hr));
+            destroyTransform();
+            continue;
+        }
+
+        hr = transform_->GetStreamIDs(1, &input_stream_id_, 1, &output_stream_id_);
+        if (hr == E_NOTIMPL)
+        {
+            // The transform has a fixed number of streams with consecutive identifiers.
+            input_stream_id_ = 0;
+            output_stream_id_ = 0;
+        }
+        else if (FAILED(hr))
+        {
+            LOG(LS_WARNING) << "IMFTransform::GetStreamIDs failed: "
+                            << SystemError::toString(static_cast<DWORD>(hr));
+            destroyTransform();
+            continue;
+        }
+
+        if (!setMediaTypes(image_size_))
+        {
+            destroyTransform();
+            continue;
+        }
+
+        setEncoderOptions();
+
+        transform_->ProcessMessage(MFT_MESSAGE_NOTIFY_BEGIN_STREAMING, 0);
+        transform_->ProcessMessage(MFT_MESSAGE_NOTIFY_START_OF_STREAM, 0);
+
+        start_time_ = std::chrono::steady_clock::now();
+
+        LOG(LS_INFO) << "H.264 encoder created for size: " << image_size_;
+        return true;
+    }
+
+    return false;
+}
+
+void VideoEncoderH264::destroyTransform()
+{
+    event_generator_.Reset();
+    transform_.Reset();
+
+    if (activate_)
+    {
+        activate_->ShutdownObject();
+        activate_.Reset();
+    }
+
+    input_stream_id_ = 0;
+    output_stream_id_ = 0;
+    input_requests_ = 0;
+}
+
+bool VideoEncoderH264::setMediaTypes(const Size& size)
+{
+    const UINT32 width = static_cast<UINT32>(size.width());
+    const UINT32 height = static_cast<UINT32>(size.height());
+    const UINT32 bitrate = std::clamp(width * height * kBitsPerPixel, kMinBitrate, kMaxBitrate);
+
+    // The output type must be set before the input type for the encoders.
+    ComPtr<IMFMediaType> output_type;
+    HRESULT hr = MFCreateMediaType(&output_type);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "MFCreateMediaType failed: "
+                        << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    output_type->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+    output_type->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_H264);
+    output_type->SetUINT32(MF_MT_AVG_BITRATE, bitrate);
+    output_type->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive);
+    output_type->SetUINT32(MF_MT_MPEG2_PROFILE, eAVEncH264VProfile_Main);
+    MFSetAttributeSize(output_type.Get(), MF_MT_FRAME_SIZE, width, height);
+    MFSetAttributeRatio(output_type.Get(), MF_MT_FRAME_RATE, kFrameRate, 1);
+    MFSetAttributeRatio(output_type.Get(), MF_MT_PIXEL_ASPECT_RATIO, 1, 1);
+
+    hr = transform_->SetOutputType(output_stream_id_, output_type.Get(), 0);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFTransform::SetOutputType failed: "
+                        << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    ComPtr<IMFMediaType> input_type;
+    hr = MFCreateMediaType(&input_type);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "MFCreateMediaType failed: "
+                        << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    input_type->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video);
+    input_type->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_NV12);
+    input_type->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive);
+    MFSetAttributeSize(input_type.Get(), MF_MT_FRAME_SIZE, width, height);
+    MFSetAttributeRatio(input_type.Get(), MF_MT_FRAME_RATE, kFrameRate, 1);
+    MFSetAttributeRatio(input_type.Get(), MF_MT_PIXEL_ASPECT_RATIO, 1, 1);
+
+    hr = transform_->SetInputType(input_stream_id_, input_type.Get(), 0);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "IMFTransform::SetInputType failed: "
+                        << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    LOG(LS_INFO) << "H.264 target bitrate: " << bitrate;
+    return true;
+}
+
+void VideoEncoderH264::setEncoderOptions()
+{
+    ComPtr<ICodecAPI> codec_api;
+    HRESULT hr = transform_.As(&codec_api);
+    if (FAILED(hr))
+    {
+        LOG(LS_WARNING) << "ICodecAPI is not supported: "
+                        << SystemError::toString(static_cast<DWORD>(hr));
+        return;
+    }
+
+    VARIANT value;
+
+    value.vt = VT_BOOL;
+    value.boolVal = VARIANT_TRUE;
+    setCodecValue(codec_api.Get(), CODECAPI_AVLowLatencyMode, &value, "AVLowLatencyMode");
+
+    value.vt = VT_UI4;
+    value.ulVal = eAVEncCommonRateControlMode_UnconstrainedVBR;
+    setCodecValue(codec_api.Get(), CODECAPI_AVEncCommonRateControlMode, &value,
+                  "AVEncCommonRateControlMode");
+
+    value.vt = VT_UI4;
+    value.ulVal = kGopSize;
+    setCodecValue(codec_api.Get(), CODECAPI_AVEncMPVGOPSize, &value, "AVEncMPVGOPSize");
+
+    // B-frames add latency.
+    value.vt = VT_UI4;
+    value.ulVal = 0;
+    setCodecValue(codec_api.Get(), CODECAPI_AVEncMPVDefaultBPictureCount, &value,
+                  "AVEncMPVDefaultBPictureCount");
+}
+
+void VideoEncoderH264::prepareImage(bool is_key_frame, const Frame* frame)
+{
+    const Rect frame_rect = Rect::makeSize(frame->size());
+    Region updated_region;
+
+    if (!is_key_frame)
+    {
+        // Align each rectangle to even coordinates which is required by ARGBToNV12().
+        for (Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+            updated_region.addRect(alignRect(it.rect()));
+
+        updated_region.intersectWith(frame_rect);
+    }
+    else
+    {
+        updated_region = Region(frame_rect);
+    }
+
+    const int y_stride = image_size_.width();
+    const int uv_stride = image_size_.width();
+    uint8_t* y_data = image_buffer_.data();
+    uint8_t* uv_data = y_data + y_stride * image_size_.height();
+
+    for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    {
+        Rect rect = it.rect();
+
+        libyuv::ARGBToNV12(frame->frameDataAtPos(rect.topLeft()),
+                           frame->stride(),
+                           y_data + y_stride * rect.y() + rect.x(), y_stride,
+                           uv_data + uv_stride * (rect.y() / 2) + rect.x(), uv_stride,
+                           rect.width(),
+                           rect.height());
+    }
+}
+
+bool VideoEncoderH264::sendInput()
+{
+    const DWORD buffer_size = static_cast<DWORD>(image_buffer_.size());
+
+    ComPtr<IMFMediaBuffer> buffer;
+    HRESULT hr = MFCreateMemoryBuffer(buffer_size, &buffer);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "MFCreateMemoryBuffer failed: "
+                      << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    BYTE* buffer_data = nullptr;
+    hr = buffer->Lock(&buffer_data, nullptr, nullptr);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "IMFMediaBuffer::Lock failed: "
+                      << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    memcpy(buffer_data, image_buffer_.data(), buffer_size);
+    buffer->Unlock();
+    buffer->SetCurrentLength(buffer_size);
+
+    ComPtr<IMFSample> sample;
+    hr = MFCreateSample(&sample);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "MFCreateSample failed: " << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    // The rate control of the encoder relies on the time stamps, so real time is used instead of
+    // a constant frame rate.
+    const int64_t sample_time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_time_).count() * 10;
+
+    sample->AddBuffer(buffer.Get());
+    sample->SetSampleTime(sample_time);
+    sample->SetSampleDuration(kSampleDuration);
+
+    hr = transform_->ProcessInput(input_stream_id_, sample.Get(), 0);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "IMFTransform::ProcessInput failed: "
+                      << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    return true;
+}
+
+bool VideoEncoderH264::processEvent(std::string* data)
+{
+    ComPtr<IMFMediaEvent> event;
+
+    // Blocks until the encoder sends the next event.
+    HRESULT hr = event_generator_->GetEvent(0, &event);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "IMFMediaEventGenerator::GetEvent failed: "
+                      << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    MediaEventType type = MEUnknown;
+    hr = event->GetType(&type);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "IMFMediaEvent::GetType failed: "
+                      << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    switch (type)
+    {
+        case METransformNeedInput:
+            ++input_requests_;
+            return true;
+
+        case METransformHaveOutput:
+            return readOutput(data);
+
+        default:
+            return true;
+    }
+}
+
+bool VideoEncoderH264::readOutput(std::string* data)
+{
+    MFT_OUTPUT_STREAM_INFO stream_info;
+    memset(&stream_info, 0, sizeof(stream_info));
+
+    HRESULT hr = transform_->GetOutputStreamInfo(output_stream_id_, &stream_info);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "IMFTransform::GetOutputStreamInfo failed: "
+                      << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    const bool provides_samples = (stream_info.dwFlags &
+        (MFT_OUTPUT_STREAM_PROVIDES_SAMPLES | MFT_OUTPUT_STREAM_CAN_PROVIDE_SAMPLES)) != 0;
+
+    ComPtr<IMFSample> sample;
+
+    if (!provides_samples)
+    {
+        ComPtr<IMFMediaBuffer> buffer;
+
+        hr = MFCreateMemoryBuffer(stream_info.cbSize, &buffer);
+        if (SUCCEEDED(hr))
+            hr = MFCreateSample(&sample);
+        if (SUCCEEDED(hr))
+            hr = sample->AddBuffer(buffer.Get());
+
+        if (FAILED(hr))
+        {
+            LOG(LS_ERROR) << "Unable to create output sample: "
+                          << SystemError::toString(static_cast<DWORD>(hr));
+            return false;
+        }
+    }
+
+    MFT_OUTPUT_DATA_BUFFER output;
+    memset(&output, 0, sizeof(output));
+
+    output.dwStreamID = output_stream_id_;
+    output.pSample = sample.Get();
+
+    DWORD status = 0;
+    hr = transform_->ProcessOutput(0, 1, &output, &status);
+
+    if (output.pEvents)
+        output.pEvents->Release();
+
+    if (provides_samples && output.pSample)
+        sample.Attach(output.pSample);
+
+    if (hr == MF_E_TRANSFORM_STREAM_CHANGE)
+    {
+        // The encoder changed the output type and it must be set again.
+        ComPtr<IMFMediaType> output_type;
+
+        hr = transform_->GetOutputAvailableType(output_stream_id_, 0, &output_type);
+        if (SUCCEEDED(hr))
+            hr = transform_->SetOutputType(output_stream_id_, output_type.Get(), 0);
+
+        if (FAILED(hr))
+        {
+            LOG(LS_ERROR) << "Unable to change output type: "
+                          << SystemError::toString(static_cast<DWORD>(hr));
+            return false;
+        }
+
+        return true;
+    }
+
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "IMFTransform::ProcessOutput failed: "
+                      << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    if (!sample)
+        return true;
+
+    ComPtr<IMFMediaBuffer> buffer;
+    hr = sample->ConvertToContiguousBuffer(&buffer);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "IMFSample::ConvertToContiguousBuffer failed: "
+                      << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    BYTE* buffer_data = nullptr;
+    DWORD buffer_size = 0;
+
+    hr = buffer->Lock(&buffer_data, nullptr, &buffer_size);
+    if (FAILED(hr))
+    {
+        LOG(LS_ERROR) << "IMFMediaBuffer::Lock failed: "
+                      << SystemError::toString(static_cast<DWORD>(hr));
+        return false;
+    }
+
+    data->append(reinterpret_cast<const char*>(buffer_data), buffer_size);
+    buffer->Unlock();
+
+    return true;
+}
+
+} // namespace base
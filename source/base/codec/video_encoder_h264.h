@@ -0,0 +1,83 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CODEC__VIDEO_ENCODER_H264_H
+#define BASE__CODEC__VIDEO_ENCODER_H264_H
+
+#include "base/macros_magic.h"
+#include "base/codec/video_encoder.h"
+#include "base/memory/byte_array.h"
+
+#include <chrono>
+
+#include <mfidl.h>
+#include <mftransform.h>
+#include <wrl/client.h>
+
+namespace base {
+
+// H.264 encoder which uses the hardware encoder of the video card (NVENC, Quick Sync, AMF)
+// available through Media Foundation.
+class VideoEncoderH264 : public VideoEncoder
+{
+public:
+    ~VideoEncoderH264() override;
+
+    // Returns true if a hardware H.264 encoder is present in the system.
+    static bool isSupported();
+
+    // Returns nullptr if a hardware H.264 encoder is not available.
+    static std::unique_ptr<VideoEncoderH264> create();
+
+    void encode(const Frame* frame, proto::VideoPacket* packet) override;
+
+private:
+    VideoEncoderH264();
+
+    bool createTransform(const Size& size);
+    void destroyTransform();
+    bool setMediaTypes(const Size& size);
+    void setEncoderOptions();
+    void prepareImage(bool is_key_frame, const Frame* frame);
+    bool sendInput();
+    bool processEvent(std::string* data);
+    bool readOutput(std::string* data);
+
+    bool mf_started_ = false;
+
+    Microsoft::WRL::ComPtr<IMFActivate> activate_;
+    Microsoft::WRL::ComPtr<IMFTransform> transform_;
+    Microsoft::WRL::ComPtr<IMFMediaEventGenerator> event_generator_;
+    DWORD input_stream_id_ = 0;
+    DWORD output_stream_id_ = 0;
+    int input_requests_ = 0;
+
+    // Size of the encoded image. H.264 requires the even width and height.
+    Size image_size_;
+
+    // NV12 planes of the current image.
+    ByteArray image_buffer_;
+
+    std::chrono::steady_clock::time_point start_time_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoEncoderH264);
+};
+
+} // namespace base
+
+#endif // BASE__CODEC__VIDEO_ENCODER_H264_H
@@ -0,0 +1,293 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/codec/video_encoder_hybrid.h"
+
+#include "base/logging.h"
+#include "base/trace_event.h"
+#include "base/codec/video_encoder_vpx.h"
+#include "base/codec/video_encoder_zstd.h"
+#include "base/desktop/frame.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace base {
+
+namespace {
+
+// Size of the classified blocks. It is a multiple of the VP9 macro block.
+const int kBlockSize = 64;
+
+// A block that changes more than about 8 times per second is treated as motion.
+const std::chrono::milliseconds kScoreHalfLife { 500 };
+const float kMotionScore = 6.0f;
+
+// A block sent with VP9 is refreshed losslessly when it has not changed for this time.
+const std::chrono::milliseconds kRefreshDelay { 300 };
+
+// Shares the pixels of another frame, but has its own updated region.
+class FrameView : public Frame
+{
+public:
+    FrameView(const Frame& frame, const Region& updated_region)
+        : Frame(frame.size(), frame.format(), frame.stride(), frame.frameData(),
+                frame.sharedMemory())
+    {
+        copyFrameInfoFrom(frame);
+        *updatedRegion() = updated_region;
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(FrameView);
+};
+
+} // namespace
+
+VideoEncoderHybrid::VideoEncoderHybrid(std::unique_ptr<VideoEncoderVPX> lossy_encoder,
+                                       std::unique_ptr<VideoEncoderZstd> lossless_encoder)
+    : VideoEncoder(proto::VIDEO_ENCODING_HYBRID),
+      lossy_encoder_(std::move(lossy_encoder)),
+      lossless_encoder_(std::move(lossless_encoder))
+{
+    DCHECK(lossy_encoder_);
+    DCHECK(lossless_encoder_);
+}
+
+VideoEncoderHybrid::~VideoEncoderHybrid() = default;
+
+// static
+std::unique_ptr<VideoEncoderHybrid> VideoEncoderHybrid::create(
+    const PixelFormat& lossless_format, int compression_ratio)
+{
+    std::unique_ptr<VideoEncoderVPX> lossy_encoder = VideoEncoderVPX::createVP9();
+    std::unique_ptr<VideoEncoderZstd> lossless_encoder =
+        VideoEncoderZstd::create(lossless_format, compression_ratio);
+
+    if (!lossy_encoder || !lossless_encoder)
+        return nullptr;
+
+    return std::unique_ptr<VideoEncoderHybrid>(
+        new VideoEncoderHybrid(std::move(lossy_encoder), std::move(lossless_encoder)));
+}
+
+void VideoEncoderHybrid::encode(const Frame* frame, proto::VideoPacket* packet)
+{
+    TRACE_EVENT("VideoEncoderHybrid::encode");
+
+    const TimePoint now = Clock::now();
+    const bool size_changed = frame->size() != size_;
+
+    Region lossy_region;
+    Region lossless_region;
+
+    if (size_changed)
+    {
+        resize(frame->size());
+
+        // The whole frame is sent losslessly. The VP9 stream starts with a key frame anyway,
+        // the lossless part is applied over it.
+        lossless_region = Region(Rect::makeSize(size_));
+    }
+    else
+    {
+        classify(now, frame->constUpdatedRegion(), &lossy_region, &lossless_region);
+    }
+
+    refresh_pending_ = false;
+
+    if (size_changed || !lossy_region.isEmpty())
+    {
+        FrameView lossy_frame(*frame, lossy_region);
+        lossy_encoder_->encode(&lossy_frame, packet);
+
+        if (!size_changed)
+            markLossy(now, *packet);
+    }
+
+    packet->set_encoding(encoding());
+
+    if (!lossless_region.isEmpty())
+    {
+        FrameView lossless_frame(*frame, lossless_region);
+        lossless_encoder_->encode(&lossless_frame, packet->mutable_lossless_packet());
+    }
+
+    lossy_region_.clear();
+
+    for (int row = 0; row < rows_; ++row)
+    {
+        for (int column = 0; column < columns_; ++column)
+        {
+            if (blocks_[static_cast<size_t>(row * columns_ + column)].lossy)
+                lossy_region_.addRect(blockRect(column, row));
+        }
+    }
+}
+
+void VideoEncoderHybrid::setTargetBitrate(uint32_t bitrate)
+{
+    lossy_encoder_->setTargetBitrate(bitrate);
+}
+
+void VideoEncoderHybrid::requestKeyFrame()
+{
+    VideoEncoder::requestKeyFrame();
+    lossy_encoder_->requestKeyFrame();
+    lossless_encoder_->requestKeyFrame();
+
+    // The next frame is handled as a new size: both streams start over.
+    size_ = Size();
+}
+
+void VideoEncoderHybrid::setMaxThreadCount(int count)
+{
+    lossy_encoder_->setMaxThreadCount(count);
+}
+
+void VideoEncoderHybrid::resize(const Size& size)
+{
+    size_ = size;
+    columns_ = (size.width() + kBlockSize - 1) / kBlockSize;
+    rows_ = (size.height() + kBlockSize - 1) / kBlockSize;
+
+    blocks_.assign(static_cast<size_t>(columns_ * rows_), Block());
+    frame_number_ = 0;
+}
+
+Rect VideoEncoderHybrid::blockRect(int column, int row) const
+{
+    Rect rect = Rect::makeXYWH(column * kBlockSize, row * kBlockSize, kBlockSize, kBlockSize);
+    rect.intersectWith(Rect::makeSize(size_));
+    return rect;
+}
+
+void VideoEncoderHybrid::classify(const TimePoint& now,
+                                  const Region& updated_region,
+                                  Region* lossy_region,
+                                  Region* lossless_region)
+{
+    ++frame_number_;
+
+    Region motion_blocks;
+    Region refreshed_blocks;
+
+    for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    {
+        Rect rect = it.rect();
+        rect.intersectWith(Rect::makeSize(size_));
+        if (rect.isEmpty())
+            continue;
+
+        const int left = rect.left() / kBlockSize;
+        const int top = rect.top() / kBlockSize;
+        const int right = (rect.right() - 1) / kBlockSize;
+        const int bottom = (rect.bottom() - 1) / kBlockSize;
+
+        for (int row = top; row <= bottom; ++row)
+        {
+            for (int column = left; column <= right; ++column)
+            {
+                Block& block = blocks_[static_cast<size_t>(row * columns_ + column)];
+                if (block.frame_number == frame_number_)
+                    continue;
+
+                block.frame_number = frame_number_;
+
+                if (refresh_pending_ && block.lossy)
+                {
+                    // The screen has not changed, the frame only repeats the lossy blocks.
+                    refreshed_blocks.addRect(blockRect(column, row));
+                    block.lossy = false;
+                    continue;
+                }
+
+                const float half_lives = std::chrono::duration<float>(now - block.last_change) /
+                    std::chrono::duration<float>(kScoreHalfLife);
+
+                block.score = block.score * std::exp2(-std::min(half_lives, 32.0f)) + 1.0f;
+                block.last_change = now;
+
+                if (block.score >= kMotionScore)
+                {
+                    motion_blocks.addRect(blockRect(column, row));
+                }
+                else if (block.lossy)
+                {
+                    // The block is not motion anymore. The rest of the block is refreshed too.
+                    refreshed_blocks.addRect(blockRect(column, row));
+                    block.lossy = false;
+                }
+            }
+        }
+    }
+
+    // The blocks that were sent with VP9 and do not change anymore are refreshed losslessly.
+    for (int row = 0; row < rows_; ++row)
+    {
+        for (int column = 0; column < columns_; ++column)
+        {
+            Block& block = blocks_[static_cast<size_t>(row * columns_ + column)];
+
+            if (block.lossy && block.frame_number != frame_number_ &&
+                now - block.lossy_time >= kRefreshDelay)
+            {
+                refreshed_blocks.addRect(blockRect(column, row));
+                block.lossy = false;
+            }
+        }
+    }
+
+    lossy_region->intersect(updated_region, motion_blocks);
+
+    *lossless_region = updated_region;
+    lossless_region->subtract(motion_blocks);
+    lossless_region->addRegion(refreshed_blocks);
+    lossless_region->intersectWith(Rect::makeSize(size_));
+}
+
+void VideoEncoderHybrid::markLossy(const TimePoint& now, const proto::VideoPacket& packet)
+{
+    // The encoder pads the rectangles, so the lossy areas can be larger than the motion blocks.
+    for (int i = 0; i < packet.dirty_rect_size(); ++i)
+    {
+        const proto::Rect& dirty_rect = packet.dirty_rect(i);
+
+        Rect rect = Rect::makeXYWH(
+            dirty_rect.x(), dirty_rect.y(), dirty_rect.width(), dirty_rect.height());
+        rect.intersectWith(Rect::makeSize(size_));
+        if (rect.isEmpty())
+            continue;
+
+        const int left = rect.left() / kBlockSize;
+        const int top = rect.top() / kBlockSize;
+        const int right = (rect.right() - 1) / kBlockSize;
+        const int bottom = (rect.bottom() - 1) / kBlockSize;
+
+        for (int row = top; row <= bottom; ++row)
+        {
+            for (int column = left; column <= right; ++column)
+            {
+                Block& block = blocks_[static_cast<size_t>(row * columns_ + column)];
+                block.lossy = true;
+                block.lossy_time = now;
+            }
+        }
+    }
+}
+
+} // namespace base
@@ -0,0 +1,100 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE__CODEC__VIDEO_ENCODER_HYBRID_H
+#define BASE__CODEC__VIDEO_ENCODER_HYBRID_H
+
+#include "base/macros_magic.h"
+#include "base/codec/video_encoder.h"
+#include "base/desktop/pixel_format.h"
+#include "base/desktop/region.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace base {
+
+class VideoEncoderVPX;
+class VideoEncoderZstd;
+
+// Encodes the frequently changing areas of the screen (video, animation) with lossy VP9 and the
+// other changes (text, user interface) with lossless ZSTD. The screen is divided into blocks and
+// each block is classified by how often it changes. When a block encoded with VP9 stops changing,
+// it is sent again losslessly.
+class VideoEncoderHybrid : public VideoEncoder
+{
+public:
+    ~VideoEncoderHybrid() override;
+
+    static std::unique_ptr<VideoEncoderHybrid> create(
+        const PixelFormat& lossless_format, int compression_ratio);
+
+    void encode(const Frame* frame, proto::VideoPacket* packet) override;
+    void setTargetBitrate(uint32_t bitrate) override;
+    Region lossyRegion() const override { return lossy_region_; }
+    void setRefreshPending() override { refresh_pending_ = true; }
+    void requestKeyFrame() override;
+
+    void setMaxThreadCount(int count);
+
+private:
+    using Clock = std::chrono::high_resolution_clock;
+    using TimePoint = std::chrono::time_point<Clock>;
+
+    struct Block
+    {
+        // How often the block changes. Each change adds 1, and the score halves every
+        // kScoreHalfLife.
+        float score = 0;
+        TimePoint last_change;
+
+        // The block was sent with VP9 and has not been refreshed losslessly yet.
+        bool lossy = false;
+        TimePoint lossy_time;
+
+        // Number of the last frame in which the block has changed.
+        uint32_t frame_number = 0;
+    };
+
+    VideoEncoderHybrid(std::unique_ptr<VideoEncoderVPX> lossy_encoder,
+                       std::unique_ptr<VideoEncoderZstd> lossless_encoder);
+
+    void resize(const Size& size);
+    Rect blockRect(int column, int row) const;
+    void classify(const TimePoint& now, const Region& updated_region,
+                  Region* lossy_region, Region* lossless_region);
+    void markLossy(const TimePoint& now, const proto::VideoPacket& packet);
+
+    std::unique_ptr<VideoEncoderVPX> lossy_encoder_;
+    std::unique_ptr<VideoEncoderZstd> lossless_encoder_;
+
+    Size size_;
+    int columns_ = 0;
+    int rows_ = 0;
+    std::vector<Block> blocks_;
+    uint32_t frame_number_ = 0;
+
+    Region lossy_region_;
+    bool refresh_pending_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoEncoderHybrid);
+};
+
+} // namespace base
+
+#endif // BASE__CODEC__VIDEO_ENCODER_HYBRID_H
@@ -19,11 +19,18 @@
 #include "base/codec/video_encoder_vpx.h"
 
 #include "base/logging.h"
+#include "base/trace_event.h"
+#include "base/sys_info.h"
 #include "base/desktop/frame.h"
+#include "base/threading/worker_group.h"
 
 #include <libyuv/convert.h>
 #include <libyuv/cpu_id.h>
 
+#include <algorithm>
+#include <bitset>
+#include <iterator>
+#include <limits>
 #include <thread>
 
 namespace base {
@@ -32,16 +39,119 @@ namespace {
 
 const std::chrono::milliseconds kTargetFrameInterval{ 80 };
 
+// The golden frame of VP8 and VP9 is refreshed with this interval and serves as the reference
+// frame for the recovery frames.
+const int kReferenceFrameInterval = 60;
+
+// Segments of the region of interest map and the quantizer deltas for them.
+enum RoiSegment { kRoiNormal = 0, kRoiFocus = 1, kRoiVideo = 2 };
+const int kRoiFocusDeltaQ = -32;
+const int kRoiVideoDeltaQ = 32;
+
+// The area around the focus point with the raised quality, in pixels of the encoded frame.
+const int kRoiFocusRadius = 160;
+
+// A macroblock that has changed in so many of the last 8 frames is considered as video.
+const int kRoiVideoChangeCount = 6;
+
+// The quantizer range of the refinement frames, which repeat the lossy areas of the screen when it
+// stops changing. The regular frames use 20..30.
+const unsigned int kRefinementMinQuantizer = 0;
+const unsigned int kRefinementMaxQuantizer = 4;
+
 // Defines the dimension of a macro block. This is used to compute the active map for the encoder.
 const int kMacroBlockSize = 16;
 
+// The updates of this area and larger are converted to YUV in parallel, in stripes of this height.
+// The smaller updates do not pay for the synchronization of the threads. The height keeps the top
+// of the stripes even, as ARGBToI420() requires.
+const int64_t kParallelConversionArea = 512 * 512;
+const int kConversionStripeHeight = kMacroBlockSize * 4;
+
 // Magic encoder profile numbers for I420 input formats.
 const int kVp9I420ProfileNumber = 0;
 
-// Magic encoder constant for adaptive quantization strategy.
+// Magic encoder constants for adaptive quantization strategy.
+const int kVp9AqModeNone = 0;
 const int kVp9AqModeCyclicRefresh = 3;
 
-void setCommonCodecParameters(vpx_codec_enc_cfg_t* config, const Size& size)
+// VP9 tiles can not be narrower than 256 pixels. libvpx supports up to 64 tile columns.
+const int kVp9MinTileWidth = 256;
+const int kVp9MaxTileColumnsLog2 = 6;
+
+// The screen content speed settings of VP9 for the frame sizes up to |max_pixels|. Blocks with
+// a difference below |static_threshold| are not encoded. Larger frames tolerate a higher
+// threshold and need a faster preset to keep up with the frame rate.
+struct Vp9SpeedProfile
+{
+    int max_pixels;
+    int cpu_used;
+    unsigned int static_threshold;
+};
+
+const Vp9SpeedProfile kVp9SpeedProfiles[] =
+{
+    { 1280 * 1024, 6, 1 },
+    { 1920 * 1200, 7, 1 },
+    { 2560 * 1600, 8, 100 },
+    { std::numeric_limits<int>::max(), 9, 100 }
+};
+
+// The fastest realtime preset of VP9.
+const int kVp9MaxCpuUsed = 9;
+
+// The speed of the VP9 encoder is adapted to the load of the processor. The encoding time is
+// averaged over this number of frames. If it takes more than a half of the frame interval, the
+// encoder becomes faster. If less than an eighth, it returns towards the profile speed.
+const int kCpuUsedCheckInterval = 30;
+const std::chrono::milliseconds kMaxEncodeTime = kTargetFrameInterval / 2;
+const std::chrono::milliseconds kMinEncodeTime = kTargetFrameInterval / 8;
+
+int processorCores()
+{
+    int cores = SysInfo::processorCores();
+    if (cores <= 0)
+        cores = SysInfo::processorThreads();
+
+    return std::max(cores, 1);
+}
+
+int applyThreadLimit(int threads, int max_thread_count)
+{
+    if (max_thread_count > 0)
+        threads = std::min(threads, max_thread_count);
+
+    return std::max(threads, 1);
+}
+
+// Returns the largest number of tile columns (log2) allowed for the frame width.
+int vp9TileColumnsLog2(int width)
+{
+    int tile_columns_log2 = 0;
+
+    while (tile_columns_log2 < kVp9MaxTileColumnsLog2 &&
+           (kVp9MinTileWidth << (tile_columns_log2 + 1)) <= width)
+    {
+        ++tile_columns_log2;
+    }
+
+    return tile_columns_log2;
+}
+
+const Vp9SpeedProfile& vp9SpeedProfile(const Size& size)
+{
+    const int pixels = size.width() * size.height();
+
+    for (const auto& profile : kVp9SpeedProfiles)
+    {
+        if (pixels <= profile.max_pixels)
+            return profile;
+    }
+
+    return std::end(kVp9SpeedProfiles)[-1];
+}
+
+void setCommonCodecParameters(vpx_codec_enc_cfg_t* config, const Size& size, bool error_resilient)
 {
     // Use millisecond granularity time base.
     config->g_timebase.num = 1;
@@ -74,6 +184,11 @@ void setCommonCodecParameters(vpx_codec_enc_cfg_t* config, const Size& size)
     config->rc_end_usage = VPX_VBR;
     config->rc_undershoot_pct = 100;
     config->rc_overshoot_pct = 15;
+
+    // A recovery frame refers to the golden frame only. The entropy contexts and other state of
+    // the frames between them must not be used, the client may have missed these frames.
+    if (error_resilient)
+        config->g_error_resilient = VPX_ERROR_RESILIENT_DEFAULT;
 }
 
 void createImage(const Size& size,
@@ -159,10 +274,15 @@ VideoEncoderVPX::VideoEncoderVPX(proto::VideoEncoding encoding)
 {
     memset(&config_, 0, sizeof(config_));
     memset(&active_map_, 0, sizeof(active_map_));
+    memset(&roi_map_, 0, sizeof(roi_map_));
 }
 
+VideoEncoderVPX::~VideoEncoderVPX() = default;
+
 void VideoEncoderVPX::encode(const Frame* frame, proto::VideoPacket* packet)
 {
+    TRACE_EVENT("VideoEncoderVPX::encode");
+
     fillPacketInfo(frame, packet);
 
     bool is_key_frame = false;
@@ -173,6 +293,8 @@ void VideoEncoderVPX::encode(const Frame* frame, proto::VideoPacket* packet)
 
         createImage(frame_size, &image_, &image_buffer_);
         createActiveMap(frame_size);
+        createRoiMap();
+        lossy_region_.clear();
 
         if (encoding() == proto::VIDEO_ENCODING_VP8)
         {
@@ -187,9 +309,17 @@ void VideoEncoderVPX::encode(const Frame* frame, proto::VideoPacket* packet)
         is_key_frame = true;
     }
 
+    const vpx_enc_frame_flags_t flags = referenceFlags(is_key_frame, packet);
+
+    // The frame repeats the lossy areas (see setRefreshPending). They are encoded with a higher
+    // quality this time.
+    const bool refinement = refresh_pending_ && !is_key_frame && !packet->recovery_frame_id();
+    refresh_pending_ = false;
+
     // Convert the updated capture data ready for encode.
-    // Update active map based on updated region.
-    prepareImageAndActiveMap(is_key_frame, frame, packet);
+    // Update active map based on updated region. The inactive blocks are copied from the last
+    // frame, so a recovery frame updates the whole image.
+    prepareImageAndActiveMap(is_key_frame || packet->recovery_frame_id(), frame, packet);
 
     // Apply active map to the encoder.
     vpx_codec_err_t ret = vpx_codec_control(codec_.get(), VP8E_SET_ACTIVEMAP, &active_map_);
@@ -198,19 +328,41 @@ void VideoEncoderVPX::encode(const Frame* frame, proto::VideoPacket* packet)
         LOG(LS_WARNING) << "vpx_codec_control(VP8E_SET_ACTIVEMAP) failed";
     }
 
+    if (!roi_map_buffer_.empty())
+    {
+        updateRoiMap(is_key_frame || packet->recovery_frame_id() || refinement);
+
+        ret = vpx_codec_control(codec_.get(), VP9E_SET_ROI_MAP, &roi_map_);
+        if (ret != VPX_CODEC_OK)
+        {
+            LOG(LS_WARNING) << "vpx_codec_control(VP9E_SET_ROI_MAP) failed";
+        }
+    }
+
+    if (refinement)
+        setQuantizerRange(kRefinementMinQuantizer, kRefinementMaxQuantizer);
+
+    const std::chrono::steady_clock::time_point encode_start = std::chrono::steady_clock::now();
+
     // Do the actual encoding.
     ret = vpx_codec_encode(codec_.get(),
                            image_.get(),
                            0, // pts
                            static_cast<unsigned long>(
                                std::chrono::microseconds(kTargetFrameInterval).count()),
-                           0, // flags
+                           flags,
                            VPX_DL_REALTIME);
     if (ret != VPX_CODEC_OK)
     {
         LOG(LS_WARNING) << "vpx_codec_encode failed";
     }
 
+    if (cpu_used_)
+        adaptCpuUsed(std::chrono::steady_clock::now() - encode_start);
+
+    if (refinement)
+        setQuantizerRange(min_quantizer_, max_quantizer_);
+
     // Read the encoded data.
     vpx_codec_iter_t iter = nullptr;
 
@@ -223,22 +375,155 @@ void VideoEncoderVPX::encode(const Frame* frame, proto::VideoPacket* packet)
         if (pkt->kind == VPX_CODEC_CX_FRAME_PKT)
         {
             packet->set_data(pkt->data.frame.buf, pkt->data.frame.sz);
+
+            // The encoder inserts key frames itself (see kf_max_dist). They replace the golden
+            // frame too.
+            if (reference_frames_ && (pkt->data.frame.flags & VPX_FRAME_IS_KEY) &&
+                packet->reference_frame_id() != frame_id_)
+            {
+                reference_frame_id_ = frame_id_;
+                frames_since_reference_ = 0;
+                packet->set_reference_frame_id(reference_frame_id_);
+            }
             break;
         }
     }
+
+    if (quality_refinement_)
+        updateLossyRegion(refinement);
+}
+
+void VideoEncoderVPX::setRefreshPending()
+{
+    if (quality_refinement_)
+        refresh_pending_ = true;
+}
+
+bool VideoEncoderVPX::requestRecoveryFrame()
+{
+    if (!reference_frames_ || !reference_frame_id_)
+        return false;
+
+    recovery_pending_ = true;
+    return true;
+}
+
+void VideoEncoderVPX::setTargetBitrate(uint32_t bitrate)
+{
+    if (bitrate == target_bitrate_)
+        return;
+
+    target_bitrate_ = bitrate;
+
+    // If the codec is not created yet, the bitrate is applied when it is created.
+    if (!codec_)
+        return;
+
+    config_.rc_target_bitrate = target_bitrate_;
+
+    vpx_codec_err_t ret = vpx_codec_enc_config_set(codec_.get(), &config_);
+    if (ret != VPX_CODEC_OK)
+    {
+        LOG(LS_WARNING) << "vpx_codec_enc_config_set failed: " << ret;
+    }
+}
+
+void VideoEncoderVPX::adaptCpuUsed(std::chrono::steady_clock::duration encode_time)
+{
+    encode_time_ += encode_time;
+    if (++encoded_frames_ < kCpuUsedCheckInterval)
+        return;
+
+    const std::chrono::steady_clock::duration average_time = encode_time_ / encoded_frames_;
+
+    encode_time_ = std::chrono::steady_clock::duration::zero();
+    encoded_frames_ = 0;
+
+    int cpu_used = cpu_used_;
+
+    if (average_time > kMaxEncodeTime)
+        cpu_used = std::min(cpu_used + 1, kVp9MaxCpuUsed);
+    else if (average_time < kMinEncodeTime)
+        cpu_used = std::max(cpu_used - 1, min_cpu_used_);
+
+    if (cpu_used == cpu_used_)
+        return;
+
+    LOG(LS_INFO) << "Average VP9 encoding time: "
+                 << std::chrono::duration_cast<std::chrono::milliseconds>(average_time).count()
+                 << " ms";
+    setCpuUsed(cpu_used);
+}
+
+void VideoEncoderVPX::setEnergySaving(bool enable)
+{
+    if (enable == energy_saving_)
+        return;
+
+    energy_saving_ = enable;
+
+    // The speed is chosen when the VP9 codec is created for the frame size.
+    if (!codec_ || !cpu_used_)
+        return;
+
+    min_cpu_used_ = energy_saving_ ?
+        kVp9MaxCpuUsed : vp9SpeedProfile(Size(static_cast<int32_t>(config_.g_w),
+                                              static_cast<int32_t>(config_.g_h))).cpu_used;
+
+    // Outside the energy saving mode the speed returns to the profile gradually, as the encoding
+    // time allows (see adaptCpuUsed).
+    if (cpu_used_ < min_cpu_used_)
+        setCpuUsed(min_cpu_used_);
+}
+
+void VideoEncoderVPX::setCpuUsed(int cpu_used)
+{
+    vpx_codec_err_t ret = vpx_codec_control(codec_.get(), VP8E_SET_CPUUSED, cpu_used);
+    if (ret != VPX_CODEC_OK)
+    {
+        LOG(LS_WARNING) << "vpx_codec_control(VP8E_SET_CPUUSED) failed";
+        return;
+    }
+
+    LOG(LS_INFO) << "VP9 speed changed from " << cpu_used_ << " to " << cpu_used;
+    cpu_used_ = cpu_used;
+}
+
+void VideoEncoderVPX::setQuantizerRange(unsigned int min_quantizer, unsigned int max_quantizer)
+{
+    config_.rc_min_quantizer = min_quantizer;
+    config_.rc_max_quantizer = max_quantizer;
+
+    vpx_codec_err_t ret = vpx_codec_enc_config_set(codec_.get(), &config_);
+    if (ret != VPX_CODEC_OK)
+    {
+        LOG(LS_WARNING) << "vpx_codec_enc_config_set failed: " << ret;
+    }
+}
+
+void VideoEncoderVPX::updateLossyRegion(bool refinement)
+{
+    // The encoder updates the whole macroblocks of the active map.
+    const Region encoded_region = active_blocks_.toRegion();
+
+    if (refinement)
+        lossy_region_.subtract(encoded_region);
+    else
+        lossy_region_.addRegion(encoded_region);
 }
 
 void VideoEncoderVPX::createActiveMap(const Size& size)
 {
-    active_map_.cols = static_cast<unsigned int>(
-        (size.width() + kMacroBlockSize - 1) / kMacroBlockSize);
-    active_map_.rows = static_cast<unsigned int>(
-        (size.height() + kMacroBlockSize - 1) / kMacroBlockSize);
+    // The map of the changed macroblocks is passed to the encoder as is.
+    active_blocks_.reset(size, kMacroBlockSize);
 
-    active_map_buffer_.resize(active_map_.cols * active_map_.rows);
-    active_map_.active_map = active_map_buffer_.data();
+    active_map_.cols = static_cast<unsigned int>(active_blocks_.columns());
+    active_map_.rows = static_cast<unsigned int>(active_blocks_.rows());
+    active_map_.active_map = active_blocks_.data();
 
-    clearActiveMap();
+    const int thread_count = applyThreadLimit(processorCores(), max_thread_count_);
+    if (!workers_ || workers_->threadCount() != thread_count)
+        workers_ = std::make_unique<WorkerGroup>(thread_count);
 }
 
 void VideoEncoderVPX::createVp8Codec(const Size& size)
@@ -254,7 +539,9 @@ void VideoEncoderVPX::createVp8Codec(const Size& size)
         LOG(LS_WARNING) << "vpx_codec_enc_config_default failed";
     }
 
-    setCommonCodecParameters(&config_, size);
+    setCommonCodecParameters(&config_, size, reference_frames_);
+    config_.g_threads = static_cast<unsigned int>(
+        applyThreadLimit(static_cast<int>(config_.g_threads), max_thread_count_));
 
     // Value of 2 means using the real time profile. This is basically a redundant option since we
     // explicitly select real time mode when doing encoding.
@@ -264,10 +551,10 @@ void VideoEncoderVPX::createVp8Codec(const Size& size)
     // the max quantizer. The quality will get topped-off in subsequent frames.
     config_.rc_min_quantizer = 20;
     config_.rc_max_quantizer = 30;
+    min_quantizer_ = config_.rc_min_quantizer;
+    max_quantizer_ = config_.rc_max_quantizer;
 
-    // In the absence of a good bandwidth estimator set the target bitrate to a
-    // conservative default.
-    config_.rc_target_bitrate = 1000;
+    config_.rc_target_bitrate = target_bitrate_;
 
     ret = vpx_codec_enc_init(codec_.get(), algo, &config_, 0);
     if (ret != VPX_CODEC_OK)
@@ -310,16 +597,31 @@ void VideoEncoderVPX::createVp9Codec(const Size& size)
         LOG(LS_WARNING) << "vpx_codec_enc_config_default failed";
     }
 
-    setCommonCodecParameters(&config_, size);
+    setCommonCodecParameters(&config_, size, reference_frames_);
+
+    // Tile columns are encoded in parallel. There is no sense in more threads than tile columns
+    // and in more tile columns than threads.
+    const int max_tile_columns_log2 = vp9TileColumnsLog2(size.width());
+    const int thread_count =
+        applyThreadLimit(std::min(processorCores(), 1 << max_tile_columns_log2), max_thread_count_);
+
+    int tile_columns_log2 = 0;
+    while ((2 << tile_columns_log2) <= thread_count)
+        ++tile_columns_log2;
+
+    config_.g_threads = static_cast<unsigned int>(thread_count);
+
+    LOG(LS_INFO) << "VP9 tile columns: " << (1 << tile_columns_log2)
+                 << ", threads: " << thread_count;
 
     // Configure VP9 for I420 source frames.
     config_.g_profile = kVp9I420ProfileNumber;
     config_.rc_min_quantizer = 20;
     config_.rc_max_quantizer = 30;
+    min_quantizer_ = config_.rc_min_quantizer;
+    max_quantizer_ = config_.rc_max_quantizer;
 
-    // In the absence of a good bandwidth estimator set the target bitrate to a
-    // conservative default.
-    config_.rc_target_bitrate = 1000;
+    config_.rc_target_bitrate = target_bitrate_;
 
     ret = vpx_codec_enc_init(codec_.get(), algo, &config_, 0);
     if (ret != VPX_CODEC_OK)
@@ -327,14 +629,30 @@ void VideoEncoderVPX::createVp9Codec(const Size& size)
         LOG(LS_WARNING) << "vpx_codec_enc_init failed";
     }
 
-    // Request the lowest-CPU usage that VP9 supports, which depends on whether we are encoding
-    // lossy or lossless.
-    ret = vpx_codec_control(codec_.get(), VP8E_SET_CPUUSED, 6);
+    const Vp9SpeedProfile& profile = vp9SpeedProfile(size);
+
+    LOG(LS_INFO) << "VP9 speed: " << profile.cpu_used
+                 << ", static threshold: " << profile.static_threshold;
+
+    // The speed starts from the profile of the frame size and may be raised later if the
+    // processor can not keep up (see adaptCpuUsed).
+    min_cpu_used_ = energy_saving_ ? kVp9MaxCpuUsed : profile.cpu_used;
+    cpu_used_ = min_cpu_used_;
+    encode_time_ = std::chrono::steady_clock::duration::zero();
+    encoded_frames_ = 0;
+
+    ret = vpx_codec_control(codec_.get(), VP8E_SET_CPUUSED, cpu_used_);
     if (ret != VPX_CODEC_OK)
     {
         LOG(LS_WARNING) << "vpx_codec_control(VP8E_SET_CPUUSED) failed";
     }
 
+    ret = vpx_codec_control(codec_.get(), VP8E_SET_STATIC_THRESHOLD, profile.static_threshold);
+    if (ret != VPX_CODEC_OK)
+    {
+        LOG(LS_WARNING) << "vpx_codec_control(VP8E_SET_STATIC_THRESHOLD) failed";
+    }
+
     ret = vpx_codec_control(codec_.get(), VP9E_SET_TUNE_CONTENT, VP9E_CONTENT_SCREEN);
     if (ret != VPX_CODEC_OK)
     {
@@ -349,12 +667,27 @@ void VideoEncoderVPX::createVp9Codec(const Size& size)
         LOG(LS_WARNING) << "vpx_codec_control(VP9E_SET_NOISE_SENSITIVITY) failed";
     }
 
-    // Set cyclic refresh (aka "top-off") only for lossy encoding.
-    ret = vpx_codec_control(codec_.get(), VP9E_SET_AQ_MODE, kVp9AqModeCyclicRefresh);
+    // Set cyclic refresh (aka "top-off") only for lossy encoding. The region of interest map uses
+    // the segmentation instead.
+    ret = vpx_codec_control(codec_.get(), VP9E_SET_AQ_MODE,
+                            roi_enabled_ ? kVp9AqModeNone : kVp9AqModeCyclicRefresh);
     if (ret != VPX_CODEC_OK)
     {
         LOG(LS_WARNING) << "vpx_codec_control(VP9E_SET_AQ_MODE) failed";
     }
+
+    ret = vpx_codec_control(codec_.get(), VP9E_SET_TILE_COLUMNS, tile_columns_log2);
+    if (ret != VPX_CODEC_OK)
+    {
+        LOG(LS_WARNING) << "vpx_codec_control(VP9E_SET_TILE_COLUMNS) failed";
+    }
+
+    // Row based multithreading further parallelizes the encoding inside the tiles.
+    ret = vpx_codec_control(codec_.get(), VP9E_SET_ROW_MT, thread_count > 1 ? 1 : 0);
+    if (ret != VPX_CODEC_OK)
+    {
+        LOG(LS_WARNING) << "vpx_codec_control(VP9E_SET_ROW_MT) failed";
+    }
 }
 
 void VideoEncoderVPX::prepareImageAndActiveMap(
@@ -393,32 +726,19 @@ void VideoEncoderVPX::prepareImageAndActiveMap(
         updated_region = Region(image_rect);
     }
 
-    clearActiveMap();
+    active_blocks_.clear();
+    stripes_.clear();
 
-    const int y_stride = image_->stride[0];
-    const int uv_stride = image_->stride[1];
-    uint8_t* y_data = image_->planes[0];
-    uint8_t* u_data = image_->planes[1];
-    uint8_t* v_data = image_->planes[2];
+    int64_t area = 0;
 
     for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
     {
-        Rect rect = it.rect();
+        const Rect& rect = it.rect();
 
-        const int y_offset = y_stride * rect.y() + rect.x();
-        const int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
-        const int width = rect.width();
-        const int height = rect.height();
+        stripes_.push_back(rect);
+        area += static_cast<int64_t>(rect.width()) * rect.height();
 
-        libyuv::ARGBToI420(frame->frameDataAtPos(rect.topLeft()),
-                           frame->stride(),
-                           y_data + y_offset, y_stride,
-                           u_data + uv_offset, uv_stride,
-                           v_data + uv_offset, uv_stride,
-                           width,
-                           height);
-
-        addRectToActiveMap(rect);
+        active_blocks_.markRect(rect);
 
         proto::Rect* dirty_rect = packet->add_dirty_rect();
         dirty_rect->set_x(rect.x());
@@ -426,29 +746,161 @@ void VideoEncoderVPX::prepareImageAndActiveMap(
         dirty_rect->set_width(rect.width());
         dirty_rect->set_height(rect.height());
     }
+
+    if (area < kParallelConversionArea || !workers_ || workers_->threadCount() == 1)
+    {
+        for (const Rect& rect : stripes_)
+            convertRect(frame, rect);
+        return;
+    }
+
+    // The rectangles are cut into the stripes, so the threads get parts of the similar size.
+    const size_t rect_count = stripes_.size();
+    for (size_t i = 0; i < rect_count; ++i)
+    {
+        const Rect rect = stripes_[i];
+
+        if (rect.height() <= kConversionStripeHeight)
+            continue;
+
+        stripes_[i] = Rect::makeLTRB(
+            rect.left(), rect.top(), rect.right(), rect.top() + kConversionStripeHeight);
+
+        for (int top = rect.top() + kConversionStripeHeight; top < rect.bottom();
+             top += kConversionStripeHeight)
+        {
+            const int bottom = std::min(top + kConversionStripeHeight, rect.bottom());
+            stripes_.push_back(Rect::makeLTRB(rect.left(), top, rect.right(), bottom));
+        }
+    }
+
+    workers_->run(static_cast<int>(stripes_.size()), [this, frame](int index)
+    {
+        convertRect(frame, stripes_[static_cast<size_t>(index)]);
+    });
+}
+
+void VideoEncoderVPX::convertRect(const Frame* frame, const Rect& rect)
+{
+    const int y_stride = image_->stride[0];
+    const int uv_stride = image_->stride[1];
+
+    const int y_offset = y_stride * rect.y() + rect.x();
+    const int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
+
+    libyuv::ARGBToI420(frame->frameDataAtPos(rect.topLeft()),
+                       frame->stride(),
+                       image_->planes[0] + y_offset, y_stride,
+                       image_->planes[1] + uv_offset, uv_stride,
+                       image_->planes[2] + uv_offset, uv_stride,
+                       rect.width(),
+                       rect.height());
 }
 
-void VideoEncoderVPX::addRectToActiveMap(const Rect& rect)
+vpx_enc_frame_flags_t VideoEncoderVPX::referenceFlags(
+    bool is_key_frame, proto::VideoPacket* packet)
 {
-    int left = rect.left() / kMacroBlockSize;
-    int top = rect.top() / kMacroBlockSize;
-    int right = (rect.right() - 1) / kMacroBlockSize;
-    int bottom = (rect.bottom() - 1) / kMacroBlockSize;
+    if (!reference_frames_)
+        return 0;
 
-    uint8_t* map = active_map_.active_map + top * active_map_.cols;
+    const bool recovery = recovery_pending_ && reference_frame_id_ && !is_key_frame;
+    recovery_pending_ = false;
 
-    for (int y = top; y <= bottom; ++y)
+    // Zero means "no frame" in the packet.
+    if (++frame_id_ == 0)
+        ++frame_id_;
+
+    if (recovery)
     {
-        for (int x = left; x <= right; ++x)
-            map[x] = 1;
+        packet->set_recovery_frame_id(reference_frame_id_);
+        ++frames_since_reference_;
 
-        map += active_map_.cols;
+        return VP8_EFLAG_NO_REF_LAST | VP8_EFLAG_NO_REF_ARF |
+               VP8_EFLAG_NO_UPD_GF | VP8_EFLAG_NO_UPD_ARF;
     }
+
+    // The key frame refreshes all reference buffers.
+    if (is_key_frame || frames_since_reference_ >= kReferenceFrameInterval)
+    {
+        reference_frame_id_ = frame_id_;
+        frames_since_reference_ = 0;
+        packet->set_reference_frame_id(reference_frame_id_);
+
+        return is_key_frame ? 0 : (VP8_EFLAG_FORCE_GF | VP8_EFLAG_NO_UPD_ARF);
+    }
+
+    ++frames_since_reference_;
+
+    // The golden frame is updated only by the reference frames.
+    return VP8_EFLAG_NO_UPD_GF | VP8_EFLAG_NO_UPD_ARF;
 }
 
-void VideoEncoderVPX::clearActiveMap()
+void VideoEncoderVPX::createRoiMap()
 {
-    memset(active_map_buffer_.data(), 0, active_map_buffer_.size());
+    memset(&roi_map_, 0, sizeof(roi_map_));
+    roi_map_buffer_.clear();
+    change_history_.clear();
+
+    if (!roi_enabled_ || encoding() != proto::VIDEO_ENCODING_VP9)
+        return;
+
+    // The map has the same macroblock grid as the active map.
+    roi_map_.rows = active_map_.rows;
+    roi_map_.cols = active_map_.cols;
+
+    roi_map_buffer_.resize(roi_map_.rows * roi_map_.cols);
+    change_history_.resize(roi_map_buffer_.size());
+    memset(change_history_.data(), 0, change_history_.size());
+
+    roi_map_.roi_map = roi_map_buffer_.data();
+    roi_map_.delta_q[kRoiFocus] = kRoiFocusDeltaQ;
+    roi_map_.delta_q[kRoiVideo] = kRoiVideoDeltaQ;
+
+    // The segments do not force a reference frame.
+    for (size_t i = 0; i < std::size(roi_map_.ref_frame); ++i)
+        roi_map_.ref_frame[i] = -1;
+}
+
+void VideoEncoderVPX::updateRoiMap(bool full_frame)
+{
+    const int rows = static_cast<int>(roi_map_.rows);
+    const int cols = static_cast<int>(roi_map_.cols);
+
+    // The whole image of a key frame or a recovery frame does not mean that it has changed.
+    if (!full_frame)
+    {
+        for (size_t i = 0; i < change_history_.size(); ++i)
+        {
+            change_history_[i] = static_cast<uint8_t>(
+                (change_history_[i] << 1) | (active_blocks_.constData()[i] ? 1 : 0));
+        }
+    }
+
+    Rect focus_rect;
+    if (focus_point_.has_value())
+    {
+        focus_rect = Rect::makeLTRB(
+            (focus_point_->x() - kRoiFocusRadius) / kMacroBlockSize,
+            (focus_point_->y() - kRoiFocusRadius) / kMacroBlockSize,
+            (focus_point_->x() + kRoiFocusRadius) / kMacroBlockSize + 1,
+            (focus_point_->y() + kRoiFocusRadius) / kMacroBlockSize + 1);
+    }
+
+    for (int y = 0; y < rows; ++y)
+    {
+        uint8_t* map = roi_map_buffer_.data() + y * cols;
+        const uint8_t* history = change_history_.data() + y * cols;
+
+        for (int x = 0; x < cols; ++x)
+        {
+            if (focus_rect.contains(x, y))
+                map[x] = kRoiFocus;
+            else if (std::bitset<8>(history[x]).count() >= kRoiVideoChangeCount)
+                map[x] = kRoiVideo;
+            else
+                map[x] = kRoiNormal;
+        }
+    }
 }
 
 } // namespace base
@@ -22,45 +22,130 @@
 #include "base/macros_magic.h"
 #include "base/codec/scoped_vpx_codec.h"
 #include "base/codec/video_encoder.h"
-#include "base/desktop/region.h"
+#include "base/desktop/dirty_block_map.h"
 #include "base/memory/byte_array.h"
 
 #define VPX_CODEC_DISABLE_COMPAT 1
 #include <vpx/vpx_encoder.h>
 #include <vpx/vp8cx.h>
 
+#include <chrono>
+#include <optional>
+#include <vector>
+
 namespace base {
 
+class WorkerGroup;
+
 class VideoEncoderVPX : public VideoEncoder
 {
 public:
-    ~VideoEncoderVPX() = default;
+    ~VideoEncoderVPX();
 
     static std::unique_ptr<VideoEncoderVPX> createVP8();
     static std::unique_ptr<VideoEncoderVPX> createVP9();
 
     void encode(const Frame* frame, proto::VideoPacket* packet) override;
+    void setTargetBitrate(uint32_t bitrate) override;
+
+    // Limits the number of encoder threads and the threads of the color conversion. 0 means that
+    // the number of threads depends only on the frame size and the number of processor cores.
+    // Takes effect when the frame size changes.
+    void setMaxThreadCount(int count) { max_thread_count_ = count; }
+
+    // Enables the reference frames that allow to recover the stream without a key frame (see
+    // requestRecoveryFrame). The frames are encoded in error resilient mode then, so they do not
+    // depend on the state left by the frames that the client has not decoded. Takes effect when
+    // the frame size changes.
+    void setReferenceFrames(bool enable) { reference_frames_ = enable; }
+
+    // Enables the refinement of the lossy areas. The areas sent since the last refinement are
+    // reported by lossyRegion() and when the screen stops changing, the frame that repeats them is
+    // encoded with a much lower quantizer (see setRefreshPending).
+    void setQualityRefinement(bool enable) { quality_refinement_ = enable; }
+    Region lossyRegion() const override { return lossy_region_; }
+    void setRefreshPending() override;
+
+    uint32_t referenceFrameId() const override { return reference_frame_id_; }
+    bool requestRecoveryFrame() override;
+
+    // Enables the region of interest map (VP9 only). The quality is raised around the focus point
+    // and lowered in the areas that change in almost every frame (video). The map replaces the
+    // cyclic refresh of VP9, both use the segmentation. Takes effect when the frame size changes.
+    void setRegionOfInterest(bool enable) { roi_enabled_ = enable; }
+    void setFocusPoint(const Point& point) override { focus_point_ = point; }
+
+    // VP9 uses its fastest speed regardless of the frame size. VP8 always uses it.
+    void setEnergySaving(bool enable) override;
 
 private:
+    // In the absence of a good bandwidth estimator set the target bitrate to a conservative
+    // default.
+    static constexpr uint32_t kDefaultTargetBitrate = 1000; // kbps
+
     explicit VideoEncoderVPX(proto::VideoEncoding encoding);
 
     void createActiveMap(const Size& size);
     void createVp8Codec(const Size& size);
     void createVp9Codec(const Size& size);
     void prepareImageAndActiveMap(bool is_key_frame, const Frame* frame, proto::VideoPacket* packet);
-    void addRectToActiveMap(const Rect& rect);
-    void clearActiveMap();
+    void convertRect(const Frame* frame, const Rect& rect);
+    void setQuantizerRange(unsigned int min_quantizer, unsigned int max_quantizer);
+    void updateLossyRegion(bool refinement);
+    void adaptCpuUsed(std::chrono::steady_clock::duration encode_time);
+    void setCpuUsed(int cpu_used);
+    vpx_enc_frame_flags_t referenceFlags(bool is_key_frame, proto::VideoPacket* packet);
+    void createRoiMap();
+    void updateRoiMap(bool full_frame);
 
     vpx_codec_enc_cfg_t config_;
     ScopedVpxCodec codec_;
 
-    ByteArray active_map_buffer_;
+    DirtyBlockMap active_blocks_;
     vpx_active_map_t active_map_;
 
+    bool roi_enabled_ = false;
+    std::optional<Point> focus_point_;
+    ByteArray roi_map_buffer_;
+    vpx_roi_map_t roi_map_;
+
+    // The bits of the last frames in which the macroblock has changed (the last frame is the
+    // lowest bit).
+    ByteArray change_history_;
+
     // VPX image and buffer to hold the actual YUV planes.
     std::unique_ptr<vpx_image_t> image_;
     ByteArray image_buffer_;
 
+    // The large updates are converted to YUV in horizontal stripes in parallel.
+    std::unique_ptr<WorkerGroup> workers_;
+    std::vector<Rect> stripes_;
+
+    int max_thread_count_ = 0;
+
+    // The quantizer range of the regular frames.
+    unsigned int min_quantizer_ = 0;
+    unsigned int max_quantizer_ = 0;
+
+    bool quality_refinement_ = false;
+    bool refresh_pending_ = false;
+    Region lossy_region_;
+
+    // The current speed of the VP9 encoder and the speed of the profile for the frame size (the
+    // fastest one in the energy saving mode). Zero for VP8.
+    int cpu_used_ = 0;
+    int min_cpu_used_ = 0;
+    bool energy_saving_ = false;
+    std::chrono::steady_clock::duration encode_time_ = std::chrono::steady_clock::duration::zero();
+    int encoded_frames_ = 0;
+    uint32_t target_bitrate_ = kDefaultTargetBitrate;
+
+    bool reference_frames_ = false;
+    uint32_t frame_id_ = 0;
+    uint32_t reference_frame_id_ = 0;
+    int frames_since_reference_ = 0;
+    bool recovery_pending_ = false;
+
     DISALLOW_COPY_AND_ASSIGN(VideoEncoderVPX);
 };
 
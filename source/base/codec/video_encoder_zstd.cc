@@ -19,21 +19,24 @@
 #include "base/codec/video_encoder_zstd.h"
 
 #include "base/logging.h"
+#include "base/trace_event.h"
+#include "base/codec/delta_filter.h"
+#include "base/codec/palette.h"
 #include "base/codec/pixel_translator.h"
-#include "base/desktop/frame.h"
+#include "base/codec/tile_cache.h"
+#include "base/codec/zstd_dictionary.h"
+#include "base/desktop/frame_aligned.h"
+#include "base/desktop/scroll_detector.h"
+#include "base/threading/worker_group.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
 
 namespace base {
 
 namespace {
 
-// Retrieves a pointer to the output buffer in |update| used for storing the
-// encoded rectangle data. Will resize the buffer to |size|.
-uint8_t* outputBuffer(proto::VideoPacket* packet, size_t size)
-{
-    packet->mutable_data()->resize(size);
-    return reinterpret_cast<uint8_t*>(packet->mutable_data()->data());
-}
-
 void serializePixelFormat(const PixelFormat& from, proto::PixelFormat* to)
 {
     to->set_bits_per_pixel(from.bitsPerPixel());
@@ -55,15 +58,50 @@ void serializeRect(const Rect& from, proto::Rect* to)
     to->set_height(from.height());
 }
 
+// Each copy rectangle costs a search over the area, so only the largest areas are checked.
+const int kMaxCopyRects = 4;
+
+// Smaller areas moved by the system are encoded as usual.
+const int kMinMoveRectSize = 16;
+
+// Updates are split into parts only if each part gets at least that number of pixels. For smaller
+// updates waking up the worker threads costs more than the parallel compression saves.
+const int64_t kMinPixelsPerPart = 512 * 512;
+
+// With the slicing the updates are split into parts of kMinPixelsPerPart pixels, but not into more
+// parts than that. Each part has its own stream in the encoder and in the decoder.
+const int kMaxSliceCount = 8;
+
+// The window of the streams with the cross-frame context. Each stream compresses its own part of
+// the screen, so 16 MB keeps more than one full frame of each part.
+const int kCrossFrameWindowLog = 24;
+
+bool isAreaMoved(const Frame& previous, const Frame& current,
+                 const Point& src_pos, const Rect& dest_rect)
+{
+    const size_t row_size = static_cast<size_t>(dest_rect.width()) * sizeof(uint32_t);
+
+    for (int y = 0; y < dest_rect.height(); ++y)
+    {
+        if (memcmp(previous.frameDataAtPos(src_pos.x(), src_pos.y() + y),
+                   current.frameDataAtPos(dest_rect.left(), dest_rect.top() + y),
+                   row_size) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 } // namespace
 
 VideoEncoderZstd::VideoEncoderZstd(const PixelFormat& target_format, int compression_ratio)
     : VideoEncoder(proto::VIDEO_ENCODING_ZSTD),
       target_format_(target_format),
-      compress_ratio_(compression_ratio),
-      stream_(ZSTD_createCStream())
+      compress_ratio_(compression_ratio)
 {
-    // Nothing
+    parts_.emplace_back(std::make_unique<Part>());
 }
 
 VideoEncoderZstd::~VideoEncoderZstd() = default;
@@ -81,49 +119,385 @@ std::unique_ptr<VideoEncoderZstd> VideoEncoderZstd::create(
         new VideoEncoderZstd(target_format, compression_ratio));
 }
 
-void VideoEncoderZstd::compressPacket(proto::VideoPacket* packet,
-                                      const uint8_t* input_data,
-                                      size_t input_size)
+void VideoEncoderZstd::setScrollDetection(bool enable)
+{
+    if (enable == (scroll_detector_ != nullptr))
+        return;
+
+    if (enable)
+    {
+        scroll_detector_ = std::make_unique<ScrollDetector>();
+    }
+    else
+    {
+        scroll_detector_.reset();
+
+        if (!delta_filter_)
+            previous_frame_.reset();
+    }
+}
+
+void VideoEncoderZstd::setPaletteEncoding(bool enable)
+{
+    palette_encoding_ = enable;
+}
+
+void VideoEncoderZstd::setSlicing(bool enable)
+{
+    slicing_ = enable;
+}
+
+void VideoEncoderZstd::setDeltaFilter(bool enable)
 {
-    size_t ret = ZSTD_initCStream(stream_.get(), compress_ratio_);
+    delta_filter_ = enable;
+
+    // The previous frame is created with the next key frame.
+    if (!delta_filter_ && !scroll_detector_)
+        previous_frame_.reset();
+}
+
+void VideoEncoderZstd::setTileCache(bool enable)
+{
+    tile_cache_enabled_ = enable;
+
+    // The encoder and the decoder create their caches with the next frame format.
+    tile_cache_.reset();
+}
+
+void VideoEncoderZstd::setMaxThreadCount(int count)
+{
+    const int max_count = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+
+    count = std::clamp(count, 1, max_count);
+    if (count == max_thread_count_)
+        return;
+
+    max_thread_count_ = count;
+    workers_.reset();
+}
+
+void VideoEncoderZstd::setCrossFrameContext(bool enable)
+{
+    cross_frame_enabled_ = enable;
+}
+
+void VideoEncoderZstd::setDictionary(uint32_t id)
+{
+    requested_dictionary_id_ = id;
+}
+
+void VideoEncoderZstd::resetStream(Part* part)
+{
+    ZSTD_CStream* stream = part->stream.get();
+
+    // The stream starts again with the key frame, the decoder resets its stream too.
+    ZSTD_CCtx_reset(stream, ZSTD_reset_session_and_parameters);
+    ZSTD_CCtx_setParameter(stream, ZSTD_c_compressionLevel, compress_ratio_);
+
+    if (cross_frame_context_)
+    {
+        ZSTD_CCtx_setParameter(stream, ZSTD_c_windowLog, kCrossFrameWindowLog);
+        ZSTD_CCtx_setParameter(stream, ZSTD_c_enableLongDistanceMatching, 1);
+    }
+
+    // The dictionary stays loaded for all the next frames of the stream.
+    if (!dictionary_.empty())
+    {
+        const size_t ret = ZSTD_CCtx_loadDictionary(stream, dictionary_.data(), dictionary_.size());
+        if (ZSTD_isError(ret))
+            LOG(LS_WARNING) << "ZSTD_CCtx_loadDictionary failed: " << ZSTD_getErrorName(ret);
+    }
+
+    part->reset_context = false;
+}
+
+void VideoEncoderZstd::compressPart(Part* part, std::string* output)
+{
+    if (!part->stream)
+        part->stream.reset(ZSTD_createCStream());
+
+    if (part->reset_context)
+        resetStream(part);
+
+    size_t data_size = 0;
+
+    for (const Rect& rect : part->rects)
+    {
+        data_size +=
+            static_cast<size_t>(rect.width() * rect.height() * target_format_.bytesPerPixel());
+    }
+
+    if (part->translate_buffer_size < data_size)
+    {
+        part->translate_buffer.reset(static_cast<uint8_t*>(base::alignedAlloc(data_size, 32)));
+        part->translate_buffer_size = data_size;
+    }
+
+    uint8_t* translate_pos = part->translate_buffer.get();
+    part->delta_rects.clear();
+    part->palette_rects.clear();
+
+    for (const Rect& rect : part->rects)
+    {
+        const int stride = rect.width() * target_format_.bytesPerPixel();
+        const size_t rect_size = static_cast<size_t>(rect.height() * stride);
+
+        translator_->translate(part->frame->frameDataAtPos(rect.topLeft()),
+                               part->frame->stride(),
+                               translate_pos,
+                               stride,
+                               rect.width(),
+                               rect.height());
+
+        if (use_delta_filter_)
+        {
+            if (part->reference_buffer_size < rect_size)
+            {
+                part->reference_buffer.reset(
+                    static_cast<uint8_t*>(base::alignedAlloc(rect_size, 32)));
+                part->reference_buffer_size = rect_size;
+            }
+
+            // The decoder has the same pixels in its image.
+            translator_->translate(previous_frame_->frameDataAtPos(rect.topLeft()),
+                                   previous_frame_->stride(),
+                                   part->reference_buffer.get(),
+                                   stride,
+                                   rect.width(),
+                                   rect.height());
+
+            const bool delta =
+                isDeltaCheaper(translate_pos, part->reference_buffer.get(), rect_size);
+            if (delta)
+                xorDelta(translate_pos, part->reference_buffer.get(), rect_size);
+
+            part->delta_rects.emplace_back(delta);
+        }
+
+        uint32_t palette_size = 0;
+
+        // The delta is mostly zeros and compresses well as is.
+        if (palette_encoding_ && (part->delta_rects.empty() || !part->delta_rects.back()))
+        {
+            if (part->palette_buffer.size() < rect_size)
+                part->palette_buffer.resize(rect_size);
+
+            palette_size = encodePalette(translate_pos, rect.width(), rect.height(),
+                                         target_format_.bytesPerPixel(),
+                                         part->palette_buffer.data());
+        }
+
+        if (palette_encoding_)
+            part->palette_rects.emplace_back(palette_size);
+
+        if (palette_size)
+        {
+            const size_t palette_data_size = paletteDataSize(
+                rect.width(), rect.height(), target_format_.bytesPerPixel(), palette_size);
+
+            memcpy(translate_pos, part->palette_buffer.data(), palette_data_size);
+            translate_pos += palette_data_size;
+        }
+        else
+        {
+            translate_pos += rect_size;
+        }
+    }
+
+    // The indexed rectangles are smaller than their pixels.
+    data_size = static_cast<size_t>(translate_pos - part->translate_buffer.get());
+
+    if (cross_frame_context_)
+    {
+        if (!compressWithContext(part, data_size, output))
+            output->clear();
+        return;
+    }
+
+    // Compress data with using Zstd compressor. Unlike ZSTD_initCStream the reset of the session
+    // keeps the parameters and the dictionary.
+    size_t ret = ZSTD_CCtx_reset(part->stream.get(), ZSTD_reset_session_only);
     DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
 
-    const size_t output_size = ZSTD_compressBound(input_size);
-    uint8_t* output_data = outputBuffer(packet, output_size);
+    const size_t output_size = ZSTD_compressBound(data_size);
+    output->resize(output_size);
 
-    ZSTD_inBuffer input = { input_data, input_size, 0 };
-    ZSTD_outBuffer output = { output_data, output_size, 0 };
+    ZSTD_inBuffer input = { part->translate_buffer.get(), data_size, 0 };
+    ZSTD_outBuffer zstd_output = { output->data(), output_size, 0 };
 
     while (input.pos < input.size)
     {
-        ret = ZSTD_compressStream(stream_.get(), &output, &input);
+        ret = ZSTD_compressStream(part->stream.get(), &zstd_output, &input);
         if (ZSTD_isError(ret))
         {
             LOG(LS_WARNING) << "ZSTD_compressStream failed: " << ZSTD_getErrorName(ret);
+            output->clear();
             return;
         }
     }
 
-    ret = ZSTD_endStream(stream_.get(), &output);
+    ret = ZSTD_endStream(part->stream.get(), &zstd_output);
     DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
 
-    packet->mutable_data()->resize(output.pos);
+    output->resize(zstd_output.pos);
+}
+
+bool VideoEncoderZstd::compressWithContext(Part* part, size_t data_size, std::string* output)
+{
+    ZSTD_CStream* stream = part->stream.get();
+
+    if (!data_size)
+    {
+        // The decoder does not read the stream for a part without rectangles.
+        output->clear();
+        return true;
+    }
+
+    output->resize(ZSTD_compressBound(data_size));
+
+    ZSTD_inBuffer input = { part->translate_buffer.get(), data_size, 0 };
+    ZSTD_outBuffer zstd_output = { output->data(), output->size(), 0 };
+
+    // The frame is not ended. The flushed data can be decoded completely, and the next packet
+    // continues the same frame.
+    for (;;)
+    {
+        const size_t ret =
+            ZSTD_compressStream2(stream, &zstd_output, &input, ZSTD_e_flush);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_WARNING) << "ZSTD_compressStream2 failed: " << ZSTD_getErrorName(ret);
+
+            // The stream state is unknown now.
+            part->reset_context = true;
+            return false;
+        }
+
+        if (!ret)
+            break;
+
+        output->resize(output->size() + ZSTD_CStreamOutSize());
+        zstd_output.dst = output->data();
+        zstd_output.size = output->size();
+    }
+
+    output->resize(zstd_output.pos);
+    return true;
+}
+
+int VideoEncoderZstd::splitRegion(const Frame* frame)
+{
+    int64_t total_pixels = 0;
+    for (Region::Iterator it(updated_region_); !it.isAtEnd(); it.advance())
+        total_pixels += static_cast<int64_t>(it.rect().width()) * it.rect().height();
+
+    const int max_part_count =
+        slicing_ ? std::max(max_thread_count_, kMaxSliceCount) : max_thread_count_;
+    const int part_count = static_cast<int>(std::clamp<int64_t>(
+        total_pixels / kMinPixelsPerPart, 1, max_part_count));
+
+    while (parts_.size() < static_cast<size_t>(part_count))
+        parts_.emplace_back(std::make_unique<Part>());
+
+    for (auto& part : parts_)
+    {
+        part->frame = frame;
+        part->rects.clear();
+    }
+
+    // The rectangles are cut into bands so that the parts get about the same number of pixels.
+    const int64_t part_pixels = (total_pixels + part_count - 1) / part_count;
+    int64_t current_pixels = 0;
+    int current_part = 0;
+
+    for (Region::Iterator it(updated_region_); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        int top = rect.top();
+
+        while (top < rect.bottom())
+        {
+            int rows = rect.bottom() - top;
+
+            if (current_part < part_count - 1)
+            {
+                const int64_t needed_rows =
+                    (part_pixels - current_pixels + rect.width() - 1) / rect.width();
+                rows = static_cast<int>(std::min<int64_t>(rows, std::max<int64_t>(needed_rows, 1)));
+            }
+
+            parts_[static_cast<size_t>(current_part)]->rects.emplace_back(
+                Rect::makeLTRB(rect.left(), top, rect.right(), top + rows));
+
+            current_pixels += static_cast<int64_t>(rows) * rect.width();
+            top += rows;
+
+            if (current_pixels >= part_pixels && current_part < part_count - 1)
+            {
+                ++current_part;
+                current_pixels = 0;
+            }
+        }
+    }
+
+    // The last parts can stay empty when the rectangles are cut unevenly.
+    return std::min(current_part + 1, part_count);
 }
 
 void VideoEncoderZstd::encode(const Frame* frame, proto::VideoPacket* packet)
 {
+    TRACE_EVENT("VideoEncoderZstd::encode");
+
     fillPacketInfo(frame, packet);
 
     if (packet->has_format())
     {
         serializePixelFormat(target_format_, packet->mutable_format()->mutable_pixel_format());
         updated_region_ = Region(Rect::makeSize(frame->size()));
+
+        cross_frame_context_ = cross_frame_enabled_;
+        if (cross_frame_context_)
+            packet->mutable_format()->set_zstd_window_log(kCrossFrameWindowLog);
+
+        if (dictionary_id_ != requested_dictionary_id_)
+        {
+            dictionary_id_ = requested_dictionary_id_;
+            dictionary_ = createZstdDictionary(dictionary_id_, target_format_);
+            if (dictionary_.empty())
+                dictionary_id_ = ZSTD_DICTIONARY_NONE;
+        }
+
+        if (dictionary_id_ != ZSTD_DICTIONARY_NONE)
+            packet->mutable_format()->set_zstd_dictionary(dictionary_id_);
+
+        for (auto& part : parts_)
+            part->reset_context = true;
+
+        if (scroll_detector_ || delta_filter_)
+        {
+            previous_frame_ = FrameAligned::create(frame->size(), PixelFormat::ARGB(), 32);
+            if (!previous_frame_)
+                LOG(LS_WARNING) << "Unable to create the previous frame";
+        }
+
+        if (tile_cache_enabled_)
+        {
+            tile_cache_ = std::make_unique<TileCache>(TileCache::kDefaultCapacity, 0);
+            packet->mutable_format()->set_tile_cache_size(
+                static_cast<uint32_t>(tile_cache_->capacity()));
+        }
     }
     else
     {
         updated_region_ = frame->constUpdatedRegion();
+
+        if (scroll_detector_ && previous_frame_)
+            detectScroll(frame, packet);
     }
 
+    if (tile_cache_)
+        lookupTiles(frame, packet);
+
     if (!translator_)
     {
         translator_ = PixelTranslator::create(PixelFormat::ARGB(), target_format_);
@@ -134,40 +508,321 @@ void VideoEncoderZstd::encode(const Frame* frame, proto::VideoPacket* packet)
         }
     }
 
-    size_t data_size = 0;
+    // The decoder has no previous image for the key frame.
+    use_delta_filter_ = delta_filter_ && previous_frame_ && !packet->has_format();
 
-    for (Region::Iterator it(updated_region_); !it.isAtEnd(); it.advance())
+    const int part_count = splitRegion(frame);
+
+    for (int i = 0; i < part_count; ++i)
     {
-        const Rect& rect = it.rect();
-        data_size += static_cast<size_t>(rect.width() * rect.height() * target_format_.bytesPerPixel());
-        serializeRect(rect, packet->add_dirty_rect());
+        for (const Rect& rect : parts_[static_cast<size_t>(i)]->rects)
+            serializeRect(rect, packet->add_dirty_rect());
     }
 
-    if (translate_buffer_size_ < data_size)
+    if (part_count == 1)
     {
-        translate_buffer_.reset(static_cast<uint8_t*>(base::alignedAlloc(data_size, 32)));
-        translate_buffer_size_ = data_size;
+        compressPart(parts_.front().get(), packet->mutable_data());
     }
+    else
+    {
+        if (!workers_)
+            workers_ = std::make_unique<WorkerGroup>(max_thread_count_);
 
-    uint8_t* translate_pos = translate_buffer_.get();
+        // Each part is compressed in its own stream and can be decompressed independently.
+        workers_->run(part_count, [this](int index)
+        {
+            Part* part = parts_[static_cast<size_t>(index)].get();
+            compressPart(part, &part->data);
+        });
 
-    for (Region::Iterator it(updated_region_); !it.isAtEnd(); it.advance())
+        for (int i = 0; i < part_count; ++i)
+        {
+            Part* part = parts_[static_cast<size_t>(i)].get();
+
+            packet->add_part_rect_count(static_cast<uint32_t>(part->rects.size()));
+            packet->add_part_data()->swap(part->data);
+        }
+    }
+
+    if (use_delta_filter_)
+    {
+        bool has_delta = false;
+
+        for (int i = 0; i < part_count; ++i)
+        {
+            for (bool delta : parts_[static_cast<size_t>(i)]->delta_rects)
+                has_delta |= delta;
+        }
+
+        // The field is omitted if all the rectangles are sent as is.
+        for (int i = 0; has_delta && i < part_count; ++i)
+        {
+            for (bool delta : parts_[static_cast<size_t>(i)]->delta_rects)
+                packet->add_dirty_rect_delta(delta);
+        }
+    }
+
+    if (palette_encoding_)
+    {
+        bool has_palette = false;
+
+        for (int i = 0; i < part_count; ++i)
+        {
+            for (uint32_t palette_size : parts_[static_cast<size_t>(i)]->palette_rects)
+                has_palette |= palette_size != 0;
+        }
+
+        // The field is omitted if all the rectangles are sent as pixels.
+        for (int i = 0; has_palette && i < part_count; ++i)
+        {
+            for (uint32_t palette_size : parts_[static_cast<size_t>(i)]->palette_rects)
+                packet->add_dirty_rect_palette(palette_size);
+        }
+    }
+
+    // The decoder adds the new tiles in the same order.
+    for (int i = 0; i < packet->new_tile_size(); ++i)
+        tile_cache_->insert(packet->new_tile(i).hash());
+
+    if (previous_frame_)
+    {
+        updatePreviousFrame(frame, packet->has_format() ?
+            Region(Rect::makeSize(frame->size())) : frame->constUpdatedRegion());
+    }
+}
+
+// static
+std::vector<proto::VideoPacket> VideoEncoderZstd::splitIntoSlices(
+    proto::VideoPacket* packet, size_t slice_size)
+{
+    std::vector<proto::VideoPacket> slices;
+
+    const int part_count = packet->part_data_size();
+    if (part_count < 2 || packet->part_rect_count_size() != part_count)
+        return slices;
+
+    int64_t total_rect_count = 0;
+    for (int i = 0; i < part_count; ++i)
+        total_rect_count += packet->part_rect_count(i);
+
+    if (total_rect_count != packet->dirty_rect_size())
+        return slices;
+
+    // The parts are grouped in order. A slice is closed when it has at least |slice_size| bytes.
+    std::vector<int> first_parts;
+    size_t current_size = slice_size;
+
+    for (int i = 0; i < part_count; ++i)
+    {
+        if (current_size >= slice_size)
+        {
+            first_parts.emplace_back(i);
+            current_size = 0;
+        }
+
+        current_size += packet->part_data(i).size();
+    }
+
+    if (first_parts.size() < 2)
+        return slices;
+
+    first_parts.emplace_back(part_count);
+    slices.resize(first_parts.size() - 1);
+
+    const bool has_delta = packet->dirty_rect_delta_size() != 0;
+    const bool has_palette = packet->dirty_rect_palette_size() != 0;
+    int rect_index = 0;
+
+    for (size_t i = 0; i < slices.size(); ++i)
+    {
+        proto::VideoPacket* slice = &slices[i];
+        const bool is_first = i == 0;
+        const bool is_last = i == slices.size() - 1;
+
+        slice->set_encoding(packet->encoding());
+        slice->set_partial(!is_last);
+        slice->set_first_part(static_cast<uint32_t>(first_parts[i]));
+
+        // The moved areas and the cached tiles are applied before the rectangles of any part, and
+        // the new tiles are stored after all of them.
+        if (is_first)
+        {
+            if (packet->has_format())
+                *slice->mutable_format() = packet->format();
+
+            *slice->mutable_copy_rect() = packet->copy_rect();
+            *slice->mutable_cached_tile() = packet->cached_tile();
+        }
+
+        if (is_last)
+        {
+            *slice->mutable_new_tile() = packet->new_tile();
+
+            if (packet->has_timing())
+                *slice->mutable_timing() = packet->timing();
+        }
+
+        for (int part = first_parts[i]; part < first_parts[i + 1]; ++part)
+        {
+            const uint32_t rect_count = packet->part_rect_count(part);
+
+            for (uint32_t j = 0; j < rect_count; ++j, ++rect_index)
+            {
+                *slice->add_dirty_rect() = packet->dirty_rect(rect_index);
+
+                if (has_delta)
+                    slice->add_dirty_rect_delta(packet->dirty_rect_delta(rect_index));
+                if (has_palette)
+                    slice->add_dirty_rect_palette(packet->dirty_rect_palette(rect_index));
+            }
+
+            slice->add_part_rect_count(rect_count);
+            slice->add_part_data()->swap(*packet->mutable_part_data(part));
+        }
+    }
+
+    return slices;
+}
+
+void VideoEncoderZstd::detectScroll(const Frame* frame, proto::VideoPacket* packet)
+{
+    DCHECK(scroll_detector_);
+    DCHECK(previous_frame_);
+
+    // The search is not needed if the capturer has reported the moved areas.
+    if (addMoveRects(frame, packet))
+        return;
+
+    const Rect frame_rect = Rect::makeSize(frame->size());
+    const Region region = updated_region_;
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        if (packet->copy_rect_size() >= kMaxCopyRects)
+            break;
+
+        Rect rect = it.rect();
+        rect.intersectWith(frame_rect);
+
+        Rect dest_rect;
+        Point src_pos;
+
+        // The source and the target are inside the same rectangle of the region, so the copy
+        // rectangles do not affect each other.
+        if (!scroll_detector_->detect(*previous_frame_, *frame, rect, &dest_rect, &src_pos))
+            continue;
+
+        proto::CopyRect* copy_rect = packet->add_copy_rect();
+        copy_rect->set_source_x(src_pos.x());
+        copy_rect->set_source_y(src_pos.y());
+        serializeRect(dest_rect, copy_rect->mutable_dest_rect());
+
+        // The moved area is restored by the decoder from its own image.
+        updated_region_.subtract(dest_rect);
+    }
+}
+
+bool VideoEncoderZstd::addMoveRects(const Frame* frame, proto::VideoPacket* packet)
+{
+    const Rect frame_rect = Rect::makeSize(frame->size());
+
+    // The decoder applies the copy rectangles one by one, so the source of a rectangle must not
+    // be changed by the previous ones.
+    Region copied_region;
+
+    for (const Frame::MoveRect& move_rect : frame->constMoveRects())
+    {
+        if (packet->copy_rect_size() >= kMaxCopyRects)
+            break;
+
+        const Rect& dest_rect = move_rect.dest_rect;
+        const Rect source_rect = Rect::makeXYWH(move_rect.source_pos, dest_rect.size());
+
+        if (dest_rect.width() < kMinMoveRectSize || dest_rect.height() < kMinMoveRectSize)
+            continue;
+
+        if (!frame_rect.containsRect(dest_rect) || !frame_rect.containsRect(source_rect))
+            continue;
+
+        Region overlap(source_rect);
+        overlap.intersectWith(copied_region);
+        if (!overlap.isEmpty())
+            continue;
+
+        // The source of the move is the previous image of the capturer. Frames may have been
+        // skipped since the previous encoded frame, so the move is checked against it.
+        if (!isAreaMoved(*previous_frame_, *frame, move_rect.source_pos, dest_rect))
+            continue;
+
+        proto::CopyRect* copy_rect = packet->add_copy_rect();
+        copy_rect->set_source_x(move_rect.source_pos.x());
+        copy_rect->set_source_y(move_rect.source_pos.y());
+        serializeRect(dest_rect, copy_rect->mutable_dest_rect());
+
+        copied_region.addRect(dest_rect);
+        updated_region_.subtract(dest_rect);
+    }
+
+    return !copied_region.isEmpty();
+}
+
+void VideoEncoderZstd::lookupTiles(const Frame* frame, proto::VideoPacket* packet)
+{
+    DCHECK(tile_cache_);
+
+    const int tile_size = TileCache::kTileSize;
+    const Region region = updated_region_;
+    std::vector<Rect> cached_rects;
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
     {
         const Rect& rect = it.rect();
-        const int stride = rect.width() * target_format_.bytesPerPixel();
 
-        translator_->translate(frame->frameDataAtPos(rect.topLeft()),
-                               frame->stride(),
-                               translate_pos,
-                               stride,
-                               rect.width(),
-                               rect.height());
+        // Only the tiles of the grid which are completely inside the rectangle are checked.
+        const int left = (rect.left() + tile_size - 1) / tile_size * tile_size;
+        const int top = (rect.top() + tile_size - 1) / tile_size * tile_size;
+        const int right = rect.right() / tile_size * tile_size;
+        const int bottom = rect.bottom() / tile_size * tile_size;
 
-        translate_pos += rect.height() * stride;
+        for (int y = top; y < bottom; y += tile_size)
+        {
+            for (int x = left; x < right; x += tile_size)
+            {
+                const uint64_t hash =
+                    TileCache::hashTile(frame->frameDataAtPos(x, y), frame->stride());
+                proto::VideoTile* tile;
+
+                if (tile_cache_->find(hash) != -1)
+                {
+                    tile = packet->add_cached_tile();
+                    cached_rects.emplace_back(Rect::makeXYWH(x, y, tile_size, tile_size));
+                }
+                else
+                {
+                    tile = packet->add_new_tile();
+                }
+
+                tile->set_x(x);
+                tile->set_y(y);
+                tile->set_hash(hash);
+            }
+        }
     }
 
-    // Compress data with using Zstd compressor.
-    compressPacket(packet, translate_buffer_.get(), data_size);
+    const Region cached_region(cached_rects.data(), static_cast<int>(cached_rects.size()));
+    updated_region_.subtract(cached_region);
+}
+
+void VideoEncoderZstd::updatePreviousFrame(const Frame* frame, const Region& region)
+{
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        Rect rect = it.rect();
+        rect.intersectWith(Rect::makeSize(frame->size()));
+
+        if (!rect.isEmpty())
+            previous_frame_->copyPixelsFrom(*frame, rect.topLeft(), rect);
+    }
 }
 
 } // namespace base
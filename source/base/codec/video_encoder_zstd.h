@@ -26,9 +26,16 @@
 #include "base/desktop/region.h"
 #include "base/desktop/pixel_format.h"
 
+#include <string>
+#include <vector>
+
 namespace base {
 
+class Frame;
 class PixelTranslator;
+class ScrollDetector;
+class TileCache;
+class WorkerGroup;
 
 class VideoEncoderZstd : public VideoEncoder
 {
@@ -40,19 +47,99 @@ public:
 
     void encode(const Frame* frame, proto::VideoPacket* packet) override;
 
+    // Enables the search for scrolled areas. The encoder keeps a copy of the previous frame and
+    // sends the moved areas as copy rectangles. The decoder must support them.
+    void setScrollDetection(bool enable);
+
+    // Enables the tile cache. The tiles which the decoder has already received are sent as
+    // references to its cache. The cache is reset with every frame format.
+    void setTileCache(bool enable);
+
+    // Large updates are split into parts which are compressed in parallel. The decoder must
+    // support the parts if |count| is greater than 1.
+    void setMaxThreadCount(int count);
+
+    // The compression streams keep their context from packet to packet until the next key frame,
+    // so the repeated content of the previous frames is compressed as references to it. The
+    // decoder must decode every packet of the stream. Has effect from the next key frame.
+    void setCrossFrameContext(bool enable);
+
+    // Sets the dictionary (see ZstdDictionary) which improves the compression of small updates.
+    // The decoder must know the dictionary. Has effect from the next key frame.
+    void setDictionary(uint32_t id);
+
+    // Enables the delta filter. A rectangle that differs only slightly from the previous frame is
+    // compressed as the XOR with the previous pixels if it is estimated to be cheaper. The decoder
+    // must support it. Has effect from the next key frame.
+    void setDeltaFilter(bool enable);
+
+    // Enables the palette encoding. A rectangle with few colors is sent as a palette and the
+    // indices of its pixels, which is smaller and compresses faster. The decoder must support it.
+    void setPaletteEncoding(bool enable);
+
+    // Large updates are split into more parts than the threads, so that the packet can be sent
+    // in slices (see splitIntoSlices). The decoder must support the parts.
+    void setSlicing(bool enable);
+
+    // Splits the parts of |packet| into slices of about |slice_size| bytes of data. Each slice is
+    // a packet that the decoder can decode and paint as soon as it arrives. The data of the parts
+    // is moved to the slices. Returns an empty list if the packet is not split.
+    static std::vector<proto::VideoPacket> splitIntoSlices(
+        proto::VideoPacket* packet, size_t slice_size);
+
 private:
     VideoEncoderZstd(const PixelFormat& target_format, int compression_ratio);
-    void compressPacket(proto::VideoPacket* packet,
-                        const uint8_t* input_data,
-                        size_t input_size);
+    struct Part
+    {
+        const Frame* frame = nullptr;
+        std::vector<Rect> rects;
+        ScopedZstdCStream stream;
+        std::unique_ptr<uint8_t[], base::AlignedFreeDeleter> translate_buffer;
+        size_t translate_buffer_size = 0;
+        std::unique_ptr<uint8_t[], base::AlignedFreeDeleter> reference_buffer;
+        size_t reference_buffer_size = 0;
+        std::vector<bool> delta_rects;
+        std::vector<uint8_t> palette_buffer;
+        std::vector<uint32_t> palette_rects;
+        std::string data;
+        bool reset_context = true;
+    };
+
+    void resetStream(Part* part);
+    void compressPart(Part* part, std::string* output);
+    bool compressWithContext(Part* part, size_t data_size, std::string* output);
+    int splitRegion(const Frame* frame);
+    void detectScroll(const Frame* frame, proto::VideoPacket* packet);
+    bool addMoveRects(const Frame* frame, proto::VideoPacket* packet);
+    void updatePreviousFrame(const Frame* frame, const Region& region);
+    void lookupTiles(const Frame* frame, proto::VideoPacket* packet);
 
     Region updated_region_;
     PixelFormat target_format_;
     int compress_ratio_;
-    ScopedZstdCStream stream_;
     std::unique_ptr<PixelTranslator> translator_;
-    std::unique_ptr<uint8_t[], base::AlignedFreeDeleter> translate_buffer_;
-    size_t translate_buffer_size_ = 0;
+
+    int max_thread_count_ = 1;
+    std::vector<std::unique_ptr<Part>> parts_;
+    std::unique_ptr<WorkerGroup> workers_;
+
+    bool cross_frame_enabled_ = false;
+    bool cross_frame_context_ = false;
+
+    uint32_t requested_dictionary_id_ = 0;
+    uint32_t dictionary_id_ = 0;
+    std::string dictionary_;
+
+    std::unique_ptr<ScrollDetector> scroll_detector_;
+    bool delta_filter_ = false;
+    bool use_delta_filter_ = false;
+    std::unique_ptr<Frame> previous_frame_;
+
+    bool palette_encoding_ = false;
+    bool slicing_ = false;
+
+    bool tile_cache_enabled_ = false;
+    std::unique_ptr<TileCache> tile_cache_;
 
     DISALLOW_COPY_AND_ASSIGN(VideoEncoderZstd);
 };
@@ -0,0 +1,260 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/environment.h"
+#include "base/codec/video_decoder.h"
+#include "base/codec/video_encoder_vpx.h"
+#include "base/codec/video_encoder_zstd.h"
+#include "base/crypto/message_decryptor_openssl.h"
+#include "base/crypto/message_encryptor_openssl.h"
+#include "base/desktop/benchmark_frame_source.h"
+#include "base/desktop/frame_dump.h"
+#include "base/desktop/frame_simple.h"
+#include "base/memory/byte_array.h"
+#include "proto/desktop.pb.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+const Size kFrameSize(1920, 1080);
+const int kCompressRatio = 8;
+
+// The scene argument that selects the frame dump from ASPIA_FRAME_REPLAY.
+const int64_t kRecordedScene = -1;
+
+const ByteArray kKey = fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+const ByteArray kIv = fromHex("ee7eb0e6fb24d445597f3e6f");
+
+std::unique_ptr<VideoEncoder> createEncoder(proto::VideoEncoding encoding)
+{
+    switch (encoding)
+    {
+        case proto::VIDEO_ENCODING_ZSTD:
+            return VideoEncoderZstd::create(PixelFormat::RGB565(), kCompressRatio);
+
+        case proto::VIDEO_ENCODING_VP8:
+            return VideoEncoderVPX::createVP8();
+
+        case proto::VIDEO_ENCODING_VP9:
+            return VideoEncoderVPX::createVP9();
+
+        default:
+            return nullptr;
+    }
+}
+
+const char* encodingName(proto::VideoEncoding encoding)
+{
+    switch (encoding)
+    {
+        case proto::VIDEO_ENCODING_ZSTD:
+            return "zstd";
+
+        case proto::VIDEO_ENCODING_VP8:
+            return "vp8";
+
+        case proto::VIDEO_ENCODING_VP9:
+            return "vp9";
+
+        default:
+            return "unknown";
+    }
+}
+
+// Gives the frames of a generated scene or of the frame dump recorded on a real desktop (see
+// ScreenCapturerWrapper). The dump is played in a loop.
+class PipelineFrameSource
+{
+public:
+    explicit PipelineFrameSource(int64_t scene)
+    {
+        if (scene != kRecordedScene)
+        {
+            generated_ = std::make_unique<BenchmarkFrameSource>(
+                static_cast<BenchmarkFrameSource::Scene>(scene), kFrameSize);
+            return;
+        }
+
+        std::string dump_file;
+        if (Environment::get("ASPIA_FRAME_REPLAY", &dump_file) && !dump_file.empty())
+            recorded_ = FrameDumpReader::open(std::filesystem::u8path(dump_file));
+    }
+
+    bool isValid() const { return generated_ || recorded_; }
+
+    // The frames without changes are skipped, the host does not encode them.
+    const Frame* nextFrame()
+    {
+        if (generated_)
+            return generated_->nextFrame();
+
+        for (bool rewound = false;;)
+        {
+            const Frame* frame = recorded_->nextFrame();
+            if (!frame)
+            {
+                if (rewound || !recorded_->rewind())
+                    return nullptr;
+
+                rewound = true;
+                continue;
+            }
+
+            if (!frame->constUpdatedRegion().isEmpty())
+                return frame;
+        }
+    }
+
+private:
+    std::unique_ptr<BenchmarkFrameSource> generated_;
+    std::unique_ptr<FrameDumpReader> recorded_;
+};
+
+// Encodes the frames, passes the packets through the data path of NetworkChannel (serialization
+// and encryption) and decodes them, one frame at a time and as fast as possible. Reports the
+// throughput, the size of the packets and the latency of a frame. range(0) is the encoding,
+// range(1) is the scene or kRecordedScene.
+void BM_VideoPipeline(benchmark::State& state)
+{
+    const proto::VideoEncoding encoding = static_cast<proto::VideoEncoding>(state.range(0));
+    const int64_t scene = state.range(1);
+
+    PipelineFrameSource source(scene);
+    if (!source.isValid())
+    {
+        state.SkipWithError("No frame dump, set ASPIA_FRAME_REPLAY");
+        return;
+    }
+
+    std::unique_ptr<VideoEncoder> encoder = createEncoder(encoding);
+    std::unique_ptr<VideoDecoder> decoder = VideoDecoder::create(encoding);
+    std::unique_ptr<MessageEncryptor> encryptor =
+        MessageEncryptorOpenssl::createForChaCha20Poly1305(kKey, kIv);
+    std::unique_ptr<MessageDecryptor> decryptor =
+        MessageDecryptorOpenssl::createForChaCha20Poly1305(kKey, kIv);
+    if (!encoder || !decoder || !encryptor || !decryptor)
+    {
+        state.SkipWithError("Unable to create pipeline");
+        return;
+    }
+
+    proto::VideoPacket packet;
+    proto::VideoPacket received_packet;
+    ByteArray message;
+    ByteArray encrypted;
+    ByteArray decrypted;
+    std::unique_ptr<FrameSimple> decoded_frame;
+
+    std::vector<double> latencies;
+    int64_t packet_bytes = 0;
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        const Frame* frame = source.nextFrame();
+        state.ResumeTiming();
+
+        if (!frame)
+        {
+            state.SkipWithError("Unable to read frame");
+            break;
+        }
+
+        const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+        packet.Clear();
+        encoder->encode(frame, &packet);
+
+        message.resize(packet.ByteSizeLong());
+        packet.SerializeWithCachedSizesToArray(message.data());
+
+        encrypted.resize(encryptor->encryptedDataSize(message.size()));
+        decrypted.resize(decryptor->decryptedDataSize(encrypted.size()));
+
+        if (!encryptor->encrypt(message.data(), message.size(), encrypted.data()) ||
+            !decryptor->decrypt(encrypted.data(), encrypted.size(), decrypted.data()) ||
+            !received_packet.ParseFromArray(decrypted.data(), static_cast<int>(decrypted.size())))
+        {
+            state.SkipWithError("Unable to pass packet");
+            break;
+        }
+
+        if (received_packet.has_format())
+        {
+            const proto::Rect& video_rect = received_packet.format().video_rect();
+            decoded_frame = FrameSimple::create(
+                Size(video_rect.width(), video_rect.height()), PixelFormat::ARGB());
+        }
+
+        if (!decoded_frame || !decoder->decode(received_packet, decoded_frame.get()))
+        {
+            state.SkipWithError("Unable to decode packet");
+            break;
+        }
+
+        latencies.emplace_back(std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start_time).count());
+        packet_bytes += static_cast<int64_t>(encrypted.size());
+    }
+
+    if (latencies.empty())
+        return;
+
+    std::sort(latencies.begin(), latencies.end());
+
+    auto percentile = [&latencies](size_t percent)
+    {
+        return latencies[std::min(latencies.size() - 1, latencies.size() * percent / 100)];
+    };
+
+    state.SetLabel(std::string(encodingName(encoding)) + '/' +
+                   (scene == kRecordedScene ? "recorded" : BenchmarkFrameSource::sceneName(
+                       static_cast<BenchmarkFrameSource::Scene>(scene))));
+
+    state.counters["frames"] =
+        benchmark::Counter(static_cast<double>(latencies.size()), benchmark::Counter::kIsRate);
+    state.counters["bits"] =
+        benchmark::Counter(static_cast<double>(packet_bytes) * 8, benchmark::Counter::kIsRate,
+                           benchmark::Counter::kIs1000);
+    state.counters["packet_bytes"] =
+        benchmark::Counter(static_cast<double>(packet_bytes), benchmark::Counter::kAvgIterations);
+    state.counters["latency_p50_us"] = percentile(50);
+    state.counters["latency_p99_us"] = percentile(99);
+}
+
+BENCHMARK(BM_VideoPipeline)
+    ->ArgsProduct({ { proto::VIDEO_ENCODING_ZSTD,
+                      proto::VIDEO_ENCODING_VP8,
+                      proto::VIDEO_ENCODING_VP9 },
+                    { kRecordedScene,
+                      static_cast<int64_t>(BenchmarkFrameSource::Scene::OFFICE),
+                      static_cast<int64_t>(BenchmarkFrameSource::Scene::VIDEO),
+                      static_cast<int64_t>(BenchmarkFrameSource::Scene::SCROLLING) } })
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+} // namespace
+
+} // namespace base
@@ -27,6 +27,15 @@
 
 namespace base {
 
+namespace {
+
+// Clusters are written to the file when they are complete. Short clusters keep the most of the
+// recording readable if the application is terminated before the file is finalized.
+const uint64_t kMaxClusterDuration = 5ULL * 1000 * 1000 * 1000; // 5 seconds in nanoseconds.
+const uint64_t kMaxClusterSize = 8 * 1024 * 1024;
+
+} // namespace
+
 WebmFileMuxer::WebmFileMuxer() = default;
 
 WebmFileMuxer::~WebmFileMuxer() = default;
@@ -48,6 +57,8 @@ bool WebmFileMuxer::init(FILE* file)
     }
 
     segment_->set_mode(mkvmuxer::Segment::kFile);
+    segment_->set_max_cluster_duration(kMaxClusterDuration);
+    segment_->set_max_cluster_size(kMaxClusterSize);
 
     // Set segment info fields.
     mkvmuxer::SegmentInfo* const segment_info = segment_->GetSegmentInfo();
@@ -141,6 +152,14 @@ bool WebmFileMuxer::finalize()
     return true;
 }
 
+int64_t WebmFileMuxer::fileSize() const
+{
+    if (!writer_)
+        return 0;
+
+    return writer_->Position();
+}
+
 bool WebmFileMuxer::writeAudioFrame(std::string_view frame,
                                     const std::chrono::nanoseconds& timestamp)
 {
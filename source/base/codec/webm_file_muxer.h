@@ -37,7 +37,7 @@ public:
     WebmFileMuxer();
     ~WebmFileMuxer();
 
-    // Initializes libwebm for muxing in live mode. Returns |true| when successful.
+    // Initializes libwebm for muxing in file mode. Returns |true| when successful.
     bool init(FILE* file);
 
     bool hasAudioTrack() const { return audio_track_num_ != 0; }
@@ -63,6 +63,9 @@ public:
                          const std::chrono::nanoseconds& timestamp,
                          bool is_key);
 
+    // Returns the number of bytes written to the file.
+    int64_t fileSize() const;
+
     // Accessors.
     bool initialized() const { return initialized_; }
 
@@ -23,11 +23,25 @@
 #include "base/codec/webm_file_muxer.h"
 #include "build/build_config.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 
 namespace base {
 
+namespace {
+
+// Long recordings are split into several files. The muxer keeps the index of the whole file in
+// memory until the file is finalized, and a file which was not finalized has no index.
+constexpr std::chrono::minutes kMaxFileDuration { 30 };
+constexpr int64_t kMaxFileSize = 1024LL * 1024 * 1024;
+
+// The data buffered by the C runtime is passed to the system at least this often.
+constexpr std::chrono::seconds kFlushInterval { 5 };
+constexpr size_t kFileBufferSize = 256 * 1024;
+
+} // namespace
+
 WebmFileWriter::WebmFileWriter(const std::filesystem::path& path, std::u16string_view name)
     : path_(path),
       name_(name)
@@ -40,33 +54,54 @@ WebmFileWriter::~WebmFileWriter()
     close();
 }
 
-void WebmFileWriter::addVideoPacket(const proto::VideoPacket& packet)
+void WebmFileWriter::addVideoPacket(const proto::VideoPacket& packet, TimePoint time)
 {
-    if (packet.encoding() != last_video_encoding_ || packet.has_format())
+    if (!isSupportedEncoding(packet.encoding()))
     {
+        // The caller has to re-encode the video.
         close();
+        return;
+    }
 
-        switch (packet.encoding())
+    if (packet.has_format())
+    {
+        Size video_size(packet.format().video_rect().width(),
+                        packet.format().video_rect().height());
+
+        if (packet.encoding() != last_video_encoding_ || video_size != last_video_size_)
         {
-            case proto::VIDEO_ENCODING_VP8:
-            case proto::VIDEO_ENCODING_VP9:
-                break;
+            close();
 
-            default:
-                LOG(LS_ERROR) << "Not supported video encoding";
-                return;
+            last_video_encoding_ = packet.encoding();
+            last_video_size_ = video_size;
         }
+    }
+    else if (packet.encoding() != last_video_encoding_)
+    {
+        // The frame size for the new encoding is not known yet.
+        close();
+        return;
+    }
 
-        last_video_encoding_ = packet.encoding();
+    const bool is_key_frame = isKeyFrame(packet);
 
-        if (!packet.has_format())
-            return;
+    if (muxer_ && is_key_frame && video_start_time_.has_value())
+    {
+        // A new file also starts with a key frame.
+        if (time - *video_start_time_ >= kMaxFileDuration ||
+            muxer_->fileSize() >= kMaxFileSize)
+        {
+            LOG(LS_INFO) << "Maximum file duration or size reached";
+            close();
+        }
     }
 
-    bool is_key_frame = false;
-
-    if (packet.has_format())
+    if (!muxer_)
     {
+        // A file can only start with a key frame.
+        if (!is_key_frame || last_video_size_.isEmpty())
+            return;
+
         if (!init())
             return;
 
@@ -74,11 +109,11 @@ void WebmFileWriter::addVideoPacket(const proto::VideoPacket& packet)
         if (packet.encoding() == proto::VIDEO_ENCODING_VP9)
             video_codec_id = mkvmuxer::Tracks::kVp9CodecId;
 
-        if (!muxer_->addVideoTrack(packet.format().video_rect().width(),
-                                   packet.format().video_rect().height(),
+        if (!muxer_->addVideoTrack(last_video_size_.width(), last_video_size_.height(),
                                    video_codec_id))
         {
             LOG(LS_ERROR) << "WebmFileMuxer::addVideoTrack failed";
+            close();
             return;
         }
 
@@ -87,35 +122,32 @@ void WebmFileWriter::addVideoPacket(const proto::VideoPacket& packet)
                                    mkvmuxer::Tracks::kOpusCodecId))
         {
             LOG(LS_ERROR) << "WebmFileMuxer::addAudioTrack failed";
+            close();
             return;
         }
-
-        is_key_frame = true;
     }
 
-    if (!muxer_)
-        return;
-
     DCHECK(muxer_->hasVideoTrack());
     DCHECK(muxer_->hasAudioTrack());
 
-    TimePoint current = Clock::now();
-    NanoSeconds timestamp;
+    if (!video_start_time_.has_value())
+        video_start_time_.emplace(time);
 
-    if (video_start_time_.has_value())
-    {
-        timestamp = std::chrono::duration_cast<NanoSeconds>(current - *video_start_time_);
-    }
-    else
-    {
-        video_start_time_.emplace(current);
-        timestamp = NanoSeconds(0);
-    }
+    // The packets written from different threads may come slightly out of order.
+    const NanoSeconds timestamp =
+        std::max(std::chrono::duration_cast<NanoSeconds>(time - *video_start_time_),
+                 NanoSeconds(0));
 
     muxer_->writeVideoFrame(packet.data(), timestamp, is_key_frame);
+
+    if (time - last_flush_time_ >= kFlushInterval)
+    {
+        fflush(file_);
+        last_flush_time_ = time;
+    }
 }
 
-void WebmFileWriter::addAudioPacket(const proto::AudioPacket& packet)
+void WebmFileWriter::addAudioPacket(const proto::AudioPacket& packet, TimePoint time)
 {
     if (packet.encoding() != proto::AUDIO_ENCODING_OPUS ||
         packet.channels() != proto::AudioPacket::CHANNELS_STEREO ||
@@ -125,27 +157,62 @@ void WebmFileWriter::addAudioPacket(const proto::AudioPacket& packet)
         return;
     }
 
-    if (!muxer_ || !muxer_->hasAudioTrack())
+    // Audio is written only after the first video frame of the file.
+    if (!muxer_ || !muxer_->hasAudioTrack() || !video_start_time_.has_value())
         return;
 
+    const NanoSeconds timestamp =
+        std::max(std::chrono::duration_cast<NanoSeconds>(time - *video_start_time_),
+                 NanoSeconds(0));
+
     for (int i = 0; i < packet.data_size(); ++i)
+        muxer_->writeAudioFrame(packet.data(i), timestamp);
+}
+
+// static
+bool WebmFileWriter::isSupportedEncoding(proto::VideoEncoding encoding)
+{
+    return encoding == proto::VIDEO_ENCODING_VP8 || encoding == proto::VIDEO_ENCODING_VP9;
+}
+
+// static
+bool WebmFileWriter::isKeyFrame(const proto::VideoPacket& packet)
+{
+    const std::string& data = packet.data();
+    if (data.empty())
+        return false;
+
+    const uint8_t first_byte = static_cast<uint8_t>(data[0]);
+
+    if (packet.encoding() == proto::VIDEO_ENCODING_VP8)
     {
-        TimePoint current = Clock::now();
-        NanoSeconds timestamp;
+        // The first bit of the frame tag is 0 for key frames (RFC 6386, 9.1).
+        return (first_byte & 0x01) == 0;
+    }
 
-        if (video_start_time_.has_value())
-        {
-            timestamp = std::chrono::duration_cast<NanoSeconds>(
-                current - *video_start_time_);
-        }
-        else
-        {
-            video_start_time_.emplace(current);
-            timestamp = NanoSeconds(0);
-        }
+    if (packet.encoding() == proto::VIDEO_ENCODING_VP9)
+    {
+        // Uncompressed header: frame_marker (2 bits), profile_low_bit, profile_high_bit,
+        // reserved_zero (profile 3 only), show_existing_frame, frame_type (0 for key frames).
+        int bit = 7;
+        auto read_bit = [&]() { return (first_byte >> bit--) & 0x01; };
 
-        muxer_->writeAudioFrame(packet.data(i), timestamp);
+        const int frame_marker = (read_bit() << 1) | read_bit();
+        if (frame_marker != 2)
+            return false;
+
+        const int profile = read_bit() | (read_bit() << 1);
+        if (profile == 3)
+            read_bit();
+
+        const int show_existing_frame = read_bit();
+        if (show_existing_frame)
+            return false;
+
+        return read_bit() == 0;
     }
+
+    return false;
 }
 
 bool WebmFileWriter::init()
@@ -183,6 +250,10 @@ bool WebmFileWriter::init()
         return false;
     }
 
+    // Frames are small and written one by one.
+    setvbuf(file_, nullptr, _IOFBF, kFileBufferSize);
+    last_flush_time_ = Clock::now();
+
     muxer_ = std::make_unique<WebmFileMuxer>();
     if (!muxer_->init(file_))
     {
@@ -197,9 +268,7 @@ bool WebmFileWriter::init()
 
 void WebmFileWriter::close()
 {
-    last_video_encoding_ = proto::VIDEO_ENCODING_UNKNOWN;
     video_start_time_.reset();
-    audio_start_time_.reset();
 
     if (muxer_)
     {
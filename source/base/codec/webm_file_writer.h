@@ -34,14 +34,27 @@ namespace base {
 
 class WebmFileMuxer;
 
+// Writes VP8 or VP9 video packets and Opus audio packets to WebM files. The packets may come
+// directly from the host: a file is started with a key frame and continues across the following
+// key frames until the encoding or the frame size changes.
 class WebmFileWriter
 {
 public:
+    using Clock = std::chrono::high_resolution_clock;
+    using TimePoint = std::chrono::time_point<Clock>;
+
     WebmFileWriter(const std::filesystem::path& path, std::u16string_view name);
     ~WebmFileWriter();
 
-    void addVideoPacket(const proto::VideoPacket& packet);
-    void addAudioPacket(const proto::AudioPacket& packet);
+    // |time| is the moment when the packet was received or encoded.
+    void addVideoPacket(const proto::VideoPacket& packet, TimePoint time);
+    void addAudioPacket(const proto::AudioPacket& packet, TimePoint time);
+
+    // Returns true if the packet can be written as is.
+    static bool isSupportedEncoding(proto::VideoEncoding encoding);
+
+    // Returns true if the packet contains a VP8 or VP9 key frame.
+    static bool isKeyFrame(const proto::VideoPacket& packet);
 
 private:
     bool init();
@@ -52,15 +65,14 @@ private:
     int file_counter_ = 0;
     FILE* file_ = nullptr;
 
-    using Clock = std::chrono::high_resolution_clock;
-    using TimePoint = std::chrono::time_point<Clock>;
     using NanoSeconds = std::chrono::nanoseconds;
 
     std::unique_ptr<WebmFileMuxer> muxer_;
     std::optional<TimePoint> video_start_time_;
-    std::optional<TimePoint> audio_start_time_;
+    TimePoint last_flush_time_;
 
     proto::VideoEncoding last_video_encoding_ = proto::VIDEO_ENCODING_UNKNOWN;
+    Size last_video_size_;
 
     DISALLOW_COPY_AND_ASSIGN(WebmFileWriter);
 };
@@ -0,0 +1,156 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/codec/zstd_dictionary.h"
+
+#include "base/logging.h"
+#include "base/codec/pixel_translator.h"
+
+#include <vector>
+
+namespace base {
+
+namespace {
+
+// Window and document backgrounds of Windows, macOS, GNOME and popular editors. Offsets to the
+// end of the dictionary are the shortest, so the most common colors go last.
+const uint32_t kBackgroundColors[] =
+{
+    0xFF000000, 0xFF2B2B2B, 0xFF242424, 0xFF1E1E1E, 0xFF202020,
+    0xFFECECEC, 0xFFFAFAFA, 0xFFF0F0F0, 0xFFF3F3F3, 0xFFFFFFFF
+};
+
+// Text, selection and accent colors.
+const uint32_t kForegroundColors[] =
+{
+    0xFF0078D7, 0xFF3584E4, 0xFFCCCCCC, 0xFFE4E4E4, 0xFFFFFFFF,
+    0xFF333333, 0xFF1A1A1A, 0xFF202020, 0xFF000000
+};
+
+const int kRunLength = 64;
+const int kGradientSteps = 16;
+
+// Order of the de Bruijn sequence. It contains every combination of the background and the
+// foreground pixels of this length, which is longer than the minimal match of zstd.
+const int kSequenceOrder = 6;
+
+uint32_t blend(uint32_t from, uint32_t to, int step, int steps)
+{
+    uint32_t result = 0xFF000000;
+
+    for (int shift = 0; shift < 24; shift += 8)
+    {
+        const int a = static_cast<int>((from >> shift) & 0xFF);
+        const int b = static_cast<int>((to >> shift) & 0xFF);
+
+        result |= static_cast<uint32_t>(a + (b - a) * step / steps) << shift;
+    }
+
+    return result;
+}
+
+// Binary de Bruijn sequence B(2, n) by the FKM algorithm.
+void deBruijn(int t, int p, int n, std::vector<int>* a, std::vector<int>* sequence)
+{
+    if (t > n)
+    {
+        if (n % p == 0)
+            sequence->insert(sequence->end(), a->begin() + 1, a->begin() + p + 1);
+        return;
+    }
+
+    (*a)[static_cast<size_t>(t)] = (*a)[static_cast<size_t>(t - p)];
+    deBruijn(t + 1, p, n, a, sequence);
+
+    for (int j = (*a)[static_cast<size_t>(t - p)] + 1; j < 2; ++j)
+    {
+        (*a)[static_cast<size_t>(t)] = j;
+        deBruijn(t + 1, t, n, a, sequence);
+    }
+}
+
+std::vector<uint32_t> createUiPixels()
+{
+    std::vector<int> a(kSequenceOrder + 1, 0);
+    std::vector<int> sequence;
+    deBruijn(1, 1, kSequenceOrder, &a, &sequence);
+
+    std::vector<uint32_t> pixels;
+
+    for (uint32_t background : kBackgroundColors)
+    {
+        // Empty areas of the windows.
+        pixels.insert(pixels.end(), kRunLength, background);
+
+        for (uint32_t foreground : kForegroundColors)
+        {
+            if (foreground == background)
+                continue;
+
+            // Thin lines of glyphs.
+            for (int bit : sequence)
+                pixels.emplace_back(bit ? foreground : background);
+
+            // Anti-aliased edges.
+            for (int step = 0; step <= kGradientSteps; ++step)
+                pixels.emplace_back(blend(background, foreground, step, kGradientSteps));
+        }
+    }
+
+    return pixels;
+}
+
+} // namespace
+
+std::string createZstdDictionary(uint32_t id, const PixelFormat& format)
+{
+    std::vector<uint32_t> pixels;
+
+    switch (id)
+    {
+        case ZSTD_DICTIONARY_UI:
+            pixels = createUiPixels();
+            break;
+
+        default:
+            return std::string();
+    }
+
+    std::unique_ptr<PixelTranslator> translator =
+        PixelTranslator::create(PixelFormat::ARGB(), format);
+    if (!translator)
+    {
+        LOG(LS_WARNING) << "Unsupported pixel format";
+        return std::string();
+    }
+
+    const int width = static_cast<int>(pixels.size());
+
+    std::string content;
+    content.resize(pixels.size() * format.bytesPerPixel());
+
+    translator->translate(reinterpret_cast<const uint8_t*>(pixels.data()),
+                          width * static_cast<int>(sizeof(uint32_t)),
+                          reinterpret_cast<uint8_t*>(content.data()),
+                          width * format.bytesPerPixel(),
+                          width,
+                          1);
+    return content;
+}
+
+} // namespace base
@@ -0,0 +1,45 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CODEC__ZSTD_DICTIONARY_H
+#define BASE__CODEC__ZSTD_DICTIONARY_H
+
+#include "base/desktop/pixel_format.h"
+
+#include <cstdint>
+#include <string>
+
+namespace base {
+
+// Identifiers of the dictionaries for the ZSTD video codec (see proto::VideoPacketFormat).
+enum ZstdDictionary : uint32_t
+{
+    ZSTD_DICTIONARY_NONE = 0,
+
+    // Backgrounds, text and anti-aliasing of the common light and dark UI themes.
+    ZSTD_DICTIONARY_UI = 1
+};
+
+// Creates the content of the dictionary in the pixel format of the compressed data. The encoder
+// and the decoder create the same content, so the dictionary is not sent. Returns an empty string
+// for an unknown identifier.
+std::string createZstdDictionary(uint32_t id, const PixelFormat& format);
+
+} // namespace base
+
+#endif // BASE__CODEC__ZSTD_DICTIONARY_H
@@ -79,6 +79,19 @@ bool CpuidUtil::hasAesNi()
     return BitSet<uint32_t>(CpuidUtil(1).ecx()).test(25);
 }
 
+// static
+bool CpuidUtil::hasPclmul()
+{
+    // Check if function 1 is supported.
+    if (CpuidUtil(0).eax() < 1)
+        return false;
+
+    // Bit 1 of register ECX indicates the support of PCLMULQDQ instruction, bit 19 indicates the
+    // support of SSE4.1.
+    const BitSet<uint32_t> ecx(CpuidUtil(1).ecx());
+    return ecx.test(1) && ecx.test(19);
+}
+
 } // namespace base
 
 #endif // defined(ARCH_CPU_X86_FAMILY)
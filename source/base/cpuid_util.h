@@ -48,6 +48,7 @@ public:
     uint32_t edx() const { return edx_; }
 
     static bool hasAesNi();
+    static bool hasPclmul();
 
 private:
     uint32_t eax_ = 0;
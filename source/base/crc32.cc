@@ -18,6 +18,22 @@
 
 #include "base/crc32.h"
 
+#include "build/build_config.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include "base/cpuid_util.h"
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+#if defined(ARCH_CPU_ARM64) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif // defined(ARCH_CPU_ARM64) && defined(__ARM_FEATURE_CRC32)
+
 namespace base {
 
 // Static table of checksums for all possible 8 bit bytes.
@@ -77,6 +93,211 @@ const uint32_t kCrcTable[256] =
     0x2d02ef8dL,
 };
 
+namespace {
+
+using SliceTables = std::array<std::array<uint32_t, 256>, 8>;
+
+// Tables for the slice-by-8 algorithm. The first table is the same as |kCrcTable|, each next
+// table continues the previous one by one zero byte.
+constexpr SliceTables makeSliceTables()
+{
+    SliceTables tables = {};
+
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t checksum = i;
+        for (int j = 0; j < 8; ++j)
+            checksum = (checksum & 1) ? (0xEDB88320 ^ (checksum >> 1)) : (checksum >> 1);
+
+        tables[0][i] = checksum;
+    }
+
+    for (size_t k = 1; k < tables.size(); ++k)
+    {
+        for (size_t i = 0; i < 256; ++i)
+            tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFF];
+    }
+
+    return tables;
+}
+
+constexpr SliceTables kSliceTables = makeSliceTables();
+
+uint32_t crc32Bytes(uint32_t sum, const uint8_t* bytes, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+        sum = kCrcTable[(sum & 0x000000FF) ^ bytes[i]] ^ (sum >> 8);
+
+    return sum;
+}
+
+uint32_t crc32Slice8(uint32_t sum, const uint8_t* bytes, size_t size)
+{
+#if defined(ARCH_CPU_LITTLE_ENDIAN)
+    const SliceTables& t = kSliceTables;
+
+    while (size >= 8)
+    {
+        uint32_t low;
+        uint32_t high;
+
+        memcpy(&low, bytes, sizeof(low));
+        memcpy(&high, bytes + sizeof(low), sizeof(high));
+
+        low ^= sum;
+
+        sum = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^
+              t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+              t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^
+              t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+
+        bytes += 8;
+        size -= 8;
+    }
+#endif // defined(ARCH_CPU_LITTLE_ENDIAN)
+
+    return crc32Bytes(sum, bytes, size);
+}
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+#if defined(CC_GCC)
+#define TARGET_PCLMUL __attribute__((target("pclmul,sse4.1")))
+#else
+#define TARGET_PCLMUL
+#endif
+
+// Folding of 64-byte blocks with carry-less multiplication and Barrett reduction to 32 bits, as
+// described in the Intel paper "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+// Instruction". |size| must be at least 64 and a multiple of 16.
+TARGET_PCLMUL uint32_t crc32Pclmul(uint32_t sum, const uint8_t* bytes, size_t size)
+{
+    alignas(16) static const uint64_t k1k2[] = { 0x0154442BD4, 0x01C6E41596 };
+    alignas(16) static const uint64_t k3k4[] = { 0x01751997D0, 0x00CCAA009E };
+    alignas(16) static const uint64_t k5k0[] = { 0x0163CD6124, 0x0000000000 };
+    alignas(16) static const uint64_t poly[] = { 0x01DB710641, 0x01F7011641 };
+
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 0x00));
+    x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 0x10));
+    x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 0x20));
+    x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 0x30));
+
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(sum)));
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+
+    bytes += 64;
+    size -= 64;
+
+    // Fold 64-byte blocks.
+    while (size >= 64)
+    {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6),
+                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7),
+                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8),
+                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 0x30)));
+
+        bytes += 64;
+        size -= 64;
+    }
+
+    // Fold into 128 bits.
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // Fold the remaining 16-byte blocks.
+    while (size >= 16)
+    {
+        x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+        bytes += 16;
+        size -= 16;
+    }
+
+    // Fold 128 bits to 64 bits.
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+
+    x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits.
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+}
+
+#undef TARGET_PCLMUL
+
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+#if defined(ARCH_CPU_ARM64) && defined(__ARM_FEATURE_CRC32)
+
+uint32_t crc32Arm(uint32_t sum, const uint8_t* bytes, size_t size)
+{
+    while (size >= sizeof(uint64_t))
+    {
+        uint64_t value;
+        memcpy(&value, bytes, sizeof(value));
+
+        sum = __crc32d(sum, value);
+
+        bytes += sizeof(uint64_t);
+        size -= sizeof(uint64_t);
+    }
+
+    while (size--)
+        sum = __crc32b(sum, *bytes++);
+
+    return sum;
+}
+
+#endif // defined(ARCH_CPU_ARM64) && defined(__ARM_FEATURE_CRC32)
+
+} // namespace
+
 // We generate the CRC-32 using the low order bits to select whether to XOR in the reversed
 // polynomial 0xEDB88320. This is nice and simple, and allows us to keep the quotient in a uint32_t.
 // Since we're not concerned about the nature of corruptions (i.e., we don't care about bit
@@ -84,14 +305,30 @@ const uint32_t kCrcTable[256] =
 // to get the CRC correct for big-endian vs little-ending calculations. All we need is a nice hash,
 // that tends to depend on all the bits of the sample, with very little chance of changes in one
 // place impacting changes in another place.
+//
+// The hardware implementations compute the same checksum: PCLMULQDQ on x86 (selected at runtime)
+// and the CRC32 instructions on ARMv8 (selected at compile time). Otherwise the slice-by-8
+// algorithm is used.
 uint32_t crc32(uint32_t sum, const void* data, size_t size)
 {
     const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
 
-    for (size_t i = 0; i < size; ++i)
-        sum = kCrcTable[(sum & 0x000000FF) ^ bytes[i]] ^ (sum >> 8);
+#if defined(ARCH_CPU_X86_FAMILY)
+    static const bool has_pclmul = CpuidUtil::hasPclmul();
 
-    return sum;
+    if (has_pclmul && size >= 64)
+    {
+        const size_t blocks_size = size & ~static_cast<size_t>(15);
+
+        sum = crc32Pclmul(sum, bytes, blocks_size);
+        bytes += blocks_size;
+        size -= blocks_size;
+    }
+#elif defined(ARCH_CPU_ARM64) && defined(__ARM_FEATURE_CRC32)
+    return crc32Arm(sum, bytes, size);
+#endif
+
+    return crc32Slice8(sum, bytes, size);
 }
 
 } // namespace base
@@ -18,6 +18,8 @@
 
 #include "base/crc32.h"
 
+#include <vector>
+
 #include <gtest/gtest.h>
 
 namespace base {
@@ -47,4 +49,26 @@ TEST(Crc32Test, ZeroTest)
     EXPECT_EQ(0U, crc32(0, nullptr, 0));
 }
 
+// The fast implementations must give the same result as the byte-at-a-time algorithm for any size
+// and alignment of the data.
+TEST(Crc32Test, SizeAndAlignmentTest)
+{
+    std::vector<uint8_t> data(1024 + 16);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 131 + 7);
+
+    for (size_t offset = 0; offset < 16; offset += 5)
+    {
+        for (size_t size = 0; size <= 1024; size += (size < 160) ? 1 : 37)
+        {
+            uint32_t expected = 0x12345678;
+            for (size_t i = 0; i < size; ++i)
+                expected = kCrcTable[(expected & 0xFF) ^ data[offset + i]] ^ (expected >> 8);
+
+            EXPECT_EQ(expected, crc32(0x12345678, data.data() + offset, size))
+                << "size: " << size << ", offset: " << offset;
+        }
+    }
+}
+
 } // namespace base
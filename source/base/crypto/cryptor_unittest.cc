@@ -21,6 +21,9 @@
 
 #include <gtest/gtest.h>
 
+#include <iterator>
+#include <vector>
+
 namespace base {
 
 void testVector(MessageEncryptor* client_encryptor, MessageDecryptor* client_decryptor,
@@ -106,6 +109,62 @@ void wrongKey(MessageEncryptor* client_encryptor, MessageDecryptor* host_decrypt
     ASSERT_FALSE(ret);
 }
 
+void inPlace(MessageEncryptor* encryptor, MessageDecryptor* decryptor)
+{
+    ByteArray message = fromHex(
+        "6006ee8029610876ec2facd5fc9ce6bd6dc03d4a5ddb4d6c28f2ff048d4f7eb7bcf5048c901a4adaa7fd");
+
+    const size_t overhead = encryptor->encryptedDataSize(message.size()) - message.size();
+
+    // The plain text is placed after the space for the overhead of the encryptor.
+    ByteArray buffer(overhead);
+    buffer.insert(buffer.end(), message.begin(), message.end());
+
+    bool ret = encryptor->encrypt(buffer.data() + overhead, message.size(), buffer.data());
+    ASSERT_TRUE(ret);
+
+    ASSERT_EQ(decryptor->decryptedDataSize(buffer.size()), message.size());
+
+    // The authentication tag is passed separately and the message is decrypted in place.
+    ByteArray header(buffer.begin(), buffer.begin() + overhead);
+    ByteArray decrypted_message(buffer.begin() + overhead, buffer.end());
+
+    ret = decryptor->decryptInPlace(
+        header.data(), decrypted_message.data(), decrypted_message.size());
+    ASSERT_TRUE(ret);
+    ASSERT_EQ(decrypted_message, message);
+}
+
+void batch(MessageEncryptor* batch_encryptor, MessageEncryptor* encryptor)
+{
+    const size_t kSizes[] = { 1, 16, 17, 100, 4096 };
+    const size_t kCount = std::size(kSizes);
+
+    std::vector<ByteArray> messages;
+    std::vector<ByteArray> batch_encrypted;
+    std::vector<MessageEncryptor::Message> batch_messages;
+
+    for (size_t i = 0; i < kCount; ++i)
+        messages.emplace_back(kSizes[i], static_cast<uint8_t>(i + 1));
+
+    for (size_t i = 0; i < kCount; ++i)
+    {
+        batch_encrypted.emplace_back(batch_encryptor->encryptedDataSize(messages[i].size()));
+        batch_messages.push_back(
+            { messages[i].data(), messages[i].size(), batch_encrypted[i].data() });
+    }
+
+    ASSERT_TRUE(batch_encryptor->encryptBatch(batch_messages.data(), batch_messages.size()));
+
+    // Each message of the batch uses the next IV, as with separate calls.
+    for (size_t i = 0; i < kCount; ++i)
+    {
+        ByteArray encrypted(encryptor->encryptedDataSize(messages[i].size()));
+        ASSERT_TRUE(encryptor->encrypt(messages[i].data(), messages[i].size(), encrypted.data()));
+        ASSERT_EQ(encrypted, batch_encrypted[i]);
+    }
+}
+
 TEST(CryptorAes256GcmTest, TestVector)
 {
     const ByteArray key =
@@ -162,6 +221,40 @@ TEST(CryptorAes256GcmTest, WrongKey)
     wrongKey(client_encryptor.get(), host_decryptor.get());
 }
 
+TEST(CryptorAes256GcmTest, InPlace)
+{
+    const ByteArray key =
+        fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+    const ByteArray iv = fromHex("ee7eb0e6fb24d445597f3e6f");
+
+    std::unique_ptr<MessageEncryptor> encryptor = MessageEncryptorOpenssl::createForAes256Gcm(key, iv);
+    ASSERT_NE(encryptor, nullptr);
+
+    std::unique_ptr<MessageDecryptor> decryptor = MessageDecryptorOpenssl::createForAes256Gcm(key, iv);
+    ASSERT_NE(decryptor, nullptr);
+
+    for (int i = 0; i < 10; ++i)
+        inPlace(encryptor.get(), decryptor.get());
+}
+
+TEST(CryptorAes256GcmTest, Batch)
+{
+    const ByteArray key =
+        fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+    const ByteArray iv = fromHex("ee7eb0e6fb24d445597f3e6f");
+
+    std::unique_ptr<MessageEncryptor> batch_encryptor =
+        MessageEncryptorOpenssl::createForAes256Gcm(key, iv);
+    ASSERT_NE(batch_encryptor, nullptr);
+
+    std::unique_ptr<MessageEncryptor> encryptor =
+        MessageEncryptorOpenssl::createForAes256Gcm(key, iv);
+    ASSERT_NE(encryptor, nullptr);
+
+    for (int i = 0; i < 3; ++i)
+        batch(batch_encryptor.get(), encryptor.get());
+}
+
 TEST(CryptorChaCha20Poly1305Test, TestVector)
 {
     const ByteArray key =
@@ -218,4 +311,38 @@ TEST(CryptorChaCha20Poly1305Test, WrongKey)
     wrongKey(client_encryptor.get(), host_decryptor.get());
 }
 
+TEST(CryptorChaCha20Poly1305Test, InPlace)
+{
+    const ByteArray key =
+        fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+    const ByteArray iv = fromHex("ee7eb0e6fb24d445597f3e6f");
+
+    std::unique_ptr<MessageEncryptor> encryptor = MessageEncryptorOpenssl::createForChaCha20Poly1305(key, iv);
+    ASSERT_NE(encryptor, nullptr);
+
+    std::unique_ptr<MessageDecryptor> decryptor = MessageDecryptorOpenssl::createForChaCha20Poly1305(key, iv);
+    ASSERT_NE(decryptor, nullptr);
+
+    for (int i = 0; i < 10; ++i)
+        inPlace(encryptor.get(), decryptor.get());
+}
+
+TEST(CryptorChaCha20Poly1305Test, Batch)
+{
+    const ByteArray key =
+        fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+    const ByteArray iv = fromHex("ee7eb0e6fb24d445597f3e6f");
+
+    std::unique_ptr<MessageEncryptor> batch_encryptor =
+        MessageEncryptorOpenssl::createForChaCha20Poly1305(key, iv);
+    ASSERT_NE(batch_encryptor, nullptr);
+
+    std::unique_ptr<MessageEncryptor> encryptor =
+        MessageEncryptorOpenssl::createForChaCha20Poly1305(key, iv);
+    ASSERT_NE(encryptor, nullptr);
+
+    for (int i = 0; i < 3; ++i)
+        batch(batch_encryptor.get(), encryptor.get());
+}
+
 } // namespace base
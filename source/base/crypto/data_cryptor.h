@@ -23,6 +23,8 @@
 
 namespace base {
 
+class SecureBuffer;
+
 class DataCryptor
 {
 public:
@@ -30,6 +32,10 @@ public:
 
     virtual bool encrypt(std::string_view in, std::string* out) = 0;
     virtual bool decrypt(std::string_view in, std::string* out) = 0;
+
+    // Decrypts into the locked memory of |out|. The decrypted data is not copied anywhere else
+    // and can be parsed directly from |out|.
+    virtual bool decrypt(std::string_view in, SecureBuffer* out) = 0;
 };
 
 } // namespace base
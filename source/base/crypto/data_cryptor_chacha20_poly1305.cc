@@ -21,6 +21,7 @@
 #include "base/logging.h"
 #include "base/crypto/openssl_util.h"
 #include "base/crypto/random.h"
+#include "base/crypto/secure_buffer.h"
 #include "base/crypto/secure_memory.h"
 
 #include <openssl/evp.h>
@@ -156,6 +157,39 @@ bool DataCryptorChaCha20Poly1305::decrypt(std::string_view in, std::string* out)
         return false;
     }
 
+    out->resize(in.size() - kHeaderSize);
+
+    if (!decryptTo(in, reinterpret_cast<uint8_t*>(out->data())))
+    {
+        memZero(out);
+        out->clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool DataCryptorChaCha20Poly1305::decrypt(std::string_view in, SecureBuffer* out)
+{
+    if (in.size() <= kHeaderSize)
+    {
+        LOG(LS_WARNING) << "Header missed";
+        return false;
+    }
+
+    out->resize(in.size() - kHeaderSize);
+
+    if (!decryptTo(in, out->data()))
+    {
+        out->clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool DataCryptorChaCha20Poly1305::decryptTo(std::string_view in, uint8_t* out)
+{
     EVP_CIPHER_CTX_ptr cipher = createCipher(key_, in.data(), 0);
     if (!cipher)
     {
@@ -163,12 +197,10 @@ bool DataCryptorChaCha20Poly1305::decrypt(std::string_view in, std::string* out)
         return false;
     }
 
-    out->resize(in.size() - kHeaderSize);
-
     int length;
 
     if (EVP_DecryptUpdate(cipher.get(),
-                          reinterpret_cast<uint8_t*>(out->data()),
+                          out,
                           &length,
                           reinterpret_cast<const uint8_t*>(in.data()) + kHeaderSize,
                           static_cast<int>(in.size() - kHeaderSize)) != 1)
@@ -187,9 +219,7 @@ bool DataCryptorChaCha20Poly1305::decrypt(std::string_view in, std::string* out)
         return false;
     }
 
-    if (EVP_DecryptFinal_ex(cipher.get(),
-                            reinterpret_cast<uint8_t*>(out->data()) + length,
-                            &length) <= 0)
+    if (EVP_DecryptFinal_ex(cipher.get(), out + length, &length) <= 0)
     {
         LOG(LS_WARNING) << "EVP_DecryptFinal_ex failed";
         return false;
@@ -32,8 +32,11 @@ public:
 
     bool encrypt(std::string_view in, std::string* out) override;
     bool decrypt(std::string_view in, std::string* out) override;
+    bool decrypt(std::string_view in, SecureBuffer* out) override;
 
 private:
+    bool decryptTo(std::string_view in, uint8_t* out);
+
     std::string key_;
 
     DISALLOW_COPY_AND_ASSIGN(DataCryptorChaCha20Poly1305);
@@ -18,6 +18,8 @@
 
 #include "base/crypto/data_cryptor_fake.h"
 
+#include "base/crypto/secure_buffer.h"
+
 namespace base {
 
 namespace {
@@ -40,4 +42,10 @@ bool DataCryptorFake::decrypt(std::string_view in, std::string* out)
     return copyUnchangedData(in, out);
 }
 
+bool DataCryptorFake::decrypt(std::string_view in, SecureBuffer* out)
+{
+    *out = SecureBuffer(in);
+    return true;
+}
+
 } // namespace base
@@ -32,6 +32,7 @@ public:
 
     bool encrypt(std::string_view in, std::string* out) override;
     bool decrypt(std::string_view in, std::string* out) override;
+    bool decrypt(std::string_view in, SecureBuffer* out) override;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(DataCryptorFake);
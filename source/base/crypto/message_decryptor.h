@@ -30,6 +30,11 @@ public:
 
     virtual size_t decryptedDataSize(size_t in_size) = 0;
     virtual bool decrypt(const void* in, size_t in_size, void* out) = 0;
+
+    // Decrypts the message in place. |header| contains the first
+    // in_size - decryptedDataSize(in_size) bytes of the encrypted message (the authentication tag)
+    // and |data| contains the rest of it. The decrypted message replaces the contents of |data|.
+    virtual bool decryptInPlace(const void* header, void* data, size_t data_size) = 0;
 };
 
 } // namespace base
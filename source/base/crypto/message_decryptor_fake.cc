@@ -37,4 +37,11 @@ bool MessageDecryptorFake::decrypt(const void* in, size_t in_size, void* out)
     return true;
 }
 
+bool MessageDecryptorFake::decryptInPlace(
+    const void* /* header */, void* /* data */, size_t /* data_size */)
+{
+    // The message is not encrypted and has no header.
+    return true;
+}
+
 } // namespace base
@@ -126,4 +126,38 @@ bool MessageDecryptorOpenssl::decrypt(const void* in, size_t in_size, void* out)
     return true;
 }
 
+bool MessageDecryptorOpenssl::decryptInPlace(const void* header, void* data, size_t data_size)
+{
+    if (EVP_DecryptInit_ex(ctx_.get(), nullptr, nullptr, nullptr, iv_.data()) != 1)
+    {
+        LOG(LS_WARNING) << "EVP_DecryptInit_ex failed";
+        return false;
+    }
+
+    uint8_t* buffer = reinterpret_cast<uint8_t*>(data);
+    int length;
+
+    if (EVP_DecryptUpdate(ctx_.get(), buffer, &length, buffer, static_cast<int>(data_size)) != 1)
+    {
+        LOG(LS_WARNING) << "EVP_DecryptUpdate failed";
+        return false;
+    }
+
+    if (EVP_CIPHER_CTX_ctrl(ctx_.get(), EVP_CTRL_AEAD_SET_TAG, kTagSize,
+                            const_cast<void*>(header)) != 1)
+    {
+        LOG(LS_WARNING) << "EVP_CIPHER_CTX_ctrl failed";
+        return false;
+    }
+
+    if (EVP_DecryptFinal_ex(ctx_.get(), buffer + length, &length) <= 0)
+    {
+        LOG(LS_WARNING) << "EVP_DecryptFinal_ex failed";
+        return false;
+    }
+
+    largeNumberIncrement(&iv_);
+    return true;
+}
+
 } // namespace base
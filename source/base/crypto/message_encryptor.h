@@ -29,7 +29,31 @@ public:
     virtual ~MessageEncryptor() = default;
 
     virtual size_t encryptedDataSize(size_t in_size) = 0;
+
+    // Encrypts |in| into |out|. The message can be encrypted in place: |in| may point into the
+    // |out| buffer at the offset of encryptedDataSize(in_size) - in_size bytes.
     virtual bool encrypt(const void* in, size_t in_size, void* out) = 0;
+
+    struct Message
+    {
+        const void* in;
+        size_t in_size;
+        void* out;
+    };
+
+    // Encrypts |count| messages in the order of the array. The result is the same as calling
+    // encrypt() for each message, but implementations can avoid the per-call overhead.
+    // Returns false if encryption of any message failed.
+    virtual bool encryptBatch(const Message* messages, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (!encrypt(messages[i].in, messages[i].in_size, messages[i].out))
+                return false;
+        }
+
+        return true;
+    }
 };
 
 } // namespace base
@@ -0,0 +1,123 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/crypto/message_encryptor_openssl.h"
+#include "base/memory/byte_array.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace base {
+
+namespace {
+
+const ByteArray kKey = fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+const ByteArray kIv = fromHex("ee7eb0e6fb24d445597f3e6f");
+
+// range(0) is the message size.
+template <std::unique_ptr<MessageEncryptor> (*CreateFunc)(const ByteArray&, const ByteArray&)>
+void BM_MessageEncrypt(benchmark::State& state)
+{
+    std::unique_ptr<MessageEncryptor> encryptor = CreateFunc(kKey, kIv);
+    if (!encryptor)
+    {
+        state.SkipWithError("Unable to create encryptor");
+        return;
+    }
+
+    const size_t message_size = static_cast<size_t>(state.range(0));
+    std::vector<uint8_t> message(message_size, 0x5A);
+    std::vector<uint8_t> encrypted(encryptor->encryptedDataSize(message_size));
+
+    for (auto _ : state)
+    {
+        if (!encryptor->encrypt(message.data(), message.size(), encrypted.data()))
+        {
+            state.SkipWithError("Unable to encrypt message");
+            break;
+        }
+
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(message_size));
+}
+
+// Small messages (input, cursor, keep-alive) written together. range(0) is the number of
+// messages, each of them is 32 bytes.
+template <std::unique_ptr<MessageEncryptor> (*CreateFunc)(const ByteArray&, const ByteArray&)>
+void BM_MessageEncryptBatch(benchmark::State& state)
+{
+    const size_t kMessageSize = 32;
+
+    std::unique_ptr<MessageEncryptor> encryptor = CreateFunc(kKey, kIv);
+    if (!encryptor)
+    {
+        state.SkipWithError("Unable to create encryptor");
+        return;
+    }
+
+    const size_t count = static_cast<size_t>(state.range(0));
+    const size_t encrypted_size = encryptor->encryptedDataSize(kMessageSize);
+
+    std::vector<uint8_t> messages(count * kMessageSize, 0x5A);
+    std::vector<uint8_t> encrypted(count * encrypted_size);
+    std::vector<MessageEncryptor::Message> batch;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        batch.push_back(
+            { &messages[i * kMessageSize], kMessageSize, &encrypted[i * encrypted_size] });
+    }
+
+    for (auto _ : state)
+    {
+        if (!encryptor->encryptBatch(batch.data(), batch.size()))
+        {
+            state.SkipWithError("Unable to encrypt messages");
+            break;
+        }
+
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(count));
+}
+
+BENCHMARK_TEMPLATE(BM_MessageEncrypt, MessageEncryptorOpenssl::createForAes256Gcm)
+    ->RangeMultiplier(16)
+    ->Range(64, 1024 * 1024);
+
+BENCHMARK_TEMPLATE(BM_MessageEncrypt, MessageEncryptorOpenssl::createForChaCha20Poly1305)
+    ->RangeMultiplier(16)
+    ->Range(64, 1024 * 1024);
+
+BENCHMARK_TEMPLATE(BM_MessageEncryptBatch, MessageEncryptorOpenssl::createForAes256Gcm)
+    ->Arg(1)
+    ->Arg(64);
+
+BENCHMARK_TEMPLATE(BM_MessageEncryptBatch, MessageEncryptorOpenssl::createForChaCha20Poly1305)
+    ->Arg(1)
+    ->Arg(64);
+
+} // namespace
+
+} // namespace base
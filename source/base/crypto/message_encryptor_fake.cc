@@ -33,7 +33,7 @@ size_t MessageEncryptorFake::encryptedDataSize(size_t in_size)
 
 bool MessageEncryptorFake::encrypt(const void* in, size_t in_size, void* out)
 {
-    memcpy(out, in, in_size);
+    memmove(out, in, in_size);
     return true;
 }
 
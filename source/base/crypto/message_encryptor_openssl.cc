@@ -92,7 +92,34 @@ size_t MessageEncryptorOpenssl::encryptedDataSize(size_t in_size)
 
 bool MessageEncryptorOpenssl::encrypt(const void* in, size_t in_size, void* out)
 {
-    if (EVP_EncryptInit_ex(ctx_.get(), nullptr, nullptr, nullptr, iv_.data()) != 1)
+    return encryptMessage(reinterpret_cast<const uint8_t*>(in), in_size,
+                          reinterpret_cast<uint8_t*>(out));
+}
+
+bool MessageEncryptorOpenssl::encryptBatch(const Message* messages, size_t count)
+{
+    // OpenSSL has no multi-buffer AEAD for these ciphers. The key schedule stays in the context,
+    // only the IV changes between the messages.
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Message& message = messages[i];
+
+        if (!encryptMessage(reinterpret_cast<const uint8_t*>(message.in), message.in_size,
+                            reinterpret_cast<uint8_t*>(message.out)))
+        {
+            LOG(LS_WARNING) << "Encryption of message " << i << " of " << count << " failed";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool MessageEncryptorOpenssl::encryptMessage(const uint8_t* in, size_t in_size, uint8_t* out)
+{
+    EVP_CIPHER_CTX* ctx = ctx_.get();
+
+    if (EVP_EncryptInit_ex(ctx, nullptr, nullptr, nullptr, iv_.data()) != 1)
     {
         LOG(LS_WARNING) << "EVP_EncryptInit_ex failed";
         return false;
@@ -100,23 +127,19 @@ bool MessageEncryptorOpenssl::encrypt(const void* in, size_t in_size, void* out)
 
     int length;
 
-    if (EVP_EncryptUpdate(ctx_.get(),
-                          reinterpret_cast<uint8_t*>(out) + kTagSize, &length,
-                          reinterpret_cast<const uint8_t*>(in), static_cast<int>(in_size)) != 1)
+    if (EVP_EncryptUpdate(ctx, out + kTagSize, &length, in, static_cast<int>(in_size)) != 1)
     {
         LOG(LS_WARNING) << "EVP_EncryptUpdate failed";
         return false;
     }
 
-    if (EVP_EncryptFinal_ex(ctx_.get(),
-                            reinterpret_cast<uint8_t*>(out) + kTagSize + length,
-                            &length) != 1)
+    if (EVP_EncryptFinal_ex(ctx, out + kTagSize + length, &length) != 1)
     {
         LOG(LS_WARNING) << "EVP_EncryptFinal_ex failed";
         return false;
     }
 
-    if (EVP_CIPHER_CTX_ctrl(ctx_.get(), EVP_CTRL_AEAD_GET_TAG, kTagSize, out) != 1)
+    if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, kTagSize, out) != 1)
     {
         LOG(LS_WARNING) << "EVP_CIPHER_CTX_ctrl failed";
         return false;
@@ -40,10 +40,13 @@ public:
     // MessageEncryptor implementation.
     size_t encryptedDataSize(size_t in_size) override;
     bool encrypt(const void* in, size_t in_size, void* out) override;
+    bool encryptBatch(const Message* messages, size_t count) override;
 
 private:
     MessageEncryptorOpenssl(EVP_CIPHER_CTX_ptr ctx, const ByteArray& iv);
 
+    bool encryptMessage(const uint8_t* in, size_t in_size, uint8_t* out);
+
     EVP_CIPHER_CTX_ptr ctx_;
     ByteArray iv_;
 
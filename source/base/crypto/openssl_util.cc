@@ -19,6 +19,16 @@
 #include "base/crypto/openssl_util.h"
 
 #include "base/logging.h"
+#include "build/build_config.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include "base/cpuid_util.h"
+#elif defined(ARCH_CPU_ARM64) && defined(OS_WIN)
+#include <Windows.h>
+#elif defined(ARCH_CPU_ARM64) && defined(OS_LINUX)
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
 
 #include <openssl/bn.h>
 #include <openssl/evp.h>
@@ -35,6 +45,11 @@ void BIGNUM_Deleter::operator()(bignum_st* bignum)
     BN_clear_free(bignum);
 }
 
+void BN_MONT_CTX_Deleter::operator()(bn_mont_ctx_st* mont_ctx)
+{
+    BN_MONT_CTX_free(mont_ctx);
+}
+
 void EVP_CIPHER_CTX_Deleter::operator()(evp_cipher_ctx_st* ctx)
 {
     EVP_CIPHER_CTX_cleanup(ctx);
@@ -125,4 +140,20 @@ EVP_CIPHER_CTX_ptr createCipher(CipherType type, CipherMode mode, const ByteArra
     return ctx;
 }
 
+bool hasHardwareAes()
+{
+#if defined(ARCH_CPU_X86_FAMILY)
+    return CpuidUtil::hasAesNi();
+#elif defined(ARCH_CPU_ARM64) && defined(OS_MAC)
+    // All ARM64 processors of Apple have the cryptography extension.
+    return true;
+#elif defined(ARCH_CPU_ARM64) && defined(OS_LINUX)
+    return (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+#elif defined(ARCH_CPU_ARM64) && defined(OS_WIN)
+    return IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE) != FALSE;
+#else
+    return false;
+#endif
+}
+
 } // namespace base
@@ -22,17 +22,25 @@
 
 #include <openssl/evp.h>
 
+#include <algorithm>
+
 namespace base {
 
 namespace {
 
 template <typename InputT, typename OutputT>
-OutputT hashT(PasswordHash::Type type, std::string_view password, InputT salt)
+OutputT hashT(PasswordHash::Type type, std::string_view password, InputT salt, uint32_t cost)
 {
     DCHECK_EQ(type, PasswordHash::Type::SCRYPT);
 
+    if (!PasswordHash::isValidCost(cost))
+    {
+        LOG(LS_ERROR) << "Invalid cost: " << cost;
+        return OutputT();
+    }
+
     // CPU/Memory cost parameter, must be larger than 1, a power of 2, and less than 2^(128 * r / 8).
-    static const uint64_t N = 16384;
+    const uint64_t N = cost;
 
     // Block size parameter.
     static const uint64_t r = 8;
@@ -41,8 +49,8 @@ OutputT hashT(PasswordHash::Type type, std::string_view password, InputT salt)
     // where hLen is 32 and MFlen is 128 * r.
     static const uint64_t p = 2;
 
-    // 32MB
-    static const uint64_t max_mem = 32 * 1024 * 1024;
+    // 32MB for the default cost. The memory grows linearly with the cost.
+    const uint64_t max_mem = std::max<uint64_t>(32 * 1024 * 1024, 128 * r * (N + p + 2));
 
     OutputT result;
     result.resize(PasswordHash::kBytesSize);
@@ -59,15 +67,46 @@ OutputT hashT(PasswordHash::Type type, std::string_view password, InputT salt)
 } // namespace
 
 // static
-ByteArray PasswordHash::hash(Type type, std::string_view password, const ByteArray& salt)
+ByteArray PasswordHash::hash(
+    Type type, std::string_view password, const ByteArray& salt, uint32_t cost)
+{
+    return hashT<const ByteArray, ByteArray>(type, password, salt, cost);
+}
+
+// static
+std::string PasswordHash::hash(
+    Type type, std::string_view password, std::string_view salt, uint32_t cost)
+{
+    return hashT<std::string_view, std::string>(type, password, salt, cost);
+}
+
+// static
+uint32_t PasswordHash::tuneCost(Type type, std::chrono::milliseconds target_time)
 {
-    return hashT<const ByteArray, ByteArray>(type, password, salt);
+    const ByteArray salt(kBytesSize, 0);
+    uint32_t cost = kDefaultCost;
+
+    while (cost < kMaxCost)
+    {
+        const auto start_time = std::chrono::steady_clock::now();
+        hash(type, "password", salt, cost);
+        const auto elapsed_time = std::chrono::steady_clock::now() - start_time;
+
+        // The time grows linearly with the cost.
+        if (elapsed_time * 2 > target_time)
+            break;
+
+        cost *= 2;
+    }
+
+    LOG(LS_INFO) << "Password hash cost: " << cost;
+    return cost;
 }
 
 // static
-std::string PasswordHash::hash(Type type, std::string_view password, std::string_view salt)
+bool PasswordHash::isValidCost(uint32_t cost)
 {
-    return hashT<std::string_view, std::string>(type, password, salt);
+    return cost >= 2 && cost <= kMaxCost && (cost & (cost - 1)) == 0;
 }
 
 } // namespace base
@@ -22,6 +22,8 @@
 #include "base/macros_magic.h"
 #include "base/memory/byte_array.h"
 
+#include <chrono>
+
 namespace base {
 
 class PasswordHash
@@ -29,12 +31,26 @@ class PasswordHash
 public:
     enum Type { SCRYPT };
 
-    static const size_t kBitsPerByte = 8;
-    static const size_t kBitsSize = 256;
-    static const size_t kBytesSize = kBitsSize / kBitsPerByte;
+    static constexpr size_t kBitsPerByte = 8;
+    static constexpr size_t kBitsSize = 256;
+    static constexpr size_t kBytesSize = kBitsSize / kBitsPerByte;
+
+    // CPU/memory cost parameter. Must be a power of 2. The hashes of the same password with
+    // different costs are different, so the cost must be stored together with the hash.
+    static constexpr uint32_t kDefaultCost = 16384;
+    static constexpr uint32_t kMaxCost = 131072;
+
+    // Returns an empty result if |cost| is not valid.
+    static ByteArray hash(Type type, std::string_view password, const ByteArray& salt,
+                          uint32_t cost = kDefaultCost);
+    static std::string hash(Type type, std::string_view password, std::string_view salt,
+                            uint32_t cost = kDefaultCost);
+
+    // Returns the largest cost for which hashing on this computer takes no longer than
+    // |target_time|. The result is between kDefaultCost and kMaxCost.
+    static uint32_t tuneCost(Type type, std::chrono::milliseconds target_time);
 
-    static ByteArray hash(Type type, std::string_view password, const ByteArray& salt);
-    static std::string hash(Type type, std::string_view password, std::string_view salt);
+    static bool isValidCost(uint32_t cost);
 
 private:
     DISALLOW_COPY_AND_ASSIGN(PasswordHash);
@@ -64,4 +64,37 @@ TEST(PasswordHashTest, Scrypt)
     }
 }
 
+TEST(PasswordHashTest, Cost)
+{
+    const ByteArray salt = fromHex(
+        "ee7eb0e6fb24d445597f3e6f1e0cdd649c71f7cd5c9699e270d5dc69f2d6baa5");
+
+    ByteArray default_hash = PasswordHash::hash(PasswordHash::Type::SCRYPT, "MyPassword", salt);
+    ByteArray cheap_hash = PasswordHash::hash(PasswordHash::Type::SCRYPT, "MyPassword", salt, 1024);
+    ByteArray costly_hash = PasswordHash::hash(
+        PasswordHash::Type::SCRYPT, "MyPassword", salt, PasswordHash::kDefaultCost * 2);
+
+    EXPECT_EQ(cheap_hash.size(), PasswordHash::kBytesSize);
+    EXPECT_EQ(costly_hash.size(), PasswordHash::kBytesSize);
+    EXPECT_NE(cheap_hash, default_hash);
+    EXPECT_NE(costly_hash, default_hash);
+
+    EXPECT_TRUE(PasswordHash::hash(PasswordHash::Type::SCRYPT, "MyPassword", salt, 1000).empty());
+    EXPECT_TRUE(PasswordHash::hash(PasswordHash::Type::SCRYPT, "MyPassword", salt, 0).empty());
+    EXPECT_TRUE(PasswordHash::hash(
+        PasswordHash::Type::SCRYPT, "MyPassword", salt, PasswordHash::kMaxCost * 2).empty());
+}
+
+TEST(PasswordHashTest, TuneCost)
+{
+    // Hashing with the default cost takes much longer than 1 ms.
+    EXPECT_EQ(PasswordHash::tuneCost(PasswordHash::Type::SCRYPT, std::chrono::milliseconds(1)),
+              PasswordHash::kDefaultCost);
+
+    uint32_t cost =
+        PasswordHash::tuneCost(PasswordHash::Type::SCRYPT, std::chrono::milliseconds(200));
+    EXPECT_TRUE(PasswordHash::isValidCost(cost));
+    EXPECT_GE(cost, PasswordHash::kDefaultCost);
+}
+
 } // namespace base
@@ -0,0 +1,189 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/crypto/secure_buffer.h"
+
+#include "base/logging.h"
+#include "base/crypto/secure_memory.h"
+
+#include <cstring>
+#include <utility>
+
+#if defined(OS_WIN)
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif // defined(OS_WIN)
+
+namespace base {
+
+namespace {
+
+size_t pageSize()
+{
+    static const size_t page_size = []()
+    {
+#if defined(OS_WIN)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return static_cast<size_t>(info.dwPageSize);
+#else
+        return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif // defined(OS_WIN)
+    }();
+
+    return page_size;
+}
+
+uint8_t* allocatePages(size_t size)
+{
+#if defined(OS_WIN)
+    void* memory = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!memory)
+    {
+        PLOG(LS_ERROR) << "VirtualAlloc failed";
+        return nullptr;
+    }
+
+    // The working set can be too small to lock the pages. The buffer works without it.
+    if (!VirtualLock(memory, size))
+    {
+        DPLOG(LS_WARNING) << "VirtualLock failed";
+    }
+#else
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        PLOG(LS_ERROR) << "mmap failed";
+        return nullptr;
+    }
+
+    // RLIMIT_MEMLOCK can be too small to lock the pages. The buffer works without it.
+    if (mlock(memory, size) != 0)
+    {
+        DPLOG(LS_WARNING) << "mlock failed";
+    }
+
+#if defined(MADV_DONTDUMP)
+    madvise(memory, size, MADV_DONTDUMP);
+#endif // defined(MADV_DONTDUMP)
+#endif // defined(OS_WIN)
+
+    return reinterpret_cast<uint8_t*>(memory);
+}
+
+void freePages(uint8_t* memory, size_t size)
+{
+    memZero(memory, size);
+
+#if defined(OS_WIN)
+    VirtualUnlock(memory, size);
+    VirtualFree(memory, 0, MEM_RELEASE);
+#else
+    munlock(memory, size);
+    munmap(memory, size);
+#endif // defined(OS_WIN)
+}
+
+} // namespace
+
+SecureBuffer::SecureBuffer(size_t size)
+{
+    resize(size);
+}
+
+SecureBuffer::SecureBuffer(std::string_view data)
+{
+    resize(data.size());
+    if (size_)
+        memcpy(data_, data.data(), size_);
+}
+
+SecureBuffer::~SecureBuffer()
+{
+    release();
+}
+
+SecureBuffer::SecureBuffer(SecureBuffer&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      capacity_(std::exchange(other.capacity_, 0))
+{
+    // Nothing
+}
+
+SecureBuffer& SecureBuffer::operator=(SecureBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        capacity_ = std::exchange(other.capacity_, 0);
+    }
+
+    return *this;
+}
+
+void SecureBuffer::resize(size_t size)
+{
+    if (size <= capacity_)
+    {
+        if (size < size_)
+            memZero(data_ + size, size_ - size);
+
+        size_ = size;
+        return;
+    }
+
+    const size_t page_size = pageSize();
+    const size_t capacity = (size + page_size - 1) / page_size * page_size;
+
+    uint8_t* data = allocatePages(capacity);
+    CHECK(data);
+
+    if (size_)
+        memcpy(data, data_, size_);
+
+    release();
+
+    data_ = data;
+    size_ = size;
+    capacity_ = capacity;
+}
+
+void SecureBuffer::clear()
+{
+    resize(0);
+}
+
+void SecureBuffer::release()
+{
+    if (!data_)
+        return;
+
+    freePages(data_, capacity_);
+
+    data_ = nullptr;
+    size_ = 0;
+    capacity_ = 0;
+}
+
+} // namespace base
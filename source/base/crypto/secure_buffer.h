@@ -0,0 +1,71 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__CRYPTO__SECURE_BUFFER_H
+#define BASE__CRYPTO__SECURE_BUFFER_H
+
+#include "base/macros_magic.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace base {
+
+// Buffer for keys and decrypted data. The memory is allocated in whole pages that are locked in
+// RAM (if the system allows it) and excluded from core dumps. The content is wiped when the
+// buffer is resized, moved from or destroyed.
+class SecureBuffer
+{
+public:
+    SecureBuffer() = default;
+    explicit SecureBuffer(size_t size);
+    explicit SecureBuffer(std::string_view data);
+    ~SecureBuffer();
+
+    SecureBuffer(SecureBuffer&& other) noexcept;
+    SecureBuffer& operator=(SecureBuffer&& other) noexcept;
+
+    uint8_t* data() { return data_; }
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    std::string_view view() const
+    {
+        return std::string_view(reinterpret_cast<const char*>(data_), size_);
+    }
+
+    // The content up to the new size is preserved. The memory is reallocated only if the buffer
+    // grows beyond the allocated pages.
+    void resize(size_t size);
+    void clear();
+
+private:
+    void release();
+
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(SecureBuffer);
+};
+
+} // namespace base
+
+#endif // BASE__CRYPTO__SECURE_BUFFER_H
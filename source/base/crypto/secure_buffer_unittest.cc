@@ -0,0 +1,93 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/crypto/secure_buffer.h"
+
+#include "base/crypto/data_cryptor_chacha20_poly1305.h"
+#include "base/crypto/data_cryptor_fake.h"
+#include "base/memory/byte_array.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(SecureBufferTest, Resize)
+{
+    SecureBuffer buffer("0123456789");
+    ASSERT_EQ(buffer.size(), 10u);
+    EXPECT_EQ(buffer.view(), "0123456789");
+
+    const uint8_t* data = buffer.data();
+
+    // Shrinking keeps the pages.
+    buffer.resize(4);
+    EXPECT_EQ(buffer.data(), data);
+    EXPECT_EQ(buffer.view(), "0123");
+
+    // The wiped tail is not visible again.
+    buffer.resize(10);
+    EXPECT_EQ(buffer.data(), data);
+    EXPECT_EQ(buffer.view(), std::string_view("0123\0\0\0\0\0\0", 10));
+
+    // Growing beyond the page keeps the content.
+    buffer.resize(1024 * 1024);
+    EXPECT_EQ(buffer.view().substr(0, 4), "0123");
+
+    buffer.clear();
+    EXPECT_TRUE(buffer.empty());
+}
+
+TEST(SecureBufferTest, Move)
+{
+    SecureBuffer buffer1("secret");
+    SecureBuffer buffer2(std::move(buffer1));
+
+    EXPECT_TRUE(buffer1.empty());
+    EXPECT_EQ(buffer1.data(), nullptr);
+    EXPECT_EQ(buffer2.view(), "secret");
+
+    buffer1 = std::move(buffer2);
+    EXPECT_TRUE(buffer2.empty());
+    EXPECT_EQ(buffer1.view(), "secret");
+}
+
+TEST(SecureBufferTest, Decrypt)
+{
+    const ByteArray key = fromHex("1ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+    const std::string message = "address book data";
+
+    DataCryptorChaCha20Poly1305 cryptor(toStdString(key));
+
+    std::string encrypted;
+    ASSERT_TRUE(cryptor.encrypt(message, &encrypted));
+
+    SecureBuffer decrypted;
+    ASSERT_TRUE(cryptor.decrypt(encrypted, &decrypted));
+    EXPECT_EQ(decrypted.view(), message);
+
+    // A damaged message leaves the buffer empty.
+    encrypted.back() ^= 1;
+    EXPECT_FALSE(cryptor.decrypt(encrypted, &decrypted));
+    EXPECT_TRUE(decrypted.empty());
+
+    DataCryptorFake fake;
+    ASSERT_TRUE(fake.decrypt(message, &decrypted));
+    EXPECT_EQ(decrypted.view(), message);
+}
+
+} // namespace base
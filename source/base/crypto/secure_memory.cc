@@ -20,12 +20,23 @@
 
 #include <openssl/crypto.h>
 
+#include <cstring>
+
 namespace base {
 
 void memZero(void* data, size_t data_size)
 {
-    if (data && data_size)
-        OPENSSL_cleanse(data, data_size);
+    if (!data || !data_size)
+        return;
+
+#if defined(__GNUC__) || defined(__clang__)
+    // memset is vectorized by the C library. The barrier tells the compiler that the memory is
+    // read afterwards, so the call cannot be removed as a dead store.
+    memset(data, 0, data_size);
+    __asm__ __volatile__("" : : "r"(data) : "memory");
+#else
+    OPENSSL_cleanse(data, data_size);
+#endif
 }
 
 void memZero(std::string* str)
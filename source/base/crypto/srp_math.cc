@@ -20,12 +20,16 @@
 
 #include "base/logging.h"
 #include "base/crypto/generic_hash.h"
+#include "base/crypto/srp_constants.h"
 #include "base/strings/string_util.h"
 #include "base/strings/unicode.h"
 
 #include <openssl/opensslv.h>
 #include <openssl/bn.h>
 
+#include <mutex>
+#include <vector>
+
 namespace base {
 
 namespace {
@@ -62,6 +66,289 @@ BigNum calc_k(const BigNum& N, const BigNum& g)
     return calc_xy(N, g, N);
 }
 
+// Exponents up to this size use the precomputed powers of the generator. The secret values a and
+// b are 1024 bits and x is 512 bits.
+constexpr int kFixedBaseMaxBits = 1024;
+constexpr int kWindowBits = 4;
+constexpr int kWindowEntries = (1 << kWindowBits) - 1;
+constexpr int kWindowCount = kFixedBaseMaxBits / kWindowBits;
+
+// Precomputed values for one of the groups from srp_constants. Instead of squarings, g^e is
+// calculated with one multiplication for each non-zero 4-bit digit of e. The tables are
+// created on first use and do not change after that, so they can be used from any thread.
+class FixedBaseGroup
+{
+public:
+    explicit FixedBaseGroup(const SrpNgPair& pair)
+        : N_(BigNum::fromStdString(pair.first)),
+          g_(BigNum::fromStdString(pair.second))
+    {
+        // Nothing
+    }
+
+    bool matches(const BigNum& N) const { return BN_cmp(N_, N) == 0; }
+
+    bool matches(const BigNum& N, const BigNum& g) const
+    {
+        return matches(N) && BN_cmp(g_, g) == 0;
+    }
+
+    // Returns k for the group or nullptr on error.
+    const BigNum* k()
+    {
+        std::call_once(init_flag_, &FixedBaseGroup::init, this);
+        return k_.isValid() ? &k_ : nullptr;
+    }
+
+    // Returns the Montgomery context for N or nullptr on error. The context is only read by
+    // OpenSSL after it is set, so it is shared by all threads.
+    BN_MONT_CTX* mont()
+    {
+        std::call_once(init_flag_, &FixedBaseGroup::init, this);
+        return mont_.get();
+    }
+
+    // r = g^e % N. Returns false if |e| is too large for the tables.
+    bool power(BigNum& r, const BigNum& e, BN_CTX* ctx)
+    {
+        if (BN_is_negative(e) || BN_num_bits(e) > kFixedBaseMaxBits)
+            return false;
+
+        std::call_once(init_flag_, &FixedBaseGroup::init, this);
+        if (table_.empty())
+            return false;
+
+        BN_CTX_start(ctx);
+
+        BIGNUM* product = BN_CTX_get(ctx);
+        bool has_product = false;
+        bool result = product != nullptr;
+
+        for (int i = 0; result && i < kWindowCount; ++i)
+        {
+            int digit = 0;
+            for (int bit = 0; bit < kWindowBits; ++bit)
+            {
+                if (BN_is_bit_set(e, i * kWindowBits + bit))
+                    digit |= 1 << bit;
+            }
+
+            if (!digit)
+                continue;
+
+            const BigNum& entry = table_[static_cast<size_t>(i * kWindowEntries + digit - 1)];
+
+            if (!has_product)
+            {
+                result = BN_copy(product, entry) != nullptr;
+                has_product = true;
+            }
+            else
+            {
+                result = BN_mod_mul_montgomery(product, product, entry, mont_.get(), ctx) != 0;
+            }
+        }
+
+        if (result)
+        {
+            // g^0 = 1.
+            if (!has_product)
+                result = BN_one(r) != 0;
+            else
+                result = BN_from_montgomery(r, product, mont_.get(), ctx) != 0;
+        }
+
+        BN_CTX_end(ctx);
+        return result;
+    }
+
+private:
+    // table_[i * 15 + j - 1] = g^(j * 16^i) in the Montgomery form.
+    void init()
+    {
+        k_ = calc_k(N_, g_);
+
+        BigNum::Context ctx = BigNum::Context::create();
+        BN_MONT_CTX_ptr mont(BN_MONT_CTX_new());
+        BigNum base = BigNum::create();
+
+        if (!ctx.isValid() || !mont || !base.isValid() || !N_.isValid() || !g_.isValid())
+        {
+            LOG(LS_ERROR) << "Unable to create the tables of the SRP group";
+            return;
+        }
+
+        if (!BN_MONT_CTX_set(mont.get(), N_, ctx) ||
+            !BN_to_montgomery(base, g_, mont.get(), ctx))
+        {
+            LOG(LS_ERROR) << "Unable to create the Montgomery context of the SRP group";
+            return;
+        }
+
+        // The context does not depend on the tables and is kept even if they fail.
+        mont_ = std::move(mont);
+
+        std::vector<BigNum> table;
+        table.reserve(kWindowCount * kWindowEntries);
+
+        for (int i = 0; i < kWindowCount; ++i)
+        {
+            for (int j = 1; j <= kWindowEntries; ++j)
+            {
+                BigNum entry = BigNum::create();
+                if (!entry.isValid())
+                    return;
+
+                if (j == 1)
+                {
+                    if (!BN_copy(entry, base))
+                        return;
+                }
+                else if (!BN_mod_mul_montgomery(entry, table.back(), base, mont_.get(), ctx))
+                {
+                    return;
+                }
+
+                table.emplace_back(std::move(entry));
+            }
+
+            // The base of the next window is base^16.
+            BigNum next_base = BigNum::create();
+            if (!next_base.isValid() ||
+                !BN_mod_mul_montgomery(next_base, table.back(), base, mont_.get(), ctx))
+            {
+                return;
+            }
+
+            base = std::move(next_base);
+        }
+
+        table_ = std::move(table);
+    }
+
+    const BigNum N_;
+    const BigNum g_;
+
+    std::once_flag init_flag_;
+    BigNum k_;
+    BN_MONT_CTX_ptr mont_;
+    std::vector<BigNum> table_;
+
+    DISALLOW_COPY_AND_ASSIGN(FixedBaseGroup);
+};
+
+FixedBaseGroup* fixedBaseGroups(size_t* count)
+{
+    static FixedBaseGroup groups[] =
+    {
+        FixedBaseGroup(kSrpNgPair_1024),
+        FixedBaseGroup(kSrpNgPair_1536),
+        FixedBaseGroup(kSrpNgPair_2048),
+        FixedBaseGroup(kSrpNgPair_3072),
+        FixedBaseGroup(kSrpNgPair_4096),
+        FixedBaseGroup(kSrpNgPair_6144),
+        FixedBaseGroup(kSrpNgPair_8192)
+    };
+
+    *count = std::size(groups);
+    return groups;
+}
+
+// Returns the precomputed values if N and g are one of the groups from srp_constants.
+FixedBaseGroup* fixedBaseGroup(const BigNum& N, const BigNum& g)
+{
+    size_t count;
+    FixedBaseGroup* groups = fixedBaseGroups(&count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (groups[i].matches(N, g))
+            return &groups[i];
+    }
+
+    return nullptr;
+}
+
+// Returns the cached Montgomery context if N is the modulus of one of the groups from
+// srp_constants. The server does not know g when it calculates the key, so only N is compared.
+BN_MONT_CTX* groupMont(const BigNum& N)
+{
+    size_t count;
+    FixedBaseGroup* groups = fixedBaseGroups(&count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (groups[i].matches(N))
+            return groups[i].mont();
+    }
+
+    return nullptr;
+}
+
+// Every handshake does several operations. The context keeps its buffers between them, so it is
+// created once for each thread instead of once for each operation.
+BN_CTX* threadContext()
+{
+    thread_local BigNum::Context ctx = BigNum::Context::create();
+    return ctx;
+}
+
+// Takes temporary values from the context. They are returned to the context when the scope ends.
+class ContextScope
+{
+public:
+    explicit ContextScope(BN_CTX* ctx)
+        : ctx_(ctx)
+    {
+        BN_CTX_start(ctx_);
+    }
+
+    ~ContextScope()
+    {
+        BN_CTX_end(ctx_);
+    }
+
+    // Returns nullptr on error.
+    BIGNUM* get() { return BN_CTX_get(ctx_); }
+
+private:
+    BN_CTX* ctx_;
+    DISALLOW_COPY_AND_ASSIGN(ContextScope);
+};
+
+// Returns k for the group. If the group is not one of the precomputed ones, k is calculated
+// into |storage|.
+const BigNum* group_k(const BigNum& N, const BigNum& g, BigNum* storage)
+{
+    FixedBaseGroup* group = fixedBaseGroup(N, g);
+    if (group)
+    {
+        const BigNum* k = group->k();
+        if (k)
+            return k;
+    }
+
+    *storage = calc_k(N, g);
+    return storage->isValid() ? storage : nullptr;
+}
+
+// r = g^e % N
+bool calc_power(BigNum& r, const BigNum& g, const BigNum& e, const BigNum& N, BN_CTX* ctx)
+{
+    FixedBaseGroup* group = fixedBaseGroup(N, g);
+    if (group && group->power(r, e, ctx))
+        return true;
+
+    return BN_mod_exp(r, g, e, N, ctx) != 0;
+}
+
+// r = a^e % N, where e is a secret value. The time of the exponentiation does not depend on the
+// bits of e. |r| must not be the same value as |a|.
+bool calc_secret_power(BigNum& r, const BIGNUM* a, const BIGNUM* e, const BigNum& N, BN_CTX* ctx)
+{
+    return BN_mod_exp_mont_consttime(r, a, e, N, ctx, groupMont(N)) != 0;
+}
+
 } // namespace
 
 // static
@@ -81,54 +368,43 @@ BigNum SrpMath::calc_B(const BigNum& b, const BigNum& N, const BigNum& g, const
         return BigNum();
     }
 
-    BigNum::Context ctx = BigNum::Context::create();
-    if (!ctx.isValid())
+    BN_CTX* ctx = threadContext();
+    if (!ctx)
     {
         LOG(LS_ERROR) << "BigNum::Context::create failed";
         return BigNum();
     }
 
-    BigNum gb = BigNum::create();
-    if (!gb.isValid())
-    {
-        LOG(LS_ERROR) << "BigNum::create failed";
-        return BigNum();
-    }
-
-    if (!BN_mod_exp(gb, g, b, N, ctx))
-    {
-        LOG(LS_ERROR) << "BN_mod_exp failed";
-        return BigNum();
-    }
-
-    BigNum k = calc_k(N, g);
-    if (!k.isValid())
+    BigNum k_storage;
+    const BigNum* k = group_k(N, g, &k_storage);
+    if (!k)
     {
         LOG(LS_ERROR) << "Invalid k";
         return BigNum();
     }
 
-    BigNum kv = BigNum::create();
-    if (!kv.isValid())
+    BigNum B = BigNum::create();
+    BigNum gb = BigNum::create();
+
+    if (!B.isValid() || !gb.isValid())
     {
         LOG(LS_ERROR) << "BigNum::create failed";
         return BigNum();
     }
 
-    if (!BN_mod_mul(kv, v, k, N, ctx))
+    if (!calc_power(gb, g, b, N, ctx))
     {
-        LOG(LS_ERROR) << "BN_mod_mul failed";
+        LOG(LS_ERROR) << "calc_power failed";
         return BigNum();
     }
 
-    BigNum B = BigNum::create();
-    if (!B.isValid())
+    if (!BN_mod_mul(B, v, *k, N, ctx))
     {
-        LOG(LS_ERROR) << "BigNum::create failed";
+        LOG(LS_ERROR) << "BN_mod_mul failed";
         return BigNum();
     }
 
-    if (!BN_mod_add(B, gb, kv, N, ctx))
+    if (!BN_mod_add(B, B, gb, N, ctx))
     {
         LOG(LS_ERROR) << "BN_mod_add failed";
         return BigNum();
@@ -180,18 +456,18 @@ BigNum SrpMath::calc_A(const BigNum& a, const BigNum& N, const BigNum& g)
         return BigNum();
     }
 
-    BigNum::Context ctx = BigNum::Context::create();
+    BN_CTX* ctx = threadContext();
     BigNum A = BigNum::create();
 
-    if (!A.isValid() || !ctx.isValid())
+    if (!A.isValid() || !ctx)
     {
         LOG(LS_ERROR) << "BigNum::Context::create or BigNum::create failed";
         return BigNum();
     }
 
-    if (!BN_mod_exp(A, g, a, N, ctx))
+    if (!calc_power(A, g, a, N, ctx))
     {
-        LOG(LS_ERROR) << "BN_mod_exp failed";
+        LOG(LS_ERROR) << "calc_power failed";
         return BigNum();
     }
 
@@ -209,37 +485,39 @@ BigNum SrpMath::calcServerKey(const BigNum& A, const BigNum& v, const BigNum& u,
         return BigNum();
     }
 
-    BigNum::Context ctx = BigNum::Context::create();
-    BigNum tmp = BigNum::create();
-
-    if (!ctx.isValid() || !tmp.isValid())
+    BN_CTX* ctx = threadContext();
+    if (!ctx)
     {
-        LOG(LS_ERROR) << "BigNum::Context::create or BigNum::create failed";
+        LOG(LS_ERROR) << "BigNum::Context::create failed";
         return BigNum();
     }
 
-    if (!BN_mod_exp(tmp, v, u, N, ctx))
+    ContextScope scope(ctx);
+    BIGNUM* tmp = scope.get();
+    BigNum S = BigNum::create();
+
+    if (!tmp || !S.isValid())
     {
-        LOG(LS_ERROR) << "BN_mod_exp failed";
+        LOG(LS_ERROR) << "BN_CTX_get or BigNum::create failed";
         return BigNum();
     }
 
-    if (!BN_mod_mul(tmp, A, tmp, N, ctx))
+    // u is public, so v^u does not have to be calculated in constant time.
+    if (!BN_mod_exp_mont(tmp, v, u, N, ctx, groupMont(N)))
     {
-        LOG(LS_ERROR) << "BN_mod_mul failed";
+        LOG(LS_ERROR) << "BN_mod_exp_mont failed";
         return BigNum();
     }
 
-    BigNum S = BigNum::create();
-    if (!S.isValid())
+    if (!BN_mod_mul(tmp, A, tmp, N, ctx))
     {
-        LOG(LS_ERROR) << "BigNum::create failed";
+        LOG(LS_ERROR) << "BN_mod_mul failed";
         return BigNum();
     }
 
-    if (!BN_mod_exp(S, tmp, b, N, ctx))
+    if (!calc_secret_power(S, tmp, b, N, ctx))
     {
-        LOG(LS_ERROR) << "BN_mod_exp failed";
+        LOG(LS_ERROR) << "calc_secret_power failed";
         return BigNum();
     }
 
@@ -257,70 +535,65 @@ BigNum SrpMath::calcClientKey(const BigNum& N, const BigNum& B, const BigNum& g,
         return BigNum();
     }
 
-    BigNum::Context ctx = BigNum::Context::create();
-    if (!ctx.isValid())
+    BN_CTX* ctx = threadContext();
+    if (!ctx)
     {
         LOG(LS_ERROR) << "BigNum::Context::create failed";
         return BigNum();
     }
 
-    BigNum tmp = BigNum::create();
-    BigNum tmp2 = BigNum::create();
-    BigNum tmp3 = BigNum::create();
-
-    if (!tmp.isValid() || !tmp2.isValid() || !tmp3.isValid())
+    BigNum k_storage;
+    const BigNum* k = group_k(N, g, &k_storage);
+    if (!k)
     {
-        LOG(LS_ERROR) << "BigNum::create failed";
+        LOG(LS_ERROR) << "calc_k failed";
         return BigNum();
     }
 
-    if (!BN_mod_exp(tmp, g, x, N, ctx))
+    ContextScope scope(ctx);
+    BIGNUM* base = scope.get();
+    BIGNUM* exponent = scope.get();
+    BigNum K = BigNum::create();
+
+    if (!base || !exponent || !K.isValid())
     {
-        LOG(LS_ERROR) << "BN_mod_exp failed";
+        LOG(LS_ERROR) << "BN_CTX_get or BigNum::create failed";
         return BigNum();
     }
 
-    BigNum k = calc_k(N, g);
-    if (!k.isValid())
+    if (!calc_power(K, g, x, N, ctx))
     {
-        LOG(LS_ERROR) << "calc_k failed";
+        LOG(LS_ERROR) << "calc_power failed";
         return BigNum();
     }
 
-    if (!BN_mod_mul(tmp2, tmp, k, N, ctx))
+    if (!BN_mod_mul(K, K, *k, N, ctx))
     {
         LOG(LS_ERROR) << "BN_mod_mul failed";
         return BigNum();
     }
 
-    if (!BN_mod_sub(tmp, B, tmp2, N, ctx))
+    if (!BN_mod_sub(base, B, K, N, ctx))
     {
         LOG(LS_ERROR) << "BN_mod_sub failed";
         return BigNum();
     }
 
-    if (!BN_mul(tmp3, u, x, ctx))
+    if (!BN_mul(exponent, u, x, ctx))
     {
         LOG(LS_ERROR) << "BN_mul failed";
         return BigNum();
     }
 
-    if (!BN_add(tmp2, a, tmp3))
+    if (!BN_add(exponent, a, exponent))
     {
         LOG(LS_ERROR) << "BN_add failed";
         return BigNum();
     }
 
-    BigNum K = BigNum::create();
-    if (!K.isValid())
-    {
-        LOG(LS_ERROR) << "BigNum::create failed";
-        return BigNum();
-    }
-
-    if (!BN_mod_exp(K, tmp, tmp2, N, ctx))
+    if (!calc_secret_power(K, base, exponent, N, ctx))
     {
-        LOG(LS_ERROR) << "BN_mod_exp failed";
+        LOG(LS_ERROR) << "calc_secret_power failed";
         return BigNum();
     }
 
@@ -336,10 +609,10 @@ bool SrpMath::verify_B_mod_N(const BigNum& B, const BigNum& N)
         return false;
     }
 
-    BigNum::Context ctx = BigNum::Context::create();
+    BN_CTX* ctx = threadContext();
     BigNum result = BigNum::create();
 
-    if (!ctx.isValid() || !result.isValid())
+    if (!ctx || !result.isValid())
     {
         LOG(LS_ERROR) << "BigNum::Context::create or BigNum::create failed";
         return false;
@@ -370,10 +643,10 @@ BigNum SrpMath::calc_v(std::u16string_view I, std::u16string_view p, const BigNu
         return BigNum();
     }
 
-    BigNum::Context ctx = BigNum::Context::create();
+    BN_CTX* ctx = threadContext();
     BigNum v = BigNum::create();
 
-    if (!ctx.isValid() || !v.isValid())
+    if (!ctx || !v.isValid())
     {
         LOG(LS_ERROR) << "BigNum::Context::create or BigNum::create failed";
         return BigNum();
@@ -381,9 +654,9 @@ BigNum SrpMath::calc_v(std::u16string_view I, std::u16string_view p, const BigNu
 
     BigNum x = calc_x(s, I, p);
 
-    if (!BN_mod_exp(v, g, x, N, ctx))
+    if (!calc_power(v, g, x, N, ctx))
     {
-        LOG(LS_ERROR) << "BN_mod_exp failed";
+        LOG(LS_ERROR) << "calc_power failed";
         return BigNum();
     }
 
@@ -400,10 +673,10 @@ BigNum SrpMath::calc_v(std::u16string_view I, const ByteArray& p, const BigNum&
         return BigNum();
     }
 
-    BigNum::Context ctx = BigNum::Context::create();
+    BN_CTX* ctx = threadContext();
     BigNum v = BigNum::create();
 
-    if (!ctx.isValid() || !v.isValid())
+    if (!ctx || !v.isValid())
     {
         LOG(LS_ERROR) << "BigNum::Context::create or BigNum::create failed";
         return BigNum();
@@ -411,9 +684,9 @@ BigNum SrpMath::calc_v(std::u16string_view I, const ByteArray& p, const BigNum&
 
     BigNum x = calc_x(s, I, p);
 
-    if (!BN_mod_exp(v, g, x, N, ctx))
+    if (!calc_power(v, g, x, N, ctx))
     {
-        LOG(LS_ERROR) << "BN_mod_exp failed";
+        LOG(LS_ERROR) << "calc_power failed";
         return BigNum();
     }
 
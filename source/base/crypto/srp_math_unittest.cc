@@ -16,10 +16,12 @@
 // along with this program. If not, see <https://www.gnu.org/licenses/>.
 //
 
+#include "base/crypto/random.h"
 #include "base/crypto/srp_constants.h"
 #include "base/crypto/srp_math.h"
 
 #include <gtest/gtest.h>
+#include <openssl/bn.h>
 
 namespace base {
 
@@ -190,4 +192,36 @@ TEST(srp_math_test, test_vector)
     ASSERT_EQ(memcmp(client_key_string.c_str(), key_ref_buf, sizeof(key_ref_buf)), 0);
 }
 
+TEST(srp_math_test, precomputed_groups)
+{
+    const SrpNgPair groups[] = { kSrpNgPair_1024, kSrpNgPair_1536, kSrpNgPair_2048,
+                                 kSrpNgPair_3072, kSrpNgPair_4096, kSrpNgPair_6144,
+                                 kSrpNgPair_8192 };
+
+    // The last exponent is larger than the precomputed tables.
+    const size_t exponent_sizes[] = { 1, 32, 64, 128, 129 };
+
+    BigNum::Context ctx = BigNum::Context::create();
+    ASSERT_TRUE(ctx.isValid());
+
+    for (const SrpNgPair& group : groups)
+    {
+        BigNum N = BigNum::fromStdString(group.first);
+        BigNum g = BigNum::fromStdString(group.second);
+
+        for (size_t exponent_size : exponent_sizes)
+        {
+            BigNum a = BigNum::fromByteArray(Random::byteArray(exponent_size));
+            ASSERT_TRUE(a.isValid());
+
+            BigNum A = SrpMath::calc_A(a, N, g);
+            ASSERT_TRUE(A.isValid());
+
+            BigNum expected = BigNum::create();
+            ASSERT_TRUE(BN_mod_exp(expected, g, a, N, ctx));
+            EXPECT_EQ(BN_cmp(A, expected), 0);
+        }
+    }
+}
+
 } // namespace base
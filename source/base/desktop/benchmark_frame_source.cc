@@ -0,0 +1,254 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/benchmark_frame_source.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame_simple.h"
+
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+const int kGlyphWidth = 8;
+const int kGlyphHeight = 16;
+const int kLineHeight = 20;
+const int kMargin = 32;
+const int kToolbarHeight = 48;
+const int kGlyphsPerFrame = 2;
+const int kCaretBlinkFrames = 15;
+const int kScrollLines = 3;
+
+const uint32_t kColorBackground = 0xFFFFFFFF;
+const uint32_t kColorText = 0xFF202020;
+const uint32_t kColorToolbar = 0xFFE0E0E0;
+
+inline uint32_t* pixelAt(Frame* frame, int x, int y)
+{
+    return reinterpret_cast<uint32_t*>(frame->frameDataAtPos(x, y));
+}
+
+} // namespace
+
+BenchmarkFrameSource::BenchmarkFrameSource(Scene scene, const Size& size)
+    : scene_(scene),
+      document_rect_(Rect::makeLTRB(0, kToolbarHeight, size.width(), size.height())),
+      current_(FrameSimple::create(size, PixelFormat::ARGB())),
+      previous_(FrameSimple::create(size, PixelFormat::ARGB())),
+      text_pos_(kMargin, kToolbarHeight + kMargin)
+{
+    CHECK(current_ && previous_);
+    CHECK_GT(document_rect_.height(), kMargin * 2 + kLineHeight);
+
+    fillRect(current_.get(), Rect::makeWH(size.width(), kToolbarHeight), kColorToolbar);
+    drawText(current_.get(), document_rect_);
+
+    memcpy(previous_->frameData(), current_->frameData(),
+           static_cast<size_t>(current_->stride()) * static_cast<size_t>(size.height()));
+}
+
+BenchmarkFrameSource::~BenchmarkFrameSource() = default;
+
+// static
+const char* BenchmarkFrameSource::sceneName(Scene scene)
+{
+    switch (scene)
+    {
+        case Scene::OFFICE:
+            return "office";
+
+        case Scene::VIDEO:
+            return "video";
+
+        case Scene::SCROLLING:
+            return "scrolling";
+
+        default:
+            NOTREACHED();
+            return "unknown";
+    }
+}
+
+const Frame* BenchmarkFrameSource::nextFrame()
+{
+    std::swap(current_, previous_);
+
+    memcpy(current_->frameData(), previous_->frameData(),
+           static_cast<size_t>(current_->stride()) * static_cast<size_t>(current_->size().height()));
+    current_->updatedRegion()->clear();
+
+    switch (scene_)
+    {
+        case Scene::OFFICE:
+            drawOffice(current_.get());
+            break;
+
+        case Scene::VIDEO:
+            drawVideo(current_.get());
+            break;
+
+        case Scene::SCROLLING:
+            drawScrolling(current_.get());
+            break;
+    }
+
+    ++frame_number_;
+    return current_.get();
+}
+
+void BenchmarkFrameSource::drawText(Frame* frame, const Rect& rect)
+{
+    fillRect(frame, rect, kColorBackground);
+
+    const int y_offset = (kLineHeight - kGlyphHeight) / 2;
+
+    for (int y = rect.top() + y_offset; y + kGlyphHeight <= rect.bottom(); y += kLineHeight)
+    {
+        int x = kMargin;
+
+        while (x + kGlyphWidth <= rect.right() - kMargin)
+        {
+            // Words of 2-9 glyphs separated by a space.
+            int word_length = 2 + static_cast<int>(random() % 8);
+
+            for (int i = 0; i < word_length && x + kGlyphWidth <= rect.right() - kMargin; ++i)
+            {
+                drawGlyph(frame, Point(x, y));
+                x += kGlyphWidth;
+            }
+
+            x += kGlyphWidth;
+        }
+    }
+}
+
+void BenchmarkFrameSource::drawGlyph(Frame* frame, const Point& pos)
+{
+    fillRect(frame, Rect::makeXYWH(pos, Size(kGlyphWidth, kGlyphHeight)), kColorBackground);
+
+    // Glyphs have empty rows above and below like the letters of a real font.
+    for (int row = 3; row < kGlyphHeight - 3; ++row)
+    {
+        uint32_t* pixel = pixelAt(frame, pos.x(), pos.y() + row);
+        uint32_t bits = random();
+
+        for (int column = 1; column < kGlyphWidth - 1; ++column)
+            pixel[column] = (bits & (1U << column)) ? kColorText : kColorBackground;
+    }
+}
+
+void BenchmarkFrameSource::fillRect(Frame* frame, const Rect& rect, uint32_t color)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* pixel = pixelAt(frame, rect.left(), y);
+
+        for (int x = 0; x < rect.width(); ++x)
+            pixel[x] = color;
+    }
+}
+
+void BenchmarkFrameSource::drawOffice(Frame* frame)
+{
+    const int line_end = document_rect_.right() - kMargin;
+    const int last_line = document_rect_.bottom() - kMargin - kLineHeight;
+
+    for (int i = 0; i < kGlyphsPerFrame; ++i)
+    {
+        if (text_pos_.x() + kGlyphWidth > line_end)
+        {
+            text_pos_.set(kMargin, text_pos_.y() + kLineHeight);
+
+            if (text_pos_.y() > last_line)
+                text_pos_.set(kMargin, document_rect_.top() + kMargin);
+        }
+
+        drawGlyph(frame, text_pos_);
+        frame->updatedRegion()->addRect(
+            Rect::makeXYWH(text_pos_, Size(kGlyphWidth, kGlyphHeight)));
+
+        text_pos_.translate(kGlyphWidth, 0);
+    }
+
+    if (text_pos_.x() + 2 <= line_end)
+    {
+        Rect caret_rect = Rect::makeXYWH(text_pos_, Size(2, kGlyphHeight));
+        bool visible = (frame_number_ / kCaretBlinkFrames) % 2 == 0;
+
+        fillRect(frame, caret_rect, visible ? kColorText : kColorBackground);
+        frame->updatedRegion()->addRect(caret_rect);
+    }
+}
+
+void BenchmarkFrameSource::drawVideo(Frame* frame)
+{
+    const Size& size = frame->size();
+    const Rect video_rect = Rect::makeXYWH(
+        size.width() / 4, size.height() / 4, size.width() / 2, size.height() / 2);
+
+    // Moving gradients with noise. Like a real video, the picture is changed everywhere and does
+    // not compress losslessly.
+    for (int y = 0; y < video_rect.height(); ++y)
+    {
+        uint32_t* pixel = pixelAt(frame, video_rect.left(), video_rect.top() + y);
+
+        for (int x = 0; x < video_rect.width(); ++x)
+        {
+            uint32_t noise = random() & 0x0F;
+            uint32_t red = (static_cast<uint32_t>(x + frame_number_ * 4) + noise) & 0xFF;
+            uint32_t green = (static_cast<uint32_t>(y + frame_number_ * 2) + noise) & 0xFF;
+            uint32_t blue = (static_cast<uint32_t>((x ^ y) + frame_number_) + noise) & 0xFF;
+
+            pixel[x] = 0xFF000000 | (red << 16) | (green << 8) | blue;
+        }
+    }
+
+    frame->updatedRegion()->addRect(video_rect);
+}
+
+void BenchmarkFrameSource::drawScrolling(Frame* frame)
+{
+    const int scroll_height = kScrollLines * kLineHeight;
+    const int stride = frame->stride();
+
+    // Moves the document up. The lines scrolled in at the bottom are new.
+    memmove(frame->frameDataAtPos(0, document_rect_.top()),
+            frame->frameDataAtPos(0, document_rect_.top() + scroll_height),
+            static_cast<size_t>(stride) *
+                static_cast<size_t>(document_rect_.height() - scroll_height));
+
+    drawText(frame, Rect::makeLTRB(document_rect_.left(),
+                                   document_rect_.bottom() - scroll_height,
+                                   document_rect_.right(),
+                                   document_rect_.bottom()));
+
+    frame->updatedRegion()->addRect(document_rect_);
+}
+
+uint32_t BenchmarkFrameSource::random()
+{
+    // xorshift32, the sequence is the same on every run.
+    random_state_ ^= random_state_ << 13;
+    random_state_ ^= random_state_ >> 17;
+    random_state_ ^= random_state_ << 5;
+    return random_state_;
+}
+
+} // namespace base
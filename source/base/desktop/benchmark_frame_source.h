@@ -0,0 +1,85 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__DESKTOP__BENCHMARK_FRAME_SOURCE_H
+#define BASE__DESKTOP__BENCHMARK_FRAME_SOURCE_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/geometry.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace base {
+
+class Frame;
+
+// Generates deterministic sequences of desktop frames for benchmarks. Each scene imitates a
+// typical workload of a remote session, so the results of different runs and machines are
+// comparable.
+class BenchmarkFrameSource
+{
+public:
+    enum class Scene
+    {
+        // Static document with text typed in small areas and a blinking caret.
+        OFFICE,
+
+        // Video playback in a window, the window area changes completely in every frame.
+        VIDEO,
+
+        // Document scrolled up by several lines of text in every frame.
+        SCROLLING
+    };
+
+    BenchmarkFrameSource(Scene scene, const Size& size);
+    ~BenchmarkFrameSource();
+
+    static const char* sceneName(Scene scene);
+
+    // Generates the next frame of the scene. The updated region of the frame contains the areas
+    // changed since the previous frame. The returned frame is valid until the next call.
+    const Frame* nextFrame();
+
+    // Returns the frame that preceded the last one returned by nextFrame().
+    const Frame* previousFrame() const { return previous_.get(); }
+
+private:
+    void drawText(Frame* frame, const Rect& rect);
+    void drawGlyph(Frame* frame, const Point& pos);
+    void fillRect(Frame* frame, const Rect& rect, uint32_t color);
+    void drawOffice(Frame* frame);
+    void drawVideo(Frame* frame);
+    void drawScrolling(Frame* frame);
+    uint32_t random();
+
+    const Scene scene_;
+    const Rect document_rect_;
+    std::unique_ptr<Frame> current_;
+    std::unique_ptr<Frame> previous_;
+
+    uint32_t random_state_ = 0x12345678;
+    int frame_number_ = 0;
+    Point text_pos_;
+
+    DISALLOW_COPY_AND_ASSIGN(BenchmarkFrameSource);
+};
+
+} // namespace base
+
+#endif // BASE__DESKTOP__BENCHMARK_FRAME_SOURCE_H
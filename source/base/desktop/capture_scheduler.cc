@@ -18,8 +18,24 @@
 
 #include "base/desktop/capture_scheduler.h"
 
+#include <algorithm>
+
 namespace base {
 
+namespace {
+
+// The interval starts to grow after this number of captures without changes.
+const int kIdleCountBeforeBackoff = 2;
+const int kMaxBackoffShift = 5;
+
+} // namespace
+
+// static
+const std::chrono::milliseconds CaptureScheduler::kMinCaptureInterval { 10 };
+
+// static
+const std::chrono::milliseconds CaptureScheduler::kMaxIdleInterval { 500 };
+
 CaptureScheduler::CaptureScheduler(const std::chrono::milliseconds& update_interval)
     : update_interval_(update_interval)
 {
@@ -38,23 +54,63 @@ std::chrono::milliseconds CaptureScheduler::updateInterval() const
 
 void CaptureScheduler::beginCapture()
 {
-    begin_time_ = std::chrono::high_resolution_clock::now();
+    begin_time_ = Clock::now();
+    wakeup_ = false;
+}
+
+void CaptureScheduler::endCapture(bool has_changes)
+{
+    end_time_ = Clock::now();
+
+    if (has_changes)
+        idle_count_ = 0;
+    else
+        idle_count_ = std::min(idle_count_ + 1, kIdleCountBeforeBackoff + kMaxBackoffShift);
 }
 
-void CaptureScheduler::endCapture()
+void CaptureScheduler::onInputEvent()
 {
-    end_time_ = std::chrono::high_resolution_clock::now();
+    // The screen is likely to change in response to the input.
+    idle_count_ = 0;
+    wakeup_ = true;
+}
+
+void CaptureScheduler::onDamage()
+{
+    wakeup_ = true;
 }
 
 std::chrono::milliseconds CaptureScheduler::nextCaptureDelay() const
 {
+    if (wakeup_)
+    {
+        // Captures are not started more often than kMinCaptureInterval, otherwise a stream of
+        // mouse moves would make the capture run continuously.
+        std::chrono::milliseconds elapsed_time =
+            std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - begin_time_);
+
+        if (elapsed_time >= kMinCaptureInterval)
+            return std::chrono::milliseconds::zero();
+
+        return kMinCaptureInterval - elapsed_time;
+    }
+
+    std::chrono::milliseconds interval = update_interval_;
+
+    if (idle_count_ > kIdleCountBeforeBackoff)
+    {
+        const int shift = std::min(idle_count_ - kIdleCountBeforeBackoff, kMaxBackoffShift);
+        interval = std::max(std::min(update_interval_ * (1 << shift), kMaxIdleInterval),
+                            update_interval_);
+    }
+
     std::chrono::milliseconds diff_time =
         std::chrono::duration_cast<std::chrono::milliseconds>(end_time_ - begin_time_);
 
-    if (diff_time > update_interval_)
-        diff_time = update_interval_;
+    if (diff_time > interval)
+        diff_time = interval;
 
-    return update_interval_ - diff_time;
+    return interval - diff_time;
 }
 
 } // namespace base
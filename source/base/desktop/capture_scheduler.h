@@ -25,23 +25,45 @@
 
 namespace base {
 
+// Calculates the delay before the next screen capture. Captures go with |update_interval| while
+// the screen changes. If the screen stays the same, the interval grows exponentially up to
+// kMaxIdleInterval. An input event or a damage notification from the capturer makes the next
+// capture happen as soon as possible.
 class CaptureScheduler
 {
 public:
     explicit CaptureScheduler(const std::chrono::milliseconds& update_interval);
     ~CaptureScheduler() = default;
 
+    static const std::chrono::milliseconds kMinCaptureInterval;
+    static const std::chrono::milliseconds kMaxIdleInterval;
+
     void setUpdateInterval(const std::chrono::milliseconds& update_interval);
     std::chrono::milliseconds updateInterval() const;
 
     void beginCapture();
-    void endCapture();
+
+    // |has_changes| is false if the captured frame is the same as the previous one.
+    void endCapture(bool has_changes);
+
+    void onInputEvent();
+    void onDamage();
+
     std::chrono::milliseconds nextCaptureDelay() const;
 
 private:
+    using Clock = std::chrono::high_resolution_clock;
+    using TimePoint = std::chrono::time_point<Clock>;
+
     std::chrono::milliseconds update_interval_;
-    std::chrono::time_point<std::chrono::high_resolution_clock> begin_time_;
-    std::chrono::time_point<std::chrono::high_resolution_clock> end_time_;
+    TimePoint begin_time_;
+    TimePoint end_time_;
+
+    // Number of captures in a row without changes on the screen.
+    int idle_count_ = 0;
+
+    // An input event or a damage notification came after the beginning of the last capture.
+    bool wakeup_ = false;
 
     DISALLOW_COPY_AND_ASSIGN(CaptureScheduler);
 };
@@ -0,0 +1,91 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/capture_scheduler.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+const std::chrono::milliseconds kUpdateInterval { 40 };
+
+void captureFrames(CaptureScheduler* scheduler, int count, bool has_changes)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        scheduler->beginCapture();
+        scheduler->endCapture(has_changes);
+    }
+}
+
+} // namespace
+
+TEST(capture_scheduler_test, changing_screen_uses_update_interval)
+{
+    CaptureScheduler scheduler(kUpdateInterval);
+    captureFrames(&scheduler, 10, true);
+
+    EXPECT_LE(scheduler.nextCaptureDelay(), kUpdateInterval);
+    EXPECT_GT(scheduler.nextCaptureDelay(), kUpdateInterval / 2);
+}
+
+TEST(capture_scheduler_test, idle_screen_backs_off)
+{
+    CaptureScheduler scheduler(kUpdateInterval);
+
+    captureFrames(&scheduler, 3, false);
+    const std::chrono::milliseconds first_delay = scheduler.nextCaptureDelay();
+    EXPECT_GT(first_delay, kUpdateInterval);
+
+    captureFrames(&scheduler, 100, false);
+    const std::chrono::milliseconds last_delay = scheduler.nextCaptureDelay();
+    EXPECT_GT(last_delay, first_delay);
+    EXPECT_LE(last_delay, CaptureScheduler::kMaxIdleInterval);
+
+    captureFrames(&scheduler, 1, true);
+    EXPECT_LE(scheduler.nextCaptureDelay(), kUpdateInterval);
+}
+
+TEST(capture_scheduler_test, input_wakes_capture)
+{
+    CaptureScheduler scheduler(kUpdateInterval);
+    captureFrames(&scheduler, 100, false);
+
+    scheduler.onInputEvent();
+    EXPECT_LE(scheduler.nextCaptureDelay(), CaptureScheduler::kMinCaptureInterval);
+
+    // After the capture the backoff starts from the beginning.
+    captureFrames(&scheduler, 1, false);
+    EXPECT_LE(scheduler.nextCaptureDelay(), kUpdateInterval);
+}
+
+TEST(capture_scheduler_test, damage_wakes_capture)
+{
+    CaptureScheduler scheduler(kUpdateInterval);
+    captureFrames(&scheduler, 100, false);
+
+    scheduler.onDamage();
+    EXPECT_LE(scheduler.nextCaptureDelay(), CaptureScheduler::kMinCaptureInterval);
+
+    scheduler.beginCapture();
+    EXPECT_GT(scheduler.nextCaptureDelay(), kUpdateInterval);
+}
+
+} // namespace base
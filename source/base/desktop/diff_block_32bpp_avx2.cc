@@ -0,0 +1,97 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/diff_block_32bpp_avx2.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif // defined(CC_*)
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+namespace base {
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+uint8_t diffFullBlock_32bpp_32x32_AVX2(
+    const uint8_t* image1, const uint8_t* image2, int bytes_per_row)
+{
+    for (int i = 0; i < 32; ++i)
+    {
+        const __m256i* i1 = reinterpret_cast<const __m256i*>(image1);
+        const __m256i* i2 = reinterpret_cast<const __m256i*>(image2);
+
+        // Row of 32 pixels is 128 bytes. Bits that differ in the images are set in XOR.
+        __m256i diff01 = _mm256_or_si256(
+            _mm256_xor_si256(_mm256_loadu_si256(i1 + 0), _mm256_loadu_si256(i2 + 0)),
+            _mm256_xor_si256(_mm256_loadu_si256(i1 + 1), _mm256_loadu_si256(i2 + 1)));
+
+        __m256i diff23 = _mm256_or_si256(
+            _mm256_xor_si256(_mm256_loadu_si256(i1 + 2), _mm256_loadu_si256(i2 + 2)),
+            _mm256_xor_si256(_mm256_loadu_si256(i1 + 3), _mm256_loadu_si256(i2 + 3)));
+
+        __m256i diff = _mm256_or_si256(diff01, diff23);
+
+        // If the row has differences.
+        if (!_mm256_testz_si256(diff, diff))
+            return 1U;
+
+        image1 += bytes_per_row;
+        image2 += bytes_per_row;
+    }
+
+    return 0U;
+}
+
+uint8_t diffFullBlock_32bpp_16x16_AVX2(
+    const uint8_t* image1, const uint8_t* image2, int bytes_per_row)
+{
+    // Two rows of 16 pixels (64 bytes each) are checked per iteration.
+    for (int i = 0; i < 16; i += 2)
+    {
+        const __m256i* i1 = reinterpret_cast<const __m256i*>(image1);
+        const __m256i* i2 = reinterpret_cast<const __m256i*>(image2);
+        const __m256i* n1 = reinterpret_cast<const __m256i*>(image1 + bytes_per_row);
+        const __m256i* n2 = reinterpret_cast<const __m256i*>(image2 + bytes_per_row);
+
+        __m256i diff0 = _mm256_or_si256(
+            _mm256_xor_si256(_mm256_loadu_si256(i1 + 0), _mm256_loadu_si256(i2 + 0)),
+            _mm256_xor_si256(_mm256_loadu_si256(i1 + 1), _mm256_loadu_si256(i2 + 1)));
+
+        __m256i diff1 = _mm256_or_si256(
+            _mm256_xor_si256(_mm256_loadu_si256(n1 + 0), _mm256_loadu_si256(n2 + 0)),
+            _mm256_xor_si256(_mm256_loadu_si256(n1 + 1), _mm256_loadu_si256(n2 + 1)));
+
+        __m256i diff = _mm256_or_si256(diff0, diff1);
+
+        // If the rows have differences.
+        if (!_mm256_testz_si256(diff, diff))
+            return 1U;
+
+        image1 += bytes_per_row * 2;
+        image2 += bytes_per_row * 2;
+    }
+
+    return 0U;
+}
+
+#endif // defined(ARCH_CPU_X86_FAMILY)
+
+} // namespace base
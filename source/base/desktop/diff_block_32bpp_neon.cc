@@ -0,0 +1,75 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/diff_block_32bpp_neon.h"
+
+#if defined(ARCH_CPU_ARM64)
+#include <arm_neon.h>
+#endif // defined(ARCH_CPU_ARM64)
+
+namespace base {
+
+#if defined(ARCH_CPU_ARM64)
+
+uint8_t diffFullBlock_32bpp_32x32_NEON(
+    const uint8_t* image1, const uint8_t* image2, int bytes_per_row)
+{
+    for (int i = 0; i < 32; ++i)
+    {
+        // Row of 32 pixels is 128 bytes. Bits that differ in the images are set in XOR.
+        uint8x16_t diff = veorq_u8(vld1q_u8(image1), vld1q_u8(image2));
+
+        for (int offset = 16; offset < 128; offset += 16)
+            diff = vorrq_u8(diff, veorq_u8(vld1q_u8(image1 + offset), vld1q_u8(image2 + offset)));
+
+        // If the row has differences.
+        if (vmaxvq_u8(diff))
+            return 1U;
+
+        image1 += bytes_per_row;
+        image2 += bytes_per_row;
+    }
+
+    return 0U;
+}
+
+uint8_t diffFullBlock_32bpp_16x16_NEON(
+    const uint8_t* image1, const uint8_t* image2, int bytes_per_row)
+{
+    for (int i = 0; i < 16; ++i)
+    {
+        // Row of 16 pixels is 64 bytes.
+        uint8x16_t diff01 = vorrq_u8(veorq_u8(vld1q_u8(image1 + 0), vld1q_u8(image2 + 0)),
+                                     veorq_u8(vld1q_u8(image1 + 16), vld1q_u8(image2 + 16)));
+        uint8x16_t diff23 = vorrq_u8(veorq_u8(vld1q_u8(image1 + 32), vld1q_u8(image2 + 32)),
+                                     veorq_u8(vld1q_u8(image1 + 48), vld1q_u8(image2 + 48)));
+
+        // If the row has differences.
+        if (vmaxvq_u8(vorrq_u8(diff01, diff23)))
+            return 1U;
+
+        image1 += bytes_per_row;
+        image2 += bytes_per_row;
+    }
+
+    return 0U;
+}
+
+#endif // defined(ARCH_CPU_ARM64)
+
+} // namespace base
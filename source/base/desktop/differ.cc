@@ -19,10 +19,17 @@
 #include "base/desktop/differ.h"
 
 #include "base/logging.h"
+#include "base/trace_event.h"
+#include "base/desktop/diff_block_32bpp_avx2.h"
+#include "base/desktop/diff_block_32bpp_neon.h"
 #include "base/desktop/diff_block_32bpp_sse2.h"
 #include "base/desktop/diff_block_32bpp_c.h"
+#include "base/threading/simple_thread.h"
 
+#include <algorithm>
+#include <condition_variable>
 #include <cstring>
+#include <mutex>
 #include <libyuv/cpu_id.h>
 
 namespace base {
@@ -33,6 +40,23 @@ const int kBlockSize = 16;
 const int kBytesPerPixel = 4;
 const int kBytesPerBlock = kBlockSize * kBytesPerPixel;
 
+// Frames are split into stripes only if each stripe gets at least that number of pixels. For
+// smaller frames waking up the worker threads costs more than the parallel scan saves.
+const int kMinPixelsPerStripe = 1920 * 1080;
+const int kMinRowsPerStripe = 8;
+const int kMaxStripeCount = 4;
+
+int calcStripeCount(const Size& size, int diff_height)
+{
+    const int64_t pixels = static_cast<int64_t>(size.width()) * size.height();
+
+    int64_t count = std::min<int64_t>(kMaxStripeCount, pixels / kMinPixelsPerStripe);
+    count = std::min<int64_t>(count, diff_height / kMinRowsPerStripe);
+    count = std::min<int64_t>(count, std::thread::hardware_concurrency());
+
+    return std::max(static_cast<int>(count), 1);
+}
+
 // Check for diffs in upper-left portion of the block. The size of the portion to check is
 // specified by the |width| and |height| values.
 // Note that if we force the capturer to always return images whose width and height are multiples
@@ -55,15 +79,137 @@ uint8_t diffPartialBlock(const uint8_t* prev_image,
     return 0U;
 }
 
+} // namespace
 
+// Range of block rows of the frame that is marked and merged independently of other stripes.
+// The first stripe is processed on the calling thread, the others on their own threads.
+class Differ::Stripe
+{
+public:
+    Stripe(Differ* differ, int first_row, int last_row, bool use_thread);
+    ~Stripe();
+
+    // Starts processing of the stripe.
+    void start(const uint8_t* prev_image, const uint8_t* curr_image);
+
+    // Waits for the processing to complete and returns the dirty region of the stripe.
+    const Region& finish();
+
+private:
+    void run();
+    void process();
+
+    Differ* differ_;
+    const int first_row_;
+    const int last_row_;
+
+    std::unique_ptr<SimpleThread> thread_;
+    std::mutex lock_;
+    std::condition_variable work_event_;
+    std::condition_variable done_event_;
+    bool has_work_ = false;
+    bool terminate_ = false;
+
+    const uint8_t* prev_image_ = nullptr;
+    const uint8_t* curr_image_ = nullptr;
+    Region region_;
+
+    DISALLOW_COPY_AND_ASSIGN(Stripe);
+};
+
+Differ::Stripe::Stripe(Differ* differ, int first_row, int last_row, bool use_thread)
+    : differ_(differ),
+      first_row_(first_row),
+      last_row_(last_row)
+{
+    if (use_thread)
+    {
+        thread_ = std::make_unique<SimpleThread>();
+        thread_->start(std::bind(&Stripe::run, this));
+    }
+}
 
-} // namespace
+Differ::Stripe::~Stripe()
+{
+    if (!thread_)
+        return;
+
+    {
+        std::unique_lock lock(lock_);
+        terminate_ = true;
+    }
+
+    work_event_.notify_one();
+    thread_->stop();
+}
+
+void Differ::Stripe::start(const uint8_t* prev_image, const uint8_t* curr_image)
+{
+    std::unique_lock lock(lock_);
+
+    DCHECK(!has_work_);
+
+    prev_image_ = prev_image;
+    curr_image_ = curr_image;
+    has_work_ = true;
+
+    if (thread_)
+    {
+        lock.unlock();
+        work_event_.notify_one();
+    }
+}
+
+const Region& Differ::Stripe::finish()
+{
+    if (!thread_)
+    {
+        process();
+        has_work_ = false;
+        return region_;
+    }
+
+    std::unique_lock lock(lock_);
+    while (has_work_)
+        done_event_.wait(lock);
+
+    return region_;
+}
+
+void Differ::Stripe::run()
+{
+    std::unique_lock lock(lock_);
+
+    while (true)
+    {
+        while (!has_work_ && !terminate_)
+            work_event_.wait(lock);
+
+        if (terminate_)
+            return;
+
+        lock.unlock();
+        process();
+        lock.lock();
+
+        has_work_ = false;
+        done_event_.notify_one();
+    }
+}
+
+void Differ::Stripe::process()
+{
+    region_.clear();
+
+    differ_->markDirtyBlocks(prev_image_, curr_image_, first_row_, last_row_);
+    differ_->mergeBlocks(first_row_, last_row_, &region_);
+}
 
 Differ::Differ(const Size& size)
-    : screen_rect_(Rect::makeSize(size)),
-      bytes_per_row_(size.width() * kBytesPerPixel),
-      diff_width_(((size.width() + kBlockSize - 1) / kBlockSize) + 1),
-      diff_height_(((size.height() + kBlockSize - 1) / kBlockSize) + 1),
+    : bytes_per_row_(size.width() * kBytesPerPixel),
+      dirty_blocks_(size, kBlockSize),
+      diff_width_(dirty_blocks_.columns()),
+      diff_height_(dirty_blocks_.rows()),
       full_blocks_x_(size.width() / kBlockSize),
       full_blocks_y_(size.height() / kBlockSize)
 {
@@ -72,11 +218,6 @@ Differ::Differ(const Size& size)
     LOG(LS_INFO) << "Diff size: " << diff_width_ << "x" << diff_height_;
     LOG(LS_INFO) << "Full blocks: " << full_blocks_x_ << "x" << full_blocks_y_;
 
-    const size_t diff_info_size = static_cast<size_t>(diff_width_ * diff_height_);
-
-    diff_info_ = std::make_unique<uint8_t[]>(diff_info_size);
-    memset(diff_info_.get(), 0, diff_info_size);
-
     // Calc size of partial blocks which may be present on right and bottom edge.
     partial_column_width_ = size.width() - (full_blocks_x_ * kBlockSize);
     partial_row_height_ = size.height() - (full_blocks_y_ * kBlockSize);
@@ -91,47 +232,84 @@ Differ::Differ(const Size& size)
 
     diff_full_block_func_ = diffFunction();
     CHECK(diff_full_block_func_);
+
+    const int stripe_count = calcStripeCount(size, diff_height_);
+    if (stripe_count > 1)
+    {
+        const int rows_per_stripe = (diff_height_ + stripe_count - 1) / stripe_count;
+
+        for (int first_row = 0; first_row < diff_height_; first_row += rows_per_stripe)
+        {
+            const int last_row = std::min(first_row + rows_per_stripe, diff_height_);
+            stripes_.emplace_back(
+                std::make_unique<Stripe>(this, first_row, last_row, !stripes_.empty()));
+        }
+
+        LOG(LS_INFO) << "Frame stripes: " << stripes_.size();
+    }
 }
 
+Differ::~Differ() = default;
+
 // static
 Differ::DiffFullBlockFunc Differ::diffFunction()
 {
-    if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
-    {
 #if defined(ARCH_CPU_X86_FAMILY)
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
+    {
+        LOG(LS_INFO) << "AVX2 differ loaded";
+
+        if constexpr (kBlockSize == 16)
+            return diffFullBlock_32bpp_16x16_AVX2;
+        else if constexpr (kBlockSize == 32)
+            return diffFullBlock_32bpp_32x32_AVX2;
+    }
+    else if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+    {
         LOG(LS_INFO) << "SSE2 differ loaded";
 
         if constexpr (kBlockSize == 16)
             return diffFullBlock_32bpp_16x16_SSE2;
         else if constexpr (kBlockSize == 32)
             return diffFullBlock_32bpp_32x32_SSE2;
-#endif // defined(ARCH_CPU_X86_FAMILY)
     }
-    else
+#elif defined(ARCH_CPU_ARM64)
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasNEON))
     {
-        LOG(LS_INFO) << "C differ loaded";
+        LOG(LS_INFO) << "NEON differ loaded";
 
         if constexpr (kBlockSize == 16)
-            return diffFullBlock_32bpp_16x16_C;
+            return diffFullBlock_32bpp_16x16_NEON;
         else if constexpr (kBlockSize == 32)
-            return diffFullBlock_32bpp_32x32_C;
+            return diffFullBlock_32bpp_32x32_NEON;
     }
+#endif // defined(ARCH_CPU_*)
+
+    LOG(LS_INFO) << "C differ loaded";
+
+    if constexpr (kBlockSize == 16)
+        return diffFullBlock_32bpp_16x16_C;
+    else if constexpr (kBlockSize == 32)
+        return diffFullBlock_32bpp_32x32_C;
 
     return nullptr;
 }
 
 // Identify all of the blocks that contain changed pixels.
-void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_image)
+void Differ::markDirtyBlocks(const uint8_t* prev_image,
+                             const uint8_t* curr_image,
+                             int first_row,
+                             int last_row)
 {
-    const uint8_t* prev_block_row_start = prev_image;
-    const uint8_t* curr_block_row_start = curr_image;
+    const uint8_t* prev_block_row_start = prev_image + first_row * block_stride_y_;
+    const uint8_t* curr_block_row_start = curr_image + first_row * block_stride_y_;
 
-    // Offset from the start of one diff_info row to the next.
+    // Offset from the start of one row of the block map to the next.
     const int diff_stride = diff_width_;
 
-    uint8_t* is_diff_row_start = diff_info_.get();
+    uint8_t* is_diff_row_start = dirty_blocks_.data() + first_row * diff_stride;
 
-    for (int y = 0; y < full_blocks_y_; ++y)
+    for (int y = first_row; y < std::min(last_row, full_blocks_y_); ++y)
     {
         const uint8_t* prev_block = prev_block_row_start;
         const uint8_t* curr_block = curr_block_row_start;
@@ -169,7 +347,7 @@ void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_imag
 
     // If the screen height is not a multiple of the block size, then this handles the last partial
     // row. This situation is far more common than the 'partial column' case.
-    if (partial_row_height_ != 0)
+    if (partial_row_height_ != 0 && first_row <= full_blocks_y_ && last_row > full_blocks_y_)
     {
         const uint8_t* prev_block = prev_block_row_start;
         const uint8_t* curr_block = curr_block_row_start;
@@ -202,100 +380,38 @@ void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_imag
 }
 
 // After the dirty blocks have been identified, this routine merges adjacent blocks into a region.
-// The goal is to minimize the region that covers the dirty blocks.
-void Differ::mergeBlocks(Region* dirty_region)
+// The region is built from the rows of the blocks in one pass, the adjacent rows with the same
+// blocks become one rectangle.
+void Differ::mergeBlocks(int first_row, int last_row, Region* dirty_region)
 {
-    uint8_t* is_diff_row_start = diff_info_.get();
-    const int diff_stride = diff_width_;
-
-    for (int y = 0; y < diff_height_; ++y)
-    {
-        uint8_t* is_different = is_diff_row_start;
-
-        for (int x = 0; x < diff_width_; ++x)
-        {
-            // We've found a modified block. Look at blocks to the right and below to group this
-            // block with as many others as we can.
-            if (*is_different != 0)
-            {
-                // Width and height of the rectangle in blocks.
-                int width  = 1;
-                int height = 1;
-
-                *is_different = 0;
-
-                // Group with blocks to the right. We can keep looking until we find an unchanged
-                // block because we have a boundary block which is never marked as having diffs.
-                uint8_t* right = is_different + 1;
-
-                while (*right != 0)
-                {
-                    *right++ = 0;
-                    ++width;
-                }
-
-                // Group with blocks below. The entire width of blocks that we matched above much
-                // match for each row that we add.
-                uint8_t* bottom = is_different;
-                bool found_new_row;
-
-                do
-                {
-                    found_new_row = true;
-                    bottom += diff_stride;
-                    right = bottom;
-
-                    for (int x2 = 0; x2 < width; ++x2)
-                    {
-                        if (*right++ == 0)
-                            found_new_row = false;
-                    }
-
-                    if (found_new_row)
-                    {
-                        ++height;
-
-                        // We need to go back and erase the diff markers so that we don't try to
-                        // add these blocks a second time.
-                        right = bottom;
-
-                        for (int x2 = 0; x2 < width; ++x2)
-                        {
-                            *right++ = 0;
-                        }
-                    }
-                } while (found_new_row);
-
-                Rect dirty_rect = Rect::makeXYWH(x * kBlockSize, y * kBlockSize,
-                                                 width * kBlockSize, height * kBlockSize);
-
-                dirty_rect.intersectWith(screen_rect_);
-
-                // Add rect to region.
-                dirty_region->addRect(dirty_rect);
-            }
-
-            // Increment to next block in this row.
-            ++is_different;
-        }
-
-        // Go to start of next row.
-        is_diff_row_start += diff_stride;
-    }
+    *dirty_region = dirty_blocks_.toRegion(first_row, last_row);
 }
 
 void Differ::calcDirtyRegion(const uint8_t* prev_image,
                              const uint8_t* curr_image,
                              Region* dirty_region)
 {
+    TRACE_EVENT("Differ::calcDirtyRegion");
+
     dirty_region->clear();
 
-    // Identify all the blocks that contain changed pixels.
-    markDirtyBlocks(prev_image, curr_image);
+    if (stripes_.empty())
+    {
+        // Identify all the blocks that contain changed pixels.
+        markDirtyBlocks(prev_image, curr_image, 0, diff_height_);
+
+        // Now that we've identified the blocks that have changed, merge adjacent blocks to
+        // minimize the number of rects that we return.
+        mergeBlocks(0, diff_height_, dirty_region);
+        return;
+    }
+
+    for (auto& stripe : stripes_)
+        stripe->start(prev_image, curr_image);
 
-    // Now that we've identified the blocks that have changed, merge adjacent blocks to minimize
-    // the number of rects that we return.
-    mergeBlocks(dirty_region);
+    // Rectangles of neighboring stripes are joined when the regions are added together.
+    for (auto& stripe : stripes_)
+        dirty_region->addRegion(stripe->finish());
 }
 
 } // namespace base
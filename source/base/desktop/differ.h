@@ -20,18 +20,20 @@
 #define BASE__DESKTOP__DIFFER_H
 
 #include "base/macros_magic.h"
-#include "base/desktop/region.h"
+#include "base/desktop/dirty_block_map.h"
 
 #include <memory>
+#include <vector>
 
 namespace base {
 
 // Class to search for changed regions of the screen.
+// Large frames are split into horizontal stripes which are processed in parallel.
 class Differ
 {
 public:
     explicit Differ(const Size& size);
-    ~Differ() = default;
+    ~Differ();
 
     void calcDirtyRegion(const uint8_t* prev_image,
                          const uint8_t* curr_image,
@@ -42,11 +44,20 @@ private:
 
     static DiffFullBlockFunc diffFunction();
 
-    void markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_image);
-    void mergeBlocks(Region* dirty_region);
+    class Stripe;
+
+    // Processes block rows in range [|first_row|; |last_row|).
+    void markDirtyBlocks(const uint8_t* prev_image,
+                         const uint8_t* curr_image,
+                         int first_row,
+                         int last_row);
+    void mergeBlocks(int first_row, int last_row, Region* dirty_region);
 
-    const Rect screen_rect_;
     const int bytes_per_row_;
+
+    // The blocks are marked by the stripes, each stripe writes only its own rows.
+    DirtyBlockMap dirty_blocks_;
+
     const int diff_width_;
     const int diff_height_;
     const int full_blocks_x_;
@@ -56,9 +67,10 @@ private:
     int partial_row_height_;
     int block_stride_y_;
 
-    std::unique_ptr<uint8_t[]> diff_info_;
     DiffFullBlockFunc diff_full_block_func_;
 
+    std::vector<std::unique_ptr<Stripe>> stripes_;
+
     DISALLOW_COPY_AND_ASSIGN(Differ);
 };
 
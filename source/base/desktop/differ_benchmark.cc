@@ -0,0 +1,63 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/benchmark_frame_source.h"
+#include "base/desktop/differ.h"
+#include "base/desktop/frame.h"
+
+#include <benchmark/benchmark.h>
+
+namespace base {
+
+namespace {
+
+const Size kFrameSize(1920, 1080);
+
+void BM_Differ(benchmark::State& state)
+{
+    BenchmarkFrameSource::Scene scene = static_cast<BenchmarkFrameSource::Scene>(state.range(0));
+    BenchmarkFrameSource source(scene, kFrameSize);
+    Differ differ(kFrameSize);
+    Region changed_region;
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        const Frame* frame = source.nextFrame();
+        changed_region.clear();
+        state.ResumeTiming();
+
+        differ.calcDirtyRegion(source.previousFrame()->frameData(), frame->frameData(),
+                               &changed_region);
+        benchmark::DoNotOptimize(changed_region);
+    }
+
+    state.SetLabel(BenchmarkFrameSource::sceneName(scene));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            kFrameSize.width() * kFrameSize.height() * 4);
+}
+
+BENCHMARK(BM_Differ)
+    ->Arg(static_cast<int>(BenchmarkFrameSource::Scene::OFFICE))
+    ->Arg(static_cast<int>(BenchmarkFrameSource::Scene::VIDEO))
+    ->Arg(static_cast<int>(BenchmarkFrameSource::Scene::SCROLLING))
+    ->Unit(benchmark::kMicrosecond);
+
+} // namespace
+
+} // namespace base
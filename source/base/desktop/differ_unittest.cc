@@ -0,0 +1,113 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/differ.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+const int kBytesPerPixel = 4;
+const int kBlockSize = 16;
+
+class DifferTest
+{
+public:
+    explicit DifferTest(const Size& size)
+        : size_(size),
+          prev_(static_cast<size_t>(size.width() * size.height() * kBytesPerPixel)),
+          curr_(prev_.size()),
+          differ_(size)
+    {
+        for (size_t i = 0; i < prev_.size(); ++i)
+            prev_[i] = static_cast<uint8_t>(i);
+
+        memcpy(curr_.data(), prev_.data(), prev_.size());
+    }
+
+    void changePixel(int x, int y)
+    {
+        curr_[static_cast<size_t>((y * size_.width() + x) * kBytesPerPixel)] += 1;
+    }
+
+    Region calcDirtyRegion()
+    {
+        Region region;
+        differ_.calcDirtyRegion(prev_.data(), curr_.data(), &region);
+        return region;
+    }
+
+private:
+    const Size size_;
+    std::vector<uint8_t> prev_;
+    std::vector<uint8_t> curr_;
+    Differ differ_;
+};
+
+Rect blockRect(int x, int y, int width, int height, const Size& size)
+{
+    Rect rect = Rect::makeXYWH(x * kBlockSize, y * kBlockSize,
+                               width * kBlockSize, height * kBlockSize);
+    rect.intersectWith(Rect::makeSize(size));
+    return rect;
+}
+
+} // namespace
+
+TEST(differ_test, same_frames)
+{
+    DifferTest test(Size(640, 480));
+    EXPECT_TRUE(test.calcDirtyRegion().isEmpty());
+}
+
+TEST(differ_test, partial_blocks)
+{
+    const Size size(100, 50);
+    DifferTest test(size);
+
+    test.changePixel(99, 49);
+    EXPECT_TRUE(test.calcDirtyRegion().equals(Region(blockRect(6, 3, 1, 1, size))));
+}
+
+TEST(differ_test, large_frame)
+{
+    // The frame is large enough to be processed in several stripes. The changed area crosses the
+    // borders of the stripes.
+    const Size size(5120, 2880);
+    DifferTest test(size);
+
+    for (int y = 0; y < size.height(); y += kBlockSize)
+        test.changePixel(kBlockSize * 10 + 1, y + 1);
+
+    test.changePixel(size.width() - 1, size.height() - 1);
+
+    Region expected;
+    expected.addRect(blockRect(10, 0, 1, size.height() / kBlockSize, size));
+    expected.addRect(blockRect(size.width() / kBlockSize - 1, size.height() / kBlockSize - 1,
+                               1, 1, size));
+
+    for (int i = 0; i < 3; ++i)
+        EXPECT_TRUE(test.calcDirtyRegion().equals(expected));
+}
+
+} // namespace base
@@ -0,0 +1,101 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/dirty_block_map.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace base {
+
+DirtyBlockMap::DirtyBlockMap(const Size& size, int block_size)
+{
+    reset(size, block_size);
+}
+
+void DirtyBlockMap::reset(const Size& size, int block_size)
+{
+    DCHECK_GT(block_size, 0);
+
+    size_ = size;
+    block_size_ = block_size;
+    columns_ = (std::max(size.width(), 0) + block_size - 1) / block_size;
+    rows_ = (std::max(size.height(), 0) + block_size - 1) / block_size;
+
+    map_.assign(static_cast<size_t>(columns_) * static_cast<size_t>(rows_), 0);
+}
+
+void DirtyBlockMap::clear()
+{
+    if (!map_.empty())
+        memset(map_.data(), 0, map_.size());
+}
+
+void DirtyBlockMap::markRect(const Rect& rect)
+{
+    Rect clipped = rect;
+    clipped.intersectWith(Rect::makeSize(size_));
+    if (clipped.isEmpty())
+        return;
+
+    const int left = clipped.left() / block_size_;
+    const int top = clipped.top() / block_size_;
+    const int right = (clipped.right() - 1) / block_size_;
+    const int bottom = (clipped.bottom() - 1) / block_size_;
+
+    uint8_t* row = map_.data() + index(left, top);
+
+    for (int y = top; y <= bottom; ++y)
+    {
+        memset(row, 1, static_cast<size_t>(right - left + 1));
+        row += columns_;
+    }
+}
+
+void DirtyBlockMap::markRegion(const Region& region)
+{
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        markRect(it.rect());
+}
+
+Region DirtyBlockMap::toRegion() const
+{
+    return toRegion(0, rows_);
+}
+
+Region DirtyBlockMap::toRegion(int first_row, int last_row) const
+{
+    if (map_.empty())
+        return Region();
+
+    return Region::fromBlockMap(map_.data(), columns_,
+                                Rect::makeLTRB(0, first_row, columns_, last_row),
+                                block_size_, Rect::makeSize(size_));
+}
+
+Rect DirtyBlockMap::blockRect(int column, int row) const
+{
+    Rect rect = Rect::makeXYWH(
+        column * block_size_, row * block_size_, block_size_, block_size_);
+    rect.intersectWith(Rect::makeSize(size_));
+    return rect;
+}
+
+} // namespace base
@@ -0,0 +1,85 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__DESKTOP__DIRTY_BLOCK_MAP_H
+#define BASE__DESKTOP__DIRTY_BLOCK_MAP_H
+
+#include "base/desktop/region.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace base {
+
+// Changes of a frame as a map of square blocks, one byte per block (non-zero if the block has
+// changed). The rows of the map follow each other without padding, so the map can be passed as is
+// to the encoders that take such maps (for example the active map of libvpx). The blocks of the
+// right column and the bottom row may be partially outside the frame.
+class DirtyBlockMap
+{
+public:
+    DirtyBlockMap() = default;
+    DirtyBlockMap(const Size& size, int block_size);
+
+    // Resizes the map for a frame of |size| and clears it.
+    void reset(const Size& size, int block_size);
+
+    // Marks all blocks as unchanged.
+    void clear();
+
+    // Marks the blocks that intersect with |rect| or |region| as changed.
+    void markRect(const Rect& rect);
+    void markRegion(const Region& region);
+
+    bool isDirty(int column, int row) const { return map_[index(column, row)] != 0; }
+    void setDirty(int column, int row, bool dirty) { map_[index(column, row)] = dirty ? 1 : 0; }
+
+    // Returns the area of the changed blocks clipped by the frame. The second method returns only
+    // the rows in range [|first_row|; |last_row|).
+    Region toRegion() const;
+    Region toRegion(int first_row, int last_row) const;
+
+    // Returns the rectangle of the block in the frame.
+    Rect blockRect(int column, int row) const;
+
+    bool isEmpty() const { return map_.empty(); }
+    const Size& frameSize() const { return size_; }
+    int blockSize() const { return block_size_; }
+    int columns() const { return columns_; }
+    int rows() const { return rows_; }
+
+    uint8_t* data() { return map_.data(); }
+    const uint8_t* constData() const { return map_.data(); }
+
+private:
+    size_t index(int column, int row) const
+    {
+        return static_cast<size_t>(row) * static_cast<size_t>(columns_) +
+            static_cast<size_t>(column);
+    }
+
+    Size size_;
+    int block_size_ = 0;
+    int columns_ = 0;
+    int rows_ = 0;
+    std::vector<uint8_t> map_;
+};
+
+} // namespace base
+
+#endif // BASE__DESKTOP__DIRTY_BLOCK_MAP_H
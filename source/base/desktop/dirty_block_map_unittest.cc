@@ -0,0 +1,91 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/dirty_block_map.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(DirtyBlockMapTest, Size)
+{
+    DirtyBlockMap map(Size(100, 33), 16);
+
+    EXPECT_EQ(map.columns(), 7);
+    EXPECT_EQ(map.rows(), 3);
+    EXPECT_EQ(map.blockSize(), 16);
+
+    for (int row = 0; row < map.rows(); ++row)
+    {
+        for (int column = 0; column < map.columns(); ++column)
+            EXPECT_FALSE(map.isDirty(column, row));
+    }
+
+    // The blocks of the last column and row are clipped by the frame.
+    EXPECT_EQ(map.blockRect(6, 2), Rect::makeLTRB(96, 32, 100, 33));
+}
+
+TEST(DirtyBlockMapTest, MarkRect)
+{
+    DirtyBlockMap map(Size(100, 100), 16);
+
+    map.markRect(Rect::makeLTRB(15, 16, 17, 32));
+
+    for (int row = 0; row < map.rows(); ++row)
+    {
+        for (int column = 0; column < map.columns(); ++column)
+        {
+            const bool expected = row == 1 && (column == 0 || column == 1);
+            EXPECT_EQ(map.isDirty(column, row), expected) << column << "x" << row;
+        }
+    }
+
+    // The rectangles outside the frame are clipped.
+    map.clear();
+    map.markRect(Rect::makeLTRB(-50, 90, 20, 200));
+
+    EXPECT_TRUE(map.isDirty(0, 5));
+    EXPECT_TRUE(map.isDirty(1, 6));
+    EXPECT_FALSE(map.isDirty(2, 6));
+    EXPECT_FALSE(map.isDirty(0, 4));
+}
+
+TEST(DirtyBlockMapTest, ToRegion)
+{
+    const Size size(100, 70);
+    DirtyBlockMap map(size, 16);
+
+    Region region;
+    region.addRect(Rect::makeXYWH(3, 3, 20, 10));
+    region.addRect(Rect::makeXYWH(90, 60, 30, 30));
+    map.markRegion(region);
+
+    Region expected;
+    expected.addRect(Rect::makeLTRB(0, 0, 32, 16));
+    expected.addRect(Rect::makeLTRB(80, 48, 100, 70));
+
+    EXPECT_TRUE(map.toRegion().equals(expected));
+
+    // Only the requested rows.
+    EXPECT_TRUE(map.toRegion(1, map.rows()).equals(Region(Rect::makeLTRB(80, 48, 100, 70))));
+
+    map.clear();
+    EXPECT_TRUE(map.toRegion().isEmpty());
+}
+
+} // namespace base
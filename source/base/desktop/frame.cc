@@ -64,6 +64,34 @@ void Frame::copyPixelsFrom(const Frame& src_frame, const Point& src_pos, const R
     copyPixelsFrom(src_frame.frameDataAtPos(src_pos), src_frame.stride(), dest_rect);
 }
 
+void Frame::copyRect(const Point& src_pos, const Rect& dest_rect)
+{
+    DCHECK(Rect::makeSize(size()).containsRect(dest_rect));
+    DCHECK(Rect::makeSize(size()).containsRect(
+        Rect::makeXYWH(src_pos.x(), src_pos.y(), dest_rect.width(), dest_rect.height())));
+
+    const size_t bytes_per_row = static_cast<size_t>(format_.bytesPerPixel() * dest_rect.width());
+    const uint8_t* src = frameDataAtPos(src_pos);
+    uint8_t* dest = frameDataAtPos(dest_rect.topLeft());
+    int step = stride();
+
+    // When the area moves down, the rows are copied from the bottom so that the source rows are
+    // not overwritten before they are copied.
+    if (src_pos.y() < dest_rect.y())
+    {
+        src += (dest_rect.height() - 1) * step;
+        dest += (dest_rect.height() - 1) * step;
+        step = -step;
+    }
+
+    for (int y = 0; y < dest_rect.height(); ++y)
+    {
+        memmove(dest, src, bytes_per_row);
+        src += step;
+        dest += step;
+    }
+}
+
 uint8_t* Frame::frameDataAtPos(const Point& pos) const
 {
     return frameDataAtPos(pos.x(), pos.y());
@@ -77,9 +105,11 @@ uint8_t* Frame::frameDataAtPos(int x, int y) const
 void Frame::copyFrameInfoFrom(const Frame& other)
 {
     updated_region_ = other.updated_region_;
+    move_rects_ = other.move_rects_;
     top_left_ = other.top_left_;
     dpi_ = other.dpi_;
     capturer_type_ = other.capturer_type_;
+    capture_timing_ = other.capture_timing_;
 }
 
 // static
@@ -23,6 +23,9 @@
 #include "base/desktop/pixel_format.h"
 #include "base/desktop/region.h"
 
+#include <cstdint>
+#include <vector>
+
 namespace base {
 
 class SharedMemoryBase;
@@ -45,9 +48,26 @@ public:
     void copyPixelsFrom(const uint8_t* src_buffer, int src_stride, const Rect& dest_rect);
     void copyPixelsFrom(const Frame& src_frame, const Point& src_pos, const Rect& dest_rect);
 
+    // Copies the pixels of the frame from |src_pos| into |dest_rect|. The areas may overlap.
+    void copyRect(const Point& src_pos, const Rect& dest_rect);
+
     const Region& constUpdatedRegion() const { return updated_region_; }
     Region* updatedRegion() { return &updated_region_; }
 
+    // An area of the screen moved by the system (for example, when scrolling or dragging a window).
+    // |dest_rect| contains the pixels which were at |source_pos| before the move.
+    struct MoveRect
+    {
+        Point source_pos;
+        Rect dest_rect;
+    };
+
+    // The moved areas reported by the capturer. They are also included in the updated region.
+    // These are only hints: the source refers to the previous image of the screen seen by the
+    // capturer, which may differ from the previous frame seen by the consumer.
+    const std::vector<MoveRect>& constMoveRects() const { return move_rects_; }
+    std::vector<MoveRect>* moveRects() { return &move_rects_; }
+
     void setTopLeft(const Point& top_left) { top_left_ = top_left; }
     const Point& topLeft() const { return top_left_; }
 
@@ -57,6 +77,20 @@ public:
     void setCapturerType(uint32_t capturer_type) { capturer_type_ = capturer_type; }
     uint32_t capturerType() const { return capturer_type_; }
 
+    // Time of the capture in microseconds. |capture_time| is a time point of
+    // std::chrono::steady_clock or 0 if unknown. |capture_duration| includes |diff_duration|.
+    // |input_delay| is the average delay of the input events injected before the capture.
+    struct CaptureTiming
+    {
+        int64_t capture_time = 0;
+        int64_t capture_duration = 0;
+        int64_t diff_duration = 0;
+        int64_t input_delay = 0;
+    };
+
+    const CaptureTiming& constCaptureTiming() const { return capture_timing_; }
+    CaptureTiming* captureTiming() { return &capture_timing_; }
+
     // Copies various information from |other|. Anything initialized in constructor are not copied.
     // This function is usually used when sharing a source Frame with several clients: the original
     // Frame should be kept unchanged. For example and SharedFrame::share().
@@ -82,9 +116,11 @@ private:
     const int stride_;
 
     Region updated_region_;
+    std::vector<MoveRect> move_rects_;
     Point top_left_;
     Point dpi_;
     uint32_t capturer_type_ = 0;
+    CaptureTiming capture_timing_;
 
     DISALLOW_COPY_AND_ASSIGN(Frame);
 };
@@ -0,0 +1,433 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/frame_dump.h"
+
+#include "base/endian_util.h"
+#include "base/logging.h"
+#include "base/desktop/frame_simple.h"
+
+#include <zstd.h>
+
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+// The file starts with kFileMagic and kVersion. Each frame is a record header followed by the
+// changed rectangles, the moved areas and the compressed pixels of the rectangles. All values are
+// little-endian.
+const uint32_t kFileMagic = 0x44465341; // "ASFD"
+const uint32_t kVersion = 1;
+const uint32_t kFrameMagic = 0x4d415246; // "FRAM"
+
+// Magic, timestamp, width, height, rectangle count, move count, compressed size.
+const size_t kFileHeaderSize = 2 * sizeof(uint32_t);
+const size_t kRecordHeaderSize = sizeof(uint32_t) + sizeof(uint64_t) + 5 * sizeof(uint32_t);
+const size_t kRectSize = 4 * sizeof(uint32_t);
+const size_t kMoveSize = 6 * sizeof(uint32_t);
+
+const int kBytesPerPixel = 4;
+const int kCompressLevel = 1;
+const int32_t kMaxFrameDimension = 16384;
+const uint32_t kMaxRectCount = 1024 * 1024;
+const uint32_t kMaxCompressedSize = 256 * 1024 * 1024;
+
+void appendUint32(ByteArray* buffer, uint32_t value)
+{
+    value = EndianUtil::toLittle(value);
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(&value);
+    buffer->insert(buffer->end(), data, data + sizeof(value));
+}
+
+void appendUint64(ByteArray* buffer, uint64_t value)
+{
+    value = EndianUtil::toLittle(value);
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(&value);
+    buffer->insert(buffer->end(), data, data + sizeof(value));
+}
+
+void appendRect(ByteArray* buffer, const Rect& rect)
+{
+    appendUint32(buffer, static_cast<uint32_t>(rect.x()));
+    appendUint32(buffer, static_cast<uint32_t>(rect.y()));
+    appendUint32(buffer, static_cast<uint32_t>(rect.width()));
+    appendUint32(buffer, static_cast<uint32_t>(rect.height()));
+}
+
+uint32_t readUint32(const uint8_t** data)
+{
+    uint32_t value;
+    memcpy(&value, *data, sizeof(value));
+    *data += sizeof(value);
+    return EndianUtil::fromLittle(value);
+}
+
+uint64_t readUint64(const uint8_t** data)
+{
+    uint64_t value;
+    memcpy(&value, *data, sizeof(value));
+    *data += sizeof(value);
+    return EndianUtil::fromLittle(value);
+}
+
+int32_t readInt32(const uint8_t** data)
+{
+    return static_cast<int32_t>(readUint32(data));
+}
+
+Rect readRect(const uint8_t** data)
+{
+    const int32_t x = readInt32(data);
+    const int32_t y = readInt32(data);
+    const int32_t width = readInt32(data);
+    const int32_t height = readInt32(data);
+
+    return Rect::makeXYWH(x, y, width, height);
+}
+
+bool readBytes(std::ifstream* file, size_t size, ByteArray* buffer)
+{
+    buffer->resize(size);
+    if (!size)
+        return true;
+
+    return file->read(reinterpret_cast<char*>(buffer->data()),
+                      static_cast<std::streamsize>(size)).good();
+}
+
+} // namespace
+
+// static
+const int64_t FrameDumpWriter::kMaxFileSize = 4LL * 1024 * 1024 * 1024;
+
+FrameDumpWriter::FrameDumpWriter(std::ofstream&& file)
+    : file_(std::move(file))
+{
+    // Nothing
+}
+
+FrameDumpWriter::~FrameDumpWriter() = default;
+
+// static
+std::unique_ptr<FrameDumpWriter> FrameDumpWriter::create(const std::filesystem::path& file_path)
+{
+    std::ofstream file(file_path, std::ofstream::binary | std::ofstream::trunc);
+    if (!file.is_open())
+    {
+        LOG(LS_ERROR) << "Unable to create frame dump: " << file_path;
+        return nullptr;
+    }
+
+    ByteArray header;
+    appendUint32(&header, kFileMagic);
+    appendUint32(&header, kVersion);
+
+    if (!file.write(reinterpret_cast<const char*>(header.data()),
+                    static_cast<std::streamsize>(header.size())))
+    {
+        LOG(LS_ERROR) << "Unable to write frame dump: " << file_path;
+        return nullptr;
+    }
+
+    std::unique_ptr<FrameDumpWriter> writer(new FrameDumpWriter(std::move(file)));
+    writer->file_size_ = static_cast<int64_t>(header.size());
+    return writer;
+}
+
+bool FrameDumpWriter::addFrame(const Frame& frame, std::chrono::microseconds timestamp)
+{
+    if (frame.format().bytesPerPixel() != kBytesPerPixel)
+    {
+        LOG(LS_ERROR) << "Unsupported bytes per pixel: "
+                      << static_cast<int>(frame.format().bytesPerPixel());
+        return false;
+    }
+
+    const Rect frame_rect = Rect::makeSize(frame.size());
+    Region region;
+    std::vector<Frame::MoveRect> move_rects;
+
+    if (frame.size() != last_size_)
+    {
+        // The reader has no previous image of this size.
+        region.addRect(frame_rect);
+        last_size_ = frame.size();
+    }
+    else
+    {
+        region = frame.constUpdatedRegion();
+        region.intersectWith(frame_rect);
+
+        for (const Frame::MoveRect& move_rect : frame.constMoveRects())
+        {
+            const Rect source_rect =
+                Rect::makeXYWH(move_rect.source_pos, move_rect.dest_rect.size());
+
+            if (frame_rect.containsRect(move_rect.dest_rect) &&
+                frame_rect.containsRect(source_rect))
+            {
+                move_rects.emplace_back(move_rect);
+            }
+        }
+    }
+
+    pixels_.clear();
+    header_.clear();
+
+    uint32_t rect_count = 0;
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+        const size_t row_size = static_cast<size_t>(rect.width()) * kBytesPerPixel;
+
+        for (int32_t y = rect.top(); y < rect.bottom(); ++y)
+        {
+            const uint8_t* row = frame.frameDataAtPos(rect.left(), y);
+            pixels_.insert(pixels_.end(), row, row + row_size);
+        }
+
+        ++rect_count;
+    }
+
+    size_t compressed_size = 0;
+    if (!pixels_.empty())
+    {
+        compressed_.resize(ZSTD_compressBound(pixels_.size()));
+        compressed_size = ZSTD_compress(compressed_.data(), compressed_.size(),
+                                        pixels_.data(), pixels_.size(), kCompressLevel);
+        if (ZSTD_isError(compressed_size))
+        {
+            LOG(LS_ERROR) << "ZSTD_compress failed: " << ZSTD_getErrorName(compressed_size);
+            return false;
+        }
+    }
+
+    appendUint32(&header_, kFrameMagic);
+    appendUint64(&header_, static_cast<uint64_t>(timestamp.count()));
+    appendUint32(&header_, static_cast<uint32_t>(frame.size().width()));
+    appendUint32(&header_, static_cast<uint32_t>(frame.size().height()));
+    appendUint32(&header_, rect_count);
+    appendUint32(&header_, static_cast<uint32_t>(move_rects.size()));
+    appendUint32(&header_, static_cast<uint32_t>(compressed_size));
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        appendRect(&header_, it.rect());
+
+    for (const Frame::MoveRect& move_rect : move_rects)
+    {
+        appendUint32(&header_, static_cast<uint32_t>(move_rect.source_pos.x()));
+        appendUint32(&header_, static_cast<uint32_t>(move_rect.source_pos.y()));
+        appendRect(&header_, move_rect.dest_rect);
+    }
+
+    const int64_t record_size = static_cast<int64_t>(header_.size() + compressed_size);
+    if (file_size_ + record_size > kMaxFileSize)
+    {
+        LOG(LS_WARNING) << "Frame dump has reached the maximum size";
+        return false;
+    }
+
+    file_.write(reinterpret_cast<const char*>(header_.data()),
+                static_cast<std::streamsize>(header_.size()));
+    file_.write(reinterpret_cast<const char*>(compressed_.data()),
+                static_cast<std::streamsize>(compressed_size));
+    if (file_.fail())
+    {
+        LOG(LS_ERROR) << "Unable to write frame dump";
+        return false;
+    }
+
+    file_size_ += record_size;
+    return true;
+}
+
+FrameDumpReader::FrameDumpReader(std::ifstream&& file)
+    : file_(std::move(file))
+{
+    // Nothing
+}
+
+FrameDumpReader::~FrameDumpReader() = default;
+
+// static
+std::unique_ptr<FrameDumpReader> FrameDumpReader::open(const std::filesystem::path& file_path)
+{
+    std::ifstream file(file_path, std::ifstream::binary);
+    if (!file.is_open())
+    {
+        LOG(LS_ERROR) << "Unable to open frame dump: " << file_path;
+        return nullptr;
+    }
+
+    ByteArray header;
+    if (!readBytes(&file, kFileHeaderSize, &header))
+    {
+        LOG(LS_ERROR) << "Unable to read frame dump: " << file_path;
+        return nullptr;
+    }
+
+    const uint8_t* data = header.data();
+    const uint32_t magic = readUint32(&data);
+    const uint32_t version = readUint32(&data);
+
+    if (magic != kFileMagic || version != kVersion)
+    {
+        LOG(LS_ERROR) << "Not a frame dump or unsupported version: " << file_path;
+        return nullptr;
+    }
+
+    return std::unique_ptr<FrameDumpReader>(new FrameDumpReader(std::move(file)));
+}
+
+const Frame* FrameDumpReader::nextFrame()
+{
+    if (!readBytes(&file_, kRecordHeaderSize, &header_))
+        return nullptr;
+
+    const uint8_t* data = header_.data();
+    const uint32_t magic = readUint32(&data);
+    const uint64_t timestamp = readUint64(&data);
+    const int32_t width = readInt32(&data);
+    const int32_t height = readInt32(&data);
+    const uint32_t rect_count = readUint32(&data);
+    const uint32_t move_count = readUint32(&data);
+    const uint32_t compressed_size = readUint32(&data);
+
+    if (magic != kFrameMagic || width <= 0 || height <= 0 || width > kMaxFrameDimension ||
+        height > kMaxFrameDimension || rect_count > kMaxRectCount || move_count > kMaxRectCount ||
+        compressed_size > kMaxCompressedSize)
+    {
+        LOG(LS_ERROR) << "Invalid frame record";
+        return nullptr;
+    }
+
+    const Size size(width, height);
+    const Rect frame_rect = Rect::makeSize(size);
+
+    if (!frame_ || frame_->size() != size)
+    {
+        frame_ = FrameSimple::create(size, PixelFormat::ARGB());
+        if (!frame_)
+        {
+            LOG(LS_ERROR) << "Unable to create frame";
+            return nullptr;
+        }
+    }
+
+    if (!readBytes(&file_, rect_count * kRectSize + move_count * kMoveSize, &header_))
+    {
+        LOG(LS_ERROR) << "Unexpected end of frame dump";
+        return nullptr;
+    }
+
+    data = header_.data();
+
+    rects_.clear();
+    size_t pixels_size = 0;
+
+    for (uint32_t i = 0; i < rect_count; ++i)
+    {
+        const Rect rect = readRect(&data);
+        if (rect.isEmpty() || !frame_rect.containsRect(rect))
+        {
+            LOG(LS_ERROR) << "Invalid rectangle in frame dump: " << rect;
+            return nullptr;
+        }
+
+        rects_.emplace_back(rect);
+        pixels_size += static_cast<size_t>(rect.width()) * rect.height() * kBytesPerPixel;
+    }
+
+    // The rectangles of a region do not overlap.
+    if (pixels_size > static_cast<size_t>(width) * height * kBytesPerPixel)
+    {
+        LOG(LS_ERROR) << "Overlapping rectangles in frame dump";
+        return nullptr;
+    }
+
+    std::vector<Frame::MoveRect>* move_rects = frame_->moveRects();
+    move_rects->clear();
+
+    for (uint32_t i = 0; i < move_count; ++i)
+    {
+        Frame::MoveRect move_rect;
+        const int32_t source_x = readInt32(&data);
+        const int32_t source_y = readInt32(&data);
+        move_rect.source_pos.set(source_x, source_y);
+        move_rect.dest_rect = readRect(&data);
+
+        const Rect source_rect = Rect::makeXYWH(move_rect.source_pos, move_rect.dest_rect.size());
+        if (!frame_rect.containsRect(move_rect.dest_rect) || !frame_rect.containsRect(source_rect))
+        {
+            LOG(LS_ERROR) << "Invalid moved area in frame dump";
+            return nullptr;
+        }
+
+        move_rects->emplace_back(move_rect);
+    }
+
+    if (!readBytes(&file_, compressed_size, &compressed_))
+    {
+        LOG(LS_ERROR) << "Unexpected end of frame dump";
+        return nullptr;
+    }
+
+    pixels_.resize(pixels_size);
+    if (pixels_size)
+    {
+        const size_t ret = ZSTD_decompress(pixels_.data(), pixels_.size(),
+                                           compressed_.data(), compressed_.size());
+        if (ZSTD_isError(ret) || ret != pixels_size)
+        {
+            LOG(LS_ERROR) << "Unable to decompress frame dump";
+            return nullptr;
+        }
+    }
+
+    // The move rectangles are hints only, the moved pixels are in the changed rectangles too.
+    Region* updated_region = frame_->updatedRegion();
+    updated_region->clear();
+
+    const uint8_t* pixels = pixels_.data();
+    for (const Rect& rect : rects_)
+    {
+        const int stride = rect.width() * kBytesPerPixel;
+
+        frame_->copyPixelsFrom(pixels, stride, rect);
+        pixels += static_cast<size_t>(stride) * rect.height();
+
+        updated_region->addRect(rect);
+    }
+
+    timestamp_ = std::chrono::microseconds(static_cast<int64_t>(timestamp));
+
+    return frame_.get();
+}
+
+bool FrameDumpReader::rewind()
+{
+    file_.clear();
+    file_.seekg(static_cast<std::streamoff>(kFileHeaderSize));
+    timestamp_ = std::chrono::microseconds::zero();
+
+    return file_.good();
+}
+
+} // namespace base
@@ -0,0 +1,106 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__DESKTOP__FRAME_DUMP_H
+#define BASE__DESKTOP__FRAME_DUMP_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+#include "base/desktop/geometry.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+namespace base {
+
+class Frame;
+
+// Writes the captured frames to a file. Only the changed areas of a frame are written, the first
+// frame and the frames of a new size are written whole. The areas are compressed with zstd.
+// The dump is replayed by FrameDumpReader, so the sequences captured on real desktops can be used
+// to compare the performance of the codecs.
+class FrameDumpWriter
+{
+public:
+    ~FrameDumpWriter();
+
+    // Returns nullptr if the file cannot be created.
+    static std::unique_ptr<FrameDumpWriter> create(const std::filesystem::path& file_path);
+
+    // |timestamp| is the time of the capture from the start of the recording. Returns false if
+    // the frame cannot be written or the file has reached kMaxFileSize.
+    bool addFrame(const Frame& frame, std::chrono::microseconds timestamp);
+
+    static const int64_t kMaxFileSize;
+
+private:
+    FrameDumpWriter(std::ofstream&& file);
+
+    std::ofstream file_;
+    int64_t file_size_ = 0;
+    Size last_size_;
+
+    ByteArray header_;
+    ByteArray pixels_;
+    ByteArray compressed_;
+
+    DISALLOW_COPY_AND_ASSIGN(FrameDumpWriter);
+};
+
+// Reads the frames written by FrameDumpWriter.
+class FrameDumpReader
+{
+public:
+    ~FrameDumpReader();
+
+    // Returns nullptr if the file cannot be opened or it is not a frame dump.
+    static std::unique_ptr<FrameDumpReader> open(const std::filesystem::path& file_path);
+
+    // Reads the next frame. The updated region and the moved areas of the frame are those of the
+    // recorded capture. Returns nullptr at the end of the dump or if the dump is damaged. The frame
+    // is valid until the next call.
+    const Frame* nextFrame();
+
+    // Time of the capture of the last frame from the start of the recording.
+    std::chrono::microseconds timestamp() const { return timestamp_; }
+
+    // Continues reading from the first frame. The first frame is written whole, so the sequence
+    // can be played in a loop.
+    bool rewind();
+
+private:
+    FrameDumpReader(std::ifstream&& file);
+
+    std::ifstream file_;
+    std::unique_ptr<Frame> frame_;
+    std::chrono::microseconds timestamp_ { 0 };
+
+    ByteArray header_;
+    ByteArray pixels_;
+    ByteArray compressed_;
+    std::vector<Rect> rects_;
+
+    DISALLOW_COPY_AND_ASSIGN(FrameDumpReader);
+};
+
+} // namespace base
+
+#endif // BASE__DESKTOP__FRAME_DUMP_H
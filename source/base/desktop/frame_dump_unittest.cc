@@ -0,0 +1,155 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/frame_dump.h"
+
+#include "base/desktop/frame_simple.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+class FrameDumpTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        std::error_code ignored_code;
+        file_path_ = std::filesystem::temp_directory_path(ignored_code) / "aspia_frame_dump_test";
+        std::filesystem::remove(file_path_, ignored_code);
+    }
+
+    void TearDown() override
+    {
+        std::error_code ignored_code;
+        std::filesystem::remove(file_path_, ignored_code);
+    }
+
+    std::filesystem::path file_path_;
+};
+
+std::unique_ptr<FrameSimple> createFrame(const Size& size, uint8_t seed)
+{
+    std::unique_ptr<FrameSimple> frame = FrameSimple::create(size, PixelFormat::ARGB());
+
+    for (int y = 0; y < size.height(); ++y)
+    {
+        uint8_t* row = frame->frameDataAtPos(0, y);
+        for (int x = 0; x < size.width() * 4; ++x)
+            row[x] = static_cast<uint8_t>(x * 7 + y * 3 + seed);
+    }
+
+    return frame;
+}
+
+bool isEqualRect(const Frame& first, const Frame& second, const Rect& rect)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        if (memcmp(first.frameDataAtPos(rect.left(), y), second.frameDataAtPos(rect.left(), y),
+                   static_cast<size_t>(rect.width()) * 4) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+TEST_F(FrameDumpTest, ReplaysFrames)
+{
+    const Size size(67, 41);
+    std::unique_ptr<FrameSimple> first = createFrame(size, 1);
+    std::unique_ptr<FrameSimple> second = createFrame(size, 2);
+    std::unique_ptr<FrameSimple> third = createFrame(Size(20, 10), 3);
+
+    // The first frame is written whole although only a part of it is marked as changed.
+    first->updatedRegion()->addRect(Rect::makeXYWH(0, 0, 10, 10));
+
+    Region second_region(Rect::makeXYWH(5, 7, 20, 11));
+    second_region.addRect(Rect::makeXYWH(40, 30, 27, 11));
+    *second->updatedRegion() = second_region;
+    second->moveRects()->push_back({ Point(0, 0), Rect::makeXYWH(5, 7, 20, 11) });
+
+    {
+        std::unique_ptr<FrameDumpWriter> writer = FrameDumpWriter::create(file_path_);
+        ASSERT_TRUE(writer);
+        EXPECT_TRUE(writer->addFrame(*first, std::chrono::microseconds(0)));
+        EXPECT_TRUE(writer->addFrame(*second, std::chrono::microseconds(16000)));
+        EXPECT_TRUE(writer->addFrame(*third, std::chrono::microseconds(33000)));
+    }
+
+    std::unique_ptr<FrameDumpReader> reader = FrameDumpReader::open(file_path_);
+    ASSERT_TRUE(reader);
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        const Frame* frame = reader->nextFrame();
+        ASSERT_TRUE(frame);
+        EXPECT_EQ(frame->size(), size);
+        EXPECT_TRUE(frame->constUpdatedRegion().equals(Region(Rect::makeSize(size))));
+        EXPECT_TRUE(isEqualRect(*frame, *first, Rect::makeSize(size)));
+        EXPECT_EQ(reader->timestamp().count(), 0);
+
+        // Only the changed areas of the second frame are taken from it.
+        frame = reader->nextFrame();
+        ASSERT_TRUE(frame);
+        EXPECT_TRUE(frame->constUpdatedRegion().equals(second_region));
+        ASSERT_EQ(frame->constMoveRects().size(), 1u);
+        EXPECT_EQ(frame->constMoveRects()[0].dest_rect, Rect::makeXYWH(5, 7, 20, 11));
+        EXPECT_TRUE(isEqualRect(*frame, *second, Rect::makeXYWH(5, 7, 20, 11)));
+        EXPECT_TRUE(isEqualRect(*frame, *second, Rect::makeXYWH(40, 30, 27, 11)));
+        EXPECT_TRUE(isEqualRect(*frame, *first, Rect::makeXYWH(0, 0, 5, 41)));
+        EXPECT_EQ(reader->timestamp().count(), 16000);
+
+        frame = reader->nextFrame();
+        ASSERT_TRUE(frame);
+        EXPECT_EQ(frame->size(), Size(20, 10));
+        EXPECT_TRUE(isEqualRect(*frame, *third, Rect::makeWH(20, 10)));
+        EXPECT_EQ(reader->timestamp().count(), 33000);
+
+        EXPECT_FALSE(reader->nextFrame());
+        EXPECT_TRUE(reader->rewind());
+    }
+}
+
+TEST_F(FrameDumpTest, RejectsDamagedDump)
+{
+    std::unique_ptr<FrameSimple> frame = createFrame(Size(32, 32), 1);
+
+    {
+        std::unique_ptr<FrameDumpWriter> writer = FrameDumpWriter::create(file_path_);
+        ASSERT_TRUE(writer);
+        EXPECT_TRUE(writer->addFrame(*frame, std::chrono::microseconds(0)));
+    }
+
+    std::filesystem::resize_file(file_path_, std::filesystem::file_size(file_path_) - 1);
+
+    std::unique_ptr<FrameDumpReader> reader = FrameDumpReader::open(file_path_);
+    ASSERT_TRUE(reader);
+    EXPECT_FALSE(reader->nextFrame());
+
+    std::filesystem::resize_file(file_path_, 3);
+    EXPECT_FALSE(FrameDumpReader::open(file_path_));
+}
+
+} // namespace base
@@ -0,0 +1,113 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/frame_pool.h"
+
+#include "base/logging.h"
+
+namespace base {
+
+FramePool::FramePool(Allocator allocator, size_t max_free_frames)
+    : allocator_(std::move(allocator)),
+      max_free_frames_(max_free_frames)
+{
+    DCHECK(allocator_);
+}
+
+FramePool::~FramePool() = default;
+
+// static
+std::shared_ptr<FramePool> FramePool::create(Allocator allocator, size_t max_free_frames)
+{
+    return std::shared_ptr<FramePool>(new FramePool(std::move(allocator), max_free_frames));
+}
+
+std::shared_ptr<Frame> FramePool::allocate(const Size& size)
+{
+    std::unique_ptr<Frame> frame;
+
+    {
+        std::scoped_lock lock(lock_);
+
+        for (auto it = free_frames_.rbegin(); it != free_frames_.rend(); ++it)
+        {
+            if ((*it)->size() == size)
+            {
+                frame = std::move(*it);
+                free_frames_.erase(std::next(it).base());
+                break;
+            }
+        }
+    }
+
+    if (!frame)
+    {
+        frame = allocator_(size);
+        if (!frame)
+        {
+            LOG(LS_ERROR) << "Unable to allocate frame " << size;
+            return nullptr;
+        }
+    }
+
+    std::weak_ptr<FramePool> pool = weak_from_this();
+
+    return std::shared_ptr<Frame>(frame.release(), [pool](Frame* frame)
+    {
+        std::unique_ptr<Frame> released_frame(frame);
+
+        std::shared_ptr<FramePool> self = pool.lock();
+        if (self)
+            self->release(std::move(released_frame));
+    });
+}
+
+size_t FramePool::freeFrameCount() const
+{
+    std::scoped_lock lock(lock_);
+    return free_frames_.size();
+}
+
+void FramePool::release(std::unique_ptr<Frame> frame)
+{
+    // The next user of the frame gets a buffer with the previous image but without the information
+    // about it.
+    frame->updatedRegion()->clear();
+    frame->moveRects()->clear();
+    frame->setTopLeft(Point());
+    frame->setDpi(Point());
+    frame->setCapturerType(0);
+    *frame->captureTiming() = Frame::CaptureTiming();
+
+    std::unique_ptr<Frame> evicted_frame;
+
+    {
+        std::scoped_lock lock(lock_);
+
+        free_frames_.emplace_back(std::move(frame));
+
+        if (free_frames_.size() > max_free_frames_)
+        {
+            // The frame is deleted outside the lock.
+            evicted_frame = std::move(free_frames_.front());
+            free_frames_.erase(free_frames_.begin());
+        }
+    }
+}
+
+} // namespace base
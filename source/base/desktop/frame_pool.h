@@ -0,0 +1,73 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__DESKTOP__FRAME_POOL_H
+#define BASE__DESKTOP__FRAME_POOL_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/frame.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace base {
+
+// Keeps the released frames for reuse. A frame of the same size is taken from the pool instead of
+// allocating a new buffer, so switching between screens and resolutions does not allocate and
+// fault in large buffers again. The frames may be released on any thread and may outlive the
+// pool.
+class FramePool : public std::enable_shared_from_this<FramePool>
+{
+public:
+    using Allocator = std::function<std::unique_ptr<Frame>(const Size& size)>;
+
+    static const size_t kDefaultMaxFreeFrames = 2;
+
+    ~FramePool();
+
+    // |max_free_frames| limits the number of the released frames that the pool keeps. The oldest
+    // frames are deleted first.
+    static std::shared_ptr<FramePool> create(
+        Allocator allocator, size_t max_free_frames = kDefaultMaxFreeFrames);
+
+    // Returns a frame of |size|. The frame returns to the pool when the last reference to it is
+    // released. Returns nullptr if the frame cannot be allocated.
+    std::shared_ptr<Frame> allocate(const Size& size);
+
+    size_t freeFrameCount() const;
+
+private:
+    FramePool(Allocator allocator, size_t max_free_frames);
+    void release(std::unique_ptr<Frame> frame);
+
+    const Allocator allocator_;
+    const size_t max_free_frames_;
+
+    mutable std::mutex lock_;
+
+    // The released frames, the most recent at the end.
+    std::vector<std::unique_ptr<Frame>> free_frames_;
+
+    DISALLOW_COPY_AND_ASSIGN(FramePool);
+};
+
+} // namespace base
+
+#endif // BASE__DESKTOP__FRAME_POOL_H
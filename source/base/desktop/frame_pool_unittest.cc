@@ -0,0 +1,119 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/frame_pool.h"
+
+#include "base/desktop/frame_simple.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+std::shared_ptr<FramePool> createPool(int* allocations, size_t max_free_frames = 2)
+{
+    return FramePool::create([allocations](const Size& size) -> std::unique_ptr<Frame>
+    {
+        ++*allocations;
+        return FrameSimple::create(size, PixelFormat::ARGB());
+    }, max_free_frames);
+}
+
+} // namespace
+
+TEST(FramePoolTest, ReusesFrameOfSameSize)
+{
+    int allocations = 0;
+    std::shared_ptr<FramePool> pool = createPool(&allocations);
+
+    std::shared_ptr<Frame> frame = pool->allocate(Size(100, 50));
+    ASSERT_TRUE(frame);
+    EXPECT_EQ(frame->size(), Size(100, 50));
+    EXPECT_EQ(pool->freeFrameCount(), 0u);
+
+    const uint8_t* data = frame->frameData();
+    frame->updatedRegion()->addRect(Rect::makeWH(10, 10));
+    frame->setTopLeft(Point(5, 5));
+    frame.reset();
+
+    EXPECT_EQ(pool->freeFrameCount(), 1u);
+
+    frame = pool->allocate(Size(100, 50));
+    ASSERT_TRUE(frame);
+    EXPECT_EQ(frame->frameData(), data);
+    EXPECT_EQ(allocations, 1);
+    EXPECT_EQ(pool->freeFrameCount(), 0u);
+
+    // The information about the previous image is reset.
+    EXPECT_TRUE(frame->constUpdatedRegion().isEmpty());
+    EXPECT_EQ(frame->topLeft(), Point());
+}
+
+TEST(FramePoolTest, AllocatesFrameOfOtherSize)
+{
+    int allocations = 0;
+    std::shared_ptr<FramePool> pool = createPool(&allocations);
+
+    pool->allocate(Size(100, 50)).reset();
+
+    std::shared_ptr<Frame> frame = pool->allocate(Size(50, 100));
+    ASSERT_TRUE(frame);
+    EXPECT_EQ(frame->size(), Size(50, 100));
+    EXPECT_EQ(allocations, 2);
+
+    // The frame of the other size stays in the pool.
+    EXPECT_EQ(pool->freeFrameCount(), 1u);
+}
+
+TEST(FramePoolTest, LimitsFreeFrames)
+{
+    int allocations = 0;
+    std::shared_ptr<FramePool> pool = createPool(&allocations, 2);
+
+    std::shared_ptr<Frame> frame1 = pool->allocate(Size(10, 10));
+    std::shared_ptr<Frame> frame2 = pool->allocate(Size(20, 20));
+    std::shared_ptr<Frame> frame3 = pool->allocate(Size(30, 30));
+
+    frame1.reset();
+    frame2.reset();
+    frame3.reset();
+
+    EXPECT_EQ(pool->freeFrameCount(), 2u);
+
+    // The oldest frame is deleted.
+    pool->allocate(Size(10, 10)).reset();
+    EXPECT_EQ(allocations, 4);
+
+    pool->allocate(Size(30, 30)).reset();
+    EXPECT_EQ(allocations, 4);
+}
+
+TEST(FramePoolTest, FrameOutlivesPool)
+{
+    int allocations = 0;
+    std::shared_ptr<FramePool> pool = createPool(&allocations);
+
+    std::shared_ptr<Frame> frame = pool->allocate(Size(10, 10));
+    ASSERT_TRUE(frame);
+
+    pool.reset();
+    frame.reset();
+}
+
+} // namespace base
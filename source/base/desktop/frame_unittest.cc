@@ -35,8 +35,69 @@ std::unique_ptr<Frame> createTestFrame(const Rect& rect, int pixels_value)
     return std::move(frame);
 }
 
+void fillTestPattern(Frame* frame)
+{
+    for (int y = 0; y < frame->size().height(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(0, y));
+
+        for (int x = 0; x < frame->size().width(); ++x)
+            row[x] = static_cast<uint32_t>((y << 16) | x);
+    }
+}
+
+uint32_t pixelAt(const Frame& frame, int x, int y)
+{
+    return *reinterpret_cast<const uint32_t*>(frame.frameDataAtPos(x, y));
+}
+
 } // namespace
 
+TEST(FrameTest, CopyRect)
+{
+    struct
+    {
+        Point src_pos;
+        Rect dest_rect;
+    } cases[] =
+    {
+        // Scrolls down, up, right and left with overlapping areas.
+        { Point(10, 10), Rect::makeXYWH(10, 30, 100, 80) },
+        { Point(10, 30), Rect::makeXYWH(10, 10, 100, 80) },
+        { Point(10, 10), Rect::makeXYWH(17, 10, 100, 80) },
+        { Point(17, 10), Rect::makeXYWH(10, 10, 100, 80) },
+        { Point(0, 0), Rect::makeXYWH(120, 100, 40, 40) }
+    };
+
+    for (size_t i = 0; i < std::size(cases); ++i)
+    {
+        auto frame = FrameSimple::create(Size(200, 150), PixelFormat::ARGB());
+        fillTestPattern(frame.get());
+
+        const Rect& dest_rect = cases[i].dest_rect;
+        const Point& src_pos = cases[i].src_pos;
+
+        frame->copyRect(src_pos, dest_rect);
+
+        for (int y = 0; y < frame->size().height(); ++y)
+        {
+            for (int x = 0; x < frame->size().width(); ++x)
+            {
+                uint32_t expected = static_cast<uint32_t>((y << 16) | x);
+
+                if (dest_rect.contains(x, y))
+                {
+                    const int src_x = x - dest_rect.x() + src_pos.x();
+                    const int src_y = y - dest_rect.y() + src_pos.y();
+                    expected = static_cast<uint32_t>((src_y << 16) | src_x);
+                }
+
+                ASSERT_EQ(pixelAt(*frame, x, y), expected) << "case " << i;
+            }
+        }
+    }
+}
+
 TEST(FrameTest, Performance)
 {
     Rect frame_rect = Rect::makeWH(1024, 768);
@@ -0,0 +1,459 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/linux/screencast_portal.h"
+
+#include "base/logging.h"
+#include "base/crypto/random.h"
+
+#include <gio/gio.h>
+#include <gio/gunixfdlist.h>
+
+#include <unistd.h>
+
+namespace base {
+
+namespace {
+
+const char kDesktopBusName[] = "org.freedesktop.portal.Desktop";
+const char kDesktopObjectPath[] = "/org/freedesktop/portal/desktop";
+const char kRequestInterface[] = "org.freedesktop.portal.Request";
+const char kScreenCastInterface[] = "org.freedesktop.portal.ScreenCast";
+const char kSessionInterface[] = "org.freedesktop.portal.Session";
+const char kPropertiesInterface[] = "org.freedesktop.DBus.Properties";
+
+// Values of the ScreenCast portal enumerations.
+const uint32_t kSourceTypeMonitor = 1;
+const uint32_t kCursorModeEmbedded = 2;
+
+std::string newToken()
+{
+    return "aspia" + std::to_string(Random::number32());
+}
+
+std::string errorMessage(GError* error)
+{
+    std::string message(error ? error->message : "Unknown error");
+    if (error)
+        g_error_free(error);
+    return message;
+}
+
+} // namespace
+
+ScreenCastPortal::ScreenCastPortal() = default;
+
+ScreenCastPortal::~ScreenCastPortal()
+{
+    unsubscribe();
+    closeSession();
+
+    if (pipewire_fd_ != -1)
+        close(pipewire_fd_);
+
+    if (connection_)
+        g_object_unref(connection_);
+
+    if (context_)
+        g_main_context_unref(context_);
+}
+
+void ScreenCastPortal::start()
+{
+    if (state_ != State::NOT_STARTED)
+        return;
+
+    state_ = State::PENDING;
+    context_ = g_main_context_new();
+
+    GError* error = nullptr;
+    connection_ = g_bus_get_sync(G_BUS_TYPE_SESSION, nullptr, &error);
+    if (!connection_)
+    {
+        LOG(LS_WARNING) << "Unable to connect to the session bus: " << errorMessage(error);
+        fail();
+        return;
+    }
+
+    // Request objects are created by the portal at a path derived from the unique name of the
+    // connection: ":1.42" becomes "1_42".
+    sender_name_ = g_dbus_connection_get_unique_name(connection_) + 1;
+    for (auto& ch : sender_name_)
+    {
+        if (ch == '.')
+            ch = '_';
+    }
+
+    if (!sendRequest(Request::CREATE_SESSION))
+        fail();
+}
+
+void ScreenCastPortal::processEvents()
+{
+    if (!context_)
+        return;
+
+    while (g_main_context_iteration(context_, FALSE))
+    {
+        // Nothing
+    }
+}
+
+int ScreenCastPortal::takePipeWireFd()
+{
+    DCHECK(state_ == State::READY);
+
+    int fd = pipewire_fd_;
+    pipewire_fd_ = -1;
+    return fd;
+}
+
+bool ScreenCastPortal::sendRequest(Request request)
+{
+    const std::string token = newToken();
+    const std::string request_path =
+        std::string(kDesktopObjectPath) + "/request/" + sender_name_ + "/" + token;
+
+    // The subscription is made before the call, otherwise the response can be lost.
+    subscribe(request_path.c_str());
+
+    GVariantBuilder options;
+    g_variant_builder_init(&options, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add(&options, "{sv}", "handle_token", g_variant_new_string(token.c_str()));
+
+    const char* method = nullptr;
+    GVariant* parameters = nullptr;
+
+    switch (request)
+    {
+        case Request::CREATE_SESSION:
+        {
+            const std::string session_token = newToken();
+
+            g_variant_builder_add(&options, "{sv}", "session_handle_token",
+                                  g_variant_new_string(session_token.c_str()));
+
+            method = "CreateSession";
+            parameters = g_variant_new("(a{sv})", &options);
+        }
+        break;
+
+        case Request::SELECT_SOURCES:
+        {
+            g_variant_builder_add(&options, "{sv}", "types",
+                                  g_variant_new_uint32(kSourceTypeMonitor));
+            g_variant_builder_add(&options, "{sv}", "multiple", g_variant_new_boolean(FALSE));
+
+            // The cursor is drawn into the stream if the portal allows this.
+            if (availableCursorModes() & kCursorModeEmbedded)
+            {
+                g_variant_builder_add(&options, "{sv}", "cursor_mode",
+                                      g_variant_new_uint32(kCursorModeEmbedded));
+            }
+
+            method = "SelectSources";
+            parameters = g_variant_new("(oa{sv})", session_handle_.c_str(), &options);
+        }
+        break;
+
+        case Request::START:
+        {
+            method = "Start";
+            parameters = g_variant_new("(osa{sv})", session_handle_.c_str(), "", &options);
+        }
+        break;
+
+        default:
+            NOTREACHED();
+            g_variant_builder_clear(&options);
+            return false;
+    }
+
+    GError* error = nullptr;
+    GVariant* result = g_dbus_connection_call_sync(connection_,
+                                                   kDesktopBusName,
+                                                   kDesktopObjectPath,
+                                                   kScreenCastInterface,
+                                                   method,
+                                                   parameters,
+                                                   G_VARIANT_TYPE("(o)"),
+                                                   G_DBUS_CALL_FLAGS_NONE,
+                                                   -1,
+                                                   nullptr,
+                                                   &error);
+    if (!result)
+    {
+        LOG(LS_WARNING) << "Portal method " << method << " failed: " << errorMessage(error);
+        unsubscribe();
+        return false;
+    }
+
+    const char* handle = nullptr;
+    g_variant_get(result, "(&o)", &handle);
+
+    // Old versions of the portal do not use the handle token, in which case the response comes
+    // from the object returned by the call.
+    if (request_path != handle)
+    {
+        LOG(LS_INFO) << "Unexpected request path: " << handle;
+        unsubscribe();
+        subscribe(handle);
+    }
+
+    g_variant_unref(result);
+    pending_request_ = request;
+    return true;
+}
+
+void ScreenCastPortal::onResponse(uint32_t response, GVariant* results)
+{
+    const Request request = pending_request_;
+
+    pending_request_ = Request::NONE;
+    unsubscribe();
+
+    if (response != 0)
+    {
+        // 1 means that the user cancelled the dialog, 2 means any other error.
+        LOG(LS_WARNING) << "Portal request failed with response " << response;
+        fail();
+        return;
+    }
+
+    switch (request)
+    {
+        case Request::CREATE_SESSION:
+        {
+            char* session_handle = nullptr;
+            if (!g_variant_lookup(results, "session_handle", "s", &session_handle))
+            {
+                LOG(LS_WARNING) << "No session handle in the response";
+                fail();
+                return;
+            }
+
+            session_handle_ = session_handle;
+            g_free(session_handle);
+
+            if (!sendRequest(Request::SELECT_SOURCES))
+                fail();
+        }
+        break;
+
+        case Request::SELECT_SOURCES:
+        {
+            if (!sendRequest(Request::START))
+                fail();
+        }
+        break;
+
+        case Request::START:
+        {
+            GVariant* streams = g_variant_lookup_value(results, "streams", G_VARIANT_TYPE_ARRAY);
+            if (!streams || !g_variant_n_children(streams))
+            {
+                LOG(LS_WARNING) << "No streams in the response";
+                if (streams)
+                    g_variant_unref(streams);
+                fail();
+                return;
+            }
+
+            // Only one monitor is requested, so there is only one stream.
+            GVariant* properties = nullptr;
+            g_variant_get_child(streams, 0, "(u@a{sv})", &node_id_, &properties);
+
+            int width = 0;
+            int height = 0;
+            if (g_variant_lookup(properties, "size", "(ii)", &width, &height))
+                stream_size_ = Size(width, height);
+
+            g_variant_unref(properties);
+            g_variant_unref(streams);
+
+            if (!openPipeWireRemote())
+            {
+                fail();
+                return;
+            }
+
+            LOG(LS_INFO) << "Screen cast session started (node: " << node_id_
+                         << ", size: " << stream_size_ << ")";
+            state_ = State::READY;
+        }
+        break;
+
+        default:
+            NOTREACHED();
+            break;
+    }
+}
+
+bool ScreenCastPortal::openPipeWireRemote()
+{
+    GVariantBuilder options;
+    g_variant_builder_init(&options, G_VARIANT_TYPE_VARDICT);
+
+    GUnixFDList* fd_list = nullptr;
+    GError* error = nullptr;
+
+    GVariant* result = g_dbus_connection_call_with_unix_fd_list_sync(
+        connection_,
+        kDesktopBusName,
+        kDesktopObjectPath,
+        kScreenCastInterface,
+        "OpenPipeWireRemote",
+        g_variant_new("(oa{sv})", session_handle_.c_str(), &options),
+        G_VARIANT_TYPE("(h)"),
+        G_DBUS_CALL_FLAGS_NONE,
+        -1,
+        nullptr,
+        &fd_list,
+        nullptr,
+        &error);
+    if (!result)
+    {
+        LOG(LS_WARNING) << "OpenPipeWireRemote failed: " << errorMessage(error);
+        return false;
+    }
+
+    int32_t index = 0;
+    g_variant_get(result, "(h)", &index);
+    g_variant_unref(result);
+
+    pipewire_fd_ = g_unix_fd_list_get(fd_list, index, &error);
+    g_object_unref(fd_list);
+
+    if (pipewire_fd_ == -1)
+    {
+        LOG(LS_WARNING) << "Unable to get the PipeWire descriptor: " << errorMessage(error);
+        return false;
+    }
+
+    return true;
+}
+
+uint32_t ScreenCastPortal::availableCursorModes()
+{
+    GError* error = nullptr;
+    GVariant* result = g_dbus_connection_call_sync(connection_,
+                                                   kDesktopBusName,
+                                                   kDesktopObjectPath,
+                                                   kPropertiesInterface,
+                                                   "Get",
+                                                   g_variant_new("(ss)",
+                                                                 kScreenCastInterface,
+                                                                 "AvailableCursorModes"),
+                                                   G_VARIANT_TYPE("(v)"),
+                                                   G_DBUS_CALL_FLAGS_NONE,
+                                                   -1,
+                                                   nullptr,
+                                                   &error);
+    if (!result)
+    {
+        // The property is missing in the first version of the interface.
+        LOG(LS_INFO) << "Unable to get available cursor modes: " << errorMessage(error);
+        return 0;
+    }
+
+    GVariant* value = nullptr;
+    g_variant_get(result, "(v)", &value);
+
+    uint32_t modes = g_variant_get_uint32(value);
+
+    g_variant_unref(value);
+    g_variant_unref(result);
+    return modes;
+}
+
+void ScreenCastPortal::subscribe(const char* request_path)
+{
+    // Signals are dispatched on the thread-default context at the time of the subscription.
+    g_main_context_push_thread_default(context_);
+    signal_id_ = g_dbus_connection_signal_subscribe(connection_,
+                                                    kDesktopBusName,
+                                                    kRequestInterface,
+                                                    "Response",
+                                                    request_path,
+                                                    nullptr,
+                                                    G_DBUS_SIGNAL_FLAGS_NO_MATCH_RULE,
+                                                    &ScreenCastPortal::onResponseSignal,
+                                                    this,
+                                                    nullptr);
+    g_main_context_pop_thread_default(context_);
+}
+
+void ScreenCastPortal::unsubscribe()
+{
+    if (!signal_id_)
+        return;
+
+    g_dbus_connection_signal_unsubscribe(connection_, signal_id_);
+    signal_id_ = 0;
+}
+
+void ScreenCastPortal::closeSession()
+{
+    if (session_handle_.empty())
+        return;
+
+    GVariant* result = g_dbus_connection_call_sync(connection_,
+                                                   kDesktopBusName,
+                                                   session_handle_.c_str(),
+                                                   kSessionInterface,
+                                                   "Close",
+                                                   nullptr,
+                                                   nullptr,
+                                                   G_DBUS_CALL_FLAGS_NONE,
+                                                   -1,
+                                                   nullptr,
+                                                   nullptr);
+    if (result)
+        g_variant_unref(result);
+
+    session_handle_.clear();
+}
+
+void ScreenCastPortal::fail()
+{
+    unsubscribe();
+    closeSession();
+    state_ = State::FAILED;
+}
+
+// static
+void ScreenCastPortal::onResponseSignal(GDBusConnection* /* connection */,
+                                        const char* /* sender_name */,
+                                        const char* /* object_path */,
+                                        const char* /* interface_name */,
+                                        const char* /* signal_name */,
+                                        GVariant* parameters,
+                                        void* user_data)
+{
+    ScreenCastPortal* self = reinterpret_cast<ScreenCastPortal*>(user_data);
+    DCHECK(self);
+
+    uint32_t response = 0;
+    GVariant* results = nullptr;
+    g_variant_get(parameters, "(u@a{sv})", &response, &results);
+
+    self->onResponse(response, results);
+    g_variant_unref(results);
+}
+
+} // namespace base
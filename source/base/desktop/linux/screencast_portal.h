@@ -0,0 +1,112 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__DESKTOP__LINUX__SCREENCAST_PORTAL_H
+#define BASE__DESKTOP__LINUX__SCREENCAST_PORTAL_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/geometry.h"
+
+#include <string>
+
+// GLib headers are included only in the implementation.
+typedef struct _GDBusConnection GDBusConnection;
+typedef struct _GMainContext GMainContext;
+typedef struct _GVariant GVariant;
+
+namespace base {
+
+// Negotiates a screen cast session with xdg-desktop-portal. The portal shows a dialog where the
+// user selects the screen to share, after which the session provides a PipeWire remote and the
+// node ID of the stream.
+// All D-Bus signals are dispatched on a private GLib main context which is iterated by
+// processEvents(), so the handshake never blocks the calling thread.
+class ScreenCastPortal
+{
+public:
+    ScreenCastPortal();
+    ~ScreenCastPortal();
+
+    enum class State
+    {
+        NOT_STARTED,
+        PENDING,
+        READY,
+        FAILED
+    };
+
+    void start();
+    void processEvents();
+
+    State state() const { return state_; }
+
+    // Returns the descriptor of the PipeWire remote. The caller takes ownership of the
+    // descriptor. Valid only in READY state.
+    int takePipeWireFd();
+
+    uint32_t nodeId() const { return node_id_; }
+    const Size& streamSize() const { return stream_size_; }
+
+private:
+    enum class Request
+    {
+        NONE,
+        CREATE_SESSION,
+        SELECT_SOURCES,
+        START
+    };
+
+    bool sendRequest(Request request);
+    void onResponse(uint32_t response, GVariant* results);
+    bool openPipeWireRemote();
+    uint32_t availableCursorModes();
+    void subscribe(const char* request_path);
+    void unsubscribe();
+    void closeSession();
+    void fail();
+
+    static void onResponseSignal(GDBusConnection* connection,
+                                 const char* sender_name,
+                                 const char* object_path,
+                                 const char* interface_name,
+                                 const char* signal_name,
+                                 GVariant* parameters,
+                                 void* user_data);
+
+    State state_ = State::NOT_STARTED;
+
+    GMainContext* context_ = nullptr;
+    GDBusConnection* connection_ = nullptr;
+
+    // Unique name of the connection in the form used in request object paths.
+    std::string sender_name_;
+
+    Request pending_request_ = Request::NONE;
+    unsigned int signal_id_ = 0;
+
+    std::string session_handle_;
+    int pipewire_fd_ = -1;
+    uint32_t node_id_ = 0;
+    Size stream_size_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScreenCastPortal);
+};
+
+} // namespace base
+
+#endif // BASE__DESKTOP__LINUX__SCREENCAST_PORTAL_H
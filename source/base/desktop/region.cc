@@ -20,6 +20,9 @@
 
 #include "base/compiler_specific.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace base {
 
 namespace {
@@ -29,6 +32,27 @@ ALWAYS_INLINE RegionPtr region_cast(const RegionRec* region)
     return reinterpret_cast<RegionPtr>(const_cast<RegionRec*>(region));
 }
 
+BoxRec makeBox(int left, int top, int right, int bottom)
+{
+    BoxRec box;
+    box.x1 = static_cast<short>(left);
+    box.y1 = static_cast<short>(top);
+    box.x2 = static_cast<short>(right);
+    box.y2 = static_cast<short>(bottom);
+    return box;
+}
+
+bool isSameBand(const BoxRec* band1, const BoxRec* band2, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (band1[i].x1 != band2[i].x1 || band1[i].x2 != band2[i].x2)
+            return false;
+    }
+
+    return true;
+}
+
 } // namespace
 
 Region::Region()
@@ -59,6 +83,69 @@ Region::Region(const Rect* rects, int count)
     addRects(rects, count);
 }
 
+// static
+Region Region::fromBlockMap(const uint8_t* map, int stride, const Rect& blocks, int block_size,
+                            const Rect& clip)
+{
+    std::vector<BoxRec> boxes;
+
+    // The first box and the number of boxes of the last band.
+    size_t band_start = 0;
+    size_t band_count = 0;
+
+    for (int y = blocks.top(); y < blocks.bottom(); ++y)
+    {
+        const int top = std::max(y * block_size, clip.top());
+        const int bottom = std::min((y + 1) * block_size, clip.bottom());
+        if (top >= bottom)
+            continue;
+
+        const uint8_t* row = map + y * stride;
+        const size_t row_start = boxes.size();
+
+        int x = blocks.left();
+        while (x < blocks.right())
+        {
+            if (!row[x])
+            {
+                ++x;
+                continue;
+            }
+
+            const int run_start = x;
+            while (x < blocks.right() && row[x])
+                ++x;
+
+            const int left = std::max(run_start * block_size, clip.left());
+            const int right = std::min(x * block_size, clip.right());
+            if (left < right)
+                boxes.emplace_back(makeBox(left, top, right, bottom));
+        }
+
+        const size_t row_count = boxes.size() - row_start;
+        if (!row_count)
+            continue;
+
+        // The row continues the last band if it has the same boxes.
+        if (band_count == row_count && boxes[band_start].y2 == top &&
+            isSameBand(&boxes[band_start], &boxes[row_start], row_count))
+        {
+            for (size_t i = band_start; i < row_start; ++i)
+                boxes[i].y2 = static_cast<short>(bottom);
+
+            boxes.resize(row_start);
+            continue;
+        }
+
+        band_start = row_start;
+        band_count = row_count;
+    }
+
+    Region region;
+    region.setBoxes(boxes, true);
+    return region;
+}
+
 Region::Region(const Region& other)
 {
     miRegionInit(&x11reg_, NullBox, 0);
@@ -67,6 +154,7 @@ Region::Region(const Region& other)
 
 Region::Region(Region&& other) noexcept
 {
+    miRegionInit(&x11reg_, NullBox, 0);
     *this = std::move(other);
 }
 
@@ -134,8 +222,28 @@ void Region::addRect(const Rect& rect)
 
 void Region::addRects(const Rect* rects, int count)
 {
+    std::vector<BoxRec> boxes;
+    boxes.reserve(static_cast<size_t>(std::max(count, 0)));
+
     for (int i = 0; i < count; ++i)
-        addRect(rects[i]);
+    {
+        const Rect& rect = rects[i];
+        if (!rect.isEmpty())
+            boxes.emplace_back(makeBox(rect.left(), rect.top(), rect.right(), rect.bottom()));
+    }
+
+    if (boxes.empty())
+        return;
+
+    if (isEmpty())
+    {
+        setBoxes(boxes, false);
+        return;
+    }
+
+    Region temp;
+    temp.setBoxes(boxes, false);
+    addRegion(temp);
 }
 
 void Region::addRegion(const Region& region)
@@ -177,6 +285,59 @@ void Region::translate(int32_t dx, int32_t dy)
     miTranslateRegion(&x11reg_, dx, dy);
 }
 
+void Region::setBoxes(const std::vector<BoxRec>& boxes, bool banded)
+{
+    miRegionUninit(&x11reg_);
+
+    if (boxes.size() <= 1)
+    {
+        miRegionInit(&x11reg_, boxes.empty() ? NullBox : const_cast<BoxRec*>(&boxes[0]), 0);
+        return;
+    }
+
+    const int count = static_cast<int>(boxes.size());
+
+    miRegionInit(&x11reg_, NullBox, count);
+    if (x11reg_.data == &miEmptyData)
+    {
+        // Not enough memory for the array of boxes. The boxes are added one by one.
+        for (const BoxRec& box : boxes)
+        {
+            RegionRec temp;
+            miRegionInit(&temp, const_cast<BoxRec*>(&box), 0);
+            miUnion(&x11reg_, &x11reg_, &temp);
+            miRegionUninit(&temp);
+        }
+        return;
+    }
+
+    memcpy(REGION_BOXPTR(&x11reg_), boxes.data(), boxes.size() * sizeof(BoxRec));
+    x11reg_.data->numRects = count;
+
+    if (banded)
+    {
+        BoxRec& extents = x11reg_.extents;
+
+        extents.y1 = boxes.front().y1;
+        extents.y2 = boxes.back().y2;
+        extents.x1 = boxes.front().x1;
+        extents.x2 = boxes.front().x2;
+
+        for (const BoxRec& box : boxes)
+        {
+            extents.x1 = std::min(extents.x1, box.x1);
+            extents.x2 = std::max(extents.x2, box.x2);
+        }
+    }
+    else
+    {
+        // Empty extents make miRegionValidate sort the boxes and merge the overlapping ones.
+        Bool overlap;
+        x11reg_.extents.x1 = x11reg_.extents.x2 = 0;
+        miRegionValidate(&x11reg_, &overlap);
+    }
+}
+
 void Region::swap(Region* region)
 {
     std::swap(x11reg_.extents, region->x11reg_.extents);
@@ -21,6 +21,8 @@
 
 #include "base/desktop/geometry.h"
 
+#include <vector>
+
 extern "C" {
 #include "third_party/x11region/x11region.h"
 } // extern "C"
@@ -64,6 +66,13 @@ public:
     Region(Region&& other) noexcept;
     ~Region();
 
+    // Builds the region from a map of blocks in one pass. Each byte of |map| is a block of
+    // |block_size| x |block_size| pixels, non-zero bytes mark the blocks of the region. The rows of
+    // the map are |stride| bytes apart. Only the blocks inside |blocks| (in units of blocks) are
+    // scanned and the result is clipped by |clip| (in pixels).
+    static Region fromBlockMap(const uint8_t* map, int stride, const Rect& blocks, int block_size,
+                               const Rect& clip);
+
     Region& operator=(const Region& other);
     Region& operator=(Region&& other) noexcept;
 
@@ -77,7 +86,8 @@ public:
     // Reset region to contain just |rect|.
     void setRect(const Rect& rect);
 
-    // Adds specified rect(s) or region to the region.
+    // Adds specified rect(s) or region to the region. Adding many rects at once is faster than
+    // adding them one by one.
     void addRect(const Rect& rect);
     void addRects(const Rect* rects, int count);
     void addRegion(const Region& region);
@@ -103,6 +113,10 @@ public:
     void swap(Region* region);
 
 private:
+    // Replaces the content of the region with |boxes|. If |banded| is true, the boxes must already
+    // form a valid region: sorted by bands, without overlaps and with the bands coalesced.
+    void setBoxes(const std::vector<BoxRec>& boxes, bool banded);
+
     RegionRec x11reg_;
 };
 
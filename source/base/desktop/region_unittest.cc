@@ -21,6 +21,7 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <vector>
 
 namespace base {
 
@@ -983,6 +984,86 @@ TEST(desktop_region_test, subtract_rect_on_same_col)
     }
 }
 
+TEST(desktop_region_test, from_block_map)
+{
+    const int kBlockSize = 16;
+    const int kColumns = 7;
+    const int kRows = 6;
+
+    // The last column and the last row are clipped, the frame is not a multiple of blocks.
+    const Rect clip = Rect::makeWH(kColumns * kBlockSize - 5, kRows * kBlockSize - 3);
+
+    for (int c = 0; c < 200; ++c)
+    {
+        uint8_t map[kRows][kColumns];
+        Region expected;
+
+        for (int y = 0; y < kRows; ++y)
+        {
+            for (int x = 0; x < kColumns; ++x)
+            {
+                map[y][x] = static_cast<uint8_t>(radmonInt(3) == 0);
+                if (map[y][x])
+                {
+                    Rect rect = Rect::makeXYWH(x * kBlockSize, y * kBlockSize,
+                                               kBlockSize, kBlockSize);
+                    rect.intersectWith(clip);
+                    expected.addRect(rect);
+                }
+            }
+        }
+
+        Region region = Region::fromBlockMap(
+            &map[0][0], kColumns, Rect::makeWH(kColumns, kRows), kBlockSize, clip);
+        EXPECT_TRUE(region.equals(expected));
+
+        // The result is a valid region for the other operations.
+        region.addRect(Rect::makeXYWH(0, 0, 1, 1));
+        expected.addRect(Rect::makeXYWH(0, 0, 1, 1));
+        EXPECT_TRUE(region.equals(expected));
+    }
+
+    // The vertically adjacent rows with the same blocks become one rectangle.
+    const uint8_t column_map[4] = { 1, 1, 0, 1 };
+    Region column = Region::fromBlockMap(
+        column_map, 1, Rect::makeWH(1, 4), kBlockSize, Rect::makeWH(100, 100));
+
+    const Rect expected_rects[] =
+    {
+        Rect::makeXYWH(0, 0, kBlockSize, 2 * kBlockSize),
+        Rect::makeXYWH(0, 3 * kBlockSize, kBlockSize, kBlockSize)
+    };
+    compareRegion(column, expected_rects, static_cast<int>(std::size(expected_rects)));
+}
+
+TEST(desktop_region_test, add_rects)
+{
+    for (int c = 0; c < 100; ++c)
+    {
+        std::vector<Rect> rects;
+
+        for (int i = 0; i < 50; ++i)
+        {
+            rects.emplace_back(Rect::makeXYWH(radmonInt(200), radmonInt(200),
+                                              radmonInt(40), radmonInt(40)));
+        }
+
+        Region expected(Rect::makeXYWH(50, 50, 20, 20));
+        for (const auto& rect : rects)
+            expected.addRect(rect);
+
+        Region region(Rect::makeXYWH(50, 50, 20, 20));
+        region.addRects(rects.data(), static_cast<int>(rects.size()));
+
+        EXPECT_TRUE(region.equals(expected));
+
+        Region from_rects(rects.data(), static_cast<int>(rects.size()));
+        from_rects.addRect(Rect::makeXYWH(50, 50, 20, 20));
+
+        EXPECT_TRUE(from_rects.equals(expected));
+    }
+}
+
 TEST(desktop_region_test, performance)
 {
     for (int c = 0; c < 1000; ++c)
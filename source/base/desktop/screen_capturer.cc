@@ -38,6 +38,11 @@ SharedMemoryFactory* ScreenCapturer::sharedMemoryFactory() const
     return shared_memory_factory_;
 }
 
+void ScreenCapturer::setDamageCallback(DamageCallback callback)
+{
+    damage_callback_ = std::move(callback);
+}
+
 const char* ScreenCapturer::typeToString(Type type)
 {
     switch (type)
@@ -57,6 +62,9 @@ const char* ScreenCapturer::typeToString(Type type)
         case Type::LINUX_X11:
             return "LINUX_X11";
 
+        case Type::LINUX_PIPEWIRE:
+            return "LINUX_PIPEWIRE";
+
         case Type::MACOSX:
             return "MACOSX";
 
@@ -70,4 +78,10 @@ ScreenCapturer::Type ScreenCapturer::type() const
     return type_;
 }
 
+void ScreenCapturer::notifyDamage()
+{
+    if (damage_callback_)
+        damage_callback_();
+}
+
 } // namespace base
@@ -21,6 +21,7 @@
 
 #include "base/desktop/frame.h"
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -44,7 +45,8 @@ public:
         WIN_DXGI   = 3,
         LINUX_X11  = 4,
         MACOSX     = 5,
-        WIN_MIRROR = 6
+        WIN_MIRROR = 6,
+        LINUX_PIPEWIRE = 7
     };
 
     enum class Error
@@ -84,6 +86,12 @@ public:
     void setSharedMemoryFactory(SharedMemoryFactory* shared_memory_factory);
     SharedMemoryFactory* sharedMemoryFactory() const;
 
+    // Sets the callback which is called when the system notifies the capturer about screen
+    // updates. The callback can be called on any thread. Capturers which find the updates only
+    // during the capture never call it.
+    using DamageCallback = std::function<void()>;
+    void setDamageCallback(DamageCallback callback);
+
     static const char* typeToString(Type type);
     Type type() const;
 
@@ -93,6 +101,8 @@ protected:
     explicit ScreenCapturer(Type type);
     virtual void reset() = 0;
 
+    void notifyDamage();
+
     template <typename FrameType>
     class FrameQueue
     {
@@ -121,6 +131,7 @@ protected:
 
 private:
     SharedMemoryFactory* shared_memory_factory_ = nullptr;
+    DamageCallback damage_callback_;
     const Type type_;
 };
 
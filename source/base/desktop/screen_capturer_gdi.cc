@@ -29,10 +29,29 @@
 
 #include <dwmapi.h>
 
+#include <chrono>
+#include <cstring>
+
 namespace base {
 
 namespace {
 
+// The sweep captures one horizontal band of the screen in every frame, so the changes without
+// hints are found in at most this number of frames.
+const int kSweepBandCount = 8;
+
+// Number of the previous frames whose updated areas are captured again.
+const size_t kUpdateHistoryLength = 4;
+
+// The changed areas usually grow (typed text, opened menus), so the hints are enlarged.
+const int kHintMargin = 32;
+const int kCursorAreaSize = 256;
+const int kCaretMargin = 64;
+
+// A single blit of the whole screen is cheaper than many small ones.
+const int kMaxPartialRects = 32;
+const int kMaxPartialAreaPercent = 50;
+
 bool isSameCursorShape(const CURSORINFO& left, const CURSORINFO& right)
 {
     // If the cursors are not showing, we do not care the hCursor handle.
@@ -183,6 +202,8 @@ const Frame* ScreenCapturerGdi::captureImage()
         return nullptr;
     }
 
+    bool frame_created = false;
+
     if (!queue_.currentFrame() || queue_.currentFrame()->size() != screen_rect_.size())
     {
         DCHECK(desktop_dc_);
@@ -198,21 +219,55 @@ const Frame* ScreenCapturerGdi::captureImage()
 
         frame->setCapturerType(static_cast<uint32_t>(type()));
         queue_.replaceCurrentFrame(std::move(frame));
+        frame_created = true;
     }
 
     Frame* current = queue_.currentFrame();
     Frame* previous = queue_.previousFrame();
+    const Rect frame_rect = Rect::makeSize(screen_rect_.size());
+
+    // BitBlt with CAPTUREBLT is very expensive on terminal servers, so only the areas which are
+    // likely to be changed are captured if the rest of the screen can be taken from the previous
+    // frame.
+    Region capture_region;
+    if (!frame_created && previous && previous->size() == current->size())
+        capture_region = hintedRegion();
+
+    if (capture_region.isEmpty() || !isPartialCaptureCheaper(capture_region))
+    {
+        capture_region = Region(frame_rect);
+    }
+    else
+    {
+        // The buffer of the current frame contains the screen as it was two frames ago. Bring it
+        // up to date with the previous frame in the areas which are not captured.
+        Region sync_region(previous->constUpdatedRegion());
+        sync_region.subtract(capture_region);
+
+        for (Region::Iterator it(sync_region); !it.isAtEnd(); it.advance())
+            current->copyPixelsFrom(*previous, it.rect().topLeft(), it.rect());
+    }
 
     {
         win::ScopedSelectObject select_object(
             memory_dc_, static_cast<FrameDib*>(current)->bitmap());
 
-        if (!BitBlt(memory_dc_,
-                    0, 0,
-                    screen_rect_.width(), screen_rect_.height(),
-                    desktop_dc_,
-                    screen_rect_.left(), screen_rect_.top(),
-                    CAPTUREBLT | SRCCOPY))
+        bool succeeded = true;
+
+        for (Region::Iterator it(capture_region); !it.isAtEnd(); it.advance())
+        {
+            const Rect& rect = it.rect();
+
+            succeeded &= !!BitBlt(memory_dc_,
+                                  rect.left(), rect.top(),
+                                  rect.width(), rect.height(),
+                                  desktop_dc_,
+                                  screen_rect_.left() + rect.left(),
+                                  screen_rect_.top() + rect.top(),
+                                  CAPTUREBLT | SRCCOPY);
+        }
+
+        if (!succeeded)
         {
             static thread_local int count = 0;
 
@@ -230,21 +285,109 @@ const Frame* ScreenCapturerGdi::captureImage()
     current->setDpi(Point(GetDeviceCaps(desktop_dc_, LOGPIXELSX),
                           GetDeviceCaps(desktop_dc_, LOGPIXELSY)));
 
-    if (!previous || previous->size() != current->size())
+    *current->captureTiming() = Frame::CaptureTiming();
+
+    if (frame_created || !previous || previous->size() != current->size())
     {
         differ_ = std::make_unique<Differ>(screen_rect_.size());
-        current->updatedRegion()->addRect(Rect::makeSize(screen_rect_.size()));
+        current->updatedRegion()->setRect(frame_rect);
+        update_history_.clear();
     }
     else
     {
+        std::chrono::steady_clock::time_point diff_start = std::chrono::steady_clock::now();
+
         differ_->calcDirtyRegion(previous->frameData(),
                                  current->frameData(),
                                  current->updatedRegion());
+
+        current->captureTiming()->diff_duration =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - diff_start).count();
+
+        update_history_.emplace_back(current->constUpdatedRegion());
+        if (update_history_.size() > kUpdateHistoryLength)
+            update_history_.pop_front();
     }
 
     return current;
 }
 
+Region ScreenCapturerGdi::hintedRegion()
+{
+    const Rect frame_rect = Rect::makeSize(screen_rect_.size());
+    const Point origin = screen_rect_.topLeft();
+    Region region;
+
+    // The recently changed areas usually keep changing.
+    for (const Region& updated_region : update_history_)
+    {
+        for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+        {
+            Rect rect = it.rect();
+            rect.extend(kHintMargin, kHintMargin, kHintMargin, kHintMargin);
+            region.addRect(rect);
+        }
+    }
+
+    // The user mostly changes the screen around the cursor and the caret.
+    POINT cursor_pos;
+    if (GetCursorPos(&cursor_pos))
+    {
+        region.addRect(Rect::makeXYWH(cursor_pos.x - origin.x() - kCursorAreaSize / 2,
+                                      cursor_pos.y - origin.y() - kCursorAreaSize / 2,
+                                      kCursorAreaSize,
+                                      kCursorAreaSize));
+    }
+
+    GUITHREADINFO thread_info;
+    memset(&thread_info, 0, sizeof(thread_info));
+    thread_info.cbSize = sizeof(thread_info);
+
+    if (GetGUIThreadInfo(0, &thread_info) && thread_info.hwndCaret)
+    {
+        POINT caret_pos = { thread_info.rcCaret.left, thread_info.rcCaret.top };
+        if (ClientToScreen(thread_info.hwndCaret, &caret_pos))
+        {
+            Rect caret_rect = Rect::makeXYWH(
+                caret_pos.x - origin.x(),
+                caret_pos.y - origin.y(),
+                thread_info.rcCaret.right - thread_info.rcCaret.left,
+                thread_info.rcCaret.bottom - thread_info.rcCaret.top);
+            caret_rect.extend(kCaretMargin, kCaretMargin, kCaretMargin, kCaretMargin);
+            region.addRect(caret_rect);
+        }
+    }
+
+    // The changes without hints are found by the sweep.
+    const int band_height = (frame_rect.height() + kSweepBandCount - 1) / kSweepBandCount;
+    region.addRect(
+        Rect::makeXYWH(0, sweep_band_ * band_height, frame_rect.width(), band_height));
+    sweep_band_ = (sweep_band_ + 1) % kSweepBandCount;
+
+    region.intersectWith(frame_rect);
+    return region;
+}
+
+bool ScreenCapturerGdi::isPartialCaptureCheaper(const Region& region) const
+{
+    int rect_count = 0;
+    int64_t area = 0;
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        if (++rect_count > kMaxPartialRects)
+            return false;
+
+        area += static_cast<int64_t>(it.rect().width()) * it.rect().height();
+    }
+
+    const int64_t screen_area =
+        static_cast<int64_t>(screen_rect_.width()) * screen_rect_.height();
+
+    return area * 100 <= screen_area * kMaxPartialAreaPercent;
+}
+
 bool ScreenCapturerGdi::prepareCaptureResources()
 {
     Rect desktop_rect = ScreenCaptureUtils::fullScreenRect();
@@ -23,6 +23,8 @@
 #include "base/desktop/shared_frame.h"
 #include "base/win/scoped_hdc.h"
 
+#include <deque>
+
 namespace base {
 
 class Differ;
@@ -51,6 +53,10 @@ private:
     const Frame* captureImage();
     bool prepareCaptureResources();
 
+    // Returns the areas of the screen which are likely to be changed since the previous frame.
+    Region hintedRegion();
+    bool isPartialCaptureCheaper(const Region& region) const;
+
     bool composition_changed_ = false;
 
     ScreenId current_screen_id_ = kFullDesktopScreenId;
@@ -60,6 +66,9 @@ private:
     Rect screen_rect_;
 
     std::unique_ptr<Differ> differ_;
+    std::deque<Region> update_history_;
+    int sweep_band_ = 0;
+
     win::ScopedGetDC desktop_dc_;
     win::ScopedCreateDC memory_dc_;
 
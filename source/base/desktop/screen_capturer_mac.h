@@ -19,10 +19,28 @@
 #ifndef BASE__DESKTOP__SCREEN_CAPTURER_MAC_H
 #define BASE__DESKTOP__SCREEN_CAPTURER_MAC_H
 
+#include "base/desktop/region.h"
 #include "base/desktop/screen_capturer.h"
+#include "base/desktop/shared_frame.h"
+
+#include <atomic>
+#include <mutex>
+
+#include <IOSurface/IOSurfaceRef.h>
+#ifdef __OBJC__
+@class SCStream;
+@class ScreenCapturerMacOutput;
+#else
+class SCStream;
+class ScreenCapturerMacOutput;
+#endif
 
 namespace base {
 
+// Captures a display with ScreenCaptureKit (macOS 12.3+). The stream delivers IOSurface-backed
+// frames together with the dirty rects of the frame. The stream callback only keeps a reference
+// to the newest surface; on capture the dirty rects are copied from it directly into the frame in
+// shared memory.
 class ScreenCapturerMac : public ScreenCapturer
 {
 public:
@@ -43,6 +61,35 @@ protected:
     void reset() override;
 
 private:
+    enum class StreamState
+    {
+        STOPPED,
+        STARTING,
+        RUNNING,
+        FAILED
+    };
+
+    void startStream();
+    void stopStream();
+    const Frame* captureImage();
+    uint32_t displayId() const;
+
+    // Called on the dispatch queue of the stream.
+    void onStreamFrame(IOSurfaceRef surface, const Region& dirty_region);
+
+    ScreenId current_screen_id_ = kFullDesktopScreenId;
+
+    SCStream* stream_ = nullptr;
+    ScreenCapturerMacOutput* stream_output_ = nullptr;
+    std::atomic<StreamState> stream_state_ = StreamState::STOPPED;
+
+    // The newest surface of the stream and the area changed since the previous frame.
+    std::mutex surface_lock_;
+    IOSurfaceRef surface_ = nullptr;
+    Region dirty_region_;
+
+    FrameQueue<Frame> queue_;
+
     DISALLOW_COPY_AND_ASSIGN(ScreenCapturerMac);
 };
 
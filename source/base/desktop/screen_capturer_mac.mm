@@ -19,64 +19,619 @@
 #include "base/desktop/screen_capturer_mac.h"
 
 #include "base/logging.h"
+#include "base/desktop/shared_memory_frame.h"
+#include "base/mac/nsstring_conversions.h"
+
+#include <cmath>
+
+#include <ApplicationServices/ApplicationServices.h>
+#include <CoreMedia/CoreMedia.h>
+#include <CoreVideo/CoreVideo.h>
+#include <IOSurface/IOSurface.h>
+#include <ScreenCaptureKit/ScreenCaptureKit.h>
+
+using FrameHandler = void (^)(IOSurfaceRef surface, const base::Region& dirty_region);
+using StateHandler = void (^)(bool running);
+
+// Receives the frames and the state changes of the stream. The handlers are called on the
+// dispatch queue of the stream and can be removed with invalidate() at any time.
+API_AVAILABLE(macos(12.3))
+@interface ScreenCapturerMacOutput : NSObject <SCStreamOutput, SCStreamDelegate>
+{
+    FrameHandler frame_handler_;
+    StateHandler state_handler_;
+}
+
+- (instancetype)initWithFrameHandler:(FrameHandler)frame_handler
+                        stateHandler:(StateHandler)state_handler;
+- (void)notifyState:(bool)running;
+- (void)invalidate;
+
+@end
+
+@implementation ScreenCapturerMacOutput
+
+- (instancetype)initWithFrameHandler:(FrameHandler)frame_handler
+                        stateHandler:(StateHandler)state_handler
+{
+    self = [super init];
+    if (self)
+    {
+        frame_handler_ = [frame_handler copy];
+        state_handler_ = [state_handler copy];
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    [frame_handler_ release];
+    [state_handler_ release];
+    [super dealloc];
+}
+
+- (void)notifyState:(bool)running
+{
+    @synchronized(self)
+    {
+        if (state_handler_)
+            state_handler_(running);
+    }
+}
+
+- (void)invalidate
+{
+    @synchronized(self)
+    {
+        [frame_handler_ release];
+        frame_handler_ = nil;
+
+        [state_handler_ release];
+        state_handler_ = nil;
+    }
+}
+
+- (void)stream:(SCStream*)stream
+    didOutputSampleBuffer:(CMSampleBufferRef)sample_buffer
+                   ofType:(SCStreamOutputType)type
+{
+    if (type != SCStreamOutputTypeScreen)
+        return;
+
+    CFArrayRef attachments = CMSampleBufferGetSampleAttachmentsArray(sample_buffer, false);
+    if (!attachments || CFArrayGetCount(attachments) < 1)
+        return;
+
+    NSDictionary* info = reinterpret_cast<NSDictionary*>(
+        const_cast<void*>(CFArrayGetValueAtIndex(attachments, 0)));
+
+    // Idle frames (nothing has changed) and blank frames carry no image.
+    NSNumber* status = info[SCStreamFrameInfoStatus];
+    if (!status || status.integerValue != SCFrameStatusComplete)
+        return;
+
+    CVPixelBufferRef pixel_buffer = CMSampleBufferGetImageBuffer(sample_buffer);
+    if (!pixel_buffer)
+        return;
+
+    IOSurfaceRef surface = CVPixelBufferGetIOSurface(pixel_buffer);
+    if (!surface)
+        return;
+
+    base::Region dirty_region;
+
+    NSArray* dirty_rects = info[SCStreamFrameInfoDirtyRects];
+    if (dirty_rects)
+    {
+        for (id value in dirty_rects)
+        {
+            CFDictionaryRef dictionary = reinterpret_cast<CFDictionaryRef>(value);
+
+            CGRect rect = CGRectNull;
+            if (!CGRectMakeWithDictionaryRepresentation(dictionary, &rect))
+                continue;
+
+            dirty_region.addRect(base::Rect::makeLTRB(
+                static_cast<int32_t>(std::floor(CGRectGetMinX(rect))),
+                static_cast<int32_t>(std::floor(CGRectGetMinY(rect))),
+                static_cast<int32_t>(std::ceil(CGRectGetMaxX(rect))),
+                static_cast<int32_t>(std::ceil(CGRectGetMaxY(rect)))));
+        }
+    }
+    else
+    {
+        dirty_region.addRect(base::Rect::makeWH(static_cast<int32_t>(IOSurfaceGetWidth(surface)),
+                                                static_cast<int32_t>(IOSurfaceGetHeight(surface))));
+    }
+
+    @synchronized(self)
+    {
+        if (frame_handler_)
+            frame_handler_(surface, dirty_region);
+    }
+}
+
+- (void)stream:(SCStream*)stream didStopWithError:(NSError*)error
+{
+    LOG(LS_WARNING) << "Stream stopped with error: "
+                    << base::NSStringToUtf8(error.localizedDescription);
+    [self notifyState:false];
+}
+
+@end
 
 namespace base {
 
+namespace {
+
+const uint32_t kMaxDisplays = 16;
+const int kMaxFrameRate = 60;
+
+// The capturer keeps one surface of the stream, so the queue is a bit deeper than the default.
+const int kQueueDepth = 5;
+
+const int64_t kShareableContentTimeout = 5 * NSEC_PER_SEC;
+
+Size displayPixelSize(CGDirectDisplayID display_id)
+{
+    CGDisplayModeRef mode = CGDisplayCopyDisplayMode(display_id);
+    if (!mode)
+    {
+        return Size(static_cast<int32_t>(CGDisplayPixelsWide(display_id)),
+                    static_cast<int32_t>(CGDisplayPixelsHigh(display_id)));
+    }
+
+    Size size(static_cast<int32_t>(CGDisplayModeGetPixelWidth(mode)),
+              static_cast<int32_t>(CGDisplayModeGetPixelHeight(mode)));
+    CGDisplayModeRelease(mode);
+    return size;
+}
+
+void releaseSurface(IOSurfaceRef surface)
+{
+    IOSurfaceDecrementUseCount(surface);
+    CFRelease(surface);
+}
+
+} // namespace
+
 ScreenCapturerMac::ScreenCapturerMac()
     : ScreenCapturer(ScreenCapturer::Type::MACOSX)
 {
     // Nothing
 }
 
-ScreenCapturerMac::~ScreenCapturerMac() = default;
+ScreenCapturerMac::~ScreenCapturerMac()
+{
+    stopStream();
+}
 
 int ScreenCapturerMac::screenCount()
 {
-    NOTIMPLEMENTED();
-    return 0;
+    uint32_t count = 0;
+    if (CGGetActiveDisplayList(0, nullptr, &count) != kCGErrorSuccess)
+        return 0;
+
+    return static_cast<int>(count);
 }
 
-bool ScreenCapturerMac::screenList(ScreenList* /* screens */)
+bool ScreenCapturerMac::screenList(ScreenList* screens)
 {
-    NOTIMPLEMENTED();
-    return false;
+    DCHECK(screens);
+
+    CGDirectDisplayID displays[kMaxDisplays];
+    uint32_t count = 0;
+
+    if (CGGetActiveDisplayList(kMaxDisplays, displays, &count) != kCGErrorSuccess)
+    {
+        LOG(LS_WARNING) << "CGGetActiveDisplayList failed";
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        Screen screen;
+        screen.id = static_cast<ScreenId>(displays[i]);
+        screen.title = std::to_string(i + 1);
+        screen.resolution = displayPixelSize(displays[i]);
+        screen.is_primary = CGDisplayIsMain(displays[i]);
+
+        screens->screens.emplace_back(std::move(screen));
+    }
+
+    return true;
 }
 
-bool ScreenCapturerMac::selectScreen(ScreenId /* screen_id */)
+bool ScreenCapturerMac::selectScreen(ScreenId screen_id)
 {
-    NOTIMPLEMENTED();
-    return false;
+    LOG(LS_INFO) << "Select screen with ID: " << screen_id;
+
+    if (screen_id != kFullDesktopScreenId && !CGDisplayIsActive(static_cast<uint32_t>(screen_id)))
+    {
+        LOG(LS_WARNING) << "Invalid screen";
+        return false;
+    }
+
+    if (screen_id == current_screen_id_)
+        return true;
+
+    // The stream is recreated for the new display at the next capture.
+    stopStream();
+
+    current_screen_id_ = screen_id;
+    return true;
 }
 
 ScreenCapturer::ScreenId ScreenCapturerMac::currentScreen() const
 {
-    NOTIMPLEMENTED();
-    return kInvalidScreenId;
+    return current_screen_id_;
 }
 
 const Frame* ScreenCapturerMac::captureFrame(Error* error)
 {
     DCHECK(error);
-    NOTIMPLEMENTED();
-    *error = Error::PERMANENT;
-    return nullptr;
+
+    if (@available(macOS 12.3, *))
+    {
+        // Nothing
+    }
+    else
+    {
+        LOG(LS_WARNING) << "ScreenCaptureKit is not available";
+        *error = Error::PERMANENT;
+        return nullptr;
+    }
+
+    switch (stream_state_)
+    {
+        case StreamState::STOPPED:
+            startStream();
+            *error = Error::TEMPORARY;
+            return nullptr;
+
+        case StreamState::STARTING:
+            *error = Error::TEMPORARY;
+            return nullptr;
+
+        case StreamState::FAILED:
+            *error = Error::PERMANENT;
+            return nullptr;
+
+        case StreamState::RUNNING:
+            break;
+    }
+
+    const Frame* frame = captureImage();
+    if (!frame)
+    {
+        *error = Error::TEMPORARY;
+        return nullptr;
+    }
+
+    *error = Error::SUCCEEDED;
+    return frame;
 }
 
 const MouseCursor* ScreenCapturerMac::captureCursor()
 {
-    NOTIMPLEMENTED();
+    // The cursor is drawn into the stream.
     return nullptr;
 }
 
 Point ScreenCapturerMac::cursorPosition()
 {
-    NOTIMPLEMENTED();
-    return Point();
+    CGEventRef event = CGEventCreate(nullptr);
+    if (!event)
+        return Point();
+
+    CGPoint location = CGEventGetLocation(event);
+    CFRelease(event);
+
+    // The location is in points of the global display space, the frame is in pixels.
+    const CGDirectDisplayID display_id = displayId();
+    const CGRect bounds = CGDisplayBounds(display_id);
+    const Size pixel_size = displayPixelSize(display_id);
+
+    double scale = 1.0;
+    if (bounds.size.width > 0)
+        scale = pixel_size.width() / bounds.size.width;
+
+    return Point(static_cast<int32_t>((location.x - bounds.origin.x) * scale),
+                 static_cast<int32_t>((location.y - bounds.origin.y) * scale));
 }
 
 void ScreenCapturerMac::reset()
 {
-    NOTIMPLEMENTED();
+    // macOS has no input desktops to switch between, the stream stays valid.
+}
+
+void ScreenCapturerMac::startStream()
+{
+    if (@available(macOS 12.3, *))
+    {
+        DCHECK(!stream_);
+        stream_state_ = StreamState::STARTING;
+
+        const CGDirectDisplayID display_id = displayId();
+
+        // The list of displays is requested asynchronously, but the answer comes quickly. The
+        // stream is created on the capturer thread, so there is no need to synchronize it.
+        __block SCShareableContent* shareable_content = nil;
+        dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+
+        [SCShareableContent getShareableContentWithCompletionHandler:
+            ^(SCShareableContent* content, NSError* error)
+        {
+            if (content)
+            {
+                shareable_content = [content retain];
+            }
+            else
+            {
+                // Usually means that the screen recording permission is not granted.
+                LOG(LS_WARNING) << "Unable to get shareable content: "
+                                << NSStringToUtf8(error.localizedDescription);
+            }
+
+            dispatch_semaphore_signal(semaphore);
+        }];
+
+        long wait_result = dispatch_semaphore_wait(
+            semaphore, dispatch_time(DISPATCH_TIME_NOW, kShareableContentTimeout));
+        dispatch_release(semaphore);
+
+        if (wait_result != 0 || !shareable_content)
+        {
+            LOG(LS_WARNING) << "No shareable content";
+            stream_state_ = StreamState::FAILED;
+            return;
+        }
+
+        SCDisplay* display = nil;
+        for (SCDisplay* item in shareable_content.displays)
+        {
+            if (item.displayID == display_id)
+            {
+                display = item;
+                break;
+            }
+        }
+
+        if (!display)
+        {
+            LOG(LS_WARNING) << "Display " << display_id << " not found";
+            [shareable_content release];
+            stream_state_ = StreamState::FAILED;
+            return;
+        }
+
+        const Size size = displayPixelSize(display_id);
+
+        SCContentFilter* filter =
+            [[SCContentFilter alloc] initWithDisplay:display excludingWindows:@[]];
+        [shareable_content release];
+
+        SCStreamConfiguration* config = [[SCStreamConfiguration alloc] init];
+        config.width = static_cast<size_t>(size.width());
+        config.height = static_cast<size_t>(size.height());
+        config.pixelFormat = kCVPixelFormatType_32BGRA;
+        config.showsCursor = YES;
+        config.minimumFrameInterval = CMTimeMake(1, kMaxFrameRate);
+        config.queueDepth = kQueueDepth;
+
+        std::atomic<StreamState>* stream_state = &stream_state_;
+
+        stream_output_ = [[ScreenCapturerMacOutput alloc]
+            initWithFrameHandler:^(IOSurfaceRef surface, const Region& dirty_region)
+            {
+                onStreamFrame(surface, dirty_region);
+            }
+            stateHandler:^(bool running)
+            {
+                StreamState expected = StreamState::STARTING;
+                if (!running)
+                    *stream_state = StreamState::FAILED;
+                else
+                    stream_state->compare_exchange_strong(expected, StreamState::RUNNING);
+            }];
+
+        stream_ = [[SCStream alloc] initWithFilter:filter
+                                     configuration:config
+                                          delegate:stream_output_];
+        [filter release];
+        [config release];
+
+        dispatch_queue_t queue =
+            dispatch_queue_create("aspia.screen_capturer_mac", DISPATCH_QUEUE_SERIAL);
+
+        NSError* error = nil;
+        BOOL added = [stream_ addStreamOutput:stream_output_
+                                         type:SCStreamOutputTypeScreen
+                           sampleHandlerQueue:queue
+                                        error:&error];
+        dispatch_release(queue);
+
+        if (!added)
+        {
+            LOG(LS_WARNING) << "addStreamOutput failed: "
+                            << NSStringToUtf8(error.localizedDescription);
+            stopStream();
+            stream_state_ = StreamState::FAILED;
+            return;
+        }
+
+        // The block holds a reference to the output, the output may outlive the capturer.
+        ScreenCapturerMacOutput* output = stream_output_;
+
+        [stream_ startCaptureWithCompletionHandler:^(NSError* start_error)
+        {
+            if (start_error)
+            {
+                LOG(LS_WARNING) << "Unable to start capture: "
+                                << NSStringToUtf8(start_error.localizedDescription);
+            }
+
+            [output notifyState:(start_error == nil)];
+        }];
+
+        LOG(LS_INFO) << "Starting capture of display " << display_id << " (" << size << ")";
+    }
+}
+
+void ScreenCapturerMac::stopStream()
+{
+    if (@available(macOS 12.3, *))
+    {
+        // After this no handlers are called, even if the stream is still stopping.
+        [stream_output_ invalidate];
+
+        if (stream_)
+        {
+            [stream_ stopCaptureWithCompletionHandler:^(NSError* /* error */)
+            {
+                // Nothing
+            }];
+
+            [stream_ release];
+            stream_ = nullptr;
+        }
+
+        [stream_output_ release];
+        stream_output_ = nullptr;
+    }
+
+    {
+        std::scoped_lock lock(surface_lock_);
+
+        if (surface_)
+        {
+            releaseSurface(surface_);
+            surface_ = nullptr;
+        }
+
+        dirty_region_.clear();
+    }
+
+    queue_.reset();
+    stream_state_ = StreamState::STOPPED;
+}
+
+const Frame* ScreenCapturerMac::captureImage()
+{
+    IOSurfaceRef surface = nullptr;
+    Region dirty_region;
+
+    {
+        std::scoped_lock lock(surface_lock_);
+
+        if (!surface_)
+            return nullptr;
+
+        surface = surface_;
+        CFRetain(surface);
+        IOSurfaceIncrementUseCount(surface);
+
+        dirty_region.swap(&dirty_region_);
+    }
+
+    const Size size(static_cast<int32_t>(IOSurfaceGetWidth(surface)),
+                    static_cast<int32_t>(IOSurfaceGetHeight(surface)));
+
+    queue_.moveToNextFrame();
+
+    if (!queue_.currentFrame() || queue_.currentFrame()->size() != size)
+    {
+        std::unique_ptr<Frame> frame = SharedMemoryFrame::create(
+            size, PixelFormat::ARGB(), sharedMemoryFactory());
+        if (!frame)
+        {
+            LOG(LS_WARNING) << "Failed to create frame buffer";
+            releaseSurface(surface);
+            return nullptr;
+        }
+
+        frame->setCapturerType(static_cast<uint32_t>(type()));
+        queue_.replaceCurrentFrame(std::move(frame));
+    }
+
+    Frame* current = queue_.currentFrame();
+    Frame* previous = queue_.previousFrame();
+
+    const Rect frame_rect = Rect::makeSize(size);
+    Region copy_region;
+
+    if (!previous || previous->size() != current->size())
+    {
+        dirty_region.setRect(frame_rect);
+        copy_region.setRect(frame_rect);
+    }
+    else
+    {
+        // The buffer of the current frame contains the screen as it was two frames ago, so the
+        // updates of the previous frame are copied too.
+        dirty_region.intersectWith(frame_rect);
+
+        copy_region = dirty_region;
+        copy_region.addRegion(previous->constUpdatedRegion());
+    }
+
+    if (IOSurfaceLock(surface, kIOSurfaceLockReadOnly, nullptr) != kIOReturnSuccess)
+    {
+        LOG(LS_WARNING) << "IOSurfaceLock failed";
+        releaseSurface(surface);
+
+        // The frame is complete only when the previous updates are copied too.
+        queue_.reset();
+        return nullptr;
+    }
+
+    const uint8_t* data = static_cast<const uint8_t*>(IOSurfaceGetBaseAddress(surface));
+    const size_t stride = IOSurfaceGetBytesPerRow(surface);
+
+    for (Region::Iterator it(copy_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect rect = it.rect();
+        current->copyPixelsFrom(data + rect.y() * stride + rect.x() * 4,
+                                static_cast<int>(stride), rect);
+    }
+
+    IOSurfaceUnlock(surface, kIOSurfaceLockReadOnly, nullptr);
+    releaseSurface(surface);
+
+    current->updatedRegion()->swap(&dirty_region);
+    return current;
+}
+
+uint32_t ScreenCapturerMac::displayId() const
+{
+    // The whole desktop of several displays can not be captured as one stream, the main display
+    // is used instead.
+    if (current_screen_id_ == kFullDesktopScreenId)
+        return CGMainDisplayID();
+
+    return static_cast<uint32_t>(current_screen_id_);
+}
+
+void ScreenCapturerMac::onStreamFrame(IOSurfaceRef surface, const Region& dirty_region)
+{
+    {
+        std::scoped_lock lock(surface_lock_);
+
+        if (surface_)
+            releaseSurface(surface_);
+
+        // The use count prevents the stream from writing into the surface while it is
+        // referenced.
+        surface_ = surface;
+        CFRetain(surface_);
+        IOSurfaceIncrementUseCount(surface_);
+
+        dirty_region_.addRegion(dirty_region);
+    }
+
+    if (!dirty_region.isEmpty())
+        notifyDamage();
 }
 
 } // namespace base
@@ -132,8 +132,10 @@ const Frame* ScreenCapturerMirror::captureFrame(Error* error)
     // Exclude a region that should not be captured.
     updated_region->subtract(exclude_region_);
 
-    // Copy the image of the modified areas into the frame.
-    helper_->copyRegion(frame_.get(), *updated_region);
+    // Copy the image of the modified areas into the frame. The areas where the driver reported
+    // drawing without a visible change are removed from the region, so the frame does not need
+    // the Differ.
+    helper_->copyRegion(frame_.get(), updated_region);
 
     const Rect& screen_rect = helper_->screenRect();
 
@@ -0,0 +1,646 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/desktop/screen_capturer_pipewire.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame_simple.h"
+#include "base/desktop/shared_memory_frame.h"
+#include "base/desktop/linux/screencast_portal.h"
+
+#include <spa/buffer/meta.h>
+#include <spa/param/video/format-utils.h>
+#include <spa/pod/builder.h>
+#include <spa/utils/result.h>
+
+#include <cstring>
+#include <iterator>
+
+#include <linux/dma-buf.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+namespace base {
+
+namespace {
+
+// DRM_FORMAT_MOD_LINEAR from drm_fourcc.h. Only linear buffers can be mapped and read by CPU.
+const uint64_t kDrmFormatModLinear = 0;
+
+const int kMaxDamageRects = 16;
+const int kRegionSize = static_cast<int>(sizeof(spa_meta_region));
+
+spa_pod* buildFormat(spa_pod_builder* builder, const Size& size, bool dmabuf)
+{
+    const spa_rectangle default_size = { static_cast<uint32_t>(size.width()),
+                                         static_cast<uint32_t>(size.height()) };
+    const spa_rectangle min_size = { 1, 1 };
+    const spa_rectangle max_size = { 8192, 8192 };
+
+    const spa_fraction default_rate = { 30, 1 };
+    const spa_fraction min_rate = { 0, 1 };
+    const spa_fraction max_rate = { 60, 1 };
+
+    spa_pod_frame frame;
+    spa_pod_builder_push_object(builder, &frame, SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat);
+    spa_pod_builder_add(builder,
+        SPA_FORMAT_mediaType, SPA_POD_Id(SPA_MEDIA_TYPE_video),
+        SPA_FORMAT_mediaSubtype, SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
+        SPA_FORMAT_VIDEO_format, SPA_POD_CHOICE_ENUM_Id(
+            3, SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_BGRA),
+        SPA_FORMAT_VIDEO_size, SPA_POD_CHOICE_RANGE_Rectangle(
+            &default_size, &min_size, &max_size),
+        SPA_FORMAT_VIDEO_framerate, SPA_POD_CHOICE_RANGE_Fraction(
+            &default_rate, &min_rate, &max_rate),
+        0);
+
+    if (dmabuf)
+    {
+        spa_pod_builder_prop(builder, SPA_FORMAT_VIDEO_modifier, SPA_POD_PROP_FLAG_MANDATORY);
+        spa_pod_builder_long(builder, static_cast<int64_t>(kDrmFormatModLinear));
+    }
+
+    return static_cast<spa_pod*>(spa_pod_builder_pop(builder, &frame));
+}
+
+// Adds the damage of |buffer| to |damage|. Without the damage metadata the whole image is
+// considered changed.
+void addBufferDamage(spa_buffer* buffer, const Rect& image_rect, Region* damage)
+{
+    spa_meta* meta = spa_buffer_find_meta(buffer, SPA_META_VideoDamage);
+    if (!meta)
+    {
+        damage->addRect(image_rect);
+        return;
+    }
+
+    bool has_regions = false;
+    spa_meta_region* region;
+
+    spa_meta_for_each(region, meta)
+    {
+        if (!spa_meta_region_is_valid(region))
+            break;
+
+        damage->addRect(Rect::makeXYWH(region->region.position.x,
+                                       region->region.position.y,
+                                       static_cast<int32_t>(region->region.size.width),
+                                       static_cast<int32_t>(region->region.size.height)));
+        has_regions = true;
+    }
+
+    if (!has_regions)
+        damage->addRect(image_rect);
+}
+
+void syncDmaBuf(int fd, uint64_t flags)
+{
+    dma_buf_sync sync;
+    sync.flags = flags | DMA_BUF_SYNC_READ;
+
+    if (ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync) == -1)
+    {
+        PLOG(LS_WARNING) << "DMA_BUF_IOCTL_SYNC failed";
+    }
+}
+
+} // namespace
+
+ScreenCapturerPipeWire::ScreenCapturerPipeWire()
+    : ScreenCapturer(ScreenCapturer::Type::LINUX_PIPEWIRE)
+{
+    memset(&core_listener_, 0, sizeof(core_listener_));
+    memset(&core_events_, 0, sizeof(core_events_));
+    memset(&stream_listener_, 0, sizeof(stream_listener_));
+    memset(&stream_events_, 0, sizeof(stream_events_));
+    memset(&video_format_, 0, sizeof(video_format_));
+
+    core_events_.version = PW_VERSION_CORE_EVENTS;
+    core_events_.error = &ScreenCapturerPipeWire::onCoreErrorCallback;
+
+    stream_events_.version = PW_VERSION_STREAM_EVENTS;
+    stream_events_.state_changed = &ScreenCapturerPipeWire::onStreamStateChangedCallback;
+    stream_events_.param_changed = &ScreenCapturerPipeWire::onStreamParamChangedCallback;
+    stream_events_.process = &ScreenCapturerPipeWire::onStreamProcessCallback;
+}
+
+ScreenCapturerPipeWire::~ScreenCapturerPipeWire()
+{
+    stopStream();
+}
+
+int ScreenCapturerPipeWire::screenCount()
+{
+    // The portal gives one stream for the monitor selected by the user.
+    return 1;
+}
+
+bool ScreenCapturerPipeWire::screenList(ScreenList* screens)
+{
+    DCHECK(screens);
+
+    Screen screen;
+    screen.id = kFullDesktopScreenId;
+    screen.is_primary = true;
+
+    {
+        std::scoped_lock lock(stream_lock_);
+        if (stream_frame_)
+            screen.resolution = stream_frame_->size();
+        else if (portal_)
+            screen.resolution = portal_->streamSize();
+    }
+
+    screens->screens.emplace_back(std::move(screen));
+    return true;
+}
+
+bool ScreenCapturerPipeWire::selectScreen(ScreenId screen_id)
+{
+    LOG(LS_INFO) << "Select screen with ID: " << screen_id;
+
+    if (screen_id != kFullDesktopScreenId)
+    {
+        LOG(LS_WARNING) << "Invalid screen";
+        return false;
+    }
+
+    return true;
+}
+
+ScreenCapturer::ScreenId ScreenCapturerPipeWire::currentScreen() const
+{
+    return kFullDesktopScreenId;
+}
+
+const Frame* ScreenCapturerPipeWire::captureFrame(Error* error)
+{
+    DCHECK(error);
+
+    if (!portal_)
+    {
+        portal_ = std::make_unique<ScreenCastPortal>();
+        portal_->start();
+    }
+
+    portal_->processEvents();
+
+    switch (portal_->state())
+    {
+        case ScreenCastPortal::State::FAILED:
+            *error = Error::PERMANENT;
+            return nullptr;
+
+        case ScreenCastPortal::State::READY:
+            break;
+
+        default:
+            // The user has not yet chosen the screen in the portal dialog.
+            *error = Error::TEMPORARY;
+            return nullptr;
+    }
+
+    if (!loop_ && !startStream())
+    {
+        *error = Error::PERMANENT;
+        return nullptr;
+    }
+
+    if (stream_failed_)
+    {
+        *error = Error::PERMANENT;
+        return nullptr;
+    }
+
+    const Frame* frame = captureImage();
+    if (!frame)
+    {
+        *error = Error::TEMPORARY;
+        return nullptr;
+    }
+
+    *error = Error::SUCCEEDED;
+    return frame;
+}
+
+const MouseCursor* ScreenCapturerPipeWire::captureCursor()
+{
+    // The cursor is embedded into the stream.
+    return nullptr;
+}
+
+Point ScreenCapturerPipeWire::cursorPosition()
+{
+    // The portal does not report the cursor position in the embedded cursor mode.
+    return Point();
+}
+
+void ScreenCapturerPipeWire::reset()
+{
+    // Wayland has no input desktops to switch between, the stream stays valid.
+}
+
+bool ScreenCapturerPipeWire::startStream()
+{
+    pw_init(nullptr, nullptr);
+    pipewire_initialized_ = true;
+
+    loop_ = pw_thread_loop_new("aspia-pipewire", nullptr);
+    if (!loop_)
+    {
+        LOG(LS_WARNING) << "pw_thread_loop_new failed";
+        return false;
+    }
+
+    context_ = pw_context_new(pw_thread_loop_get_loop(loop_), nullptr, 0);
+    if (!context_)
+    {
+        LOG(LS_WARNING) << "pw_context_new failed";
+        return false;
+    }
+
+    if (pw_thread_loop_start(loop_) < 0)
+    {
+        LOG(LS_WARNING) << "pw_thread_loop_start failed";
+        return false;
+    }
+
+    pw_thread_loop_lock(loop_);
+
+    // The core takes ownership of the descriptor.
+    core_ = pw_context_connect_fd(context_, portal_->takePipeWireFd(), nullptr, 0);
+    if (!core_)
+    {
+        pw_thread_loop_unlock(loop_);
+        LOG(LS_WARNING) << "pw_context_connect_fd failed";
+        return false;
+    }
+
+    pw_core_add_listener(core_, &core_listener_, &core_events_, this);
+
+    stream_ = pw_stream_new(core_, "aspia-screen-capturer",
+                            pw_properties_new(PW_KEY_MEDIA_TYPE, "Video",
+                                              PW_KEY_MEDIA_CATEGORY, "Capture",
+                                              PW_KEY_MEDIA_ROLE, "Screen",
+                                              nullptr));
+    if (!stream_)
+    {
+        pw_thread_loop_unlock(loop_);
+        LOG(LS_WARNING) << "pw_stream_new failed";
+        return false;
+    }
+
+    pw_stream_add_listener(stream_, &stream_listener_, &stream_events_, this);
+
+    uint8_t buffer[1024];
+    spa_pod_builder builder = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+
+    // The format with the modifier goes first, so DMA-BUF is preferred when the compositor
+    // supports it.
+    const spa_pod* params[2];
+    params[0] = buildFormat(&builder, portal_->streamSize(), true);
+    params[1] = buildFormat(&builder, portal_->streamSize(), false);
+
+    int ret = pw_stream_connect(stream_,
+                                PW_DIRECTION_INPUT,
+                                portal_->nodeId(),
+                                static_cast<pw_stream_flags>(
+                                    PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS),
+                                params,
+                                std::size(params));
+
+    pw_thread_loop_unlock(loop_);
+
+    if (ret < 0)
+    {
+        LOG(LS_WARNING) << "pw_stream_connect failed: " << spa_strerror(ret);
+        return false;
+    }
+
+    LOG(LS_INFO) << "PipeWire stream connected (node: " << portal_->nodeId() << ")";
+    return true;
+}
+
+void ScreenCapturerPipeWire::stopStream()
+{
+    // After the thread is stopped, no callbacks are called.
+    if (loop_)
+        pw_thread_loop_stop(loop_);
+
+    if (stream_)
+    {
+        pw_stream_destroy(stream_);
+        stream_ = nullptr;
+    }
+
+    if (core_)
+    {
+        pw_core_disconnect(core_);
+        core_ = nullptr;
+    }
+
+    if (context_)
+    {
+        pw_context_destroy(context_);
+        context_ = nullptr;
+    }
+
+    if (loop_)
+    {
+        pw_thread_loop_destroy(loop_);
+        loop_ = nullptr;
+    }
+
+    if (pipewire_initialized_)
+    {
+        pw_deinit();
+        pipewire_initialized_ = false;
+    }
+}
+
+const Frame* ScreenCapturerPipeWire::captureImage()
+{
+    std::scoped_lock lock(stream_lock_);
+
+    if (!stream_frame_)
+        return nullptr;
+
+    queue_.moveToNextFrame();
+
+    if (!queue_.currentFrame() || queue_.currentFrame()->size() != stream_frame_->size())
+    {
+        std::unique_ptr<Frame> frame = SharedMemoryFrame::create(
+            stream_frame_->size(), PixelFormat::ARGB(), sharedMemoryFactory());
+        if (!frame)
+        {
+            LOG(LS_WARNING) << "Failed to create frame buffer";
+            return nullptr;
+        }
+
+        frame->setCapturerType(static_cast<uint32_t>(type()));
+        queue_.replaceCurrentFrame(std::move(frame));
+    }
+
+    Frame* current = queue_.currentFrame();
+    Frame* previous = queue_.previousFrame();
+
+    Region copy_region;
+
+    if (!previous || previous->size() != current->size())
+    {
+        stream_damage_.setRect(Rect::makeSize(current->size()));
+        copy_region.setRect(Rect::makeSize(current->size()));
+    }
+    else
+    {
+        // The buffer of the current frame contains the screen as it was two frames ago, so the
+        // updates of the previous frame are copied too.
+        copy_region = stream_damage_;
+        copy_region.addRegion(previous->constUpdatedRegion());
+    }
+
+    for (Region::Iterator it(copy_region); !it.isAtEnd(); it.advance())
+        current->copyPixelsFrom(*stream_frame_, it.rect().topLeft(), it.rect());
+
+    current->updatedRegion()->clear();
+    current->updatedRegion()->swap(&stream_damage_);
+    return current;
+}
+
+void ScreenCapturerPipeWire::onStreamStateChanged(pw_stream_state state, const char* error)
+{
+    LOG(LS_INFO) << "PipeWire stream state: " << pw_stream_state_as_string(state);
+
+    if (state == PW_STREAM_STATE_ERROR)
+    {
+        LOG(LS_WARNING) << "PipeWire stream error: " << (error ? error : "unknown");
+        stream_failed_ = true;
+    }
+}
+
+void ScreenCapturerPipeWire::onStreamParamChanged(uint32_t id, const spa_pod* param)
+{
+    if (!param || id != SPA_PARAM_Format)
+        return;
+
+    if (spa_format_video_raw_parse(param, &video_format_) < 0)
+    {
+        LOG(LS_WARNING) << "Unable to parse the video format";
+        stream_failed_ = true;
+        return;
+    }
+
+    const bool dmabuf = spa_pod_find_prop(param, nullptr, SPA_FORMAT_VIDEO_modifier) != nullptr;
+
+    LOG(LS_INFO) << "PipeWire stream format: " << video_format_.format
+                 << " (size: " << video_format_.size.width << "x" << video_format_.size.height
+                 << ", DMA-BUF: " << dmabuf << ")";
+
+    int data_types = (1 << SPA_DATA_MemFd) | (1 << SPA_DATA_MemPtr);
+    if (dmabuf)
+        data_types |= (1 << SPA_DATA_DmaBuf);
+
+    uint8_t buffer[1024];
+    spa_pod_builder builder = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+
+    const spa_pod* params[3];
+
+    params[0] = static_cast<spa_pod*>(spa_pod_builder_add_object(&builder,
+        SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
+        SPA_PARAM_BUFFERS_dataType, SPA_POD_CHOICE_FLAGS_Int(data_types)));
+
+    params[1] = static_cast<spa_pod*>(spa_pod_builder_add_object(&builder,
+        SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta,
+        SPA_PARAM_META_type, SPA_POD_Id(SPA_META_Header),
+        SPA_PARAM_META_size, SPA_POD_Int(static_cast<int>(sizeof(spa_meta_header)))));
+
+    params[2] = static_cast<spa_pod*>(spa_pod_builder_add_object(&builder,
+        SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta,
+        SPA_PARAM_META_type, SPA_POD_Id(SPA_META_VideoDamage),
+        SPA_PARAM_META_size, SPA_POD_CHOICE_RANGE_Int(
+            kRegionSize * kMaxDamageRects, kRegionSize, kRegionSize * kMaxDamageRects)));
+
+    pw_stream_update_params(stream_, params, std::size(params));
+}
+
+void ScreenCapturerPipeWire::onStreamProcess()
+{
+    const Rect image_rect = Rect::makeWH(static_cast<int32_t>(video_format_.size.width),
+                                         static_cast<int32_t>(video_format_.size.height));
+    Region damage;
+
+    // Only the newest buffer is copied. The older ones are returned to the stream at once, but
+    // their damage is kept.
+    pw_buffer* buffer = nullptr;
+    while (pw_buffer* next = pw_stream_dequeue_buffer(stream_))
+    {
+        if (buffer)
+            pw_stream_queue_buffer(stream_, buffer);
+
+        buffer = next;
+        addBufferDamage(buffer->buffer, image_rect, &damage);
+    }
+
+    if (!buffer)
+        return;
+
+    const bool copied = copyBuffer(buffer->buffer, &damage);
+    pw_stream_queue_buffer(stream_, buffer);
+
+    if (copied && !damage.isEmpty())
+        notifyDamage();
+}
+
+void ScreenCapturerPipeWire::onCoreError(uint32_t id, int res, const char* message)
+{
+    LOG(LS_WARNING) << "PipeWire error (id: " << id << ", res: " << spa_strerror(res) << "): "
+                    << (message ? message : "unknown");
+
+    if (id == PW_ID_CORE)
+        stream_failed_ = true;
+}
+
+bool ScreenCapturerPipeWire::copyBuffer(spa_buffer* buffer, Region* damage)
+{
+    spa_meta_header* header = static_cast<spa_meta_header*>(
+        spa_buffer_find_meta_data(buffer, SPA_META_Header, sizeof(spa_meta_header)));
+    if (header && (header->flags & SPA_META_HEADER_FLAG_CORRUPTED))
+        return false;
+
+    spa_data& data = buffer->datas[0];
+    if (!data.chunk || !data.chunk->size)
+    {
+        // The buffer has no video data, e.g. only the metadata are updated.
+        return false;
+    }
+
+    const Size size(static_cast<int32_t>(video_format_.size.width),
+                    static_cast<int32_t>(video_format_.size.height));
+    const int stride = data.chunk->stride ? data.chunk->stride : size.width() * 4;
+
+    if (size.isEmpty() || stride < size.width() * 4)
+    {
+        LOG(LS_WARNING) << "Invalid buffer layout";
+        return false;
+    }
+
+    void* mapped = nullptr;
+    size_t mapped_size = 0;
+    const uint8_t* source = nullptr;
+
+    if (data.type == SPA_DATA_DmaBuf)
+    {
+        // The modifier is negotiated to be linear, so the buffer can be read directly.
+        mapped_size = data.maxsize + data.mapoffset;
+        mapped = mmap(nullptr, mapped_size, PROT_READ, MAP_PRIVATE, static_cast<int>(data.fd), 0);
+        if (mapped == MAP_FAILED)
+        {
+            PLOG(LS_WARNING) << "mmap failed";
+            return false;
+        }
+
+        syncDmaBuf(static_cast<int>(data.fd), DMA_BUF_SYNC_START);
+        source = static_cast<const uint8_t*>(mapped) + data.mapoffset;
+    }
+    else
+    {
+        source = static_cast<const uint8_t*>(data.data);
+    }
+
+    bool copied = false;
+
+    const size_t required_size =
+        static_cast<size_t>(data.chunk->offset) + static_cast<size_t>(stride) * size.height();
+
+    if (source && required_size <= data.maxsize)
+    {
+        source += data.chunk->offset;
+
+        std::scoped_lock lock(stream_lock_);
+
+        if (!stream_frame_ || stream_frame_->size() != size)
+        {
+            stream_frame_ = FrameSimple::create(size, PixelFormat::ARGB());
+            damage->setRect(Rect::makeSize(size));
+        }
+
+        if (stream_frame_)
+        {
+            damage->intersectWith(Rect::makeSize(size));
+
+            for (Region::Iterator it(*damage); !it.isAtEnd(); it.advance())
+            {
+                const Rect rect = it.rect();
+                stream_frame_->copyPixelsFrom(
+                    source + rect.y() * stride + rect.x() * 4, stride, rect);
+            }
+
+            stream_damage_.addRegion(*damage);
+            copied = true;
+        }
+    }
+
+    if (mapped)
+    {
+        syncDmaBuf(static_cast<int>(data.fd), DMA_BUF_SYNC_END);
+        munmap(mapped, mapped_size);
+    }
+
+    return copied;
+}
+
+// static
+void ScreenCapturerPipeWire::onStreamStateChangedCallback(
+    void* data, pw_stream_state /* old_state */, pw_stream_state state, const char* error)
+{
+    ScreenCapturerPipeWire* self = reinterpret_cast<ScreenCapturerPipeWire*>(data);
+    DCHECK(self);
+
+    self->onStreamStateChanged(state, error);
+}
+
+// static
+void ScreenCapturerPipeWire::onStreamParamChangedCallback(
+    void* data, uint32_t id, const spa_pod* param)
+{
+    ScreenCapturerPipeWire* self = reinterpret_cast<ScreenCapturerPipeWire*>(data);
+    DCHECK(self);
+
+    self->onStreamParamChanged(id, param);
+}
+
+// static
+void ScreenCapturerPipeWire::onStreamProcessCallback(void* data)
+{
+    ScreenCapturerPipeWire* self = reinterpret_cast<ScreenCapturerPipeWire*>(data);
+    DCHECK(self);
+
+    self->onStreamProcess();
+}
+
+// static
+void ScreenCapturerPipeWire::onCoreErrorCallback(
+    void* data, uint32_t id, int /* seq */, int res, const char* message)
+{
+    ScreenCapturerPipeWire* self = reinterpret_cast<ScreenCapturerPipeWire*>(data);
+    DCHECK(self);
+
+    self->onCoreError(id, res, message);
+}
+
+} // namespace base
@@ -0,0 +1,109 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__DESKTOP__SCREEN_CAPTURER_PIPEWIRE_H
+#define BASE__DESKTOP__SCREEN_CAPTURER_PIPEWIRE_H
+
+#include "base/desktop/region.h"
+#include "base/desktop/screen_capturer.h"
+#include "base/desktop/shared_frame.h"
+
+#include <atomic>
+#include <mutex>
+
+#include <pipewire/pipewire.h>
+#include <spa/param/video/raw.h>
+
+namespace base {
+
+class ScreenCastPortal;
+
+// Captures the screen on Wayland through the ScreenCast portal and a PipeWire stream. Buffers
+// are accepted as DMA-BUF with linear layout (mapped directly, without the copy into shared
+// memory by the compositor) or as shared memory. Only the areas from the damage metadata of the
+// stream are copied into the frames.
+class ScreenCapturerPipeWire : public ScreenCapturer
+{
+public:
+    ScreenCapturerPipeWire();
+    ~ScreenCapturerPipeWire();
+
+    // ScreenCapturer implementation.
+    int screenCount() override;
+    bool screenList(ScreenList* screens) override;
+    bool selectScreen(ScreenId screen_id) override;
+    ScreenId currentScreen() const override;
+    const Frame* captureFrame(Error* error) override;
+    const MouseCursor* captureCursor() override;
+    Point cursorPosition() override;
+
+protected:
+    // ScreenCapturer implementation.
+    void reset() override;
+
+private:
+    bool startStream();
+    void stopStream();
+    const Frame* captureImage();
+
+    // Called on the PipeWire thread.
+    void onStreamStateChanged(pw_stream_state state, const char* error);
+    void onStreamParamChanged(uint32_t id, const spa_pod* param);
+    void onStreamProcess();
+    void onCoreError(uint32_t id, int res, const char* message);
+    bool copyBuffer(spa_buffer* buffer, Region* damage);
+
+    static void onStreamStateChangedCallback(
+        void* data, pw_stream_state old_state, pw_stream_state state, const char* error);
+    static void onStreamParamChangedCallback(void* data, uint32_t id, const spa_pod* param);
+    static void onStreamProcessCallback(void* data);
+    static void onCoreErrorCallback(
+        void* data, uint32_t id, int seq, int res, const char* message);
+
+    std::unique_ptr<ScreenCastPortal> portal_;
+
+    bool pipewire_initialized_ = false;
+    pw_thread_loop* loop_ = nullptr;
+    pw_context* context_ = nullptr;
+    pw_core* core_ = nullptr;
+    pw_stream* stream_ = nullptr;
+
+    spa_hook core_listener_;
+    pw_core_events core_events_;
+    spa_hook stream_listener_;
+    pw_stream_events stream_events_;
+
+    std::atomic_bool stream_failed_ = false;
+
+    // The negotiated format is changed only on the PipeWire thread.
+    spa_video_info_raw video_format_;
+
+    // The last stream image and the area updated since the previous frame. Written on the
+    // PipeWire thread and read on the capturer thread.
+    std::mutex stream_lock_;
+    std::unique_ptr<Frame> stream_frame_;
+    Region stream_damage_;
+
+    FrameQueue<Frame> queue_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScreenCapturerPipeWire);
+};
+
+} // namespace base
+
+#endif // BASE__DESKTOP__SCREEN_CAPTURER_PIPEWIRE_H
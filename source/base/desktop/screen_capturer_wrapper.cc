@@ -18,12 +18,16 @@
 
 #include "base/desktop/screen_capturer_wrapper.h"
 
+#include "base/environment.h"
 #include "base/logging.h"
+#include "base/trace_event.h"
 #include "base/desktop/desktop_environment.h"
 #include "base/desktop/desktop_resizer.h"
+#include "base/desktop/frame_dump.h"
 #include "base/desktop/mouse_cursor.h"
 #include "base/desktop/power_save_blocker.h"
 #include "base/ipc/shared_memory_factory.h"
+#include "base/threading/scoped_thread_qos.h"
 
 #if defined(OS_WIN)
 #include "base/desktop/screen_capturer_dxgi.h"
@@ -31,20 +35,39 @@
 #include "base/desktop/screen_capturer_mirror.h"
 #include "base/win/windows_version.h"
 #elif defined(OS_LINUX)
-// TODO
+#include "base/desktop/screen_capturer_x11.h"
+#if defined(USE_PIPEWIRE)
+#include "base/desktop/screen_capturer_pipewire.h"
+#endif // defined(USE_PIPEWIRE)
 #elif defined(OS_MAC)
-// TODO
+#include "base/desktop/screen_capturer_mac.h"
 #else
 #error Platform support not implemented
 #endif
 
 namespace base {
 
+namespace {
+
+#if defined(OS_LINUX) && defined(USE_PIPEWIRE)
+bool isWaylandSession()
+{
+    std::string session_type;
+    if (Environment::get("XDG_SESSION_TYPE", &session_type))
+        return session_type == "wayland";
+
+    return Environment::has("WAYLAND_DISPLAY");
+}
+#endif // defined(OS_LINUX) && defined(USE_PIPEWIRE)
+
+} // namespace
+
 ScreenCapturerWrapper::ScreenCapturerWrapper(ScreenCapturer::Type preferred_type,
                                              Delegate* delegate)
     : preferred_type_(preferred_type),
       delegate_(delegate),
       power_save_blocker_(std::make_unique<PowerSaveBlocker>()),
+      thread_qos_(std::make_unique<ScopedThreadQoS>(ThreadQoS::CAPTURE)),
       environment_(std::make_unique<DesktopEnvironment>())
 {
     LOG(LS_INFO) << "Ctor";
@@ -54,6 +77,19 @@ ScreenCapturerWrapper::ScreenCapturerWrapper(ScreenCapturer::Type preferred_type
     SetThreadExecutionState(ES_DISPLAY_REQUIRED);
 #endif // defined(OS_WIN)
 
+    // The frames are written to the file for the replay benchmarks. Only for debugging, the dump
+    // contains everything shown on the screen.
+    std::string dump_file;
+    if (Environment::get("ASPIA_FRAME_DUMP", &dump_file) && !dump_file.empty())
+    {
+        frame_dump_ = FrameDumpWriter::create(std::filesystem::u8path(dump_file));
+        if (frame_dump_)
+        {
+            LOG(LS_WARNING) << "Captured frames are written to: " << dump_file;
+            frame_dump_start_time_ = std::chrono::steady_clock::now();
+        }
+    }
+
     switchToInputDesktop();
     selectCapturer();
 }
@@ -69,22 +105,26 @@ void ScreenCapturerWrapper::selectScreen(ScreenCapturer::ScreenId screen_id, con
 
     if (screen_id == screen_capturer_->currentScreen())
     {
-        if (resolution.isEmpty())
+        if (!resizer_)
         {
-            LOG(LS_WARNING) << "Empty resolution";
+            LOG(LS_WARNING) << "No desktop resizer";
         }
-        else
+        else if (resolution.isEmpty())
         {
-            if (!resizer_)
+            // The restore makes the screen blink, so it is done only after a change.
+            if (resolution_changed_)
             {
-                LOG(LS_WARNING) << "No desktop resizer";
-            }
-            else
-            {
-                LOG(LS_INFO) << "Change resolution for screen " << screen_id << " to: " << resolution;
-                resizer_->setResolution(screen_id, resolution);
+                LOG(LS_INFO) << "Restore resolution for screen " << screen_id;
+                resizer_->restoreResolution(screen_id);
+                resolution_changed_ = false;
             }
         }
+        else
+        {
+            LOG(LS_INFO) << "Change resolution for screen " << screen_id << " to: " << resolution;
+            resizer_->setResolution(screen_id, resolution);
+            resolution_changed_ = true;
+        }
     }
     else
     {
@@ -135,6 +175,7 @@ void ScreenCapturerWrapper::selectScreen(ScreenCapturer::ScreenId screen_id, con
 void ScreenCapturerWrapper::captureFrame()
 {
     DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+    TRACE_EVENT("ScreenCapturerWrapper::captureFrame");
 
     if (!screen_capturer_)
     {
@@ -151,6 +192,7 @@ void ScreenCapturerWrapper::captureFrame()
 
         resizer_.reset();
         resizer_ = DesktopResizer::create();
+        resolution_changed_ = false;
 
         screen_count_ = count;
         selectScreen(defaultScreen(), Size());
@@ -175,8 +217,7 @@ void ScreenCapturerWrapper::captureFrame()
         }
     }
 
-    delegate_->onScreenCaptured(frame, screen_capturer_->captureCursor());
-
+    // The position is reported before the frame, so that the delegate can send them together.
     if (enable_cursor_position_)
     {
         Point cursor_pos = screen_capturer_->cursorPosition();
@@ -190,6 +231,21 @@ void ScreenCapturerWrapper::captureFrame()
             last_cursor_pos_ = cursor_pos;
         }
     }
+
+    if (frame && frame_dump_)
+    {
+        std::chrono::microseconds timestamp =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - frame_dump_start_time_);
+
+        if (!frame_dump_->addFrame(*frame, timestamp))
+        {
+            LOG(LS_WARNING) << "Frame dump stopped";
+            frame_dump_.reset();
+        }
+    }
+
+    delegate_->onScreenCaptured(frame, screen_capturer_->captureCursor());
 }
 
 void ScreenCapturerWrapper::setSharedMemoryFactory(SharedMemoryFactory* shared_memory_factory)
@@ -291,14 +347,39 @@ void ScreenCapturerWrapper::selectCapturer()
     }
 
 #elif defined(OS_LINUX)
-    NOTIMPLEMENTED();
+#if defined(USE_PIPEWIRE)
+    // The portal asks the user for permission. If the PipeWire capturer has failed (e.g. the user
+    // cancelled the dialog), it is not created again.
+    const bool pipewire_failed = screen_capturer_ &&
+        screen_capturer_->type() == ScreenCapturer::Type::LINUX_PIPEWIRE;
+
+    const bool use_pipewire = preferred_type_ == ScreenCapturer::Type::LINUX_PIPEWIRE ||
+        (preferred_type_ == ScreenCapturer::Type::DEFAULT && isWaylandSession());
+
+    if (use_pipewire && !pipewire_failed)
+    {
+        LOG(LS_INFO) << "Using PipeWire capturer";
+        screen_capturer_ = std::make_unique<ScreenCapturerPipeWire>();
+    }
+    else
+#endif // defined(USE_PIPEWIRE)
+    {
+        LOG(LS_INFO) << "Using X11 capturer";
+        screen_capturer_ = std::make_unique<ScreenCapturerX11>();
+    }
 #elif defined(OS_MAC)
-    NOTIMPLEMENTED();
+    LOG(LS_INFO) << "Using ScreenCaptureKit capturer";
+    screen_capturer_ = std::make_unique<ScreenCapturerMac>();
 #else
     NOTIMPLEMENTED();
 #endif
 
     screen_capturer_->setSharedMemoryFactory(shared_memory_factory_);
+    screen_capturer_->setDamageCallback([this]()
+    {
+        delegate_->onScreenDamaged();
+    });
+
     if (last_screen_id_ != ScreenCapturer::kInvalidScreenId)
     {
         LOG(LS_INFO) << "Restore selected screen: " << last_screen_id_;
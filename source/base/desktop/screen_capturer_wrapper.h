@@ -23,6 +23,8 @@
 #include "base/threading/thread_checker.h"
 #include "build/build_config.h"
 
+#include <chrono>
+
 #if defined(OS_WIN)
 #include "base/win/scoped_thread_desktop.h"
 #elif defined(OS_LINUX)
@@ -32,8 +34,10 @@ namespace base {
 
 class DesktopEnvironment;
 class DesktopResizer;
+class FrameDumpWriter;
 class MouseCursor;
 class PowerSaveBlocker;
+class ScopedThreadQoS;
 
 class ScreenCapturerWrapper
 {
@@ -46,7 +50,12 @@ public:
         virtual void onScreenListChanged(
             const ScreenCapturer::ScreenList& list, ScreenCapturer::ScreenId current) = 0;
         virtual void onScreenCaptured(const Frame* frame, const MouseCursor* mouse_cursor) = 0;
+
+        // Called before onScreenCaptured() of the same capture.
         virtual void onCursorPositionChanged(const Point& position) = 0;
+
+        // Called on any thread when the capturer is notified about screen updates.
+        virtual void onScreenDamaged() = 0;
     };
 
     ScreenCapturerWrapper(ScreenCapturer::Type preferred_type, Delegate* delegate);
@@ -79,11 +88,19 @@ private:
     Point last_cursor_pos_;
     bool enable_cursor_position_ = false;
 
+    // Set if the resolution of the current screen was changed by the client.
+    bool resolution_changed_ = false;
+
     std::unique_ptr<PowerSaveBlocker> power_save_blocker_;
+    std::unique_ptr<ScopedThreadQoS> thread_qos_;
     std::unique_ptr<DesktopEnvironment> environment_;
     std::unique_ptr<DesktopResizer> resizer_;
     std::unique_ptr<ScreenCapturer> screen_capturer_;
 
+    // Set if the ASPIA_FRAME_DUMP environment variable contains the path of the dump file.
+    std::unique_ptr<FrameDumpWriter> frame_dump_;
+    std::chrono::steady_clock::time_point frame_dump_start_time_;
+
     THREAD_CHECKER(thread_checker_);
 
     DISALLOW_COPY_AND_ASSIGN(ScreenCapturerWrapper);
@@ -19,64 +19,644 @@
 #include "base/desktop/screen_capturer_x11.h"
 
 #include "base/logging.h"
+#include "base/desktop/differ.h"
+#include "base/desktop/mouse_cursor.h"
+#include "base/desktop/region.h"
+#include "base/desktop/shared_memory_frame.h"
+
+#include <chrono>
+#include <cstring>
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/Xdamage.h>
+#include <X11/extensions/Xfixes.h>
+#include <X11/extensions/XShm.h>
 
 namespace base {
 
+namespace {
+
+// Frames are stored as 32bpp ARGB, so only images with the same memory layout can be copied
+// without conversion. This covers practically all X servers with 24 or 32 bit depth.
+bool isSupportedImage(const XImage* image)
+{
+    return image->bits_per_pixel == 32 &&
+           image->byte_order == LSBFirst &&
+           image->red_mask == 0xFF0000 &&
+           image->green_mask == 0x00FF00 &&
+           image->blue_mask == 0x0000FF;
+}
+
+void copyRectFromImage(const XImage* image, const Rect& rect, Frame* frame)
+{
+    const uint8_t* source = reinterpret_cast<const uint8_t*>(image->data) +
+        rect.y() * image->bytes_per_line + rect.x() * (image->bits_per_pixel / 8);
+
+    frame->copyPixelsFrom(source, image->bytes_per_line, rect);
+}
+
+} // namespace
+
+struct ScreenCapturerX11::ShmSegment
+{
+    ShmSegment()
+    {
+        memset(&info, 0, sizeof(info));
+        info.shmid = -1;
+        info.shmaddr = reinterpret_cast<char*>(-1);
+    }
+
+    XShmSegmentInfo info;
+};
+
 ScreenCapturerX11::ScreenCapturerX11()
-    : ScreenCapturer(ScreenCapturer::Type::LINUX_X11)
+    : ScreenCapturer(ScreenCapturer::Type::LINUX_X11),
+      shm_segment_(std::make_unique<ShmSegment>())
 {
     // Nothing
 }
 
-ScreenCapturerX11::~ScreenCapturerX11() = default;
+ScreenCapturerX11::~ScreenCapturerX11()
+{
+    releaseDisplay();
+}
 
 int ScreenCapturerX11::screenCount()
 {
-    NOTIMPLEMENTED();
-    return 0;
+    // Displays are combined into a single root window.
+    return 1;
 }
 
-bool ScreenCapturerX11::screenList(ScreenList* /* screens */)
+bool ScreenCapturerX11::screenList(ScreenList* screens)
 {
-    NOTIMPLEMENTED();
-    return false;
+    DCHECK(screens);
+
+    if (!display_ && !initDisplay())
+        return false;
+
+    Screen screen;
+    screen.id = kFullDesktopScreenId;
+    screen.resolution = screen_size_;
+    screen.is_primary = true;
+
+    screens->screens.emplace_back(std::move(screen));
+    return true;
 }
 
-bool ScreenCapturerX11::selectScreen(ScreenId /* screen_id */)
+bool ScreenCapturerX11::selectScreen(ScreenId screen_id)
 {
-    NOTIMPLEMENTED();
-    return false;
+    LOG(LS_INFO) << "Select screen with ID: " << screen_id;
+
+    if (screen_id != kFullDesktopScreenId)
+    {
+        LOG(LS_WARNING) << "Invalid screen";
+        return false;
+    }
+
+    return true;
 }
 
 ScreenCapturer::ScreenId ScreenCapturerX11::currentScreen() const
 {
-    NOTIMPLEMENTED();
-    return kInvalidScreenId;
+    return kFullDesktopScreenId;
 }
 
 const Frame* ScreenCapturerX11::captureFrame(Error* error)
 {
     DCHECK(error);
-    NOTIMPLEMENTED();
-    *error = Error::PERMANENT;
-    return nullptr;
+
+    if (!display_ && !initDisplay())
+    {
+        *error = Error::PERMANENT;
+        return nullptr;
+    }
+
+    const Frame* frame = captureImage();
+    if (!frame)
+    {
+        *error = Error::TEMPORARY;
+        return nullptr;
+    }
+
+    *error = Error::SUCCEEDED;
+    return frame;
 }
 
 const MouseCursor* ScreenCapturerX11::captureCursor()
 {
-    NOTIMPLEMENTED();
-    return nullptr;
+    if (!display_ || !has_xfixes_)
+        return nullptr;
+
+    processPendingEvents();
+
+    if (!cursor_changed_)
+        return nullptr;
+
+    XFixesCursorImage* cursor_image = XFixesGetCursorImage(display_);
+    if (!cursor_image)
+    {
+        LOG(LS_WARNING) << "XFixesGetCursorImage failed";
+        return nullptr;
+    }
+
+    cursor_changed_ = false;
+
+    const int width = cursor_image->width;
+    const int height = cursor_image->height;
+
+    ByteArray image;
+    image.resize(static_cast<size_t>(width * height * MouseCursor::kBytesPerPixel));
+
+    // XFixes returns pixels as 32-bit ARGB values stored in unsigned long.
+    uint32_t* dst = reinterpret_cast<uint32_t*>(image.data());
+    for (int i = 0; i < width * height; ++i)
+        dst[i] = static_cast<uint32_t>(cursor_image->pixels[i]);
+
+    mouse_cursor_ = std::make_unique<MouseCursor>(
+        std::move(image), Size(width, height), Point(cursor_image->xhot, cursor_image->yhot));
+
+    XFree(cursor_image);
+    return mouse_cursor_.get();
 }
 
 Point ScreenCapturerX11::cursorPosition()
 {
-    NOTIMPLEMENTED();
-    return Point();
+    if (!display_)
+        return Point();
+
+    Window root;
+    Window child;
+    int root_x = 0;
+    int root_y = 0;
+    int win_x;
+    int win_y;
+    unsigned int mask;
+
+    if (!XQueryPointer(display_, root_window_, &root, &child,
+                       &root_x, &root_y, &win_x, &win_y, &mask))
+    {
+        return Point();
+    }
+
+    return Point(root_x, root_y);
 }
 
 void ScreenCapturerX11::reset()
 {
-    NOTIMPLEMENTED();
+    // X11 has no input desktops to switch between, the resources stay valid.
+}
+
+bool ScreenCapturerX11::initDisplay()
+{
+    display_ = XOpenDisplay(nullptr);
+    if (!display_)
+    {
+        LOG(LS_WARNING) << "Unable to open X display";
+        return false;
+    }
+
+    root_window_ = RootWindow(display_, DefaultScreen(display_));
+    if (root_window_ == BadValue)
+    {
+        LOG(LS_WARNING) << "Unable to get the root window";
+        releaseDisplay();
+        return false;
+    }
+
+    // Size changes of the root window (e.g. by xrandr) are delivered as ConfigureNotify events.
+    XSelectInput(display_, root_window_, StructureNotifyMask);
+
+    int error_base;
+    has_xfixes_ = XFixesQueryExtension(display_, &xfixes_event_base_, &error_base);
+    if (has_xfixes_)
+    {
+        XFixesSelectCursorInput(display_, root_window_, XFixesDisplayCursorNotifyMask);
+    }
+    else
+    {
+        LOG(LS_INFO) << "X server does not support XFixes";
+    }
+
+    if (!initPixelBuffer())
+    {
+        releaseDisplay();
+        return false;
+    }
+
+    initDamage();
+    return true;
+}
+
+bool ScreenCapturerX11::initPixelBuffer()
+{
+    XWindowAttributes attributes;
+    if (!XGetWindowAttributes(display_, root_window_, &attributes))
+    {
+        LOG(LS_WARNING) << "XGetWindowAttributes failed";
+        return false;
+    }
+
+    screen_size_ = Size(attributes.width, attributes.height);
+    screen_size_changed_ = false;
+
+    int major;
+    int minor;
+    Bool have_pixmaps;
+
+    if (!XShmQueryVersion(display_, &major, &minor, &have_pixmaps))
+    {
+        LOG(LS_INFO) << "X server does not support MIT-SHM";
+        return true;
+    }
+
+    XShmSegmentInfo* segment_info = &shm_segment_->info;
+
+    shm_image_ = XShmCreateImage(display_, attributes.visual, attributes.depth, ZPixmap,
+                                 nullptr, segment_info,
+                                 attributes.width, attributes.height);
+    if (!shm_image_)
+    {
+        LOG(LS_WARNING) << "XShmCreateImage failed";
+        return true;
+    }
+
+    if (!isSupportedImage(shm_image_))
+    {
+        LOG(LS_WARNING) << "Unsupported pixel format (bpp: " << shm_image_->bits_per_pixel
+                        << ", depth: " << attributes.depth << ")";
+        releasePixelBuffer();
+        return false;
+    }
+
+    segment_info->shmid = shmget(IPC_PRIVATE, shm_image_->bytes_per_line * shm_image_->height,
+                                 IPC_CREAT | 0600);
+    if (segment_info->shmid == -1)
+    {
+        PLOG(LS_WARNING) << "shmget failed";
+        releasePixelBuffer();
+        return true;
+    }
+
+    segment_info->shmaddr = reinterpret_cast<char*>(shmat(segment_info->shmid, nullptr, 0));
+    segment_info->readOnly = False;
+
+    if (segment_info->shmaddr == reinterpret_cast<char*>(-1))
+    {
+        PLOG(LS_WARNING) << "shmat failed";
+        releasePixelBuffer();
+        return true;
+    }
+
+    shm_image_->data = segment_info->shmaddr;
+
+    if (!XShmAttach(display_, segment_info))
+    {
+        LOG(LS_WARNING) << "XShmAttach failed";
+        releasePixelBuffer();
+        return true;
+    }
+
+    shm_attached_ = true;
+    XSync(display_, False);
+
+    // Both sides are attached, the segment is destroyed after the last detach even if the
+    // process crashes.
+    shmctl(segment_info->shmid, IPC_RMID, nullptr);
+
+    if (have_pixmaps && XShmPixmapFormat(display_) == ZPixmap)
+    {
+        // A shared pixmap allows to copy only the damaged rectangles with XCopyArea instead of
+        // reading the whole screen with XShmGetImage.
+        shm_pixmap_ = XShmCreatePixmap(display_, root_window_, segment_info->shmaddr,
+                                       segment_info, attributes.width, attributes.height,
+                                       attributes.depth);
+        XSync(display_, False);
+
+        if (shm_pixmap_)
+        {
+            XGCValues gc_values;
+            gc_values.subwindow_mode = IncludeInferiors;
+            gc_values.graphics_exposures = False;
+
+            shm_gc_ = XCreateGC(display_, root_window_,
+                                GCSubwindowMode | GCGraphicsExposures, &gc_values);
+        }
+    }
+
+    LOG(LS_INFO) << "MIT-SHM initialized (version: " << major << "." << minor
+                 << ", pixmaps: " << (shm_gc_ ? "yes" : "no") << ")";
+    return true;
+}
+
+void ScreenCapturerX11::initDamage()
+{
+    int error_base;
+    if (!XDamageQueryExtension(display_, &damage_event_base_, &error_base))
+    {
+        LOG(LS_INFO) << "X server does not support XDamage";
+        return;
+    }
+
+    if (!has_xfixes_)
+    {
+        LOG(LS_INFO) << "XDamage requires XFixes to read the damage region";
+        return;
+    }
+
+    // Only one event is sent until the damage is subtracted, so the event queue does not grow
+    // with the number of updates on the screen.
+    damage_handle_ = XDamageCreate(display_, root_window_, XDamageReportNonEmpty);
+    if (!damage_handle_)
+    {
+        LOG(LS_WARNING) << "XDamageCreate failed";
+        return;
+    }
+
+    damage_region_ = XFixesCreateRegion(display_, nullptr, 0);
+    if (!damage_region_)
+    {
+        XDamageDestroy(display_, damage_handle_);
+        damage_handle_ = 0;
+        LOG(LS_WARNING) << "XFixesCreateRegion failed";
+        return;
+    }
+
+    use_damage_ = true;
+    LOG(LS_INFO) << "Using XDamage to detect screen updates";
+}
+
+void ScreenCapturerX11::releasePixelBuffer()
+{
+    if (shm_gc_)
+    {
+        XFreeGC(display_, shm_gc_);
+        shm_gc_ = nullptr;
+    }
+
+    if (shm_pixmap_)
+    {
+        XFreePixmap(display_, shm_pixmap_);
+        shm_pixmap_ = 0;
+    }
+
+    if (shm_attached_)
+    {
+        XShmDetach(display_, &shm_segment_->info);
+        XSync(display_, False);
+        shm_attached_ = false;
+    }
+
+    if (shm_segment_->info.shmaddr != reinterpret_cast<char*>(-1))
+    {
+        shmdt(shm_segment_->info.shmaddr);
+        shm_segment_->info.shmaddr = reinterpret_cast<char*>(-1);
+    }
+
+    if (shm_segment_->info.shmid != -1)
+    {
+        shmctl(shm_segment_->info.shmid, IPC_RMID, nullptr);
+        shm_segment_->info.shmid = -1;
+    }
+
+    if (shm_image_)
+    {
+        // The data belongs to the shared memory segment, it must not be freed by XDestroyImage.
+        shm_image_->data = nullptr;
+        XDestroyImage(shm_image_);
+        shm_image_ = nullptr;
+    }
+}
+
+void ScreenCapturerX11::releaseDisplay()
+{
+    if (!display_)
+        return;
+
+    if (damage_region_)
+    {
+        XFixesDestroyRegion(display_, damage_region_);
+        damage_region_ = 0;
+    }
+
+    if (damage_handle_)
+    {
+        XDamageDestroy(display_, damage_handle_);
+        damage_handle_ = 0;
+    }
+
+    use_damage_ = false;
+
+    releasePixelBuffer();
+
+    XCloseDisplay(display_);
+    display_ = nullptr;
+}
+
+void ScreenCapturerX11::processPendingEvents()
+{
+    // XDamage events are not needed by themselves (the damage is read with XDamageSubtract), but
+    // they must be removed from the queue.
+    const int count = XPending(display_);
+    for (int i = 0; i < count; ++i)
+    {
+        XEvent event;
+        XNextEvent(display_, &event);
+
+        if (event.type == ConfigureNotify && event.xconfigure.window == root_window_)
+        {
+            if (Size(event.xconfigure.width, event.xconfigure.height) != screen_size_)
+                screen_size_changed_ = true;
+        }
+        else if (has_xfixes_ && event.type == xfixes_event_base_ + XFixesCursorNotify)
+        {
+            cursor_changed_ = true;
+        }
+    }
+}
+
+const Frame* ScreenCapturerX11::captureImage()
+{
+    processPendingEvents();
+
+    if (screen_size_changed_)
+    {
+        LOG(LS_INFO) << "Screen size changed";
+
+        releasePixelBuffer();
+        if (!initPixelBuffer())
+            return nullptr;
+
+        // Make sure the frame buffers will be reallocated.
+        queue_.reset();
+    }
+
+    queue_.moveToNextFrame();
+
+    if (!queue_.currentFrame() || queue_.currentFrame()->size() != screen_size_)
+    {
+        std::unique_ptr<Frame> frame = SharedMemoryFrame::create(
+            screen_size_, PixelFormat::ARGB(), sharedMemoryFactory());
+        if (!frame)
+        {
+            LOG(LS_WARNING) << "Failed to create frame buffer";
+            return nullptr;
+        }
+
+        frame->setCapturerType(static_cast<uint32_t>(type()));
+        queue_.replaceCurrentFrame(std::move(frame));
+    }
+
+    Frame* current = queue_.currentFrame();
+    Frame* previous = queue_.previousFrame();
+
+    const Rect screen_rect = Rect::makeSize(screen_size_);
+    current->updatedRegion()->clear();
+
+    if (use_damage_ && previous && previous->size() == current->size())
+    {
+        XDamageSubtract(display_, damage_handle_, None, damage_region_);
+
+        int rect_count = 0;
+        XRectangle* rects = XFixesFetchRegion(display_, damage_region_, &rect_count);
+
+        Region damage_region;
+        for (int i = 0; i < rect_count; ++i)
+        {
+            damage_region.addRect(
+                Rect::makeXYWH(rects[i].x, rects[i].y, rects[i].width, rects[i].height));
+        }
+
+        if (rects)
+            XFree(rects);
+
+        damage_region.intersectWith(screen_rect);
+
+        // The buffer of the current frame contains the screen as it was two frames ago. Bring it
+        // up to date with the previous frame in the areas which are not read from the server.
+        Region sync_region(previous->constUpdatedRegion());
+        sync_region.subtract(damage_region);
+
+        for (Region::Iterator it(sync_region); !it.isAtEnd(); it.advance())
+            current->copyPixelsFrom(*previous, it.rect().topLeft(), it.rect());
+
+        if (!damage_region.isEmpty() && !readRegion(damage_region, current))
+            return nullptr;
+
+        current->updatedRegion()->swap(&damage_region);
+    }
+    else
+    {
+        if (use_damage_)
+        {
+            // The whole screen is read, the accumulated damage is no longer needed.
+            XDamageSubtract(display_, damage_handle_, None, None);
+        }
+
+        if (!readRegion(Region(screen_rect), current))
+            return nullptr;
+
+        *current->captureTiming() = Frame::CaptureTiming();
+
+        if (!previous || previous->size() != current->size())
+        {
+            differ_ = std::make_unique<Differ>(screen_size_);
+            current->updatedRegion()->addRect(screen_rect);
+        }
+        else
+        {
+            std::chrono::steady_clock::time_point diff_start = std::chrono::steady_clock::now();
+
+            differ_->calcDirtyRegion(previous->frameData(),
+                                     current->frameData(),
+                                     current->updatedRegion());
+
+            current->captureTiming()->diff_duration =
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - diff_start).count();
+        }
+    }
+
+    int screen = DefaultScreen(display_);
+    int width_mm = DisplayWidthMM(display_, screen);
+    int height_mm = DisplayHeightMM(display_, screen);
+
+    if (width_mm > 0 && height_mm > 0)
+    {
+        current->setDpi(Point(static_cast<int>(screen_size_.width() * 25.4 / width_mm + 0.5),
+                              static_cast<int>(screen_size_.height() * 25.4 / height_mm + 0.5)));
+    }
+
+    return current;
+}
+
+bool ScreenCapturerX11::readRegion(const Region& region, Frame* frame)
+{
+    if (shm_gc_)
+    {
+        for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        {
+            const Rect& rect = it.rect();
+            XCopyArea(display_, root_window_, shm_pixmap_, shm_gc_,
+                      rect.x(), rect.y(), rect.width(), rect.height(),
+                      rect.x(), rect.y());
+        }
+
+        // Wait until the server has finished writing into the shared memory.
+        XSync(display_, False);
+    }
+    else if (shm_image_)
+    {
+        if (!XShmGetImage(display_, root_window_, shm_image_, 0, 0, AllPlanes))
+        {
+            LOG(LS_WARNING) << "XShmGetImage failed";
+            return false;
+        }
+    }
+    else
+    {
+        for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        {
+            if (!readRectDirect(it.rect(), frame))
+                return false;
+        }
+
+        return true;
+    }
+
+    for (Region::Iterator it(region); !it.isAtEnd(); it.advance())
+        copyRectFromImage(shm_image_, it.rect(), frame);
+
+    return true;
+}
+
+bool ScreenCapturerX11::readRectDirect(const Rect& rect, Frame* frame)
+{
+    XImage* image = XGetImage(display_, root_window_,
+                              rect.x(), rect.y(), rect.width(), rect.height(),
+                              AllPlanes, ZPixmap);
+    if (!image)
+    {
+        LOG(LS_WARNING) << "XGetImage failed";
+        return false;
+    }
+
+    const bool is_supported = isSupportedImage(image);
+    if (is_supported)
+    {
+        frame->copyPixelsFrom(reinterpret_cast<const uint8_t*>(image->data),
+                              image->bytes_per_line, rect);
+    }
+    else
+    {
+        LOG(LS_WARNING) << "Unsupported pixel format (bpp: " << image->bits_per_pixel << ")";
+    }
+
+    XDestroyImage(image);
+    return is_supported;
 }
 
 } // namespace base
@@ -20,9 +20,30 @@
 #define BASE__DESKTOP__SCREEN_CAPTURER_X11_H
 
 #include "base/desktop/screen_capturer.h"
+#include "base/desktop/shared_frame.h"
+
+// Xlib headers define macros (Status, Bool, None, etc.) which conflict with other code, so only
+// the X11 types used by the class are declared here.
+typedef struct _XDisplay Display;
+typedef struct _XGC* GC;
+typedef struct _XImage XImage;
+typedef unsigned long XID;
+typedef XID Window;
+typedef XID Pixmap;
+typedef XID Damage;
+typedef XID XserverRegion;
 
 namespace base {
 
+class Differ;
+class Region;
+
+// Captures the root window of the X server. When the XDamage extension is available, only the
+// areas reported as damaged since the previous frame are read from the server and the damage
+// region becomes the updated region of the frame. Pixels are transferred through MIT-SHM if the
+// server supports it (a shared pixmap where possible, otherwise a shared image), or through the
+// X protocol otherwise. Without XDamage the whole screen is read and compared with the previous
+// frame.
 class ScreenCapturerX11 : public ScreenCapturer
 {
 public:
@@ -43,6 +64,45 @@ protected:
     void reset() override;
 
 private:
+    bool initDisplay();
+    bool initPixelBuffer();
+    void initDamage();
+    void releasePixelBuffer();
+    void releaseDisplay();
+    void processPendingEvents();
+
+    const Frame* captureImage();
+    bool readRegion(const Region& region, Frame* frame);
+    bool readRectDirect(const Rect& rect, Frame* frame);
+
+    Display* display_ = nullptr;
+    Window root_window_ = 0;
+    Size screen_size_;
+    bool screen_size_changed_ = false;
+
+    // MIT-SHM resources. |shm_pixmap_| is used only if the server supports shared pixmaps.
+    struct ShmSegment;
+    std::unique_ptr<ShmSegment> shm_segment_;
+    XImage* shm_image_ = nullptr;
+    bool shm_attached_ = false;
+    Pixmap shm_pixmap_ = 0;
+    GC shm_gc_ = nullptr;
+
+    // XDamage resources.
+    bool use_damage_ = false;
+    int damage_event_base_ = 0;
+    Damage damage_handle_ = 0;
+    XserverRegion damage_region_ = 0;
+
+    bool has_xfixes_ = false;
+    int xfixes_event_base_ = 0;
+    bool cursor_changed_ = true;
+
+    std::unique_ptr<Differ> differ_;
+    FrameQueue<Frame> queue_;
+
+    std::unique_ptr<MouseCursor> mouse_cursor_;
+
     DISALLOW_COPY_AND_ASSIGN(ScreenCapturerX11);
 };
 
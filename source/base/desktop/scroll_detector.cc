@@ -0,0 +1,243 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/desktop/scroll_detector.h"
+
+#include "base/logging.h"
+#include "base/desktop/frame.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+// Smaller areas are cheaper to encode than to search for a shift.
+const int kMinRectSize = 128;
+
+// The moved area must contain at least this number of lines.
+const int kMinScrollLines = 32;
+
+// Number of the unique lines which must point to the same shift.
+const int kMinVotes = 4;
+
+const uint64_t kHashOffset = 0xcbf29ce484222325ULL;
+const uint64_t kHashPrime = 0x100000001b3ULL;
+
+inline uint64_t hashPixel(uint64_t hash, uint32_t pixel)
+{
+    return (hash ^ pixel) * kHashPrime;
+}
+
+const uint32_t* rowAt(const Frame& frame, int x, int y)
+{
+    return reinterpret_cast<const uint32_t*>(frame.frameDataAtPos(x, y));
+}
+
+// Calculates the hashes of the rows of |rect|.
+void hashRows(const Frame& frame, const Rect& rect, std::vector<uint64_t>* hashes)
+{
+    hashes->resize(static_cast<size_t>(rect.height()));
+
+    for (int y = 0; y < rect.height(); ++y)
+    {
+        const uint32_t* row = rowAt(frame, rect.left(), rect.top() + y);
+        uint64_t hash = kHashOffset;
+
+        for (int x = 0; x < rect.width(); ++x)
+            hash = hashPixel(hash, row[x]);
+
+        (*hashes)[static_cast<size_t>(y)] = hash;
+    }
+}
+
+// Calculates the hashes of the columns of |rect|. The frame is read row by row.
+void hashColumns(const Frame& frame, const Rect& rect, std::vector<uint64_t>* hashes)
+{
+    hashes->assign(static_cast<size_t>(rect.width()), kHashOffset);
+    uint64_t* hash = hashes->data();
+
+    for (int y = 0; y < rect.height(); ++y)
+    {
+        const uint32_t* row = rowAt(frame, rect.left(), rect.top() + y);
+
+        for (int x = 0; x < rect.width(); ++x)
+            hash[x] = hashPixel(hash[x], row[x]);
+    }
+}
+
+} // namespace
+
+ScrollDetector::ScrollDetector() = default;
+ScrollDetector::~ScrollDetector() = default;
+
+bool ScrollDetector::detect(const Frame& previous, const Frame& current, const Rect& rect,
+                            Rect* dest_rect, Point* src_pos)
+{
+    DCHECK(dest_rect);
+    DCHECK(src_pos);
+    DCHECK(previous.size() == current.size());
+    DCHECK_EQ(previous.format().bytesPerPixel(), 4);
+    DCHECK_EQ(current.format().bytesPerPixel(), 4);
+    DCHECK(Rect::makeSize(current.size()).containsRect(rect));
+
+    if (rect.width() < kMinRectSize || rect.height() < kMinRectSize)
+        return false;
+
+    // Vertical scrolling is much more common, so it is checked first.
+    return detectVertical(previous, current, rect, dest_rect, src_pos) ||
+           detectHorizontal(previous, current, rect, dest_rect, src_pos);
+}
+
+bool ScrollDetector::detectVertical(const Frame& previous, const Frame& current, const Rect& rect,
+                                    Rect* dest_rect, Point* src_pos)
+{
+    hashRows(previous, rect, &previous_hashes_);
+    hashRows(current, rect, &current_hashes_);
+
+    int shift, begin, end;
+    if (!findShift(&shift, &begin, &end))
+        return false;
+
+    // Hash collisions are possible, so the pixels are compared.
+    const size_t row_size = static_cast<size_t>(rect.width()) * sizeof(uint32_t);
+
+    for (int y = begin; y < end; ++y)
+    {
+        if (memcmp(rowAt(previous, rect.left(), rect.top() + y - shift),
+                   rowAt(current, rect.left(), rect.top() + y), row_size) != 0)
+        {
+            return false;
+        }
+    }
+
+    *dest_rect = Rect::makeLTRB(rect.left(), rect.top() + begin, rect.right(), rect.top() + end);
+    *src_pos = Point(rect.left(), rect.top() + begin - shift);
+    return true;
+}
+
+bool ScrollDetector::detectHorizontal(const Frame& previous, const Frame& current,
+                                      const Rect& rect, Rect* dest_rect, Point* src_pos)
+{
+    hashColumns(previous, rect, &previous_hashes_);
+    hashColumns(current, rect, &current_hashes_);
+
+    int shift, begin, end;
+    if (!findShift(&shift, &begin, &end))
+        return false;
+
+    const size_t row_size = static_cast<size_t>(end - begin) * sizeof(uint32_t);
+
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        if (memcmp(rowAt(previous, rect.left() + begin - shift, y),
+                   rowAt(current, rect.left() + begin, y), row_size) != 0)
+        {
+            return false;
+        }
+    }
+
+    *dest_rect = Rect::makeLTRB(rect.left() + begin, rect.top(), rect.left() + end, rect.bottom());
+    *src_pos = Point(rect.left() + begin - shift, rect.top());
+    return true;
+}
+
+bool ScrollDetector::findShift(int* shift, int* begin, int* end)
+{
+    DCHECK_EQ(previous_hashes_.size(), current_hashes_.size());
+
+    const int count = static_cast<int>(current_hashes_.size());
+
+    // Lines that occur several times (for example, empty lines) do not define the shift.
+    previous_lines_.clear();
+    for (int i = 0; i < count; ++i)
+    {
+        auto result = previous_lines_.emplace(previous_hashes_[static_cast<size_t>(i)], i);
+        if (!result.second)
+            result.first->second = -1;
+    }
+
+    votes_.clear();
+    int best_shift = 0;
+    int best_votes = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        const uint64_t hash = current_hashes_[static_cast<size_t>(i)];
+
+        // The lines that did not change do not define the shift.
+        if (hash == previous_hashes_[static_cast<size_t>(i)])
+            continue;
+
+        auto line = previous_lines_.find(hash);
+        if (line == previous_lines_.end() || line->second < 0)
+            continue;
+
+        const int line_shift = i - line->second;
+        const int votes = ++votes_[line_shift];
+
+        if (votes > best_votes)
+        {
+            best_votes = votes;
+            best_shift = line_shift;
+        }
+    }
+
+    if (best_votes < kMinVotes)
+        return false;
+
+    // The longest run of the lines which match the previous lines with the shift.
+    int best_begin = 0;
+    int best_end = 0;
+    int run_begin = -1;
+
+    const int first = std::max(0, best_shift);
+    const int last = std::min(count, count + best_shift);
+
+    for (int i = first; i <= last; ++i)
+    {
+        const bool match = i < last && current_hashes_[static_cast<size_t>(i)] ==
+            previous_hashes_[static_cast<size_t>(i - best_shift)];
+
+        if (match)
+        {
+            if (run_begin < 0)
+                run_begin = i;
+        }
+        else if (run_begin >= 0)
+        {
+            if (i - run_begin > best_end - best_begin)
+            {
+                best_begin = run_begin;
+                best_end = i;
+            }
+
+            run_begin = -1;
+        }
+    }
+
+    if (best_end - best_begin < kMinScrollLines)
+        return false;
+
+    *shift = best_shift;
+    *begin = best_begin;
+    *end = best_end;
+    return true;
+}
+
+} // namespace base
@@ -0,0 +1,66 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE__DESKTOP__SCROLL_DETECTOR_H
+#define BASE__DESKTOP__SCROLL_DETECTOR_H
+
+#include "base/macros_magic.h"
+#include "base/desktop/geometry.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace base {
+
+class Frame;
+
+// Searches the changed areas of the screen for content that was moved by scrolling. The moved
+// area can be copied on the receiving side instead of being encoded again.
+class ScrollDetector
+{
+public:
+    ScrollDetector();
+    ~ScrollDetector();
+
+    // Checks whether a part of |rect| in |current| is a copy of |previous| shifted vertically or
+    // horizontally within |rect|. On success |dest_rect| receives the moved area and |src_pos|
+    // receives the position of its source in |previous|. Both frames must have the same size and
+    // 32 bits per pixel.
+    bool detect(const Frame& previous, const Frame& current, const Rect& rect,
+                Rect* dest_rect, Point* src_pos);
+
+private:
+    bool detectVertical(const Frame& previous, const Frame& current, const Rect& rect,
+                        Rect* dest_rect, Point* src_pos);
+    bool detectHorizontal(const Frame& previous, const Frame& current, const Rect& rect,
+                          Rect* dest_rect, Point* src_pos);
+
+    // Finds the shift of the lines and the longest run of the shifted lines [|begin|; |end|) in
+    // the current hashes.
+    bool findShift(int* shift, int* begin, int* end);
+
+    std::vector<uint64_t> previous_hashes_;
+    std::vector<uint64_t> current_hashes_;
+    std::unordered_map<uint64_t, int> previous_lines_;
+    std::unordered_map<int, int> votes_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScrollDetector);
+};
+
+} // namespace base
+
+#endif // BASE__DESKTOP__SCROLL_DETECTOR_H
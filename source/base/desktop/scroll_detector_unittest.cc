@@ -0,0 +1,109 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/desktop/scroll_detector.h"
+
+#include "base/desktop/frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace base {
+
+namespace {
+
+std::unique_ptr<Frame> createRandomFrame(const Size& size, uint32_t seed)
+{
+    std::unique_ptr<Frame> frame = FrameSimple::create(size, PixelFormat::ARGB());
+    std::mt19937 engine(seed);
+
+    for (int y = 0; y < size.height(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(0, y));
+
+        for (int x = 0; x < size.width(); ++x)
+            row[x] = engine();
+    }
+
+    return frame;
+}
+
+std::unique_ptr<Frame> copyFrame(const Frame& frame)
+{
+    std::unique_ptr<Frame> copy = FrameSimple::create(frame.size(), frame.format());
+    copy->copyPixelsFrom(frame, Point(0, 0), Rect::makeSize(frame.size()));
+    return copy;
+}
+
+} // namespace
+
+TEST(ScrollDetectorTest, Vertical)
+{
+    const Rect rect = Rect::makeXYWH(100, 50, 400, 300);
+    std::unique_ptr<Frame> previous = createRandomFrame(Size(640, 480), 1);
+    std::unique_ptr<Frame> current = copyFrame(*previous);
+
+    // The content of |rect| moves up by 37 lines and a new strip appears at the bottom.
+    current->copyRect(Point(rect.left(), rect.top() + 37),
+                      Rect::makeLTRB(rect.left(), rect.top(), rect.right(), rect.bottom() - 37));
+
+    ScrollDetector detector;
+    Rect dest_rect;
+    Point src_pos;
+
+    ASSERT_TRUE(detector.detect(*previous, *current, rect, &dest_rect, &src_pos));
+    EXPECT_EQ(dest_rect, Rect::makeLTRB(rect.left(), rect.top(), rect.right(), rect.bottom() - 37));
+    EXPECT_EQ(src_pos, Point(rect.left(), rect.top() + 37));
+}
+
+TEST(ScrollDetectorTest, Horizontal)
+{
+    const Rect rect = Rect::makeXYWH(64, 64, 256, 200);
+    std::unique_ptr<Frame> previous = createRandomFrame(Size(400, 300), 2);
+    std::unique_ptr<Frame> current = copyFrame(*previous);
+
+    // The content of |rect| moves right by 50 columns.
+    current->copyRect(rect.topLeft(),
+                      Rect::makeLTRB(rect.left() + 50, rect.top(), rect.right(), rect.bottom()));
+
+    ScrollDetector detector;
+    Rect dest_rect;
+    Point src_pos;
+
+    ASSERT_TRUE(detector.detect(*previous, *current, rect, &dest_rect, &src_pos));
+    EXPECT_EQ(dest_rect, Rect::makeLTRB(rect.left() + 50, rect.top(), rect.right(), rect.bottom()));
+    EXPECT_EQ(src_pos, rect.topLeft());
+}
+
+TEST(ScrollDetectorTest, NoScroll)
+{
+    const Rect rect = Rect::makeWH(320, 240);
+    std::unique_ptr<Frame> previous = createRandomFrame(rect.size(), 3);
+    std::unique_ptr<Frame> current = createRandomFrame(rect.size(), 4);
+
+    ScrollDetector detector;
+    Rect dest_rect;
+    Point src_pos;
+
+    EXPECT_FALSE(detector.detect(*previous, *current, rect, &dest_rect, &src_pos));
+
+    // The same frame has no shift either.
+    EXPECT_FALSE(detector.detect(*previous, *previous, rect, &dest_rect, &src_pos));
+}
+
+} // namespace base
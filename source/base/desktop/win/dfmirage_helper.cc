@@ -26,7 +26,6 @@ namespace base {
 
 namespace {
 
-static const int kBytesPerPixel = 4;
 static const int kBitsPerPixel = 32;
 static const int kExtendedDeviceModeSize = 3072;
 
@@ -119,22 +118,6 @@ void DFMirageHelper::addUpdatedRects(Region* updated_region) const
     last_update_ = next_update;
 }
 
-void DFMirageHelper::copyRegion(Frame* frame, const Region& updated_region) const
-{
-    DCHECK(frame);
-
-    const uint8_t* source_buffer = get_changes_buffer_.user_buffer;
-    const int source_stride = kBytesPerPixel * screen_rect_.width();
-
-    for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
-    {
-        const Rect& rect = it.rect();
-        const int source_offset =
-            source_stride * rect.y() + static_cast<int>(sizeof(uint32_t)) * rect.x();
-        frame->copyPixelsFrom(source_buffer + source_offset, source_stride, rect);
-    }
-}
-
 bool DFMirageHelper::update(bool load)
 {
     static const DWORD dmf_devmodewext_magic_sig = 0xDF20C0DE;
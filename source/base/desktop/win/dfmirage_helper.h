@@ -34,7 +34,9 @@ public:
 
     const Rect& screenRect() const override { return screen_rect_; }
     void addUpdatedRects(Region* updated_region) const override;
-    void copyRegion(Frame* frame, const Region& updated_region) const override;
+
+protected:
+    const uint8_t* screenBuffer() const override { return get_changes_buffer_.user_buffer; }
 
 private:
     explicit DFMirageHelper(const Rect& screen_rect);
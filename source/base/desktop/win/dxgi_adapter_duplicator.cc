@@ -150,16 +150,34 @@ void DxgiAdapterDuplicator::unregister(const Context* const context)
         duplicators_[i].unregister(&context->contexts[i]);
 }
 
-bool DxgiAdapterDuplicator::duplicate(Context* context, SharedFrame* target, DxgiCursor* cursor)
+bool DxgiAdapterDuplicator::beginDuplicate(
+    Context* context, SharedFrame* target, DxgiCursor* cursor)
 {
     DCHECK_EQ(context->contexts.size(), duplicators_.size());
 
     for (size_t i = 0; i < duplicators_.size(); ++i)
     {
-        if (!duplicators_[i].duplicate(&context->contexts[i],
-                                       duplicators_[i].desktopRect().topLeft(),
-                                       target,
-                                       cursor))
+        if (!duplicators_[i].beginDuplicate(&context->contexts[i],
+                                            duplicators_[i].desktopRect().topLeft(),
+                                            target,
+                                            cursor))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool DxgiAdapterDuplicator::endDuplicate(Context* context, SharedFrame* target)
+{
+    DCHECK_EQ(context->contexts.size(), duplicators_.size());
+
+    for (size_t i = 0; i < duplicators_.size(); ++i)
+    {
+        if (!duplicators_[i].endDuplicate(&context->contexts[i],
+                                          duplicators_[i].desktopRect().topLeft(),
+                                          target))
         {
             return false;
         }
@@ -47,9 +47,11 @@ public:
     // Initializes the DxgiAdapterDuplicator from a D3dDevice.
     bool initialize();
 
-    // Sequentially calls Duplicate function of all the DxgiOutputDuplicator instances owned by
-    // this instance, and writes into |target|.
-    bool duplicate(Context* context, SharedFrame* target, DxgiCursor* cursor);
+    // Duplicates all the monitors of this instance into |target| in two steps, see
+    // DxgiOutputDuplicator::beginDuplicate(). The copies of all the monitors are started before
+    // the content of any of them is read.
+    bool beginDuplicate(Context* context, SharedFrame* target, DxgiCursor* cursor);
+    bool endDuplicate(Context* context, SharedFrame* target);
 
     // Captures one monitor and writes into |target|. |monitor_id| should be between [0, screenCount()).
     bool duplicateMonitor(Context* context, int monitor_id, SharedFrame* target, DxgiCursor* cursor);
@@ -22,12 +22,22 @@
 #include "base/desktop/frame_aligned.h"
 #include "base/desktop/win/dxgi_frame.h"
 #include "base/desktop/win/screen_capture_utils.h"
+#include "base/threading/worker_group.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <thread>
 
 namespace base {
 
+namespace {
+
+// Number of the threads which finish the duplication of the video adapters.
+const int kMaxThreadCount = 4;
+
+} // namespace
+
 // static
 const char* DxgiDuplicatorController::resultName(DxgiDuplicatorController::Result result)
 {
@@ -182,6 +192,7 @@ DxgiDuplicatorController::Result DxgiDuplicatorController::doDuplicate(
         return Result::FRAME_PREPARE_FAILED;
 
     frame->frame()->updatedRegion()->clear();
+    frame->frame()->moveRects()->clear();
 
     setup(frame->context());
 
@@ -338,13 +349,37 @@ void DxgiDuplicatorController::setup(Context* context)
 bool DxgiDuplicatorController::doDuplicateAll(
     Context* context, SharedFrame* target, DxgiCursor* cursor)
 {
+    // The video cards copy the updated regions of all the monitors at the same time. The CPU waits
+    // for the copies only after all of them are started.
     for (size_t i = 0; i < duplicators_.size(); ++i)
     {
-        if (!duplicators_[i].duplicate(&context->contexts[i], target, cursor))
+        if (!duplicators_[i].beginDuplicate(&context->contexts[i], target, cursor))
             return false;
     }
 
-    return true;
+    if (duplicators_.size() == 1)
+        return duplicators_.front().endDuplicate(&context->contexts.front(), target);
+
+    // Every adapter has its own device, so the adapters wait for their copies and read the
+    // textures in parallel. The monitors of one adapter share its device context and are finished
+    // one after another.
+    const int adapter_count = static_cast<int>(duplicators_.size());
+    const int thread_count = std::min(adapter_count, kMaxThreadCount);
+
+    if (!workers_ || workers_->threadCount() != thread_count)
+        workers_ = std::make_unique<WorkerGroup>(thread_count);
+
+    std::atomic<bool> result = true;
+
+    workers_->run(adapter_count, [&](int index)
+    {
+        const size_t i = static_cast<size_t>(index);
+
+        if (!duplicators_[i].endDuplicate(&context->contexts[i], target))
+            result = false;
+    });
+
+    return result;
 }
 
 bool DxgiDuplicatorController::doDuplicateOne(
@@ -27,11 +27,14 @@
 
 #include <D3DCommon.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace base {
 
+class WorkerGroup;
+
 // A controller for all the objects we need to call Windows DirectX capture APIs It's a singleton
 // because only one IDXGIOutputDuplication instance per monitor is allowed per application.
 //
@@ -188,6 +191,7 @@ private:
     Rect desktop_rect_;
     Point dpi_;
     std::vector<DxgiAdapterDuplicator> duplicators_;
+    std::unique_ptr<WorkerGroup> workers_;
     D3dInfo d3d_info_;
     DisplayConfigurationMonitor display_configuration_monitor_;
     // A number to indicate how many succeeded duplications have been performed.
@@ -27,6 +27,7 @@
 
 #include <algorithm>
 #include <cstring>
+#include <mutex>
 
 #include <comdef.h>
 #include <dxgi.h>
@@ -44,6 +45,11 @@ namespace {
 // DxgiOutputDuplicator does not need to actively wait for a new frame.
 const int kAcquireTimeoutMs = 0;
 
+// The monitors of different video adapters are finished in parallel (see
+// DxgiDuplicatorController). They write into separate areas of the target frame, but its
+// updated region and move rectangles are shared.
+std::mutex g_target_info_lock;
+
 Rect RECTToDesktopRect(const RECT& rect)
 {
     return Rect::makeLTRB(rect.left, rect.top, rect.right, rect.bottom);
@@ -197,6 +203,13 @@ bool DxgiOutputDuplicator::releaseFrame()
 
 bool DxgiOutputDuplicator::duplicate(
     Context* context, const Point& offset, SharedFrame* target, DxgiCursor* cursor)
+{
+    return beginDuplicate(context, offset, target, cursor) &&
+           endDuplicate(context, offset, target);
+}
+
+bool DxgiOutputDuplicator::beginDuplicate(
+    Context* context, const Point& offset, SharedFrame* target, DxgiCursor* cursor)
 {
     DCHECK(duplication_);
     DCHECK(texture_);
@@ -273,10 +286,47 @@ bool DxgiOutputDuplicator::duplicate(
         detectUpdatedRegion(frame_info, &context->updated_region);
         spreadContextChange(context);
 
-        if (!texture_->copyFrom(frame_info, resource.Get()))
+        updated_region.addRegion(context->updated_region);
+
+        // Only |updated_region| of the texture is read below. The texture is not rotated.
+        Region texture_region;
+        if (rotation_ != Rotation::CLOCK_WISE_0)
+        {
+            for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+            {
+                texture_region.addRect(
+                    rotateRect(it.rect(), desktopSize(), reverseRotation(rotation_)));
+            }
+        }
+        else
+        {
+            texture_region = updated_region;
+        }
+
+        if (!texture_->copyFrom(frame_info, resource.Get(), texture_region))
             return false;
 
-        updated_region.addRegion(context->updated_region);
+        has_pending_frame_ = true;
+    }
+
+    pending_region_.swap(&updated_region);
+    pending_error_ = error.Error();
+    return true;
+}
+
+bool DxgiOutputDuplicator::endDuplicate(
+    Context* context, const Point& offset, SharedFrame* target)
+{
+    Region updated_region;
+    updated_region.swap(&pending_region_);
+
+    if (has_pending_frame_)
+    {
+        has_pending_frame_ = false;
+
+        // Waits for the copy started in beginDuplicate().
+        if (!texture_->map())
+            return false;
 
         // TODO(zijiehe): Figure out why clearing context->updated_region() here triggers screen
         // flickering?
@@ -308,9 +358,30 @@ bool DxgiOutputDuplicator::duplicate(
             }
         }
 
+        std::scoped_lock lock(g_target_info_lock);
+
         last_frame_ = target->share();
         last_frame_offset_ = offset;
 
+        const Rect desktop_rect = untranslatedDesktopRect();
+
+        for (const Frame::MoveRect& move_rect : move_rects_)
+        {
+            const Rect source_rect = Rect::makeXYWH(move_rect.source_pos,
+                                                    move_rect.dest_rect.size());
+            if (!desktop_rect.containsRect(source_rect) ||
+                !desktop_rect.containsRect(move_rect.dest_rect))
+            {
+                continue;
+            }
+
+            Frame::MoveRect translated = move_rect;
+            translated.source_pos.translate(offset);
+            translated.dest_rect.translate(offset);
+
+            target->moveRects()->push_back(translated);
+        }
+
         updated_region.translate(offset.x(), offset.y());
         target->updatedRegion()->addRegion(updated_region);
         ++num_frames_captured_;
@@ -339,6 +410,8 @@ bool DxgiOutputDuplicator::duplicate(
         }
 
         updated_region.translate(offset.x(), offset.y());
+
+        std::scoped_lock lock(g_target_info_lock);
         target->updatedRegion()->addRegion(updated_region);
     }
     else
@@ -349,7 +422,7 @@ bool DxgiOutputDuplicator::duplicate(
     }
 
     // If AcquireNextFrame() failed with timeout error, we do not need to release the frame.
-    return error.Error() == DXGI_ERROR_WAIT_TIMEOUT || releaseFrame();
+    return pending_error_ == DXGI_ERROR_WAIT_TIMEOUT || releaseFrame();
 }
 
 Rect DxgiOutputDuplicator::translatedDesktopRect(const Point& offset) const
@@ -384,6 +457,7 @@ bool DxgiOutputDuplicator::doDetectUpdatedRegion(const DXGI_OUTDUPL_FRAME_INFO&
 {
     DCHECK(updated_region);
     updated_region->clear();
+    move_rects_.clear();
 
     if (frame_info.TotalMetadataBufferSize == 0)
     {
@@ -436,6 +510,16 @@ bool DxgiOutputDuplicator::doDetectUpdatedRegion(const DXGI_OUTDUPL_FRAME_INFO&
         if (move_rects->SourcePoint.x != move_rects->DestinationRect.left ||
             move_rects->SourcePoint.y != move_rects->DestinationRect.top)
         {
+            if (rotation_ == Rotation::CLOCK_WISE_0)
+            {
+                move_rects_.push_back(Frame::MoveRect {
+                    Point(move_rects->SourcePoint.x, move_rects->SourcePoint.y),
+                    Rect::makeLTRB(move_rects->DestinationRect.left,
+                                   move_rects->DestinationRect.top,
+                                   move_rects->DestinationRect.right,
+                                   move_rects->DestinationRect.bottom) });
+            }
+
             updated_region->addRect(
                 rotateRect(Rect::makeXYWH(move_rects->SourcePoint.x,
                                           move_rects->SourcePoint.y,
@@ -69,6 +69,15 @@ public:
     bool duplicate(
         Context* context, const Point& offset, SharedFrame* target_frame, DxgiCursor* cursor);
 
+    // duplicate() in two steps. beginDuplicate() acquires the frame and starts the copy of the
+    // updated region from the video memory, endDuplicate() waits for the copy and writes the
+    // content to the |target|. Calling beginDuplicate() for all outputs first lets the GPU copy
+    // the monitors together instead of waiting for each of them in turn. Both calls take the same
+    // arguments and endDuplicate() must follow a successful beginDuplicate().
+    bool beginDuplicate(
+        Context* context, const Point& offset, SharedFrame* target_frame, DxgiCursor* cursor);
+    bool endDuplicate(Context* context, const Point& offset, SharedFrame* target_frame);
+
     // Returns the desktop rect covered by this DxgiOutputDuplicator.
     const Rect& desktopRect() const { return desktop_rect_; }
 
@@ -119,7 +128,18 @@ private:
     Microsoft::WRL::ComPtr<IDXGIOutputDuplication> duplication_;
     DXGI_OUTDUPL_DESC desc_;
     std::vector<uint8_t> metadata_;
+
+    // Move rectangles of the last frame in untranslated coordinates. Only filled for not rotated
+    // outputs.
+    std::vector<Frame::MoveRect> move_rects_;
+
     std::unique_ptr<DxgiTexture> texture_;
+
+    // State between beginDuplicate() and endDuplicate().
+    bool has_pending_frame_ = false;
+    Region pending_region_;
+    HRESULT pending_error_ = S_OK;
+
     Rotation rotation_ = Rotation::CLOCK_WISE_0;
     Size unrotated_size_;
 
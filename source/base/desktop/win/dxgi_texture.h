@@ -20,6 +20,7 @@
 #define BASE__DESKTOP__WIN__DXGI_TEXTURE_H
 
 #include "base/desktop/frame.h"
+#include "base/desktop/region.h"
 
 #include <memory>
 
@@ -37,9 +38,17 @@ public:
     DxgiTexture();
     virtual ~DxgiTexture();
 
-    // Copies selected regions of a frame represented by frame_info and resource.
-    // Returns false if anything wrong.
-    bool copyFrom(const DXGI_OUTDUPL_FRAME_INFO& frame_info, IDXGIResource* resource);
+    // Copies selected regions of a frame represented by frame_info and resource. |region| is the
+    // area of the texture which will be read after the call (in the coordinates of the texture),
+    // the implementation may copy only this area. The copy can be executed asynchronously, map()
+    // must be called before the data is read. Returns false if anything wrong.
+    bool copyFrom(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
+                  IDXGIResource* resource,
+                  const Region& region);
+
+    // Waits for the copy started by copyFrom() and makes the data accessible by the CPU. Returns
+    // false if anything wrong.
+    bool map();
 
     const Size& desktopSize() const { return desktop_size_; }
     uint8_t* bits() const { return static_cast<uint8_t*>(rect_.pBits); }
@@ -47,7 +56,7 @@ public:
 
     // Releases the resource currently holds by this instance. Returns false if
     // anything wrong, and this instance should be deprecated in this state. bits,
-    // pitch and AsDesktopFrame are only valid after a success CopyFrom() call,
+    // pitch and AsDesktopFrame are only valid after a success map() call,
     // but before Release() call.
     bool release();
 
@@ -60,8 +69,10 @@ protected:
     DXGI_MAPPED_RECT* rect();
 
     virtual bool copyFromTexture(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
-                                 ID3D11Texture2D* texture) = 0;
+                                 ID3D11Texture2D* texture,
+                                 const Region& region) = 0;
 
+    virtual bool doMap() = 0;
     virtual bool doRelease() = 0;
 
 private:
@@ -35,7 +35,8 @@ DxgiTextureMapping::DxgiTextureMapping(IDXGIOutputDuplication* duplication)
 DxgiTextureMapping::~DxgiTextureMapping() = default;
 
 bool DxgiTextureMapping::copyFromTexture(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
-                                         ID3D11Texture2D* texture)
+                                         ID3D11Texture2D* texture,
+                                         const Region& /* region */)
 {
     DCHECK_GT(frame_info.AccumulatedFrames, 0u);
     DCHECK(texture);
@@ -54,6 +55,12 @@ bool DxgiTextureMapping::copyFromTexture(const DXGI_OUTDUPL_FRAME_INFO& frame_in
     return true;
 }
 
+bool DxgiTextureMapping::doMap()
+{
+    // The surface is in the system memory and was mapped in copyFromTexture().
+    return true;
+}
+
 bool DxgiTextureMapping::doRelease()
 {
     _com_error error = duplication_->UnMapDesktopSurface();
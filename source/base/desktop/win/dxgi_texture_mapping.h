@@ -39,8 +39,10 @@ public:
 
 protected:
     bool copyFromTexture(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
-                         ID3D11Texture2D* texture) override;
+                         ID3D11Texture2D* texture,
+                         const Region& region) override;
 
+    bool doMap() override;
     bool doRelease() override;
 
 private:
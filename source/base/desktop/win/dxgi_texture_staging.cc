@@ -28,6 +28,14 @@ using Microsoft::WRL::ComPtr;
 
 namespace base {
 
+namespace {
+
+// With more rectangles the overhead of separate copy commands exceeds the gain and the entire
+// texture is copied.
+const int kMaxCopyRects = 64;
+
+} // namespace
+
 DxgiTextureStaging::DxgiTextureStaging(const D3dDevice& device)
     : device_(device)
 {
@@ -106,7 +114,8 @@ void DxgiTextureStaging::assertStageAndSurfaceAreSameObject()
 }
 
 bool DxgiTextureStaging::copyFromTexture(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
-                                         ID3D11Texture2D* texture)
+                                         ID3D11Texture2D* texture,
+                                         const Region& region)
 {
     DCHECK_GT(frame_info.AccumulatedFrames, 0u);
     DCHECK(texture);
@@ -116,9 +125,13 @@ bool DxgiTextureStaging::copyFromTexture(const DXGI_OUTDUPL_FRAME_INFO& frame_in
     if (!initializeStage(texture))
         return false;
 
-    device_.context()->CopyResource(static_cast<ID3D11Resource*>(stage_.Get()),
-                                    static_cast<ID3D11Resource*>(texture));
+    copyRegion(texture, region);
+    return true;
+}
 
+bool DxgiTextureStaging::doMap()
+{
+    // The call waits until the copy queued by copyRegion() is completed by the GPU.
     *rect() = { 0 };
 
     _com_error error = surface_->Map(rect(), DXGI_MAP_READ);
@@ -133,6 +146,44 @@ bool DxgiTextureStaging::copyFromTexture(const DXGI_OUTDUPL_FRAME_INFO& frame_in
     return true;
 }
 
+void DxgiTextureStaging::copyRegion(ID3D11Texture2D* texture, const Region& region)
+{
+    ID3D11Resource* target = static_cast<ID3D11Resource*>(stage_.Get());
+    ID3D11Resource* source = static_cast<ID3D11Resource*>(texture);
+    const Rect texture_rect = Rect::makeSize(desktopSize());
+
+    // The stage is read only inside |region|, so only this area has to be transferred from the
+    // video memory. Usually it is a small part of the screen.
+    Region copy_region(region);
+    copy_region.intersectWith(texture_rect);
+
+    int rect_count = 0;
+    for (Region::Iterator it(copy_region); !it.isAtEnd(); it.advance())
+        ++rect_count;
+
+    if (rect_count == 0 || rect_count > kMaxCopyRects || copy_region.equals(Region(texture_rect)))
+    {
+        device_.context()->CopyResource(target, source);
+        return;
+    }
+
+    for (Region::Iterator it(copy_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect rect = it.rect();
+
+        D3D11_BOX box;
+        box.left = static_cast<UINT>(rect.left());
+        box.top = static_cast<UINT>(rect.top());
+        box.front = 0;
+        box.right = static_cast<UINT>(rect.right());
+        box.bottom = static_cast<UINT>(rect.bottom());
+        box.back = 1;
+
+        device_.context()->CopySubresourceRegion(
+            target, 0, box.left, box.top, 0, source, 0, &box);
+    }
+}
+
 bool DxgiTextureStaging::doRelease()
 {
     _com_error error = surface_->Unmap();
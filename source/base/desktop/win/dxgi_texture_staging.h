@@ -46,8 +46,10 @@ protected:
     // Copies selected regions of a frame represented by frame_info and texture.
     // Returns false if anything wrong.
     bool copyFromTexture(const DXGI_OUTDUPL_FRAME_INFO& frame_info,
-                         ID3D11Texture2D* texture) override;
+                         ID3D11Texture2D* texture,
+                         const Region& region) override;
 
+    bool doMap() override;
     bool doRelease() override;
 
 private:
@@ -55,6 +57,9 @@ private:
     // execute Windows APIs, or the size of the texture is not consistent with desktop_rect.
     bool initializeStage(ID3D11Texture2D* texture);
 
+    // Copies |region| of |texture| to the stage.
+    void copyRegion(ID3D11Texture2D* texture, const Region& region);
+
     // Makes sure stage_ and surface_ are always pointing to a same object.
     // We need an ID3D11Texture2D instance for ID3D11DeviceContext::CopySubresourceRegion, but an
     // IDXGISurface for IDXGISurface::Map.
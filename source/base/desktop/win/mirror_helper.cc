@@ -19,11 +19,76 @@
 #include "base/desktop/win/mirror_helper.h"
 
 #include "base/logging.h"
+#include "base/desktop/frame.h"
+#include "base/desktop/region.h"
 #include "base/strings/string_util.h"
 #include "base/win/registry.h"
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
 namespace base {
 
+namespace {
+
+const int kBytesPerPixel = 4;
+
+// The size of the blocks which are checked for the changes. The same as in Differ.
+const int kBlockSize = 32;
+
+} // namespace
+
+void MirrorHelper::copyRegion(Frame* frame, Region* updated_region) const
+{
+    DCHECK(frame);
+    DCHECK(updated_region);
+
+    const uint8_t* source_buffer = screenBuffer();
+    const int source_stride = kBytesPerPixel * screenRect().width();
+
+    std::vector<Rect> changed_rects;
+
+    for (Region::Iterator it(*updated_region); !it.isAtEnd(); it.advance())
+    {
+        const Rect& rect = it.rect();
+
+        // The blocks are aligned to the grid, so the neighbouring rectangles of the region
+        // produce blocks that the region can merge.
+        for (int y = rect.top() - rect.top() % kBlockSize; y < rect.bottom(); y += kBlockSize)
+        {
+            for (int x = rect.left() - rect.left() % kBlockSize; x < rect.right(); x += kBlockSize)
+            {
+                Rect block = Rect::makeXYWH(x, y, kBlockSize, kBlockSize);
+                block.intersectWith(rect);
+
+                const uint8_t* source = source_buffer + source_stride * block.y() +
+                    kBytesPerPixel * block.x();
+                const uint8_t* dest = frame->frameDataAtPos(block.topLeft());
+                const size_t row_size = static_cast<size_t>(kBytesPerPixel * block.width());
+
+                bool changed = false;
+
+                for (int row = 0; row < block.height() && !changed; ++row)
+                {
+                    changed = memcmp(source + row * source_stride,
+                                     dest + row * frame->stride(),
+                                     row_size) != 0;
+                }
+
+                if (!changed)
+                    continue;
+
+                frame->copyPixelsFrom(source, source_stride, block);
+                changed_rects.emplace_back(block);
+            }
+        }
+    }
+
+    updated_region->clear();
+    updated_region->addRects(changed_rects.data(), static_cast<int>(changed_rects.size()));
+}
+
 // static
 bool MirrorHelper::findDisplayDevice(std::wstring_view device_string,
                                      std::wstring* device_name,
@@ -35,9 +35,16 @@ public:
 
     virtual const Rect& screenRect() const = 0;
     virtual void addUpdatedRects(Region* updated_region) const = 0;
-    virtual void copyRegion(Frame* frame, const Region& updated_region) const = 0;
+
+    // Copies the areas reported by the driver into |frame|. The driver reports the areas which
+    // were drawn to, so the blocks whose pixels are the same as in |frame| are removed from
+    // |updated_region|.
+    void copyRegion(Frame* frame, Region* updated_region) const;
 
 protected:
+    // Returns the screen image of the driver (32 bits per pixel, rows without padding).
+    virtual const uint8_t* screenBuffer() const = 0;
+
     static bool findDisplayDevice(std::wstring_view device_string,
                                   std::wstring* device_name,
                                   std::wstring* device_key);
@@ -110,22 +110,6 @@ void Mv2Helper::addUpdatedRects(Region* updated_region) const
     last_update_ = next_update;
 }
 
-void Mv2Helper::copyRegion(Frame* frame, const Region& updated_region) const
-{
-    DCHECK(frame);
-
-    const uint8_t* source_buffer = screen_buffer_;
-    const int source_stride = kBytesPerPixel * screen_rect_.width();
-
-    for (Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
-    {
-        const Rect& rect = it.rect();
-        const int source_offset =
-            source_stride * rect.y() + static_cast<int>(sizeof(uint32_t)) * rect.x();
-        frame->copyPixelsFrom(source_buffer + source_offset, source_stride, rect);
-    }
-}
-
 bool Mv2Helper::update(bool load)
 {
     DEVMODE device_mode;
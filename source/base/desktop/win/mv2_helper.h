@@ -35,7 +35,9 @@ public:
 
     const Rect& screenRect() const override { return screen_rect_; }
     void addUpdatedRects(Region* updated_region) const override;
-    void copyRegion(Frame* frame, const Region& updated_region) const override;
+
+protected:
+    const uint8_t* screenBuffer() const override { return screen_buffer_; }
 
 private:
     explicit Mv2Helper(const Rect& screen_rect);
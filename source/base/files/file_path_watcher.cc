@@ -18,7 +18,10 @@
 
 #include "base/files/file_path_watcher.h"
 
+#include "base/hash64.h"
 #include "base/logging.h"
+#include "base/waitable_timer.h"
+#include "base/files/file_util.h"
 #include "build/build_config.h"
 
 namespace base {
@@ -57,7 +60,90 @@ bool FilePathWatcher::watch(const std::filesystem::path& path,
                             const Callback& callback)
 {
     DCHECK(path.is_absolute());
-    return impl_->watch(path, recursive, callback);
+
+    callback_ = callback;
+
+    if (content_check_)
+        content_hash_ = contentHash(path);
+
+    return impl_->watch(path, recursive,
+        std::bind(&FilePathWatcher::onChanged, this, std::placeholders::_1,
+                  std::placeholders::_2));
+}
+
+void FilePathWatcher::setQuietPeriod(const std::chrono::milliseconds& period)
+{
+    quiet_period_ = period;
+
+    if (quiet_period_ > std::chrono::milliseconds::zero() && !quiet_timer_)
+    {
+        quiet_timer_ = std::make_unique<WaitableTimer>(
+            WaitableTimer::Type::SINGLE_SHOT, impl_->taskRunner());
+    }
+}
+
+void FilePathWatcher::setContentCheck(bool enable)
+{
+    content_check_ = enable;
+}
+
+void FilePathWatcher::onChanged(const std::filesystem::path& path, bool error)
+{
+    if (error)
+    {
+        if (quiet_timer_)
+            quiet_timer_->stop();
+
+        callback_(path, true);
+        return;
+    }
+
+    if (!quiet_timer_)
+    {
+        notify(path);
+        return;
+    }
+
+    // The timer is restarted by each change.
+    changed_path_ = path;
+    quiet_timer_->stop();
+    quiet_timer_->start(quiet_period_, [this]()
+    {
+        notify(changed_path_);
+    });
+}
+
+void FilePathWatcher::notify(const std::filesystem::path& path)
+{
+    if (content_check_)
+    {
+        std::optional<uint64_t> content_hash = contentHash(path);
+
+        // A file that cannot be read is reported, it may have been deleted.
+        if (content_hash.has_value() && content_hash == content_hash_)
+        {
+            LOG(LS_INFO) << "File content has not changed: " << path;
+            return;
+        }
+
+        content_hash_ = content_hash;
+    }
+
+    callback_(path, false);
+}
+
+// static
+std::optional<uint64_t> FilePathWatcher::contentHash(const std::filesystem::path& path)
+{
+    std::error_code error_code;
+    if (!std::filesystem::is_regular_file(path, error_code))
+        return std::nullopt;
+
+    std::string content;
+    if (!readFile(path, &content))
+        return std::nullopt;
+
+    return hash64(content.data(), content.size());
 }
 
 } // namespace base
@@ -21,13 +21,16 @@
 
 #include "base/macros_magic.h"
 
+#include <chrono>
 #include <filesystem>
 #include <functional>
 #include <memory>
+#include <optional>
 
 namespace base {
 
 class TaskRunner;
+class WaitableTimer;
 
 // This class lets you register interest in changes on a std::filesystem::path. The callback will
 // get called whenever the file or directory referenced by the std::filesystem::path is changed,
@@ -104,8 +107,28 @@ public:
     // false in the case of failure.
     bool watch(const std::filesystem::path& path, bool recursive, const Callback& callback);
 
+    // Changes that follow each other within |period| are reported once, after the last of them.
+    // Must be called before watch().
+    void setQuietPeriod(const std::chrono::milliseconds& period);
+
+    // If enabled, the callback is not invoked when the content of the watched file is the same as
+    // before the change. Must be called before watch().
+    void setContentCheck(bool enable);
+
 private:
+    void onChanged(const std::filesystem::path& path, bool error);
+    void notify(const std::filesystem::path& path);
+    static std::optional<uint64_t> contentHash(const std::filesystem::path& path);
+
     std::unique_ptr<PlatformDelegate> impl_;
+    Callback callback_;
+
+    std::chrono::milliseconds quiet_period_ { 0 };
+    std::unique_ptr<WaitableTimer> quiet_timer_;
+    std::filesystem::path changed_path_;
+
+    bool content_check_ = false;
+    std::optional<uint64_t> content_hash_;
 
     DISALLOW_COPY_AND_ASSIGN(FilePathWatcher);
 };
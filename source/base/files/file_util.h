@@ -32,6 +32,12 @@ bool writeFile(const std::filesystem::path& filename, std::string_view buffer);
 bool readFile(const std::filesystem::path& filename, ByteArray* buffer);
 bool readFile(const std::filesystem::path& filename, std::string* buffer);
 
+// Copies the file with the native API of the system. The data is not read into the process if the
+// file system can clone the file or copy it by itself (for example, a network share). Fails if
+// |target| exists and |overwrite| is false.
+bool copyFile(const std::filesystem::path& source, const std::filesystem::path& target,
+              bool overwrite);
+
 } // namespace base
 
 #endif // BASE__FILES__FILE_UTIL_H
@@ -0,0 +1,191 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/files/file_util.h"
+
+#include "base/logging.h"
+#include "base/macros_magic.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(OS_LINUX)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif // defined(OS_LINUX)
+
+#if defined(OS_MAC)
+#include <copyfile.h>
+#endif // defined(OS_MAC)
+
+#include <memory>
+
+namespace base {
+
+namespace {
+
+#if defined(OS_LINUX)
+
+class ScopedFile
+{
+public:
+    explicit ScopedFile(int file) : file_(file) {}
+    ~ScopedFile()
+    {
+        if (file_ != -1)
+            close(file_);
+    }
+
+    int get() const { return file_; }
+    bool isValid() const { return file_ != -1; }
+
+private:
+    int file_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedFile);
+};
+
+bool copyData(int source, int target)
+{
+    const size_t kBufferSize = 1024 * 1024;
+    std::unique_ptr<char[]> buffer = std::make_unique<char[]>(kBufferSize);
+
+    for (;;)
+    {
+        ssize_t read_size = read(source, buffer.get(), kBufferSize);
+        if (read_size == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            PLOG(LS_WARNING) << "read failed";
+            return false;
+        }
+
+        if (!read_size)
+            return true;
+
+        for (ssize_t written = 0; written < read_size;)
+        {
+            ssize_t result = write(target, buffer.get() + written,
+                                   static_cast<size_t>(read_size - written));
+            if (result == -1)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                PLOG(LS_WARNING) << "write failed";
+                return false;
+            }
+
+            written += result;
+        }
+    }
+}
+
+#endif // defined(OS_LINUX)
+
+} // namespace
+
+bool copyFile(const std::filesystem::path& source, const std::filesystem::path& target,
+              bool overwrite)
+{
+#if defined(OS_MAC)
+    // COPYFILE_CLONE makes a copy-on-write clone on APFS and copies the data otherwise.
+    copyfile_flags_t flags = COPYFILE_ALL | COPYFILE_CLONE;
+    if (!overwrite)
+        flags |= COPYFILE_EXCL;
+
+    if (copyfile(source.c_str(), target.c_str(), nullptr, flags) != 0)
+    {
+        PLOG(LS_WARNING) << "copyfile failed";
+        return false;
+    }
+
+    return true;
+#else
+    ScopedFile source_file(open(source.c_str(), O_RDONLY | O_CLOEXEC));
+    if (!source_file.isValid())
+    {
+        PLOG(LS_WARNING) << "open failed";
+        return false;
+    }
+
+    struct stat source_stat;
+    if (fstat(source_file.get(), &source_stat) != 0)
+    {
+        PLOG(LS_WARNING) << "fstat failed";
+        return false;
+    }
+
+    const int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (overwrite ? O_TRUNC : O_EXCL);
+
+    ScopedFile target_file(open(target.c_str(), flags, source_stat.st_mode & 0777));
+    if (!target_file.isValid())
+    {
+        PLOG(LS_WARNING) << "open failed";
+        return false;
+    }
+
+#if defined(FICLONE)
+    // Btrfs and XFS share the blocks of the files without copying.
+    if (ioctl(target_file.get(), FICLONE, source_file.get()) == 0)
+        return true;
+#endif // defined(FICLONE)
+
+    // The kernel copies the data without reading it into the process. NFS and SMB ask the server
+    // to copy it.
+    off_t left_size = source_stat.st_size;
+    bool copied_any = false;
+
+    while (left_size > 0)
+    {
+        ssize_t result = copy_file_range(source_file.get(), nullptr, target_file.get(), nullptr,
+                                         static_cast<size_t>(left_size), 0);
+        if (result == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            // The files are on different file systems (older kernels) or the file system does
+            // not support it.
+            if (!copied_any && (errno == EXDEV || errno == ENOSYS || errno == EINVAL ||
+                                errno == EOPNOTSUPP))
+            {
+                return copyData(source_file.get(), target_file.get());
+            }
+
+            PLOG(LS_WARNING) << "copy_file_range failed";
+            return false;
+        }
+
+        // The file has become shorter.
+        if (!result)
+            break;
+
+        left_size -= result;
+        copied_any = true;
+    }
+
+    return true;
+#endif
+}
+
+} // namespace base
@@ -0,0 +1,98 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/files/file_util.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+class FileUtilTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        std::error_code ignored_code;
+        directory_ = std::filesystem::temp_directory_path(ignored_code) / "aspia_file_util_test";
+        std::filesystem::remove_all(directory_, ignored_code);
+        ASSERT_TRUE(std::filesystem::create_directories(directory_, ignored_code));
+    }
+
+    void TearDown() override
+    {
+        std::error_code ignored_code;
+        std::filesystem::remove_all(directory_, ignored_code);
+    }
+
+    std::filesystem::path directory_;
+};
+
+} // namespace
+
+TEST_F(FileUtilTest, CopyFile)
+{
+    std::string data;
+    for (int i = 0; i < 3 * 1024 * 1024 + 17; ++i)
+        data.push_back(static_cast<char>(i * 13));
+
+    const std::filesystem::path source = directory_ / "source";
+    const std::filesystem::path target = directory_ / "target";
+
+    ASSERT_TRUE(writeFile(source, data));
+    ASSERT_TRUE(copyFile(source, target, false));
+
+    std::string copied;
+    ASSERT_TRUE(readFile(target, &copied));
+    EXPECT_EQ(copied, data);
+}
+
+TEST_F(FileUtilTest, CopyEmptyFile)
+{
+    const std::filesystem::path source = directory_ / "source";
+    const std::filesystem::path target = directory_ / "target";
+
+    ASSERT_TRUE(writeFile(source, std::string_view()));
+    ASSERT_TRUE(copyFile(source, target, false));
+
+    std::string copied = "x";
+    ASSERT_TRUE(readFile(target, &copied));
+    EXPECT_TRUE(copied.empty());
+}
+
+TEST_F(FileUtilTest, CopyFileOverwrite)
+{
+    const std::filesystem::path source = directory_ / "source";
+    const std::filesystem::path target = directory_ / "target";
+
+    ASSERT_TRUE(writeFile(source, std::string_view("new")));
+    ASSERT_TRUE(writeFile(target, std::string_view("old data")));
+
+    EXPECT_FALSE(copyFile(source, target, false));
+
+    std::string copied;
+    ASSERT_TRUE(readFile(target, &copied));
+    EXPECT_EQ(copied, "old data");
+
+    ASSERT_TRUE(copyFile(source, target, true));
+    ASSERT_TRUE(readFile(target, &copied));
+    EXPECT_EQ(copied, "new");
+}
+
+} // namespace base
@@ -0,0 +1,42 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/files/file_util.h"
+
+#include "base/logging.h"
+
+#include <Windows.h>
+
+namespace base {
+
+bool copyFile(const std::filesystem::path& source, const std::filesystem::path& target,
+              bool overwrite)
+{
+    // CopyFileExW clones the file on ReFS and asks the server to copy it on SMB shares.
+    const DWORD flags = overwrite ? 0 : COPY_FILE_FAIL_IF_EXISTS;
+
+    if (!CopyFileExW(source.c_str(), target.c_str(), nullptr, nullptr, nullptr, flags))
+    {
+        PLOG(LS_WARNING) << "CopyFileExW failed";
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace base
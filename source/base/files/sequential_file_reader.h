@@ -0,0 +1,82 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__FILES__SEQUENTIAL_FILE_READER_H
+#define BASE__FILES__SEQUENTIAL_FILE_READER_H
+
+#include "base/macros_magic.h"
+#include "build/build_config.h"
+
+#if defined(OS_WIN)
+#include "base/win/scoped_object.h"
+#endif // defined(OS_WIN)
+
+#include <filesystem>
+#include <memory>
+
+namespace base {
+
+// Reads a file from the beginning to the end. The system is told that the file is read
+// sequentially, and the next part of the file is read ahead in the background while the caller
+// processes the current one.
+class SequentialFileReader
+{
+public:
+    ~SequentialFileReader();
+
+    // Opens the file for reading. Returns nullptr if the file can not be opened.
+    static std::unique_ptr<SequentialFileReader> open(const std::filesystem::path& file_path);
+
+    // Size of the file when it was opened.
+    uint64_t size() const { return size_; }
+
+    // Number of bytes left to read.
+    uint64_t leftSize() const { return size_ - offset_; }
+
+    // Reads the next |size| bytes of the file. |size| must not be more than leftSize(). Returns
+    // false on error. |read_ahead| is the size of the data the caller is going to read next.
+    bool read(char* buffer, size_t size, size_t read_ahead);
+
+    // Moves to |offset| from the beginning of the file for a part that has to be read again. The
+    // reading continues sequentially from there. Returns false on error.
+    bool seek(uint64_t offset);
+
+private:
+#if defined(OS_WIN)
+    SequentialFileReader(win::ScopedHandle&& file, uint64_t size);
+#else
+    SequentialFileReader(int file, uint64_t size);
+#endif // defined(OS_WIN)
+
+    void readAhead(size_t size);
+
+#if defined(OS_WIN)
+    win::ScopedHandle file_;
+#else
+    int file_;
+#endif // defined(OS_WIN)
+
+    const uint64_t size_;
+    uint64_t offset_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(SequentialFileReader);
+};
+
+} // namespace base
+
+#endif // BASE__FILES__SEQUENTIAL_FILE_READER_H
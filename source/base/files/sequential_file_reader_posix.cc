@@ -0,0 +1,144 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/files/sequential_file_reader.h"
+
+#include "base/logging.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+
+namespace base {
+
+SequentialFileReader::SequentialFileReader(int file, uint64_t size)
+    : file_(file),
+      size_(size)
+{
+#if defined(OS_LINUX)
+    // Doubles the read-ahead window of the kernel for the file.
+    posix_fadvise(file_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#elif defined(OS_MAC)
+    fcntl(file_, F_RDAHEAD, 1);
+#endif
+}
+
+SequentialFileReader::~SequentialFileReader()
+{
+    close(file_);
+}
+
+// static
+std::unique_ptr<SequentialFileReader> SequentialFileReader::open(
+    const std::filesystem::path& file_path)
+{
+    int file;
+
+    do
+    {
+        file = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    while (file == -1 && errno == EINTR);
+
+    if (file == -1)
+    {
+        PLOG(LS_WARNING) << "open failed";
+        return nullptr;
+    }
+
+    struct stat file_stat;
+    if (fstat(file, &file_stat) != 0 || !S_ISREG(file_stat.st_mode))
+    {
+        LOG(LS_WARNING) << "Not a regular file";
+        close(file);
+        return nullptr;
+    }
+
+    return std::unique_ptr<SequentialFileReader>(
+        new SequentialFileReader(file, static_cast<uint64_t>(file_stat.st_size)));
+}
+
+bool SequentialFileReader::read(char* buffer, size_t size, size_t read_ahead)
+{
+    DCHECK_LE(size, leftSize());
+
+    size_t done = 0;
+
+    while (done < size)
+    {
+        ssize_t result = ::read(file_, buffer + done, size - done);
+        if (result == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            PLOG(LS_WARNING) << "read failed";
+            return false;
+        }
+
+        if (result == 0)
+        {
+            LOG(LS_WARNING) << "Unexpected end of file";
+            return false;
+        }
+
+        done += static_cast<size_t>(result);
+    }
+
+    offset_ += size;
+    readAhead(read_ahead);
+    return true;
+}
+
+bool SequentialFileReader::seek(uint64_t offset)
+{
+    DCHECK_LE(offset, size_);
+
+    if (lseek(file_, static_cast<off_t>(offset), SEEK_SET) == -1)
+    {
+        PLOG(LS_WARNING) << "lseek failed";
+        return false;
+    }
+
+    offset_ = offset;
+    return true;
+}
+
+void SequentialFileReader::readAhead(size_t size)
+{
+    size = static_cast<size_t>(std::min(static_cast<uint64_t>(size), leftSize()));
+    if (!size)
+        return;
+
+#if defined(OS_LINUX)
+    // The kernel starts reading the next part into the page cache and returns at once.
+    posix_fadvise(file_, static_cast<off_t>(offset_), static_cast<off_t>(size),
+                  POSIX_FADV_WILLNEED);
+#elif defined(OS_MAC)
+    struct radvisory advisory;
+    advisory.ra_offset = static_cast<off_t>(offset_);
+    advisory.ra_count = static_cast<int>(std::min(size, static_cast<size_t>(INT_MAX)));
+    fcntl(file_, F_RDADVISE, &advisory);
+#endif
+}
+
+} // namespace base
@@ -0,0 +1,113 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/files/sequential_file_reader.h"
+
+#include "base/files/scoped_temp_file.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+namespace base {
+
+namespace {
+
+std::filesystem::path tempFilePath()
+{
+    return std::filesystem::temp_directory_path() / "aspia_sequential_file_reader_test";
+}
+
+std::string testData(size_t size)
+{
+    std::string data(size, 0);
+    for (size_t i = 0; i < size; ++i)
+        data[i] = static_cast<char>(i * 7 + 3);
+    return data;
+}
+
+} // namespace
+
+TEST(SequentialFileReaderTest, ReadInParts)
+{
+    const std::string data = testData(1000 * 1000 + 17);
+
+    ScopedTempFile temp_file(tempFilePath());
+    temp_file.stream().write(data.data(), static_cast<std::streamsize>(data.size()));
+    temp_file.stream().flush();
+
+    std::unique_ptr<SequentialFileReader> reader = SequentialFileReader::open(temp_file.filePath());
+    ASSERT_TRUE(reader);
+    EXPECT_EQ(reader->size(), data.size());
+
+    const size_t kPartSize = 64 * 1024;
+    std::string result;
+
+    while (reader->leftSize())
+    {
+        const size_t size = std::min(static_cast<size_t>(reader->leftSize()), kPartSize);
+        std::string part(size, 0);
+
+        ASSERT_TRUE(reader->read(part.data(), part.size(), kPartSize));
+        result += part;
+    }
+
+    EXPECT_EQ(result, data);
+}
+
+TEST(SequentialFileReaderTest, SeekBack)
+{
+    const std::string data = testData(300 * 1000 + 5);
+
+    ScopedTempFile temp_file(tempFilePath());
+    temp_file.stream().write(data.data(), static_cast<std::streamsize>(data.size()));
+    temp_file.stream().flush();
+
+    std::unique_ptr<SequentialFileReader> reader = SequentialFileReader::open(temp_file.filePath());
+    ASSERT_TRUE(reader);
+
+    std::string part(data.size(), 0);
+    ASSERT_TRUE(reader->read(part.data(), part.size(), 0));
+    EXPECT_EQ(reader->leftSize(), 0u);
+
+    const size_t kOffset = 123457;
+    ASSERT_TRUE(reader->seek(kOffset));
+    EXPECT_EQ(reader->leftSize(), data.size() - kOffset);
+
+    part.resize(1000);
+    ASSERT_TRUE(reader->read(part.data(), part.size(), 0));
+    EXPECT_EQ(part, data.substr(kOffset, part.size()));
+    EXPECT_EQ(reader->leftSize(), data.size() - kOffset - part.size());
+}
+
+TEST(SequentialFileReaderTest, EmptyFile)
+{
+    ScopedTempFile temp_file(tempFilePath());
+
+    std::unique_ptr<SequentialFileReader> reader = SequentialFileReader::open(temp_file.filePath());
+    ASSERT_TRUE(reader);
+    EXPECT_EQ(reader->size(), 0u);
+    EXPECT_EQ(reader->leftSize(), 0u);
+}
+
+TEST(SequentialFileReaderTest, MissingFile)
+{
+    EXPECT_FALSE(SequentialFileReader::open(tempFilePath() / "missing"));
+}
+
+} // namespace base
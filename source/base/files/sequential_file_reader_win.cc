@@ -0,0 +1,121 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/files/sequential_file_reader.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace base {
+
+SequentialFileReader::SequentialFileReader(win::ScopedHandle&& file, uint64_t size)
+    : file_(std::move(file)),
+      size_(size)
+{
+    // Nothing
+}
+
+SequentialFileReader::~SequentialFileReader() = default;
+
+// static
+std::unique_ptr<SequentialFileReader> SequentialFileReader::open(
+    const std::filesystem::path& file_path)
+{
+    // With FILE_FLAG_SEQUENTIAL_SCAN the cache manager reads ahead larger parts of the file and
+    // drops the pages already read sooner.
+    win::ScopedHandle file(CreateFileW(file_path.c_str(),
+                                       GENERIC_READ,
+                                       FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                       nullptr,
+                                       OPEN_EXISTING,
+                                       FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                                       nullptr));
+    if (!file.isValid())
+    {
+        PLOG(LS_WARNING) << "CreateFileW failed";
+        return nullptr;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        PLOG(LS_WARNING) << "GetFileSizeEx failed";
+        return nullptr;
+    }
+
+    return std::unique_ptr<SequentialFileReader>(
+        new SequentialFileReader(std::move(file), static_cast<uint64_t>(size.QuadPart)));
+}
+
+bool SequentialFileReader::read(char* buffer, size_t size, size_t read_ahead)
+{
+    DCHECK_LE(size, leftSize());
+
+    size_t done = 0;
+
+    while (done < size)
+    {
+        const DWORD chunk_size = static_cast<DWORD>(
+            std::min(size - done, static_cast<size_t>(std::numeric_limits<DWORD>::max())));
+        DWORD read_bytes = 0;
+
+        if (!ReadFile(file_, buffer + done, chunk_size, &read_bytes, nullptr))
+        {
+            PLOG(LS_WARNING) << "ReadFile failed";
+            return false;
+        }
+
+        if (!read_bytes)
+        {
+            LOG(LS_WARNING) << "Unexpected end of file";
+            return false;
+        }
+
+        done += read_bytes;
+    }
+
+    offset_ += size;
+    readAhead(read_ahead);
+    return true;
+}
+
+bool SequentialFileReader::seek(uint64_t offset)
+{
+    DCHECK_LE(offset, size_);
+
+    LARGE_INTEGER distance;
+    distance.QuadPart = static_cast<LONGLONG>(offset);
+
+    if (!SetFilePointerEx(file_, distance, nullptr, FILE_BEGIN))
+    {
+        PLOG(LS_WARNING) << "SetFilePointerEx failed";
+        return false;
+    }
+
+    offset_ = offset;
+    return true;
+}
+
+void SequentialFileReader::readAhead(size_t /* size */)
+{
+    // The cache manager reads ahead by itself for the files opened with FILE_FLAG_SEQUENTIAL_SCAN.
+}
+
+} // namespace base
@@ -0,0 +1,148 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/files/sequential_file_writer.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+
+#include <algorithm>
+
+namespace base {
+
+namespace {
+
+// The data is written to the disk in blocks of this size.
+const size_t kBlockSize = 1024 * 1024; // 1 MB
+
+// If more data waits for the disk, write() blocks until the disk catches up.
+const size_t kMaxQueuedSize = 16 * 1024 * 1024; // 16 MB
+
+} // namespace
+
+// static
+std::unique_ptr<SequentialFileWriter> SequentialFileWriter::create(
+    const std::filesystem::path& file_path, std::shared_ptr<TaskRunner> write_task_runner)
+{
+    return openFile(file_path, true, std::move(write_task_runner));
+}
+
+// static
+std::unique_ptr<SequentialFileWriter> SequentialFileWriter::open(
+    const std::filesystem::path& file_path, std::shared_ptr<TaskRunner> write_task_runner)
+{
+    return openFile(file_path, false, std::move(write_task_runner));
+}
+
+void SequentialFileWriter::preallocate(uint64_t size)
+{
+    DCHECK(!closed_);
+
+    // Only the metadata of the file is changed, this does not wait for the disk.
+    preallocateFile(size);
+}
+
+bool SequentialFileWriter::write(const char* data, size_t size)
+{
+    DCHECK(!closed_);
+
+    while (size)
+    {
+        if (buffer_.capacity() < kBlockSize)
+            buffer_.reserve(kBlockSize);
+
+        const size_t part_size = std::min(size, kBlockSize - buffer_.size());
+        buffer_.insert(buffer_.end(), data, data + part_size);
+
+        data += part_size;
+        size -= part_size;
+
+        if (buffer_.size() == kBlockSize)
+            postBuffer();
+    }
+
+    return !failed_;
+}
+
+bool SequentialFileWriter::skip(uint64_t size)
+{
+    DCHECK(!closed_);
+
+    postBuffer();
+    buffer_offset_ += size;
+
+    return !failed_;
+}
+
+bool SequentialFileWriter::close()
+{
+    DCHECK(!closed_);
+
+    postBuffer();
+    waitQueued();
+
+    closed_ = true;
+
+    // An existing file could be longer.
+    const bool truncated = failed_ || truncateFile(buffer_offset_);
+    const bool closed = closeFile();
+
+    return truncated && closed && !failed_;
+}
+
+void SequentialFileWriter::postBuffer()
+{
+    if (buffer_.empty())
+        return;
+
+    {
+        std::unique_lock lock(queued_lock_);
+        queued_condition_.wait(lock, [this]()
+        {
+            return !queued_size_ || queued_size_ + buffer_.size() <= kMaxQueuedSize;
+        });
+
+        queued_size_ += buffer_.size();
+    }
+
+    std::shared_ptr<std::vector<char>> buffer =
+        std::make_shared<std::vector<char>>(std::move(buffer_));
+    buffer_ = std::vector<char>();
+
+    const uint64_t offset = buffer_offset_;
+    buffer_offset_ += buffer->size();
+
+    write_task_runner_->postTask([this, buffer, offset]()
+    {
+        // After an error the rest of the data is dropped.
+        if (!failed_ && !writeToFile(buffer->data(), buffer->size(), offset))
+            failed_ = true;
+
+        std::scoped_lock lock(queued_lock_);
+        queued_size_ -= buffer->size();
+        queued_condition_.notify_all();
+    });
+}
+
+void SequentialFileWriter::waitQueued()
+{
+    std::unique_lock lock(queued_lock_);
+    queued_condition_.wait(lock, [this]() { return !queued_size_; });
+}
+
+} // namespace base
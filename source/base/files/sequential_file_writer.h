@@ -0,0 +1,121 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__FILES__SEQUENTIAL_FILE_WRITER_H
+#define BASE__FILES__SEQUENTIAL_FILE_WRITER_H
+
+#include "base/macros_magic.h"
+#include "build/build_config.h"
+
+#if defined(OS_WIN)
+#include "base/win/scoped_object.h"
+#endif // defined(OS_WIN)
+
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace base {
+
+class TaskRunner;
+
+// Writes a file from the beginning to the end. The data is collected into large blocks that are
+// written on |write_task_runner|, so the caller does not wait for the disk. A write error is
+// reported by the next call to write() or close(). Parts of an existing file can be skipped, they
+// keep their contents.
+class SequentialFileWriter
+{
+public:
+    // Waits for the queued blocks and closes the file if close() was not called.
+    ~SequentialFileWriter();
+
+    // Creates the file or truncates the existing one. Returns nullptr if the file can not be
+    // opened for writing.
+    static std::unique_ptr<SequentialFileWriter> create(
+        const std::filesystem::path& file_path, std::shared_ptr<TaskRunner> write_task_runner);
+
+    // Opens the existing file without truncating it or creates a new one. Returns nullptr if the
+    // file can not be opened for writing.
+    static std::unique_ptr<SequentialFileWriter> open(
+        const std::filesystem::path& file_path, std::shared_ptr<TaskRunner> write_task_runner);
+
+    // Reserves the disk space for the file of |size| bytes. The file system can then place the
+    // file in one piece. Errors are ignored, the space is allocated by the writes then.
+    void preallocate(uint64_t size);
+
+    // Queues the data for writing. Blocks only if too much data is waiting for the disk. Returns
+    // false if an earlier write has failed.
+    bool write(const char* data, size_t size);
+
+    // Leaves the next |size| bytes of the file as they are. Returns false if an earlier write has
+    // failed.
+    bool skip(uint64_t size);
+
+    // Writes the rest of the data, truncates the file to the written size and closes it. Returns
+    // false if any write has failed.
+    bool close();
+
+private:
+#if defined(OS_WIN)
+    SequentialFileWriter(win::ScopedHandle&& file, std::shared_ptr<TaskRunner> write_task_runner);
+#else
+    SequentialFileWriter(int file, std::shared_ptr<TaskRunner> write_task_runner);
+#endif // defined(OS_WIN)
+
+    void postBuffer();
+    void waitQueued();
+
+    // Implemented for each platform.
+    static std::unique_ptr<SequentialFileWriter> openFile(
+        const std::filesystem::path& file_path,
+        bool truncate,
+        std::shared_ptr<TaskRunner> write_task_runner);
+    bool writeToFile(const char* data, size_t size, uint64_t offset);
+    void preallocateFile(uint64_t size);
+    bool truncateFile(uint64_t size);
+    bool closeFile();
+
+#if defined(OS_WIN)
+    win::ScopedHandle file_;
+#else
+    int file_;
+#endif // defined(OS_WIN)
+
+    std::shared_ptr<TaskRunner> write_task_runner_;
+    std::vector<char> buffer_;
+
+    // Position of |buffer_| in the file.
+    uint64_t buffer_offset_ = 0;
+
+    bool closed_ = false;
+
+    std::mutex queued_lock_;
+    std::condition_variable queued_condition_;
+    size_t queued_size_ = 0;
+
+    std::atomic_bool failed_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(SequentialFileWriter);
+};
+
+} // namespace base
+
+#endif // BASE__FILES__SEQUENTIAL_FILE_WRITER_H
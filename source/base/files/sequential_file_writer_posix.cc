@@ -0,0 +1,151 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/files/sequential_file_writer.h"
+
+#include "base/logging.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+
+namespace base {
+
+SequentialFileWriter::SequentialFileWriter(
+    int file, std::shared_ptr<TaskRunner> write_task_runner)
+    : file_(file),
+      write_task_runner_(std::move(write_task_runner))
+{
+    DCHECK(write_task_runner_);
+}
+
+SequentialFileWriter::~SequentialFileWriter()
+{
+    waitQueued();
+
+    if (!closed_)
+        closeFile();
+}
+
+// static
+// static
+std::unique_ptr<SequentialFileWriter> SequentialFileWriter::openFile(
+    const std::filesystem::path& file_path,
+    bool truncate,
+    std::shared_ptr<TaskRunner> write_task_runner)
+{
+    const int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+    int file;
+
+    do
+    {
+        file = ::open(file_path.c_str(), flags, 0666);
+    }
+    while (file == -1 && errno == EINTR);
+
+    if (file == -1)
+    {
+        PLOG(LS_WARNING) << "open failed";
+        return nullptr;
+    }
+
+    return std::unique_ptr<SequentialFileWriter>(
+        new SequentialFileWriter(file, std::move(write_task_runner)));
+}
+
+bool SequentialFileWriter::writeToFile(const char* data, size_t size, uint64_t offset)
+{
+    while (size)
+    {
+        ssize_t result = ::pwrite(file_, data, size, static_cast<off_t>(offset));
+        if (result == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            PLOG(LS_WARNING) << "pwrite failed";
+            return false;
+        }
+
+        data += result;
+        size -= static_cast<size_t>(result);
+        offset += static_cast<uint64_t>(result);
+    }
+
+    return true;
+}
+
+void SequentialFileWriter::preallocateFile(uint64_t size)
+{
+    if (!size)
+        return;
+
+#if defined(OS_LINUX)
+    // The size of the file is not changed, an incomplete file does not look complete.
+    if (fallocate(file_, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size)) != 0)
+        PLOG(LS_INFO) << "fallocate failed";
+#elif defined(OS_MAC)
+    fstore_t store;
+    memset(&store, 0, sizeof(store));
+    store.fst_flags = F_ALLOCATECONTIG;
+    store.fst_posmode = F_PEOFPOSMODE;
+    store.fst_length = static_cast<off_t>(size);
+
+    if (fcntl(file_, F_PREALLOCATE, &store) == -1)
+    {
+        // There is no contiguous space, any space is fine too.
+        store.fst_flags = F_ALLOCATEALL;
+        if (fcntl(file_, F_PREALLOCATE, &store) == -1)
+            PLOG(LS_INFO) << "F_PREALLOCATE failed";
+    }
+#endif
+}
+
+bool SequentialFileWriter::truncateFile(uint64_t size)
+{
+    int result;
+
+    do
+    {
+        result = ftruncate(file_, static_cast<off_t>(size));
+    }
+    while (result == -1 && errno == EINTR);
+
+    if (result == -1)
+    {
+        PLOG(LS_WARNING) << "ftruncate failed";
+        return false;
+    }
+
+    return true;
+}
+
+bool SequentialFileWriter::closeFile()
+{
+    if (::close(file_) != 0)
+    {
+        PLOG(LS_WARNING) << "close failed";
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace base
@@ -0,0 +1,145 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/files/sequential_file_writer.h"
+
+#include "base/files/file_util.h"
+#include "base/threading/thread.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+namespace base {
+
+namespace {
+
+class SequentialFileWriterTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        thread_.start(MessageLoop::Type::DEFAULT);
+        file_path_ = std::filesystem::temp_directory_path() / "aspia_sequential_file_writer_test";
+    }
+
+    void TearDown() override
+    {
+        thread_.stop();
+
+        std::error_code ignored_code;
+        std::filesystem::remove(file_path_, ignored_code);
+    }
+
+    Thread thread_;
+    std::filesystem::path file_path_;
+};
+
+std::string testData(size_t size)
+{
+    std::string data(size, 0);
+    for (size_t i = 0; i < size; ++i)
+        data[i] = static_cast<char>(i * 13 + 5);
+    return data;
+}
+
+} // namespace
+
+TEST_F(SequentialFileWriterTest, WriteInParts)
+{
+    // More than the write queue holds, so the writes also wait for the disk.
+    const std::string data = testData(20 * 1024 * 1024 + 11);
+
+    std::unique_ptr<SequentialFileWriter> writer =
+        SequentialFileWriter::create(file_path_, thread_.taskRunner());
+    ASSERT_TRUE(writer);
+
+    writer->preallocate(data.size());
+
+    const size_t kPartSize = 64 * 1024 + 3;
+    for (size_t offset = 0; offset < data.size(); offset += kPartSize)
+    {
+        const size_t size = std::min(kPartSize, data.size() - offset);
+        ASSERT_TRUE(writer->write(data.data() + offset, size));
+    }
+
+    ASSERT_TRUE(writer->close());
+
+    std::string result;
+    ASSERT_TRUE(readFile(file_path_, &result));
+    EXPECT_EQ(result, data);
+}
+
+TEST_F(SequentialFileWriterTest, TruncateExisting)
+{
+    ASSERT_TRUE(writeFile(file_path_, std::string_view("old contents")));
+
+    std::unique_ptr<SequentialFileWriter> writer =
+        SequentialFileWriter::create(file_path_, thread_.taskRunner());
+    ASSERT_TRUE(writer);
+    ASSERT_TRUE(writer->write("new", 3));
+    ASSERT_TRUE(writer->close());
+
+    std::string result;
+    ASSERT_TRUE(readFile(file_path_, &result));
+    EXPECT_EQ(result, "new");
+}
+
+TEST_F(SequentialFileWriterTest, SkipExisting)
+{
+    const std::string old_data = testData(3 * 1024 * 1024 + 100);
+    ASSERT_TRUE(writeFile(file_path_, old_data));
+
+    std::string expected = old_data;
+    const std::string new_data(5000, 'x');
+
+    std::unique_ptr<SequentialFileWriter> writer =
+        SequentialFileWriter::open(file_path_, thread_.taskRunner());
+    ASSERT_TRUE(writer);
+
+    ASSERT_TRUE(writer->write(new_data.data(), new_data.size()));
+    expected.replace(0, new_data.size(), new_data);
+
+    ASSERT_TRUE(writer->skip(2 * 1024 * 1024));
+
+    ASSERT_TRUE(writer->write(new_data.data(), new_data.size()));
+    expected.replace(new_data.size() + 2 * 1024 * 1024, new_data.size(), new_data);
+    expected.resize(2 * new_data.size() + 2 * 1024 * 1024);
+
+    // The rest of the old file is cut off.
+    ASSERT_TRUE(writer->close());
+
+    std::string result;
+    ASSERT_TRUE(readFile(file_path_, &result));
+    EXPECT_EQ(result, expected);
+}
+
+TEST_F(SequentialFileWriterTest, DestroyWithoutClose)
+{
+    std::unique_ptr<SequentialFileWriter> writer =
+        SequentialFileWriter::create(file_path_, thread_.taskRunner());
+    ASSERT_TRUE(writer);
+
+    const std::string data = testData(3 * 1024 * 1024);
+    ASSERT_TRUE(writer->write(data.data(), data.size()));
+
+    // The queued blocks are written before the writer is destroyed.
+    writer.reset();
+}
+
+} // namespace base
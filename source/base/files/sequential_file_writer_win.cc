@@ -0,0 +1,140 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/files/sequential_file_writer.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace base {
+
+SequentialFileWriter::SequentialFileWriter(
+    win::ScopedHandle&& file, std::shared_ptr<TaskRunner> write_task_runner)
+    : file_(std::move(file)),
+      write_task_runner_(std::move(write_task_runner))
+{
+    DCHECK(write_task_runner_);
+}
+
+SequentialFileWriter::~SequentialFileWriter()
+{
+    waitQueued();
+
+    if (!closed_)
+        closeFile();
+}
+
+// static
+// static
+std::unique_ptr<SequentialFileWriter> SequentialFileWriter::openFile(
+    const std::filesystem::path& file_path,
+    bool truncate,
+    std::shared_ptr<TaskRunner> write_task_runner)
+{
+    win::ScopedHandle file(CreateFileW(file_path.c_str(),
+                                       GENERIC_WRITE,
+                                       FILE_SHARE_READ,
+                                       nullptr,
+                                       truncate ? CREATE_ALWAYS : OPEN_ALWAYS,
+                                       FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                                       nullptr));
+    if (!file.isValid())
+    {
+        PLOG(LS_WARNING) << "CreateFileW failed";
+        return nullptr;
+    }
+
+    return std::unique_ptr<SequentialFileWriter>(
+        new SequentialFileWriter(std::move(file), std::move(write_task_runner)));
+}
+
+bool SequentialFileWriter::writeToFile(const char* data, size_t size, uint64_t offset)
+{
+    while (size)
+    {
+        const DWORD chunk_size = static_cast<DWORD>(
+            std::min(size, static_cast<size_t>(std::numeric_limits<DWORD>::max())));
+        DWORD written = 0;
+
+        // For a synchronous handle the offset of the write is passed in OVERLAPPED.
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+        if (!WriteFile(file_, data, chunk_size, &written, &overlapped))
+        {
+            PLOG(LS_WARNING) << "WriteFile failed";
+            return false;
+        }
+
+        data += written;
+        size -= written;
+        offset += written;
+    }
+
+    return true;
+}
+
+void SequentialFileWriter::preallocateFile(uint64_t size)
+{
+    if (!size)
+        return;
+
+    // Only the space is reserved, the size of the file stays the same. SetFileValidData is not
+    // used: it needs SE_MANAGE_VOLUME_NAME and exposes old disk contents.
+    FILE_ALLOCATION_INFO allocation_info;
+    allocation_info.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+
+    if (!SetFileInformationByHandle(
+            file_, FileAllocationInfo, &allocation_info, sizeof(allocation_info)))
+    {
+        PLOG(LS_INFO) << "SetFileInformationByHandle failed";
+    }
+}
+
+bool SequentialFileWriter::truncateFile(uint64_t size)
+{
+    FILE_END_OF_FILE_INFO end_of_file_info;
+    end_of_file_info.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+
+    if (!SetFileInformationByHandle(
+            file_, FileEndOfFileInfo, &end_of_file_info, sizeof(end_of_file_info)))
+    {
+        PLOG(LS_WARNING) << "SetFileInformationByHandle failed";
+        return false;
+    }
+
+    return true;
+}
+
+bool SequentialFileWriter::closeFile()
+{
+    if (!CloseHandle(file_.release()))
+    {
+        PLOG(LS_WARNING) << "CloseHandle failed";
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace base
@@ -0,0 +1,139 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/hash64.h"
+
+#include "build/build_config.h"
+
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+uint64_t rotateLeft(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// The input is read in little-endian byte order on all platforms.
+template <typename T>
+T readLE(const uint8_t* data)
+{
+    T value;
+#if defined(ARCH_CPU_LITTLE_ENDIAN)
+    memcpy(&value, data, sizeof(value));
+#else
+    value = 0;
+    for (size_t i = 0; i < sizeof(value); ++i)
+        value |= static_cast<T>(data[i]) << (i * 8);
+#endif
+    return value;
+}
+
+uint64_t round(uint64_t accumulator, uint64_t input)
+{
+    accumulator += input * kPrime2;
+    accumulator = rotateLeft(accumulator, 31);
+    return accumulator * kPrime1;
+}
+
+uint64_t mergeRound(uint64_t accumulator, uint64_t value)
+{
+    accumulator ^= round(0, value);
+    return accumulator * kPrime1 + kPrime4;
+}
+
+} // namespace
+
+uint64_t hash64(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    const uint8_t* end = bytes + size;
+    uint64_t result;
+
+    if (size >= 32)
+    {
+        const uint8_t* limit = end - 32;
+
+        uint64_t v1 = seed + kPrime1 + kPrime2;
+        uint64_t v2 = seed + kPrime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - kPrime1;
+
+        do
+        {
+            v1 = round(v1, readLE<uint64_t>(bytes));
+            v2 = round(v2, readLE<uint64_t>(bytes + 8));
+            v3 = round(v3, readLE<uint64_t>(bytes + 16));
+            v4 = round(v4, readLE<uint64_t>(bytes + 24));
+            bytes += 32;
+        }
+        while (bytes <= limit);
+
+        result = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+        result = mergeRound(result, v1);
+        result = mergeRound(result, v2);
+        result = mergeRound(result, v3);
+        result = mergeRound(result, v4);
+    }
+    else
+    {
+        result = seed + kPrime5;
+    }
+
+    result += static_cast<uint64_t>(size);
+
+    while (bytes + 8 <= end)
+    {
+        result ^= round(0, readLE<uint64_t>(bytes));
+        result = rotateLeft(result, 27) * kPrime1 + kPrime4;
+        bytes += 8;
+    }
+
+    if (bytes + 4 <= end)
+    {
+        result ^= static_cast<uint64_t>(readLE<uint32_t>(bytes)) * kPrime1;
+        result = rotateLeft(result, 23) * kPrime2 + kPrime3;
+        bytes += 4;
+    }
+
+    while (bytes < end)
+    {
+        result ^= static_cast<uint64_t>(*bytes) * kPrime5;
+        result = rotateLeft(result, 11) * kPrime1;
+        ++bytes;
+    }
+
+    // Final mix of all bits.
+    result ^= result >> 33;
+    result *= kPrime2;
+    result ^= result >> 29;
+    result *= kPrime3;
+    result ^= result >> 32;
+
+    return result;
+}
+
+} // namespace base
@@ -0,0 +1,34 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__HASH64_H
+#define BASE__HASH64_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace base {
+
+// Fast non-cryptographic 64-bit hash (XXH64 algorithm). The result does not depend on the
+// platform, so it can be stored or sent to the peer. Must not be used where an attacker can choose
+// the data to cause collisions.
+uint64_t hash64(const void* data, size_t size, uint64_t seed = 0);
+
+} // namespace base
+
+#endif // BASE__HASH64_H
@@ -0,0 +1,63 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/hash64.h"
+
+#include <cstring>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+// Reference values of XXH64 algorithm.
+TEST(Hash64Test, ReferenceValues)
+{
+    EXPECT_EQ(0xEF46DB3751D8E999ULL, hash64("", 0));
+    EXPECT_EQ(0xD24EC4F1A98C6E5BULL, hash64("a", 1));
+    EXPECT_EQ(0x44BC2CF5AD770999ULL, hash64("abc", 3));
+
+    const char kText[] = "Nobody inspects the spammish repetition";
+    EXPECT_EQ(0xFBCEA83C8A378BF1ULL, hash64(kText, strlen(kText)));
+}
+
+TEST(Hash64Test, Seed)
+{
+    EXPECT_NE(hash64("abc", 3, 0), hash64("abc", 3, 1));
+    EXPECT_EQ(hash64("abc", 3, 1), hash64("abc", 3, 1));
+}
+
+TEST(Hash64Test, Distinct)
+{
+    std::vector<uint8_t> data(256);
+    std::set<uint64_t> hashes;
+
+    // Each size and each changed byte gives a different hash.
+    for (size_t size = 0; size <= data.size(); ++size)
+        EXPECT_TRUE(hashes.insert(hash64(data.data(), size)).second);
+
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = 1;
+        EXPECT_TRUE(hashes.insert(hash64(data.data(), data.size())).second);
+        data[i] = 0;
+    }
+}
+
+} // namespace base
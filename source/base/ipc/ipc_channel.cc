@@ -21,6 +21,8 @@
 #include "base/location.h"
 #include "base/logging.h"
 #include "base/ipc/ipc_channel_proxy.h"
+#include "base/ipc/ipc_ring_buffer.h"
+#include "base/ipc/shared_memory.h"
 #include "base/message_loop/message_loop.h"
 #include "base/message_loop/message_pump_asio.h"
 #include "base/strings/unicode.h"
@@ -28,6 +30,7 @@
 #include <asio/read.hpp>
 #include <asio/write.hpp>
 
+#include <cstring>
 #include <functional>
 
 #if defined(OS_WIN)
@@ -41,6 +44,24 @@ namespace {
 
 const uint32_t kMaxMessageSize = 16 * 1024 * 1024; // 16MB
 
+// The high bits of the size word define the type of the frame.
+const uint32_t kSharedMemoryFlag = 0x80000000; // The frame contains a descriptor of the message.
+const uint32_t kRingCreatedFlag = 0x40000000; // The frame contains an ID of the shared memory.
+const uint32_t kSizeMask = 0x3FFFFFFF;
+
+const size_t kRingSize = 4 * 1024 * 1024; // 4MB
+const size_t kMinRingMessageSize = 16 * 1024; // 16kB
+
+// Size of the descriptor in the frame: position (8 bytes) and size (4 bytes).
+const uint32_t kDescriptorSize = sizeof(uint64_t) + sizeof(uint32_t);
+
+template <typename T>
+void appendValue(ByteArray* buffer, T value)
+{
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(&value);
+    buffer->insert(buffer->end(), data, data + sizeof(value));
+}
+
 #if defined(OS_WIN)
 
 const char16_t kPipeNamePrefix[] = u"\\\\.\\pipe\\aspia.";
@@ -262,7 +283,7 @@ void IpcChannel::send(ByteArray&& buffer)
     const bool schedule_write = write_queue_.empty();
 
     // Add the buffer to the queue for sending.
-    write_queue_.emplace(std::move(buffer));
+    write_queue_.emplace_back(std::move(buffer));
 
     if (schedule_write)
         doWrite();
@@ -332,15 +353,63 @@ void IpcChannel::onErrorOccurred(const Location& location, const std::error_code
 
 void IpcChannel::doWrite()
 {
-    write_size_ = static_cast<uint32_t>(write_queue_.front().size());
+    DCHECK(!write_queue_.empty());
+
+    write_header_.clear();
+    write_buffers_.clear();
+    write_count_ = 0;
+    write_size_ = 0;
 
-    if (!write_size_ || write_size_ > kMaxMessageSize)
+    // Each message in the batch has a header (the size word or the ring frames) and the body if
+    // it is sent through the pipe. The buffers are added after all the headers are collected
+    // because |write_header_| can be reallocated.
+    struct Frame
     {
-        onErrorOccurred(FROM_HERE, asio::error::message_size);
-        return;
+        size_t header_offset;
+        size_t header_size;
+        bool in_ring;
+    };
+
+    std::vector<Frame> frames;
+
+    // All currently queued messages are gathered into one write until the limit is reached. The
+    // first message is always written entirely.
+    while (write_count_ < write_queue_.size() &&
+           (!write_count_ || write_size_ < write_batch_limit_))
+    {
+        const ByteArray& buffer = write_queue_[write_count_];
+        const uint32_t size = static_cast<uint32_t>(buffer.size());
+
+        if (!size || size > kMaxMessageSize)
+        {
+            onErrorOccurred(FROM_HERE, asio::error::message_size);
+            return;
+        }
+
+        const size_t header_offset = write_header_.size();
+
+        // If the message is not placed in the ring, it is sent through the pipe.
+        const bool in_ring = size >= kMinRingMessageSize && writeToRing(buffer);
+        if (!in_ring)
+            appendValue(&write_header_, size);
+
+        const size_t header_size = write_header_.size() - header_offset;
+
+        frames.push_back({ header_offset, header_size, in_ring });
+        write_size_ += header_size + (in_ring ? 0 : size);
+        ++write_count_;
+    }
+
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        const Frame& frame = frames[i];
+
+        write_buffers_.emplace_back(write_header_.data() + frame.header_offset, frame.header_size);
+        if (!frame.in_ring)
+            write_buffers_.emplace_back(write_queue_[i].data(), write_queue_[i].size());
     }
 
-    asio::async_write(stream_, asio::buffer(&write_size_, sizeof(write_size_)),
+    asio::async_write(stream_, write_buffers_,
         [this](const std::error_code& error_code, size_t bytes_transferred)
     {
         if (error_code)
@@ -349,34 +418,61 @@ void IpcChannel::doWrite()
             return;
         }
 
-        DCHECK_EQ(bytes_transferred, sizeof(write_size_));
-        DCHECK(!write_queue_.empty());
+        DCHECK_EQ(bytes_transferred, write_size_);
+        DCHECK_LE(write_count_, write_queue_.size());
 
-        const ByteArray& buffer = write_queue_.front();
+        // Delete the sent messages from the queue.
+        write_queue_.erase(write_queue_.begin(), write_queue_.begin() + write_count_);
+        write_count_ = 0;
 
-        // Send the buffer to the recipient.
-        asio::async_write(stream_, asio::buffer(buffer.data(), buffer.size()),
-            [this](const std::error_code& error_code, size_t bytes_transferred)
+        // If the queue is not empty, then we send the following messages.
+        if (write_queue_.empty() && !proxy_->reloadWriteQueue(&write_queue_))
+            return;
+
+        doWrite();
+    });
+}
+
+void IpcChannel::setWriteBatchLimit(size_t bytes)
+{
+    DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+    write_batch_limit_ = bytes;
+}
+
+bool IpcChannel::writeToRing(const ByteArray& buffer)
+{
+    if (!write_ring_)
+    {
+        if (write_ring_failed_)
+            return false;
+
+        write_memory_ = SharedMemory::create(SharedMemory::Mode::READ_WRITE, kRingSize);
+        if (!write_memory_)
         {
-            if (error_code)
-            {
-                onErrorOccurred(FROM_HERE, error_code);
-                return;
-            }
+            LOG(LS_WARNING) << "Unable to create shared memory for the ring. Large messages will "
+                            << "be sent through the pipe";
+            write_ring_failed_ = true;
+            return false;
+        }
 
-            DCHECK_EQ(bytes_transferred, write_size_);
-            DCHECK(!write_queue_.empty());
+        write_ring_ = std::make_unique<IpcRingBuffer>(write_memory_->data(), kRingSize);
 
-            // Delete the sent message from the queue.
-            write_queue_.pop();
+        // The ring is announced before its first message.
+        const int32_t ring_id = write_memory_->id();
+        appendValue(&write_header_, kRingCreatedFlag | static_cast<uint32_t>(sizeof(ring_id)));
+        appendValue(&write_header_, ring_id);
+    }
 
-            // If the queue is not empty, then we send the following message.
-            if (write_queue_.empty() && !proxy_->reloadWriteQueue(&write_queue_))
-                return;
+    IpcRingBuffer::Descriptor descriptor;
 
-            doWrite();
-        });
-    });
+    // If the reader has not yet released enough space, the message goes through the pipe.
+    if (!write_ring_->write(buffer.data(), buffer.size(), &descriptor))
+        return false;
+
+    appendValue(&write_header_, kSharedMemoryFlag | kDescriptorSize);
+    appendValue(&write_header_, descriptor.end);
+    appendValue(&write_header_, descriptor.size);
+    return true;
 }
 
 void IpcChannel::doReadMessage()
@@ -392,7 +488,30 @@ void IpcChannel::doReadMessage()
 
         DCHECK_EQ(bytes_transferred, sizeof(read_size_));
 
-        if (!read_size_ || read_size_ > kMaxMessageSize)
+        const uint32_t flags = read_size_ & ~kSizeMask;
+        read_size_ &= kSizeMask;
+
+        bool is_valid_size;
+        switch (flags)
+        {
+            case 0:
+                is_valid_size = read_size_ && read_size_ <= kMaxMessageSize;
+                break;
+
+            case kSharedMemoryFlag:
+                is_valid_size = read_size_ == kDescriptorSize;
+                break;
+
+            case kRingCreatedFlag:
+                is_valid_size = read_size_ == sizeof(int32_t);
+                break;
+
+            default:
+                is_valid_size = false;
+                break;
+        }
+
+        if (!is_valid_size)
         {
             onErrorOccurred(FROM_HERE, asio::error::message_size);
             return;
@@ -407,7 +526,7 @@ void IpcChannel::doReadMessage()
         read_buffer_.resize(read_size_);
 
         asio::async_read(stream_, asio::buffer(read_buffer_.data(), read_buffer_.size()),
-            [this](const std::error_code& error_code, size_t bytes_transferred)
+            [this, flags](const std::error_code& error_code, size_t bytes_transferred)
         {
             if (error_code)
             {
@@ -417,6 +536,28 @@ void IpcChannel::doReadMessage()
 
             DCHECK_EQ(bytes_transferred, read_size_);
 
+            if (flags == kRingCreatedFlag)
+            {
+                read_size_ = 0;
+
+                if (!openRing())
+                {
+                    onErrorOccurred(FROM_HERE, asio::error::invalid_argument);
+                    return;
+                }
+
+                // When paused, reading continues after resume().
+                if (!is_paused_)
+                    doReadMessage();
+                return;
+            }
+
+            if (flags == kSharedMemoryFlag && !readFromRing())
+            {
+                onErrorOccurred(FROM_HERE, asio::error::invalid_argument);
+                return;
+            }
+
             if (is_paused_)
                 return;
 
@@ -432,6 +573,54 @@ void IpcChannel::doReadMessage()
     });
 }
 
+bool IpcChannel::openRing()
+{
+    if (read_ring_)
+    {
+        LOG(LS_ERROR) << "Ring is already opened";
+        return false;
+    }
+
+    int32_t ring_id;
+    memcpy(&ring_id, read_buffer_.data(), sizeof(ring_id));
+
+    read_memory_ = SharedMemory::open(SharedMemory::Mode::READ_WRITE, ring_id);
+    if (!read_memory_)
+    {
+        LOG(LS_ERROR) << "Unable to open shared memory of the ring: " << ring_id;
+        return false;
+    }
+
+    read_ring_ = std::make_unique<IpcRingBuffer>(read_memory_->data(), kRingSize);
+    return true;
+}
+
+bool IpcChannel::readFromRing()
+{
+    if (!read_ring_)
+    {
+        LOG(LS_ERROR) << "Message descriptor received without a ring";
+        return false;
+    }
+
+    IpcRingBuffer::Descriptor descriptor;
+    memcpy(&descriptor.end, read_buffer_.data(), sizeof(descriptor.end));
+    memcpy(&descriptor.size, read_buffer_.data() + sizeof(descriptor.end),
+           sizeof(descriptor.size));
+
+    if (!descriptor.size || descriptor.size > kMaxMessageSize)
+    {
+        LOG(LS_ERROR) << "Invalid message size in the descriptor: " << descriptor.size;
+        return false;
+    }
+
+    if (!read_ring_->read(descriptor, &read_buffer_))
+        return false;
+
+    read_size_ = descriptor.size;
+    return true;
+}
+
 void IpcChannel::onMessageReceived()
 {
     if (listener_)
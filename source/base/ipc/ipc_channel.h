@@ -31,13 +31,17 @@
 #endif
 
 #include <filesystem>
-#include <queue>
+#include <memory>
+#include <deque>
+#include <vector>
 
 namespace base {
 
 class IpcChannelProxy;
+class IpcRingBuffer;
 class IpcServer;
 class Location;
+class SharedMemory;
 
 class IpcChannel
 {
@@ -73,6 +77,10 @@ public:
 
     void send(ByteArray&& buffer);
 
+    // Queued messages are written with one operation up to |bytes| in total. A message is never
+    // split between operations, so the first message of a write may exceed the limit.
+    void setWriteBatchLimit(size_t bytes);
+
     ProcessId peerProcessId() const { return peer_process_id_; }
     SessionId peerSessionId() const { return peer_session_id_; }
     std::filesystem::path peerFilePath() const;
@@ -87,12 +95,17 @@ private:
     using Stream = asio::posix::stream_descriptor;
 #endif
 
+    static const size_t kDefaultWriteBatchLimit = 256 * 1024; // 256kB
+
     IpcChannel(std::u16string_view channel_name, Stream&& stream);
     static std::u16string channelName(std::u16string_view channel_id);
 
     void onErrorOccurred(const Location& location, const std::error_code& error_code);
     void doWrite();
+    bool writeToRing(const ByteArray& buffer);
     void doReadMessage();
+    bool openRing();
+    bool readFromRing();
     void onMessageReceived();
 
     std::u16string channel_name_;
@@ -104,12 +117,25 @@ private:
     bool is_connected_ = false;
     bool is_paused_ = true;
 
-    std::queue<ByteArray> write_queue_;
-    uint32_t write_size_ = 0;
+    std::deque<ByteArray> write_queue_;
+    size_t write_batch_limit_ = kDefaultWriteBatchLimit;
+    size_t write_count_ = 0;
+    size_t write_size_ = 0;
+    ByteArray write_header_;
+    std::vector<asio::const_buffer> write_buffers_;
 
     uint32_t read_size_ = 0;
     ByteArray read_buffer_;
 
+    // Large messages are copied into the shared memory ring and only their descriptors are sent
+    // through the pipe. Each side creates the ring for its own direction.
+    std::unique_ptr<SharedMemory> write_memory_;
+    std::unique_ptr<IpcRingBuffer> write_ring_;
+    bool write_ring_failed_ = false;
+
+    std::unique_ptr<SharedMemory> read_memory_;
+    std::unique_ptr<IpcRingBuffer> read_ring_;
+
     ProcessId peer_process_id_ = kNullProcessId;
     SessionId peer_session_id_ = kInvalidSessionId;
 
@@ -0,0 +1,119 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/ipc/ipc_ring_buffer.h"
+
+#include "base/logging.h"
+
+#include <atomic>
+#include <cstring>
+
+namespace base {
+
+namespace {
+
+using AtomicPosition = std::atomic<uint64_t>;
+
+static_assert(sizeof(AtomicPosition) <= IpcRingBuffer::kHeaderSize);
+
+} // namespace
+
+IpcRingBuffer::IpcRingBuffer(void* memory, size_t size)
+    : header_(memory),
+      data_(reinterpret_cast<uint8_t*>(memory) + kHeaderSize),
+      capacity_(size - kHeaderSize)
+{
+    DCHECK(memory);
+    DCHECK_GT(size, kHeaderSize);
+}
+
+IpcRingBuffer::~IpcRingBuffer() = default;
+
+bool IpcRingBuffer::write(const uint8_t* data, size_t size, Descriptor* descriptor)
+{
+    DCHECK(data && descriptor);
+
+    if (!size || size > capacity_)
+        return false;
+
+    const uint64_t read_position = readPosition();
+    if (read_position > position_)
+    {
+        LOG(LS_ERROR) << "Invalid read position in the ring";
+        return false;
+    }
+
+    const size_t used = static_cast<size_t>(position_ - read_position);
+    const size_t offset = static_cast<size_t>(position_ % capacity_);
+
+    // A message is not split at the end of the ring. The tail is skipped instead.
+    const size_t skip = (offset + size > capacity_) ? capacity_ - offset : 0;
+
+    if (used + skip + size > capacity_)
+        return false;
+
+    position_ += skip;
+    memcpy(data_ + (position_ % capacity_), data, size);
+    position_ += size;
+
+    descriptor->end = position_;
+    descriptor->size = static_cast<uint32_t>(size);
+    return true;
+}
+
+bool IpcRingBuffer::read(const Descriptor& descriptor, ByteArray* buffer)
+{
+    DCHECK(buffer);
+
+    const size_t size = descriptor.size;
+
+    // The message must follow the previous one and be entirely in the ring.
+    if (!size || size > capacity_ || descriptor.end < position_ + size ||
+        descriptor.end - position_ > capacity_)
+    {
+        LOG(LS_ERROR) << "Invalid message descriptor";
+        return false;
+    }
+
+    const size_t offset = static_cast<size_t>((descriptor.end - size) % capacity_);
+    if (offset + size > capacity_)
+    {
+        LOG(LS_ERROR) << "Invalid message offset";
+        return false;
+    }
+
+    buffer->resize(size);
+    memcpy(buffer->data(), data_ + offset, size);
+
+    // The space of the message can be reused by the writer.
+    position_ = descriptor.end;
+    setReadPosition(position_);
+    return true;
+}
+
+uint64_t IpcRingBuffer::readPosition() const
+{
+    return reinterpret_cast<const AtomicPosition*>(header_)->load(std::memory_order_acquire);
+}
+
+void IpcRingBuffer::setReadPosition(uint64_t position)
+{
+    reinterpret_cast<AtomicPosition*>(header_)->store(position, std::memory_order_release);
+}
+
+} // namespace base
@@ -0,0 +1,75 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__IPC__IPC_RING_BUFFER_H
+#define BASE__IPC__IPC_RING_BUFFER_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+
+namespace base {
+
+// Ring of messages in memory shared by two processes. There is one writer and one reader. The
+// writer copies a message into the ring and passes its descriptor to the reader through another
+// channel. The reader must handle the descriptors in the order in which they were created: it
+// copies the message out of the ring and releases its space. Messages are never split at the end
+// of the ring.
+class IpcRingBuffer
+{
+public:
+    // The beginning of the memory is occupied by the header of the ring.
+    static constexpr size_t kHeaderSize = 64;
+
+    struct Descriptor
+    {
+        // Position in the ring right after the message.
+        uint64_t end = 0;
+        uint32_t size = 0;
+    };
+
+    // |memory| must be filled with zeros when the ring is created. |size| includes the header.
+    IpcRingBuffer(void* memory, size_t size);
+    ~IpcRingBuffer();
+
+    // Called by the writer. Returns false if there is not enough free space in the ring.
+    bool write(const uint8_t* data, size_t size, Descriptor* descriptor);
+
+    // Called by the reader. Returns false if the descriptor does not match the ring.
+    bool read(const Descriptor& descriptor, ByteArray* buffer);
+
+    size_t capacity() const { return capacity_; }
+
+private:
+    uint64_t readPosition() const;
+    void setReadPosition(uint64_t position);
+
+    void* header_;
+    uint8_t* data_;
+    const size_t capacity_;
+
+    // Position of the next message for the writer and the end of the last read message for the
+    // reader. Positions grow continuously, the offset in the ring is the remainder of division by
+    // the capacity.
+    uint64_t position_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(IpcRingBuffer);
+};
+
+} // namespace base
+
+#endif // BASE__IPC__IPC_RING_BUFFER_H
@@ -0,0 +1,123 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/ipc/ipc_ring_buffer.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+constexpr size_t kMemorySize = IpcRingBuffer::kHeaderSize + 1024;
+
+ByteArray makeMessage(size_t size, uint8_t value)
+{
+    return ByteArray(size, value);
+}
+
+} // namespace
+
+TEST(IpcRingBufferTest, WriteRead)
+{
+    std::vector<uint8_t> memory(kMemorySize, 0);
+
+    IpcRingBuffer writer(memory.data(), memory.size());
+    IpcRingBuffer reader(memory.data(), memory.size());
+
+    for (uint8_t i = 1; i < 50; ++i)
+    {
+        ByteArray message = makeMessage(100 + i, i);
+        IpcRingBuffer::Descriptor descriptor;
+
+        ASSERT_TRUE(writer.write(message.data(), message.size(), &descriptor));
+
+        ByteArray result;
+        ASSERT_TRUE(reader.read(descriptor, &result));
+        EXPECT_EQ(result, message);
+    }
+}
+
+TEST(IpcRingBufferTest, Full)
+{
+    std::vector<uint8_t> memory(kMemorySize, 0);
+
+    IpcRingBuffer writer(memory.data(), memory.size());
+    IpcRingBuffer reader(memory.data(), memory.size());
+
+    ByteArray message = makeMessage(400, 1);
+    IpcRingBuffer::Descriptor first;
+    IpcRingBuffer::Descriptor second;
+    IpcRingBuffer::Descriptor third;
+
+    EXPECT_TRUE(writer.write(message.data(), message.size(), &first));
+    EXPECT_TRUE(writer.write(message.data(), message.size(), &second));
+
+    // There are only 224 bytes left in the ring.
+    EXPECT_FALSE(writer.write(message.data(), message.size(), &third));
+
+    // After the first message is read, the third one is placed at the beginning of the ring.
+    ByteArray result;
+    EXPECT_TRUE(reader.read(first, &result));
+    EXPECT_TRUE(writer.write(message.data(), message.size(), &third));
+    EXPECT_EQ(third.end - third.size, 1024u);
+
+    EXPECT_TRUE(reader.read(second, &result));
+    EXPECT_TRUE(reader.read(third, &result));
+    EXPECT_EQ(result, message);
+}
+
+TEST(IpcRingBufferTest, TooLarge)
+{
+    std::vector<uint8_t> memory(kMemorySize, 0);
+    IpcRingBuffer writer(memory.data(), memory.size());
+
+    ByteArray message = makeMessage(1025, 1);
+    IpcRingBuffer::Descriptor descriptor;
+
+    EXPECT_FALSE(writer.write(message.data(), message.size(), &descriptor));
+}
+
+TEST(IpcRingBufferTest, InvalidDescriptor)
+{
+    std::vector<uint8_t> memory(kMemorySize, 0);
+
+    IpcRingBuffer writer(memory.data(), memory.size());
+    IpcRingBuffer reader(memory.data(), memory.size());
+
+    ByteArray message = makeMessage(100, 1);
+    IpcRingBuffer::Descriptor descriptor;
+    ASSERT_TRUE(writer.write(message.data(), message.size(), &descriptor));
+
+    ByteArray result;
+
+    IpcRingBuffer::Descriptor invalid = descriptor;
+    invalid.size = 0;
+    EXPECT_FALSE(reader.read(invalid, &result));
+
+    invalid = descriptor;
+    invalid.end = 2048;
+    EXPECT_FALSE(reader.read(invalid, &result));
+
+    EXPECT_TRUE(reader.read(descriptor, &result));
+
+    // The same message can not be read twice.
+    EXPECT_FALSE(reader.read(descriptor, &result));
+}
+
+} // namespace base
@@ -22,14 +22,17 @@
 #include "base/endian_util.h"
 #include "base/environment.h"
 #include "base/system_time.h"
+#include "base/trace_event.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/unicode.h"
 
+#include <condition_variable>
 #include <fstream>
 #include <iomanip>
 #include <mutex>
 #include <ostream>
 #include <thread>
+#include <vector>
 
 #if defined(OS_WIN)
 #include <Windows.h>
@@ -65,6 +68,25 @@ std::filesystem::path g_log_file_path;
 std::ofstream g_log_file;
 std::mutex g_log_file_lock;
 
+// Messages for the log file are written by a background thread, so the threads that log do not
+// wait for the disk. If the writer falls behind by more than this size, new messages are dropped.
+const size_t kMaxPendingSize = 8 * 1024 * 1024; // 8 Mb.
+
+struct PendingMessage
+{
+    std::string text;
+    size_t message_start; // Position of the text after the header (time, thread, location).
+};
+
+std::mutex g_pending_lock;
+std::condition_variable g_pending_event;
+std::vector<PendingMessage> g_pending;
+size_t g_pending_size = 0;
+size_t g_dropped_count = 0;
+bool g_writer_running = false;
+bool g_writer_stopping = false;
+std::thread g_writer_thread;
+
 const char* severityName(LoggingSeverity severity)
 {
     static const char* const kLogSeverityNames[] = { "I", "W", "E", "F" };
@@ -167,33 +189,6 @@ bool initLoggingUnlocked(const std::string& prefix)
     return true;
 }
 
-} // namespace
-
-// This is never instantiated, it's just used for EAT_STREAM_PARAMETERS to have
-// an object of the correct type on the LHS of the unused part of the ternary
-// operator.
-std::ostream* g_swallow_stream;
-
-LoggingSettings::LoggingSettings()
-    : destination(LOG_DEFAULT),
-      min_log_level(LOG_LS_WARNING),
-      max_log_file_size(kDefaultMaxLogFileSize),
-      max_log_file_age(kDefaultMaxLogFileAge)
-{
-    std::string log_level_string;
-    if (Environment::get("ASPIA_LOG_LEVEL", &log_level_string))
-    {
-        LoggingSeverity log_level = LOG_LS_WARNING;
-        if (stringToInt(log_level_string, &log_level))
-        {
-            log_level = std::max(log_level, LOG_LS_INFO);
-            log_level = std::min(log_level, LOG_LS_FATAL);
-
-            min_log_level = log_level;
-        }
-    }
-}
-
 std::filesystem::path execFilePath()
 {
     std::filesystem::path exec_file_path;
@@ -226,6 +221,227 @@ std::string logFilePrefix()
     return exec_file_name.string();
 }
 
+// Writes a message to the log file. Must be called with |g_log_file_lock| held.
+void writeToFileUnlocked(const std::string& message)
+{
+    if (g_log_file.tellp() >= g_max_log_file_size)
+    {
+        // The maximum size of the log file has been exceeded. Close the current log file and
+        // create a new one.
+        initLoggingUnlocked(logFilePrefix());
+    }
+
+    g_log_file.write(message.data(), message.size());
+}
+
+// Messages that repeat the previous one (apart from the header) are counted instead of written.
+// Must be called with |g_log_file_lock| held.
+class RepeatFilter
+{
+public:
+    void write(const PendingMessage& message)
+    {
+        std::string_view body(message.text);
+        body.remove_prefix(std::min(message.message_start, body.size()));
+
+        if (!last_body_.empty() && body == last_body_)
+        {
+            ++repeat_count_;
+            return;
+        }
+
+        flush();
+
+        last_body_.assign(body);
+        writeToFileUnlocked(message.text);
+    }
+
+    void flush()
+    {
+        if (!repeat_count_)
+            return;
+
+        std::ostringstream stream;
+        stream << "Previous message repeated " << repeat_count_ << " times" << std::endl;
+
+        writeToFileUnlocked(stream.str());
+        repeat_count_ = 0;
+    }
+
+private:
+    std::string last_body_;
+    size_t repeat_count_ = 0;
+};
+
+RepeatFilter g_repeat_filter;
+
+// Writes the taken messages. Must be called with |g_log_file_lock| held.
+void writeMessagesUnlocked(const std::vector<PendingMessage>& messages, size_t dropped_count)
+{
+    for (const auto& message : messages)
+        g_repeat_filter.write(message);
+
+    if (dropped_count)
+    {
+        g_repeat_filter.flush();
+
+        std::ostringstream stream;
+        stream << dropped_count << " messages were dropped (logging is too slow)" << std::endl;
+        writeToFileUnlocked(stream.str());
+    }
+
+    g_log_file.flush();
+}
+
+void writerThreadMain()
+{
+    std::vector<PendingMessage> messages;
+
+    for (;;)
+    {
+        size_t dropped_count;
+        bool stopping;
+
+        {
+            std::unique_lock lock(g_pending_lock);
+            g_pending_event.wait(lock, []()
+            {
+                return !g_pending.empty() || g_dropped_count || g_writer_stopping;
+            });
+
+            // All the messages that have come since the last write are written at once.
+            messages.swap(g_pending);
+            g_pending_size = 0;
+
+            dropped_count = g_dropped_count;
+            g_dropped_count = 0;
+
+            stopping = g_writer_stopping;
+        }
+
+        {
+            std::scoped_lock lock(g_log_file_lock);
+            writeMessagesUnlocked(messages, dropped_count);
+
+            if (stopping)
+                g_repeat_filter.flush();
+        }
+
+        messages.clear();
+
+        if (stopping)
+            break;
+    }
+}
+
+void startWriterThread()
+{
+    std::scoped_lock lock(g_pending_lock);
+    if (g_writer_running)
+        return;
+
+    g_writer_stopping = false;
+    g_writer_running = true;
+    g_writer_thread = std::thread(&writerThreadMain);
+}
+
+void stopWriterThread()
+{
+    {
+        std::scoped_lock lock(g_pending_lock);
+        if (!g_writer_running)
+            return;
+
+        g_writer_stopping = true;
+    }
+
+    g_pending_event.notify_one();
+    g_writer_thread.join();
+
+    std::scoped_lock lock(g_pending_lock);
+    g_writer_running = false;
+}
+
+// Queues the message for the writer thread. Returns false if the writer is not running.
+bool postToWriter(std::string&& message, size_t message_start)
+{
+    {
+        std::scoped_lock lock(g_pending_lock);
+
+        if (!g_writer_running || g_writer_stopping)
+            return false;
+
+        if (g_pending_size + message.size() > kMaxPendingSize)
+        {
+            ++g_dropped_count;
+            return true;
+        }
+
+        g_pending_size += message.size();
+        g_pending.push_back(PendingMessage{ std::move(message), message_start });
+
+        // The writer is already woken up by the first message.
+        if (g_pending.size() > 1)
+            return true;
+    }
+
+    g_pending_event.notify_one();
+    return true;
+}
+
+// Writes the message directly with all the messages pending for the writer thread before it.
+void writeSynchronously(std::string&& message, size_t message_start)
+{
+    std::vector<PendingMessage> messages;
+    size_t dropped_count;
+
+    {
+        std::scoped_lock lock(g_pending_lock);
+
+        messages.swap(g_pending);
+        g_pending_size = 0;
+
+        dropped_count = g_dropped_count;
+        g_dropped_count = 0;
+    }
+
+    messages.push_back(PendingMessage{ std::move(message), message_start });
+
+    std::scoped_lock lock(g_log_file_lock);
+    writeMessagesUnlocked(messages, dropped_count);
+}
+
+} // namespace
+
+// This is never instantiated, it's just used for EAT_STREAM_PARAMETERS to have
+// an object of the correct type on the LHS of the unused part of the ternary
+// operator.
+std::ostream* g_swallow_stream;
+
+LoggingSettings::LoggingSettings()
+    : destination(LOG_DEFAULT),
+      min_log_level(LOG_LS_WARNING),
+      max_log_file_size(kDefaultMaxLogFileSize),
+      max_log_file_age(kDefaultMaxLogFileAge)
+{
+    std::string log_level_string;
+    if (Environment::get("ASPIA_LOG_LEVEL", &log_level_string))
+    {
+        LoggingSeverity log_level = LOG_LS_WARNING;
+        if (stringToInt(log_level_string, &log_level))
+        {
+            log_level = std::max(log_level, LOG_LS_INFO);
+            log_level = std::min(log_level, LOG_LS_FATAL);
+
+            min_log_level = log_level;
+        }
+    }
+
+    std::string trace_file_string;
+    if (Environment::get("ASPIA_TRACE_FILE", &trace_file_string))
+        trace_file = std::filesystem::u8path(trace_file_string);
+}
+
 bool initLogging(const LoggingSettings& settings)
 {
     {
@@ -241,6 +457,9 @@ bool initLogging(const LoggingSettings& settings)
             return false;
     }
 
+    if (g_logging_destination & LOG_TO_FILE)
+        startWriterThread();
+
     LOG(LS_INFO) << "Executable file: " << execFilePath();
     if (g_logging_destination & LOG_TO_FILE)
     {
@@ -258,13 +477,23 @@ bool initLogging(const LoggingSettings& settings)
 
     LOG(LS_INFO) << "Little endian: " << (EndianUtil::isLittle() ? "Yes" : "No");
     LOG(LS_INFO) << "Logging started";
+
+    if (!settings.trace_file.empty())
+        TraceLog::instance()->start(settings.trace_file);
+
     return true;
 }
 
 void shutdownLogging()
 {
+    // Does nothing if tracing was not started.
+    TraceLog::instance()->stop();
+
     LOG(LS_INFO) << "Logging finished";
 
+    // The remaining messages are written before the writer thread exits.
+    stopWriterThread();
+
     std::scoped_lock lock(g_log_file_lock);
     g_log_file.close();
 }
@@ -386,20 +615,12 @@ LogMessage::~LogMessage()
         fflush(stderr);
     }
 
-    // Write to log file.
+    // Write to log file. A fatal message is written directly because the process is about to
+    // crash.
     if ((g_logging_destination & LOG_TO_FILE) != 0)
     {
-        std::scoped_lock lock(g_log_file_lock);
-
-        if (g_log_file.tellp() >= g_max_log_file_size)
-        {
-            // The maximum size of the log file has been exceeded. Close the current log file and
-            // create a new one.
-            initLoggingUnlocked(logFilePrefix());
-        }
-
-        g_log_file.write(message.c_str(), message.size());
-        g_log_file.flush();
+        if (severity_ == LOG_LS_FATAL || !postToWriter(std::move(message), message_start_))
+            writeSynchronously(std::move(message), message_start_);
     }
 
     if (severity_ == LOG_LS_FATAL)
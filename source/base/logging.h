@@ -123,6 +123,7 @@ struct LoggingSettings
     //  min_log_level: LOG_LS_INFO
     //  max_log_file_size: 2 Mb
     //  max_log_file_age: 14 days
+    //  trace_file: value of ASPIA_TRACE_FILE environment variable or empty
     LoggingSettings();
 
     LoggingDestination destination;
@@ -132,6 +133,10 @@ struct LoggingSettings
 
     size_t max_log_file_size;
     size_t max_log_file_age;
+
+    // If not empty, trace events (see base/trace_event.h) are recorded while logging is
+    // initialized and written to this file by shutdownLogging().
+    std::filesystem::path trace_file;
 };
 
 // Sets the log file name and other global logging state. Calling this function is recommended,
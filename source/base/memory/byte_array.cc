@@ -19,6 +19,7 @@
 #include "base/memory/byte_array.h"
 
 #include "base/logging.h"
+#include "base/memory/byte_array_pool.h"
 
 namespace base {
 
@@ -128,8 +129,7 @@ base::ByteArray serialize(const google::protobuf::MessageLite& message)
     if (!size)
         return base::ByteArray();
 
-    base::ByteArray buffer;
-    buffer.resize(size);
+    base::ByteArray buffer = ByteArrayPool::acquire(size);
 
     message.SerializeWithCachedSizesToArray(buffer.data());
     return buffer;
@@ -0,0 +1,190 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/memory/byte_array_pool.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace base {
+
+namespace {
+
+constexpr size_t kClassCount = 11; // 256 bytes ... 256 kB.
+
+static_assert((ByteArrayPool::kMinClassSize << (kClassCount - 1)) ==
+              ByteArrayPool::kMaxClassSize);
+
+struct SizeClass
+{
+    std::mutex lock;
+    std::vector<ByteArray> buffers;
+};
+
+struct Pool
+{
+    SizeClass classes[kClassCount];
+
+    std::atomic_uint64_t acquired { 0 };
+    std::atomic_uint64_t reused { 0 };
+    std::atomic_uint64_t released { 0 };
+    std::atomic_uint64_t dropped { 0 };
+    std::atomic_uint64_t cached_bytes { 0 };
+};
+
+Pool& pool()
+{
+    // The pool is never destroyed, buffers can be released while static objects are destroyed.
+    static Pool* instance = new Pool();
+    return *instance;
+}
+
+// Returns the smallest class whose buffers can hold |size| bytes.
+size_t classForSize(size_t size)
+{
+    size_t index = 0;
+    while ((ByteArrayPool::kMinClassSize << index) < size)
+        ++index;
+    return index;
+}
+
+// Returns the largest class whose size does not exceed |capacity|.
+size_t classForCapacity(size_t capacity)
+{
+    size_t index = 0;
+    while (index + 1 < kClassCount && (ByteArrayPool::kMinClassSize << (index + 1)) <= capacity)
+        ++index;
+    return index;
+}
+
+} // namespace
+
+// static
+ByteArray ByteArrayPool::acquire(size_t size)
+{
+    ByteArray buffer;
+
+    if (size > kMaxClassSize)
+    {
+        buffer.resize(size);
+        return buffer;
+    }
+
+    Pool& instance = pool();
+    const size_t index = classForSize(size);
+    const size_t class_size = kMinClassSize << index;
+
+    ++instance.acquired;
+
+    {
+        SizeClass& size_class = instance.classes[index];
+        std::scoped_lock lock(size_class.lock);
+
+        if (!size_class.buffers.empty())
+        {
+            buffer = std::move(size_class.buffers.back());
+            size_class.buffers.pop_back();
+        }
+    }
+
+    if (buffer.capacity())
+    {
+        ++instance.reused;
+        instance.cached_bytes -= class_size;
+    }
+    else
+    {
+        buffer.reserve(class_size);
+    }
+
+    buffer.resize(size);
+    return buffer;
+}
+
+// static
+void ByteArrayPool::release(ByteArray&& buffer)
+{
+    ByteArray released(std::move(buffer));
+
+    const size_t capacity = released.capacity();
+    if (capacity < kMinClassSize)
+        return;
+
+    Pool& instance = pool();
+    const size_t index = classForCapacity(capacity);
+    const size_t class_size = kMinClassSize << index;
+
+    // A buffer much larger than its class wastes memory while it is in the pool.
+    if (capacity > class_size * 2)
+    {
+        ++instance.dropped;
+        return;
+    }
+
+    released.clear();
+
+    {
+        SizeClass& size_class = instance.classes[index];
+        std::scoped_lock lock(size_class.lock);
+
+        if ((size_class.buffers.size() + 1) * class_size <= kMaxCachedBytesPerClass)
+        {
+            size_class.buffers.emplace_back(std::move(released));
+            instance.cached_bytes += class_size;
+            ++instance.released;
+            return;
+        }
+    }
+
+    ++instance.dropped;
+}
+
+// static
+ByteArrayPool::Statistics ByteArrayPool::statistics()
+{
+    Pool& instance = pool();
+
+    Statistics statistics;
+    statistics.acquired = instance.acquired;
+    statistics.reused = instance.reused;
+    statistics.released = instance.released;
+    statistics.dropped = instance.dropped;
+    statistics.cached_bytes = instance.cached_bytes;
+    return statistics;
+}
+
+// static
+void ByteArrayPool::clear()
+{
+    Pool& instance = pool();
+
+    for (size_t i = 0; i < kClassCount; ++i)
+    {
+        std::vector<ByteArray> buffers;
+
+        {
+            SizeClass& size_class = instance.classes[i];
+            std::scoped_lock lock(size_class.lock);
+            buffers.swap(size_class.buffers);
+        }
+
+        instance.cached_bytes -= buffers.size() * (kMinClassSize << i);
+    }
+}
+
+} // namespace base
@@ -0,0 +1,61 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__MEMORY__BYTE_ARRAY_POOL_H
+#define BASE__MEMORY__BYTE_ARRAY_POOL_H
+
+#include "base/memory/byte_array.h"
+
+namespace base {
+
+// Keeps released message buffers for reuse. Buffers are grouped by capacity into power of two
+// size classes, so that messages created and freed at a high rate do not fragment the heap.
+// All methods can be called from any thread.
+class ByteArrayPool
+{
+public:
+    static constexpr size_t kMinClassSize = 256;
+    static constexpr size_t kMaxClassSize = 256 * 1024;
+
+    // Memory kept by one size class.
+    static constexpr size_t kMaxCachedBytesPerClass = 1024 * 1024;
+
+    // Returns a buffer of |size| bytes. Its capacity is rounded up to the size class.
+    static ByteArray acquire(size_t size);
+
+    // Returns the memory of |buffer| to the pool. The buffer may be freed if the pool is full.
+    static void release(ByteArray&& buffer);
+
+    struct Statistics
+    {
+        uint64_t acquired = 0;   // Buffers returned by acquire().
+        uint64_t reused = 0;     // Buffers taken from the pool.
+        uint64_t released = 0;   // Buffers kept by release().
+        uint64_t dropped = 0;    // Buffers freed by release() because the pool is full.
+        uint64_t cached_bytes = 0;
+    };
+
+    static Statistics statistics();
+
+    // Frees all buffers kept by the pool.
+    static void clear();
+};
+
+} // namespace base
+
+#endif // BASE__MEMORY__BYTE_ARRAY_POOL_H
@@ -0,0 +1,98 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/memory/byte_array_pool.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(ByteArrayPool, AcquireRoundsCapacity)
+{
+    ByteArrayPool::clear();
+
+    ByteArray buffer = ByteArrayPool::acquire(300);
+    EXPECT_EQ(buffer.size(), 300u);
+    EXPECT_GE(buffer.capacity(), 512u);
+
+    ByteArray small = ByteArrayPool::acquire(1);
+    EXPECT_EQ(small.size(), 1u);
+    EXPECT_GE(small.capacity(), ByteArrayPool::kMinClassSize);
+
+    ByteArray large = ByteArrayPool::acquire(ByteArrayPool::kMaxClassSize + 1);
+    EXPECT_EQ(large.size(), ByteArrayPool::kMaxClassSize + 1);
+}
+
+TEST(ByteArrayPool, ReleasedBufferIsReused)
+{
+    ByteArrayPool::clear();
+
+    ByteArray buffer = ByteArrayPool::acquire(1000);
+    const uint8_t* data = buffer.data();
+
+    const ByteArrayPool::Statistics before = ByteArrayPool::statistics();
+
+    ByteArrayPool::release(std::move(buffer));
+    EXPECT_EQ(ByteArrayPool::statistics().released, before.released + 1);
+    EXPECT_EQ(ByteArrayPool::statistics().cached_bytes, 1024u);
+
+    // A buffer of the same size class is taken from the pool.
+    ByteArray reused = ByteArrayPool::acquire(700);
+    EXPECT_EQ(reused.data(), data);
+    EXPECT_EQ(reused.size(), 700u);
+    EXPECT_EQ(ByteArrayPool::statistics().reused, before.reused + 1);
+    EXPECT_EQ(ByteArrayPool::statistics().cached_bytes, 0u);
+}
+
+TEST(ByteArrayPool, PoolIsBounded)
+{
+    ByteArrayPool::clear();
+
+    const size_t count =
+        ByteArrayPool::kMaxCachedBytesPerClass / ByteArrayPool::kMaxClassSize + 2;
+
+    std::vector<ByteArray> buffers;
+    for (size_t i = 0; i < count; ++i)
+        buffers.emplace_back(ByteArrayPool::acquire(ByteArrayPool::kMaxClassSize));
+
+    const ByteArrayPool::Statistics before = ByteArrayPool::statistics();
+
+    for (auto& buffer : buffers)
+        ByteArrayPool::release(std::move(buffer));
+
+    const ByteArrayPool::Statistics after = ByteArrayPool::statistics();
+    EXPECT_EQ(after.dropped - before.dropped, 2u);
+    EXPECT_EQ(after.cached_bytes, ByteArrayPool::kMaxCachedBytesPerClass);
+
+    ByteArrayPool::clear();
+    EXPECT_EQ(ByteArrayPool::statistics().cached_bytes, 0u);
+}
+
+TEST(ByteArrayPool, SmallBufferIsNotKept)
+{
+    ByteArrayPool::clear();
+
+    const ByteArrayPool::Statistics before = ByteArrayPool::statistics();
+    ByteArrayPool::release(ByteArray(10));
+
+    const ByteArrayPool::Statistics after = ByteArrayPool::statistics();
+    EXPECT_EQ(after.released, before.released);
+    EXPECT_EQ(after.cached_bytes, 0u);
+}
+
+} // namespace base
@@ -0,0 +1,77 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/message_loop/incoming_task_queue.h"
+
+namespace base {
+
+IncomingTaskQueue::~IncomingTaskQueue()
+{
+    Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+    while (node)
+    {
+        Node* next = node->next;
+        delete node;
+        node = next;
+    }
+}
+
+bool IncomingTaskQueue::push(
+    PendingTask::Callback&& callback, PendingTask::TimePoint delayed_run_time, bool nestable)
+{
+    Node* node = new Node(std::move(callback), delayed_run_time, nestable);
+
+    Node* head = head_.load(std::memory_order_relaxed);
+    do
+    {
+        node->next = head;
+    }
+    while (!head_.compare_exchange_weak(
+        head, node, std::memory_order_release, std::memory_order_relaxed));
+
+    // |node| may be already taken by the consumer here, so it is not accessed anymore.
+    return head == nullptr;
+}
+
+void IncomingTaskQueue::takeAll(TaskQueue* work_queue)
+{
+    // Tasks are taken all at once, so there is no ABA problem with concurrent pushes.
+    Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+    if (!node)
+        return;
+
+    // Reverse the list to get the tasks in the order in which they were added.
+    Node* oldest = nullptr;
+    while (node)
+    {
+        Node* next = node->next;
+        node->next = oldest;
+        oldest = node;
+        node = next;
+    }
+
+    while (oldest)
+    {
+        Node* next = oldest->next;
+        work_queue->emplace(std::move(oldest->task));
+        delete oldest;
+        oldest = next;
+    }
+}
+
+} // namespace base
@@ -0,0 +1,69 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__MESSAGE_LOOP__INCOMING_TASK_QUEUE_H
+#define BASE__MESSAGE_LOOP__INCOMING_TASK_QUEUE_H
+
+#include "base/macros_magic.h"
+#include "base/message_loop/pending_task.h"
+
+#include <atomic>
+
+namespace base {
+
+// Queue of the tasks posted to a message loop. Tasks can be added from any thread without locks
+// (a single compare-and-swap); the thread of the message loop takes all the queued tasks at once.
+class IncomingTaskQueue
+{
+public:
+    IncomingTaskQueue() = default;
+    ~IncomingTaskQueue();
+
+    // Adds a task. Can be called from any thread.
+    // Returns true if the queue was empty, i.e. the message loop must be woken up. While the
+    // queue stays non-empty, the message loop is already about to take the tasks.
+    bool push(PendingTask::Callback&& callback, PendingTask::TimePoint delayed_run_time,
+              bool nestable);
+
+    // Moves all the queued tasks to the end of |work_queue| in the order in which they were
+    // added. Only one thread may take the tasks.
+    void takeAll(TaskQueue* work_queue);
+
+private:
+    struct Node
+    {
+        Node(PendingTask::Callback&& callback, PendingTask::TimePoint delayed_run_time,
+             bool nestable)
+            : task(std::move(callback), delayed_run_time, nestable)
+        {
+            // Nothing
+        }
+
+        PendingTask task;
+        Node* next = nullptr;
+    };
+
+    // The most recently added task. The list is linked from the newest task to the oldest.
+    std::atomic<Node*> head_ { nullptr };
+
+    DISALLOW_COPY_AND_ASSIGN(IncomingTaskQueue);
+};
+
+} // namespace base
+
+#endif // BASE__MESSAGE_LOOP__INCOMING_TASK_QUEUE_H
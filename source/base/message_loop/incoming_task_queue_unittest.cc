@@ -0,0 +1,102 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/message_loop/incoming_task_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace base {
+
+TEST(IncomingTaskQueueTest, KeepsOrder)
+{
+    IncomingTaskQueue queue;
+    std::vector<int> result;
+
+    EXPECT_TRUE(queue.push([&]() { result.push_back(1); }, PendingTask::TimePoint(), true));
+    EXPECT_FALSE(queue.push([&]() { result.push_back(2); }, PendingTask::TimePoint(), false));
+    EXPECT_FALSE(queue.push([&]() { result.push_back(3); }, PendingTask::TimePoint(), true));
+
+    TaskQueue work_queue;
+    queue.takeAll(&work_queue);
+    ASSERT_EQ(work_queue.size(), 3u);
+    EXPECT_TRUE(work_queue.front().nestable);
+
+    while (!work_queue.empty())
+    {
+        work_queue.front().callback();
+        work_queue.pop();
+    }
+
+    EXPECT_EQ(result, std::vector<int>({ 1, 2, 3 }));
+
+    // The queue is empty again, the next task must wake up the consumer.
+    EXPECT_TRUE(queue.push([]() {}, PendingTask::TimePoint(), true));
+}
+
+TEST(IncomingTaskQueueTest, ConcurrentProducers)
+{
+    static const int kThreadCount = 4;
+    static const int kTaskCount = 10000;
+
+    IncomingTaskQueue queue;
+    std::vector<std::vector<int>> result(kThreadCount);
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < kThreadCount; ++i)
+    {
+        threads.emplace_back([&queue, &result, i]()
+        {
+            for (int j = 0; j < kTaskCount; ++j)
+            {
+                queue.push([&result, i, j]() { result[i].push_back(j); },
+                           PendingTask::TimePoint(), true);
+            }
+        });
+    }
+
+    TaskQueue work_queue;
+    size_t taken = 0;
+
+    while (taken < kThreadCount * kTaskCount)
+    {
+        queue.takeAll(&work_queue);
+
+        while (!work_queue.empty())
+        {
+            work_queue.front().callback();
+            work_queue.pop();
+            ++taken;
+        }
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    // The tasks of each producer are received in the order in which they were added.
+    for (int i = 0; i < kThreadCount; ++i)
+    {
+        ASSERT_EQ(result[i].size(), static_cast<size_t>(kTaskCount));
+        for (int j = 0; j < kTaskCount; ++j)
+            EXPECT_EQ(result[i][j], j);
+    }
+}
+
+} // namespace base
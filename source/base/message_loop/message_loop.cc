@@ -177,7 +177,7 @@ void MessageLoop::runTask(const PendingTask& pending_task)
     nestable_tasks_allowed_ = true;
 }
 
-bool MessageLoop::deferOrRunPendingTask(const PendingTask& pending_task)
+bool MessageLoop::deferOrRunPendingTask(PendingTask&& pending_task)
 {
     if (pending_task.nestable)
     {
@@ -189,37 +189,23 @@ bool MessageLoop::deferOrRunPendingTask(const PendingTask& pending_task)
 
     // We couldn't run the task now because we're in a nested message loop
     // and the task isn't nestable.
-    deferred_non_nestable_work_queue_.emplace(pending_task);
+    deferred_non_nestable_work_queue_.emplace(std::move(pending_task));
     return false;
 }
 
 void MessageLoop::addToDelayedWorkQueue(PendingTask* pending_task)
 {
-    // Move to the delayed work queue.  Initialize the sequence number before inserting into the
-    // delayed_work_queue_. The sequence number is used to faciliate FIFO sorting when two tasks
-    // have the same delayed_run_time value.
-    delayed_work_queue_.emplace(std::move(pending_task->callback),
-                                pending_task->delayed_run_time,
-                                pending_task->nestable,
-                                next_sequence_num_++);
+    // Move to the delayed work queue. Tasks with the same run time are run in the order in which
+    // they were added.
+    delayed_work_queue_.add(std::move(*pending_task));
 }
 
 void MessageLoop::addToIncomingQueue(
     PendingTask::Callback&& callback, const Milliseconds& delay, bool nestable)
 {
-    bool empty;
-
-    {
-        std::scoped_lock lock(incoming_queue_lock_);
-
-        empty = incoming_queue_.empty();
-
-        incoming_queue_.emplace(std::move(callback),
-                                calculateDelayedRuntime(delay),
-                                nestable);
-    }
-
-    if (!empty)
+    // The pump is signaled only when the queue becomes non-empty. Until the queue is taken by
+    // reloadWorkQueue() the pump already has a pending wakeup.
+    if (!incoming_queue_.push(std::move(callback), calculateDelayedRuntime(delay), nestable))
         return;
 
     std::shared_ptr<MessagePump> pump(pump_);
@@ -231,13 +217,7 @@ void MessageLoop::reloadWorkQueue()
     if (!work_queue_.empty())
         return;
 
-    std::scoped_lock lock(incoming_queue_lock_);
-
-    if (incoming_queue_.empty())
-        return;
-
-    incoming_queue_.Swap(&work_queue_);
-    DCHECK(incoming_queue_.empty());
+    incoming_queue_.takeAll(&work_queue_);
 }
 
 bool MessageLoop::deletePendingTasks()
@@ -246,7 +226,7 @@ bool MessageLoop::deletePendingTasks()
 
     while (!work_queue_.empty())
     {
-        PendingTask pending_task = work_queue_.front();
+        PendingTask pending_task = std::move(work_queue_.front());
         work_queue_.pop();
 
         if (pending_task.delayed_run_time != TimePoint())
@@ -264,8 +244,7 @@ bool MessageLoop::deletePendingTasks()
 
     did_work |= !delayed_work_queue_.empty();
 
-    while (!delayed_work_queue_.empty())
-        delayed_work_queue_.pop();
+    delayed_work_queue_.clear();
 
     return did_work;
 }
@@ -299,7 +278,7 @@ bool MessageLoop::doWork()
         // Execute oldest task.
         do
         {
-            PendingTask pending_task = work_queue_.front();
+            PendingTask pending_task = std::move(work_queue_.front());
             work_queue_.pop();
 
             if (pending_task.delayed_run_time != TimePoint())
@@ -314,7 +293,7 @@ bool MessageLoop::doWork()
             }
             else
             {
-                if (deferOrRunPendingTask(pending_task))
+                if (deferOrRunPendingTask(std::move(pending_task)))
                     return true;
             }
         }
@@ -339,25 +318,27 @@ bool MessageLoop::doDelayedWork(TimePoint* next_delayed_work_time)
     // As a result, the more we fall behind (and have a lot of ready-to-run delayed tasks), the more
     // efficient we'll be at handling the tasks.
 
-    TimePoint next_run_time = delayed_work_queue_.top().delayed_run_time;
-
-    if (next_run_time > recent_time_)
+    if (!delayed_work_queue_.hasDueTasks())
     {
-        recent_time_ = Clock::now();
+        TimePoint next_run_time = delayed_work_queue_.nextWakeupTime();
         if (next_run_time > recent_time_)
+            recent_time_ = Clock::now();
+
+        delayed_work_queue_.advance(recent_time_);
+
+        if (!delayed_work_queue_.hasDueTasks())
         {
-            *next_delayed_work_time = next_run_time;
+            *next_delayed_work_time = delayed_work_queue_.nextWakeupTime();
             return false;
         }
     }
 
-    PendingTask pending_task = delayed_work_queue_.top();
-    delayed_work_queue_.pop();
+    PendingTask pending_task = delayed_work_queue_.takeDueTask();
 
-    if (!delayed_work_queue_.empty())
-        *next_delayed_work_time = delayed_work_queue_.top().delayed_run_time;
+    // If there are more due tasks, the returned time is in the past and we are called again.
+    *next_delayed_work_time = delayed_work_queue_.nextWakeupTime();
 
-    return deferOrRunPendingTask(pending_task);
+    return deferOrRunPendingTask(std::move(pending_task));
 }
 
 bool MessageLoop::doIdleWork()
@@ -365,7 +346,7 @@ bool MessageLoop::doIdleWork()
     if (deferred_non_nestable_work_queue_.empty())
         return false;
 
-    PendingTask pending_task = deferred_non_nestable_work_queue_.front();
+    PendingTask pending_task = std::move(deferred_non_nestable_work_queue_.front());
     deferred_non_nestable_work_queue_.pop();
 
     runTask(pending_task);
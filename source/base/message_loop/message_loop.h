@@ -21,9 +21,11 @@
 
 #include "base/macros_magic.h"
 #include "base/task_runner.h"
+#include "base/message_loop/incoming_task_queue.h"
 #include "base/message_loop/message_pump.h"
 #include "base/message_loop/message_pump_dispatcher.h"
 #include "base/message_loop/pending_task.h"
+#include "base/message_loop/timer_wheel.h"
 #include "build/build_config.h"
 
 #include <memory>
@@ -87,7 +89,7 @@ protected:
 
     // Calls RunTask or queues the pending_task on the deferred task list if it cannot be run right
     // now. Returns true if the task was run.
-    bool deferOrRunPendingTask(const PendingTask& pending_task);
+    bool deferOrRunPendingTask(PendingTask&& pending_task);
 
     // Adds the pending task to delayed_work_queue_.
     void addToDelayedWorkQueue(PendingTask* pending_task);
@@ -100,7 +102,7 @@ protected:
     void addToIncomingQueue(PendingTask::Callback&& callback, const Milliseconds& delay, bool nestable);
 
     // Load tasks from the incoming_queue_ into work_queue_ if the latter is empty. The former
-    // requires a lock to access, while the latter is directly accessible on this thread.
+    // is filled by any thread, while the latter is directly accessible on this thread.
     void reloadWorkQueue();
 
     bool deletePendingTasks();
@@ -118,8 +120,8 @@ protected:
     // A recent snapshot of Clock::now(), used to check delayed_work_queue_.
     TimePoint recent_time_;
 
-    // Contains delayed tasks, sorted by their 'delayed_run_time' property.
-    DelayedTaskQueue delayed_work_queue_;
+    // Contains delayed tasks, ordered by their 'delayed_run_time' property.
+    TimerWheel delayed_work_queue_;
 
     // A list of tasks that need to be processed by this instance.  Note that this queue is only
     // accessed (push/pop) by our current thread.
@@ -135,11 +137,7 @@ protected:
 
     std::shared_ptr<MessagePump> pump_;
 
-    TaskQueue incoming_queue_;
-    std::mutex incoming_queue_lock_;
-
-    // The next sequence number to use for delayed tasks.
-    int next_sequence_num_ = 0;
+    IncomingTaskQueue incoming_queue_;
 
     std::shared_ptr<MessageLoopTaskRunner> proxy_;
 
@@ -19,18 +19,19 @@
 #ifndef BASE__MESSAGE_LOOP__PENDING_TASK_H
 #define BASE__MESSAGE_LOOP__PENDING_TASK_H
 
+#include "base/task_callback.h"
+
 #include <chrono>
-#include <functional>
 #include <queue>
 
 namespace base {
 
-// Contains data about a pending task. Stored in TaskQueue and DelayedTaskQueue for use by classes
+// Contains data about a pending task. Stored in TaskQueue and TimerWheel for use by classes
 // that queue and execute tasks.
 class PendingTask
 {
 public:
-    using Callback = std::function<void()>;
+    using Callback = TaskCallback;
     using Clock = std::chrono::high_resolution_clock;
     using TimePoint = std::chrono::time_point<Clock>;
 
@@ -38,6 +39,8 @@ public:
                 TimePoint delayed_run_time,
                 bool nestable,
                 int sequence_num = 0);
+    PendingTask(PendingTask&& other) = default;
+    PendingTask& operator=(PendingTask&& other) = default;
     ~PendingTask() = default;
 
     // Used to support sorting.
@@ -65,9 +68,6 @@ public:
     }
 };
 
-// PendingTasks are sorted by their |delayed_run_time| property.
-using DelayedTaskQueue = std::priority_queue<PendingTask>;
-
 } // namespace base
 
 #endif // BASE__MESSAGE_LOOP__PENDING_TASK_H
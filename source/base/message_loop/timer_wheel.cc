@@ -0,0 +1,240 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/message_loop/timer_wheel.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace base {
+
+namespace {
+
+using Tick = std::chrono::milliseconds;
+
+int highestBit(uint64_t value)
+{
+    DCHECK_NE(value, 0u);
+
+    int bit = 0;
+    while (value >>= 1)
+        ++bit;
+
+    return bit;
+}
+
+int lowestBit(uint64_t value)
+{
+    DCHECK_NE(value, 0u);
+
+    int bit = 0;
+    while (!(value & 1))
+    {
+        value >>= 1;
+        ++bit;
+    }
+
+    return bit;
+}
+
+} // namespace
+
+TimerWheel::TimerWheel(TimePoint origin)
+    : origin_(origin)
+{
+    // Nothing
+}
+
+void TimerWheel::add(PendingTask&& pending_task)
+{
+    uint64_t tick = tickOf(pending_task.delayed_run_time);
+    ++size_;
+    insert(Entry{ tick, std::move(pending_task) });
+}
+
+void TimerWheel::advance(TimePoint now)
+{
+    if (now <= origin_)
+        return;
+
+    // Only the ticks that have passed completely.
+    const uint64_t target_tick =
+        static_cast<uint64_t>(std::chrono::duration_cast<Tick>(now - origin_).count());
+
+    while (current_tick_ < target_tick)
+    {
+        uint64_t next_tick = nextEventTick();
+        if (next_tick > target_tick)
+        {
+            // There are no non-empty slots in between, we can skip directly to the target.
+            current_tick_ = target_tick;
+            break;
+        }
+
+        current_tick_ = next_tick;
+
+        if (!(current_tick_ & ((1ULL << kWheelBits) - 1)) && !overflow_.empty())
+            cascade(&overflow_);
+
+        // Slots of the higher levels that begin at the current tick are moved down. Their tasks
+        // are placed at the lower levels (or become due).
+        for (int level = kLevelCount - 1; level > 0; --level)
+        {
+            const int shift = level * kSlotBits;
+            if (current_tick_ & ((1ULL << shift) - 1))
+                continue;
+
+            const uint64_t index = (current_tick_ >> shift) & (kSlotCount - 1);
+            if (!(occupied_[level] & (1ULL << index)))
+                continue;
+
+            occupied_[level] &= ~(1ULL << index);
+            cascade(&levels_[level][index]);
+        }
+
+        const uint64_t index = current_tick_ & (kSlotCount - 1);
+        if (occupied_[0] & (1ULL << index))
+        {
+            occupied_[0] &= ~(1ULL << index);
+
+            Slot slot;
+            slot.swap(levels_[0][index]);
+
+            for (auto& entry : slot)
+                due_.emplace_back(std::move(entry.pending_task));
+        }
+    }
+}
+
+PendingTask TimerWheel::takeDueTask()
+{
+    DCHECK(!due_.empty());
+
+    PendingTask pending_task = std::move(due_.front());
+    due_.pop_front();
+    --size_;
+
+    return pending_task;
+}
+
+TimerWheel::TimePoint TimerWheel::nextWakeupTime() const
+{
+    if (!due_.empty())
+        return timeOf(current_tick_);
+
+    uint64_t next_tick = nextEventTick();
+    if (next_tick == std::numeric_limits<uint64_t>::max())
+        return TimePoint();
+
+    return timeOf(next_tick);
+}
+
+void TimerWheel::clear()
+{
+    for (int level = 0; level < kLevelCount; ++level)
+    {
+        for (auto& slot : levels_[level])
+            slot.clear();
+
+        occupied_[level] = 0;
+    }
+
+    overflow_.clear();
+    due_.clear();
+    size_ = 0;
+}
+
+uint64_t TimerWheel::tickOf(TimePoint time) const
+{
+    if (time <= origin_)
+        return 0;
+
+    // Rounded up so that a task is never run before its time.
+    Tick ticks = std::chrono::ceil<Tick>(time - origin_);
+    return static_cast<uint64_t>(ticks.count());
+}
+
+TimerWheel::TimePoint TimerWheel::timeOf(uint64_t tick) const
+{
+    return origin_ + std::chrono::duration_cast<TimePoint::duration>(Tick(tick));
+}
+
+void TimerWheel::insert(Entry&& entry)
+{
+    if (entry.tick <= current_tick_)
+    {
+        due_.emplace_back(std::move(entry.pending_task));
+        return;
+    }
+
+    const int level = highestBit(entry.tick ^ current_tick_) / kSlotBits;
+    if (level >= kLevelCount)
+    {
+        overflow_.emplace_back(std::move(entry));
+        return;
+    }
+
+    // The index is always greater than the index of the current tick at this level.
+    const uint64_t index = (entry.tick >> (level * kSlotBits)) & (kSlotCount - 1);
+
+    levels_[level][index].emplace_back(std::move(entry));
+    occupied_[level] |= (1ULL << index);
+}
+
+void TimerWheel::cascade(Slot* slot)
+{
+    Slot entries;
+    entries.swap(*slot);
+
+    for (auto& entry : entries)
+        insert(std::move(entry));
+}
+
+uint64_t TimerWheel::nextEventTick() const
+{
+    uint64_t result = std::numeric_limits<uint64_t>::max();
+
+    for (int level = 0; level < kLevelCount; ++level)
+    {
+        const int shift = level * kSlotBits;
+        const uint64_t index = (current_tick_ >> shift) & (kSlotCount - 1);
+
+        // Only slots after the current one can be occupied.
+        uint64_t mask = (index == kSlotCount - 1) ? 0 : (~0ULL << (index + 1));
+        mask &= occupied_[level];
+        if (!mask)
+            continue;
+
+        const uint64_t block = (current_tick_ >> (shift + kSlotBits)) << (shift + kSlotBits);
+        const uint64_t tick = block | (static_cast<uint64_t>(lowestBit(mask)) << shift);
+
+        result = std::min(result, tick);
+    }
+
+    if (!overflow_.empty())
+    {
+        const uint64_t tick = ((current_tick_ >> kWheelBits) + 1) << kWheelBits;
+        result = std::min(result, tick);
+    }
+
+    return result;
+}
+
+} // namespace base
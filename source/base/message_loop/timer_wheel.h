@@ -0,0 +1,107 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__MESSAGE_LOOP__TIMER_WHEEL_H
+#define BASE__MESSAGE_LOOP__TIMER_WHEEL_H
+
+#include "base/macros_magic.h"
+#include "base/message_loop/pending_task.h"
+
+#include <array>
+#include <deque>
+#include <vector>
+
+namespace base {
+
+// Hierarchical timer wheel for delayed tasks. Adding a task takes constant time regardless of the
+// number of pending tasks. The run time of tasks is rounded up to whole milliseconds (ticks), so
+// tasks that become due within the same tick are run on a single wakeup in the order in which they
+// were added.
+class TimerWheel
+{
+public:
+    using Clock = PendingTask::Clock;
+    using TimePoint = PendingTask::TimePoint;
+
+    explicit TimerWheel(TimePoint origin = Clock::now());
+    ~TimerWheel() = default;
+
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+
+    // Adds a task that must be run at |pending_task.delayed_run_time|.
+    void add(PendingTask&& pending_task);
+
+    // Moves the tasks that must be run by |now| to the list of due tasks.
+    void advance(TimePoint now);
+
+    bool hasDueTasks() const { return !due_.empty(); }
+
+    // Takes the oldest due task. The list of due tasks must not be empty.
+    PendingTask takeDueTask();
+
+    // Returns the time at which advance() must be called next. It may come before the run time of
+    // the nearest task (tasks far in the future are moved between the levels of the wheel on the
+    // way). Returns a null TimePoint if there are no tasks.
+    TimePoint nextWakeupTime() const;
+
+    void clear();
+
+private:
+    static const int kLevelCount = 4;
+    static const int kSlotBits = 6;
+    static const uint64_t kSlotCount = 1ULL << kSlotBits;
+    static const int kWheelBits = kLevelCount * kSlotBits;
+
+    struct Entry
+    {
+        uint64_t tick;
+        PendingTask pending_task;
+    };
+
+    using Slot = std::vector<Entry>;
+
+    uint64_t tickOf(TimePoint time) const;
+    TimePoint timeOf(uint64_t tick) const;
+    void insert(Entry&& entry);
+    void cascade(Slot* slot);
+    uint64_t nextEventTick() const;
+
+    const TimePoint origin_;
+
+    // Ticks passed since |origin_| that have been processed.
+    uint64_t current_tick_ = 0;
+
+    // Level N slot covers 64^N ticks. A task is placed at the level of the highest bit in which its
+    // tick differs from |current_tick_|, so a slot of a higher level is moved down one level when
+    // the current tick reaches its beginning.
+    std::array<std::array<Slot, kSlotCount>, kLevelCount> levels_;
+    std::array<uint64_t, kLevelCount> occupied_ = {}; // Bitmask of non-empty slots per level.
+
+    // Tasks that are further in the future than the wheel covers (about 4.6 hours).
+    Slot overflow_;
+
+    std::deque<PendingTask> due_;
+    size_t size_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(TimerWheel);
+};
+
+} // namespace base
+
+#endif // BASE__MESSAGE_LOOP__TIMER_WHEEL_H
@@ -0,0 +1,157 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/message_loop/timer_wheel.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+using Clock = TimerWheel::Clock;
+using TimePoint = TimerWheel::TimePoint;
+using Milliseconds = std::chrono::milliseconds;
+
+void addTask(TimerWheel* wheel, TimePoint run_time, int id, std::vector<int>* result)
+{
+    wheel->add(PendingTask([id, result]() { result->push_back(id); }, run_time, true));
+}
+
+void runDueTasks(TimerWheel* wheel)
+{
+    while (wheel->hasDueTasks())
+        wheel->takeDueTask().callback();
+}
+
+} // namespace
+
+TEST(TimerWheelTest, RunsInOrder)
+{
+    const TimePoint origin = Clock::now();
+    TimerWheel wheel(origin);
+    std::vector<int> result;
+
+    EXPECT_TRUE(wheel.empty());
+    EXPECT_EQ(wheel.nextWakeupTime(), TimePoint());
+
+    addTask(&wheel, origin + Milliseconds(100), 3, &result);
+    addTask(&wheel, origin + Milliseconds(10), 1, &result);
+    addTask(&wheel, origin + Milliseconds(50), 2, &result);
+    addTask(&wheel, origin + Milliseconds(50), 4, &result);
+    EXPECT_EQ(wheel.size(), 4u);
+
+    EXPECT_EQ(wheel.nextWakeupTime(), origin + Milliseconds(10));
+
+    wheel.advance(origin + Milliseconds(9));
+    EXPECT_FALSE(wheel.hasDueTasks());
+
+    wheel.advance(origin + Milliseconds(60));
+    runDueTasks(&wheel);
+    EXPECT_EQ(result, std::vector<int>({ 1, 2, 4 }));
+
+    wheel.advance(origin + Milliseconds(1000));
+    runDueTasks(&wheel);
+    EXPECT_EQ(result, std::vector<int>({ 1, 2, 4, 3 }));
+    EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, NeverRunsEarly)
+{
+    const TimePoint origin = Clock::now();
+    TimerWheel wheel(origin);
+    std::vector<int> result;
+
+    addTask(&wheel, origin + std::chrono::microseconds(1500), 1, &result);
+
+    wheel.advance(origin + std::chrono::microseconds(1600));
+    EXPECT_FALSE(wheel.hasDueTasks());
+
+    wheel.advance(origin + Milliseconds(2));
+    EXPECT_TRUE(wheel.hasDueTasks());
+}
+
+TEST(TimerWheelTest, LongDelays)
+{
+    const TimePoint origin = Clock::now();
+    TimerWheel wheel(origin);
+    std::vector<int> result;
+
+    // Beyond the range of the wheel (about 4.6 hours).
+    addTask(&wheel, origin + std::chrono::hours(10), 2, &result);
+    addTask(&wheel, origin + std::chrono::hours(1), 1, &result);
+
+    wheel.advance(origin + std::chrono::hours(1) - Milliseconds(1));
+    EXPECT_FALSE(wheel.hasDueTasks());
+
+    wheel.advance(origin + std::chrono::hours(1));
+    runDueTasks(&wheel);
+    EXPECT_EQ(result, std::vector<int>({ 1 }));
+
+    wheel.advance(origin + std::chrono::hours(10) - Milliseconds(1));
+    EXPECT_FALSE(wheel.hasDueTasks());
+
+    wheel.advance(origin + std::chrono::hours(10));
+    runDueTasks(&wheel);
+    EXPECT_EQ(result, std::vector<int>({ 1, 2 }));
+}
+
+TEST(TimerWheelTest, RandomDelays)
+{
+    const TimePoint origin = Clock::now();
+    TimerWheel wheel(origin);
+
+    std::mt19937 generator(1234);
+    std::uniform_int_distribution<int> delay(0, 20000000);
+    std::uniform_int_distribution<int> step(0, 50000);
+
+    std::vector<int> delays;
+    std::vector<int> result;
+
+    for (int i = 0; i < 10000; ++i)
+    {
+        delays.push_back(delay(generator));
+        addTask(&wheel, origin + Milliseconds(delays.back()), i, &result);
+    }
+
+    TimePoint now = origin;
+    while (!wheel.empty())
+    {
+        now += Milliseconds(step(generator));
+        wheel.advance(now);
+
+        while (wheel.hasDueTasks())
+        {
+            wheel.takeDueTask().callback();
+
+            // A task is run not earlier than its time and not later than the current time.
+            TimePoint run_time = origin + Milliseconds(delays[result.back()]);
+            ASSERT_LE(run_time, now);
+        }
+    }
+
+    ASSERT_EQ(result.size(), delays.size());
+
+    for (size_t i = 1; i < result.size(); ++i)
+        EXPECT_LE(delays[result[i - 1]], delays[result[i]]);
+}
+
+} // namespace base
@@ -0,0 +1,147 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/congestion_controller.h"
+
+#include <algorithm>
+
+namespace base {
+
+namespace {
+
+// If there are more messages in the write queue, the channel does not keep up with the stream.
+const size_t kMaxPendingMessages = 6;
+
+// If there are no more messages in the write queue, the channel has spare throughput.
+const size_t kIdlePendingMessages = 1;
+
+// The queue needs some time to drain after the parameters are lowered.
+const CongestionController::Milliseconds kDecreaseInterval { 500 };
+
+// How long the queue must stay empty before the parameters are raised.
+const CongestionController::Milliseconds kIncreaseInterval { 2000 };
+
+// The round-trip time is considered high if it exceeds twice the minimum plus this margin.
+const CongestionController::Milliseconds kRttMargin { 100 };
+
+const int kScaleFactorStep = 10;
+
+// The audio bitrate is 1/8 of the video bitrate.
+const uint32_t kAudioBitrateShare = 8;
+
+} // namespace
+
+CongestionController::CongestionController() = default;
+CongestionController::~CongestionController() = default;
+
+uint32_t CongestionController::audioBitrate() const
+{
+    return std::clamp(bitrate_ / kAudioBitrateShare, kMinAudioBitrate, kMaxAudioBitrate);
+}
+
+bool CongestionController::update(
+    const TimePoint& now, size_t pending, int speed_tx, const Milliseconds& rtt)
+{
+    if (rtt > Milliseconds::zero() && (min_rtt_ == Milliseconds::zero() || rtt < min_rtt_))
+        min_rtt_ = rtt;
+
+    if (pending > kMaxPendingMessages)
+    {
+        clear_time_.reset();
+
+        if (last_decrease_time_.has_value() && now - *last_decrease_time_ < kDecreaseInterval)
+            return false;
+
+        last_decrease_time_ = now;
+        return decrease(speed_tx);
+    }
+
+    if (pending > kIdlePendingMessages || isRttHigh(rtt))
+    {
+        // The channel is loaded, but keeps up. Hold the current parameters.
+        clear_time_.reset();
+        return false;
+    }
+
+    if (!clear_time_.has_value())
+    {
+        clear_time_ = now;
+        return false;
+    }
+
+    if (now - *clear_time_ < kIncreaseInterval)
+        return false;
+
+    clear_time_ = now;
+    return increase();
+}
+
+bool CongestionController::isRttHigh(const Milliseconds& rtt) const
+{
+    if (min_rtt_ == Milliseconds::zero())
+        return false;
+
+    return rtt > (min_rtt_ * 2) + kRttMargin;
+}
+
+bool CongestionController::decrease(int speed_tx)
+{
+    const uint32_t old_bitrate = bitrate_;
+    const Milliseconds old_capture_interval = capture_interval_;
+    const int old_scale_factor = scale_factor_;
+
+    uint64_t bitrate = bitrate_ * 7 / 10;
+    if (speed_tx > 0)
+    {
+        // The stream should fit into 90% of the measured throughput.
+        bitrate = std::min(bitrate, static_cast<uint64_t>(speed_tx) * 8 * 9 / 10 / 1000);
+    }
+
+    bitrate_ = static_cast<uint32_t>(
+        std::clamp(bitrate, static_cast<uint64_t>(kMinBitrate), static_cast<uint64_t>(kMaxBitrate)));
+
+    // The frame rate is lowered first. The resolution is lowered only when the frame rate is
+    // already at the minimum.
+    if (capture_interval_ < kMaxCaptureInterval)
+        capture_interval_ = std::min(capture_interval_ * 3 / 2, kMaxCaptureInterval);
+    else
+        scale_factor_ = std::max(scale_factor_ - kScaleFactorStep, kMinScaleFactor);
+
+    return bitrate_ != old_bitrate || capture_interval_ != old_capture_interval ||
+           scale_factor_ != old_scale_factor;
+}
+
+bool CongestionController::increase()
+{
+    const uint32_t old_bitrate = bitrate_;
+    const Milliseconds old_capture_interval = capture_interval_;
+    const int old_scale_factor = scale_factor_;
+
+    bitrate_ = std::min(std::max(bitrate_ * 5 / 4, bitrate_ + kMinBitrate / 2), kMaxBitrate);
+
+    // The parameters are restored in the reverse order.
+    if (scale_factor_ < kMaxScaleFactor)
+        scale_factor_ = std::min(scale_factor_ + kScaleFactorStep, kMaxScaleFactor);
+    else if (capture_interval_ > kMinCaptureInterval)
+        capture_interval_ = std::max(capture_interval_ * 2 / 3, kMinCaptureInterval);
+
+    return bitrate_ != old_bitrate || capture_interval_ != old_capture_interval ||
+           scale_factor_ != old_scale_factor;
+}
+
+} // namespace base
@@ -0,0 +1,89 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__NET__CONGESTION_CONTROLLER_H
+#define BASE__NET__CONGESTION_CONTROLLER_H
+
+#include "base/macros_magic.h"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace base {
+
+// Adapts the video stream to the network throughput. The controller is fed with the depth of the
+// outgoing queue, the measured send speed and the keep-alive round-trip time. When the queue
+// grows, it lowers the bitrate of the encoder and the capture rate and, as a last resort, the
+// resolution. When the queue stays empty, the parameters are restored in the reverse order.
+class CongestionController
+{
+public:
+    using Clock = std::chrono::high_resolution_clock;
+    using TimePoint = std::chrono::time_point<Clock>;
+    using Milliseconds = std::chrono::milliseconds;
+
+    CongestionController();
+    ~CongestionController();
+
+    static constexpr uint32_t kMinBitrate = 100; // kbps
+    static constexpr uint32_t kMaxBitrate = 1000; // kbps
+    static constexpr int kMinScaleFactor = 50; // %
+    static constexpr int kMaxScaleFactor = 100; // %
+    static constexpr Milliseconds kMinCaptureInterval { 40 };
+    static constexpr Milliseconds kMaxCaptureInterval { 200 };
+    static constexpr uint32_t kMinAudioBitrate = 16; // kbps
+    static constexpr uint32_t kMaxAudioBitrate = 64; // kbps
+
+    // |pending| is the number of messages in the write queue. |speed_tx| is the send speed in
+    // bytes per second (0 if unknown). |rtt| is the round-trip time (0 if unknown).
+    // Returns true if any of the parameters has changed.
+    bool update(const TimePoint& now, size_t pending, int speed_tx, const Milliseconds& rtt);
+
+    // Target bitrate of the video encoder in kilobits per second.
+    uint32_t targetBitrate() const { return bitrate_; }
+
+    // Target bitrate of the audio encoder in kilobits per second. The audio takes a small share
+    // of the video bitrate, so it degrades together with the video.
+    uint32_t audioBitrate() const;
+
+    // Interval between screen captures.
+    Milliseconds captureInterval() const { return capture_interval_; }
+
+    // Scale of the video relative to its current size in percent.
+    int scaleFactor() const { return scale_factor_; }
+
+private:
+    bool isRttHigh(const Milliseconds& rtt) const;
+    bool decrease(int speed_tx);
+    bool increase();
+
+    uint32_t bitrate_ = kMaxBitrate;
+    Milliseconds capture_interval_ = kMinCaptureInterval;
+    int scale_factor_ = kMaxScaleFactor;
+
+    Milliseconds min_rtt_ = Milliseconds::zero();
+    std::optional<TimePoint> last_decrease_time_;
+    std::optional<TimePoint> clear_time_;
+
+    DISALLOW_COPY_AND_ASSIGN(CongestionController);
+};
+
+} // namespace base
+
+#endif // BASE__NET__CONGESTION_CONTROLLER_H
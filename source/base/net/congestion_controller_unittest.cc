@@ -0,0 +1,137 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/congestion_controller.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+using Milliseconds = CongestionController::Milliseconds;
+
+const CongestionController::TimePoint kStartTime = CongestionController::Clock::now();
+
+} // namespace
+
+TEST(CongestionControllerTest, InitialState)
+{
+    CongestionController controller;
+
+    EXPECT_EQ(controller.targetBitrate(), CongestionController::kMaxBitrate);
+    EXPECT_EQ(controller.captureInterval(), CongestionController::kMinCaptureInterval);
+    EXPECT_EQ(controller.scaleFactor(), CongestionController::kMaxScaleFactor);
+    EXPECT_EQ(controller.audioBitrate(), CongestionController::kMaxAudioBitrate);
+}
+
+TEST(CongestionControllerTest, NoCongestion)
+{
+    CongestionController controller;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_FALSE(controller.update(
+            kStartTime + Milliseconds(i * 100), 0, 1024 * 1024, Milliseconds(20)));
+    }
+
+    EXPECT_EQ(controller.targetBitrate(), CongestionController::kMaxBitrate);
+    EXPECT_EQ(controller.captureInterval(), CongestionController::kMinCaptureInterval);
+    EXPECT_EQ(controller.scaleFactor(), CongestionController::kMaxScaleFactor);
+}
+
+TEST(CongestionControllerTest, Decrease)
+{
+    CongestionController controller;
+
+    // 32 kB/s is approximately 230 kbps with a margin.
+    EXPECT_TRUE(controller.update(kStartTime, 20, 32 * 1024, Milliseconds::zero()));
+    EXPECT_LE(controller.targetBitrate(), 240u);
+    EXPECT_GT(controller.captureInterval(), CongestionController::kMinCaptureInterval);
+    EXPECT_EQ(controller.scaleFactor(), CongestionController::kMaxScaleFactor);
+
+    // The queue needs time to drain before the next decrease.
+    const Milliseconds interval = controller.captureInterval();
+    EXPECT_FALSE(
+        controller.update(kStartTime + Milliseconds(100), 20, 32 * 1024, Milliseconds::zero()));
+    EXPECT_EQ(controller.captureInterval(), interval);
+
+    // The resolution is lowered only after the frame rate has reached the minimum.
+    for (int i = 1; i <= 20; ++i)
+        controller.update(kStartTime + Milliseconds(i * 500), 20, 1024, Milliseconds::zero());
+
+    EXPECT_EQ(controller.targetBitrate(), CongestionController::kMinBitrate);
+    EXPECT_EQ(controller.captureInterval(), CongestionController::kMaxCaptureInterval);
+    EXPECT_EQ(controller.scaleFactor(), CongestionController::kMinScaleFactor);
+    EXPECT_EQ(controller.audioBitrate(), CongestionController::kMinAudioBitrate);
+}
+
+TEST(CongestionControllerTest, Increase)
+{
+    CongestionController controller;
+
+    for (int i = 0; i < 20; ++i)
+        controller.update(kStartTime + Milliseconds(i * 500), 20, 1024, Milliseconds::zero());
+
+    EXPECT_EQ(controller.scaleFactor(), CongestionController::kMinScaleFactor);
+
+    CongestionController::TimePoint time = kStartTime + Milliseconds(20 * 500);
+    int last_scale_factor = controller.scaleFactor();
+
+    // The resolution is restored first.
+    for (int i = 0; i < 200 && controller.scaleFactor() < CongestionController::kMaxScaleFactor;
+         ++i)
+    {
+        time += Milliseconds(500);
+        controller.update(time, 0, 1024 * 1024, Milliseconds::zero());
+
+        EXPECT_GE(controller.scaleFactor(), last_scale_factor);
+        EXPECT_EQ(controller.captureInterval(), CongestionController::kMaxCaptureInterval);
+        last_scale_factor = controller.scaleFactor();
+    }
+
+    for (int i = 0; i < 200; ++i)
+    {
+        time += Milliseconds(500);
+        controller.update(time, 0, 1024 * 1024, Milliseconds::zero());
+    }
+
+    EXPECT_EQ(controller.targetBitrate(), CongestionController::kMaxBitrate);
+    EXPECT_EQ(controller.captureInterval(), CongestionController::kMinCaptureInterval);
+    EXPECT_EQ(controller.scaleFactor(), CongestionController::kMaxScaleFactor);
+}
+
+TEST(CongestionControllerTest, HighRtt)
+{
+    CongestionController controller;
+
+    for (int i = 0; i < 20; ++i)
+        controller.update(kStartTime + Milliseconds(i * 500), 20, 1024, Milliseconds(50));
+
+    const uint32_t bitrate = controller.targetBitrate();
+
+    // While the round-trip time is high, the parameters are not raised.
+    for (int i = 20; i < 100; ++i)
+        EXPECT_FALSE(
+            controller.update(kStartTime + Milliseconds(i * 500), 0, 1024, Milliseconds(1000)));
+
+    EXPECT_EQ(controller.targetBitrate(), bitrate);
+    EXPECT_EQ(controller.scaleFactor(), CongestionController::kMinScaleFactor);
+}
+
+} // namespace base
@@ -0,0 +1,161 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/keep_alive_scheduler.h"
+
+#include "base/logging.h"
+
+namespace base {
+
+namespace {
+
+constexpr std::chrono::seconds kTickInterval { 1 };
+
+} // namespace
+
+KeepAliveScheduler::KeepAliveScheduler(asio::io_context& io_context)
+    : io_context_(io_context),
+      timer_(io_context)
+{
+    // Nothing
+}
+
+KeepAliveScheduler::~KeepAliveScheduler()
+{
+    DCHECK_EQ(client_count_, 0u);
+
+    std::error_code ignored_code;
+    timer_.cancel(ignored_code);
+}
+
+// static
+std::shared_ptr<KeepAliveScheduler> KeepAliveScheduler::current(asio::io_context& io_context)
+{
+    thread_local std::weak_ptr<KeepAliveScheduler> instance;
+
+    std::shared_ptr<KeepAliveScheduler> scheduler = instance.lock();
+    if (!scheduler || &scheduler->io_context_ != &io_context)
+    {
+        scheduler = std::make_shared<KeepAliveScheduler>(io_context);
+        instance = scheduler;
+    }
+
+    return scheduler;
+}
+
+void KeepAliveScheduler::schedule(Client* client, const Seconds& delay)
+{
+    DCHECK(client);
+    cancel(client);
+
+    const size_t ticks = std::max(static_cast<size_t>(delay / kTickInterval), size_t(1));
+    DCHECK_LT(ticks, kSlotCount);
+
+    if (!client_count_)
+    {
+        // The wheel starts from the current time.
+        tick_time_ = Clock::now();
+    }
+
+    const size_t slot = (current_slot_ + ticks) % kSlotCount;
+
+    client->slot_ = slot;
+    client->index_ = slots_[slot].size();
+    slots_[slot].emplace_back(client);
+    ++client_count_;
+
+    startTimer();
+}
+
+void KeepAliveScheduler::cancel(Client* client)
+{
+    DCHECK(client);
+
+    if (client->slot_ == kNoSlot)
+        return;
+
+    std::vector<Client*>& slot = slots_[client->slot_];
+    DCHECK_LT(client->index_, slot.size());
+    DCHECK_EQ(slot[client->index_], client);
+
+    // The last client of the slot takes the place of the removed one.
+    Client* last = slot.back();
+    slot[client->index_] = last;
+    last->index_ = client->index_;
+    slot.pop_back();
+
+    client->slot_ = kNoSlot;
+    --client_count_;
+}
+
+void KeepAliveScheduler::startTimer()
+{
+    if (timer_active_ || !client_count_)
+        return;
+
+    timer_active_ = true;
+    timer_.expires_at(tick_time_ + kTickInterval);
+    timer_.async_wait(
+        [weak_self = weak_from_this()](const std::error_code& error_code)
+    {
+        std::shared_ptr<KeepAliveScheduler> self = weak_self.lock();
+        if (self)
+            self->onTimer(error_code);
+    });
+}
+
+void KeepAliveScheduler::onTimer(const std::error_code& error_code)
+{
+    timer_active_ = false;
+
+    if (error_code == asio::error::operation_aborted)
+        return;
+
+    // The scheduler must stay alive while the clients are called.
+    std::shared_ptr<KeepAliveScheduler> self = shared_from_this();
+
+    const Clock::time_point now = Clock::now();
+
+    // If the thread was busy, several ticks are handled at once.
+    while (tick_time_ + kTickInterval <= now)
+    {
+        tick_time_ += kTickInterval;
+        current_slot_ = (current_slot_ + 1) % kSlotCount;
+
+        std::vector<Client*>& slot = slots_[current_slot_];
+
+        // Clients can cancel each other or schedule themselves again while they are called.
+        while (!slot.empty())
+        {
+            Client* client = slot.back();
+            slot.pop_back();
+
+            client->slot_ = kNoSlot;
+            --client_count_;
+
+            client->onKeepAliveTimer();
+        }
+    }
+
+    if (!client_count_)
+        return;
+
+    startTimer();
+}
+
+} // namespace base
@@ -0,0 +1,88 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__NET__KEEP_ALIVE_SCHEDULER_H
+#define BASE__NET__KEEP_ALIVE_SCHEDULER_H
+
+#include "base/macros_magic.h"
+
+#include <asio/steady_timer.hpp>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace base {
+
+// Wakes up the keep-alive handlers of the network channels of one thread. A single timer ticks
+// once a second and calls all handlers due in that second together, so thousands of connections
+// do not need their own timers and wake-ups.
+class KeepAliveScheduler : public std::enable_shared_from_this<KeepAliveScheduler>
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Seconds = std::chrono::seconds;
+
+    class Client
+    {
+    public:
+        virtual ~Client() = default;
+        virtual void onKeepAliveTimer() = 0;
+
+    private:
+        friend class KeepAliveScheduler;
+
+        size_t slot_ = kNoSlot;
+        size_t index_ = 0;
+    };
+
+    explicit KeepAliveScheduler(asio::io_context& io_context);
+    ~KeepAliveScheduler();
+
+    // Returns the scheduler of the current thread. It exists while someone holds it.
+    static std::shared_ptr<KeepAliveScheduler> current(asio::io_context& io_context);
+
+    // Calls |client| after |delay| (rounded up to whole seconds). The previous call of the
+    // client is cancelled.
+    void schedule(Client* client, const Seconds& delay);
+    void cancel(Client* client);
+
+private:
+    static constexpr size_t kNoSlot = static_cast<size_t>(-1);
+
+    // Maximum delay is the longest keep-alive interval plus the timeout.
+    static constexpr size_t kSlotCount = 512;
+
+    void startTimer();
+    void onTimer(const std::error_code& error_code);
+
+    asio::io_context& io_context_;
+    asio::steady_timer timer_;
+    bool timer_active_ = false;
+
+    std::vector<Client*> slots_[kSlotCount];
+    size_t current_slot_ = 0;
+    size_t client_count_ = 0;
+    Clock::time_point tick_time_;
+
+    DISALLOW_COPY_AND_ASSIGN(KeepAliveScheduler);
+};
+
+} // namespace base
+
+#endif // BASE__NET__KEEP_ALIVE_SCHEDULER_H
@@ -0,0 +1,162 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/net/message_compressor.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+
+namespace base {
+
+namespace {
+
+// Fast levels are used: the data is compressed on the I/O thread of the channel.
+const int kCompressionLevel = 3;
+
+// Smaller messages are always sent as is.
+const size_t kMinMessageSize = 256;
+
+// Maximum number of messages skipped after failed compression attempts.
+const uint32_t kMaxBackoff = 64;
+
+} // namespace
+
+MessageCompressor::MessageCompressor()
+    : cstream_(ZSTD_createCStream()),
+      dstream_(ZSTD_createDStream())
+{
+    // Nothing
+}
+
+MessageCompressor::~MessageCompressor() = default;
+
+bool MessageCompressor::compress(
+    size_t lane_index, const uint8_t* in, size_t in_size, ByteArray* out)
+{
+    DCHECK_LT(lane_index, kLaneCount);
+    DCHECK(out);
+
+    Lane* lane = &lanes_[lane_index];
+
+    if (in_size < kMinMessageSize)
+        return false;
+
+    if (lane->skip_count)
+    {
+        --lane->skip_count;
+        return false;
+    }
+
+    if (!cstream_)
+        return false;
+
+    ZSTD_CCtx_reset(cstream_.get(), ZSTD_reset_session_only);
+    ZSTD_CCtx_setParameter(cstream_.get(), ZSTD_c_compressionLevel, kCompressionLevel);
+    ZSTD_CCtx_setPledgedSrcSize(cstream_.get(), in_size);
+
+    // The message is sent compressed only if it saves at least 1/8 of the size.
+    const size_t max_size = in_size - in_size / 8;
+
+    out->resize(ZSTD_compressBound(in_size));
+
+    ZSTD_inBuffer input = { in, in_size, 0 };
+    ZSTD_outBuffer output = { out->data(), out->size(), 0 };
+
+    size_t ret;
+    do
+    {
+        ret = ZSTD_compressStream2(cstream_.get(), &output, &input, ZSTD_e_end);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_WARNING) << "ZSTD_compressStream2 failed: " << ZSTD_getErrorName(ret);
+            onCompressionFailed(lane);
+            return false;
+        }
+    }
+    while (ret != 0);
+
+    if (output.pos > max_size)
+    {
+        onCompressionFailed(lane);
+        return false;
+    }
+
+    out->resize(output.pos);
+    lane->backoff = 0;
+    return true;
+}
+
+bool MessageCompressor::decompress(
+    const uint8_t* in, size_t in_size, size_t max_size, ByteArray* out)
+{
+    DCHECK(out);
+
+    if (!dstream_)
+        return false;
+
+    const unsigned long long size = ZSTD_getFrameContentSize(in, in_size);
+    if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN || size > max_size)
+    {
+        LOG(LS_ERROR) << "Invalid size of compressed message: " << size;
+        return false;
+    }
+
+    ZSTD_DCtx_reset(dstream_.get(), ZSTD_reset_session_only);
+
+    out->resize(static_cast<size_t>(size));
+
+    ZSTD_inBuffer input = { in, in_size, 0 };
+    ZSTD_outBuffer output = { out->data(), out->size(), 0 };
+
+    while (input.pos < input.size)
+    {
+        size_t ret = ZSTD_decompressStream(dstream_.get(), &output, &input);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_ERROR) << "ZSTD_decompressStream failed: " << ZSTD_getErrorName(ret);
+            return false;
+        }
+
+        // The frame is complete.
+        if (!ret)
+            break;
+
+        // The output buffer is full, but the frame is not finished.
+        if (output.pos == output.size && input.pos < input.size)
+        {
+            LOG(LS_ERROR) << "Compressed message is larger than declared";
+            return false;
+        }
+    }
+
+    if (output.pos != output.size || input.pos != input.size)
+    {
+        LOG(LS_ERROR) << "Incomplete compressed message";
+        return false;
+    }
+
+    return true;
+}
+
+void MessageCompressor::onCompressionFailed(Lane* lane)
+{
+    lane->backoff = std::clamp(lane->backoff * 2, 1u, kMaxBackoff);
+    lane->skip_count = lane->backoff;
+}
+
+} // namespace base
@@ -0,0 +1,69 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE__NET__MESSAGE_COMPRESSOR_H
+#define BASE__NET__MESSAGE_COMPRESSOR_H
+
+#include "base/macros_magic.h"
+#include "base/codec/scoped_zstd_stream.h"
+#include "base/memory/byte_array.h"
+
+namespace base {
+
+// Compresses user messages of a network channel with zstd. Each message is compressed into an
+// independent frame using the same streams, so the contexts are not allocated for every message.
+// A message is sent compressed only if it becomes noticeably smaller. When messages of some kind
+// (the channel passes the priority lane) do not compress, the compressor skips an increasing
+// number of the next messages of this kind before trying again, so already compressed data (for
+// example, video) does not waste the CPU.
+class MessageCompressor
+{
+public:
+    static constexpr size_t kLaneCount = 3;
+
+    MessageCompressor();
+    ~MessageCompressor();
+
+    // Compresses |in| to |out|. Returns false if the message must be sent uncompressed.
+    bool compress(size_t lane, const uint8_t* in, size_t in_size, ByteArray* out);
+
+    // Decompresses |in| to |out|. Returns false if the data is invalid or the decompressed size
+    // is greater than |max_size|.
+    bool decompress(const uint8_t* in, size_t in_size, size_t max_size, ByteArray* out);
+
+    // Number of next messages in the |lane| that will be sent without a compression attempt.
+    uint32_t skipCount(size_t lane) const { return lanes_[lane].skip_count; }
+
+private:
+    struct Lane
+    {
+        uint32_t skip_count = 0;
+        uint32_t backoff = 0;
+    };
+
+    void onCompressionFailed(Lane* lane);
+
+    ScopedZstdCStream cstream_;
+    ScopedZstdDStream dstream_;
+    Lane lanes_[kLaneCount];
+
+    DISALLOW_COPY_AND_ASSIGN(MessageCompressor);
+};
+
+} // namespace base
+
+#endif // BASE__NET__MESSAGE_COMPRESSOR_H
@@ -0,0 +1,138 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/net/message_compressor.h"
+
+#include <random>
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+ByteArray textMessage(size_t size)
+{
+    static const char kText[] = "2022-05-14 10:21:33.512 INFO network_channel.cc:284] Connected\n";
+
+    ByteArray message;
+    while (message.size() < size)
+        message.insert(message.end(), std::begin(kText), std::end(kText) - 1);
+
+    message.resize(size);
+    return message;
+}
+
+ByteArray randomMessage(size_t size)
+{
+    std::mt19937 engine(size);
+    std::uniform_int_distribution<int> distribution(0, 255);
+
+    ByteArray message(size);
+    for (auto& byte : message)
+        byte = static_cast<uint8_t>(distribution(engine));
+
+    return message;
+}
+
+} // namespace
+
+TEST(MessageCompressorTest, RoundTrip)
+{
+    MessageCompressor compressor;
+
+    for (size_t size : { 1024u, 64u * 1024u, 1024u * 1024u })
+    {
+        ByteArray message = textMessage(size);
+        ByteArray compressed;
+
+        ASSERT_TRUE(compressor.compress(0, message.data(), message.size(), &compressed));
+        EXPECT_LT(compressed.size(), message.size());
+
+        ByteArray decompressed;
+        ASSERT_TRUE(compressor.decompress(
+            compressed.data(), compressed.size(), message.size(), &decompressed));
+        EXPECT_EQ(decompressed, message);
+    }
+}
+
+TEST(MessageCompressorTest, SmallMessage)
+{
+    MessageCompressor compressor;
+
+    ByteArray message = textMessage(100);
+    ByteArray compressed;
+
+    EXPECT_FALSE(compressor.compress(0, message.data(), message.size(), &compressed));
+    EXPECT_EQ(compressor.skipCount(0), 0u);
+}
+
+TEST(MessageCompressorTest, Backoff)
+{
+    MessageCompressor compressor;
+
+    ByteArray random = randomMessage(4096);
+    ByteArray text = textMessage(4096);
+    ByteArray compressed;
+
+    EXPECT_FALSE(compressor.compress(2, random.data(), random.size(), &compressed));
+    EXPECT_EQ(compressor.skipCount(2), 1u);
+
+    // Other lanes are not affected.
+    EXPECT_TRUE(compressor.compress(1, text.data(), text.size(), &compressed));
+
+    // The next message is skipped without an attempt.
+    EXPECT_FALSE(compressor.compress(2, text.data(), text.size(), &compressed));
+    EXPECT_EQ(compressor.skipCount(2), 0u);
+
+    // The number of skipped messages doubles after each failure.
+    EXPECT_FALSE(compressor.compress(2, random.data(), random.size(), &compressed));
+    EXPECT_EQ(compressor.skipCount(2), 2u);
+
+    EXPECT_FALSE(compressor.compress(2, text.data(), text.size(), &compressed));
+    EXPECT_FALSE(compressor.compress(2, text.data(), text.size(), &compressed));
+
+    // A successful attempt resets the backoff.
+    EXPECT_TRUE(compressor.compress(2, text.data(), text.size(), &compressed));
+    EXPECT_FALSE(compressor.compress(2, random.data(), random.size(), &compressed));
+    EXPECT_EQ(compressor.skipCount(2), 1u);
+}
+
+TEST(MessageCompressorTest, InvalidData)
+{
+    MessageCompressor compressor;
+
+    ByteArray message = textMessage(64 * 1024);
+    ByteArray compressed;
+    ByteArray decompressed;
+
+    ASSERT_TRUE(compressor.compress(0, message.data(), message.size(), &compressed));
+
+    // The decompressed size exceeds the limit.
+    EXPECT_FALSE(compressor.decompress(
+        compressed.data(), compressed.size(), message.size() - 1, &decompressed));
+
+    // Truncated frame.
+    EXPECT_FALSE(compressor.decompress(
+        compressed.data(), compressed.size() / 2, message.size(), &decompressed));
+
+    ByteArray random = randomMessage(1024);
+    EXPECT_FALSE(compressor.decompress(
+        random.data(), random.size(), message.size(), &decompressed));
+}
+
+} // namespace base
@@ -20,26 +20,81 @@
 
 #include "base/location.h"
 #include "base/logging.h"
+#include "base/trace_event.h"
 #include "base/crypto/large_number_increment.h"
 #include "base/crypto/message_encryptor_fake.h"
 #include "base/crypto/message_decryptor_fake.h"
 #include "base/message_loop/message_loop.h"
+#include "base/memory/byte_array_pool.h"
 #include "base/message_loop/message_pump_asio.h"
 #include "base/net/network_channel_proxy.h"
 #include "base/net/tcp_keep_alive.h"
 #include "base/strings/string_printf.h"
 #include "base/strings/unicode.h"
 
-#include <asio/connect.hpp>
 #include <asio/read.hpp>
 #include <asio/write.hpp>
 
+#include <algorithm>
+#include <array>
+#include <iterator>
+
+#if defined(OS_POSIX)
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif // defined(OS_POSIX)
+
 namespace base {
 
 namespace {
 
 static const size_t kMaxMessageSize = 16 * 1024 * 1024; // 16 MB
 
+// Larger user messages are sent in parts if message chunking is enabled.
+static const size_t kMaxChunkSize = 16 * 1024; // 16 kB
+
+// Queued messages are collected into one write until the buffer reaches this size.
+static const size_t kMaxWriteSize = 64 * 1024; // 64 kB
+
+static const size_t kMinBufferCapacity = 4 * 1024; // 4 kB
+
+// Delay before the next connection attempt is started while the previous ones are still in
+// progress (RFC 8305 recommends 250 ms).
+static const std::chrono::milliseconds kConnectAttemptDelay{ 250 };
+
+// Orders the resolved addresses so that IPv6 and IPv4 addresses alternate. The family of the first
+// address (the most preferred by the resolver) goes first.
+std::vector<asio::ip::tcp::endpoint> interleaveEndpoints(
+    const asio::ip::tcp::resolver::results_type& results)
+{
+    std::vector<asio::ip::tcp::endpoint> preferred;
+    std::vector<asio::ip::tcp::endpoint> other;
+
+    for (const auto& result : results)
+    {
+        const asio::ip::tcp::endpoint& endpoint = result.endpoint();
+
+        if (preferred.empty() || endpoint.protocol() == preferred.front().protocol())
+            preferred.emplace_back(endpoint);
+        else
+            other.emplace_back(endpoint);
+    }
+
+    std::vector<asio::ip::tcp::endpoint> endpoints;
+    endpoints.reserve(preferred.size() + other.size());
+
+    for (size_t i = 0; i < std::max(preferred.size(), other.size()); ++i)
+    {
+        if (i < preferred.size())
+            endpoints.emplace_back(preferred[i]);
+
+        if (i < other.size())
+            endpoints.emplace_back(other[i]);
+    }
+
+    return endpoints;
+}
+
 int calculateSpeed(int last_speed, const std::chrono::milliseconds& duration, int64_t bytes)
 {
     static const double kAlpha = 0.1;
@@ -48,13 +103,25 @@ int calculateSpeed(int last_speed, const std::chrono::milliseconds& duration, in
         ((1.0 - kAlpha) * static_cast<double>(last_speed)));
 }
 
+// Buffers are reserved with a capacity rounded up to a power of two, so that a buffer is not
+// reallocated every time a slightly larger message is received.
+size_t bufferCapacity(size_t size)
+{
+    size_t capacity = kMinBufferCapacity;
+
+    while (capacity < size)
+        capacity <<= 1;
+
+    return capacity;
+}
+
 void resizeBuffer(ByteArray* buffer, size_t new_size)
 {
     // If the reserved buffer size is less, then increase it.
     if (buffer->capacity() < new_size)
     {
         buffer->clear();
-        buffer->reserve(new_size);
+        buffer->reserve(bufferCapacity(new_size));
     }
 
     // Change the size of the buffer.
@@ -127,7 +194,7 @@ std::u16string NetworkChannel::peerAddress() const
 
 void NetworkChannel::connect(std::u16string_view address, uint16_t port)
 {
-    if (connected_ || !resolver_)
+    if (connected_ || connect_timer_ || !resolver_)
         return;
 
     resolver_->async_resolve(local8BitFromUtf16(address), std::to_string(port),
@@ -140,21 +207,15 @@ void NetworkChannel::connect(std::u16string_view address, uint16_t port)
             return;
         }
 
-        asio::async_connect(socket_, endpoints,
-            [this](const std::error_code& error_code,
-                   const asio::ip::tcp::endpoint& /* endpoint */)
+        connect_endpoints_ = interleaveEndpoints(endpoints);
+        if (connect_endpoints_.empty())
         {
-            if (error_code)
-            {
-                onErrorOccurred(FROM_HERE, error_code);
-                return;
-            }
-
-            connected_ = true;
+            onErrorOccurred(FROM_HERE, ErrorCode::SPECIFIED_HOST_NOT_FOUND);
+            return;
+        }
 
-            if (listener_)
-                listener_->onConnected();
-        });
+        connect_timer_ = std::make_unique<asio::high_resolution_timer>(io_context_);
+        startConnectAttempt();
     });
 }
 
@@ -200,9 +261,23 @@ void NetworkChannel::resume()
     doReadSize();
 }
 
-void NetworkChannel::send(ByteArray&& buffer)
+void NetworkChannel::send(ByteArray&& buffer, Priority priority, uint32_t key)
 {
-    addWriteTask(WriteTask::Type::USER_DATA, std::move(buffer));
+    addWriteTask(WriteTask(WriteTask::Type::USER_DATA, priority, key, std::move(buffer)));
+}
+
+void NetworkChannel::setMessageChunking(bool enable)
+{
+    LOG(LS_INFO) << "Message chunking: " << enable;
+    message_chunking_ = enable;
+}
+
+void NetworkChannel::setMessageCompression(bool enable)
+{
+    LOG(LS_INFO) << "Message compression: " << enable;
+    DCHECK(!enable || message_chunking_);
+
+    message_compression_ = enable;
 }
 
 bool NetworkChannel::setNoDelay(bool enable)
@@ -222,6 +297,37 @@ bool NetworkChannel::setNoDelay(bool enable)
     return true;
 }
 
+bool NetworkChannel::isWritingMessage(uint32_t key) const
+{
+    if (!write_in_progress_)
+        return false;
+
+    return std::find(write_keys_.cbegin(), write_keys_.cend(), key) != write_keys_.cend();
+}
+
+bool NetworkChannel::setNotSentLowWatermark(size_t bytes)
+{
+#if defined(TCP_NOTSENT_LOWAT)
+    using NotSentLowWatermark = asio::detail::socket_option::integer<IPPROTO_TCP, TCP_NOTSENT_LOWAT>;
+    NotSentLowWatermark option(static_cast<int>(bytes));
+
+    asio::error_code error_code;
+    socket_.set_option(option, error_code);
+
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Failed to set not sent low watermark: "
+                      << base::utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    return true;
+#else
+    LOG(LS_INFO) << "Not sent low watermark is not supported (" << bytes << ")";
+    return false;
+#endif // defined(TCP_NOTSENT_LOWAT)
+}
+
 bool NetworkChannel::setTcpKeepAlive(bool enable,
                                      const Milliseconds& time,
                                      const Milliseconds& interval)
@@ -231,7 +337,7 @@ bool NetworkChannel::setTcpKeepAlive(bool enable,
 
 bool NetworkChannel::setOwnKeepAlive(bool enable, const Seconds& interval, const Seconds& timeout)
 {
-    if (enable && keep_alive_timer_)
+    if (enable && keep_alive_scheduler_)
     {
         LOG(LS_WARNING) << "Keep alive already active";
         return false;
@@ -253,11 +359,13 @@ bool NetworkChannel::setOwnKeepAlive(bool enable, const Seconds& interval, const
     {
         keep_alive_counter_.clear();
 
-        if (keep_alive_timer_)
+        if (keep_alive_scheduler_)
         {
-            keep_alive_timer_->cancel();
-            keep_alive_timer_.reset();
+            keep_alive_scheduler_->cancel(this);
+            keep_alive_scheduler_.reset();
         }
+
+        keep_alive_waiting_pong_ = false;
     }
     else
     {
@@ -267,15 +375,21 @@ bool NetworkChannel::setOwnKeepAlive(bool enable, const Seconds& interval, const
         keep_alive_counter_.resize(sizeof(uint32_t));
         memset(keep_alive_counter_.data(), 0, keep_alive_counter_.size());
 
-        keep_alive_timer_ = std::make_unique<asio::high_resolution_timer>(io_context_);
-        keep_alive_timer_->expires_after(keep_alive_interval_);
-        keep_alive_timer_->async_wait(
-            std::bind(&NetworkChannel::onKeepAliveInterval, this, std::placeholders::_1));
+        keep_alive_waiting_pong_ = false;
+        keep_alive_rx_ = total_rx_;
+
+        keep_alive_scheduler_ = KeepAliveScheduler::current(io_context_);
+        keep_alive_scheduler_->schedule(this, keep_alive_interval_);
     }
 
     return true;
 }
 
+void NetworkChannel::setKeepAliveOnIdleOnly(bool enable)
+{
+    keep_alive_idle_only_ = enable;
+}
+
 bool NetworkChannel::setReadBufferSize(size_t size)
 {
     asio::socket_base::receive_buffer_size option(static_cast<int>(size));
@@ -310,6 +424,41 @@ bool NetworkChannel::setWriteBufferSize(size_t size)
     return true;
 }
 
+void NetworkChannel::trimMemory()
+{
+    const bool write_idle = !write_in_progress_ && write_queue_.empty();
+    if (write_idle)
+    {
+        ByteArrayPool::release(std::move(write_buffer_));
+        write_buffer_.clear();
+        write_queue_.trim();
+
+        std::vector<EncryptTask>().swap(encrypt_tasks_);
+        std::vector<MessageEncryptor::Message>().swap(encrypt_batch_);
+    }
+
+    // The message buffers are not used while the size of the next message is being read.
+    if (state_ != ReadState::READ_SIZE)
+        return;
+
+    ByteArrayPool::release(std::move(read_buffer_));
+    read_buffer_.clear();
+    ByteArray().swap(read_header_);
+    ByteArray().swap(service_buffer_);
+    ByteArray().swap(decompress_buffer_);
+
+    // Chunks of partially received messages must be kept.
+    for (ByteArray& chunk : read_chunks_)
+    {
+        if (chunk.empty())
+            ByteArray().swap(chunk);
+    }
+
+    // Each message is compressed independently, the compression contexts can be created again.
+    if (write_idle)
+        compressor_.reset();
+}
+
 int NetworkChannel::speedRx()
 {
     TimePoint current_time = Clock::now();
@@ -393,6 +542,11 @@ std::string NetworkChannel::errorToString(ErrorCode error_code)
 
 void NetworkChannel::disconnect()
 {
+    stopConnectAttempts();
+
+    if (keep_alive_scheduler_)
+        keep_alive_scheduler_->cancel(this);
+
     if (!connected_)
         return;
 
@@ -445,6 +599,100 @@ void NetworkChannel::onErrorOccurred(const Location& location, ErrorCode error_c
     }
 }
 
+void NetworkChannel::startConnectAttempt()
+{
+    size_t index = connect_sockets_.size();
+    if (index >= connect_endpoints_.size())
+        return;
+
+    LOG(LS_INFO) << "Connection attempt to "
+                 << connect_endpoints_[index].address().to_string() << " started";
+
+    connect_sockets_.emplace_back(std::make_unique<asio::ip::tcp::socket>(io_context_));
+    ++pending_attempts_;
+
+    connect_sockets_.back()->async_connect(connect_endpoints_[index],
+        [this, index](const std::error_code& error_code)
+    {
+        onConnectAttempt(index, error_code);
+    });
+
+    // If there are more addresses, the next attempt is started when this one fails or when it
+    // has not completed in time.
+    if (index + 1 < connect_endpoints_.size())
+    {
+        connect_timer_->expires_after(kConnectAttemptDelay);
+        connect_timer_->async_wait(
+            std::bind(&NetworkChannel::onConnectAttemptDelay, this, std::placeholders::_1));
+    }
+}
+
+void NetworkChannel::onConnectAttempt(size_t index, const std::error_code& error_code)
+{
+    // The attempt was cancelled. The channel may be already destroyed.
+    if (error_code == asio::error::operation_aborted)
+        return;
+
+    --pending_attempts_;
+
+    if (error_code)
+    {
+        LOG(LS_INFO) << "Connection attempt to "
+                     << connect_endpoints_[index].address().to_string() << " failed: "
+                     << utf16FromLocal8Bit(error_code.message());
+
+        last_connect_error_ = error_code;
+        connect_sockets_[index].reset();
+
+        if (connect_sockets_.size() < connect_endpoints_.size())
+        {
+            // Do not wait for the delay to expire if the attempt failed.
+            std::error_code ignored_code;
+            connect_timer_->cancel(ignored_code);
+            startConnectAttempt();
+        }
+        else if (!pending_attempts_)
+        {
+            std::error_code last_error = last_connect_error_;
+            stopConnectAttempts();
+            onErrorOccurred(FROM_HERE, last_error);
+        }
+        return;
+    }
+
+    socket_ = std::move(*connect_sockets_[index]);
+    stopConnectAttempts();
+
+    connected_ = true;
+
+    if (listener_)
+        listener_->onConnected();
+}
+
+void NetworkChannel::onConnectAttemptDelay(const std::error_code& error_code)
+{
+    if (error_code == asio::error::operation_aborted)
+        return;
+
+    startConnectAttempt();
+}
+
+void NetworkChannel::stopConnectAttempts()
+{
+    if (connect_timer_)
+    {
+        std::error_code ignored_code;
+        connect_timer_->cancel(ignored_code);
+        connect_timer_.reset();
+    }
+
+    // Destroying the sockets cancels the attempts that are still in progress.
+    connect_sockets_.clear();
+    connect_endpoints_.clear();
+    pending_attempts_ = 0;
+    last_connect_error_.clear();
+}
+
 void NetworkChannel::onMessageWritten()
 {
     if (listener_)
@@ -453,44 +701,196 @@ void NetworkChannel::onMessageWritten()
 
 void NetworkChannel::onMessageReceived()
 {
-    resizeBuffer(&decrypt_buffer_, decryptor_->decryptedDataSize(read_buffer_.size()));
+    TRACE_EVENT("NetworkChannel::onMessageReceived");
 
-    if (!decryptor_->decrypt(read_buffer_.data(), read_buffer_.size(), decrypt_buffer_.data()))
+    if (!decryptor_->decryptInPlace(read_header_.data(), read_buffer_.data(), read_buffer_.size()))
     {
         onErrorOccurred(FROM_HERE, ErrorCode::ACCESS_DENIED);
         return;
     }
 
+    if (message_chunking_)
+    {
+        onChunkReceived();
+        return;
+    }
+
     if (listener_)
-        listener_->onMessageReceived(decrypt_buffer_);
+        listener_->onMessageReceived(read_buffer_);
 }
 
-void NetworkChannel::addWriteTask(WriteTask::Type type, ByteArray&& data)
+void NetworkChannel::onChunkReceived()
 {
-    const bool schedule_write = write_queue_.empty();
+    if (read_buffer_.empty())
+    {
+        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+        return;
+    }
 
-    // Add the buffer to the queue for sending.
-    write_queue_.emplace(type, std::move(data));
+    const uint8_t flags = read_buffer_.front();
+    const size_t lane = flags & CHUNK_PRIORITY_MASK;
 
-    if (schedule_write)
-        doWrite();
+    if (lane >= std::size(read_chunks_))
+    {
+        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+        return;
+    }
+
+    ByteArray& message = read_chunks_[lane];
+
+    if (message.size() + read_buffer_.size() - 1 > kMaxMessageSize)
+    {
+        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+        return;
+    }
+
+    if (!(flags & CHUNK_FINAL))
+    {
+        // Wait for the next parts of the message.
+        message.insert(message.end(), read_buffer_.begin() + 1, read_buffer_.end());
+        return;
+    }
+
+    if (message.empty())
+    {
+        // The message was sent in one chunk.
+        read_buffer_.erase(read_buffer_.begin());
+        notifyMessageReceived(flags, read_buffer_);
+    }
+    else
+    {
+        message.insert(message.end(), read_buffer_.begin() + 1, read_buffer_.end());
+
+        // The lane must be empty before the notification.
+        read_buffer_.swap(message);
+        message.clear();
+
+        notifyMessageReceived(flags, read_buffer_);
+    }
 }
 
-void NetworkChannel::doWrite()
+void NetworkChannel::compressMessage(WriteTask* task)
 {
-    const WriteTask& task = write_queue_.front();
-    const ByteArray& source_buffer = task.data();
+    if (!compressor_)
+        compressor_ = std::make_unique<MessageCompressor>();
+
+    const ByteArray& source_buffer = task->data();
+    ByteArray compressed;
 
-    if (source_buffer.empty())
+    if (compressor_->compress(static_cast<size_t>(task->priority()),
+                              source_buffer.data(), source_buffer.size(), &compressed))
+    {
+        task->setCompressedData(std::move(compressed));
+    }
+}
+
+void NetworkChannel::notifyMessageReceived(uint8_t flags, const ByteArray& buffer)
+{
+    if (!(flags & CHUNK_COMPRESSED))
+    {
+        if (listener_)
+            listener_->onMessageReceived(buffer);
+        return;
+    }
+
+    if (!compressor_)
+        compressor_ = std::make_unique<MessageCompressor>();
+
+    if (!compressor_->decompress(
+            buffer.data(), buffer.size(), kMaxMessageSize, &decompress_buffer_))
     {
         onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
         return;
     }
 
-    if (task.type() == WriteTask::Type::USER_DATA)
+    if (listener_)
+        listener_->onMessageReceived(decompress_buffer_);
+}
+
+void NetworkChannel::addWriteTask(WriteTask&& task)
+{
+    // Add the buffer to the queue for sending.
+    write_queue_.push(std::move(task));
+
+    // If the previous write has not been completed yet, the message will be sent after it.
+    if (!write_in_progress_)
+        doWrite();
+}
+
+void NetworkChannel::doWrite()
+{
+    DCHECK(!write_in_progress_);
+    DCHECK(!write_queue_.empty());
+    TRACE_EVENT("NetworkChannel::doWrite");
+
+    // The buffer keeps its capacity between writes.
+    write_buffer_.clear();
+    write_message_count_ = 0;
+    write_keys_.clear();
+    encrypt_tasks_.clear();
+
+    // Small messages are collected into one buffer and sent with a single write operation.
+    while (!write_queue_.empty() && write_buffer_.size() < kMaxWriteSize)
     {
+        WriteTask& task = write_queue_.front();
+
+        if (message_compression_ && task.type() == WriteTask::Type::USER_DATA &&
+            !task.isCompressed() && !write_queue_.frontOffset())
+        {
+            compressMessage(&task);
+        }
+
+        const ByteArray& source_buffer = task.data();
+
+        if (source_buffer.empty())
+        {
+            onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+            return;
+        }
+
+        if (task.type() != WriteTask::Type::USER_DATA)
+        {
+            DCHECK_EQ(task.type(), WriteTask::Type::SERVICE_DATA);
+
+            // Service data does not need encryption. Copy the source buffer.
+            write_buffer_.insert(write_buffer_.end(), source_buffer.begin(), source_buffer.end());
+            write_queue_.pop();
+            continue;
+        }
+
+        const uint8_t* data = source_buffer.data();
+        size_t data_size = source_buffer.size();
+        size_t chunk_end = data_size;
+        uint8_t chunk_flags = 0;
+
+        if (message_chunking_)
+        {
+            if (data_size > kMaxMessageSize)
+            {
+                onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+                return;
+            }
+
+            const size_t offset = write_queue_.frontOffset();
+            const size_t chunk_size = std::min(data_size - offset, kMaxChunkSize);
+
+            chunk_end = offset + chunk_size;
+
+            chunk_flags = static_cast<uint8_t>(task.priority()) & CHUNK_PRIORITY_MASK;
+            if (chunk_end == data_size)
+                chunk_flags |= CHUNK_FINAL;
+            if (task.isCompressed())
+                chunk_flags |= CHUNK_COMPRESSED;
+
+            data += offset;
+            data_size = chunk_size;
+        }
+
+        // The chunk consists of the flags and a part of the message.
+        const size_t plain_size = data_size + (message_chunking_ ? 1 : 0);
+
         // Calculate the size of the encrypted message.
-        const size_t target_data_size = encryptor_->encryptedDataSize(source_buffer.size());
+        const size_t target_data_size = encryptor_->encryptedDataSize(plain_size);
 
         if (target_data_size > kMaxMessageSize)
         {
@@ -500,30 +900,61 @@ void NetworkChannel::doWrite()
 
         asio::const_buffer variable_size = variable_size_writer_.variableSize(target_data_size);
 
-        resizeBuffer(&write_buffer_, variable_size.size() + target_data_size);
+        const size_t message_offset = write_buffer_.size() + variable_size.size();
+        write_buffer_.resize(message_offset + target_data_size);
 
         // Copy the size of the message to the buffer.
-        memcpy(write_buffer_.data(), variable_size.data(), variable_size.size());
+        memcpy(write_buffer_.data() + message_offset - variable_size.size(),
+               variable_size.data(), variable_size.size());
+
+        // The plain text is placed at the end of the message space and encrypted in place.
+        uint8_t* message = write_buffer_.data() + message_offset;
+        uint8_t* plain = message + (target_data_size - plain_size);
+
+        if (message_chunking_)
+            plain[0] = chunk_flags;
+        memcpy(plain + (plain_size - data_size), data, data_size);
 
-        // Encrypt the message.
-        if (!encryptor_->encrypt(source_buffer.data(),
-                                 source_buffer.size(),
-                                 write_buffer_.data() + variable_size.size()))
+        encrypt_tasks_.push_back(
+            { message_offset, message_offset + (target_data_size - plain_size), plain_size });
+
+        if (task.key())
+            write_keys_.push_back(task.key());
+
+        if (chunk_end < source_buffer.size())
         {
-            onErrorOccurred(FROM_HERE, ErrorCode::ACCESS_DENIED);
-            return;
+            // Only a part of the message is sent. A message with a higher priority can be sent
+            // before the next part.
+            write_queue_.suspend(chunk_end);
+            break;
         }
+
+        // The message leaves the queue as soon as it is in the write buffer.
+        write_queue_.pop();
+        ++write_message_count_;
     }
-    else
+
+    // Encrypt all messages of the buffer with one call.
+    if (!encrypt_tasks_.empty())
     {
-        DCHECK_EQ(task.type(), WriteTask::Type::SERVICE_DATA);
+        encrypt_batch_.clear();
 
-        resizeBuffer(&write_buffer_, source_buffer.size());
+        for (const EncryptTask& task : encrypt_tasks_)
+        {
+            encrypt_batch_.push_back({ write_buffer_.data() + task.plain_offset,
+                                       task.plain_size,
+                                       write_buffer_.data() + task.message_offset });
+        }
 
-        // Service data does not need encryption. Copy the source buffer.
-        memcpy(write_buffer_.data(), source_buffer.data(), source_buffer.size());
+        if (!encryptor_->encryptBatch(encrypt_batch_.data(), encrypt_batch_.size()))
+        {
+            onErrorOccurred(FROM_HERE, ErrorCode::ACCESS_DENIED);
+            return;
+        }
     }
 
+    write_in_progress_ = true;
+
     // Send the buffer to the recipient.
     asio::async_write(socket_,
                       asio::buffer(write_buffer_.data(), write_buffer_.size()),
@@ -541,23 +972,26 @@ void NetworkChannel::onWrite(const std::error_code& error_code, size_t bytes_tra
         return;
     }
 
-    DCHECK(!write_queue_.empty());
+    DCHECK(write_in_progress_);
 
     // Update TX statistics.
     addTxBytes(bytes_transferred);
 
-    WriteTask::Type task_type = write_queue_.front().type();
+    write_in_progress_ = false;
+    write_keys_.clear();
 
-    // Delete the sent message from the queue.
-    write_queue_.pop();
+    // Take the messages sent from other threads.
+    proxy_->reloadWriteQueue(&write_queue_);
 
-    // If the queue is not empty, then we send the following message.
-    bool schedule_write = !write_queue_.empty() || proxy_->reloadWriteQueue(&write_queue_);
+    // Listeners can send new messages from the notification. They are written after the
+    // notifications of the current write.
+    const size_t message_count = write_message_count_;
+    write_message_count_ = 0;
 
-    if (task_type == WriteTask::Type::USER_DATA)
+    for (size_t i = 0; i < message_count; ++i)
         onMessageWritten();
 
-    if (schedule_write)
+    if (!write_in_progress_ && !write_queue_.empty())
         doWrite();
 }
 
@@ -612,11 +1046,27 @@ void NetworkChannel::onReadSize(const std::error_code& error_code, size_t bytes_
 
 void NetworkChannel::doReadUserData(size_t length)
 {
-    resizeBuffer(&read_buffer_, length);
+    const size_t message_size = decryptor_->decryptedDataSize(length);
+    if (message_size > length)
+    {
+        onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
+        return;
+    }
+
+    // The header of the encrypted message is read separately. The rest of the message is
+    // decrypted in place and passed to the listener from the same buffer.
+    read_header_.resize(length - message_size);
+    resizeBuffer(&read_buffer_, message_size);
+
+    const std::array<asio::mutable_buffer, 2> buffers =
+    {
+        asio::buffer(read_header_.data(), read_header_.size()),
+        asio::buffer(read_buffer_.data(), read_buffer_.size())
+    };
 
     state_ = ReadState::READ_USER_DATA;
     asio::async_read(socket_,
-                     asio::buffer(read_buffer_.data(), read_buffer_.size()),
+                     buffers,
                      std::bind(&NetworkChannel::onReadUserData,
                                this,
                                std::placeholders::_1,
@@ -636,7 +1086,7 @@ void NetworkChannel::onReadUserData(const std::error_code& error_code, size_t by
     // Update RX statistics.
     addRxBytes(bytes_transferred);
 
-    DCHECK_EQ(bytes_transferred, read_buffer_.size());
+    DCHECK_EQ(bytes_transferred, read_header_.size() + read_buffer_.size());
 
     if (paused_)
     {
@@ -657,11 +1107,11 @@ void NetworkChannel::onReadUserData(const std::error_code& error_code, size_t by
 
 void NetworkChannel::doReadServiceHeader()
 {
-    resizeBuffer(&read_buffer_, sizeof(ServiceHeader));
+    resizeBuffer(&service_buffer_, sizeof(ServiceHeader));
 
     state_ = ReadState::READ_SERVICE_HEADER;
     asio::async_read(socket_,
-                     asio::buffer(read_buffer_.data(), read_buffer_.size()),
+                     asio::buffer(service_buffer_.data(), service_buffer_.size()),
                      std::bind(&NetworkChannel::onReadServiceHeader,
                                this,
                                std::placeholders::_1,
@@ -671,7 +1121,7 @@ void NetworkChannel::doReadServiceHeader()
 void NetworkChannel::onReadServiceHeader(const std::error_code& error_code, size_t bytes_transferred)
 {
     DCHECK_EQ(state_, ReadState::READ_SERVICE_HEADER);
-    DCHECK_EQ(read_buffer_.size(), sizeof(ServiceHeader));
+    DCHECK_EQ(service_buffer_.size(), sizeof(ServiceHeader));
 
     if (error_code)
     {
@@ -679,12 +1129,12 @@ void NetworkChannel::onReadServiceHeader(const std::error_code& error_code, size
         return;
     }
 
-    DCHECK_EQ(bytes_transferred, read_buffer_.size());
+    DCHECK_EQ(bytes_transferred, service_buffer_.size());
 
     // Update RX statistics.
     addRxBytes(bytes_transferred);
 
-    ServiceHeader* header = reinterpret_cast<ServiceHeader*>(read_buffer_.data());
+    ServiceHeader* header = reinterpret_cast<ServiceHeader*>(service_buffer_.data());
     if (header->length > kMaxMessageSize)
     {
         onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
@@ -711,17 +1161,17 @@ void NetworkChannel::onReadServiceHeader(const std::error_code& error_code, size
 
 void NetworkChannel::doReadServiceData(size_t length)
 {
-    DCHECK_EQ(read_buffer_.size(), sizeof(ServiceHeader));
+    DCHECK_EQ(service_buffer_.size(), sizeof(ServiceHeader));
     DCHECK_EQ(state_, ReadState::READ_SERVICE_HEADER);
     DCHECK_GT(length, 0u);
 
-    read_buffer_.resize(read_buffer_.size() + length);
+    service_buffer_.resize(service_buffer_.size() + length);
 
     // Now we read the data after the header.
     state_ = ReadState::READ_SERVICE_DATA;
     asio::async_read(socket_,
-                     asio::buffer(read_buffer_.data() + sizeof(ServiceHeader),
-                                  read_buffer_.size() - sizeof(ServiceHeader)),
+                     asio::buffer(service_buffer_.data() + sizeof(ServiceHeader),
+                                  service_buffer_.size() - sizeof(ServiceHeader)),
                      std::bind(&NetworkChannel::onReadServiceData,
                                this,
                                std::placeholders::_1,
@@ -731,7 +1181,7 @@ void NetworkChannel::doReadServiceData(size_t length)
 void NetworkChannel::onReadServiceData(const std::error_code& error_code, size_t bytes_transferred)
 {
     DCHECK_EQ(state_, ReadState::READ_SERVICE_DATA);
-    DCHECK_GT(read_buffer_.size(), sizeof(ServiceHeader));
+    DCHECK_GT(service_buffer_.size(), sizeof(ServiceHeader));
 
     if (error_code)
     {
@@ -743,9 +1193,9 @@ void NetworkChannel::onReadServiceData(const std::error_code& error_code, size_t
     addRxBytes(bytes_transferred);
 
     // Incoming buffer contains a service header.
-    ServiceHeader* header = reinterpret_cast<ServiceHeader*>(read_buffer_.data());
+    ServiceHeader* header = reinterpret_cast<ServiceHeader*>(service_buffer_.data());
 
-    DCHECK_EQ(bytes_transferred, read_buffer_.size() - sizeof(ServiceHeader));
+    DCHECK_EQ(bytes_transferred, service_buffer_.size() - sizeof(ServiceHeader));
     DCHECK_LE(header->length, kMaxMessageSize);
 
     if (header->type == KEEP_ALIVE)
@@ -754,12 +1204,12 @@ void NetworkChannel::onReadServiceData(const std::error_code& error_code, size_t
         {
             // Send pong.
             sendKeepAlive(KEEP_ALIVE_PONG,
-                          read_buffer_.data() + sizeof(ServiceHeader),
-                          read_buffer_.size() - sizeof(ServiceHeader));
+                          service_buffer_.data() + sizeof(ServiceHeader),
+                          service_buffer_.size() - sizeof(ServiceHeader));
         }
         else
         {
-            if (read_buffer_.size() < (sizeof(ServiceHeader) + header->length))
+            if (service_buffer_.size() < (sizeof(ServiceHeader) + header->length))
             {
                 onErrorOccurred(FROM_HERE, ErrorCode::INVALID_PROTOCOL);
                 return;
@@ -772,7 +1222,7 @@ void NetworkChannel::onReadServiceData(const std::error_code& error_code, size_t
             }
 
             // Pong must contain the same data as ping.
-            if (memcmp(read_buffer_.data() + sizeof(ServiceHeader),
+            if (memcmp(service_buffer_.data() + sizeof(ServiceHeader),
                        keep_alive_counter_.data(),
                        keep_alive_counter_.size()) != 0)
             {
@@ -780,17 +1230,14 @@ void NetworkChannel::onReadServiceData(const std::error_code& error_code, size_t
                 return;
             }
 
-            if (DCHECK_IS_ON())
-            {
-                Milliseconds ping_time = std::chrono::duration_cast<Milliseconds>(
-                    Clock::now() - keep_alive_timestamp_);
+            round_trip_time_ = std::chrono::duration_cast<Milliseconds>(
+                Clock::now() - keep_alive_timestamp_);
 
-                DLOG(LS_INFO) << "Ping result: " << ping_time.count() << " ms ("
-                              << keep_alive_counter_.size() << " bytes)";
-            }
+            DLOG(LS_INFO) << "Ping result: " << round_trip_time_.count() << " ms ("
+                          << keep_alive_counter_.size() << " bytes)";
 
             // The user can disable keep alive. Restart the timer only if keep alive is enabled.
-            if (keep_alive_timer_)
+            if (keep_alive_scheduler_)
             {
                 DCHECK(!keep_alive_counter_.empty());
 
@@ -798,9 +1245,9 @@ void NetworkChannel::onReadServiceData(const std::error_code& error_code, size_t
                 largeNumberIncrement(&keep_alive_counter_);
 
                 // Restart keep alive timer.
-                keep_alive_timer_->expires_after(keep_alive_interval_);
-                keep_alive_timer_->async_wait(
-                    std::bind(&NetworkChannel::onKeepAliveInterval, this, std::placeholders::_1));
+                keep_alive_waiting_pong_ = false;
+                keep_alive_rx_ = total_rx_;
+                keep_alive_scheduler_->schedule(this, keep_alive_interval_);
             }
         }
     }
@@ -813,50 +1260,36 @@ void NetworkChannel::onReadServiceData(const std::error_code& error_code, size_t
     doReadSize();
 }
 
-void NetworkChannel::onKeepAliveInterval(const std::error_code& error_code)
+void NetworkChannel::onKeepAliveTimer()
 {
-    if (error_code == asio::error::operation_aborted)
-        return;
-
-    DCHECK(keep_alive_timer_);
+    DCHECK(keep_alive_scheduler_);
 
-    if (error_code)
+    if (keep_alive_waiting_pong_)
     {
-        LOG(LS_ERROR) << "Keep alive timer error: " << utf16FromLocal8Bit(error_code.message());
-
-        // Restarting the timer.
-        keep_alive_timer_->expires_after(keep_alive_interval_);
-        keep_alive_timer_->async_wait(
-            std::bind(&NetworkChannel::onKeepAliveInterval, this, std::placeholders::_1));
+        // No response came within the specified period of time. We forcibly terminate the
+        // connection.
+        onErrorOccurred(FROM_HERE, ErrorCode::SOCKET_TIMEOUT);
+        return;
     }
-    else
-    {
-        // Save sending time.
-        keep_alive_timestamp_ = Clock::now();
-
-        // Send ping.
-        sendKeepAlive(KEEP_ALIVE_PING, keep_alive_counter_.data(), keep_alive_counter_.size());
 
-        // If a response is not received within the specified interval, the connection will be
-        // terminated.
-        keep_alive_timer_->expires_after(keep_alive_timeout_);
-        keep_alive_timer_->async_wait(
-            std::bind(&NetworkChannel::onKeepAliveTimeout, this, std::placeholders::_1));
+    if (keep_alive_idle_only_ && total_rx_ != keep_alive_rx_)
+    {
+        // The peer is alive, the ping is not needed.
+        keep_alive_rx_ = total_rx_;
+        keep_alive_scheduler_->schedule(this, keep_alive_interval_);
+        return;
     }
-}
 
-void NetworkChannel::onKeepAliveTimeout(const std::error_code& error_code)
-{
-    if (error_code == asio::error::operation_aborted)
-        return;
+    // Save sending time.
+    keep_alive_timestamp_ = Clock::now();
 
-    if (error_code)
-    {
-        LOG(LS_ERROR) << "Keep alive timer error: " << utf16FromLocal8Bit(error_code.message());
-    }
+    // Send ping.
+    sendKeepAlive(KEEP_ALIVE_PING, keep_alive_counter_.data(), keep_alive_counter_.size());
 
-    // No response came within the specified period of time. We forcibly terminate the connection.
-    onErrorOccurred(FROM_HERE, ErrorCode::SOCKET_TIMEOUT);
+    // If a response is not received within the specified interval, the connection will be
+    // terminated.
+    keep_alive_waiting_pong_ = true;
+    keep_alive_scheduler_->schedule(this, keep_alive_timeout_);
 }
 
 void NetworkChannel::sendKeepAlive(uint8_t flags, const void* data, size_t size)
@@ -879,7 +1312,8 @@ void NetworkChannel::sendKeepAlive(uint8_t flags, const void* data, size_t size)
     memcpy(buffer.data() + sizeof(uint8_t) + sizeof(header), data, size);
 
     // Add a task to the queue.
-    addWriteTask(WriteTask::Type::SERVICE_DATA, std::move(buffer));
+    addWriteTask(WriteTask(WriteTask::Type::SERVICE_DATA,
+                           WriteTask::Priority::HIGH, 0, std::move(buffer)));
 }
 
 void NetworkChannel::addTxBytes(size_t bytes_count)
@@ -19,34 +19,37 @@
 #ifndef BASE__NET__NETWORK_CHANNEL_H
 #define BASE__NET__NETWORK_CHANNEL_H
 
+#include "base/crypto/message_encryptor.h"
 #include "base/memory/byte_array.h"
+#include "base/net/keep_alive_scheduler.h"
+#include "base/net/message_compressor.h"
 #include "base/net/variable_size.h"
-#include "base/net/write_task.h"
+#include "base/net/write_queue.h"
 
 #include <asio/ip/tcp.hpp>
 #include <asio/high_resolution_timer.hpp>
 
-#include <queue>
+#include <vector>
 
 namespace base {
 
 class NetworkChannelProxy;
 class Location;
-class MessageEncryptor;
 class MessageDecryptor;
 class NetworkServer;
 
-class NetworkChannel
+class NetworkChannel : private KeepAliveScheduler::Client
 {
 public:
     // Constructor available for client.
     NetworkChannel();
-    ~NetworkChannel();
+    ~NetworkChannel() override;
 
     using Clock = std::chrono::high_resolution_clock;
     using TimePoint = std::chrono::time_point<Clock>;
     using Milliseconds = std::chrono::milliseconds;
     using Seconds = std::chrono::seconds;
+    using Priority = WriteTask::Priority;
 
     enum class ErrorCode
     {
@@ -111,6 +114,9 @@ public:
     std::u16string peerAddress() const;
 
     // Connects to a host at the specified address and port.
+    // If the name resolves to several addresses, connection attempts are started one after another
+    // with a short delay without waiting for the previous attempts to fail (alternating IPv6 and
+    // IPv4 addresses). The first established connection is used, the rest are closed.
     void connect(std::u16string_view address, uint16_t port);
 
     // Returns true if the channel is connected and false if not connected.
@@ -130,11 +136,29 @@ public:
 
     // Sending a message. The method call is thread safe. After the call, the message will be added
     // to the queue to be sent.
-    void send(ByteArray&& buffer);
+    // Messages with a higher |priority| are sent before the queued messages with a lower priority.
+    // If |key| is not zero, the message replaces a queued message with the same key that has not
+    // been sent yet.
+    void send(ByteArray&& buffer, Priority priority = Priority::NORMAL, uint32_t key = 0);
+
+    // Returns true if a message with the |key| is waiting in the queue. The message that is being
+    // written at the moment is not taken into account.
+    bool hasQueuedMessage(uint32_t key) const { return write_queue_.contains(key); }
+
+    // Returns true if a message with the |key| has left the queue and is being written to the
+    // socket. With the not sent low watermark the write completes only when the kernel is close to
+    // sending everything, so the sender can wait for it and make the next message from fresh data.
+    bool isWritingMessage(uint32_t key) const;
 
     // Disable or enable the algorithm of Nagle.
     bool setNoDelay(bool enable);
 
+    // Limits the amount of unsent data that the kernel keeps in the socket send buffer. The
+    // messages stay in the priority queue of the channel instead, so input and control messages
+    // are not stuck behind megabytes of already written video data on a slow link. Returns false
+    // if the platform does not support the option (TCP_NOTSENT_LOWAT).
+    bool setNotSentLowWatermark(size_t bytes);
+
     // Enables or disables sending keep alive packets.
     // If the |enable| is set to true, TCP keep-alive is enabled. If |enable| is false, then
     // disabled and |time| and |interval| are ignored.
@@ -149,14 +173,38 @@ public:
                          const Seconds& interval = Seconds(45),
                          const Seconds& timeout = Seconds(15));
 
+    // If enabled, a ping is sent only when nothing was received from the peer during the keep
+    // alive interval. Saves traffic and wake-ups for servers with many connections, but the round
+    // trip time is not measured while the channel is busy.
+    void setKeepAliveOnIdleOnly(bool enable);
+
+    // Enables or disables splitting of user messages into chunks. The chunks of the messages with
+    // different priorities are interleaved, so a large message does not delay the messages with a
+    // higher priority. Both peers must enable it before sending of user messages (supported by
+    // version 2.3.0+).
+    void setMessageChunking(bool enable);
+
+    // Enables or disables compression of outgoing user messages. Messages are compressed only if
+    // they become noticeably smaller. Requires message chunking. Compressed messages from the peer
+    // are always accepted when message chunking is enabled.
+    void setMessageCompression(bool enable);
+
     bool setReadBufferSize(size_t size);
     bool setWriteBufferSize(size_t size);
 
+    // Frees the buffers and contexts that are not in use right now. They are allocated again by
+    // the next message. Used for connections that stay idle for a long time.
+    void trimMemory();
+
     int64_t totalRx() const { return total_rx_; }
     int64_t totalTx() const { return total_tx_; }
     int speedRx();
     int speedTx();
 
+    // Returns the round-trip time measured by the last keep-alive ping. If the own keep-alive is
+    // disabled or no response has been received yet, zero is returned.
+    Milliseconds roundTripTime() const { return round_trip_time_; }
+
     // Converts an error code to a human readable string.
     // Does not support localization. Used for logs.
     static std::string errorToString(ErrorCode error_code);
@@ -196,6 +244,13 @@ private:
         KEEP_ALIVE_PING = 1
     };
 
+    enum ChunkFlags
+    {
+        CHUNK_PRIORITY_MASK = 0x03, // Priority of the message (the lane of the chunk).
+        CHUNK_COMPRESSED = 0x40,    // The message is compressed with zstd.
+        CHUNK_FINAL = 0x80          // The last chunk of the message.
+    };
+
     struct ServiceHeader
     {
         uint8_t type;      // Type of service packet (see ServiceDataType).
@@ -207,10 +262,18 @@ private:
 
     void onErrorOccurred(const Location& location, const std::error_code& error_code);
     void onErrorOccurred(const Location& location, ErrorCode error_code);
+
+    void startConnectAttempt();
+    void onConnectAttempt(size_t index, const std::error_code& error_code);
+    void onConnectAttemptDelay(const std::error_code& error_code);
+    void stopConnectAttempts();
     void onMessageWritten();
     void onMessageReceived();
+    void onChunkReceived();
+    void notifyMessageReceived(uint8_t flags, const ByteArray& buffer);
+    void compressMessage(WriteTask* task);
 
-    void addWriteTask(WriteTask::Type type, ByteArray&& data);
+    void addWriteTask(WriteTask&& task);
 
     void doWrite();
     void onWrite(const std::error_code& error_code, size_t bytes_transferred);
@@ -227,8 +290,9 @@ private:
     void doReadServiceData(size_t length);
     void onReadServiceData(const std::error_code& error_code, size_t bytes_transferred);
 
-    void onKeepAliveInterval(const std::error_code& error_code);
-    void onKeepAliveTimeout(const std::error_code& error_code);
+    // KeepAliveScheduler::Client implementation.
+    void onKeepAliveTimer() override;
+
     void sendKeepAlive(uint8_t flags, const void* data, size_t size);
 
     void addTxBytes(size_t bytes_count);
@@ -239,11 +303,22 @@ private:
     asio::ip::tcp::socket socket_;
     std::unique_ptr<asio::ip::tcp::resolver> resolver_;
 
-    std::unique_ptr<asio::high_resolution_timer> keep_alive_timer_;
+    // Addresses to connect to and the sockets of the connection attempts started so far.
+    std::vector<asio::ip::tcp::endpoint> connect_endpoints_;
+    std::vector<std::unique_ptr<asio::ip::tcp::socket>> connect_sockets_;
+    std::unique_ptr<asio::high_resolution_timer> connect_timer_;
+    size_t pending_attempts_ = 0;
+    std::error_code last_connect_error_;
+
+    std::shared_ptr<KeepAliveScheduler> keep_alive_scheduler_;
+    bool keep_alive_waiting_pong_ = false;
+    bool keep_alive_idle_only_ = false;
+    int64_t keep_alive_rx_ = 0;
     Seconds keep_alive_interval_;
     Seconds keep_alive_timeout_;
     ByteArray keep_alive_counter_;
     TimePoint keep_alive_timestamp_;
+    Milliseconds round_trip_time_ = Milliseconds::zero();
 
     Listener* listener_ = nullptr;
     bool connected_ = false;
@@ -252,14 +327,41 @@ private:
     std::unique_ptr<MessageEncryptor> encryptor_;
     std::unique_ptr<MessageDecryptor> decryptor_;
 
-    std::queue<WriteTask> write_queue_;
+    WriteQueue write_queue_;
     VariableSizeWriter variable_size_writer_;
     ByteArray write_buffer_;
+    bool write_in_progress_ = false;
+
+    // Number of user messages completely placed into |write_buffer_|.
+    size_t write_message_count_ = 0;
+
+    // Non-zero keys of the messages (or their chunks) in |write_buffer_|.
+    std::vector<uint32_t> write_keys_;
+
+    // Messages of |write_buffer_| are encrypted with one call after the buffer is filled. The
+    // buffer can be reallocated while it is filled, so offsets are stored until then.
+    struct EncryptTask
+    {
+        size_t message_offset;
+        size_t plain_offset;
+        size_t plain_size;
+    };
+    std::vector<EncryptTask> encrypt_tasks_;
+    std::vector<MessageEncryptor::Message> encrypt_batch_;
+
+    bool message_chunking_ = false;
+    bool message_compression_ = false;
+    std::unique_ptr<MessageCompressor> compressor_;
+    ByteArray decompress_buffer_;
+
+    // Incompletely received messages for each priority.
+    ByteArray read_chunks_[static_cast<size_t>(Priority::LOW) + 1];
 
     ReadState state_ = ReadState::IDLE;
     VariableSizeReader variable_size_reader_;
+    ByteArray read_header_;
     ByteArray read_buffer_;
-    ByteArray decrypt_buffer_;
+    ByteArray service_buffer_;
 
     int64_t total_tx_ = 0;
     int64_t total_rx_ = 0;
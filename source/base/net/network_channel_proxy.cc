@@ -61,21 +61,23 @@ void NetworkChannelProxy::scheduleWrite()
     if (!reloadWriteQueue(&channel_->write_queue_))
         return;
 
-    channel_->doWrite();
+    // If a write is in progress, the messages will be sent when it is completed.
+    if (!channel_->write_in_progress_)
+        channel_->doWrite();
 }
 
-bool NetworkChannelProxy::reloadWriteQueue(std::queue<WriteTask>* work_queue)
+bool NetworkChannelProxy::reloadWriteQueue(WriteQueue* work_queue)
 {
-    if (!work_queue->empty())
-        return false;
-
     std::scoped_lock lock(incoming_queue_lock_);
 
     if (incoming_queue_.empty())
         return false;
 
-    incoming_queue_.swap(*work_queue);
-    DCHECK(incoming_queue_.empty());
+    while (!incoming_queue_.empty())
+    {
+        work_queue->push(std::move(incoming_queue_.front()));
+        incoming_queue_.pop();
+    }
 
     return true;
 }
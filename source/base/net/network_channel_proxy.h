@@ -21,6 +21,7 @@
 
 #include "base/net/network_channel.h"
 
+#include <queue>
 #include <shared_mutex>
 
 namespace base {
@@ -40,7 +41,7 @@ private:
     void willDestroyCurrentChannel();
 
     void scheduleWrite();
-    bool reloadWriteQueue(std::queue<WriteTask>* work_queue);
+    bool reloadWriteQueue(WriteQueue* work_queue);
 
     std::shared_ptr<TaskRunner> task_runner_;
 
@@ -19,37 +19,108 @@
 #include "base/net/network_server.h"
 
 #include "base/logging.h"
+#include "base/task_runner.h"
 #include "base/message_loop/message_loop.h"
 #include "base/message_loop/message_pump_asio.h"
 #include "base/net/network_channel.h"
 #include "base/strings/unicode.h"
+#include "base/threading/thread.h"
+
+#include <atomic>
 
 namespace base {
 
+namespace {
+
+std::unique_ptr<asio::ip::tcp::acceptor> openAcceptor(
+    asio::io_context& io_context, const NetworkServer::Listener& listener)
+{
+    asio::error_code error_code;
+    asio::ip::address address = asio::ip::address_v4::any();
+
+    if (!listener.address.empty())
+    {
+        address = asio::ip::make_address(utf8FromUtf16(listener.address), error_code);
+        if (error_code)
+        {
+            LOG(LS_ERROR) << "Invalid listen address '" << listener.address << "': "
+                          << utf16FromLocal8Bit(error_code.message());
+            return nullptr;
+        }
+    }
+
+    asio::ip::tcp::endpoint endpoint(address, listener.port);
+    std::unique_ptr<asio::ip::tcp::acceptor> acceptor =
+        std::make_unique<asio::ip::tcp::acceptor>(io_context);
+
+    acceptor->open(endpoint.protocol(), error_code);
+    if (!error_code)
+        acceptor->set_option(asio::ip::tcp::acceptor::reuse_address(true), error_code);
+    if (!error_code && address.is_v6())
+        acceptor->set_option(asio::ip::v6_only(true), error_code);
+    if (!error_code)
+        acceptor->bind(endpoint, error_code);
+    if (!error_code)
+        acceptor->listen(asio::socket_base::max_listen_connections, error_code);
+
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Unable to listen on " << endpoint.address().to_string() << ":"
+                      << endpoint.port() << ": " << utf16FromLocal8Bit(error_code.message());
+        return nullptr;
+    }
+
+    LOG(LS_INFO) << "Listening on " << endpoint.address().to_string() << ":" << endpoint.port();
+    return acceptor;
+}
+
+} // namespace
+
 class NetworkServer::Impl : public std::enable_shared_from_this<Impl>
 {
 public:
     explicit Impl(asio::io_context& io_context);
     ~Impl();
 
-    void start(uint16_t port, Delegate* delegate);
+    void setChannelThreads(const std::vector<Thread*>& threads);
+    bool start(const std::vector<Listener>& listeners, Delegate* delegate);
     void stop();
     uint16_t port() const;
 
 private:
-    void doAccept();
-    void onAccept(const std::error_code& error_code, asio::ip::tcp::socket socket);
+    struct Acceptor
+    {
+        std::unique_ptr<Thread> thread;
+        std::unique_ptr<asio::ip::tcp::acceptor> acceptor;
+    };
+
+    void doAccept(Acceptor* acceptor);
+    void onAccept(Acceptor* acceptor,
+                  const std::error_code& error_code,
+                  asio::ip::tcp::socket socket);
+    void onAcceptInThread(Acceptor* acceptor,
+                          const std::error_code& error_code,
+                          asio::ip::tcp::socket socket,
+                          std::shared_ptr<TaskRunner> task_runner);
 
     asio::io_context& io_context_;
-    std::unique_ptr<asio::ip::tcp::acceptor> acceptor_;
-    Delegate* delegate_ = nullptr;
+    std::shared_ptr<TaskRunner> task_runner_;
+    std::vector<std::unique_ptr<Acceptor>> acceptors_;
+    std::vector<Thread*> threads_;
+
+    // The listeners with their own threads take the channel threads from the same sequence.
+    std::atomic<size_t> next_thread_ = 0;
+
+    // Read on the channel threads.
+    std::atomic<Delegate*> delegate_ = nullptr;
     uint16_t port_ = 0;
 
     DISALLOW_COPY_AND_ASSIGN(Impl);
 };
 
 NetworkServer::Impl::Impl(asio::io_context& io_context)
-    : io_context_(io_context)
+    : io_context_(io_context),
+      task_runner_(MessageLoop::current()->taskRunner())
 {
     LOG(LS_INFO) << "Ctor";
 }
@@ -57,26 +128,93 @@ NetworkServer::Impl::Impl(asio::io_context& io_context)
 NetworkServer::Impl::~Impl()
 {
     LOG(LS_INFO) << "Dtor";
-    DCHECK(!acceptor_);
+    DCHECK(acceptors_.empty());
 }
 
-void NetworkServer::Impl::start(uint16_t port, Delegate* delegate)
+void NetworkServer::Impl::setChannelThreads(const std::vector<Thread*>& threads)
 {
+    DCHECK(acceptors_.empty());
+    threads_ = threads;
+}
+
+bool NetworkServer::Impl::start(const std::vector<Listener>& listeners, Delegate* delegate)
+{
+    DCHECK(acceptors_.empty());
+    DCHECK(delegate);
+
     delegate_ = delegate;
-    port_ = port;
 
-    DCHECK(delegate_);
+    for (const Listener& listener : listeners)
+    {
+        std::unique_ptr<Acceptor> acceptor = std::make_unique<Acceptor>();
+        asio::io_context* io_context = &io_context_;
+
+        if (listener.own_thread)
+        {
+            acceptor->thread = std::make_unique<Thread>();
+            acceptor->thread->start(MessageLoop::Type::ASIO);
+            io_context = &acceptor->thread->messageLoop()->pumpAsio()->ioContext();
+        }
+
+        acceptor->acceptor = openAcceptor(*io_context, listener);
+        if (!acceptor->acceptor)
+        {
+            if (acceptor->thread)
+                acceptor->thread->stop();
+            continue;
+        }
 
-    asio::ip::tcp::endpoint endpoint(asio::ip::tcp::v4(), port);
-    acceptor_ = std::make_unique<asio::ip::tcp::acceptor>(io_context_, endpoint);
+        if (acceptors_.empty())
+            port_ = listener.port;
 
-    doAccept();
+        Acceptor* acceptor_ptr = acceptor.get();
+        acceptors_.emplace_back(std::move(acceptor));
+
+        if (acceptor_ptr->thread)
+        {
+            // The acceptor is used only on its own thread from now on.
+            acceptor_ptr->thread->taskRunner()->postTask(
+                std::bind(&Impl::doAccept, shared_from_this(), acceptor_ptr));
+        }
+        else
+        {
+            doAccept(acceptor_ptr);
+        }
+    }
+
+    if (acceptors_.empty())
+    {
+        LOG(LS_ERROR) << "No listeners started";
+        delegate_ = nullptr;
+        return false;
+    }
+
+    return true;
 }
 
 void NetworkServer::Impl::stop()
 {
     delegate_ = nullptr;
-    acceptor_.reset();
+
+    for (const auto& acceptor : acceptors_)
+    {
+        if (acceptor->thread)
+        {
+            // The acceptor is closed on its thread before the message loop of the thread ends.
+            Acceptor* acceptor_ptr = acceptor.get();
+            acceptor->thread->taskRunner()->postTask([acceptor_ptr]()
+            {
+                acceptor_ptr->acceptor.reset();
+            });
+            acceptor->thread->stop();
+        }
+        else
+        {
+            acceptor->acceptor.reset();
+        }
+    }
+
+    acceptors_.clear();
 }
 
 uint16_t NetworkServer::Impl::port() const
@@ -84,13 +222,45 @@ uint16_t NetworkServer::Impl::port() const
     return port_;
 }
 
-void NetworkServer::Impl::doAccept()
+void NetworkServer::Impl::doAccept(Acceptor* acceptor)
 {
-    acceptor_->async_accept(
-        std::bind(&Impl::onAccept, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+    if (!delegate_)
+        return;
+
+    if (threads_.empty() && !acceptor->thread)
+    {
+        acceptor->acceptor->async_accept(std::bind(
+            &Impl::onAccept, shared_from_this(), acceptor,
+            std::placeholders::_1, std::placeholders::_2));
+        return;
+    }
+
+    // Without the channel threads the connections of the listeners with their own threads are
+    // served on the thread of the server.
+    asio::io_context* io_context = &io_context_;
+    std::shared_ptr<TaskRunner> task_runner = task_runner_;
+
+    if (!threads_.empty())
+    {
+        Thread* thread = threads_[next_thread_++ % threads_.size()];
+
+        io_context = &thread->messageLoop()->pumpAsio()->ioContext();
+        task_runner = thread->taskRunner();
+    }
+
+    // The socket is created in the I/O context of the thread that will serve the connection.
+    acceptor->acceptor->async_accept(*io_context,
+                                     std::bind(&Impl::onAcceptInThread,
+                                               shared_from_this(),
+                                               acceptor,
+                                               std::placeholders::_1,
+                                               std::placeholders::_2,
+                                               std::move(task_runner)));
 }
 
-void NetworkServer::Impl::onAccept(const std::error_code& error_code, asio::ip::tcp::socket socket)
+void NetworkServer::Impl::onAccept(Acceptor* acceptor,
+                                   const std::error_code& error_code,
+                                   asio::ip::tcp::socket socket)
 {
     if (!delegate_)
         return;
@@ -106,11 +276,48 @@ void NetworkServer::Impl::onAccept(const std::error_code& error_code, asio::ip::
             std::unique_ptr<NetworkChannel>(new NetworkChannel(std::move(socket)));
 
         // Connection accepted.
-        delegate_->onNewConnection(std::move(channel));
+        delegate_.load()->onNewConnection(std::move(channel));
     }
 
     // Accept next connection.
-    doAccept();
+    doAccept(acceptor);
+}
+
+void NetworkServer::Impl::onAcceptInThread(Acceptor* acceptor,
+                                           const std::error_code& error_code,
+                                           asio::ip::tcp::socket socket,
+                                           std::shared_ptr<TaskRunner> task_runner)
+{
+    if (!delegate_)
+        return;
+
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Error while accepting connection: "
+                      << base::utf16FromLocal8Bit(error_code.message());
+    }
+    else
+    {
+        std::shared_ptr<asio::ip::tcp::socket> shared_socket =
+            std::make_shared<asio::ip::tcp::socket>(std::move(socket));
+
+        task_runner->postTask([self = shared_from_this(), shared_socket]()
+        {
+            Delegate* delegate = self->delegate_;
+            if (!delegate)
+                return;
+
+            // The channel takes the message loop of the current thread.
+            std::unique_ptr<NetworkChannel> channel =
+                std::unique_ptr<NetworkChannel>(new NetworkChannel(std::move(*shared_socket)));
+
+            // Connection accepted.
+            delegate->onNewConnection(std::move(channel));
+        });
+    }
+
+    // Accept next connection.
+    doAccept(acceptor);
 }
 
 NetworkServer::NetworkServer()
@@ -125,9 +332,22 @@ NetworkServer::~NetworkServer()
     impl_->stop();
 }
 
+void NetworkServer::setChannelThreads(const std::vector<Thread*>& threads)
+{
+    impl_->setChannelThreads(threads);
+}
+
 void NetworkServer::start(uint16_t port, Delegate* delegate)
 {
-    impl_->start(port, delegate);
+    Listener listener;
+    listener.port = port;
+
+    impl_->start({ listener }, delegate);
+}
+
+bool NetworkServer::start(const std::vector<Listener>& listeners, Delegate* delegate)
+{
+    return impl_->start(listeners, delegate);
 }
 
 void NetworkServer::stop()
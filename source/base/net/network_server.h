@@ -23,10 +23,13 @@
 
 #include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace base {
 
 class NetworkChannel;
+class Thread;
 
 class NetworkServer
 {
@@ -42,7 +45,30 @@ public:
         virtual void onNewConnection(std::unique_ptr<NetworkChannel> channel) = 0;
     };
 
+    // An address and a port to accept connections on.
+    struct Listener
+    {
+        // An empty address means all IPv4 interfaces. An IPv6 listener accepts only IPv6
+        // connections, so "::" can be combined with an IPv4 listener on the same port.
+        std::u16string address;
+        uint16_t port = 0;
+
+        // Connections are accepted on a separate thread, so accepting on one interface does not
+        // wait for the thread of the server or for the other listeners.
+        bool own_thread = false;
+    };
+
+    // Accepted connections are distributed between |threads| in turn. The channel is created and
+    // Delegate::onNewConnection is called on the thread of the connection. The threads must run
+    // ASIO message loops and outlive the server. Must be called before start().
+    void setChannelThreads(const std::vector<Thread*>& threads);
+
+    // Accepts connections on all IPv4 interfaces.
     void start(uint16_t port, Delegate* delegate);
+
+    // Accepts connections on each of the |listeners|. Listeners that fail to start are logged and
+    // skipped. Returns false if none of them started.
+    bool start(const std::vector<Listener>& listeners, Delegate* delegate);
     void stop();
     uint16_t port() const;
 
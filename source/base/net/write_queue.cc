@@ -0,0 +1,144 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/write_queue.h"
+
+#include "base/logging.h"
+#include "base/memory/byte_array_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace base {
+
+WriteQueue::WriteQueue() = default;
+WriteQueue::~WriteQueue() = default;
+
+void WriteQueue::push(WriteTask&& task)
+{
+    const size_t lane_index = static_cast<size_t>(task.priority());
+    DCHECK_LT(lane_index, kLaneCount);
+
+    if (!lanes_)
+        lanes_ = std::make_unique<std::array<Lane, kLaneCount>>();
+
+    Lane& lane = (*lanes_)[lane_index];
+
+    if (task.key() != 0)
+    {
+        auto it = std::find_if(lane.tasks.begin() + firstWaiting(lane), lane.tasks.end(),
+                               [&task](const WriteTask& item)
+        {
+            return item.key() == task.key();
+        });
+
+        if (it != lane.tasks.end())
+        {
+            // The old message has not been sent yet. It is no longer relevant.
+            *it = std::move(task);
+            return;
+        }
+    }
+
+    lane.tasks.emplace_back(std::move(task));
+    ++size_;
+}
+
+void WriteQueue::pop()
+{
+    Lane& lane = frontLane();
+
+    // The message has been copied to the write buffer. Its memory is used for the next messages.
+    ByteArrayPool::release(lane.tasks.front().takeData());
+    lane.tasks.pop_front();
+    lane.offset = 0;
+    --size_;
+}
+
+void WriteQueue::suspend(size_t offset)
+{
+    DCHECK_LT(offset, front().data().size());
+    frontLane().offset = offset;
+}
+
+const WriteTask& WriteQueue::front() const
+{
+    return frontLane().tasks.front();
+}
+
+WriteTask& WriteQueue::front()
+{
+    return frontLane().tasks.front();
+}
+
+size_t WriteQueue::frontOffset() const
+{
+    return frontLane().offset;
+}
+
+bool WriteQueue::contains(uint32_t key) const
+{
+    if (!lanes_)
+        return false;
+
+    for (const Lane& lane : *lanes_)
+    {
+        if (std::any_of(lane.tasks.begin() + firstWaiting(lane), lane.tasks.end(),
+                        [key](const WriteTask& item) { return item.key() == key; }))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WriteQueue::trim()
+{
+    if (empty())
+        lanes_.reset();
+}
+
+const WriteQueue::Lane& WriteQueue::frontLane() const
+{
+    DCHECK(!empty());
+    DCHECK(lanes_);
+
+    for (const Lane& lane : *lanes_)
+    {
+        if (!lane.tasks.empty())
+            return lane;
+    }
+
+    NOTREACHED();
+    return (*lanes_)[0];
+}
+
+WriteQueue::Lane& WriteQueue::frontLane()
+{
+    return const_cast<Lane&>(std::as_const(*this).frontLane());
+}
+
+// static
+size_t WriteQueue::firstWaiting(const Lane& lane)
+{
+    // The first message of the lane is not waiting anymore if a part of it has been written.
+    return lane.offset != 0 ? 1 : 0;
+}
+
+} // namespace base
@@ -0,0 +1,93 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__NET__WRITE_QUEUE_H
+#define BASE__NET__WRITE_QUEUE_H
+
+#include "base/macros_magic.h"
+#include "base/net/write_task.h"
+
+#include <array>
+#include <deque>
+#include <memory>
+
+namespace base {
+
+// Queue of messages waiting to be written to the network channel. Each priority has its own lane,
+// and the messages of a lane are sent in the order in which they were added. The channel takes
+// the front message (the first message of the lane with the highest priority) and removes it from
+// the queue once it has been passed to the socket. If the channel writes messages in chunks, it
+// suspends the front message after each chunk, and a message with a higher priority can go first.
+// A message with a non-zero key replaces a waiting message with the same key in its lane.
+class WriteQueue
+{
+public:
+    WriteQueue();
+    ~WriteQueue();
+
+    void push(WriteTask&& task);
+
+    // Removes the front message when it has been written completely.
+    void pop();
+
+    // Remembers that |offset| bytes of the front message have been written. The rest of the
+    // message is written when there are no messages with a higher priority.
+    void suspend(size_t offset);
+
+    const WriteTask& front() const;
+    WriteTask& front();
+
+    // Number of bytes of the front message that have already been written.
+    size_t frontOffset() const;
+
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+
+    // Returns true if a message with the |key| is waiting to be sent. Partially written messages
+    // are not taken into account.
+    bool contains(uint32_t key) const;
+
+    // Frees the memory of the queue if it is empty. It is allocated again by the next push().
+    void trim();
+
+private:
+    static constexpr size_t kLaneCount = static_cast<size_t>(WriteTask::Priority::LOW) + 1;
+
+    struct Lane
+    {
+        std::deque<WriteTask> tasks;
+
+        // Number of bytes of the first message that have been written.
+        size_t offset = 0;
+    };
+
+    const Lane& frontLane() const;
+    Lane& frontLane();
+    static size_t firstWaiting(const Lane& lane);
+
+    // Allocated by the first push(). Even empty deques allocate memory, which matters for many
+    // idle connections.
+    std::unique_ptr<std::array<Lane, kLaneCount>> lanes_;
+    size_t size_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(WriteQueue);
+};
+
+} // namespace base
+
+#endif // BASE__NET__WRITE_QUEUE_H
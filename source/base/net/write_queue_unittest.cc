@@ -0,0 +1,174 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/net/write_queue.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+using Priority = WriteTask::Priority;
+
+WriteTask makeTask(Priority priority, uint32_t key, uint8_t value, size_t size = 1)
+{
+    return WriteTask(WriteTask::Type::USER_DATA, priority, key, ByteArray(size, value));
+}
+
+uint8_t frontValue(const WriteQueue& queue)
+{
+    return queue.front().data().front();
+}
+
+} // namespace
+
+TEST(WriteQueueTest, Fifo)
+{
+    WriteQueue queue;
+    EXPECT_TRUE(queue.empty());
+
+    for (uint8_t i = 0; i < 5; ++i)
+        queue.push(makeTask(Priority::NORMAL, 0, i));
+
+    EXPECT_EQ(queue.size(), 5u);
+
+    for (uint8_t i = 0; i < 5; ++i)
+    {
+        EXPECT_EQ(frontValue(queue), i);
+        queue.pop();
+    }
+
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(WriteQueueTest, Priority)
+{
+    WriteQueue queue;
+
+    queue.push(makeTask(Priority::LOW, 0, 1));
+    queue.push(makeTask(Priority::LOW, 0, 2));
+    queue.push(makeTask(Priority::NORMAL, 0, 3));
+    queue.push(makeTask(Priority::HIGH, 0, 4));
+    queue.push(makeTask(Priority::HIGH, 0, 5));
+    queue.push(makeTask(Priority::LOW, 0, 6));
+
+    const uint8_t expected[] = { 4, 5, 3, 1, 2, 6 };
+
+    for (uint8_t value : expected)
+    {
+        ASSERT_FALSE(queue.empty());
+        EXPECT_EQ(frontValue(queue), value);
+        queue.pop();
+    }
+
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(WriteQueueTest, Replace)
+{
+    WriteQueue queue;
+
+    queue.push(makeTask(Priority::LOW, 1, 1));
+    EXPECT_TRUE(queue.contains(1));
+    EXPECT_FALSE(queue.contains(2));
+
+    queue.push(makeTask(Priority::LOW, 1, 2));
+    EXPECT_EQ(queue.size(), 1u);
+
+    queue.push(makeTask(Priority::NORMAL, 0, 3));
+    queue.push(makeTask(Priority::LOW, 2, 4));
+    queue.push(makeTask(Priority::LOW, 1, 5));
+    EXPECT_EQ(queue.size(), 3u);
+
+    const uint8_t expected[] = { 3, 5, 4 };
+
+    for (uint8_t value : expected)
+    {
+        ASSERT_FALSE(queue.empty());
+        EXPECT_EQ(frontValue(queue), value);
+        queue.pop();
+    }
+
+    EXPECT_FALSE(queue.contains(1));
+}
+
+TEST(WriteQueueTest, Suspend)
+{
+    WriteQueue queue;
+
+    queue.push(makeTask(Priority::LOW, 1, 1, 100));
+    queue.push(makeTask(Priority::LOW, 0, 2));
+    EXPECT_EQ(queue.frontOffset(), 0u);
+
+    // Without messages with a higher priority the same message is continued.
+    queue.suspend(10);
+    EXPECT_EQ(frontValue(queue), 1);
+    EXPECT_EQ(queue.frontOffset(), 10u);
+    EXPECT_FALSE(queue.contains(1));
+
+    queue.push(makeTask(Priority::HIGH, 0, 3));
+    EXPECT_EQ(frontValue(queue), 3);
+    EXPECT_EQ(queue.frontOffset(), 0u);
+
+    // The partially written message is not replaced.
+    queue.push(makeTask(Priority::LOW, 1, 4));
+    EXPECT_EQ(queue.size(), 4u);
+    EXPECT_TRUE(queue.contains(1));
+
+    queue.pop();
+    EXPECT_EQ(frontValue(queue), 1);
+    EXPECT_EQ(queue.frontOffset(), 10u);
+
+    const uint8_t expected[] = { 1, 2, 4 };
+
+    for (uint8_t value : expected)
+    {
+        ASSERT_FALSE(queue.empty());
+        EXPECT_EQ(frontValue(queue), value);
+        queue.pop();
+    }
+
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(WriteQueueTest, Trim)
+{
+    WriteQueue queue;
+    EXPECT_FALSE(queue.contains(1));
+
+    queue.push(makeTask(Priority::NORMAL, 1, 1));
+
+    // A queue with messages is not changed.
+    queue.trim();
+    EXPECT_EQ(queue.size(), 1u);
+    EXPECT_TRUE(queue.contains(1));
+
+    queue.pop();
+    queue.trim();
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.contains(1));
+
+    // The queue can be used again.
+    queue.push(makeTask(Priority::LOW, 0, 2));
+    EXPECT_EQ(frontValue(queue), 2);
+    queue.pop();
+    EXPECT_TRUE(queue.empty());
+}
+
+} // namespace base
@@ -28,19 +28,57 @@ class WriteTask
 public:
     enum class Type { SERVICE_DATA, USER_DATA };
 
+    // Messages with a higher priority are sent before messages with a lower priority.
+    enum class Priority
+    {
+        HIGH,   // Input, clipboard and service messages.
+        NORMAL, // Default priority.
+        LOW     // Bulk data (video, files).
+    };
+
     WriteTask(Type type, ByteArray&& data)
+        : WriteTask(type, Priority::NORMAL, 0, std::move(data))
+    {
+        // Nothing
+    }
+
+    WriteTask(Type type, Priority priority, uint32_t key, ByteArray&& data)
         : type_(type),
+          priority_(priority),
+          key_(key),
           data_(std::move(data))
     {
         // Nothing
     }
 
+    WriteTask(WriteTask&& other) = default;
+    WriteTask& operator=(WriteTask&& other) = default;
+
     Type type() const { return type_; }
+    Priority priority() const { return priority_; }
+
+    // If the key is not zero, the message replaces a message with the same key that has not been
+    // sent yet.
+    uint32_t key() const { return key_; }
+
     const ByteArray& data() const { return data_; }
+    ByteArray takeData() { return std::move(data_); }
+
+    // Returns true if the data has been compressed by the channel.
+    bool isCompressed() const { return compressed_; }
+
+    void setCompressedData(ByteArray&& data)
+    {
+        data_ = std::move(data);
+        compressed_ = true;
+    }
 
 private:
-    const Type type_;
-    const ByteArray data_;
+    Type type_;
+    Priority priority_;
+    uint32_t key_;
+    ByteArray data_;
+    bool compressed_ = false;
 };
 
 } // namespace base
@@ -20,6 +20,7 @@
 
 #include "base/location.h"
 #include "base/logging.h"
+#include "base/crypto/generic_hash.h"
 #include "base/crypto/message_decryptor_openssl.h"
 #include "base/crypto/message_encryptor_openssl.h"
 
@@ -227,4 +228,29 @@ bool Authenticator::onSessionKeyChanged()
     return true;
 }
 
+ByteArray Authenticator::resumptionSecret() const
+{
+    GenericHash hash(GenericHash::BLAKE2s256);
+    hash.addData(session_key_);
+    hash.addData("resumption");
+    return hash.result();
+}
+
+// static
+ByteArray Authenticator::resumedSessionKey(const ByteArray& session_key,
+                                           const ByteArray& secret,
+                                           std::string_view client_nonce,
+                                           std::string_view server_nonce)
+{
+    GenericHash hash(GenericHash::BLAKE2s256);
+
+    if (!session_key.empty())
+        hash.addData(session_key);
+    hash.addData(secret);
+    hash.addData(client_nonce);
+    hash.addData(server_nonce);
+
+    return hash.result();
+}
+
 } // namespace base
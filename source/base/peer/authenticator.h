@@ -92,6 +92,19 @@ protected:
 
     [[nodiscard]] bool onSessionKeyChanged();
 
+    // Size of the nonces that both sides send when resuming a session.
+    static constexpr size_t kResumptionNonceSize = 32;
+
+    // Secret for resuming the session. Both sides derive it from the current session key.
+    [[nodiscard]] ByteArray resumptionSecret() const;
+
+    // Key of the resumed session. |session_key| is the key agreed in ClientHello/ServerHello (may
+    // be empty).
+    [[nodiscard]] static ByteArray resumedSessionKey(const ByteArray& session_key,
+                                                     const ByteArray& secret,
+                                                     std::string_view client_nonce,
+                                                     std::string_view server_nonce);
+
     proto::Encryption encryption_ = proto::ENCRYPTION_UNKNOWN;
     proto::Identify identify_ = proto::IDENTIFY_SRP;
     ByteArray session_key_;
@@ -18,12 +18,12 @@
 
 #include "base/peer/client_authenticator.h"
 
-#include "base/cpuid_util.h"
 #include "base/location.h"
 #include "base/logging.h"
 #include "base/sys_info.h"
 #include "base/crypto/generic_hash.h"
 #include "base/crypto/key_pair.h"
+#include "base/crypto/openssl_util.h"
 #include "base/crypto/random.h"
 #include "base/crypto/srp_constants.h"
 #include "base/crypto/srp_math.h"
@@ -107,6 +107,11 @@ void ClientAuthenticator::setSessionType(uint32_t session_type)
     session_type_ = session_type;
 }
 
+void ClientAuthenticator::setResumptionTicket(const ResumptionTicket& ticket)
+{
+    ticket_ = ticket;
+}
+
 bool ClientAuthenticator::onStarted()
 {
     internal_state_ = InternalState::SEND_CLIENT_HELLO;
@@ -122,7 +127,7 @@ void ClientAuthenticator::onReceived(const ByteArray& buffer)
         {
             if (readServerHello(buffer))
             {
-                if (identify_ == proto::IDENTIFY_ANONYMOUS)
+                if (identify_ == proto::IDENTIFY_ANONYMOUS || resumed_)
                 {
                     internal_state_ = InternalState::READ_SESSION_CHALLENGE;
                 }
@@ -218,10 +223,8 @@ void ClientAuthenticator::sendClientHello()
 
     uint32_t encryption = proto::ENCRYPTION_CHACHA20_POLY1305;
 
-#if defined(ARCH_CPU_X86_FAMILY)
-    if (CpuidUtil::hasAesNi())
+    if (hasHardwareAes())
         encryption |= proto::ENCRYPTION_AES256_GCM;
-#endif
 
     client_hello->set_encryption(encryption);
     client_hello->set_identify(identify_);
@@ -267,6 +270,23 @@ void ClientAuthenticator::sendClientHello()
         client_hello->set_iv(toStdString(encrypt_iv_));
     }
 
+    if (ticket_.isValid())
+    {
+        if (encrypt_iv_.empty())
+            encrypt_iv_ = Random::byteArray(kIvSize);
+
+        nonce_ = Random::string(kResumptionNonceSize);
+        if (encrypt_iv_.empty() || nonce_.empty())
+        {
+            finish(FROM_HERE, ErrorCode::UNKNOWN_ERROR);
+            return;
+        }
+
+        client_hello->set_ticket(ticket_.ticket);
+        client_hello->set_nonce(nonce_);
+        client_hello->set_iv(toStdString(encrypt_iv_));
+    }
+
     LOG(LS_INFO) << "Sending: ClientHello";
     sendMessage(*client_hello);
 }
@@ -296,6 +316,21 @@ bool ClientAuthenticator::readServerHello(const ByteArray& buffer)
             return false;
     }
 
+    if (server_hello->resumed())
+    {
+        if (!ticket_.isValid() || server_hello->nonce().size() != kResumptionNonceSize)
+        {
+            finish(FROM_HERE, ErrorCode::PROTOCOL_ERROR);
+            return false;
+        }
+
+        LOG(LS_INFO) << "Session resumed";
+
+        session_key_ = resumedSessionKey(
+            session_key_, ticket_.secret, nonce_, server_hello->nonce());
+        resumed_ = true;
+    }
+
     decrypt_iv_ = fromStdString(server_hello->iv());
 
     if (session_key_.empty() != decrypt_iv_.empty())
@@ -414,6 +449,12 @@ bool ClientAuthenticator::readSessionChallenge(const ByteArray& buffer)
         return false;
     }
 
+    if (!challenge->ticket().empty() && !session_key_.empty())
+    {
+        new_ticket_.ticket = challenge->ticket();
+        new_ticket_.secret = resumptionSecret();
+    }
+
     setPeerVersion(challenge->version());
     setPeerOsName(challenge->os_name());
     setPeerComputerName(challenge->computer_name());
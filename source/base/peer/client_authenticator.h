@@ -30,12 +30,32 @@ public:
     explicit ClientAuthenticator(std::shared_ptr<TaskRunner> task_runner);
     ~ClientAuthenticator();
 
+    // Allows to reconnect to the same server without the key exchange.
+    struct ResumptionTicket
+    {
+        bool isValid() const { return !ticket.empty() && !secret.empty(); }
+
+        std::string ticket;
+        ByteArray secret;
+    };
+
     void setPeerPublicKey(const ByteArray& public_key);
     void setIdentify(proto::Identify identify);
     void setUserName(std::u16string_view username);
     void setPassword(std::u16string_view password);
     void setSessionType(uint32_t session_type);
 
+    // Sets the ticket received from the server in the previous session. If the server does not
+    // accept the ticket, the full authentication is performed.
+    void setResumptionTicket(const ResumptionTicket& ticket);
+
+    // Returns the ticket for the next connection. It is valid after successful authentication if
+    // the server issues tickets.
+    const ResumptionTicket& resumptionTicket() const { return new_ticket_; }
+
+    // Returns true if the session was resumed with the ticket.
+    bool isResumed() const { return resumed_; }
+
 protected:
     // Authenticator implementation.
     bool onStarted() override;
@@ -65,6 +85,10 @@ private:
     InternalState internal_state_ = InternalState::SEND_CLIENT_HELLO;
 
     ByteArray peer_public_key_;
+    ResumptionTicket ticket_;
+    ResumptionTicket new_ticket_;
+    std::string nonce_;
+    bool resumed_ = false;
     std::u16string username_;
     std::u16string password_;
 
@@ -0,0 +1,202 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/peer/direct_peer.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/strings/unicode.h"
+
+#include <algorithm>
+
+namespace base {
+
+namespace {
+
+// The direct path is usually either available at once (the same network or a forwarded port) or
+// not available at all. The relay connection is used after this time.
+const std::chrono::seconds kConnectTimeout{ 3 };
+
+} // namespace
+
+class DirectPeer::Attempt : public NetworkChannel::Listener
+{
+public:
+    Attempt(DirectPeer* owner, const proto::PeerCandidate& candidate)
+        : owner_(owner),
+          candidate_(candidate),
+          channel_(std::make_unique<NetworkChannel>())
+    {
+        channel_->setListener(this);
+    }
+
+    ~Attempt() override = default;
+
+    void start()
+    {
+        LOG(LS_INFO) << "Connecting to candidate " << candidate_.host() << ":" << candidate_.port()
+                     << " (type: " << candidate_.type() << ")";
+        channel_->connect(utf16FromUtf8(candidate_.host()),
+                          static_cast<uint16_t>(candidate_.port()));
+    }
+
+    std::unique_ptr<NetworkChannel> takeChannel()
+    {
+        channel_->setListener(nullptr);
+        return std::move(channel_);
+    }
+
+    // The attempt no longer notifies the owner.
+    void detach() { owner_ = nullptr; }
+
+    const proto::PeerCandidate& candidate() const { return candidate_; }
+
+protected:
+    // NetworkChannel::Listener implementation.
+    void onConnected() override
+    {
+        if (owner_)
+            owner_->onAttemptConnected(this);
+    }
+
+    void onDisconnected(NetworkChannel::ErrorCode error_code) override
+    {
+        LOG(LS_INFO) << "Candidate " << candidate_.host() << ":" << candidate_.port()
+                     << " is not reachable (" << NetworkChannel::errorToString(error_code) << ")";
+        if (owner_)
+            owner_->onAttemptFailed(this);
+    }
+
+    void onMessageReceived(const ByteArray& /* buffer */) override
+    {
+        // Nothing
+    }
+
+    void onMessageWritten(size_t /* pending */) override
+    {
+        // Nothing
+    }
+
+private:
+    DirectPeer* owner_;
+    proto::PeerCandidate candidate_;
+    std::unique_ptr<NetworkChannel> channel_;
+
+    DISALLOW_COPY_AND_ASSIGN(Attempt);
+};
+
+DirectPeer::DirectPeer(std::shared_ptr<TaskRunner> task_runner)
+    : task_runner_(std::move(task_runner)),
+      timeout_timer_(WaitableTimer::Type::SINGLE_SHOT, task_runner_)
+{
+    DCHECK(task_runner_);
+}
+
+DirectPeer::~DirectPeer()
+{
+    delegate_ = nullptr;
+    timeout_timer_.stop();
+}
+
+void DirectPeer::start(const Candidates& candidates, Delegate* delegate)
+{
+    delegate_ = delegate;
+    DCHECK(delegate_);
+
+    for (const auto& candidate : candidates)
+    {
+        if (candidate.host().empty() || candidate.port() == 0 || candidate.port() > 65535)
+            continue;
+
+        attempts_.emplace_back(std::make_unique<Attempt>(this, candidate));
+    }
+
+    if (attempts_.empty())
+    {
+        LOG(LS_INFO) << "No candidates for direct connection";
+        finish(nullptr);
+        return;
+    }
+
+    timeout_timer_.start(kConnectTimeout, std::bind(&DirectPeer::onTimeout, this));
+
+    // The list is not changed while the attempts are started: the errors are reported
+    // asynchronously.
+    for (const auto& attempt : attempts_)
+        attempt->start();
+}
+
+void DirectPeer::onAttemptConnected(Attempt* attempt)
+{
+    LOG(LS_INFO) << "Direct connection established with " << attempt->candidate().host() << ":"
+                 << attempt->candidate().port();
+    finish(attempt->takeChannel());
+}
+
+void DirectPeer::onAttemptFailed(Attempt* attempt)
+{
+    auto it = std::find_if(attempts_.begin(), attempts_.end(),
+                           [attempt](const std::unique_ptr<Attempt>& item)
+    {
+        return item.get() == attempt;
+    });
+
+    if (it == attempts_.end())
+        return;
+
+    // The attempt is called from its own channel. It is deleted after the return.
+    (*it)->detach();
+    task_runner_->deleteSoon(std::move(*it));
+    attempts_.erase(it);
+
+    if (attempts_.empty())
+        finish(nullptr);
+}
+
+void DirectPeer::onTimeout()
+{
+    LOG(LS_INFO) << "Direct connection timeout";
+    finish(nullptr);
+}
+
+void DirectPeer::finish(std::unique_ptr<NetworkChannel> channel)
+{
+    if (is_finished_)
+        return;
+
+    is_finished_ = true;
+    timeout_timer_.stop();
+
+    // The remaining attempts may be in their callbacks at the moment.
+    for (auto& attempt : attempts_)
+    {
+        attempt->detach();
+        task_runner_->deleteSoon(std::move(attempt));
+    }
+    attempts_.clear();
+
+    if (!delegate_)
+        return;
+
+    if (channel)
+        delegate_->onDirectConnectionReady(std::move(channel));
+    else
+        delegate_->onDirectConnectionError();
+}
+
+} // namespace base
@@ -0,0 +1,76 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__PEER__DIRECT_PEER_H
+#define BASE__PEER__DIRECT_PEER_H
+
+#include "base/waitable_timer.h"
+#include "base/net/network_channel.h"
+#include "proto/router_peer.pb.h"
+
+#include <memory>
+#include <vector>
+
+namespace base {
+
+class TaskRunner;
+
+// Tries to connect directly to the host using the candidates from the connection offer. The
+// connection attempts to all candidates are started at once, the first established connection is
+// used and the rest are closed.
+class DirectPeer
+{
+public:
+    explicit DirectPeer(std::shared_ptr<TaskRunner> task_runner);
+    ~DirectPeer();
+
+    class Delegate
+    {
+    public:
+        virtual ~Delegate() = default;
+
+        virtual void onDirectConnectionReady(std::unique_ptr<NetworkChannel> channel) = 0;
+        virtual void onDirectConnectionError() = 0;
+    };
+
+    using Candidates = google::protobuf::RepeatedPtrField<proto::PeerCandidate>;
+
+    void start(const Candidates& candidates, Delegate* delegate);
+    bool isFinished() const { return is_finished_; }
+
+private:
+    class Attempt;
+
+    void onAttemptConnected(Attempt* attempt);
+    void onAttemptFailed(Attempt* attempt);
+    void onTimeout();
+    void finish(std::unique_ptr<NetworkChannel> channel);
+
+    std::shared_ptr<TaskRunner> task_runner_;
+    Delegate* delegate_ = nullptr;
+    bool is_finished_ = false;
+
+    std::vector<std::unique_ptr<Attempt>> attempts_;
+    WaitableTimer timeout_timer_;
+
+    DISALLOW_COPY_AND_ASSIGN(DirectPeer);
+};
+
+} // namespace base
+
+#endif // BASE__PEER__DIRECT_PEER_H
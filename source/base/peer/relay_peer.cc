@@ -52,17 +52,60 @@ RelayPeer::~RelayPeer()
     socket_.close(ignored_code);
 }
 
+void RelayPeer::preconnect(const std::string& host, uint32_t port, Delegate* delegate)
+{
+    DCHECK_EQ(state_, State::NONE);
+
+    delegate_ = delegate;
+    DCHECK(delegate_);
+
+    connectTo(host, port);
+}
+
 void RelayPeer::start(const proto::RelayCredentials& credentials, Delegate* delegate)
 {
     delegate_ = delegate;
     DCHECK(delegate_);
 
     message_ = authenticationMessage(credentials.key(), credentials.secret());
+    if (message_.empty())
+    {
+        onErrorOccurred(FROM_HERE, std::error_code());
+        return;
+    }
+
+    if (state_ != State::NONE)
+    {
+        DCHECK(isConnectedTo(credentials.host(), credentials.port()));
+
+        // The connection is made in advance. If it is still in progress, the authentication is
+        // sent when it is established.
+        if (state_ == State::CONNECTED)
+        {
+            LOG(LS_INFO) << "Using connection made in advance to " << host_ << ":" << port_;
+            preconnected_ = true;
+            sendAuthentication();
+        }
+        return;
+    }
+
+    connectTo(credentials.host(), credentials.port());
+}
+
+bool RelayPeer::isConnectedTo(const std::string& host, uint32_t port) const
+{
+    return state_ != State::NONE && !is_finished_ && host_ == host && port_ == port;
+}
+
+void RelayPeer::connectTo(const std::string& host, uint32_t port)
+{
+    host_ = host;
+    port_ = port;
+    state_ = State::CONNECTING;
 
-    LOG(LS_INFO) << "Start resolving for " << credentials.host() << ":" << credentials.port();
+    LOG(LS_INFO) << "Start resolving for " << host << ":" << port;
 
-    resolver_.async_resolve(local8BitFromUtf16(utf16FromUtf8(credentials.host())),
-                            std::to_string(credentials.port()),
+    resolver_.async_resolve(local8BitFromUtf16(utf16FromUtf8(host)), std::to_string(port),
         [this](const std::error_code& error_code,
                const asio::ip::tcp::resolver::results_type& endpoints)
     {
@@ -94,11 +137,19 @@ void RelayPeer::start(const proto::RelayCredentials& credentials, Delegate* dele
 
 void RelayPeer::onConnected()
 {
+    state_ = State::CONNECTED;
+    connect_time_ = std::chrono::steady_clock::now();
+
+    // The connection made in advance waits for start().
     if (message_.empty())
-    {
-        onErrorOccurred(FROM_HERE, std::error_code());
         return;
-    }
+
+    sendAuthentication();
+}
+
+void RelayPeer::sendAuthentication()
+{
+    DCHECK(!message_.empty());
 
     message_size_ = base::EndianUtil::toBig(static_cast<uint32_t>(message_.size()));
 
@@ -154,6 +205,19 @@ void RelayPeer::onErrorOccurred(const Location& location, const std::error_code&
                   << utf16FromLocal8Bit(error_code.message()) << " ("
                   << location.toString() << ")";
 
+    if (preconnected_)
+    {
+        // The relay has closed the connection made in advance. The session is not lost yet.
+        LOG(LS_INFO) << "Reconnecting to relay server";
+        preconnected_ = false;
+
+        std::error_code ignored_code;
+        socket_.close(ignored_code);
+
+        connectTo(host_, port_);
+        return;
+    }
+
     is_finished_ = true;
     if (delegate_)
     {
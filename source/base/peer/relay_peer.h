@@ -25,6 +25,8 @@
 
 #include <asio/ip/tcp.hpp>
 
+#include <chrono>
+
 namespace base {
 
 class NetworkChannel;
@@ -45,11 +47,26 @@ public:
         virtual void onRelayConnectionError() = 0;
     };
 
+    // Connects to the relay in advance. start() with the credentials for the same relay sends the
+    // authentication over this connection, without the resolving and the TCP handshake. The relay
+    // closes the connection if it is not authenticated in 30 seconds.
+    void preconnect(const std::string& host, uint32_t port, Delegate* delegate);
+
     void start(const proto::RelayCredentials& credentials, Delegate* delegate);
     bool isFinished() const { return is_finished_; }
 
+    // The connection made by preconnect() is established and start() has not been called yet.
+    bool isIdle() const { return state_ == State::CONNECTED && message_.empty(); }
+
+    bool isConnectedTo(const std::string& host, uint32_t port) const;
+    std::chrono::steady_clock::time_point connectTime() const { return connect_time_; }
+
 private:
+    enum class State { NONE, CONNECTING, CONNECTED };
+
+    void connectTo(const std::string& host, uint32_t port);
     void onConnected();
+    void sendAuthentication();
     void onErrorOccurred(const Location& location, const std::error_code& error_code);
 
     static ByteArray authenticationMessage(const proto::RelayKey& key, const std::string& secret);
@@ -57,6 +74,15 @@ private:
     Delegate* delegate_ = nullptr;
     bool is_finished_ = false;
 
+    State state_ = State::NONE;
+    std::string host_;
+    uint32_t port_ = 0;
+    std::chrono::steady_clock::time_point connect_time_;
+
+    // The authentication is sent over the connection made in advance. If the relay has closed it,
+    // the peer connects again once.
+    bool preconnected_ = false;
+
     uint32_t message_size_ = 0;
     ByteArray message_;
 
@@ -21,12 +21,30 @@
 #include "base/logging.h"
 #include "base/task_runner.h"
 #include "base/net/network_channel.h"
+#include "proto/router_common.pb.h"
+
+#include <algorithm>
 
 namespace base {
 
+namespace {
+
+// The relay drops a connection that is not authenticated in 30 seconds. The session must also have
+// time to find the opposite peer before that, so the connections made in advance are used only
+// while they are younger than kWarmConnectionLifetime.
+const std::chrono::seconds kWarmConnectionLifetime { 10 };
+const std::chrono::seconds kWarmCheckInterval { 5 };
+
+// The connections are kept only for the relays used during this time.
+const std::chrono::minutes kWarmPeriod { 5 };
+const size_t kMaxWarmRelays = 2;
+
+} // namespace
+
 RelayPeerManager::RelayPeerManager(std::shared_ptr<TaskRunner> task_runner, Delegate* delegate)
     : task_runner_(std::move(task_runner)),
-      delegate_(delegate)
+      delegate_(delegate),
+      warm_timer_(WaitableTimer::Type::REPEATED, task_runner_)
 {
     DCHECK(task_runner_ && delegate_);
 }
@@ -34,12 +52,53 @@ RelayPeerManager::RelayPeerManager(std::shared_ptr<TaskRunner> task_runner, Dele
 RelayPeerManager::~RelayPeerManager()
 {
     delegate_ = nullptr;
+    warm_timer_.stop();
 }
 
 void RelayPeerManager::addConnectionOffer(const proto::RelayCredentials& credentials)
 {
-    pending_.emplace_back(std::make_unique<RelayPeer>());
+    std::unique_ptr<RelayPeer> peer = takeWarmPeer(credentials.host(), credentials.port());
+    if (!peer)
+        peer = std::make_unique<RelayPeer>();
+
+    pending_.emplace_back(std::move(peer));
     pending_.back()->start(credentials, this);
+
+    auto it = std::find_if(warm_relays_.begin(), warm_relays_.end(),
+                           [&credentials](const WarmRelay& relay)
+    {
+        return relay.host == credentials.host() && relay.port == credentials.port();
+    });
+
+    if (it == warm_relays_.end())
+    {
+        if (warm_relays_.size() >= kMaxWarmRelays)
+        {
+            // The relay that was used the longest time ago is replaced.
+            auto oldest = std::min_element(warm_relays_.begin(), warm_relays_.end(),
+                                           [](const WarmRelay& first, const WarmRelay& second)
+            {
+                return first.last_used < second.last_used;
+            });
+
+            if (oldest->peer)
+                task_runner_->deleteSoon(std::move(oldest->peer));
+            warm_relays_.erase(oldest);
+        }
+
+        warm_relays_.push_back({ credentials.host(), credentials.port(), {}, nullptr });
+        it = warm_relays_.end() - 1;
+    }
+
+    it->last_used = std::chrono::steady_clock::now();
+
+    updateWarmRelays();
+
+    if (!warm_timer_.isActive())
+    {
+        warm_timer_.start(kWarmCheckInterval,
+                          std::bind(&RelayPeerManager::updateWarmRelays, this));
+    }
 }
 
 void RelayPeerManager::onRelayConnectionReady(std::unique_ptr<NetworkChannel> channel)
@@ -61,6 +120,59 @@ void RelayPeerManager::onRelayConnectionError()
     cleanup();
 }
 
+std::unique_ptr<RelayPeer> RelayPeerManager::takeWarmPeer(const std::string& host, uint32_t port)
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    for (WarmRelay& relay : warm_relays_)
+    {
+        if (!relay.peer || !relay.peer->isConnectedTo(host, port))
+            continue;
+
+        // The connection that is still being established is taken too, it is closer to ready
+        // than a new one.
+        if (relay.peer->isIdle() && now - relay.peer->connectTime() > kWarmConnectionLifetime)
+            return nullptr;
+
+        return std::move(relay.peer);
+    }
+
+    return nullptr;
+}
+
+void RelayPeerManager::updateWarmRelays()
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    auto it = warm_relays_.begin();
+    while (it != warm_relays_.end())
+    {
+        if (now - it->last_used > kWarmPeriod)
+        {
+            LOG(LS_INFO) << "Relay " << it->host << ":" << it->port << " is no longer kept warm";
+
+            if (it->peer)
+                task_runner_->deleteSoon(std::move(it->peer));
+            it = warm_relays_.erase(it);
+            continue;
+        }
+
+        const bool expired = it->peer && it->peer->isIdle() &&
+            now - it->peer->connectTime() > kWarmConnectionLifetime;
+
+        if (!it->peer || it->peer->isFinished() || expired)
+        {
+            if (it->peer)
+                task_runner_->deleteSoon(std::move(it->peer));
+
+            it->peer = std::make_unique<RelayPeer>();
+            it->peer->preconnect(it->host, it->port, this);
+        }
+
+        ++it;
+    }
+}
+
 void RelayPeerManager::cleanup()
 {
     auto it = pending_.begin();
@@ -20,9 +20,12 @@
 #define BASE__PEER__RELAY_PEER_MANAGER_H
 
 #include "base/macros_magic.h"
+#include "base/waitable_timer.h"
 #include "base/peer/relay_peer.h"
 
+#include <chrono>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace proto {
@@ -34,6 +37,9 @@ namespace base {
 class NetworkChannel;
 class TaskRunner;
 
+// Connects the host to the relays offered by the router. For the relays used recently the manager
+// keeps a connection made in advance, so the next relayed session starts without the resolving and
+// the TCP handshake. The connection is replaced before the relay drops it as unauthenticated.
 class RelayPeerManager : public RelayPeer::Delegate
 {
 public:
@@ -56,13 +62,26 @@ protected:
     void onRelayConnectionError() override;
 
 private:
+    struct WarmRelay
+    {
+        std::string host;
+        uint32_t port;
+        std::chrono::steady_clock::time_point last_used;
+        std::unique_ptr<RelayPeer> peer;
+    };
+
     void cleanup();
+    std::unique_ptr<RelayPeer> takeWarmPeer(const std::string& host, uint32_t port);
+    void updateWarmRelays();
 
     std::shared_ptr<TaskRunner> task_runner_;
     Delegate* delegate_;
 
     std::vector<std::unique_ptr<RelayPeer>> pending_;
 
+    std::vector<WarmRelay> warm_relays_;
+    WaitableTimer warm_timer_;
+
     DISALLOW_COPY_AND_ASSIGN(RelayPeerManager);
 };
 
@@ -19,11 +19,13 @@
 #include "base/peer/server_authenticator.h"
 
 #include "base/bitset.h"
-#include "base/cpuid_util.h"
 #include "base/location.h"
 #include "base/logging.h"
 #include "base/sys_info.h"
+#include "base/task_runner.h"
+#include "base/crypto/data_cryptor_chacha20_poly1305.h"
 #include "base/crypto/generic_hash.h"
+#include "base/crypto/openssl_util.h"
 #include "base/crypto/random.h"
 #include "base/crypto/srp_constants.h"
 #include "base/crypto/srp_math.h"
@@ -31,16 +33,67 @@
 #include "base/strings/unicode.h"
 #include "build/version.h"
 
+#include <mutex>
+#include <unordered_map>
+
 namespace base {
 
 namespace {
 
 constexpr size_t kIvSize = 12;
+constexpr std::chrono::minutes kTicketLifetime { 10 };
+constexpr size_t kMaxFakeVerifierCount = 1024;
+
+// The verifiers of the users that are not in the list are calculated from the seed key and the
+// user name. They do not change, so repeated attempts with the same user name reuse them.
+struct FakeVerifierCache
+{
+    std::mutex lock;
+    std::unordered_map<std::string, ByteArray> verifiers;
+};
+
+FakeVerifierCache& fakeVerifierCache()
+{
+    static FakeVerifierCache cache;
+    return cache;
+}
+
+BigNum fakeVerifier(std::u16string_view user_name, const ByteArray& seed_key, const BigNum& s,
+                    const BigNum& N, const BigNum& g)
+{
+    // The salt is a hash of the seed key and the user name, so it identifies the verifier.
+    std::string key = s.toStdString();
+    FakeVerifierCache& cache = fakeVerifierCache();
+
+    {
+        std::scoped_lock lock(cache.lock);
+
+        auto it = cache.verifiers.find(key);
+        if (it != cache.verifiers.end())
+            return BigNum::fromByteArray(it->second);
+    }
+
+    BigNum v = SrpMath::calc_v(user_name, seed_key, s, N, g);
+    if (v.isValid())
+    {
+        std::scoped_lock lock(cache.lock);
+
+        if (cache.verifiers.size() >= kMaxFakeVerifierCount)
+            cache.verifiers.clear();
+
+        cache.verifiers.emplace(std::move(key), v.toByteArray());
+    }
+
+    return v;
+}
 
 } // namespace
 
 ServerAuthenticator::ServerAuthenticator(std::shared_ptr<TaskRunner> task_runner)
-    : Authenticator(std::move(task_runner))
+    : Authenticator(task_runner),
+      task_runner_(std::move(task_runner)),
+      srp_(std::make_shared<Srp>()),
+      lifetime_(std::make_shared<int>(0))
 {
     LOG(LS_INFO) << "Ctor";
 }
@@ -118,6 +171,18 @@ bool ServerAuthenticator::setAnonymousAccess(
     return true;
 }
 
+void ServerAuthenticator::setCryptoTaskRunner(std::shared_ptr<TaskRunner> crypto_task_runner)
+{
+    DCHECK_EQ(state(), State::STOPPED);
+    crypto_task_runner_ = std::move(crypto_task_runner);
+}
+
+void ServerAuthenticator::setTicketKey(const ByteArray& ticket_key)
+{
+    DCHECK_EQ(state(), State::STOPPED);
+    ticket_key_ = ticket_key;
+}
+
 bool ServerAuthenticator::onStarted()
 {
     internal_state_ = InternalState::READ_CLIENT_HELLO;
@@ -178,6 +243,11 @@ void ServerAuthenticator::onReceived(const ByteArray& buffer)
             onSessionResponse(buffer);
             break;
 
+        case InternalState::CALCULATION:
+            // The peer must wait for the reply.
+            finish(FROM_HERE, ErrorCode::PROTOCOL_ERROR);
+            break;
+
         default:
             NOTREACHED();
             break;
@@ -198,6 +268,14 @@ void ServerAuthenticator::onWritten()
                     return;
             }
 
+            if (resumed_)
+            {
+                // The key exchange is not needed for the resumed session.
+                internal_state_ = InternalState::SEND_SESSION_CHALLENGE;
+                doSessionChallenge();
+                break;
+            }
+
             switch (identify_)
             {
                 case proto::IDENTIFY_SRP:
@@ -295,7 +373,14 @@ void ServerAuthenticator::onClientHello(const ByteArray& buffer)
         ByteArray peer_public_key = fromStdString(client_hello->public_key());
         decrypt_iv_ = fromStdString(client_hello->iv());
 
-        if (peer_public_key.empty() != decrypt_iv_.empty())
+        // The IV is also sent together with the resumption ticket.
+        if (!peer_public_key.empty() && decrypt_iv_.empty())
+        {
+            finish(FROM_HERE, ErrorCode::PROTOCOL_ERROR);
+            return;
+        }
+
+        if (peer_public_key.empty() && !decrypt_iv_.empty() && client_hello->ticket().empty())
         {
             finish(FROM_HERE, ErrorCode::PROTOCOL_ERROR);
             return;
@@ -322,13 +407,26 @@ void ServerAuthenticator::onClientHello(const ByteArray& buffer)
         }
     }
 
-    bool has_aes_ni = false;
+    if (!client_hello->ticket().empty() && !ticket_key_.empty())
+    {
+        std::string server_nonce = Random::string(kResumptionNonceSize);
+
+        resumed_ = resumeSession(*client_hello, server_nonce);
+        if (resumed_)
+        {
+            LOG(LS_INFO) << "Session resumed for user '" << user_name_ << "'";
 
-#if defined(ARCH_CPU_X86_FAMILY)
-    has_aes_ni = CpuidUtil::hasAesNi();
-#endif
+            server_hello->set_resumed(true);
+            server_hello->set_nonce(server_nonce);
+            server_hello->set_iv(toStdString(encrypt_iv_));
+        }
+        else
+        {
+            LOG(LS_INFO) << "Resumption ticket not accepted";
+        }
+    }
 
-    if ((client_hello->encryption() & proto::ENCRYPTION_AES256_GCM) && has_aes_ni)
+    if ((client_hello->encryption() & proto::ENCRYPTION_AES256_GCM) && hasHardwareAes())
     {
         LOG(LS_INFO) << "Both sides have hardware support AES. Using AES256 GCM";
         // If both sides of the connection support AES, then method AES256 GCM is the fastest option.
@@ -350,6 +448,70 @@ void ServerAuthenticator::onClientHello(const ByteArray& buffer)
     sendMessage(*server_hello);
 }
 
+bool ServerAuthenticator::resumeSession(
+    const proto::ClientHello& client_hello, std::string_view server_nonce)
+{
+    if (client_hello.nonce().size() != kResumptionNonceSize || client_hello.iv().empty())
+        return false;
+
+    DataCryptorChaCha20Poly1305 cryptor(toStdString(ticket_key_));
+
+    std::string serialized_ticket;
+    if (!cryptor.decrypt(client_hello.ticket(), &serialized_ticket))
+        return false;
+
+    proto::TicketData ticket;
+    if (!ticket.ParseFromString(serialized_ticket))
+        return false;
+
+    const int64_t current_time = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    if (ticket.expire_time() < current_time || ticket.identify() != identify_)
+        return false;
+
+    if (identify_ == proto::IDENTIFY_SRP)
+    {
+        if (!user_list_)
+            return false;
+
+        // The user could be changed or removed after the ticket was issued.
+        User user = user_list_->find(base::utf16FromUtf8(ticket.username()));
+        if (!user.isValid() || !(user.flags & User::ENABLED))
+            return false;
+
+        user_name_ = ticket.username();
+        session_types_ = user.sessions;
+    }
+
+    if (encrypt_iv_.empty())
+        encrypt_iv_ = Random::byteArray(kIvSize);
+
+    decrypt_iv_ = fromStdString(client_hello.iv());
+    session_key_ = resumedSessionKey(
+        session_key_, fromStdString(ticket.secret()), client_hello.nonce(), server_nonce);
+
+    return !session_key_.empty() && !encrypt_iv_.empty();
+}
+
+std::string ServerAuthenticator::createTicket() const
+{
+    proto::TicketData ticket;
+    ticket.set_secret(toStdString(resumptionSecret()));
+    ticket.set_identify(identify_);
+    ticket.set_username(user_name_);
+    ticket.set_expire_time(std::chrono::duration_cast<std::chrono::seconds>(
+        (std::chrono::system_clock::now() + kTicketLifetime).time_since_epoch()).count());
+
+    DataCryptorChaCha20Poly1305 cryptor(toStdString(ticket_key_));
+
+    std::string encrypted_ticket;
+    if (!cryptor.encrypt(ticket.SerializeAsString(), &encrypted_ticket))
+        return std::string();
+
+    return encrypted_ticket;
+}
+
 void ServerAuthenticator::onIdentify(const ByteArray& buffer)
 {
     LOG(LS_INFO) << "Received: Identify";
@@ -370,71 +532,83 @@ void ServerAuthenticator::onIdentify(const ByteArray& buffer)
 
     LOG(LS_INFO) << "Username: " << user_name_;
 
-    do
+    std::u16string user_name_utf16 = base::utf16FromUtf8(user_name_);
+    ByteArray seed_key;
+    User user;
+
+    if (user_list_)
+    {
+        user = user_list_->find(user_name_utf16);
+        seed_key = user_list_->seedKey();
+    }
+    else
     {
-        std::u16string user_name_utf16 = base::utf16FromUtf8(user_name_);
-        ByteArray seed_key;
-        User user;
+        LOG(LS_INFO) << "UserList is nullptr";
+    }
 
-        if (user_list_)
-        {
-            user = user_list_->find(user_name_utf16);
-            seed_key = user_list_->seedKey();
-        }
-        else
-        {
-            LOG(LS_INFO) << "UserList is nullptr";
-        }
+    if (seed_key.empty())
+        seed_key = base::Random::byteArray(64);
+
+    if (user.isValid())
+    {
+        LOG(LS_INFO) << "User '" << user_name_ << "' found (enabled: "
+                     << ((user.flags & User::ENABLED) != 0) << ")";
+    }
+    else
+    {
+        LOG(LS_INFO) << "User '" << user_name_ << "' NOT found";
+    }
+
+    bool fake_user = true;
 
-        if (seed_key.empty())
-            seed_key = base::Random::byteArray(64);
+    if (user.isValid() && (user.flags & User::ENABLED))
+    {
+        session_types_ = user.sessions;
 
-        if (user.isValid())
+        std::optional<SrpNgPair> Ng_pair = pairByGroup(user.group);
+        if (Ng_pair.has_value())
         {
-            LOG(LS_INFO) << "User '" << user_name_ << "' found (enabled: "
-                         << ((user.flags & User::ENABLED) != 0) << ")";
+            srp_->N = BigNum::fromStdString(Ng_pair->first);
+            srp_->g = BigNum::fromStdString(Ng_pair->second);
+            srp_->s = BigNum::fromByteArray(user.salt);
+            srp_->v = BigNum::fromByteArray(user.verifier);
+            fake_user = false;
         }
         else
         {
-            LOG(LS_INFO) << "User '" << user_name_ << "' NOT found";
-        }
-
-        if (user.isValid() && (user.flags & User::ENABLED))
-        {
-            session_types_ = user.sessions;
-
-            std::optional<SrpNgPair> Ng_pair = pairByGroup(user.group);
-            if (Ng_pair.has_value())
-            {
-                N_ = BigNum::fromStdString(Ng_pair->first);
-                g_ = BigNum::fromStdString(Ng_pair->second);
-                s_ = BigNum::fromByteArray(user.salt);
-                v_ = BigNum::fromByteArray(user.verifier);
-                break;
-            }
-            else
-            {
-                LOG(LS_ERROR) << "User '" << user.name << "' has an invalid SRP group";
-            }
+            LOG(LS_ERROR) << "User '" << user.name << "' has an invalid SRP group";
         }
+    }
 
+    if (fake_user)
+    {
         session_types_ = 0;
 
         GenericHash hash(GenericHash::BLAKE2b512);
         hash.addData(seed_key);
         hash.addData(user_name_);
 
-        N_ = BigNum::fromStdString(kSrpNgPair_8192.first);
-        g_ = BigNum::fromStdString(kSrpNgPair_8192.second);
-        s_ = BigNum::fromByteArray(hash.result());
-        v_ = SrpMath::calc_v(user_name_utf16, seed_key, s_, N_, g_);
+        srp_->N = BigNum::fromStdString(kSrpNgPair_8192.first);
+        srp_->g = BigNum::fromStdString(kSrpNgPair_8192.second);
+        srp_->s = BigNum::fromByteArray(hash.result());
     }
-    while (false);
 
-    b_ = BigNum::fromByteArray(Random::byteArray(128)); // 1024 bits.
-    B_ = SrpMath::calc_B(b_, N_, g_, v_);
+    std::shared_ptr<Srp> srp = srp_;
+
+    runCalculation([srp, fake_user, user_name_utf16, seed_key]()
+    {
+        if (fake_user)
+            srp->v = fakeVerifier(user_name_utf16, seed_key, srp->s, srp->N, srp->g);
+
+        srp->b = BigNum::fromByteArray(Random::byteArray(128)); // 1024 bits.
+        srp->B = SrpMath::calc_B(srp->b, srp->N, srp->g, srp->v);
+    },
+    std::bind(&ServerAuthenticator::doServerKeyExchange, this));
+}
 
-    if (!N_.isValid() || !g_.isValid() || !s_.isValid() || !B_.isValid())
+void ServerAuthenticator::doServerKeyExchange()
+{
+    if (!srp_->N.isValid() || !srp_->g.isValid() || !srp_->s.isValid() || !srp_->B.isValid())
     {
         finish(FROM_HERE, ErrorCode::PROTOCOL_ERROR);
         return;
@@ -446,10 +620,10 @@ void ServerAuthenticator::onIdentify(const ByteArray& buffer)
     std::unique_ptr<proto::SrpServerKeyExchange> server_key_exchange =
         std::make_unique<proto::SrpServerKeyExchange>();
 
-    server_key_exchange->set_number(N_.toStdString());
-    server_key_exchange->set_generator(g_.toStdString());
-    server_key_exchange->set_salt(s_.toStdString());
-    server_key_exchange->set_b(B_.toStdString());
+    server_key_exchange->set_number(srp_->N.toStdString());
+    server_key_exchange->set_generator(srp_->g.toStdString());
+    server_key_exchange->set_salt(srp_->s.toStdString());
+    server_key_exchange->set_b(srp_->B.toStdString());
     server_key_exchange->set_iv(toStdString(encrypt_iv_));
 
     LOG(LS_INFO) << "Sending: ServerKeyExchange";
@@ -468,16 +642,30 @@ void ServerAuthenticator::onClientKeyExchange(const ByteArray& buffer)
         return;
     }
 
-    A_ = BigNum::fromStdString(client_key_exchange->a());
+    srp_->A = BigNum::fromStdString(client_key_exchange->a());
     decrypt_iv_ = fromStdString(client_key_exchange->iv());
 
-    if (!A_.isValid() || decrypt_iv_.empty())
+    if (!srp_->A.isValid() || decrypt_iv_.empty())
     {
         finish(FROM_HERE, ErrorCode::PROTOCOL_ERROR);
         return;
     }
 
-    ByteArray srp_key = createSrpKey();
+    std::shared_ptr<Srp> srp = srp_;
+    std::shared_ptr<ByteArray> srp_key = std::make_shared<ByteArray>();
+
+    runCalculation([srp, srp_key]()
+    {
+        *srp_key = createSrpKey(*srp);
+    },
+    [this, srp_key]()
+    {
+        onSrpKeyCreated(*srp_key);
+    });
+}
+
+void ServerAuthenticator::onSrpKeyCreated(const ByteArray& srp_key)
+{
     if (srp_key.empty())
     {
         finish(FROM_HERE, ErrorCode::UNKNOWN_ERROR);
@@ -529,6 +717,10 @@ void ServerAuthenticator::doSessionChallenge()
     session_challenge->set_computer_name(SysInfo::computerName());
     session_challenge->set_cpu_cores(static_cast<uint32_t>(SysInfo::processorThreads()));
 
+    // The ticket is useless without encryption, because its secret comes from the session key.
+    if (!ticket_key_.empty() && !session_key_.empty())
+        session_challenge->set_ticket(createTicket());
+
     LOG(LS_INFO) << "Sending: SessionChallenge";
     sendMessage(*session_challenge);
 }
@@ -573,18 +765,50 @@ void ServerAuthenticator::onSessionResponse(const ByteArray& buffer)
     finish(FROM_HERE, ErrorCode::SUCCESS);
 }
 
-ByteArray ServerAuthenticator::createSrpKey()
+// static
+ByteArray ServerAuthenticator::createSrpKey(const Srp& srp)
 {
-    if (!SrpMath::verify_A_mod_N(A_, N_))
+    if (!SrpMath::verify_A_mod_N(srp.A, srp.N))
     {
         LOG(LS_ERROR) << "SrpMath::verify_A_mod_N failed";
         return ByteArray();
     }
 
-    BigNum u = SrpMath::calc_u(A_, B_, N_);
-    BigNum server_key = SrpMath::calcServerKey(A_, v_, u, b_, N_);
+    BigNum u = SrpMath::calc_u(srp.A, srp.B, srp.N);
+    BigNum server_key = SrpMath::calcServerKey(srp.A, srp.v, u, srp.b, srp.N);
 
     return server_key.toByteArray();
 }
 
+void ServerAuthenticator::runCalculation(
+    std::function<void()> calculation, std::function<void()> done)
+{
+    if (!crypto_task_runner_)
+    {
+        calculation();
+        done();
+        return;
+    }
+
+    // No messages are expected from the peer until the reply is sent.
+    internal_state_ = InternalState::CALCULATION;
+
+    std::weak_ptr<int> lifetime = lifetime_;
+    std::shared_ptr<TaskRunner> task_runner = task_runner_;
+
+    crypto_task_runner_->postTask([this, calculation, done, lifetime, task_runner]()
+    {
+        calculation();
+
+        task_runner->postTask([this, done, lifetime]()
+        {
+            // The authenticator is destroyed on its own thread, so the check is reliable here.
+            if (lifetime.expired() || state() != State::PENDING)
+                return;
+
+            done();
+        });
+    });
+}
+
 } // namespace base
@@ -52,6 +52,14 @@ public:
     // By default, anonymous access is disabled.
     [[nodiscard]] bool setAnonymousAccess(AnonymousAccess anonymous_access, uint32_t session_types);
 
+    // Sets the task runner for the SRP calculations. If it is not set, the calculations are done
+    // on the task runner of the authenticator. Must be called before calling start().
+    void setCryptoTaskRunner(std::shared_ptr<TaskRunner> crypto_task_runner);
+
+    // Sets the key for the resumption tickets. If it is set, the clients get tickets that allow
+    // them to reconnect without the key exchange. Must be called before calling start().
+    void setTicketKey(const ByteArray& ticket_key);
+
 protected:
     // Authenticator implementation.
     bool onStarted() override;
@@ -60,11 +68,36 @@ protected:
 
 private:
     void onClientHello(const ByteArray& buffer);
+    [[nodiscard]] bool resumeSession(const proto::ClientHello& client_hello,
+                                     std::string_view server_nonce);
+    [[nodiscard]] std::string createTicket() const;
     void onIdentify(const ByteArray& buffer);
+    void doServerKeyExchange();
     void onClientKeyExchange(const ByteArray& buffer);
+    void onSrpKeyCreated(const ByteArray& srp_key);
     void doSessionChallenge();
     void onSessionResponse(const ByteArray& buffer);
-    [[nodiscard]] ByteArray createSrpKey();
+
+    // SRP values. They are used by the crypto thread while a calculation is running.
+    struct Srp
+    {
+        BigNum N;
+        BigNum g;
+        BigNum v;
+        BigNum s;
+        BigNum b;
+        BigNum B;
+        BigNum A;
+    };
+
+    [[nodiscard]] static ByteArray createSrpKey(const Srp& srp);
+
+    // Runs |calculation| on the crypto task runner and then |done| on the task runner of the
+    // authenticator. |done| is not called if the authenticator was destroyed or finished before.
+    void runCalculation(std::function<void()> calculation, std::function<void()> done);
+
+    std::shared_ptr<TaskRunner> task_runner_;
+    std::shared_ptr<TaskRunner> crypto_task_runner_;
 
     std::shared_ptr<UserListBase> user_list_;
 
@@ -75,10 +108,14 @@ private:
         READ_IDENTIFY,
         SEND_SERVER_KEY_EXCHANGE,
         READ_CLIENT_KEY_EXCHANGE,
+        CALCULATION,
         SEND_SESSION_CHALLENGE,
         READ_SESSION_RESPONSE
     };
 
+    ByteArray ticket_key_;
+    bool resumed_ = false;
+
     AnonymousAccess anonymous_access_ = AnonymousAccess::DISABLE;
     InternalState internal_state_ = InternalState::READ_CLIENT_HELLO;
 
@@ -86,13 +123,10 @@ private:
     uint32_t session_types_ = 0;
 
     KeyPair key_pair_;
-    BigNum N_;
-    BigNum g_;
-    BigNum v_;
-    BigNum s_;
-    BigNum b_;
-    BigNum B_;
-    BigNum A_;
+    std::shared_ptr<Srp> srp_;
+
+    // Expires when the authenticator is destroyed.
+    std::shared_ptr<int> lifetime_;
 
     DISALLOW_COPY_AND_ASSIGN(ServerAuthenticator);
 };
@@ -21,6 +21,7 @@
 #include "base/logging.h"
 #include "base/task_runner.h"
 #include "base/peer/user_list_base.h"
+#include "base/threading/thread_pool.h"
 
 namespace base {
 
@@ -56,6 +57,16 @@ void ServerAuthenticatorManager::setAnonymousAccess(
     anonymous_session_types_ = session_types;
 }
 
+void ServerAuthenticatorManager::setCryptoPool(std::shared_ptr<ThreadPool> crypto_pool)
+{
+    crypto_pool_ = std::move(crypto_pool);
+}
+
+void ServerAuthenticatorManager::setTicketKey(const ByteArray& ticket_key)
+{
+    ticket_key_ = ticket_key;
+}
+
 void ServerAuthenticatorManager::addNewChannel(std::unique_ptr<NetworkChannel> channel)
 {
     DCHECK(channel);
@@ -64,6 +75,12 @@ void ServerAuthenticatorManager::addNewChannel(std::unique_ptr<NetworkChannel> c
         std::make_unique<ServerAuthenticator>(task_runner_);
     authenticator->setUserList(user_list_);
 
+    if (crypto_pool_)
+        authenticator->setCryptoTaskRunner(crypto_pool_->taskRunner());
+
+    if (!ticket_key_.empty())
+        authenticator->setTicketKey(ticket_key_);
+
     if (!private_key_.empty())
     {
         if (!authenticator->setPrivateKey(private_key_))
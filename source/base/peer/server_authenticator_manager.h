@@ -23,6 +23,8 @@
 
 namespace base {
 
+class ThreadPool;
+
 class ServerAuthenticatorManager
 {
 public:
@@ -63,6 +65,15 @@ public:
     void setAnonymousAccess(
         ServerAuthenticator::AnonymousAccess anonymous_access, uint32_t session_types);
 
+    // Sets the threads for the SRP calculations of the authenticators, so a burst of new
+    // connections does not delay other work on the task runner. The pool can be shared between
+    // several managers.
+    void setCryptoPool(std::shared_ptr<ThreadPool> crypto_pool);
+
+    // Sets the key for the resumption tickets of the authenticators. The key must be the same for
+    // all managers of the server.
+    void setTicketKey(const ByteArray& ticket_key);
+
     // Adds a channel to the authentication queue. After success completion, a session will be
     // created (in a stopped state) and method Delegate::onNewSession will be called.
     // If authentication fails, the channel will be automatically deleted.
@@ -74,8 +85,10 @@ private:
     std::shared_ptr<TaskRunner> task_runner_;
     std::shared_ptr<UserListBase> user_list_;
     std::vector<std::unique_ptr<ServerAuthenticator>> pending_;
+    std::shared_ptr<ThreadPool> crypto_pool_;
 
     ByteArray private_key_;
+    ByteArray ticket_key_;
 
     ServerAuthenticator::AnonymousAccess anonymous_access_ =
         ServerAuthenticator::AnonymousAccess::DISABLE;
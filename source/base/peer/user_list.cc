@@ -25,10 +25,13 @@ namespace base {
 UserList::UserList() = default;
 
 UserList::UserList(const std::vector<User>& list, const ByteArray& seed_key)
-    : seed_key_(seed_key),
-      list_(list)
+    : seed_key_(seed_key)
 {
-    // Nothing
+    list_.reserve(list.size());
+    index_.reserve(list.size());
+
+    for (const auto& user : list)
+        add(user);
 }
 
 UserList::~UserList() = default;
@@ -46,27 +49,28 @@ std::unique_ptr<UserList> UserList::duplicate() const
 
 void UserList::add(const User& user)
 {
-    if (user.isValid())
-        list_.emplace_back(user);
+    if (!user.isValid())
+        return;
+
+    index_.insert_or_assign(toLower(user.name), list_.size());
+    list_.emplace_back(user);
 }
 
 void UserList::merge(const UserList& user_list)
 {
+    list_.reserve(list_.size() + user_list.list_.size());
+
     for (const auto& user : user_list.list_)
         add(user);
 }
 
 User UserList::find(std::u16string_view username) const
 {
-    const User* user = &User::kInvalidUser;
-
-    for (const auto& item : list_)
-    {
-        if (compareCaseInsensitive(username, item.name) == 0)
-            user = &item;
-    }
+    auto it = index_.find(toLower(username));
+    if (it == index_.end())
+        return User::kInvalidUser;
 
-    return *user;
+    return list_[it->second];
 }
 
 void UserList::setSeedKey(const ByteArray& seed_key)
@@ -22,6 +22,8 @@
 #include "base/macros_magic.h"
 #include "base/peer/user_list_base.h"
 
+#include <unordered_map>
+
 namespace base {
 
 class UserList : public UserListBase
@@ -47,6 +49,10 @@ private:
     ByteArray seed_key_;
     std::vector<User> list_;
 
+    // Lower case user names and positions of the users in |list_|. If several users have the same
+    // name, the last added one is found.
+    std::unordered_map<std::u16string, size_t> index_;
+
     DISALLOW_COPY_AND_ASSIGN(UserList);
 };
 
@@ -25,8 +25,16 @@ namespace base {
 
 ProtobufArena::ProtobufArena(std::shared_ptr<TaskRunner> task_runner)
     : cleanup_timer_(std::make_unique<WaitableTimer>(
-          WaitableTimer::Type::REPEATED, std::move(task_runner)))
+          WaitableTimer::Type::REPEATED, std::move(task_runner))),
+      incoming_block_(std::make_unique<char[]>(kIncomingArenaBlockSize))
 {
+    google::protobuf::ArenaOptions incoming_options;
+    incoming_options.initial_block = incoming_block_.get();
+    incoming_options.initial_block_size = kIncomingArenaBlockSize;
+    incoming_options.max_block_size = kIncomingArenaBlockSize;
+
+    incoming_arena_ = std::make_unique<google::protobuf::Arena>(incoming_options);
+
     cleanup_timer_->start(std::chrono::seconds(60), [this]()
     {
         if (arena_.SpaceUsed() >= arena_start_block_size_)
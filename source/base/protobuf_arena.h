@@ -48,12 +48,28 @@ protected:
         return google::protobuf::Arena::CreateMessage<T>(&arena_);
     }
 
+    // Returns a message to parse an incoming message into. Incoming messages are allocated in a
+    // separate arena that is cleared for each new message, so the previous incoming message must
+    // not be used after the call. The first block of the arena is kept between messages and
+    // parsing of small messages does not allocate memory.
+    template<class T>
+    T* incomingMessageFromArena()
+    {
+        incoming_arena_->Reset();
+        return google::protobuf::Arena::CreateMessage<T>(incoming_arena_.get());
+    }
+
 private:
+    static const size_t kIncomingArenaBlockSize = 64 * 1024; // 64 kB
+
     void reset();
 
     std::unique_ptr<WaitableTimer> cleanup_timer_;
     google::protobuf::Arena arena_;
 
+    std::unique_ptr<char[]> incoming_block_;
+    std::unique_ptr<google::protobuf::Arena> incoming_arena_;
+
     size_t arena_start_block_size_ = kArenaStartBlockSize;
     size_t arena_max_block_size_ = kArenaMaxBlockSize;
 };
@@ -39,7 +39,7 @@ public:
     void postTask(TaskRunner::Callback callback)
     {
         auto self = shared_from_this();
-        task_runner_->postTask([self, callback]()
+        task_runner_->postTask([self, callback = std::move(callback)]()
         {
             if (!self->attached_)
                 return;
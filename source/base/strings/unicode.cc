@@ -20,6 +20,8 @@
 
 #include "base/logging.h"
 
+#include <cstring>
+
 #if defined(OS_WIN)
 #include <Windows.h>
 #endif // defined(OS_WIN)
@@ -33,13 +35,70 @@ namespace base {
 
 namespace {
 
+// Returns the number of leading ASCII characters. Eight bytes are checked at once.
+size_t asciiPrefixLength(std::string_view in)
+{
+    const char* data = in.data();
+    const size_t size = in.size();
+    size_t i = 0;
+
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t chunk;
+        memcpy(&chunk, data + i, sizeof(chunk));
+
+        if (chunk & 0x8080808080808080ULL)
+            break;
+    }
+
+    while (i < size && !(static_cast<uint8_t>(data[i]) & 0x80))
+        ++i;
+
+    return i;
+}
+
+template <class InputType>
+size_t asciiPrefixLength16(InputType in)
+{
+    static_assert(sizeof(typename InputType::value_type) == sizeof(uint16_t));
+
+    const auto* data = in.data();
+    const size_t size = in.size();
+    const size_t kUnitsPerChunk = sizeof(uint64_t) / sizeof(uint16_t);
+    size_t i = 0;
+
+    for (; i + kUnitsPerChunk <= size; i += kUnitsPerChunk)
+    {
+        uint64_t chunk;
+        memcpy(&chunk, data + i, sizeof(chunk));
+
+        if (chunk & 0xFF80FF80FF80FF80ULL)
+            break;
+    }
+
+    while (i < size && !(static_cast<uint16_t>(data[i]) & 0xFF80))
+        ++i;
+
+    return i;
+}
+
+// ASCII characters are the same in all supported encodings. They are copied directly and only the
+// rest of the string is passed to the converter.
+template <class OutputType, class InputType>
+void appendAscii(InputType in, OutputType* out)
+{
+    const size_t offset = out->size();
+    out->resize(offset + in.size());
+
+    for (size_t i = 0; i < in.size(); ++i)
+        (*out)[offset + i] = static_cast<typename OutputType::value_type>(in[i]);
+}
+
 #if defined(OS_WIN)
 
 template <class InputType>
 bool wideToLocalImpl(InputType in, std::string* out)
 {
-    out->clear();
-
     const size_t in_len = in.length();
     if (!in_len)
         return true;
@@ -51,12 +110,13 @@ bool wideToLocalImpl(InputType in, std::string* out)
     if (out_len <= 0)
         return false;
 
-    out->resize(static_cast<size_t>(out_len));
+    const size_t offset = out->size();
+    out->resize(offset + static_cast<size_t>(out_len));
 
     if (WideCharToMultiByte(CP_ACP, 0,
                             reinterpret_cast<const wchar_t*>(in.data()),
                             static_cast<int>(in_len),
-                            out->data(), out_len, nullptr, nullptr) != out_len)
+                            out->data() + offset, out_len, nullptr, nullptr) != out_len)
     {
         return false;
     }
@@ -67,8 +127,6 @@ bool wideToLocalImpl(InputType in, std::string* out)
 template <class OutputType>
 bool localToWideImpl(std::string_view in, OutputType* out)
 {
-    out->clear();
-
     const size_t in_len = in.length();
     if (!in_len)
         return true;
@@ -78,10 +136,11 @@ bool localToWideImpl(std::string_view in, OutputType* out)
     if (out_len <= 0)
         return false;
 
-    out->resize(static_cast<size_t>(out_len));
+    const size_t offset = out->size();
+    out->resize(offset + static_cast<size_t>(out_len));
 
     if (MultiByteToWideChar(CP_ACP, 0, in.data(), static_cast<int>(in_len),
-                            reinterpret_cast<wchar_t*>(out->data()), out_len) != out_len)
+                            reinterpret_cast<wchar_t*>(out->data() + offset), out_len) != out_len)
     {
         return false;
     }
@@ -89,105 +148,104 @@ bool localToWideImpl(std::string_view in, OutputType* out)
     return true;
 }
 
+// UTF conversions are done in one pass. The output is allocated for the worst case: 3 bytes of
+// UTF-8 per UTF-16 code unit and 1 UTF-16 code unit per byte of UTF-8.
 template <class InputType>
 bool wideToUtf8Impl(InputType in, std::string* out)
 {
-    out->clear();
-
     const size_t in_len = in.length();
     if (!in_len)
         return true;
 
+    const size_t offset = out->size();
+    out->resize(offset + in_len * 3);
+
     const int out_len = WideCharToMultiByte(CP_UTF8, 0,
                                             reinterpret_cast<const wchar_t*>(in.data()),
                                             static_cast<int>(in_len),
-                                            nullptr, 0, nullptr, nullptr);
+                                            out->data() + offset,
+                                            static_cast<int>(in_len * 3),
+                                            nullptr, nullptr);
     if (out_len <= 0)
-        return false;
-
-    out->resize(static_cast<size_t>(out_len));
-
-    if (WideCharToMultiByte(CP_UTF8, 0,
-                            reinterpret_cast<const wchar_t*>(in.data()),
-                            static_cast<int>(in_len),
-                            out->data(), out_len, nullptr, nullptr) != out_len)
     {
+        out->resize(offset);
         return false;
     }
 
+    out->resize(offset + static_cast<size_t>(out_len));
     return true;
 }
 
 template <class OutputType>
 bool utf8ToWideImpl(std::string_view in, OutputType* out)
 {
-    out->clear();
-
     const size_t in_len = in.length();
     if (!in_len)
         return true;
 
-    const int out_len =
-        MultiByteToWideChar(CP_UTF8, 0, in.data(), static_cast<int>(in_len), nullptr, 0);
-    if (out_len <= 0)
-        return false;
-
-    out->resize(static_cast<size_t>(out_len));
+    const size_t offset = out->size();
+    out->resize(offset + in_len);
 
-    if (MultiByteToWideChar(CP_UTF8, 0, in.data(), static_cast<int>(in_len),
-                            reinterpret_cast<wchar_t*>(out->data()), out_len) != out_len)
+    const int out_len = MultiByteToWideChar(CP_UTF8, 0, in.data(), static_cast<int>(in_len),
+                                            reinterpret_cast<wchar_t*>(out->data() + offset),
+                                            static_cast<int>(in_len));
+    if (out_len <= 0)
     {
+        out->resize(offset);
         return false;
     }
 
+    out->resize(offset + static_cast<size_t>(out_len));
     return true;
 }
 
 #else
 
+// UTF conversions are done in one pass. The output is allocated for the worst case: 3 bytes of
+// UTF-8 per UTF-16 code unit and 1 UTF-16 code unit per byte of UTF-8.
 bool utf16ToUtf8Impl(std::u16string_view in, std::string* out)
 {
-    out->clear();
-
     if (!in.length())
         return true;
 
+    const size_t offset = out->size();
+    out->resize(offset + in.length() * 3);
+
     UErrorCode error_code = U_ZERO_ERROR;
     int32_t out_len = 0;
-    u_strToUTF8(nullptr, 0, &out_len, in.data(), in.length(), &error_code);
-    if (error_code != U_BUFFER_OVERFLOW_ERROR || out_len <= 0)
-        return false;
 
-    error_code = U_ZERO_ERROR;
-    out->resize(out_len);
-
-    u_strToUTF8(out->data(), out->length(), &out_len, in.data(), in.length(), &error_code);
+    u_strToUTF8(out->data() + offset, static_cast<int32_t>(in.length() * 3), &out_len,
+                in.data(), static_cast<int32_t>(in.length()), &error_code);
     if (!U_SUCCESS(error_code) || out_len <= 0)
+    {
+        out->resize(offset);
         return false;
+    }
 
+    out->resize(offset + static_cast<size_t>(out_len));
     return true;
 }
 
 bool utf8ToUtf16Impl(std::string_view in, std::u16string* out)
 {
-    out->clear();
-
     if (!in.length())
         return true;
 
+    const size_t offset = out->size();
+    out->resize(offset + in.length());
+
     UErrorCode error_code = U_ZERO_ERROR;
     int32_t out_len = 0;
-    u_strFromUTF8(nullptr, 0, &out_len, in.data(), in.length(), &error_code);
-    if (error_code != U_BUFFER_OVERFLOW_ERROR || out_len <= 0)
-        return false;
 
-    error_code = U_ZERO_ERROR;
-    out->resize(out_len);
-
-    u_strFromUTF8(out->data(), out->length(), &out_len, in.data(), in.length(), &error_code);
+    u_strFromUTF8(out->data() + offset, static_cast<int32_t>(in.length()), &out_len,
+                  in.data(), static_cast<int32_t>(in.length()), &error_code);
     if (!U_SUCCESS(error_code) || out_len <= 0)
+    {
+        out->resize(offset);
         return false;
+    }
 
+    out->resize(offset + static_cast<size_t>(out_len));
     return true;
 }
 
@@ -203,6 +261,27 @@ bool localToUtf16Impl(std::string_view in, std::u16string* out)
 
 #endif
 
+// Converts the ASCII prefix of |in| directly and passes the rest to |converter|, which appends
+// the result to |out|.
+template <class InputType, class OutputType, class Converter>
+bool convert(InputType in, OutputType* out, Converter converter)
+{
+    out->clear();
+
+    size_t ascii_length;
+    if constexpr (sizeof(typename InputType::value_type) == sizeof(char))
+        ascii_length = asciiPrefixLength(in);
+    else
+        ascii_length = asciiPrefixLength16(in);
+
+    appendAscii(in.substr(0, ascii_length), out);
+
+    if (ascii_length == in.size())
+        return true;
+
+    return converter(in.substr(ascii_length), out);
+}
+
 template <class InputString, class OutputString>
 OutputString asciiConverter(InputString in)
 {
@@ -220,18 +299,18 @@ OutputString asciiConverter(InputString in)
 bool utf16ToUtf8(std::u16string_view in, std::string* out)
 {
 #if defined(WCHAR_T_IS_UTF16)
-    return wideToUtf8Impl(in, out);
+    return convert(in, out, wideToUtf8Impl<std::u16string_view>);
 #else
-    return utf16ToUtf8Impl(in, out);
+    return convert(in, out, utf16ToUtf8Impl);
 #endif
 }
 
 bool utf8ToUtf16(std::string_view in, std::u16string* out)
 {
 #if defined(WCHAR_T_IS_UTF16)
-    return utf8ToWideImpl(in, out);
+    return convert(in, out, utf8ToWideImpl<std::u16string>);
 #else
-    return utf8ToUtf16Impl(in, out);
+    return convert(in, out, utf8ToUtf16Impl);
 #endif
 }
 
@@ -253,12 +332,12 @@ std::string utf8FromUtf16(std::u16string_view in)
 
 bool wideToUtf8(std::wstring_view in, std::string* out)
 {
-    return wideToUtf8Impl(in, out);
+    return convert(in, out, wideToUtf8Impl<std::wstring_view>);
 }
 
 bool utf8ToWide(std::string_view in, std::wstring* out)
 {
-    return utf8ToWideImpl(in, out);
+    return convert(in, out, utf8ToWideImpl<std::wstring>);
 }
 
 std::wstring wideFromUtf8(std::string_view in)
@@ -338,18 +417,18 @@ std::wstring wideFromAscii(std::string_view in)
 bool utf16ToLocal8Bit(std::u16string_view in, std::string* out)
 {
 #if defined(WCHAR_T_IS_UTF16)
-    return wideToLocalImpl(in, out);
+    return convert(in, out, wideToLocalImpl<std::u16string_view>);
 #else
-    return utf16ToLocalImpl(in, out);
+    return convert(in, out, utf16ToLocalImpl);
 #endif
 }
 
 bool local8BitToUtf16(std::string_view in, std::u16string* out)
 {
 #if defined(WCHAR_T_IS_UTF16)
-    return localToWideImpl(in, out);
+    return convert(in, out, localToWideImpl<std::u16string>);
 #else
-    return localToUtf16Impl(in, out);
+    return convert(in, out, localToUtf16Impl);
 #endif
 }
 
@@ -371,12 +450,12 @@ std::string local8BitFromUtf16(std::u16string_view in)
 
 bool wideToLocal8Bit(std::wstring_view in, std::string* out)
 {
-    return wideToLocalImpl(in, out);
+    return convert(in, out, wideToLocalImpl<std::wstring_view>);
 }
 
 bool local8BitToWide(std::string_view in, std::wstring* out)
 {
-    return localToWideImpl(in, out);
+    return convert(in, out, localToWideImpl<std::wstring>);
 }
 
 std::wstring wideFromLocal8Bit(std::string_view in)
@@ -0,0 +1,72 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/strings/unicode.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(UnicodeTest, Empty)
+{
+    EXPECT_TRUE(utf16FromUtf8(std::string_view()).empty());
+    EXPECT_TRUE(utf8FromUtf16(std::u16string_view()).empty());
+}
+
+TEST(UnicodeTest, Ascii)
+{
+    EXPECT_EQ(utf16FromUtf8("a"), u"a");
+    EXPECT_EQ(utf16FromUtf8("Hello, world! 0123456789"), u"Hello, world! 0123456789");
+    EXPECT_EQ(utf8FromUtf16(u"a"), "a");
+    EXPECT_EQ(utf8FromUtf16(u"Hello, world! 0123456789"), "Hello, world! 0123456789");
+}
+
+TEST(UnicodeTest, NonAscii)
+{
+    // Non-ASCII characters at the beginning, in the middle and at the end of the string.
+    const char kUtf8[] = u8"при long ASCII run é中\U0001F600 tail ü";
+    const char16_t kUtf16[] = u"при long ASCII run é中\U0001F600 tail ü";
+
+    EXPECT_EQ(utf16FromUtf8(kUtf8), kUtf16);
+    EXPECT_EQ(utf8FromUtf16(kUtf16), kUtf8);
+
+    EXPECT_EQ(utf16FromUtf8(u8"ASCII prefix of 24 bytesé"), u"ASCII prefix of 24 bytesé");
+    EXPECT_EQ(utf8FromUtf16(u"ASCII prefix of 24 bytesé"), u8"ASCII prefix of 24 bytesé");
+}
+
+TEST(UnicodeTest, ReuseOutput)
+{
+    std::u16string utf16(u"previous value");
+    EXPECT_TRUE(utf8ToUtf16("new", &utf16));
+    EXPECT_EQ(utf16, u"new");
+
+    std::string utf8("previous value");
+    EXPECT_TRUE(utf16ToUtf8(u"é", &utf8));
+    EXPECT_EQ(utf8, u8"é");
+}
+
+TEST(UnicodeTest, Invalid)
+{
+    std::u16string utf16;
+    EXPECT_FALSE(utf8ToUtf16("ASCII \xff\xfe", &utf16));
+
+    std::string utf8;
+    EXPECT_FALSE(utf16ToUtf8(std::u16string(u"ASCII ") + char16_t(0xD800), &utf8));
+}
+
+} // namespace base
@@ -47,6 +47,10 @@ public:
     static int processorCores();
     static int processorThreads();
 
+    // Returns true if the computer runs on battery now. False if it is connected to the power
+    // line, has no battery or the state is unknown.
+    static bool isOnBatteryPower();
+
 private:
     DISALLOW_COPY_AND_ASSIGN(SysInfo);
 };
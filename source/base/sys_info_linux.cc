@@ -151,4 +151,38 @@ int SysInfo::processorThreads()
     return static_cast<int>(res);
 }
 
+// static
+bool SysInfo::isOnBatteryPower()
+{
+    const std::filesystem::path kPowerSupplyDir("/sys/class/power_supply");
+
+    std::error_code ignored_code;
+    bool has_battery = false;
+
+    for (const auto& item : std::filesystem::directory_iterator(kPowerSupplyDir, ignored_code))
+    {
+        std::string type;
+        if (!readFile(item.path() / "type", &type))
+            continue;
+
+        std::string online;
+        if (type.compare(0, 5, "Mains") == 0 && readFile(item.path() / "online", &online) &&
+            online.compare(0, 1, "1") == 0)
+        {
+            // The power line is connected.
+            return false;
+        }
+
+        // The batteries of the peripheral devices have the scope "Device".
+        std::string scope;
+        if (type.compare(0, 7, "Battery") == 0 &&
+            (!readFile(item.path() / "scope", &scope) || scope.compare(0, 6, "Device") != 0))
+        {
+            has_battery = true;
+        }
+    }
+
+    return has_battery;
+}
+
 } // namespace base
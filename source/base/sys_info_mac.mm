@@ -138,4 +138,11 @@ int SysInfo::processorThreads()
     return static_cast<int>(res);
 }
 
+// static
+bool SysInfo::isOnBatteryPower()
+{
+    NOTIMPLEMENTED();
+    return false;
+}
+
 } // namespace base
@@ -369,4 +369,20 @@ int SysInfo::processorThreads()
     return system_info.dwNumberOfProcessors;
 }
 
+// static
+bool SysInfo::isOnBatteryPower()
+{
+    SYSTEM_POWER_STATUS power_status;
+    memset(&power_status, 0, sizeof(power_status));
+
+    if (!GetSystemPowerStatus(&power_status))
+    {
+        PLOG(LS_WARNING) << "GetSystemPowerStatus failed";
+        return false;
+    }
+
+    // 0 is offline, 255 is unknown status.
+    return power_status.ACLineStatus == 0;
+}
+
 } // namespace base
@@ -0,0 +1,191 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__TASK_CALLBACK_H
+#define BASE__TASK_CALLBACK_H
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace base {
+
+// Move-only callable wrapper for tasks posted to task runners. Unlike std::function, functors that
+// fit into the inline buffer (a lambda capturing a couple of shared pointers and a message) are
+// stored without a heap allocation, and functors that capture move-only objects are accepted.
+class TaskCallback
+{
+public:
+    // Size of the buffer for functors stored without an allocation.
+    static constexpr size_t kInlineSize = 48;
+
+    TaskCallback() = default;
+    TaskCallback(std::nullptr_t) {}
+
+    template <class Function,
+              class = std::enable_if_t<!std::is_same_v<std::decay_t<Function>, TaskCallback> &&
+                                       std::is_invocable_r_v<void, std::decay_t<Function>&>>>
+    TaskCallback(Function&& function)
+    {
+        using Stored = std::decay_t<Function>;
+
+        if constexpr (std::is_pointer_v<Stored> ||
+                      std::is_member_pointer_v<Stored> ||
+                      IsStdFunction<Stored>::value)
+        {
+            // Empty function pointers and std::function objects give an empty callback.
+            if (!function)
+                return;
+        }
+
+        if constexpr (isInline<Stored>())
+        {
+            new (&storage_) Stored(std::forward<Function>(function));
+            ops_ = &kInlineOps<Stored>;
+        }
+        else
+        {
+            *reinterpret_cast<Stored**>(&storage_) = new Stored(std::forward<Function>(function));
+            ops_ = &kHeapOps<Stored>;
+        }
+    }
+
+    TaskCallback(TaskCallback&& other) noexcept
+    {
+        moveFrom(other);
+    }
+
+    TaskCallback& operator=(TaskCallback&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    TaskCallback& operator=(std::nullptr_t)
+    {
+        reset();
+        return *this;
+    }
+
+    ~TaskCallback()
+    {
+        reset();
+    }
+
+    void operator()() const
+    {
+        ops_->invoke(&storage_);
+    }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+    bool operator==(std::nullptr_t) const { return ops_ == nullptr; }
+    bool operator!=(std::nullptr_t) const { return ops_ != nullptr; }
+
+private:
+    template <class T>
+    struct IsStdFunction : std::false_type {};
+
+    template <class Signature>
+    struct IsStdFunction<std::function<Signature>> : std::true_type {};
+
+    struct Ops
+    {
+        void (*invoke)(void* storage);
+        void (*move)(void* from, void* to); // Moves the functor and destroys the source.
+        void (*destroy)(void* storage);
+    };
+
+    template <class Stored>
+    static constexpr bool isInline()
+    {
+        return sizeof(Stored) <= kInlineSize &&
+               alignof(Stored) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible_v<Stored>;
+    }
+
+    template <class Stored>
+    static constexpr Ops kInlineOps =
+    {
+        [](void* storage)
+        {
+            std::invoke(*static_cast<Stored*>(storage));
+        },
+        [](void* from, void* to)
+        {
+            Stored* source = static_cast<Stored*>(from);
+            new (to) Stored(std::move(*source));
+            source->~Stored();
+        },
+        [](void* storage)
+        {
+            static_cast<Stored*>(storage)->~Stored();
+        }
+    };
+
+    template <class Stored>
+    static constexpr Ops kHeapOps =
+    {
+        [](void* storage)
+        {
+            std::invoke(**static_cast<Stored**>(storage));
+        },
+        [](void* from, void* to)
+        {
+            *static_cast<Stored**>(to) = *static_cast<Stored**>(from);
+        },
+        [](void* storage)
+        {
+            delete *static_cast<Stored**>(storage);
+        }
+    };
+
+    void moveFrom(TaskCallback& other)
+    {
+        if (!other.ops_)
+            return;
+
+        other.ops_->move(&other.storage_, &storage_);
+        ops_ = other.ops_;
+        other.ops_ = nullptr;
+    }
+
+    void reset()
+    {
+        if (!ops_)
+            return;
+
+        ops_->destroy(&storage_);
+        ops_ = nullptr;
+    }
+
+    const Ops* ops_ = nullptr;
+
+    // The functor is not a part of the logical state of the callback, so it may be called from
+    // the const operator() (as with std::function).
+    alignas(std::max_align_t) mutable unsigned char storage_[kInlineSize];
+};
+
+} // namespace base
+
+#endif // BASE__TASK_CALLBACK_H
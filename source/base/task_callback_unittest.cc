@@ -0,0 +1,119 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/task_callback.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <memory>
+
+namespace base {
+
+namespace {
+
+class Counter
+{
+public:
+    explicit Counter(int* destroyed)
+        : destroyed_(destroyed)
+    {
+        // Nothing
+    }
+
+    ~Counter()
+    {
+        ++(*destroyed_);
+    }
+
+private:
+    int* destroyed_;
+};
+
+} // namespace
+
+TEST(TaskCallbackTest, Empty)
+{
+    TaskCallback callback;
+    EXPECT_FALSE(callback);
+    EXPECT_TRUE(callback == nullptr);
+
+    std::function<void()> function;
+    TaskCallback from_function(function);
+    EXPECT_FALSE(from_function);
+
+    void (*pointer)() = nullptr;
+    TaskCallback from_pointer(pointer);
+    EXPECT_FALSE(from_pointer);
+}
+
+TEST(TaskCallbackTest, MoveOnlyCapture)
+{
+    int result = 0;
+    auto value = std::make_unique<int>(5);
+
+    TaskCallback callback([&result, value = std::move(value)]() { result = *value; });
+    ASSERT_TRUE(callback);
+
+    TaskCallback moved(std::move(callback));
+    EXPECT_FALSE(callback);
+    ASSERT_TRUE(moved);
+
+    moved();
+    EXPECT_EQ(result, 5);
+}
+
+TEST(TaskCallbackTest, LargeCapture)
+{
+    std::array<uint8_t, TaskCallback::kInlineSize * 2> data;
+    data.fill(7);
+
+    int result = 0;
+    TaskCallback callback([&result, data]() { result = data.back(); });
+
+    TaskCallback moved;
+    moved = std::move(callback);
+    EXPECT_FALSE(callback);
+
+    moved();
+    EXPECT_EQ(result, 7);
+}
+
+TEST(TaskCallbackTest, Destruction)
+{
+    int destroyed = 0;
+
+    {
+        auto counter = std::make_shared<Counter>(&destroyed);
+        TaskCallback callback([counter]() {});
+        counter.reset();
+        EXPECT_EQ(destroyed, 0);
+
+        TaskCallback moved(std::move(callback));
+        EXPECT_EQ(destroyed, 0);
+    }
+
+    EXPECT_EQ(destroyed, 1);
+
+    std::array<uint8_t, TaskCallback::kInlineSize * 2> data = {};
+    TaskCallback large([counter = std::make_shared<Counter>(&destroyed), data]() {});
+    large = nullptr;
+    EXPECT_EQ(destroyed, 2);
+}
+
+} // namespace base
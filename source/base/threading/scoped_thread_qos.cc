@@ -0,0 +1,175 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/threading/scoped_thread_qos.h"
+
+#include "base/logging.h"
+
+#if defined(OS_WIN)
+#include "base/audio/win/scoped_mmcss_registration.h"
+#endif // defined(OS_WIN)
+
+#if defined(OS_POSIX)
+#include <pthread.h>
+#endif // defined(OS_POSIX)
+
+#if defined(OS_LINUX)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif // defined(OS_LINUX)
+
+namespace base {
+
+namespace {
+
+#if defined(OS_LINUX)
+
+// Real-time priorities above the normal threads but far below the system ones.
+const int kCaptureRealtimePriority = 1;
+const int kAudioRealtimePriority = 2;
+
+// Used if the real-time policy is not allowed (no CAP_SYS_NICE and RLIMIT_RTPRIO is zero).
+const int kCaptureNice = -5;
+const int kAudioNice = -10;
+
+pid_t currentThreadId()
+{
+    return static_cast<pid_t>(syscall(SYS_gettid));
+}
+
+#endif // defined(OS_LINUX)
+
+} // namespace
+
+ScopedThreadQoS::ScopedThreadQoS(ThreadQoS qos)
+{
+    if (qos == ThreadQoS::DEFAULT)
+        return;
+
+#if defined(OS_WIN)
+    mmcss_registration_ = std::make_unique<ScopedMMCSSRegistration>(
+        qos == ThreadQoS::AUDIO ? L"Pro Audio" : L"Capture");
+    succeeded_ = mmcss_registration_->isSucceeded();
+#elif defined(OS_LINUX)
+    pthread_getschedparam(pthread_self(), &previous_policy_, &previous_param_);
+
+    sched_param param;
+    param.sched_priority =
+        qos == ThreadQoS::AUDIO ? kAudioRealtimePriority : kCaptureRealtimePriority;
+
+    int error = pthread_setschedparam(pthread_self(), SCHED_RR, &param);
+    if (!error)
+    {
+        succeeded_ = true;
+        return;
+    }
+
+    errno = 0;
+    previous_nice_ = getpriority(PRIO_PROCESS, static_cast<id_t>(currentThreadId()));
+    if (errno)
+    {
+        PLOG(LS_WARNING) << "getpriority failed";
+        return;
+    }
+
+    // On Linux the nice value belongs to the thread.
+    const int nice = qos == ThreadQoS::AUDIO ? kAudioNice : kCaptureNice;
+    if (setpriority(PRIO_PROCESS, static_cast<id_t>(currentThreadId()), nice) != 0)
+    {
+        LOG(LS_WARNING) << "Unable to raise the thread priority (pthread_setschedparam: "
+                        << error << ", setpriority: " << errno << ")";
+        return;
+    }
+
+    nice_changed_ = true;
+    succeeded_ = true;
+#elif defined(OS_MAC)
+    pthread_get_qos_class_np(pthread_self(), &previous_qos_class_, &previous_relative_priority_);
+
+    int error = pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
+    if (error)
+    {
+        LOG(LS_WARNING) << "pthread_set_qos_class_self_np failed: " << error;
+        return;
+    }
+
+    succeeded_ = true;
+#else
+    NOTIMPLEMENTED();
+#endif
+}
+
+ScopedThreadQoS::~ScopedThreadQoS()
+{
+    if (!succeeded_)
+        return;
+
+#if defined(OS_LINUX)
+    if (nice_changed_)
+        setpriority(PRIO_PROCESS, static_cast<id_t>(currentThreadId()), previous_nice_);
+    else
+        pthread_setschedparam(pthread_self(), previous_policy_, &previous_param_);
+#elif defined(OS_MAC)
+    if (previous_qos_class_ != QOS_CLASS_UNSPECIFIED)
+        pthread_set_qos_class_self_np(previous_qos_class_, previous_relative_priority_);
+#endif
+
+    // On Windows the MMCSS registration is reverted by its own destructor.
+}
+
+bool setCurrentThreadAffinity(uint64_t cpu_mask)
+{
+    if (!cpu_mask)
+        return false;
+
+#if defined(OS_WIN)
+    if (!SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(cpu_mask)))
+    {
+        PLOG(LS_WARNING) << "SetThreadAffinityMask failed";
+        return false;
+    }
+
+    return true;
+#elif defined(OS_LINUX)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+
+    for (int i = 0; i < 64; ++i)
+    {
+        if (cpu_mask & (uint64_t(1) << i))
+            CPU_SET(i, &cpu_set);
+    }
+
+    const int error = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    if (error)
+    {
+        LOG(LS_WARNING) << "pthread_setaffinity_np failed: " << error;
+        return false;
+    }
+
+    return true;
+#else
+    // macOS has only affinity hints which do not bind the thread to processors.
+    return false;
+#endif
+}
+
+} // namespace base
@@ -0,0 +1,91 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__THREADING__SCOPED_THREAD_QOS_H
+#define BASE__THREADING__SCOPED_THREAD_QOS_H
+
+#include "base/macros_magic.h"
+#include "build/build_config.h"
+
+#include <cstdint>
+#include <memory>
+
+#if defined(OS_LINUX)
+#include <sched.h>
+#endif // defined(OS_LINUX)
+
+#if defined(OS_MAC)
+#include <pthread/qos.h>
+#endif // defined(OS_MAC)
+
+namespace base {
+
+#if defined(OS_WIN)
+class ScopedMMCSSRegistration;
+#endif // defined(OS_WIN)
+
+enum class ThreadQoS
+{
+    // The scheduling of the thread is not changed.
+    DEFAULT,
+
+    // Screen capture and video encoding. MMCSS task "Capture" on Windows, the lowest real-time
+    // round-robin priority on Linux, QOS_CLASS_USER_INTERACTIVE on macOS.
+    CAPTURE,
+
+    // Audio capture and encoding. MMCSS task "Pro Audio" on Windows, a real-time round-robin
+    // priority above CAPTURE on Linux, QOS_CLASS_USER_INTERACTIVE on macOS.
+    AUDIO
+};
+
+// Raises the scheduling class of the calling thread while the object exists. Must be destroyed on
+// the same thread. If the process is not allowed to use the real-time scheduling on Linux, the
+// nice value of the thread is lowered instead.
+class ScopedThreadQoS
+{
+public:
+    explicit ScopedThreadQoS(ThreadQoS qos);
+    ~ScopedThreadQoS();
+
+    bool isSucceeded() const { return succeeded_; }
+
+private:
+    bool succeeded_ = false;
+
+#if defined(OS_WIN)
+    std::unique_ptr<ScopedMMCSSRegistration> mmcss_registration_;
+#elif defined(OS_LINUX)
+    int previous_policy_ = SCHED_OTHER;
+    sched_param previous_param_;
+    bool nice_changed_ = false;
+    int previous_nice_ = 0;
+#elif defined(OS_MAC)
+    qos_class_t previous_qos_class_ = QOS_CLASS_UNSPECIFIED;
+    int previous_relative_priority_ = 0;
+#endif
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedThreadQoS);
+};
+
+// Binds the calling thread to the processors from |cpu_mask| (bit N is the processor N). Returns
+// false if it fails or the system does not support it (macOS).
+bool setCurrentThreadAffinity(uint64_t cpu_mask);
+
+} // namespace base
+
+#endif // BASE__THREADING__SCOPED_THREAD_QOS_H
@@ -112,6 +112,13 @@ void Thread::threadMain(MessageLoop::Type message_loop_type)
     thread_id_ = GetCurrentThreadId();
 #endif // defined(OS_WIN)
 
+    ScopedThreadQoS thread_qos(qos_);
+    if (qos_ != ThreadQoS::DEFAULT && !thread_qos.isSucceeded())
+        LOG(LS_WARNING) << "Unable to change the thread scheduling";
+
+    if (cpu_mask_)
+        setCurrentThreadAffinity(cpu_mask_);
+
     // Let the thread do extra initialization.
     // Let's do this before signaling we are started.
     if (delegate_)
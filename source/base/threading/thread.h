@@ -20,6 +20,7 @@
 #define BASE__THREADING__THREAD_H
 
 #include "base/message_loop/message_loop.h"
+#include "base/threading/scoped_thread_qos.h"
 #include "build/build_config.h"
 
 #include <atomic>
@@ -69,6 +70,11 @@ public:
 
     void join();
 
+    // Sets the scheduling class and the processor affinity of the thread. Must be called before
+    // start(). By default the scheduling is not changed and the thread may run on any processor.
+    void setQoS(ThreadQoS qos) { qos_ = qos; }
+    void setAffinity(uint64_t cpu_mask) { cpu_mask_ = cpu_mask; }
+
     bool isRunning() const { return running_; }
     MessageLoop* messageLoop() const { return message_loop_; }
 
@@ -105,6 +111,9 @@ private:
 
     std::thread thread_;
 
+    ThreadQoS qos_ = ThreadQoS::DEFAULT;
+    uint64_t cpu_mask_ = 0;
+
 #if defined(OS_WIN)
     uint32_t thread_id_ = 0;
 #endif // defined(OS_WIN)
@@ -0,0 +1,454 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/threading/thread_pool.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/threading/simple_thread.h"
+#include "base/threading/thread.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+namespace {
+
+// The pool and the index of its worker if the current thread is a worker of a pool.
+thread_local const void* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+// The sequenced task runner whose task is running on the current thread.
+thread_local const TaskRunner* current_sequence = nullptr;
+
+} // namespace
+
+class ThreadPool::Core : public std::enable_shared_from_this<Core>
+{
+public:
+    explicit Core(size_t thread_count);
+    ~Core();
+
+    void start();
+    void stop();
+
+    size_t threadCount() const { return workers_.size(); }
+    bool belongsToCurrentThread() const;
+
+    void postTask(TaskRunner::Callback task, Priority priority = Priority::NORMAL);
+    void postDelayedTask(std::shared_ptr<TaskRunner> task_runner,
+                         TaskRunner::Callback task,
+                         const TaskRunner::Milliseconds& delay);
+
+private:
+    struct Worker
+    {
+        SimpleThread thread;
+        std::mutex lock;
+        std::deque<TaskRunner::Callback> queue;
+    };
+
+    void workerMain(size_t index);
+    bool takeTask(size_t index, TaskRunner::Callback* task);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> next_worker_ = 0;
+
+    // The tasks with the high priority are shared by all the workers.
+    std::mutex high_priority_lock_;
+    std::deque<TaskRunner::Callback> high_priority_queue_;
+    std::atomic<size_t> high_priority_pending_ = 0;
+
+    // Number of the tasks in the queues of all the workers.
+    std::atomic<size_t> pending_ = 0;
+
+    std::mutex sleep_lock_;
+    std::condition_variable work_event_;
+    bool terminate_ = false;
+
+    // Runs the timers of delayed tasks. Started with the first delayed task.
+    std::once_flag timer_thread_started_;
+    Thread timer_thread_;
+
+    DISALLOW_COPY_AND_ASSIGN(Core);
+};
+
+ThreadPool::Core::Core(size_t thread_count)
+{
+    for (size_t i = 0; i < thread_count; ++i)
+        workers_.emplace_back(std::make_unique<Worker>());
+}
+
+ThreadPool::Core::~Core()
+{
+    stop();
+}
+
+void ThreadPool::Core::start()
+{
+    for (size_t i = 0; i < workers_.size(); ++i)
+        workers_[i]->thread.start(std::bind(&Core::workerMain, this, i));
+}
+
+void ThreadPool::Core::stop()
+{
+    {
+        std::scoped_lock lock(sleep_lock_);
+        if (terminate_)
+            return;
+
+        terminate_ = true;
+    }
+
+    work_event_.notify_all();
+
+    for (auto& worker : workers_)
+        worker->thread.stop();
+
+    timer_thread_.stop();
+}
+
+bool ThreadPool::Core::belongsToCurrentThread() const
+{
+    return current_pool == this;
+}
+
+void ThreadPool::Core::postTask(TaskRunner::Callback task, Priority priority)
+{
+    if (priority == Priority::HIGH)
+    {
+        std::scoped_lock lock(high_priority_lock_);
+        high_priority_queue_.emplace_back(std::move(task));
+        ++high_priority_pending_;
+    }
+    else
+    {
+        // A task posted from a thread of the pool goes to the queue of this thread. Otherwise the
+        // queues are filled in turn.
+        size_t index = (current_pool == this) ? current_worker : next_worker_++ % workers_.size();
+
+        Worker* worker = workers_[index].get();
+        std::scoped_lock lock(worker->lock);
+        worker->queue.emplace_back(std::move(task));
+    }
+
+    {
+        std::scoped_lock lock(sleep_lock_);
+        ++pending_;
+    }
+
+    work_event_.notify_one();
+}
+
+void ThreadPool::Core::postDelayedTask(std::shared_ptr<TaskRunner> task_runner,
+                                       TaskRunner::Callback task,
+                                       const TaskRunner::Milliseconds& delay)
+{
+    std::call_once(timer_thread_started_, [this]()
+    {
+        timer_thread_.start(MessageLoop::Type::DEFAULT);
+    });
+
+    std::shared_ptr<TaskRunner> timer_task_runner = timer_thread_.taskRunner();
+    if (!timer_task_runner)
+        return;
+
+    // When the time comes, the task is posted to its task runner as a regular one. The task runner
+    // is held weakly, the task is dropped if the task runner is destroyed before.
+    std::weak_ptr<TaskRunner> task_runner_weak = task_runner;
+
+    timer_task_runner->postDelayedTask(
+        [task_runner_weak, task = std::move(task)]() mutable
+    {
+        std::shared_ptr<TaskRunner> task_runner = task_runner_weak.lock();
+        if (task_runner)
+            task_runner->postTask(std::move(task));
+    }, delay);
+}
+
+void ThreadPool::Core::workerMain(size_t index)
+{
+    current_pool = this;
+    current_worker = index;
+
+    for (;;)
+    {
+        TaskRunner::Callback task;
+
+        if (takeTask(index, &task))
+        {
+            task();
+            continue;
+        }
+
+        std::unique_lock lock(sleep_lock_);
+        work_event_.wait(lock, [this]() { return terminate_ || pending_ != 0; });
+
+        if (terminate_)
+            break;
+    }
+
+    current_pool = nullptr;
+}
+
+bool ThreadPool::Core::takeTask(size_t index, TaskRunner::Callback* task)
+{
+    if (high_priority_pending_ != 0)
+    {
+        std::scoped_lock lock(high_priority_lock_);
+        if (!high_priority_queue_.empty())
+        {
+            *task = std::move(high_priority_queue_.front());
+            high_priority_queue_.pop_front();
+            --high_priority_pending_;
+            --pending_;
+            return true;
+        }
+    }
+
+    // Own queue first, then the queues of the other threads.
+    for (size_t i = 0; i < workers_.size(); ++i)
+    {
+        Worker* worker = workers_[(index + i) % workers_.size()].get();
+
+        std::scoped_lock lock(worker->lock);
+        if (worker->queue.empty())
+            continue;
+
+        *task = std::move(worker->queue.front());
+        worker->queue.pop_front();
+        --pending_;
+        return true;
+    }
+
+    return false;
+}
+
+class ThreadPool::ParallelTaskRunner : public TaskRunner
+{
+public:
+    explicit ParallelTaskRunner(std::weak_ptr<Core> core)
+        : core_(std::move(core))
+    {
+        // Nothing
+    }
+
+    // TaskRunner implementation.
+    bool belongsToCurrentThread() const override
+    {
+        std::shared_ptr<Core> core = core_.lock();
+        return core && core->belongsToCurrentThread();
+    }
+
+    void postTask(Callback callback) override
+    {
+        std::shared_ptr<Core> core = core_.lock();
+        if (core)
+            core->postTask(std::move(callback));
+    }
+
+    void postDelayedTask(Callback callback, const Milliseconds& delay) override
+    {
+        std::shared_ptr<Core> core = core_.lock();
+        if (core)
+            core->postDelayedTask(shared_from_this(), std::move(callback), delay);
+    }
+
+    void postNonNestableTask(Callback callback) override
+    {
+        // Tasks of the pool are never nested.
+        postTask(std::move(callback));
+    }
+
+    void postNonNestableDelayedTask(Callback callback, const Milliseconds& delay) override
+    {
+        postDelayedTask(std::move(callback), delay);
+    }
+
+    void postQuit() override
+    {
+        NOTREACHED() << "The threads of the pool are stopped by its destructor";
+    }
+
+private:
+    std::weak_ptr<Core> core_;
+
+    DISALLOW_COPY_AND_ASSIGN(ParallelTaskRunner);
+};
+
+class ThreadPool::SequencedTaskRunner : public TaskRunner
+{
+public:
+    explicit SequencedTaskRunner(std::weak_ptr<Core> core)
+        : core_(std::move(core))
+    {
+        // Nothing
+    }
+
+    // TaskRunner implementation.
+    bool belongsToCurrentThread() const override
+    {
+        return current_sequence == this;
+    }
+
+    void postTask(Callback callback) override
+    {
+        {
+            std::scoped_lock lock(lock_);
+            queue_.emplace_back(std::move(callback));
+
+            // The pool is already going to run the tasks of the sequence.
+            if (running_)
+                return;
+
+            running_ = true;
+        }
+
+        schedule();
+    }
+
+    void postDelayedTask(Callback callback, const Milliseconds& delay) override
+    {
+        std::shared_ptr<Core> core = core_.lock();
+        if (core)
+            core->postDelayedTask(shared_from_this(), std::move(callback), delay);
+    }
+
+    void postNonNestableTask(Callback callback) override
+    {
+        // Tasks of the pool are never nested.
+        postTask(std::move(callback));
+    }
+
+    void postNonNestableDelayedTask(Callback callback, const Milliseconds& delay) override
+    {
+        postDelayedTask(std::move(callback), delay);
+    }
+
+    void postQuit() override
+    {
+        NOTREACHED() << "The threads of the pool are stopped by its destructor";
+    }
+
+    void setPriority(Priority priority) { priority_ = priority; }
+
+private:
+    void schedule()
+    {
+        std::shared_ptr<Core> core = core_.lock();
+        if (!core)
+            return;
+
+        // One task of the sequence per pool task, so that a long sequence does not occupy a
+        // thread while other tasks are waiting.
+        std::shared_ptr<SequencedTaskRunner> self =
+            std::static_pointer_cast<SequencedTaskRunner>(shared_from_this());
+        core->postTask([self]() { self->runNextTask(); }, priority_);
+    }
+
+    void runNextTask()
+    {
+        Callback callback;
+
+        {
+            std::scoped_lock lock(lock_);
+            DCHECK(!queue_.empty());
+
+            callback = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        current_sequence = this;
+        callback();
+        current_sequence = nullptr;
+
+        {
+            std::scoped_lock lock(lock_);
+            if (queue_.empty())
+            {
+                running_ = false;
+                return;
+            }
+        }
+
+        schedule();
+    }
+
+    std::weak_ptr<Core> core_;
+
+    std::mutex lock_;
+    std::deque<Callback> queue_;
+    bool running_ = false;
+
+    std::atomic<Priority> priority_ = Priority::NORMAL;
+
+    DISALLOW_COPY_AND_ASSIGN(SequencedTaskRunner);
+};
+
+ThreadPool::ThreadPool(size_t thread_count)
+{
+    if (!thread_count)
+        thread_count = std::max(std::thread::hardware_concurrency(), 1U);
+
+    core_ = std::make_shared<Core>(thread_count);
+    core_->start();
+
+    task_runner_ = std::make_shared<ParallelTaskRunner>(core_);
+}
+
+ThreadPool::~ThreadPool()
+{
+    core_->stop();
+}
+
+size_t ThreadPool::threadCount() const
+{
+    return core_->threadCount();
+}
+
+std::shared_ptr<TaskRunner> ThreadPool::taskRunner()
+{
+    return task_runner_;
+}
+
+std::shared_ptr<TaskRunner> ThreadPool::createSequencedTaskRunner()
+{
+    return std::make_shared<SequencedTaskRunner>(core_);
+}
+
+void ThreadPool::setPriority(const std::shared_ptr<TaskRunner>& sequence, Priority priority)
+{
+    SequencedTaskRunner* sequenced_task_runner =
+        dynamic_cast<SequencedTaskRunner*>(sequence.get());
+    if (!sequenced_task_runner)
+    {
+        NOTREACHED() << "Not a sequenced task runner of the pool";
+        return;
+    }
+
+    // The task of the sequence that is already in a queue of the pool keeps its priority.
+    sequenced_task_runner->setPriority(priority);
+}
+
+} // namespace base
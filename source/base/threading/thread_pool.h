@@ -0,0 +1,72 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__THREADING__THREAD_POOL_H
+#define BASE__THREADING__THREAD_POOL_H
+
+#include "base/macros_magic.h"
+
+#include <memory>
+
+namespace base {
+
+class TaskRunner;
+
+// A fixed number of threads for the tasks that take a long time to execute. Every thread has its
+// own queue of tasks, a thread that has run out of tasks takes them from the queues of the other
+// threads. The methods can be called from any thread.
+//
+// Delayed tasks are supported. Quitting is not: the threads are stopped by the destructor and the
+// tasks that are not started by then are dropped.
+class ThreadPool
+{
+public:
+    // If |thread_count| is 0, the number of processor cores is used.
+    explicit ThreadPool(size_t thread_count);
+    ~ThreadPool();
+
+    size_t threadCount() const;
+
+    enum class Priority { NORMAL, HIGH };
+
+    // Returns a task runner whose tasks run on the threads of the pool in parallel with each
+    // other, in no particular order.
+    std::shared_ptr<TaskRunner> taskRunner();
+
+    // Returns a new task runner whose tasks run one at a time, in the order in which they were
+    // posted. Successive tasks may run on different threads of the pool.
+    std::shared_ptr<TaskRunner> createSequencedTaskRunner();
+
+    // Changes the priority of a task runner returned by createSequencedTaskRunner. The tasks of
+    // the sequences with the high priority are taken before all other tasks of the pool.
+    void setPriority(const std::shared_ptr<TaskRunner>& sequence, Priority priority);
+
+private:
+    class Core;
+    class ParallelTaskRunner;
+    class SequencedTaskRunner;
+
+    std::shared_ptr<Core> core_;
+    std::shared_ptr<TaskRunner> task_runner_;
+
+    DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+} // namespace base
+
+#endif // BASE__THREADING__THREAD_POOL_H
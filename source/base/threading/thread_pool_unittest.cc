@@ -0,0 +1,238 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/threading/thread_pool.h"
+
+#include "base/task_runner.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+TEST(ThreadPoolTest, RunsTasksOnAllThreads)
+{
+    ThreadPool pool(3);
+    EXPECT_EQ(pool.threadCount(), 3u);
+
+    std::shared_ptr<TaskRunner> task_runner = pool.taskRunner();
+    ASSERT_TRUE(task_runner);
+    EXPECT_FALSE(task_runner->belongsToCurrentThread());
+
+    std::mutex lock;
+    std::condition_variable event;
+    std::set<std::thread::id> thread_ids;
+    int started = 0;
+    int done = 0;
+
+    // Every task waits until all three are started, so they must run in parallel.
+    for (int i = 0; i < 3; ++i)
+    {
+        task_runner->postTask([&]()
+        {
+            std::unique_lock unique_lock(lock);
+            EXPECT_TRUE(task_runner->belongsToCurrentThread());
+
+            thread_ids.insert(std::this_thread::get_id());
+            ++started;
+            event.notify_all();
+            event.wait(unique_lock, [&]() { return started == 3; });
+
+            ++done;
+            event.notify_all();
+        });
+    }
+
+    std::unique_lock unique_lock(lock);
+    event.wait(unique_lock, [&]() { return done == 3; });
+
+    EXPECT_EQ(thread_ids.size(), 3u);
+    EXPECT_EQ(thread_ids.count(std::this_thread::get_id()), 0u);
+}
+
+TEST(ThreadPoolTest, StealsTasks)
+{
+    ThreadPool pool(2);
+    std::shared_ptr<TaskRunner> task_runner = pool.taskRunner();
+
+    std::mutex lock;
+    std::condition_variable event;
+    std::thread::id busy_thread_id;
+    std::thread::id first_thread_id;
+    int done = 0;
+
+    // The tasks are posted from a thread of the pool, so they go to the queue of that thread. The
+    // thread stays busy until one of them is run, so the other thread has to take it.
+    task_runner->postTask([&]()
+    {
+        std::unique_lock unique_lock(lock);
+        busy_thread_id = std::this_thread::get_id();
+
+        for (int i = 0; i < 2; ++i)
+        {
+            task_runner->postTask([&]()
+            {
+                std::scoped_lock scoped_lock(lock);
+                if (!done)
+                    first_thread_id = std::this_thread::get_id();
+                ++done;
+                event.notify_all();
+            });
+        }
+
+        event.wait(unique_lock, [&]() { return done != 0; });
+    });
+
+    std::unique_lock unique_lock(lock);
+    event.wait(unique_lock, [&]() { return done == 2; });
+    EXPECT_NE(first_thread_id, busy_thread_id);
+}
+
+TEST(ThreadPoolTest, SequencedTaskRunner)
+{
+    ThreadPool pool(4);
+
+    std::shared_ptr<TaskRunner> task_runner = pool.createSequencedTaskRunner();
+    ASSERT_TRUE(task_runner);
+    EXPECT_FALSE(task_runner->belongsToCurrentThread());
+
+    std::mutex lock;
+    std::condition_variable done_event;
+    std::vector<int> result;
+    std::atomic<int> running = 0;
+    bool done = false;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        task_runner->postTask([&, i]()
+        {
+            // Tasks of the sequence never run at the same time.
+            EXPECT_EQ(++running, 1);
+            EXPECT_TRUE(task_runner->belongsToCurrentThread());
+
+            result.push_back(i);
+            --running;
+
+            if (i == 99)
+            {
+                std::scoped_lock scoped_lock(lock);
+                done = true;
+                done_event.notify_one();
+            }
+        });
+    }
+
+    std::unique_lock unique_lock(lock);
+    done_event.wait(unique_lock, [&]() { return done; });
+
+    ASSERT_EQ(result.size(), 100u);
+    for (int i = 0; i < 100; ++i)
+        EXPECT_EQ(result[i], i);
+}
+
+TEST(ThreadPoolTest, HighPrioritySequence)
+{
+    ThreadPool pool(1);
+
+    std::shared_ptr<TaskRunner> normal = pool.createSequencedTaskRunner();
+    std::shared_ptr<TaskRunner> high = pool.createSequencedTaskRunner();
+    pool.setPriority(high, ThreadPool::Priority::HIGH);
+
+    std::mutex lock;
+    std::condition_variable event;
+    bool started = false;
+    bool released = false;
+    std::vector<int> result;
+
+    // The only thread of the pool is busy while the other tasks are posted.
+    pool.taskRunner()->postTask([&]()
+    {
+        std::unique_lock unique_lock(lock);
+        started = true;
+        event.notify_all();
+        event.wait(unique_lock, [&]() { return released; });
+    });
+
+    {
+        std::unique_lock unique_lock(lock);
+        event.wait(unique_lock, [&]() { return started; });
+    }
+
+    normal->postTask([&]()
+    {
+        std::scoped_lock scoped_lock(lock);
+        result.push_back(1);
+        event.notify_all();
+    });
+
+    high->postTask([&]()
+    {
+        std::scoped_lock scoped_lock(lock);
+        result.push_back(2);
+        event.notify_all();
+    });
+
+    std::unique_lock unique_lock(lock);
+    released = true;
+    event.notify_all();
+    event.wait(unique_lock, [&]() { return result.size() == 2; });
+
+    EXPECT_EQ(result[0], 2);
+    EXPECT_EQ(result[1], 1);
+}
+
+TEST(ThreadPoolTest, DelayedTask)
+{
+    ThreadPool pool(2);
+    std::shared_ptr<TaskRunner> task_runner = pool.createSequencedTaskRunner();
+
+    std::mutex lock;
+    std::condition_variable done_event;
+    std::vector<int> result;
+
+    task_runner->postDelayedTask([&]()
+    {
+        std::scoped_lock scoped_lock(lock);
+        result.push_back(2);
+        done_event.notify_one();
+    }, std::chrono::milliseconds(50));
+
+    task_runner->postTask([&]()
+    {
+        std::scoped_lock scoped_lock(lock);
+        result.push_back(1);
+    });
+
+    std::unique_lock unique_lock(lock);
+    done_event.wait(unique_lock, [&]() { return result.size() == 2; });
+    EXPECT_EQ(result, std::vector<int>({ 1, 2 }));
+}
+
+TEST(ThreadPoolTest, DefaultThreadCount)
+{
+    ThreadPool pool(0);
+    EXPECT_GE(pool.threadCount(), 1u);
+}
+
+} // namespace base
@@ -0,0 +1,125 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/threading/worker_group.h"
+
+#include "base/logging.h"
+#include "base/threading/simple_thread.h"
+
+namespace base {
+
+WorkerGroup::WorkerGroup(int thread_count)
+{
+    DCHECK_GE(thread_count, 1);
+
+    for (int i = 1; i < thread_count; ++i)
+    {
+        threads_.emplace_back(std::make_unique<SimpleThread>());
+        threads_.back()->start(std::bind(&WorkerGroup::threadMain, this));
+    }
+}
+
+WorkerGroup::~WorkerGroup()
+{
+    {
+        std::unique_lock lock(lock_);
+        terminate_ = true;
+    }
+
+    work_event_.notify_all();
+
+    for (auto& thread : threads_)
+        thread->stop();
+}
+
+void WorkerGroup::run(int count, const Task& task)
+{
+    if (count <= 0)
+        return;
+
+    if (threads_.empty() || count == 1)
+    {
+        for (int i = 0; i < count; ++i)
+            task(i);
+        return;
+    }
+
+    {
+        std::unique_lock lock(lock_);
+
+        DCHECK(!task_);
+
+        task_ = &task;
+        task_count_ = count;
+        next_task_ = 0;
+        ++job_number_;
+    }
+
+    work_event_.notify_all();
+
+    std::unique_lock lock(lock_);
+    runTasks(lock);
+
+    // The other threads may still be running their last tasks.
+    while (running_tasks_ > 0)
+        done_event_.wait(lock);
+
+    task_ = nullptr;
+    task_count_ = 0;
+}
+
+void WorkerGroup::threadMain()
+{
+    std::unique_lock lock(lock_);
+    uint64_t last_job = 0;
+
+    while (true)
+    {
+        while (!terminate_ && (!task_ || last_job == job_number_))
+            work_event_.wait(lock);
+
+        if (terminate_)
+            return;
+
+        last_job = job_number_;
+        runTasks(lock);
+
+        if (running_tasks_ == 0)
+            done_event_.notify_one();
+    }
+}
+
+void WorkerGroup::runTasks(std::unique_lock<std::mutex>& lock)
+{
+    DCHECK(lock.owns_lock());
+
+    while (next_task_ < task_count_)
+    {
+        const int index = next_task_++;
+        const Task& task = *task_;
+
+        ++running_tasks_;
+        lock.unlock();
+
+        task(index);
+
+        lock.lock();
+        --running_tasks_;
+    }
+}
+
+} // namespace base
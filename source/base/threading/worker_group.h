@@ -0,0 +1,74 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef BASE__THREADING__WORKER_GROUP_H
+#define BASE__THREADING__WORKER_GROUP_H
+
+#include "base/macros_magic.h"
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace base {
+
+class SimpleThread;
+
+// Runs independent parts of one job in parallel. The calling thread takes part in the job, so a
+// group of one thread does not start any threads. The worker threads are started once and wait
+// for the next job.
+class WorkerGroup
+{
+public:
+    explicit WorkerGroup(int thread_count);
+    ~WorkerGroup();
+
+    // Number of the threads including the calling thread.
+    int threadCount() const { return static_cast<int>(threads_.size()) + 1; }
+
+    // Calls |task| for each index in [0; |count|) and returns when all the calls are completed.
+    // The calls are made from the calling thread and from the worker threads.
+    using Task = std::function<void(int index)>;
+    void run(int count, const Task& task);
+
+private:
+    void threadMain();
+    void runTasks(std::unique_lock<std::mutex>& lock);
+
+    std::vector<std::unique_ptr<SimpleThread>> threads_;
+
+    std::mutex lock_;
+    std::condition_variable work_event_;
+    std::condition_variable done_event_;
+    bool terminate_ = false;
+
+    // Increases with every job, so a worker does not take the same job twice.
+    uint64_t job_number_ = 0;
+
+    const Task* task_ = nullptr;
+    int task_count_ = 0;
+    int next_task_ = 0;
+    int running_tasks_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(WorkerGroup);
+};
+
+} // namespace base
+
+#endif // BASE__THREADING__WORKER_GROUP_H
@@ -0,0 +1,86 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#include "base/threading/worker_group.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+namespace base {
+
+TEST(WorkerGroupTest, RunsAllTasks)
+{
+    WorkerGroup group(4);
+    EXPECT_EQ(group.threadCount(), 4);
+
+    for (int job = 0; job < 100; ++job)
+    {
+        const int count = job % 9;
+        std::vector<int> results(static_cast<size_t>(count), 0);
+
+        group.run(count, [&](int index)
+        {
+            results[static_cast<size_t>(index)] += index + 1;
+        });
+
+        for (int i = 0; i < count; ++i)
+            EXPECT_EQ(results[static_cast<size_t>(i)], i + 1);
+    }
+}
+
+TEST(WorkerGroupTest, UsesSeveralThreads)
+{
+    WorkerGroup group(2);
+    std::atomic<int> running = 0;
+    std::atomic<bool> parallel = false;
+
+    group.run(2, [&](int /* index */)
+    {
+        ++running;
+
+        // Both tasks must be running at the same time at some point.
+        for (int i = 0; i < 1000 && !parallel; ++i)
+        {
+            if (running == 2)
+                parallel = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    EXPECT_TRUE(parallel);
+}
+
+TEST(WorkerGroupTest, SingleThread)
+{
+    WorkerGroup group(1);
+    EXPECT_EQ(group.threadCount(), 1);
+
+    const std::thread::id thread_id = std::this_thread::get_id();
+    int calls = 0;
+
+    group.run(3, [&](int /* index */)
+    {
+        EXPECT_EQ(std::this_thread::get_id(), thread_id);
+        ++calls;
+    });
+
+    EXPECT_EQ(calls, 3);
+}
+
+} // namespace base
@@ -0,0 +1,217 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/trace_event.h"
+
+#include "base/logging.h"
+#include "base/process_handle.h"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+namespace base {
+
+namespace {
+
+thread_local TraceLog::ThreadBuffer* current_buffer = nullptr;
+
+void appendEscaped(std::string_view str, std::ostream* stream)
+{
+    for (char ch : str)
+    {
+        if (ch == '"' || ch == '\\')
+            *stream << '\\';
+        *stream << ch;
+    }
+}
+
+} // namespace
+
+class TraceLog::ThreadBuffer
+{
+public:
+    explicit ThreadBuffer(uint32_t thread_id)
+        : thread_id_(thread_id)
+    {
+        events_.resize(kMaxEventsPerThread);
+    }
+
+    void add(const char* name, int64_t begin_us, int64_t duration_us)
+    {
+        std::scoped_lock lock(lock_);
+        events_[count_ % events_.size()] = { name, begin_us, duration_us };
+        ++count_;
+    }
+
+    void clear()
+    {
+        std::scoped_lock lock(lock_);
+        count_ = 0;
+    }
+
+    void write(ProcessId process_id, bool* first, std::ostream* stream) const
+    {
+        std::scoped_lock lock(lock_);
+
+        size_t size = std::min(count_, events_.size());
+        size_t first_index = count_ - size;
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            const Event& event = events_[(first_index + i) % events_.size()];
+
+            *stream << (*first ? "\n" : ",\n") << "{\"name\":\"";
+            appendEscaped(event.name, stream);
+            *stream << "\",\"ph\":\"X\",\"ts\":" << event.begin_us
+                    << ",\"dur\":" << event.duration_us
+                    << ",\"pid\":" << process_id
+                    << ",\"tid\":" << thread_id_ << "}";
+            *first = false;
+        }
+    }
+
+private:
+    struct Event
+    {
+        const char* name;
+        int64_t begin_us;
+        int64_t duration_us;
+    };
+
+    const uint32_t thread_id_;
+
+    mutable std::mutex lock_;
+    std::vector<Event> events_;
+    size_t count_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(ThreadBuffer);
+};
+
+TraceLog::TraceLog() = default;
+TraceLog::~TraceLog() = default;
+
+// static
+TraceLog* TraceLog::instance()
+{
+    // The instance is never destroyed, so threads may record events until the process exits.
+    static TraceLog* trace_log = new TraceLog();
+    return trace_log;
+}
+
+void TraceLog::start(const std::filesystem::path& file_path)
+{
+    {
+        std::scoped_lock lock(buffers_lock_);
+        file_path_ = file_path;
+    }
+
+    LOG(LS_INFO) << "Tracing started (file: " << file_path << ")";
+    enabled_.store(true, std::memory_order_relaxed);
+}
+
+void TraceLog::stop()
+{
+    if (!enabled_.exchange(false, std::memory_order_relaxed))
+        return;
+
+    std::filesystem::path file_path;
+    {
+        std::scoped_lock lock(buffers_lock_);
+        file_path.swap(file_path_);
+    }
+
+    LOG(LS_INFO) << "Tracing stopped";
+
+    if (file_path.empty())
+        return;
+
+    std::ofstream file(file_path, std::ofstream::out | std::ofstream::trunc);
+    if (!file.is_open())
+    {
+        LOG(LS_ERROR) << "Unable to open trace file: " << file_path;
+        return;
+    }
+
+    file << toJson();
+    if (file.fail())
+    {
+        LOG(LS_ERROR) << "Unable to write trace file: " << file_path;
+        return;
+    }
+
+    LOG(LS_INFO) << "Trace written to: " << file_path;
+}
+
+// static
+int64_t TraceLog::now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void TraceLog::addEvent(const char* name, int64_t begin_us, int64_t duration_us)
+{
+    ThreadBuffer* buffer = currentThreadBuffer();
+    if (buffer)
+        buffer->add(name, begin_us, duration_us);
+}
+
+std::string TraceLog::toJson() const
+{
+    std::ostringstream stream;
+    stream << "{\"traceEvents\":[";
+
+    ProcessId process_id = currentProcessId();
+    bool first = true;
+
+    {
+        std::scoped_lock lock(buffers_lock_);
+        for (const auto& buffer : buffers_)
+            buffer->write(process_id, &first, &stream);
+    }
+
+    stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return stream.str();
+}
+
+void TraceLog::clear()
+{
+    std::scoped_lock lock(buffers_lock_);
+    for (const auto& buffer : buffers_)
+        buffer->clear();
+}
+
+TraceLog::ThreadBuffer* TraceLog::currentThreadBuffer()
+{
+    if (current_buffer)
+        return current_buffer;
+
+    std::scoped_lock lock(buffers_lock_);
+
+    // The buffers are kept after their threads exit, so the events of short-lived threads are
+    // not lost. The number of buffers is limited in case threads are created continuously.
+    if (buffers_.size() >= kMaxThreads)
+        return nullptr;
+
+    buffers_.emplace_back(std::make_shared<ThreadBuffer>(next_thread_id_++));
+    current_buffer = buffers_.back().get();
+    return current_buffer;
+}
+
+} // namespace base
@@ -0,0 +1,130 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__TRACE_EVENT_H
+#define BASE__TRACE_EVENT_H
+
+#include "base/macros_magic.h"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Records the time spent in the current scope under |name|, which must be a string literal.
+// The events are collected only when the build is configured with USE_TRACE_EVENTS and
+// TraceLog is started (see LoggingSettings::trace_file). Otherwise the macro compiles to nothing.
+#if defined(USE_TRACE_EVENTS)
+#define TRACE_EVENT(name) \
+    base::ScopedTraceEvent TRACE_EVENT_CONCAT(trace_event_, __LINE__)(name)
+#else
+#define TRACE_EVENT(name) static_cast<void>(0)
+#endif // defined(USE_TRACE_EVENTS)
+
+#define TRACE_EVENT_CONCAT(a, b) TRACE_EVENT_CONCAT_INTERNAL(a, b)
+#define TRACE_EVENT_CONCAT_INTERNAL(a, b) a##b
+
+namespace base {
+
+// Collects trace events into per-thread ring buffers. Each thread writes only to its own buffer,
+// so the buffer lock is taken by another thread only while the events are exported. When a
+// buffer is full, the oldest events are overwritten. The events are exported in the Chrome trace
+// event format (JSON), which is opened by Perfetto UI (ui.perfetto.dev) and chrome://tracing.
+class TraceLog
+{
+public:
+    // Maximum number of events kept for one thread.
+    static constexpr size_t kMaxEventsPerThread = 8192;
+
+    // Maximum number of threads for which the events are kept.
+    static constexpr size_t kMaxThreads = 256;
+
+    static TraceLog* instance();
+
+    // Starts recording. If |file_path| is not empty, the events are written to it when the
+    // recording is stopped.
+    void start(const std::filesystem::path& file_path = std::filesystem::path());
+    void stop();
+
+    bool isEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // Returns the current time in microseconds on the clock used for the events.
+    static int64_t now();
+
+    // Adds an event of the calling thread. |name| must be a string literal.
+    void addEvent(const char* name, int64_t begin_us, int64_t duration_us);
+
+    // Returns the events of all threads in the Chrome trace event format.
+    std::string toJson() const;
+
+    // Removes all events.
+    void clear();
+
+    class ThreadBuffer;
+
+private:
+    TraceLog();
+    ~TraceLog();
+
+    ThreadBuffer* currentThreadBuffer();
+
+    std::atomic_bool enabled_ { false };
+
+    mutable std::mutex buffers_lock_;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+    uint32_t next_thread_id_ = 1;
+
+    std::filesystem::path file_path_;
+
+    DISALLOW_COPY_AND_ASSIGN(TraceLog);
+};
+
+class ScopedTraceEvent
+{
+public:
+    explicit ScopedTraceEvent(const char* name)
+    {
+        TraceLog* trace_log = TraceLog::instance();
+        if (!trace_log->isEnabled())
+            return;
+
+        name_ = name;
+        begin_us_ = TraceLog::now();
+    }
+
+    ~ScopedTraceEvent()
+    {
+        if (!name_)
+            return;
+
+        TraceLog::instance()->addEvent(name_, begin_us_, TraceLog::now() - begin_us_);
+    }
+
+private:
+    const char* name_ = nullptr;
+    int64_t begin_us_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedTraceEvent);
+};
+
+} // namespace base
+
+#endif // BASE__TRACE_EVENT_H
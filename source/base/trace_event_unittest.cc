@@ -0,0 +1,113 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/trace_event.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+namespace base {
+
+namespace {
+
+size_t countOf(const std::string& str, const std::string& substr)
+{
+    size_t count = 0;
+
+    for (size_t pos = str.find(substr); pos != std::string::npos;
+         pos = str.find(substr, pos + substr.size()))
+    {
+        ++count;
+    }
+
+    return count;
+}
+
+class TraceEventTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        TraceLog::instance()->clear();
+    }
+
+    void TearDown() override
+    {
+        TraceLog::instance()->stop();
+        TraceLog::instance()->clear();
+    }
+};
+
+} // namespace
+
+TEST_F(TraceEventTest, NotRecordedWhenDisabled)
+{
+    {
+        ScopedTraceEvent event("disabled_event");
+    }
+
+    EXPECT_EQ(countOf(TraceLog::instance()->toJson(), "disabled_event"), 0u);
+}
+
+TEST_F(TraceEventTest, RecordsScopes)
+{
+    TraceLog::instance()->start();
+
+    {
+        ScopedTraceEvent outer("outer_event");
+        ScopedTraceEvent inner("inner_event");
+    }
+
+    std::string json = TraceLog::instance()->toJson();
+    EXPECT_EQ(json.find("{\"traceEvents\":["), 0u);
+    EXPECT_EQ(countOf(json, "\"name\":\"outer_event\",\"ph\":\"X\""), 1u);
+    EXPECT_EQ(countOf(json, "\"name\":\"inner_event\",\"ph\":\"X\""), 1u);
+
+    // The inner scope ends first.
+    EXPECT_LT(json.find("inner_event"), json.find("outer_event"));
+}
+
+TEST_F(TraceEventTest, RecordsOtherThreads)
+{
+    TraceLog::instance()->start();
+
+    std::thread thread([]()
+    {
+        ScopedTraceEvent event("thread_event");
+    });
+    thread.join();
+
+    // The events of the thread are kept after it exits.
+    EXPECT_EQ(countOf(TraceLog::instance()->toJson(), "thread_event"), 1u);
+}
+
+TEST_F(TraceEventTest, OverwritesOldestEvents)
+{
+    TraceLog::instance()->start();
+
+    TraceLog::instance()->addEvent("old_event", 0, 1);
+    for (size_t i = 0; i < TraceLog::kMaxEventsPerThread; ++i)
+        TraceLog::instance()->addEvent("new_event", 1, 1);
+
+    std::string json = TraceLog::instance()->toJson();
+    EXPECT_EQ(countOf(json, "old_event"), 0u);
+    EXPECT_EQ(countOf(json, "new_event"), TraceLog::kMaxEventsPerThread);
+}
+
+} // namespace base
@@ -148,7 +148,8 @@ proto::SessionType Client::sessionType() const
     return config_.session_type;
 }
 
-void Client::sendMessage(const google::protobuf::MessageLite& message)
+void Client::sendMessage(const google::protobuf::MessageLite& message,
+                         base::NetworkChannel::Priority priority)
 {
     if (!channel_)
     {
@@ -156,7 +157,7 @@ void Client::sendMessage(const google::protobuf::MessageLite& message)
         return;
     }
 
-    channel_->send(base::serialize(message));
+    channel_->send(base::serialize(message), priority);
 }
 
 int64_t Client::totalRx() const
@@ -203,6 +204,17 @@ int Client::speedTx()
     return channel_->speedTx();
 }
 
+std::chrono::milliseconds Client::roundTripTime() const
+{
+    if (!channel_)
+    {
+        LOG(LS_WARNING) << "roundTripTime called but channel not initialized";
+        return std::chrono::milliseconds::zero();
+    }
+
+    return channel_->roundTripTime();
+}
+
 void Client::onConnected()
 {
     LOG(LS_INFO) << "Connection established";
@@ -241,9 +253,11 @@ void Client::startAuthentication()
     LOG(LS_INFO) << "Start authentication";
 
     static const size_t kReadBufferSize = 2 * 1024 * 1024; // 2 Mb.
+    static const size_t kNotSentLowWatermark = 128 * 1024; // 128 kB.
 
     channel_->setReadBufferSize(kReadBufferSize);
     channel_->setNoDelay(true);
+    channel_->setNotSentLowWatermark(kNotSentLowWatermark);
 
     authenticator_ = std::make_unique<base::ClientAuthenticator>(io_task_runner_);
 
@@ -279,6 +293,12 @@ void Client::startAuthentication()
                 channel_->setTcpKeepAlive(true);
             }
 
+            // Versions 2.3.0+ support interleaving of messages with different priorities and
+            // message compression.
+            const bool has_chunking = authenticator_->peerVersion() >= base::Version(2, 3, 0);
+            channel_->setMessageChunking(has_chunking);
+            channel_->setMessageCompression(has_chunking);
+
             status_window_proxy_->onConnected();
 
             // Signal that everything is ready to start the session (connection established,
@@ -67,14 +67,18 @@ protected:
     // When calling this method, the client implementation should display a session window.
     virtual void onSessionStarted(const base::Version& peer_version) = 0;
 
-    // Sends outgoing message.
-    void sendMessage(const google::protobuf::MessageLite& message);
+    // Sends outgoing message. Messages with a higher |priority| are sent before the queued
+    // messages with a lower priority.
+    using Priority = base::NetworkChannel::Priority;
+    void sendMessage(const google::protobuf::MessageLite& message,
+                     Priority priority = Priority::NORMAL);
 
     // Methods for obtaining network metrics.
     int64_t totalRx() const;
     int64_t totalTx() const;
     int speedRx();
     int speedTx();
+    std::chrono::milliseconds roundTripTime() const;
 
     // base::NetworkChannel::Listener implementation.
     void onConnected() override;
@@ -19,24 +19,56 @@
 #include "client/client_desktop.h"
 
 #include "base/logging.h"
+#include "base/scoped_task_runner.h"
+#include "base/stl_util.h"
+#include "base/sys_info.h"
 #include "base/task_runner.h"
+#include "base/trace_event.h"
 #include "base/audio/audio_player.h"
 #include "base/codec/audio_decoder_opus.h"
 #include "base/codec/cursor_decoder.h"
+#include "base/codec/tile_cache.h"
 #include "base/codec/video_decoder.h"
 #include "base/codec/webm_file_writer.h"
-#include "base/codec/webm_video_encoder.h"
 #include "base/desktop/mouse_cursor.h"
+#include "base/desktop/region.h"
+#include "base/strings/string_split.h"
+#include "base/threading/thread_pool.h"
 #include "client/desktop_control_proxy.h"
 #include "client/desktop_window.h"
 #include "client/desktop_window_proxy.h"
 #include "client/config_factory.h"
+#include "client/cursor_cache_storage.h"
+#include "client/video_recorder.h"
 #include "common/desktop_session_constants.h"
 
+#include <future>
+#include <mutex>
+
 namespace client {
 
 namespace {
 
+// Returns the pool of threads for the decoding of all desktop sessions. A separate thread for
+// every session would compete with the others for the processor cores. The pool is created with
+// the first session and destroyed with the last one.
+std::shared_ptr<base::ThreadPool> decodePool()
+{
+    static std::mutex lock;
+    static std::weak_ptr<base::ThreadPool> pool_weak;
+
+    std::scoped_lock scoped_lock(lock);
+
+    std::shared_ptr<base::ThreadPool> pool = pool_weak.lock();
+    if (!pool)
+    {
+        pool = std::make_shared<base::ThreadPool>(0);
+        pool_weak = pool;
+    }
+
+    return pool;
+}
+
 int calculateFps(int last_fps, const std::chrono::milliseconds& duration, int64_t count)
 {
     static const double kAlpha = 0.1;
@@ -45,6 +77,11 @@ int calculateFps(int last_fps, const std::chrono::milliseconds& duration, int64_
         ((1.0 - kAlpha) * static_cast<double>(last_fps)));
 }
 
+// Mouse moves are sent no more often than once per this interval.
+constexpr std::chrono::milliseconds kInputBatchInterval(16);
+
+constexpr std::chrono::seconds kPowerCheckInterval(15);
+
 size_t calculateAvgSize(size_t last_avg_size, size_t bytes)
 {
     static const double kAlpha = 0.1;
@@ -53,23 +90,71 @@ size_t calculateAvgSize(size_t last_avg_size, size_t bytes)
         ((1.0 - kAlpha) * static_cast<double>(last_avg_size)));
 }
 
+std::chrono::microseconds calculateAvgTime(const std::chrono::microseconds& last_avg_time,
+                                           const std::chrono::microseconds& time)
+{
+    static const double kAlpha = 0.1;
+    return std::chrono::microseconds(static_cast<int64_t>(
+        (kAlpha * static_cast<double>(time.count())) +
+        ((1.0 - kAlpha) * static_cast<double>(last_avg_time.count()))));
+}
+
+void addPacketRegion(const proto::VideoPacket& packet, base::Region* region)
+{
+    auto add_rect = [region](const proto::Rect& rect)
+    {
+        region->addRect(base::Rect::makeXYWH(rect.x(), rect.y(), rect.width(), rect.height()));
+    };
+
+    for (int i = 0; i < packet.dirty_rect_size(); ++i)
+        add_rect(packet.dirty_rect(i));
+
+    for (int i = 0; i < packet.copy_rect_size(); ++i)
+        add_rect(packet.copy_rect(i).dest_rect());
+
+    for (int i = 0; i < packet.cached_tile_size(); ++i)
+    {
+        const proto::VideoTile& tile = packet.cached_tile(i);
+        region->addRect(base::Rect::makeXYWH(
+            tile.x(), tile.y(), base::TileCache::kTileSize, base::TileCache::kTileSize));
+    }
+
+    if (packet.has_lossless_packet())
+        addPacketRegion(packet.lossless_packet(), region);
+}
+
 } // namespace
 
 ClientDesktop::ClientDesktop(std::shared_ptr<base::TaskRunner> io_task_runner)
     : base::ProtobufArena(io_task_runner),
       Client(io_task_runner),
-      desktop_control_proxy_(std::make_shared<DesktopControlProxy>(io_task_runner, this))
+      desktop_control_proxy_(std::make_shared<DesktopControlProxy>(io_task_runner, this)),
+      scoped_task_runner_(std::make_unique<base::ScopedTaskRunner>(io_task_runner))
 {
     LOG(LS_INFO) << "Ctor";
 
     setArenaStartSize(1 * 1024 * 1024); // 1 MB
     setArenaMaxSize(3 * 1024 * 1024); // 3 MB
+
+    decode_pool_ = decodePool();
+    decode_task_runner_ = decode_pool_->createSequencedTaskRunner();
 }
 
 ClientDesktop::~ClientDesktop()
 {
     LOG(LS_INFO) << "Dtor";
+
+    // The decode tasks use the members of the class. The tasks that have not started yet are
+    // skipped, the running one is waited for. The results that are already posted to the IO
+    // thread are discarded together with |scoped_task_runner_|.
+    decode_stopped_ = true;
+
+    std::promise<void> decode_done;
+    decode_task_runner_->postTask([&decode_done]() { decode_done.set_value(); });
+    decode_done.get_future().wait();
+
     desktop_control_proxy_->dettach();
+    saveCursorCache();
 }
 
 void ClientDesktop::setDesktopWindow(std::shared_ptr<DesktopWindowProxy> desktop_window_proxy)
@@ -91,11 +176,18 @@ void ClientDesktop::onSessionStarted(const base::Version& peer_version)
     clipboard_monitor_->start(ioTaskRunner(), this);
 
     audio_player_ = base::AudioPlayer::create();
+
+    on_battery_ = base::SysInfo::isOnBatteryPower();
+    LOG(LS_INFO) << "On battery: " << on_battery_;
+
+    power_timer_ = std::make_unique<base::WaitableTimer>(
+        base::WaitableTimer::Type::REPEATED, ioTaskRunner());
+    power_timer_->start(kPowerCheckInterval, std::bind(&ClientDesktop::onPowerTimer, this));
 }
 
 void ClientDesktop::onMessageReceived(const base::ByteArray& buffer)
 {
-    proto::HostToClient* incoming_message_ = messageFromArena<proto::HostToClient>();
+    proto::HostToClient* incoming_message_ = incomingMessageFromArena<proto::HostToClient>();
 
     if (!base::parse(buffer, incoming_message_))
     {
@@ -138,9 +230,9 @@ void ClientDesktop::onMessageReceived(const base::ByteArray& buffer)
     }
 }
 
-void ClientDesktop::onMessageWritten(size_t /* pending */)
+void ClientDesktop::onMessageWritten(size_t pending)
 {
-    // Nothing
+    pending_messages_ = pending;
 }
 
 void ClientDesktop::onClipboardEvent(const proto::ClipboardEvent& event)
@@ -149,9 +241,25 @@ void ClientDesktop::onClipboardEvent(const proto::ClipboardEvent& event)
     if (!out_event.has_value())
         return;
 
-    proto::ClientToHost* outgoing_message = messageFromArena<proto::ClientToHost>();
-    outgoing_message->mutable_clipboard_event()->CopyFrom(*out_event);
-    sendMessage(*outgoing_message);
+    if (!clipboard_stream_supported_)
+    {
+        proto::ClientToHost* outgoing_message = messageFromArena<proto::ClientToHost>();
+        outgoing_message->mutable_clipboard_event()->CopyFrom(*out_event);
+        sendMessage(*outgoing_message, Priority::HIGH);
+        return;
+    }
+
+    // The chunks of a large clipboard do not delay the input and the service messages.
+    std::vector<proto::ClipboardEvent> chunks = clipboard_stream_.split(*out_event);
+    const Priority priority = chunks.size() > 1 ? Priority::LOW : Priority::HIGH;
+
+    for (auto& chunk : chunks)
+    {
+        // The chunks are not allocated in the arena to not keep a large clipboard in it.
+        proto::ClientToHost outgoing_message;
+        outgoing_message.mutable_clipboard_event()->Swap(&chunk);
+        sendMessage(outgoing_message, priority);
+    }
 }
 
 void ClientDesktop::setDesktopConfig(const proto::DesktopConfig& desktop_config)
@@ -171,13 +279,48 @@ void ClientDesktop::setDesktopConfig(const proto::DesktopConfig& desktop_config)
     if (!(desktop_config_.flags() & proto::ENABLE_CURSOR_SHAPE))
     {
         LOG(LS_INFO) << "Cursor shape disabled";
+        saveCursorCache();
         cursor_decoder_.reset();
     }
+    else
+    {
+        initCursorDecoder();
+    }
 
     input_event_filter_.setClipboardEnabled(desktop_config_.flags() & proto::ENABLE_CLIPBOARD);
 
     proto::ClientToHost* outgoing_message = messageFromArena<proto::ClientToHost>();
-    outgoing_message->mutable_config()->CopyFrom(desktop_config_);
+    proto::DesktopConfig* config = outgoing_message->mutable_config();
+    config->CopyFrom(desktop_config_);
+
+    if (cursor_decoder_)
+    {
+        // The host does not send the cursors that we already have. The changed cursors come as
+        // a difference from the previous one.
+        config->set_flags(config->flags() | proto::CURSOR_HASH_CACHE | proto::CURSOR_DELTA);
+
+        for (uint64_t hash : cursor_decoder_->hashCache())
+            config->add_cursor_cache(hash);
+    }
+
+    // The decoder paints the slices of large frames as they arrive.
+    config->set_flags(config->flags() | proto::SLICED_FRAMES);
+
+    if (on_battery_)
+    {
+        config->set_flags(config->flags() | proto::ENERGY_SAVER);
+
+        // The hardware encoder of the host and the hardware decoder of the client spend much less
+        // energy than VP8 and VP9 in software.
+        const uint32_t h264 = static_cast<uint32_t>(proto::VIDEO_ENCODING_H264);
+        if ((config->video_encoding() == proto::VIDEO_ENCODING_VP8 ||
+             config->video_encoding() == proto::VIDEO_ENCODING_VP9) &&
+            (host_video_encodings_ & common::kSupportedVideoEncodings & h264))
+        {
+            LOG(LS_INFO) << "H.264 is used instead of " << config->video_encoding();
+            config->set_video_encoding(proto::VIDEO_ENCODING_H264);
+        }
+    }
 
     LOG(LS_INFO) << "Send new config to host";
     sendMessage(*outgoing_message);
@@ -214,46 +357,50 @@ void ClientDesktop::setPreferredSize(int width, int height)
     sendMessage(*outgoing_message);
 }
 
-void ClientDesktop::setVideoRecording(bool enable, const std::filesystem::path& file_path)
+void ClientDesktop::setActive(bool active)
 {
-    proto::VideoRecording video_recording;
+    decode_pool_->setPriority(decode_task_runner_, active ?
+        base::ThreadPool::Priority::HIGH : base::ThreadPool::Priority::NORMAL);
+}
 
+void ClientDesktop::setViewport(const proto::Viewport& viewport)
+{
+    if (!viewport_supported_)
+        return;
+
+    proto::ClientToHost* outgoing_message = messageFromArena<proto::ClientToHost>();
+
+    proto::DesktopExtension* extension = outgoing_message->mutable_extension();
+
+    extension->set_name(common::kViewportExtension);
+    extension->set_data(viewport.SerializeAsString());
+
+    sendMessage(*outgoing_message);
+}
+
+void ClientDesktop::setVideoRecording(bool enable, const std::filesystem::path& file_path)
+{
     if (enable)
     {
-        video_recording.set_action(proto::VideoRecording::ACTION_STARTED);
-
-        webm_file_writer_ = std::make_unique<base::WebmFileWriter>(file_path, computerName());
-        webm_video_encoder_ = std::make_unique<base::WebmVideoEncoder>();
+        video_recorder_ = std::make_unique<VideoRecorder>(file_path, computerName());
 
-        webm_video_encode_timer_ = std::make_unique<base::WaitableTimer>(
+        video_recorder_timer_ = std::make_unique<base::WaitableTimer>(
             base::WaitableTimer::Type::REPEATED, ioTaskRunner());
-        webm_video_encode_timer_->start(std::chrono::milliseconds(60), [this]()
+        video_recorder_timer_->start(std::chrono::milliseconds(60), [this]()
         {
-            if (!webm_video_encoder_ || !webm_file_writer_ || !desktop_frame_)
+            if (!video_recorder_ || !desktop_frame_ || canRecordVideoPackets())
                 return;
 
-            proto::VideoPacket packet;
-
-            if (webm_video_encoder_->encode(*desktop_frame_, &packet))
-                webm_file_writer_->addVideoPacket(packet);
+            video_recorder_->addFrame(*desktop_frame_);
         });
     }
     else
     {
-        video_recording.set_action(proto::VideoRecording::ACTION_STOPPED);
-
-        webm_video_encode_timer_.reset();
-        webm_video_encoder_.reset();
-        webm_file_writer_.reset();
+        video_recorder_timer_.reset();
+        video_recorder_.reset();
     }
 
-    proto::ClientToHost* outgoing_message = messageFromArena<proto::ClientToHost>();
-    proto::DesktopExtension* extension = outgoing_message->mutable_extension();
-
-    extension->set_name(common::kVideoRecordingExtension);
-    extension->set_data(video_recording.SerializeAsString());
-
-    sendMessage(*outgoing_message);
+    sendVideoRecording(enable);
 }
 
 void ClientDesktop::onKeyEvent(const proto::KeyEvent& event)
@@ -262,10 +409,17 @@ void ClientDesktop::onKeyEvent(const proto::KeyEvent& event)
     if (!out_event.has_value())
         return;
 
+    if (input_batch_enabled_)
+    {
+        input_batch_.add_event()->mutable_key_event()->CopyFrom(*out_event);
+        sendInputBatch();
+        return;
+    }
+
     proto::ClientToHost* outgoing_message = messageFromArena<proto::ClientToHost>();
     outgoing_message->mutable_key_event()->CopyFrom(*out_event);
 
-    sendMessage(*outgoing_message);
+    sendMessage(*outgoing_message, Priority::HIGH);
 }
 
 void ClientDesktop::onTextEvent(const proto::TextEvent& event)
@@ -274,10 +428,17 @@ void ClientDesktop::onTextEvent(const proto::TextEvent& event)
     if (!out_event.has_value())
         return;
 
+    if (input_batch_enabled_)
+    {
+        input_batch_.add_event()->mutable_text_event()->CopyFrom(*out_event);
+        sendInputBatch();
+        return;
+    }
+
     proto::ClientToHost* outgoing_message = messageFromArena<proto::ClientToHost>();
     outgoing_message->mutable_text_event()->CopyFrom(*out_event);
 
-    sendMessage(*outgoing_message);
+    sendMessage(*outgoing_message, Priority::HIGH);
 }
 
 void ClientDesktop::onMouseEvent(const proto::MouseEvent& event)
@@ -286,10 +447,16 @@ void ClientDesktop::onMouseEvent(const proto::MouseEvent& event)
     if (!out_event.has_value())
         return;
 
+    if (input_batch_enabled_)
+    {
+        addMouseEventToBatch(*out_event);
+        return;
+    }
+
     proto::ClientToHost* outgoing_message = messageFromArena<proto::ClientToHost>();
     outgoing_message->mutable_mouse_event()->CopyFrom(*out_event);
 
-    sendMessage(*outgoing_message);
+    sendMessage(*outgoing_message, Priority::HIGH);
 }
 
 void ClientDesktop::onPowerControl(proto::PowerControl::Action action)
@@ -382,6 +549,19 @@ void ClientDesktop::onMetricsRequest()
     metrics.cursor_shape_count = cursor_shape_count_;
     metrics.cursor_pos_count   = cursor_pos_count_;
 
+    metrics.capture_time = avg_capture_time_;
+    metrics.diff_time    = avg_diff_time_;
+    metrics.queue_time   = avg_queue_time_;
+    metrics.encode_time  = avg_encode_time_;
+    metrics.round_trip_time = roundTripTime();
+    metrics.network_time = metrics.round_trip_time / 2;
+    metrics.decode_time  = avg_decode_time_;
+    metrics.input_delay  = avg_input_delay_;
+    metrics.pending_messages = pending_messages_;
+    metrics.dropped_frames = dropped_frame_count_;
+    metrics.host_load = host_load_;
+    metrics.throttle_level = throttle_level_;
+
     if (cursor_decoder_)
     {
         metrics.cursor_cached = cursor_decoder_->cachedCursors();
@@ -399,6 +579,24 @@ void ClientDesktop::readConfigRequest(const proto::DesktopConfigRequest& config_
     // A window can disable/enable some of its capabilities in accordance with this information.
     desktop_window_proxy_->setCapabilities(
         config_request.extensions(), config_request.video_encodings());
+    host_video_encodings_ = config_request.video_encodings();
+
+    std::vector<std::string_view> extensions = base::splitStringView(
+        config_request.extensions(), ";", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+
+    input_batch_enabled_ = base::contains(extensions, common::kInputEventBatchExtension);
+    if (input_batch_enabled_ && !input_batch_timer_)
+    {
+        input_batch_timer_ = std::make_unique<base::WaitableTimer>(
+            base::WaitableTimer::Type::SINGLE_SHOT, ioTaskRunner());
+    }
+    LOG(LS_INFO) << "Input event batches: " << input_batch_enabled_;
+
+    recording_key_frame_supported_ =
+        base::contains(extensions, common::kRecordingKeyFrameExtension);
+    video_recovery_supported_ = base::contains(extensions, common::kVideoRecoveryExtension);
+    clipboard_stream_supported_ = base::contains(extensions, common::kClipboardStreamExtension);
+    viewport_supported_ = base::contains(extensions, common::kViewportExtension);
 
     // If current video encoding not supported.
     if (!(config_request.video_encodings() & static_cast<uint32_t>(desktop_config_.video_encoding())))
@@ -417,18 +615,23 @@ void ClientDesktop::readConfigRequest(const proto::DesktopConfigRequest& config_
 
 void ClientDesktop::readVideoPacket(const proto::VideoPacket& packet)
 {
+    TRACE_EVENT("ClientDesktop::readVideoPacket");
+
     if (video_encoding_ != packet.encoding())
     {
-        video_decoder_ = base::VideoDecoder::create(packet.encoding());
         video_encoding_ = packet.encoding();
 
         LOG(LS_INFO) << "Video encoding changed to: " << video_encoding_;
-    }
 
-    if (!video_decoder_)
-    {
-        LOG(LS_ERROR) << "Video decoder not initialized";
-        return;
+        decode_task_runner_->postTask([this, encoding = video_encoding_]()
+        {
+            if (decode_stopped_)
+                return;
+
+            video_decoder_ = base::VideoDecoder::create(encoding);
+            video_recovery_pending_ = false;
+            reference_frame_id_ = 0;
+        });
     }
 
     if (packet.has_format())
@@ -474,14 +677,119 @@ void ClientDesktop::readVideoPacket(const proto::VideoPacket& packet)
         return;
     }
 
-    if (!video_decoder_->decode(packet, desktop_frame_.get()))
+    // The packet belongs to the arena of the incoming messages, the decode thread gets a copy.
+    decode_task_runner_->postTask(
+        [this, packet = std::make_shared<proto::VideoPacket>(packet), frame = desktop_frame_,
+         recovery_supported = video_recovery_supported_]() mutable
+    {
+        decodeVideoPacket(std::move(packet), std::move(frame), recovery_supported);
+    });
+}
+
+void ClientDesktop::decodeVideoPacket(std::shared_ptr<proto::VideoPacket> packet,
+                                      std::shared_ptr<base::Frame> frame,
+                                      bool recovery_supported)
+{
+    DCHECK(decode_task_runner_->belongsToCurrentThread());
+    TRACE_EVENT("ClientDesktop::decodeVideoPacket");
+
+    if (decode_stopped_)
+        return;
+
+    DecodeResult result = DecodeResult::DECODED;
+    std::chrono::microseconds decode_time(0);
+
+    if (!video_decoder_)
+    {
+        LOG(LS_ERROR) << "Video decoder not initialized";
+        result = DecodeResult::DROPPED;
+    }
+    else if (video_recovery_pending_ && !packet->has_format() &&
+             (!packet->recovery_frame_id() || packet->recovery_frame_id() != reference_frame_id_))
+    {
+        // The packet depends on the frames that could not be decoded.
+        result = DecodeResult::DROPPED;
+    }
+    else
+    {
+        if (video_recovery_pending_)
+        {
+            LOG(LS_INFO) << "Video stream recovered";
+            video_recovery_pending_ = false;
+        }
+
+        const Clock::time_point decode_start_time = Clock::now();
+
+        if (video_decoder_->decode(*packet, frame.get()))
+        {
+            if (packet->reference_frame_id())
+                reference_frame_id_ = packet->reference_frame_id();
+
+            decode_time = std::chrono::duration_cast<std::chrono::microseconds>(
+                Clock::now() - decode_start_time);
+        }
+        else
+        {
+            LOG(LS_ERROR) << "The video packet could not be decoded";
+            result = DecodeResult::FAILED;
+            video_recovery_pending_ = recovery_supported;
+        }
+    }
+
+    scoped_task_runner_->postTask(
+        [this, packet = std::move(packet), frame = std::move(frame), result, decode_time,
+         reference_frame_id = reference_frame_id_]()
+    {
+        onVideoPacketDecoded(*packet, *frame, result, decode_time, reference_frame_id);
+    });
+}
+
+void ClientDesktop::onVideoPacketDecoded(const proto::VideoPacket& packet,
+                                         const base::Frame& frame,
+                                         DecodeResult result,
+                                         std::chrono::microseconds decode_time,
+                                         uint32_t reference_frame_id)
+{
+    if (result != DecodeResult::DECODED)
     {
-        LOG(LS_ERROR) << "The video packet could not be decoded";
+        ++dropped_frame_count_;
+
+        if (result == DecodeResult::FAILED && video_recovery_supported_)
+            sendVideoRecovery(reference_frame_id);
         return;
     }
 
+    avg_decode_time_ = calculateAvgTime(avg_decode_time_, decode_time);
+
+    if (packet.has_timing())
+    {
+        const proto::VideoPacketTiming& timing = packet.timing();
+
+        avg_capture_time_ = calculateAvgTime(
+            avg_capture_time_, std::chrono::microseconds(timing.capture_duration()));
+        avg_diff_time_ = calculateAvgTime(
+            avg_diff_time_, std::chrono::microseconds(timing.diff_duration()));
+        avg_queue_time_ = calculateAvgTime(
+            avg_queue_time_, std::chrono::microseconds(timing.queue_duration()));
+        avg_encode_time_ = calculateAvgTime(
+            avg_encode_time_, std::chrono::microseconds(timing.encode_duration()));
+
+        // The frames without the input events do not change the delay.
+        if (timing.input_delay())
+        {
+            avg_input_delay_ = calculateAvgTime(
+                avg_input_delay_, std::chrono::microseconds(timing.input_delay()));
+        }
+    }
+
+    host_load_ = static_cast<int>(packet.host_load());
+    throttle_level_ = static_cast<int>(packet.throttle_level());
+
     ++video_packet_count_;
-    ++fps_frame_count_;
+
+    // The frame is complete with its last slice.
+    if (!packet.partial())
+        ++fps_frame_count_;
 
     size_t packet_size = packet.ByteSizeLong();
 
@@ -489,13 +797,31 @@ void ClientDesktop::readVideoPacket(const proto::VideoPacket& packet)
     min_video_packet_ = std::min(min_video_packet_, packet_size);
     max_video_packet_ = std::max(max_video_packet_, packet_size);
 
-    desktop_window_proxy_->drawFrame();
+    base::Region dirty_region;
+    if (packet.has_format())
+    {
+        dirty_region.addRect(base::Rect::makeSize(frame.size()));
+    }
+    else
+    {
+        addPacketRegion(packet, &dirty_region);
+        dirty_region.intersectWith(base::Rect::makeSize(frame.size()));
+    }
+
+    desktop_window_proxy_->drawFrame(dirty_region);
+
+    if (video_recorder_ && canRecordVideoPackets())
+    {
+        // The recording has lost a packet and can continue only from a key frame.
+        if (!video_recorder_->addVideoPacket(packet))
+            sendVideoRecording(true);
+    }
 }
 
 void ClientDesktop::readAudioPacket(const proto::AudioPacket& packet)
 {
-    if (webm_file_writer_)
-        webm_file_writer_->addAudioPacket(packet);
+    if (video_recorder_)
+        video_recorder_->addAudioPacket(packet);
 
     if (!audio_player_)
         return;
@@ -524,6 +850,95 @@ void ClientDesktop::readAudioPacket(const proto::AudioPacket& packet)
         audio_player_->addPacket(std::move(decoded_packet));
 }
 
+bool ClientDesktop::canRecordVideoPackets() const
+{
+    return recording_key_frame_supported_ &&
+           base::WebmFileWriter::isSupportedEncoding(video_encoding_);
+}
+
+void ClientDesktop::sendVideoRecording(bool started)
+{
+    proto::VideoRecording video_recording;
+    video_recording.set_action(started ? proto::VideoRecording::ACTION_STARTED
+                                       : proto::VideoRecording::ACTION_STOPPED);
+
+    proto::ClientToHost* outgoing_message = messageFromArena<proto::ClientToHost>();
+    proto::DesktopExtension* extension = outgoing_message->mutable_extension();
+
+    extension->set_name(common::kVideoRecordingExtension);
+    extension->set_data(video_recording.SerializeAsString());
+
+    sendMessage(*outgoing_message);
+}
+
+void ClientDesktop::sendVideoRecovery(uint32_t reference_frame_id)
+{
+    LOG(LS_INFO) << "Requesting video recovery (reference frame: " << reference_frame_id << ")";
+
+    proto::VideoRecovery video_recovery;
+    video_recovery.set_reference_frame_id(reference_frame_id);
+
+    proto::ClientToHost* outgoing_message = messageFromArena<proto::ClientToHost>();
+    proto::DesktopExtension* extension = outgoing_message->mutable_extension();
+
+    extension->set_name(common::kVideoRecoveryExtension);
+    extension->set_data(video_recovery.SerializeAsString());
+
+    sendMessage(*outgoing_message);
+}
+
+void ClientDesktop::addMouseEventToBatch(const proto::MouseEvent& event)
+{
+    constexpr uint32_t kWheelMask = proto::MouseEvent::WHEEL_DOWN | proto::MouseEvent::WHEEL_UP;
+
+    const bool is_move = event.mask() == last_input_mouse_mask_ && !(event.mask() & kWheelMask);
+    last_input_mouse_mask_ = event.mask();
+
+    if (is_move && input_batch_.event_size() != 0)
+    {
+        proto::InputEvent* last_event = input_batch_.mutable_event(input_batch_.event_size() - 1);
+
+        // Only the last position of the consecutive moves is needed.
+        if (last_event->has_mouse_event() && last_event->mouse_event().mask() == event.mask())
+        {
+            last_event->mutable_mouse_event()->set_x(event.x());
+            last_event->mutable_mouse_event()->set_y(event.y());
+            return;
+        }
+    }
+
+    input_batch_.add_event()->mutable_mouse_event()->CopyFrom(event);
+
+    if (!is_move)
+    {
+        // Clicks and wheel events are sent without a delay.
+        sendInputBatch();
+        return;
+    }
+
+    if (!input_batch_scheduled_)
+    {
+        input_batch_scheduled_ = true;
+        input_batch_timer_->start(kInputBatchInterval, [this]()
+        {
+            input_batch_scheduled_ = false;
+            sendInputBatch();
+        });
+    }
+}
+
+void ClientDesktop::sendInputBatch()
+{
+    if (input_batch_.event_size() == 0)
+        return;
+
+    proto::ClientToHost* outgoing_message = messageFromArena<proto::ClientToHost>();
+    outgoing_message->mutable_input_event_batch()->Swap(&input_batch_);
+    input_batch_.Clear();
+
+    sendMessage(*outgoing_message, Priority::HIGH);
+}
+
 void ClientDesktop::readCursorShape(const proto::CursorShape& cursor_shape)
 {
     if (sessionType() != proto::SESSION_TYPE_DESKTOP_MANAGE)
@@ -540,11 +955,7 @@ void ClientDesktop::readCursorShape(const proto::CursorShape& cursor_shape)
 
     ++cursor_shape_count_;
 
-    if (!cursor_decoder_)
-    {
-        LOG(LS_INFO) << "Cursor decoder initialization";
-        cursor_decoder_ = std::make_unique<base::CursorDecoder>();
-    }
+    initCursorDecoder();
 
     std::shared_ptr<base::MouseCursor> mouse_cursor = cursor_decoder_->decode(cursor_shape);
     if (!mouse_cursor)
@@ -553,6 +964,35 @@ void ClientDesktop::readCursorShape(const proto::CursorShape& cursor_shape)
     desktop_window_proxy_->setMouseCursor(mouse_cursor);
 }
 
+void ClientDesktop::initCursorDecoder()
+{
+    if (cursor_decoder_)
+        return;
+
+    LOG(LS_INFO) << "Cursor decoder initialization";
+    cursor_decoder_ = std::make_unique<base::CursorDecoder>();
+
+    proto::CursorCache cursor_cache;
+    if (CursorCacheStorage::load(&cursor_cache))
+        cursor_decoder_->setHashCache(cursor_cache);
+}
+
+void ClientDesktop::saveCursorCache()
+{
+    if (!cursor_decoder_)
+        return;
+
+    proto::CursorCache cursor_cache;
+    cursor_decoder_->hashCacheContents(&cursor_cache);
+
+    // Do not overwrite the cursors of the previous sessions if the host did not use the cache.
+    if (cursor_cache.cursor_size() == 0)
+        return;
+
+    if (!CursorCacheStorage::save(cursor_cache))
+        LOG(LS_WARNING) << "Unable to save cursor cache";
+}
+
 void ClientDesktop::readCursorPosition(const proto::CursorPosition& cursor_position)
 {
     if (!(desktop_config_.flags() & proto::CURSOR_POSITION))
@@ -574,7 +1014,12 @@ void ClientDesktop::readClipboardEvent(const proto::ClipboardEvent& event)
         return;
     }
 
-    std::optional<proto::ClipboardEvent> out_event = input_event_filter_.readClipboardEvent(event);
+    std::optional<proto::ClipboardEvent> joined_event = clipboard_stream_.join(event);
+    if (!joined_event.has_value())
+        return;
+
+    std::optional<proto::ClipboardEvent> out_event =
+        input_event_filter_.readClipboardEvent(*joined_event);
     if (!out_event.has_value())
         return;
 
@@ -623,4 +1068,19 @@ void ClientDesktop::readExtension(const proto::DesktopExtension& extension)
     }
 }
 
+void ClientDesktop::onPowerTimer()
+{
+    const bool on_battery = base::SysInfo::isOnBatteryPower();
+    if (on_battery == on_battery_)
+        return;
+
+    LOG(LS_INFO) << "Power source changed (on battery: " << on_battery << ")";
+    on_battery_ = on_battery;
+
+    // The configuration is sent again with the energy saving mode changed. Before the request
+    // of the host it is not sent at all.
+    if (host_video_encodings_)
+        setDesktopConfig(desktop_config_);
+}
+
 } // namespace client
@@ -25,16 +25,19 @@
 #include "client/desktop_control.h"
 #include "client/input_event_filter.h"
 #include "common/clipboard_monitor.h"
+#include "common/clipboard_stream.h"
+
+#include <atomic>
 
 namespace base {
 class AudioDecoder;
 class AudioPlayer;
 class CursorDecoder;
 class Frame;
+class ScopedTaskRunner;
+class ThreadPool;
 class VideoDecoder;
 class WaitableTimer;
-class WebmFileWriter;
-class WebmVideoEncoder;
 } // namespace base
 
 namespace client {
@@ -43,6 +46,7 @@ class AudioRenderer;
 class DesktopControlProxy;
 class DesktopWindow;
 class DesktopWindowProxy;
+class VideoRecorder;
 
 class ClientDesktop
     : public base::ProtobufArena,
@@ -60,7 +64,9 @@ public:
     void setDesktopConfig(const proto::DesktopConfig& config) override;
     void setCurrentScreen(const proto::Screen& screen) override;
     void setPreferredSize(int width, int height) override;
+    void setViewport(const proto::Viewport& viewport) override;
     void setVideoRecording(bool enable, const std::filesystem::path& file_path) override;
+    void setActive(bool active) override;
     void onKeyEvent(const proto::KeyEvent& event) override;
     void onTextEvent(const proto::TextEvent& event) override;
     void onMouseEvent(const proto::MouseEvent& event) override;
@@ -82,12 +88,30 @@ protected:
 
 private:
     void readConfigRequest(const proto::DesktopConfigRequest& config_request);
+    enum class DecodeResult { DECODED, FAILED, DROPPED };
+
     void readVideoPacket(const proto::VideoPacket& packet);
+    void decodeVideoPacket(std::shared_ptr<proto::VideoPacket> packet,
+                           std::shared_ptr<base::Frame> frame,
+                           bool recovery_supported);
+    void onVideoPacketDecoded(const proto::VideoPacket& packet,
+                              const base::Frame& frame,
+                              DecodeResult result,
+                              std::chrono::microseconds decode_time,
+                              uint32_t reference_frame_id);
     void readAudioPacket(const proto::AudioPacket& packet);
+    bool canRecordVideoPackets() const;
+    void sendVideoRecording(bool started);
+    void sendVideoRecovery(uint32_t reference_frame_id);
+    void addMouseEventToBatch(const proto::MouseEvent& event);
+    void sendInputBatch();
     void readCursorShape(const proto::CursorShape& cursor_shape);
+    void initCursorDecoder();
+    void saveCursorCache();
     void readCursorPosition(const proto::CursorPosition& cursor_position);
     void readClipboardEvent(const proto::ClipboardEvent& event);
     void readExtension(const proto::DesktopExtension& extension);
+    void onPowerTimer();
 
     bool started_ = false;
 
@@ -95,21 +119,61 @@ private:
     std::shared_ptr<DesktopWindowProxy> desktop_window_proxy_;
     std::shared_ptr<base::Frame> desktop_frame_;
     proto::DesktopConfig desktop_config_;
+    uint32_t host_video_encodings_ = 0;
+
+    // While the computer runs on battery, the host is asked for fewer frames that are cheaper to
+    // encode and decode (see proto::ENERGY_SAVER). The power source is checked by the timer.
+    bool on_battery_ = false;
+    std::unique_ptr<base::WaitableTimer> power_timer_;
 
     proto::VideoEncoding video_encoding_ = proto::VIDEO_ENCODING_UNKNOWN;
     proto::AudioEncoding audio_encoding_ = proto::AUDIO_ENCODING_UNKNOWN;
 
-    std::unique_ptr<base::VideoDecoder> video_decoder_;
     std::unique_ptr<base::CursorDecoder> cursor_decoder_;
     std::unique_ptr<base::AudioDecoder> audio_decoder_;
     std::unique_ptr<base::AudioPlayer> audio_player_;
     std::unique_ptr<common::ClipboardMonitor> clipboard_monitor_;
+    common::ClipboardStream clipboard_stream_;
+    bool clipboard_stream_supported_ = false;
+
+    // If the host supports it, the host encodes only the part of the screen visible in the window.
+    bool viewport_supported_ = false;
 
     InputEventFilter input_event_filter_;
 
-    std::unique_ptr<base::WaitableTimer> webm_video_encode_timer_;
-    std::unique_ptr<base::WebmVideoEncoder> webm_video_encoder_;
-    std::unique_ptr<base::WebmFileWriter> webm_file_writer_;
+    // If the host supports it, the input events are sent in batches. Mouse moves are collected for
+    // kInputBatchInterval, the other events are sent at once with the collected moves.
+    bool input_batch_enabled_ = false;
+    bool input_batch_scheduled_ = false;
+    uint32_t last_input_mouse_mask_ = 0;
+    proto::InputEventBatch input_batch_;
+    std::unique_ptr<base::WaitableTimer> input_batch_timer_;
+
+    // The host sends a key frame when the recording starts. The VP8 and VP9 packets are written
+    // to the file as they are, the frames of the other encodings are encoded again by the timer.
+    bool recording_key_frame_supported_ = false;
+    std::unique_ptr<VideoRecorder> video_recorder_;
+    std::unique_ptr<base::WaitableTimer> video_recorder_timer_;
+
+    // If a video packet could not be decoded, the next packets are skipped until a key frame or a
+    // recovery frame that refers to the last decoded reference frame (see proto::VideoPacket).
+    bool video_recovery_supported_ = false;
+
+    // The video packets are decoded apart from the IO thread, so the decoding of the large frames
+    // does not delay the network. The results are handled on the IO thread in the order of the
+    // packets. All sessions of the client decode on one pool of threads, each session in its own
+    // sequence. The sequence of the active window has the high priority.
+    std::shared_ptr<base::ThreadPool> decode_pool_;
+    std::shared_ptr<base::TaskRunner> decode_task_runner_;
+    std::unique_ptr<base::ScopedTaskRunner> scoped_task_runner_;
+
+    // Set in the destructor. The decode tasks that have not started yet do nothing.
+    std::atomic_bool decode_stopped_ = false;
+
+    // Accessed only in the decode sequence.
+    std::unique_ptr<base::VideoDecoder> video_decoder_;
+    bool video_recovery_pending_ = false;
+    uint32_t reference_frame_id_ = 0;
 
     using Clock = std::chrono::high_resolution_clock;
     using TimePoint = std::chrono::time_point<Clock>;
@@ -130,6 +194,21 @@ private:
     int cursor_shape_count_ = 0;
     int cursor_pos_count_ = 0;
 
+    // Average latency of the video frames by stages.
+    std::chrono::microseconds avg_capture_time_ { 0 };
+    std::chrono::microseconds avg_diff_time_ { 0 };
+    std::chrono::microseconds avg_queue_time_ { 0 };
+    std::chrono::microseconds avg_encode_time_ { 0 };
+    std::chrono::microseconds avg_decode_time_ { 0 };
+    std::chrono::microseconds avg_input_delay_ { 0 };
+
+    int64_t dropped_frame_count_ = 0;
+    size_t pending_messages_ = 0;
+
+    // The last values reported by the host.
+    int host_load_ = 0;
+    int throttle_level_ = 0;
+
     DISALLOW_COPY_AND_ASSIGN(ClientDesktop);
 };
 
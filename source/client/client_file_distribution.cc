@@ -0,0 +1,287 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/client_file_distribution.h"
+
+#include "base/logging.h"
+#include "base/crypto/generic_hash.h"
+#include "common/file_packet.h"
+
+namespace client {
+
+namespace {
+
+// The packets are sent without waiting for the replies to hide the round trip time. Each packet
+// has one chunk of the file.
+const size_t kMaxPacketsInFlight = 8;
+
+} // namespace
+
+ClientFileDistribution::ClientFileDistribution(std::shared_ptr<base::TaskRunner> io_task_runner,
+                                               FileDistributionCache* cache,
+                                               Delegate* delegate,
+                                               size_t host_index,
+                                               const std::string& target_dir,
+                                               const std::string& file_name,
+                                               bool overwrite,
+                                               bool resume)
+    : Client(std::move(io_task_runner)),
+      cache_(cache),
+      delegate_(delegate),
+      host_index_(host_index),
+      reader_id_(cache->addReader()),
+      target_dir_(target_dir),
+      target_path_(target_dir + '/' + file_name),
+      overwrite_(overwrite || resume),
+      resume_(resume)
+{
+    LOG(LS_INFO) << "Ctor";
+    DCHECK(cache_ && delegate_);
+}
+
+ClientFileDistribution::~ClientFileDistribution()
+{
+    LOG(LS_INFO) << "Dtor";
+    cache_->removeReader(reader_id_);
+}
+
+void ClientFileDistribution::onSessionStarted(const base::Version& /* peer_version */)
+{
+    LOG(LS_INFO) << "File distribution session started";
+
+    // The directory usually exists already, the error is ignored.
+    state_ = State::CREATE_DIRECTORY;
+
+    proto::FileRequest request;
+    request.mutable_create_directory_request()->set_path(target_dir_);
+    sendMessage(request);
+}
+
+void ClientFileDistribution::onMessageReceived(const base::ByteArray& buffer)
+{
+    proto::FileReply reply;
+
+    if (!base::parse(buffer, &reply))
+    {
+        LOG(LS_ERROR) << "Invalid message from host";
+        finish(proto::FILE_ERROR_UNKNOWN);
+        return;
+    }
+
+    if (reply.error_code() == proto::FILE_ERROR_NO_LOGGED_ON_USER)
+    {
+        finish(reply.error_code());
+        return;
+    }
+
+    switch (state_)
+    {
+        case State::CREATE_DIRECTORY:
+            sendUploadRequest();
+            break;
+
+        case State::UPLOAD:
+        {
+            if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
+            {
+                finish(reply.error_code());
+                return;
+            }
+
+            // The hashes are compared with the chunks of the cache, other block sizes are not
+            // used.
+            const proto::FileBlockHashes& block_hashes = reply.block_hashes();
+            if (block_hashes.hash_size() && block_hashes.block_size() == cache_->kChunkSize)
+            {
+                block_hashes_.assign(block_hashes.hash().begin(), block_hashes.hash().end());
+                digest_ = std::make_unique<base::GenericHash>(base::GenericHash::BLAKE2b512);
+            }
+
+            state_ = State::SEND;
+            readNextChunk();
+        }
+        break;
+
+        case State::SEND:
+            onPacketReply(reply.error_code());
+            break;
+
+        default:
+            break;
+    }
+}
+
+void ClientFileDistribution::onMessageWritten(size_t /* pending */)
+{
+    // Nothing
+}
+
+void ClientFileDistribution::sendUploadRequest()
+{
+    state_ = State::UPLOAD;
+
+    proto::FileRequest request;
+    proto::UploadRequest* upload_request = request.mutable_upload_request();
+    upload_request->set_path(target_path_);
+    upload_request->set_overwrite(overwrite_);
+    upload_request->set_resume(resume_);
+    sendMessage(request);
+}
+
+void ClientFileDistribution::readNextChunk()
+{
+    if (is_reading_ || last_packet_sent_ || packets_in_flight_.size() >= kMaxPacketsInFlight)
+        return;
+
+    if (!cache_->chunkCount())
+    {
+        // An empty file is sent in one packet without data.
+        proto::FileRequest request;
+        request.mutable_packet();
+        sendPacket(&request, true);
+        return;
+    }
+
+    is_reading_ = true;
+
+    const size_t index = next_chunk_++;
+    cache_->readChunk(reader_id_, index, [this, index](FileDistributionCache::Chunk chunk)
+    {
+        onChunkRead(index, std::move(chunk));
+    });
+}
+
+void ClientFileDistribution::onChunkRead(size_t index, FileDistributionCache::Chunk chunk)
+{
+    is_reading_ = false;
+
+    if (state_ != State::SEND)
+        return;
+
+    if (!chunk)
+    {
+        finish(proto::FILE_ERROR_FILE_READ_ERROR);
+        return;
+    }
+
+    const bool is_last = index + 1 == cache_->chunkCount();
+
+    if (index < block_hashes_.size() && cache_->chunkHash(index) == block_hashes_[index])
+    {
+        // The block on the host matches, only its size is sent.
+        unchanged_size_ += chunk->size();
+
+        if (is_last || unchanged_size_ >= common::kMaxUnchangedSize)
+            flushUnchangedSize(is_last);
+    }
+    else
+    {
+        flushUnchangedSize(false);
+
+        proto::FileRequest request;
+        request.mutable_packet()->set_data(*chunk);
+        sendPacket(&request, is_last);
+    }
+
+    readNextChunk();
+}
+
+void ClientFileDistribution::flushUnchangedSize(bool is_last)
+{
+    if (!unchanged_size_)
+        return;
+
+    proto::FileRequest request;
+    request.mutable_packet()->set_unchanged_size(unchanged_size_);
+    sendPacket(&request, is_last);
+
+    unchanged_size_ = 0;
+}
+
+void ClientFileDistribution::sendPacket(proto::FileRequest* request, bool is_last)
+{
+    proto::FilePacket* packet = request->mutable_packet();
+
+    if (digest_)
+        digest_->addData(packet->data());
+
+    if (is_first_packet_)
+    {
+        is_first_packet_ = false;
+
+        packet->set_flags(packet->flags() | proto::FilePacket::FIRST_PACKET);
+        packet->set_file_size(cache_->fileSize());
+    }
+
+    if (is_last)
+    {
+        last_packet_sent_ = true;
+        packet->set_flags(packet->flags() | proto::FilePacket::LAST_PACKET);
+
+        if (cache_->fileSize())
+        {
+            // The digest of the cache is ready when the last chunk has been read.
+            packet->set_digest(digest_ ? base::toStdString(digest_->result()) : cache_->digest());
+        }
+    }
+
+    packets_in_flight_.emplace_back(packet->data().size() + packet->unchanged_size());
+    sendMessage(*request);
+}
+
+void ClientFileDistribution::onPacketReply(proto::FileError error_code)
+{
+    if (error_code != proto::FILE_ERROR_SUCCESS)
+    {
+        finish(error_code);
+        return;
+    }
+
+    if (packets_in_flight_.empty())
+    {
+        LOG(LS_ERROR) << "Unexpected reply from host";
+        finish(proto::FILE_ERROR_UNKNOWN);
+        return;
+    }
+
+    transferred_size_ += packets_in_flight_.front();
+    packets_in_flight_.pop_front();
+
+    delegate_->onDistributionProgress(host_index_, transferred_size_);
+
+    if (last_packet_sent_ && packets_in_flight_.empty())
+    {
+        finish(proto::FILE_ERROR_SUCCESS);
+        return;
+    }
+
+    readNextChunk();
+}
+
+void ClientFileDistribution::finish(proto::FileError error_code)
+{
+    if (state_ == State::FINISHED)
+        return;
+
+    LOG(LS_INFO) << "File distribution finished: " << error_code;
+    state_ = State::FINISHED;
+
+    delegate_->onDistributionFinished(host_index_, error_code);
+}
+
+} // namespace client
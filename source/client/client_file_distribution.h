@@ -0,0 +1,113 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT__CLIENT_FILE_DISTRIBUTION_H
+#define CLIENT__CLIENT_FILE_DISTRIBUTION_H
+
+#include "client/client.h"
+#include "client/file_distribution_cache.h"
+#include "proto/file_transfer.pb.h"
+
+#include <deque>
+
+namespace base {
+class GenericHash;
+} // namespace base
+
+namespace client {
+
+// Uploads the file of a distribution to one host. The data is taken from the cache shared by all
+// the hosts of the distribution.
+class ClientFileDistribution : public Client
+{
+public:
+    class Delegate
+    {
+    public:
+        virtual ~Delegate() = default;
+
+        // |transferred_size| includes the unchanged blocks of a resumed file.
+        virtual void onDistributionProgress(size_t host_index, uint64_t transferred_size) = 0;
+        virtual void onDistributionFinished(size_t host_index, proto::FileError error_code) = 0;
+    };
+
+    // The file is uploaded to |target_dir|, the directory is created if it does not exist. With
+    // |resume| the file left by a previous attempt is overwritten and only the changed blocks are
+    // sent.
+    ClientFileDistribution(std::shared_ptr<base::TaskRunner> io_task_runner,
+                           FileDistributionCache* cache,
+                           Delegate* delegate,
+                           size_t host_index,
+                           const std::string& target_dir,
+                           const std::string& file_name,
+                           bool overwrite,
+                           bool resume);
+    ~ClientFileDistribution();
+
+protected:
+    // Client implementation.
+    void onSessionStarted(const base::Version& peer_version) override;
+
+    // net::Channel::Listener implementation.
+    void onMessageReceived(const base::ByteArray& buffer) override;
+    void onMessageWritten(size_t pending) override;
+
+private:
+    void sendUploadRequest();
+    void readNextChunk();
+    void onChunkRead(size_t index, FileDistributionCache::Chunk chunk);
+    void flushUnchangedSize(bool is_last);
+    void sendPacket(proto::FileRequest* request, bool is_last);
+    void onPacketReply(proto::FileError error_code);
+    void finish(proto::FileError error_code);
+
+    enum class State { CREATED, CREATE_DIRECTORY, UPLOAD, SEND, FINISHED };
+    State state_ = State::CREATED;
+
+    FileDistributionCache* cache_;
+    Delegate* delegate_;
+    const size_t host_index_;
+    const size_t reader_id_;
+    const std::string target_dir_;
+    const std::string target_path_;
+    const bool overwrite_;
+    const bool resume_;
+
+    // Hashes of the blocks of the file left on the host.
+    std::vector<std::string> block_hashes_;
+
+    // The digest of the cache covers the whole file. When unchanged blocks are skipped, the
+    // digest of the sent data is calculated here.
+    std::unique_ptr<base::GenericHash> digest_;
+
+    size_t next_chunk_ = 0;
+    bool is_reading_ = false;
+    bool is_first_packet_ = true;
+    uint64_t unchanged_size_ = 0;
+
+    // The sizes of the packets waiting for the replies of the host.
+    std::deque<uint64_t> packets_in_flight_;
+    bool last_packet_sent_ = false;
+    uint64_t transferred_size_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(ClientFileDistribution);
+};
+
+} // namespace client
+
+#endif // CLIENT__CLIENT_FILE_DISTRIBUTION_H
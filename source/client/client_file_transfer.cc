@@ -27,16 +27,30 @@
 #include "common/file_task_producer_proxy.h"
 #include "common/file_worker.h"
 
+#include <algorithm>
+
 namespace client {
 
+namespace {
+
+// The first items of a large directory are shown while the rest is still being listed.
+const uint32_t kFileListPartSize = 1000;
+
+} // namespace
+
 ClientFileTransfer::ClientFileTransfer(std::shared_ptr<base::TaskRunner> io_task_runner)
     : Client(io_task_runner),
       task_consumer_proxy_(std::make_shared<common::FileTaskConsumerProxy>(this)),
       task_producer_proxy_(std::make_shared<common::FileTaskProducerProxy>(this)),
-      local_worker_(std::make_unique<common::FileWorker>(io_task_runner)),
       file_control_proxy_(std::make_shared<FileControlProxy>(io_task_runner, this))
 {
     LOG(LS_INFO) << "Ctor";
+
+    data_thread_.start(base::MessageLoop::Type::DEFAULT);
+    metadata_thread_.start(base::MessageLoop::Type::DEFAULT);
+
+    local_worker_ = std::make_unique<common::FileWorker>(
+        io_task_runner, data_thread_.taskRunner(), metadata_thread_.taskRunner());
 }
 
 ClientFileTransfer::~ClientFileTransfer()
@@ -49,6 +63,11 @@ ClientFileTransfer::~ClientFileTransfer()
 
     remover_.reset();
     transfer_.reset();
+
+    // The threads finish the queued requests, the replies are no longer delivered.
+    local_worker_.reset();
+    metadata_thread_.stop();
+    data_thread_.stop();
 }
 
 void ClientFileTransfer::setFileManagerWindow(
@@ -86,14 +105,33 @@ void ClientFileTransfer::onMessageReceived(const base::ByteArray& buffer)
     }
     else if (!remote_task_queue_.empty())
     {
-        // Move the reply to the request and notify the sender.
-        remote_task_queue_.front()->setReply(std::move(reply));
+        auto task = remote_task_queue_.begin();
+
+        if (reply->request_id())
+        {
+            const uint32_t request_id = reply->request_id();
+
+            task = std::find_if(remote_task_queue_.begin(), remote_task_queue_.end(),
+                [request_id](const std::shared_ptr<common::FileTask>& remote_task)
+            {
+                return remote_task->request().request_id() == request_id;
+            });
+
+            if (task == remote_task_queue_.end())
+            {
+                LOG(LS_ERROR) << "Reply to unknown request: " << request_id;
+                file_manager_window_proxy_->onErrorOccurred(proto::FILE_ERROR_UNKNOWN);
+                return;
+            }
+        }
+
+        std::shared_ptr<common::FileTask> remote_task = std::move(*task);
 
         // Remove the request from the queue.
-        remote_task_queue_.pop();
+        remote_task_queue_.erase(task);
 
-        // Execute the next request.
-        doNextRemoteTask();
+        // Move the reply to the request and notify the sender.
+        remote_task->setReply(std::move(reply));
     }
     else
     {
@@ -118,8 +156,33 @@ void ClientFileTransfer::onTaskDone(std::shared_ptr<common::FileTask> task)
     }
     else if (request.has_file_list_request())
     {
-        file_manager_window_proxy_->onFileList(
-            task->target(), reply.error_code(), reply.file_list());
+        std::shared_ptr<common::FileTask>& list_task = list_tasks_[task->target()];
+        if (list_task != task)
+        {
+            // Another list was requested after this one.
+            return;
+        }
+
+        list_task.reset();
+
+        const proto::FileListRequest& list_request = request.file_list_request();
+        if (list_request.next_part())
+        {
+            file_manager_window_proxy_->onFileListPart(
+                task->target(), reply.error_code(), reply.file_list());
+        }
+        else
+        {
+            file_manager_window_proxy_->onFileList(
+                task->target(), reply.error_code(), reply.file_list());
+        }
+
+        if (reply.error_code() == proto::FILE_ERROR_SUCCESS && reply.file_list().has_more())
+        {
+            list_task = taskFactory(task->target())->fileList(
+                list_request.path(), kFileListPartSize, true);
+            task_consumer_proxy_->doTask(list_task);
+        }
     }
     else if (request.has_create_directory_request())
     {
@@ -143,24 +206,19 @@ void ClientFileTransfer::doTask(std::shared_ptr<common::FileTask> task)
     }
     else
     {
-        const bool schedule = remote_task_queue_.empty();
+        // Zero means no id.
+        if (++last_request_id_ == 0)
+            ++last_request_id_;
 
-        // Add the request to the queue.
-        remote_task_queue_.emplace(std::move(task));
+        task->mutableRequest()->set_request_id(last_request_id_);
 
-        // If the request queue was empty, then run execution.
-        if (schedule)
-            doNextRemoteTask();
-    }
-}
+        // The request is sent without waiting for the replies to the previous ones. The file
+        // transfer keeps several packets on the way to hide the round trip time.
+        sendMessage(task->request());
 
-void ClientFileTransfer::doNextRemoteTask()
-{
-    if (remote_task_queue_.empty())
-        return;
-
-    // Send a request to the remote computer.
-    sendMessage(remote_task_queue_.front()->request());
+        // Add the request to the queue.
+        remote_task_queue_.emplace_back(std::move(task));
+    }
 }
 
 common::FileTaskFactory* ClientFileTransfer::taskFactory(common::FileTask::Target target)
@@ -188,7 +246,10 @@ void ClientFileTransfer::driveList(common::FileTask::Target target)
 
 void ClientFileTransfer::fileList(common::FileTask::Target target, const std::string& path)
 {
-    task_consumer_proxy_->doTask(taskFactory(target)->fileList(path));
+    std::shared_ptr<common::FileTask> task = taskFactory(target)->fileList(path, kFileListPartSize);
+    list_tasks_[target] = task;
+
+    task_consumer_proxy_->doTask(std::move(task));
 }
 
 void ClientFileTransfer::createDirectory(common::FileTask::Target target, const std::string& path)
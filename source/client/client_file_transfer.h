@@ -19,11 +19,15 @@
 #ifndef CLIENT__CLIENT_FILE_TRANSFER_H
 #define CLIENT__CLIENT_FILE_TRANSFER_H
 
+#include "base/threading/thread.h"
 #include "client/client.h"
 #include "client/file_control.h"
 #include "common/file_task_consumer.h"
 #include "common/file_task_producer.h"
 
+#include <deque>
+#include <map>
+
 namespace common {
 class FileTaskConsumerProxy;
 class FileTaskProducerProxy;
@@ -67,8 +71,6 @@ protected:
     void onTaskDone(std::shared_ptr<common::FileTask> task) override;
 
 private:
-    void doNextRemoteTask();
-
     common::FileTaskFactory* taskFactory(common::FileTask::Target target);
 
     // FileControl implementation.
@@ -93,7 +95,20 @@ private:
     std::unique_ptr<common::FileTaskFactory> local_task_factory_;
     std::unique_ptr<common::FileTaskFactory> remote_task_factory_;
 
-    std::queue<std::shared_ptr<common::FileTask>> remote_task_queue_;
+    // Requests sent to the host and waiting for the replies. The host replies to the lists of
+    // files before the earlier requests for the data of the files, the replies are matched by the
+    // id of the request. Older versions reply in the order of the requests and send no id.
+    std::deque<std::shared_ptr<common::FileTask>> remote_task_queue_;
+
+    // The last request for a list of files of each target. A large directory is received in
+    // parts, the parts of an older list are dropped.
+    std::map<common::FileTask::Target, std::shared_ptr<common::FileTask>> list_tasks_;
+    uint32_t last_request_id_ = 0;
+
+    // Local files are read and written on |data_thread_|, the lists of files and other short
+    // requests are executed on |metadata_thread_|.
+    base::Thread data_thread_;
+    base::Thread metadata_thread_;
     std::unique_ptr<common::FileWorker> local_worker_;
 
     std::shared_ptr<FileControlProxy> file_control_proxy_;
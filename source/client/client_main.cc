@@ -74,9 +74,19 @@ bool parseCodecValue(const QString& value, proto::DesktopConfig& config)
         {
             config.set_video_encoding(proto::VIDEO_ENCODING_ZSTD);
         }
+        else if (value == QLatin1String("hybrid"))
+        {
+            config.set_video_encoding(proto::VIDEO_ENCODING_HYBRID);
+        }
+#if defined(OS_WIN)
+        else if (value == QLatin1String("h264"))
+        {
+            config.set_video_encoding(proto::VIDEO_ENCODING_H264);
+        }
+#endif // defined(OS_WIN)
         else
         {
-            onInvalidValue(QStringLiteral("codec"), QStringLiteral("vp8, vp9, zstd"));
+            onInvalidValue(QStringLiteral("codec"), QStringLiteral("vp8, vp9, zstd, hybrid"));
             return false;
         }
     }
@@ -384,7 +394,8 @@ int clientMain(int argc, char* argv[])
         QStringLiteral("desktop-manage"));
 
     QCommandLineOption codec_option(QStringLiteral("codec"),
-        QApplication::translate("Client", "Type of codec. Possible values: vp8, vp9, zstd."),
+        QApplication::translate("Client", "Type of codec. Possible values: vp8, vp9, zstd, "
+                                "hybrid."),
         QStringLiteral("codec"));
 
     QCommandLineOption color_depth_option(QStringLiteral("color-depth"),
@@ -498,7 +509,8 @@ int clientMain(int argc, char* argv[])
             if (!parseCodecValue(parser.value(codec_option), *desktop_config))
                 return 1;
 
-            if (desktop_config->video_encoding() == proto::VIDEO_ENCODING_ZSTD)
+            if (desktop_config->video_encoding() == proto::VIDEO_ENCODING_ZSTD ||
+                desktop_config->video_encoding() == proto::VIDEO_ENCODING_HYBRID)
             {
                 if (!parseColorDepthValue(parser.value(color_depth_option), *desktop_config))
                     return 1;
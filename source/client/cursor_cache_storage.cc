@@ -0,0 +1,101 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/cursor_cache_storage.h"
+
+#include "base/logging.h"
+#include "base/files/base_paths.h"
+#include "base/files/file_util.h"
+#include "base/strings/unicode.h"
+#include "proto/desktop.pb.h"
+
+namespace client {
+
+// static
+bool CursorCacheStorage::load(proto::CursorCache* cursor_cache)
+{
+    std::filesystem::path file_path = filePath();
+    if (file_path.empty())
+        return false;
+
+    std::error_code ignored_code;
+    if (!std::filesystem::exists(file_path, ignored_code))
+    {
+        LOG(LS_INFO) << "No cursor cache file";
+        return false;
+    }
+
+    base::ByteArray buffer;
+    if (!base::readFile(file_path, &buffer))
+    {
+        LOG(LS_WARNING) << "Unable to read file: " << file_path;
+        return false;
+    }
+
+    if (!base::parse(buffer, cursor_cache))
+    {
+        LOG(LS_WARNING) << "Invalid cursor cache file: " << file_path;
+        return false;
+    }
+
+    return true;
+}
+
+// static
+bool CursorCacheStorage::save(const proto::CursorCache& cursor_cache)
+{
+    std::filesystem::path file_path = filePath();
+    if (file_path.empty())
+        return false;
+
+    std::error_code error_code;
+    if (!std::filesystem::create_directories(file_path.parent_path(), error_code))
+    {
+        if (error_code)
+        {
+            LOG(LS_WARNING) << "create_directories failed: "
+                            << base::utf16FromLocal8Bit(error_code.message());
+            return false;
+        }
+    }
+
+    if (!base::writeFile(file_path, base::serialize(cursor_cache)))
+    {
+        LOG(LS_WARNING) << "Unable to write file: " << file_path;
+        return false;
+    }
+
+    return true;
+}
+
+// static
+std::filesystem::path CursorCacheStorage::filePath()
+{
+    std::filesystem::path file_path;
+    if (!base::BasePaths::userAppData(&file_path))
+    {
+        LOG(LS_WARNING) << "Unable to get user app data directory";
+        return std::filesystem::path();
+    }
+
+    file_path.append("aspia");
+    file_path.append("cursor_cache.bin");
+    return file_path;
+}
+
+} // namespace client
@@ -0,0 +1,47 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT__CURSOR_CACHE_STORAGE_H
+#define CLIENT__CURSOR_CACHE_STORAGE_H
+
+#include "base/macros_magic.h"
+
+#include <filesystem>
+
+namespace proto {
+class CursorCache;
+} // namespace proto
+
+namespace client {
+
+// Keeps the cursors received from the hosts between sessions.
+class CursorCacheStorage
+{
+public:
+    static bool load(proto::CursorCache* cursor_cache);
+    static bool save(const proto::CursorCache& cursor_cache);
+
+private:
+    static std::filesystem::path filePath();
+
+    DISALLOW_COPY_AND_ASSIGN(CursorCacheStorage);
+};
+
+} // namespace client
+
+#endif // CLIENT__CURSOR_CACHE_STORAGE_H
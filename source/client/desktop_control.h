@@ -35,8 +35,13 @@ public:
     virtual void setDesktopConfig(const proto::DesktopConfig& desktop_config) = 0;
     virtual void setCurrentScreen(const proto::Screen& screen) = 0;
     virtual void setPreferredSize(int width, int height) = 0;
+    virtual void setViewport(const proto::Viewport& viewport) = 0;
     virtual void setVideoRecording(bool enable, const std::filesystem::path& file_path) = 0;
 
+    // The window of the session is the active one. Its video packets are decoded before the
+    // packets of the other sessions.
+    virtual void setActive(bool active) = 0;
+
     virtual void onKeyEvent(const proto::KeyEvent& event) = 0;
     virtual void onTextEvent(const proto::TextEvent& event) = 0;
     virtual void onMouseEvent(const proto::MouseEvent& event) = 0;
@@ -86,6 +86,32 @@ void DesktopControlProxy::setPreferredSize(int width, int height)
         desktop_control_->setPreferredSize(width, height);
 }
 
+void DesktopControlProxy::setViewport(const proto::Viewport& viewport)
+{
+    if (!io_task_runner_->belongsToCurrentThread())
+    {
+        io_task_runner_->postTask(
+            std::bind(&DesktopControlProxy::setViewport, shared_from_this(), viewport));
+        return;
+    }
+
+    if (desktop_control_)
+        desktop_control_->setViewport(viewport);
+}
+
+void DesktopControlProxy::setActive(bool active)
+{
+    if (!io_task_runner_->belongsToCurrentThread())
+    {
+        io_task_runner_->postTask(
+            std::bind(&DesktopControlProxy::setActive, shared_from_this(), active));
+        return;
+    }
+
+    if (desktop_control_)
+        desktop_control_->setActive(active);
+}
+
 void DesktopControlProxy::onKeyEvent(const proto::KeyEvent& event)
 {
     if (!io_task_runner_->belongsToCurrentThread())
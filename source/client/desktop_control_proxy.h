@@ -44,6 +44,8 @@ public:
     void setDesktopConfig(const proto::DesktopConfig& desktop_config);
     void setCurrentScreen(const proto::Screen& screen);
     void setPreferredSize(int width, int height);
+    void setViewport(const proto::Viewport& viewport);
+    void setActive(bool active);
     void onKeyEvent(const proto::KeyEvent& event);
     void onTextEvent(const proto::TextEvent& event);
     void onMouseEvent(const proto::MouseEvent& event);
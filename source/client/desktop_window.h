@@ -26,6 +26,7 @@
 namespace base {
 class Frame;
 class MouseCursor;
+class Region;
 class Size;
 class Version;
 } // namespace base
@@ -79,6 +80,33 @@ public:
         int cursor_pos_count = 0;
         int cursor_cached = 0;
         int cursor_taken_from_cache = 0;
+
+        // Average latency of the video frames by stages. The capture, the queue and the encoding
+        // are measured by the host (the capture includes the comparison of images). The network
+        // delay is estimated as a half of the round trip time of the keep-alive pings.
+        std::chrono::microseconds capture_time { 0 };
+        std::chrono::microseconds diff_time { 0 };
+        std::chrono::microseconds queue_time { 0 };
+        std::chrono::microseconds encode_time { 0 };
+        std::chrono::microseconds network_time { 0 };
+        std::chrono::microseconds decode_time { 0 };
+        std::chrono::microseconds paint_time { 0 };
+
+        // Average delay of the input events on the host, from their receipt to the injection.
+        std::chrono::microseconds input_delay { 0 };
+
+        std::chrono::milliseconds round_trip_time { 0 };
+
+        // Number of outgoing messages waiting to be sent.
+        size_t pending_messages = 0;
+
+        // Frames that could not be decoded or were replaced by the next frame before painting.
+        int64_t dropped_frames = 0;
+
+        // Load of the video encoders of the host in percent and the level at which the host
+        // throttles the video stream because of it (see host/resource_governor.h).
+        int host_load = 0;
+        int throttle_level = 0;
     };
 
     virtual void showWindow(std::shared_ptr<DesktopControlProxy> desktop_control_proxy,
@@ -95,7 +123,9 @@ public:
     virtual std::unique_ptr<FrameFactory> frameFactory() = 0;
     virtual void setFrame(const base::Size& screen_size,
                           std::shared_ptr<base::Frame> frame) = 0;
-    virtual void drawFrame() = 0;
+    // Repaints the window. |dirty_region| contains the areas of the frame changed since the
+    // previous call.
+    virtual void drawFrame(const base::Region& dirty_region) = 0;
     virtual void setMouseCursor(std::shared_ptr<base::MouseCursor> mouse_cursor) = 0;
 };
 
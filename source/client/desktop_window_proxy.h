@@ -54,7 +54,7 @@ public:
 
     std::shared_ptr<base::Frame> allocateFrame(const base::Size& size);
     void setFrame(const base::Size& screen_size, std::shared_ptr<base::Frame> frame);
-    void drawFrame();
+    void drawFrame(const base::Region& dirty_region);
     void setMouseCursor(std::shared_ptr<base::MouseCursor> mouse_cursor);
 
 private:
@@ -0,0 +1,259 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/file_distribution_cache.h"
+
+#include "base/logging.h"
+#include "base/scoped_task_runner.h"
+#include "base/task_runner.h"
+#include "base/crypto/generic_hash.h"
+#include "base/files/sequential_file_reader.h"
+
+#include <algorithm>
+
+namespace client {
+
+namespace {
+
+// The first reading of the file is this far ahead of the fastest host.
+const size_t kReadAheadChunks = 8;
+
+// Limits the memory used for the chunks. The hosts far behind the others read the chunks again.
+const size_t kMaxCachedChunks = 64;
+
+} // namespace
+
+FileDistributionCache::FileDistributionCache(std::shared_ptr<base::TaskRunner> io_task_runner,
+                                             std::unique_ptr<base::SequentialFileReader> reader)
+    : file_size_(reader->size()),
+      chunk_count_(static_cast<size_t>((reader->size() + kChunkSize - 1) / kChunkSize)),
+      chunk_hashes_(chunk_count_),
+      scoped_task_runner_(std::make_unique<base::ScopedTaskRunner>(std::move(io_task_runner))),
+      reader_(std::move(reader)),
+      digest_hash_(std::make_unique<base::GenericHash>(base::GenericHash::BLAKE2b512))
+{
+    LOG(LS_INFO) << "Ctor (size: " << file_size_ << " chunks: " << chunk_count_ << ")";
+
+    read_thread_.start(base::MessageLoop::Type::DEFAULT);
+    read_task_runner_ = read_thread_.taskRunner();
+
+    // An empty file has no chunks, its digest is known at once.
+    if (!chunk_count_)
+        digest_ = base::toStdString(digest_hash_->result());
+}
+
+FileDistributionCache::~FileDistributionCache()
+{
+    LOG(LS_INFO) << "Dtor";
+
+    // The chunks read after this are no longer delivered.
+    read_thread_.stop();
+}
+
+// static
+std::unique_ptr<FileDistributionCache> FileDistributionCache::open(
+    std::shared_ptr<base::TaskRunner> io_task_runner, const std::filesystem::path& file_path)
+{
+    std::unique_ptr<base::SequentialFileReader> reader =
+        base::SequentialFileReader::open(file_path);
+    if (!reader)
+    {
+        LOG(LS_WARNING) << "Unable to open file: " << file_path;
+        return nullptr;
+    }
+
+    return std::unique_ptr<FileDistributionCache>(
+        new FileDistributionCache(std::move(io_task_runner), std::move(reader)));
+}
+
+size_t FileDistributionCache::addReader()
+{
+    const size_t reader_id = next_reader_id_++;
+    readers_.emplace(reader_id, Reader());
+    return reader_id;
+}
+
+void FileDistributionCache::removeReader(size_t reader_id)
+{
+    readers_.erase(reader_id);
+    dropChunks();
+}
+
+void FileDistributionCache::readChunk(size_t reader_id, size_t index, ChunkCallback callback)
+{
+    DCHECK_LT(index, chunk_count_);
+
+    auto reader = readers_.find(reader_id);
+    if (reader == readers_.end())
+    {
+        NOTREACHED();
+        return;
+    }
+
+    reader->second.position = index;
+    reader->second.callback = std::move(callback);
+
+    auto chunk = chunks_.find(index);
+    if (chunk != chunks_.end())
+    {
+        scoped_task_runner_->postTask(
+            std::bind(&FileDistributionCache::deliverChunk, this, reader_id, index, chunk->second));
+    }
+    else
+    {
+        requestChunk(index);
+    }
+
+    // The first reading goes ahead of the fastest reader. The chunks are requested in order, so
+    // the digest of the file is calculated on the way.
+    const size_t read_ahead_end = std::min(index + kReadAheadChunks + 1, chunk_count_);
+    while (next_chunk_ < read_ahead_end)
+        requestChunk(next_chunk_);
+
+    dropChunks();
+}
+
+void FileDistributionCache::requestChunk(size_t index)
+{
+    if (index == next_chunk_)
+    {
+        ++next_chunk_;
+    }
+    else if (index > next_chunk_)
+    {
+        // The chunks before it are needed for the digest.
+        while (next_chunk_ < index)
+            requestChunk(next_chunk_);
+        ++next_chunk_;
+    }
+    else if (reading_.count(index))
+    {
+        return;
+    }
+
+    reading_.insert(index);
+    read_task_runner_->postTask(
+        std::bind(&FileDistributionCache::readChunkOnThread, this, index));
+}
+
+void FileDistributionCache::onChunkRead(
+    size_t index, Chunk chunk, const std::string& hash, const std::string& digest)
+{
+    reading_.erase(index);
+
+    if (chunk)
+    {
+        chunks_[index] = chunk;
+        chunk_hashes_[index] = hash;
+
+        if (!digest.empty())
+            digest_ = digest;
+    }
+
+    // The callbacks can request the next chunks.
+    std::vector<size_t> waiting_readers;
+    for (const auto& reader : readers_)
+        waiting_readers.emplace_back(reader.first);
+
+    for (size_t reader_id : waiting_readers)
+        deliverChunk(reader_id, index, chunk);
+
+    dropChunks();
+}
+
+void FileDistributionCache::deliverChunk(size_t reader_id, size_t index, Chunk chunk)
+{
+    // The reader may have been removed or may already wait for another chunk.
+    auto reader = readers_.find(reader_id);
+    if (reader == readers_.end() || !reader->second.callback || reader->second.position != index)
+        return;
+
+    ChunkCallback callback = std::move(reader->second.callback);
+    reader->second.callback = nullptr;
+
+    callback(std::move(chunk));
+}
+
+void FileDistributionCache::dropChunks()
+{
+    size_t lowest_position = next_chunk_;
+    for (const auto& reader : readers_)
+        lowest_position = std::min(lowest_position, reader.second.position);
+
+    // Nobody goes back to the chunks behind all readers.
+    chunks_.erase(chunks_.begin(), chunks_.lower_bound(lowest_position));
+
+    // The readers far behind the others read the chunks again.
+    while (chunks_.size() > kMaxCachedChunks)
+        chunks_.erase(chunks_.begin());
+}
+
+void FileDistributionCache::readChunkOnThread(size_t index)
+{
+    const uint64_t offset = static_cast<uint64_t>(index) * kChunkSize;
+    const size_t size = static_cast<size_t>(
+        std::min(file_size_ - offset, static_cast<uint64_t>(kChunkSize)));
+
+    Chunk chunk;
+    std::string hash;
+    std::string digest;
+
+    if (index != read_chunk_ && !reader_->seek(offset))
+    {
+        LOG(LS_WARNING) << "Unable to seek file to chunk " << index;
+        read_chunk_ = chunk_count_;
+    }
+    else
+    {
+        std::string buffer;
+        buffer.resize(size);
+
+        const bool has_next = index + 1 < chunk_count_;
+
+        if (!reader_->read(buffer.data(), size, has_next ? kChunkSize : 0))
+        {
+            LOG(LS_WARNING) << "Unable to read chunk " << index;
+
+            // The position is unknown after an error.
+            read_chunk_ = chunk_count_;
+        }
+        else
+        {
+            read_chunk_ = index + 1;
+
+            hash = base::toStdString(
+                base::GenericHash::hash(base::GenericHash::SHA256, buffer.data(), size));
+
+            // The chunks of the first reading come in order.
+            if (index == digest_chunk_)
+            {
+                digest_hash_->addData(buffer.data(), size);
+                if (++digest_chunk_ == chunk_count_)
+                    digest = base::toStdString(digest_hash_->result());
+            }
+
+            chunk = std::make_shared<const std::string>(std::move(buffer));
+        }
+    }
+
+    scoped_task_runner_->postTask(std::bind(&FileDistributionCache::onChunkRead, this,
+                                            index, std::move(chunk), std::move(hash),
+                                            std::move(digest)));
+}
+
+} // namespace client
@@ -0,0 +1,132 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT__FILE_DISTRIBUTION_CACHE_H
+#define CLIENT__FILE_DISTRIBUTION_CACHE_H
+
+#include "base/macros_magic.h"
+#include "base/threading/thread.h"
+#include "common/file_packet.h"
+
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace base {
+class GenericHash;
+class ScopedTaskRunner;
+class SequentialFileReader;
+class TaskRunner;
+} // namespace base
+
+namespace client {
+
+// Reads the source file of a distribution once for all hosts. The file is read in chunks on its
+// own thread ahead of the fastest host and the chunks are kept while the other hosts still need
+// them. A chunk dropped before a slow host has taken it is read again for that host. The hashes
+// of the chunks and the digest of the whole file are calculated on the first reading, so the hosts
+// do not calculate them each.
+class FileDistributionCache
+{
+public:
+    // The chunks match the blocks that the hosts compare when a transfer is resumed.
+    static constexpr size_t kChunkSize = common::kFileBlockSize;
+
+    using Chunk = std::shared_ptr<const std::string>;
+    using ChunkCallback = std::function<void(Chunk chunk)>;
+
+    ~FileDistributionCache();
+
+    // Returns nullptr if the file can not be opened. The chunks are delivered on |io_task_runner|.
+    static std::unique_ptr<FileDistributionCache> open(
+        std::shared_ptr<base::TaskRunner> io_task_runner, const std::filesystem::path& file_path);
+
+    uint64_t fileSize() const { return file_size_; }
+    size_t chunkCount() const { return chunk_count_; }
+
+    // A reader takes the chunks in order, one at a time. The chunks behind all readers are
+    // dropped first. The callback of a removed reader is not called.
+    size_t addReader();
+    void removeReader(size_t reader_id);
+
+    // Calls |callback| with the chunk or with nullptr if it could not be read. The callback is
+    // called later, never from inside the call.
+    void readChunk(size_t reader_id, size_t index, ChunkCallback callback);
+
+    // SHA-256 hash of the chunk (see proto::FileBlockHashes). Available when the chunk has been
+    // delivered.
+    const std::string& chunkHash(size_t index) const { return chunk_hashes_[index]; }
+
+    // BLAKE2b-512 digest of the whole file (see proto::FilePacket). Available when the last chunk
+    // has been delivered.
+    const std::string& digest() const { return digest_; }
+
+private:
+    FileDistributionCache(std::shared_ptr<base::TaskRunner> io_task_runner,
+                          std::unique_ptr<base::SequentialFileReader> reader);
+
+    void requestChunk(size_t index);
+    void onChunkRead(size_t index, Chunk chunk, const std::string& hash,
+                     const std::string& digest);
+    void deliverChunk(size_t reader_id, size_t index, Chunk chunk);
+    void dropChunks();
+
+    // Called on the read thread.
+    void readChunkOnThread(size_t index);
+
+    const uint64_t file_size_;
+    const size_t chunk_count_;
+
+    std::map<size_t, Chunk> chunks_;
+    std::vector<std::string> chunk_hashes_;
+    std::string digest_;
+
+    // The next chunk of the first reading of the file. The chunks before it are read again if
+    // they have been dropped.
+    size_t next_chunk_ = 0;
+    std::set<size_t> reading_;
+
+    struct Reader
+    {
+        // The last chunk requested by the reader.
+        size_t position = 0;
+        ChunkCallback callback;
+    };
+
+    std::map<size_t, Reader> readers_;
+    size_t next_reader_id_ = 0;
+
+    // The read thread owns |reader_| and |digest_hash_|.
+    std::unique_ptr<base::ScopedTaskRunner> scoped_task_runner_;
+    base::Thread read_thread_;
+    std::shared_ptr<base::TaskRunner> read_task_runner_;
+    std::unique_ptr<base::SequentialFileReader> reader_;
+    std::unique_ptr<base::GenericHash> digest_hash_;
+    size_t digest_chunk_ = 0;
+    size_t read_chunk_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(FileDistributionCache);
+};
+
+} // namespace client
+
+#endif // CLIENT__FILE_DISTRIBUTION_CACHE_H
@@ -0,0 +1,42 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT__FILE_DISTRIBUTION_WINDOW_H
+#define CLIENT__FILE_DISTRIBUTION_WINDOW_H
+
+#include "client/file_distributor.h"
+
+namespace client {
+
+class FileDistributionWindow
+{
+public:
+    virtual ~FileDistributionWindow() = default;
+
+    virtual void onHostStarted(size_t host_index, int attempt) = 0;
+    virtual void onHostProgress(size_t host_index, int percentage) = 0;
+    virtual void onHostFinished(size_t host_index, const FileDistributor::HostError& error) = 0;
+    virtual void onTotalProgress(int percentage) = 0;
+
+    // Called when all the hosts are finished or when the source file can not be opened.
+    virtual void onFinished(proto::FileError error_code) = 0;
+};
+
+} // namespace client
+
+#endif // CLIENT__FILE_DISTRIBUTION_WINDOW_H
@@ -0,0 +1,117 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/file_distribution_window_proxy.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "client/file_distribution_window.h"
+
+namespace client {
+
+FileDistributionWindowProxy::FileDistributionWindowProxy(
+    std::shared_ptr<base::TaskRunner> ui_task_runner, FileDistributionWindow* distribution_window)
+    : ui_task_runner_(std::move(ui_task_runner)),
+      distribution_window_(distribution_window)
+{
+    LOG(LS_INFO) << "Ctor";
+    DCHECK(ui_task_runner_);
+    DCHECK(ui_task_runner_->belongsToCurrentThread());
+    DCHECK(distribution_window_);
+}
+
+FileDistributionWindowProxy::~FileDistributionWindowProxy()
+{
+    LOG(LS_INFO) << "Dtor";
+    DCHECK(!distribution_window_);
+}
+
+void FileDistributionWindowProxy::dettach()
+{
+    LOG(LS_INFO) << "Dettach file distribution window";
+    DCHECK(ui_task_runner_->belongsToCurrentThread());
+    distribution_window_ = nullptr;
+}
+
+void FileDistributionWindowProxy::onHostStarted(size_t host_index, int attempt)
+{
+    if (!ui_task_runner_->belongsToCurrentThread())
+    {
+        ui_task_runner_->postTask(std::bind(
+            &FileDistributionWindowProxy::onHostStarted, shared_from_this(), host_index, attempt));
+        return;
+    }
+
+    if (distribution_window_)
+        distribution_window_->onHostStarted(host_index, attempt);
+}
+
+void FileDistributionWindowProxy::onHostProgress(size_t host_index, int percentage)
+{
+    if (!ui_task_runner_->belongsToCurrentThread())
+    {
+        ui_task_runner_->postTask(std::bind(&FileDistributionWindowProxy::onHostProgress,
+                                            shared_from_this(), host_index, percentage));
+        return;
+    }
+
+    if (distribution_window_)
+        distribution_window_->onHostProgress(host_index, percentage);
+}
+
+void FileDistributionWindowProxy::onHostFinished(
+    size_t host_index, const FileDistributor::HostError& error)
+{
+    if (!ui_task_runner_->belongsToCurrentThread())
+    {
+        ui_task_runner_->postTask(std::bind(
+            &FileDistributionWindowProxy::onHostFinished, shared_from_this(), host_index, error));
+        return;
+    }
+
+    if (distribution_window_)
+        distribution_window_->onHostFinished(host_index, error);
+}
+
+void FileDistributionWindowProxy::onTotalProgress(int percentage)
+{
+    if (!ui_task_runner_->belongsToCurrentThread())
+    {
+        ui_task_runner_->postTask(std::bind(
+            &FileDistributionWindowProxy::onTotalProgress, shared_from_this(), percentage));
+        return;
+    }
+
+    if (distribution_window_)
+        distribution_window_->onTotalProgress(percentage);
+}
+
+void FileDistributionWindowProxy::onFinished(proto::FileError error_code)
+{
+    if (!ui_task_runner_->belongsToCurrentThread())
+    {
+        ui_task_runner_->postTask(
+            std::bind(&FileDistributionWindowProxy::onFinished, shared_from_this(), error_code));
+        return;
+    }
+
+    if (distribution_window_)
+        distribution_window_->onFinished(error_code);
+}
+
+} // namespace client
@@ -0,0 +1,60 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT__FILE_DISTRIBUTION_WINDOW_PROXY_H
+#define CLIENT__FILE_DISTRIBUTION_WINDOW_PROXY_H
+
+#include "base/macros_magic.h"
+#include "client/file_distributor.h"
+
+#include <memory>
+
+namespace base {
+class TaskRunner;
+} // namespace base
+
+namespace client {
+
+class FileDistributionWindow;
+
+class FileDistributionWindowProxy
+    : public std::enable_shared_from_this<FileDistributionWindowProxy>
+{
+public:
+    FileDistributionWindowProxy(std::shared_ptr<base::TaskRunner> ui_task_runner,
+                                FileDistributionWindow* distribution_window);
+    ~FileDistributionWindowProxy();
+
+    void dettach();
+
+    void onHostStarted(size_t host_index, int attempt);
+    void onHostProgress(size_t host_index, int percentage);
+    void onHostFinished(size_t host_index, const FileDistributor::HostError& error);
+    void onTotalProgress(int percentage);
+    void onFinished(proto::FileError error_code);
+
+private:
+    std::shared_ptr<base::TaskRunner> ui_task_runner_;
+    FileDistributionWindow* distribution_window_;
+
+    DISALLOW_COPY_AND_ASSIGN(FileDistributionWindowProxy);
+};
+
+} // namespace client
+
+#endif // CLIENT__FILE_DISTRIBUTION_WINDOW_PROXY_H
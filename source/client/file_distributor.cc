@@ -0,0 +1,319 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/file_distributor.h"
+
+#include "base/logging.h"
+#include "base/scoped_task_runner.h"
+#include "base/task_runner.h"
+#include "client/file_distribution_cache.h"
+#include "client/file_distribution_window_proxy.h"
+#include "client/status_window.h"
+#include "client/status_window_proxy.h"
+
+#include <algorithm>
+#include <filesystem>
+
+namespace client {
+
+// Receives the connection errors of one host.
+class FileDistributor::HostStatusWindow : public StatusWindow
+{
+public:
+    HostStatusWindow(FileDistributor* distributor, size_t host_index)
+        : distributor_(distributor),
+          host_index_(host_index)
+    {
+        // Nothing
+    }
+
+    // StatusWindow implementation.
+    void onStarted(const std::u16string& /* address_or_id */) override
+    {
+        // Nothing
+    }
+
+    void onStopped() override
+    {
+        // Nothing
+    }
+
+    void onConnected() override
+    {
+        // Nothing
+    }
+
+    void onDisconnected(base::NetworkChannel::ErrorCode error_code) override
+    {
+        onError(HostError::Type::NETWORK, static_cast<int>(error_code), true);
+    }
+
+    void onAccessDenied(base::ClientAuthenticator::ErrorCode error_code) override
+    {
+        onError(HostError::Type::ACCESS_DENIED, static_cast<int>(error_code), false);
+    }
+
+    void onRouterError(const RouterController::Error& error) override
+    {
+        onError(HostError::Type::ROUTER, static_cast<int>(error.type), true);
+    }
+
+private:
+    void onError(HostError::Type type, int code, bool can_retry)
+    {
+        HostError error;
+        error.type = type;
+        error.code = code;
+
+        distributor_->onHostError(host_index_, error, can_retry);
+    }
+
+    FileDistributor* distributor_;
+    const size_t host_index_;
+
+    DISALLOW_COPY_AND_ASSIGN(HostStatusWindow);
+};
+
+FileDistributor::FileDistributor(
+    std::shared_ptr<base::TaskRunner> io_task_runner,
+    std::shared_ptr<FileDistributionWindowProxy> distribution_window_proxy)
+    : io_task_runner_(std::move(io_task_runner)),
+      distribution_window_proxy_(std::move(distribution_window_proxy)),
+      scoped_task_runner_(std::make_unique<base::ScopedTaskRunner>(io_task_runner_))
+{
+    LOG(LS_INFO) << "Ctor";
+    DCHECK(io_task_runner_ && distribution_window_proxy_);
+}
+
+FileDistributor::~FileDistributor()
+{
+    LOG(LS_INFO) << "Dtor";
+    stop();
+}
+
+void FileDistributor::start(const std::string& source_path, const std::vector<Config>& hosts,
+                            const Options& options)
+{
+    DCHECK(io_task_runner_->belongsToCurrentThread());
+    DCHECK(!cache_);
+
+    LOG(LS_INFO) << "Distributing file " << source_path << " to " << hosts.size() << " hosts";
+
+    const std::filesystem::path file_path = std::filesystem::u8path(source_path);
+
+    cache_ = FileDistributionCache::open(io_task_runner_, file_path);
+    if (!cache_)
+    {
+        distribution_window_proxy_->onFinished(proto::FILE_ERROR_FILE_OPEN_ERROR);
+        return;
+    }
+
+    options_ = options;
+    options_.max_parallel = std::max(options_.max_parallel, size_t(1));
+    file_name_ = file_path.filename().u8string();
+
+    hosts_.resize(hosts.size());
+    for (size_t i = 0; i < hosts.size(); ++i)
+    {
+        hosts_[i].config = hosts[i];
+        hosts_[i].config.session_type = proto::SESSION_TYPE_FILE_TRANSFER;
+        hosts_[i].status_window = std::make_unique<HostStatusWindow>(this, i);
+
+        queue_.emplace_back(i);
+    }
+
+    if (hosts_.empty())
+    {
+        distribution_window_proxy_->onFinished(proto::FILE_ERROR_SUCCESS);
+        return;
+    }
+
+    startNextHosts();
+}
+
+void FileDistributor::stop()
+{
+    DCHECK(io_task_runner_->belongsToCurrentThread());
+
+    queue_.clear();
+
+    for (size_t i = 0; i < hosts_.size(); ++i)
+    {
+        if (hosts_[i].session)
+            endSession(i);
+    }
+
+    finished_sessions_.clear();
+}
+
+void FileDistributor::onDistributionProgress(size_t host_index, uint64_t transferred_size)
+{
+    Host& host = hosts_[host_index];
+
+    host.upload_started = true;
+
+    total_transferred_size_ += transferred_size - host.transferred_size;
+    host.transferred_size = transferred_size;
+
+    const uint64_t file_size = cache_->fileSize();
+    const int percentage = file_size ? static_cast<int>(transferred_size * 100 / file_size) : 100;
+
+    if (percentage != host.percentage)
+    {
+        host.percentage = percentage;
+        distribution_window_proxy_->onHostProgress(host_index, percentage);
+    }
+
+    updateTotalProgress();
+}
+
+void FileDistributor::onDistributionFinished(size_t host_index, proto::FileError error_code)
+{
+    if (error_code == proto::FILE_ERROR_SUCCESS)
+    {
+        LOG(LS_INFO) << "File distributed to host " << host_index;
+
+        endSession(host_index);
+        ++finished_count_;
+
+        distribution_window_proxy_->onHostFinished(host_index, HostError());
+        updateTotalProgress();
+        startNextHosts();
+        return;
+    }
+
+    HostError error;
+    error.type = HostError::Type::FILE;
+    error.code = error_code;
+
+    // The data is checked on the host, a damaged transfer is sent again.
+    onHostError(host_index, error, error_code == proto::FILE_ERROR_CHECKSUM_MISMATCH);
+}
+
+void FileDistributor::startNextHosts()
+{
+    while (active_count_ < options_.max_parallel && !queue_.empty())
+    {
+        const size_t host_index = queue_.front();
+        queue_.pop_front();
+
+        startHost(host_index);
+    }
+
+    if (finished_count_ == hosts_.size())
+    {
+        LOG(LS_INFO) << "File distribution finished";
+        distribution_window_proxy_->onFinished(proto::FILE_ERROR_SUCCESS);
+    }
+}
+
+void FileDistributor::startHost(size_t host_index)
+{
+    Host& host = hosts_[host_index];
+    ++host.attempts;
+    ++active_count_;
+
+    LOG(LS_INFO) << "Starting host " << host_index << " (attempt: " << host.attempts << ")";
+
+    // The previous attempt starts again from the beginning.
+    total_transferred_size_ -= host.transferred_size;
+    host.transferred_size = 0;
+    host.percentage = 0;
+
+    host.session = std::make_unique<ClientFileDistribution>(
+        io_task_runner_, cache_.get(), this, host_index, options_.target_dir, file_name_,
+        options_.overwrite, host.upload_started);
+
+    host.status_window_proxy =
+        std::make_shared<StatusWindowProxy>(io_task_runner_, host.status_window.get());
+    host.session->setStatusWindow(host.status_window_proxy);
+
+    distribution_window_proxy_->onHostStarted(host_index, host.attempts);
+    host.session->start(host.config);
+}
+
+void FileDistributor::onHostError(size_t host_index, const HostError& error, bool can_retry)
+{
+    Host& host = hosts_[host_index];
+    if (!host.session)
+        return;
+
+    LOG(LS_INFO) << "Error on host " << host_index << " (type: " << static_cast<int>(error.type)
+                 << " code: " << error.code << ")";
+
+    endSession(host_index);
+
+    if (can_retry && host.attempts < options_.max_attempts)
+    {
+        // The other hosts go first, the host may be back when its turn comes.
+        queue_.emplace_back(host_index);
+    }
+    else
+    {
+        ++finished_count_;
+
+        // The total progress counts the failed host as done.
+        total_transferred_size_ += cache_->fileSize() - host.transferred_size;
+        host.transferred_size = cache_->fileSize();
+
+        distribution_window_proxy_->onHostFinished(host_index, error);
+        updateTotalProgress();
+    }
+
+    startNextHosts();
+}
+
+void FileDistributor::endSession(size_t host_index)
+{
+    Host& host = hosts_[host_index];
+    DCHECK(host.session);
+
+    // The status notifications of the stopped session are not needed.
+    host.status_window_proxy->dettach();
+    host.status_window_proxy.reset();
+
+    finished_sessions_.emplace_back(std::move(host.session));
+    --active_count_;
+
+    if (finished_sessions_.size() == 1)
+    {
+        scoped_task_runner_->postTask([this]()
+        {
+            finished_sessions_.clear();
+        });
+    }
+}
+
+void FileDistributor::updateTotalProgress()
+{
+    const uint64_t total_size = cache_->fileSize() * hosts_.size();
+    int percentage;
+
+    if (total_size)
+        percentage = static_cast<int>(total_transferred_size_ * 100 / total_size);
+    else
+        percentage = static_cast<int>(finished_count_ * 100 / hosts_.size());
+
+    if (percentage != total_percentage_)
+    {
+        total_percentage_ = percentage;
+        distribution_window_proxy_->onTotalProgress(percentage);
+    }
+}
+
+} // namespace client
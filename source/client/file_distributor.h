@@ -0,0 +1,128 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT__FILE_DISTRIBUTOR_H
+#define CLIENT__FILE_DISTRIBUTOR_H
+
+#include "client/client_config.h"
+#include "client/client_file_distribution.h"
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace base {
+class ScopedTaskRunner;
+class TaskRunner;
+} // namespace base
+
+namespace client {
+
+class FileDistributionCache;
+class FileDistributionWindowProxy;
+class StatusWindowProxy;
+
+// Uploads one file to many hosts. The file is read once for all the hosts, a limited number of
+// hosts receive it at the same time. A host that lost the connection is tried again later, the
+// next attempt resumes the file.
+class FileDistributor : public ClientFileDistribution::Delegate
+{
+public:
+    struct Options
+    {
+        std::string target_dir;
+        size_t max_parallel = 8;
+        int max_attempts = 3;
+        bool overwrite = false;
+    };
+
+    struct HostError
+    {
+        enum class Type { NONE, NETWORK, ACCESS_DENIED, ROUTER, FILE };
+
+        Type type = Type::NONE;
+
+        // base::NetworkChannel::ErrorCode, base::ClientAuthenticator::ErrorCode,
+        // RouterController::ErrorType or proto::FileError depending on the type.
+        int code = 0;
+    };
+
+    FileDistributor(std::shared_ptr<base::TaskRunner> io_task_runner,
+                    std::shared_ptr<FileDistributionWindowProxy> distribution_window_proxy);
+    ~FileDistributor();
+
+    void start(const std::string& source_path, const std::vector<Config>& hosts,
+               const Options& options);
+    void stop();
+
+protected:
+    // ClientFileDistribution::Delegate implementation.
+    void onDistributionProgress(size_t host_index, uint64_t transferred_size) override;
+    void onDistributionFinished(size_t host_index, proto::FileError error_code) override;
+
+private:
+    class HostStatusWindow;
+
+    void startNextHosts();
+    void startHost(size_t host_index);
+    void onHostError(size_t host_index, const HostError& error, bool can_retry);
+    void endSession(size_t host_index);
+    void updateTotalProgress();
+
+    std::shared_ptr<base::TaskRunner> io_task_runner_;
+    std::shared_ptr<FileDistributionWindowProxy> distribution_window_proxy_;
+
+    Options options_;
+    std::string file_name_;
+    std::unique_ptr<FileDistributionCache> cache_;
+
+    struct Host
+    {
+        Config config;
+        std::unique_ptr<HostStatusWindow> status_window;
+        std::shared_ptr<StatusWindowProxy> status_window_proxy;
+        std::unique_ptr<ClientFileDistribution> session;
+        int attempts = 0;
+
+        // The file has been created on the host, the next attempt resumes it.
+        bool upload_started = false;
+
+        uint64_t transferred_size = 0;
+        int percentage = 0;
+    };
+
+    std::vector<Host> hosts_;
+    std::deque<size_t> queue_;
+    size_t active_count_ = 0;
+    size_t finished_count_ = 0;
+
+    uint64_t total_transferred_size_ = 0;
+    int total_percentage_ = 0;
+
+    // The sessions can not be deleted from their own notifications. They are deleted later but
+    // before |cache_|.
+    std::vector<std::unique_ptr<ClientFileDistribution>> finished_sessions_;
+    std::unique_ptr<base::ScopedTaskRunner> scoped_task_runner_;
+
+    DISALLOW_COPY_AND_ASSIGN(FileDistributor);
+};
+
+} // namespace client
+
+#endif // CLIENT__FILE_DISTRIBUTOR_H
@@ -0,0 +1,111 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/file_distributor_proxy.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+
+namespace client {
+
+class FileDistributorProxy::Impl : public std::enable_shared_from_this<Impl>
+{
+public:
+    Impl(std::shared_ptr<base::TaskRunner> io_task_runner,
+         std::unique_ptr<FileDistributor> distributor);
+    ~Impl();
+
+    void start(const std::string& source_path, const std::vector<Config>& hosts,
+               const FileDistributor::Options& options);
+    void stop();
+
+private:
+    std::shared_ptr<base::TaskRunner> io_task_runner_;
+    std::unique_ptr<FileDistributor> distributor_;
+
+    DISALLOW_COPY_AND_ASSIGN(Impl);
+};
+
+FileDistributorProxy::Impl::Impl(std::shared_ptr<base::TaskRunner> io_task_runner,
+                                 std::unique_ptr<FileDistributor> distributor)
+    : io_task_runner_(std::move(io_task_runner)),
+      distributor_(std::move(distributor))
+{
+    DCHECK(io_task_runner_ && distributor_);
+}
+
+FileDistributorProxy::Impl::~Impl()
+{
+    DCHECK(!distributor_);
+}
+
+void FileDistributorProxy::Impl::start(const std::string& source_path,
+                                       const std::vector<Config>& hosts,
+                                       const FileDistributor::Options& options)
+{
+    if (!io_task_runner_->belongsToCurrentThread())
+    {
+        io_task_runner_->postTask(
+            std::bind(&Impl::start, shared_from_this(), source_path, hosts, options));
+        return;
+    }
+
+    if (distributor_)
+        distributor_->start(source_path, hosts, options);
+}
+
+void FileDistributorProxy::Impl::stop()
+{
+    if (!io_task_runner_->belongsToCurrentThread())
+    {
+        io_task_runner_->postTask(std::bind(&Impl::stop, shared_from_this()));
+        return;
+    }
+
+    if (distributor_)
+    {
+        distributor_->stop();
+        distributor_.reset();
+    }
+}
+
+FileDistributorProxy::FileDistributorProxy(std::shared_ptr<base::TaskRunner> io_task_runner,
+                                           std::unique_ptr<FileDistributor> distributor)
+    : impl_(std::make_shared<Impl>(std::move(io_task_runner), std::move(distributor)))
+{
+    // Nothing
+}
+
+FileDistributorProxy::~FileDistributorProxy()
+{
+    impl_->stop();
+}
+
+void FileDistributorProxy::start(const std::string& source_path,
+                                 const std::vector<Config>& hosts,
+                                 const FileDistributor::Options& options)
+{
+    impl_->start(source_path, hosts, options);
+}
+
+void FileDistributorProxy::stop()
+{
+    impl_->stop();
+}
+
+} // namespace client
@@ -0,0 +1,53 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT__FILE_DISTRIBUTOR_PROXY_H
+#define CLIENT__FILE_DISTRIBUTOR_PROXY_H
+
+#include "base/macros_magic.h"
+#include "client/file_distributor.h"
+
+#include <memory>
+
+namespace base {
+class TaskRunner;
+} // namespace base
+
+namespace client {
+
+class FileDistributorProxy
+{
+public:
+    FileDistributorProxy(std::shared_ptr<base::TaskRunner> io_task_runner,
+                         std::unique_ptr<FileDistributor> distributor);
+    ~FileDistributorProxy();
+
+    void start(const std::string& source_path, const std::vector<Config>& hosts,
+               const FileDistributor::Options& options);
+    void stop();
+
+private:
+    class Impl;
+    std::shared_ptr<Impl> impl_;
+
+    DISALLOW_COPY_AND_ASSIGN(FileDistributorProxy);
+};
+
+} // namespace client
+
+#endif // CLIENT__FILE_DISTRIBUTOR_PROXY_H
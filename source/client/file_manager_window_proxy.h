@@ -50,6 +50,9 @@ public:
     void onFileList(common::FileTask::Target target,
                     proto::FileError error_code,
                     const proto::FileList& file_list);
+    void onFileListPart(common::FileTask::Target target,
+                        proto::FileError error_code,
+                        const proto::FileList& file_list);
     void onCreateDirectory(common::FileTask::Target target, proto::FileError error_code);
     void onRename(common::FileTask::Target target, proto::FileError error_code);
 
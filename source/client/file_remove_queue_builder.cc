@@ -26,6 +26,13 @@
 
 namespace client {
 
+namespace {
+
+// Several directories are listed at once to avoid a round trip for each directory.
+const size_t kMaxListRequests = 8;
+
+} // namespace
+
 FileRemoveQueueBuilder::FileRemoveQueueBuilder(
     std::shared_ptr<common::FileTaskConsumerProxy> task_consumer_proxy,
     common::FileTask::Target target)
@@ -76,6 +83,11 @@ void FileRemoveQueueBuilder::onTaskDone(std::shared_ptr<common::FileTask> task)
     }
 
     const std::string& path = request.file_list_request().path();
+    if (!listed_dirs_.erase(path))
+    {
+        onAborted(proto::FILE_ERROR_UNKNOWN);
+        return;
+    }
 
     for (int i = 0; i < reply.file_list().item_size(); ++i)
     {
@@ -90,25 +102,33 @@ void FileRemoveQueueBuilder::onTaskDone(std::shared_ptr<common::FileTask> task)
 
 void FileRemoveQueueBuilder::doPendingTasks()
 {
+    // The content of a directory is always found after the directory itself and is placed before
+    // it in the queue, so the directory is removed when it is already empty.
     while (!pending_tasks_.empty())
     {
+        if (pending_tasks_.front().isDirectory() && listed_dirs_.size() >= kMaxListRequests)
+            return;
+
         tasks_.emplace_front(std::move(pending_tasks_.front()));
         pending_tasks_.pop_front();
 
-        if (tasks_.front().isDirectory())
+        const FileRemover::Task& task = tasks_.front();
+        if (task.isDirectory())
         {
-            task_consumer_proxy_->doTask(task_factory_->fileList(tasks_.front().path()));
-            return;
+            listed_dirs_.emplace(task.path());
+            task_consumer_proxy_->doTask(task_factory_->fileList(task.path()));
         }
     }
 
-    callback_(proto::FILE_ERROR_SUCCESS);
+    if (listed_dirs_.empty())
+        callback_(proto::FILE_ERROR_SUCCESS);
 }
 
 void FileRemoveQueueBuilder::onAborted(proto::FileError error_code)
 {
     pending_tasks_.clear();
     tasks_.clear();
+    listed_dirs_.clear();
 
     callback_(error_code);
 }
@@ -22,6 +22,8 @@
 #include "client/file_remover.h"
 #include "proto/file_transfer.pb.h"
 
+#include <set>
+
 namespace client {
 
 // The class prepares the task queue to perform the deletion.
@@ -57,6 +59,9 @@ private:
     FileRemover::TaskList pending_tasks_;
     FileRemover::TaskList tasks_;
 
+    // Directories for which the list of files is requested.
+    std::set<std::string> listed_dirs_;
+
     DISALLOW_COPY_AND_ASSIGN(FileRemoveQueueBuilder);
 };
 
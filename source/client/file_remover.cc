@@ -28,6 +28,14 @@
 
 namespace client {
 
+namespace {
+
+// The number of items removed by one request of a recursive removal. The progress is updated
+// after each part.
+const uint32_t kRemovePartSize = 256;
+
+} // namespace
+
 FileRemover::FileRemover(std::shared_ptr<base::TaskRunner> io_task_runner,
                          std::shared_ptr<FileRemoveWindowProxy> remove_window_proxy,
                          std::shared_ptr<common::FileTaskConsumerProxy> task_consumer_proxy,
@@ -56,32 +64,19 @@ void FileRemover::start(const TaskList& items, const FinishCallback& callback)
     // Asynchronously start UI.
     remove_window_proxy_->start(remover_proxy_);
 
-    queue_builder_ = std::make_unique<FileRemoveQueueBuilder>(
-        task_consumer_proxy_, task_factory_->target());
-
-    // Start building a list of objects for deletion.
-    queue_builder_->start(items, [this](proto::FileError error_code)
-    {
-        if (error_code == proto::FILE_ERROR_SUCCESS)
-        {
-            tasks_ = queue_builder_->takeQueue();
-            tasks_count_ = tasks_.size();
-
-            doCurrentTask();
-        }
-        else
-        {
-            remove_window_proxy_->errorOccurred(std::string(), error_code, ACTION_ABORT);
-        }
+    // The items are removed recursively by the side that owns them. If it does not support this,
+    // the list of all objects is built and they are removed one by one.
+    items_ = items;
+    items_count_ = items_.size();
 
-        queue_builder_.reset();
-    });
+    doCurrentItem();
 }
 
 void FileRemover::stop()
 {
     queue_builder_.reset();
     tasks_.clear();
+    items_.clear();
 
     onFinished();
 }
@@ -91,12 +86,12 @@ void FileRemover::setAction(Action action)
     switch (action)
     {
         case ACTION_SKIP:
-            doNextTask();
+            skipFailure();
             break;
 
         case ACTION_SKIP_ALL:
             failure_action_ = action;
-            doNextTask();
+            skipFailure();
             break;
 
         case ACTION_ABORT:
@@ -121,38 +116,181 @@ void FileRemover::onTaskDone(std::shared_ptr<common::FileTask> task)
         return;
     }
 
+    if (request.remove_request().recursive())
+    {
+        onRecursiveRemoveDone(request.remove_request(), reply);
+        return;
+    }
+
     if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
     {
-        uint32_t actions;
+        if (!showError(request.remove_request().path(), reply.error_code()))
+            doNextTask();
+        return;
+    }
 
-        switch (reply.error_code())
+    doNextTask();
+}
+
+void FileRemover::onRecursiveRemoveDone(
+    const proto::RemoveRequest& request, const proto::FileReply& reply)
+{
+    if (!reply.has_remove_progress())
+    {
+        // Older versions remove only files and empty directories.
+        if (reply.error_code() == proto::FILE_ERROR_SUCCESS)
         {
-            case proto::FILE_ERROR_PATH_NOT_FOUND:
-            case proto::FILE_ERROR_ACCESS_DENIED:
-            {
-                if (failure_action_ != ACTION_ASK)
-                {
-                    setAction(failure_action_);
-                    return;
-                }
-
-                actions = ACTION_ABORT | ACTION_SKIP | ACTION_SKIP_ALL;
-            }
-            break;
+            doNextItem();
+            return;
+        }
 
-            default:
-                actions = ACTION_ABORT;
-                break;
+        LOG(LS_INFO) << "Recursive removal is not supported";
+        buildQueue();
+        return;
+    }
+
+    const proto::RemoveProgress& progress = reply.remove_progress();
+
+    if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
+    {
+        failures_.emplace_back(request.path(), reply.error_code());
+        has_more_ = false;
+    }
+    else
+    {
+        for (int i = 0; i < progress.failure_size(); ++i)
+        {
+            const proto::RemoveProgress::Failure& failure = progress.failure(i);
+            failures_.emplace_back(failure.path(), failure.error_code());
         }
 
-        remove_window_proxy_->errorOccurred(
-            request.remove_request().path(), reply.error_code(), actions);
+        has_more_ = progress.has_more();
+    }
+
+    if (!progress.last_path().empty())
+        remove_window_proxy_->setCurrentProgress(progress.last_path(), itemsPercentage());
+
+    doRecursiveStep();
+}
+
+void FileRemover::doRecursiveStep()
+{
+    while (!failures_.empty())
+    {
+        const std::pair<std::string, proto::FileError>& failure = failures_.front();
+
+        if (showError(failure.first, failure.second))
+            return;
+
+        failures_.pop_front();
+    }
+
+    if (has_more_)
+    {
+        task_consumer_proxy_->doTask(
+            task_factory_->remove(items_.front().path(), true, kRemovePartSize, true));
+        return;
+    }
+
+    doNextItem();
+}
+
+void FileRemover::skipFailure()
+{
+    if (!failures_.empty())
+    {
+        // The rest of the items are removed by the next parts.
+        failures_.pop_front();
+        doRecursiveStep();
         return;
     }
 
     doNextTask();
 }
 
+bool FileRemover::showError(const std::string& path, proto::FileError error_code)
+{
+    uint32_t actions;
+
+    switch (error_code)
+    {
+        case proto::FILE_ERROR_PATH_NOT_FOUND:
+        case proto::FILE_ERROR_ACCESS_DENIED:
+        {
+            if (failure_action_ == ACTION_SKIP_ALL)
+                return false;
+
+            actions = ACTION_ABORT | ACTION_SKIP | ACTION_SKIP_ALL;
+        }
+        break;
+
+        default:
+            actions = ACTION_ABORT;
+            break;
+    }
+
+    remove_window_proxy_->errorOccurred(path, error_code, actions);
+    return true;
+}
+
+void FileRemover::doNextItem()
+{
+    if (!items_.empty())
+        items_.pop_front();
+
+    doCurrentItem();
+}
+
+void FileRemover::doCurrentItem()
+{
+    if (items_.empty())
+    {
+        onFinished();
+        return;
+    }
+
+    const std::string& path = items_.front().path();
+
+    // Updating progress in UI.
+    remove_window_proxy_->setCurrentProgress(path, itemsPercentage());
+
+    has_more_ = false;
+    task_consumer_proxy_->doTask(task_factory_->remove(path, true, kRemovePartSize));
+}
+
+int FileRemover::itemsPercentage() const
+{
+    DCHECK_NE(items_count_, 0);
+    return static_cast<int>((items_count_ - items_.size()) * 100 / items_count_);
+}
+
+void FileRemover::buildQueue()
+{
+    queue_builder_ = std::make_unique<FileRemoveQueueBuilder>(
+        task_consumer_proxy_, task_factory_->target());
+
+    // Start building a list of objects for deletion. The items removed recursively are not in
+    // the list anymore.
+    queue_builder_->start(items_, [this](proto::FileError error_code)
+    {
+        items_.clear();
+
+        if (error_code == proto::FILE_ERROR_SUCCESS)
+        {
+            tasks_ = queue_builder_->takeQueue();
+            tasks_count_ = tasks_.size();
+
+            doCurrentTask();
+        }
+        else
+        {
+            remove_window_proxy_->errorOccurred(std::string(), error_code, ACTION_ABORT);
+        }
+
+        queue_builder_.reset();
+    });
+}
+
 void FileRemover::doNextTask()
 {
     // The task is completed. We delete it.
@@ -21,10 +21,12 @@
 
 #include "common/file_task.h"
 #include "common/file_task_producer.h"
+#include "proto/file_transfer.pb.h"
 
 #include <functional>
 #include <deque>
 #include <string>
+#include <utility>
 
 namespace base {
 class TaskRunner;
@@ -93,6 +95,18 @@ protected:
     void onTaskDone(std::shared_ptr<common::FileTask> task) override;
 
 private:
+    void onRecursiveRemoveDone(const proto::RemoveRequest& request, const proto::FileReply& reply);
+    void doRecursiveStep();
+    void skipFailure();
+
+    // Returns true if the error is shown to the user and the remover waits for setAction().
+    bool showError(const std::string& path, proto::FileError error_code);
+
+    void doNextItem();
+    void doCurrentItem();
+    int itemsPercentage() const;
+    void buildQueue();
+
     void doNextTask();
     void doCurrentTask();
     void onFinished();
@@ -105,6 +119,13 @@ private:
 
     std::unique_ptr<FileRemoveQueueBuilder> queue_builder_;
 
+    // The selected items, each of them is removed recursively.
+    TaskList items_;
+    size_t items_count_ = 0;
+    bool has_more_ = false;
+    std::deque<std::pair<std::string, proto::FileError>> failures_;
+
+    // All objects to remove one by one if recursive removal is not supported.
     TaskList tasks_;
     FinishCallback finish_callback_;
 
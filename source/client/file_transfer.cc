@@ -27,10 +27,31 @@
 #include "common/file_task_producer_proxy.h"
 #include "common/file_packet.h"
 
+#include <algorithm>
+#include <iterator>
+
 namespace client {
 
 namespace {
 
+// Bytes on the way between the source and the target at the start of the transfer.
+const size_t kInitialWindow = 4 * common::kDefaultFilePacketSize;
+const size_t kMinWindow = common::kMinFilePacketSize;
+const size_t kMaxWindow = 16 * 1024 * 1024; // 16 MB
+
+// Bounds for the number of packets waiting in the queues on the way. A few packets in the queues
+// keep the channel and the disks busy, more of them only add delay.
+const double kMinQueuedPackets = 2.0;
+const double kMaxQueuedPackets = 6.0;
+
+// The packet size is chosen so that one packet takes about this time at the measured speed.
+const std::chrono::milliseconds kRateInterval(500);
+const std::chrono::milliseconds kPacketDuration(10);
+
+// Limits of one CopyRequest. The progress is updated after each request.
+const size_t kMaxCopyEntries = 256;
+const int64_t kMaxCopySize = 256 * 1024 * 1024; // 256 MB
+
 struct ActionsMap
 {
     FileTransfer::Error::Type type;
@@ -94,7 +115,9 @@ FileTransfer::FileTransfer(std::shared_ptr<base::TaskRunner> io_task_runner,
       task_consumer_proxy_(std::move(task_consumer_proxy)),
       task_producer_proxy_(std::make_shared<common::FileTaskProducerProxy>(this)),
       cancel_timer_(base::WaitableTimer::Type::SINGLE_SHOT, io_task_runner),
-      type_(type)
+      type_(type),
+      window_(kInitialWindow),
+      packet_size_(common::kDefaultFilePacketSize)
 {
     // Nothing
 }
@@ -125,13 +148,27 @@ void FileTransfer::start(const std::string& source_path,
         task_factory_source_ = std::move(task_factory_remote);
         task_factory_target_ = std::move(task_factory_local);
     }
-    else
+    else if (type_ == Type::UPLOADER)
     {
-        DCHECK_EQ(type_, Type::UPLOADER);
-
         task_factory_source_ = std::move(task_factory_local);
         task_factory_target_ = std::move(task_factory_remote);
     }
+    else if (type_ == Type::LOCAL_COPIER)
+    {
+        task_factory_source_ = std::move(task_factory_local);
+        task_factory_target_ = std::make_unique<common::FileTaskFactory>(
+            task_producer_proxy_, common::FileTask::Target::LOCAL);
+    }
+    else
+    {
+        DCHECK_EQ(type_, Type::REMOTE_COPIER);
+
+        task_factory_source_ = std::move(task_factory_remote);
+        task_factory_target_ = std::make_unique<common::FileTaskFactory>(
+            task_producer_proxy_, common::FileTask::Target::REMOTE);
+    }
+
+    rate_time_ = std::chrono::steady_clock::now();
 
     // Asynchronously start UI.
     transfer_window_proxy_->start(transfer_proxy_);
@@ -176,6 +213,9 @@ void FileTransfer::stop()
     {
         is_canceled_ = true;
         cancel_timer_.start(std::chrono::seconds(5), std::bind(&FileTransfer::onFinished, this));
+
+        // The source closes the file being transferred.
+        sendPacketRequests();
     }
 }
 
@@ -186,6 +226,16 @@ void FileTransfer::setActionForErrorType(Error::Type error_type, Error::Action a
 
 void FileTransfer::onTaskDone(std::shared_ptr<common::FileTask> task)
 {
+    if (isCopier())
+    {
+        // The queue is built with the list requests, the files are copied with CopyRequest.
+        if (task->request().has_copy_request())
+            copyReply(task->reply());
+        else
+            onError(Error::Type::OTHER, proto::FILE_ERROR_UNKNOWN);
+        return;
+    }
+
     if (type_ == Type::DOWNLOADER)
     {
         if (task->target() == common::FileTask::Target::LOCAL)
@@ -196,7 +246,7 @@ void FileTransfer::onTaskDone(std::shared_ptr<common::FileTask> task)
         {
             DCHECK_EQ(task->target(), common::FileTask::Target::REMOTE);
 
-            sourceReply(task->request(), task->reply());
+            sourceReply(task->request(), task->mutableReply());
         }
     }
     else
@@ -205,7 +255,7 @@ void FileTransfer::onTaskDone(std::shared_ptr<common::FileTask> task)
 
         if (task->target() == common::FileTask::Target::LOCAL)
         {
-            sourceReply(task->request(), task->reply());
+            sourceReply(task->request(), task->mutableReply());
         }
         else
         {
@@ -250,21 +300,54 @@ void FileTransfer::targetReply(const proto::FileRequest& request, const proto::F
             return;
         }
 
-        task_consumer_proxy_->doTask(
-            task_factory_source_->packetRequest(proto::FilePacketRequest::NO_FLAGS));
+        // The source compares the file with the blocks of the replaced file.
+        block_hashes_.reset();
+        if (reply.block_hashes().hash_size())
+            block_hashes_ = std::make_unique<proto::FileBlockHashes>(reply.block_hashes());
+
+        startPackets();
+    }
+    else if (request.has_batch_upload_request())
+    {
+        batchTargetReply(reply);
     }
     else if (request.has_packet())
     {
+        DCHECK_GT(target_pending_, 0u);
+        --target_pending_;
+
+        if (file_closed_)
+        {
+            // The packet was sent before an error in the file.
+            onPipelineDrained();
+            return;
+        }
+
         if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
         {
+            closeFile();
             onError(Error::Type::WRITE_FILE, reply.error_code(), frontTask().targetPath());
             return;
         }
 
+        const size_t written_size = request.packet().data().size();
+        const uint64_t unchanged_size = request.packet().unchanged_size();
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        if (!packet_times_.empty())
+        {
+            updateWindow(now - packet_times_.front());
+            packet_times_.pop_front();
+        }
+
+        bytes_in_flight_ -= std::min(bytes_in_flight_, written_size);
+        rate_bytes_ += static_cast<int64_t>(written_size);
+        updatePacketSize(now);
+
         const int64_t full_task_size = frontTask().size();
         if (full_task_size && total_size_)
         {
-            int64_t packet_size = common::kMaxFilePacketSize;
+            int64_t packet_size = static_cast<int64_t>(written_size + unchanged_size);
 
             task_transfered_size_ += packet_size;
 
@@ -292,15 +375,12 @@ void FileTransfer::targetReply(const proto::FileRequest& request, const proto::F
 
         if (request.packet().flags() & proto::FilePacket::LAST_PACKET)
         {
+            closeFile();
             doNextTask();
             return;
         }
 
-        uint32_t flags = proto::FilePacketRequest::NO_FLAGS;
-        if (is_canceled_)
-            flags = proto::FilePacketRequest::CANCEL;
-
-        task_consumer_proxy_->doTask(task_factory_source_->packetRequest(flags));
+        sendPacketRequests();
     }
     else
     {
@@ -308,7 +388,7 @@ void FileTransfer::targetReply(const proto::FileRequest& request, const proto::F
     }
 }
 
-void FileTransfer::sourceReply(const proto::FileRequest& request, const proto::FileReply& reply)
+void FileTransfer::sourceReply(const proto::FileRequest& request, proto::FileReply* reply)
 {
     if (tasks_.empty())
         return;
@@ -317,24 +397,76 @@ void FileTransfer::sourceReply(const proto::FileRequest& request, const proto::F
     {
         Task& front_task = frontTask();
 
-        if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
+        if (reply->error_code() != proto::FILE_ERROR_SUCCESS)
         {
-            onError(Error::Type::OPEN_FILE, reply.error_code(), front_task.sourcePath());
+            onError(Error::Type::OPEN_FILE, reply->error_code(), front_task.sourcePath());
             return;
         }
 
+        // A replaced file is resumed: only the blocks that differ from the source are sent.
+        const bool overwrite = front_task.overwrite();
         task_consumer_proxy_->doTask(
-            task_factory_target_->upload(front_task.targetPath(), front_task.overwrite()));
+            task_factory_target_->upload(front_task.targetPath(), overwrite, overwrite));
+    }
+    else if (request.has_batch_download_request())
+    {
+        batchSourceReply(reply);
     }
     else if (request.has_packet_request())
     {
-        if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
+        DCHECK(!source_requests_.empty());
+        const size_t requested_size = source_requests_.front();
+        source_requests_.pop_front();
+
+        if (file_closed_ || last_packet_received_)
+        {
+            // The request was sent after the last packet of the file or before an error in it.
+            onPipelineDrained();
+            return;
+        }
+
+        if (reply->error_code() != proto::FILE_ERROR_SUCCESS)
         {
-            onError(Error::Type::READ_FILE, reply.error_code(), frontTask().sourcePath());
+            closeFile();
+            onError(Error::Type::READ_FILE, reply->error_code(), frontTask().sourcePath());
             return;
         }
 
-        task_consumer_proxy_->doTask(task_factory_target_->packet(reply.packet()));
+        // The packet is moved to the request for the target without copying the data.
+        std::unique_ptr<proto::FilePacket> packet(reply->release_packet());
+        if (!packet)
+        {
+            closeFile();
+            onError(Error::Type::READ_FILE, proto::FILE_ERROR_UNKNOWN, frontTask().sourcePath());
+            return;
+        }
+
+        const size_t packet_size = packet->data().size();
+        const uint64_t unchanged_size = packet->unchanged_size();
+
+        // The file could change after the transfer queue was built.
+        if (packet->flags() & proto::FilePacket::FIRST_PACKET)
+            expected_bytes_ = static_cast<int64_t>(packet->file_size());
+
+        if (packet->flags() & proto::FilePacket::LAST_PACKET)
+        {
+            last_packet_received_ = true;
+        }
+        else
+        {
+            // The source limits the size of the packets. Older versions always send the packets
+            // of the default size. The unchanged blocks of a resumed file are not sent at all.
+            if (packet_size < requested_size)
+                bytes_in_flight_ -= std::min(bytes_in_flight_, requested_size - packet_size);
+
+            requested_bytes_ += static_cast<int64_t>(packet_size + unchanged_size) -
+                static_cast<int64_t>(requested_size);
+        }
+
+        ++target_pending_;
+        task_consumer_proxy_->doTask(task_factory_target_->packet(std::move(packet)));
+
+        sendPacketRequests();
     }
     else
     {
@@ -378,6 +510,14 @@ void FileTransfer::setAction(Error::Type error_type, Error::Action action)
 
 void FileTransfer::doFrontTask(bool overwrite)
 {
+    if (!source_requests_.empty() || target_pending_)
+    {
+        // The replies for the previous file are still on the way.
+        front_task_deferred_ = true;
+        deferred_overwrite_ = overwrite;
+        return;
+    }
+
     task_percentage_ = 0;
     task_transfered_size_ = 0;
 
@@ -386,6 +526,15 @@ void FileTransfer::doFrontTask(bool overwrite)
 
     transfer_window_proxy_->setCurrentItem(front_task.sourcePath(), front_task.targetPath());
 
+    if (isCopier())
+    {
+        startCopy();
+        return;
+    }
+
+    if (startBatch())
+        return;
+
     if (front_task.isDirectory())
     {
         task_consumer_proxy_->doTask(
@@ -398,6 +547,276 @@ void FileTransfer::doFrontTask(bool overwrite)
     }
 }
 
+bool FileTransfer::startBatch()
+{
+    if (!batch_supported_ || is_canceled_)
+        return false;
+
+    std::vector<std::string> file_paths;
+    int64_t batch_size = 0;
+
+    for (const Task& task : tasks_)
+    {
+        if (task.isDirectory() || task.batchFailed() || task.overwrite())
+            break;
+
+        if (task.size() > static_cast<int64_t>(common::kMaxBatchFileSize) ||
+            batch_size + task.size() > static_cast<int64_t>(common::kMaxBatchSize) ||
+            file_paths.size() >= common::kMaxBatchFiles)
+        {
+            break;
+        }
+
+        batch_size += task.size();
+        file_paths.emplace_back(task.sourcePath());
+    }
+
+    // A single file is sent in packets as before.
+    if (file_paths.size() < 2)
+        return false;
+
+    batch_failed_.assign(file_paths.size(), false);
+    task_consumer_proxy_->doTask(task_factory_source_->batchDownload(file_paths));
+    return true;
+}
+
+void FileTransfer::batchSourceReply(proto::FileReply* reply)
+{
+    if (reply->error_code() != proto::FILE_ERROR_SUCCESS || !reply->has_batch())
+    {
+        LOG(LS_INFO) << "The source does not support file batches";
+
+        // Nothing has been done yet, the files are sent in packets.
+        batch_supported_ = false;
+        batch_failed_.clear();
+        doFrontTask(false);
+        return;
+    }
+
+    proto::FileBatch* source_batch = reply->mutable_batch();
+    std::unique_ptr<proto::FileBatch> target_batch = std::make_unique<proto::FileBatch>();
+
+    // The files are replaced without asking if the user has chosen so.
+    auto action = actions_.find(Error::Type::ALREADY_EXISTS);
+    const bool replace_all =
+        action != actions_.end() && action->second == Error::ACTION_REPLACE_ALL;
+
+    for (size_t i = 0; i < batch_failed_.size(); ++i)
+    {
+        if (i >= static_cast<size_t>(source_batch->entry_size()) ||
+            source_batch->entry(static_cast<int>(i)).error_code() != proto::FILE_ERROR_SUCCESS)
+        {
+            batch_failed_[i] = true;
+            continue;
+        }
+
+        proto::FileBatch::Entry* entry = target_batch->add_entry();
+        entry->set_path(tasks_[i].targetPath());
+        entry->set_overwrite(replace_all);
+        entry->mutable_data()->swap(
+            *source_batch->mutable_entry(static_cast<int>(i))->mutable_data());
+    }
+
+    if (!target_batch->entry_size())
+    {
+        finishBatch();
+        return;
+    }
+
+    task_consumer_proxy_->doTask(task_factory_target_->batchUpload(std::move(target_batch)));
+}
+
+void FileTransfer::batchTargetReply(const proto::FileReply& reply)
+{
+    const bool supported = reply.error_code() == proto::FILE_ERROR_SUCCESS && reply.has_batch();
+    if (!supported)
+    {
+        LOG(LS_INFO) << "The target does not support file batches";
+        batch_supported_ = false;
+    }
+
+    // The reply has an entry for each file that was read by the source.
+    int index = 0;
+
+    for (size_t i = 0; i < batch_failed_.size(); ++i)
+    {
+        if (batch_failed_[i])
+            continue;
+
+        if (!supported || index >= reply.batch().entry_size() ||
+            reply.batch().entry(index).error_code() != proto::FILE_ERROR_SUCCESS)
+        {
+            batch_failed_[i] = true;
+        }
+
+        ++index;
+    }
+
+    finishBatch();
+}
+
+void FileTransfer::finishBatch()
+{
+    TaskList tasks;
+    int64_t done_size = 0;
+
+    for (size_t i = 0; i < batch_failed_.size() && !tasks_.empty(); ++i)
+    {
+        if (batch_failed_[i])
+        {
+            // The file is sent again in packets with the usual error handling.
+            tasks.emplace_back(std::move(tasks_.front()));
+            if (batch_supported_)
+                tasks.back().setBatchFailed();
+        }
+        else
+        {
+            done_size += tasks_.front().size();
+        }
+
+        tasks_.pop_front();
+    }
+
+    batch_failed_.clear();
+
+    std::move(tasks_.begin(), tasks_.end(), std::back_inserter(tasks));
+    tasks_ = std::move(tasks);
+
+    total_transfered_size_ += done_size;
+
+    if (total_size_)
+    {
+        const int total_percentage = static_cast<int>(total_transfered_size_ * 100 / total_size_);
+        if (total_percentage != total_percentage_)
+        {
+            total_percentage_ = total_percentage;
+            transfer_window_proxy_->setCurrentProgress(total_percentage_, 100);
+        }
+    }
+
+    if (is_canceled_ || tasks_.empty())
+    {
+        tasks_.clear();
+
+        if (cancel_timer_.isActive())
+            cancel_timer_.stop();
+
+        onFinished();
+        return;
+    }
+
+    doFrontTask(false);
+}
+
+bool FileTransfer::isCopier() const
+{
+    return type_ == Type::LOCAL_COPIER || type_ == Type::REMOTE_COPIER;
+}
+
+void FileTransfer::startCopy()
+{
+    // The files are replaced without asking if the user has chosen so.
+    auto action = actions_.find(Error::Type::ALREADY_EXISTS);
+    const bool replace_all =
+        action != actions_.end() && action->second == Error::ACTION_REPLACE_ALL;
+
+    std::unique_ptr<proto::CopyRequest> request = std::make_unique<proto::CopyRequest>();
+    int64_t copy_size = 0;
+
+    for (const Task& task : tasks_)
+    {
+        // A large file is copied alone.
+        if (request->entry_size() &&
+            (static_cast<size_t>(request->entry_size()) >= kMaxCopyEntries ||
+             copy_size + task.size() > kMaxCopySize))
+        {
+            break;
+        }
+
+        proto::CopyRequest::Entry* entry = request->add_entry();
+        entry->set_source_path(task.sourcePath());
+        entry->set_target_path(task.targetPath());
+        entry->set_is_directory(task.isDirectory());
+        entry->set_overwrite(task.overwrite() || replace_all);
+
+        copy_size += task.size();
+    }
+
+    task_consumer_proxy_->doTask(task_factory_target_->copy(std::move(request)));
+}
+
+void FileTransfer::copyReply(const proto::FileReply& reply)
+{
+    if (is_canceled_)
+    {
+        tasks_.clear();
+
+        if (cancel_timer_.isActive())
+            cancel_timer_.stop();
+
+        onFinished();
+        return;
+    }
+
+    if (reply.error_code() != proto::FILE_ERROR_SUCCESS || !reply.has_copy_result())
+    {
+        // Older versions reply with FILE_ERROR_INVALID_REQUEST.
+        LOG(LS_INFO) << "The peer does not support copying";
+        onError(Error::Type::OTHER, reply.error_code());
+        return;
+    }
+
+    const proto::CopyResult& result = reply.copy_result();
+    int64_t done_size = 0;
+
+    // The tasks are executed in order up to the first failed one.
+    for (int i = 0; i < result.error_code_size() && !tasks_.empty(); ++i)
+    {
+        const proto::FileError error_code = result.error_code(i);
+        if (error_code == proto::FILE_ERROR_SUCCESS)
+        {
+            done_size += tasks_.front().size();
+            tasks_.pop_front();
+            continue;
+        }
+
+        total_transfered_size_ += done_size;
+
+        Task& front_task = frontTask();
+        front_task.setOverwrite(false);
+
+        Error::Type error_type = Error::Type::CREATE_FILE;
+        if (front_task.isDirectory())
+            error_type = Error::Type::CREATE_DIRECTORY;
+        else if (error_code == proto::FILE_ERROR_PATH_ALREADY_EXISTS)
+            error_type = Error::Type::ALREADY_EXISTS;
+
+        transfer_window_proxy_->setCurrentItem(front_task.sourcePath(), front_task.targetPath());
+        onError(error_type, error_code, front_task.targetPath());
+        return;
+    }
+
+    total_transfered_size_ += done_size;
+
+    if (total_size_)
+    {
+        const int total_percentage = static_cast<int>(total_transfered_size_ * 100 / total_size_);
+        if (total_percentage != total_percentage_)
+        {
+            total_percentage_ = total_percentage;
+            transfer_window_proxy_->setCurrentProgress(total_percentage_, 100);
+        }
+    }
+
+    if (tasks_.empty())
+    {
+        onFinished();
+        return;
+    }
+
+    doFrontTask(false);
+}
+
 void FileTransfer::doNextTask()
 {
     if (is_canceled_)
@@ -424,6 +843,116 @@ void FileTransfer::doNextTask()
     doFrontTask(false);
 }
 
+void FileTransfer::startPackets()
+{
+    requested_bytes_ = 0;
+    expected_bytes_ = frontTask().size();
+    cancel_requested_ = false;
+    last_packet_received_ = false;
+    file_closed_ = false;
+
+    sendPacketRequests();
+}
+
+void FileTransfer::sendPacketRequests()
+{
+    if (file_closed_ || last_packet_received_ || cancel_requested_)
+        return;
+
+    if (is_canceled_)
+    {
+        // The source replies with the last packet and closes the file.
+        cancel_requested_ = true;
+        source_requests_.emplace_back(0);
+        task_consumer_proxy_->doTask(
+            task_factory_source_->packetRequest(proto::FilePacketRequest::CANCEL));
+        return;
+    }
+
+    // An empty file is also sent in one packet.
+    while (bytes_in_flight_ < window_ &&
+           (!requested_bytes_ || requested_bytes_ < expected_bytes_))
+    {
+        packet_times_.emplace_back(std::chrono::steady_clock::now());
+        source_requests_.emplace_back(packet_size_);
+        requested_bytes_ += static_cast<int64_t>(packet_size_);
+        bytes_in_flight_ += packet_size_;
+
+        if (block_hashes_)
+        {
+            // The hashes are sent with the first request of the file.
+            task_consumer_proxy_->doTask(task_factory_source_->packetRequest(
+                proto::FilePacketRequest::NO_FLAGS, static_cast<uint32_t>(packet_size_),
+                std::move(block_hashes_)));
+        }
+        else
+        {
+            task_consumer_proxy_->doTask(task_factory_source_->packetRequest(
+                proto::FilePacketRequest::NO_FLAGS, static_cast<uint32_t>(packet_size_)));
+        }
+    }
+}
+
+void FileTransfer::closeFile()
+{
+    file_closed_ = true;
+    bytes_in_flight_ = 0;
+    packet_times_.clear();
+}
+
+void FileTransfer::onPipelineDrained()
+{
+    if (!source_requests_.empty() || target_pending_ || !front_task_deferred_)
+        return;
+
+    front_task_deferred_ = false;
+    doFrontTask(deferred_overwrite_);
+}
+
+void FileTransfer::updateWindow(std::chrono::steady_clock::duration delay)
+{
+    min_delay_ = std::min(min_delay_, delay);
+
+    if (delay <= std::chrono::steady_clock::duration::zero())
+        return;
+
+    // The delay over the minimum is the time the packets wait in the queues. With the window of
+    // N packets, about N * (1 - min_delay / delay) of them are waiting.
+    const double ratio = std::chrono::duration<double>(min_delay_) /
+        std::chrono::duration<double>(delay);
+    const double queued_packets =
+        static_cast<double>(window_) * (1.0 - ratio) / static_cast<double>(packet_size_);
+
+    if (queued_packets < kMinQueuedPackets)
+        window_ = std::min(window_ + packet_size_, kMaxWindow);
+    else if (queued_packets > kMaxQueuedPackets)
+        window_ = std::max(window_ - std::min(window_, packet_size_), kMinWindow);
+}
+
+void FileTransfer::updatePacketSize(std::chrono::steady_clock::time_point now)
+{
+    const std::chrono::steady_clock::duration elapsed = now - rate_time_;
+    if (elapsed < kRateInterval)
+        return;
+
+    const double bytes_per_second =
+        static_cast<double>(rate_bytes_) / std::chrono::duration<double>(elapsed).count();
+    const double target_size =
+        bytes_per_second * std::chrono::duration<double>(kPacketDuration).count();
+
+    rate_bytes_ = 0;
+    rate_time_ = now;
+
+    size_t packet_size = common::kMinFilePacketSize;
+    while (packet_size * 2 <= common::kMaxFilePacketSize &&
+           static_cast<double>(packet_size * 2) <= target_size)
+    {
+        packet_size *= 2;
+    }
+
+    packet_size_ = packet_size;
+}
+
 void FileTransfer::onError(Error::Type type, proto::FileError code, const std::string& path)
 {
     auto default_action = actions_.find(type);
@@ -484,6 +1013,8 @@ FileTransfer::Task::Task(Task&& other) noexcept
     : source_path_(std::move(other.source_path_)),
       target_path_(std::move(other.target_path_)),
       is_directory_(other.is_directory_),
+      overwrite_(other.overwrite_),
+      batch_failed_(other.batch_failed_),
       size_(other.size_)
 {
     // Nothing
@@ -494,6 +1025,8 @@ FileTransfer::Task& FileTransfer::Task::operator=(Task&& other) noexcept
     source_path_ = std::move(other.source_path_);
     target_path_ = std::move(other.target_path_);
     is_directory_ = other.is_directory_;
+    overwrite_ = other.overwrite_;
+    batch_failed_ = other.batch_failed_;
     size_ = other.size_;
     return *this;
 }
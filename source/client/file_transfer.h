@@ -24,7 +24,9 @@
 #include "common/file_task_producer.h"
 #include "proto/file_transfer.pb.h"
 
+#include <chrono>
 #include <deque>
+#include <vector>
 
 namespace base {
 class TaskRunner;
@@ -48,7 +50,11 @@ public:
     enum class Type
     {
         DOWNLOADER,
-        UPLOADER
+        UPLOADER,
+
+        // The files are copied within one side, the data is not sent over the network.
+        LOCAL_COPIER,
+        REMOTE_COPIER
     };
 
     class Error
@@ -144,11 +150,16 @@ public:
         bool overwrite() const { return overwrite_; }
         void setOverwrite(bool value) { overwrite_ = value; }
 
+        // The file could not be sent in a batch and is sent in packets.
+        bool batchFailed() const { return batch_failed_; }
+        void setBatchFailed() { batch_failed_ = true; }
+
     private:
         std::string source_path_;
         std::string target_path_;
         bool is_directory_;
         bool overwrite_ = false;
+        bool batch_failed_ = false;
         int64_t size_;
     };
 
@@ -176,9 +187,22 @@ protected:
 private:
     Task& frontTask();
     void targetReply(const proto::FileRequest& request, const proto::FileReply& reply);
-    void sourceReply(const proto::FileRequest& request, const proto::FileReply& reply);
+    void sourceReply(const proto::FileRequest& request, proto::FileReply* reply);
     void doFrontTask(bool overwrite);
+    bool startBatch();
+    bool isCopier() const;
+    void startCopy();
+    void copyReply(const proto::FileReply& reply);
+    void batchSourceReply(proto::FileReply* reply);
+    void batchTargetReply(const proto::FileReply& reply);
+    void finishBatch();
     void doNextTask();
+    void startPackets();
+    void sendPacketRequests();
+    void closeFile();
+    void onPipelineDrained();
+    void updateWindow(std::chrono::steady_clock::duration delay);
+    void updatePacketSize(std::chrono::steady_clock::time_point now);
     void onError(Error::Type type, proto::FileError code, const std::string& path = std::string());
     void setActionForErrorType(Error::Type error_type, Error::Action action);
     void onFinished();
@@ -208,6 +232,45 @@ private:
     int total_percentage_ = 0;
     int task_percentage_ = 0;
 
+    // The packets of the file are requested from the source ahead of the acknowledgements of the
+    // target. The window limits the bytes on the way. It grows while the delay of the packets
+    // stays close to the minimum and shrinks when the packets queue up.
+    size_t window_;
+    size_t bytes_in_flight_ = 0;
+    std::chrono::steady_clock::duration min_delay_ = std::chrono::steady_clock::duration::max();
+
+    // Size of the requested packets. Larger packets are used on faster links to lower the cost
+    // of each packet.
+    size_t packet_size_;
+    int64_t rate_bytes_ = 0;
+    std::chrono::steady_clock::time_point rate_time_;
+
+    // Request times of the packets that have not been written yet.
+    std::deque<std::chrono::steady_clock::time_point> packet_times_;
+
+    // Sizes of the packet requests not answered by the source yet and the number of packets not
+    // written by the target yet. The replies are ignored when the current file has been closed,
+    // the next task starts after all of them.
+    std::deque<size_t> source_requests_;
+    size_t target_pending_ = 0;
+
+    int64_t requested_bytes_ = 0;
+    int64_t expected_bytes_ = 0;
+    bool cancel_requested_ = false;
+    bool last_packet_received_ = false;
+    bool file_closed_ = true;
+
+    bool front_task_deferred_ = false;
+    bool deferred_overwrite_ = false;
+
+    // Small files are sent in batches while the peer supports them. The batch consists of the
+    // first tasks of the queue, the failed ones stay in the queue and are sent in packets.
+    bool batch_supported_ = true;
+
+    // Hashes of the blocks of the replaced file, sent to the source with the first packet request.
+    std::unique_ptr<proto::FileBlockHashes> block_hashes_;
+    std::vector<bool> batch_failed_;
+
     bool is_canceled_ = false;
 
     DISALLOW_COPY_AND_ASSIGN(FileTransfer);
@@ -25,6 +25,13 @@
 
 namespace client {
 
+namespace {
+
+// Several directories are listed at once to avoid a round trip for each directory.
+const size_t kMaxListRequests = 8;
+
+} // namespace
+
 FileTransferQueueBuilder::FileTransferQueueBuilder(
     std::shared_ptr<common::FileTaskConsumerProxy> task_consumer_proxy,
     common::FileTask::Target target)
@@ -67,8 +74,6 @@ int64_t FileTransferQueueBuilder::totalSize() const
 
 void FileTransferQueueBuilder::onTaskDone(std::shared_ptr<common::FileTask> task)
 {
-    DCHECK(!tasks_.empty());
-
     const proto::FileRequest& request = task->request();
     const proto::FileReply& reply = task->reply();
 
@@ -84,16 +89,23 @@ void FileTransferQueueBuilder::onTaskDone(std::shared_ptr<common::FileTask> task
         return;
     }
 
-    // If we get a list of files, then the last task is a directory.
-    const FileTransfer::Task& last_task = tasks_.back();
-    DCHECK(last_task.isDirectory());
+    auto dir = listed_dirs_.find(request.file_list_request().path());
+    if (dir == listed_dirs_.end())
+    {
+        onAborted(proto::FILE_ERROR_UNKNOWN);
+        return;
+    }
+
+    const std::string source_dir = dir->first;
+    const std::string target_dir = dir->second;
+    listed_dirs_.erase(dir);
 
     for (int i = 0; i < reply.file_list().item_size(); ++i)
     {
         const proto::FileList::Item& item = reply.file_list().item(i);
 
-        addPendingTask(last_task.sourcePath(),
-                       last_task.targetPath(),
+        addPendingTask(source_dir,
+                       target_dir,
                        item.name(),
                        item.is_directory(),
                        static_cast<int64_t>(item.size()));
@@ -118,25 +130,33 @@ void FileTransferQueueBuilder::addPendingTask(const std::string& source_dir,
 
 void FileTransferQueueBuilder::doPendingTasks()
 {
+    // A directory is always added to the queue before its content, so the target directories
+    // are created before the files are copied into them.
     while (!pending_tasks_.empty())
     {
+        if (pending_tasks_.front().isDirectory() && listed_dirs_.size() >= kMaxListRequests)
+            return;
+
         tasks_.emplace_back(std::move(pending_tasks_.front()));
         pending_tasks_.pop_front();
 
-        if (tasks_.back().isDirectory())
+        const FileTransfer::Task& task = tasks_.back();
+        if (task.isDirectory())
         {
-            task_consumer_proxy_->doTask(task_factory_->fileList(tasks_.back().sourcePath()));
-            return;
+            listed_dirs_.emplace(task.sourcePath(), task.targetPath());
+            task_consumer_proxy_->doTask(task_factory_->fileList(task.sourcePath()));
         }
     }
 
-    callback_(proto::FILE_ERROR_SUCCESS);
+    if (listed_dirs_.empty())
+        callback_(proto::FILE_ERROR_SUCCESS);
 }
 
 void FileTransferQueueBuilder::onAborted(proto::FileError error_code)
 {
     pending_tasks_.clear();
     tasks_.clear();
+    listed_dirs_.clear();
     total_size_ = 0;
 
     callback_(error_code);
@@ -21,6 +21,8 @@
 
 #include "client/file_transfer.h"
 
+#include <map>
+
 namespace client {
 
 // The class prepares the task queue to perform the downloading/uploading.
@@ -66,6 +68,9 @@ private:
     FileTransfer::TaskList tasks_;
     int64_t total_size_ = 0;
 
+    // Directories for which the list of files is requested (source path -> target path).
+    std::map<std::string, std::string> listed_dirs_;
+
     DISALLOW_COPY_AND_ASSIGN(FileTransferQueueBuilder);
 };
 
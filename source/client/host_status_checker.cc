@@ -0,0 +1,468 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/host_status_checker.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/waitable_timer.h"
+#include "base/net/network_channel.h"
+#include "base/peer/client_authenticator.h"
+#include "proto/router_peer.pb.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace client {
+
+namespace {
+
+// The router accepts up to 1000 hosts in one request.
+const size_t kMaxHostsPerRequest = 1000;
+const size_t kMaxAddressProbes = 16;
+const std::chrono::seconds kRouterTimeout{ 30 };
+const std::chrono::seconds kAddressTimeout{ 5 };
+
+} // namespace
+
+class HostStatusChecker::AddressProbe : public base::NetworkChannel::Listener
+{
+public:
+    AddressProbe(Core* core, size_t index, std::shared_ptr<base::TaskRunner> task_runner);
+    ~AddressProbe() override = default;
+
+    void start(const std::u16string& address, uint16_t port);
+
+protected:
+    // base::NetworkChannel::Listener implementation.
+    void onConnected() override;
+    void onDisconnected(base::NetworkChannel::ErrorCode error_code) override;
+    void onMessageReceived(const base::ByteArray& buffer) override;
+    void onMessageWritten(size_t pending) override;
+
+private:
+    void finish(Status status);
+
+    Core* core_;
+    const size_t index_;
+
+    base::NetworkChannel channel_;
+    base::WaitableTimer timeout_timer_;
+    bool finished_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(AddressProbe);
+};
+
+class HostStatusChecker::Core
+    : public std::enable_shared_from_this<Core>,
+      public base::NetworkChannel::Listener
+{
+public:
+    Core(std::shared_ptr<base::TaskRunner> io_task_runner,
+         std::shared_ptr<base::TaskRunner> ui_task_runner,
+         std::weak_ptr<int> lifetime,
+         Callback callback);
+    ~Core() override = default;
+
+    void start(const std::optional<RouterConfig>& router_config, std::vector<Target>&& targets);
+    void stop();
+
+    void onAddressProbeFinished(AddressProbe* probe, size_t index, Status status);
+
+protected:
+    // base::NetworkChannel::Listener implementation.
+    void onConnected() override;
+    void onDisconnected(base::NetworkChannel::ErrorCode error_code) override;
+    void onMessageReceived(const base::ByteArray& buffer) override;
+    void onMessageWritten(size_t pending) override;
+
+private:
+    void sendNextRouterRequest();
+    void finishRouterQuery();
+    void startAddressProbes();
+    void report(ResultList&& results);
+
+    std::shared_ptr<base::TaskRunner> io_task_runner_;
+    std::shared_ptr<base::TaskRunner> ui_task_runner_;
+    std::weak_ptr<int> lifetime_;
+    Callback callback_;
+
+    std::optional<RouterConfig> router_config_;
+    std::vector<Target> targets_;
+
+    // Indexes of the targets checked through the router.
+    std::vector<size_t> router_targets_;
+    size_t router_requested_ = 0;
+    size_t router_answered_ = 0;
+
+    std::unique_ptr<base::NetworkChannel> router_channel_;
+    std::unique_ptr<base::ClientAuthenticator> authenticator_;
+    std::unique_ptr<base::WaitableTimer> router_timer_;
+
+    // Indexes of the targets checked by a connection to them.
+    std::vector<size_t> address_targets_;
+    size_t next_address_ = 0;
+    std::vector<std::unique_ptr<AddressProbe>> address_probes_;
+
+    DISALLOW_COPY_AND_ASSIGN(Core);
+};
+
+//--------------------------------------------------------------------------------------------------
+
+HostStatusChecker::AddressProbe::AddressProbe(
+    Core* core, size_t index, std::shared_ptr<base::TaskRunner> task_runner)
+    : core_(core),
+      index_(index),
+      timeout_timer_(base::WaitableTimer::Type::SINGLE_SHOT, std::move(task_runner))
+{
+    DCHECK(core_);
+}
+
+void HostStatusChecker::AddressProbe::start(const std::u16string& address, uint16_t port)
+{
+    timeout_timer_.start(kAddressTimeout, [this]()
+    {
+        finish(Status::OFFLINE);
+    });
+
+    channel_.setListener(this);
+    channel_.connect(address, port);
+}
+
+void HostStatusChecker::AddressProbe::onConnected()
+{
+    // The host accepts connections, no data is sent.
+    finish(Status::ONLINE);
+}
+
+void HostStatusChecker::AddressProbe::onDisconnected(
+    base::NetworkChannel::ErrorCode /* error_code */)
+{
+    finish(Status::OFFLINE);
+}
+
+void HostStatusChecker::AddressProbe::onMessageReceived(const base::ByteArray& /* buffer */)
+{
+    // Nothing
+}
+
+void HostStatusChecker::AddressProbe::onMessageWritten(size_t /* pending */)
+{
+    // Nothing
+}
+
+void HostStatusChecker::AddressProbe::finish(Status status)
+{
+    if (finished_)
+        return;
+
+    finished_ = true;
+    timeout_timer_.stop();
+
+    core_->onAddressProbeFinished(this, index_, status);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+HostStatusChecker::Core::Core(std::shared_ptr<base::TaskRunner> io_task_runner,
+                              std::shared_ptr<base::TaskRunner> ui_task_runner,
+                              std::weak_ptr<int> lifetime,
+                              Callback callback)
+    : io_task_runner_(std::move(io_task_runner)),
+      ui_task_runner_(std::move(ui_task_runner)),
+      lifetime_(std::move(lifetime)),
+      callback_(std::move(callback))
+{
+    DCHECK(io_task_runner_);
+    DCHECK(ui_task_runner_);
+    DCHECK(callback_);
+}
+
+void HostStatusChecker::Core::start(const std::optional<RouterConfig>& router_config,
+                                    std::vector<Target>&& targets)
+{
+    DCHECK(io_task_runner_->belongsToCurrentThread());
+
+    router_config_ = router_config;
+    targets_ = std::move(targets);
+
+    ResultList unknown;
+
+    for (size_t i = 0; i < targets_.size(); ++i)
+    {
+        const Target& target = targets_[i];
+
+        if (target.host_id == base::kInvalidHostId)
+            address_targets_.emplace_back(i);
+        else if (router_config_.has_value())
+            router_targets_.emplace_back(i);
+        else
+            unknown.push_back(Result{ target.key, Status::UNKNOWN });
+    }
+
+    if (!unknown.empty())
+        report(std::move(unknown));
+
+    if (!router_targets_.empty())
+    {
+        router_timer_ = std::make_unique<base::WaitableTimer>(
+            base::WaitableTimer::Type::SINGLE_SHOT, io_task_runner_);
+        router_timer_->start(kRouterTimeout, [this]()
+        {
+            LOG(LS_WARNING) << "Timeout of the host status request";
+            finishRouterQuery();
+        });
+
+        router_channel_ = std::make_unique<base::NetworkChannel>();
+        router_channel_->setListener(this);
+        router_channel_->connect(router_config_->address, router_config_->port);
+    }
+
+    startAddressProbes();
+}
+
+void HostStatusChecker::Core::stop()
+{
+    DCHECK(io_task_runner_->belongsToCurrentThread());
+
+    router_timer_.reset();
+    authenticator_.reset();
+    router_channel_.reset();
+    address_probes_.clear();
+
+    router_targets_.clear();
+    address_targets_.clear();
+}
+
+void HostStatusChecker::Core::onAddressProbeFinished(
+    AddressProbe* probe, size_t index, Status status)
+{
+    report({ Result{ targets_[index].key, status } });
+
+    auto it = std::find_if(address_probes_.begin(), address_probes_.end(),
+                           [probe](const std::unique_ptr<AddressProbe>& item)
+    {
+        return item.get() == probe;
+    });
+
+    if (it != address_probes_.end())
+    {
+        // The probe is still on the call stack.
+        io_task_runner_->deleteSoon(std::move(*it));
+        address_probes_.erase(it);
+    }
+
+    startAddressProbes();
+}
+
+void HostStatusChecker::Core::onConnected()
+{
+    router_channel_->setOwnKeepAlive(true);
+    router_channel_->setNoDelay(true);
+
+    authenticator_ = std::make_unique<base::ClientAuthenticator>(io_task_runner_);
+
+    authenticator_->setIdentify(proto::IDENTIFY_SRP);
+    authenticator_->setUserName(router_config_->username);
+    authenticator_->setPassword(router_config_->password);
+    authenticator_->setSessionType(proto::ROUTER_SESSION_CLIENT);
+
+    authenticator_->start(std::move(router_channel_),
+                          [this](base::ClientAuthenticator::ErrorCode error_code)
+    {
+        if (error_code == base::ClientAuthenticator::ErrorCode::SUCCESS)
+        {
+            router_channel_ = authenticator_->takeChannel();
+            router_channel_->setListener(this);
+            router_channel_->resume();
+
+            sendNextRouterRequest();
+        }
+        else
+        {
+            LOG(LS_WARNING) << "Authentication on the router failed: "
+                            << base::ClientAuthenticator::errorToString(error_code);
+            finishRouterQuery();
+        }
+
+        io_task_runner_->deleteSoon(std::move(authenticator_));
+    });
+}
+
+void HostStatusChecker::Core::onDisconnected(base::NetworkChannel::ErrorCode error_code)
+{
+    LOG(LS_WARNING) << "Connection to the router is lost ("
+                    << base::NetworkChannel::errorToString(error_code) << ")";
+    finishRouterQuery();
+}
+
+void HostStatusChecker::Core::onMessageReceived(const base::ByteArray& buffer)
+{
+    proto::RouterToPeer message;
+    if (!base::parse(buffer, &message) || !message.has_host_status_list())
+    {
+        LOG(LS_WARNING) << "Unhandled message from router";
+        return;
+    }
+
+    const proto::HostStatusList& host_status_list = message.host_status_list();
+    const std::unordered_set<base::HostId> online(host_status_list.online_host_id().begin(),
+                                                  host_status_list.online_host_id().end());
+
+    ResultList results;
+
+    // The router answers the requests in order.
+    for (; router_answered_ < router_requested_; ++router_answered_)
+    {
+        const Target& target = targets_[router_targets_[router_answered_]];
+        const bool is_online = online.find(target.host_id) != online.end();
+
+        results.push_back(Result{ target.key, is_online ? Status::ONLINE : Status::OFFLINE });
+    }
+
+    report(std::move(results));
+
+    if (router_requested_ < router_targets_.size())
+        sendNextRouterRequest();
+    else
+        finishRouterQuery();
+}
+
+void HostStatusChecker::Core::onMessageWritten(size_t /* pending */)
+{
+    // Nothing
+}
+
+void HostStatusChecker::Core::sendNextRouterRequest()
+{
+    proto::PeerToRouter message;
+    proto::CheckHostStatusList* request = message.mutable_check_host_status_list();
+
+    const size_t end = std::min(router_targets_.size(), router_requested_ + kMaxHostsPerRequest);
+
+    for (; router_requested_ < end; ++router_requested_)
+        request->add_host_id(targets_[router_targets_[router_requested_]].host_id);
+
+    router_channel_->send(base::serialize(message));
+}
+
+void HostStatusChecker::Core::finishRouterQuery()
+{
+    if (router_timer_)
+        router_timer_->stop();
+
+    // The status of the hosts without an answer stays unknown. Routers of older versions do not
+    // answer bulk requests.
+    ResultList results;
+
+    for (; router_answered_ < router_targets_.size(); ++router_answered_)
+    {
+        const Target& target = targets_[router_targets_[router_answered_]];
+        results.push_back(Result{ target.key, Status::UNKNOWN });
+    }
+
+    if (!results.empty())
+        report(std::move(results));
+
+    router_requested_ = router_targets_.size();
+
+    if (router_channel_)
+        io_task_runner_->deleteSoon(std::move(router_channel_));
+}
+
+void HostStatusChecker::Core::startAddressProbes()
+{
+    while (address_probes_.size() < kMaxAddressProbes && next_address_ < address_targets_.size())
+    {
+        const size_t index = address_targets_[next_address_++];
+
+        std::unique_ptr<AddressProbe> probe =
+            std::make_unique<AddressProbe>(this, index, io_task_runner_);
+        AddressProbe* probe_ptr = probe.get();
+
+        address_probes_.emplace_back(std::move(probe));
+        probe_ptr->start(targets_[index].address, targets_[index].port);
+    }
+}
+
+void HostStatusChecker::Core::report(ResultList&& results)
+{
+    ui_task_runner_->postTask(
+        [lifetime = lifetime_, callback = callback_, results = std::move(results)]()
+    {
+        // The checker is destroyed on the UI thread, so the check is reliable here.
+        if (lifetime.expired())
+            return;
+
+        callback(results);
+    });
+}
+
+//--------------------------------------------------------------------------------------------------
+
+HostStatusChecker::HostStatusChecker(std::shared_ptr<base::TaskRunner> io_task_runner,
+                                     std::shared_ptr<base::TaskRunner> ui_task_runner)
+    : io_task_runner_(std::move(io_task_runner)),
+      ui_task_runner_(std::move(ui_task_runner))
+{
+    DCHECK(io_task_runner_);
+    DCHECK(ui_task_runner_);
+}
+
+HostStatusChecker::~HostStatusChecker()
+{
+    cancel();
+}
+
+void HostStatusChecker::check(const std::optional<RouterConfig>& router_config,
+                              std::vector<Target>&& targets,
+                              Callback callback)
+{
+    DCHECK(ui_task_runner_->belongsToCurrentThread());
+
+    cancel();
+
+    if (targets.empty())
+        return;
+
+    check_lifetime_ = std::make_shared<int>(0);
+    core_ = std::make_shared<Core>(
+        io_task_runner_, ui_task_runner_, check_lifetime_, std::move(callback));
+
+    io_task_runner_->postTask(
+        [core = core_, router_config, targets = std::move(targets)]() mutable
+    {
+        core->start(router_config, std::move(targets));
+    });
+}
+
+void HostStatusChecker::cancel()
+{
+    check_lifetime_.reset();
+
+    if (!core_)
+        return;
+
+    // The core is destroyed on the I/O thread with the last task that holds it.
+    io_task_runner_->postTask([core = std::move(core_)]()
+    {
+        core->stop();
+    });
+}
+
+} // namespace client
@@ -0,0 +1,104 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT__HOST_STATUS_CHECKER_H
+#define CLIENT__HOST_STATUS_CHECKER_H
+
+#include "base/macros_magic.h"
+#include "base/peer/host_id.h"
+#include "client/router_config.h"
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace base {
+class TaskRunner;
+} // namespace base
+
+namespace client {
+
+// Checks which hosts are online without connecting to their sessions. The hosts with an ID are
+// checked through one connection to the router with bulk requests. The hosts with an address are
+// checked by opening a TCP connection to them, a limited number at a time.
+class HostStatusChecker
+{
+public:
+    HostStatusChecker(std::shared_ptr<base::TaskRunner> io_task_runner,
+                      std::shared_ptr<base::TaskRunner> ui_task_runner);
+    ~HostStatusChecker();
+
+    enum class Status
+    {
+        UNKNOWN,
+        ONLINE,
+        OFFLINE
+    };
+
+    struct Target
+    {
+        // Identifies the host in the results.
+        std::u16string key;
+
+        // If the ID is valid, the host is checked through the router. Otherwise the address and
+        // the port are used.
+        base::HostId host_id = base::kInvalidHostId;
+        std::u16string address;
+        uint16_t port = 0;
+    };
+
+    struct Result
+    {
+        std::u16string key;
+        Status status;
+    };
+
+    using ResultList = std::vector<Result>;
+
+    // Called on the UI thread. The results of one check come in several parts. The callback is
+    // not called after the check is cancelled or the checker is destroyed.
+    using Callback = std::function<void(const ResultList& results)>;
+
+    // Starts a new check. The previous check is cancelled.
+    void check(const std::optional<RouterConfig>& router_config,
+               std::vector<Target>&& targets,
+               Callback callback);
+
+    // Cancels the current check.
+    void cancel();
+
+private:
+    class AddressProbe;
+    class Core;
+
+    std::shared_ptr<base::TaskRunner> io_task_runner_;
+    std::shared_ptr<base::TaskRunner> ui_task_runner_;
+
+    // Lives on the I/O thread.
+    std::shared_ptr<Core> core_;
+
+    // Expires when the current check is cancelled.
+    std::shared_ptr<int> check_lifetime_;
+
+    DISALLOW_COPY_AND_ASSIGN(HostStatusChecker);
+};
+
+} // namespace client
+
+#endif // CLIENT__HOST_STATUS_CHECKER_H
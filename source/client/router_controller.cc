@@ -183,6 +183,15 @@ void RouterController::onMessageReceived(const base::ByteArray& buffer)
         {
             relay_peer_ = std::make_unique<base::RelayPeer>();
             relay_peer_->start(connection_offer.relay(), this);
+
+            if (connection_offer.candidate_size() > 0)
+            {
+                LOG(LS_INFO) << "Trying direct connection ("
+                             << connection_offer.candidate_size() << " candidates)";
+
+                direct_peer_ = std::make_unique<base::DirectPeer>(task_runner_);
+                direct_peer_->start(connection_offer.candidate(), this);
+            }
         }
     }
     else
@@ -197,6 +206,61 @@ void RouterController::onMessageWritten(size_t /* pending */)
 }
 
 void RouterController::onRelayConnectionReady(std::unique_ptr<base::NetworkChannel> channel)
+{
+    if (isDirectPending())
+    {
+        LOG(LS_INFO) << "Relay connection is ready. Waiting for direct connection";
+        relay_channel_ = std::move(channel);
+        return;
+    }
+
+    hostConnected(std::move(channel));
+}
+
+void RouterController::onRelayConnectionError()
+{
+    if (isDirectPending())
+    {
+        LOG(LS_INFO) << "Relay connection failed. Waiting for direct connection";
+        relay_failed_ = true;
+        return;
+    }
+
+    relayError();
+}
+
+void RouterController::onDirectConnectionReady(std::unique_ptr<base::NetworkChannel> channel)
+{
+    LOG(LS_INFO) << "Using direct connection";
+
+    // The host drops the relay connection when it is closed.
+    relay_channel_.reset();
+    hostConnected(std::move(channel));
+}
+
+void RouterController::onDirectConnectionError()
+{
+    if (relay_channel_)
+    {
+        LOG(LS_INFO) << "Direct connection failed. Using relay connection";
+        hostConnected(std::move(relay_channel_));
+    }
+    else if (relay_failed_)
+    {
+        relayError();
+    }
+    else
+    {
+        LOG(LS_INFO) << "Direct connection failed. Waiting for relay connection";
+    }
+}
+
+bool RouterController::isDirectPending() const
+{
+    return direct_peer_ && !direct_peer_->isFinished();
+}
+
+void RouterController::hostConnected(std::unique_ptr<base::NetworkChannel> channel)
 {
     if (delegate_)
     {
@@ -208,7 +272,7 @@ void RouterController::onRelayConnectionReady(std::unique_ptr<base::NetworkChann
     }
 }
 
-void RouterController::onRelayConnectionError()
+void RouterController::relayError()
 {
     if (!delegate_)
     {
@@ -22,6 +22,7 @@
 #include "base/waitable_timer.h"
 #include "base/net/network_channel.h"
 #include "base/peer/authenticator.h"
+#include "base/peer/direct_peer.h"
 #include "base/peer/host_id.h"
 #include "base/peer/relay_peer.h"
 #include "client/router_config.h"
@@ -34,7 +35,8 @@ namespace client {
 
 class RouterController
     : public base::NetworkChannel::Listener,
-      public base::RelayPeer::Delegate
+      public base::RelayPeer::Delegate,
+      public base::DirectPeer::Delegate
 {
 public:
     enum class ErrorType
@@ -92,11 +94,25 @@ protected:
     void onRelayConnectionReady(std::unique_ptr<base::NetworkChannel> channel) override;
     void onRelayConnectionError() override;
 
+    // base::DirectPeer::Delegate implementation.
+    void onDirectConnectionReady(std::unique_ptr<base::NetworkChannel> channel) override;
+    void onDirectConnectionError() override;
+
 private:
+    bool isDirectPending() const;
+    void hostConnected(std::unique_ptr<base::NetworkChannel> channel);
+    void relayError();
+
     std::shared_ptr<base::TaskRunner> task_runner_;
     std::unique_ptr<base::NetworkChannel> channel_;
     std::unique_ptr<base::ClientAuthenticator> authenticator_;
     std::unique_ptr<base::RelayPeer> relay_peer_;
+
+    // The direct connection is preferred. The relay connection is held while the direct one is
+    // being established and is used if it fails.
+    std::unique_ptr<base::DirectPeer> direct_peer_;
+    std::unique_ptr<base::NetworkChannel> relay_channel_;
+    bool relay_failed_ = false;
     RouterConfig router_config_;
 
     base::HostId host_id_ = base::kInvalidHostId;
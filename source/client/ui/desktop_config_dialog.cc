@@ -21,6 +21,7 @@
 #include "base/logging.h"
 #include "base/desktop/pixel_format.h"
 #include "client/config_factory.h"
+#include "common/desktop_session_constants.h"
 #include "ui_desktop_config_dialog.h"
 
 #include <QTimer>
@@ -79,6 +80,12 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
 
     QComboBox* combo_codec = ui->combo_codec;
 
+    // The host can support encodings which are not supported by the client.
+    video_encodings &= common::kSupportedVideoEncodings;
+
+    if (video_encodings & proto::VIDEO_ENCODING_H264)
+        combo_codec->addItem(QStringLiteral("H.264"), proto::VIDEO_ENCODING_H264);
+
     if (video_encodings & proto::VIDEO_ENCODING_VP9)
         combo_codec->addItem(QStringLiteral("VP9"), proto::VIDEO_ENCODING_VP9);
 
@@ -88,6 +95,9 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
     if (video_encodings & proto::VIDEO_ENCODING_ZSTD)
         combo_codec->addItem(QStringLiteral("ZSTD"), proto::VIDEO_ENCODING_ZSTD);
 
+    if (video_encodings & proto::VIDEO_ENCODING_HYBRID)
+        combo_codec->addItem(QStringLiteral("VP9 + ZSTD"), proto::VIDEO_ENCODING_HYBRID);
+
     int current_codec = combo_codec->findData(config_.video_encoding());
     if (current_codec == -1)
         current_codec = 0;
@@ -163,6 +173,9 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
     if (config_.flags() & proto::DISABLE_FONT_SMOOTHING)
         ui->checkbox_font_smoothing->setChecked(true);
 
+    if (config_.flags() & proto::MATCH_RESOLUTION)
+        ui->checkbox_match_resolution->setChecked(true);
+
     connect(combo_codec, QOverload<int>::of(&QComboBox::currentIndexChanged),
             this, &DesktopConfigDialog::onCodecChanged);
 
@@ -183,8 +196,9 @@ DesktopConfigDialog::~DesktopConfigDialog() = default;
 
 void DesktopConfigDialog::onCodecChanged(int item_index)
 {
-    bool has_pixel_format =
-        (ui->combo_codec->itemData(item_index).toInt() == proto::VIDEO_ENCODING_ZSTD);
+    const int video_encoding = ui->combo_codec->itemData(item_index).toInt();
+    bool has_pixel_format = (video_encoding == proto::VIDEO_ENCODING_ZSTD ||
+                             video_encoding == proto::VIDEO_ENCODING_HYBRID);
 
     ui->label_color_depth->setEnabled(has_pixel_format);
     ui->combobox_color_depth->setEnabled(has_pixel_format);
@@ -208,7 +222,8 @@ void DesktopConfigDialog::onButtonBoxClicked(QAbstractButton* button)
 
         config_.set_video_encoding(video_encoding);
 
-        if (video_encoding == proto::VIDEO_ENCODING_ZSTD)
+        if (video_encoding == proto::VIDEO_ENCODING_ZSTD ||
+            video_encoding == proto::VIDEO_ENCODING_HYBRID)
         {
             base::PixelFormat pixel_format;
 
@@ -269,6 +284,9 @@ void DesktopConfigDialog::onButtonBoxClicked(QAbstractButton* button)
         if (ui->checkbox_font_smoothing->isChecked())
             flags |= proto::DISABLE_FONT_SMOOTHING;
 
+        if (ui->checkbox_match_resolution->isChecked())
+            flags |= proto::MATCH_RESOLUTION;
+
         if (ui->checkbox_block_remote_input->isChecked())
             flags |= proto::BLOCK_REMOTE_INPUT;
 
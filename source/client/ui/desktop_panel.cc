@@ -65,6 +65,7 @@ DesktopPanel::DesktopPanel(proto::SessionType session_type, QWidget* parent)
     });
 
     ui.action_autoscroll->setChecked(settings_.autoScrolling());
+    ui.action_smooth_scaling->setChecked(settings_.smoothScaling());
 
     scale_ = settings_.scale();
 
@@ -78,9 +79,13 @@ DesktopPanel::DesktopPanel(proto::SessionType session_type, QWidget* parent)
     connect(ui.action_autosize, &QAction::triggered, this, &DesktopPanel::onAutosizeButton);
     connect(ui.action_fullscreen, &QAction::triggered, this, &DesktopPanel::onFullscreenButton);
     connect(ui.action_autoscroll, &QAction::triggered, this, &DesktopPanel::autoScrollChanged);
+    connect(ui.action_smooth_scaling, &QAction::triggered,
+            this, &DesktopPanel::smoothScalingChanged);
     connect(ui.action_update, &QAction::triggered, this, &DesktopPanel::startRemoteUpdate);
     connect(ui.action_system_info, &QAction::triggered, this, &DesktopPanel::startSystemInfo);
     connect(ui.action_statistics, &QAction::triggered, this, &DesktopPanel::startStatistics);
+    connect(ui.action_performance_overlay, &QAction::triggered,
+            this, &DesktopPanel::performanceOverlayChanged);
     connect(ui.action_minimize, &QAction::triggered, this, &DesktopPanel::minimizeSession);
     connect(ui.action_close, &QAction::triggered, this, &DesktopPanel::closeSession);
 
@@ -112,6 +117,7 @@ DesktopPanel::~DesktopPanel()
 {
     settings_.setScale(scale_);
     settings_.setAutoScrolling(ui.action_autoscroll->isChecked());
+    settings_.setSmoothScaling(ui.action_smooth_scaling->isChecked());
 
     // Save the parameter only for desktop management.
     if (session_type_ == proto::SESSION_TYPE_DESKTOP_MANAGE)
@@ -291,6 +297,11 @@ bool DesktopPanel::autoScrolling() const
     return ui.action_autoscroll->isChecked();
 }
 
+bool DesktopPanel::smoothScaling() const
+{
+    return ui.action_smooth_scaling->isChecked();
+}
+
 bool DesktopPanel::sendKeyCombinations() const
 {
     return ui.action_send_key_combinations->isChecked();
@@ -477,6 +488,8 @@ void DesktopPanel::createAdditionalMenu(proto::SessionType session_type)
     scale_menu_->addAction(ui.action_fit_window);
     scale_menu_->addSeparator();
     scale_menu_->addActions(scale_group_->actions());
+    scale_menu_->addSeparator();
+    scale_menu_->addAction(ui.action_smooth_scaling);
 
     updateScaleMenu();
 
@@ -488,6 +501,7 @@ void DesktopPanel::createAdditionalMenu(proto::SessionType session_type)
     additional_menu_->addSeparator();
     additional_menu_->addAction(ui.action_screenshot);
     additional_menu_->addAction(ui.action_statistics);
+    additional_menu_->addAction(ui.action_performance_overlay);
 
     // Set the menu for the button on the toolbar.
     ui.action_menu->setMenu(additional_menu_);
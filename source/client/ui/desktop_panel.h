@@ -44,6 +44,7 @@ public:
 
     int scale() const { return scale_; }
     bool autoScrolling() const;
+    bool smoothScaling() const;
     bool sendKeyCombinations() const;
     bool isPanelHidden() const;
     bool isPanelPinned() const;
@@ -57,6 +58,7 @@ signals:
     void screenSelected(const proto::Screen& screen);
     void scaleChanged();
     void autoScrollChanged(bool enabled);
+    void smoothScalingChanged(bool enabled);
     void keyCombinationsChanged(bool enabled);
     void takeScreenshot();
     void startSession(proto::SessionType session_type);
@@ -64,6 +66,7 @@ signals:
     void startRemoteUpdate();
     void startSystemInfo();
     void startStatistics();
+    void performanceOverlayChanged(bool enabled);
     void minimizeSession();
     void closeSession();
 
@@ -25,6 +25,7 @@ namespace {
 const QString kScaleParam = QStringLiteral("Desktop/Scale");
 const QString kAutoScrollingParam = QStringLiteral("Desktop/AutoScrolling");
 const QString kSendKeyCombinationsParam = QStringLiteral("Desktop/SendKeyCombinations");
+const QString kSmoothScalingParam = QStringLiteral("Desktop/SmoothScaling");
 
 } // namespace
 
@@ -82,4 +83,14 @@ void DesktopSettings::setSendKeyCombinations(bool enable)
     settings_.setValue(kSendKeyCombinationsParam, enable);
 }
 
+bool DesktopSettings::smoothScaling() const
+{
+    return settings_.value(kSmoothScalingParam, true).toBool();
+}
+
+void DesktopSettings::setSmoothScaling(bool enable)
+{
+    settings_.setValue(kSmoothScalingParam, enable);
+}
+
 } // namespace client
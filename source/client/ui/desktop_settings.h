@@ -39,6 +39,9 @@ public:
     bool sendKeyCombinations() const;
     void setSendKeyCombinations(bool enable);
 
+    bool smoothScaling() const;
+    void setSmoothScaling(bool enable);
+
 private:
     QSettings settings_;
 
@@ -19,12 +19,19 @@
 #include "client/ui/desktop_widget.h"
 
 #include "base/logging.h"
+#include "base/trace_event.h"
 #include "common/keycode_converter.h"
 #include "client/ui/frame_qimage.h"
 
 #include <QApplication>
+#include <QOpenGLContext>
+#include <QTimer>
 #include <QWheelEvent>
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 #if defined(OS_LINUX)
 #include <X11/XKBlib.h>
 #if defined(KeyPress)
@@ -42,6 +49,43 @@ namespace {
 
 constexpr uint32_t kWheelMask = proto::MouseEvent::WHEEL_DOWN | proto::MouseEvent::WHEEL_UP;
 
+// Repaint interval while the remote cursor moves between two received positions.
+constexpr int kCursorTimerInterval = 16; // ms
+
+// If the positions come less often, the cursor stood still and jumps to the new position.
+constexpr qint64 kMaxCursorMoveDuration = 100; // ms
+
+// OpenGL ES 2.0 headers do not define this constant.
+#if !defined(GL_UNPACK_ROW_LENGTH)
+#define GL_UNPACK_ROW_LENGTH 0x0CF2
+#endif
+
+const char kVertexShader[] =
+    "attribute vec2 position;\n"
+    "attribute vec2 tex_coord;\n"
+    "varying vec2 v_tex_coord;\n"
+    "void main()\n"
+    "{\n"
+    "    v_tex_coord = tex_coord;\n"
+    "    gl_Position = vec4(position, 0.0, 1.0);\n"
+    "}\n";
+
+// The frame pixels are stored as BGRA in memory and are uploaded as RGBA, so the color
+// components are swapped here.
+const char kFragmentShader[] =
+    "#ifdef GL_ES\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "varying vec2 v_tex_coord;\n"
+    "uniform sampler2D frame;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = vec4(texture2D(frame, v_tex_coord).bgr, 1.0);\n"
+    "}\n";
+
+const GLfloat kVertices[] = { -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f, -1.0f };
+const GLfloat kTexCoords[] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f };
+
 bool isNumLockActivated()
 {
 #if defined(OS_WIN)
@@ -103,13 +147,24 @@ bool isModifierKey(int key)
 } // namespace
 
 DesktopWidget::DesktopWidget(QWidget* parent)
-    : QWidget(parent)
+    : QOpenGLWidget(parent)
 {
     setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
     setFocusPolicy(Qt::StrongFocus);
     setAttribute(Qt::WA_OpaquePaintEvent);
     setAttribute(Qt::WA_NoSystemBackground);
     setMouseTracking(true);
+
+    cursor_timer_ = new QTimer(this);
+    cursor_timer_->setInterval(kCursorTimerInterval);
+    connect(cursor_timer_, &QTimer::timeout, this, &DesktopWidget::onCursorTimer);
+}
+
+DesktopWidget::~DesktopWidget()
+{
+    makeCurrent();
+    cleanupGL();
+    doneCurrent();
 }
 
 base::Frame* DesktopWidget::desktopFrame()
@@ -120,6 +175,34 @@ base::Frame* DesktopWidget::desktopFrame()
 void DesktopWidget::setDesktopFrame(std::shared_ptr<base::Frame>& frame)
 {
     frame_ = std::move(frame);
+    full_upload_ = true;
+}
+
+void DesktopWidget::addDirtyRegion(const base::Region& dirty_region)
+{
+    dirty_region_.addRegion(dirty_region);
+    ++dirty_frames_;
+
+    if (!dirty_time_.isValid())
+        dirty_time_.start();
+}
+
+void DesktopWidget::setPerformanceOverlay(const QStringList& lines)
+{
+    if (lines.isEmpty() && overlay_lines_.isEmpty())
+        return;
+
+    overlay_lines_ = lines;
+    update();
+}
+
+void DesktopWidget::setSmoothScaling(bool enable)
+{
+    if (smooth_scaling_ == enable)
+        return;
+
+    smooth_scaling_ = enable;
+    update();
 }
 
 void DesktopWidget::setCursorShape(QPixmap&& cursor_shape, const QPoint& hotspot)
@@ -139,19 +222,38 @@ void DesktopWidget::setCursorShape(QPixmap&& cursor_shape, const QPoint& hotspot
 
 void DesktopWidget::setCursorPosition(const QPoint& cursor_position)
 {
-    remote_cursor_pos_ = cursor_position;
-
+    QPoint target = cursor_position;
     QSize widget_size = size();
 
-    if (remote_cursor_pos_.x() < 0)
-        remote_cursor_pos_.setX(0);
-    else if (remote_cursor_pos_.x() > widget_size.width())
-        remote_cursor_pos_.setX(widget_size.width());
+    if (target.x() < 0)
+        target.setX(0);
+    else if (target.x() > widget_size.width())
+        target.setX(widget_size.width());
+
+    if (target.y() < 0)
+        target.setY(0);
+    else if (target.y() > widget_size.height())
+        target.setY(widget_size.height());
 
-    if (remote_cursor_pos_.y() < 0)
-        remote_cursor_pos_.setY(0);
-    else if (remote_cursor_pos_.y() > widget_size.height())
-        remote_cursor_pos_.setY(widget_size.height());
+    const qint64 interval = cursor_update_time_.isValid() ? cursor_update_time_.restart() : -1;
+    if (!cursor_update_time_.isValid())
+        cursor_update_time_.start();
+
+    if (interval <= 0 || interval > kMaxCursorMoveDuration)
+    {
+        cursor_timer_->stop();
+        remote_cursor_pos_ = target;
+        return;
+    }
+
+    // The next position is expected after the same interval.
+    cursor_move_from_ = remote_cursor_pos_;
+    cursor_move_to_ = target;
+    cursor_move_duration_ = interval;
+    cursor_move_time_.start();
+
+    if (!cursor_timer_->isActive())
+        cursor_timer_->start();
 }
 
 void DesktopWidget::doMouseEvent(QEvent::Type event_type,
@@ -341,6 +443,13 @@ void DesktopWidget::enableKeyCombinations(bool enable)
 void DesktopWidget::enableRemoteCursorPosition(bool enable)
 {
     enable_remote_cursor_pos_ = enable;
+
+    if (!enable)
+    {
+        cursor_timer_->stop();
+        cursor_update_time_.invalidate();
+    }
+
     update();
 }
 
@@ -351,39 +460,155 @@ void DesktopWidget::userLeftFromWindow()
     releaseKeyboardButtons();
 }
 
-void DesktopWidget::paintEvent(QPaintEvent* /* event */)
+void DesktopWidget::initializeGL()
+{
+    initializeOpenGLFunctions();
+
+    connect(context(), &QOpenGLContext::aboutToBeDestroyed, this, [this]()
+    {
+        makeCurrent();
+        cleanupGL();
+        doneCurrent();
+    });
+
+    std::unique_ptr<QOpenGLShaderProgram> program = std::make_unique<QOpenGLShaderProgram>();
+
+    if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, kVertexShader) ||
+        !program->addShaderFromSourceCode(QOpenGLShader::Fragment, kFragmentShader) ||
+        !program->link())
+    {
+        LOG(LS_WARNING) << "Unable to build shader program: " << program->log().toStdString()
+                        << ". Frames will be drawn without OpenGL";
+        return;
+    }
+
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size_);
+    glGenTextures(1, &texture_);
+    glBindTexture(GL_TEXTURE_2D, texture_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    texture_filter_ = GL_LINEAR;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    // OpenGL ES 2.0 can only upload full rows of the frame.
+    QOpenGLContext* gl_context = context();
+    unpack_row_length_ =
+        !gl_context->isOpenGLES() || gl_context->format().majorVersion() >= 3;
+
+    LOG(LS_INFO) << "OpenGL renderer: "
+                 << reinterpret_cast<const char*>(glGetString(GL_RENDERER))
+                 << " (max texture size: " << max_texture_size_ << ")";
+
+    program_ = std::move(program);
+    texture_size_ = base::Size();
+    full_upload_ = true;
+}
+
+void DesktopWidget::paintGL()
 {
+    TRACE_EVENT("DesktopWidget::paintGL");
+
     FrameQImage* frame = reinterpret_cast<FrameQImage*>(frame_.get());
-    if (frame)
+    if (!frame)
+    {
+        if (program_)
+        {
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+        return;
+    }
+
+    // On HiDPI displays the widget size is in logical pixels. If the frame has the size of the
+    // widget in physical pixels, each pixel of the frame covers one pixel of the screen and no
+    // filtering is needed.
+    const bool smooth = smooth_scaling_ && !isPixelExact();
+
+    const bool use_texture = program_ && uploadTexture();
+    if (use_texture)
     {
-        painter_.begin(this);
+        const GLint filter = smooth ? GL_LINEAR : GL_NEAREST;
+        if (texture_filter_ != filter)
+        {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+            texture_filter_ = filter;
+        }
 
+        drawTexture();
+    }
+
+    painter_.begin(this);
+
+    if (!use_texture)
+    {
 #if !defined(OS_MAC)
         // SmoothPixmapTransform causes too much CPU load in MacOSX.
-        painter_.setRenderHint(QPainter::SmoothPixmapTransform);
+        painter_.setRenderHint(QPainter::SmoothPixmapTransform, smooth);
 #endif
 
         painter_.drawImage(rect(), frame->constImage());
+        dirty_region_.clear();
+    }
 
-        if (enable_remote_cursor_pos_)
+    if (enable_remote_cursor_pos_)
+    {
+        if (!remote_cursor_shape_.isNull())
         {
-            if (!remote_cursor_shape_.isNull())
-            {
-                painter_.drawPixmap(QRect(remote_cursor_pos_ - remote_cursor_hotspot_,
-                                          remote_cursor_shape_.size()),
-                                    remote_cursor_shape_,
-                                    remote_cursor_shape_.rect());
-            }
-            else
-            {
-                painter_.setBrush(QBrush(Qt::black));
-                painter_.setPen(QPen(Qt::white));
-                painter_.drawEllipse(remote_cursor_pos_, 3, 3);
-            }
+            painter_.drawPixmap(QRect(remote_cursor_pos_ - remote_cursor_hotspot_,
+                                      remote_cursor_shape_.size()),
+                                remote_cursor_shape_,
+                                remote_cursor_shape_.rect());
+        }
+        else
+        {
+            painter_.setBrush(QBrush(Qt::black));
+            painter_.setPen(QPen(Qt::white));
+            painter_.drawEllipse(remote_cursor_pos_, 3, 3);
         }
+    }
+
+    if (!overlay_lines_.isEmpty())
+    {
+        static const int kMargin = 6;
+
+        const QFontMetrics font_metrics = painter_.fontMetrics();
+        const int line_height = font_metrics.height();
+
+        int width = 0;
+        for (const auto& line : overlay_lines_)
+            width = std::max(width, font_metrics.horizontalAdvance(line));
 
-        painter_.end();
+        const QRect overlay_rect(kMargin, kMargin, width + kMargin * 2,
+                                 line_height * overlay_lines_.size() + kMargin * 2);
+
+        painter_.fillRect(overlay_rect, QColor(0, 0, 0, 160));
+        painter_.setPen(Qt::white);
+
+        const int baseline = overlay_rect.top() + kMargin + font_metrics.ascent();
+
+        for (int i = 0; i < overlay_lines_.size(); ++i)
+        {
+            painter_.drawText(overlay_rect.left() + kMargin, baseline + line_height * i,
+                              overlay_lines_[i]);
+        }
     }
+
+    painter_.end();
+
+    if (dirty_time_.isValid())
+    {
+        std::chrono::microseconds paint_time(dirty_time_.nsecsElapsed() / 1000);
+        paint_time_ = (paint_time + paint_time_ * 9) / 10;
+        dirty_time_.invalidate();
+    }
+
+    // All the frames that came since the last repaint are painted at once.
+    if (dirty_frames_ > 1)
+        dropped_frames_ += dirty_frames_ - 1;
+    dirty_frames_ = 0;
 }
 
 void DesktopWidget::mouseMoveEvent(QMouseEvent* event)
@@ -495,6 +720,134 @@ void DesktopWidget::releaseKeyboardButtons()
     }
 }
 
+bool DesktopWidget::isPixelExact() const
+{
+    const qreal ratio = devicePixelRatioF();
+
+    return frame_->size().equals(base::Size(qRound(width() * ratio), qRound(height() * ratio)));
+}
+
+bool DesktopWidget::uploadTexture()
+{
+    const base::Size& size = frame_->size();
+
+    if (size.width() > max_texture_size_ || size.height() > max_texture_size_ ||
+        frame_->stride() != size.width() * static_cast<int>(sizeof(uint32_t)))
+    {
+        return false;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture_);
+
+    if (full_upload_ || !texture_size_.equals(size))
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.width(), size.height(), 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, frame_->frameData());
+
+        texture_size_ = size;
+        full_upload_ = false;
+        dirty_region_.clear();
+        return true;
+    }
+
+    dirty_region_.intersectWith(base::Rect::makeSize(size));
+
+    if (unpack_row_length_)
+    {
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, size.width());
+
+        for (base::Region::Iterator it(dirty_region_); !it.isAtEnd(); it.advance())
+        {
+            const base::Rect& rect = it.rect();
+
+            glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x(), rect.y(), rect.width(), rect.height(),
+                            GL_RGBA, GL_UNSIGNED_BYTE, frame_->frameDataAtPos(rect.topLeft()));
+        }
+
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+    else
+    {
+        // Without GL_UNPACK_ROW_LENGTH the changed rows of the frame are uploaded entirely.
+        std::vector<std::pair<int, int>> bands;
+
+        for (base::Region::Iterator it(dirty_region_); !it.isAtEnd(); it.advance())
+            bands.emplace_back(it.rect().top(), it.rect().bottom());
+
+        std::sort(bands.begin(), bands.end());
+
+        size_t count = 0;
+        for (size_t i = 0; i < bands.size(); ++i)
+        {
+            if (count != 0 && bands[i].first <= bands[count - 1].second)
+                bands[count - 1].second = std::max(bands[count - 1].second, bands[i].second);
+            else
+                bands[count++] = bands[i];
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, bands[i].first,
+                            size.width(), bands[i].second - bands[i].first,
+                            GL_RGBA, GL_UNSIGNED_BYTE, frame_->frameDataAtPos(0, bands[i].first));
+        }
+    }
+
+    dirty_region_.clear();
+    return true;
+}
+
+void DesktopWidget::drawTexture()
+{
+    glDisable(GL_BLEND);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture_);
+
+    program_->bind();
+    program_->setUniformValue("frame", 0);
+    program_->enableAttributeArray("position");
+    program_->enableAttributeArray("tex_coord");
+    program_->setAttributeArray("position", kVertices, 2);
+    program_->setAttributeArray("tex_coord", kTexCoords, 2);
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    program_->disableAttributeArray("tex_coord");
+    program_->disableAttributeArray("position");
+    program_->release();
+}
+
+void DesktopWidget::cleanupGL()
+{
+    if (!program_)
+        return;
+
+    glDeleteTextures(1, &texture_);
+    texture_ = 0;
+    texture_size_ = base::Size();
+    program_.reset();
+}
+
+void DesktopWidget::onCursorTimer()
+{
+    const qint64 elapsed = cursor_move_time_.elapsed();
+
+    if (elapsed >= cursor_move_duration_)
+    {
+        remote_cursor_pos_ = cursor_move_to_;
+        cursor_timer_->stop();
+    }
+    else
+    {
+        const double progress =
+            static_cast<double>(elapsed) / static_cast<double>(cursor_move_duration_);
+
+        remote_cursor_pos_ = cursor_move_from_ + (cursor_move_to_ - cursor_move_from_) * progress;
+    }
+
+    update();
+}
+
 #if defined(OS_WIN)
 // static
 LRESULT CALLBACK DesktopWidget::keyboardHookProc(INT code, WPARAM wparam, LPARAM lparam)
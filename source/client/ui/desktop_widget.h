@@ -20,6 +20,7 @@
 #define CLIENT__UI__DESKTOP_WIDGET_H
 
 #include "base/desktop/frame.h"
+#include "base/desktop/region.h"
 #include "build/build_config.h"
 #include "proto/desktop.pb.h"
 
@@ -27,25 +28,54 @@
 #include "base/win/scoped_user_object.h"
 #endif // defined(OS_WIN)
 
+#include <QElapsedTimer>
 #include <QEvent>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLWidget>
 #include <QPainter>
-#include <QWidget>
+#include <QStringList>
 
+#include <chrono>
 #include <memory>
 #include <set>
 
+class QTimer;
+
 namespace client {
 
-class DesktopWidget : public QWidget
+// The frame is stored in a texture and scaled by the GPU. Only the changed areas of the frame are
+// uploaded to the texture. If OpenGL is not available, the frame is drawn with QPainter.
+class DesktopWidget
+    : public QOpenGLWidget,
+      protected QOpenGLFunctions
 {
     Q_OBJECT
 
 public:
     explicit DesktopWidget(QWidget* parent);
-    ~DesktopWidget() = default;
+    ~DesktopWidget();
 
     base::Frame* desktopFrame();
     void setDesktopFrame(std::shared_ptr<base::Frame>& frame);
+
+    // Adds the area of the frame that has changed and must be uploaded to the texture on the next
+    // repaint.
+    void addDirtyRegion(const base::Region& dirty_region);
+
+    // Average time from the arrival of the frame changes until they are painted.
+    std::chrono::microseconds paintTime() const { return paint_time_; }
+
+    // Number of frames replaced by the next frame before they were painted.
+    int64_t droppedFrames() const { return dropped_frames_; }
+
+    // Shows the lines of text over the top left corner of the image. An empty list hides them.
+    void setPerformanceOverlay(const QStringList& lines);
+
+    // Selects the filter used when the frame does not match the widget in physical pixels. When
+    // it matches, the pixels are copied as is.
+    void setSmoothScaling(bool enable);
+
     void setCursorShape(QPixmap&& cursor_shape, const QPoint& hotspot);
     void setCursorPosition(const QPoint& cursor_position);
 
@@ -69,8 +99,11 @@ signals:
     void sig_keyEvent(const proto::KeyEvent& event);
 
 protected:
+    // QOpenGLWidget implementation.
+    void initializeGL() override;
+    void paintGL() override;
+
     // QWidget implementation.
-    void paintEvent(QPaintEvent* event) override;
     void mouseMoveEvent(QMouseEvent* event) override;
     void mousePressEvent(QMouseEvent* event) override;
     void mouseReleaseEvent(QMouseEvent* event) override;
@@ -86,9 +119,32 @@ private:
     void enableKeyHooks(bool enable);
     void releaseMouseButtons();
     void releaseKeyboardButtons();
+    bool isPixelExact() const;
+    bool uploadTexture();
+    void drawTexture();
+    void cleanupGL();
+    void onCursorTimer();
 
     QPainter painter_;
 
+    std::unique_ptr<QOpenGLShaderProgram> program_;
+    GLuint texture_ = 0;
+    GLint max_texture_size_ = 0;
+    bool unpack_row_length_ = false;
+    base::Size texture_size_;
+    base::Region dirty_region_;
+    bool full_upload_ = true;
+    GLint texture_filter_ = GL_LINEAR;
+    bool smooth_scaling_ = true;
+
+    // Started by the first change of the frame after the last repaint.
+    QElapsedTimer dirty_time_;
+    std::chrono::microseconds paint_time_ { 0 };
+    int dirty_frames_ = 0;
+    int64_t dropped_frames_ = 0;
+
+    QStringList overlay_lines_;
+
 #if defined(OS_WIN)
     static LRESULT CALLBACK keyboardHookProc(INT code, WPARAM wparam, LPARAM lparam);
     base::win::ScopedHHOOK keyboard_hook_;
@@ -102,6 +158,15 @@ private:
     QPoint remote_cursor_pos_;
     QPoint remote_cursor_hotspot_;
 
+    // The host sends the cursor position once per captured frame. Between the updates the cursor
+    // moves from the previous position to the new one during the last interval between updates.
+    QTimer* cursor_timer_ = nullptr;
+    QElapsedTimer cursor_update_time_;
+    QElapsedTimer cursor_move_time_;
+    QPoint cursor_move_from_;
+    QPoint cursor_move_to_;
+    qint64 cursor_move_duration_ = 0;
+
     QPoint prev_pos_;
     uint32_t prev_mask_ = 0;
 
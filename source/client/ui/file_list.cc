@@ -76,6 +76,7 @@ FileList::FileList(QWidget* parent)
     connect(model_, &FileListModel::nameChangeRequest, this, &FileList::nameChangeRequest);
     connect(model_, &FileListModel::createFolderRequest, this, &FileList::createFolderRequest);
     connect(model_, &FileListModel::fileListDropped, this, &FileList::fileListDropped);
+    connect(model_, &FileListModel::fileListCopied, this, &FileList::fileListCopied);
 }
 
 void FileList::showDriveList(AddressBarModel* model)
@@ -105,6 +106,14 @@ void FileList::showFileList(const proto::FileList& file_list)
     model_->setFileList(file_list);
 }
 
+void FileList::addFileList(const proto::FileList& file_list)
+{
+    if (!isFileListShown())
+        return;
+
+    model_->addFileList(file_list);
+}
+
 void FileList::setMimeType(const QString& mime_type)
 {
     model_->setMimeType(mime_type);
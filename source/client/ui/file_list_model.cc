@@ -23,6 +23,8 @@
 #include <QDateTime>
 #include <QLocale>
 
+#include <algorithm>
+
 namespace client {
 
 namespace {
@@ -36,11 +38,19 @@ enum Column
     COLUMN_COUNT      = 4
 };
 
+// Sorts the items starting from |first| and merges them with the sorted items before it.
+template<class T, class Compare>
+void sortList(T& list, int first, Compare compare)
+{
+    std::sort(list.begin() + first, list.end(), compare);
+    std::inplace_merge(list.begin(), list.begin() + first, list.end(), compare);
+}
+
 template<class T>
-void sortByName(T& list, Qt::SortOrder order)
+void sortByName(T& list, Qt::SortOrder order, int first)
 {
-    std::sort(list.begin(), list.end(),
-              [order](const typename T::value_type& f1, const typename T::value_type& f2)
+    sortList(list, first,
+             [order](const typename T::value_type& f1, const typename T::value_type& f2)
     {
         const QString& f1_name = f1.name;
         const QString& f2_name = f2.name;
@@ -53,10 +63,10 @@ void sortByName(T& list, Qt::SortOrder order)
 }
 
 template<class T>
-void sortBySize(T& list, Qt::SortOrder order)
+void sortBySize(T& list, Qt::SortOrder order, int first)
 {
-    std::sort(list.begin(), list.end(),
-              [order](const typename T::value_type& f1, const typename T::value_type& f2)
+    sortList(list, first,
+             [order](const typename T::value_type& f1, const typename T::value_type& f2)
     {
         if (order == Qt::AscendingOrder)
             return f1.size < f2.size;
@@ -66,10 +76,10 @@ void sortBySize(T& list, Qt::SortOrder order)
 }
 
 template<class T>
-void sortByType(T& list, Qt::SortOrder order)
+void sortByType(T& list, Qt::SortOrder order, int first)
 {
-    std::sort(list.begin(), list.end(),
-              [order](const typename T::value_type& f1, const typename T::value_type& f2)
+    sortList(list, first,
+             [order](const typename T::value_type& f1, const typename T::value_type& f2)
     {
         if (order == Qt::AscendingOrder)
             return f1.type < f2.type;
@@ -79,10 +89,10 @@ void sortByType(T& list, Qt::SortOrder order)
 }
 
 template<class T>
-void sortByTime(T& list, Qt::SortOrder order)
+void sortByTime(T& list, Qt::SortOrder order, int first)
 {
-    std::sort(list.begin(), list.end(),
-              [order](const typename T::value_type& f1, const typename T::value_type& f2)
+    sortList(list, first,
+             [order](const typename T::value_type& f1, const typename T::value_type& f2)
     {
         if (order == Qt::AscendingOrder)
             return f1.last_write < f2.last_write;
@@ -115,6 +125,36 @@ void FileListModel::setFileList(const proto::FileList& list)
 
     beginInsertRows(QModelIndex(), 0, list.item_size() - 1);
 
+    appendItems(list);
+    sortItems(current_column_, current_order_);
+
+    endInsertRows();
+}
+
+void FileListModel::addFileList(const proto::FileList& list)
+{
+    if (!list.item_size())
+        return;
+
+    const int first_folder = folder_items_.count();
+    const int first_file = file_items_.count();
+    const int first_row = first_folder + first_file;
+
+    beginInsertRows(QModelIndex(), first_row, first_row + list.item_size() - 1);
+
+    // Only the new items are sorted, they are merged with the already sorted ones.
+    appendItems(list);
+    sortItems(current_column_, current_order_, first_folder, first_file);
+
+    endInsertRows();
+
+    // The old rows could move.
+    emit dataChanged(index(0, 0, QModelIndex()),
+                     index(rowCount(QModelIndex()) - 1, COLUMN_COUNT - 1, QModelIndex()));
+}
+
+void FileListModel::appendItems(const proto::FileList& list)
+{
     for (int i = 0; i < list.item_size(); ++i)
     {
         const proto::FileList::Item& item = list.item(i);
@@ -141,10 +181,6 @@ void FileListModel::setFileList(const proto::FileList& list)
             file_items_.append(file);
         }
     }
-
-    sortItems(current_column_, current_order_);
-
-    endInsertRows();
 }
 
 void FileListModel::setSortOrder(int column, Qt::SortOrder order)
@@ -402,7 +438,7 @@ QMimeData* FileListModel::mimeData(const QModelIndexList& indexes) const
 
 bool FileListModel::canDropMimeData(const QMimeData* data, Qt::DropAction /* action */,
                                     int /* row */, int /* column */,
-                                    const QModelIndex& /* parent */) const
+                                    const QModelIndex& parent) const
 {
     if (!data->hasFormat(mime_type_))
         return false;
@@ -413,9 +449,25 @@ bool FileListModel::canDropMimeData(const QMimeData* data, Qt::DropAction /* act
 
     const FileListModel* source = mime_data->source();
 
-    if (!source || source == this || source->mimeType() != mimeType())
+    if (!source || source->mimeType() != mimeType())
         return false;
 
+    if (source == this)
+    {
+        // The items are copied within the list only into one of its folders, but not into
+        // themselves.
+        if (!parent.isValid() || !isFolder(parent))
+            return false;
+
+        const std::string folder_name = nameAt(parent).toStdString();
+
+        for (const auto& item : mime_data->fileList())
+        {
+            if (item.name == folder_name)
+                return false;
+        }
+    }
+
     return true;
 }
 
@@ -433,7 +485,11 @@ bool FileListModel::dropMimeData(const QMimeData* data, Qt::DropAction action,
     if (parent.isValid() && isFolder(parent))
         folder = nameAt(parent);
 
-    emit fileListDropped(folder, mime_data->fileList());
+    if (mime_data->source() == this)
+        emit fileListCopied(folder, mime_data->fileList());
+    else
+        emit fileListDropped(folder, mime_data->fileList());
+
     return true;
 }
 
@@ -481,7 +537,7 @@ void FileListModel::sort(int column, Qt::SortOrder order)
     emit dataChanged(QModelIndex(), QModelIndex());
 }
 
-void FileListModel::sortItems(int column, Qt::SortOrder order)
+void FileListModel::sortItems(int column, Qt::SortOrder order, int first_folder, int first_file)
 {
     current_order_ = order;
     current_column_ = column;
@@ -489,21 +545,21 @@ void FileListModel::sortItems(int column, Qt::SortOrder order)
     switch (column)
     {
         case COLUMN_NAME:
-            sortByName(folder_items_, order);
-            sortByName(file_items_, order);
+            sortByName(folder_items_, order, first_folder);
+            sortByName(file_items_, order, first_file);
             break;
 
         case COLUMN_SIZE:
-            sortBySize(file_items_, order);
+            sortBySize(file_items_, order, first_file);
             break;
 
         case COLUMN_TYPE:
-            sortByType(file_items_, order);
+            sortByType(file_items_, order, first_file);
             break;
 
         case COLUMN_LAST_WRITE:
-            sortByTime(folder_items_, order);
-            sortByTime(file_items_, order);
+            sortByTime(folder_items_, order, first_folder);
+            sortByTime(file_items_, order, first_file);
             break;
 
         default:
@@ -36,6 +36,10 @@ public:
     void setMimeType(const QString& mime_type);
     QString mimeType() const { return mime_type_; }
     void setFileList(const proto::FileList& file_list);
+
+    // Adds the next part of the list. The items are sorted as they arrive.
+    void addFileList(const proto::FileList& file_list);
+
     void setSortOrder(int column, Qt::SortOrder order);
     void clear();
     bool isFolder(const QModelIndex& index) const;
@@ -66,13 +70,16 @@ signals:
     void nameChangeRequest(const QString& old_name, const QString& new_name);
     void createFolderRequest(const QString& name);
     void fileListDropped(const QString& folder_name, const std::vector<FileTransfer::Item>& files);
+    void fileListCopied(const QString& folder_name, const std::vector<FileTransfer::Item>& files);
 
 protected:
-    void sortItems(int column, Qt::SortOrder order);
+    void sortItems(int column, Qt::SortOrder order, int first_folder = 0, int first_file = 0);
     static QString sizeToString(int64_t size);
     static QString timeToString(time_t time);
 
 private:
+    void appendItems(const proto::FileList& file_list);
+
     struct File
     {
         int64_t size = 0;
@@ -82,6 +82,12 @@ FilePanel::FilePanel(QWidget* parent)
         emit receiveItems(this, target_folder, items);
     });
 
+    connect(ui.list, &FileList::fileListCopied,
+            this, [this](const QString& folder_name, const std::vector<FileTransfer::Item>& items)
+    {
+        emit copyItems(this, currentPath() + folder_name, items);
+    });
+
     ui.list->setFocus();
 }
 
@@ -124,6 +130,17 @@ void FilePanel::onFileList(proto::FileError error_code, const proto::FileList& f
     setEnabled(true);
 }
 
+void FilePanel::onFileListPart(proto::FileError error_code, const proto::FileList& file_list)
+{
+    if (error_code != proto::FILE_ERROR_SUCCESS)
+    {
+        showError(tr("Failed to get list of files: %1").arg(fileErrorToString(error_code)));
+        return;
+    }
+
+    ui.list->addFileList(file_list);
+}
+
 void FilePanel::onCreateDirectory(proto::FileError error_code)
 {
     if (error_code != proto::FILE_ERROR_SUCCESS)
@@ -36,6 +36,7 @@ public:
 
     void onDriveList(proto::FileError error_code, const proto::DriveList& drive_list);
     void onFileList(proto::FileError error_code, const proto::FileList& file_list);
+    void onFileListPart(proto::FileError error_code, const proto::FileList& file_list);
     void onCreateDirectory(proto::FileError error_code);
     void onRename(proto::FileError error_code);
 
@@ -59,6 +60,9 @@ signals:
     void receiveItems(FilePanel* sender,
                       const QString& folder,
                       const std::vector<FileTransfer::Item>& items);
+    void copyItems(FilePanel* sender,
+                   const QString& folder,
+                   const std::vector<FileTransfer::Item>& items);
     void pathChanged(FilePanel* sender, const QString& path);
 
 public slots:
@@ -18,17 +18,25 @@
 
 #include "client/ui/frame_factory_qimage.h"
 
+#include "base/desktop/frame_pool.h"
 #include "client/ui/frame_qimage.h"
 
 namespace client {
 
-FrameFactoryQImage::FrameFactoryQImage() = default;
+FrameFactoryQImage::FrameFactoryQImage()
+    : frame_pool_(base::FramePool::create([](const base::Size& size)
+      {
+          return std::unique_ptr<base::Frame>(FrameQImage::create(size));
+      }))
+{
+    // Nothing
+}
 
 FrameFactoryQImage::~FrameFactoryQImage() = default;
 
 std::shared_ptr<base::Frame> FrameFactoryQImage::allocateFrame(const base::Size& size)
 {
-    return std::shared_ptr<base::Frame>(FrameQImage::create(size).release());
+    return frame_pool_->allocate(size);
 }
 
 } // namespace client
@@ -22,6 +22,10 @@
 #include "base/macros_magic.h"
 #include "client/frame_factory.h"
 
+namespace base {
+class FramePool;
+} // namespace base
+
 namespace client {
 
 class FrameFactoryQImage : public FrameFactory
@@ -33,6 +37,10 @@ public:
     std::shared_ptr<base::Frame> allocateFrame(const base::Size& size) override;
 
 private:
+    // The frames are reused when the stream is restarted with the same size or switches back to
+    // the previous screen.
+    std::shared_ptr<base::FramePool> frame_pool_;
+
     DISALLOW_COPY_AND_ASSIGN(FrameFactoryQImage);
 };
 
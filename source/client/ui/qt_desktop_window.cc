@@ -49,6 +49,8 @@
 #include <QTimer>
 #include <QWindow>
 
+#include <cmath>
+
 namespace client {
 
 namespace {
@@ -101,7 +103,29 @@ QtDesktopWindow::QtDesktopWindow(proto::SessionType session_type,
     scroll_timer_ = new QTimer(this);
     connect(scroll_timer_, &QTimer::timeout, this, &QtDesktopWindow::onScrollTimer);
 
+    viewport_timer_ = new QTimer(this);
+    viewport_timer_->setSingleShot(true);
+    connect(viewport_timer_, &QTimer::timeout, this, &QtDesktopWindow::onViewportTimer);
+
+    auto start_viewport_timer = [this]()
+    {
+        if (!viewport_timer_->isActive())
+            viewport_timer_->start(std::chrono::milliseconds(100));
+    };
+
+    connect(scroll_area_->horizontalScrollBar(), &QScrollBar::valueChanged,
+            this, start_viewport_timer);
+    connect(scroll_area_->verticalScrollBar(), &QScrollBar::valueChanged,
+            this, start_viewport_timer);
+
+    overlay_timer_ = new QTimer(this);
+    connect(overlay_timer_, &QTimer::timeout, this, [this]()
+    {
+        desktop_control_proxy_->onMetricsRequest();
+    });
+
     desktop_->enableKeyCombinations(panel_->sendKeyCombinations());
+    desktop_->setSmoothScaling(panel_->smoothScaling());
     desktop_->enableRemoteCursorPosition(desktop_config_.flags() & proto::CURSOR_POSITION);
 
     connect(panel_, &DesktopPanel::keyCombination, desktop_, &DesktopWidget::executeKeyCombination);
@@ -109,6 +133,8 @@ QtDesktopWindow::QtDesktopWindow(proto::SessionType session_type,
     connect(panel_, &DesktopPanel::switchToAutosize, this, &QtDesktopWindow::autosizeWindow);
     connect(panel_, &DesktopPanel::takeScreenshot, this, &QtDesktopWindow::takeScreenshot);
     connect(panel_, &DesktopPanel::scaleChanged, this, &QtDesktopWindow::scaleDesktop);
+    connect(panel_, &DesktopPanel::smoothScalingChanged,
+            desktop_, &DesktopWidget::setSmoothScaling);
     connect(panel_, &DesktopPanel::minimizeSession, this, &QtDesktopWindow::showMinimized);
     connect(panel_, &DesktopPanel::closeSession, this, &QtDesktopWindow::close);
 
@@ -146,9 +172,37 @@ QtDesktopWindow::QtDesktopWindow(proto::SessionType session_type,
 
     connect(panel_, &DesktopPanel::startStatistics, this, [this]()
     {
+        if (!statistics_dialog_)
+        {
+            statistics_dialog_ = new StatisticsDialog(this);
+            statistics_dialog_->setAttribute(Qt::WA_DeleteOnClose);
+
+            connect(statistics_dialog_, &StatisticsDialog::metricsRequired, this, [this]()
+            {
+                desktop_control_proxy_->onMetricsRequest();
+            });
+
+            statistics_dialog_->show();
+        }
+
+        statistics_dialog_->activateWindow();
         desktop_control_proxy_->onMetricsRequest();
     });
 
+    connect(panel_, &DesktopPanel::performanceOverlayChanged, this, [this](bool enabled)
+    {
+        if (enabled)
+        {
+            overlay_timer_->start(std::chrono::seconds(1));
+            desktop_control_proxy_->onMetricsRequest();
+        }
+        else
+        {
+            overlay_timer_->stop();
+            desktop_->setPerformanceOverlay(QStringList());
+        }
+    });
+
     connect(panel_, &DesktopPanel::pasteAsKeystrokes, this, &QtDesktopWindow::onPasteKeystrokes);
     connect(panel_, &DesktopPanel::switchToFullscreen, this, [this](bool fullscreen)
     {
@@ -314,21 +368,16 @@ void QtDesktopWindow::setSystemInfo(const proto::system_info::SystemInfo& system
 
 void QtDesktopWindow::setMetrics(const DesktopWindow::Metrics& metrics)
 {
-    if (!statistics_dialog_)
-    {
-        statistics_dialog_ = new StatisticsDialog(this);
-        statistics_dialog_->setAttribute(Qt::WA_DeleteOnClose);
+    // The painting is measured by the window.
+    DesktopWindow::Metrics window_metrics = metrics;
+    window_metrics.paint_time = desktop_->paintTime();
+    window_metrics.dropped_frames += desktop_->droppedFrames();
 
-        connect(statistics_dialog_, &StatisticsDialog::metricsRequired, this, [this]()
-        {
-            desktop_control_proxy_->onMetricsRequest();
-        });
+    if (statistics_dialog_)
+        statistics_dialog_->setMetrics(window_metrics);
 
-        statistics_dialog_->show();
-        statistics_dialog_->activateWindow();
-    }
-
-    statistics_dialog_->setMetrics(metrics);
+    if (overlay_timer_->isActive())
+        desktop_->setPerformanceOverlay(performanceOverlayLines(window_metrics));
 }
 
 std::unique_ptr<FrameFactory> QtDesktopWindow::frameFactory()
@@ -353,8 +402,9 @@ void QtDesktopWindow::setFrame(
     }
 }
 
-void QtDesktopWindow::drawFrame()
+void QtDesktopWindow::drawFrame(const base::Region& dirty_region)
 {
+    desktop_->addDirtyRegion(dirty_region);
     desktop_->update();
     panel_->update();
 }
@@ -395,6 +445,10 @@ void QtDesktopWindow::changeEvent(QEvent* event)
 {
     if (event->type() == QEvent::WindowStateChange && isMinimized())
         desktop_->userLeftFromWindow();
+
+    if (event->type() == QEvent::ActivationChange)
+        desktop_control_proxy_->setActive(isActiveWindow());
+
     QWidget::changeEvent(event);
 }
 
@@ -647,6 +701,10 @@ void QtDesktopWindow::onResizeTimer()
 {
     QSize desktop_size = desktop_->size();
 
+    // The host changes the resolution to fill the whole window, not only the scaled desktop.
+    if ((desktop_config_.flags() & proto::MATCH_RESOLUTION) && panel_->scale() == -1)
+        desktop_size = size();
+
     QScreen* current_screen = window()->windowHandle()->screen();
     if (current_screen)
         desktop_size *= current_screen->devicePixelRatio();
@@ -655,6 +713,53 @@ void QtDesktopWindow::onResizeTimer()
 
     desktop_control_proxy_->setPreferredSize(desktop_size.width(), desktop_size.height());
     resize_timer_->stop();
+
+    onViewportTimer();
+}
+
+void QtDesktopWindow::onViewportTimer()
+{
+    viewport_timer_->stop();
+
+    if (!desktop_control_proxy_ || screen_size_.isEmpty() || desktop_->size().isEmpty())
+        return;
+
+    // Part of the desktop widget that is visible in the scroll area.
+    QRect visible_rect = QRect(-desktop_->pos(), scroll_area_->viewport()->size())
+        .intersected(desktop_->rect());
+
+    QRect viewport;
+
+    // If the whole desktop is visible, an empty viewport is sent.
+    if (visible_rect != desktop_->rect())
+    {
+        double scale_x = double(screen_size_.width()) / double(desktop_->width());
+        double scale_y = double(screen_size_.height()) / double(desktop_->height());
+
+        int left = static_cast<int>(std::floor(visible_rect.left() * scale_x));
+        int top = static_cast<int>(std::floor(visible_rect.top() * scale_y));
+        int right = static_cast<int>(std::ceil((visible_rect.right() + 1) * scale_x));
+        int bottom = static_cast<int>(std::ceil((visible_rect.bottom() + 1) * scale_y));
+
+        viewport = QRect(QPoint(left, top), QPoint(right - 1, bottom - 1))
+            .intersected(QRect(QPoint(0, 0), screen_size_));
+    }
+
+    if (viewport == viewport_)
+        return;
+
+    viewport_ = viewport;
+
+    proto::Viewport message;
+    if (!viewport_.isEmpty())
+    {
+        message.set_x(viewport_.x());
+        message.set_y(viewport_.y());
+        message.set_width(viewport_.width());
+        message.set_height(viewport_.height());
+    }
+
+    desktop_control_proxy_->setViewport(message);
 }
 
 void QtDesktopWindow::onScrollTimer()
@@ -707,4 +812,32 @@ void QtDesktopWindow::onPasteKeystrokes()
     }
 }
 
+// static
+QStringList QtDesktopWindow::performanceOverlayLines(const DesktopWindow::Metrics& metrics)
+{
+    auto to_ms = [](const std::chrono::microseconds& time)
+    {
+        return QString::number(static_cast<double>(time.count()) / 1000.0, 'f', 1);
+    };
+
+    QStringList lines;
+
+    lines.append(QString("FPS: %1, dropped frames: %2")
+                 .arg(metrics.fps).arg(metrics.dropped_frames));
+    lines.append(QString("Bitrate: %1 / %2 kbit/s (in / out)")
+                 .arg(metrics.speed_rx * 8 / 1000).arg(metrics.speed_tx * 8 / 1000));
+    lines.append(QString("RTT: %1 ms, send queue: %2")
+                 .arg(metrics.round_trip_time.count()).arg(metrics.pending_messages));
+    lines.append(QString("Host: capture %1 (diff %2), queue %3, encode %4 ms")
+                 .arg(to_ms(metrics.capture_time), to_ms(metrics.diff_time),
+                      to_ms(metrics.queue_time), to_ms(metrics.encode_time)));
+    lines.append(QString("Client: decode %1, paint %2 ms")
+                 .arg(to_ms(metrics.decode_time), to_ms(metrics.paint_time)));
+    lines.append(QString("Input delay on host: %1 ms").arg(to_ms(metrics.input_delay)));
+    lines.append(QString("Host encoder load: %1%, throttling level: %2")
+                 .arg(metrics.host_load).arg(metrics.throttle_level));
+
+    return lines;
+}
+
 } // namespace client
@@ -70,7 +70,7 @@ public:
     void setMetrics(const DesktopWindow::Metrics& metrics) override;
     std::unique_ptr<FrameFactory> frameFactory() override;
     void setFrame(const base::Size& screen_size, std::shared_ptr<base::Frame> frame) override;
-    void drawFrame() override;
+    void drawFrame(const base::Region& dirty_region) override;
     void setMouseCursor(std::shared_ptr<base::MouseCursor> mouse_cursor) override;
 
     // SystemInfoControl implementation.
@@ -95,9 +95,12 @@ private slots:
     void scaleDesktop();
     void onResizeTimer();
     void onScrollTimer();
+    void onViewportTimer();
     void onPasteKeystrokes();
 
 private:
+    static QStringList performanceOverlayLines(const DesktopWindow::Metrics& metrics);
+
     const proto::SessionType session_type_;
     proto::DesktopConfig desktop_config_;
 
@@ -114,11 +117,19 @@ private:
     QPointer<QtSystemInfoWindow> system_info_;
     QPointer<StatisticsDialog> statistics_dialog_;
 
+    // Requests the metrics for the performance overlay while it is shown.
+    QTimer* overlay_timer_ = nullptr;
+
     QTimer* resize_timer_ = nullptr;
     QSize screen_size_;
     QTimer* scroll_timer_ = nullptr;
     QPoint scroll_delta_;
 
+    // The part of the remote screen visible in the window (in the screen coordinates). It is sent
+    // to the host when the scroll position or the window size changes.
+    QTimer* viewport_timer_ = nullptr;
+    QRect viewport_;
+
     bool is_maximized_ = false;
 
     DISALLOW_COPY_AND_ASSIGN(QtDesktopWindow);
@@ -117,6 +117,20 @@ void QtFileManagerWindow::onFileList(
     }
 }
 
+void QtFileManagerWindow::onFileListPart(
+    common::FileTask::Target target, proto::FileError error_code, const proto::FileList& file_list)
+{
+    if (target == common::FileTask::Target::LOCAL)
+    {
+        ui->local_panel->onFileListPart(error_code, file_list);
+    }
+    else
+    {
+        DCHECK_EQ(target, common::FileTask::Target::REMOTE);
+        ui->remote_panel->onFileListPart(error_code, file_list);
+    }
+}
+
 void QtFileManagerWindow::onCreateDirectory(
     common::FileTask::Target target, proto::FileError error_code)
 {
@@ -267,6 +281,29 @@ void QtFileManagerWindow::receiveItems(FilePanel* sender,
     }
 }
 
+void QtFileManagerWindow::copyItems(FilePanel* sender,
+                                    const QString& target_folder,
+                                    const std::vector<FileTransfer::Item>& items)
+{
+    // The files are copied by the side that owns them.
+    if (sender == ui->local_panel)
+    {
+        transferItems(FileTransfer::Type::LOCAL_COPIER,
+                      ui->local_panel->currentPath(),
+                      target_folder,
+                      items);
+    }
+    else
+    {
+        DCHECK(sender == ui->remote_panel);
+
+        transferItems(FileTransfer::Type::REMOTE_COPIER,
+                      ui->remote_panel->currentPath(),
+                      target_folder,
+                      items);
+    }
+}
+
 void QtFileManagerWindow::transferItems(FileTransfer::Type type,
                                         const QString& source_path,
                                         const QString& target_path,
@@ -336,6 +373,7 @@ void QtFileManagerWindow::initPanel(
     connect(panel, &FilePanel::removeItems, this, &QtFileManagerWindow::removeItems);
     connect(panel, &FilePanel::sendItems, this, &QtFileManagerWindow::sendItems);
     connect(panel, &FilePanel::receiveItems, this, &QtFileManagerWindow::receiveItems);
+    connect(panel, &FilePanel::copyItems, this, &QtFileManagerWindow::copyItems);
     connect(panel, &FilePanel::pathChanged, this, &QtFileManagerWindow::onPathChanged);
 }
 
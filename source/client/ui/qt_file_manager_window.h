@@ -59,6 +59,9 @@ public:
     void onFileList(common::FileTask::Target target,
                     proto::FileError error_code,
                     const proto::FileList& file_list) override;
+    void onFileListPart(common::FileTask::Target target,
+                        proto::FileError error_code,
+                        const proto::FileList& file_list) override;
     void onCreateDirectory(common::FileTask::Target target, proto::FileError error_code) override;
     void onRename(common::FileTask::Target target, proto::FileError error_code) override;
 
@@ -78,6 +81,9 @@ private slots:
     void receiveItems(FilePanel* sender,
                       const QString& target_folder,
                       const std::vector<FileTransfer::Item>& items);
+    void copyItems(FilePanel* sender,
+                   const QString& target_folder,
+                   const std::vector<FileTransfer::Item>& items);
     void onPathChanged(FilePanel* sender, const QString& path);
 
 private:
@@ -20,10 +20,21 @@
 
 #include "base/desktop/screen_capturer.h"
 
+#include <QFile>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QTextStream>
 #include <QTimer>
 
 namespace client {
 
+namespace {
+
+// One hour of the metrics received every second.
+const size_t kMaxHistorySize = 3600;
+
+} // namespace
+
 StatisticsDialog::StatisticsDialog(QWidget* parent)
     : QDialog(parent),
       duration_(0, 0)
@@ -34,12 +45,18 @@ StatisticsDialog::StatisticsDialog(QWidget* parent)
     update_timer_ = new QTimer(this);
     connect(update_timer_, &QTimer::timeout, this, &StatisticsDialog::metricsRequired);
     update_timer_->start(std::chrono::seconds(1));
+
+    connect(ui.button_export, &QPushButton::clicked, this, &StatisticsDialog::exportToCsv);
 }
 
 StatisticsDialog::~StatisticsDialog() = default;
 
 void StatisticsDialog::setMetrics(const DesktopWindow::Metrics& metrics)
 {
+    history_.push_back(metrics);
+    if (history_.size() > kMaxHistorySize)
+        history_.pop_front();
+
     for (int i = 0; i < ui.tree->topLevelItemCount(); ++i)
     {
         QTreeWidgetItem* item = ui.tree->topLevelItem(i);
@@ -155,10 +172,134 @@ void StatisticsDialog::setMetrics(const DesktopWindow::Metrics& metrics)
             case 24:
                 item->setText(1, QString::number(metrics.cursor_pos_count));
                 break;
+
+            case 25:
+                item->setText(1, timeToString(metrics.capture_time));
+                break;
+
+            case 26:
+                item->setText(1, timeToString(metrics.diff_time));
+                break;
+
+            case 27:
+                item->setText(1, timeToString(metrics.queue_time));
+                break;
+
+            case 28:
+                item->setText(1, timeToString(metrics.encode_time));
+                break;
+
+            case 29:
+                item->setText(1, timeToString(metrics.network_time));
+                break;
+
+            case 30:
+                item->setText(1, timeToString(metrics.decode_time));
+                break;
+
+            case 31:
+                item->setText(1, timeToString(metrics.paint_time));
+                break;
+
+            case 32:
+            {
+                // The comparison of images is a part of the capture.
+                std::chrono::microseconds latency = metrics.capture_time + metrics.queue_time +
+                    metrics.encode_time + metrics.network_time + metrics.decode_time +
+                    metrics.paint_time;
+                item->setText(1, timeToString(latency));
+            }
+            break;
+
+            case 33:
+                item->setText(1, QString("%1 ms").arg(metrics.round_trip_time.count()));
+                break;
+
+            case 34:
+                item->setText(1, QString::number(metrics.pending_messages));
+                break;
+
+            case 35:
+                item->setText(1, QString::number(metrics.dropped_frames));
+                break;
+
+            case 36:
+                item->setText(1, timeToString(metrics.input_delay));
+                break;
+
+            case 37:
+                item->setText(1, QString("%1 %").arg(metrics.host_load));
+                break;
+
+            case 38:
+                item->setText(1, QString::number(metrics.throttle_level));
+                break;
         }
     }
 }
 
+void StatisticsDialog::exportToCsv()
+{
+    QString file_path = QFileDialog::getSaveFileName(this,
+                                                     tr("Save File"),
+                                                     QString(),
+                                                     tr("CSV File (*.csv)"));
+    if (file_path.isEmpty())
+        return;
+
+    QFile file(file_path);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate | QFile::Text))
+    {
+        QMessageBox::warning(this,
+                             tr("Warning"),
+                             tr("Failed to save file: %1").arg(file.errorString()),
+                             QMessageBox::Ok);
+        return;
+    }
+
+    // The values are written without units: sizes in bytes, speeds in bytes per second and times
+    // in microseconds (except the duration in seconds and the round trip time in milliseconds).
+    QTextStream stream(&file);
+    stream << "duration_s,total_rx,total_tx,speed_rx,speed_tx,video_packet_count,"
+              "avg_video_packet,fps,dropped_frames,round_trip_time_ms,pending_messages,"
+              "capture_us,diff_us,queue_us,encode_us,network_us,decode_us,paint_us,"
+              "input_delay_us,host_load,throttle_level\n";
+
+    for (const auto& metrics : history_)
+    {
+        stream << metrics.duration.count() << ','
+               << metrics.total_rx << ','
+               << metrics.total_tx << ','
+               << metrics.speed_rx << ','
+               << metrics.speed_tx << ','
+               << metrics.video_packet_count << ','
+               << static_cast<qulonglong>(metrics.avg_video_packet) << ','
+               << metrics.fps << ','
+               << metrics.dropped_frames << ','
+               << metrics.round_trip_time.count() << ','
+               << static_cast<qulonglong>(metrics.pending_messages) << ','
+               << metrics.capture_time.count() << ','
+               << metrics.diff_time.count() << ','
+               << metrics.queue_time.count() << ','
+               << metrics.encode_time.count() << ','
+               << metrics.network_time.count() << ','
+               << metrics.decode_time.count() << ','
+               << metrics.paint_time.count() << ','
+               << metrics.input_delay.count() << ','
+               << metrics.host_load << ','
+               << metrics.throttle_level << '\n';
+    }
+
+    stream.flush();
+    if (stream.status() != QTextStream::Ok)
+    {
+        QMessageBox::warning(this,
+                             tr("Warning"),
+                             tr("Failed to save file: %1").arg(file.errorString()),
+                             QMessageBox::Ok);
+    }
+}
+
 // static
 QString StatisticsDialog::sizeToString(int64_t size)
 {
@@ -243,4 +384,10 @@ QString StatisticsDialog::speedToString(int64_t speed)
         .arg(units);
 }
 
+// static
+QString StatisticsDialog::timeToString(const std::chrono::microseconds& time)
+{
+    return QString("%1 ms").arg(static_cast<double>(time.count()) / 1000.0, 0, 'f', 1);
+}
+
 } // namespace client
@@ -25,6 +25,8 @@
 
 #include <QTime>
 
+#include <deque>
+
 namespace client {
 
 class StatisticsDialog : public QDialog
@@ -43,11 +45,17 @@ signals:
 private:
     static QString sizeToString(int64_t size);
     static QString speedToString(int64_t speed);
+    static QString timeToString(const std::chrono::microseconds& time);
+
+    void exportToCsv();
 
     Ui::StatisticsDialog ui;
     QTimer* update_timer_ = nullptr;
     QTime duration_;
 
+    // The metrics received while the dialog is open, for the export.
+    std::deque<DesktopWindow::Metrics> history_;
+
     DISALLOW_COPY_AND_ASSIGN(StatisticsDialog);
 };
 
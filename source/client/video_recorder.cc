@@ -0,0 +1,145 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/video_recorder.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/codec/webm_file_writer.h"
+#include "base/codec/webm_video_encoder.h"
+#include "base/desktop/frame_simple.h"
+#include "proto/desktop.pb.h"
+
+namespace client {
+
+namespace {
+
+// Packets and frames waiting for the recorder thread. A few seconds of video at the usual frame
+// rates, the audio packets are counted too.
+const int kMaxQueuedTasks = 128;
+
+} // namespace
+
+VideoRecorder::VideoRecorder(const std::filesystem::path& path, std::u16string_view name)
+    : writer_(std::make_unique<base::WebmFileWriter>(path, name))
+{
+    thread_.start(base::MessageLoop::Type::DEFAULT);
+    task_runner_ = thread_.taskRunner();
+}
+
+VideoRecorder::~VideoRecorder()
+{
+    // The queued tasks are completed before the thread exits.
+    thread_.stop();
+}
+
+bool VideoRecorder::addVideoPacket(const proto::VideoPacket& packet)
+{
+    const bool is_key_frame = base::WebmFileWriter::isKeyFrame(packet);
+
+    if (reencoding_)
+    {
+        // The packets of the host can only continue the re-encoded stream from a key frame.
+        reencoding_ = false;
+        waiting_key_frame_ = true;
+    }
+
+    if (!waiting_key_frame_ || is_key_frame)
+    {
+        if (startTask())
+        {
+            waiting_key_frame_ = false;
+            key_frame_requested_ = false;
+
+            const base::WebmFileWriter::TimePoint time = base::WebmFileWriter::Clock::now();
+
+            task_runner_->postTask([this, packet, time]()
+            {
+                writer_->addVideoPacket(packet, time);
+                --queued_tasks_;
+            });
+            return true;
+        }
+
+        LOG_IF(LS_WARNING, !waiting_key_frame_)
+            << "Recording queue is full, waiting for a key frame";
+        waiting_key_frame_ = true;
+    }
+
+    // The next packets depend on the missing one.
+    if (key_frame_requested_)
+        return true;
+
+    key_frame_requested_ = true;
+    return false;
+}
+
+void VideoRecorder::addFrame(const base::Frame& frame)
+{
+    // Frames are independent of each other, a dropped frame only lowers the frame rate.
+    if (!startTask())
+        return;
+
+    // The encoder starts a new stream with a key frame when the recording switches from the
+    // packets of the host.
+    const bool new_stream = !reencoding_;
+    reencoding_ = true;
+
+    std::shared_ptr<base::Frame> frame_copy =
+        base::FrameSimple::create(frame.size(), frame.format());
+    frame_copy->copyPixelsFrom(frame, base::Point(0, 0), base::Rect::makeSize(frame.size()));
+
+    const base::WebmFileWriter::TimePoint time = base::WebmFileWriter::Clock::now();
+
+    task_runner_->postTask([this, frame_copy, time, new_stream]()
+    {
+        if (new_stream || !encoder_)
+            encoder_ = std::make_unique<base::WebmVideoEncoder>();
+
+        proto::VideoPacket packet;
+        if (encoder_->encode(*frame_copy, &packet))
+            writer_->addVideoPacket(packet, time);
+
+        --queued_tasks_;
+    });
+}
+
+void VideoRecorder::addAudioPacket(const proto::AudioPacket& packet)
+{
+    if (!startTask())
+        return;
+
+    const base::WebmFileWriter::TimePoint time = base::WebmFileWriter::Clock::now();
+
+    task_runner_->postTask([this, packet, time]()
+    {
+        writer_->addAudioPacket(packet, time);
+        --queued_tasks_;
+    });
+}
+
+bool VideoRecorder::startTask()
+{
+    if (queued_tasks_ >= kMaxQueuedTasks)
+        return false;
+
+    ++queued_tasks_;
+    return true;
+}
+
+} // namespace client
@@ -0,0 +1,87 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT__VIDEO_RECORDER_H
+#define CLIENT__VIDEO_RECORDER_H
+
+#include "base/macros_magic.h"
+#include "base/threading/thread.h"
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+namespace base {
+class Frame;
+class WebmFileWriter;
+class WebmVideoEncoder;
+} // namespace base
+
+namespace proto {
+class AudioPacket;
+class VideoPacket;
+} // namespace proto
+
+namespace client {
+
+// Records the session to WebM files on its own thread. The VP8 and VP9 packets from the host are
+// written without decoding, the frames of the other encodings are encoded again. The number of
+// queued packets and frames is limited, so a slow disk or encoder cannot delay the display.
+class VideoRecorder
+{
+public:
+    VideoRecorder(const std::filesystem::path& path, std::u16string_view name);
+    ~VideoRecorder();
+
+    // Adds a packet received from the host. The encoding must be supported by WebmFileWriter.
+    // Returns false when the recording cannot continue without a key frame (a packet has been
+    // dropped or the recording switches from re-encoded frames). It is returned once until the
+    // key frame arrives.
+    bool addVideoPacket(const proto::VideoPacket& packet);
+
+    // Adds a decoded frame that is encoded again on the recorder thread.
+    void addFrame(const base::Frame& frame);
+
+    void addAudioPacket(const proto::AudioPacket& packet);
+
+private:
+    // Returns false if the queue is full.
+    bool startTask();
+
+    base::Thread thread_;
+    std::shared_ptr<base::TaskRunner> task_runner_;
+
+    // Number of the tasks posted to the recorder thread and not yet completed.
+    std::atomic_int queued_tasks_ = 0;
+
+    // Accessed only on the calling thread.
+    bool reencoding_ = false;
+    bool waiting_key_frame_ = false;
+    bool key_frame_requested_ = false;
+
+    // Accessed only on the recorder thread.
+    std::unique_ptr<base::WebmFileWriter> writer_;
+    std::unique_ptr<base::WebmVideoEncoder> encoder_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoRecorder);
+};
+
+} // namespace client
+
+#endif // CLIENT__VIDEO_RECORDER_H
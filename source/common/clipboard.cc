@@ -19,6 +19,7 @@
 #include "common/clipboard.h"
 
 #include "base/logging.h"
+#include "base/crypto/generic_hash.h"
 
 #include <zstd.h>
 
@@ -98,6 +99,11 @@ bool decompress(const std::string& in, std::string* out)
     return true;
 }
 
+base::ByteArray dataHash(const std::string& data)
+{
+    return base::GenericHash::hash(base::GenericHash::BLAKE2b512, data);
+}
+
 } // namespace
 
 void Clipboard::start(Delegate* delegate)
@@ -109,19 +115,16 @@ void Clipboard::start(Delegate* delegate)
 
 void Clipboard::injectClipboardEvent(const proto::ClipboardEvent& event)
 {
+    std::string data;
+
     if (event.mime_type() == kMimeTypeCompressedTextUtf8)
     {
-        std::string decompressed_data;
-        if (!decompress(event.data(), &decompressed_data))
+        if (!decompress(event.data(), &data))
             return;
-
-        // Store last injected data.
-        last_data_ = std::move(decompressed_data);
     }
     else if (event.mime_type() == kMimeTypeTextUtf8)
     {
-        // Store last injected data.
-        last_data_ = event.data();
+        data = event.data();
     }
     else
     {
@@ -129,7 +132,10 @@ void Clipboard::injectClipboardEvent(const proto::ClipboardEvent& event)
         return;
     }
 
-    setData(last_data_);
+    // The injected data comes back through onData() and must not be sent again. Only the hash is
+    // kept instead of a copy of a possibly large clipboard.
+    last_hash_ = dataHash(data);
+    setData(data);
 }
 
 void Clipboard::clearClipboard()
@@ -139,9 +145,12 @@ void Clipboard::clearClipboard()
 
 void Clipboard::onData(const std::string& data)
 {
-    if (last_data_ == data)
+    base::ByteArray hash = dataHash(data);
+    if (hash == last_hash_)
         return;
 
+    last_hash_ = std::move(hash);
+
     proto::ClipboardEvent event;
 
     if (data.size() > kMinSizeToCompress)
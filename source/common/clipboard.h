@@ -19,6 +19,7 @@
 #ifndef COMMON__CLIPBOARD_H
 #define COMMON__CLIPBOARD_H
 
+#include "base/memory/byte_array.h"
 #include "proto/desktop.pb.h"
 
 #include <memory>
@@ -51,7 +52,7 @@ protected:
 
 private:
     Delegate* delegate_ = nullptr;
-    std::string last_data_;
+    base::ByteArray last_hash_;
 };
 
 } // namespace common
@@ -0,0 +1,113 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "common/clipboard_stream.h"
+
+#include "base/logging.h"
+
+namespace common {
+
+namespace {
+
+// The decompressed clipboard is limited by the platforms anyway. This limit protects the receiver
+// from a peer that never finishes a stream.
+const size_t kMaxStreamSize = 256 * 1024 * 1024;
+
+} // namespace
+
+ClipboardStream::ClipboardStream() = default;
+
+ClipboardStream::~ClipboardStream() = default;
+
+std::vector<proto::ClipboardEvent> ClipboardStream::split(const proto::ClipboardEvent& event)
+{
+    std::vector<proto::ClipboardEvent> chunks;
+    const uint32_t stream_id = next_stream_id_++;
+
+    const std::string& data = event.data();
+    size_t offset = 0;
+
+    do
+    {
+        const size_t size = std::min(kChunkSize, data.size() - offset);
+
+        proto::ClipboardEvent& chunk = chunks.emplace_back();
+        chunk.set_mime_type(event.mime_type());
+        chunk.set_data(data.data() + offset, size);
+        chunk.set_stream_id(stream_id);
+
+        offset += size;
+        chunk.set_partial(offset < data.size());
+    }
+    while (offset < data.size());
+
+    return chunks;
+}
+
+std::optional<proto::ClipboardEvent> ClipboardStream::join(const proto::ClipboardEvent& event)
+{
+    const uint32_t stream_id = event.stream_id();
+
+    // Older peers do not number the events.
+    if (!stream_id)
+        return event;
+
+    if (stream_id < last_stream_id_)
+    {
+        LOG(LS_INFO) << "Outdated clipboard stream " << stream_id << " dropped";
+        return std::nullopt;
+    }
+
+    if (stream_id != last_stream_id_)
+    {
+        // The previous stream is not finished, but the clipboard has changed after it.
+        last_stream_id_ = stream_id;
+        mime_type_ = event.mime_type();
+        data_.clear();
+        overflow_ = false;
+    }
+
+    if (overflow_)
+        return std::nullopt;
+
+    if (!event.partial() && data_.empty())
+        return event;
+
+    if (data_.size() + event.data().size() > kMaxStreamSize)
+    {
+        LOG(LS_ERROR) << "Too large clipboard stream: " << data_.size() + event.data().size();
+        data_.clear();
+        overflow_ = true;
+        return std::nullopt;
+    }
+
+    data_.append(event.data());
+
+    if (event.partial())
+        return std::nullopt;
+
+    proto::ClipboardEvent result;
+    result.set_mime_type(std::move(mime_type_));
+    result.set_data(std::move(data_));
+    data_.clear();
+    mime_type_.clear();
+
+    return result;
+}
+
+} // namespace common
@@ -0,0 +1,63 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef COMMON__CLIPBOARD_STREAM_H
+#define COMMON__CLIPBOARD_STREAM_H
+
+#include "base/macros_magic.h"
+#include "proto/desktop.pb.h"
+
+#include <optional>
+#include <vector>
+
+namespace common {
+
+// Splits large clipboard events into chunks on the sending side and joins them on the receiving
+// side. The chunks are sent with a low priority so that a large clipboard does not hold the input
+// and the video. Each event gets a stream ID; a stream that is older than the last received event
+// is dropped because the clipboard has already changed after it.
+class ClipboardStream
+{
+public:
+    ClipboardStream();
+    ~ClipboardStream();
+
+    // Events with larger data are split.
+    static const size_t kChunkSize = 64 * 1024;
+
+    // Returns the event as is if it is small, otherwise the list of chunks.
+    std::vector<proto::ClipboardEvent> split(const proto::ClipboardEvent& event);
+
+    // Returns the complete event when the last chunk of the stream is received. Events from the
+    // peers without streams are returned at once.
+    std::optional<proto::ClipboardEvent> join(const proto::ClipboardEvent& event);
+
+private:
+    uint32_t next_stream_id_ = 1;
+
+    uint32_t last_stream_id_ = 0;
+    std::string mime_type_;
+    std::string data_;
+    bool overflow_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(ClipboardStream);
+};
+
+} // namespace common
+
+#endif // COMMON__CLIPBOARD_STREAM_H
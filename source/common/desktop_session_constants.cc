@@ -18,26 +18,41 @@
 
 #include "common/desktop_session_constants.h"
 
+#include "build/build_config.h"
 #include "proto/desktop.pb.h"
 
 namespace common {
 
 const char kSelectScreenExtension[] = "select_screen";
 const char kPreferredSizeExtension[] = "preferred_size";
+const char kViewportExtension[] = "viewport";
 const char kPowerControlExtension[] = "power_control";
 const char kRemoteUpdateExtension[] = "remote_update";
 const char kSystemInfoExtension[] = "system_info";
 const char kVideoRecordingExtension[] = "video_recording";
 const char kTextChatExtension[] = "text_chat";
+const char kInputEventBatchExtension[] = "input_event_batch";
+const char kRecordingKeyFrameExtension[] = "recording_key_frame";
+const char kVideoRecoveryExtension[] = "video_recovery";
+const char kClipboardStreamExtension[] = "clipboard_stream";
 
 const char kSupportedExtensionsForManage[] =
-    "select_screen;preferred_size;power_control;remote_update;system_info;video_recording;text_chat";
+    "select_screen;preferred_size;power_control;remote_update;system_info;video_recording;text_chat;"
+    "input_event_batch;recording_key_frame;video_recovery;clipboard_stream;viewport";
 
 const char kSupportedExtensionsForView[] =
-    "select_screen;preferred_size;system_info;video_recording;text_chat";
+    "select_screen;preferred_size;system_info;video_recording;text_chat;recording_key_frame;"
+    "video_recovery;viewport";
 
+#if defined(OS_WIN)
 const uint32_t kSupportedVideoEncodings =
-    proto::VIDEO_ENCODING_VP8 | proto::VIDEO_ENCODING_VP9 | proto::VIDEO_ENCODING_ZSTD;
+    proto::VIDEO_ENCODING_VP8 | proto::VIDEO_ENCODING_VP9 | proto::VIDEO_ENCODING_ZSTD |
+    proto::VIDEO_ENCODING_HYBRID | proto::VIDEO_ENCODING_H264;
+#else
+const uint32_t kSupportedVideoEncodings =
+    proto::VIDEO_ENCODING_VP8 | proto::VIDEO_ENCODING_VP9 | proto::VIDEO_ENCODING_ZSTD |
+    proto::VIDEO_ENCODING_HYBRID;
+#endif // defined(OS_WIN)
 const uint32_t kSupportedAudioEncodings = proto::AUDIO_ENCODING_OPUS;
 
 } // namespace common
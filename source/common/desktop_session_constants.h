@@ -25,11 +25,21 @@ namespace common {
 
 extern const char kSelectScreenExtension[];
 extern const char kPreferredSizeExtension[];
+extern const char kViewportExtension[];
 extern const char kPowerControlExtension[];
 extern const char kRemoteUpdateExtension[];
 extern const char kSystemInfoExtension[];
 extern const char kVideoRecordingExtension[];
 extern const char kTextChatExtension[];
+extern const char kInputEventBatchExtension[];
+
+// The host sends a key frame when the client starts a video recording. The client can write the
+// VP8 and VP9 packets to the file without encoding the frames again.
+extern const char kRecordingKeyFrameExtension[];
+extern const char kVideoRecoveryExtension[];
+
+// The peers send large clipboards in chunks (see ClipboardStream).
+extern const char kClipboardStreamExtension[];
 
 extern const char kSupportedExtensionsForManage[];
 extern const char kSupportedExtensionsForView[];
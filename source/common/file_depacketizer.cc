@@ -19,13 +19,20 @@
 #include "common/file_depacketizer.h"
 
 #include "base/logging.h"
+#include "base/crypto/generic_hash.h"
+#include "base/files/sequential_file_reader.h"
+#include "base/files/sequential_file_writer.h"
+#include "common/file_packet.h"
+
+#include <algorithm>
 
 namespace common {
 
 FileDepacketizer::FileDepacketizer(const std::filesystem::path& file_path,
-                                   std::ofstream&& file_stream)
+                                   std::unique_ptr<base::SequentialFileWriter> writer)
     : file_path_(file_path),
-      file_stream_(std::move(file_stream))
+      writer_(std::move(writer)),
+      digest_(std::make_unique<base::GenericHash>(base::GenericHash::BLAKE2b512))
 {
     // Nothing
 }
@@ -33,9 +40,9 @@ FileDepacketizer::FileDepacketizer(const std::filesystem::path& file_path,
 FileDepacketizer::~FileDepacketizer()
 {
     // If the file is opened, it was not completely written.
-    if (file_stream_.is_open())
+    if (writer_)
     {
-        file_stream_.close();
+        writer_.reset();
 
         // The transfer of files was canceled. Delete the file.
         std::error_code ignored_error;
@@ -45,29 +52,49 @@ FileDepacketizer::~FileDepacketizer()
 
 // static
 std::unique_ptr<FileDepacketizer> FileDepacketizer::create(
-    const std::filesystem::path& file_path, bool overwrite)
+    const std::filesystem::path& file_path, std::shared_ptr<base::TaskRunner> write_task_runner)
 {
-    std::ofstream::openmode mode = std::ofstream::binary;
+    std::unique_ptr<base::SequentialFileWriter> writer =
+        base::SequentialFileWriter::create(file_path, std::move(write_task_runner));
+    if (!writer)
+        return nullptr;
+
+    return std::unique_ptr<FileDepacketizer>(new FileDepacketizer(file_path, std::move(writer)));
+}
 
-    if (overwrite)
-        mode |= std::ofstream::trunc;
+// static
+std::unique_ptr<FileDepacketizer> FileDepacketizer::resume(
+    const std::filesystem::path& file_path,
+    std::shared_ptr<base::TaskRunner> write_task_runner,
+    proto::FileBlockHashes* block_hashes)
+{
+    DCHECK(block_hashes);
 
-    std::ofstream file_stream;
+    calculateBlockHashes(file_path, block_hashes);
 
-    file_stream.open(file_path, mode);
-    if (!file_stream.is_open())
+    std::unique_ptr<base::SequentialFileWriter> writer =
+        base::SequentialFileWriter::open(file_path, std::move(write_task_runner));
+    if (!writer)
         return nullptr;
 
-    return std::unique_ptr<FileDepacketizer>(
-        new FileDepacketizer(file_path, std::move(file_stream)));
+    return std::unique_ptr<FileDepacketizer>(new FileDepacketizer(file_path, std::move(writer)));
+}
+
+void FileDepacketizer::keepIncompleteFile()
+{
+    // The writer waits for the queued data. The file is not truncated, the blocks after the
+    // received data can still match the source.
+    writer_.reset();
 }
 
 bool FileDepacketizer::writeNextPacket(const proto::FilePacket& packet)
 {
-    DCHECK(file_stream_.is_open());
+    DCHECK(writer_);
 
     const size_t packet_size = packet.data().size();
-    if (!packet_size)
+    const uint64_t unchanged_size = packet.unchanged_size();
+
+    if (!packet_size && !unchanged_size)
     {
         if (packet.flags() & proto::FilePacket::LAST_PACKET)
         {
@@ -75,7 +102,12 @@ bool FileDepacketizer::writeNextPacket(const proto::FilePacket& packet)
             {
                 // Zero-length file received.
                 file_size_ = 0;
-                file_stream_.close();
+
+                // After an error the file is removed with the writer.
+                if (!writer_->close())
+                    return false;
+
+                writer_.reset();
             }
             else
             {
@@ -95,25 +127,102 @@ bool FileDepacketizer::writeNextPacket(const proto::FilePacket& packet)
     {
         file_size_ = packet.file_size();
         left_size_ = file_size_;
+
+        // The file system can place the file in one piece.
+        writer_->preallocate(file_size_);
     }
 
-    file_stream_.seekp(static_cast<std::streamoff>(file_size_ - left_size_));
-    file_stream_.write(packet.data().data(), packet_size);
-    if (file_stream_.fail())
+    if (unchanged_size)
     {
-        LOG(LS_WARNING) << "Unable to write file";
-        return false;
+        if (packet_size || unchanged_size > left_size_)
+        {
+            LOG(LS_WARNING) << "Wrong unchanged size";
+            return false;
+        }
+
+        if (!writer_->skip(unchanged_size))
+        {
+            LOG(LS_WARNING) << "Unable to write file";
+            return false;
+        }
+
+        left_size_ -= unchanged_size;
     }
+    else
+    {
+        if (!writer_->write(packet.data().data(), packet_size))
+        {
+            LOG(LS_WARNING) << "Unable to write file";
+            return false;
+        }
+
+        digest_->addData(packet.data());
 
-    left_size_ -= packet_size;
+        left_size_ -= packet_size;
+    }
 
     if (packet.flags() & proto::FilePacket::LAST_PACKET)
     {
         file_size_ = 0;
-        file_stream_.close();
+
+        // Older sources do not send the digest. After a mismatch the file is removed with the
+        // writer.
+        if (!packet.digest().empty() && packet.digest() != base::toStdString(digest_->result()))
+        {
+            LOG(LS_WARNING) << "Digest mismatch for file: " << file_path_;
+            digest_mismatch_ = true;
+            return false;
+        }
+
+        // Waits until all the data is on the disk. After an error the file is removed with the
+        // writer.
+        if (!writer_->close())
+        {
+            LOG(LS_WARNING) << "Unable to write file";
+            return false;
+        }
+
+        writer_.reset();
     }
 
     return true;
 }
 
+// static
+void FileDepacketizer::calculateBlockHashes(const std::filesystem::path& file_path,
+                                            proto::FileBlockHashes* block_hashes)
+{
+    std::unique_ptr<base::SequentialFileReader> reader =
+        base::SequentialFileReader::open(file_path);
+    if (!reader)
+    {
+        // There is no file yet, everything is sent.
+        return;
+    }
+
+    size_t block_size = kFileBlockSize;
+    while (reader->size() / block_size >= kMaxFileBlocks && block_size < kMaxFileBlockSize)
+        block_size *= 2;
+
+    std::string buffer;
+    buffer.resize(block_size);
+
+    while (reader->leftSize())
+    {
+        const size_t size = static_cast<size_t>(
+            std::min(reader->leftSize(), static_cast<uint64_t>(block_size)));
+
+        if (!reader->read(buffer.data(), size, block_size))
+        {
+            LOG(LS_WARNING) << "Unable to read file";
+            break;
+        }
+
+        block_hashes->add_hash(base::toStdString(
+            base::GenericHash::hash(base::GenericHash::SHA256, buffer.data(), size)));
+    }
+
+    block_hashes->set_block_size(static_cast<uint32_t>(block_size));
+}
+
 } // namespace common
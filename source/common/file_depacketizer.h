@@ -23,9 +23,14 @@
 #include "proto/file_transfer.pb.h"
 
 #include <filesystem>
-#include <fstream>
 #include <memory>
 
+namespace base {
+class GenericHash;
+class SequentialFileWriter;
+class TaskRunner;
+} // namespace base
+
 namespace common {
 
 class FileDepacketizer
@@ -33,17 +38,44 @@ class FileDepacketizer
 public:
     ~FileDepacketizer();
 
-    static std::unique_ptr<FileDepacketizer> create(const std::filesystem::path& file_path,
-                                                    bool overwrite);
+    // Creates the file or truncates the existing one. The data is written to the disk on
+    // |write_task_runner|.
+    static std::unique_ptr<FileDepacketizer> create(
+        const std::filesystem::path& file_path,
+        std::shared_ptr<base::TaskRunner> write_task_runner);
+
+    // Opens the existing file without truncating it or creates a new one. |block_hashes| receives
+    // the hashes of the blocks of the existing file. The blocks reported as unchanged by the
+    // source keep their contents.
+    static std::unique_ptr<FileDepacketizer> resume(
+        const std::filesystem::path& file_path,
+        std::shared_ptr<base::TaskRunner> write_task_runner,
+        proto::FileBlockHashes* block_hashes);
+
+    // Closes an incompletely received file without deleting it. The connection was lost and the
+    // transfer of the file can be resumed later.
+    void keepIncompleteFile();
 
-    // Reads the packet and writes its contents to a file.
+    // Reads the packet and writes its contents to a file. The data may still be on the way to the
+    // disk when it returns, a write error is reported for one of the next packets. The last
+    // packet returns when the file is completely written.
     bool writeNextPacket(const proto::FilePacket& packet);
 
+    // Returns true if the last packet was rejected because the digest of the received data did
+    // not match the source.
+    bool isDigestMismatch() const { return digest_mismatch_; }
+
 private:
-    FileDepacketizer(const std::filesystem::path& file_path, std::ofstream&& file_stream);
+    FileDepacketizer(const std::filesystem::path& file_path,
+                     std::unique_ptr<base::SequentialFileWriter> writer);
+
+    static void calculateBlockHashes(const std::filesystem::path& file_path,
+                                     proto::FileBlockHashes* block_hashes);
 
     std::filesystem::path file_path_;
-    std::ofstream file_stream_;
+    std::unique_ptr<base::SequentialFileWriter> writer_;
+    std::unique_ptr<base::GenericHash> digest_;
+    bool digest_mismatch_ = false;
 
     uint64_t file_size_ = 0;
     uint64_t left_size_ = 0;
@@ -24,6 +24,7 @@
 #include "proto/file_transfer.pb.h"
 
 #include <filesystem>
+#include <memory>
 
 #if defined(OS_WIN)
 #include <Windows.h>
@@ -52,9 +53,14 @@ public:
         WIN32_FIND_DATA find_data_;
 #endif // defined(OS_WIN)
 
-#if defined(OS_POSIX)
+#if defined(OS_LINUX)
+        std::string name_;
+        bool is_directory_ = false;
+        int64_t size_ = 0;
+        time_t last_write_time_ = 0;
+#elif defined(OS_POSIX)
     std::filesystem::directory_iterator it_;
-#endif // defined(OS_POSIX)
+#endif
     };
 
     explicit FileEnumerator(const std::filesystem::path& root_path);
@@ -74,6 +80,16 @@ private:
     HANDLE find_handle_ = INVALID_HANDLE_VALUE;
 #endif // defined(OS_WIN)
 
+#if defined(OS_LINUX)
+    bool readEntries();
+
+    int dir_fd_ = -1;
+    std::unique_ptr<char[]> buffer_;
+    size_t buffer_size_ = 0;
+    size_t buffer_pos_ = 0;
+    bool is_at_end_ = false;
+#endif // defined(OS_LINUX)
+
     DISALLOW_COPY_AND_ASSIGN(FileEnumerator);
 };
 
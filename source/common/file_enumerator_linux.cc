@@ -0,0 +1,198 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "common/file_enumerator.h"
+
+#include "base/logging.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace common {
+
+namespace {
+
+// One getdents64 call returns as many entries as fit into the buffer. A large buffer reduces the
+// number of round trips, which matters most for network file systems.
+const size_t kBufferSize = 64 * 1024;
+
+struct LinuxDirent64
+{
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+bool shouldSkip(const char* file_name)
+{
+    return strcmp(file_name, ".") == 0 || strcmp(file_name, "..") == 0;
+}
+
+bool statEntry(int dir_fd, const char* file_name, bool* is_directory, int64_t* size,
+               time_t* last_write_time)
+{
+#if defined(STATX_BASIC_STATS)
+    // AT_STATX_DONT_SYNC allows network file systems to return the cached attributes instead of
+    // requesting them from the server for each file.
+    struct statx stx;
+    if (statx(dir_fd, file_name, AT_STATX_DONT_SYNC, STATX_TYPE | STATX_SIZE | STATX_MTIME,
+              &stx) == 0)
+    {
+        *is_directory = S_ISDIR(stx.stx_mode);
+        *size = static_cast<int64_t>(stx.stx_size);
+        *last_write_time = static_cast<time_t>(stx.stx_mtime.tv_sec);
+        return true;
+    }
+
+    if (errno != ENOSYS)
+        return false;
+#endif // defined(STATX_BASIC_STATS)
+
+    struct stat st;
+    if (fstatat(dir_fd, file_name, &st, 0) != 0)
+        return false;
+
+    *is_directory = S_ISDIR(st.st_mode);
+    *size = static_cast<int64_t>(st.st_size);
+    *last_write_time = st.st_mtime;
+    return true;
+}
+
+} // namespace
+
+// FileEnumerator::FileInfo ----------------------------------------------------------------------
+
+FileEnumerator::FileInfo::FileInfo() = default;
+
+bool FileEnumerator::FileInfo::isDirectory() const
+{
+    return is_directory_;
+}
+
+std::filesystem::path FileEnumerator::FileInfo::name() const
+{
+    return std::filesystem::path(name_);
+}
+
+std::string FileEnumerator::FileInfo::u8name() const
+{
+    return name_;
+}
+
+int64_t FileEnumerator::FileInfo::size() const
+{
+    return size_;
+}
+
+time_t FileEnumerator::FileInfo::lastWriteTime() const
+{
+    return last_write_time_;
+}
+
+// FileEnumerator --------------------------------------------------------------
+
+FileEnumerator::FileEnumerator(const std::filesystem::path& root_path)
+{
+    dir_fd_ = open(root_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd_ == -1)
+    {
+        switch (errno)
+        {
+            case EACCES:
+            case EPERM:
+                error_code_ = proto::FILE_ERROR_ACCESS_DENIED;
+                break;
+
+            default:
+                PLOG(LS_WARNING) << "Unable to open directory " << root_path;
+                break;
+        }
+
+        is_at_end_ = true;
+        return;
+    }
+
+    buffer_ = std::make_unique<char[]>(kBufferSize);
+    advance();
+}
+
+FileEnumerator::~FileEnumerator()
+{
+    if (dir_fd_ != -1)
+        close(dir_fd_);
+}
+
+bool FileEnumerator::isAtEnd() const
+{
+    return is_at_end_;
+}
+
+void FileEnumerator::advance()
+{
+    while (!is_at_end_)
+    {
+        if (buffer_pos_ >= buffer_size_ && !readEntries())
+        {
+            is_at_end_ = true;
+            break;
+        }
+
+        const LinuxDirent64* entry =
+            reinterpret_cast<const LinuxDirent64*>(buffer_.get() + buffer_pos_);
+        buffer_pos_ += entry->d_reclen;
+
+        if (shouldSkip(entry->d_name))
+            continue;
+
+        file_info_.name_ = entry->d_name;
+        file_info_.is_directory_ = entry->d_type == DT_DIR;
+        file_info_.size_ = 0;
+        file_info_.last_write_time_ = 0;
+
+        // The type from the directory entry is kept if the file cannot be queried (for example, a
+        // broken symbolic link).
+        statEntry(dir_fd_, entry->d_name, &file_info_.is_directory_, &file_info_.size_,
+                  &file_info_.last_write_time_);
+        break;
+    }
+}
+
+bool FileEnumerator::readEntries()
+{
+    long result = syscall(SYS_getdents64, dir_fd_, buffer_.get(), kBufferSize);
+    if (result < 0)
+    {
+        PLOG(LS_WARNING) << "getdents64 failed";
+        return false;
+    }
+
+    buffer_size_ = static_cast<size_t>(result);
+    buffer_pos_ = 0;
+
+    return result != 0;
+}
+
+} // namespace common
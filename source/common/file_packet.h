@@ -22,8 +22,25 @@
 namespace common {
 
 // When transferring a file is divided into parts and each part is transmitted separately.
-// This parameter specifies the size of the part.
-static const size_t kMaxFilePacketSize = 64 * 1024; // 64 kB
+// The receiver requests the size of the part, the size is chosen according to the speed of the
+// transfer. Older versions always use the default size.
+static const size_t kDefaultFilePacketSize = 64 * 1024; // 64 kB
+static const size_t kMinFilePacketSize = 64 * 1024; // 64 kB
+static const size_t kMaxFilePacketSize = 4 * 1024 * 1024; // 4 MB
+
+// Files up to this size are sent in batches, many files in one request.
+static const size_t kMaxBatchFileSize = 64 * 1024; // 64 kB
+static const size_t kMaxBatchSize = 4 * 1024 * 1024; // 4 MB
+static const size_t kMaxBatchFiles = 256;
+
+// A replaced file is compared with the source in blocks, only the changed blocks are sent. The
+// block is larger for large files to limit the number of hashes.
+static const size_t kFileBlockSize = 1024 * 1024; // 1 MB
+static const size_t kMaxFileBlockSize = 64 * 1024 * 1024; // 64 MB
+static const size_t kMaxFileBlocks = 16384;
+
+// Limits the reading of the source for one packet when the blocks are unchanged.
+static const size_t kMaxUnchangedSize = 64 * 1024 * 1024; // 64 MB
 
 } // namespace common
 
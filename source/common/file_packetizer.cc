@@ -19,8 +19,13 @@
 #include "common/file_packetizer.h"
 
 #include "base/logging.h"
+#include "base/crypto/generic_hash.h"
+#include "base/files/sequential_file_reader.h"
 #include "common/file_packet.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace common {
 
 namespace {
@@ -33,30 +38,46 @@ char* outputBuffer(proto::FilePacket* packet, size_t size)
 
 } // namespace
 
-FilePacketizer::FilePacketizer(std::ifstream&& file_stream)
-    : file_stream_(std::move(file_stream))
+FilePacketizer::FilePacketizer(std::unique_ptr<base::SequentialFileReader> reader)
+    : reader_(std::move(reader)),
+      digest_(std::make_unique<base::GenericHash>(base::GenericHash::BLAKE2b512))
 {
-    file_stream_.seekg(0, file_stream_.end);
-    file_size_ = static_cast<uint64_t>(file_stream_.tellg());
-    file_stream_.seekg(0);
-    left_size_ = file_size_;
+    DCHECK(reader_);
 }
 
+FilePacketizer::~FilePacketizer() = default;
+
 std::unique_ptr<FilePacketizer> FilePacketizer::create(const std::filesystem::path& file_path)
 {
-    std::ifstream file_stream;
-
-    file_stream.open(file_path, std::ifstream::binary);
-    if (!file_stream.is_open())
+    std::unique_ptr<base::SequentialFileReader> reader =
+        base::SequentialFileReader::open(file_path);
+    if (!reader)
         return nullptr;
 
-    return std::unique_ptr<FilePacketizer>(new FilePacketizer(std::move(file_stream)));
+    return std::unique_ptr<FilePacketizer>(new FilePacketizer(std::move(reader)));
+}
+
+void FilePacketizer::setBlockHashes(const proto::FileBlockHashes& block_hashes)
+{
+    // The blocks are compared from the beginning of the file.
+    if (!is_first_packet_)
+        return;
+
+    const size_t block_size = block_hashes.block_size();
+    if (block_size < kFileBlockSize || block_size > kMaxFileBlockSize)
+    {
+        LOG(LS_WARNING) << "Invalid block size: " << block_size;
+        return;
+    }
+
+    block_size_ = block_size;
+    block_hashes_.assign(block_hashes.hash().begin(), block_hashes.hash().end());
 }
 
 std::unique_ptr<proto::FilePacket> FilePacketizer::readNextPacket(
     const proto::FilePacketRequest& request)
 {
-    DCHECK(file_stream_.is_open());
+    DCHECK(reader_);
 
     // Create a new file packet.
     std::unique_ptr<proto::FilePacket> packet = std::make_unique<proto::FilePacket>();
@@ -67,42 +88,100 @@ std::unique_ptr<proto::FilePacket> FilePacketizer::readNextPacket(
         return packet;
     }
 
-    size_t packet_buffer_size = kMaxFilePacketSize;
+    size_t packet_buffer_size = kDefaultFilePacketSize;
+
+    if (request.packet_size())
+    {
+        packet_buffer_size = std::clamp(static_cast<size_t>(request.packet_size()),
+                                        kMinFilePacketSize, kMaxFilePacketSize);
+    }
 
-    if (left_size_ < kMaxFilePacketSize)
-        packet_buffer_size = static_cast<size_t>(left_size_);
+    uint64_t unchanged_size = 0;
+    if (!readChangedBlock(&unchanged_size))
+        return nullptr;
 
-    char* packet_buffer = outputBuffer(packet.get(), packet_buffer_size);
+    if (unchanged_size)
+    {
+        packet->set_unchanged_size(unchanged_size);
+    }
+    else if (block_offset_ < block_.size())
+    {
+        packet_buffer_size = std::min(packet_buffer_size, block_.size() - block_offset_);
 
-    // Moving to a new position in file.
-    file_stream_.seekg(static_cast<std::streamoff>(file_size_ - left_size_));
+        char* packet_buffer = outputBuffer(packet.get(), packet_buffer_size);
+        memcpy(packet_buffer, block_.data() + block_offset_, packet_buffer_size);
 
-    file_stream_.read(packet_buffer, packet_buffer_size);
-    if (file_stream_.fail())
+        block_offset_ += packet_buffer_size;
+    }
+    else
     {
-        LOG(LS_WARNING) << "Unable to read file";
-        return nullptr;
+        // The next request usually asks for the same size. The system reads it ahead while this
+        // packet is on the way.
+        const size_t read_ahead_size = packet_buffer_size;
+
+        if (reader_->leftSize() < packet_buffer_size)
+            packet_buffer_size = static_cast<size_t>(reader_->leftSize());
+
+        char* packet_buffer = outputBuffer(packet.get(), packet_buffer_size);
+
+        if (!reader_->read(packet_buffer, packet_buffer_size, read_ahead_size))
+        {
+            LOG(LS_WARNING) << "Unable to read file";
+            return nullptr;
+        }
     }
 
-    if (left_size_ == file_size_)
+    digest_->addData(packet->data());
+
+    if (is_first_packet_)
     {
+        is_first_packet_ = false;
+
         packet->set_flags(packet->flags() | proto::FilePacket::FIRST_PACKET);
 
         // Set file path and size in first packet.
-        packet->set_file_size(file_size_);
+        packet->set_file_size(reader_->size());
     }
 
-    left_size_ -= packet_buffer_size;
-
-    if (!left_size_)
+    if (!reader_->leftSize() && block_offset_ == block_.size())
     {
-        file_size_ = 0;
-        file_stream_.close();
-
+        reader_.reset();
         packet->set_flags(packet->flags() | proto::FilePacket::LAST_PACKET);
+        packet->set_digest(base::toStdString(digest_->result()));
     }
 
     return packet;
 }
 
+bool FilePacketizer::readChangedBlock(uint64_t* unchanged_size)
+{
+    // The blocks are read while they match the target and nothing else is waiting to be sent.
+    while (block_offset_ == block_.size() && block_index_ < block_hashes_.size() &&
+           reader_->leftSize() && *unchanged_size < kMaxUnchangedSize)
+    {
+        const size_t size = static_cast<size_t>(
+            std::min(reader_->leftSize(), static_cast<uint64_t>(block_size_)));
+
+        block_.resize(size);
+        block_offset_ = 0;
+
+        if (!reader_->read(block_.data(), size, block_size_))
+        {
+            LOG(LS_WARNING) << "Unable to read file";
+            return false;
+        }
+
+        const std::string hash = base::toStdString(
+            base::GenericHash::hash(base::GenericHash::SHA256, block_.data(), size));
+
+        if (hash == block_hashes_[block_index_++])
+        {
+            *unchanged_size += size;
+            block_.clear();
+        }
+    }
+
+    return true;
+}
+
 } // namespace common
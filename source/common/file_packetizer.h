@@ -23,31 +23,49 @@
 #include "proto/file_transfer.pb.h"
 
 #include <filesystem>
-#include <fstream>
 #include <memory>
+#include <string>
+#include <vector>
+
+namespace base {
+class GenericHash;
+class SequentialFileReader;
+} // namespace base
 
 namespace common {
 
 class FilePacketizer
 {
 public:
-    ~FilePacketizer() = default;
+    ~FilePacketizer();
 
     // Creates an instance of the class.
     // Parameter |file_path| contains the full path to the file.
     // If the specified file can not be opened for reading, then returns nullptr.
     static std::unique_ptr<FilePacketizer> create(const std::filesystem::path& file_path);
 
+    // Sets the hashes of the blocks of the file on the target. The matching blocks are not sent.
+    void setBlockHashes(const proto::FileBlockHashes& block_hashes);
+
     // Creates a packet for transferring.
     std::unique_ptr<proto::FilePacket> readNextPacket(const proto::FilePacketRequest& request);
 
 private:
-    explicit FilePacketizer(std::ifstream&& file_stream);
+    explicit FilePacketizer(std::unique_ptr<base::SequentialFileReader> reader);
+
+    bool readChangedBlock(uint64_t* unchanged_size);
+
+    std::unique_ptr<base::SequentialFileReader> reader_;
+    std::unique_ptr<base::GenericHash> digest_;
+    bool is_first_packet_ = true;
 
-    std::ifstream file_stream_;
+    size_t block_size_ = 0;
+    std::vector<std::string> block_hashes_;
+    size_t block_index_ = 0;
 
-    uint64_t file_size_ = 0;
-    uint64_t left_size_ = 0;
+    // The block that differs from the target. It is sent in one or more packets.
+    std::string block_;
+    size_t block_offset_ = 0;
 
     DISALLOW_COPY_AND_ASSIGN(FilePacketizer);
 };
@@ -53,6 +53,18 @@ const proto::FileReply& FileTask::reply() const
     return *reply_;
 }
 
+proto::FileRequest* FileTask::mutableRequest()
+{
+    DCHECK(!reply_);
+    return request_.get();
+}
+
+proto::FileReply* FileTask::mutableReply()
+{
+    DCHECK(reply_);
+    return reply_.get();
+}
+
 void FileTask::setReply(std::unique_ptr<proto::FileReply> reply)
 {
     // Save the reply inside the request.
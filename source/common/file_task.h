@@ -53,11 +53,18 @@ public:
     // Returns the data of the current request.
     const proto::FileRequest& request() const;
 
+    // Returns the request for modification. It can be called only before the request is sent.
+    proto::FileRequest* mutableRequest();
+
     // Returns reply data for the current request.
     // If method setReply has not been called and data has not been set, an empty reply will be
     // returned.
     const proto::FileReply& reply() const;
 
+    // Returns the reply for modification. It can be called only after the reply is set. Allows to
+    // move the file data to the next request without copying.
+    proto::FileReply* mutableReply();
+
     // Sets the reply to the current request. The sender will be notified of this reply.
     void setReply(std::unique_ptr<proto::FileReply> reply);
 
@@ -41,10 +41,16 @@ std::shared_ptr<FileTask> FileTaskFactory::driveList()
     return makeTask(std::move(request));
 }
 
-std::shared_ptr<FileTask> FileTaskFactory::fileList(const std::string& path)
+std::shared_ptr<FileTask> FileTaskFactory::fileList(
+    const std::string& path, uint32_t part_size, bool next_part)
 {
     auto request = std::make_unique<proto::FileRequest>();
-    request->mutable_file_list_request()->set_path(path);
+
+    proto::FileListRequest* file_list_request = request->mutable_file_list_request();
+    file_list_request->set_path(path);
+    file_list_request->set_part_size(part_size);
+    file_list_request->set_next_part(next_part);
+
     return makeTask(std::move(request));
 }
 
@@ -67,10 +73,17 @@ std::shared_ptr<FileTask> FileTaskFactory::rename(
     return makeTask(std::move(request));
 }
 
-std::shared_ptr<FileTask> FileTaskFactory::remove(const std::string& path)
+std::shared_ptr<FileTask> FileTaskFactory::remove(
+    const std::string& path, bool recursive, uint32_t part_size, bool next_part)
 {
     auto request = std::make_unique<proto::FileRequest>();
-    request->mutable_remove_request()->set_path(path);
+
+    proto::RemoveRequest* remove_request = request->mutable_remove_request();
+    remove_request->set_path(path);
+    remove_request->set_recursive(recursive);
+    remove_request->set_part_size(part_size);
+    remove_request->set_next_part(next_part);
+
     return makeTask(std::move(request));
 }
 
@@ -81,21 +94,60 @@ std::shared_ptr<FileTask> FileTaskFactory::download(const std::string& file_path
     return makeTask(std::move(request));
 }
 
-std::shared_ptr<FileTask> FileTaskFactory::upload(const std::string& file_path, bool overwrite)
+std::shared_ptr<FileTask> FileTaskFactory::upload(
+    const std::string& file_path, bool overwrite, bool resume)
 {
     auto request = std::make_unique<proto::FileRequest>();
 
     proto::UploadRequest* upload_request = request->mutable_upload_request();
     upload_request->set_path(file_path);
     upload_request->set_overwrite(overwrite);
+    upload_request->set_resume(resume);
+
+    return makeTask(std::move(request));
+}
+
+std::shared_ptr<FileTask> FileTaskFactory::batchDownload(
+    const std::vector<std::string>& file_paths)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+
+    proto::BatchDownloadRequest* batch_request = request->mutable_batch_download_request();
+    for (const auto& file_path : file_paths)
+        batch_request->add_path(file_path);
+
+    return makeTask(std::move(request));
+}
 
+std::shared_ptr<FileTask> FileTaskFactory::batchUpload(std::unique_ptr<proto::FileBatch> batch)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+    request->set_allocated_batch_upload_request(batch.release());
+    return makeTask(std::move(request));
+}
+
+std::shared_ptr<FileTask> FileTaskFactory::copy(std::unique_ptr<proto::CopyRequest> copy_request)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+    request->set_allocated_copy_request(copy_request.release());
+    return makeTask(std::move(request));
+}
+
+std::shared_ptr<FileTask> FileTaskFactory::packetRequest(uint32_t flags, uint32_t packet_size)
+{
+    auto request = std::make_unique<proto::FileRequest>();
+    request->mutable_packet_request()->set_flags(flags);
+    request->mutable_packet_request()->set_packet_size(packet_size);
     return makeTask(std::move(request));
 }
 
-std::shared_ptr<FileTask> FileTaskFactory::packetRequest(uint32_t flags)
+std::shared_ptr<FileTask> FileTaskFactory::packetRequest(
+    uint32_t flags, uint32_t packet_size, std::unique_ptr<proto::FileBlockHashes> block_hashes)
 {
     auto request = std::make_unique<proto::FileRequest>();
     request->mutable_packet_request()->set_flags(flags);
+    request->mutable_packet_request()->set_packet_size(packet_size);
+    request->mutable_packet_request()->set_allocated_block_hashes(block_hashes.release());
     return makeTask(std::move(request));
 }
 
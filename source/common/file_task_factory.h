@@ -22,8 +22,12 @@
 #include "common/file_task.h"
 
 #include <string>
+#include <vector>
 
 namespace proto {
+class CopyRequest;
+class FileBatch;
+class FileBlockHashes;
 class FilePacket;
 } // namespace proto
 
@@ -38,13 +42,23 @@ public:
     FileTask::Target target() const { return target_; }
 
     std::shared_ptr<FileTask> driveList();
-    std::shared_ptr<FileTask> fileList(const std::string& path);
+    std::shared_ptr<FileTask> fileList(
+        const std::string& path, uint32_t part_size = 0, bool next_part = false);
     std::shared_ptr<FileTask> createDirectory(const std::string& path);
     std::shared_ptr<FileTask> rename(const std::string& old_name, const std::string& new_name);
-    std::shared_ptr<FileTask> remove(const std::string& path);
+    std::shared_ptr<FileTask> remove(const std::string& path, bool recursive = false,
+                                     uint32_t part_size = 0, bool next_part = false);
     std::shared_ptr<FileTask> download(const std::string& file_path);
-    std::shared_ptr<FileTask> upload(const std::string& file_path, bool overwrite);
-    std::shared_ptr<FileTask> packetRequest(uint32_t flags);
+    std::shared_ptr<FileTask> upload(
+        const std::string& file_path, bool overwrite, bool resume = false);
+    std::shared_ptr<FileTask> batchDownload(const std::vector<std::string>& file_paths);
+    std::shared_ptr<FileTask> batchUpload(std::unique_ptr<proto::FileBatch> batch);
+    std::shared_ptr<FileTask> copy(std::unique_ptr<proto::CopyRequest> copy_request);
+    std::shared_ptr<FileTask> packetRequest(uint32_t flags, uint32_t packet_size = 0);
+    std::shared_ptr<FileTask> packetRequest(
+        uint32_t flags,
+        uint32_t packet_size,
+        std::unique_ptr<proto::FileBlockHashes> block_hashes);
     std::shared_ptr<FileTask> packet(const proto::FilePacket& packet);
     std::shared_ptr<FileTask> packet(std::unique_ptr<proto::FilePacket> packet);
 
@@ -21,23 +21,100 @@
 #include "base/logging.h"
 #include "base/task_runner.h"
 #include "base/files/base_paths.h"
+#include "base/files/file_util.h"
+#include "base/threading/thread.h"
 #include "build/build_config.h"
 #include "common/file_depacketizer.h"
 #include "common/file_packetizer.h"
 #include "common/file_enumerator.h"
+#include "common/file_packet.h"
 #include "common/file_platform_util.h"
 #include "common/file_task.h"
 
+#include <limits>
+#include <vector>
+
 #if defined(OS_WIN)
 #include "base/win/drive_enumerator.h"
 #endif // defined(OS_WIN)
 
 namespace common {
 
+namespace {
+
+proto::FileError removePath(const std::filesystem::path& path, bool is_symlink)
+{
+    std::error_code ignored_code;
+    if (std::filesystem::remove(path, ignored_code))
+        return proto::FILE_ERROR_SUCCESS;
+
+    // Read-only files cannot be removed on Windows. The permissions of a symbolic link would
+    // change its target, so it is not retried.
+    if (!is_symlink)
+    {
+        std::filesystem::permissions(
+            path,
+            std::filesystem::perms::owner_all | std::filesystem::perms::group_all,
+            std::filesystem::perm_options::add,
+            ignored_code);
+
+        if (std::filesystem::remove(path, ignored_code))
+            return proto::FILE_ERROR_SUCCESS;
+    }
+
+    return proto::FILE_ERROR_ACCESS_DENIED;
+}
+
+proto::FileError copyEntry(const proto::CopyRequest::Entry& entry)
+{
+    std::filesystem::path source_path = std::filesystem::u8path(entry.source_path());
+    std::filesystem::path target_path = std::filesystem::u8path(entry.target_path());
+
+    std::error_code error_code;
+    std::filesystem::file_status target_status =
+        std::filesystem::status(target_path, error_code);
+
+    if (entry.is_directory())
+    {
+        if (std::filesystem::is_directory(target_status))
+            return proto::FILE_ERROR_SUCCESS;
+
+        if (std::filesystem::exists(target_status))
+            return proto::FILE_ERROR_PATH_ALREADY_EXISTS;
+
+        if (!std::filesystem::create_directory(target_path, error_code))
+            return proto::FILE_ERROR_ACCESS_DENIED;
+
+        return proto::FILE_ERROR_SUCCESS;
+    }
+
+    if (std::filesystem::exists(target_status))
+    {
+        if (!entry.overwrite())
+            return proto::FILE_ERROR_PATH_ALREADY_EXISTS;
+
+        // A file cannot be copied over itself.
+        if (std::filesystem::equivalent(source_path, target_path, error_code))
+            return proto::FILE_ERROR_PATH_ALREADY_EXISTS;
+    }
+
+    if (!std::filesystem::exists(source_path, error_code))
+        return error_code ? proto::FILE_ERROR_ACCESS_DENIED : proto::FILE_ERROR_PATH_NOT_FOUND;
+
+    if (!base::copyFile(source_path, target_path, entry.overwrite()))
+        return proto::FILE_ERROR_FILE_CREATE_ERROR;
+
+    return proto::FILE_ERROR_SUCCESS;
+}
+
+} // namespace
+
 class FileWorker::Impl : public std::enable_shared_from_this<Impl>
 {
 public:
-    explicit Impl(std::shared_ptr<base::TaskRunner> task_runner);
+    Impl(std::shared_ptr<base::TaskRunner> task_runner,
+         std::shared_ptr<base::TaskRunner> data_task_runner,
+         std::shared_ptr<base::TaskRunner> metadata_task_runner);
     ~Impl();
 
     void doTask(std::shared_ptr<FileTask> task);
@@ -45,41 +122,125 @@ public:
     std::shared_ptr<base::TaskRunner> taskRunner() { return task_runner_; }
 
 private:
+    std::unique_ptr<proto::FileReply> executeRequest(const proto::FileRequest& request);
     std::unique_ptr<proto::FileReply> doRequest(const proto::FileRequest& request);
     std::unique_ptr<proto::FileReply> doDriveListRequest();
     std::unique_ptr<proto::FileReply> doFileListRequest(const proto::FileListRequest& request);
     std::unique_ptr<proto::FileReply> doCreateDirectoryRequest(const proto::CreateDirectoryRequest& request);
     std::unique_ptr<proto::FileReply> doRenameRequest(const proto::RenameRequest& request);
     std::unique_ptr<proto::FileReply> doRemoveRequest(const proto::RemoveRequest& request);
+    std::unique_ptr<proto::FileReply> doRecursiveRemoveRequest(
+        const proto::RemoveRequest& request);
+    void removeEntry(const std::filesystem::path& path, bool is_symlink,
+                     proto::RemoveProgress* progress);
     std::unique_ptr<proto::FileReply> doDownloadRequest(const proto::DownloadRequest& request);
     std::unique_ptr<proto::FileReply> doUploadRequest(const proto::UploadRequest& request);
     std::unique_ptr<proto::FileReply> doPacketRequest(const proto::FilePacketRequest& request);
     std::unique_ptr<proto::FileReply> doPacket(const proto::FilePacket& packet);
+    std::unique_ptr<proto::FileReply> doBatchDownloadRequest(
+        const proto::BatchDownloadRequest& request);
+    std::unique_ptr<proto::FileReply> doBatchUploadRequest(const proto::FileBatch& request);
+    std::unique_ptr<proto::FileReply> doCopyRequest(const proto::CopyRequest& request);
 
     std::shared_ptr<base::TaskRunner> task_runner_;
+    std::shared_ptr<base::TaskRunner> data_task_runner_;
+    std::shared_ptr<base::TaskRunner> metadata_task_runner_;
+
+    // The received files are written to the disk on this thread, so the next packets can be
+    // received while the disk is busy.
+    base::Thread write_thread_;
+
     std::unique_ptr<FileDepacketizer> depacketizer_;
     std::unique_ptr<FilePacketizer> packetizer_;
 
+    // The directory that is listed in parts.
+    std::string list_path_;
+    std::unique_ptr<FileEnumerator> list_enumerator_;
+
+    // The directory that is removed in parts. The stack has the directories from the removed one
+    // down to the one being emptied now.
+    struct RemoveFrame
+    {
+        std::filesystem::path path;
+        std::unique_ptr<FileEnumerator> enumerator;
+        bool has_failures = false;
+    };
+
+    std::string remove_path_;
+    std::vector<RemoveFrame> remove_stack_;
+
     DISALLOW_COPY_AND_ASSIGN(Impl);
 };
 
-FileWorker::Impl::Impl(std::shared_ptr<base::TaskRunner> task_runner)
-    : task_runner_(std::move(task_runner))
+FileWorker::Impl::Impl(std::shared_ptr<base::TaskRunner> task_runner,
+                       std::shared_ptr<base::TaskRunner> data_task_runner,
+                       std::shared_ptr<base::TaskRunner> metadata_task_runner)
+    : task_runner_(std::move(task_runner)),
+      data_task_runner_(std::move(data_task_runner)),
+      metadata_task_runner_(std::move(metadata_task_runner))
 {
     DCHECK(task_runner_);
+    DCHECK(data_task_runner_);
+    DCHECK(metadata_task_runner_);
 }
 
-FileWorker::Impl::~Impl() = default;
+FileWorker::Impl::~Impl()
+{
+    // The depacketizer waits for its writes on the thread. The incomplete file is kept, the
+    // transfer can be resumed by the next connection.
+    if (depacketizer_)
+    {
+        depacketizer_->keepIncompleteFile();
+        depacketizer_.reset();
+    }
+
+    write_thread_.stop();
+}
 
 void FileWorker::Impl::doTask(std::shared_ptr<FileTask> task)
 {
     auto self = shared_from_this();
-    task_runner_->postTask([self, task]()
+
+    const proto::FileRequest& request = task->request();
+    const bool is_metadata_request =
+        request.has_drive_list_request() || request.has_file_list_request() ||
+        request.has_create_directory_request() || request.has_rename_request() ||
+        request.has_remove_request();
+
+    std::shared_ptr<base::TaskRunner> task_runner =
+        is_metadata_request ? metadata_task_runner_ : data_task_runner_;
+
+    if (task_runner == task_runner_)
     {
-        task->setReply(self->doRequest(task->request()));
+        task_runner_->postTask([self, task]()
+        {
+            task->setReply(self->executeRequest(task->request()));
+        });
+        return;
+    }
+
+    task_runner->postTask([self, task]()
+    {
+        std::shared_ptr<proto::FileReply> reply = self->executeRequest(task->request());
+
+        // The sender expects the reply on the thread of the worker.
+        self->task_runner_->postTask([task, reply]()
+        {
+            task->setReply(std::make_unique<proto::FileReply>(std::move(*reply)));
+        });
     });
 }
 
+std::unique_ptr<proto::FileReply> FileWorker::Impl::executeRequest(
+    const proto::FileRequest& request)
+{
+    std::unique_ptr<proto::FileReply> reply = doRequest(request);
+
+    // The replies can come in a different order than the requests.
+    reply->set_request_id(request.request_id());
+    return reply;
+}
+
 std::unique_ptr<proto::FileReply> FileWorker::Impl::doRequest(const proto::FileRequest& request)
 {
 #if defined(OS_WIN)
@@ -124,6 +285,18 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doRequest(const proto::FileR
     {
         return doPacket(request.packet());
     }
+    else if (request.has_batch_download_request())
+    {
+        return doBatchDownloadRequest(request.batch_download_request());
+    }
+    else if (request.has_batch_upload_request())
+    {
+        return doBatchUploadRequest(request.batch_upload_request());
+    }
+    else if (request.has_copy_request())
+    {
+        return doCopyRequest(request.copy_request());
+    }
     else
     {
         std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
@@ -221,30 +394,49 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doFileListRequest(
     const proto::FileListRequest& request)
 {
     std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+    std::unique_ptr<FileEnumerator> enumerator;
 
-    std::filesystem::path path = std::filesystem::u8path(request.path());
-
-    std::error_code ignored_code;
-    std::filesystem::file_status status = std::filesystem::status(path, ignored_code);
-
-    if (!std::filesystem::exists(status))
+    if (request.next_part())
     {
-        reply->set_error_code(proto::FILE_ERROR_PATH_NOT_FOUND);
-        return reply;
-    }
+        if (!list_enumerator_ || list_path_ != request.path())
+        {
+            reply->set_error_code(proto::FILE_ERROR_INVALID_REQUEST);
+            return reply;
+        }
 
-    if (!std::filesystem::is_directory(status))
+        enumerator = std::move(list_enumerator_);
+    }
+    else
     {
-        reply->set_error_code(proto::FILE_ERROR_INVALID_PATH_NAME);
-        return reply;
+        std::filesystem::path path = std::filesystem::u8path(request.path());
+
+        std::error_code ignored_code;
+        std::filesystem::file_status status = std::filesystem::status(path, ignored_code);
+
+        if (!std::filesystem::exists(status))
+        {
+            reply->set_error_code(proto::FILE_ERROR_PATH_NOT_FOUND);
+            return reply;
+        }
+
+        if (!std::filesystem::is_directory(status))
+        {
+            reply->set_error_code(proto::FILE_ERROR_INVALID_PATH_NAME);
+            return reply;
+        }
+
+        enumerator = std::make_unique<FileEnumerator>(path);
     }
 
+    uint32_t left_items = request.part_size();
+    if (!left_items)
+        left_items = std::numeric_limits<uint32_t>::max();
+
     proto::FileList* file_list = reply->mutable_file_list();
-    FileEnumerator enumerator(path);
 
-    while (!enumerator.isAtEnd())
+    while (!enumerator->isAtEnd() && left_items)
     {
-        const FileEnumerator::FileInfo& file_info = enumerator.fileInfo();
+        const FileEnumerator::FileInfo& file_info = enumerator->fileInfo();
 
         proto::FileList::Item* item = file_list->add_item();
         item->set_name(file_info.u8name());
@@ -252,10 +444,27 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doFileListRequest(
         item->set_modification_time(file_info.lastWriteTime());
         item->set_is_directory(file_info.isDirectory());
 
-        enumerator.advance();
+        enumerator->advance();
+        --left_items;
+    }
+
+    reply->set_error_code(enumerator->errorCode());
+
+    if (request.part_size())
+    {
+        // A new list replaces the unfinished one.
+        list_enumerator_.reset();
+        list_path_.clear();
+
+        if (!enumerator->isAtEnd())
+        {
+            file_list->set_has_more(true);
+
+            list_path_ = request.path();
+            list_enumerator_ = std::move(enumerator);
+        }
     }
 
-    reply->set_error_code(enumerator.errorCode());
     return reply;
 }
 
@@ -336,6 +545,9 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doRenameRequest(
 std::unique_ptr<proto::FileReply> FileWorker::Impl::doRemoveRequest(
     const proto::RemoveRequest& request)
 {
+    if (request.recursive())
+        return doRecursiveRemoveRequest(request);
+
     std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
 
     std::filesystem::path path = std::filesystem::u8path(request.path());
@@ -368,6 +580,141 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doRemoveRequest(
     return reply;
 }
 
+std::unique_ptr<proto::FileReply> FileWorker::Impl::doRecursiveRemoveRequest(
+    const proto::RemoveRequest& request)
+{
+    std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+
+    // The progress is set even for errors, so the sender knows that recursive removal is
+    // supported.
+    proto::RemoveProgress* progress = reply->mutable_remove_progress();
+
+    if (request.next_part())
+    {
+        if (remove_stack_.empty() || remove_path_ != request.path())
+        {
+            reply->set_error_code(proto::FILE_ERROR_INVALID_REQUEST);
+            return reply;
+        }
+    }
+    else
+    {
+        // A new removal replaces the unfinished one.
+        remove_stack_.clear();
+        remove_path_.clear();
+
+        std::filesystem::path path = std::filesystem::u8path(request.path());
+
+        std::error_code error_code;
+        std::filesystem::file_status status = std::filesystem::symlink_status(path, error_code);
+
+        if (!std::filesystem::exists(status))
+        {
+            if (error_code && error_code != std::errc::no_such_file_or_directory)
+                reply->set_error_code(proto::FILE_ERROR_ACCESS_DENIED);
+            else
+                reply->set_error_code(proto::FILE_ERROR_PATH_NOT_FOUND);
+
+            return reply;
+        }
+
+        if (!std::filesystem::is_directory(status))
+        {
+            reply->set_error_code(removePath(path, std::filesystem::is_symlink(status)));
+            if (reply->error_code() == proto::FILE_ERROR_SUCCESS)
+            {
+                progress->set_removed_count(1);
+                progress->set_last_path(request.path());
+            }
+            return reply;
+        }
+
+        remove_stack_.emplace_back();
+        remove_stack_.back().path = std::move(path);
+    }
+
+    uint32_t left_items = request.part_size();
+    if (!left_items)
+        left_items = std::numeric_limits<uint32_t>::max();
+
+    while (!remove_stack_.empty() && left_items)
+    {
+        RemoveFrame& frame = remove_stack_.back();
+
+        if (!frame.enumerator)
+            frame.enumerator = std::make_unique<FileEnumerator>(frame.path);
+
+        if (frame.enumerator->isAtEnd())
+        {
+            // The directory is empty now or has the items that could not be removed.
+            RemoveFrame done = std::move(frame);
+            remove_stack_.pop_back();
+            done.enumerator.reset();
+
+            if (done.has_failures)
+            {
+                if (!remove_stack_.empty())
+                    remove_stack_.back().has_failures = true;
+                continue;
+            }
+
+            removeEntry(done.path, false, progress);
+            --left_items;
+            continue;
+        }
+
+        std::filesystem::path child = frame.path / frame.enumerator->fileInfo().name();
+        frame.enumerator->advance();
+
+        // Symbolic links and junctions to directories are removed without their targets.
+        std::error_code ignored_code;
+        std::filesystem::file_status status = std::filesystem::symlink_status(child, ignored_code);
+
+        if (std::filesystem::is_directory(status))
+        {
+            remove_stack_.emplace_back();
+            remove_stack_.back().path = std::move(child);
+            continue;
+        }
+
+        removeEntry(child, std::filesystem::is_symlink(status), progress);
+        --left_items;
+    }
+
+    if (remove_stack_.empty())
+    {
+        remove_path_.clear();
+    }
+    else
+    {
+        progress->set_has_more(true);
+        remove_path_ = request.path();
+    }
+
+    reply->set_error_code(proto::FILE_ERROR_SUCCESS);
+    return reply;
+}
+
+void FileWorker::Impl::removeEntry(const std::filesystem::path& path, bool is_symlink,
+                                   proto::RemoveProgress* progress)
+{
+    proto::FileError error_code = removePath(path, is_symlink);
+    if (error_code == proto::FILE_ERROR_SUCCESS)
+    {
+        progress->set_removed_count(progress->removed_count() + 1);
+        progress->set_last_path(path.u8string());
+        return;
+    }
+
+    proto::RemoveProgress::Failure* failure = progress->add_failure();
+    failure->set_path(path.u8string());
+    failure->set_error_code(error_code);
+
+    // The parent directory cannot be removed now.
+    if (!remove_stack_.empty())
+        remove_stack_.back().has_failures = true;
+}
+
 std::unique_ptr<proto::FileReply> FileWorker::Impl::doDownloadRequest(
     const proto::DownloadRequest& request)
 {
@@ -401,9 +748,22 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doUploadRequest(
             }
         }
 
-        depacketizer_ = FileDepacketizer::create(file_path, request.overwrite());
+        if (!write_thread_.isRunning())
+            write_thread_.start(base::MessageLoop::Type::DEFAULT);
+
+        if (request.overwrite() && request.resume())
+        {
+            depacketizer_ = FileDepacketizer::resume(
+                file_path, write_thread_.taskRunner(), reply->mutable_block_hashes());
+        }
+        else
+        {
+            depacketizer_ = FileDepacketizer::create(file_path, write_thread_.taskRunner());
+        }
+
         if (!depacketizer_)
         {
+            reply->clear_block_hashes();
             reply->set_error_code(proto::FILE_ERROR_FILE_CREATE_ERROR);
             break;
         }
@@ -428,6 +788,9 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doPacketRequest(
     }
     else
     {
+        if (request.has_block_hashes())
+            packetizer_->setBlockHashes(request.block_hashes());
+
         std::unique_ptr<proto::FilePacket> packet = packetizer_->readNextPacket(request);
         if (!packet)
         {
@@ -461,7 +824,8 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doPacket(const proto::FilePa
     {
         if (!depacketizer_->writeNextPacket(packet))
         {
-            reply->set_error_code(proto::FILE_ERROR_FILE_WRITE_ERROR);
+            reply->set_error_code(depacketizer_->isDigestMismatch() ?
+                proto::FILE_ERROR_CHECKSUM_MISMATCH : proto::FILE_ERROR_FILE_WRITE_ERROR);
             depacketizer_.reset();
         }
         else
@@ -476,8 +840,134 @@ std::unique_ptr<proto::FileReply> FileWorker::Impl::doPacket(const proto::FilePa
     return reply;
 }
 
+std::unique_ptr<proto::FileReply> FileWorker::Impl::doBatchDownloadRequest(
+    const proto::BatchDownloadRequest& request)
+{
+    std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+    proto::FileBatch* batch = reply->mutable_batch();
+
+    size_t batch_size = 0;
+
+    for (int i = 0; i < request.path_size(); ++i)
+    {
+        proto::FileBatch::Entry* entry = batch->add_entry();
+        entry->set_path(request.path(i));
+
+        if (i >= static_cast<int>(kMaxBatchFiles))
+        {
+            entry->set_error_code(proto::FILE_ERROR_INVALID_REQUEST);
+            continue;
+        }
+
+        std::filesystem::path file_path = std::filesystem::u8path(request.path(i));
+
+        // The file could grow after the client has listed it. The large files are sent in
+        // packets.
+        std::error_code error_code;
+        uintmax_t file_size = std::filesystem::file_size(file_path, error_code);
+        if (error_code)
+        {
+            entry->set_error_code(proto::FILE_ERROR_FILE_OPEN_ERROR);
+            continue;
+        }
+
+        if (file_size > kMaxBatchFileSize || batch_size + file_size > kMaxBatchSize)
+        {
+            entry->set_error_code(proto::FILE_ERROR_INVALID_REQUEST);
+            continue;
+        }
+
+        if (!base::readFile(file_path, entry->mutable_data()) ||
+            entry->data().size() > kMaxBatchFileSize)
+        {
+            entry->clear_data();
+            entry->set_error_code(proto::FILE_ERROR_FILE_READ_ERROR);
+            continue;
+        }
+
+        batch_size += entry->data().size();
+        entry->set_error_code(proto::FILE_ERROR_SUCCESS);
+    }
+
+    reply->set_error_code(proto::FILE_ERROR_SUCCESS);
+    return reply;
+}
+
+std::unique_ptr<proto::FileReply> FileWorker::Impl::doBatchUploadRequest(
+    const proto::FileBatch& request)
+{
+    std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+    proto::FileBatch* batch = reply->mutable_batch();
+
+    for (int i = 0; i < request.entry_size(); ++i)
+    {
+        const proto::FileBatch::Entry& request_entry = request.entry(i);
+
+        // The reply has the same entries without data.
+        proto::FileBatch::Entry* entry = batch->add_entry();
+        entry->set_path(request_entry.path());
+
+        std::filesystem::path file_path = std::filesystem::u8path(request_entry.path());
+
+        if (!request_entry.overwrite())
+        {
+            std::error_code ignored_code;
+            if (std::filesystem::exists(file_path, ignored_code))
+            {
+                entry->set_error_code(proto::FILE_ERROR_PATH_ALREADY_EXISTS);
+                continue;
+            }
+        }
+
+        if (!base::writeFile(file_path, request_entry.data()))
+        {
+            // An incomplete file is not left.
+            std::error_code ignored_code;
+            std::filesystem::remove(file_path, ignored_code);
+
+            entry->set_error_code(proto::FILE_ERROR_FILE_CREATE_ERROR);
+            continue;
+        }
+
+        entry->set_error_code(proto::FILE_ERROR_SUCCESS);
+    }
+
+    reply->set_error_code(proto::FILE_ERROR_SUCCESS);
+    return reply;
+}
+
+std::unique_ptr<proto::FileReply> FileWorker::Impl::doCopyRequest(
+    const proto::CopyRequest& request)
+{
+    std::unique_ptr<proto::FileReply> reply = std::make_unique<proto::FileReply>();
+    proto::CopyResult* result = reply->mutable_copy_result();
+
+    for (int i = 0; i < request.entry_size(); ++i)
+    {
+        proto::FileError error_code = copyEntry(request.entry(i));
+        result->add_error_code(error_code);
+
+        // The next entries can be the contents of the failed directory.
+        if (error_code != proto::FILE_ERROR_SUCCESS)
+            break;
+    }
+
+    reply->set_error_code(proto::FILE_ERROR_SUCCESS);
+    return reply;
+}
+
 FileWorker::FileWorker(std::shared_ptr<base::TaskRunner> task_runner)
-    : impl_(std::make_shared<Impl>(std::move(task_runner)))
+    : impl_(std::make_shared<Impl>(task_runner, task_runner, task_runner))
+{
+    // Nothing
+}
+
+FileWorker::FileWorker(std::shared_ptr<base::TaskRunner> task_runner,
+                       std::shared_ptr<base::TaskRunner> data_task_runner,
+                       std::shared_ptr<base::TaskRunner> metadata_task_runner)
+    : impl_(std::make_shared<Impl>(std::move(task_runner),
+                                   std::move(data_task_runner),
+                                   std::move(metadata_task_runner)))
 {
     // Nothing
 }
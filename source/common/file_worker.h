@@ -34,7 +34,16 @@ class FileTask;
 class FileWorker
 {
 public:
+    // All requests are executed on |task_runner| in the order they are received.
     explicit FileWorker(std::shared_ptr<base::TaskRunner> task_runner);
+
+    // The requests for the data of the files are executed on |data_task_runner| in the order they
+    // are received. The lists of files, renaming and removing are executed on
+    // |metadata_task_runner|, so they do not wait for a large file. The replies are delivered on
+    // |task_runner|.
+    FileWorker(std::shared_ptr<base::TaskRunner> task_runner,
+               std::shared_ptr<base::TaskRunner> data_task_runner,
+               std::shared_ptr<base::TaskRunner> metadata_task_runner);
     ~FileWorker();
 
     void doTask(std::shared_ptr<FileTask> task);
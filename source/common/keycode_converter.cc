@@ -21,6 +21,8 @@
 
 #include <QtCore>
 
+#include <array>
+
 namespace common {
 
 namespace {
@@ -36,12 +38,75 @@ namespace {
 #else
 #define USB_KEYMAP(usb, evdev, xkb, win, mac, qt) {usb, 0, qt}
 #endif
-#define USB_KEYMAP_DECLARATION const KeycodeMapEntry usb_keycode_map[] =
+#define USB_KEYMAP_DECLARATION constexpr KeycodeMapEntry usb_keycode_map[] =
 #include "common/keycode_converter_data.inc"
 #undef USB_KEYMAP
 #undef USB_KEYMAP_DECLARATION
 
-const size_t kKeycodeMapEntries = std::size(usb_keycode_map);
+constexpr size_t kKeycodeMapEntries = std::size(usb_keycode_map);
+
+// The lookup tables are open addressing hash tables with indexes of the map entries. They are
+// built at compile time for each direction of the conversion.
+constexpr size_t kLookupTableSize = 512;
+constexpr uint16_t kEmptySlot = 0xFFFF;
+
+static_assert((kLookupTableSize & (kLookupTableSize - 1)) == 0);
+static_assert(kLookupTableSize >= kKeycodeMapEntries * 2);
+
+using LookupTable = std::array<uint16_t, kLookupTableSize>;
+
+constexpr size_t hashKeycode(uint32_t keycode)
+{
+    keycode ^= keycode >> 16;
+    keycode *= 0x45d9f3b;
+    keycode ^= keycode >> 16;
+    return keycode & (kLookupTableSize - 1);
+}
+
+template <typename T>
+constexpr LookupTable makeLookupTable(T KeycodeMapEntry::* field)
+{
+    LookupTable table = {};
+
+    for (size_t slot = 0; slot < kLookupTableSize; ++slot)
+        table[slot] = kEmptySlot;
+
+    for (size_t i = 0; i < kKeycodeMapEntries; ++i)
+    {
+        const T keycode = usb_keycode_map[i].*field;
+        size_t slot = hashKeycode(static_cast<uint32_t>(keycode));
+
+        // If the keycode occurs several times, the first entry is used.
+        while (table[slot] != kEmptySlot && usb_keycode_map[table[slot]].*field != keycode)
+            slot = (slot + 1) & (kLookupTableSize - 1);
+
+        if (table[slot] == kEmptySlot)
+            table[slot] = static_cast<uint16_t>(i);
+    }
+
+    return table;
+}
+
+// Returns the entry index or |kKeycodeMapEntries| if the keycode is not in the map.
+template <typename T>
+size_t findEntry(const LookupTable& table, T KeycodeMapEntry::* field, T keycode)
+{
+    for (size_t slot = hashKeycode(static_cast<uint32_t>(keycode));;
+         slot = (slot + 1) & (kLookupTableSize - 1))
+    {
+        const uint16_t index = table[slot];
+
+        if (index == kEmptySlot)
+            return kKeycodeMapEntries;
+
+        if (usb_keycode_map[index].*field == keycode)
+            return index;
+    }
+}
+
+constexpr LookupTable kUsbLookupTable = makeLookupTable(&KeycodeMapEntry::usb_keycode);
+constexpr LookupTable kNativeLookupTable = makeLookupTable(&KeycodeMapEntry::native_keycode);
+constexpr LookupTable kQtLookupTable = makeLookupTable(&KeycodeMapEntry::qt_keycode);
 
 } // namespace
 
@@ -74,37 +139,32 @@ int KeycodeConverter::usbKeycodeToNativeKeycode(uint32_t usb_keycode)
         usb_keycode = 0x070068; // F13.
 #endif
 
-    for (size_t i = 0; i < kKeycodeMapEntries; ++i)
-    {
-        if (usb_keycode_map[i].usb_keycode == usb_keycode)
-            return usb_keycode_map[i].native_keycode;
-    }
+    const size_t index = findEntry(kUsbLookupTable, &KeycodeMapEntry::usb_keycode, usb_keycode);
+    if (index == kKeycodeMapEntries)
+        return invalidNativeKeycode();
 
-    return invalidNativeKeycode();
+    return usb_keycode_map[index].native_keycode;
 }
 
 // static
 uint32_t KeycodeConverter::nativeKeycodeToUsbKeycode(int native_keycode)
 {
-    for (size_t i = 0; i < kKeycodeMapEntries; ++i)
-    {
-        if (usb_keycode_map[i].native_keycode == native_keycode)
-            return usb_keycode_map[i].usb_keycode;
-    }
+    const size_t index =
+        findEntry(kNativeLookupTable, &KeycodeMapEntry::native_keycode, native_keycode);
+    if (index == kKeycodeMapEntries)
+        return invalidUsbKeycode();
 
-    return invalidUsbKeycode();
+    return usb_keycode_map[index].usb_keycode;
 }
 
 // static
 uint32_t KeycodeConverter::qtKeycodeToUsbKeycode(int qt_keycode)
 {
-    for (size_t i = 0; i < kKeycodeMapEntries; ++i)
-    {
-        if (usb_keycode_map[i].qt_keycode == qt_keycode)
-            return usb_keycode_map[i].usb_keycode;
-    }
+    const size_t index = findEntry(kQtLookupTable, &KeycodeMapEntry::qt_keycode, qt_keycode);
+    if (index == kKeycodeMapEntries)
+        return invalidUsbKeycode();
 
-    return invalidUsbKeycode();
+    return usb_keycode_map[index].usb_keycode;
 }
 
 } // namespace common
@@ -22,7 +22,9 @@
 #include "base/crypto/data_cryptor_chacha20_poly1305.h"
 #include "base/crypto/data_cryptor_fake.h"
 #include "base/crypto/password_hash.h"
+#include "base/crypto/secure_buffer.h"
 #include "base/crypto/secure_memory.h"
+#include "base/net/address.h"
 #include "base/strings/unicode.h"
 #include "console/address_book_dialog.h"
 #include "console/computer_dialog.h"
@@ -30,15 +32,21 @@
 #include "console/computer_item.h"
 #include "console/open_address_book_dialog.h"
 #include "console/settings.h"
+#include "qt_base/application.h"
 
 #include <QFileDialog>
 #include <QMenu>
 #include <QMessageBox>
+#include <QScrollBar>
+#include <QTimer>
 
 namespace console {
 
 namespace {
 
+const std::chrono::milliseconds kStatusCheckDelay{ 300 };
+const std::chrono::seconds kStatusCacheTime{ 60 };
+
 void cleanupComputer(proto::address_book::Computer* computer)
 {
     if (!computer)
@@ -115,20 +123,20 @@ AddressBookTab::AddressBookTab(const QString& file_path,
 
     updateComputerList(group_item);
 
-    group_item->setExpanded(group_item->IsExpanded());
-
+    // Only the items of the expanded groups are created.
     std::function<void(ComputerGroupItem*)> restore_child = [&](ComputerGroupItem* item)
     {
+        if (!item->IsExpanded())
+            return;
+
+        item->populateChildGroups();
+        item->setExpanded(true);
+
         for (int i = 0; i < item->childCount(); ++i)
         {
             ComputerGroupItem* child_item = dynamic_cast<ComputerGroupItem*>(item->child(i));
             if (child_item)
-            {
-                if (child_item->IsExpanded())
-                    child_item->setExpanded(true);
-
                 restore_child(child_item);
-            }
         }
     };
 
@@ -167,6 +175,20 @@ AddressBookTab::AddressBookTab(const QString& file_path,
 
     connect(ui.tree_computer, &ComputerTree::itemDoubleClicked,
             this, &AddressBookTab::onComputerItemDoubleClicked);
+
+    connect(ui.edit_search, &QLineEdit::textChanged,
+            this, &AddressBookTab::onSearchTextChanged);
+
+    status_checker_ = std::make_unique<client::HostStatusChecker>(
+        qt_base::Application::ioTaskRunner(), qt_base::Application::uiTaskRunner());
+
+    status_timer_ = new QTimer(this);
+    status_timer_->setSingleShot(true);
+    status_timer_->setInterval(kStatusCheckDelay);
+
+    connect(status_timer_, &QTimer::timeout, this, &AddressBookTab::checkComputerStatus);
+    connect(ui.tree_computer->verticalScrollBar(), &QScrollBar::valueChanged,
+            status_timer_, QOverload<>::of(&QTimer::start));
 }
 
 AddressBookTab::~AddressBookTab()
@@ -266,20 +288,26 @@ AddressBookTab* AddressBookTab::openFromFile(const QString& file_path, QWidget*
         return nullptr;
     }
 
-    std::string decrypted_data;
+    // The data is decrypted into locked memory and parsed from there without intermediate copies.
+    // It is wiped on any return.
+    base::SecureBuffer decrypted_data;
     if (!cryptor->decrypt(address_book_file.data(), &decrypted_data))
     {
         showOpenError(parent, tr("Unable to decrypt the address book with the specified password."));
         return nullptr;
     }
 
-    if (!address_book_data.ParseFromString(decrypted_data))
+    // The encrypted copy is no longer needed.
+    address_book_file.clear_data();
+
+    if (!address_book_data.ParseFromArray(decrypted_data.data(),
+                                          static_cast<int>(decrypted_data.size())))
     {
         showOpenError(parent, tr("The address book file is corrupted or has an unknown format."));
         return nullptr;
     }
 
-    base::memZero(&decrypted_data);
+    decrypted_data.clear();
 
     return new AddressBookTab(file_path,
                               std::move(address_book_file),
@@ -549,6 +577,13 @@ void AddressBookTab::onGroupItemClicked(QTreeWidgetItem* item, int /* column */)
     if (!current_item)
         return;
 
+    if (!ui.edit_search->text().isEmpty())
+    {
+        // Selecting a group ends the search.
+        QSignalBlocker blocker(ui.edit_search);
+        ui.edit_search->clear();
+    }
+
     bool is_root = !current_item->parent();
     emit computerGroupActivated(true, is_root);
     updateComputerList(current_item);
@@ -584,6 +619,7 @@ void AddressBookTab::onGroupItemExpanded(QTreeWidgetItem* item)
     if (!current_item)
         return;
 
+    current_item->populateChildGroups();
     current_item->SetExpanded(true);
     setChanged(true);
 }
@@ -595,8 +631,12 @@ void AddressBookTab::onGroupItemDropped()
     if (!current_item)
         return;
 
-    updateComputerList(current_item);
     setChanged(true);
+
+    if (ui.edit_search->text().isEmpty())
+        updateComputerList(current_item);
+    else
+        onSearchTextChanged(ui.edit_search->text());
 }
 
 void AddressBookTab::onComputerItemClicked(QTreeWidgetItem* item, int /* column */)
@@ -629,6 +669,86 @@ void AddressBookTab::onComputerItemDoubleClicked(QTreeWidgetItem* item, int /* c
     emit computerDoubleClicked(current_item->computer());
 }
 
+void AddressBookTab::onSearchTextChanged(const QString& text)
+{
+    if (text.isEmpty())
+    {
+        ComputerGroupItem* current_group =
+            dynamic_cast<ComputerGroupItem*>(ui.tree_group->currentItem());
+        if (current_group)
+            updateComputerList(current_group);
+        return;
+    }
+
+    if (computer_index_.isEmpty())
+        computer_index_.build(data_.mutable_root_group());
+
+    QList<QTreeWidgetItem*> items;
+
+    for (const ComputerIndex::Entry* entry : computer_index_.find(text))
+    {
+        ComputerGroupItem* group_item = computerGroupItem(entry->groups);
+        if (group_item)
+            items.push_back(new ComputerItem(entry->computer, group_item));
+    }
+
+    ui.tree_computer->clear();
+
+    const bool sorting_enabled = ui.tree_computer->isSortingEnabled();
+    ui.tree_computer->setSortingEnabled(false);
+    ui.tree_computer->addTopLevelItems(items);
+    ui.tree_computer->setSortingEnabled(sorting_enabled);
+
+    status_timer_->start();
+
+    emit computerActivated(false);
+}
+
+void AddressBookTab::checkComputerStatus()
+{
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<client::HostStatusChecker::Target> targets;
+
+    for (ComputerItem* item : visibleComputerItems())
+    {
+        const proto::address_book::Computer& computer = *item->computer();
+        std::u16string key = ComputerItem::statusKey(computer);
+
+        auto cached = status_cache_.find(key);
+        if (cached != status_cache_.end() && now - cached->second.time < kStatusCacheTime)
+        {
+            item->setStatus(cached->second.status);
+            continue;
+        }
+
+        client::HostStatusChecker::Target target;
+        target.key = std::move(key);
+
+        if (base::isHostId(computer.address()))
+        {
+            target.host_id = base::stringToHostId(computer.address());
+        }
+        else
+        {
+            base::Address address = base::Address::fromString(
+                base::utf16FromUtf8(computer.address()), DEFAULT_HOST_TCP_PORT);
+            if (computer.port())
+                address.setPort(static_cast<uint16_t>(computer.port()));
+
+            target.address = address.host();
+            target.port = address.port();
+        }
+
+        targets.emplace_back(std::move(target));
+    }
+
+    // The previous check is cancelled, its results for the computers that are still visible are
+    // requested again.
+    status_checker_->check(routerConfig(), std::move(targets),
+                           std::bind(&AddressBookTab::onComputerStatus, this,
+                                     std::placeholders::_1));
+}
+
 void AddressBookTab::showEvent(QShowEvent* event)
 {
     ComputerGroupItem* current_group =
@@ -722,6 +842,10 @@ void AddressBookTab::keyPressEvent(QKeyEvent* event)
 void AddressBookTab::setChanged(bool value)
 {
     is_changed_ = value;
+
+    if (value)
+        computer_index_.clear();
+
     emit addressBookChanged(value);
 }
 
@@ -784,15 +908,27 @@ void AddressBookTab::restoreState(const QByteArray& state)
 
 void AddressBookTab::updateComputerList(ComputerGroupItem* computer_group)
 {
-    for (int i = ui.tree_computer->topLevelItemCount() - 1; i >= 0; --i)
-        std::unique_ptr<QTreeWidgetItem> item_deleter(ui.tree_computer->takeTopLevelItem(i));
+    ui.tree_computer->clear();
 
+    // With sorting enabled, each item is inserted into its sorted position separately. Sorting
+    // the whole list once is much faster for large groups.
+    const bool sorting_enabled = ui.tree_computer->isSortingEnabled();
+    ui.tree_computer->setSortingEnabled(false);
     ui.tree_computer->addTopLevelItems(computer_group->ComputerList());
+    ui.tree_computer->setSortingEnabled(sorting_enabled);
+
+    status_timer_->start();
 }
 
 bool AddressBookTab::saveToFile(const QString& file_path)
 {
-    std::string serialized_data = data_.SerializeAsString();
+    base::SecureBuffer serialized_data(data_.ByteSizeLong());
+    if (!serialized_data.empty())
+    {
+        CHECK(data_.SerializeToArray(serialized_data.data(),
+                                     static_cast<int>(serialized_data.size())));
+    }
+
     std::unique_ptr<base::DataCryptor> cryptor;
 
     switch (file_.encryption_type())
@@ -811,8 +947,8 @@ bool AddressBookTab::saveToFile(const QString& file_path)
     }
 
     std::string encrypted_data;
-    CHECK(cryptor->encrypt(serialized_data, &encrypted_data));
-    base::memZero(&serialized_data);
+    CHECK(cryptor->encrypt(serialized_data.view(), &encrypted_data));
+    serialized_data.clear();
 
     file_.set_data(std::move(encrypted_data));
 
@@ -871,6 +1007,70 @@ ComputerGroupItem* AddressBookTab::rootComputerGroup()
     return root_item;
 }
 
+ComputerGroupItem* AddressBookTab::computerGroupItem(
+    const std::vector<proto::address_book::ComputerGroup*>& groups)
+{
+    ComputerGroupItem* item = rootComputerGroup();
+    if (!item || groups.empty() || item->computerGroup() != groups.front())
+        return nullptr;
+
+    // The items of the groups on the path are created if they are not expanded yet.
+    for (size_t i = 1; i < groups.size() && item; ++i)
+    {
+        item->populateChildGroups();
+
+        ComputerGroupItem* parent_item = item;
+        item = nullptr;
+
+        for (int j = 0; j < parent_item->childCount(); ++j)
+        {
+            ComputerGroupItem* child_item =
+                dynamic_cast<ComputerGroupItem*>(parent_item->child(j));
+            if (child_item && child_item->computerGroup() == groups[i])
+            {
+                item = child_item;
+                break;
+            }
+        }
+    }
+
+    return item;
+}
+
+QList<ComputerItem*> AddressBookTab::visibleComputerItems() const
+{
+    QList<ComputerItem*> items;
+
+    const int viewport_height = ui.tree_computer->viewport()->height();
+    QTreeWidgetItem* item = ui.tree_computer->itemAt(0, 0);
+
+    while (item && ui.tree_computer->visualItemRect(item).top() < viewport_height)
+    {
+        ComputerItem* computer_item = dynamic_cast<ComputerItem*>(item);
+        if (computer_item)
+            items.push_back(computer_item);
+
+        item = ui.tree_computer->itemBelow(item);
+    }
+
+    return items;
+}
+
+void AddressBookTab::onComputerStatus(const client::HostStatusChecker::ResultList& results)
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    for (const auto& result : results)
+        status_cache_[result.key] = ComputerStatus{ result.status, now };
+
+    for (ComputerItem* item : visibleComputerItems())
+    {
+        auto cached = status_cache_.find(ComputerItem::statusKey(*item->computer()));
+        if (cached != status_cache_.end())
+            item->setStatus(cached->second.status);
+    }
+}
+
 // static
 QString AddressBookTab::parentName(ComputerGroupItem* item)
 {
@@ -20,12 +20,18 @@
 #define CONSOLE__ADDRESS_BOOK_TAB_H
 
 #include "base/macros_magic.h"
+#include "client/host_status_checker.h"
 #include "client/router_config.h"
+#include "console/computer_index.h"
 #include "proto/address_book.pb.h"
 #include "ui_address_book_tab.h"
 
+#include <chrono>
+#include <map>
 #include <optional>
 
+class QTimer;
+
 namespace console {
 
 class ComputerItem;
@@ -90,6 +96,8 @@ private slots:
     void onComputerItemClicked(QTreeWidgetItem* item, int column);
     void onComputerContextMenu(const QPoint& point);
     void onComputerItemDoubleClicked(QTreeWidgetItem* item, int column);
+    void onSearchTextChanged(const QString& text);
+    void checkComputerStatus();
 
 private:
     AddressBookTab(const QString& file_path,
@@ -103,6 +111,10 @@ private:
     void updateComputerList(ComputerGroupItem* computer_group);
     bool saveToFile(const QString& file_path);
     ComputerGroupItem* rootComputerGroup();
+    ComputerGroupItem* computerGroupItem(
+        const std::vector<proto::address_book::ComputerGroup*>& groups);
+    QList<ComputerItem*> visibleComputerItems() const;
+    void onComputerStatus(const client::HostStatusChecker::ResultList& results);
 
     static QString parentName(ComputerGroupItem* item);
     static void showOpenError(QWidget* parent, const QString& message);
@@ -118,6 +130,21 @@ private:
 
     bool is_changed_ = false;
 
+    // Built on the first search after the data is changed.
+    ComputerIndex computer_index_;
+
+    struct ComputerStatus
+    {
+        client::HostStatusChecker::Status status;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    // The status of the visible computers is checked shortly after the list is changed or
+    // scrolled. The results are cached by ComputerItem::statusKey.
+    QTimer* status_timer_;
+    std::unique_ptr<client::HostStatusChecker> status_checker_;
+    std::map<std::u16string, ComputerStatus> status_cache_;
+
     DISALLOW_COPY_AND_ASSIGN(AddressBookTab);
 };
 
@@ -20,6 +20,7 @@
 
 #include "base/logging.h"
 #include "base/desktop/pixel_format.h"
+#include "common/desktop_session_constants.h"
 
 namespace console {
 
@@ -77,9 +78,14 @@ void ComputerDialogDesktop::restoreSettings(
     proto::SessionType session_type, const proto::DesktopConfig& config)
 {
     QComboBox* combo_codec = ui.combo_codec;
+
+    if (common::kSupportedVideoEncodings & proto::VIDEO_ENCODING_H264)
+        combo_codec->addItem(QStringLiteral("H.264"), proto::VIDEO_ENCODING_H264);
+
     combo_codec->addItem(QStringLiteral("VP9"), proto::VIDEO_ENCODING_VP9);
     combo_codec->addItem(QStringLiteral("VP8"), proto::VIDEO_ENCODING_VP8);
     combo_codec->addItem(QStringLiteral("ZSTD"), proto::VIDEO_ENCODING_ZSTD);
+    combo_codec->addItem(QStringLiteral("VP9 + ZSTD"), proto::VIDEO_ENCODING_HYBRID);
 
     QComboBox* combo_color_depth = ui.combobox_color_depth;
     combo_color_depth->addItem(tr("True color (32 bit)"), COLOR_DEPTH_ARGB);
@@ -166,7 +172,8 @@ void ComputerDialogDesktop::saveSettings(proto::DesktopConfig* config)
 
     config->set_video_encoding(video_encoding);
 
-    if (video_encoding == proto::VIDEO_ENCODING_ZSTD)
+    if (video_encoding == proto::VIDEO_ENCODING_ZSTD ||
+        video_encoding == proto::VIDEO_ENCODING_HYBRID)
     {
         base::PixelFormat pixel_format;
 
@@ -241,8 +248,9 @@ void ComputerDialogDesktop::saveSettings(proto::DesktopConfig* config)
 
 void ComputerDialogDesktop::onCodecChanged(int item_index)
 {
-    bool has_pixel_format =
-        (ui.combo_codec->itemData(item_index).toInt() == proto::VIDEO_ENCODING_ZSTD);
+    const int video_encoding = ui.combo_codec->itemData(item_index).toInt();
+    bool has_pixel_format = (video_encoding == proto::VIDEO_ENCODING_ZSTD ||
+                             video_encoding == proto::VIDEO_ENCODING_HYBRID);
 
     ui.label_color_depth->setEnabled(has_pixel_format);
     ui.combobox_color_depth->setEnabled(has_pixel_format);
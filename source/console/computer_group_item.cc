@@ -27,9 +27,24 @@ ComputerGroupItem::ComputerGroupItem(proto::address_book::ComputerGroup* compute
     : QTreeWidgetItem(parent_item),
       computer_group_(computer_group)
 {
-    setIcon(0, QIcon(QStringLiteral(":/img/folder.png")));
+    static const QIcon kIcon(QStringLiteral(":/img/folder.png"));
+
+    setIcon(0, kIcon);
     updateItem();
 
+    // The child groups are created when the group is expanded for the first time.
+    if (computer_group_->computer_group_size() > 0)
+        setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+}
+
+void ComputerGroupItem::populateChildGroups()
+{
+    if (children_populated_)
+        return;
+
+    children_populated_ = true;
+    setChildIndicatorPolicy(QTreeWidgetItem::DontShowIndicatorWhenChildless);
+
     for (int i = 0; i < computer_group_->computer_group_size(); ++i)
     {
         addChild(new ComputerGroupItem(computer_group_->mutable_computer_group(i), this));
@@ -39,6 +54,8 @@ ComputerGroupItem::ComputerGroupItem(proto::address_book::ComputerGroup* compute
 ComputerGroupItem* ComputerGroupItem::addChildComputerGroup(
     proto::address_book::ComputerGroup* computer_group)
 {
+    populateChildGroups();
+
     computer_group_->mutable_computer_group()->AddAllocated(computer_group);
 
     ComputerGroupItem* item = new ComputerGroupItem(computer_group, this);
@@ -0,0 +1,141 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "console/computer_index.h"
+
+namespace console {
+
+namespace {
+
+const size_t kTrigramSize = 3;
+
+uint32_t trigram(const std::string& text, size_t pos)
+{
+    return (static_cast<uint32_t>(static_cast<uint8_t>(text[pos])) << 16) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(text[pos + 1])) << 8) |
+           static_cast<uint32_t>(static_cast<uint8_t>(text[pos + 2]));
+}
+
+} // namespace
+
+void ComputerIndex::build(proto::address_book::ComputerGroup* root_group)
+{
+    clear();
+
+    std::vector<proto::address_book::ComputerGroup*> groups;
+    addGroup(root_group, &groups);
+}
+
+void ComputerIndex::clear()
+{
+    entries_.clear();
+    texts_.clear();
+    trigrams_.clear();
+}
+
+std::vector<const ComputerIndex::Entry*> ComputerIndex::find(const QString& text) const
+{
+    std::vector<const Entry*> result;
+
+    const std::string query = normalize(text);
+    if (query.empty())
+        return result;
+
+    if (query.size() < kTrigramSize)
+    {
+        // Too short for the index.
+        for (size_t i = 0; i < texts_.size(); ++i)
+        {
+            if (texts_[i].find(query) != std::string::npos)
+                result.push_back(&entries_[i]);
+        }
+
+        return result;
+    }
+
+    // Each match contains all trigrams of the query, so the shortest list of them is checked.
+    const std::vector<uint32_t>* candidates = nullptr;
+
+    for (size_t pos = 0; pos + kTrigramSize <= query.size(); ++pos)
+    {
+        auto it = trigrams_.find(trigram(query, pos));
+        if (it == trigrams_.end())
+            return result;
+
+        if (!candidates || it->second.size() < candidates->size())
+            candidates = &it->second;
+    }
+
+    for (uint32_t index : *candidates)
+    {
+        if (texts_[index].find(query) != std::string::npos)
+            result.push_back(&entries_[index]);
+    }
+
+    return result;
+}
+
+void ComputerIndex::addGroup(proto::address_book::ComputerGroup* group,
+                             std::vector<proto::address_book::ComputerGroup*>* groups)
+{
+    groups->push_back(group);
+
+    for (int i = 0; i < group->computer_size(); ++i)
+        addComputer(group->mutable_computer(i), *groups);
+
+    for (int i = 0; i < group->computer_group_size(); ++i)
+        addGroup(group->mutable_computer_group(i), groups);
+
+    groups->pop_back();
+}
+
+void ComputerIndex::addComputer(proto::address_book::Computer* computer,
+                                const std::vector<proto::address_book::ComputerGroup*>& groups)
+{
+    const uint32_t index = static_cast<uint32_t>(entries_.size());
+
+    entries_.push_back(Entry{ computer, groups });
+
+    // The fields are separated by a line break, which the search text does not contain.
+    std::string text = normalize(QString::fromStdString(computer->name()));
+    text += '\n';
+    text += normalize(QString::fromStdString(computer->address()));
+    text += '\n';
+    text += normalize(QString::fromStdString(computer->username()));
+    text += '\n';
+    text += normalize(QString::fromStdString(computer->comment()));
+
+    for (size_t pos = 0; pos + kTrigramSize <= text.size(); ++pos)
+    {
+        std::vector<uint32_t>& list = trigrams_[trigram(text, pos)];
+
+        // A trigram may occur in the text several times.
+        if (list.empty() || list.back() != index)
+            list.push_back(index);
+    }
+
+    texts_.emplace_back(std::move(text));
+}
+
+// static
+std::string ComputerIndex::normalize(const QString& text)
+{
+    return text.toCaseFolded().simplified().toStdString();
+}
+
+} // namespace console
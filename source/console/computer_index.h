@@ -0,0 +1,76 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CONSOLE__COMPUTER_INDEX_H
+#define CONSOLE__COMPUTER_INDEX_H
+
+#include "base/macros_magic.h"
+#include "proto/address_book.pb.h"
+
+#include <QString>
+
+#include <unordered_map>
+#include <vector>
+
+namespace console {
+
+// Trigram index of the computers of an address book. Searches by a substring of the name, address,
+// user name or comment, case insensitive. The index keeps pointers to the data of the address
+// book, so it must be rebuilt after any change of the data.
+class ComputerIndex
+{
+public:
+    ComputerIndex() = default;
+    ~ComputerIndex() = default;
+
+    struct Entry
+    {
+        proto::address_book::Computer* computer;
+
+        // Groups from the root group to the parent group of the computer.
+        std::vector<proto::address_book::ComputerGroup*> groups;
+    };
+
+    void build(proto::address_book::ComputerGroup* root_group);
+    void clear();
+    bool isEmpty() const { return entries_.empty(); }
+
+    std::vector<const Entry*> find(const QString& text) const;
+
+private:
+    void addGroup(proto::address_book::ComputerGroup* group,
+                  std::vector<proto::address_book::ComputerGroup*>* groups);
+    void addComputer(proto::address_book::Computer* computer,
+                     const std::vector<proto::address_book::ComputerGroup*>& groups);
+
+    static std::string normalize(const QString& text);
+
+    std::vector<Entry> entries_;
+
+    // Normalized searchable text of each entry.
+    std::vector<std::string> texts_;
+
+    // Sorted indexes of the entries containing each trigram.
+    std::unordered_map<uint32_t, std::vector<uint32_t>> trigrams_;
+
+    DISALLOW_COPY_AND_ASSIGN(ComputerIndex);
+};
+
+} // namespace console
+
+#endif // CONSOLE__COMPUTER_INDEX_H
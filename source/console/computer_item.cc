@@ -19,19 +19,41 @@
 #include "console/computer_item.h"
 
 #include "base/net/address.h"
+#include "base/strings/string_number_conversions.h"
 #include "base/strings/unicode.h"
 #include "console/computer_group_item.h"
 
 #include <QDateTime>
+#include <QPainter>
 
 namespace console {
 
+namespace {
+
+QIcon statusIcon(const QColor& color)
+{
+    QPixmap pixmap(QStringLiteral(":/img/computer.png"));
+
+    const int size = pixmap.width() / 2;
+
+    QPainter painter(&pixmap);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(QPen(Qt::white, 1));
+    painter.setBrush(color);
+    painter.drawEllipse(pixmap.width() - size, pixmap.height() - size, size - 1, size - 1);
+
+    return QIcon(pixmap);
+}
+
+} // namespace
+
 ComputerItem::ComputerItem(proto::address_book::Computer* computer,
                            ComputerGroupItem* parent_group_item)
     : computer_(computer),
       parent_group_item_(parent_group_item)
 {
-    setIcon(0, QIcon(QStringLiteral(":/img/computer.png")));
+    static const QIcon kIcon(QStringLiteral(":/img/computer.png"));
+    setIcon(0, kIcon);
     updateItem();
 }
 
@@ -78,6 +100,35 @@ ComputerGroupItem* ComputerItem::parentComputerGroupItem()
     return parent_group_item_;
 }
 
+void ComputerItem::setStatus(client::HostStatusChecker::Status status)
+{
+    static const QIcon kOnlineIcon = statusIcon(QColor(0x2e, 0xb8, 0x4a));
+    static const QIcon kOfflineIcon = statusIcon(QColor(0xa0, 0xa0, 0xa0));
+    static const QIcon kUnknownIcon(QStringLiteral(":/img/computer.png"));
+
+    switch (status)
+    {
+        case client::HostStatusChecker::Status::ONLINE:
+            setIcon(COLUMN_INDEX_NAME, kOnlineIcon);
+            break;
+
+        case client::HostStatusChecker::Status::OFFLINE:
+            setIcon(COLUMN_INDEX_NAME, kOfflineIcon);
+            break;
+
+        default:
+            setIcon(COLUMN_INDEX_NAME, kUnknownIcon);
+            break;
+    }
+}
+
+// static
+std::u16string ComputerItem::statusKey(const proto::address_book::Computer& computer)
+{
+    return base::utf16FromUtf8(computer.address()) + u':' +
+           base::numberToString16(computer.port());
+}
+
 bool ComputerItem::operator<(const QTreeWidgetItem &other) const
 {
     switch (treeWidget()->sortColumn())
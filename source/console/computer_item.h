@@ -20,6 +20,7 @@
 #define CONSOLE__COMPUTER_ITEM_H
 
 #include "base/macros_magic.h"
+#include "client/host_status_checker.h"
 #include "proto/address_book.pb.h"
 
 #include <QTreeWidget>
@@ -48,6 +49,12 @@ public:
     proto::address_book::Computer* computer() { return computer_; }
     ComputerGroupItem* parentComputerGroupItem();
 
+    // Shows the status on the icon of the item.
+    void setStatus(client::HostStatusChecker::Status status);
+
+    // Identifies the computer in the status checks.
+    static std::u16string statusKey(const proto::address_book::Computer& computer);
+
     // QTreeWidgetItem implementation.
     bool operator<(const QTreeWidgetItem &other) const override;
 
@@ -0,0 +1,228 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "console/file_distribution_dialog.h"
+
+#include "base/logging.h"
+#include "base/net/network_channel.h"
+#include "base/peer/client_authenticator.h"
+#include "client/file_distribution_window_proxy.h"
+#include "client/file_distributor_proxy.h"
+#include "client/ui/file_error_code.h"
+#include "qt_base/application.h"
+
+#include <QCloseEvent>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QMessageBox>
+#include <QPushButton>
+
+namespace console {
+
+namespace {
+
+enum Column
+{
+    COLUMN_NAME    = 0,
+    COLUMN_ADDRESS = 1,
+    COLUMN_STATUS  = 2
+};
+
+} // namespace
+
+FileDistributionDialog::FileDistributionDialog(
+    const std::vector<client::Config>& hosts, QWidget* parent)
+    : QDialog(parent),
+      hosts_(hosts)
+{
+    ui.setupUi(this);
+
+    for (const auto& host : hosts_)
+    {
+        QTreeWidgetItem* item = new QTreeWidgetItem(ui.tree_hosts);
+        item->setText(COLUMN_NAME, QString::fromStdU16String(host.computer_name));
+        item->setText(COLUMN_ADDRESS, QString::fromStdU16String(host.address_or_id));
+        item->setText(COLUMN_STATUS, tr("Waiting"));
+    }
+
+    ui.label_hosts->setText(tr("Computers: %1").arg(hosts_.size()));
+
+    start_button_ = ui.button_box->addButton(tr("Start"), QDialogButtonBox::ActionRole);
+
+    connect(start_button_, &QPushButton::clicked, this, &FileDistributionDialog::onStart);
+    connect(ui.button_browse, &QPushButton::clicked, this, &FileDistributionDialog::onBrowse);
+    connect(ui.button_box, &QDialogButtonBox::rejected, this, &FileDistributionDialog::close);
+}
+
+FileDistributionDialog::~FileDistributionDialog()
+{
+    distributor_proxy_.reset();
+
+    if (distribution_window_proxy_)
+        distribution_window_proxy_->dettach();
+}
+
+void FileDistributionDialog::onHostStarted(size_t host_index, int attempt)
+{
+    if (attempt > 1)
+        setHostStatus(host_index, tr("Connecting (attempt %1)").arg(attempt));
+    else
+        setHostStatus(host_index, tr("Connecting"));
+}
+
+void FileDistributionDialog::onHostProgress(size_t host_index, int percentage)
+{
+    setHostStatus(host_index, tr("Sending (%1%)").arg(percentage));
+}
+
+void FileDistributionDialog::onHostFinished(
+    size_t host_index, const client::FileDistributor::HostError& error)
+{
+    if (error.type == client::FileDistributor::HostError::Type::NONE)
+        setHostStatus(host_index, tr("Done"));
+    else
+        setHostStatus(host_index, errorToString(error));
+}
+
+void FileDistributionDialog::onTotalProgress(int percentage)
+{
+    ui.progress_total->setValue(percentage);
+}
+
+void FileDistributionDialog::onFinished(proto::FileError error_code)
+{
+    LOG(LS_INFO) << "File distribution finished: " << error_code;
+
+    if (error_code != proto::FILE_ERROR_SUCCESS)
+    {
+        QMessageBox::warning(this,
+                             tr("Warning"),
+                             tr("Unable to read the file: %1")
+                                 .arg(client::fileErrorToString(error_code)),
+                             QMessageBox::Ok);
+    }
+    else
+    {
+        ui.progress_total->setValue(ui.progress_total->maximum());
+    }
+}
+
+void FileDistributionDialog::closeEvent(QCloseEvent* event)
+{
+    if (distributor_proxy_)
+    {
+        // The hosts that have not received the file yet are stopped.
+        distributor_proxy_.reset();
+    }
+
+    QDialog::closeEvent(event);
+}
+
+void FileDistributionDialog::onBrowse()
+{
+    QString file_path =
+        QFileDialog::getOpenFileName(this, tr("Select File"), ui.edit_source->text());
+    if (!file_path.isEmpty())
+        ui.edit_source->setText(file_path);
+}
+
+void FileDistributionDialog::onStart()
+{
+    if (distributor_proxy_)
+        return;
+
+    QString source_path = ui.edit_source->text();
+    QString target_dir = ui.edit_target->text();
+
+    if (!QFileInfo(source_path).isFile())
+    {
+        QMessageBox::warning(this, tr("Warning"), tr("Select the file to send."), QMessageBox::Ok);
+        return;
+    }
+
+    if (target_dir.isEmpty())
+    {
+        QMessageBox::warning(this,
+                             tr("Warning"),
+                             tr("Enter the directory on the computers."),
+                             QMessageBox::Ok);
+        return;
+    }
+
+    // Remove the trailing separators, the file name is appended to the directory.
+    while (target_dir.length() > 1 && (target_dir.endsWith('/') || target_dir.endsWith('\\')))
+        target_dir.chop(1);
+
+    ui.group_settings->setEnabled(false);
+    start_button_->setEnabled(false);
+
+    for (size_t i = 0; i < hosts_.size(); ++i)
+        setHostStatus(i, tr("Waiting"));
+
+    client::FileDistributor::Options options;
+    options.target_dir = target_dir.toStdString();
+    options.max_parallel = static_cast<size_t>(ui.spinbox_parallel->value());
+    options.overwrite = ui.checkbox_overwrite->isChecked();
+
+    distribution_window_proxy_ = std::make_shared<client::FileDistributionWindowProxy>(
+        qt_base::Application::uiTaskRunner(), this);
+
+    distributor_proxy_ = std::make_unique<client::FileDistributorProxy>(
+        qt_base::Application::ioTaskRunner(),
+        std::make_unique<client::FileDistributor>(
+            qt_base::Application::ioTaskRunner(), distribution_window_proxy_));
+
+    distributor_proxy_->start(source_path.toStdString(), hosts_, options);
+}
+
+void FileDistributionDialog::setHostStatus(size_t host_index, const QString& status)
+{
+    QTreeWidgetItem* item = ui.tree_hosts->topLevelItem(static_cast<int>(host_index));
+    if (item)
+        item->setText(COLUMN_STATUS, status);
+}
+
+// static
+QString FileDistributionDialog::errorToString(const client::FileDistributor::HostError& error)
+{
+    using Type = client::FileDistributor::HostError::Type;
+
+    switch (error.type)
+    {
+        case Type::NETWORK:
+            return tr("Network error: %1").arg(QString::fromStdString(
+                base::NetworkChannel::errorToString(
+                    static_cast<base::NetworkChannel::ErrorCode>(error.code))));
+
+        case Type::ACCESS_DENIED:
+            return tr("Authentication error: %1").arg(
+                base::ClientAuthenticator::errorToString(
+                    static_cast<base::ClientAuthenticator::ErrorCode>(error.code)));
+
+        case Type::ROUTER:
+            return tr("Router error");
+
+        case Type::FILE:
+            return client::fileErrorToString(static_cast<proto::FileError>(error.code));
+
+        default:
+            return tr("Unknown error");
+    }
+}
+
+} // namespace console
@@ -0,0 +1,80 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CONSOLE__FILE_DISTRIBUTION_DIALOG_H
+#define CONSOLE__FILE_DISTRIBUTION_DIALOG_H
+
+#include "base/macros_magic.h"
+#include "client/client_config.h"
+#include "client/file_distribution_window.h"
+#include "ui_file_distribution_dialog.h"
+
+#include <memory>
+#include <vector>
+
+namespace client {
+class FileDistributionWindowProxy;
+class FileDistributorProxy;
+} // namespace client
+
+namespace console {
+
+// Sends one file to all the computers of a group.
+class FileDistributionDialog
+    : public QDialog,
+      public client::FileDistributionWindow
+{
+    Q_OBJECT
+
+public:
+    FileDistributionDialog(const std::vector<client::Config>& hosts, QWidget* parent = nullptr);
+    ~FileDistributionDialog();
+
+    // client::FileDistributionWindow implementation.
+    void onHostStarted(size_t host_index, int attempt) override;
+    void onHostProgress(size_t host_index, int percentage) override;
+    void onHostFinished(size_t host_index,
+                        const client::FileDistributor::HostError& error) override;
+    void onTotalProgress(int percentage) override;
+    void onFinished(proto::FileError error_code) override;
+
+protected:
+    // QDialog implementation.
+    void closeEvent(QCloseEvent* event) override;
+
+private slots:
+    void onBrowse();
+    void onStart();
+
+private:
+    void setHostStatus(size_t host_index, const QString& status);
+    static QString errorToString(const client::FileDistributor::HostError& error);
+
+    Ui::FileDistributionDialog ui;
+    QPushButton* start_button_ = nullptr;
+
+    std::vector<client::Config> hosts_;
+    std::shared_ptr<client::FileDistributionWindowProxy> distribution_window_proxy_;
+    std::unique_ptr<client::FileDistributorProxy> distributor_proxy_;
+
+    DISALLOW_COPY_AND_ASSIGN(FileDistributionDialog);
+};
+
+} // namespace console
+
+#endif // CONSOLE__FILE_DISTRIBUTION_DIALOG_H
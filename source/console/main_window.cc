@@ -18,6 +18,7 @@
 
 #include "console/main_window.h"
 
+#include "base/peer/host_id.h"
 #include "base/strings/unicode.h"
 #include "build/build_config.h"
 #include "build/version.h"
@@ -30,6 +31,7 @@
 #include "console/address_book_tab.h"
 #include "console/application.h"
 #include "console/fast_connect_dialog.h"
+#include "console/file_distribution_dialog.h"
 #include "console/mru_action.h"
 #include "console/update_settings_dialog.h"
 #include "common/ui/update_dialog.h"
@@ -114,6 +116,7 @@ MainWindow::MainWindow(const QString& file_path)
     connect(ui.action_exit, &QAction::triggered, this, &MainWindow::close);
     connect(ui.action_fast_connect, &QAction::triggered, this, &MainWindow::onFastConnect);
     connect(ui.action_router_manage, &QAction::triggered, this, &MainWindow::connectToRouter);
+    connect(ui.action_distribute_file, &QAction::triggered, this, &MainWindow::onDistributeFile);
 
     connect(ui.action_desktop_manage_connect, &QAction::triggered,
             this, &MainWindow::onDesktopManageConnect);
@@ -511,6 +514,63 @@ void MainWindow::onSystemInfoConnect()
     }
 }
 
+void MainWindow::onDistributeFile()
+{
+    AddressBookTab* tab = currentAddressBookTab();
+    if (!tab)
+        return;
+
+    proto::address_book::ComputerGroup* computer_group = tab->currentComputerGroup();
+    if (!computer_group)
+        return;
+
+    const std::optional<client::RouterConfig> router_config = tab->routerConfig();
+
+    std::vector<client::Config> hosts;
+    int skipped_count = 0;
+
+    for (int i = 0; i < computer_group->computer_size(); ++i)
+    {
+        const proto::address_book::Computer& computer = computer_group->computer(i);
+
+        client::Config config;
+        config.router_config = router_config;
+        config.computer_name = base::utf16FromUtf8(computer.name());
+        config.address_or_id = base::utf16FromUtf8(computer.address());
+        config.port          = static_cast<uint16_t>(computer.port());
+        config.username      = base::utf16FromUtf8(computer.username());
+        config.password      = base::utf16FromUtf8(computer.password());
+        config.session_type  = proto::SESSION_TYPE_FILE_TRANSFER;
+
+        // The credentials can not be asked for each computer.
+        if (config.username.empty() || config.password.empty() ||
+            (base::isHostId(config.address_or_id) && !router_config.has_value()))
+        {
+            ++skipped_count;
+            continue;
+        }
+
+        hosts.emplace_back(std::move(config));
+    }
+
+    if (skipped_count)
+    {
+        QMessageBox::warning(this,
+                             tr("Warning"),
+                             tr("%n computer(s) without a user name and password or without a "
+                                "configured router are skipped.", "", skipped_count),
+                             QMessageBox::Ok);
+    }
+
+    if (hosts.empty())
+        return;
+
+    FileDistributionDialog* dialog = new FileDistributionDialog(hosts, this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->show();
+    dialog->activateWindow();
+}
+
 void MainWindow::onCurrentTabChanged(int index)
 {
     if (index == -1)
@@ -520,6 +580,7 @@ void MainWindow::onCurrentTabChanged(int index)
         ui.action_add_computer->setEnabled(false);
         ui.action_fast_connect->setEnabled(false);
         ui.action_router_manage->setEnabled(false);
+        ui.action_distribute_file->setEnabled(false);
         return;
     }
 
@@ -532,6 +593,7 @@ void MainWindow::onCurrentTabChanged(int index)
 
     ui.action_fast_connect->setEnabled(true);
     ui.action_router_manage->setEnabled(tab->isRouterEnabled());
+    ui.action_distribute_file->setEnabled(true);
 
     proto::address_book::ComputerGroup* computer_group = tab->currentComputerGroup();
     if (computer_group)
@@ -47,9 +47,11 @@ ClientSession::~ClientSession()
 }
 
 // static
-std::unique_ptr<ClientSession> ClientSession::create(proto::SessionType session_type,
-                                                     std::unique_ptr<base::NetworkChannel> channel,
-                                                     std::shared_ptr<base::TaskRunner> task_runner)
+std::unique_ptr<ClientSession> ClientSession::create(
+    proto::SessionType session_type,
+    std::unique_ptr<base::NetworkChannel> channel,
+    std::shared_ptr<base::TaskRunner> task_runner,
+    std::shared_ptr<SystemInfoCache> system_info_cache)
 {
     if (!channel)
     {
@@ -70,7 +72,7 @@ std::unique_ptr<ClientSession> ClientSession::create(proto::SessionType session_
 
         case proto::SESSION_TYPE_SYSTEM_INFO:
             return std::unique_ptr<ClientSessionSystemInfo>(
-                new ClientSessionSystemInfo(std::move(channel)));
+                new ClientSessionSystemInfo(std::move(channel), std::move(system_info_cache)));
 
         default:
             LOG(LS_ERROR) << "Unknown session type: " << session_type;
@@ -103,6 +105,12 @@ void ClientSession::start(Delegate* delegate)
         channel_->setTcpKeepAlive(true);
     }
 
+    // Versions 2.3.0+ support interleaving of messages with different priorities and message
+    // compression.
+    const bool has_chunking = version_ >= base::Version(2, 3, 0);
+    channel_->setMessageChunking(has_chunking);
+    channel_->setMessageCompression(has_chunking);
+
     channel_->resume();
     onStarted();
 }
@@ -145,9 +153,31 @@ std::shared_ptr<base::NetworkChannelProxy> ClientSession::channelProxy()
     return channel_->channelProxy();
 }
 
-void ClientSession::sendMessage(base::ByteArray&& buffer)
+void ClientSession::sendMessage(base::ByteArray&& buffer,
+                                base::NetworkChannel::Priority priority,
+                                uint32_t key)
+{
+    channel_->send(std::move(buffer), priority, key);
+}
+
+bool ClientSession::hasQueuedMessage(uint32_t key) const
+{
+    return channel_->hasQueuedMessage(key);
+}
+
+bool ClientSession::isWritingMessage(uint32_t key) const
+{
+    return channel_->isWritingMessage(key);
+}
+
+int ClientSession::speedTx()
+{
+    return channel_->speedTx();
+}
+
+base::NetworkChannel::Milliseconds ClientSession::roundTripTime() const
 {
-    channel_->send(std::move(buffer));
+    return channel_->roundTripTime();
 }
 
 void ClientSession::onConnected()
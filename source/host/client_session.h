@@ -33,6 +33,7 @@ class TaskRunner;
 namespace host {
 
 class DesktopSessionProxy;
+class SystemInfoCache;
 
 class ClientSession : public base::NetworkChannel::Listener
 {
@@ -56,9 +57,11 @@ public:
         FINISHED // Session is stopped.
     };
 
-    static std::unique_ptr<ClientSession> create(proto::SessionType session_type,
-                                                 std::unique_ptr<base::NetworkChannel> channel,
-                                                 std::shared_ptr<base::TaskRunner> task_runner);
+    static std::unique_ptr<ClientSession> create(
+        proto::SessionType session_type,
+        std::unique_ptr<base::NetworkChannel> channel,
+        std::shared_ptr<base::TaskRunner> task_runner,
+        std::shared_ptr<SystemInfoCache> system_info_cache);
 
     void start(Delegate* delegate);
     void stop();
@@ -88,7 +91,18 @@ protected:
     virtual void onStarted() = 0;
 
     std::shared_ptr<base::NetworkChannelProxy> channelProxy();
-    void sendMessage(base::ByteArray&& buffer);
+    // Messages with a higher |priority| are sent before the queued messages with a lower priority.
+    // A message with a non-zero |key| replaces a queued message with the same key.
+    using Priority = base::NetworkChannel::Priority;
+    void sendMessage(base::ByteArray&& buffer,
+                     Priority priority = Priority::NORMAL,
+                     uint32_t key = 0);
+    bool hasQueuedMessage(uint32_t key) const;
+    bool isWritingMessage(uint32_t key) const;
+
+    // Statistics of the network channel. See base::NetworkChannel for details.
+    int speedTx();
+    base::NetworkChannel::Milliseconds roundTripTime() const;
 
     // base::NetworkChannel::Listener implementation.
     void onConnected() override;
@@ -20,22 +20,23 @@
 
 #include "base/logging.h"
 #include "base/power_controller.h"
-#include "base/codec/audio_encoder_opus.h"
 #include "base/codec/cursor_encoder.h"
-#include "base/codec/scale_reducer.h"
-#include "base/codec/video_encoder_vpx.h"
-#include "base/codec/video_encoder_zstd.h"
-#include "base/desktop/frame.h"
-#include "base/desktop/screen_capturer.h"
+#include "base/codec/video_encoder_h264.h"
+#include "base/net/congestion_controller.h"
+#include "base/strings/string_number_conversions.h"
 #include "base/win/safe_mode_util.h"
 #include "common/desktop_session_constants.h"
 #include "host/desktop_session_proxy.h"
+#include "host/session_recorder.h"
+#include "host/system_settings.h"
 #include "host/system_info.h"
 #include "host/win/updater_launcher.h"
 #include "host/win/service_constants.h"
 #include "proto/desktop_internal.pb.h"
 #include "proto/text_chat.pb.h"
 
+#include <algorithm>
+
 namespace host {
 
 namespace {
@@ -52,13 +53,28 @@ base::PixelFormat parsePixelFormat(const proto::PixelFormat& format)
         static_cast<uint8_t>(format.blue_shift()));
 }
 
+// Keys of the messages that replace each other in the write queue.
+const uint32_t kVideoMessageKey = 1;
+const uint32_t kCursorPositionMessageKey = 2;
+
+// The send speed is measured between updates, so the interval should not be too short.
+const std::chrono::milliseconds kCongestionUpdateInterval { 250 };
+
+// A resolution change takes a while and makes the screen blink, so it is not done for every step
+// of the window resize.
+const std::chrono::milliseconds kResolutionChangeDelay { 1000 };
+
+// Frame interval of the preview clients.
+const std::chrono::milliseconds kPreviewFrameInterval { 1000 };
+
 } // namespace
 
 ClientSessionDesktop::ClientSessionDesktop(proto::SessionType session_type,
                                            std::unique_ptr<base::NetworkChannel> channel,
                                            std::shared_ptr<base::TaskRunner> task_runner)
-    : base::ProtobufArena(std::move(task_runner)),
-      ClientSession(session_type, std::move(channel))
+    : base::ProtobufArena(task_runner),
+      ClientSession(session_type, std::move(channel)),
+      resolution_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner)
 {
     LOG(LS_INFO) << "Ctor";
 
@@ -69,6 +85,11 @@ ClientSessionDesktop::ClientSessionDesktop(proto::SessionType session_type,
 ClientSessionDesktop::~ClientSessionDesktop()
 {
     LOG(LS_INFO) << "Dtor";
+
+    restoreResolution();
+
+    if (screen_encoder_)
+        screen_encoder_->removeClient(this);
 }
 
 void ClientSessionDesktop::setDesktopSessionProxy(
@@ -78,9 +99,16 @@ void ClientSessionDesktop::setDesktopSessionProxy(
     DCHECK(desktop_session_proxy_);
 }
 
+void ClientSessionDesktop::setScreenEncoderPool(
+    std::shared_ptr<ScreenEncoderPool> screen_encoder_pool)
+{
+    screen_encoder_pool_ = std::move(screen_encoder_pool);
+    DCHECK(screen_encoder_pool_);
+}
+
 void ClientSessionDesktop::onMessageReceived(const base::ByteArray& buffer)
 {
-    proto::ClientToHost* incoming_message = messageFromArena<proto::ClientToHost>();
+    proto::ClientToHost* incoming_message = incomingMessageFromArena<proto::ClientToHost>();
 
     if (!base::parse(buffer, incoming_message))
     {
@@ -93,37 +121,46 @@ void ClientSessionDesktop::onMessageReceived(const base::ByteArray& buffer)
         if (sessionType() != proto::SESSION_TYPE_DESKTOP_MANAGE)
             return;
 
-        if (!scale_reducer_)
-            return;
-
-        const proto::MouseEvent& mouse_event = incoming_message->mouse_event();
-
-        int pos_x = static_cast<int>(
-            static_cast<double>(mouse_event.x() * 100) / scale_reducer_->scaleFactorX());
-        int pos_y = static_cast<int>(
-            static_cast<double>(mouse_event.y() * 100) / scale_reducer_->scaleFactorY());
-
         proto::MouseEvent out_mouse_event;
-        out_mouse_event.set_mask(mouse_event.mask());
-        out_mouse_event.set_x(pos_x);
-        out_mouse_event.set_y(pos_y);
+        if (!translateMouseEvent(incoming_message->mouse_event(), &out_mouse_event))
+            return;
 
+        screen_encoder_->setFocusPoint(base::Point(out_mouse_event.x(), out_mouse_event.y()));
+        screen_encoder_->onClientInput();
         desktop_session_proxy_->injectMouseEvent(out_mouse_event);
     }
+    else if (incoming_message->has_input_event_batch())
+    {
+        if (sessionType() == proto::SESSION_TYPE_DESKTOP_MANAGE)
+            readInputEventBatch(incoming_message->input_event_batch());
+    }
     else if (incoming_message->has_key_event())
     {
         if (sessionType() == proto::SESSION_TYPE_DESKTOP_MANAGE)
+        {
+            if (screen_encoder_)
+                screen_encoder_->onClientInput();
             desktop_session_proxy_->injectKeyEvent(incoming_message->key_event());
+        }
     }
     else if (incoming_message->has_text_event())
     {
         if (sessionType() == proto::SESSION_TYPE_DESKTOP_MANAGE)
+        {
+            if (screen_encoder_)
+                screen_encoder_->onClientInput();
             desktop_session_proxy_->injectTextEvent(incoming_message->text_event());
+        }
     }
     else if (incoming_message->has_clipboard_event())
     {
         if (sessionType() == proto::SESSION_TYPE_DESKTOP_MANAGE)
-            desktop_session_proxy_->injectClipboardEvent(incoming_message->clipboard_event());
+        {
+            std::optional<proto::ClipboardEvent> event =
+                clipboard_stream_.join(incoming_message->clipboard_event());
+            if (event.has_value())
+                desktop_session_proxy_->injectClipboardEvent(*event);
+        }
     }
     else if (incoming_message->has_extension())
     {
@@ -140,9 +177,42 @@ void ClientSessionDesktop::onMessageReceived(const base::ByteArray& buffer)
     }
 }
 
-void ClientSessionDesktop::onMessageWritten(size_t /* pending */)
+void ClientSessionDesktop::onMessageWritten(size_t pending)
 {
-    // Nothing
+    // The screen may not change anymore. The skipped changes are sent as soon as the channel can
+    // take the next frame.
+    if (screen_encoder_)
+        screen_encoder_->onClientReady();
+
+    if (!congestion_controller_)
+        return;
+
+    // The deepest queue during the update interval is used.
+    max_pending_ = std::max(max_pending_, pending);
+
+    const base::CongestionController::TimePoint current_time =
+        base::CongestionController::Clock::now();
+
+    if (current_time - congestion_update_time_ < kCongestionUpdateInterval)
+        return;
+
+    const size_t max_pending = max_pending_;
+
+    congestion_update_time_ = current_time;
+    max_pending_ = 0;
+
+    if (!congestion_controller_->update(current_time, max_pending, speedTx(), roundTripTime()))
+        return;
+
+    LOG(LS_INFO) << "Congestion control: " << congestion_controller_->targetBitrate() << " kbps, "
+                 << congestion_controller_->captureInterval().count() << " ms, "
+                 << congestion_controller_->scaleFactor() << "% (pending: " << max_pending << ")";
+
+    if (screen_encoder_)
+    {
+        screen_encoder_->setClientRate(this, congestion_controller_->targetBitrate(),
+                                       congestion_controller_->scaleFactor());
+    }
 }
 
 void ClientSessionDesktop::onStarted()
@@ -164,9 +234,15 @@ void ClientSessionDesktop::onStarted()
     proto::HostToClient* outgoing_message = messageFromArena<proto::HostToClient>();
     proto::DesktopConfigRequest* request = outgoing_message->mutable_config_request();
 
+    uint32_t video_encodings = common::kSupportedVideoEncodings;
+
+    // H.264 is only offered if the video card has a hardware encoder.
+    if (!base::VideoEncoderH264::isSupported())
+        video_encodings &= ~static_cast<uint32_t>(proto::VIDEO_ENCODING_H264);
+
     // Add supported extensions and video encodings.
     request->set_extensions(extensions);
-    request->set_video_encodings(common::kSupportedVideoEncodings);
+    request->set_video_encodings(video_encodings);
     request->set_audio_encodings(common::kSupportedAudioEncodings);
 
     LOG(LS_INFO) << "Sending config request";
@@ -176,112 +252,110 @@ void ClientSessionDesktop::onStarted()
 
     // Send the request.
     sendMessage(base::serialize(*outgoing_message));
-}
 
-void ClientSessionDesktop::encodeScreen(const base::Frame* frame, const base::MouseCursor* cursor)
-{
-    proto::HostToClient* outgoing_message = messageFromArena<proto::HostToClient>();
-
-    if (frame && video_encoder_ && scale_reducer_)
+    const std::u16string recording_path = SystemSettings::snapshot()->session_recording_path;
+    if (!recording_path.empty())
     {
-        if (source_size_ != frame->size())
-        {
-            // Every time we change the resolution, we have to reset the preferred size.
-            source_size_ = frame->size();
-            preferred_size_ = base::Size();
-        }
+        std::u16string name = u"session-" + base::numberToString16(id());
 
-        base::Size current_size = preferred_size_;
+        LOG(LS_INFO) << "Session recording enabled (name: " << name << " user: " << userName()
+                     << ")";
+        session_recorder_ = std::make_unique<SessionRecorder>(recording_path, name);
+    }
+}
 
-        // If the preferred size is larger than the original, then we use the original size.
-        if (current_size.width() > source_size_.width() ||
-            current_size.height() > source_size_.height())
-        {
-            current_size = source_size_;
-        }
+std::chrono::milliseconds ClientSessionDesktop::captureInterval() const
+{
+    if (preview_)
+        return kPreviewFrameInterval;
 
-        // If we don't have a preferred size, then we use the original frame size.
-        if (current_size.isEmpty())
-            current_size = source_size_;
+    std::chrono::milliseconds capture_interval = base::CongestionController::kMinCaptureInterval;
+    if (congestion_controller_)
+        capture_interval = congestion_controller_->captureInterval();
 
-        const base::Frame* scaled_frame = scale_reducer_->scaleFrame(frame, current_size);
-        if (!scaled_frame)
-        {
-            LOG(LS_ERROR) << "No scaled frame";
-            return;
-        }
+    if (video_settings_.energy_saving)
+        capture_interval = std::max(capture_interval, ScreenEncoder::kEnergySavingFrameInterval);
 
-        proto::VideoPacket* packet = outgoing_message->mutable_video_packet();
+    return capture_interval;
+}
 
-        // Encode the frame into a video packet.
-        video_encoder_->encode(scaled_frame, packet);
+uint32_t ClientSessionDesktop::audioBitrate() const
+{
+    uint32_t bitrate = base::CongestionController::kMaxAudioBitrate;
+    if (congestion_controller_)
+        bitrate = congestion_controller_->audioBitrate();
 
-        if (packet->has_format())
-        {
-            proto::VideoPacketFormat* format = packet->mutable_format();
-
-            // In video packets that contain the format, we pass the screen capture type.
-            format->set_capturer_type(frame->capturerType());
-
-            // Real screen size.
-            proto::Size* screen_size = format->mutable_screen_size();
-            screen_size->set_width(frame->size().width());
-            screen_size->set_height(frame->size().height());
-
-            LOG(LS_INFO) << "Video packet has format";
-            LOG(LS_INFO) << "Capturer type: " << base::ScreenCapturer::typeToString(
-                static_cast<base::ScreenCapturer::Type>(frame->capturerType()));
-            LOG(LS_INFO) << "Screen size: " << screen_size->width() << "x"
-                         << screen_size->height();
-            LOG(LS_INFO) << "Video size: " << format->video_rect().width() << "x"
-                         << format->video_rect().height();
-        }
-    }
+    return bitrate * 1000;
+}
 
-    if (cursor && cursor_encoder_)
-    {
-        if (!cursor_encoder_->encode(*cursor, outgoing_message->mutable_cursor_shape()))
-            outgoing_message->clear_cursor_shape();
-    }
+void ClientSessionDesktop::encodeCursor(const base::MouseCursor* cursor)
+{
+    if (!cursor || !cursor_encoder_)
+        return;
+
+    proto::HostToClient* outgoing_message = messageFromArena<proto::HostToClient>();
 
-    if (outgoing_message->has_video_packet() || outgoing_message->has_cursor_shape())
+    if (cursor_encoder_->encode(*cursor, outgoing_message->mutable_cursor_shape()))
         sendMessage(base::serialize(*outgoing_message));
 }
 
-void ClientSessionDesktop::encodeAudio(const proto::AudioPacket& audio_packet)
+void ClientSessionDesktop::sendAudio(const proto::AudioPacket& audio_packet)
 {
-    if (!audio_encoder_)
+    if (session_recorder_)
+        session_recorder_->addAudioPacket(audio_packet);
+
+    if (!desktop_session_config_.audio)
         return;
 
-    proto::HostToClient* outgoing_message = messageFromArena<proto::HostToClient>();
+    // The desktop agent encodes the audio.
+    DCHECK_EQ(audio_packet.encoding(), proto::AUDIO_ENCODING_OPUS);
 
-    if (!audio_encoder_->encode(audio_packet, outgoing_message->mutable_audio_packet()))
-        return;
+    proto::HostToClient* outgoing_message = messageFromArena<proto::HostToClient>();
+    outgoing_message->mutable_audio_packet()->CopyFrom(audio_packet);
 
     sendMessage(base::serialize(*outgoing_message));
 }
 
 void ClientSessionDesktop::setCursorPosition(const proto::CursorPosition& cursor_position)
 {
-    if (!desktop_session_config_.cursor_position)
+    if (!screen_encoder_)
         return;
 
-    proto::HostToClient* outgoing_message = messageFromArena<proto::HostToClient>();
+    screen_encoder_->setFocusPoint(base::Point(cursor_position.x(), cursor_position.y()));
+
+    if (!desktop_session_config_.cursor_position)
+        return;
 
     int pos_x = static_cast<int>(
-        static_cast<double>(cursor_position.x()) * scale_reducer_->scaleFactorX() / 100.0);
+        static_cast<double>(cursor_position.x()) * screen_encoder_->scaleFactorX() / 100.0);
     int pos_y = static_cast<int>(
-        static_cast<double>(cursor_position.y()) * scale_reducer_->scaleFactorY() / 100.0);
+        static_cast<double>(cursor_position.y()) * screen_encoder_->scaleFactorY() / 100.0);
+
+    // With the scaling several positions of the host become the same position for the client.
+    const base::Point scaled_position(pos_x, pos_y);
+    if (last_cursor_position_ == scaled_position)
+        return;
+
+    last_cursor_position_.emplace(scaled_position);
+
+    proto::HostToClient* outgoing_message = messageFromArena<proto::HostToClient>();
 
     proto::CursorPosition* position = outgoing_message->mutable_cursor_position();
     position->set_x(pos_x);
     position->set_y(pos_y);
 
-    sendMessage(base::serialize(*outgoing_message));
+    // Only the last position of the cursor is relevant.
+    sendMessage(base::serialize(*outgoing_message), Priority::HIGH, kCursorPositionMessageKey);
 }
 
 void ClientSessionDesktop::setScreenList(const proto::ScreenList& list)
 {
+    current_screen_ = list.current_screen();
+
+    resolutions_.clear();
+    for (const auto& resolution : list.resolution())
+        resolutions_.emplace_back(resolution.width(), resolution.height());
+
     proto::HostToClient* outgoing_message = messageFromArena<proto::HostToClient>();
     proto::DesktopExtension* extension = outgoing_message->mutable_extension();
     extension->set_name(common::kSelectScreenExtension);
@@ -294,9 +368,26 @@ void ClientSessionDesktop::injectClipboardEvent(const proto::ClipboardEvent& eve
 {
     if (sessionType() == proto::SESSION_TYPE_DESKTOP_MANAGE)
     {
-        proto::HostToClient* outgoing_message = messageFromArena<proto::HostToClient>();
-        outgoing_message->mutable_clipboard_event()->CopyFrom(event);
-        sendMessage(base::serialize(*outgoing_message));
+        // Older clients do not join the chunks.
+        if (version() < base::Version(2, 3, 0))
+        {
+            proto::HostToClient* outgoing_message = messageFromArena<proto::HostToClient>();
+            outgoing_message->mutable_clipboard_event()->CopyFrom(event);
+            sendMessage(base::serialize(*outgoing_message), Priority::HIGH);
+            return;
+        }
+
+        // The chunks of a large clipboard do not delay the input and the service messages.
+        std::vector<proto::ClipboardEvent> chunks = clipboard_stream_.split(event);
+        const Priority priority = chunks.size() > 1 ? Priority::LOW : Priority::HIGH;
+
+        for (auto& chunk : chunks)
+        {
+            // The chunks are not allocated in the arena to not keep a large clipboard in it.
+            proto::HostToClient outgoing_message;
+            outgoing_message.mutable_clipboard_event()->Swap(&chunk);
+            sendMessage(base::serialize(outgoing_message), priority);
+        }
     }
     else
     {
@@ -304,6 +395,60 @@ void ClientSessionDesktop::injectClipboardEvent(const proto::ClipboardEvent& eve
     }
 }
 
+bool ClientSessionDesktop::translateMouseEvent(
+    const proto::MouseEvent& mouse_event, proto::MouseEvent* out_mouse_event) const
+{
+    if (!screen_encoder_)
+        return false;
+
+    const double scale_factor_x = screen_encoder_->scaleFactorX();
+    const double scale_factor_y = screen_encoder_->scaleFactorY();
+
+    if (scale_factor_x <= 0 || scale_factor_y <= 0)
+        return false;
+
+    int pos_x = static_cast<int>(
+        static_cast<double>(mouse_event.x() * 100) / scale_factor_x);
+    int pos_y = static_cast<int>(
+        static_cast<double>(mouse_event.y() * 100) / scale_factor_y);
+
+    out_mouse_event->set_mask(mouse_event.mask());
+    out_mouse_event->set_x(pos_x);
+    out_mouse_event->set_y(pos_y);
+    return true;
+}
+
+void ClientSessionDesktop::readInputEventBatch(const proto::InputEventBatch& batch)
+{
+    proto::InputEventBatch* out_batch = messageFromArena<proto::InputEventBatch>();
+
+    for (int i = 0; i < batch.event_size(); ++i)
+    {
+        const proto::InputEvent& event = batch.event(i);
+
+        if (event.has_mouse_event())
+        {
+            proto::MouseEvent out_mouse_event;
+            if (!translateMouseEvent(event.mouse_event(), &out_mouse_event))
+                continue;
+
+            screen_encoder_->setFocusPoint(base::Point(out_mouse_event.x(), out_mouse_event.y()));
+            out_batch->add_event()->mutable_mouse_event()->CopyFrom(out_mouse_event);
+        }
+        else if (event.has_key_event() || event.has_text_event())
+        {
+            out_batch->add_event()->CopyFrom(event);
+        }
+    }
+
+    if (out_batch->event_size() != 0)
+    {
+        if (screen_encoder_)
+            screen_encoder_->onClientInput();
+        desktop_session_proxy_->injectInputEventBatch(*out_batch);
+    }
+}
+
 void ClientSessionDesktop::readExtension(const proto::DesktopExtension& extension)
 {
     if (extension.name() == common::kSelectScreenExtension)
@@ -319,7 +464,16 @@ void ClientSessionDesktop::readExtension(const proto::DesktopExtension& extensio
         }
 
         desktop_session_proxy_->selectScreen(screen);
-        preferred_size_ = base::Size();
+
+        // The client has chosen the screen or the resolution itself.
+        resolution_timer_.stop();
+        requested_resolution_ = base::Size();
+
+        video_settings_.preferred_size = base::Size();
+        viewport_ = base::Rect();
+        updateScreenEncoder();
+        if (screen_encoder_)
+            screen_encoder_->setClientViewport(this, viewport_);
     }
     else if (extension.name() == common::kPreferredSizeExtension)
     {
@@ -344,8 +498,77 @@ void ClientSessionDesktop::readExtension(const proto::DesktopExtension& extensio
         LOG(LS_INFO) << "Preferred size changed: "
                      << preferred_size.width() << "x" << preferred_size.height();
 
-        preferred_size_.set(preferred_size.width(), preferred_size.height());
+        video_settings_.preferred_size.set(preferred_size.width(), preferred_size.height());
+        updateScreenEncoder();
         desktop_session_proxy_->captureScreen();
+
+        // Until the resolution is changed, the frames are scaled.
+        if (match_resolution_)
+            resolution_timer_.start(kResolutionChangeDelay, [this]() { matchResolution(); });
+    }
+    else if (extension.name() == common::kViewportExtension)
+    {
+        proto::Viewport viewport;
+
+        if (!viewport.ParseFromString(extension.data()))
+        {
+            LOG(LS_ERROR) << "Unable to parse viewport extension data";
+            return;
+        }
+
+        static const int kMaxScreenSize = std::numeric_limits<int16_t>::max();
+
+        if (viewport.x() < 0 || viewport.x() > kMaxScreenSize ||
+            viewport.y() < 0 || viewport.y() > kMaxScreenSize ||
+            viewport.width() < 0 || viewport.width() > kMaxScreenSize ||
+            viewport.height() < 0 || viewport.height() > kMaxScreenSize)
+        {
+            LOG(LS_ERROR) << "Invalid viewport: " << viewport.x() << "," << viewport.y() << " "
+                          << viewport.width() << "x" << viewport.height();
+            return;
+        }
+
+        viewport_ = base::Rect::makeXYWH(
+            viewport.x(), viewport.y(), viewport.width(), viewport.height());
+
+        if (screen_encoder_)
+            screen_encoder_->setClientViewport(this, viewport_);
+    }
+    else if (extension.name() == common::kVideoRecordingExtension)
+    {
+        proto::VideoRecording video_recording;
+
+        if (!video_recording.ParseFromString(extension.data()))
+        {
+            LOG(LS_ERROR) << "Unable to parse video recording extension data";
+            return;
+        }
+
+        if (video_recording.action() != proto::VideoRecording::ACTION_STARTED)
+            return;
+
+        // The client writes the packets to the file as they are. The recording can start only
+        // from a key frame.
+        LOG(LS_INFO) << "Video recording started, key frame requested";
+
+        if (screen_encoder_)
+            screen_encoder_->requestKeyFrame();
+    }
+    else if (extension.name() == common::kVideoRecoveryExtension)
+    {
+        proto::VideoRecovery video_recovery;
+
+        if (!video_recovery.ParseFromString(extension.data()))
+        {
+            LOG(LS_ERROR) << "Unable to parse video recovery extension data";
+            return;
+        }
+
+        LOG(LS_INFO) << "Video recovery requested (reference frame: "
+                     << video_recovery.reference_frame_id() << ")";
+
+        if (screen_encoder_)
+            screen_encoder_->requestRecovery(this, video_recovery.reference_frame_id());
     }
     else if (extension.name() == common::kTextChatExtension)
     {
@@ -483,7 +706,8 @@ void ClientSessionDesktop::readExtension(const proto::DesktopExtension& extensio
         desktop_extension->set_name(common::kSystemInfoExtension);
         desktop_extension->set_data(system_info->SerializeAsString());
 
-        sendMessage(base::serialize(*outgoing_message));
+        // The report can be large. Input and cursor messages must not wait for it.
+        sendMessage(base::serialize(*outgoing_message), Priority::LOW);
     }
     else
     {
@@ -493,54 +717,59 @@ void ClientSessionDesktop::readExtension(const proto::DesktopExtension& extensio
 
 void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
 {
-    switch (config.video_encoding())
-    {
-        case proto::VIDEO_ENCODING_VP8:
-            video_encoder_ = base::VideoEncoderVPX::createVP8();
-            break;
+    video_settings_.encoding = config.video_encoding();
+    video_settings_.pixel_format = parsePixelFormat(config.pixel_format());
+    video_settings_.compress_ratio = static_cast<int>(config.compress_ratio());
 
-        case proto::VIDEO_ENCODING_VP9:
-            video_encoder_ = base::VideoEncoderVPX::createVP9();
-            break;
+    preview_ = (config.flags() & proto::PREVIEW);
+    video_settings_.frame_interval =
+        preview_ ? kPreviewFrameInterval : std::chrono::milliseconds::zero();
+    video_settings_.energy_saving = (config.flags() & proto::ENERGY_SAVER);
 
-        case proto::VIDEO_ENCODING_ZSTD:
-            video_encoder_ = base::VideoEncoderZstd::create(
-                parsePixelFormat(config.pixel_format()), static_cast<int>(config.compress_ratio()));
-            break;
+    if (video_settings_.energy_saving)
+        LOG(LS_INFO) << "Client runs on battery";
 
-        default:
-        {
-            // No supported video encoding.
-            LOG(LS_WARNING) << "Unsupported video encoding: " << config.video_encoding();
-        }
-        break;
-    }
+    // Older clients do not know the copy rectangles and the tile cache.
+    video_settings_.extended_zstd = config.video_encoding() == proto::VIDEO_ENCODING_ZSTD &&
+        version() >= base::Version(2, 3, 0);
+    video_settings_.sliced_frames =
+        video_settings_.extended_zstd && (config.flags() & proto::SLICED_FRAMES);
 
-    if (!video_encoder_)
-    {
-        LOG(LS_ERROR) << "Video encoder not initialized!";
+    congestion_controller_ = std::make_unique<base::CongestionController>();
+    max_pending_ = 0;
+
+    updateScreenEncoder();
+    if (!screen_encoder_)
         return;
-    }
 
     switch (config.audio_encoding())
     {
         case proto::AUDIO_ENCODING_OPUS:
-            audio_encoder_ = std::make_unique<base::AudioEncoderOpus>();
+            desktop_session_config_.audio = true;
             break;
 
         default:
         {
             LOG(LS_WARNING) << "Unsupported audio encoding: " << config.audio_encoding();
-            audio_encoder_.reset();
+            desktop_session_config_.audio = false;
         }
         break;
     }
 
+    last_cursor_position_.reset();
+
     cursor_encoder_.reset();
     if (config.flags() & proto::ENABLE_CURSOR_SHAPE)
+    {
         cursor_encoder_ = std::make_unique<base::CursorEncoder>();
 
-    scale_reducer_ = std::make_unique<base::ScaleReducer>();
+        if (config.flags() & proto::CURSOR_HASH_CACHE)
+        {
+            cursor_encoder_->setHashCache(
+                std::vector<uint64_t>(config.cursor_cache().begin(), config.cursor_cache().end()));
+            cursor_encoder_->setDeltaEnabled(config.flags() & proto::CURSOR_DELTA);
+        }
+    }
 
     desktop_session_config_.disable_font_smoothing =
         (config.flags() & proto::DISABLE_FONT_SMOOTHING);
@@ -554,9 +783,18 @@ void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
         (config.flags() & proto::LOCK_AT_DISCONNECT);
     desktop_session_config_.clear_clipboard =
         (config.flags() & proto::CLEAR_CLIPBOARD);
+    desktop_session_config_.clipboard = sessionType() == proto::SESSION_TYPE_DESKTOP_MANAGE &&
+        (config.flags() & proto::ENABLE_CLIPBOARD);
     desktop_session_config_.cursor_position =
         (config.flags() & proto::CURSOR_POSITION);
 
+    match_resolution_ = (config.flags() & proto::MATCH_RESOLUTION);
+    if (!match_resolution_)
+    {
+        resolution_timer_.stop();
+        restoreResolution();
+    }
+
     LOG(LS_INFO) << "Client configuration changed";
     LOG(LS_INFO) << "Video encoding: " << config.video_encoding();
     LOG(LS_INFO) << "Enable cursor shape: " << (cursor_encoder_ != nullptr);
@@ -566,9 +804,133 @@ void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
     LOG(LS_INFO) << "Block input: " << desktop_session_config_.block_input;
     LOG(LS_INFO) << "Lock at disconnect: " << desktop_session_config_.lock_at_disconnect;
     LOG(LS_INFO) << "Clear clipboard: " << desktop_session_config_.clear_clipboard;
+    LOG(LS_INFO) << "Clipboard: " << desktop_session_config_.clipboard;
     LOG(LS_INFO) << "Cursor position: " << desktop_session_config_.cursor_position;
+    LOG(LS_INFO) << "Match resolution: " << match_resolution_;
+    LOG(LS_INFO) << "Preview: " << preview_;
 
     delegate_->onClientSessionConfigured();
 }
 
+bool ClientSessionDesktop::hasQueuedVideoPacket() const
+{
+    return hasQueuedMessage(kVideoMessageKey);
+}
+
+bool ClientSessionDesktop::isWritingVideoPacket() const
+{
+    return isWritingMessage(kVideoMessageKey);
+}
+
+void ClientSessionDesktop::sendVideoPacket(base::ByteArray&& buffer)
+{
+    if (session_recorder_)
+        session_recorder_->addVideoMessage(buffer);
+
+    // The video packet replaces the previous one if it has not been sent yet. The encoder sends
+    // a delta packet only when the queue has no video packet.
+    sendMessage(std::move(buffer), Priority::LOW, kVideoMessageKey);
+}
+
+void ClientSessionDesktop::sendReplayPacket(base::ByteArray&& buffer)
+{
+    if (session_recorder_)
+        session_recorder_->addVideoMessage(buffer);
+
+    // The packets of the cached stream depend on each other and are sent without a key. The next
+    // video packets are queued after them.
+    sendMessage(std::move(buffer), Priority::LOW);
+}
+
+void ClientSessionDesktop::updateScreenEncoder()
+{
+    DCHECK(screen_encoder_pool_);
+
+    if (screen_encoder_ && screen_encoder_->settings() == video_settings_)
+        return;
+
+    if (screen_encoder_)
+    {
+        screen_encoder_->removeClient(this);
+        screen_encoder_.reset();
+    }
+
+    if (video_settings_.encoding == proto::VIDEO_ENCODING_UNKNOWN)
+        return;
+
+    screen_encoder_ = screen_encoder_pool_->encoder(video_settings_, desktop_session_proxy_);
+    if (!screen_encoder_)
+    {
+        LOG(LS_ERROR) << "Video encoder not initialized!";
+        return;
+    }
+
+    screen_encoder_->addClient(this);
+    screen_encoder_->setClientViewport(this, viewport_);
+
+    if (congestion_controller_)
+    {
+        screen_encoder_->setClientRate(this, congestion_controller_->targetBitrate(),
+                                       congestion_controller_->scaleFactor());
+    }
+}
+
+void ClientSessionDesktop::matchResolution()
+{
+    const base::Size& preferred_size = video_settings_.preferred_size;
+    if (preferred_size.isEmpty() || current_screen_ == -1 || !desktop_session_proxy_)
+        return;
+
+    // The largest supported resolution that fits into the client window.
+    base::Size resolution;
+    for (const base::Size& candidate : resolutions_)
+    {
+        if (candidate.width() > preferred_size.width() ||
+            candidate.height() > preferred_size.height())
+        {
+            continue;
+        }
+
+        if (static_cast<int64_t>(candidate.width()) * candidate.height() >
+            static_cast<int64_t>(resolution.width()) * resolution.height())
+        {
+            resolution = candidate;
+        }
+    }
+
+    if (resolution.isEmpty())
+    {
+        LOG(LS_INFO) << "No supported resolution fits into " << preferred_size;
+        return;
+    }
+
+    if (resolution == requested_resolution_)
+        return;
+
+    LOG(LS_INFO) << "Change resolution to match the client window: " << resolution;
+
+    proto::Screen screen;
+    screen.set_id(current_screen_);
+    screen.mutable_resolution()->set_width(resolution.width());
+    screen.mutable_resolution()->set_height(resolution.height());
+
+    desktop_session_proxy_->selectScreen(screen);
+    requested_resolution_ = resolution;
+}
+
+void ClientSessionDesktop::restoreResolution()
+{
+    if (requested_resolution_.isEmpty() || !desktop_session_proxy_)
+        return;
+
+    LOG(LS_INFO) << "Restore resolution of screen " << current_screen_;
+
+    // A screen without a resolution restores the original one.
+    proto::Screen screen;
+    screen.set_id(current_screen_);
+
+    desktop_session_proxy_->selectScreen(screen);
+    requested_resolution_ = base::Size();
+}
+
 } // namespace host
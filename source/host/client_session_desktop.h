@@ -21,26 +21,30 @@
 
 #include "base/macros_magic.h"
 #include "base/protobuf_arena.h"
-#include "base/desktop/geometry.h"
+#include "base/waitable_timer.h"
+#include "common/clipboard_stream.h"
 #include "host/client_session.h"
 #include "host/desktop_session.h"
+#include "host/screen_encoder.h"
+
+#include <optional>
+#include <vector>
 
 namespace base {
-class AudioEncoder;
+class CongestionController;
 class CursorEncoder;
-class Frame;
 class MouseCursor;
-class ScaleReducer;
-class VideoEncoder;
 } // namespace base
 
 namespace host {
 
 class DesktopSessionProxy;
+class SessionRecorder;
 
 class ClientSessionDesktop
     : public base::ProtobufArena,
-      public ClientSession
+      public ClientSession,
+      public ScreenEncoder::Client
 {
 public:
     ClientSessionDesktop(proto::SessionType session_type,
@@ -49,15 +53,28 @@ public:
     ~ClientSessionDesktop() override;
 
     void setDesktopSessionProxy(std::shared_ptr<DesktopSessionProxy> desktop_session_proxy);
+    void setScreenEncoderPool(std::shared_ptr<ScreenEncoderPool> screen_encoder_pool);
+
+    // The screen is encoded by the encoder which can be shared with other clients.
+    ScreenEncoder* screenEncoder() const { return screen_encoder_.get(); }
 
-    void encodeScreen(const base::Frame* frame, const base::MouseCursor* cursor);
-    void encodeAudio(const proto::AudioPacket& audio_packet);
+    void encodeCursor(const base::MouseCursor* cursor);
+    void sendAudio(const proto::AudioPacket& audio_packet);
     void setCursorPosition(const proto::CursorPosition& cursor_position);
     void setScreenList(const proto::ScreenList& list);
     void injectClipboardEvent(const proto::ClipboardEvent& event);
 
     const DesktopSession::Config& desktopSessionConfig() const { return desktop_session_config_; }
 
+    // Screen capture interval suitable for the throughput of the client network channel.
+    std::chrono::milliseconds captureInterval() const;
+
+    // The client shows a preview of the screen and takes frames at a low rate.
+    bool isPreview() const { return preview_; }
+
+    // Audio bitrate in bits per second suitable for the throughput of the client network channel.
+    uint32_t audioBitrate() const;
+
 protected:
     // net::Listener implementation.
     void onMessageReceived(const base::ByteArray& buffer) override;
@@ -66,18 +83,49 @@ protected:
     // ClientSession implementation.
     void onStarted() override;
 
+    // ScreenEncoder::Client implementation.
+    bool hasQueuedVideoPacket() const override;
+    bool isWritingVideoPacket() const override;
+    void sendVideoPacket(base::ByteArray&& buffer) override;
+    void sendReplayPacket(base::ByteArray&& buffer) override;
+
 private:
+    bool translateMouseEvent(const proto::MouseEvent& mouse_event,
+                             proto::MouseEvent* out_mouse_event) const;
+    void readInputEventBatch(const proto::InputEventBatch& batch);
     void readExtension(const proto::DesktopExtension& extension);
     void readConfig(const proto::DesktopConfig& config);
+    void updateScreenEncoder();
+    void matchResolution();
+    void restoreResolution();
 
     std::shared_ptr<DesktopSessionProxy> desktop_session_proxy_;
-    std::unique_ptr<base::ScaleReducer> scale_reducer_;
-    std::unique_ptr<base::VideoEncoder> video_encoder_;
+    std::shared_ptr<ScreenEncoderPool> screen_encoder_pool_;
+    std::shared_ptr<ScreenEncoder> screen_encoder_;
+    ScreenEncoder::Settings video_settings_;
+    std::unique_ptr<base::CongestionController> congestion_controller_;
+    std::chrono::time_point<std::chrono::high_resolution_clock> congestion_update_time_;
+    size_t max_pending_ = 0;
     std::unique_ptr<base::CursorEncoder> cursor_encoder_;
-    std::unique_ptr<base::AudioEncoder> audio_encoder_;
+    std::optional<base::Point> last_cursor_position_;
     DesktopSession::Config desktop_session_config_;
-    base::Size source_size_;
-    base::Size preferred_size_;
+    common::ClipboardStream clipboard_stream_;
+    std::unique_ptr<SessionRecorder> session_recorder_;
+
+    // The area of the screen shown by the client. Empty if the whole screen is shown.
+    base::Rect viewport_;
+
+    bool preview_ = false;
+
+    // The current screen and its supported resolutions from the last screen list.
+    int64_t current_screen_ = -1;
+    std::vector<base::Size> resolutions_;
+
+    // Set if the client asked to change the resolution instead of scaling. The resolution is
+    // changed when the preferred size stops changing for a while.
+    bool match_resolution_ = false;
+    base::WaitableTimer resolution_timer_;
+    base::Size requested_resolution_;
 
     DISALLOW_COPY_AND_ASSIGN(ClientSessionDesktop);
 };
@@ -31,6 +31,8 @@
 
 #include <WtsApi32.h>
 
+#include <deque>
+
 namespace host {
 
 namespace {
@@ -90,6 +92,65 @@ bool createLoggedOnUserToken(DWORD session_id, base::win::ScopedHandle* token_ou
     return true;
 }
 
+// Executes the tasks as the logged on user.
+class ImpersonatedThread : public base::Thread::Delegate
+{
+public:
+    ImpersonatedThread() = default;
+    ~ImpersonatedThread() override;
+
+    // Returns false if the thread can not impersonate the user, it is stopped then.
+    bool start(HANDLE user_token);
+
+    std::shared_ptr<base::TaskRunner> taskRunner() { return thread_.taskRunner(); }
+
+protected:
+    // base::Thread::Delegate implementation.
+    void onBeforeThreadRunning() override;
+    void onAfterThreadRunning() override;
+
+private:
+    base::Thread thread_;
+    HANDLE user_token_ = nullptr;
+    std::unique_ptr<base::win::ScopedImpersonator> impersonator_;
+    bool is_impersonated_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(ImpersonatedThread);
+};
+
+ImpersonatedThread::~ImpersonatedThread()
+{
+    thread_.stop();
+}
+
+bool ImpersonatedThread::start(HANDLE user_token)
+{
+    user_token_ = user_token;
+
+    // Returns after onBeforeThreadRunning.
+    thread_.start(base::MessageLoop::Type::DEFAULT, this);
+    user_token_ = nullptr;
+
+    if (!is_impersonated_)
+    {
+        thread_.stop();
+        return false;
+    }
+
+    return true;
+}
+
+void ImpersonatedThread::onBeforeThreadRunning()
+{
+    impersonator_ = std::make_unique<base::win::ScopedImpersonator>();
+    is_impersonated_ = impersonator_->loggedOnUser(user_token_);
+}
+
+void ImpersonatedThread::onAfterThreadRunning()
+{
+    impersonator_.reset();
+}
+
 } // namespace
 
 class ClientSessionFileTransfer::Worker
@@ -112,13 +173,27 @@ protected:
     void onTaskDone(std::shared_ptr<common::FileTask> task) override;
 
 private:
+    void sendOrderedReplies();
+
     base::Thread thread_;
     const base::SessionId session_id_;
     std::unique_ptr<base::win::ScopedImpersonator> impersonator_;
     std::shared_ptr<base::NetworkChannelProxy> channel_proxy_;
     std::shared_ptr<common::FileTaskProducerProxy> producer_proxy_;
+
+    // The lists of files and other short requests are executed on this thread, so they do not
+    // wait for a large file.
+    std::unique_ptr<ImpersonatedThread> metadata_thread_;
     std::unique_ptr<common::FileWorker> impl_;
 
+    // Requests without an id. Older clients expect the replies in the order of the requests.
+    struct OrderedTask
+    {
+        std::shared_ptr<common::FileTask> task;
+        bool is_done = false;
+    };
+    std::deque<OrderedTask> ordered_tasks_;
+
     DISALLOW_COPY_AND_ASSIGN(Worker);
 };
 
@@ -146,9 +221,20 @@ void ClientSessionFileTransfer::Worker::postRequest(std::unique_ptr<proto::FileR
 {
     if (impl_)
     {
+        const bool has_request_id = request->request_id() != 0;
+
         std::shared_ptr<common::FileTask> task = std::make_shared<common::FileTask>(
             producer_proxy_, std::move(request), common::FileTask::Target::LOCAL);
 
+        if (!has_request_id)
+        {
+            // The task is added on the worker thread, where the replies are received.
+            thread_.taskRunner()->postTask([this, task]()
+            {
+                ordered_tasks_.push_back(OrderedTask{ task });
+            });
+        }
+
         impl_->doTask(std::move(task));
     }
     else
@@ -178,7 +264,20 @@ void ClientSessionFileTransfer::Worker::onBeforeThreadRunning()
     }
 
     producer_proxy_ = std::make_shared<common::FileTaskProducerProxy>(this);
-    impl_ = std::make_unique<common::FileWorker>(thread_.taskRunner());
+
+    metadata_thread_ = std::make_unique<ImpersonatedThread>();
+    if (metadata_thread_->start(user_token))
+    {
+        impl_ = std::make_unique<common::FileWorker>(
+            thread_.taskRunner(), thread_.taskRunner(), metadata_thread_->taskRunner());
+    }
+    else
+    {
+        LOG(LS_WARNING) << "Unable to start metadata thread";
+
+        metadata_thread_.reset();
+        impl_ = std::make_unique<common::FileWorker>(thread_.taskRunner());
+    }
 }
 
 void ClientSessionFileTransfer::Worker::onAfterThreadRunning()
@@ -195,13 +294,39 @@ void ClientSessionFileTransfer::Worker::onAfterThreadRunning()
         LOG(LS_WARNING) << "Invalid producer proxy";
     }
 
+    metadata_thread_.reset();
     impl_.reset();
+    ordered_tasks_.clear();
     impersonator_.reset();
 }
 
 void ClientSessionFileTransfer::Worker::onTaskDone(std::shared_ptr<common::FileTask> task)
 {
-    channel_proxy_->send(base::serialize(task->reply()));
+    if (task->request().request_id())
+    {
+        channel_proxy_->send(base::serialize(task->reply()));
+        return;
+    }
+
+    for (auto& ordered_task : ordered_tasks_)
+    {
+        if (ordered_task.task == task)
+        {
+            ordered_task.is_done = true;
+            break;
+        }
+    }
+
+    sendOrderedReplies();
+}
+
+void ClientSessionFileTransfer::Worker::sendOrderedReplies()
+{
+    while (!ordered_tasks_.empty() && ordered_tasks_.front().is_done)
+    {
+        channel_proxy_->send(base::serialize(ordered_tasks_.front().task->reply()));
+        ordered_tasks_.pop_front();
+    }
 }
 
 ClientSessionFileTransfer::ClientSessionFileTransfer(std::unique_ptr<base::NetworkChannel> channel)
@@ -20,13 +20,18 @@
 
 #include "base/logging.h"
 #include "base/net/network_channel_proxy.h"
-#include "host/system_info.h"
+#include "host/system_info_cache.h"
 
 namespace host {
 
-ClientSessionSystemInfo::ClientSessionSystemInfo(std::unique_ptr<base::NetworkChannel> channel)
-    : ClientSession(proto::SESSION_TYPE_SYSTEM_INFO, std::move(channel))
+ClientSessionSystemInfo::ClientSessionSystemInfo(
+    std::unique_ptr<base::NetworkChannel> channel,
+    std::shared_ptr<SystemInfoCache> system_info_cache)
+    : ClientSession(proto::SESSION_TYPE_SYSTEM_INFO, std::move(channel)),
+      system_info_cache_(std::move(system_info_cache)),
+      lifetime_(std::make_shared<int>(0))
 {
+    DCHECK(system_info_cache_);
     LOG(LS_INFO) << "Ctor";
 }
 
@@ -45,10 +50,16 @@ void ClientSessionSystemInfo::onMessageReceived(const base::ByteArray& buffer)
         return;
     }
 
-    proto::system_info::SystemInfo system_info;
-    createSystemInfo(request, &system_info);
+    std::weak_ptr<int> lifetime = lifetime_;
 
-    sendMessage(base::serialize(system_info));
+    // The information is collected on the worker thread of the cache.
+    system_info_cache_->request(request, [this, lifetime](const base::ByteArray& system_info)
+    {
+        if (lifetime.expired())
+            return;
+
+        sendMessage(base::ByteArray(system_info));
+    });
 }
 
 void ClientSessionSystemInfo::onMessageWritten(size_t /* pending */)
@@ -24,10 +24,13 @@
 
 namespace host {
 
+class SystemInfoCache;
+
 class ClientSessionSystemInfo : public ClientSession
 {
 public:
-    explicit ClientSessionSystemInfo(std::unique_ptr<base::NetworkChannel> channel);
+    ClientSessionSystemInfo(std::unique_ptr<base::NetworkChannel> channel,
+                            std::shared_ptr<SystemInfoCache> system_info_cache);
     ~ClientSessionSystemInfo();
 
 protected:
@@ -39,6 +42,12 @@ protected:
     void onStarted() override;
 
 private:
+    std::shared_ptr<SystemInfoCache> system_info_cache_;
+
+    // Expires when the session is destroyed.
+    std::shared_ptr<int> lifetime_;
+
+    DISALLOW_COPY_AND_ASSIGN(ClientSessionSystemInfo);
 };
 
 } // namespace host
@@ -21,9 +21,12 @@
 
 #include "proto/desktop_internal.pb.h"
 
+#include <chrono>
+
 namespace base {
 class Frame;
 class MouseCursor;
+class Region;
 } // namespace base
 
 namespace host {
@@ -55,7 +58,10 @@ public:
         bool block_input = false;
         bool lock_at_disconnect = false;
         bool clear_clipboard = true;
+        bool clipboard = false;
         bool cursor_position = false;
+        bool audio = false;
+        uint32_t audio_frame_duration = 0; // In milliseconds.
 
         bool equals(const Config& other) const
         {
@@ -65,7 +71,10 @@ public:
                    (block_input == other.block_input) &&
                    (lock_at_disconnect == other.lock_at_disconnect) &&
                    (clear_clipboard == other.clear_clipboard) &&
-                   (cursor_position == other.cursor_position);
+                   (clipboard == other.clipboard) &&
+                   (cursor_position == other.cursor_position) &&
+                   (audio == other.audio) &&
+                   (audio_frame_duration == other.audio_frame_duration);
         }
     };
 
@@ -76,10 +85,18 @@ public:
     virtual void configure(const Config& config) = 0;
     virtual void selectScreen(const proto::Screen& screen) = 0;
     virtual void captureScreen() = 0;
+    virtual void setScreenCaptureInterval(const std::chrono::milliseconds& interval) = 0;
+
+    // Sets the bitrate of the audio encoder in bits per second.
+    virtual void setAudioBitrate(uint32_t bitrate) = 0;
+
+    // Passes the last captured frame to the delegate again with |region| as the updated region.
+    virtual void resendScreen(const base::Region& region) = 0;
 
     virtual void injectKeyEvent(const proto::KeyEvent& event) = 0;
     virtual void injectTextEvent(const proto::TextEvent& event) = 0;
     virtual void injectMouseEvent(const proto::MouseEvent& event) = 0;
+    virtual void injectInputEventBatch(const proto::InputEventBatch& batch) = 0;
     virtual void injectClipboardEvent(const proto::ClipboardEvent& event) = 0;
 
     static const char* controlActionToString(proto::internal::DesktopControl::Action action);
@@ -26,8 +26,9 @@
 #include "base/desktop/screen_capturer_wrapper.h"
 #include "base/desktop/shared_frame.h"
 #include "base/ipc/shared_memory.h"
+#include "base/waitable_timer.h"
+#include "base/strings/unicode.h"
 #include "base/threading/thread.h"
-#include "host/input_injector_win.h"
 #include "host/system_settings.h"
 
 namespace host {
@@ -126,28 +127,33 @@ void DesktopSessionAgent::onMessageReceived(const base::ByteArray& buffer)
 
     if (incoming_message->has_next_screen_capture())
     {
-        captureEnd(std::chrono::milliseconds(
-            incoming_message->next_screen_capture().update_interval()));
+        onNextScreenCapture(incoming_message->next_screen_capture());
     }
-    else if (incoming_message->has_mouse_event())
+    else if (incoming_message->has_mouse_event() || incoming_message->has_key_event() ||
+             incoming_message->has_text_event() || incoming_message->has_input_event_batch())
     {
+        // The service uses the main channel until the input channel is connected.
         if (input_injector_)
-            input_injector_->injectMouseEvent(incoming_message->mouse_event());
+            input_injector_->injectInput(*incoming_message);
     }
-    else if (incoming_message->has_key_event())
-    {
-        if (input_injector_)
-            input_injector_->injectKeyEvent(incoming_message->key_event());
-    }
-    else if (incoming_message->has_text_event())
+    else if (incoming_message->has_input_channel())
     {
+        LOG(LS_INFO) << "Input channel received";
+
+        input_channel_id_ = base::utf16FromUtf8(incoming_message->input_channel().channel_id());
         if (input_injector_)
-            input_injector_->injectTextEvent(incoming_message->text_event());
+            input_injector_->connectChannel(input_channel_id_);
     }
     else if (incoming_message->has_clipboard_event())
     {
-        if (clipboard_monitor_)
+        if (input_injector_)
+        {
+            // The client can send the clipboard before the configuration reaches us.
+            if (!clipboard_monitor_)
+                startClipboardMonitor();
+
             clipboard_monitor_->injectClipboardEvent(incoming_message->clipboard_event());
+        }
     }
     else if (incoming_message->has_select_source())
     {
@@ -177,7 +183,10 @@ void DesktopSessionAgent::onMessageReceived(const base::ByteArray& buffer)
         LOG(LS_INFO) << "Block input: " << config.block_input();
         LOG(LS_INFO) << "Lock at disconnect: " << config.lock_at_disconnect();
         LOG(LS_INFO) << "Clear clipboard: " << config.clear_clipboard();
+        LOG(LS_INFO) << "Clipboard: " << config.clipboard();
         LOG(LS_INFO) << "Cursor position: " << config.cursor_position();
+        LOG(LS_INFO) << "Audio: " << config.audio()
+                     << " (frame duration: " << config.audio_frame_duration() << " ms)";
 
         if (screen_capturer_)
         {
@@ -202,6 +211,31 @@ void DesktopSessionAgent::onMessageReceived(const base::ByteArray& buffer)
 
         lock_at_disconnect_ = config.lock_at_disconnect();
         clear_clipboard_ = config.clear_clipboard();
+        clipboard_enabled_ = config.clipboard();
+
+        // The monitor is kept once started: it is required to clear the clipboard at disconnect.
+        if (clipboard_enabled_ && input_injector_ && !clipboard_monitor_)
+            startClipboardMonitor();
+
+        const std::chrono::milliseconds audio_frame_duration(config.audio_frame_duration());
+
+        if (config.audio() != audio_enabled_ || audio_frame_duration != audio_frame_duration_)
+        {
+            audio_enabled_ = config.audio();
+            audio_frame_duration_ = audio_frame_duration;
+
+            // The capturer is restarted with the new settings.
+            audio_capturer_.reset();
+            if (input_injector_)
+                startAudioCapturer();
+        }
+    }
+    else if (incoming_message->has_audio_rate())
+    {
+        audio_bitrate_ = static_cast<int>(incoming_message->audio_rate().bitrate());
+
+        if (audio_capturer_)
+            audio_capturer_->setBitrate(audio_bitrate_);
     }
     else if (incoming_message->has_control())
     {
@@ -329,6 +363,26 @@ void DesktopSessionAgent::onScreenCaptured(
         serialized_frame->set_dpi_x(frame->dpi().x());
         serialized_frame->set_dpi_y(frame->dpi().y());
 
+        if (capture_start_time_ != std::chrono::steady_clock::time_point())
+        {
+            serialized_frame->set_capture_time(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    capture_start_time_.time_since_epoch()).count());
+            serialized_frame->set_capture_duration(static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - capture_start_time_).count()));
+            serialized_frame->set_diff_duration(
+                static_cast<uint32_t>(frame->constCaptureTiming().diff_duration));
+
+            if (input_count_)
+            {
+                serialized_frame->set_input_delay(
+                    static_cast<uint32_t>(input_delay_.count() / input_count_));
+                input_delay_ = std::chrono::microseconds(0);
+                input_count_ = 0;
+            }
+        }
+
         for (base::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
         {
             proto::Rect* dirty_rect = serialized_frame->add_dirty_rect();
@@ -339,6 +393,19 @@ void DesktopSessionAgent::onScreenCaptured(
             dirty_rect->set_width(rect.width());
             dirty_rect->set_height(rect.height());
         }
+
+        for (const base::Frame::MoveRect& move_rect : frame->constMoveRects())
+        {
+            proto::CopyRect* serialized_move_rect = serialized_frame->add_move_rect();
+            proto::Rect* dest_rect = serialized_move_rect->mutable_dest_rect();
+
+            serialized_move_rect->set_source_x(move_rect.source_pos.x());
+            serialized_move_rect->set_source_y(move_rect.source_pos.y());
+            dest_rect->set_x(move_rect.dest_rect.x());
+            dest_rect->set_y(move_rect.dest_rect.y());
+            dest_rect->set_width(move_rect.dest_rect.width());
+            dest_rect->set_height(move_rect.dest_rect.height());
+        }
     }
 
     if (mouse_cursor)
@@ -353,26 +420,65 @@ void DesktopSessionAgent::onScreenCaptured(
         serialized_mouse_cursor->set_data(base::toStdString(mouse_cursor->constImage()));
     }
 
-    if (screen_captured->has_frame() || screen_captured->has_mouse_cursor())
+    const bool has_changes = screen_captured->has_frame() || screen_captured->has_mouse_cursor();
+
+    if (message_in_flight_)
+    {
+        // The service is still reading the other frame buffer. The next capture would write to it,
+        // so we wait for the reply.
+        if (has_changes)
+            pending_message_ = base::serialize(*outgoing_message);
+
+        // The cursor position does not wait for the reply.
+        sendCursorPosition();
+
+        capture_waits_reply_ = true;
+        capture_scheduler_->endCapture(has_changes);
+        return;
+    }
+
+    if (has_changes)
     {
+        // The cursor position goes in the same message as the frame.
+        if (cursor_position_.has_value())
+        {
+            proto::CursorPosition* cursor_position = screen_captured->mutable_cursor_position();
+            cursor_position->set_x(cursor_position_->x());
+            cursor_position->set_y(cursor_position_->y());
+            cursor_position_.reset();
+        }
+
         channel_->send(base::serialize(*outgoing_message));
+        message_in_flight_ = true;
     }
     else
     {
-        captureEnd(capture_scheduler_->updateInterval());
+        sendCursorPosition();
     }
+
+    captureEnd(has_changes);
 }
 
 void DesktopSessionAgent::onCursorPositionChanged(const base::Point& position)
 {
-    proto::internal::DesktopToService* outgoing_message =
-        messageFromArena<proto::internal::DesktopToService>();
+    // The position is sent with the frame of the same capture in onScreenCaptured().
+    cursor_position_.emplace(position);
+}
 
-    proto::CursorPosition* cursor_position = outgoing_message->mutable_cursor_position();
-    cursor_position->set_x(position.x());
-    cursor_position->set_y(position.y());
+void DesktopSessionAgent::onScreenDamaged()
+{
+    // Called on the thread of the capturer.
+    std::weak_ptr<DesktopSessionAgent> self = weak_from_this();
 
-    channel_->send(base::serialize(*outgoing_message));
+    task_runner_->postTask([self]()
+    {
+        std::shared_ptr<DesktopSessionAgent> agent = self.lock();
+        if (!agent || !agent->capture_scheduler_)
+            return;
+
+        agent->capture_scheduler_->onDamage();
+        agent->wakeCapture();
+    });
 }
 
 void DesktopSessionAgent::onClipboardEvent(const proto::ClipboardEvent& event)
@@ -395,12 +501,12 @@ void DesktopSessionAgent::setEnabled(bool enable)
             return;
         }
 
-        input_injector_ = std::make_unique<InputInjectorWin>();
+        input_injector_ = std::make_unique<InputInjectorThread>();
+        input_injector_->start(task_runner_, this);
 
-        // A window is created to monitor the clipboard. We cannot create windows in the current
-        // thread. Create a separate thread.
-        clipboard_monitor_ = std::make_unique<common::ClipboardMonitor>();
-        clipboard_monitor_->start(task_runner_, this);
+        // The input channel is known if the session is enabled again.
+        if (!input_channel_id_.empty())
+            input_injector_->connectChannel(input_channel_id_);
 
         // Create a shared memory factory.
         // We will receive notifications of all creations and destruction of shared memory.
@@ -408,13 +514,18 @@ void DesktopSessionAgent::setEnabled(bool enable)
 
         capture_scheduler_ = std::make_unique<base::CaptureScheduler>(
             std::chrono::milliseconds(40));
+        capture_timer_ = std::make_unique<base::WaitableTimer>(
+            base::WaitableTimer::Type::SINGLE_SHOT, task_runner_);
 
         screen_capturer_ = std::make_unique<base::ScreenCapturerWrapper>(
             preferred_video_capturer_, this);
         screen_capturer_->setSharedMemoryFactory(shared_memory_factory_.get());
 
-        audio_capturer_ = std::make_unique<base::AudioCapturerWrapper>(channel_->channelProxy());
-        audio_capturer_->start();
+        // The clipboard monitor and the audio capturer have their own threads. They are started
+        // only if the clients need them so as not to delay the first frame.
+        if (clipboard_enabled_)
+            startClipboardMonitor();
+        startAudioCapturer();
 
         LOG(LS_INFO) << "Session successfully enabled";
 
@@ -431,13 +542,20 @@ void DesktopSessionAgent::setEnabled(bool enable)
             }
             else
             {
-                LOG(LS_WARNING) << "Clipboard monitor not present";
+                LOG(LS_INFO) << "Clipboard was not used in the session";
             }
 
             clear_clipboard_ = false;
         }
 
         input_injector_.reset();
+        input_delay_ = std::chrono::microseconds(0);
+        input_count_ = 0;
+        message_in_flight_ = false;
+        capture_waits_reply_ = false;
+        pending_message_.clear();
+        cursor_position_.reset();
+        capture_timer_.reset();
         capture_scheduler_.reset();
         screen_capturer_.reset();
         shared_memory_factory_.reset();
@@ -456,16 +574,99 @@ void DesktopSessionAgent::setEnabled(bool enable)
     }
 }
 
+void DesktopSessionAgent::startAudioCapturer()
+{
+    if (!audio_enabled_)
+    {
+        LOG(LS_INFO) << "Audio is not required by clients";
+        return;
+    }
+
+    audio_capturer_ = std::make_unique<base::AudioCapturerWrapper>(
+        channel_->channelProxy(), audio_frame_duration_, audio_bitrate_);
+    audio_capturer_->start();
+}
+
+void DesktopSessionAgent::startClipboardMonitor()
+{
+    LOG(LS_INFO) << "Starting clipboard monitor";
+
+    // A window is created to monitor the clipboard. We cannot create windows in the current
+    // thread. Create a separate thread.
+    clipboard_monitor_ = std::make_unique<common::ClipboardMonitor>();
+    clipboard_monitor_->start(task_runner_, this);
+}
+
+void DesktopSessionAgent::onNextScreenCapture(
+    const proto::internal::NextScreenCapture& next_screen_capture)
+{
+    if (!capture_scheduler_ || !capture_timer_)
+        return;
+
+    const std::chrono::milliseconds update_interval(next_screen_capture.update_interval());
+
+    if (!next_screen_capture.reply())
+    {
+        // A frame that is already in flight or waits for sending satisfies the request.
+        if (!message_in_flight_ && update_interval == std::chrono::milliseconds::zero())
+        {
+            // Capture immediately.
+            capture_timer_->start(std::chrono::milliseconds::zero(),
+                                  std::bind(&DesktopSessionAgent::captureBegin, this));
+        }
+        return;
+    }
+
+    if (update_interval != std::chrono::milliseconds::zero())
+        capture_scheduler_->setUpdateInterval(update_interval);
+
+    message_in_flight_ = false;
+
+    if (!capture_waits_reply_)
+    {
+        // The capture ahead is not finished yet. It is sent as soon as it ends.
+        return;
+    }
+
+    capture_waits_reply_ = false;
+
+    if (!pending_message_.empty())
+    {
+        channel_->send(std::move(pending_message_));
+        pending_message_.clear();
+        message_in_flight_ = true;
+    }
+
+    scheduleCapture();
+}
+
+void DesktopSessionAgent::sendCursorPosition()
+{
+    if (!cursor_position_.has_value())
+        return;
+
+    proto::internal::DesktopToService* outgoing_message =
+        messageFromArena<proto::internal::DesktopToService>();
+
+    proto::CursorPosition* cursor_position = outgoing_message->mutable_cursor_position();
+    cursor_position->set_x(cursor_position_->x());
+    cursor_position->set_y(cursor_position_->y());
+    cursor_position_.reset();
+
+    channel_->send(base::serialize(*outgoing_message));
+}
+
 void DesktopSessionAgent::captureBegin()
 {
     if (!capture_scheduler_ || !screen_capturer_)
         return;
 
     capture_scheduler_->beginCapture();
+    capture_start_time_ = std::chrono::steady_clock::now();
     screen_capturer_->captureFrame();
 }
 
-void DesktopSessionAgent::captureEnd(const std::chrono::milliseconds& update_interval)
+void DesktopSessionAgent::captureEnd(bool has_changes)
 {
     if (!capture_scheduler_)
     {
@@ -473,21 +674,39 @@ void DesktopSessionAgent::captureEnd(const std::chrono::milliseconds& update_int
         return;
     }
 
-    capture_scheduler_->endCapture();
+    capture_scheduler_->endCapture(has_changes);
+    scheduleCapture();
+}
 
-    if (update_interval == std::chrono::milliseconds::zero())
+void DesktopSessionAgent::scheduleCapture()
+{
+    // The timer belongs to the agent and is stopped when it is destroyed.
+    capture_timer_->start(capture_scheduler_->nextCaptureDelay(),
+                          std::bind(&DesktopSessionAgent::captureBegin, this));
+}
+
+void DesktopSessionAgent::wakeCapture()
+{
+    // If the capture is in progress, the scheduler takes the event into account when it ends.
+    if (!capture_timer_ || !capture_timer_->isActive())
+        return;
+
+    scheduleCapture();
+}
+
+void DesktopSessionAgent::onInputInjected(std::chrono::microseconds delay)
+{
+    if (delay.count() > 0)
     {
-        // Capture immediately.
-        task_runner_->postTask(std::bind(&DesktopSessionAgent::captureBegin, shared_from_this()));
+        input_delay_ += delay;
+        ++input_count_;
     }
-    else
-    {
-        capture_scheduler_->setUpdateInterval(update_interval);
 
-        task_runner_->postDelayedTask(
-            std::bind(&DesktopSessionAgent::captureBegin, shared_from_this()),
-            capture_scheduler_->nextCaptureDelay());
-    }
+    if (!capture_scheduler_)
+        return;
+
+    capture_scheduler_->onInputEvent();
+    wakeCapture();
 }
 
 } // namespace host
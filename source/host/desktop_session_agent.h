@@ -24,27 +24,31 @@
 #include "base/ipc/ipc_channel.h"
 #include "base/ipc/shared_memory_factory.h"
 #include "common/clipboard_monitor.h"
+#include "host/input_injector_thread.h"
 #include "proto/desktop_internal.pb.h"
 
+#include <chrono>
+#include <optional>
+
 namespace base {
 class AudioCapturerWrapper;
 class CaptureScheduler;
 class TaskRunner;
 class Thread;
+class WaitableTimer;
 class SharedFrame;
 } // namespace base
 
 namespace host {
 
-class InputInjector;
-
 class DesktopSessionAgent
     : public base::ProtobufArena,
       public std::enable_shared_from_this<DesktopSessionAgent>,
       public base::IpcChannel::Listener,
       public base::SharedMemoryFactory::Delegate,
       public base::ScreenCapturerWrapper::Delegate,
-      public common::Clipboard::Delegate
+      public common::Clipboard::Delegate,
+      public InputInjectorThread::Delegate
 {
 public:
     explicit DesktopSessionAgent(std::shared_ptr<base::TaskRunner> task_runner);
@@ -67,28 +71,61 @@ protected:
     void onScreenCaptured(const base::Frame* frame,
                           const base::MouseCursor* mouse_cursor) override;
     void onCursorPositionChanged(const base::Point& position) override;
+    void onScreenDamaged() override;
 
     // common::Clipboard::Delegate implementation.
     void onClipboardEvent(const proto::ClipboardEvent& event) override;
 
+    // InputInjectorThread::Delegate implementation.
+    void onInputInjected(std::chrono::microseconds delay) override;
+
 private:
     void setEnabled(bool enable);
+    void startAudioCapturer();
+    void startClipboardMonitor();
+    void onNextScreenCapture(const proto::internal::NextScreenCapture& next_screen_capture);
+    void sendCursorPosition();
     void captureBegin();
-    void captureEnd(const std::chrono::milliseconds& update_interval);
+    void captureEnd(bool has_changes);
+    void scheduleCapture();
+    void wakeCapture();
 
     std::shared_ptr<base::TaskRunner> task_runner_;
 
     std::unique_ptr<base::IpcChannel> channel_;
     std::unique_ptr<common::ClipboardMonitor> clipboard_monitor_;
-    std::unique_ptr<InputInjector> input_injector_;
+    std::unique_ptr<InputInjectorThread> input_injector_;
+    std::u16string input_channel_id_;
+
+    // The delays of the input events injected since the last captured frame.
+    std::chrono::microseconds input_delay_ { 0 };
+    int input_count_ = 0;
 
     std::unique_ptr<base::SharedMemoryFactory> shared_memory_factory_;
     std::unique_ptr<base::CaptureScheduler> capture_scheduler_;
+    std::unique_ptr<base::WaitableTimer> capture_timer_;
     std::unique_ptr<base::ScreenCapturerWrapper> screen_capturer_;
+
+    // Start of the current capture. Sent with the frame to measure the latency of the frames.
+    std::chrono::steady_clock::time_point capture_start_time_;
     std::unique_ptr<base::AudioCapturerWrapper> audio_capturer_;
 
+    // The capture of the next frame goes while the service processes the previous one. The
+    // capturer has two frame buffers, so only one capture can be made ahead. Its result waits in
+    // |pending_message_| until the service replies to the message in flight.
+    bool message_in_flight_ = false;
+    bool capture_waits_reply_ = false;
+    base::ByteArray pending_message_;
+
+    // The cursor position of the current capture.
+    std::optional<base::Point> cursor_position_;
+
     base::ScreenCapturer::Type preferred_video_capturer_ = base::ScreenCapturer::Type::DEFAULT;
     bool lock_at_disconnect_ = false;
+    bool audio_enabled_ = false;
+    bool clipboard_enabled_ = false;
+    std::chrono::milliseconds audio_frame_duration_ { 0 };
+    int audio_bitrate_ = 0; // The default bitrate of the encoder is used until it is set.
     bool clear_clipboard_ = false;
 
     DISALLOW_COPY_AND_ASSIGN(DesktopSessionAgent);
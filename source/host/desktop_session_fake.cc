@@ -18,17 +18,22 @@
 
 #include "host/desktop_session_fake.h"
 
+#include "base/environment.h"
 #include "base/logging.h"
 #include "base/task_runner.h"
+#include "base/desktop/frame_dump.h"
 #include "base/desktop/frame_simple.h"
 #include "base/desktop/screen_capturer.h"
 
+#include <algorithm>
+
 namespace host {
 
 namespace {
 
 const int kFrameWidth = 800;
 const int kFrameHeight = 600;
+const std::chrono::milliseconds kFrameInterval { 1000 };
 
 } // namespace
 
@@ -43,12 +48,20 @@ public:
     void generateFrame();
 
 private:
+    void onFrameTimer();
+    const base::Frame* nextFrame();
 
     Delegate* delegate_ = nullptr;
 
     std::shared_ptr<base::TaskRunner> task_runner_;
     std::unique_ptr<base::Frame> frame_;
 
+    // If the ASPIA_FRAME_REPLAY environment variable contains the path of a frame dump, the
+    // recorded frames are played in a loop with the recorded intervals instead of the black frame.
+    std::unique_ptr<base::FrameDumpReader> frame_dump_;
+    std::chrono::microseconds last_timestamp_ { 0 };
+    std::chrono::milliseconds next_interval_ = kFrameInterval;
+
     DISALLOW_COPY_AND_ASSIGN(FrameGenerator);
 };
 
@@ -73,6 +86,14 @@ DesktopSessionFake::FrameGenerator::FrameGenerator(std::shared_ptr<base::TaskRun
 
     frame_->setCapturerType(static_cast<uint32_t>(base::ScreenCapturer::Type::FAKE));
     frame_->setDpi(base::Point(96, 96));
+
+    std::string dump_file;
+    if (base::Environment::get("ASPIA_FRAME_REPLAY", &dump_file) && !dump_file.empty())
+    {
+        frame_dump_ = base::FrameDumpReader::open(std::filesystem::u8path(dump_file));
+        if (frame_dump_)
+            LOG(LS_INFO) << "Frames are replayed from: " << dump_file;
+    }
 }
 
 DesktopSessionFake::FrameGenerator::~FrameGenerator()
@@ -87,7 +108,7 @@ void DesktopSessionFake::FrameGenerator::start(Delegate* delegate)
     delegate_ = delegate;
     DCHECK(delegate);
 
-    generateFrame();
+    onFrameTimer();
 }
 
 void DesktopSessionFake::FrameGenerator::stop()
@@ -98,29 +119,71 @@ void DesktopSessionFake::FrameGenerator::stop()
 
 void DesktopSessionFake::FrameGenerator::generateFrame()
 {
-    if (!frame_)
+    if (!delegate_)
+        return;
+
+    const base::Frame* frame = nextFrame();
+    if (!frame)
     {
         LOG(LS_ERROR) << "No frame generated";
         return;
     }
 
-    base::Region* updated_region = frame_->updatedRegion();
-    updated_region->clear();
-    updated_region->addRect(base::Rect::makeWH(kFrameWidth, kFrameHeight));
-
-    if (delegate_)
-    {
-        delegate_->onScreenCaptured(frame_.get(), nullptr);
+    delegate_->onScreenCaptured(frame, nullptr);
+}
 
-        task_runner_->postDelayedTask(
-            std::bind(&FrameGenerator::generateFrame, shared_from_this()),
-            std::chrono::milliseconds(1000));
-    }
-    else
+void DesktopSessionFake::FrameGenerator::onFrameTimer()
+{
+    if (!delegate_)
     {
         LOG(LS_INFO) << "Reset desktop frame";
         frame_.reset();
+        frame_dump_.reset();
+        return;
     }
+
+    generateFrame();
+
+    task_runner_->postDelayedTask(
+        std::bind(&FrameGenerator::onFrameTimer, shared_from_this()), next_interval_);
+}
+
+const base::Frame* DesktopSessionFake::FrameGenerator::nextFrame()
+{
+    if (frame_dump_)
+    {
+        const base::Frame* frame = frame_dump_->nextFrame();
+        if (!frame && frame_dump_->rewind())
+        {
+            // The first frame of the dump is whole, the sequence starts over.
+            last_timestamp_ = std::chrono::microseconds::zero();
+            frame = frame_dump_->nextFrame();
+        }
+
+        if (frame)
+        {
+            // The next frame comes after the interval that preceded this one in the recording.
+            next_interval_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+                frame_dump_->timestamp() - last_timestamp_);
+            next_interval_ = std::clamp(next_interval_, std::chrono::milliseconds(1),
+                                        kFrameInterval);
+            last_timestamp_ = frame_dump_->timestamp();
+            return frame;
+        }
+
+        LOG(LS_ERROR) << "Unable to read frame dump";
+        frame_dump_.reset();
+        next_interval_ = kFrameInterval;
+    }
+
+    if (!frame_)
+        return nullptr;
+
+    base::Region* updated_region = frame_->updatedRegion();
+    updated_region->clear();
+    updated_region->addRect(base::Rect::makeWH(kFrameWidth, kFrameHeight));
+
+    return frame_.get();
 }
 
 DesktopSessionFake::DesktopSessionFake(
@@ -194,6 +257,22 @@ void DesktopSessionFake::captureScreen()
     frame_generator_->generateFrame();
 }
 
+void DesktopSessionFake::setScreenCaptureInterval(
+    const std::chrono::milliseconds& /* interval */)
+{
+    // Nothing
+}
+
+void DesktopSessionFake::setAudioBitrate(uint32_t /* bitrate */)
+{
+    // Nothing
+}
+
+void DesktopSessionFake::resendScreen(const base::Region& /* region */)
+{
+    // Nothing
+}
+
 void DesktopSessionFake::injectKeyEvent(const proto::KeyEvent& /* event */)
 {
     // Nothing
@@ -209,6 +288,11 @@ void DesktopSessionFake::injectMouseEvent(const proto::MouseEvent& /* event */)
     // Nothing
 }
 
+void DesktopSessionFake::injectInputEventBatch(const proto::InputEventBatch& /* batch */)
+{
+    // Nothing
+}
+
 void DesktopSessionFake::injectClipboardEvent(const proto::ClipboardEvent& /* event */)
 {
     // Nothing
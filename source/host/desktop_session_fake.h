@@ -41,9 +41,13 @@ public:
     void configure(const Config& config) override;
     void selectScreen(const proto::Screen& screen) override;
     void captureScreen() override;
+    void setScreenCaptureInterval(const std::chrono::milliseconds& interval) override;
+    void setAudioBitrate(uint32_t bitrate) override;
+    void resendScreen(const base::Region& region) override;
     void injectKeyEvent(const proto::KeyEvent& event) override;
     void injectTextEvent(const proto::TextEvent& event) override;
     void injectMouseEvent(const proto::MouseEvent& event) override;
+    void injectInputEventBatch(const proto::InputEventBatch& batch) override;
     void injectClipboardEvent(const proto::ClipboardEvent& event) override;
 
 private:
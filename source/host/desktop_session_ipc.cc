@@ -19,6 +19,8 @@
 #include "host/desktop_session_ipc.h"
 
 #include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/strings/unicode.h"
 #include "base/desktop/mouse_cursor.h"
 #include "base/desktop/shared_memory_frame.h"
 #include "base/ipc/shared_memory.h"
@@ -70,8 +72,9 @@ private:
 
 DesktopSessionIpc::DesktopSessionIpc(std::unique_ptr<base::IpcChannel> channel,
                                      std::shared_ptr<base::TaskRunner> task_runner,
-                                     Delegate* delegate)
-    : base::ProtobufArena(std::move(task_runner)),
+                                     DesktopSession::Delegate* delegate)
+    : base::ProtobufArena(task_runner),
+      task_runner_(std::move(task_runner)),
       channel_(std::move(channel)),
       delegate_(delegate)
 {
@@ -102,6 +105,8 @@ void DesktopSessionIpc::start()
     channel_->setListener(this);
     channel_->resume();
 
+    startInputChannel();
+
     delegate_->onDesktopSessionStarted();
 }
 
@@ -135,7 +140,10 @@ void DesktopSessionIpc::configure(const Config& config)
     configure->set_block_input(config.block_input);
     configure->set_lock_at_disconnect(config.lock_at_disconnect);
     configure->set_clear_clipboard(config.clear_clipboard);
+    configure->set_clipboard(config.clipboard);
     configure->set_cursor_position(config.cursor_position);
+    configure->set_audio(config.audio);
+    configure->set_audio_frame_duration(config.audio_frame_duration);
 
     channel_->send(base::serialize(*outgoing_message));
 }
@@ -155,6 +163,10 @@ void DesktopSessionIpc::captureScreen()
     if (last_frame_)
     {
         last_frame_->updatedRegion()->addRect(base::Rect::makeSize(last_frame_->size()));
+        last_frame_->moveRects()->clear();
+
+        // The frame is sent again, the time of its capture would distort the latency.
+        *last_frame_->captureTiming() = base::Frame::CaptureTiming();
 
         if (delegate_)
         {
@@ -184,21 +196,57 @@ void DesktopSessionIpc::captureScreen()
     }
 }
 
+void DesktopSessionIpc::setScreenCaptureInterval(const std::chrono::milliseconds& interval)
+{
+    // The interval is sent to the desktop agent with the next capture request.
+    capture_interval_ = interval;
+}
+
+void DesktopSessionIpc::setAudioBitrate(uint32_t bitrate)
+{
+    if (bitrate == audio_bitrate_)
+        return;
+
+    audio_bitrate_ = bitrate;
+
+    proto::internal::ServiceToDesktop* outgoing_message =
+        messageFromArena<proto::internal::ServiceToDesktop>();
+    outgoing_message->mutable_audio_rate()->set_bitrate(bitrate);
+    channel_->send(base::serialize(*outgoing_message));
+}
+
+void DesktopSessionIpc::resendScreen(const base::Region& region)
+{
+    if (!last_frame_ || !delegate_)
+        return;
+
+    base::Region* updated_region = last_frame_->updatedRegion();
+    updated_region->clear();
+    updated_region->addRegion(region);
+    updated_region->intersectWith(base::Rect::makeSize(last_frame_->size()));
+    last_frame_->moveRects()->clear();
+    *last_frame_->captureTiming() = base::Frame::CaptureTiming();
+
+    if (updated_region->isEmpty())
+        return;
+
+    delegate_->onScreenCaptured(last_frame_.get(), nullptr);
+}
+
 void DesktopSessionIpc::injectKeyEvent(const proto::KeyEvent& event)
 {
     proto::internal::ServiceToDesktop* outgoing_message =
         messageFromArena<proto::internal::ServiceToDesktop>();
     outgoing_message->mutable_key_event()->CopyFrom(event);
-    channel_->send(base::serialize(*outgoing_message));
+    sendInput(outgoing_message);
 }
 
 void DesktopSessionIpc::injectTextEvent(const proto::TextEvent& event)
 {
     proto::internal::ServiceToDesktop* outgoing_message =
         messageFromArena<proto::internal::ServiceToDesktop>();
-
     outgoing_message->mutable_text_event()->CopyFrom(event);
-    channel_->send(base::serialize(*outgoing_message));
+    sendInput(outgoing_message);
 }
 
 void DesktopSessionIpc::injectMouseEvent(const proto::MouseEvent& event)
@@ -206,7 +254,15 @@ void DesktopSessionIpc::injectMouseEvent(const proto::MouseEvent& event)
     proto::internal::ServiceToDesktop* outgoing_message =
         messageFromArena<proto::internal::ServiceToDesktop>();
     outgoing_message->mutable_mouse_event()->CopyFrom(event);
-    channel_->send(base::serialize(*outgoing_message));
+    sendInput(outgoing_message);
+}
+
+void DesktopSessionIpc::injectInputEventBatch(const proto::InputEventBatch& batch)
+{
+    proto::internal::ServiceToDesktop* outgoing_message =
+        messageFromArena<proto::internal::ServiceToDesktop>();
+    outgoing_message->mutable_input_event_batch()->CopyFrom(batch);
+    sendInput(outgoing_message);
 }
 
 void DesktopSessionIpc::injectClipboardEvent(const proto::ClipboardEvent& event)
@@ -293,6 +349,29 @@ void DesktopSessionIpc::onMessageReceived(const base::ByteArray& buffer)
     }
 }
 
+void DesktopSessionIpc::onNewConnection(std::unique_ptr<base::IpcChannel> channel)
+{
+    // Only the desktop process of this session can connect the input channel.
+    if (channel->peerProcessId() != channel_->peerProcessId())
+    {
+        LOG(LS_ERROR) << "Input channel connected from an unknown process";
+        return;
+    }
+
+    LOG(LS_INFO) << "Input channel connected";
+
+    // The desktop process connects again when the session is enabled again.
+    input_channel_ = std::move(channel);
+}
+
+void DesktopSessionIpc::onErrorOccurred()
+{
+    LOG(LS_WARNING) << "Error in the input channel server";
+
+    // Without the server the input goes over the main channel when the input channel is closed.
+    task_runner_->deleteSoon(std::move(input_server_));
+}
+
 void DesktopSessionIpc::onScreenCaptured(const proto::internal::ScreenCaptured& screen_captured)
 {
     const base::Frame* frame = nullptr;
@@ -315,6 +394,12 @@ void DesktopSessionIpc::onScreenCaptured(const proto::internal::ScreenCaptured&
             last_frame_->setDpi(base::Point(
                 serialized_frame.dpi_x(), serialized_frame.dpi_y()));
 
+            base::Frame::CaptureTiming* capture_timing = last_frame_->captureTiming();
+            capture_timing->capture_time = serialized_frame.capture_time();
+            capture_timing->capture_duration = serialized_frame.capture_duration();
+            capture_timing->diff_duration = serialized_frame.diff_duration();
+            capture_timing->input_delay = serialized_frame.input_delay();
+
             base::Region* updated_region = last_frame_->updatedRegion();
 
             for (int i = 0; i < serialized_frame.dirty_rect_size(); ++i)
@@ -324,6 +409,19 @@ void DesktopSessionIpc::onScreenCaptured(const proto::internal::ScreenCaptured&
                     dirty_rect.x(), dirty_rect.y(), dirty_rect.width(), dirty_rect.height()));
             }
 
+            std::vector<base::Frame::MoveRect>* move_rects = last_frame_->moveRects();
+
+            for (int i = 0; i < serialized_frame.move_rect_size(); ++i)
+            {
+                const proto::CopyRect& move_rect = serialized_frame.move_rect(i);
+                const proto::Rect& dest_rect = move_rect.dest_rect();
+
+                move_rects->push_back(base::Frame::MoveRect {
+                    base::Point(move_rect.source_x(), move_rect.source_y()),
+                    base::Rect::makeXYWH(
+                        dest_rect.x(), dest_rect.y(), dest_rect.width(), dest_rect.height()) });
+            }
+
             frame = last_frame_.get();
         }
     }
@@ -353,9 +451,16 @@ void DesktopSessionIpc::onScreenCaptured(const proto::internal::ScreenCaptured&
         LOG(LS_WARNING) << "Invalid delegate";
     }
 
+    // The agent sends the cursor position with the frame of the same capture.
+    if (screen_captured.has_cursor_position())
+        onCursorPositionChanged(screen_captured.cursor_position());
+
     proto::internal::ServiceToDesktop* outgoing_message =
         messageFromArena<proto::internal::ServiceToDesktop>();
-    outgoing_message->mutable_next_screen_capture()->set_update_interval(40);
+    proto::internal::NextScreenCapture* next_screen_capture =
+        outgoing_message->mutable_next_screen_capture();
+    next_screen_capture->set_update_interval(static_cast<uint32_t>(capture_interval_.count()));
+    next_screen_capture->set_reply(true);
     channel_->send(base::serialize(*outgoing_message));
 }
 
@@ -425,4 +530,33 @@ std::unique_ptr<DesktopSessionIpc::SharedBuffer> DesktopSessionIpc::sharedBuffer
     return result->second->share();
 }
 
+void DesktopSessionIpc::startInputChannel()
+{
+    std::u16string channel_id = base::IpcServer::createUniqueId();
+
+    input_server_ = std::make_unique<base::IpcServer>();
+    if (!input_server_->start(channel_id, this))
+    {
+        LOG(LS_WARNING) << "Failed to start the input channel server";
+        input_server_.reset();
+        return;
+    }
+
+    proto::internal::ServiceToDesktop* outgoing_message =
+        messageFromArena<proto::internal::ServiceToDesktop>();
+    outgoing_message->mutable_input_channel()->set_channel_id(base::utf8FromUtf16(channel_id));
+    channel_->send(base::serialize(*outgoing_message));
+}
+
+void DesktopSessionIpc::sendInput(proto::internal::ServiceToDesktop* message)
+{
+    message->set_input_time(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+
+    if (input_channel_ && input_channel_->isConnected())
+        input_channel_->send(base::serialize(*message));
+    else
+        channel_->send(base::serialize(*message));
+}
+
 } // namespace host
@@ -21,6 +21,7 @@
 
 #include "base/protobuf_arena.h"
 #include "base/ipc/ipc_channel.h"
+#include "base/ipc/ipc_server.h"
 #include "host/desktop_session.h"
 
 namespace host {
@@ -28,12 +29,13 @@ namespace host {
 class DesktopSessionIpc
     : public base::ProtobufArena,
       public DesktopSession,
-      public base::IpcChannel::Listener
+      public base::IpcChannel::Listener,
+      public base::IpcServer::Delegate
 {
 public:
     DesktopSessionIpc(std::unique_ptr<base::IpcChannel> channel,
                       std::shared_ptr<base::TaskRunner> task_runner,
-                      Delegate* delegate);
+                      DesktopSession::Delegate* delegate);
     ~DesktopSessionIpc() override;
 
     // DesktopSession implementation.
@@ -43,9 +45,13 @@ public:
     void configure(const Config& config) override;
     void selectScreen(const proto::Screen& screen) override;
     void captureScreen() override;
+    void setScreenCaptureInterval(const std::chrono::milliseconds& interval) override;
+    void setAudioBitrate(uint32_t bitrate) override;
+    void resendScreen(const base::Region& region) override;
     void injectKeyEvent(const proto::KeyEvent& event) override;
     void injectTextEvent(const proto::TextEvent& event) override;
     void injectMouseEvent(const proto::MouseEvent& event) override;
+    void injectInputEventBatch(const proto::InputEventBatch& batch) override;
     void injectClipboardEvent(const proto::ClipboardEvent& event) override;
 
 protected:
@@ -53,6 +59,10 @@ protected:
     void onDisconnected() override;
     void onMessageReceived(const base::ByteArray& buffer) override;
 
+    // base::IpcServer::Delegate implementation.
+    void onNewConnection(std::unique_ptr<base::IpcChannel> channel) override;
+    void onErrorOccurred() override;
+
 private:
     class SharedBuffer;
     using SharedBuffers = std::map<int, std::unique_ptr<SharedBuffer>>;
@@ -63,13 +73,23 @@ private:
     void onCreateSharedBuffer(int shared_buffer_id);
     void onReleaseSharedBuffer(int shared_buffer_id);
     std::unique_ptr<SharedBuffer> sharedBuffer(int shared_buffer_id);
+    void startInputChannel();
+    void sendInput(proto::internal::ServiceToDesktop* message);
 
+    std::shared_ptr<base::TaskRunner> task_runner_;
     std::unique_ptr<base::IpcChannel> channel_;
+
+    // The input events are sent over a separate channel, which the desktop process reads on its
+    // own thread. Until it is connected, the events are sent over the main channel.
+    std::unique_ptr<base::IpcServer> input_server_;
+    std::unique_ptr<base::IpcChannel> input_channel_;
     SharedBuffers shared_buffers_;
     std::unique_ptr<base::Frame> last_frame_;
     std::unique_ptr<base::MouseCursor> last_mouse_cursor_;
     std::unique_ptr<proto::ScreenList> last_screen_list_;
-    Delegate* delegate_;
+    DesktopSession::Delegate* delegate_;
+    std::chrono::milliseconds capture_interval_ { 40 };
+    uint32_t audio_bitrate_ = 0;
 
     DISALLOW_COPY_AND_ASSIGN(DesktopSessionIpc);
 };
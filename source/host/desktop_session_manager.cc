@@ -30,11 +30,110 @@
 
 namespace host {
 
+namespace {
+
+// The spare process is started when the attached one has finished its startup.
+const std::chrono::seconds kSpareProcessDelay { 10 };
+
+} // namespace
+
+class DesktopSessionManager::SpareProcess
+    : public base::IpcServer::Delegate,
+      public base::IpcChannel::Listener
+{
+public:
+    SpareProcess(std::shared_ptr<base::TaskRunner> task_runner, base::SessionId session_id)
+        : task_runner_(std::move(task_runner)),
+          session_id_(session_id)
+    {
+        // Nothing
+    }
+
+    ~SpareProcess() override
+    {
+        if (server_)
+            server_->stop();
+    }
+
+    bool start()
+    {
+        std::u16string channel_id = base::IpcServer::createUniqueId();
+
+        server_ = std::make_unique<base::IpcServer>();
+        if (!server_->start(channel_id, this))
+        {
+            LOG(LS_ERROR) << "Failed to start IPC server for spare process";
+            return false;
+        }
+
+        if (!DesktopSessionProcess::create(session_id_, channel_id))
+        {
+            LOG(LS_ERROR) << "Failed to create spare session process";
+            return false;
+        }
+
+        return true;
+    }
+
+    base::SessionId sessionId() const { return session_id_; }
+
+    // Returns the channel of the connected process or nullptr if the process is not connected.
+    std::unique_ptr<base::IpcChannel> takeChannel() { return std::move(channel_); }
+
+protected:
+    // base::IpcServer::Delegate implementation.
+    void onNewConnection(std::unique_ptr<base::IpcChannel> channel) override
+    {
+        if (DesktopSessionProcess::filePath() != channel->peerFilePath())
+        {
+            LOG(LS_ERROR) << "An attempt was made to connect from an unknown application";
+            return;
+        }
+
+        LOG(LS_INFO) << "Spare session process connected";
+
+        server_->stop();
+        task_runner_->deleteSoon(std::move(server_));
+
+        // The channel is read to find out if the process has ended. The process does nothing
+        // until the session is enabled.
+        channel_ = std::move(channel);
+        channel_->setListener(this);
+        channel_->resume();
+    }
+
+    void onErrorOccurred() override
+    {
+        LOG(LS_WARNING) << "IPC server error for spare process";
+    }
+
+    // base::IpcChannel::Listener implementation.
+    void onDisconnected() override
+    {
+        LOG(LS_INFO) << "Spare session process disconnected";
+        task_runner_->deleteSoon(std::move(channel_));
+    }
+
+    void onMessageReceived(const base::ByteArray& /* buffer */) override
+    {
+        LOG(LS_WARNING) << "Unexpected message from spare session process";
+    }
+
+private:
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    const base::SessionId session_id_;
+    std::unique_ptr<base::IpcServer> server_;
+    std::unique_ptr<base::IpcChannel> channel_;
+
+    DISALLOW_COPY_AND_ASSIGN(SpareProcess);
+};
+
 DesktopSessionManager::DesktopSessionManager(
     std::shared_ptr<base::TaskRunner> task_runner, DesktopSession::Delegate* delegate)
     : task_runner_(task_runner),
       session_proxy_(std::make_shared<DesktopSessionProxy>()),
       session_attach_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner),
+      spare_process_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner),
       delegate_(delegate)
 {
     LOG(LS_INFO) << "Ctor";
@@ -71,6 +170,10 @@ void DesktopSessionManager::attachSession(
     }
 
     setState(FROM_HERE, State::STARTING);
+    session_id_ = session_id;
+
+    if (attachSpareProcess(session_id))
+        return;
 
     std::u16string channel_id = base::IpcServer::createUniqueId();
 
@@ -117,7 +220,11 @@ void DesktopSessionManager::dettachSession(const base::Location& location)
     LOG(LS_INFO) << "Session process is detached";
 
     if (state_ == State::STOPPING)
+    {
+        spare_process_timer_.stop();
+        task_runner_->deleteSoon(std::move(spare_process_));
         return;
+    }
 
     session_attach_timer_.start(std::chrono::minutes(1), [this]()
     {
@@ -154,10 +261,7 @@ void DesktopSessionManager::onNewConnection(std::unique_ptr<base::IpcChannel> ch
         task_runner_->deleteSoon(std::move(server_));
     }
 
-    session_ = std::make_unique<DesktopSessionIpc>(std::move(channel), task_runner_, this);
-
-    setState(FROM_HERE, State::ATTACHED);
-    session_proxy_->attachAndStart(session_.get());
+    attachChannel(std::move(channel));
 }
 
 void DesktopSessionManager::onErrorOccurred()
@@ -178,6 +282,10 @@ void DesktopSessionManager::onDesktopSessionStarted()
 void DesktopSessionManager::onDesktopSessionStopped()
 {
     dettachSession(FROM_HERE);
+
+    // The session still exists if the spare process is running in it.
+    if (state_ == State::DETACHED && attachSpareProcess(session_id_))
+        session_attach_timer_.stop();
 }
 
 void DesktopSessionManager::onScreenCaptured(
@@ -213,6 +321,62 @@ void DesktopSessionManager::setState(const base::Location& location, State state
     state_ = state;
 }
 
+void DesktopSessionManager::attachChannel(std::unique_ptr<base::IpcChannel> channel)
+{
+    session_ = std::make_unique<DesktopSessionIpc>(std::move(channel), task_runner_, this);
+
+    setState(FROM_HERE, State::ATTACHED);
+    session_proxy_->attachAndStart(session_.get());
+
+    spare_process_timer_.start(kSpareProcessDelay, [this]()
+    {
+        startSpareProcess();
+    });
+}
+
+bool DesktopSessionManager::attachSpareProcess(base::SessionId session_id)
+{
+    if (!spare_process_)
+        return false;
+
+    std::unique_ptr<base::IpcChannel> channel;
+    if (spare_process_->sessionId() == session_id)
+        channel = spare_process_->takeChannel();
+
+    // The spare process is used only once. It also ends if the session has changed.
+    task_runner_->deleteSoon(std::move(spare_process_));
+
+    if (!channel)
+        return false;
+
+    LOG(LS_INFO) << "Spare session process is used";
+
+    if (server_)
+    {
+        server_->stop();
+        task_runner_->deleteSoon(std::move(server_));
+    }
+
+    session_attach_timer_.stop();
+    session_proxy_->stopAndDettach();
+    task_runner_->deleteSoon(std::move(session_));
+
+    attachChannel(std::move(channel));
+    return true;
+}
+
+void DesktopSessionManager::startSpareProcess()
+{
+    if (state_ != State::ATTACHED || spare_process_)
+        return;
+
+    LOG(LS_INFO) << "Starting spare session process";
+
+    spare_process_ = std::make_unique<SpareProcess>(task_runner_, session_id_);
+    if (!spare_process_->start())
+        task_runner_->deleteSoon(std::move(spare_process_));
+}
+
 // static
 const char* DesktopSessionManager::stateToString(State state)
 {
@@ -65,15 +65,27 @@ protected:
     void onClipboardEvent(const proto::ClipboardEvent& event) override;
 
 private:
+    class SpareProcess;
+
     enum class State { STOPPED, STARTING, STOPPING, DETACHED, ATTACHED };
     void setState(const base::Location& location, State state);
     static const char* stateToString(State state);
 
+    void attachChannel(std::unique_ptr<base::IpcChannel> channel);
+    bool attachSpareProcess(base::SessionId session_id);
+    void startSpareProcess();
+
     std::shared_ptr<base::TaskRunner> task_runner_;
     std::unique_ptr<base::IpcServer> server_;
     std::unique_ptr<DesktopSession> session_;
     std::shared_ptr<DesktopSessionProxy> session_proxy_;
     base::WaitableTimer session_attach_timer_;
+    base::SessionId session_id_ = base::kInvalidSessionId;
+
+    // The next desktop agent is started in advance, so attaching to the session does not wait
+    // for the process to start.
+    std::unique_ptr<SpareProcess> spare_process_;
+    base::WaitableTimer spare_process_timer_;
 
     State state_ = State::STOPPED;
     DesktopSession::Delegate* delegate_;
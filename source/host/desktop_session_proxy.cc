@@ -62,6 +62,27 @@ void DesktopSessionProxy::captureScreen()
         desktop_session_->captureScreen();
 }
 
+void DesktopSessionProxy::setScreenCaptureInterval(const std::chrono::milliseconds& interval)
+{
+    if (desktop_session_)
+        desktop_session_->setScreenCaptureInterval(interval);
+}
+
+void DesktopSessionProxy::setAudioBitrate(uint32_t bitrate)
+{
+    if (desktop_session_)
+        desktop_session_->setAudioBitrate(bitrate);
+}
+
+void DesktopSessionProxy::resendScreen(const base::Region& region)
+{
+    if (is_paused_)
+        return;
+
+    if (desktop_session_)
+        desktop_session_->resendScreen(region);
+}
+
 void DesktopSessionProxy::injectKeyEvent(const proto::KeyEvent& event)
 {
     if (is_keyboard_locked_ || is_paused_)
@@ -89,6 +110,34 @@ void DesktopSessionProxy::injectMouseEvent(const proto::MouseEvent& event)
         desktop_session_->injectMouseEvent(event);
 }
 
+void DesktopSessionProxy::injectInputEventBatch(const proto::InputEventBatch& batch)
+{
+    if (is_paused_ || !desktop_session_)
+        return;
+
+    if (!is_mouse_locked_ && !is_keyboard_locked_)
+    {
+        desktop_session_->injectInputEventBatch(batch);
+        return;
+    }
+
+    // Remove the events of the locked devices.
+    proto::InputEventBatch filtered_batch;
+
+    for (int i = 0; i < batch.event_size(); ++i)
+    {
+        const proto::InputEvent& event = batch.event(i);
+
+        if (event.has_mouse_event() ? is_mouse_locked_ : is_keyboard_locked_)
+            continue;
+
+        filtered_batch.add_event()->CopyFrom(event);
+    }
+
+    if (filtered_batch.event_size() != 0)
+        desktop_session_->injectInputEventBatch(filtered_batch);
+}
+
 void DesktopSessionProxy::injectClipboardEvent(const proto::ClipboardEvent& event)
 {
     if (is_paused_)
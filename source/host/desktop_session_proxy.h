@@ -36,9 +36,13 @@ public:
     void configure(const DesktopSession::Config& config);
     void selectScreen(const proto::Screen& screen);
     void captureScreen();
+    void setScreenCaptureInterval(const std::chrono::milliseconds& interval);
+    void setAudioBitrate(uint32_t bitrate);
+    void resendScreen(const base::Region& region);
     void injectKeyEvent(const proto::KeyEvent& event);
     void injectTextEvent(const proto::TextEvent& event);
     void injectMouseEvent(const proto::MouseEvent& event);
+    void injectInputEventBatch(const proto::InputEventBatch& batch);
     void injectClipboardEvent(const proto::ClipboardEvent& event);
 
     bool isMouseLocked() const { return is_mouse_locked_; }
@@ -35,6 +35,22 @@ public:
     virtual void injectKeyEvent(const proto::KeyEvent& event) = 0;
     virtual void injectTextEvent(const proto::TextEvent& event) = 0;
     virtual void injectMouseEvent(const proto::MouseEvent& event) = 0;
+
+    // Injects the events in their order. Implementations can pass them to the system in one call.
+    virtual void injectInputEventBatch(const proto::InputEventBatch& batch)
+    {
+        for (int i = 0; i < batch.event_size(); ++i)
+        {
+            const proto::InputEvent& event = batch.event(i);
+
+            if (event.has_mouse_event())
+                injectMouseEvent(event.mouse_event());
+            else if (event.has_key_event())
+                injectKeyEvent(event.key_event());
+            else if (event.has_text_event())
+                injectTextEvent(event.text_event());
+        }
+    }
 };
 
 } // namespace host
@@ -0,0 +1,187 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "host/input_injector_thread.h"
+
+#include "base/logging.h"
+#include "base/scoped_task_runner.h"
+#include "host/input_injector_win.h"
+
+namespace host {
+
+InputInjectorThread::InputInjectorThread()
+    : thread_(std::make_unique<base::Thread>())
+{
+    // Nothing
+}
+
+InputInjectorThread::~InputInjectorThread()
+{
+    // The results that the thread has already posted are discarded together with
+    // |caller_task_runner_|.
+    thread_->stop();
+}
+
+void InputInjectorThread::start(std::shared_ptr<base::TaskRunner> caller_task_runner,
+                                Delegate* delegate)
+{
+    DCHECK(caller_task_runner);
+    DCHECK(delegate);
+
+    caller_task_runner_ = std::make_unique<base::ScopedTaskRunner>(std::move(caller_task_runner));
+    delegate_ = delegate;
+
+    // The IPC channel requires the asynchronous IO of the message loop.
+    thread_->start(base::MessageLoop::Type::ASIO, this);
+}
+
+void InputInjectorThread::connectChannel(const std::u16string& channel_id)
+{
+    if (!self_task_runner_)
+        return;
+
+    if (!self_task_runner_->belongsToCurrentThread())
+    {
+        self_task_runner_->postTask(
+            std::bind(&InputInjectorThread::connectChannel, this, channel_id));
+        return;
+    }
+
+    std::unique_ptr<base::IpcChannel> channel = std::make_unique<base::IpcChannel>();
+    if (!channel->connect(channel_id))
+    {
+        LOG(LS_WARNING) << "Connection to the input channel failed";
+        return;
+    }
+
+    LOG(LS_INFO) << "Input channel connected";
+
+    channel_ = std::move(channel);
+    channel_->setListener(this);
+    channel_->resume();
+}
+
+void InputInjectorThread::setScreenOffset(const base::Point& offset)
+{
+    if (!self_task_runner_)
+        return;
+
+    // The offset is passed with every captured frame, but changes only with the screen.
+    if (screen_offset_ == offset)
+        return;
+
+    screen_offset_ = offset;
+
+    self_task_runner_->postTask([this, offset]()
+    {
+        if (input_injector_)
+            input_injector_->setScreenOffset(offset);
+    });
+}
+
+void InputInjectorThread::setBlockInput(bool enable)
+{
+    if (!self_task_runner_)
+        return;
+
+    if (!self_task_runner_->belongsToCurrentThread())
+    {
+        self_task_runner_->postTask(std::bind(&InputInjectorThread::setBlockInput, this, enable));
+        return;
+    }
+
+    if (input_injector_)
+        input_injector_->setBlockInput(enable);
+}
+
+void InputInjectorThread::injectInput(const proto::internal::ServiceToDesktop& message)
+{
+    if (!self_task_runner_)
+        return;
+
+    self_task_runner_->postTask(std::bind(&InputInjectorThread::doInjectInput, this, message));
+}
+
+void InputInjectorThread::onBeforeThreadRunning()
+{
+    self_task_runner_ = thread_->taskRunner();
+    DCHECK(self_task_runner_);
+
+    input_injector_ = std::make_unique<InputInjectorWin>();
+}
+
+void InputInjectorThread::onAfterThreadRunning()
+{
+    // The channel and the injector are bound to the thread.
+    channel_.reset();
+    input_injector_.reset();
+}
+
+void InputInjectorThread::onDisconnected()
+{
+    LOG(LS_INFO) << "Input channel disconnected";
+
+    // The channel is still in use when it calls the listener.
+    self_task_runner_->deleteSoon(std::move(channel_));
+}
+
+void InputInjectorThread::onMessageReceived(const base::ByteArray& buffer)
+{
+    if (!base::parse(buffer, &incoming_message_))
+    {
+        LOG(LS_ERROR) << "Invalid message from service";
+        return;
+    }
+
+    doInjectInput(incoming_message_);
+}
+
+void InputInjectorThread::doInjectInput(const proto::internal::ServiceToDesktop& message)
+{
+    if (!input_injector_)
+        return;
+
+    if (message.has_mouse_event())
+        input_injector_->injectMouseEvent(message.mouse_event());
+    else if (message.has_key_event())
+        input_injector_->injectKeyEvent(message.key_event());
+    else if (message.has_text_event())
+        input_injector_->injectTextEvent(message.text_event());
+    else if (message.has_input_event_batch())
+        input_injector_->injectInputEventBatch(message.input_event_batch());
+    else
+        return;
+
+    std::chrono::microseconds delay(0);
+
+    if (message.input_time())
+    {
+        const std::chrono::microseconds now = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch());
+
+        delay = std::max(now - std::chrono::microseconds(message.input_time()),
+                         std::chrono::microseconds(0));
+    }
+
+    caller_task_runner_->postTask([this, delay]()
+    {
+        delegate_->onInputInjected(delay);
+    });
+}
+
+} // namespace host
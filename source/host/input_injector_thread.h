@@ -0,0 +1,101 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef HOST__INPUT_INJECTOR_THREAD_H
+#define HOST__INPUT_INJECTOR_THREAD_H
+
+#include "base/desktop/geometry.h"
+#include "base/ipc/ipc_channel.h"
+#include "base/threading/thread.h"
+#include "proto/desktop_internal.pb.h"
+
+#include <chrono>
+#include <optional>
+
+namespace base {
+class ScopedTaskRunner;
+} // namespace base
+
+namespace host {
+
+class InputInjector;
+
+// Injects the input events on its own thread, so they do not wait for the screen capture on the
+// thread of the desktop agent. The service sends the events over a separate IPC channel that is
+// read on the same thread. The events that come over the main channel are passed to the thread.
+class InputInjectorThread
+    : public base::Thread::Delegate,
+      public base::IpcChannel::Listener
+{
+public:
+    class Delegate
+    {
+    public:
+        virtual ~Delegate() = default;
+
+        // Called on the caller thread for each injected message. |delay| is the time from the
+        // receipt of the events by the service or zero if it is unknown.
+        virtual void onInputInjected(std::chrono::microseconds delay) = 0;
+    };
+
+    InputInjectorThread();
+    ~InputInjectorThread();
+
+    void start(std::shared_ptr<base::TaskRunner> caller_task_runner, Delegate* delegate);
+
+    // Connects to the input channel of the service.
+    void connectChannel(const std::u16string& channel_id);
+
+    void setScreenOffset(const base::Point& offset);
+    void setBlockInput(bool enable);
+
+    // Injects the input events of a message received over the main channel.
+    void injectInput(const proto::internal::ServiceToDesktop& message);
+
+protected:
+    // base::Thread::Delegate implementation.
+    void onBeforeThreadRunning() override;
+    void onAfterThreadRunning() override;
+
+    // base::IpcChannel::Listener implementation.
+    void onDisconnected() override;
+    void onMessageReceived(const base::ByteArray& buffer) override;
+
+private:
+    void doInjectInput(const proto::internal::ServiceToDesktop& message);
+
+    Delegate* delegate_ = nullptr;
+
+    std::unique_ptr<base::Thread> thread_;
+    std::unique_ptr<base::ScopedTaskRunner> caller_task_runner_;
+    std::shared_ptr<base::TaskRunner> self_task_runner_;
+
+    // The last offset passed to the injector. Accessed only on the caller thread.
+    std::optional<base::Point> screen_offset_;
+
+    // Accessed only on the injector thread.
+    std::unique_ptr<InputInjector> input_injector_;
+    std::unique_ptr<base::IpcChannel> channel_;
+    proto::internal::ServiceToDesktop incoming_message_;
+
+    DISALLOW_COPY_AND_ASSIGN(InputInjectorThread);
+};
+
+} // namespace host
+
+#endif // HOST__INPUT_INJECTOR_THREAD_H
@@ -24,6 +24,8 @@
 #include "common/keycode_converter.h"
 #include "host/win/sas_injector.h"
 
+#include <algorithm>
+
 namespace host {
 
 namespace {
@@ -34,7 +36,7 @@ const uint32_t kUsbCodeRightCtrl = 0x0700e4;
 const uint32_t kUsbCodeLeftAlt = 0x0700e2;
 const uint32_t kUsbCodeRightAlt = 0x0700e6;
 
-void sendKeyboardScancode(WORD scancode, DWORD flags)
+INPUT keyboardScancodeInput(WORD scancode, DWORD flags)
 {
     INPUT input;
     memset(&input, 0, sizeof(input));
@@ -51,14 +53,10 @@ void sendKeyboardScancode(WORD scancode, DWORD flags)
             input.ki.dwFlags |= KEYEVENTF_EXTENDEDKEY;
     }
 
-    // Do the keyboard event.
-    if (!SendInput(1, &input, sizeof(input)))
-    {
-        PLOG(LS_WARNING) << "SendInput failed";
-    }
+    return input;
 }
 
-void sendKeyboardVirtualKey(WORD key_code, DWORD flags)
+INPUT keyboardVirtualKeyInput(WORD key_code, DWORD flags)
 {
     INPUT input;
     memset(&input, 0, sizeof(input));
@@ -68,14 +66,10 @@ void sendKeyboardVirtualKey(WORD key_code, DWORD flags)
     input.ki.dwFlags = flags;
     input.ki.wScan   = static_cast<WORD>(MapVirtualKeyW(key_code, MAPVK_VK_TO_VSC));
 
-    // Do the keyboard event.
-    if (!SendInput(1, &input, sizeof(input)))
-    {
-        PLOG(LS_WARNING) << "SendInput failed";
-    }
+    return input;
 }
 
-void sendKeyboardUnicodeChar(WORD unicode_char, DWORD flags)
+INPUT keyboardUnicodeCharInput(WORD unicode_char, DWORD flags)
 {
     INPUT input;
     memset(&input, 0, sizeof(input));
@@ -84,11 +78,7 @@ void sendKeyboardUnicodeChar(WORD unicode_char, DWORD flags)
     input.ki.dwFlags = KEYEVENTF_UNICODE | flags;
     input.ki.wScan = unicode_char;
 
-    // Do the keyboard event.
-    if (!SendInput(1, &input, sizeof(input)))
-    {
-        PLOG(LS_WARNING) << "SendInput failed";
-    }
+    return input;
 }
 
 } // namespace
@@ -108,14 +98,16 @@ InputInjectorWin::~InputInjectorWin()
         int scancode = common::KeycodeConverter::usbKeycodeToNativeKeycode(key);
         if (scancode != common::KeycodeConverter::invalidNativeKeycode())
         {
-            sendKeyboardScancode(
-                static_cast<WORD>(scancode), KEYEVENTF_SCANCODE | KEYEVENTF_KEYUP);
+            inputs_.emplace_back(keyboardScancodeInput(
+                static_cast<WORD>(scancode), KEYEVENTF_SCANCODE | KEYEVENTF_KEYUP));
         }
         else
         {
             LOG(LS_WARNING) << "Invalid key code: " << key;
         }
     }
+
+    sendInputs();
 }
 
 void InputInjectorWin::setScreenOffset(const base::Point& offset)
@@ -131,6 +123,47 @@ void InputInjectorWin::setBlockInput(bool enable)
 }
 
 void InputInjectorWin::injectKeyEvent(const proto::KeyEvent& event)
+{
+    switchToInputDesktop();
+    addKeyEvent(event);
+    sendInputs();
+}
+
+void InputInjectorWin::injectTextEvent(const proto::TextEvent& event)
+{
+    switchToInputDesktop();
+    addTextEvent(event);
+    sendInputs();
+}
+
+void InputInjectorWin::injectMouseEvent(const proto::MouseEvent& event)
+{
+    switchToInputDesktop();
+    addMouseEvent(event);
+    sendInputs();
+}
+
+void InputInjectorWin::injectInputEventBatch(const proto::InputEventBatch& batch)
+{
+    switchToInputDesktop();
+
+    for (int i = 0; i < batch.event_size(); ++i)
+    {
+        const proto::InputEvent& event = batch.event(i);
+
+        if (event.has_mouse_event())
+            addMouseEvent(event.mouse_event());
+        else if (event.has_key_event())
+            addKeyEvent(event.key_event());
+        else if (event.has_text_event())
+            addTextEvent(event.text_event());
+    }
+
+    // All events of the batch go to the system in one call.
+    sendInputs();
+}
+
+void InputInjectorWin::addKeyEvent(const proto::KeyEvent& event)
 {
     if (event.flags() & proto::KeyEvent::PRESSED)
     {
@@ -139,6 +172,7 @@ void InputInjectorWin::injectKeyEvent(const proto::KeyEvent& event)
         if (event.usb_keycode() == kUsbCodeDelete && isCtrlAndAltPressed())
         {
             LOG(LS_INFO) << "CTRL+ALT+DEL detected";
+            sendInputs();
             injectSAS();
             return;
         }
@@ -161,15 +195,20 @@ void InputInjectorWin::injectKeyEvent(const proto::KeyEvent& event)
         return;
     }
 
-    switchToInputDesktop();
+    // The state of the lock keys must include the keyboard events added before.
+    if (std::any_of(inputs_.cbegin(), inputs_.cend(),
+                    [](const INPUT& input) { return input.type == INPUT_KEYBOARD; }))
+    {
+        sendInputs();
+    }
 
     bool prev_state = GetKeyState(VK_CAPITAL) != 0;
     bool curr_state = (event.flags() & proto::KeyEvent::CAPSLOCK) != 0;
 
     if (prev_state != curr_state)
     {
-        sendKeyboardVirtualKey(VK_CAPITAL, 0);
-        sendKeyboardVirtualKey(VK_CAPITAL, KEYEVENTF_KEYUP);
+        inputs_.emplace_back(keyboardVirtualKeyInput(VK_CAPITAL, 0));
+        inputs_.emplace_back(keyboardVirtualKeyInput(VK_CAPITAL, KEYEVENTF_KEYUP));
     }
 
     prev_state = GetKeyState(VK_NUMLOCK) != 0;
@@ -177,8 +216,8 @@ void InputInjectorWin::injectKeyEvent(const proto::KeyEvent& event)
 
     if (prev_state != curr_state)
     {
-        sendKeyboardVirtualKey(VK_NUMLOCK, 0);
-        sendKeyboardVirtualKey(VK_NUMLOCK, KEYEVENTF_KEYUP);
+        inputs_.emplace_back(keyboardVirtualKeyInput(VK_NUMLOCK, 0));
+        inputs_.emplace_back(keyboardVirtualKeyInput(VK_NUMLOCK, KEYEVENTF_KEYUP));
     }
 
     DWORD flags = KEYEVENTF_SCANCODE;
@@ -186,36 +225,32 @@ void InputInjectorWin::injectKeyEvent(const proto::KeyEvent& event)
     if (!(event.flags() & proto::KeyEvent::PRESSED))
         flags |= KEYEVENTF_KEYUP;
 
-    sendKeyboardScancode(static_cast<WORD>(scancode), flags);
+    inputs_.emplace_back(keyboardScancodeInput(static_cast<WORD>(scancode), flags));
 }
 
-void InputInjectorWin::injectTextEvent(const proto::TextEvent& event)
+void InputInjectorWin::addTextEvent(const proto::TextEvent& event)
 {
     std::u16string text = base::utf16FromUtf8(event.text());
     if (text.empty())
         return;
 
-    switchToInputDesktop();
-
     for (auto it = text.begin(); it != text.end(); ++it)
     {
         if (*it == '\n')
         {
             // The WM_CHAR event generated for carriage return is '\r', not '\n', and some
             // applications may check for VK_RETURN explicitly, so handle newlines specially.
-            sendKeyboardVirtualKey(VK_RETURN, 0);
-            sendKeyboardVirtualKey(VK_RETURN, KEYEVENTF_KEYUP);
+            inputs_.emplace_back(keyboardVirtualKeyInput(VK_RETURN, 0));
+            inputs_.emplace_back(keyboardVirtualKeyInput(VK_RETURN, KEYEVENTF_KEYUP));
         }
 
-        sendKeyboardUnicodeChar(*it, 0);
-        sendKeyboardUnicodeChar(*it, KEYEVENTF_KEYUP);
+        inputs_.emplace_back(keyboardUnicodeCharInput(*it, 0));
+        inputs_.emplace_back(keyboardUnicodeCharInput(*it, KEYEVENTF_KEYUP));
     }
 }
 
-void InputInjectorWin::injectMouseEvent(const proto::MouseEvent& event)
+void InputInjectorWin::addMouseEvent(const proto::MouseEvent& event)
 {
-    switchToInputDesktop();
-
     base::Size full_size(GetSystemMetrics(SM_CXVIRTUALSCREEN),
                          GetSystemMetrics(SM_CYVIRTUALSCREEN));
     if (full_size.width() <= 1 || full_size.height() <= 1)
@@ -289,13 +324,24 @@ void InputInjectorWin::injectMouseEvent(const proto::MouseEvent& event)
     input.mi.mouseData = wheel_movement;
     input.mi.dwFlags = flags;
 
-    // Do the mouse event.
-    if (!SendInput(1, &input, sizeof(input)))
+    inputs_.emplace_back(input);
+    last_mouse_mask_ = mask;
+}
+
+void InputInjectorWin::sendInputs()
+{
+    if (inputs_.empty())
+        return;
+
+    const UINT count = static_cast<UINT>(inputs_.size());
+
+    // Do the input events.
+    if (SendInput(count, inputs_.data(), sizeof(INPUT)) != count)
     {
         PLOG(LS_WARNING) << "SendInput failed";
     }
 
-    last_mouse_mask_ = mask;
+    inputs_.clear();
 }
 
 void InputInjectorWin::switchToInputDesktop()
@@ -22,6 +22,8 @@
 #include "base/win/scoped_thread_desktop.h"
 #include "host/input_injector.h"
 
+#include <vector>
+
 namespace host {
 
 class InputInjectorWin : public InputInjector
@@ -36,8 +38,15 @@ public:
     void injectKeyEvent(const proto::KeyEvent& event) override;
     void injectTextEvent(const proto::TextEvent& event) override;
     void injectMouseEvent(const proto::MouseEvent& event) override;
+    void injectInputEventBatch(const proto::InputEventBatch& batch) override;
 
 private:
+    // The events are added to |inputs_| and passed to the system by sendInputs().
+    void addKeyEvent(const proto::KeyEvent& event);
+    void addTextEvent(const proto::TextEvent& event);
+    void addMouseEvent(const proto::MouseEvent& event);
+    void sendInputs();
+
     void switchToInputDesktop();
     bool isCtrlAndAltPressed();
 
@@ -50,6 +59,8 @@ private:
     base::Point last_mouse_pos_;
     uint32_t last_mouse_mask_ = 0;
 
+    std::vector<INPUT> inputs_;
+
     DISALLOW_COPY_AND_ASSIGN(InputInjectorWin);
 };
 
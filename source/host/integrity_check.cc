@@ -20,20 +20,26 @@
 
 #include "base/logging.h"
 #include "base/files/base_paths.h"
+#include "base/strings/string_util.h"
 #include "base/strings/unicode.h"
 
 namespace host {
 
-bool integrityCheck()
+namespace {
+
+const char16_t* kFiles[] =
 {
-    static const char16_t* kFiles[] =
-    {
-        u"aspia_host.exe",
-        u"aspia_desktop_agent.exe",
-        u"aspia_host_service.exe"
-    };
-    static const size_t kMinFileSize = 5 * 1024; // 5 kB.
+    u"aspia_host.exe",
+    u"aspia_desktop_agent.exe",
+    u"aspia_host_service.exe"
+};
+
+const size_t kMinFileSize = 5 * 1024; // 5 kB.
 
+} // namespace
+
+bool integrityCheck()
+{
     std::filesystem::path current_dir;
     if (!base::BasePaths::currentExecDir(&current_dir))
     {
@@ -48,18 +54,40 @@ bool integrityCheck()
         return false;
     }
 
-    bool current_file_found = false;
+    // The directory is read once. The entries keep the attributes and sizes that the system returns
+    // with the listing, so the files themselves are not opened one by one. This matters on slow
+    // disks when many hosts start at the same time.
+    std::error_code error_code;
+    std::filesystem::directory_iterator it(current_dir, error_code);
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Failed to read directory '" << current_dir << "': "
+                      << base::utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
 
-    for (size_t i = 0; i < std::size(kFiles); ++i)
+    bool found[std::size(kFiles)] = { false };
+
+    for (const std::filesystem::directory_entry& entry : it)
     {
-        std::filesystem::path file_path(current_dir);
-        file_path.append(kFiles[i]);
+        std::u16string file_name = entry.path().filename().u16string();
+        size_t index = std::size(kFiles);
 
-        if (file_path == current_file)
-            current_file_found = true;
+        for (size_t i = 0; i < std::size(kFiles); ++i)
+        {
+            if (base::compareCaseInsensitive(file_name, kFiles[i]) == 0)
+            {
+                index = i;
+                break;
+            }
+        }
 
-        std::error_code error_code;
-        std::filesystem::file_status status = std::filesystem::status(file_path, error_code);
+        if (index == std::size(kFiles))
+            continue;
+
+        const std::filesystem::path& file_path = entry.path();
+
+        std::filesystem::file_status status = entry.status(error_code);
         if (error_code)
         {
             LOG(LS_ERROR) << "Failed to get file status '" << file_path << "': "
@@ -67,24 +95,34 @@ bool integrityCheck()
             return false;
         }
 
-        if (!std::filesystem::exists(status))
+        if (!std::filesystem::is_regular_file(status))
         {
-            LOG(LS_ERROR) << "File '" << file_path << "' does not exist";
+            LOG(LS_ERROR) << "File '" << file_path << "' is not a file";
             return false;
         }
 
-        if (!std::filesystem::is_regular_file(status))
+        uintmax_t file_size = entry.file_size(error_code);
+        if (error_code || file_size < kMinFileSize)
         {
-            LOG(LS_ERROR) << "File '" << file_path << "' is not a file";
+            LOG(LS_ERROR) << "File '" << file_path << "' is not the correct size: " << file_size;
             return false;
         }
 
-        uintmax_t file_size = std::filesystem::file_size(file_path, error_code);
-        if (file_size < kMinFileSize)
+        found[index] = true;
+    }
+
+    bool current_file_found = false;
+
+    for (size_t i = 0; i < std::size(kFiles); ++i)
+    {
+        if (!found[i])
         {
-            LOG(LS_ERROR) << "File '" << file_path << "' is not the correct size: " << file_size;
+            LOG(LS_ERROR) << "File '" << current_dir / kFiles[i] << "' does not exist";
             return false;
         }
+
+        if (base::compareCaseInsensitive(current_file.filename().u16string(), kFiles[i]) == 0)
+            current_file_found = true;
     }
 
     if (!current_file_found)
@@ -0,0 +1,251 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "host/resource_governor.h"
+
+#include "base/logging.h"
+#include "base/scoped_task_runner.h"
+
+#include <algorithm>
+#include <iterator>
+#include <thread>
+
+namespace host {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const std::chrono::milliseconds kUpdateInterval { 2000 };
+
+// The level grows when the encoders take more than kHighLoad percent of the processor and goes
+// down when they take less than kLowLoad percent for kLowLoadCount measurements in a row.
+const int kHighLoad = 85;
+const int kLowLoad = 50;
+const int kLowLoadCount = 5;
+
+// The throttling of an encoder by its level.
+const ResourceGovernor::Throttle kThrottles[] =
+{
+    { std::chrono::milliseconds(0), 100 },
+    { std::chrono::milliseconds(66), 100 },
+    { std::chrono::milliseconds(100), 75 },
+    { std::chrono::milliseconds(200), 50 }
+};
+
+const int kMaxBackgroundLevel = static_cast<int>(std::size(kThrottles)) - 1;
+
+// The foreground encoders are throttled only when the background encoders are at their maximum
+// level, and not as much.
+const int kMaxForegroundLevel = 2;
+
+const int kMaxLevel = kMaxBackgroundLevel + kMaxForegroundLevel;
+
+// The minimum levels of the encoders while the host runs on battery.
+const int kEnergySavingBackgroundLevel = 2;
+const int kEnergySavingForegroundLevel = 1;
+
+template <class T>
+void eraseItem(std::vector<T>* items, const T& item)
+{
+    items->erase(std::remove(items->begin(), items->end(), item), items->end());
+}
+
+} // namespace
+
+ResourceGovernor::ResourceGovernor(std::shared_ptr<base::TaskRunner> task_runner)
+    : scoped_task_runner_(std::make_unique<base::ScopedTaskRunner>(task_runner)),
+      max_slots_(static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u))),
+      update_timer_(base::WaitableTimer::Type::REPEATED, task_runner)
+{
+    LOG(LS_INFO) << "Max concurrent encoders: " << max_slots_;
+}
+
+ResourceGovernor::~ResourceGovernor()
+{
+    DCHECK(encoders_.empty());
+}
+
+void ResourceGovernor::addEncoder(Encoder* encoder)
+{
+    DCHECK(encoder);
+
+    encoders_.emplace_back(encoder);
+
+    if (encoders_.size() == 1)
+    {
+        measure_start_time_ = Clock::now();
+        busy_time_ = std::chrono::microseconds::zero();
+
+        update_timer_.start(kUpdateInterval, std::bind(&ResourceGovernor::onUpdateTimer, this));
+    }
+}
+
+void ResourceGovernor::removeEncoder(Encoder* encoder)
+{
+    eraseItem(&encoders_, encoder);
+    eraseItem(&waiting_, encoder);
+
+    // The result of the frame that is being encoded is discarded, its slot is free.
+    const size_t encoding_count = encoding_.size();
+    eraseItem(&encoding_, encoder);
+
+    if (encoders_.empty())
+    {
+        update_timer_.stop();
+        load_ = 0;
+        level_ = 0;
+        low_load_count_ = 0;
+    }
+
+    if (encoding_.size() != encoding_count)
+        notifyWaiting();
+}
+
+bool ResourceGovernor::hasFreeSlot(Encoder* encoder)
+{
+    bool has_free_slot = static_cast<int>(encoding_.size()) < max_slots_;
+
+    // The foreground encoders that wait for a slot take it first.
+    if (has_free_slot && !encoder->isForeground())
+    {
+        has_free_slot = std::none_of(waiting_.cbegin(), waiting_.cend(),
+                                     [](const Encoder* waiting)
+        {
+            return waiting->isForeground();
+        });
+    }
+
+    if (has_free_slot)
+    {
+        eraseItem(&waiting_, encoder);
+        return true;
+    }
+
+    if (std::find(waiting_.cbegin(), waiting_.cend(), encoder) == waiting_.cend())
+        waiting_.emplace_back(encoder);
+
+    return false;
+}
+
+void ResourceGovernor::onEncodingStarted(Encoder* encoder)
+{
+    DCHECK(std::find(encoding_.cbegin(), encoding_.cend(), encoder) == encoding_.cend());
+    encoding_.emplace_back(encoder);
+}
+
+void ResourceGovernor::onEncodingFinished(Encoder* encoder, std::chrono::microseconds encode_time)
+{
+    busy_time_ += encode_time;
+    eraseItem(&encoding_, encoder);
+    notifyWaiting();
+}
+
+void ResourceGovernor::setEnergySaving(bool enable)
+{
+    if (enable == energy_saving_)
+        return;
+
+    LOG(LS_INFO) << "Energy saving mode: " << enable;
+    energy_saving_ = enable;
+}
+
+int ResourceGovernor::throttleLevel(const Encoder* encoder) const
+{
+    if (encoder->isForeground())
+    {
+        const int level = std::clamp(level_ - kMaxBackgroundLevel, 0, kMaxForegroundLevel);
+        return energy_saving_ ? std::max(level, kEnergySavingForegroundLevel) : level;
+    }
+
+    const int level = std::min(level_, kMaxBackgroundLevel);
+    return energy_saving_ ? std::max(level, kEnergySavingBackgroundLevel) : level;
+}
+
+ResourceGovernor::Throttle ResourceGovernor::throttle(const Encoder* encoder) const
+{
+    return kThrottles[throttleLevel(encoder)];
+}
+
+void ResourceGovernor::onUpdateTimer()
+{
+    const Clock::time_point now = Clock::now();
+    const int64_t elapsed_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(now - measure_start_time_).count();
+
+    if (elapsed_us <= 0)
+        return;
+
+    load_ = static_cast<int>(busy_time_.count() * 100 / (elapsed_us * max_slots_));
+    measure_start_time_ = now;
+    busy_time_ = std::chrono::microseconds::zero();
+
+    int level = level_;
+
+    if (load_ > kHighLoad)
+    {
+        level = std::min(level + 1, kMaxLevel);
+        low_load_count_ = 0;
+    }
+    else if (load_ < kLowLoad)
+    {
+        // The load is low because of the throttling, so the level goes down slowly.
+        if (level > 0 && ++low_load_count_ >= kLowLoadCount)
+        {
+            --level;
+            low_load_count_ = 0;
+        }
+    }
+    else
+    {
+        low_load_count_ = 0;
+    }
+
+    if (level == level_)
+        return;
+
+    LOG(LS_INFO) << "Throttling level changed from " << level_ << " to " << level
+                 << " (encoder load: " << load_ << "%, encoders: " << encoders_.size() << ")";
+    level_ = level;
+}
+
+void ResourceGovernor::notifyWaiting()
+{
+    if (notify_pending_ || waiting_.empty())
+        return;
+
+    // The encoders are notified after the current call, they may start a frame right away.
+    notify_pending_ = true;
+
+    scoped_task_runner_->postTask([this]()
+    {
+        notify_pending_ = false;
+
+        std::vector<Encoder*> waiting;
+        waiting.swap(waiting_);
+
+        for (Encoder* encoder : waiting)
+        {
+            // An encoder may be removed by the notification of another one.
+            if (std::find(encoders_.cbegin(), encoders_.cend(), encoder) != encoders_.cend())
+                encoder->onEncodeSlotAvailable();
+        }
+    });
+}
+
+} // namespace host
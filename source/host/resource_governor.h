@@ -0,0 +1,126 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef HOST__RESOURCE_GOVERNOR_H
+#define HOST__RESOURCE_GOVERNOR_H
+
+#include "base/macros_magic.h"
+#include "base/waitable_timer.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace base {
+class ScopedTaskRunner;
+class TaskRunner;
+} // namespace base
+
+namespace host {
+
+// Shares the processor between the software screen encoders of all user sessions of the host.
+// Not more frames than the processor cores are encoded at the same time, the other encoders wait
+// for a free slot. The governor measures the time that the encoders spend on the frames, and if
+// they take too much of the processor it throttles them: the background encoders lower the frame
+// rate and then the resolution first, the foreground encoders follow when that is not enough.
+// When the host runs on battery, all the encoders are throttled at least to the energy saving
+// level and use their fastest settings.
+class ResourceGovernor
+{
+public:
+    class Encoder
+    {
+    public:
+        virtual ~Encoder() = default;
+
+        // A client of the encoder has sent input recently. Such encoders are throttled last and
+        // get the free slots first.
+        virtual bool isForeground() const = 0;
+
+        // A slot has become free after the encoder has been refused one.
+        virtual void onEncodeSlotAvailable() = 0;
+    };
+
+    struct Throttle
+    {
+        // Minimum time between two frames, zero if the frame rate is not limited.
+        std::chrono::milliseconds frame_interval;
+
+        // Maximum scale factor of the frames in percent.
+        int max_scale_factor;
+    };
+
+    explicit ResourceGovernor(std::shared_ptr<base::TaskRunner> task_runner);
+    ~ResourceGovernor();
+
+    void addEncoder(Encoder* encoder);
+    void removeEncoder(Encoder* encoder);
+
+    // Returns true if the encoder can start a frame now. Otherwise it is notified by
+    // onEncodeSlotAvailable when a slot is free.
+    bool hasFreeSlot(Encoder* encoder);
+
+    // The encoder takes a slot for the frame and returns it with the time spent on the frame.
+    void onEncodingStarted(Encoder* encoder);
+    void onEncodingFinished(Encoder* encoder, std::chrono::microseconds encode_time);
+
+    // Throttling level of the encoder, 0 if it is not throttled.
+    int throttleLevel(const Encoder* encoder) const;
+    Throttle throttle(const Encoder* encoder) const;
+
+    // Time spent by the encoders on the frames during the last measurement in percent of the
+    // time of all processor cores.
+    int load() const { return load_; }
+
+    void setEnergySaving(bool enable);
+    bool isEnergySaving() const { return energy_saving_; }
+
+private:
+    void onUpdateTimer();
+    void notifyWaiting();
+
+    std::unique_ptr<base::ScopedTaskRunner> scoped_task_runner_;
+    const int max_slots_;
+
+    std::vector<Encoder*> encoders_;
+    std::vector<Encoder*> encoding_;
+
+    // The encoders that have been refused a slot. They are notified all together when a slot is
+    // free and ask again.
+    std::vector<Encoder*> waiting_;
+    bool notify_pending_ = false;
+
+    // Measures the load while there are encoders.
+    base::WaitableTimer update_timer_;
+    std::chrono::steady_clock::time_point measure_start_time_;
+    std::chrono::microseconds busy_time_ { 0 };
+    int load_ = 0;
+
+    // The level grows by one with every measurement of a high load and goes down after several
+    // measurements of a low load in a row.
+    int level_ = 0;
+    int low_load_count_ = 0;
+
+    bool energy_saving_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(ResourceGovernor);
+};
+
+} // namespace host
+
+#endif // HOST__RESOURCE_GOVERNOR_H
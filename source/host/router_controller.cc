@@ -20,16 +20,20 @@
 
 #include "base/logging.h"
 #include "base/task_runner.h"
+#include "base/net/adapter_enumerator.h"
 #include "base/peer/client_authenticator.h"
 #include "base/strings/unicode.h"
 #include "host/host_key_storage.h"
 #include "proto/router_peer.pb.h"
 
+#include <asio/ip/address.hpp>
+
 namespace host {
 
 namespace {
 
 const std::chrono::seconds kReconnectTimeout{ 10 };
+const int kMaxCandidates = 8;
 
 } // namespace
 
@@ -50,6 +54,7 @@ RouterController::~RouterController()
 void RouterController::start(const RouterInfo& router_info, Delegate* delegate)
 {
     router_info_ = router_info;
+    resumption_ticket_ = base::ClientAuthenticator::ResumptionTicket();
     delegate_ = delegate;
 
     if (!delegate_)
@@ -128,6 +133,7 @@ void RouterController::onConnected()
     authenticator_->setIdentify(proto::IDENTIFY_ANONYMOUS);
     authenticator_->setPeerPublicKey(router_info_.public_key);
     authenticator_->setSessionType(proto::ROUTER_SESSION_HOST);
+    authenticator_->setResumptionTicket(resumption_ticket_);
 
     authenticator_->start(std::move(channel_),
                           [this](base::ClientAuthenticator::ErrorCode error_code)
@@ -139,16 +145,23 @@ void RouterController::onConnected()
             channel_ = authenticator_->takeChannel();
             channel_->setListener(this);
 
-            LOG(LS_INFO) << "Router connected";
+            resumption_ticket_ = authenticator_->resumptionTicket();
+
+            LOG(LS_INFO) << "Router connected" << (authenticator_->isResumed() ? " (resumed)" : "");
             routerStateChanged(proto::internal::RouterState::CONNECTED);
 
             // Now the session will receive incoming messages.
             channel_->resume();
+
+            sendCandidates();
         }
         else
         {
             LOG(LS_WARNING) << "Authentication failed: "
                             << base::ClientAuthenticator::errorToString(error_code);
+
+            // The next attempt performs the full authentication.
+            resumption_ticket_ = base::ClientAuthenticator::ResumptionTicket();
             delayedConnectToRouter();
         }
 
@@ -284,6 +297,45 @@ void RouterController::delayedConnectToRouter()
     reconnect_timer_.start(kReconnectTimeout, std::bind(&RouterController::connectToRouter, this));
 }
 
+void RouterController::sendCandidates()
+{
+    if (!router_info_.tcp_port)
+    {
+        LOG(LS_INFO) << "Direct connections are not available";
+        return;
+    }
+
+    proto::PeerToRouter* message = messageFromArena<proto::PeerToRouter>();
+    proto::HostCandidates* host_candidates = message->mutable_host_candidates();
+
+    for (base::AdapterEnumerator adapter; !adapter.isAtEnd(); adapter.advance())
+    {
+        for (base::AdapterEnumerator::IpAddressEnumerator ip(adapter);
+             !ip.isAtEnd(); ip.advance())
+        {
+            std::error_code error_code;
+            asio::ip::address address = asio::ip::make_address(ip.address(), error_code);
+            if (error_code || address.is_loopback() || address.is_unspecified())
+                continue;
+
+            // Link-local addresses can not be used without a scope on the client side.
+            if (address.is_v6() && address.to_v6().is_link_local())
+                continue;
+
+            if (host_candidates->candidate_size() >= kMaxCandidates)
+                break;
+
+            proto::PeerCandidate* candidate = host_candidates->add_candidate();
+            candidate->set_type(proto::PeerCandidate::TYPE_LOCAL);
+            candidate->set_host(address.to_string());
+            candidate->set_port(router_info_.tcp_port);
+        }
+    }
+
+    LOG(LS_INFO) << "Sending " << host_candidates->candidate_size() << " candidates to router";
+    channel_->send(base::serialize(*message));
+}
+
 void RouterController::routerStateChanged(proto::internal::RouterState::State state)
 {
     LOG(LS_INFO) << "Router state changed: " << routerStateToString(state);
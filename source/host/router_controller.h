@@ -22,13 +22,12 @@
 #include "base/protobuf_arena.h"
 #include "base/waitable_timer.h"
 #include "base/net/network_channel.h"
+#include "base/peer/client_authenticator.h"
 #include "base/peer/host_id.h"
 #include "base/peer/relay_peer_manager.h"
 #include "proto/host_internal.pb.h"
 
-namespace base {
-class ClientAuthenticator;
-} // namespace base
+#include <queue>
 
 namespace host {
 
@@ -46,6 +45,10 @@ public:
         std::u16string address;
         uint16_t port = 0;
         base::ByteArray public_key;
+
+        // Port on which the host accepts direct connections. If zero, the connections go only
+        // through the relay.
+        uint16_t tcp_port = 0;
     };
 
     class Delegate
@@ -80,6 +83,7 @@ protected:
 private:
     void connectToRouter();
     void delayedConnectToRouter();
+    void sendCandidates();
     void routerStateChanged(proto::internal::RouterState::State state);
     static const char* routerStateToString(proto::internal::RouterState::State state);
 
@@ -88,6 +92,9 @@ private:
     std::shared_ptr<base::TaskRunner> task_runner_;
     std::unique_ptr<base::NetworkChannel> channel_;
     std::unique_ptr<base::ClientAuthenticator> authenticator_;
+
+    // Allows to reconnect to the router without the key exchange.
+    base::ClientAuthenticator::ResumptionTicket resumption_ticket_;
     std::unique_ptr<base::RelayPeerManager> peer_manager_;
     base::WaitableTimer reconnect_timer_;
     RouterInfo router_info_;
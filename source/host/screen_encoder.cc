@@ -0,0 +1,1149 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "host/screen_encoder.h"
+
+#include "base/logging.h"
+#include "base/codec/scale_reducer.h"
+#include "base/codec/video_encoder_h264.h"
+#include "base/codec/video_encoder_hybrid.h"
+#include "base/codec/video_encoder_vpx.h"
+#include "base/codec/video_encoder_zstd.h"
+#include "base/codec/zstd_dictionary.h"
+#include "base/desktop/frame_pool.h"
+#include "base/desktop/frame_simple.h"
+#include "base/desktop/screen_capturer.h"
+#include "base/net/congestion_controller.h"
+#include "host/desktop_session_proxy.h"
+#include "host/system_settings.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace host {
+
+namespace {
+
+// The lossy areas of the screen are refreshed when they have not changed for this time.
+const std::chrono::milliseconds kLosslessRefreshDelay { 500 };
+
+const std::chrono::milliseconds kMinKeyFrameInterval { 1000 };
+
+// The viewports of the clients are extended by this margin, so that short scrolls show the
+// content at once.
+const int32_t kViewportMargin = 256;
+
+// The packets since the last key frame are kept for the joining clients while they take less than
+// kMaxReplayRatio key frames and kMaxReplayCacheSize bytes.
+const size_t kMaxReplayRatio = 2;
+const size_t kMaxReplayCacheSize = 16 * 1024 * 1024;
+
+// Large frames are sent in slices of about this size, so the client paints the first bands of the
+// screen while the next ones are on the way.
+const size_t kSliceSize = 256 * 1024;
+
+// The encoder is in the foreground for the resource governor while its clients have sent input
+// within this time.
+const std::chrono::seconds kForegroundTimeout { 30 };
+
+std::unique_ptr<base::VideoEncoder> createVideoEncoder(const ScreenEncoder::Settings& settings)
+{
+    std::shared_ptr<const SystemSettings::Snapshot> system_settings = SystemSettings::snapshot();
+
+    const int max_encoder_threads = static_cast<int>(system_settings->max_video_encoder_threads);
+    const bool region_of_interest = system_settings->video_region_of_interest;
+
+    switch (settings.encoding)
+    {
+        case proto::VIDEO_ENCODING_VP8:
+        {
+            std::unique_ptr<base::VideoEncoderVPX> encoder = base::VideoEncoderVPX::createVP8();
+            encoder->setMaxThreadCount(max_encoder_threads);
+            encoder->setReferenceFrames(true);
+            encoder->setQualityRefinement(true);
+            return encoder;
+        }
+
+        case proto::VIDEO_ENCODING_VP9:
+        {
+            std::unique_ptr<base::VideoEncoderVPX> encoder = base::VideoEncoderVPX::createVP9();
+            encoder->setMaxThreadCount(max_encoder_threads);
+            encoder->setReferenceFrames(true);
+            encoder->setRegionOfInterest(region_of_interest);
+            encoder->setQualityRefinement(true);
+            return encoder;
+        }
+
+        case proto::VIDEO_ENCODING_H264:
+        {
+            std::unique_ptr<base::VideoEncoder> encoder = base::VideoEncoderH264::create();
+            if (encoder)
+                return encoder;
+
+            // The client creates the decoder by the encoding of the packet, so we can use
+            // another encoding.
+            LOG(LS_WARNING) << "Hardware H.264 encoder is not available, VP9 is used";
+
+            std::unique_ptr<base::VideoEncoderVPX> vpx_encoder =
+                base::VideoEncoderVPX::createVP9();
+            vpx_encoder->setMaxThreadCount(max_encoder_threads);
+            vpx_encoder->setReferenceFrames(true);
+            vpx_encoder->setRegionOfInterest(region_of_interest);
+            vpx_encoder->setQualityRefinement(true);
+            return vpx_encoder;
+        }
+
+        case proto::VIDEO_ENCODING_ZSTD:
+        {
+            std::unique_ptr<base::VideoEncoderZstd> encoder = base::VideoEncoderZstd::create(
+                settings.pixel_format, settings.compress_ratio);
+
+            // Older clients do not know the copy rectangles, the tile cache, the cross-frame
+            // context, the dictionaries, the delta filter and the palettes.
+            encoder->setScrollDetection(settings.extended_zstd);
+            encoder->setDeltaFilter(settings.extended_zstd);
+            encoder->setPaletteEncoding(settings.extended_zstd);
+            encoder->setTileCache(settings.extended_zstd);
+            encoder->setCrossFrameContext(settings.extended_zstd);
+            encoder->setDictionary(settings.extended_zstd ?
+                base::ZSTD_DICTIONARY_UI : base::ZSTD_DICTIONARY_NONE);
+            encoder->setMaxThreadCount(settings.extended_zstd ? max_encoder_threads : 1);
+            encoder->setSlicing(settings.sliced_frames);
+            return encoder;
+        }
+
+        case proto::VIDEO_ENCODING_HYBRID:
+        {
+            std::unique_ptr<base::VideoEncoderHybrid> encoder = base::VideoEncoderHybrid::create(
+                settings.pixel_format, settings.compress_ratio);
+            if (encoder)
+                encoder->setMaxThreadCount(max_encoder_threads);
+            return encoder;
+        }
+
+        default:
+        {
+            // No supported video encoding.
+            LOG(LS_WARNING) << "Unsupported video encoding: " << settings.encoding;
+            return nullptr;
+        }
+    }
+}
+
+} // namespace
+
+bool ScreenEncoder::Settings::operator==(const Settings& other) const
+{
+    if (encoding != other.encoding || preferred_size != other.preferred_size ||
+        frame_interval != other.frame_interval || energy_saving != other.energy_saving)
+    {
+        return false;
+    }
+
+    // The pixel format and the compression ratio are used only by the lossless encoders.
+    if (encoding != proto::VIDEO_ENCODING_ZSTD && encoding != proto::VIDEO_ENCODING_HYBRID)
+        return true;
+
+    return pixel_format == other.pixel_format &&
+           compress_ratio == other.compress_ratio &&
+           extended_zstd == other.extended_zstd &&
+           sliced_frames == other.sliced_frames;
+}
+
+ScreenEncoder::ScreenEncoder(const Settings& settings,
+                             std::shared_ptr<DesktopSessionProxy> desktop_session_proxy,
+                             std::shared_ptr<base::FramePool> frame_pool,
+                             std::shared_ptr<ResourceGovernor> resource_governor,
+                             std::shared_ptr<base::TaskRunner> task_runner)
+    : settings_(settings),
+      desktop_session_proxy_(std::move(desktop_session_proxy)),
+      frame_pool_(std::move(frame_pool)),
+      preferred_size_(settings.preferred_size),
+      resource_governor_(std::move(resource_governor)),
+      refresh_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner),
+      key_frame_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner),
+      frame_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner),
+      scoped_task_runner_(std::make_unique<base::ScopedTaskRunner>(std::move(task_runner)))
+{
+    DCHECK(desktop_session_proxy_);
+    DCHECK(frame_pool_);
+
+    video_encoder_ = createVideoEncoder(settings_);
+    if (!video_encoder_)
+    {
+        LOG(LS_ERROR) << "Video encoder not initialized!";
+        return;
+    }
+
+    scale_reducer_ = std::make_unique<base::ScaleReducer>();
+
+    // Lossy encoders lose fine details anyway, so the faster filter does not affect the quality.
+    // The lossless encoders keep the box filter to preserve the readability of text.
+    if (settings_.encoding == proto::VIDEO_ENCODING_VP8 ||
+        settings_.encoding == proto::VIDEO_ENCODING_VP9 ||
+        settings_.encoding == proto::VIDEO_ENCODING_H264)
+    {
+        scale_reducer_->setQuality(base::ScaleReducer::Quality::SPEED);
+    }
+
+    encode_thread_.setQoS(base::ThreadQoS::CAPTURE);
+    encode_thread_.start(base::MessageLoop::Type::DEFAULT);
+    encode_task_runner_ = encode_thread_.taskRunner();
+
+    // The hardware encoder does not load the processor.
+    if (video_encoder_->encoding() == proto::VIDEO_ENCODING_H264)
+        resource_governor_.reset();
+
+    if (resource_governor_)
+        resource_governor_->addEncoder(this);
+}
+
+ScreenEncoder::~ScreenEncoder()
+{
+    DCHECK(members_.empty());
+
+    if (resource_governor_)
+        resource_governor_->removeEncoder(this);
+
+    // The encode thread uses the members of the class. The results that it has already posted to
+    // the session thread are discarded together with |scoped_task_runner_|.
+    encode_thread_.stop();
+}
+
+void ScreenEncoder::addClient(Client* client)
+{
+    DCHECK(client);
+
+    members_.push_back({ client, false, 0, 0, 0, base::Rect() });
+    updateVisibleRect();
+
+    // The client that joins an existing stream cannot decode the next delta frame. It gets the
+    // cached packets of the stream or waits for a key frame.
+    if (encode_frame_ && !replayStream(&members_.back()))
+    {
+        members_.back().needs_key_frame = true;
+        requestKeyFrame();
+    }
+}
+
+void ScreenEncoder::removeClient(Client* client)
+{
+    members_.erase(std::remove_if(members_.begin(), members_.end(),
+                                  [client](const Member& member)
+    {
+        return member.client == client;
+    }), members_.end());
+
+    updateRate();
+    updateVisibleRect();
+}
+
+void ScreenEncoder::setClientRate(Client* client, uint32_t bitrate, int scale_factor)
+{
+    for (Member& member : members_)
+    {
+        if (member.client == client)
+        {
+            member.bitrate = bitrate;
+            member.scale_factor = scale_factor;
+            break;
+        }
+    }
+
+    updateRate();
+}
+
+void ScreenEncoder::setClientViewport(Client* client, const base::Rect& viewport)
+{
+    for (Member& member : members_)
+    {
+        if (member.client == client)
+        {
+            member.viewport = viewport;
+            break;
+        }
+    }
+
+    updateVisibleRect();
+}
+
+void ScreenEncoder::encodeScreen(const base::Frame* frame)
+{
+    if (!frame || !isValid())
+        return;
+
+    if (source_size_ != frame->size())
+    {
+        // Every time we change the resolution, we have to reset the preferred size.
+        if (!source_size_.isEmpty())
+            preferred_size_ = base::Size();
+
+        source_size_ = frame->size();
+        skipped_region_.clear();
+        hidden_region_.clear();
+    }
+
+    if (encoding_)
+    {
+        // The previous frame is still being encoded. Instead of queuing frames that are already
+        // stale, we remember the changes and send them with the next frame.
+        skipped_region_.addRegion(frame->constUpdatedRegion());
+        return;
+    }
+
+    if (key_frame_pending_)
+    {
+        startEncoding(frame, FrameType::KEY);
+        return;
+    }
+
+    if (recovery_pending_ && hasRecoverableClient())
+    {
+        startEncoding(frame, FrameType::RECOVERY);
+        return;
+    }
+
+    if (!hasReadyClient() || delayFrame())
+    {
+        // All clients are still sending the previous frame or wait for a key frame, or it is too
+        // early for the next frame.
+        skipped_region_.addRegion(frame->constUpdatedRegion());
+        return;
+    }
+
+    startEncoding(frame, FrameType::DELTA);
+}
+
+void ScreenEncoder::onClientReady()
+{
+    if (!encoding_ && recovery_pending_ && hasRecoverableClient())
+    {
+        startRecoveryFrame();
+        return;
+    }
+
+    resendSkippedRegion();
+}
+
+bool ScreenEncoder::hasReadyClient() const
+{
+    // The frame is encoded when the client has sent the previous one, so that it shows the latest
+    // state of the screen when it leaves. onClientReady is called when the write completes.
+    for (const Member& member : members_)
+    {
+        if (!member.needs_key_frame && !member.client->hasQueuedVideoPacket() &&
+            !member.client->isWritingVideoPacket())
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ScreenEncoder::hasRecoverableClient() const
+{
+    if (!reference_frame_id_)
+        return false;
+
+    // The recovery frame is a delta frame for the client, it must not replace a queued packet.
+    for (const Member& member : members_)
+    {
+        if (member.needs_key_frame && member.reference_frame_id == reference_frame_id_ &&
+            !member.client->hasQueuedVideoPacket())
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ScreenEncoder::delayFrame()
+{
+    const std::chrono::milliseconds frame_interval = frameInterval();
+    if (frame_interval == std::chrono::milliseconds::zero())
+        return false;
+
+    const std::chrono::steady_clock::duration elapsed =
+        std::chrono::steady_clock::now() - last_frame_time_;
+    if (elapsed >= frame_interval)
+        return false;
+
+    if (!frame_timer_.isActive())
+    {
+        frame_timer_.start(std::chrono::ceil<std::chrono::milliseconds>(frame_interval - elapsed),
+                           std::bind(&ScreenEncoder::resendSkippedRegion, this));
+    }
+
+    return true;
+}
+
+bool ScreenEncoder::hasEncodeSlot()
+{
+    return !resource_governor_ || resource_governor_->hasFreeSlot(this);
+}
+
+std::chrono::milliseconds ScreenEncoder::frameInterval() const
+{
+    std::chrono::milliseconds frame_interval = settings_.frame_interval;
+
+    if (settings_.energy_saving)
+        frame_interval = std::max(frame_interval, kEnergySavingFrameInterval);
+
+    if (resource_governor_)
+    {
+        frame_interval =
+            std::max(frame_interval, resource_governor_->throttle(this).frame_interval);
+    }
+
+    return frame_interval;
+}
+
+bool ScreenEncoder::isForeground() const
+{
+    // The previews are never in the foreground.
+    if (members_.empty() || settings_.frame_interval != std::chrono::milliseconds::zero())
+        return false;
+
+    return last_input_time_ != std::chrono::steady_clock::time_point() &&
+           std::chrono::steady_clock::now() - last_input_time_ < kForegroundTimeout;
+}
+
+void ScreenEncoder::onEncodeSlotAvailable()
+{
+    if (encoding_)
+        return;
+
+    if (key_frame_pending_)
+    {
+        startKeyFrame();
+        return;
+    }
+
+    onClientReady();
+}
+
+void ScreenEncoder::updateRate()
+{
+    uint32_t bitrate = 0;
+    int scale_factor = 0;
+
+    // The group is encoded for its fastest client. The slower clients miss some frames instead
+    // of lowering the quality for everyone.
+    for (const Member& member : members_)
+    {
+        bitrate = std::max(bitrate, member.bitrate);
+        scale_factor = std::max(scale_factor, member.scale_factor);
+    }
+
+    scale_factor_ = scale_factor;
+
+    if (!bitrate || bitrate == bitrate_ || !encode_task_runner_)
+        return;
+
+    bitrate_ = bitrate;
+
+    encode_task_runner_->postTask([this, bitrate]()
+    {
+        video_encoder_->setTargetBitrate(bitrate);
+    });
+}
+
+void ScreenEncoder::updateVisibleRect()
+{
+    base::Rect visible_rect;
+
+    for (const Member& member : members_)
+    {
+        // The client shows the whole screen.
+        if (member.viewport.isEmpty())
+        {
+            visible_rect = base::Rect();
+            break;
+        }
+
+        base::Rect viewport = member.viewport;
+        viewport.extend(kViewportMargin, kViewportMargin, kViewportMargin, kViewportMargin);
+        visible_rect.unionWith(viewport);
+    }
+
+    visible_rect_ = visible_rect;
+
+    if (hidden_region_.isEmpty())
+        return;
+
+    // The changes that have become visible are requested from the capturer again.
+    base::Region shown_region = hidden_region_;
+    if (!visible_rect_.isEmpty())
+    {
+        shown_region.intersectWith(visible_rect_);
+        hidden_region_.subtract(visible_rect_);
+    }
+    else
+    {
+        hidden_region_.clear();
+    }
+
+    if (shown_region.isEmpty())
+        return;
+
+    skipped_region_.addRegion(shown_region);
+    resendSkippedRegion();
+}
+
+void ScreenEncoder::requestKeyFrame()
+{
+    if (key_frame_pending_ || key_frame_timer_.isActive())
+        return;
+
+    const std::chrono::steady_clock::duration elapsed =
+        std::chrono::steady_clock::now() - last_key_frame_time_;
+
+    std::chrono::milliseconds delay = std::chrono::milliseconds::zero();
+    if (elapsed < kMinKeyFrameInterval)
+    {
+        delay = std::chrono::duration_cast<std::chrono::milliseconds>(
+            kMinKeyFrameInterval - elapsed);
+    }
+
+    key_frame_timer_.start(delay, std::bind(&ScreenEncoder::onKeyFrameTimer, this));
+}
+
+void ScreenEncoder::setFocusPoint(const base::Point& point)
+{
+    focus_point_.emplace(point);
+}
+
+void ScreenEncoder::onClientInput()
+{
+    last_input_time_ = std::chrono::steady_clock::now();
+}
+
+void ScreenEncoder::requestRecovery(Client* client, uint32_t reference_frame_id)
+{
+    for (Member& member : members_)
+    {
+        if (member.client == client)
+        {
+            member.needs_key_frame = true;
+            member.reference_frame_id = reference_frame_id;
+            break;
+        }
+    }
+
+    requestResync();
+
+    if (!encoding_ && recovery_pending_ && hasRecoverableClient())
+        startRecoveryFrame();
+}
+
+void ScreenEncoder::requestResync()
+{
+    bool key_frame = false;
+    bool recovery = false;
+
+    for (const Member& member : members_)
+    {
+        if (!member.needs_key_frame)
+            continue;
+
+        if (reference_frame_id_ && member.reference_frame_id == reference_frame_id_)
+            recovery = true;
+        else
+            key_frame = true;
+    }
+
+    // The key frame resynchronizes all clients of the group.
+    if (key_frame)
+        requestKeyFrame();
+    else if (recovery)
+        recovery_pending_ = true;
+}
+
+void ScreenEncoder::onKeyFrameTimer()
+{
+    key_frame_pending_ = true;
+
+    // Otherwise the key frame is encoded when the current frame is done.
+    if (!encoding_)
+        startKeyFrame();
+}
+
+void ScreenEncoder::startEncoding(const base::Frame* frame, FrameType frame_type)
+{
+    // The host encodes too many frames at once. The changes are sent when a slot is free (see
+    // onEncodeSlotAvailable).
+    if (!hasEncodeSlot())
+    {
+        skipped_region_.addRegion(frame->constUpdatedRegion());
+        return;
+    }
+
+    const base::Rect frame_rect = base::Rect::makeSize(frame->size());
+
+    // The frame is shared by all encoders, so the skipped changes are added to our copy only.
+    base::Region updated_region = frame->constUpdatedRegion();
+    updated_region.addRegion(skipped_region_);
+    updated_region.intersectWith(frame_rect);
+    skipped_region_.clear();
+
+    bool new_buffer = false;
+
+    if (!encode_frame_ || encode_frame_->size() != frame->size())
+    {
+        // The previous buffer returns to the pool first, it may have the size of the new one.
+        encode_frame_.reset();
+        encode_frame_ = frame_pool_->allocate(frame->size());
+        if (!encode_frame_)
+        {
+            LOG(LS_ERROR) << "Unable to create frame for encoding";
+            return;
+        }
+
+        // The new buffer has no previous image of the screen.
+        updated_region = base::Region(frame_rect);
+        new_buffer = true;
+    }
+
+    // The changes that no client can see are postponed. The new buffer is filled completely.
+    const bool restricted = !visible_rect_.isEmpty() && !new_buffer &&
+        !visible_rect_.containsRect(frame_rect);
+    if (restricted)
+    {
+        base::Region hidden_region = updated_region;
+        hidden_region.subtract(visible_rect_);
+        hidden_region_.addRegion(hidden_region);
+
+        updated_region.intersectWith(visible_rect_);
+    }
+
+    if (updated_region.isEmpty() && frame_type == FrameType::DELTA)
+        return;
+
+    // Only the changed areas are copied. The rest of the buffer keeps the previous image.
+    for (base::Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+        encode_frame_->copyPixelsFrom(*frame, it.rect().topLeft(), it.rect());
+
+    encode_frame_->copyFrameInfoFrom(*frame);
+
+    if (restricted)
+    {
+        // The moves to the postponed areas are not encoded.
+        std::vector<base::Frame::MoveRect>* move_rects = encode_frame_->moveRects();
+        move_rects->erase(std::remove_if(move_rects->begin(), move_rects->end(),
+                                         [this](const base::Frame::MoveRect& move_rect)
+        {
+            return !visible_rect_.containsRect(move_rect.dest_rect);
+        }), move_rects->end());
+    }
+
+    if (frame_type != FrameType::DELTA)
+    {
+        startFullFrame(frame_type);
+        return;
+    }
+
+    *encode_frame_->updatedRegion() = updated_region;
+    postEncodeFrame(FrameType::DELTA);
+}
+
+void ScreenEncoder::startKeyFrame()
+{
+    startFullFrame(FrameType::KEY);
+}
+
+void ScreenEncoder::startRecoveryFrame()
+{
+    startFullFrame(FrameType::RECOVERY);
+}
+
+void ScreenEncoder::startFullFrame(FrameType frame_type)
+{
+    DCHECK(!encoding_);
+    DCHECK_NE(frame_type, FrameType::DELTA);
+
+    // Until the first frame is encoded there is no stream, and the first frame is a key frame.
+    if (!encode_frame_)
+        return;
+
+    // The pending frame is encoded when a slot is free (see onEncodeSlotAvailable).
+    if (!hasEncodeSlot())
+        return;
+
+    // The buffer holds the whole image of the screen.
+    *encode_frame_->updatedRegion() = base::Region(base::Rect::makeSize(encode_frame_->size()));
+    encode_frame_->moveRects()->clear();
+
+    // The key frame resynchronizes the clients that wait for the recovery frame too.
+    recovery_pending_ = false;
+
+    if (frame_type == FrameType::KEY)
+    {
+        key_frame_pending_ = false;
+        last_key_frame_time_ = std::chrono::steady_clock::now();
+    }
+
+    postEncodeFrame(frame_type);
+}
+
+void ScreenEncoder::postEncodeFrame(FrameType frame_type)
+{
+    bool energy_saving = settings_.energy_saving;
+    int host_load = 0;
+    int throttle_level = 0;
+
+    if (resource_governor_)
+    {
+        resource_governor_->onEncodingStarted(this);
+        energy_saving = energy_saving || resource_governor_->isEnergySaving();
+        host_load = resource_governor_->load();
+        throttle_level = resource_governor_->throttleLevel(this);
+    }
+
+    last_frame_time_ = std::chrono::steady_clock::now();
+    encoding_ = true;
+    encode_task_runner_->postTask(std::bind(&ScreenEncoder::encodeFrame, this, targetSize(),
+                                            focus_point_, frame_type, energy_saving, host_load,
+                                            throttle_level));
+}
+
+base::Size ScreenEncoder::targetSize() const
+{
+    base::Size target_size = preferred_size_;
+
+    // If the preferred size is larger than the original, then we use the original size.
+    if (target_size.width() > source_size_.width() ||
+        target_size.height() > source_size_.height())
+    {
+        target_size = source_size_;
+    }
+
+    // If we don't have a preferred size, then we use the original frame size.
+    if (target_size.isEmpty())
+        target_size = source_size_;
+
+    // On a slow network the resolution is lowered by the congestion controller, on a loaded host
+    // by the resource governor.
+    int scale_factor = scale_factor_;
+    if (resource_governor_)
+    {
+        const int max_scale_factor = resource_governor_->throttle(this).max_scale_factor;
+        scale_factor = scale_factor > 0 ? std::min(scale_factor, max_scale_factor)
+                                        : max_scale_factor;
+    }
+
+    if (scale_factor > 0 && scale_factor < base::CongestionController::kMaxScaleFactor)
+    {
+        target_size.set((target_size.width() * scale_factor / 100) & ~1,
+                        (target_size.height() * scale_factor / 100) & ~1);
+    }
+
+    return target_size;
+}
+
+void ScreenEncoder::onFrameEncoded(std::vector<base::ByteArray>&& buffers, double scale_x,
+                                   double scale_y, bool key_frame, uint32_t reference_frame_id,
+                                   uint32_t recovery_frame_id, bool has_lossy,
+                                   std::chrono::microseconds encode_time)
+{
+    encoding_ = false;
+    scale_factor_x_ = scale_x;
+    scale_factor_y_ = scale_y;
+
+    if (resource_governor_)
+        resource_governor_->onEncodingFinished(this, encode_time);
+
+    if (!buffers.empty())
+    {
+        if (reference_frame_id)
+            reference_frame_id_ = reference_frame_id;
+
+        addToReplayCache(buffers, key_frame);
+
+        for (Member& member : members_)
+        {
+            if (key_frame)
+            {
+                // The key frame may replace a packet in the queue, it does not depend on it.
+                member.needs_key_frame = false;
+            }
+            else if (member.needs_key_frame)
+            {
+                // The recovery frame depends only on the reference frame. The client takes it
+                // after the packets that are already in the queue.
+                if (!recovery_frame_id || recovery_frame_id != member.reference_frame_id ||
+                    member.client->hasQueuedVideoPacket())
+                {
+                    continue;
+                }
+
+                member.needs_key_frame = false;
+            }
+            else if (member.client->hasQueuedVideoPacket())
+            {
+                // The packet depends on the previous one, which is still in the queue. The client
+                // misses this packet and waits for a recovery frame or a key frame.
+                member.needs_key_frame = true;
+                continue;
+            }
+
+            // The slices are queued in order and only the last one can replace a queued packet.
+            // If the client still has one, the replacement would overtake the previous slices.
+            const bool replace = buffers.size() == 1 || !member.client->hasQueuedVideoPacket();
+
+            for (size_t i = 0; i < buffers.size(); ++i)
+            {
+                if (replace && i == buffers.size() - 1)
+                    member.client->sendVideoPacket(base::ByteArray(buffers[i]));
+                else
+                    member.client->sendReplayPacket(base::ByteArray(buffers[i]));
+            }
+
+            if (reference_frame_id)
+                member.reference_frame_id = reference_frame_id;
+        }
+    }
+
+    requestResync();
+
+    // The areas sent with losses are refreshed when the screen stops changing there.
+    if (has_lossy)
+    {
+        refresh_timer_.stop();
+        refresh_timer_.start(kLosslessRefreshDelay,
+                             std::bind(&ScreenEncoder::refreshLossyRegion, this));
+    }
+
+    if (key_frame_pending_)
+    {
+        startKeyFrame();
+        return;
+    }
+
+    if (recovery_pending_ && hasRecoverableClient())
+    {
+        startRecoveryFrame();
+        return;
+    }
+
+    // The changes that came during the encoding are sent when a client can take them (see
+    // onClientReady).
+    resendSkippedRegion();
+}
+
+void ScreenEncoder::addToReplayCache(const std::vector<base::ByteArray>& buffers, bool key_frame)
+{
+    size_t size = 0;
+    for (const base::ByteArray& buffer : buffers)
+        size += buffer.size();
+
+    if (key_frame)
+    {
+        replay_cache_.clear();
+        replay_cache_size_ = 0;
+        replay_key_frame_size_ = size;
+    }
+    else if (replay_cache_.empty())
+    {
+        // The stream has no cached key frame to start from.
+        return;
+    }
+
+    replay_cache_size_ += size;
+
+    if (replay_cache_size_ > kMaxReplayCacheSize ||
+        replay_cache_size_ > replay_key_frame_size_ * kMaxReplayRatio)
+    {
+        // A new key frame is cheaper for the joining client than the whole cache.
+        replay_cache_.clear();
+        replay_cache_size_ = 0;
+        return;
+    }
+
+    replay_cache_.insert(replay_cache_.end(), buffers.begin(), buffers.end());
+}
+
+bool ScreenEncoder::replayStream(Member* member)
+{
+    if (replay_cache_.empty())
+        return false;
+
+    // The packets go in order behind anything that is already in the queue of the client. The
+    // frame that is being encoded now is sent to the client as to the other members.
+    for (const base::ByteArray& buffer : replay_cache_)
+        member->client->sendReplayPacket(base::ByteArray(buffer));
+
+    member->reference_frame_id = reference_frame_id_;
+
+    LOG(LS_INFO) << "Replayed " << replay_cache_.size() << " packets (" << replay_cache_size_
+                 << " bytes) to the joining client";
+    return true;
+}
+
+void ScreenEncoder::resendSkippedRegion()
+{
+    if (skipped_region_.isEmpty() || encoding_ || !hasReadyClient() || delayFrame())
+        return;
+
+    desktop_session_proxy_->resendScreen(skipped_region_);
+}
+
+void ScreenEncoder::refreshLossyRegion()
+{
+    if (encoding_ || !hasReadyClient())
+    {
+        // The clients are busy, the refresh would only delay the next frame.
+        refresh_timer_.start(kLosslessRefreshDelay,
+                             std::bind(&ScreenEncoder::refreshLossyRegion, this));
+        return;
+    }
+
+    encode_task_runner_->postTask(
+        std::bind(&ScreenEncoder::collectLossyRegion, this, source_size_));
+}
+
+void ScreenEncoder::encodeFrame(const base::Size& target_size,
+                                const std::optional<base::Point>& focus_point,
+                                FrameType frame_type, bool energy_saving, int host_load,
+                                int throttle_level)
+{
+    DCHECK(encode_task_runner_->belongsToCurrentThread());
+
+    video_encoder_->setEnergySaving(energy_saving);
+
+    std::vector<base::ByteArray> buffers;
+    bool is_key_frame = false;
+    uint32_t reference_frame_id = 0;
+    uint32_t recovery_frame_id = 0;
+    bool has_lossy = false;
+
+    if (frame_type == FrameType::KEY)
+    {
+        video_encoder_->requestKeyFrame();
+    }
+    else if (frame_type == FrameType::RECOVERY)
+    {
+        // The reference frame may have been replaced by a key frame inserted by the encoder.
+        if (!video_encoder_->requestRecoveryFrame())
+            video_encoder_->requestKeyFrame();
+    }
+
+    const std::chrono::steady_clock::time_point encode_start_time =
+        std::chrono::steady_clock::now();
+
+    const base::Frame* scaled_frame = scale_reducer_->scaleFrame(encode_frame_.get(), target_size);
+    if (scaled_frame)
+    {
+        // The focus point is in the coordinates of the screen.
+        if (focus_point.has_value())
+        {
+            video_encoder_->setFocusPoint(base::Point(
+                static_cast<int32_t>(focus_point->x() * scale_reducer_->scaleFactorX() / 100),
+                static_cast<int32_t>(focus_point->y() * scale_reducer_->scaleFactorY() / 100)));
+        }
+
+        proto::HostToClient outgoing_message;
+        proto::VideoPacket* packet = outgoing_message.mutable_video_packet();
+
+        // Encode the frame into a video packet.
+        video_encoder_->encode(scaled_frame, packet);
+        has_lossy = !video_encoder_->lossyRegion().isEmpty();
+
+        const base::Frame::CaptureTiming& capture_timing = encode_frame_->constCaptureTiming();
+        if (capture_timing.capture_time)
+        {
+            const int64_t encode_start_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                encode_start_time.time_since_epoch()).count();
+            const int64_t capture_end_us =
+                capture_timing.capture_time + capture_timing.capture_duration;
+
+            proto::VideoPacketTiming* timing = packet->mutable_timing();
+            timing->set_capture_duration(static_cast<uint32_t>(capture_timing.capture_duration));
+            timing->set_diff_duration(static_cast<uint32_t>(capture_timing.diff_duration));
+            timing->set_input_delay(static_cast<uint32_t>(capture_timing.input_delay));
+            timing->set_queue_duration(
+                static_cast<uint32_t>(std::max(encode_start_us - capture_end_us, int64_t(0))));
+            timing->set_encode_duration(static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - encode_start_time).count()));
+        }
+
+        // The packet with the format starts a new stream and does not depend on previous ones.
+        is_key_frame = packet->has_format();
+        reference_frame_id = packet->reference_frame_id();
+        recovery_frame_id = packet->recovery_frame_id();
+
+        if (packet->has_format())
+        {
+            proto::VideoPacketFormat* format = packet->mutable_format();
+
+            // In video packets that contain the format, we pass the screen capture type.
+            format->set_capturer_type(encode_frame_->capturerType());
+
+            // Real screen size.
+            proto::Size* screen_size = format->mutable_screen_size();
+            screen_size->set_width(encode_frame_->size().width());
+            screen_size->set_height(encode_frame_->size().height());
+
+            LOG(LS_INFO) << "Video packet has format";
+            LOG(LS_INFO) << "Capturer type: " << base::ScreenCapturer::typeToString(
+                static_cast<base::ScreenCapturer::Type>(encode_frame_->capturerType()));
+            LOG(LS_INFO) << "Screen size: " << screen_size->width() << "x"
+                         << screen_size->height();
+            LOG(LS_INFO) << "Video size: " << format->video_rect().width() << "x"
+                         << format->video_rect().height();
+        }
+
+        std::vector<proto::VideoPacket> slices;
+        if (settings_.sliced_frames)
+            slices = base::VideoEncoderZstd::splitIntoSlices(packet, kSliceSize);
+
+        if (slices.empty())
+            slices.emplace_back().Swap(packet);
+
+        for (proto::VideoPacket& slice : slices)
+        {
+            packet->Swap(&slice);
+
+            // The clients show the throttling in their statistics.
+            packet->set_host_load(static_cast<uint32_t>(host_load));
+            packet->set_throttle_level(static_cast<uint32_t>(throttle_level));
+
+            buffers.emplace_back(base::serialize(outgoing_message));
+        }
+    }
+    else
+    {
+        LOG(LS_ERROR) << "No scaled frame";
+    }
+
+    encode_frame_->updatedRegion()->clear();
+    encode_frame_->moveRects()->clear();
+    *encode_frame_->captureTiming() = base::Frame::CaptureTiming();
+
+    const double scale_x = scale_reducer_->scaleFactorX();
+    const double scale_y = scale_reducer_->scaleFactorY();
+    const std::chrono::microseconds encode_time =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - encode_start_time);
+
+    scoped_task_runner_->postTask(
+        [this, buffers = std::move(buffers), scale_x, scale_y, is_key_frame, reference_frame_id,
+         recovery_frame_id, has_lossy, encode_time]() mutable
+    {
+        onFrameEncoded(std::move(buffers), scale_x, scale_y, is_key_frame, reference_frame_id,
+                       recovery_frame_id, has_lossy, encode_time);
+    });
+}
+
+void ScreenEncoder::collectLossyRegion(const base::Size& source_size)
+{
+    DCHECK(encode_task_runner_->belongsToCurrentThread());
+
+    const base::Region lossy_region = video_encoder_->lossyRegion();
+    if (lossy_region.isEmpty())
+        return;
+
+    const double scale_x = scale_reducer_->scaleFactorX();
+    const double scale_y = scale_reducer_->scaleFactorY();
+    if (scale_x <= 0 || scale_y <= 0)
+        return;
+
+    // The lossy region is in the coordinates of the scaled frame.
+    base::Region source_region;
+
+    for (base::Region::Iterator it(lossy_region); !it.isAtEnd(); it.advance())
+    {
+        const base::Rect& rect = it.rect();
+
+        source_region.addRect(base::Rect::makeLTRB(
+            static_cast<int32_t>(std::floor(rect.left() * 100 / scale_x)),
+            static_cast<int32_t>(std::floor(rect.top() * 100 / scale_y)),
+            static_cast<int32_t>(std::ceil(rect.right() * 100 / scale_x)),
+            static_cast<int32_t>(std::ceil(rect.bottom() * 100 / scale_y))));
+    }
+
+    source_region.intersectWith(base::Rect::makeSize(source_size));
+    if (source_region.isEmpty())
+        return;
+
+    video_encoder_->setRefreshPending();
+
+    scoped_task_runner_->postTask([this, source_region]()
+    {
+        desktop_session_proxy_->resendScreen(source_region);
+    });
+}
+
+ScreenEncoderPool::ScreenEncoderPool(std::shared_ptr<base::TaskRunner> task_runner,
+                                     std::shared_ptr<ResourceGovernor> resource_governor,
+                                     bool share_encoders)
+    : task_runner_(std::move(task_runner)),
+      resource_governor_(std::move(resource_governor)),
+      share_encoders_(share_encoders),
+      frame_pool_(base::FramePool::create([](const base::Size& size)
+      {
+          return std::unique_ptr<base::Frame>(
+              base::FrameSimple::create(size, base::PixelFormat::ARGB()));
+      }))
+{
+    DCHECK(task_runner_);
+}
+
+ScreenEncoderPool::~ScreenEncoderPool() = default;
+
+std::shared_ptr<ScreenEncoder> ScreenEncoderPool::encoder(
+    const ScreenEncoder::Settings& settings,
+    std::shared_ptr<DesktopSessionProxy> desktop_session_proxy)
+{
+    if (share_encoders_)
+    {
+        auto it = encoders_.begin();
+
+        while (it != encoders_.end())
+        {
+            std::shared_ptr<ScreenEncoder> encoder = it->lock();
+            if (!encoder)
+            {
+                it = encoders_.erase(it);
+                continue;
+            }
+
+            if (encoder->settings() == settings &&
+                encoder->desktopSessionProxy() == desktop_session_proxy.get())
+            {
+                return encoder;
+            }
+
+            ++it;
+        }
+    }
+
+    std::shared_ptr<ScreenEncoder> encoder = std::make_shared<ScreenEncoder>(
+        settings, std::move(desktop_session_proxy), frame_pool_, resource_governor_, task_runner_);
+    if (!encoder->isValid())
+        return nullptr;
+
+    if (share_encoders_)
+        encoders_.emplace_back(encoder);
+
+    return encoder;
+}
+
+} // namespace host
@@ -0,0 +1,302 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef HOST__SCREEN_ENCODER_H
+#define HOST__SCREEN_ENCODER_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+#include "base/scoped_task_runner.h"
+#include "base/waitable_timer.h"
+#include "base/desktop/geometry.h"
+#include "base/desktop/pixel_format.h"
+#include "base/desktop/region.h"
+#include "base/threading/thread.h"
+#include "host/resource_governor.h"
+#include "proto/desktop.pb.h"
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace base {
+class Frame;
+class FramePool;
+class ScaleReducer;
+class VideoEncoder;
+} // namespace base
+
+namespace host {
+
+class DesktopSessionProxy;
+
+// Scales and encodes the screen on its own thread and sends the packets to one or more clients.
+// The clients with the same video settings can share one encoder, so the screen is encoded once
+// for all of them. The bitrate and the scale are set by the fastest client of the group. A client
+// that cannot take the next packet misses it and gets a recovery frame or a key frame later.
+class ScreenEncoder : public ResourceGovernor::Encoder
+{
+public:
+    struct Settings
+    {
+        proto::VideoEncoding encoding = proto::VIDEO_ENCODING_UNKNOWN;
+        base::PixelFormat pixel_format;
+        int compress_ratio = 0;
+
+        // The client supports the copy rectangles and the tile cache of the ZSTD encoder.
+        bool extended_zstd = false;
+
+        // The client decodes the frames of the ZSTD encoder that are sent in several slices.
+        bool sliced_frames = false;
+
+        base::Size preferred_size;
+
+        // Minimum time between two frames, zero if the frames are sent as fast as the client
+        // takes them. The changes of the screen in between are collected into the next frame.
+        std::chrono::milliseconds frame_interval { 0 };
+
+        // The client runs on battery. The frames are sent not more often than
+        // kEnergySavingFrameInterval and are encoded with the fastest settings.
+        bool energy_saving = false;
+
+        bool operator==(const Settings& other) const;
+        bool operator!=(const Settings& other) const { return !(*this == other); }
+    };
+
+    class Client
+    {
+    public:
+        virtual ~Client() = default;
+
+        // The previous video packet is still in the write queue of the client.
+        virtual bool hasQueuedVideoPacket() const = 0;
+
+        // The previous video packet has left the queue but is still being written to the socket.
+        // The next packet can follow it, but a frame encoded now would wait for the network.
+        virtual bool isWritingVideoPacket() const = 0;
+        virtual void sendVideoPacket(base::ByteArray&& buffer) = 0;
+
+        // Sends a packet of the stream that the client has joined or a slice of a frame. Unlike
+        // sendVideoPacket, the packet is not replaced by the next one, the client has to decode
+        // all of them.
+        virtual void sendReplayPacket(base::ByteArray&& buffer) = 0;
+    };
+
+    static constexpr std::chrono::milliseconds kEnergySavingFrameInterval { 66 };
+
+    ScreenEncoder(const Settings& settings,
+                  std::shared_ptr<DesktopSessionProxy> desktop_session_proxy,
+                  std::shared_ptr<base::FramePool> frame_pool,
+                  std::shared_ptr<ResourceGovernor> resource_governor,
+                  std::shared_ptr<base::TaskRunner> task_runner);
+    ~ScreenEncoder() override;
+
+    bool isValid() const { return video_encoder_ != nullptr; }
+
+    const Settings& settings() const { return settings_; }
+    DesktopSessionProxy* desktopSessionProxy() const { return desktop_session_proxy_.get(); }
+
+    void addClient(Client* client);
+    void removeClient(Client* client);
+
+    // Sets the bitrate in kilobits per second and the scale factor in percent that the network
+    // channel of the client can take.
+    void setClientRate(Client* client, uint32_t bitrate, int scale_factor);
+
+    // Sets the area of the screen that the client shows. An empty |viewport| means the whole
+    // screen. The changes outside the viewports of all the clients of the group are not encoded
+    // until they become visible.
+    void setClientViewport(Client* client, const base::Rect& viewport);
+
+    void encodeScreen(const base::Frame* frame);
+
+    // Called when the client has written a message and can take the next video packet.
+    void onClientReady();
+
+    // Encodes a key frame for all clients of the group. The key frames are not encoded more often
+    // than kMinKeyFrameInterval, the request is delayed if needed.
+    void requestKeyFrame();
+
+    // Called when the client could not decode a video packet. |reference_frame_id| is the last
+    // reference frame that the client has decoded. If it is still the reference frame of the
+    // encoder, the client gets a recovery frame instead of a key frame.
+    void requestRecovery(Client* client, uint32_t reference_frame_id);
+
+    // Sets the position of the cursor in the coordinates of the screen. The encoders with a region
+    // of interest map give more quality around it.
+    void setFocusPoint(const base::Point& point);
+
+    // Called when a client of the group has sent input. The encoder stays in the foreground for
+    // the resource governor for a while after it.
+    void onClientInput();
+
+    // Scale factors of the last encoded frame in percent.
+    double scaleFactorX() const { return scale_factor_x_; }
+    double scaleFactorY() const { return scale_factor_y_; }
+
+protected:
+    // ResourceGovernor::Encoder implementation.
+    bool isForeground() const override;
+    void onEncodeSlotAvailable() override;
+
+private:
+    enum class FrameType { DELTA, KEY, RECOVERY };
+
+    struct Member
+    {
+        Client* client;
+
+        // The client has missed a packet and can decode only a key frame now (or a recovery
+        // frame that refers to |reference_frame_id|).
+        bool needs_key_frame;
+
+        // The last reference frame sent to the client.
+        uint32_t reference_frame_id;
+
+        uint32_t bitrate;
+        int scale_factor;
+
+        base::Rect viewport;
+    };
+
+    bool hasReadyClient() const;
+    bool hasRecoverableClient() const;
+    bool delayFrame();
+    bool hasEncodeSlot();
+    std::chrono::milliseconds frameInterval() const;
+    void updateRate();
+    void updateVisibleRect();
+    void onKeyFrameTimer();
+    void requestResync();
+    void startEncoding(const base::Frame* frame, FrameType frame_type);
+    void startKeyFrame();
+    void startRecoveryFrame();
+    void startFullFrame(FrameType frame_type);
+    void postEncodeFrame(FrameType frame_type);
+    base::Size targetSize() const;
+    void onFrameEncoded(std::vector<base::ByteArray>&& buffers, double scale_x, double scale_y,
+                        bool key_frame, uint32_t reference_frame_id, uint32_t recovery_frame_id,
+                        bool has_lossy, std::chrono::microseconds encode_time);
+    void addToReplayCache(const std::vector<base::ByteArray>& buffers, bool key_frame);
+    bool replayStream(Member* member);
+    void resendSkippedRegion();
+    void refreshLossyRegion();
+
+    // Called on the encode thread.
+    void encodeFrame(const base::Size& target_size, const std::optional<base::Point>& focus_point,
+                     FrameType frame_type, bool energy_saving, int host_load,
+                     int throttle_level);
+    void collectLossyRegion(const base::Size& source_size);
+
+    const Settings settings_;
+    std::shared_ptr<DesktopSessionProxy> desktop_session_proxy_;
+    std::vector<Member> members_;
+
+    base::Size source_size_;
+    base::Size preferred_size_;
+    uint32_t bitrate_ = 0;
+    int scale_factor_ = 0;
+    std::optional<base::Point> focus_point_;
+
+    // Shares the processor with the encoders of the other sessions. Null for the hardware
+    // encoders.
+    std::shared_ptr<ResourceGovernor> resource_governor_;
+    std::chrono::steady_clock::time_point last_input_time_;
+
+    // Changes of the screen that were not encoded because no client could take the next frame.
+    base::Region skipped_region_;
+
+    // The area shown by the clients with a margin for scrolling. Empty if a client shows the
+    // whole screen. The changes outside of it are kept in |hidden_region_|.
+    base::Rect visible_rect_;
+    base::Region hidden_region_;
+
+    // Requests the lossless refresh of the areas that the video encoder has sent with losses.
+    base::WaitableTimer refresh_timer_;
+
+    // Key frames are expensive, so the clients that have missed packets are resynchronized not
+    // more often than kMinKeyFrameInterval.
+    base::WaitableTimer key_frame_timer_;
+    std::chrono::steady_clock::time_point last_key_frame_time_;
+    bool key_frame_pending_ = false;
+
+    // Sends the changes collected while the next frame waited for |settings_.frame_interval|.
+    base::WaitableTimer frame_timer_;
+    std::chrono::steady_clock::time_point last_frame_time_;
+
+    // VP8 and VP9 can resynchronize a client that has the current reference frame with a
+    // recovery frame, which is much smaller than a key frame.
+    uint32_t reference_frame_id_ = 0;
+    bool recovery_pending_ = false;
+
+    // The last key frame and the packets encoded after it. A client that joins the stream gets
+    // them at once instead of waiting for the next key frame. The cache is dropped when it grows
+    // larger than a new key frame would be worth.
+    std::vector<base::ByteArray> replay_cache_;
+    size_t replay_cache_size_ = 0;
+    size_t replay_key_frame_size_ = 0;
+
+    // The encode thread owns |video_encoder_| and |scale_reducer_|. |encode_frame_| is filled on
+    // the session thread while no frame is being encoded and is read by the encode thread until
+    // the result comes back.
+    std::unique_ptr<base::ScopedTaskRunner> scoped_task_runner_;
+    base::Thread encode_thread_;
+    std::shared_ptr<base::TaskRunner> encode_task_runner_;
+    std::unique_ptr<base::VideoEncoder> video_encoder_;
+    std::unique_ptr<base::ScaleReducer> scale_reducer_;
+    std::shared_ptr<base::FramePool> frame_pool_;
+    std::shared_ptr<base::Frame> encode_frame_;
+    bool encoding_ = false;
+
+    double scale_factor_x_ = 0;
+    double scale_factor_y_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(ScreenEncoder);
+};
+
+// Gives the clients of a user session their screen encoders. If sharing is enabled, the clients
+// with the same settings get the same encoder.
+class ScreenEncoderPool
+{
+public:
+    ScreenEncoderPool(std::shared_ptr<base::TaskRunner> task_runner,
+                      std::shared_ptr<ResourceGovernor> resource_governor,
+                      bool share_encoders);
+    ~ScreenEncoderPool();
+
+    // Returns nullptr if the encoder for the settings cannot be created.
+    std::shared_ptr<ScreenEncoder> encoder(
+        const ScreenEncoder::Settings& settings,
+        std::shared_ptr<DesktopSessionProxy> desktop_session_proxy);
+
+private:
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    std::shared_ptr<ResourceGovernor> resource_governor_;
+    const bool share_encoders_;
+    std::vector<std::weak_ptr<ScreenEncoder>> encoders_;
+
+    // The buffers of the encoders are reused when the clients reconnect or the screen changes.
+    std::shared_ptr<base::FramePool> frame_pool_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScreenEncoderPool);
+};
+
+} // namespace host
+
+#endif // HOST__SCREEN_ENCODER_H
@@ -24,7 +24,9 @@
 #include "base/files/file_path_watcher.h"
 #include "base/net/network_channel.h"
 #include "base/net/firewall_manager.h"
+#include "base/threading/thread_pool.h"
 #include "host/client_session.h"
+#include "host/system_info_cache.h"
 
 namespace host {
 
@@ -33,6 +35,12 @@ namespace {
 const wchar_t kFirewallRuleName[] = L"Aspia Host Service";
 const wchar_t kFirewallRuleDecription[] = L"Allow incoming TCP connections";
 
+// Threads for the SRP calculations of new connections.
+constexpr size_t kCryptoThreadCount = 2;
+
+// Applications write the configuration file in several steps. It is reloaded once they finish.
+constexpr std::chrono::milliseconds kSettingsQuietPeriod { 500 };
+
 } // namespace
 
 Server::Server(std::shared_ptr<base::TaskRunner> task_runner)
@@ -84,10 +92,16 @@ void Server::start()
     }
 
     settings_watcher_ = std::make_unique<base::FilePathWatcher>(task_runner_);
+    settings_watcher_->setQuietPeriod(kSettingsQuietPeriod);
+    settings_watcher_->setContentCheck(true);
     settings_watcher_->watch(settings_file, false,
         std::bind(&Server::updateConfiguration, this, std::placeholders::_1, std::placeholders::_2));
 
     authenticator_manager_ = std::make_unique<base::ServerAuthenticatorManager>(task_runner_, this);
+    authenticator_manager_->setCryptoPool(
+        std::make_shared<base::ThreadPool>(kCryptoThreadCount));
+
+    system_info_cache_ = std::make_shared<SystemInfoCache>(task_runner_);
 
     user_session_manager_ = std::make_unique<UserSessionManager>(task_runner_);
     user_session_manager_->start(this);
@@ -143,6 +157,13 @@ void Server::setPowerEvent(uint32_t power_event)
         }
         break;
 
+        case PBT_APMPOWERSTATUSCHANGE:
+        {
+            if (user_session_manager_)
+                user_session_manager_->onPowerSourceChanged();
+        }
+        break;
+
         default:
             // Ignore other events.
             break;
@@ -180,7 +201,8 @@ void Server::onNewSession(base::ServerAuthenticatorManager::SessionInfo&& sessio
     std::unique_ptr<ClientSession> session = ClientSession::create(
         static_cast<proto::SessionType>(session_info.session_type),
         std::move(session_info.channel),
-        task_runner_);
+        task_runner_,
+        system_info_cache_);
 
     if (session)
     {
@@ -239,9 +261,11 @@ void Server::startAuthentication(std::unique_ptr<base::NetworkChannel> channel)
     LOG(LS_INFO) << "Start authentication";
 
     static const size_t kReadBufferSize = 1 * 1024 * 1024; // 1 Mb.
+    static const size_t kNotSentLowWatermark = 128 * 1024; // 128 kB.
 
     channel->setReadBufferSize(kReadBufferSize);
     channel->setNoDelay(true);
+    channel->setNotSentLowWatermark(kNotSentLowWatermark);
 
     if (authenticator_manager_)
     {
@@ -310,6 +334,7 @@ void Server::updateConfiguration(const std::filesystem::path& path, bool error)
 
         // Synchronize the parameters from the file.
         settings_.sync();
+        SystemSettings::updateSnapshot();
 
         // Apply settings for user sessions BEFORE reloading the user list.
         user_session_manager_->onSettingsChanged();
@@ -394,6 +419,7 @@ void Server::connectToRouter()
     router_info.address = settings_.routerAddress();
     router_info.port = settings_.routerPort();
     router_info.public_key = settings_.routerPublicKey();
+    router_info.tcp_port = settings_.tcpPort();
 
     // Connect to the router.
     router_controller_ = std::make_unique<RouterController>(task_runner_);
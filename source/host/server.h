@@ -32,6 +32,8 @@ class TaskRunner;
 
 namespace host {
 
+class SystemInfoCache;
+
 class Server
     : public base::NetworkServer::Delegate,
       public RouterController::Delegate,
@@ -82,6 +84,7 @@ private:
     std::unique_ptr<RouterController> router_controller_;
     std::unique_ptr<base::ServerAuthenticatorManager> authenticator_manager_;
     std::unique_ptr<UserSessionManager> user_session_manager_;
+    std::shared_ptr<SystemInfoCache> system_info_cache_;
 
     DISALLOW_COPY_AND_ASSIGN(Server);
 };
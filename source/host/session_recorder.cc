@@ -0,0 +1,109 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "host/session_recorder.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/codec/webm_file_writer.h"
+#include "proto/desktop.pb.h"
+
+#include <utility>
+
+namespace host {
+
+namespace {
+
+// Packets waiting for the recorder thread. The video packets are queued only when the screen
+// changes, the audio packets are counted too.
+const int kMaxQueuedTasks = 128;
+
+} // namespace
+
+SessionRecorder::SessionRecorder(const std::filesystem::path& path, std::u16string_view name)
+    : writer_(std::make_unique<base::WebmFileWriter>(path, name))
+{
+    thread_.start(base::MessageLoop::Type::DEFAULT);
+    task_runner_ = thread_.taskRunner();
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    // The queued tasks are completed before the thread exits.
+    thread_.stop();
+}
+
+void SessionRecorder::addVideoMessage(const base::ByteArray& buffer)
+{
+    if (!startTask())
+    {
+        // The next packets depend on the dropped one. The recording continues from the next key
+        // frame of the encoder.
+        LOG_IF(LS_WARNING, !video_dropped_) << "Recording queue is full";
+        video_dropped_ = true;
+        return;
+    }
+
+    const base::WebmFileWriter::TimePoint time = base::WebmFileWriter::Clock::now();
+    const bool after_drop = std::exchange(video_dropped_, false);
+
+    task_runner_->postTask([this, buffer, time, after_drop]()
+    {
+        proto::HostToClient message;
+        if (base::parse(buffer, &message) && message.has_video_packet())
+        {
+            const proto::VideoPacket& packet = message.video_packet();
+
+            if (after_drop)
+                waiting_key_frame_ = true;
+
+            if (waiting_key_frame_ && base::WebmFileWriter::isKeyFrame(packet))
+                waiting_key_frame_ = false;
+
+            if (!waiting_key_frame_)
+                writer_->addVideoPacket(packet, time);
+        }
+
+        --queued_tasks_;
+    });
+}
+
+void SessionRecorder::addAudioPacket(const proto::AudioPacket& packet)
+{
+    if (!startTask())
+        return;
+
+    const base::WebmFileWriter::TimePoint time = base::WebmFileWriter::Clock::now();
+
+    task_runner_->postTask([this, packet, time]()
+    {
+        writer_->addAudioPacket(packet, time);
+        --queued_tasks_;
+    });
+}
+
+bool SessionRecorder::startTask()
+{
+    if (queued_tasks_ >= kMaxQueuedTasks)
+        return false;
+
+    ++queued_tasks_;
+    return true;
+}
+
+} // namespace host
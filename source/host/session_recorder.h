@@ -0,0 +1,76 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef HOST__SESSION_RECORDER_H
+#define HOST__SESSION_RECORDER_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+#include "base/threading/thread.h"
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+namespace base {
+class WebmFileWriter;
+} // namespace base
+
+namespace proto {
+class AudioPacket;
+} // namespace proto
+
+namespace host {
+
+// Writes the video and audio sent to the client into WebM files. The packets are written as they
+// were encoded for the client, so only VP8 and VP9 video is recorded.
+class SessionRecorder
+{
+public:
+    SessionRecorder(const std::filesystem::path& path, std::u16string_view name);
+    ~SessionRecorder();
+
+    // |buffer| is a serialized proto::HostToClient message with a video packet. It is parsed on
+    // the recorder thread.
+    void addVideoMessage(const base::ByteArray& buffer);
+    void addAudioPacket(const proto::AudioPacket& packet);
+
+private:
+    // Returns false if the queue is full.
+    bool startTask();
+
+    base::Thread thread_;
+    std::shared_ptr<base::TaskRunner> task_runner_;
+
+    // Number of the tasks posted to the recorder thread and not yet completed.
+    std::atomic_int queued_tasks_ = 0;
+
+    // Accessed only on the calling thread.
+    bool video_dropped_ = false;
+
+    // Accessed only on the recorder thread.
+    std::unique_ptr<base::WebmFileWriter> writer_;
+    bool waiting_key_frame_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(SessionRecorder);
+};
+
+} // namespace host
+
+#endif // HOST__SESSION_RECORDER_H
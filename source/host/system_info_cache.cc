@@ -0,0 +1,157 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "host/system_info_cache.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "common/system_info_constants.h"
+#include "host/system_info.h"
+
+namespace host {
+
+namespace {
+
+using Seconds = std::chrono::seconds;
+
+Seconds cacheLifetime(const std::string& category)
+{
+    // The hardware and the installed drivers rarely change.
+    if (category == common::kSystemInfo_Devices ||
+        category == common::kSystemInfo_Drivers ||
+        category == common::kSystemInfo_VideoAdapters ||
+        category == common::kSystemInfo_Monitors)
+    {
+        return Seconds(300);
+    }
+
+    // The event logs are requested by pages, the connections, routes and battery state change
+    // all the time.
+    if (category == common::kSystemInfo_EventLogs ||
+        category == common::kSystemInfo_Connections ||
+        category == common::kSystemInfo_Routes ||
+        category == common::kSystemInfo_PowerOptions)
+    {
+        return Seconds(0);
+    }
+
+    return Seconds(30);
+}
+
+} // namespace
+
+SystemInfoCache::SystemInfoCache(std::shared_ptr<base::TaskRunner> task_runner)
+    : task_runner_(std::move(task_runner)),
+      lifetime_(std::make_shared<int>(0))
+{
+    DCHECK(task_runner_);
+}
+
+SystemInfoCache::~SystemInfoCache()
+{
+    lifetime_.reset();
+    worker_thread_.stop();
+}
+
+void SystemInfoCache::request(const proto::system_info::SystemInfoRequest& request,
+                              Callback callback)
+{
+    DCHECK(task_runner_->belongsToCurrentThread());
+
+    const std::string& category = request.category();
+    const bool cacheable = cacheLifetime(category) > Seconds(0);
+
+    if (cacheable)
+    {
+        auto entry = cache_.find(category);
+        if (entry != cache_.end())
+        {
+            if (entry->second.expire_time > Clock::now())
+            {
+                callback(entry->second.system_info);
+                return;
+            }
+
+            cache_.erase(entry);
+        }
+
+        std::vector<Callback>& callbacks = pending_[category];
+        callbacks.emplace_back(callback);
+
+        // The category is already being collected.
+        if (callbacks.size() > 1)
+            return;
+    }
+
+    if (!worker_thread_.isRunning())
+    {
+        worker_thread_.start(base::MessageLoop::Type::DEFAULT);
+
+#if defined(OS_WIN)
+        // Enumerating the system should not slow down the desktop sessions.
+        worker_thread_.setPriority(base::Thread::Priority::BELOW_NORMAL);
+#endif // defined(OS_WIN)
+    }
+
+    std::weak_ptr<int> lifetime = lifetime_;
+    std::shared_ptr<base::TaskRunner> task_runner = task_runner_;
+
+    worker_thread_.taskRunner()->postTask(
+        [this, request, callback, cacheable, lifetime, task_runner]()
+    {
+        proto::system_info::SystemInfo system_info;
+        createSystemInfo(request, &system_info);
+
+        task_runner->postTask(
+            [this, category = request.category(), callback, cacheable, lifetime,
+             buffer = base::serialize(system_info)]() mutable
+        {
+            if (lifetime.expired())
+                return;
+
+            if (cacheable)
+                onCollected(category, std::move(buffer));
+            else
+                callback(buffer);
+        });
+    });
+}
+
+void SystemInfoCache::clear()
+{
+    cache_.clear();
+}
+
+void SystemInfoCache::onCollected(const std::string& category, base::ByteArray&& system_info)
+{
+    Entry& entry = cache_[category];
+    entry.system_info = std::move(system_info);
+    entry.expire_time = Clock::now() + cacheLifetime(category);
+
+    auto pending = pending_.find(category);
+    if (pending == pending_.end())
+        return;
+
+    std::vector<Callback> callbacks = std::move(pending->second);
+    pending_.erase(pending);
+
+    for (const auto& callback : callbacks)
+        callback(entry.system_info);
+}
+
+} // namespace host
@@ -0,0 +1,83 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef HOST__SYSTEM_INFO_CACHE_H
+#define HOST__SYSTEM_INFO_CACHE_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+#include "base/threading/thread.h"
+#include "proto/system_info.pb.h"
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <vector>
+
+namespace base {
+class TaskRunner;
+} // namespace base
+
+namespace host {
+
+// Collects the system information on a background thread and keeps the serialized categories
+// for a while, so repeated requests from the clients do not enumerate the system again. Requests
+// for a category that is being collected wait for the same collection.
+class SystemInfoCache
+{
+public:
+    explicit SystemInfoCache(std::shared_ptr<base::TaskRunner> task_runner);
+    ~SystemInfoCache();
+
+    // Called on the thread of |task_runner| with the serialized proto::system_info::SystemInfo.
+    using Callback = std::function<void(const base::ByteArray& system_info)>;
+
+    // The callback can be called before the method returns if the category is in the cache.
+    void request(const proto::system_info::SystemInfoRequest& request, Callback callback);
+
+    // Drops all cached categories.
+    void clear();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void onCollected(const std::string& category, base::ByteArray&& system_info);
+
+    struct Entry
+    {
+        base::ByteArray system_info;
+        Clock::time_point expire_time;
+    };
+
+    std::shared_ptr<base::TaskRunner> task_runner_;
+
+    // Started on the first request.
+    base::Thread worker_thread_;
+
+    std::map<std::string, Entry> cache_;
+    std::map<std::string, std::vector<Callback>> pending_;
+
+    // Expires when the cache is destroyed.
+    std::shared_ptr<int> lifetime_;
+
+    DISALLOW_COPY_AND_ASSIGN(SystemInfoCache);
+};
+
+} // namespace host
+
+#endif // HOST__SYSTEM_INFO_CACHE_H
@@ -25,12 +25,20 @@
 #include "base/crypto/random.h"
 #include "base/peer/user_list.h"
 
+#include <atomic>
+
 namespace host {
 
 namespace {
 
 const size_t kPasswordHashSaltSize = 256;
 
+// The cost of the password hash is chosen so that checking the password takes about this time on
+// the computer where the password is set.
+constexpr std::chrono::milliseconds kPasswordHashTime { 250 };
+
+std::shared_ptr<const SystemSettings::Snapshot> g_snapshot;
+
 } // namespace
 
 SystemSettings::SystemSettings()
@@ -42,23 +50,29 @@ SystemSettings::SystemSettings()
 SystemSettings::~SystemSettings() = default;
 
 // static
-bool SystemSettings::createPasswordHash(
-    std::string_view password, base::ByteArray* hash, base::ByteArray* salt)
+bool SystemSettings::createPasswordHash(std::string_view password,
+                                        base::ByteArray* hash,
+                                        base::ByteArray* salt,
+                                        uint32_t* cost)
 {
-    if (password.empty() || !hash || !salt)
+    if (password.empty() || !hash || !salt || !cost)
         return false;
 
     base::ByteArray salt_temp = base::Random::byteArray(kPasswordHashSaltSize);
     if (salt_temp.empty())
         return false;
 
+    uint32_t cost_temp =
+        base::PasswordHash::tuneCost(base::PasswordHash::SCRYPT, kPasswordHashTime);
+
     base::ByteArray hash_temp =
-        base::PasswordHash::hash(base::PasswordHash::SCRYPT, password, salt_temp);
+        base::PasswordHash::hash(base::PasswordHash::SCRYPT, password, salt_temp, cost_temp);
     if (hash_temp.empty())
         return false;
 
     *salt = std::move(salt_temp);
     *hash = std::move(hash_temp);
+    *cost = cost_temp;
     return true;
 }
 
@@ -76,14 +90,59 @@ bool SystemSettings::isValidPassword(std::string_view password)
     if (password_hash_salt.empty() || password_hash.empty())
         return false;
 
-    base::ByteArray verifiable_password_hash =
-        base::PasswordHash::hash(base::PasswordHash::SCRYPT, password, password_hash_salt);
+    base::ByteArray verifiable_password_hash = base::PasswordHash::hash(
+        base::PasswordHash::SCRYPT, password, password_hash_salt, settings.passwordHashCost());
     if (verifiable_password_hash.empty())
         return false;
 
     return base::equals(verifiable_password_hash, password_hash);
 }
 
+// static
+std::shared_ptr<const SystemSettings::Snapshot> SystemSettings::snapshot()
+{
+    std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&g_snapshot);
+    if (snapshot)
+        return snapshot;
+
+    // Concurrent first calls can read the file more than once, the result is the same.
+    snapshot = SystemSettings().createSnapshot();
+
+    std::shared_ptr<const Snapshot> expected;
+    if (!std::atomic_compare_exchange_strong(&g_snapshot, &expected, snapshot))
+        return expected;
+
+    return snapshot;
+}
+
+// static
+void SystemSettings::updateSnapshot()
+{
+    std::atomic_store(&g_snapshot, SystemSettings().createSnapshot());
+}
+
+std::shared_ptr<const SystemSettings::Snapshot> SystemSettings::createSnapshot() const
+{
+    auto snapshot = std::make_shared<Snapshot>();
+
+    snapshot->share_video_encoders = shareVideoEncoders();
+    snapshot->max_video_encoder_threads = maxVideoEncoderThreads();
+    snapshot->video_region_of_interest = videoRegionOfInterest();
+    snapshot->audio_frame_duration = audioFrameDuration();
+    snapshot->session_recording_path = sessionRecordingPath();
+
+    snapshot->one_time_password = oneTimePassword();
+    snapshot->one_time_password_characters = oneTimePasswordCharacters();
+    snapshot->one_time_password_length = oneTimePasswordLength();
+    snapshot->one_time_password_expire = oneTimePasswordExpire();
+
+    snapshot->conn_confirm = connConfirm();
+    snapshot->conn_confirm_no_user_action = connConfirmNoUserAction();
+    snapshot->auto_conn_confirm_interval = autoConnConfirmInterval();
+
+    return snapshot;
+}
+
 const std::filesystem::path& SystemSettings::filePath() const
 {
     return settings_.filePath();
@@ -224,6 +283,56 @@ void SystemSettings::setPreferredVideoCapturer(uint32_t type)
     settings_.set("PreferredVideoCapturer", type);
 }
 
+uint32_t SystemSettings::maxVideoEncoderThreads() const
+{
+    return settings_.get<uint32_t>("MaxVideoEncoderThreads", 0);
+}
+
+void SystemSettings::setMaxVideoEncoderThreads(uint32_t count)
+{
+    settings_.set<uint32_t>("MaxVideoEncoderThreads", count);
+}
+
+bool SystemSettings::shareVideoEncoders() const
+{
+    return settings_.get<bool>("ShareVideoEncoders", false);
+}
+
+void SystemSettings::setShareVideoEncoders(bool enable)
+{
+    settings_.set<bool>("ShareVideoEncoders", enable);
+}
+
+bool SystemSettings::videoRegionOfInterest() const
+{
+    return settings_.get<bool>("VideoRegionOfInterest", false);
+}
+
+void SystemSettings::setVideoRegionOfInterest(bool enable)
+{
+    settings_.set<bool>("VideoRegionOfInterest", enable);
+}
+
+uint32_t SystemSettings::audioFrameDuration() const
+{
+    return settings_.get<uint32_t>("AudioFrameDuration", 20);
+}
+
+void SystemSettings::setAudioFrameDuration(uint32_t duration)
+{
+    settings_.set<uint32_t>("AudioFrameDuration", duration);
+}
+
+std::u16string SystemSettings::sessionRecordingPath() const
+{
+    return settings_.get<std::u16string>("SessionRecordingPath");
+}
+
+void SystemSettings::setSessionRecordingPath(const std::u16string& path)
+{
+    settings_.set<std::u16string>("SessionRecordingPath", path);
+}
+
 bool SystemSettings::passwordProtection() const
 {
     return settings_.get<bool>("PasswordProtection", false);
@@ -254,6 +363,17 @@ void SystemSettings::setPasswordHashSalt(const base::ByteArray& salt)
     settings_.set("PasswordHashSalt", salt);
 }
 
+uint32_t SystemSettings::passwordHashCost() const
+{
+    // The hashes created before the cost was stored use the default cost.
+    return settings_.get<uint32_t>("PasswordHashCost", base::PasswordHash::kDefaultCost);
+}
+
+void SystemSettings::setPasswordHashCost(uint32_t cost)
+{
+    settings_.set<uint32_t>("PasswordHashCost", cost);
+}
+
 bool SystemSettings::oneTimePassword() const
 {
     return settings_.get<bool>("OneTimePassword", true);
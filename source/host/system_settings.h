@@ -23,6 +23,7 @@
 #include "base/settings/json_settings.h"
 
 #include <filesystem>
+#include <memory>
 
 namespace base {
 class UserList;
@@ -36,10 +37,45 @@ public:
     SystemSettings();
     ~SystemSettings();
 
-    static bool createPasswordHash(
-        std::string_view password, base::ByteArray* hash, base::ByteArray* salt);
+    static bool createPasswordHash(std::string_view password,
+                                   base::ByteArray* hash,
+                                   base::ByteArray* salt,
+                                   uint32_t* cost);
     static bool isValidPassword(std::string_view password);
 
+    enum class NoUserAction
+    {
+        ACCEPT = 0,
+        REJECT = 1
+    };
+
+    // Settings read when sessions are started and configured. The snapshot is not changed after
+    // it is created, it is replaced as a whole when the configuration file changes.
+    struct Snapshot
+    {
+        bool share_video_encoders = false;
+        uint32_t max_video_encoder_threads = 0;
+        bool video_region_of_interest = false;
+        uint32_t audio_frame_duration = 0;
+        std::u16string session_recording_path;
+
+        bool one_time_password = false;
+        uint32_t one_time_password_characters = 0;
+        int one_time_password_length = 0;
+        std::chrono::milliseconds one_time_password_expire { 0 };
+
+        bool conn_confirm = false;
+        NoUserAction conn_confirm_no_user_action = NoUserAction::ACCEPT;
+        std::chrono::milliseconds auto_conn_confirm_interval { 0 };
+    };
+
+    // Returns the current snapshot. The configuration file is read only on the first call and
+    // by updateSnapshot(). Can be called from any thread.
+    static std::shared_ptr<const Snapshot> snapshot();
+
+    // Reads the configuration file and replaces the snapshot.
+    static void updateSnapshot();
+
     const std::filesystem::path& filePath() const;
     bool isWritable() const;
     void sync();
@@ -69,6 +105,25 @@ public:
     uint32_t preferredVideoCapturer() const;
     void setPreferredVideoCapturer(uint32_t type);
 
+    // Maximum number of threads of the video encoder. 0 means no limit.
+    uint32_t maxVideoEncoderThreads() const;
+    void setMaxVideoEncoderThreads(uint32_t count);
+
+    bool shareVideoEncoders() const;
+    void setShareVideoEncoders(bool enable);
+
+    // Raise the VP9 quality around the cursor and lower it for video areas of the screen.
+    bool videoRegionOfInterest() const;
+    void setVideoRegionOfInterest(bool enable);
+
+    // Duration of the Opus audio frame in milliseconds.
+    uint32_t audioFrameDuration() const;
+    void setAudioFrameDuration(uint32_t duration);
+
+    // Directory where the desktop sessions are recorded. Sessions are not recorded if empty.
+    std::u16string sessionRecordingPath() const;
+    void setSessionRecordingPath(const std::u16string& path);
+
     bool passwordProtection() const;
     void setPasswordProtection(bool enable);
 
@@ -78,6 +133,9 @@ public:
     base::ByteArray passwordHashSalt() const;
     void setPasswordHashSalt(const base::ByteArray& salt);
 
+    uint32_t passwordHashCost() const;
+    void setPasswordHashCost(uint32_t cost);
+
     bool oneTimePassword() const;
     void setOneTimePassword(bool enable);
 
@@ -93,12 +151,6 @@ public:
     bool connConfirm() const;
     void setConnConfirm(bool enable);
 
-    enum class NoUserAction
-    {
-        ACCEPT = 0,
-        REJECT = 1
-    };
-
     NoUserAction connConfirmNoUserAction() const;
     void setConnConfirmNoUserAction(NoUserAction action);
 
@@ -109,6 +161,8 @@ public:
     void setApplicationShutdownDisabled(bool value);
 
 private:
+    std::shared_ptr<const Snapshot> createSnapshot() const;
+
     base::JsonSettings settings_;
 
     DISALLOW_COPY_AND_ASSIGN(SystemSettings);
@@ -233,6 +233,12 @@ ConfigDialog::ConfigDialog(QWidget* parent)
 #elif defined(OS_LINUX)
     ui.combo_video_capturer->addItem(
         QStringLiteral("X11"), static_cast<uint32_t>(base::ScreenCapturer::Type::LINUX_X11));
+
+#if defined(USE_PIPEWIRE)
+    ui.combo_video_capturer->addItem(
+        QStringLiteral("PipeWire"),
+        static_cast<uint32_t>(base::ScreenCapturer::Type::LINUX_PIPEWIRE));
+#endif // defined(USE_PIPEWIRE)
 #elif defined(OS_MAC)
     ui.combo_video_capturer->addItem(
         QStringLiteral("MACOSX"), static_cast<uint32_t>(base::ScreenCapturer::Type::MACOSX));
@@ -437,8 +443,10 @@ void ConfigDialog::onPassProtectClicked()
         {
             base::ByteArray hash;
             base::ByteArray salt;
+            uint32_t cost;
 
-            if (!SystemSettings::createPasswordHash(dialog.newPassword().toStdString(), &hash, &salt))
+            if (!SystemSettings::createPasswordHash(
+                    dialog.newPassword().toStdString(), &hash, &salt, &cost))
             {
                 QMessageBox::warning(this,
                                      tr("Warning"),
@@ -450,6 +458,7 @@ void ConfigDialog::onPassProtectClicked()
             settings.setPasswordProtection(true);
             settings.setPasswordHash(hash);
             settings.setPasswordHashSalt(salt);
+            settings.setPasswordHashCost(cost);
         }
     }
     else
@@ -473,8 +482,10 @@ void ConfigDialog::onChangePassClicked()
     {
         base::ByteArray hash;
         base::ByteArray salt;
+        uint32_t cost;
 
-        if (!SystemSettings::createPasswordHash(dialog.newPassword().toStdString(), &hash, &salt))
+        if (!SystemSettings::createPasswordHash(
+                dialog.newPassword().toStdString(), &hash, &salt, &cost))
         {
             QMessageBox::warning(this,
                                  tr("Warning"),
@@ -487,6 +498,7 @@ void ConfigDialog::onChangePassClicked()
         settings.setPasswordProtection(true);
         settings.setPasswordHash(hash);
         settings.setPasswordHashSalt(salt);
+        settings.setPasswordHashCost(cost);
     }
 
     QTimer::singleShot(0, this, &ConfigDialog::reloadAll);
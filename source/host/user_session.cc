@@ -33,6 +33,9 @@
 #include "base/win/session_status.h"
 #include "host/client_session_desktop.h"
 #include "host/desktop_session_proxy.h"
+#include "host/screen_encoder.h"
+
+#include <algorithm>
 
 namespace host {
 
@@ -60,6 +63,7 @@ const char* routerStateToString(proto::internal::RouterState::State state)
 UserSession::UserSession(std::shared_ptr<base::TaskRunner> task_runner,
                          base::SessionId session_id,
                          std::unique_ptr<base::IpcChannel> channel,
+                         std::shared_ptr<ResourceGovernor> resource_governor,
                          Delegate* delegate)
     : base::ProtobufArena(task_runner),
       task_runner_(task_runner),
@@ -69,6 +73,10 @@ UserSession::UserSession(std::shared_ptr<base::TaskRunner> task_runner,
       desktop_dettach_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner),
       session_id_(session_id),
       password_expire_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner),
+      resource_governor_(std::move(resource_governor)),
+      screen_encoder_pool_(std::make_shared<ScreenEncoderPool>(
+          task_runner, resource_governor_,
+          SystemSettings::snapshot()->share_video_encoders)),
       delegate_(delegate)
 {
     type_ = UserSession::Type::CONSOLE;
@@ -89,16 +97,16 @@ UserSession::UserSession(std::shared_ptr<base::TaskRunner> task_runner,
 
     router_state_.set_state(proto::internal::RouterState::DISABLED);
 
-    SystemSettings settings;
+    std::shared_ptr<const SystemSettings::Snapshot> settings = SystemSettings::snapshot();
 
-    password_enabled_ = settings.oneTimePassword();
-    password_characters_ = settings.oneTimePasswordCharacters();
-    password_length_ = settings.oneTimePasswordLength();
-    password_expire_interval_ = settings.oneTimePasswordExpire();
+    password_enabled_ = settings->one_time_password;
+    password_characters_ = settings->one_time_password_characters;
+    password_length_ = settings->one_time_password_length;
+    password_expire_interval_ = settings->one_time_password_expire;
 
-    connection_confirmation_ = settings.connConfirm();
-    no_user_action_ = settings.connConfirmNoUserAction();
-    auto_confirmation_interval_ = settings.autoConnConfirmInterval();
+    connection_confirmation_ = settings->conn_confirm;
+    no_user_action_ = settings->conn_confirm_no_user_action;
+    auto_confirmation_interval_ = settings->auto_conn_confirm_interval;
 }
 
 UserSession::~UserSession()
@@ -507,12 +515,12 @@ void UserSession::onHostIdChanged(base::HostId host_id)
 
 void UserSession::onSettingsChanged()
 {
-    SystemSettings settings;
+    std::shared_ptr<const SystemSettings::Snapshot> settings = SystemSettings::snapshot();
 
-    bool password_enabled = settings.oneTimePassword();
-    uint32_t password_characters = settings.oneTimePasswordCharacters();
-    int password_length = settings.oneTimePasswordLength();
-    std::chrono::milliseconds password_expire_interval = settings.oneTimePasswordExpire();
+    bool password_enabled = settings->one_time_password;
+    uint32_t password_characters = settings->one_time_password_characters;
+    int password_length = settings->one_time_password_length;
+    std::chrono::milliseconds password_expire_interval = settings->one_time_password_expire;
 
     if (password_enabled_ != password_enabled || password_characters_ != password_characters ||
         password_length_ != password_length || password_expire_interval_ != password_expire_interval)
@@ -530,9 +538,9 @@ void UserSession::onSettingsChanged()
         LOG(LS_INFO) << "No changes in password settings";
     }
 
-    connection_confirmation_ = settings.connConfirm();
-    no_user_action_ = settings.connConfirmNoUserAction();
-    auto_confirmation_interval_ = settings.autoConnConfirmInterval();
+    connection_confirmation_ = settings->conn_confirm;
+    no_user_action_ = settings->conn_confirm_no_user_action;
+    auto_confirmation_interval_ = settings->auto_conn_confirm_interval;
 }
 
 void UserSession::onDisconnected()
@@ -700,14 +708,68 @@ void UserSession::onDesktopSessionStopped()
 
 void UserSession::onScreenCaptured(const base::Frame* frame, const base::MouseCursor* cursor)
 {
+    std::chrono::milliseconds capture_interval = std::chrono::milliseconds::zero();
+    std::chrono::milliseconds preview_interval = std::chrono::milliseconds::zero();
+    std::vector<ScreenEncoder*> screen_encoders;
+
     for (const auto& client : desktop_clients_)
-        static_cast<ClientSessionDesktop*>(client.get())->encodeScreen(frame, cursor);
+    {
+        ClientSessionDesktop* desktop_client = static_cast<ClientSessionDesktop*>(client.get());
+
+        // The clients with the same settings can share the encoder, it encodes the frame once.
+        ScreenEncoder* screen_encoder = desktop_client->screenEncoder();
+        if (screen_encoder && std::find(screen_encoders.begin(), screen_encoders.end(),
+                                        screen_encoder) == screen_encoders.end())
+        {
+            screen_encoders.emplace_back(screen_encoder);
+            screen_encoder->encodeScreen(frame);
+        }
+
+        desktop_client->encodeCursor(cursor);
+
+        // The screen is captured for all clients at once, so the slowest client sets the rate.
+        // The preview clients skip frames instead, they set the rate only if there are no other
+        // clients.
+        if (desktop_client->isPreview())
+            preview_interval = std::max(preview_interval, desktop_client->captureInterval());
+        else
+            capture_interval = std::max(capture_interval, desktop_client->captureInterval());
+    }
+
+    if (capture_interval == std::chrono::milliseconds::zero())
+        capture_interval = preview_interval;
+
+    // On battery the encoders do not send the frames more often anyway.
+    if (capture_interval != std::chrono::milliseconds::zero() &&
+        resource_governor_->isEnergySaving())
+    {
+        capture_interval = std::max(capture_interval, ScreenEncoder::kEnergySavingFrameInterval);
+    }
+
+    if (desktop_session_proxy_ && capture_interval != std::chrono::milliseconds::zero())
+        desktop_session_proxy_->setScreenCaptureInterval(capture_interval);
 }
 
 void UserSession::onAudioCaptured(const proto::AudioPacket& audio_packet)
 {
+    uint32_t audio_bitrate = 0;
+
     for (const auto& client : desktop_clients_)
-        static_cast<ClientSessionDesktop*>(client.get())->encodeAudio(audio_packet);
+    {
+        ClientSessionDesktop* desktop_client = static_cast<ClientSessionDesktop*>(client.get());
+        desktop_client->sendAudio(audio_packet);
+
+        // The audio is encoded once for all clients, so the slowest client sets the bitrate.
+        if (desktop_client->desktopSessionConfig().audio)
+        {
+            const uint32_t bitrate = desktop_client->audioBitrate();
+            if (!audio_bitrate || bitrate < audio_bitrate)
+                audio_bitrate = bitrate;
+        }
+    }
+
+    if (desktop_session_proxy_ && audio_bitrate)
+        desktop_session_proxy_->setAudioBitrate(audio_bitrate);
 }
 
 void UserSession::onCursorPositionChanged(const proto::CursorPosition& cursor_position)
@@ -818,10 +880,16 @@ void UserSession::onClientSessionConfigured()
         system_config.clear_clipboard =
             system_config.clear_clipboard || client_config.clear_clipboard;
 
+        system_config.clipboard = system_config.clipboard || client_config.clipboard;
+
         system_config.cursor_position =
             system_config.cursor_position || client_config.cursor_position;
+
+        system_config.audio = system_config.audio || client_config.audio;
     }
 
+    system_config.audio_frame_duration = SystemSettings::snapshot()->audio_frame_duration;
+
     desktop_session_proxy_->configure(system_config);
     desktop_session_proxy_->captureScreen();
 }
@@ -1122,6 +1190,7 @@ void UserSession::addNewClientSession(std::unique_ptr<ClientSession> client_sess
                 static_cast<ClientSessionDesktop*>(client_session_ptr);
 
             desktop_client_session->setDesktopSessionProxy(desktop_session_proxy_);
+            desktop_client_session->setScreenEncoderPool(screen_encoder_pool_);
 
             if (enable_required)
                 desktop_session_proxy_->control(proto::internal::DesktopControl::ENABLE);
@@ -38,6 +38,9 @@ class ScopedTaskRunner;
 
 namespace host {
 
+class ResourceGovernor;
+class ScreenEncoderPool;
+
 class UserSession
     : public base::ProtobufArena,
       public base::IpcChannel::Listener,
@@ -73,6 +76,7 @@ public:
     UserSession(std::shared_ptr<base::TaskRunner> task_runner,
                 base::SessionId session_id,
                 std::unique_ptr<base::IpcChannel> channel,
+                std::shared_ptr<ResourceGovernor> resource_governor,
                 Delegate* delegate);
     ~UserSession() override;
 
@@ -167,6 +171,8 @@ private:
 
     std::unique_ptr<DesktopSessionManager> desktop_session_;
     std::shared_ptr<DesktopSessionProxy> desktop_session_proxy_;
+    std::shared_ptr<ResourceGovernor> resource_governor_;
+    std::shared_ptr<ScreenEncoderPool> screen_encoder_pool_;
 
     Delegate* delegate_ = nullptr;
 
@@ -27,11 +27,13 @@
 #include "base/files/base_paths.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/string_util.h"
+#include "base/sys_info.h"
 #include "base/win/scoped_impersonator.h"
 #include "base/win/scoped_object.h"
 #include "base/win/session_enumerator.h"
 #include "base/win/session_info.h"
 #include "host/client_session.h"
+#include "host/resource_governor.h"
 #include "host/user_session.h"
 #include "host/user_session_constants.h"
 
@@ -174,6 +176,8 @@ UserSessionManager::UserSessionManager(std::shared_ptr<base::TaskRunner> task_ru
     DCHECK(task_runner_);
 
     scoped_task_runner_ = std::make_unique<base::ScopedTaskRunner>(task_runner_);
+    resource_governor_ = std::make_shared<ResourceGovernor>(task_runner_);
+    resource_governor_->setEnergySaving(base::SysInfo::isOnBatteryPower());
     router_state_.set_state(proto::internal::RouterState::DISABLED);
 }
 
@@ -274,6 +278,15 @@ void UserSessionManager::onRouterStateChanged(const proto::internal::RouterState
         session->onRouterStateChanged(router_state);
 }
 
+void UserSessionManager::onPowerSourceChanged()
+{
+    const bool on_battery = base::SysInfo::isOnBatteryPower();
+    LOG(LS_INFO) << "Power source changed (on battery: " << on_battery << ")";
+
+    // The encoders of all sessions save the energy while the host runs on battery.
+    resource_governor_->setEnergySaving(on_battery);
+}
+
 void UserSessionManager::onHostIdChanged(const std::string& session_name, base::HostId host_id)
 {
     LOG(LS_INFO) << "Set host ID for session '" << session_name << "': " << host_id;
@@ -540,7 +553,7 @@ void UserSessionManager::addUserSession(
     }
 
     std::unique_ptr<UserSession> user_session = std::make_unique<UserSession>(
-        task_runner_, session_id, std::move(channel), this);
+        task_runner_, session_id, std::move(channel), resource_governor_, this);
 
     LOG(LS_INFO) << "Start user session";
     sessions_.emplace_back(std::move(user_session));
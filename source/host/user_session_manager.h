@@ -30,6 +30,7 @@ class ScopedTaskRunner;
 
 namespace host {
 
+class ResourceGovernor;
 class UserSession;
 
 class UserSessionManager
@@ -53,6 +54,9 @@ public:
     bool start(Delegate* delegate);
     void onUserSessionEvent(base::win::SessionStatus status, base::SessionId session_id);
     void onRouterStateChanged(const proto::internal::RouterState& router_state);
+
+    // Called when the computer switches between the battery and the power line.
+    void onPowerSourceChanged();
     void onHostIdChanged(const std::string& session_name, base::HostId host_id);
     void onSettingsChanged();
     void onClientSession(std::unique_ptr<ClientSession> client_session);
@@ -76,6 +80,9 @@ private:
     std::shared_ptr<base::TaskRunner> task_runner_;
     std::unique_ptr<base::ScopedTaskRunner> scoped_task_runner_;
     std::unique_ptr<base::IpcServer> ipc_server_;
+
+    // Shares the processor between the screen encoders of all sessions.
+    std::shared_ptr<ResourceGovernor> resource_governor_;
     std::vector<std::unique_ptr<UserSession>> sessions_;
     Delegate* delegate_ = nullptr;
 
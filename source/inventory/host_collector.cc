@@ -0,0 +1,217 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "inventory/host_collector.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/peer/client_authenticator.h"
+#include "proto/system_info.pb.h"
+
+namespace inventory {
+
+HostCollector::HostCollector(const Params& params,
+                             std::shared_ptr<base::TaskRunner> task_runner,
+                             Delegate* delegate)
+    : params_(params),
+      task_runner_(std::move(task_runner)),
+      delegate_(delegate),
+      timeout_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner_)
+{
+    DCHECK(task_runner_);
+    DCHECK(delegate_);
+}
+
+HostCollector::~HostCollector() = default;
+
+void HostCollector::start(base::HostId host_id)
+{
+    DCHECK_NE(host_id, base::kInvalidHostId);
+
+    result_.host_id = host_id;
+    result_.system_info.reserve(params_.categories.size());
+
+    timeout_timer_.start(params_.timeout, [this]()
+    {
+        LOG(LS_WARNING) << "Timeout for host " << result_.host_id;
+        finish(Status::TIMEOUT);
+    });
+
+    router_controller_ =
+        std::make_unique<client::RouterController>(params_.router_config, task_runner_);
+    router_controller_->connectTo(host_id, this);
+}
+
+// static
+const char* HostCollector::statusToString(Status status)
+{
+    switch (status)
+    {
+        case Status::SUCCESS:
+            return "ok";
+
+        case Status::HOST_OFFLINE:
+            return "offline";
+
+        case Status::ROUTER_ERROR:
+            return "router_error";
+
+        case Status::ACCESS_DENIED:
+            return "access_denied";
+
+        case Status::NETWORK_ERROR:
+            return "network_error";
+
+        case Status::TIMEOUT:
+            return "timeout";
+
+        default:
+            return "unknown";
+    }
+}
+
+void HostCollector::onHostConnected(std::unique_ptr<base::NetworkChannel> channel)
+{
+    task_runner_->deleteSoon(std::move(router_controller_));
+
+    channel_ = std::move(channel);
+    channel_->setNoDelay(true);
+
+    authenticator_ = std::make_unique<base::ClientAuthenticator>(task_runner_);
+
+    authenticator_->setIdentify(proto::IDENTIFY_SRP);
+    authenticator_->setUserName(params_.username);
+    authenticator_->setPassword(params_.password);
+    authenticator_->setSessionType(proto::SESSION_TYPE_SYSTEM_INFO);
+
+    authenticator_->start(std::move(channel_),
+                          [this](base::ClientAuthenticator::ErrorCode error_code)
+    {
+        if (error_code == base::ClientAuthenticator::ErrorCode::SUCCESS)
+        {
+            channel_ = authenticator_->takeChannel();
+            channel_->setListener(this);
+
+            if (authenticator_->peerVersion() >= base::Version(2, 0, 0))
+                channel_->setOwnKeepAlive(true);
+            else
+                channel_->setTcpKeepAlive(true);
+
+            const bool has_chunking = authenticator_->peerVersion() >= base::Version(2, 3, 0);
+            channel_->setMessageChunking(has_chunking);
+            channel_->setMessageCompression(has_chunking);
+
+            channel_->resume();
+            sendNextRequest();
+        }
+        else
+        {
+            LOG(LS_WARNING) << "Authentication failed for host " << result_.host_id << ": "
+                            << base::ClientAuthenticator::errorToString(error_code);
+            finish(Status::ACCESS_DENIED);
+        }
+
+        task_runner_->deleteSoon(std::move(authenticator_));
+    });
+}
+
+void HostCollector::onErrorOccurred(const client::RouterController::Error& error)
+{
+    switch (error.type)
+    {
+        case client::RouterController::ErrorType::AUTHENTICATION:
+            LOG(LS_WARNING) << "Authentication on the router failed";
+            finish(Status::ACCESS_DENIED);
+            break;
+
+        case client::RouterController::ErrorType::NETWORK:
+            finish(Status::NETWORK_ERROR);
+            break;
+
+        default:
+            if (error.code.router == client::RouterController::ErrorCode::PEER_NOT_FOUND)
+            {
+                finish(Status::HOST_OFFLINE);
+                break;
+            }
+
+            LOG(LS_WARNING) << "Router error for host " << result_.host_id << ": "
+                            << static_cast<int>(error.code.router);
+            finish(Status::ROUTER_ERROR);
+            break;
+    }
+}
+
+void HostCollector::onConnected()
+{
+    NOTREACHED();
+}
+
+void HostCollector::onDisconnected(base::NetworkChannel::ErrorCode error_code)
+{
+    LOG(LS_WARNING) << "Connection to host " << result_.host_id << " is lost ("
+                    << base::NetworkChannel::errorToString(error_code) << ")";
+    finish(Status::NETWORK_ERROR);
+}
+
+void HostCollector::onMessageReceived(const base::ByteArray& buffer)
+{
+    if (finished_)
+        return;
+
+    // The host replies to the requests in order, the reply is stored as is.
+    result_.system_info.emplace_back(buffer);
+
+    if (result_.system_info.size() < params_.categories.size())
+        sendNextRequest();
+    else
+        finish(Status::SUCCESS);
+}
+
+void HostCollector::onMessageWritten(size_t /* pending */)
+{
+    // Nothing
+}
+
+void HostCollector::sendNextRequest()
+{
+    proto::system_info::SystemInfoRequest request;
+    request.set_category(params_.categories[result_.system_info.size()]);
+
+    channel_->send(base::serialize(request));
+}
+
+void HostCollector::finish(Status status)
+{
+    if (finished_)
+        return;
+
+    finished_ = true;
+    timeout_timer_.stop();
+
+    result_.status = status;
+
+    if (channel_)
+        task_runner_->deleteSoon(std::move(channel_));
+    if (router_controller_)
+        task_runner_->deleteSoon(std::move(router_controller_));
+
+    delegate_->onHostFinished(this, result_);
+}
+
+} // namespace inventory
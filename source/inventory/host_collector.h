@@ -0,0 +1,123 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef INVENTORY__HOST_COLLECTOR_H
+#define INVENTORY__HOST_COLLECTOR_H
+
+#include "base/waitable_timer.h"
+#include "base/net/network_channel.h"
+#include "client/router_controller.h"
+
+#include <string>
+#include <vector>
+
+namespace base {
+class ClientAuthenticator;
+} // namespace base
+
+namespace inventory {
+
+// Connects to one host through the router and requests the system info categories one by one.
+class HostCollector
+    : public client::RouterController::Delegate,
+      public base::NetworkChannel::Listener
+{
+public:
+    struct Params
+    {
+        client::RouterConfig router_config;
+        std::u16string username;
+        std::u16string password;
+
+        // Categories from common/system_info_constants.h.
+        std::vector<std::string> categories;
+
+        // Time for the whole collection, including the connection.
+        std::chrono::seconds timeout{ 120 };
+    };
+
+    enum class Status
+    {
+        SUCCESS,
+        HOST_OFFLINE,
+        ROUTER_ERROR,
+        ACCESS_DENIED,
+        NETWORK_ERROR,
+        TIMEOUT
+    };
+
+    struct Result
+    {
+        base::HostId host_id = base::kInvalidHostId;
+        Status status = Status::SUCCESS;
+
+        // Serialized proto::system_info::SystemInfo for each category of Params.
+        std::vector<base::ByteArray> system_info;
+    };
+
+    class Delegate
+    {
+    public:
+        virtual ~Delegate() = default;
+
+        // The collector can be deleted with base::TaskRunner::deleteSoon from the callback.
+        virtual void onHostFinished(HostCollector* collector, const Result& result) = 0;
+    };
+
+    HostCollector(const Params& params,
+                  std::shared_ptr<base::TaskRunner> task_runner,
+                  Delegate* delegate);
+    ~HostCollector() override;
+
+    void start(base::HostId host_id);
+
+    static const char* statusToString(Status status);
+
+protected:
+    // client::RouterController::Delegate implementation.
+    void onHostConnected(std::unique_ptr<base::NetworkChannel> channel) override;
+    void onErrorOccurred(const client::RouterController::Error& error) override;
+
+    // base::NetworkChannel::Listener implementation.
+    void onConnected() override;
+    void onDisconnected(base::NetworkChannel::ErrorCode error_code) override;
+    void onMessageReceived(const base::ByteArray& buffer) override;
+    void onMessageWritten(size_t pending) override;
+
+private:
+    void sendNextRequest();
+    void finish(Status status);
+
+    const Params params_;
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    Delegate* delegate_;
+
+    std::unique_ptr<client::RouterController> router_controller_;
+    std::unique_ptr<base::ClientAuthenticator> authenticator_;
+    std::unique_ptr<base::NetworkChannel> channel_;
+    base::WaitableTimer timeout_timer_;
+
+    Result result_;
+    bool finished_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(HostCollector);
+};
+
+} // namespace inventory
+
+#endif // INVENTORY__HOST_COLLECTOR_H
@@ -0,0 +1,144 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "inventory/inventory.h"
+
+#include "base/base64.h"
+#include "base/logging.h"
+#include "base/task_runner.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace inventory {
+
+Inventory::Inventory(const Config& config, std::shared_ptr<base::TaskRunner> task_runner)
+    : config_(config),
+      task_runner_(std::move(task_runner))
+{
+    DCHECK(task_runner_);
+    DCHECK_GT(config_.concurrency, 0);
+    DCHECK_EQ(config_.category_names.size(), config_.collector.categories.size());
+}
+
+Inventory::~Inventory() = default;
+
+bool Inventory::start()
+{
+    output_.open(config_.output_file, std::ofstream::binary | std::ofstream::trunc);
+    if (!output_.is_open())
+    {
+        LOG(LS_ERROR) << "Unable to create output file: " << config_.output_file;
+        return false;
+    }
+
+    output_ << "host_id\tstatus";
+    for (const auto& name : config_.category_names)
+        output_ << '\t' << name;
+    output_ << '\n';
+
+    LOG(LS_INFO) << "Collecting system info from " << config_.host_ids.size() << " hosts ("
+                 << config_.concurrency << " at a time)";
+
+    start_time_ = std::chrono::steady_clock::now();
+
+    if (config_.host_ids.empty())
+    {
+        task_runner_->postQuit();
+        return true;
+    }
+
+    startNextHosts();
+    return true;
+}
+
+void Inventory::onHostFinished(HostCollector* collector, const HostCollector::Result& result)
+{
+    writeResult(result);
+
+    ++finished_hosts_;
+    if (result.status != HostCollector::Status::SUCCESS)
+        ++failed_hosts_;
+
+    auto it = std::find_if(collectors_.begin(), collectors_.end(),
+                           [collector](const std::unique_ptr<HostCollector>& item)
+    {
+        return item.get() == collector;
+    });
+
+    if (it != collectors_.end())
+    {
+        // The collector is still on the call stack.
+        task_runner_->deleteSoon(std::move(*it));
+        collectors_.erase(it);
+    }
+
+    if (finished_hosts_ == config_.host_ids.size())
+    {
+        output_.flush();
+
+        const auto duration = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now() - start_time_);
+
+        std::cout << "Finished " << finished_hosts_ << " hosts (" << failed_hosts_
+                  << " failed) in " << duration.count() << " s" << std::endl;
+
+        task_runner_->postQuit();
+        return;
+    }
+
+    startNextHosts();
+}
+
+void Inventory::startNextHosts()
+{
+    const size_t concurrency = static_cast<size_t>(config_.concurrency);
+
+    while (collectors_.size() < concurrency && next_host_ < config_.host_ids.size())
+    {
+        std::unique_ptr<HostCollector> collector =
+            std::make_unique<HostCollector>(config_.collector, task_runner_, this);
+
+        HostCollector* collector_ptr = collector.get();
+        collectors_.emplace_back(std::move(collector));
+
+        collector_ptr->start(config_.host_ids[next_host_++]);
+    }
+}
+
+void Inventory::writeResult(const HostCollector::Result& result)
+{
+    output_ << base::hostIdToString(result.host_id) << '\t'
+            << HostCollector::statusToString(result.status);
+
+    for (size_t i = 0; i < config_.collector.categories.size(); ++i)
+    {
+        output_ << '\t';
+
+        if (i < result.system_info.size())
+        {
+            const base::ByteArray& system_info = result.system_info[i];
+            output_ << base::Base64::encode(std::string_view(
+                reinterpret_cast<const char*>(system_info.data()), system_info.size()));
+        }
+    }
+
+    output_ << '\n';
+}
+
+} // namespace inventory
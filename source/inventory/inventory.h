@@ -0,0 +1,81 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef INVENTORY__INVENTORY_H
+#define INVENTORY__INVENTORY_H
+
+#include "inventory/host_collector.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace inventory {
+
+// Collects the system info from a list of hosts, with at most |concurrency| hosts at a time, and
+// writes a row of the output file for each host as soon as it is finished.
+//
+// The output file is tab-separated. The columns are the host ID, the status and one column per
+// requested category with the serialized proto::system_info::SystemInfo encoded in Base64.
+class Inventory : public HostCollector::Delegate
+{
+public:
+    struct Config
+    {
+        HostCollector::Params collector;
+        std::vector<base::HostId> host_ids;
+        std::filesystem::path output_file;
+
+        // Names of the categories for the header of the output file.
+        std::vector<std::string> category_names;
+
+        int concurrency = 64;
+    };
+
+    Inventory(const Config& config, std::shared_ptr<base::TaskRunner> task_runner);
+    ~Inventory() override;
+
+    // Returns false if the output file cannot be created. When all hosts are finished, quit is
+    // posted to the message loop.
+    bool start();
+
+protected:
+    // HostCollector::Delegate implementation.
+    void onHostFinished(HostCollector* collector, const HostCollector::Result& result) override;
+
+private:
+    void startNextHosts();
+    void writeResult(const HostCollector::Result& result);
+
+    const Config config_;
+    std::shared_ptr<base::TaskRunner> task_runner_;
+
+    std::ofstream output_;
+    std::vector<std::unique_ptr<HostCollector>> collectors_;
+
+    size_t next_host_ = 0;
+    size_t finished_hosts_ = 0;
+    size_t failed_hosts_ = 0;
+
+    std::chrono::steady_clock::time_point start_time_;
+
+    DISALLOW_COPY_AND_ASSIGN(Inventory);
+};
+
+} // namespace inventory
+
+#endif // INVENTORY__INVENTORY_H
@@ -0,0 +1,271 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/command_line.h"
+#include "base/logging.h"
+#include "base/crypto/scoped_crypto_initializer.h"
+#include "base/files/file_util.h"
+#include "base/message_loop/message_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/unicode.h"
+#include "build/build_config.h"
+#include "common/system_info_constants.h"
+#include "inventory/inventory.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+struct Category
+{
+    const char* name;
+    const char* guid;
+};
+
+// Event logs are requested by pages and are not supported.
+const Category kCategories[] =
+{
+    { "summary", common::kSystemInfo_Summary },
+    { "devices", common::kSystemInfo_Devices },
+    { "video-adapters", common::kSystemInfo_VideoAdapters },
+    { "monitors", common::kSystemInfo_Monitors },
+    { "printers", common::kSystemInfo_Printers },
+    { "power-options", common::kSystemInfo_PowerOptions },
+    { "drivers", common::kSystemInfo_Drivers },
+    { "services", common::kSystemInfo_Services },
+    { "environment-variables", common::kSystemInfo_EnvironmentVariables },
+    { "network-adapters", common::kSystemInfo_NetworkAdapters },
+    { "routes", common::kSystemInfo_Routes },
+    { "connections", common::kSystemInfo_Connections },
+    { "network-shares", common::kSystemInfo_NetworkShares }
+};
+
+void showHelp()
+{
+    std::cout << "aspia_inventory [switches]" << std::endl
+        << "Collects system info from many hosts through a router." << std::endl
+        << "Available switches:" << std::endl
+        << '\t' << "--router-address=<address>" << '\t' << "Router address (required)" << std::endl
+        << '\t' << "--router-port=<port>" << '\t' << "Router port (default: "
+        << DEFAULT_ROUTER_TCP_PORT << ")" << std::endl
+        << '\t' << "--router-username=<name>" << '\t' << "User of the router (required)"
+        << std::endl
+        << '\t' << "--router-password=<password>" << '\t' << "Password of the router user "
+        << "(required)" << std::endl
+        << '\t' << "--username=<name>" << '\t' << "User of the hosts (required)" << std::endl
+        << '\t' << "--password=<password>" << '\t' << "Password of the hosts user (required)"
+        << std::endl
+        << '\t' << "--hosts-file=<file>" << '\t' << "File with a host ID on each line (required)"
+        << std::endl
+        << '\t' << "--output=<file>" << '\t' << "Output file (required)" << std::endl
+        << '\t' << "--categories=<list>" << '\t' << "Comma-separated categories (default: "
+        << "summary)" << std::endl
+        << '\t' << "--concurrency=<count>" << '\t' << "Hosts collected at a time (default: 64)"
+        << std::endl
+        << '\t' << "--timeout=<seconds>" << '\t' << "Time limit for each host (default: 120)"
+        << std::endl
+        << '\t' << "--help" << '\t' << "Show help" << std::endl;
+
+    std::cout << "Categories:";
+    for (const auto& category : kCategories)
+        std::cout << ' ' << category.name;
+    std::cout << std::endl;
+}
+
+bool readNumber(const base::CommandLine& command_line, std::u16string_view name, int min_value,
+                int* value)
+{
+    if (!command_line.hasSwitch(name))
+        return true;
+
+    int result = 0;
+    if (!base::stringToInt(command_line.switchValue(name), &result) || result < min_value)
+    {
+        std::cout << "Invalid value of --" << base::utf8FromUtf16(name) << std::endl;
+        return false;
+    }
+
+    *value = result;
+    return true;
+}
+
+bool readCategories(const base::CommandLine& command_line, inventory::Inventory::Config* config)
+{
+    std::string list = "summary";
+    if (command_line.hasSwitch(u"categories"))
+        list = base::utf8FromUtf16(command_line.switchValue(u"categories"));
+
+    for (const auto& name :
+         base::splitString(list, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY))
+    {
+        auto category = std::find_if(std::begin(kCategories), std::end(kCategories),
+                                     [&name](const Category& item) { return name == item.name; });
+        if (category == std::end(kCategories))
+        {
+            std::cout << "Unknown category: " << name << std::endl;
+            return false;
+        }
+
+        config->category_names.emplace_back(category->name);
+        config->collector.categories.emplace_back(category->guid);
+    }
+
+    if (config->collector.categories.empty())
+    {
+        std::cout << "No categories" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool readHosts(const std::filesystem::path& file_path, std::vector<base::HostId>* host_ids)
+{
+    std::string buffer;
+    if (!base::readFile(file_path, &buffer))
+    {
+        std::cout << "Unable to read the hosts file" << std::endl;
+        return false;
+    }
+
+    for (const auto& line :
+         base::splitString(buffer, "\r\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY))
+    {
+        base::HostId host_id = base::stringToHostId(line);
+        if (host_id == base::kInvalidHostId)
+        {
+            std::cout << "Invalid host ID: " << line << std::endl;
+            return false;
+        }
+
+        host_ids->emplace_back(host_id);
+    }
+
+    return true;
+}
+
+bool readConfig(const base::CommandLine& command_line, inventory::Inventory::Config* config)
+{
+    client::RouterConfig& router_config = config->collector.router_config;
+
+    router_config.address = command_line.switchValue(u"router-address");
+    router_config.username = command_line.switchValue(u"router-username");
+    router_config.password = command_line.switchValue(u"router-password");
+    config->collector.username = command_line.switchValue(u"username");
+    config->collector.password = command_line.switchValue(u"password");
+    config->output_file = command_line.switchValuePath(u"output");
+
+    const std::filesystem::path hosts_file = command_line.switchValuePath(u"hosts-file");
+
+    if (router_config.address.empty() || router_config.username.empty() ||
+        router_config.password.empty() || config->collector.username.empty() ||
+        config->collector.password.empty() || hosts_file.empty() || config->output_file.empty())
+    {
+        std::cout << "Router address, user names, passwords, hosts file and output file are "
+                  << "required" << std::endl;
+        return false;
+    }
+
+    int router_port = DEFAULT_ROUTER_TCP_PORT;
+    int timeout = static_cast<int>(config->collector.timeout.count());
+
+    if (!readNumber(command_line, u"router-port", 1, &router_port) ||
+        !readNumber(command_line, u"concurrency", 1, &config->concurrency) ||
+        !readNumber(command_line, u"timeout", 1, &timeout))
+    {
+        return false;
+    }
+
+    if (router_port > 65535)
+    {
+        std::cout << "Invalid router port" << std::endl;
+        return false;
+    }
+
+    router_config.port = static_cast<uint16_t>(router_port);
+    config->collector.timeout = std::chrono::seconds(timeout);
+
+    return readCategories(command_line, config) && readHosts(hosts_file, &config->host_ids);
+}
+
+int runInventory()
+{
+    base::CommandLine* command_line = base::CommandLine::forCurrentProcess();
+
+    if (command_line->hasSwitch(u"help"))
+    {
+        showHelp();
+        return 0;
+    }
+
+    inventory::Inventory::Config config;
+    if (!readConfig(*command_line, &config))
+    {
+        showHelp();
+        return 1;
+    }
+
+    std::unique_ptr<base::ScopedCryptoInitializer> crypto_initializer =
+        std::make_unique<base::ScopedCryptoInitializer>();
+
+    std::unique_ptr<base::MessageLoop> message_loop =
+        std::make_unique<base::MessageLoop>(base::MessageLoop::Type::ASIO);
+
+    std::unique_ptr<inventory::Inventory> inventory =
+        std::make_unique<inventory::Inventory>(config, message_loop->taskRunner());
+
+    int result = 0;
+
+    if (inventory->start())
+        message_loop->run();
+    else
+        result = 1;
+
+    inventory.reset();
+    message_loop.reset();
+    crypto_initializer.reset();
+    return result;
+}
+
+} // namespace
+
+#if defined(OS_WIN)
+int wmain()
+{
+    base::initLogging();
+    base::CommandLine::init(0, nullptr); // On Windows ignores arguments.
+
+    int result = runInventory();
+
+    base::shutdownLogging();
+    return result;
+}
+#else
+int main(int argc, const char* const* argv)
+{
+    base::initLogging();
+    base::CommandLine::init(argc, argv);
+
+    int result = runInventory();
+
+    base::shutdownLogging();
+    return result;
+}
+#endif
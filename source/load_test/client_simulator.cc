@@ -0,0 +1,217 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "load_test/client_simulator.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "load_test/host_simulator.h"
+#include "proto/router_peer.pb.h"
+
+namespace load_test {
+
+// Receives the frames of the host. The router connection is closed after the relay connection
+// is established, as the real client does.
+class ClientSimulator::Receiver : public base::NetworkChannel::Listener
+{
+public:
+    Receiver(std::unique_ptr<base::NetworkChannel> channel, Statistics* statistics)
+        : channel_(std::move(channel)),
+          statistics_(statistics)
+    {
+        channel_->setListener(this);
+        channel_->resume();
+    }
+
+    ~Receiver() override = default;
+
+protected:
+    // base::NetworkChannel::Listener implementation.
+    void onConnected() override
+    {
+        // Nothing
+    }
+
+    void onDisconnected(base::NetworkChannel::ErrorCode error_code) override
+    {
+        LOG(LS_WARNING) << "Relay connection is lost ("
+                        << base::NetworkChannel::errorToString(error_code) << ")";
+        ++statistics_->counters.relay_errors;
+    }
+
+    void onMessageReceived(const base::ByteArray& buffer) override
+    {
+        statistics_->frame_delivery.add(elapsedSince(HostSimulator::frameTime(buffer)));
+        statistics_->counters.bytes_received += static_cast<int64_t>(buffer.size());
+        ++statistics_->counters.frames_received;
+    }
+
+    void onMessageWritten(size_t /* pending */) override
+    {
+        // Nothing
+    }
+
+private:
+    std::unique_ptr<base::NetworkChannel> channel_;
+    Statistics* statistics_;
+
+    DISALLOW_COPY_AND_ASSIGN(Receiver);
+};
+
+ClientSimulator::ClientSimulator(const Params& params,
+                                 std::shared_ptr<base::TaskRunner> task_runner,
+                                 Statistics* statistics)
+    : params_(params),
+      task_runner_(std::move(task_runner)),
+      statistics_(statistics)
+{
+    DCHECK(task_runner_);
+    DCHECK(statistics_);
+}
+
+ClientSimulator::~ClientSimulator() = default;
+
+void ClientSimulator::start(base::HostId host_id)
+{
+    DCHECK_NE(host_id, base::kInvalidHostId);
+
+    host_id_ = host_id;
+    ++statistics_->counters.clients_started;
+    connect_start_time_ = Clock::now();
+
+    channel_ = std::make_unique<base::NetworkChannel>();
+    channel_->setListener(this);
+    channel_->connect(params_.router_address, params_.router_port);
+}
+
+void ClientSimulator::onConnected()
+{
+    channel_->setOwnKeepAlive(true);
+    channel_->setNoDelay(true);
+
+    authenticator_ = std::make_unique<base::ClientAuthenticator>(task_runner_);
+
+    authenticator_->setIdentify(proto::IDENTIFY_SRP);
+    authenticator_->setUserName(params_.username);
+    authenticator_->setPassword(params_.password);
+    authenticator_->setSessionType(proto::ROUTER_SESSION_CLIENT);
+
+    authenticator_->start(std::move(channel_),
+                          [this](base::ClientAuthenticator::ErrorCode error_code)
+    {
+        if (error_code == base::ClientAuthenticator::ErrorCode::SUCCESS)
+        {
+            statistics_->client_handshake.add(elapsedSince(connect_start_time_));
+
+            channel_ = authenticator_->takeChannel();
+            channel_->setListener(this);
+            channel_->resume();
+
+            proto::PeerToRouter message;
+            message.mutable_connection_request()->set_host_id(host_id_);
+
+            request_time_ = Clock::now();
+            channel_->send(base::serialize(message));
+        }
+        else
+        {
+            LOG(LS_WARNING) << "Authentication failed: "
+                            << base::ClientAuthenticator::errorToString(error_code);
+            onFailed();
+        }
+
+        task_runner_->deleteSoon(std::move(authenticator_));
+    });
+}
+
+void ClientSimulator::onDisconnected(base::NetworkChannel::ErrorCode error_code)
+{
+    // The router may close the connection after the offer is sent.
+    if (relay_peer_)
+        return;
+
+    LOG(LS_WARNING) << "Connection to the router is lost ("
+                    << base::NetworkChannel::errorToString(error_code) << ")";
+    onFailed();
+}
+
+void ClientSimulator::onMessageReceived(const base::ByteArray& buffer)
+{
+    proto::RouterToPeer message;
+    if (!base::parse(buffer, &message))
+    {
+        LOG(LS_ERROR) << "Invalid message from router";
+        return;
+    }
+
+    if (!message.has_connection_offer() || relay_peer_)
+    {
+        LOG(LS_WARNING) << "Unhandled message from router";
+        return;
+    }
+
+    const proto::ConnectionOffer& offer = message.connection_offer();
+
+    if (offer.error_code() != proto::ConnectionOffer::SUCCESS ||
+        offer.peer_role() != proto::ConnectionOffer::CLIENT)
+    {
+        LOG(LS_WARNING) << "Connection offer rejected: " << offer.error_code();
+        onFailed();
+        return;
+    }
+
+    statistics_->connection_offer.add(elapsedSince(request_time_));
+    ++statistics_->counters.clients_connected;
+    offer_time_ = Clock::now();
+
+    relay_peer_ = std::make_unique<base::RelayPeer>();
+    relay_peer_->start(offer.relay(), this);
+}
+
+void ClientSimulator::onMessageWritten(size_t /* pending */)
+{
+    // Nothing
+}
+
+void ClientSimulator::onRelayConnectionReady(std::unique_ptr<base::NetworkChannel> channel)
+{
+    statistics_->relay_connect.add(elapsedSince(offer_time_));
+    ++statistics_->counters.relay_connections;
+
+    receiver_ = std::make_unique<Receiver>(std::move(channel), statistics_);
+
+    if (channel_)
+        task_runner_->deleteSoon(std::move(channel_));
+}
+
+void ClientSimulator::onRelayConnectionError()
+{
+    ++statistics_->counters.relay_errors;
+    onFailed();
+}
+
+void ClientSimulator::onFailed()
+{
+    if (failed_)
+        return;
+
+    failed_ = true;
+    ++statistics_->counters.clients_failed;
+}
+
+} // namespace load_test
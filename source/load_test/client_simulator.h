@@ -0,0 +1,88 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef LOAD_TEST__CLIENT_SIMULATOR_H
+#define LOAD_TEST__CLIENT_SIMULATOR_H
+
+#include "base/net/network_channel.h"
+#include "base/peer/client_authenticator.h"
+#include "base/peer/host_id.h"
+#include "base/peer/relay_peer.h"
+#include "load_test/statistics.h"
+
+namespace load_test {
+
+// Simulates a client: authenticates on the router with a user account, requests a connection to
+// the host and receives the frames of the host through the relay.
+class ClientSimulator
+    : public base::NetworkChannel::Listener,
+      public base::RelayPeer::Delegate
+{
+public:
+    struct Params
+    {
+        std::u16string router_address;
+        uint16_t router_port = 0;
+        std::u16string username;
+        std::u16string password;
+    };
+
+    ClientSimulator(const Params& params,
+                    std::shared_ptr<base::TaskRunner> task_runner,
+                    Statistics* statistics);
+    ~ClientSimulator();
+
+    void start(base::HostId host_id);
+
+protected:
+    // base::NetworkChannel::Listener implementation.
+    void onConnected() override;
+    void onDisconnected(base::NetworkChannel::ErrorCode error_code) override;
+    void onMessageReceived(const base::ByteArray& buffer) override;
+    void onMessageWritten(size_t pending) override;
+
+    // base::RelayPeer::Delegate implementation.
+    void onRelayConnectionReady(std::unique_ptr<base::NetworkChannel> channel) override;
+    void onRelayConnectionError() override;
+
+private:
+    class Receiver;
+
+    void onFailed();
+
+    const Params params_;
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    Statistics* statistics_;
+    base::HostId host_id_ = base::kInvalidHostId;
+
+    std::unique_ptr<base::NetworkChannel> channel_;
+    std::unique_ptr<base::ClientAuthenticator> authenticator_;
+    std::unique_ptr<base::RelayPeer> relay_peer_;
+    std::unique_ptr<Receiver> receiver_;
+
+    TimePoint connect_start_time_;
+    TimePoint request_time_;
+    TimePoint offer_time_;
+    bool failed_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(ClientSimulator);
+};
+
+} // namespace load_test
+
+#endif // LOAD_TEST__CLIENT_SIMULATOR_H
@@ -0,0 +1,287 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "load_test/host_simulator.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "proto/router_peer.pb.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace load_test {
+
+namespace {
+
+// If more frames are waiting to be sent, the next frame is skipped as the real host does when
+// the network is slower than the encoder.
+const size_t kMaxPendingFrames = 4;
+
+} // namespace
+
+class HostSimulator::Stream : public base::NetworkChannel::Listener
+{
+public:
+    explicit Stream(std::unique_ptr<base::NetworkChannel> channel)
+        : channel_(std::move(channel))
+    {
+        channel_->setListener(this);
+        channel_->resume();
+    }
+
+    ~Stream() override = default;
+
+    bool isClosed() const { return closed_; }
+    bool isBusy() const { return pending_ >= kMaxPendingFrames; }
+
+    void send(base::ByteArray&& frame)
+    {
+        ++pending_;
+        channel_->send(std::move(frame));
+    }
+
+protected:
+    // base::NetworkChannel::Listener implementation.
+    void onConnected() override
+    {
+        // Nothing
+    }
+
+    void onDisconnected(base::NetworkChannel::ErrorCode /* error_code */) override
+    {
+        closed_ = true;
+    }
+
+    void onMessageReceived(const base::ByteArray& /* buffer */) override
+    {
+        // Nothing
+    }
+
+    void onMessageWritten(size_t pending) override
+    {
+        pending_ = pending;
+    }
+
+private:
+    std::unique_ptr<base::NetworkChannel> channel_;
+    size_t pending_ = 0;
+    bool closed_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(Stream);
+};
+
+HostSimulator::HostSimulator(const Params& params,
+                             std::shared_ptr<base::TaskRunner> task_runner,
+                             Statistics* statistics,
+                             Delegate* delegate)
+    : params_(params),
+      task_runner_(task_runner),
+      statistics_(statistics),
+      delegate_(delegate),
+      peer_manager_(std::make_unique<base::RelayPeerManager>(task_runner, this)),
+      frame_timer_(base::WaitableTimer::Type::REPEATED, task_runner)
+{
+    DCHECK(task_runner_);
+    DCHECK(statistics_);
+    DCHECK(delegate_);
+}
+
+HostSimulator::~HostSimulator() = default;
+
+void HostSimulator::start()
+{
+    ++statistics_->counters.hosts_started;
+    connect_start_time_ = Clock::now();
+
+    channel_ = std::make_unique<base::NetworkChannel>();
+    channel_->setListener(this);
+    channel_->connect(params_.router_address, params_.router_port);
+}
+
+// static
+base::ByteArray HostSimulator::createFrame(size_t size)
+{
+    int64_t time = Clock::now().time_since_epoch().count();
+
+    base::ByteArray frame(std::max(size, sizeof(time)));
+    memcpy(frame.data(), &time, sizeof(time));
+    return frame;
+}
+
+// static
+TimePoint HostSimulator::frameTime(const base::ByteArray& frame)
+{
+    int64_t time = 0;
+
+    if (frame.size() >= sizeof(time))
+        memcpy(&time, frame.data(), sizeof(time));
+
+    return TimePoint(Clock::duration(time));
+}
+
+void HostSimulator::onConnected()
+{
+    channel_->setOwnKeepAlive(true);
+    channel_->setNoDelay(true);
+
+    authenticator_ = std::make_unique<base::ClientAuthenticator>(task_runner_);
+
+    authenticator_->setIdentify(proto::IDENTIFY_ANONYMOUS);
+    authenticator_->setPeerPublicKey(params_.router_public_key);
+    authenticator_->setSessionType(proto::ROUTER_SESSION_HOST);
+
+    authenticator_->start(std::move(channel_),
+                          [this](base::ClientAuthenticator::ErrorCode error_code)
+    {
+        if (error_code == base::ClientAuthenticator::ErrorCode::SUCCESS)
+        {
+            statistics_->host_handshake.add(elapsedSince(connect_start_time_));
+
+            channel_ = authenticator_->takeChannel();
+            channel_->setListener(this);
+            channel_->resume();
+
+            // Each simulated host requests a new ID, so the router database grows with each run.
+            proto::PeerToRouter message;
+            message.mutable_host_id_request()->set_type(proto::HostIdRequest::NEW_ID);
+
+            id_request_time_ = Clock::now();
+            channel_->send(base::serialize(message));
+        }
+        else
+        {
+            LOG(LS_WARNING) << "Authentication failed: "
+                            << base::ClientAuthenticator::errorToString(error_code);
+            onFailed();
+        }
+
+        task_runner_->deleteSoon(std::move(authenticator_));
+    });
+}
+
+void HostSimulator::onDisconnected(base::NetworkChannel::ErrorCode error_code)
+{
+    LOG(LS_WARNING) << "Connection to the router is lost ("
+                    << base::NetworkChannel::errorToString(error_code) << ")";
+    onFailed();
+}
+
+void HostSimulator::onMessageReceived(const base::ByteArray& buffer)
+{
+    proto::RouterToPeer message;
+    if (!base::parse(buffer, &message))
+    {
+        LOG(LS_ERROR) << "Invalid message from router";
+        return;
+    }
+
+    if (message.has_host_id_response())
+    {
+        const proto::HostIdResponse& response = message.host_id_response();
+
+        if (response.error_code() != proto::HostIdResponse::SUCCESS ||
+            response.host_id() == base::kInvalidHostId)
+        {
+            LOG(LS_WARNING) << "Host ID request failed: " << response.error_code();
+            onFailed();
+            return;
+        }
+
+        statistics_->host_registration.add(elapsedSince(id_request_time_));
+        ++statistics_->counters.hosts_registered;
+
+        delegate_->onHostRegistered(response.host_id());
+    }
+    else if (message.has_connection_offer())
+    {
+        const proto::ConnectionOffer& offer = message.connection_offer();
+
+        if (offer.error_code() == proto::ConnectionOffer::SUCCESS &&
+            offer.peer_role() == proto::ConnectionOffer::HOST)
+        {
+            peer_manager_->addConnectionOffer(offer.relay());
+        }
+    }
+}
+
+void HostSimulator::onMessageWritten(size_t /* pending */)
+{
+    // Nothing
+}
+
+void HostSimulator::onNewPeerConnected(std::unique_ptr<base::NetworkChannel> channel)
+{
+    streams_.emplace_back(std::make_unique<Stream>(std::move(channel)));
+
+    if (!frame_timer_.isActive() && params_.frame_rate > 0)
+    {
+        frame_timer_.start(std::chrono::milliseconds(1000 / params_.frame_rate),
+                           std::bind(&HostSimulator::onFrameTimer, this));
+    }
+}
+
+void HostSimulator::onFrameTimer()
+{
+    auto it = streams_.begin();
+
+    while (it != streams_.end())
+    {
+        Stream* stream = it->get();
+
+        if (stream->isClosed())
+        {
+            task_runner_->deleteSoon(std::move(*it));
+            it = streams_.erase(it);
+            continue;
+        }
+
+        if (stream->isBusy())
+        {
+            ++statistics_->counters.frames_skipped;
+        }
+        else
+        {
+            base::ByteArray frame = createFrame(params_.frame_size);
+
+            statistics_->counters.bytes_sent += static_cast<int64_t>(frame.size());
+            ++statistics_->counters.frames_sent;
+
+            stream->send(std::move(frame));
+        }
+
+        ++it;
+    }
+
+    if (streams_.empty())
+        frame_timer_.stop();
+}
+
+void HostSimulator::onFailed()
+{
+    if (failed_)
+        return;
+
+    failed_ = true;
+    ++statistics_->counters.hosts_failed;
+
+    // Streams to the connected clients go through the relay and continue to work.
+    delegate_->onHostFailed();
+}
+
+} // namespace load_test
@@ -0,0 +1,108 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef LOAD_TEST__HOST_SIMULATOR_H
+#define LOAD_TEST__HOST_SIMULATOR_H
+
+#include "base/waitable_timer.h"
+#include "base/net/network_channel.h"
+#include "base/peer/client_authenticator.h"
+#include "base/peer/host_id.h"
+#include "base/peer/relay_peer_manager.h"
+#include "load_test/statistics.h"
+
+#include <vector>
+
+namespace load_test {
+
+// Simulates a host: registers with the router as a real host does and sends synthetic video
+// frames to every client connected through a relay.
+class HostSimulator
+    : public base::NetworkChannel::Listener,
+      public base::RelayPeerManager::Delegate
+{
+public:
+    struct Params
+    {
+        std::u16string router_address;
+        uint16_t router_port = 0;
+        base::ByteArray router_public_key;
+
+        // Frames per second sent to each client and the size of a frame in bytes.
+        int frame_rate = 30;
+        size_t frame_size = 0;
+    };
+
+    class Delegate
+    {
+    public:
+        virtual ~Delegate() = default;
+
+        virtual void onHostRegistered(base::HostId host_id) = 0;
+        virtual void onHostFailed() = 0;
+    };
+
+    HostSimulator(const Params& params,
+                  std::shared_ptr<base::TaskRunner> task_runner,
+                  Statistics* statistics,
+                  Delegate* delegate);
+    ~HostSimulator();
+
+    void start();
+
+    // Frames start with the time of sending, the receiver calculates the delivery time from it.
+    static base::ByteArray createFrame(size_t size);
+    static TimePoint frameTime(const base::ByteArray& frame);
+
+protected:
+    // base::NetworkChannel::Listener implementation.
+    void onConnected() override;
+    void onDisconnected(base::NetworkChannel::ErrorCode error_code) override;
+    void onMessageReceived(const base::ByteArray& buffer) override;
+    void onMessageWritten(size_t pending) override;
+
+    // base::RelayPeerManager::Delegate implementation.
+    void onNewPeerConnected(std::unique_ptr<base::NetworkChannel> channel) override;
+
+private:
+    class Stream;
+
+    void onFrameTimer();
+    void onFailed();
+
+    const Params params_;
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    Statistics* statistics_;
+    Delegate* delegate_;
+
+    std::unique_ptr<base::NetworkChannel> channel_;
+    std::unique_ptr<base::ClientAuthenticator> authenticator_;
+    std::unique_ptr<base::RelayPeerManager> peer_manager_;
+    std::vector<std::unique_ptr<Stream>> streams_;
+    base::WaitableTimer frame_timer_;
+
+    TimePoint connect_start_time_;
+    TimePoint id_request_time_;
+    bool failed_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(HostSimulator);
+};
+
+} // namespace load_test
+
+#endif // LOAD_TEST__HOST_SIMULATOR_H
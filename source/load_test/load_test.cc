@@ -0,0 +1,171 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "load_test/load_test.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+
+#include <iostream>
+
+namespace load_test {
+
+namespace {
+
+const std::chrono::milliseconds kRampInterval{ 10 };
+const std::chrono::seconds kReportInterval{ 1 };
+
+} // namespace
+
+LoadTest::LoadTest(const Config& config, std::shared_ptr<base::TaskRunner> task_runner)
+    : config_(config),
+      task_runner_(std::move(task_runner)),
+      ramp_timer_(base::WaitableTimer::Type::REPEATED, task_runner_),
+      report_timer_(base::WaitableTimer::Type::REPEATED, task_runner_),
+      duration_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner_)
+{
+    DCHECK(task_runner_);
+}
+
+LoadTest::~LoadTest() = default;
+
+void LoadTest::start()
+{
+    LOG(LS_INFO) << "Starting " << config_.host_count << " hosts and " << config_.client_count
+                 << " clients (" << config_.connect_rate << " connections per second)";
+
+    start_time_ = Clock::now();
+    last_report_time_ = start_time_;
+
+    hosts_.reserve(static_cast<size_t>(config_.host_count));
+    clients_.reserve(static_cast<size_t>(config_.client_count));
+
+    ramp_timer_.start(kRampInterval, std::bind(&LoadTest::onRampTimer, this));
+    report_timer_.start(kReportInterval, std::bind(&LoadTest::onReportTimer, this));
+}
+
+void LoadTest::onHostRegistered(base::HostId host_id)
+{
+    host_ids_.emplace_back(host_id);
+    onHostFinished();
+}
+
+void LoadTest::onHostFailed()
+{
+    onHostFinished();
+}
+
+void LoadTest::onRampTimer()
+{
+    ramp_credit_ += static_cast<double>(config_.connect_rate) * kRampInterval.count() / 1000.0;
+
+    while (ramp_credit_ >= 1.0)
+    {
+        if (state_ == State::STARTING_HOSTS &&
+            hosts_.size() < static_cast<size_t>(config_.host_count))
+        {
+            hosts_.emplace_back(std::make_unique<HostSimulator>(
+                config_.host, task_runner_, &statistics_, this));
+            hosts_.back()->start();
+        }
+        else if (state_ == State::STARTING_CLIENTS &&
+                 clients_.size() < static_cast<size_t>(config_.client_count))
+        {
+            // Clients are distributed evenly among the registered hosts.
+            base::HostId host_id = host_ids_[clients_.size() % host_ids_.size()];
+
+            clients_.emplace_back(std::make_unique<ClientSimulator>(
+                config_.client, task_runner_, &statistics_));
+            clients_.back()->start(host_id);
+        }
+        else
+        {
+            ramp_credit_ = 0;
+            break;
+        }
+
+        ramp_credit_ -= 1.0;
+    }
+
+    if (state_ == State::STARTING_CLIENTS &&
+        clients_.size() >= static_cast<size_t>(config_.client_count))
+    {
+        LOG(LS_INFO) << "All clients started";
+
+        state_ = State::RUNNING;
+        ramp_timer_.stop();
+        duration_timer_.start(config_.duration, std::bind(&LoadTest::finish, this));
+    }
+}
+
+void LoadTest::onReportTimer()
+{
+    TimePoint now = Clock::now();
+
+    printProgress(std::cout, statistics_.counters, reported_counters_,
+                  std::chrono::duration_cast<std::chrono::milliseconds>(now - last_report_time_));
+
+    reported_counters_ = statistics_.counters;
+    last_report_time_ = now;
+}
+
+void LoadTest::onHostFinished()
+{
+    ++finished_hosts_;
+
+    if (state_ != State::STARTING_HOSTS || finished_hosts_ < config_.host_count)
+        return;
+
+    startClients();
+}
+
+void LoadTest::startClients()
+{
+    if (host_ids_.empty())
+    {
+        std::cout << "No host has been registered. Check the address and the public key of the "
+                     "router" << std::endl;
+        finish();
+        return;
+    }
+
+    LOG(LS_INFO) << host_ids_.size() << " hosts registered, starting clients";
+
+    state_ = State::STARTING_CLIENTS;
+    ramp_credit_ = 0;
+}
+
+void LoadTest::finish()
+{
+    if (state_ == State::FINISHED)
+        return;
+
+    state_ = State::FINISHED;
+
+    ramp_timer_.stop();
+    report_timer_.stop();
+    duration_timer_.stop();
+
+    printSummary(std::cout, statistics_,
+                 std::chrono::duration_cast<std::chrono::milliseconds>(
+                     Clock::now() - start_time_));
+
+    task_runner_->postQuit();
+}
+
+} // namespace load_test
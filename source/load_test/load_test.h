@@ -0,0 +1,97 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef LOAD_TEST__LOAD_TEST_H
+#define LOAD_TEST__LOAD_TEST_H
+
+#include "base/waitable_timer.h"
+#include "load_test/client_simulator.h"
+#include "load_test/host_simulator.h"
+
+#include <vector>
+
+namespace load_test {
+
+// Starts the simulated hosts, then the simulated clients which connect to them, keeps the traffic
+// running for the specified time and prints the results.
+class LoadTest : public HostSimulator::Delegate
+{
+public:
+    struct Config
+    {
+        HostSimulator::Params host;
+        ClientSimulator::Params client;
+
+        int host_count = 100;
+        int client_count = 100;
+
+        // New connections per second, for hosts and clients separately.
+        int connect_rate = 100;
+
+        // Time of the traffic after all clients are started.
+        std::chrono::seconds duration{ 60 };
+    };
+
+    LoadTest(const Config& config, std::shared_ptr<base::TaskRunner> task_runner);
+    ~LoadTest();
+
+    // Runs the test. When the test is finished, quit is posted to the message loop.
+    void start();
+
+protected:
+    // HostSimulator::Delegate implementation.
+    void onHostRegistered(base::HostId host_id) override;
+    void onHostFailed() override;
+
+private:
+    enum class State { STARTING_HOSTS, STARTING_CLIENTS, RUNNING, FINISHED };
+
+    void onRampTimer();
+    void onReportTimer();
+    void onHostFinished();
+    void startClients();
+    void finish();
+
+    const Config config_;
+    std::shared_ptr<base::TaskRunner> task_runner_;
+
+    State state_ = State::STARTING_HOSTS;
+    Statistics statistics_;
+    Counters reported_counters_;
+
+    std::vector<std::unique_ptr<HostSimulator>> hosts_;
+    std::vector<std::unique_ptr<ClientSimulator>> clients_;
+    std::vector<base::HostId> host_ids_;
+    int finished_hosts_ = 0;
+
+    // Fractional number of connections that can be started on the next tick of the ramp timer.
+    double ramp_credit_ = 0;
+
+    base::WaitableTimer ramp_timer_;
+    base::WaitableTimer report_timer_;
+    base::WaitableTimer duration_timer_;
+
+    TimePoint start_time_;
+    TimePoint last_report_time_;
+
+    DISALLOW_COPY_AND_ASSIGN(LoadTest);
+};
+
+} // namespace load_test
+
+#endif // LOAD_TEST__LOAD_TEST_H
@@ -0,0 +1,182 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/command_line.h"
+#include "base/logging.h"
+#include "base/crypto/scoped_crypto_initializer.h"
+#include "base/message_loop/message_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/unicode.h"
+#include "build/build_config.h"
+#include "load_test/load_test.h"
+
+#include <iostream>
+
+namespace {
+
+void showHelp()
+{
+    std::cout << "aspia_load_test [switches]" << std::endl
+        << "Simulates hosts and clients connecting through a router and relays." << std::endl
+        << "Each simulated host requests a new ID, so use a dedicated router database." << std::endl
+        << "Available switches:" << std::endl
+        << '\t' << "--router-address=<address>" << '\t' << "Router address (required)" << std::endl
+        << '\t' << "--router-port=<port>" << '\t' << "Router port (default: "
+        << DEFAULT_ROUTER_TCP_PORT << ")" << std::endl
+        << '\t' << "--router-public-key=<hex>" << '\t' << "Router public key (required)"
+        << std::endl
+        << '\t' << "--username=<name>" << '\t' << "User for client connections (required)"
+        << std::endl
+        << '\t' << "--password=<password>" << '\t' << "Password of the user (required)" << std::endl
+        << '\t' << "--hosts=<count>" << '\t' << "Number of hosts (default: 100)" << std::endl
+        << '\t' << "--clients=<count>" << '\t' << "Number of clients (default: 100)" << std::endl
+        << '\t' << "--connect-rate=<count>" << '\t' << "New connections per second (default: 100)"
+        << std::endl
+        << '\t' << "--frame-rate=<fps>" << '\t' << "Frames per second to each client (default: 30)"
+        << std::endl
+        << '\t' << "--frame-size=<bytes>" << '\t' << "Size of a frame (default: 16384)" << std::endl
+        << '\t' << "--duration=<seconds>" << '\t' << "Time of traffic after the start of all "
+        << "clients (default: 60)" << std::endl
+        << '\t' << "--help" << '\t' << "Show help" << std::endl;
+}
+
+bool readNumber(const base::CommandLine& command_line, std::u16string_view name, int min_value,
+                int* value)
+{
+    if (!command_line.hasSwitch(name))
+        return true;
+
+    int result = 0;
+    if (!base::stringToInt(command_line.switchValue(name), &result) || result < min_value)
+    {
+        std::cout << "Invalid value of --" << base::utf8FromUtf16(name) << std::endl;
+        return false;
+    }
+
+    *value = result;
+    return true;
+}
+
+bool readConfig(const base::CommandLine& command_line, load_test::LoadTest::Config* config)
+{
+    config->host.router_address = command_line.switchValue(u"router-address");
+    config->host.router_public_key =
+        base::fromHex(base::utf8FromUtf16(command_line.switchValue(u"router-public-key")));
+    config->client.router_address = config->host.router_address;
+    config->client.username = command_line.switchValue(u"username");
+    config->client.password = command_line.switchValue(u"password");
+
+    if (config->host.router_address.empty() || config->host.router_public_key.empty() ||
+        config->client.username.empty() || config->client.password.empty())
+    {
+        std::cout << "Router address, public key, user name and password are required"
+                  << std::endl;
+        return false;
+    }
+
+    int router_port = DEFAULT_ROUTER_TCP_PORT;
+    int frame_rate = config->host.frame_rate;
+    int frame_size = 16384;
+    int duration = static_cast<int>(config->duration.count());
+
+    if (!readNumber(command_line, u"router-port", 1, &router_port) ||
+        !readNumber(command_line, u"hosts", 1, &config->host_count) ||
+        !readNumber(command_line, u"clients", 0, &config->client_count) ||
+        !readNumber(command_line, u"connect-rate", 1, &config->connect_rate) ||
+        !readNumber(command_line, u"frame-rate", 0, &frame_rate) ||
+        !readNumber(command_line, u"frame-size", 0, &frame_size) ||
+        !readNumber(command_line, u"duration", 0, &duration))
+    {
+        return false;
+    }
+
+    if (router_port > 65535 || frame_rate > 1000)
+    {
+        std::cout << "Invalid router port or frame rate" << std::endl;
+        return false;
+    }
+
+    config->host.router_port = static_cast<uint16_t>(router_port);
+    config->client.router_port = config->host.router_port;
+    config->host.frame_rate = frame_rate;
+    config->host.frame_size = static_cast<size_t>(frame_size);
+    config->duration = std::chrono::seconds(duration);
+
+    return true;
+}
+
+int runLoadTest()
+{
+    base::CommandLine* command_line = base::CommandLine::forCurrentProcess();
+
+    if (command_line->hasSwitch(u"help"))
+    {
+        showHelp();
+        return 0;
+    }
+
+    load_test::LoadTest::Config config;
+    if (!readConfig(*command_line, &config))
+    {
+        showHelp();
+        return 1;
+    }
+
+    std::unique_ptr<base::ScopedCryptoInitializer> crypto_initializer =
+        std::make_unique<base::ScopedCryptoInitializer>();
+
+    std::unique_ptr<base::MessageLoop> message_loop =
+        std::make_unique<base::MessageLoop>(base::MessageLoop::Type::ASIO);
+
+    std::unique_ptr<load_test::LoadTest> load_test =
+        std::make_unique<load_test::LoadTest>(config, message_loop->taskRunner());
+
+    load_test->start();
+    message_loop->run();
+
+    load_test.reset();
+    message_loop.reset();
+    crypto_initializer.reset();
+    return 0;
+}
+
+} // namespace
+
+#if defined(OS_WIN)
+int wmain()
+{
+    base::initLogging();
+    base::CommandLine::init(0, nullptr); // On Windows ignores arguments.
+
+    int result = runLoadTest();
+
+    base::shutdownLogging();
+    return result;
+}
+#else
+int main(int argc, const char* const* argv)
+{
+    base::initLogging();
+    base::CommandLine::init(argc, argv);
+
+    int result = runLoadTest();
+
+    base::shutdownLogging();
+    return result;
+}
+#endif
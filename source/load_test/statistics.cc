@@ -0,0 +1,141 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "load_test/statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+namespace load_test {
+
+namespace {
+
+double perSecond(int64_t value, const std::chrono::milliseconds& interval)
+{
+    if (interval.count() <= 0)
+        return 0;
+
+    return static_cast<double>(value) * 1000.0 / static_cast<double>(interval.count());
+}
+
+double megabits(double bytes)
+{
+    return bytes * 8.0 / 1000000.0;
+}
+
+void printLatency(std::ostream& stream, const char* name, const LatencySamples& samples)
+{
+    stream << "  " << std::left << std::setw(20) << name << std::right;
+
+    if (!samples.count())
+    {
+        stream << "no samples" << std::endl;
+        return;
+    }
+
+    auto ms = [&samples](double percent)
+    {
+        return static_cast<double>(samples.percentile(percent).count()) / 1000.0;
+    };
+
+    stream << std::fixed << std::setprecision(2)
+           << "p50: " << ms(50) << " ms, p90: " << ms(90) << " ms, p99: " << ms(99)
+           << " ms, max: " << ms(100) << " ms (" << samples.count() << " samples)" << std::endl;
+}
+
+} // namespace
+
+void LatencySamples::add(const std::chrono::microseconds& duration)
+{
+    samples_.push_back(duration.count());
+    sorted_ = false;
+}
+
+std::chrono::microseconds LatencySamples::percentile(double percent) const
+{
+    if (samples_.empty())
+        return std::chrono::microseconds(0);
+
+    if (!sorted_)
+    {
+        std::sort(samples_.begin(), samples_.end());
+        sorted_ = true;
+    }
+
+    // Nearest-rank method.
+    double rank = std::ceil(percent / 100.0 * static_cast<double>(samples_.size()));
+    size_t index = static_cast<size_t>(std::clamp(rank, 1.0, static_cast<double>(samples_.size())));
+
+    return std::chrono::microseconds(samples_[index - 1]);
+}
+
+void printProgress(std::ostream& stream,
+                   const Counters& current,
+                   const Counters& previous,
+                   const std::chrono::milliseconds& interval)
+{
+    stream << std::fixed << std::setprecision(1)
+           << "hosts: " << current.hosts_registered << '/' << current.hosts_started
+           << " (failed: " << current.hosts_failed << ")"
+           << ", clients: " << current.clients_connected << '/' << current.clients_started
+           << " (failed: " << current.clients_failed << ")"
+           << ", relayed: " << current.relay_connections
+           << " (errors: " << current.relay_errors << ")"
+           << ", connects/s: "
+           << perSecond((current.hosts_registered + current.clients_connected) -
+                        (previous.hosts_registered + previous.clients_connected), interval)
+           << ", frames/s: " << perSecond(current.frames_received - previous.frames_received,
+                                          interval)
+           << ", relay Mbit/s: "
+           << megabits(perSecond(current.bytes_received - previous.bytes_received, interval))
+           << std::endl;
+}
+
+void printSummary(std::ostream& stream,
+                  const Statistics& statistics,
+                  const std::chrono::milliseconds& duration)
+{
+    const Counters& counters = statistics.counters;
+
+    stream << std::endl << "Summary (" << duration.count() / 1000 << " s)" << std::endl
+           << "  Hosts registered:   " << counters.hosts_registered << " of "
+           << counters.hosts_started << " (failed: " << counters.hosts_failed << ")" << std::endl
+           << "  Clients connected:  " << counters.clients_connected << " of "
+           << counters.clients_started << " (failed: " << counters.clients_failed << ")"
+           << std::endl
+           << "  Relay connections:  " << counters.relay_connections
+           << " (errors: " << counters.relay_errors << ")" << std::endl
+           << "  Frames:             sent: " << counters.frames_sent
+           << ", received: " << counters.frames_received
+           << ", skipped by senders: " << counters.frames_skipped << std::endl
+           << std::fixed << std::setprecision(1)
+           << "  Relay throughput:   "
+           << megabits(perSecond(counters.bytes_received, duration)) << " Mbit/s (average)"
+           << std::endl
+           << std::endl << "Latency" << std::endl;
+
+    printLatency(stream, "Host handshake", statistics.host_handshake);
+    printLatency(stream, "Host registration", statistics.host_registration);
+    printLatency(stream, "Client handshake", statistics.client_handshake);
+    printLatency(stream, "Connection offer", statistics.connection_offer);
+    printLatency(stream, "Relay connect", statistics.relay_connect);
+    printLatency(stream, "Frame delivery", statistics.frame_delivery);
+}
+
+} // namespace load_test
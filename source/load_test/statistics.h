@@ -0,0 +1,117 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef LOAD_TEST__STATISTICS_H
+#define LOAD_TEST__STATISTICS_H
+
+#include "base/macros_magic.h"
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace load_test {
+
+using Clock = std::chrono::steady_clock;
+using TimePoint = Clock::time_point;
+
+// Returns the time elapsed since |start|.
+inline std::chrono::microseconds elapsedSince(const TimePoint& start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+}
+
+// Collects the samples of a duration and calculates percentiles.
+class LatencySamples
+{
+public:
+    LatencySamples() = default;
+    ~LatencySamples() = default;
+
+    void add(const std::chrono::microseconds& duration);
+
+    size_t count() const { return samples_.size(); }
+
+    // Returns the value below which |percent| percent of the samples fall.
+    std::chrono::microseconds percentile(double percent) const;
+
+private:
+    mutable std::vector<int64_t> samples_;
+    mutable bool sorted_ = true;
+
+    DISALLOW_COPY_AND_ASSIGN(LatencySamples);
+};
+
+struct Counters
+{
+    int64_t hosts_started = 0;
+    int64_t hosts_registered = 0;
+    int64_t hosts_failed = 0;
+
+    int64_t clients_started = 0;
+    int64_t clients_connected = 0;
+    int64_t clients_failed = 0;
+
+    int64_t relay_connections = 0;
+    int64_t relay_errors = 0;
+
+    int64_t frames_sent = 0;
+    int64_t frames_skipped = 0;
+    int64_t frames_received = 0;
+    int64_t bytes_sent = 0;
+    int64_t bytes_received = 0;
+};
+
+// Results of the load test. All simulated peers run in one thread, so no locking is required.
+struct Statistics
+{
+    Counters counters;
+
+    // From the start of the connection to the end of the authentication on the router.
+    LatencySamples host_handshake;
+    LatencySamples client_handshake;
+
+    // From the host ID request to the response.
+    LatencySamples host_registration;
+
+    // From the connection request to the connection offer.
+    LatencySamples connection_offer;
+
+    // From the connection offer to the established relay connection.
+    LatencySamples relay_connect;
+
+    // From sending of a frame by the host to receiving by the client.
+    LatencySamples frame_delivery;
+};
+
+// Writes the state of the peers and the rates since the |previous| counters.
+void printProgress(std::ostream& stream,
+                   const Counters& current,
+                   const Counters& previous,
+                   const std::chrono::milliseconds& interval);
+
+// Writes the totals, the average rates for the whole |duration| of the test and the latency
+// percentiles.
+void printSummary(std::ostream& stream,
+                  const Statistics& statistics,
+                  const std::chrono::milliseconds& duration);
+
+} // namespace load_test
+
+#endif // LOAD_TEST__STATISTICS_H
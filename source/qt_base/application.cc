@@ -142,8 +142,14 @@ Application::Application(int& argc, char* argv[])
     io_thread_.start(base::MessageLoop::Type::ASIO);
     io_task_runner_ = io_thread_.taskRunner();
 
-    locale_loader_ = std::make_unique<LocaleLoader>();
     ui_task_runner_ = std::make_shared<QtTaskRunner>();
+
+    // The task is executed when the event loop is started, i.e. after the main window is shown.
+    ui_task_runner_->postTask([start_time = std::chrono::steady_clock::now()]()
+    {
+        LOG(LS_INFO) << "Startup time: " << std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time).count() << " ms";
+    });
 }
 
 Application::~Application()
@@ -214,17 +220,25 @@ bool Application::isRunning()
 
 Application::LocaleList Application::localeList() const
 {
-    return locale_loader_->localeList();
+    return localeLoader()->localeList();
 }
 
 void Application::setLocale(const QString& locale)
 {
-    locale_loader_->installTranslators(locale);
+    localeLoader()->installTranslators(locale);
 }
 
 bool Application::hasLocale(const QString& locale)
 {
-    return locale_loader_->contains(locale);
+    return localeLoader()->contains(locale);
+}
+
+LocaleLoader* Application::localeLoader() const
+{
+    // The list of translations is read from the resources only when it is first needed.
+    if (!locale_loader_)
+        locale_loader_ = std::make_unique<LocaleLoader>();
+    return locale_loader_.get();
 }
 
 void Application::sendMessage(const QByteArray& message)
@@ -64,6 +64,8 @@ private slots:
     void onNewConnection();
 
 private:
+    LocaleLoader* localeLoader() const;
+
     QString lock_file_name_;
     QString server_name_;
 
@@ -72,7 +74,7 @@ private:
 
     base::Thread io_thread_;
     std::unique_ptr<base::ScopedCryptoInitializer> crypto_initializer_;
-    std::unique_ptr<LocaleLoader> locale_loader_;
+    mutable std::unique_ptr<LocaleLoader> locale_loader_;
     std::shared_ptr<base::TaskRunner> ui_task_runner_;
     std::shared_ptr<base::TaskRunner> io_task_runner_;
 
@@ -109,7 +109,11 @@ bool LocaleLoader::contains(const QString& locale) const
 
 void LocaleLoader::installTranslators(const QString& locale)
 {
+    if (locale == current_locale_)
+        return;
+
     removeTranslators();
+    current_locale_ = locale;
 
     LOG(LS_INFO) << "Install translators for: " << locale;
 
@@ -140,6 +144,7 @@ void LocaleLoader::removeTranslators()
     }
 
     translator_list_.clear();
+    current_locale_.clear();
 }
 
 } // namespace qt_base
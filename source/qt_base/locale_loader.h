@@ -47,6 +47,7 @@ private:
 
     QHash<QString, QStringList> locale_list_;
     QVector<QTranslator*> translator_list_;
+    QString current_locale_;
 
     DISALLOW_COPY_AND_ASSIGN(LocaleLoader);
 };
@@ -0,0 +1,262 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "relay/bandwidth_limiter.h"
+
+#include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace relay {
+
+namespace {
+
+// Interval at which waiting clients are served.
+constexpr std::chrono::milliseconds kTimerInterval{ 5 };
+
+// Number of bytes added to the deficit of a waiting client in each round.
+constexpr size_t kQuantum = 16 * 1024;
+
+// Buckets allow bursts of up to 100 ms of traffic, but not less than this size.
+constexpr int64_t kMinCapacity = 16 * 1024;
+
+} // namespace
+
+BandwidthLimiter::TokenBucket::TokenBucket(int64_t rate)
+    : rate_(rate),
+      capacity_(std::max(rate / 10, kMinCapacity)),
+      tokens_(capacity_),
+      last_time_(Clock::now())
+{
+    // Nothing
+}
+
+void BandwidthLimiter::TokenBucket::refill(const TimePoint& current_time)
+{
+    if (rate_ <= 0 || current_time <= last_time_)
+        return;
+
+    const int64_t elapsed_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(current_time - last_time_).count();
+    const int64_t tokens = elapsed_us * rate_ / 1000000;
+
+    // Time is not consumed until at least one token is added.
+    if (!tokens)
+        return;
+
+    tokens_ = std::min(tokens_ + tokens, capacity_);
+    last_time_ = current_time;
+}
+
+size_t BandwidthLimiter::TokenBucket::available() const
+{
+    if (rate_ <= 0)
+        return std::numeric_limits<size_t>::max();
+
+    return static_cast<size_t>(std::max(tokens_, int64_t(0)));
+}
+
+void BandwidthLimiter::TokenBucket::consume(size_t size)
+{
+    if (rate_ > 0)
+        tokens_ -= static_cast<int64_t>(size);
+}
+
+void BandwidthLimiter::TokenBucket::giveBack(size_t size)
+{
+    if (rate_ > 0)
+        tokens_ = std::min(tokens_ + static_cast<int64_t>(size), capacity_);
+}
+
+BandwidthLimiter::Client::Client(BandwidthLimiter* limiter)
+    : limiter_(limiter),
+      bucket_(limiter ? limiter->session_limit_ : 0)
+{
+    if (limiter_)
+        limiter_->clients_.insert(this);
+}
+
+BandwidthLimiter::Client::~Client()
+{
+    if (!limiter_)
+        return;
+
+    limiter_->cancel(this);
+    limiter_->clients_.erase(this);
+}
+
+size_t BandwidthLimiter::Client::request(size_t max_size, Callback callback)
+{
+    if (!limiter_)
+        return max_size;
+
+    return limiter_->request(this, max_size, std::move(callback));
+}
+
+void BandwidthLimiter::Client::giveBack(size_t size)
+{
+    if (!limiter_ || !size)
+        return;
+
+    bucket_.giveBack(size);
+    limiter_->thread_bucket_.giveBack(size);
+}
+
+BandwidthLimiter::BandwidthLimiter(const Limits& limits)
+    : session_limit_(limits.session),
+      thread_limit_(limits.thread),
+      thread_bucket_(limits.thread),
+      timer_(base::MessageLoop::current()->pumpAsio()->ioContext())
+{
+    // Nothing
+}
+
+BandwidthLimiter::~BandwidthLimiter()
+{
+    timer_.cancel();
+
+    // Clients that outlive the limiter forward data without limits.
+    for (Client* client : clients_)
+    {
+        client->limiter_ = nullptr;
+        client->waiting_ = false;
+        client->callback_ = nullptr;
+    }
+}
+
+size_t BandwidthLimiter::request(Client* client, size_t max_size, Callback callback)
+{
+    DCHECK(!client->waiting_);
+
+    const TimePoint current_time = Clock::now();
+
+    thread_bucket_.refill(current_time);
+    client->bucket_.refill(current_time);
+
+    // While other clients wait for the thread bandwidth, new requests are queued after them.
+    if (waiting_.empty() || thread_limit_ <= 0)
+    {
+        size_t size = std::min({ max_size, client->bucket_.available(),
+                                 thread_bucket_.available() });
+        if (size)
+        {
+            client->bucket_.consume(size);
+            thread_bucket_.consume(size);
+            return size;
+        }
+    }
+
+    client->callback_ = std::move(callback);
+    client->requested_ = max_size;
+    client->deficit_ = 0;
+    client->waiting_ = true;
+    client->position_ = waiting_.insert(waiting_.end(), client);
+
+    startTimer();
+    return 0;
+}
+
+void BandwidthLimiter::cancel(Client* client)
+{
+    if (!client->waiting_)
+        return;
+
+    waiting_.erase(client->position_);
+    client->waiting_ = false;
+    client->callback_ = nullptr;
+}
+
+void BandwidthLimiter::startTimer()
+{
+    if (timer_active_)
+        return;
+
+    timer_active_ = true;
+    timer_.expires_after(kTimerInterval);
+    timer_.async_wait(std::bind(&BandwidthLimiter::onTimer, this, std::placeholders::_1));
+}
+
+void BandwidthLimiter::onTimer(const std::error_code& error_code)
+{
+    if (error_code == asio::error::operation_aborted)
+        return;
+
+    timer_active_ = false;
+
+    const TimePoint current_time = Clock::now();
+    thread_bucket_.refill(current_time);
+
+    bool progress = true;
+
+    while (progress && !waiting_.empty() && thread_bucket_.available())
+    {
+        progress = false;
+
+        // One round: every client waiting at the start of the round gets one quantum.
+        for (size_t count = waiting_.size(); count && !waiting_.empty(); --count)
+        {
+            Client* client = waiting_.front();
+            waiting_.pop_front();
+
+            client->bucket_.refill(current_time);
+
+            size_t size = std::min({ client->requested_, client->bucket_.available(),
+                                     thread_bucket_.available() });
+            if (thread_limit_ > 0)
+            {
+                if (client->deficit_ < size)
+                {
+                    client->deficit_ = std::min(client->deficit_ + kQuantum, client->requested_);
+                    progress = true;
+                }
+
+                size = std::min(size, client->deficit_);
+            }
+
+            if (!size)
+            {
+                // The client has to wait for the next round.
+                client->position_ = waiting_.insert(waiting_.end(), client);
+                continue;
+            }
+
+            client->bucket_.consume(size);
+            thread_bucket_.consume(size);
+
+            // A client that leaves the queue loses its deficit.
+            client->deficit_ = 0;
+            client->waiting_ = false;
+            progress = true;
+
+            Callback callback = std::move(client->callback_);
+            client->callback_ = nullptr;
+            callback(size);
+
+            if (!thread_bucket_.available())
+                break;
+        }
+    }
+
+    if (!waiting_.empty())
+        startTimer();
+}
+
+} // namespace relay
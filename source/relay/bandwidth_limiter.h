@@ -0,0 +1,124 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef RELAY__BANDWIDTH_LIMITER_H
+#define RELAY__BANDWIDTH_LIMITER_H
+
+#include "base/macros_magic.h"
+
+#include <asio/high_resolution_timer.hpp>
+
+#include <functional>
+#include <list>
+#include <unordered_set>
+
+namespace relay {
+
+// Limits the rate of data forwarding of the sessions served on one I/O thread. Each direction of
+// a session has its own token bucket, and all sessions of the thread share a common bucket. When
+// the common bucket is exhausted, waiting sessions are served in deficit round-robin order, so a
+// single bulk transfer cannot take the whole bandwidth of the thread from interactive sessions.
+// Must be used on a thread with an ASIO message loop.
+class BandwidthLimiter
+{
+public:
+    // Limits are in bytes per second. 0 means no limit.
+    struct Limits
+    {
+        int64_t session = 0;
+        int64_t thread = 0;
+    };
+
+    explicit BandwidthLimiter(const Limits& limits);
+    ~BandwidthLimiter();
+
+    bool isEnabled() const { return session_limit_ > 0 || thread_limit_ > 0; }
+
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+    using Callback = std::function<void(size_t size)>;
+
+    class TokenBucket
+    {
+    public:
+        explicit TokenBucket(int64_t rate);
+
+        void refill(const TimePoint& current_time);
+        size_t available() const;
+        void consume(size_t size);
+        void giveBack(size_t size);
+
+    private:
+        const int64_t rate_;
+        const int64_t capacity_;
+        int64_t tokens_;
+        TimePoint last_time_;
+    };
+
+    // Controls a single direction of data forwarding.
+    class Client
+    {
+    public:
+        explicit Client(BandwidthLimiter* limiter);
+        ~Client();
+
+        // Requests up to |max_size| bytes for forwarding. Returns the number of bytes that can be
+        // forwarded right away. If it is 0, |callback| will be called with the number of bytes
+        // when they become available.
+        size_t request(size_t max_size, Callback callback);
+
+        // Returns bytes that were granted but not forwarded.
+        void giveBack(size_t size);
+
+    private:
+        friend class BandwidthLimiter;
+
+        BandwidthLimiter* limiter_;
+        TokenBucket bucket_;
+
+        Callback callback_;
+        size_t requested_ = 0;
+        size_t deficit_ = 0;
+        bool waiting_ = false;
+        std::list<Client*>::iterator position_;
+
+        DISALLOW_COPY_AND_ASSIGN(Client);
+    };
+
+private:
+    size_t request(Client* client, size_t max_size, Callback callback);
+    void cancel(Client* client);
+    void startTimer();
+    void onTimer(const std::error_code& error_code);
+
+    const int64_t session_limit_;
+    const int64_t thread_limit_;
+
+    TokenBucket thread_bucket_;
+    asio::high_resolution_timer timer_;
+    bool timer_active_ = false;
+
+    std::unordered_set<Client*> clients_;
+    std::list<Client*> waiting_;
+
+    DISALLOW_COPY_AND_ASSIGN(BandwidthLimiter);
+};
+
+} // namespace relay
+
+#endif // RELAY__BANDWIDTH_LIMITER_H
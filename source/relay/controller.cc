@@ -24,46 +24,38 @@
 #include "proto/router_common.pb.h"
 #include "relay/settings.h"
 
+#include <algorithm>
+#include <thread>
+
 namespace relay {
 
 namespace {
 
 const std::chrono::seconds kReconnectTimeout{ 15 };
+const std::chrono::seconds kStatisticsInterval{ 15 };
+
+// Peers are required to use the key given to them by the router within this time.
+const std::chrono::seconds kKeyUseTimeout{ 30 };
+
+// Expired keys are removed from the pool in batches with this interval.
+const std::chrono::seconds kKeyExpiryInterval{ 1 };
+
+// Interval of checking the remaining sessions when the relay is going to stop.
+const std::chrono::seconds kDrainCheckInterval{ 1 };
 
 #if defined(OS_WIN)
 const wchar_t kFirewallRuleName[] = L"Aspia Relay Service";
 const wchar_t kFirewallRuleDecription[] = L"Allow incoming TCP connections";
 #endif // defined(OS_WIN)
 
-class KeyDeleter
-{
-public:
-    KeyDeleter(std::unique_ptr<SharedPool> pool, uint32_t key_id)
-        : pool_(std::move(pool)),
-          key_id_(key_id)
-    {
-        DCHECK(pool_);
-    }
-
-    ~KeyDeleter() = default;
-
-    void deleteKey()
-    {
-        pool_->setKeyExpired(key_id_);
-    }
-
-private:
-    std::unique_ptr<SharedPool> pool_;
-    const uint32_t key_id_;
-
-    DISALLOW_COPY_AND_ASSIGN(KeyDeleter);
-};
-
 } // namespace
 
 Controller::Controller(std::shared_ptr<base::TaskRunner> task_runner)
     : task_runner_(task_runner),
       reconnect_timer_(base::WaitableTimer::Type::SINGLE_SHOT, task_runner),
+      statistics_timer_(base::WaitableTimer::Type::REPEATED, task_runner),
+      key_expiry_timer_(base::WaitableTimer::Type::REPEATED, task_runner),
+      drain_timer_(base::WaitableTimer::Type::REPEATED, task_runner),
       shared_pool_(std::make_unique<SharedPool>(this))
 {
     Settings settings;
@@ -82,11 +74,26 @@ Controller::Controller(std::shared_ptr<base::TaskRunner> task_runner)
     peer_port_ = settings.peerPort();
     peer_idle_timeout_ = settings.peerIdleTimeout();
     max_peer_count_ = settings.maxPeerCount();
+    session_thread_count_ = settings.sessionThreadCount();
+    zero_copy_forwarding_ = settings.isZeroCopyForwarding();
+    metrics_port_ = settings.metricsPort();
+    bandwidth_limits_.session = int64_t(settings.sessionBandwidthLimit()) * 1024;
+    bandwidth_limits_.thread = int64_t(settings.threadBandwidthLimit()) * 1024;
+    drain_timeout_ = settings.drainTimeout();
+
+    if (!session_thread_count_)
+        session_thread_count_ = std::max(std::thread::hardware_concurrency(), 1U);
 
     LOG(LS_INFO) << "Peer address: " << peer_address_;
     LOG(LS_INFO) << "Peer port: " << peer_port_;
     LOG(LS_INFO) << "Peer idle timeout: " << peer_idle_timeout_.count();
     LOG(LS_INFO) << "Max peer count: " << max_peer_count_;
+    LOG(LS_INFO) << "Session thread count: " << session_thread_count_;
+    LOG(LS_INFO) << "Zero-copy forwarding: " << zero_copy_forwarding_;
+    LOG(LS_INFO) << "Metrics port: " << metrics_port_;
+    LOG(LS_INFO) << "Session bandwidth limit: " << bandwidth_limits_.session;
+    LOG(LS_INFO) << "Thread bandwidth limit: " << bandwidth_limits_.thread;
+    LOG(LS_INFO) << "Drain timeout: " << drain_timeout_.count();
 }
 
 Controller::~Controller() = default;
@@ -132,13 +139,57 @@ bool Controller::start()
     }
 
     sessions_worker_ = std::make_unique<SessionsWorker>(
-        peer_port_, peer_idle_timeout_, shared_pool_->share());
+        peer_port_, peer_idle_timeout_, session_thread_count_, zero_copy_forwarding_,
+        bandwidth_limits_, shared_pool_->share());
     sessions_worker_->start(task_runner_, this);
 
+    if (metrics_port_)
+    {
+        metrics_server_ = std::make_unique<MetricsServer>(metrics_port_);
+        if (!metrics_server_->start())
+        {
+            LOG(LS_WARNING) << "Unable to start metrics server";
+            metrics_server_.reset();
+        }
+    }
+
+    statistics_timer_.start(kStatisticsInterval, std::bind(&Controller::collectStatistics, this));
+
     connectToRouter();
     return true;
 }
 
+void Controller::drain(DrainCallback callback)
+{
+    DCHECK(callback);
+
+    if (is_draining_)
+    {
+        LOG(LS_INFO) << "Relay is already draining";
+        return;
+    }
+
+    if (!sessions_worker_)
+    {
+        // The controller has not been started, there is nothing to wait for.
+        callback();
+        return;
+    }
+
+    LOG(LS_INFO) << "Draining relay (timeout: " << drain_timeout_.count() << " minutes)";
+
+    is_draining_ = true;
+    drain_callback_ = std::move(callback);
+    drain_start_time_ = std::chrono::steady_clock::now();
+
+    // The keys are no longer sent to the router (see sendKeyPool). Without a connection the
+    // router has already removed the keys of the relay, the message is sent after reconnecting.
+    if (channel_ && channel_->isConnected())
+        sendDrain();
+
+    drain_timer_.start(kDrainCheckInterval, std::bind(&Controller::onDrainTimer, this));
+}
+
 void Controller::onConnected()
 {
     LOG(LS_INFO) << "Connection to the router is established";
@@ -167,7 +218,13 @@ void Controller::onConnected()
             // Now the session will receive incoming messages.
             channel_->resume();
 
-            sendKeyPool(max_peer_count_);
+            if (is_draining_)
+                sendDrain();
+            else
+                sendKeyPool(max_peer_count_);
+
+            key_expiry_timer_.start(
+                kKeyExpiryInterval, std::bind(&Controller::onKeyExpiryTimer, this));
         }
         else
         {
@@ -187,6 +244,8 @@ void Controller::onDisconnected(base::NetworkChannel::ErrorCode error_code)
                  << base::NetworkChannel::errorToString(error_code);
 
     // Clearing the key pool.
+    key_expiry_timer_.stop();
+    expiring_keys_.clear();
     shared_pool_->clear();
 
     // Retrying a connection at a time interval.
@@ -204,13 +263,10 @@ void Controller::onMessageReceived(const base::ByteArray& buffer)
 
     if (message->has_key_used())
     {
-        std::shared_ptr<KeyDeleter> key_deleter =
-            std::make_shared<KeyDeleter>(shared_pool_->share(), message->key_used().key_id());
-
         // The router gave the key to the peers. They are required to use it within 30 seconds.
         // If it is not used during this time, then it will be removed from the pool.
-        task_runner_->postDelayedTask(
-            std::bind(&KeyDeleter::deleteKey, key_deleter), std::chrono::seconds(30));
+        expiring_keys_.emplace_back(
+            std::chrono::steady_clock::now() + kKeyUseTimeout, message->key_used().key_id());
     }
     else
     {
@@ -230,11 +286,11 @@ void Controller::onSessionFinished()
     sendKeyPool(1);
 }
 
-void Controller::onPoolKeyExpired(uint32_t /* key_id */)
+void Controller::onPoolKeysExpired(const std::vector<uint32_t>& key_ids)
 {
-    // The key has expired and has been removed from the pool.
-    // Add a new key to the pool and send it to the router.
-    sendKeyPool(1);
+    // The keys have expired and have been removed from the pool.
+    // Add the same number of new keys to the pool and send them to the router in one message.
+    sendKeyPool(static_cast<uint32_t>(key_ids.size()));
 }
 
 void Controller::connectToRouter()
@@ -257,6 +313,10 @@ void Controller::delayedConnectToRouter()
 
 void Controller::sendKeyPool(uint32_t key_count)
 {
+    // The router does not give out the keys of a draining relay.
+    if (is_draining_)
+        return;
+
     std::unique_ptr<proto::RelayToRouter> message = std::make_unique<proto::RelayToRouter>();
     proto::RelayKeyPool* relay_key_pool = message->mutable_key_pool();
 
@@ -286,4 +346,88 @@ void Controller::sendKeyPool(uint32_t key_count)
     channel_->send(base::serialize(*message));
 }
 
+void Controller::onKeyExpiryTimer()
+{
+    const TimePoint current_time = std::chrono::steady_clock::now();
+    std::vector<uint32_t> key_ids;
+
+    while (!expiring_keys_.empty() && expiring_keys_.front().first <= current_time)
+    {
+        key_ids.push_back(expiring_keys_.front().second);
+        expiring_keys_.pop_front();
+    }
+
+    // Keys that have already been used were removed from the pool by the session manager.
+    if (!key_ids.empty())
+        shared_pool_->setKeysExpired(key_ids);
+}
+
+void Controller::collectStatistics()
+{
+    sessions_worker_->collectStatistics(
+        std::bind(&Controller::onStatistics, this, std::placeholders::_1));
+}
+
+void Controller::onStatistics(const proto::RelayStat& stat)
+{
+    if (metrics_server_)
+        metrics_server_->setStatistics(stat);
+
+    // The channel is available only after authentication.
+    if (!channel_ || !channel_->isConnected())
+        return;
+
+    std::unique_ptr<proto::RelayToRouter> message = std::make_unique<proto::RelayToRouter>();
+    message->mutable_relay_stat()->CopyFrom(stat);
+
+    channel_->send(base::serialize(*message));
+}
+
+void Controller::sendDrain()
+{
+    std::unique_ptr<proto::RelayToRouter> message = std::make_unique<proto::RelayToRouter>();
+    message->mutable_drain()->set_timeout(
+        static_cast<uint32_t>(std::chrono::seconds(drain_timeout_).count()));
+
+    channel_->send(base::serialize(*message));
+}
+
+void Controller::onDrainTimer()
+{
+    // The peers that received a key before the router was notified can still connect. After the
+    // key use timeout all such keys are either used or expired.
+    if (is_accepting_ && std::chrono::steady_clock::now() - drain_start_time_ >= kKeyUseTimeout)
+    {
+        is_accepting_ = false;
+        sessions_worker_->stopAccepting();
+    }
+
+    sessions_worker_->collectStatistics(
+        std::bind(&Controller::onDrainStatistics, this, std::placeholders::_1));
+}
+
+void Controller::onDrainStatistics(const proto::RelayStat& stat)
+{
+    if (!drain_callback_)
+        return;
+
+    if (stat.session_count() != 0 || is_accepting_)
+    {
+        if (std::chrono::steady_clock::now() - drain_start_time_ < drain_timeout_)
+            return;
+
+        LOG(LS_INFO) << "Drain timeout expired, remaining sessions: " << stat.session_count();
+    }
+    else
+    {
+        LOG(LS_INFO) << "All sessions finished";
+    }
+
+    drain_timer_.stop();
+
+    DrainCallback callback;
+    callback.swap(drain_callback_);
+    callback();
+}
+
 } // namespace relay
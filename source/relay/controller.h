@@ -23,9 +23,12 @@
 #include "base/net/network_channel.h"
 #include "build/build_config.h"
 #include "proto/router_relay.pb.h"
+#include "relay/metrics_server.h"
 #include "relay/sessions_worker.h"
 #include "relay/shared_pool.h"
 
+#include <deque>
+
 namespace base {
 class ClientAuthenticator;
 } // namespace base
@@ -43,6 +46,12 @@ public:
 
     bool start();
 
+    // Stops giving keys to the router and accepting new peers. The active sessions are kept until
+    // they finish or the drain timeout expires, then |callback| is called. It allows restarting
+    // the relay without reconnecting all peers at the same time.
+    using DrainCallback = std::function<void()>;
+    void drain(DrainCallback callback);
+
 protected:
     // base::NetworkChannel::Listener implementation.
     void onConnected() override;
@@ -54,12 +63,18 @@ protected:
     void onSessionFinished() override;
 
     // SharedPool::Delegate implementation.
-    void onPoolKeyExpired(uint32_t key_id) override;
+    void onPoolKeysExpired(const std::vector<uint32_t>& key_ids) override;
 
 private:
     void connectToRouter();
     void delayedConnectToRouter();
     void sendKeyPool(uint32_t key_count);
+    void onKeyExpiryTimer();
+    void collectStatistics();
+    void onStatistics(const proto::RelayStat& stat);
+    void sendDrain();
+    void onDrainTimer();
+    void onDrainStatistics(const proto::RelayStat& stat);
 
     // Router settings.
     std::u16string router_address_;
@@ -71,13 +86,33 @@ private:
     uint16_t peer_port_ = 0;
     std::chrono::minutes peer_idle_timeout_;
     uint32_t max_peer_count_ = 0;
+    uint32_t session_thread_count_ = 0;
+    bool zero_copy_forwarding_ = false;
+    BandwidthLimiter::Limits bandwidth_limits_;
+    uint16_t metrics_port_ = 0;
+    std::chrono::minutes drain_timeout_;
 
     std::shared_ptr<base::TaskRunner> task_runner_;
     base::WaitableTimer reconnect_timer_;
+    base::WaitableTimer statistics_timer_;
+    base::WaitableTimer key_expiry_timer_;
+    base::WaitableTimer drain_timer_;
     std::unique_ptr<base::NetworkChannel> channel_;
     std::unique_ptr<base::ClientAuthenticator> authenticator_;
     std::unique_ptr<SharedPool> shared_pool_;
+
+    // Keys given to peers by the router, in order of their expiration time.
+    using TimePoint = std::chrono::steady_clock::time_point;
+    std::deque<std::pair<TimePoint, uint32_t>> expiring_keys_;
+
+    // Set when the relay is going to stop.
+    bool is_draining_ = false;
+    DrainCallback drain_callback_;
+    TimePoint drain_start_time_;
+    bool is_accepting_ = true;
+
     std::unique_ptr<SessionsWorker> sessions_worker_;
+    std::unique_ptr<MetricsServer> metrics_server_;
 
     DISALLOW_COPY_AND_ASSIGN(Controller);
 };
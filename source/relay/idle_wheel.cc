@@ -0,0 +1,94 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "relay/idle_wheel.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+
+namespace relay {
+
+IdleWheel::IdleWheel(const std::chrono::minutes& idle_timeout,
+                     const std::chrono::minutes& tick_interval)
+    : idle_timeout_(idle_timeout),
+      tick_interval_(tick_interval)
+{
+    DCHECK(tick_interval_.count() > 0);
+
+    // One extra slot so that the slot for the longest delay never matches the current one.
+    slots_.resize(static_cast<size_t>(
+        (idle_timeout_ + tick_interval_ - std::chrono::seconds(1)) / tick_interval_) + 1);
+}
+
+IdleWheel::~IdleWheel() = default;
+
+void IdleWheel::add(Session* session)
+{
+    addToSlot(session, slots_.size() - 1);
+}
+
+void IdleWheel::remove(Session* session)
+{
+    auto it = slot_index_.find(session);
+    if (it == slot_index_.end())
+        return;
+
+    slots_[it->second].erase(session);
+    slot_index_.erase(it);
+}
+
+std::vector<Session*> IdleWheel::tick(const Session::TimePoint& current_time)
+{
+    current_slot_ = (current_slot_ + 1) % slots_.size();
+
+    std::unordered_set<Session*> due;
+    due.swap(slots_[current_slot_]);
+
+    std::vector<Session*> expired;
+
+    for (Session* session : due)
+    {
+        const std::chrono::seconds idle_time = session->idleTime(current_time);
+        if (idle_time >= idle_timeout_)
+        {
+            slot_index_.erase(session);
+            expired.push_back(session);
+            continue;
+        }
+
+        // The session was active recently. Check it again when its new deadline comes.
+        const std::chrono::seconds remaining = idle_timeout_ - idle_time;
+        const size_t ticks = static_cast<size_t>(
+            (remaining + tick_interval_ - std::chrono::seconds(1)) / tick_interval_);
+
+        addToSlot(session, std::clamp(ticks, size_t(1), slots_.size() - 1));
+    }
+
+    return expired;
+}
+
+void IdleWheel::addToSlot(Session* session, size_t ticks)
+{
+    const size_t slot = (current_slot_ + ticks) % slots_.size();
+
+    slots_[slot].insert(session);
+    slot_index_[session] = slot;
+}
+
+} // namespace relay
@@ -0,0 +1,62 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef RELAY__IDLE_WHEEL_H
+#define RELAY__IDLE_WHEEL_H
+
+#include "relay/session.h"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace relay {
+
+// Tracks idle sessions without scanning all of them on every tick. Each session is placed in the
+// slot of the tick at which it may become idle for |idle_timeout|. On every tick only the sessions
+// of the current slot are checked: idle ones are returned, the rest are moved to the slot of
+// their new deadline.
+class IdleWheel
+{
+public:
+    IdleWheel(const std::chrono::minutes& idle_timeout, const std::chrono::minutes& tick_interval);
+    ~IdleWheel();
+
+    void add(Session* session);
+    void remove(Session* session);
+
+    // Advances the wheel by one tick and returns sessions that have been idle for the timeout.
+    // The returned sessions are removed from the wheel.
+    std::vector<Session*> tick(const Session::TimePoint& current_time);
+
+private:
+    void addToSlot(Session* session, size_t ticks);
+
+    const std::chrono::seconds idle_timeout_;
+    const std::chrono::seconds tick_interval_;
+
+    std::vector<std::unordered_set<Session*>> slots_;
+    std::unordered_map<Session*, size_t> slot_index_;
+    size_t current_slot_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(IdleWheel);
+};
+
+} // namespace relay
+
+#endif // RELAY__IDLE_WHEEL_H
@@ -29,7 +29,10 @@
 #else
 #include "base/crypto/scoped_crypto_initializer.h"
 #include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
 #include "relay/controller.h"
+
+#include <asio/signal_set.hpp>
 #endif
 
 #include <iostream>
@@ -142,12 +145,33 @@ int main(int argc, const char* const* argv)
         std::unique_ptr<base::MessageLoop> message_loop =
             std::make_unique<base::MessageLoop>(base::MessageLoop::Type::ASIO);
 
+        std::shared_ptr<base::TaskRunner> task_runner = message_loop->taskRunner();
         std::unique_ptr<relay::Controller> controller =
-            std::make_unique<relay::Controller>(message_loop->taskRunner());
+            std::make_unique<relay::Controller>(task_runner);
+
+        // The first signal stops the relay after its sessions have finished, the second one stops
+        // it immediately.
+        std::unique_ptr<asio::signal_set> signals = std::make_unique<asio::signal_set>(
+            message_loop->pumpAsio()->ioContext(), SIGINT, SIGTERM);
+        signals->async_wait([&](const std::error_code& error_code, int signal_number)
+        {
+            if (error_code)
+                return;
+
+            LOG(LS_INFO) << "Signal received: " << signal_number;
+            controller->drain([task_runner]() { task_runner->postQuit(); });
+
+            signals->async_wait([task_runner](const std::error_code& error_code, int)
+            {
+                if (!error_code)
+                    task_runner->postQuit();
+            });
+        });
 
         controller->start();
         message_loop->run();
 
+        signals.reset();
         controller.reset();
         message_loop.reset();
     }
@@ -0,0 +1,269 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "relay/metrics_server.h"
+
+#include "base/logging.h"
+#include "base/memory/byte_array_pool.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
+#include "base/strings/unicode.h"
+#include "relay/statistics.h"
+
+#include <asio/read_until.hpp>
+#include <asio/streambuf.hpp>
+#include <asio/write.hpp>
+
+#include <sstream>
+
+namespace relay {
+
+namespace {
+
+constexpr size_t kMaxRequestSize = 8 * 1024;
+
+void writeMetric(std::ostringstream& stream, const char* name, const char* type,
+                 const char* help, uint64_t value)
+{
+    stream << "# HELP " << name << ' ' << help << '\n'
+           << "# TYPE " << name << ' ' << type << '\n'
+           << name << ' ' << value << '\n';
+}
+
+} // namespace
+
+class MetricsServer::Connection : public std::enable_shared_from_this<Connection>
+{
+public:
+    Connection(asio::ip::tcp::socket&& socket, std::string&& content)
+        : socket_(std::move(socket)),
+          request_(kMaxRequestSize),
+          content_(std::move(content))
+    {
+        // Nothing
+    }
+
+    void start()
+    {
+        // We serve only the metrics, so the content of the request does not matter. Wait for
+        // the end of the request headers and send the response.
+        asio::async_read_until(socket_, request_, "\r\n\r\n",
+            [self = shared_from_this()](const std::error_code& error_code, size_t /* bytes */)
+        {
+            if (error_code)
+                return;
+
+            self->onRequest();
+        });
+    }
+
+private:
+    void onRequest()
+    {
+        std::ostringstream stream;
+        stream << "HTTP/1.1 200 OK\r\n"
+               << "Content-Type: text/plain; version=0.0.4\r\n"
+               << "Content-Length: " << content_.size() << "\r\n"
+               << "Connection: close\r\n\r\n"
+               << content_;
+        response_ = stream.str();
+
+        asio::async_write(socket_, asio::buffer(response_),
+            [self = shared_from_this()](const std::error_code& /* error_code */, size_t /* bytes */)
+        {
+            std::error_code ignored_code;
+            self->socket_.shutdown(asio::ip::tcp::socket::shutdown_both, ignored_code);
+            self->socket_.close(ignored_code);
+        });
+    }
+
+    asio::ip::tcp::socket socket_;
+    asio::streambuf request_;
+    std::string content_;
+    std::string response_;
+
+    DISALLOW_COPY_AND_ASSIGN(Connection);
+};
+
+MetricsServer::MetricsServer(uint16_t port)
+    : port_(port),
+      acceptor_(base::MessageLoop::current()->pumpAsio()->ioContext())
+{
+    DCHECK(port_);
+}
+
+MetricsServer::~MetricsServer()
+{
+    std::error_code ignored_code;
+    acceptor_.cancel(ignored_code);
+    acceptor_.close(ignored_code);
+}
+
+bool MetricsServer::start()
+{
+    asio::ip::tcp::endpoint endpoint(asio::ip::address_v4::loopback(), port_);
+    std::error_code error_code;
+
+    acceptor_.open(endpoint.protocol(), error_code);
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "acceptor_.open failed: " << base::utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    acceptor_.set_option(asio::ip::tcp::acceptor::reuse_address(true), error_code);
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "acceptor_.set_option failed: "
+                      << base::utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    acceptor_.bind(endpoint, error_code);
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "acceptor_.bind failed: " << base::utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    acceptor_.listen(asio::ip::tcp::socket::max_listen_connections, error_code);
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "acceptor_.listen failed: "
+                      << base::utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    LOG(LS_INFO) << "Metrics server started on port " << port_;
+
+    doAccept(this);
+    return true;
+}
+
+void MetricsServer::setStatistics(const proto::RelayStat& stat)
+{
+    stat_ = stat;
+    LatencyHistogram::merge(stat.forward_latency(), &forward_latency_);
+}
+
+// static
+void MetricsServer::doAccept(MetricsServer* self)
+{
+    self->acceptor_.async_accept(
+        [self](const std::error_code& error_code, asio::ip::tcp::socket socket)
+    {
+        if (error_code)
+        {
+            if (error_code == asio::error::operation_aborted)
+                return;
+
+            LOG(LS_ERROR) << "Error while accepting connection: "
+                          << base::utf16FromLocal8Bit(error_code.message());
+        }
+        else
+        {
+            std::make_shared<Connection>(std::move(socket), self->metricsText())->start();
+        }
+
+        doAccept(self);
+    });
+}
+
+std::string MetricsServer::metricsText() const
+{
+    std::ostringstream stream;
+
+    writeMetric(stream, "aspia_relay_sessions", "gauge",
+                "Number of active peer sessions.", stat_.session_count());
+    writeMetric(stream, "aspia_relay_rx_bytes", "gauge",
+                "Bytes received from peers of active sessions.", stat_.rx_bytes());
+    writeMetric(stream, "aspia_relay_tx_bytes", "gauge",
+                "Bytes sent to peers of active sessions.", stat_.tx_bytes());
+    writeMetric(stream, "aspia_relay_rx_bytes_per_second", "gauge",
+                "Receive rate of active sessions.", stat_.rx_speed());
+    writeMetric(stream, "aspia_relay_tx_bytes_per_second", "gauge",
+                "Send rate of active sessions.", stat_.tx_speed());
+    writeMetric(stream, "aspia_relay_pending_bytes", "gauge",
+                "Bytes received but not yet sent.", stat_.pending_bytes());
+
+    const base::ByteArrayPool::Statistics pool = base::ByteArrayPool::statistics();
+
+    writeMetric(stream, "aspia_relay_buffer_pool_cached_bytes", "gauge",
+                "Memory of the released buffers kept for reuse.", pool.cached_bytes);
+    writeMetric(stream, "aspia_relay_buffer_pool_acquired_total", "counter",
+                "Buffers taken by sessions and messages.", pool.acquired);
+    writeMetric(stream, "aspia_relay_buffer_pool_reused_total", "counter",
+                "Buffers taken from the pool without an allocation.", pool.reused);
+    writeMetric(stream, "aspia_relay_buffer_pool_dropped_total", "counter",
+                "Released buffers freed because the pool was full.", pool.dropped);
+
+    stream << "# HELP aspia_relay_session_rx_bytes_per_second Receive rate of a session.\n"
+           << "# TYPE aspia_relay_session_rx_bytes_per_second gauge\n";
+    for (int i = 0; i < stat_.session_size(); ++i)
+    {
+        stream << "aspia_relay_session_rx_bytes_per_second{key_id=\""
+               << stat_.session(i).key_id() << "\"} " << stat_.session(i).rx_speed() << '\n';
+    }
+
+    stream << "# HELP aspia_relay_session_tx_bytes_per_second Send rate of a session.\n"
+           << "# TYPE aspia_relay_session_tx_bytes_per_second gauge\n";
+    for (int i = 0; i < stat_.session_size(); ++i)
+    {
+        stream << "aspia_relay_session_tx_bytes_per_second{key_id=\""
+               << stat_.session(i).key_id() << "\"} " << stat_.session(i).tx_speed() << '\n';
+    }
+
+    stream << "# HELP aspia_relay_session_pending_bytes Bytes of a session not yet sent.\n"
+           << "# TYPE aspia_relay_session_pending_bytes gauge\n";
+    for (int i = 0; i < stat_.session_size(); ++i)
+    {
+        stream << "aspia_relay_session_pending_bytes{key_id=\""
+               << stat_.session(i).key_id() << "\"} " << stat_.session(i).pending_bytes() << '\n';
+    }
+
+    stream << "# HELP aspia_relay_session_idle_seconds Time without data transfer.\n"
+           << "# TYPE aspia_relay_session_idle_seconds gauge\n";
+    for (int i = 0; i < stat_.session_size(); ++i)
+    {
+        stream << "aspia_relay_session_idle_seconds{key_id=\""
+               << stat_.session(i).key_id() << "\"} " << stat_.session(i).idle_time() << '\n';
+    }
+
+    stream << "# HELP aspia_relay_forward_latency_milliseconds Time from receiving data from "
+              "a peer to sending it to the other peer.\n"
+           << "# TYPE aspia_relay_forward_latency_milliseconds histogram\n";
+
+    // Prometheus histogram buckets are cumulative.
+    uint64_t total = 0;
+    for (int i = 0; i < forward_latency_.count_size(); ++i)
+    {
+        total += forward_latency_.count(i);
+
+        stream << "aspia_relay_forward_latency_milliseconds_bucket{le=\"";
+        if (i < forward_latency_.upper_bound_size())
+            stream << forward_latency_.upper_bound(i);
+        else
+            stream << "+Inf";
+        stream << "\"} " << total << '\n';
+    }
+    stream << "aspia_relay_forward_latency_milliseconds_count " << total << '\n';
+
+    return stream.str();
+}
+
+} // namespace relay
@@ -0,0 +1,60 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef RELAY__METRICS_SERVER_H
+#define RELAY__METRICS_SERVER_H
+
+#include "base/macros_magic.h"
+#include "proto/router_relay.pb.h"
+
+#include <asio/ip/tcp.hpp>
+
+namespace relay {
+
+// Serves the relay statistics in the Prometheus text format over HTTP. The server only listens
+// on the loopback interface.
+class MetricsServer
+{
+public:
+    explicit MetricsServer(uint16_t port);
+    ~MetricsServer();
+
+    bool start();
+
+    // Updates the served statistics. The latency histogram in |stat| contains the values since
+    // the previous call, the server accumulates them.
+    void setStatistics(const proto::RelayStat& stat);
+
+private:
+    class Connection;
+
+    static void doAccept(MetricsServer* self);
+    std::string metricsText() const;
+
+    const uint16_t port_;
+    asio::ip::tcp::acceptor acceptor_;
+
+    proto::RelayStat stat_;
+    proto::RelayLatencyHistogram forward_latency_;
+
+    DISALLOW_COPY_AND_ASSIGN(MetricsServer);
+};
+
+} // namespace relay
+
+#endif // RELAY__METRICS_SERVER_H
@@ -68,6 +68,14 @@ void PendingSession::start()
     PendingSession::doReadMessage(this);
 }
 
+void PendingSession::startAuthenticated(uint32_t key_id, const base::ByteArray& secret)
+{
+    setIdentify(key_id, secret);
+
+    timer_.start(kTimeout, std::bind(
+        &PendingSession::onErrorOccurred, this, FROM_HERE, std::error_code()));
+}
+
 void PendingSession::stop()
 {
     if (!delegate_)
@@ -59,12 +59,20 @@ public:
     // will be called.
     void start();
 
+    // Starts a session for a peer that has already been authenticated on another thread. Only the
+    // timer is started: if the opposite peer is not found in time, onPendingSessionFailed() will
+    // be called.
+    void startAuthenticated(uint32_t key_id, const base::ByteArray& secret);
+
     // Stops a session. No notifications will not come after calling this method.
     void stop();
 
     // Sets session credentials.
     void setIdentify(uint32_t key_id, const base::ByteArray& secret);
 
+    uint32_t keyId() const { return key_id_; }
+    const base::ByteArray& secret() const { return secret_; }
+
     // Returns true if the other session is a pair and false otherwise.
     bool isPeerFor(const PendingSession& other) const;
 
@@ -20,22 +20,51 @@
 
 #include "base/location.h"
 #include "base/logging.h"
+#include "base/memory/byte_array_pool.h"
 #include "base/strings/unicode.h"
 
 #include <asio/write.hpp>
 
+#include <algorithm>
+
+#if defined(OS_LINUX)
+#include <fcntl.h>
+#include <unistd.h>
+#endif // defined(OS_LINUX)
+
 namespace relay {
 
-Session::Session(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& sockets)
-    : socket_{ std::move(sockets.first), std::move(sockets.second) }
+namespace {
+
+#if defined(OS_LINUX)
+// Maximum number of bytes moved by one splice() call.
+const size_t kSpliceChunkSize = 64 * 1024;
+#endif // defined(OS_LINUX)
+
+} // namespace
+
+Session::Session(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& sockets,
+                 uint32_t key_id,
+                 bool zero_copy,
+                 BandwidthLimiter* limiter)
+    : key_id_(key_id),
+      zero_copy_(zero_copy),
+      socket_{ std::move(sockets.first), std::move(sockets.second) },
+      limiter_(limiter && limiter->isEnabled() ? limiter : nullptr)
 {
-    for (size_t i = 0; i < kNumberOfSides; ++i)
-        std::fill(buffer_[i].begin(), buffer_[i].end(), 0);
+    // Nothing
 }
 
 Session::~Session()
 {
     stop();
+
+    // Sessions come and go all the time, their buffers are used by the next sessions.
+    for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        for (auto& buffer : direction_[i].buffer)
+            base::ByteArrayPool::release(std::move(buffer));
+    }
 }
 
 void Session::start(Delegate* delegate)
@@ -43,8 +72,25 @@ void Session::start(Delegate* delegate)
     LOG(LS_INFO) << "Starting peers session";
 
     start_time_ = Clock::now();
+    last_stat_time_ = start_time_;
+    last_activity_time_ = start_time_;
     delegate_ = delegate;
 
+    if (limiter_)
+    {
+        for (int i = 0; i < kNumberOfSides; ++i)
+            limiter_client_[i] = std::make_unique<BandwidthLimiter::Client>(limiter_);
+    }
+
+#if defined(OS_LINUX)
+    if (zero_copy_ && startZeroCopy())
+    {
+        for (int i = 0; i < kNumberOfSides; ++i)
+            Session::doSpliceRead(this, i);
+        return;
+    }
+#endif // defined(OS_LINUX)
+
     for (int i = 0; i < kNumberOfSides; ++i)
         Session::doReadSome(this, i);
 }
@@ -56,6 +102,10 @@ void Session::stop()
 
     delegate_ = nullptr;
 
+    // Pending requests for bandwidth are canceled.
+    for (int i = 0; i < kNumberOfSides; ++i)
+        limiter_client_[i].reset();
+
     std::error_code ignored_code;
     for (int i = 0; i < kNumberOfSides; ++i)
     {
@@ -63,19 +113,20 @@ void Session::stop()
         socket_[i].close(ignored_code);
     }
 
+#if defined(OS_LINUX)
+    closePipes();
+#endif // defined(OS_LINUX)
+
     LOG(LS_INFO) << "Session stopped (duration: " << duration().count()
                  << " seconds, bytes transferred: " << bytesTransferred() << ")";
 }
 
 std::chrono::seconds Session::idleTime(const TimePoint& current_time) const
 {
-    if (start_idle_time_ == TimePoint())
-    {
-        start_idle_time_ = current_time;
+    if (current_time <= last_activity_time_)
         return std::chrono::seconds(0);
-    }
 
-    return std::chrono::duration_cast<std::chrono::seconds>(current_time - start_idle_time_);
+    return std::chrono::duration_cast<std::chrono::seconds>(current_time - last_activity_time_);
 }
 
 std::chrono::seconds Session::duration() const
@@ -88,42 +139,366 @@ int64_t Session::bytesTransferred() const
     return bytes_transferred_;
 }
 
+void Session::collectStatistics(const TimePoint& current_time, proto::RelayStat* stat)
+{
+    DCHECK(stat);
+
+    const int64_t elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        current_time - last_stat_time_).count();
+
+    uint64_t rx_speed = 0;
+    uint64_t tx_speed = 0;
+
+    if (elapsed_ms > 0)
+    {
+        rx_speed = static_cast<uint64_t>(
+            (bytes_transferred_ - last_bytes_transferred_) * 1000 / elapsed_ms);
+        tx_speed = static_cast<uint64_t>((bytes_sent_ - last_bytes_sent_) * 1000 / elapsed_ms);
+    }
+
+    last_stat_time_ = current_time;
+    last_bytes_transferred_ = bytes_transferred_;
+    last_bytes_sent_ = bytes_sent_;
+
+    uint64_t pending_bytes = 0;
+
+    for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        pending_bytes += direction_[i].data_size[0] + direction_[i].data_size[1];
+#if defined(OS_LINUX)
+        pending_bytes += pipe_[i].pending;
+#endif // defined(OS_LINUX)
+    }
+
+    proto::RelaySessionStat* session_stat = stat->add_session();
+    session_stat->set_key_id(key_id_);
+    session_stat->set_duration(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::seconds>(current_time - start_time_).count()));
+    session_stat->set_idle_time(static_cast<uint64_t>(idleTime(current_time).count()));
+    session_stat->set_rx_bytes(static_cast<uint64_t>(bytes_transferred_));
+    session_stat->set_tx_bytes(static_cast<uint64_t>(bytes_sent_));
+    session_stat->set_rx_speed(rx_speed);
+    session_stat->set_tx_speed(tx_speed);
+    session_stat->set_pending_bytes(pending_bytes);
+
+    stat->set_session_count(stat->session_count() + 1);
+    stat->set_rx_bytes(stat->rx_bytes() + session_stat->rx_bytes());
+    stat->set_tx_bytes(stat->tx_bytes() + session_stat->tx_bytes());
+    stat->set_rx_speed(stat->rx_speed() + rx_speed);
+    stat->set_tx_speed(stat->tx_speed() + tx_speed);
+    stat->set_pending_bytes(stat->pending_bytes() + pending_bytes);
+
+    forward_latency_.take(stat->mutable_forward_latency());
+}
+
 // static
 void Session::doReadSome(Session* session, int source)
 {
+    Direction& direction = session->direction_[source];
+    const int index = direction.read_index;
+    std::vector<uint8_t>& buffer = direction.buffer[index];
+
+    // The buffer is free, so it can be replaced before the next read.
+    if (buffer.size() != direction.buffer_size)
+    {
+        base::ByteArrayPool::release(std::move(buffer));
+        buffer = base::ByteArrayPool::acquire(direction.buffer_size);
+    }
+
+    direction.reading = true;
+
+    size_t size = buffer.size();
+
+    BandwidthLimiter::Client* limiter_client = session->limiter_client_[source].get();
+    if (limiter_client)
+    {
+        size = limiter_client->request(size, [session, source](size_t granted)
+        {
+            doReadSome(session, source, granted);
+        });
+
+        // The read will be started when the bandwidth is available.
+        if (!size)
+            return;
+    }
+
+    doReadSome(session, source, size);
+}
+
+// static
+void Session::doReadSome(Session* session, int source, size_t size)
+{
+    Direction& direction = session->direction_[source];
+    const int index = direction.read_index;
+    std::vector<uint8_t>& buffer = direction.buffer[index];
+
     session->socket_[source].async_read_some(
-        asio::buffer(session->buffer_[source].data(), session->buffer_[source].size()),
-        [session, source](const std::error_code& error_code, size_t bytes_transferred)
+        asio::buffer(buffer.data(), size),
+        [session, source, index, size](const std::error_code& error_code,
+                                       size_t bytes_transferred)
+    {
+        if (error_code)
+        {
+            if (error_code != asio::error::operation_aborted)
+                session->onErrorOccurred(FROM_HERE, error_code);
+            return;
+        }
+
+        Direction& direction = session->direction_[source];
+
+        direction.reading = false;
+        direction.data_size[index] = bytes_transferred;
+        direction.read_time[index] = Clock::now();
+
+        session->bytes_transferred_ += bytes_transferred;
+        session->last_activity_time_ = direction.read_time[index];
+
+        BandwidthLimiter::Client* limiter_client = session->limiter_client_[source].get();
+        if (limiter_client)
+            limiter_client->giveBack(size - bytes_transferred);
+
+        // If the read filled the whole buffer, there is more data in the socket than we can take
+        // at once. Increase the size for the next reads.
+        if (bytes_transferred == direction.buffer[index].size() &&
+            direction.buffer_size < kMaxBufferSize)
+        {
+            direction.buffer_size = std::min(direction.buffer_size * 2, kMaxBufferSize);
+        }
+
+        if (!direction.writing)
+            doWrite(session, source, index);
+
+        // While the data is being written to the opposite side, read into the second buffer.
+        direction.read_index = index ^ 1;
+        if (direction.isFree(direction.read_index))
+            doReadSome(session, source);
+    });
+}
+
+// static
+void Session::doWrite(Session* session, int source, int index)
+{
+    Direction& direction = session->direction_[source];
+
+    direction.writing = true;
+    direction.write_index = index;
+
+    asio::async_write(
+        session->socket_[(source + kNumberOfSides - 1) % kNumberOfSides],
+        asio::const_buffer(direction.buffer[index].data(), direction.data_size[index]),
+        [session, source, index](const std::error_code& error_code, size_t bytes_transferred)
     {
         if (error_code)
         {
             if (error_code != asio::error::operation_aborted)
                 session->onErrorOccurred(FROM_HERE, error_code);
+            return;
+        }
+
+        Direction& direction = session->direction_[source];
+
+        session->bytes_sent_ += bytes_transferred;
+        session->forward_latency_.add(std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - direction.read_time[index]));
+
+        direction.writing = false;
+        direction.data_size[index] = 0;
+
+        // The second buffer may have been filled while we were writing.
+        const int next_index = index ^ 1;
+        if (direction.data_size[next_index])
+            doWrite(session, source, next_index);
+
+        if (!direction.reading && direction.isFree(direction.read_index))
+            doReadSome(session, source);
+    });
+}
+
+#if defined(OS_LINUX)
+bool Session::startZeroCopy()
+{
+    for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        int fds[2];
+
+        if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0)
+        {
+            PLOG(LS_WARNING) << "pipe2 failed. Buffered forwarding will be used";
+            closePipes();
+            return false;
         }
-        else
+
+        pipe_[i].read_fd = fds[0];
+        pipe_[i].write_fd = fds[1];
+        pipe_[i].pending = 0;
+
+        // splice() is called directly with native descriptors, they must not block.
+        std::error_code error_code;
+        socket_[i].native_non_blocking(true, error_code);
+        if (error_code)
         {
-            session->bytes_transferred_ += bytes_transferred;
-            session->start_idle_time_ = TimePoint();
+            LOG(LS_WARNING) << "Unable to set non-blocking mode: "
+                            << base::utf16FromLocal8Bit(error_code.message());
+            closePipes();
+            return false;
+        }
+    }
+
+    LOG(LS_INFO) << "Zero-copy forwarding enabled";
+    return true;
+}
 
-            asio::async_write(
-                session->socket_[(source + kNumberOfSides - 1) % kNumberOfSides],
-                asio::const_buffer(session->buffer_[source].data(), bytes_transferred),
-                [session, source](const std::error_code& error_code, size_t /* bytes_transferred */)
+void Session::closePipes()
+{
+    for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        if (pipe_[i].read_fd != -1)
+        {
+            close(pipe_[i].read_fd);
+            pipe_[i].read_fd = -1;
+        }
+
+        if (pipe_[i].write_fd != -1)
+        {
+            close(pipe_[i].write_fd);
+            pipe_[i].write_fd = -1;
+        }
+
+        pipe_[i].pending = 0;
+    }
+}
+
+// static
+void Session::doSpliceRead(Session* session, int source)
+{
+    session->socket_[source].async_wait(asio::ip::tcp::socket::wait_read,
+                                        [session, source](const std::error_code& error_code)
+    {
+        if (error_code)
+        {
+            if (error_code != asio::error::operation_aborted)
+                session->onErrorOccurred(FROM_HERE, error_code);
+            return;
+        }
+
+        size_t size = kSpliceChunkSize;
+
+        BandwidthLimiter::Client* limiter_client = session->limiter_client_[source].get();
+        if (limiter_client)
+        {
+            size = limiter_client->request(size, [session, source](size_t granted)
             {
-                if (error_code)
-                {
-                    if (error_code != asio::error::operation_aborted)
-                        session->onErrorOccurred(FROM_HERE, error_code);
-                }
-                else
-                {
-                    doReadSome(session, source);
-                }
+                doSplice(session, source, granted);
             });
+
+            // The data will be moved when the bandwidth is available.
+            if (!size)
+                return;
         }
+
+        doSplice(session, source, size);
     });
 }
 
+// static
+void Session::doSplice(Session* session, int source, size_t size)
+{
+    Pipe& pipe = session->pipe_[source];
+    BandwidthLimiter::Client* limiter_client = session->limiter_client_[source].get();
+
+    ssize_t result = splice(session->socket_[source].native_handle(), nullptr,
+                            pipe.write_fd, nullptr, size,
+                            SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (result < 0)
+    {
+        if (errno == EAGAIN || errno == EINTR)
+        {
+            if (limiter_client)
+                limiter_client->giveBack(size);
+
+            doSpliceRead(session, source);
+            return;
+        }
+
+        session->onErrorOccurred(
+            FROM_HERE, std::error_code(errno, std::system_category()));
+        return;
+    }
+
+    if (result == 0)
+    {
+        // The peer closed the connection.
+        session->onErrorOccurred(FROM_HERE, asio::error::eof);
+        return;
+    }
+
+    if (limiter_client)
+        limiter_client->giveBack(size - static_cast<size_t>(result));
+
+    if (!pipe.pending)
+        pipe.read_time = Clock::now();
+
+    pipe.pending += static_cast<size_t>(result);
+    session->bytes_transferred_ += result;
+
+    doSpliceWrite(session, source);
+}
+
+// static
+void Session::doSpliceWrite(Session* session, int source)
+{
+    Pipe& pipe = session->pipe_[source];
+    const int target = (source + kNumberOfSides - 1) % kNumberOfSides;
+
+    while (pipe.pending > 0)
+    {
+        ssize_t result = splice(pipe.read_fd, nullptr,
+                                session->socket_[target].native_handle(), nullptr, pipe.pending,
+                                SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (result < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN)
+            {
+                // The target socket is full. Wait until it becomes writable.
+                session->socket_[target].async_wait(
+                    asio::ip::tcp::socket::wait_write,
+                    [session, source](const std::error_code& error_code)
+                {
+                    if (error_code)
+                    {
+                        if (error_code != asio::error::operation_aborted)
+                            session->onErrorOccurred(FROM_HERE, error_code);
+                        return;
+                    }
+
+                    doSpliceWrite(session, source);
+                });
+                return;
+            }
+
+            session->onErrorOccurred(
+                FROM_HERE, std::error_code(errno, std::system_category()));
+            return;
+        }
+
+        pipe.pending -= static_cast<size_t>(result);
+        session->bytes_sent_ += result;
+    }
+
+    // The activity time is updated once per drained pipe rather than for every splice call.
+    const TimePoint current_time = Clock::now();
+
+    session->last_activity_time_ = current_time;
+    session->forward_latency_.add(std::chrono::duration_cast<std::chrono::microseconds>(
+        current_time - pipe.read_time));
+
+    doSpliceRead(session, source);
+}
+#endif // defined(OS_LINUX)
+
 void Session::onErrorOccurred(const base::Location& location, const std::error_code& error_code)
 {
     LOG(LS_ERROR) << "Connection finished: " << base::utf16FromLocal8Bit(error_code.message())
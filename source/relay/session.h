@@ -20,6 +20,9 @@
 #define RELAY__SESSION_H
 
 #include "base/macros_magic.h"
+#include "build/build_config.h"
+#include "relay/bandwidth_limiter.h"
+#include "relay/statistics.h"
 
 #include <asio/ip/tcp.hpp>
 
@@ -32,7 +35,14 @@ namespace relay {
 class Session
 {
 public:
-    explicit Session(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& sockets);
+    // If |zero_copy| is true and the platform supports it, data is forwarded between sockets
+    // without copying it to user space. Otherwise the buffered forwarding is used.
+    // If |limiter| is not null, the forwarding rate is limited by it. The limiter must outlive
+    // the call to stop().
+    Session(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& sockets,
+            uint32_t key_id,
+            bool zero_copy,
+            BandwidthLimiter* limiter);
     ~Session();
 
     using Clock = std::chrono::high_resolution_clock;
@@ -49,23 +59,88 @@ public:
     void start(Delegate* delegate);
     void stop();
 
+    // Returns the time elapsed since the last data was forwarded by the session.
     std::chrono::seconds idleTime(const TimePoint& current_time) const;
     std::chrono::seconds duration() const;
     int64_t bytesTransferred() const;
+    uint32_t keyId() const { return key_id_; }
+
+    // Adds the session statistics collected since the previous call to |stat|.
+    void collectStatistics(const TimePoint& current_time, proto::RelayStat* stat);
 
 private:
     static void doReadSome(Session* session, int source);
+    static void doReadSome(Session* session, int source, size_t size);
+    static void doWrite(Session* session, int source, int index);
+
+#if defined(OS_LINUX)
+    bool startZeroCopy();
+    void closePipes();
+    static void doSpliceRead(Session* session, int source);
+    static void doSplice(Session* session, int source, size_t size);
+    static void doSpliceWrite(Session* session, int source);
+#endif // defined(OS_LINUX)
+
     void onErrorOccurred(const base::Location& location, const std::error_code& error_code);
 
     TimePoint start_time_;
-    mutable TimePoint start_idle_time_;
+    TimePoint last_activity_time_;
     int64_t bytes_transferred_ = 0;
+    int64_t bytes_sent_ = 0;
+    const uint32_t key_id_;
+    const bool zero_copy_;
+
+    TimePoint last_stat_time_;
+    int64_t last_bytes_transferred_ = 0;
+    int64_t last_bytes_sent_ = 0;
+    LatencyHistogram forward_latency_;
 
     static const int kNumberOfSides = 2;
-    static const int kBufferSize = 8192;
+    static constexpr size_t kMinBufferSize = 8 * 1024;
+    static constexpr size_t kMaxBufferSize = 256 * 1024;
 
     asio::ip::tcp::socket socket_[kNumberOfSides];
-    std::array<uint8_t, kBufferSize> buffer_[kNumberOfSides];
+
+    // Data read from a socket is written to the opposite socket. Each direction has two buffers:
+    // while one of them is being written, the next read goes to the other one.
+    struct Direction
+    {
+        bool isFree(int index) const
+        {
+            return !data_size[index] && !(writing && write_index == index);
+        }
+
+        std::vector<uint8_t> buffer[2];
+        size_t data_size[2] = { 0, 0 };
+        TimePoint read_time[2];
+        size_t buffer_size = kMinBufferSize;
+
+        int read_index = 0;
+        int write_index = 0;
+        bool reading = false;
+        bool writing = false;
+    };
+
+    Direction direction_[kNumberOfSides];
+
+#if defined(OS_LINUX)
+    struct Pipe
+    {
+        int read_fd = -1;
+        int write_fd = -1;
+
+        // Number of bytes in the pipe that have not yet been written to the target socket.
+        size_t pending = 0;
+
+        // Time when the pipe became non-empty.
+        TimePoint read_time;
+    };
+
+    Pipe pipe_[kNumberOfSides];
+#endif // defined(OS_LINUX)
+
+    BandwidthLimiter* limiter_;
+    std::unique_ptr<BandwidthLimiter::Client> limiter_client_[kNumberOfSides];
 
     Delegate* delegate_ = nullptr;
 
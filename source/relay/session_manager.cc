@@ -22,9 +22,11 @@
 #include "base/task_runner.h"
 #include "base/message_loop/message_loop.h"
 #include "base/message_loop/message_pump_asio.h"
-#include "base/crypto/message_decryptor_openssl.h"
 #include "base/peer/host_id.h"
 #include "base/strings/unicode.h"
+#include "relay/session_shard.h"
+
+#include <algorithm>
 
 namespace relay {
 
@@ -32,80 +34,53 @@ namespace {
 
 const std::chrono::minutes kIdleTimerInterval { 1 };
 
-// Decrypts an encrypted pair of peer identifiers using key |session_key|.
-base::ByteArray decryptSecret(const proto::PeerToRelay& message, const SharedPool::Key& key)
+// Returns the key under which the pending session waits for the opposite peer.
+std::string peerKey(uint32_t key_id, const base::ByteArray& secret)
 {
-    if (key.first.empty() || key.second.empty())
-    {
-        LOG(LS_ERROR) << "Invalid session key";
-        return base::ByteArray();
-    }
-
-    std::unique_ptr<base::MessageDecryptor> decryptor =
-        base::MessageDecryptorOpenssl::createForChaCha20Poly1305(key.first, key.second);
-    if (!decryptor)
-    {
-        LOG(LS_ERROR) << "Decryptor not created";
-        return base::ByteArray();
-    }
-
-    const std::string& source = message.data();
-    if (source.empty())
-    {
-        LOG(LS_ERROR) << "Empty 'data' field";
-        return base::ByteArray();
-    }
-
-    base::ByteArray target;
-    target.resize(decryptor->decryptedDataSize(source.size()));
-
-    if (!decryptor->decrypt(source.data(), source.size(), target.data()))
-    {
-        LOG(LS_ERROR) << "Failed to decrypt shared secret";
-        return base::ByteArray();
-    }
-
-    return target;
+    std::string key;
+    key.reserve(sizeof(key_id) + secret.size());
+    key.append(reinterpret_cast<const char*>(&key_id), sizeof(key_id));
+    key.append(reinterpret_cast<const char*>(secret.data()), secret.size());
+    return key;
 }
 
 // Removes a session from the list and returns a pointer to it.
 template<class T>
-std::unique_ptr<T> removeSessionT(std::vector<std::unique_ptr<T>>* session_list, T* session)
+std::unique_ptr<T> removeSessionT(std::unordered_map<T*, std::unique_ptr<T>>* session_list,
+                                  T* session)
 {
     session->stop();
 
-    auto it = session_list->begin();
-    while (it != session_list->end())
-    {
-        if (it->get() == session)
-            break;
-
-        ++it;
-    }
-
-    if (it != session_list->end())
-    {
-        std::unique_ptr<T> result = std::move(*it);
-        session_list->erase(it);
-        return result;
-    }
+    auto it = session_list->find(session);
+    if (it == session_list->end())
+        return nullptr;
 
-    return nullptr;
+    std::unique_ptr<T> result = std::move(it->second);
+    session_list->erase(it);
+    return result;
 }
 
 } // namespace
 
 SessionManager::SessionManager(std::shared_ptr<base::TaskRunner> task_runner,
                                uint16_t port,
-                               const std::chrono::minutes& idle_timeout)
+                               const std::chrono::minutes& idle_timeout,
+                               bool zero_copy,
+                               const BandwidthLimiter::Limits& bandwidth_limits,
+                               const std::vector<SessionShard*>& shards)
     : task_runner_(std::move(task_runner)),
-      acceptor_(base::MessageLoop::current()->pumpAsio()->ioContext(),
-                asio::ip::tcp::endpoint(asio::ip::tcp::v4(), port)),
-      idle_timeout_(idle_timeout),
+      acceptor_(base::MessageLoop::current()->pumpAsio()->ioContext()),
+      port_(port),
+      bandwidth_limiter_(bandwidth_limits),
+      shards_(shards),
+      zero_copy_(zero_copy),
+      idle_wheel_(idle_timeout, kIdleTimerInterval),
       idle_timer_(base::MessageLoop::current()->pumpAsio()->ioContext())
 {
     DCHECK(task_runner_);
 
+    listen(&acceptor_, port);
+
     LOG(LS_INFO) << "Session manager port: " << port;
 }
 
@@ -129,62 +104,118 @@ void SessionManager::start(std::unique_ptr<SharedPool> shared_pool, Delegate* de
     idle_timer_.expires_after(kIdleTimerInterval);
     idle_timer_.async_wait(std::bind(&SessionManager::doIdleTimeout, this, std::placeholders::_1));
 
+#if defined(OS_LINUX)
+    // Each shard accepts peers on the same port itself. The kernel distributes new connections
+    // between the listeners, so there is no single accept queue.
+    const uint16_t shard_port = port_;
+#else
+    // Peers are accepted by the session manager only and distributed between the shards.
+    const uint16_t shard_port = 0;
+#endif // defined(OS_LINUX)
+
+    for (SessionShard* shard : shards_)
+        shard->startAuthentication(this, task_runner_, shared_pool_->share(), shard_port);
+
     SessionManager::doAccept(this);
 }
 
+void SessionManager::addAuthenticatedPeer(const Protocol& protocol,
+                                          NativeHandle handle,
+                                          uint32_t key_id,
+                                          const base::ByteArray& secret)
+{
+    DCHECK(task_runner_->belongsToCurrentThread());
+
+    asio::ip::tcp::socket socket(base::MessageLoop::current()->pumpAsio()->ioContext());
+    std::error_code error_code;
+
+    socket.assign(protocol, handle, error_code);
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Unable to assign authenticated peer socket: "
+                      << base::utf16FromLocal8Bit(error_code.message());
+        return;
+    }
+
+    std::unique_ptr<PendingSession> session = std::make_unique<PendingSession>(
+        task_runner_, std::move(socket), this);
+    PendingSession* session_ptr = session.get();
+
+    pending_sessions_.emplace(session_ptr, std::move(session));
+    session_ptr->startAuthenticated(key_id, secret);
+
+    findPeer(session_ptr);
+}
+
+void SessionManager::stopAccepting()
+{
+    DCHECK(task_runner_->belongsToCurrentThread());
+
+    LOG(LS_INFO) << "Stop accepting peers";
+
+    std::error_code ignored_code;
+    acceptor_.cancel(ignored_code);
+    acceptor_.close(ignored_code);
+
+    for (SessionShard* shard : shards_)
+        shard->stopAccepting();
+}
+
+// static
+bool SessionManager::listen(asio::ip::tcp::acceptor* acceptor, uint16_t port)
+{
+    asio::ip::tcp::endpoint endpoint(asio::ip::tcp::v4(), port);
+    std::error_code error_code;
+
+    acceptor->open(endpoint.protocol(), error_code);
+    if (!error_code)
+        acceptor->set_option(asio::ip::tcp::acceptor::reuse_address(true), error_code);
+#if defined(OS_LINUX)
+    if (!error_code)
+    {
+        acceptor->set_option(
+            asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true), error_code);
+    }
+#endif // defined(OS_LINUX)
+    if (!error_code)
+        acceptor->bind(endpoint, error_code);
+    if (!error_code)
+        acceptor->listen(asio::socket_base::max_listen_connections, error_code);
+
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Unable to listen on port " << port << ": "
+                      << base::utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    return true;
+}
+
+void SessionManager::collectStatistics(proto::RelayStat* stat)
+{
+    const Session::TimePoint current_time = Session::Clock::now();
+
+    for (const auto& session : active_sessions_)
+        session.second->collectStatistics(current_time, stat);
+}
+
 void SessionManager::onPendingSessionReady(
     PendingSession* session, const proto::PeerToRelay& message)
 {
     LOG(LS_INFO) << "Pending session ready for key_id: " << message.key_id();
 
-    // Looking for a key with the specified identifier.
-    std::optional<SharedPool::Key> key = shared_pool_->key(message.key_id(), message.public_key());
-    if (key.has_value())
-    {
-        // Decrypt the identifiers of peers.
-        base::ByteArray secret = decryptSecret(message, *key);
-        if (!secret.empty())
-        {
-            // Save the identifiers of peers and the identifier of their shared key.
-            session->setIdentify(message.key_id(), secret);
-
-            // Trying to find a peer that wants to be connected.
-            for (auto& other_session : pending_sessions_)
-            {
-                if (session->isPeerFor(*other_session))
-                {
-                    LOG(LS_INFO) << "Both peers are connected with key " << message.key_id();
-
-                    // Delete the key from the pool. It can no longer be used.
-                    shared_pool_->removeKey(message.key_id());
-
-                    // Now the opposite peer is found, start the data transfer between them.
-                    active_sessions_.emplace_back(std::make_unique<Session>(
-                        std::make_pair(session->takeSocket(), other_session->takeSocket())));
-                    active_sessions_.back()->start(this);
-
-                    // Pending sessions are no longer needed, remove them.
-                    removePendingSession(other_session.get());
-                    removePendingSession(session);
-                    return;
-                }
-            }
-
-            LOG(LS_INFO) << "Second peer has not connected yet";
-            return;
-        }
-        else
-        {
-            LOG(LS_WARNING) << "Failed to decrypt shared secret. Connection will be completed";
-        }
-    }
-    else
+    base::ByteArray secret = shared_pool_->decryptSecret(message);
+    if (secret.empty())
     {
-        LOG(LS_WARNING) << "Key with id " << message.key_id() << " NOT found!";
+        // The key was not found in the pool or the identifiers could not be decrypted.
+        removePendingSession(session);
+        return;
     }
 
-    // The key was not found in the pool.
-    removePendingSession(session);
+    // Save the identifiers of peers and the identifier of their shared key.
+    session->setIdentify(message.key_id(), secret);
+    findPeer(session);
 }
 
 void SessionManager::onPendingSessionFailed(PendingSession* session)
@@ -209,9 +240,7 @@ void SessionManager::doAccept(SessionManager* self)
                 socket.remote_endpoint().address().to_string());
 
             // A new peer is connected. Create and start the pending session.
-            self->pending_sessions_.emplace_back(std::make_unique<PendingSession>(
-                self->task_runner_, std::move(socket), self));
-            self->pending_sessions_.back()->start();
+            self->startPendingSession(std::move(socket));
         }
         else
         {
@@ -240,21 +269,13 @@ void SessionManager::doIdleTimeoutImpl(const std::error_code& error_code)
 {
     if (!error_code)
     {
-        auto current_time = Session::Clock::now();
-        auto it = active_sessions_.begin();
+        std::vector<Session*> expired = idle_wheel_.tick(Session::Clock::now());
         int count = 0;
 
-        while (it != active_sessions_.end())
+        for (Session* session : expired)
         {
-            if ((*it)->idleTime(current_time) >= idle_timeout_)
-            {
-                it = active_sessions_.erase(it);
+            if (active_sessions_.erase(session))
                 ++count;
-            }
-            else
-            {
-                ++it;
-            }
         }
 
         LOG(LS_INFO) << "Sessions ended by timeout: " << count;
@@ -268,13 +289,158 @@ void SessionManager::doIdleTimeoutImpl(const std::error_code& error_code)
     idle_timer_.async_wait(std::bind(&SessionManager::doIdleTimeout, this, std::placeholders::_1));
 }
 
+void SessionManager::startPendingSession(asio::ip::tcp::socket&& socket)
+{
+#if !defined(OS_LINUX)
+    // Authentication of peers includes the calculation of a session key. To keep the accept loop
+    // responsive, it is done on the shard threads.
+    if (startPendingSessionInShard(socket))
+        return;
+#endif // !defined(OS_LINUX)
+
+    // A new peer is connected. Create and start the pending session.
+    std::unique_ptr<PendingSession> session = std::make_unique<PendingSession>(
+        task_runner_, std::move(socket), this);
+    PendingSession* session_ptr = session.get();
+
+    pending_sessions_.emplace(session_ptr, std::move(session));
+    session_ptr->start();
+}
+
+bool SessionManager::startPendingSessionInShard(asio::ip::tcp::socket& socket)
+{
+    if (shards_.empty())
+        return false;
+
+    std::error_code error_code;
+
+    Protocol protocol = socket.local_endpoint(error_code).protocol();
+    if (error_code)
+        return false;
+
+    NativeHandle handle = socket.release(error_code);
+    if (error_code)
+        return false;
+
+    // Shards are used in turn.
+    SessionShard* shard = shards_[next_shard_];
+    next_shard_ = (next_shard_ + 1) % shards_.size();
+
+    shard->addPendingPeer(protocol, handle);
+    return true;
+}
+
+void SessionManager::findPeer(PendingSession* session)
+{
+    const uint32_t key_id = session->keyId();
+
+    // Trying to find a peer that wants to be connected.
+    auto result = waiting_peers_.try_emplace(peerKey(key_id, session->secret()), session);
+    if (result.second)
+    {
+        LOG(LS_INFO) << "Second peer has not connected yet";
+        return;
+    }
+
+    PendingSession* other_session = result.first->second;
+    DCHECK(session->isPeerFor(*other_session));
+
+    LOG(LS_INFO) << "Both peers are connected with key " << key_id;
+
+    // Delete the key from the pool. It can no longer be used.
+    shared_pool_->removeKey(key_id);
+
+    // Now the opposite peer is found, start the data transfer between them.
+    startSession(key_id, session->takeSocket(), other_session->takeSocket());
+
+    // Pending sessions are no longer needed, remove them.
+    removePendingSession(other_session);
+    removePendingSession(session);
+}
+
+void SessionManager::startSession(uint32_t key_id,
+                                  asio::ip::tcp::socket&& first,
+                                  asio::ip::tcp::socket&& second)
+{
+    if (startSessionInShard(key_id, first, second))
+        return;
+
+    std::unique_ptr<Session> session = std::make_unique<Session>(
+        std::make_pair(std::move(first), std::move(second)), key_id, zero_copy_,
+        &bandwidth_limiter_);
+    Session* session_ptr = session.get();
+
+    active_sessions_.emplace(session_ptr, std::move(session));
+    idle_wheel_.add(session_ptr);
+    session_ptr->start(this);
+}
+
+bool SessionManager::startSessionInShard(uint32_t key_id,
+                                         asio::ip::tcp::socket& first,
+                                         asio::ip::tcp::socket& second)
+{
+    if (shards_.empty())
+        return false;
+
+    // Choose the least loaded shard.
+    SessionShard* shard = *std::min_element(shards_.begin(), shards_.end(),
+                                            [](SessionShard* left, SessionShard* right)
+    {
+        return left->sessionCount() < right->sessionCount();
+    });
+
+    std::error_code error_code;
+
+    SessionShard::Protocol protocol = first.local_endpoint(error_code).protocol();
+    if (error_code)
+    {
+        LOG(LS_ERROR) << "Unable to get socket protocol: "
+                      << base::utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    // Sockets are bound to the I/O context of the current thread. To move them to another thread,
+    // we release the native handles and assign them to new sockets there.
+    // On Windows versions prior to 8.1 releasing is not supported and the session stays on the
+    // current thread.
+    SessionShard::NativeHandle first_handle = first.release(error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to release socket: "
+                        << base::utf16FromLocal8Bit(error_code.message());
+        return false;
+    }
+
+    SessionShard::NativeHandle second_handle = second.release(error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to release socket: "
+                        << base::utf16FromLocal8Bit(error_code.message());
+
+        // Return the first socket back. If this fails, the session will end with an error.
+        first.assign(protocol, first_handle, error_code);
+        return false;
+    }
+
+    shard->addSession(protocol, key_id, first_handle, second_handle);
+    return true;
+}
+
 void SessionManager::removePendingSession(PendingSession* session)
 {
+    if (!session->secret().empty())
+    {
+        auto it = waiting_peers_.find(peerKey(session->keyId(), session->secret()));
+        if (it != waiting_peers_.end() && it->second == session)
+            waiting_peers_.erase(it);
+    }
+
     task_runner_->deleteSoon(removeSessionT(&pending_sessions_, session));
 }
 
 void SessionManager::removeSession(Session* session)
 {
+    idle_wheel_.remove(session);
     task_runner_->deleteSoon(removeSessionT(&active_sessions_, session));
 
     if (delegate_)
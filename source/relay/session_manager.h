@@ -20,18 +20,24 @@
 #define RELAY__SESSION_MANAGER_H
 
 #include "proto/relay_peer.pb.h"
+#include "relay/bandwidth_limiter.h"
+#include "relay/idle_wheel.h"
 #include "relay/pending_session.h"
 #include "relay/session.h"
 #include "relay/shared_pool.h"
 
 #include <asio/high_resolution_timer.hpp>
 
+#include <unordered_map>
+
 namespace base {
 class TaskRunner;
 } // namespace base
 
 namespace relay {
 
+class SessionShard;
+
 class SessionManager
     : public PendingSession::Delegate,
       public Session::Delegate
@@ -47,11 +53,35 @@ public:
 
     SessionManager(std::shared_ptr<base::TaskRunner> task_runner,
                    uint16_t port,
-                   const std::chrono::minutes& idle_timeout);
+                   const std::chrono::minutes& idle_timeout,
+                   bool zero_copy,
+                   const BandwidthLimiter::Limits& bandwidth_limits,
+                   const std::vector<SessionShard*>& shards);
     ~SessionManager();
 
+    using NativeHandle = asio::ip::tcp::socket::native_handle_type;
+    using Protocol = asio::ip::tcp::socket::protocol_type;
+
     void start(std::unique_ptr<SharedPool> shared_pool, Delegate* delegate);
 
+    // Takes a peer that has been accepted and authenticated on a shard thread and looks for the
+    // opposite peer for it. Must be called on the session manager thread.
+    void addAuthenticatedPeer(const Protocol& protocol,
+                              NativeHandle handle,
+                              uint32_t key_id,
+                              const base::ByteArray& secret);
+
+    // Opens |acceptor| for incoming peer connections on |port|. On Linux the port can be shared by
+    // several acceptors (SO_REUSEPORT), and the kernel distributes new connections between them.
+    static bool listen(asio::ip::tcp::acceptor* acceptor, uint16_t port);
+
+    // Closes the peer port of the session manager and the shards. The peers that have already
+    // been accepted are served as usual.
+    void stopAccepting();
+
+    // Adds statistics of the sessions served on the current thread to |stat|.
+    void collectStatistics(proto::RelayStat* stat);
+
 protected:
     // PendingSession::Delegate implementation.
     void onPendingSessionReady(
@@ -66,16 +96,42 @@ private:
     static void doIdleTimeout(SessionManager* self, const std::error_code& error_code);
     void doIdleTimeoutImpl(const std::error_code& error_code);
 
+    void startPendingSession(asio::ip::tcp::socket&& socket);
+    bool startPendingSessionInShard(asio::ip::tcp::socket& socket);
+    void findPeer(PendingSession* session);
+
+    void startSession(uint32_t key_id,
+                      asio::ip::tcp::socket&& first,
+                      asio::ip::tcp::socket&& second);
+    bool startSessionInShard(uint32_t key_id,
+                             asio::ip::tcp::socket& first,
+                             asio::ip::tcp::socket& second);
     void removePendingSession(PendingSession* sessions);
     void removeSession(Session* session);
 
+    using PendingSessions = std::unordered_map<PendingSession*, std::unique_ptr<PendingSession>>;
+    using Sessions = std::unordered_map<Session*, std::unique_ptr<Session>>;
+
     std::shared_ptr<base::TaskRunner> task_runner_;
 
     asio::ip::tcp::acceptor acceptor_;
-    std::vector<std::unique_ptr<PendingSession>> pending_sessions_;
-    std::vector<std::unique_ptr<Session>> active_sessions_;
+    const uint16_t port_;
+    PendingSessions pending_sessions_;
+
+    // Sessions served on the current thread share the limiter. It is destroyed after them.
+    BandwidthLimiter bandwidth_limiter_;
+    Sessions active_sessions_;
+
+    // Pending sessions that have sent their credentials and are waiting for the opposite peer.
+    // The key is made up of the key identifier and the decrypted secret.
+    std::unordered_map<std::string, PendingSession*> waiting_peers_;
+
+    // Threads that serve active sessions. If empty, sessions are served on the current thread.
+    std::vector<SessionShard*> shards_;
+    size_t next_shard_ = 0;
 
-    const std::chrono::minutes idle_timeout_;
+    const bool zero_copy_;
+    IdleWheel idle_wheel_;
     asio::high_resolution_timer idle_timer_;
 
     std::unique_ptr<SharedPool> shared_pool_;
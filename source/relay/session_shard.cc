@@ -0,0 +1,370 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "relay/session_shard.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
+#include "base/strings/unicode.h"
+
+#include <algorithm>
+
+namespace relay {
+
+namespace {
+
+const std::chrono::minutes kIdleTimerInterval { 1 };
+
+} // namespace
+
+SessionShard::SessionShard(size_t index,
+                           const std::chrono::minutes& idle_timeout,
+                           bool zero_copy,
+                           const BandwidthLimiter::Limits& bandwidth_limits,
+                           SessionManager::Delegate* delegate)
+    : index_(index),
+      zero_copy_(zero_copy),
+      bandwidth_limits_(bandwidth_limits),
+      delegate_(delegate),
+      thread_(std::make_unique<base::Thread>()),
+      idle_wheel_(idle_timeout, kIdleTimerInterval)
+{
+    DCHECK(delegate_);
+}
+
+SessionShard::~SessionShard()
+{
+    thread_->stop();
+}
+
+void SessionShard::start()
+{
+    LOG(LS_INFO) << "Starting session shard #" << index_;
+    thread_->start(base::MessageLoop::Type::ASIO, this);
+}
+
+void SessionShard::startAuthentication(SessionManager* manager,
+                                       std::shared_ptr<base::TaskRunner> manager_task_runner,
+                                       std::unique_ptr<SharedPool> shared_pool,
+                                       uint16_t port)
+{
+    // The members are used only by tasks posted after this one.
+    manager_ = manager;
+    manager_task_runner_ = std::move(manager_task_runner);
+    shared_pool_ = std::move(shared_pool);
+
+    DCHECK(manager_ && manager_task_runner_ && shared_pool_);
+
+    task_runner_->postTask(std::bind(&SessionShard::startAuthenticationImpl, this, port));
+}
+
+void SessionShard::stopAccepting()
+{
+    task_runner_->postTask(std::bind(&SessionShard::closeAcceptor, this));
+}
+
+void SessionShard::addPendingPeer(const Protocol& protocol, NativeHandle handle)
+{
+    task_runner_->postTask([this, protocol, handle]()
+    {
+        asio::ip::tcp::socket socket(base::MessageLoop::current()->pumpAsio()->ioContext());
+        std::error_code error_code;
+
+        socket.assign(protocol, handle, error_code);
+        if (error_code)
+        {
+            LOG(LS_ERROR) << "Unable to assign pending peer socket to shard #" << index_ << ": "
+                          << base::utf16FromLocal8Bit(error_code.message());
+            return;
+        }
+
+        startPendingSession(std::move(socket));
+    });
+}
+
+void SessionShard::addSession(const Protocol& protocol,
+                              uint32_t key_id,
+                              NativeHandle first,
+                              NativeHandle second)
+{
+    ++session_count_;
+
+    task_runner_->postTask(
+        std::bind(&SessionShard::addSessionImpl, this, protocol, key_id, first, second));
+}
+
+void SessionShard::collectStatistics(std::shared_ptr<base::TaskRunner> caller_task_runner,
+                                     StatisticsCallback callback)
+{
+    task_runner_->postTask([this, caller_task_runner, callback]()
+    {
+        proto::RelayStat stat;
+        const Session::TimePoint current_time = Session::Clock::now();
+
+        for (const auto& session : sessions_)
+            session.second->collectStatistics(current_time, &stat);
+
+        caller_task_runner->postTask(std::bind(callback, std::move(stat)));
+    });
+}
+
+void SessionShard::onBeforeThreadRunning()
+{
+    task_runner_ = thread_->taskRunner();
+    DCHECK(task_runner_);
+
+    idle_timer_ = std::make_unique<asio::high_resolution_timer>(
+        base::MessageLoop::current()->pumpAsio()->ioContext());
+    bandwidth_limiter_ = std::make_unique<BandwidthLimiter>(bandwidth_limits_);
+    startIdleTimer();
+}
+
+void SessionShard::onAfterThreadRunning()
+{
+    closeAcceptor();
+
+    pending_sessions_.clear();
+    idle_timer_->cancel();
+    idle_timer_.reset();
+    sessions_.clear();
+    bandwidth_limiter_.reset();
+}
+
+void SessionShard::onPendingSessionReady(
+    PendingSession* session, const proto::PeerToRelay& message)
+{
+    base::ByteArray secret = shared_pool_->decryptSecret(message);
+    if (secret.empty())
+    {
+        // The key was not found in the pool or the identifiers could not be decrypted.
+        removePendingSession(session);
+        return;
+    }
+
+    asio::ip::tcp::socket socket = session->takeSocket();
+    removePendingSession(session);
+
+    std::error_code error_code;
+    NativeHandle handle = NativeHandle();
+
+    Protocol protocol = socket.local_endpoint(error_code).protocol();
+    if (!error_code)
+        handle = socket.release(error_code);
+
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to release authenticated peer socket: "
+                        << base::utf16FromLocal8Bit(error_code.message());
+        return;
+    }
+
+    // The opposite peer can be accepted by any thread, so peers are paired by the session manager.
+    SessionManager* manager = manager_;
+    const uint32_t key_id = message.key_id();
+
+    manager_task_runner_->postTask([manager, protocol, handle, key_id, secret]()
+    {
+        manager->addAuthenticatedPeer(protocol, handle, key_id, secret);
+    });
+}
+
+void SessionShard::onPendingSessionFailed(PendingSession* session)
+{
+    removePendingSession(session);
+}
+
+void SessionShard::onSessionFinished(Session* session)
+{
+    session->stop();
+
+    idle_wheel_.remove(session);
+
+    auto it = sessions_.find(session);
+    if (it == sessions_.end())
+        return;
+
+    // The session can be called from its own handler, so we delete it later.
+    task_runner_->deleteSoon(std::move(it->second));
+    sessions_.erase(it);
+    --session_count_;
+
+    delegate_->onSessionFinished();
+}
+
+void SessionShard::addSessionImpl(const Protocol& protocol,
+                                  uint32_t key_id,
+                                  NativeHandle first,
+                                  NativeHandle second)
+{
+    asio::io_context& io_context = base::MessageLoop::current()->pumpAsio()->ioContext();
+
+    asio::ip::tcp::socket first_socket(io_context);
+    asio::ip::tcp::socket second_socket(io_context);
+
+    std::error_code first_error;
+    std::error_code second_error;
+
+    first_socket.assign(protocol, first, first_error);
+    second_socket.assign(protocol, second, second_error);
+
+    if (first_error || second_error)
+    {
+        const std::error_code& error_code = first_error ? first_error : second_error;
+
+        LOG(LS_ERROR) << "Unable to assign sockets to shard #" << index_ << ": "
+                      << base::utf16FromLocal8Bit(error_code.message());
+        --session_count_;
+
+        // The sockets are closed in destructors. The released key must be returned to the pool.
+        delegate_->onSessionFinished();
+        return;
+    }
+
+    std::unique_ptr<Session> session = std::make_unique<Session>(
+        std::make_pair(std::move(first_socket), std::move(second_socket)), key_id, zero_copy_,
+        bandwidth_limiter_.get());
+    Session* session_ptr = session.get();
+
+    sessions_.emplace(session_ptr, std::move(session));
+    idle_wheel_.add(session_ptr);
+    session_ptr->start(this);
+}
+
+void SessionShard::startAuthenticationImpl(uint16_t port)
+{
+    if (!port)
+        return;
+
+    acceptor_ = std::make_unique<asio::ip::tcp::acceptor>(
+        base::MessageLoop::current()->pumpAsio()->ioContext());
+
+    if (!SessionManager::listen(acceptor_.get(), port))
+    {
+        // Peers are still accepted by the session manager.
+        acceptor_.reset();
+        return;
+    }
+
+    LOG(LS_INFO) << "Shard #" << index_ << " accepts peers on port " << port;
+    SessionShard::doAccept(this);
+}
+
+void SessionShard::closeAcceptor()
+{
+    if (!acceptor_)
+        return;
+
+    std::error_code ignored_code;
+    acceptor_->cancel(ignored_code);
+    acceptor_->close(ignored_code);
+    acceptor_.reset();
+}
+
+// static
+void SessionShard::doAccept(SessionShard* self)
+{
+    self->acceptor_->async_accept(
+        [self](const std::error_code& error_code, asio::ip::tcp::socket socket)
+    {
+        if (!error_code)
+        {
+            self->startPendingSession(std::move(socket));
+        }
+        else
+        {
+            if (error_code == asio::error::operation_aborted)
+                return;
+
+            LOG(LS_ERROR) << "Error while accepting connection in shard #" << self->index_ << ": "
+                          << base::utf16FromLocal8Bit(error_code.message());
+        }
+
+        // Waiting for the next connection.
+        SessionShard::doAccept(self);
+    });
+}
+
+void SessionShard::startPendingSession(asio::ip::tcp::socket&& socket)
+{
+    std::unique_ptr<PendingSession> session = std::make_unique<PendingSession>(
+        task_runner_, std::move(socket), this);
+    PendingSession* session_ptr = session.get();
+
+    pending_sessions_.emplace(session_ptr, std::move(session));
+    session_ptr->start();
+}
+
+void SessionShard::removePendingSession(PendingSession* session)
+{
+    session->stop();
+
+    auto it = pending_sessions_.find(session);
+    if (it == pending_sessions_.end())
+        return;
+
+    // The session can be called from its own handler, so we delete it later.
+    task_runner_->deleteSoon(std::move(it->second));
+    pending_sessions_.erase(it);
+}
+
+// static
+void SessionShard::doIdleTimeout(SessionShard* self, const std::error_code& error_code)
+{
+    if (error_code == asio::error::operation_aborted)
+        return;
+
+    self->doIdleTimeoutImpl(error_code);
+}
+
+void SessionShard::doIdleTimeoutImpl(const std::error_code& error_code)
+{
+    if (!error_code)
+    {
+        std::vector<Session*> expired = idle_wheel_.tick(Session::Clock::now());
+        int count = 0;
+
+        for (Session* session : expired)
+        {
+            if (sessions_.erase(session))
+            {
+                --session_count_;
+                ++count;
+            }
+        }
+
+        if (count)
+            LOG(LS_INFO) << "Sessions ended by timeout in shard #" << index_ << ": " << count;
+    }
+    else
+    {
+        LOG(LS_ERROR) << "Error in idle timer: " << base::utf16FromLocal8Bit(error_code.message());
+    }
+
+    startIdleTimer();
+}
+
+void SessionShard::startIdleTimer()
+{
+    idle_timer_->expires_after(kIdleTimerInterval);
+    idle_timer_->async_wait(
+        std::bind(&SessionShard::doIdleTimeout, this, std::placeholders::_1));
+}
+
+} // namespace relay
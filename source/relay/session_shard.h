@@ -0,0 +1,141 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef RELAY__SESSION_SHARD_H
+#define RELAY__SESSION_SHARD_H
+
+#include "base/threading/thread.h"
+#include "relay/idle_wheel.h"
+#include "relay/pending_session.h"
+#include "relay/session.h"
+#include "relay/session_manager.h"
+
+#include <asio/high_resolution_timer.hpp>
+
+#include <atomic>
+#include <unordered_map>
+
+namespace relay {
+
+// Runs a part of the active peer sessions on its own I/O thread. The shard also authenticates
+// peers: either accepted by itself on the shared peer port or handed over by SessionManager.
+// Authenticated peers are passed to SessionManager, which pairs them and hands the pair of
+// sockets back to one of the shards.
+class SessionShard
+    : public base::Thread::Delegate,
+      public PendingSession::Delegate,
+      public Session::Delegate
+{
+public:
+    using NativeHandle = asio::ip::tcp::socket::native_handle_type;
+    using Protocol = asio::ip::tcp::socket::protocol_type;
+
+    SessionShard(size_t index,
+                 const std::chrono::minutes& idle_timeout,
+                 bool zero_copy,
+                 const BandwidthLimiter::Limits& bandwidth_limits,
+                 SessionManager::Delegate* delegate);
+    ~SessionShard();
+
+    void start();
+
+    // Starts authentication of peers on the shard thread. Authenticated peers are passed to
+    // |manager| on the |manager_task_runner| thread. If |port| is not 0, the shard accepts peers
+    // on this port itself. Can be called from any thread.
+    void startAuthentication(SessionManager* manager,
+                             std::shared_ptr<base::TaskRunner> manager_task_runner,
+                             std::unique_ptr<SharedPool> shared_pool,
+                             uint16_t port);
+
+    // Stops accepting peers on the shared peer port. Can be called from any thread.
+    void stopAccepting();
+
+    // Takes ownership of an accepted native socket and authenticates the peer on the shard thread.
+    // Can be called from any thread.
+    void addPendingPeer(const Protocol& protocol, NativeHandle handle);
+
+    // Takes ownership of two native sockets and starts the data transfer between them on the
+    // shard thread. Can be called from any thread.
+    void addSession(const Protocol& protocol,
+                    uint32_t key_id,
+                    NativeHandle first,
+                    NativeHandle second);
+
+    // Collects statistics of the shard sessions on the shard thread and passes them to
+    // |callback| on the |caller_task_runner| thread.
+    using StatisticsCallback = std::function<void(const proto::RelayStat& stat)>;
+    void collectStatistics(std::shared_ptr<base::TaskRunner> caller_task_runner,
+                           StatisticsCallback callback);
+
+    // Returns the number of sessions served by the shard. Can be called from any thread.
+    size_t sessionCount() const { return session_count_; }
+
+protected:
+    // base::Thread::Delegate implementation.
+    void onBeforeThreadRunning() override;
+    void onAfterThreadRunning() override;
+
+    // PendingSession::Delegate implementation.
+    void onPendingSessionReady(
+        PendingSession* session, const proto::PeerToRelay& message) override;
+    void onPendingSessionFailed(PendingSession* session) override;
+
+    // Session::Delegate implementation.
+    void onSessionFinished(Session* session) override;
+
+private:
+    void startAuthenticationImpl(uint16_t port);
+    void closeAcceptor();
+    static void doAccept(SessionShard* self);
+    void startPendingSession(asio::ip::tcp::socket&& socket);
+    void removePendingSession(PendingSession* session);
+
+    void addSessionImpl(const Protocol& protocol,
+                        uint32_t key_id,
+                        NativeHandle first,
+                        NativeHandle second);
+    static void doIdleTimeout(SessionShard* self, const std::error_code& error_code);
+    void doIdleTimeoutImpl(const std::error_code& error_code);
+    void startIdleTimer();
+
+    const size_t index_;
+    const bool zero_copy_;
+    const BandwidthLimiter::Limits bandwidth_limits_;
+    SessionManager::Delegate* delegate_;
+
+    std::unique_ptr<base::Thread> thread_;
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    std::unique_ptr<asio::high_resolution_timer> idle_timer_;
+    std::unique_ptr<BandwidthLimiter> bandwidth_limiter_;
+
+    SessionManager* manager_ = nullptr;
+    std::shared_ptr<base::TaskRunner> manager_task_runner_;
+    std::unique_ptr<SharedPool> shared_pool_;
+    std::unique_ptr<asio::ip::tcp::acceptor> acceptor_;
+    std::unordered_map<PendingSession*, std::unique_ptr<PendingSession>> pending_sessions_;
+
+    std::unordered_map<Session*, std::unique_ptr<Session>> sessions_;
+    IdleWheel idle_wheel_;
+    std::atomic<size_t> session_count_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(SessionShard);
+};
+
+} // namespace relay
+
+#endif // RELAY__SESSION_SHARD_H
@@ -19,14 +19,21 @@
 #include "relay/sessions_worker.h"
 
 #include "base/logging.h"
+#include "relay/session_shard.h"
 
 namespace relay {
 
 SessionsWorker::SessionsWorker(uint16_t peer_port,
                                const std::chrono::minutes& peer_idle_timeout,
+                               size_t thread_count,
+                               bool zero_copy,
+                               const BandwidthLimiter::Limits& bandwidth_limits,
                                std::unique_ptr<SharedPool> shared_pool)
     : peer_port_(peer_port),
       peer_idle_timeout_(peer_idle_timeout),
+      thread_count_(thread_count),
+      zero_copy_(zero_copy),
+      bandwidth_limits_(bandwidth_limits),
       shared_pool_(std::move(shared_pool)),
       thread_(std::make_unique<base::Thread>())
 {
@@ -35,7 +42,9 @@ SessionsWorker::SessionsWorker(uint16_t peer_port,
 
 SessionsWorker::~SessionsWorker()
 {
+    // The session manager hands over sessions to the shards, so it is stopped first.
     thread_->stop();
+    shards_.clear();
 }
 
 void SessionsWorker::start(std::shared_ptr<base::TaskRunner> caller_task_runner,
@@ -47,16 +56,80 @@ void SessionsWorker::start(std::shared_ptr<base::TaskRunner> caller_task_runner,
     DCHECK(caller_task_runner_);
     DCHECK(delegate_);
 
+    // With a single thread, sessions are served on the session manager thread.
+    if (thread_count_ > 1)
+    {
+        LOG(LS_INFO) << "Number of session threads: " << thread_count_;
+
+        for (size_t i = 0; i < thread_count_; ++i)
+        {
+            shards_.emplace_back(std::make_unique<SessionShard>(
+                i, peer_idle_timeout_, zero_copy_, bandwidth_limits_, this));
+            shards_.back()->start();
+        }
+    }
+
     thread_->start(base::MessageLoop::Type::ASIO, this);
 }
 
+void SessionsWorker::stopAccepting()
+{
+    self_task_runner_->postTask([this]()
+    {
+        if (session_manager_)
+            session_manager_->stopAccepting();
+    });
+}
+
+void SessionsWorker::collectStatistics(StatisticsCallback callback)
+{
+    DCHECK(caller_task_runner_->belongsToCurrentThread());
+
+    struct Collector
+    {
+        proto::RelayStat stat;
+        size_t remaining = 0;
+        StatisticsCallback callback;
+    };
+
+    std::shared_ptr<Collector> collector = std::make_shared<Collector>();
+    collector->remaining = shards_.size() + 1;
+    collector->callback = std::move(callback);
+
+    // Called on the caller thread for each thread that serves sessions.
+    SessionShard::StatisticsCallback on_part = [collector](const proto::RelayStat& stat)
+    {
+        mergeStatistics(stat, &collector->stat);
+
+        if (--collector->remaining == 0)
+            collector->callback(collector->stat);
+    };
+
+    for (const auto& shard : shards_)
+        shard->collectStatistics(caller_task_runner_, on_part);
+
+    self_task_runner_->postTask([this, on_part]()
+    {
+        proto::RelayStat stat;
+        if (session_manager_)
+            session_manager_->collectStatistics(&stat);
+
+        caller_task_runner_->postTask(std::bind(on_part, std::move(stat)));
+    });
+}
+
 void SessionsWorker::onBeforeThreadRunning()
 {
     self_task_runner_ = thread_->taskRunner();
     DCHECK(self_task_runner_);
 
+    std::vector<SessionShard*> shards;
+    for (const auto& shard : shards_)
+        shards.emplace_back(shard.get());
+
     session_manager_ = std::make_unique<SessionManager>(
-        self_task_runner_, peer_port_, peer_idle_timeout_);
+        self_task_runner_, peer_port_, peer_idle_timeout_, zero_copy_, bandwidth_limits_,
+        shards);
     session_manager_->start(std::move(shared_pool_), this);
 }
 
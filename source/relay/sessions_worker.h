@@ -24,6 +24,7 @@
 
 namespace relay {
 
+class SessionShard;
 class SharedPool;
 
 class SessionsWorker
@@ -33,12 +34,22 @@ class SessionsWorker
 public:
     SessionsWorker(uint16_t peer_port,
                    const std::chrono::minutes& peer_idle_timeout,
+                   size_t thread_count,
+                   bool zero_copy,
+                   const BandwidthLimiter::Limits& bandwidth_limits,
                    std::unique_ptr<SharedPool> shared_pool);
     ~SessionsWorker();
 
     void start(std::shared_ptr<base::TaskRunner> caller_task_runner,
                SessionManager::Delegate* delegate);
 
+    // Stops accepting new peers. The active sessions are kept.
+    void stopAccepting();
+
+    // Collects statistics of all sessions. |callback| is called on the caller thread.
+    using StatisticsCallback = std::function<void(const proto::RelayStat& stat)>;
+    void collectStatistics(StatisticsCallback callback);
+
 protected:
     // base::Thread::Delegate implementation.
     void onBeforeThreadRunning() override;
@@ -50,9 +61,13 @@ protected:
 private:
     const uint16_t peer_port_;
     const std::chrono::minutes peer_idle_timeout_;
+    const size_t thread_count_;
+    const bool zero_copy_;
+    const BandwidthLimiter::Limits bandwidth_limits_;
 
     std::unique_ptr<SharedPool> shared_pool_;
 
+    std::vector<std::unique_ptr<SessionShard>> shards_;
     std::unique_ptr<base::Thread> thread_;
     std::shared_ptr<base::TaskRunner> caller_task_runner_;
     std::shared_ptr<base::TaskRunner> self_task_runner_;
@@ -54,6 +54,12 @@ void Settings::reset()
     setPeerPort(DEFAULT_RELAY_PEER_TCP_PORT);
     setPeerIdleTimeout(std::chrono::minutes(5));
     setMaxPeerCount(100);
+    setSessionThreadCount(0);
+    setZeroCopyForwarding(true);
+    setMetricsPort(0);
+    setSessionBandwidthLimit(0);
+    setThreadBandwidthLimit(0);
+    setDrainTimeout(std::chrono::minutes(5));
 }
 
 void Settings::flush()
@@ -131,4 +137,64 @@ uint32_t Settings::maxPeerCount() const
     return impl_.get<uint32_t>("MaxPeerCount", 100);
 }
 
+void Settings::setSessionThreadCount(uint32_t count)
+{
+    impl_.set<uint32_t>("SessionThreadCount", count);
+}
+
+uint32_t Settings::sessionThreadCount() const
+{
+    return impl_.get<uint32_t>("SessionThreadCount", 0);
+}
+
+void Settings::setZeroCopyForwarding(bool enable)
+{
+    impl_.set<bool>("ZeroCopyForwarding", enable);
+}
+
+bool Settings::isZeroCopyForwarding() const
+{
+    return impl_.get<bool>("ZeroCopyForwarding", true);
+}
+
+void Settings::setMetricsPort(uint16_t port)
+{
+    impl_.set<uint16_t>("MetricsPort", port);
+}
+
+uint16_t Settings::metricsPort() const
+{
+    return impl_.get<uint16_t>("MetricsPort", 0);
+}
+
+void Settings::setSessionBandwidthLimit(uint32_t limit)
+{
+    impl_.set<uint32_t>("SessionBandwidthLimit", limit);
+}
+
+uint32_t Settings::sessionBandwidthLimit() const
+{
+    return impl_.get<uint32_t>("SessionBandwidthLimit", 0);
+}
+
+void Settings::setThreadBandwidthLimit(uint32_t limit)
+{
+    impl_.set<uint32_t>("ThreadBandwidthLimit", limit);
+}
+
+uint32_t Settings::threadBandwidthLimit() const
+{
+    return impl_.get<uint32_t>("ThreadBandwidthLimit", 0);
+}
+
+void Settings::setDrainTimeout(const std::chrono::minutes& timeout)
+{
+    impl_.set<int>("DrainTimeout", timeout.count());
+}
+
+std::chrono::minutes Settings::drainTimeout() const
+{
+    return std::chrono::minutes(impl_.get<int>("DrainTimeout", 5));
+}
+
 } // namespace relay
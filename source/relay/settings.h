@@ -57,6 +57,33 @@ public:
     void setMaxPeerCount(uint32_t count);
     uint32_t maxPeerCount() const;
 
+    // Number of threads for peer sessions. If 0, the number of processor cores is used.
+    void setSessionThreadCount(uint32_t count);
+    uint32_t sessionThreadCount() const;
+
+    // Forwarding of data between peers without copying it to user space (Linux only).
+    void setZeroCopyForwarding(bool enable);
+    bool isZeroCopyForwarding() const;
+
+    // Port of the local metrics endpoint. If 0, the endpoint is disabled.
+    void setMetricsPort(uint16_t port);
+    uint16_t metricsPort() const;
+
+    // Maximum forwarding rate of one direction of a peer session in kilobytes per second.
+    // If 0, the rate is not limited.
+    void setSessionBandwidthLimit(uint32_t limit);
+    uint32_t sessionBandwidthLimit() const;
+
+    // Maximum total forwarding rate of the sessions served by one thread in kilobytes per second.
+    // The bandwidth is shared fairly between the sessions. If 0, the rate is not limited.
+    void setThreadBandwidthLimit(uint32_t limit);
+    uint32_t threadBandwidthLimit() const;
+
+    // Maximum time the active sessions are kept after the relay has been asked to stop. New peers
+    // are not accepted during this time.
+    void setDrainTimeout(const std::chrono::minutes& timeout);
+    std::chrono::minutes drainTimeout() const;
+
 private:
     base::JsonSettings impl_;
 };
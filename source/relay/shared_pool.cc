@@ -19,11 +19,56 @@
 #include "relay/shared_pool.h"
 
 #include "base/logging.h"
+#include "base/crypto/message_decryptor_openssl.h"
 
+#include <array>
+#include <atomic>
 #include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
 
 namespace relay {
 
+namespace {
+
+// Decrypts an encrypted pair of peer identifiers using |key|.
+base::ByteArray decryptWithKey(const proto::PeerToRelay& message, const SharedPool::Key& key)
+{
+    if (key.first.empty() || key.second.empty())
+    {
+        LOG(LS_ERROR) << "Invalid session key";
+        return base::ByteArray();
+    }
+
+    std::unique_ptr<base::MessageDecryptor> decryptor =
+        base::MessageDecryptorOpenssl::createForChaCha20Poly1305(key.first, key.second);
+    if (!decryptor)
+    {
+        LOG(LS_ERROR) << "Decryptor not created";
+        return base::ByteArray();
+    }
+
+    const std::string& source = message.data();
+    if (source.empty())
+    {
+        LOG(LS_ERROR) << "Empty 'data' field";
+        return base::ByteArray();
+    }
+
+    base::ByteArray target;
+    target.resize(decryptor->decryptedDataSize(source.size()));
+
+    if (!decryptor->decrypt(source.data(), source.size(), target.data()))
+    {
+        LOG(LS_ERROR) << "Failed to decrypt shared secret";
+        return base::ByteArray();
+    }
+
+    return target;
+}
+
+} // namespace
+
 class SharedPool::Pool
 {
 public:
@@ -34,16 +79,28 @@ public:
 
     uint32_t addKey(SessionKey&& session_key);
     bool removeKey(uint32_t key_id);
-    void setKeyExpired(uint32_t key_id);
+    void setKeysExpired(const std::vector<uint32_t>& key_ids);
     std::optional<Key> key(uint32_t key_id, std::string_view peer_public_key) const;
     void clear();
 
 private:
-    Delegate* delegate_;
+    // Keys are distributed between shards by identifier. Each shard has its own lock, so lookups
+    // from different session threads rarely contend with each other or with the controller.
+    struct Shard
+    {
+        mutable std::shared_mutex lock;
+        std::unordered_map<uint32_t, std::shared_ptr<const SessionKey>> map;
+    };
+
+    static const size_t kShardCount = 16;
+
+    Shard& shard(uint32_t key_id) { return shards_[key_id % kShardCount]; }
+    const Shard& shard(uint32_t key_id) const { return shards_[key_id % kShardCount]; }
 
-    mutable std::mutex pool_lock_;
-    std::map<uint32_t, SessionKey> map_;
-    uint32_t current_key_id_ = 0;
+    std::atomic<Delegate*> delegate_;
+
+    std::array<Shard, kShardCount> shards_;
+    std::atomic<uint32_t> current_key_id_ = 0;
 
     DISALLOW_COPY_AND_ASSIGN(Pool);
 };
@@ -61,10 +118,15 @@ void SharedPool::Pool::dettach()
 
 uint32_t SharedPool::Pool::addKey(SessionKey&& session_key)
 {
-    std::scoped_lock lock(pool_lock_);
-
     uint32_t key_id = current_key_id_++;
-    map_.emplace(key_id, std::move(session_key));
+
+    std::shared_ptr<const SessionKey> value = std::make_shared<SessionKey>(std::move(session_key));
+    Shard& key_shard = shard(key_id);
+
+    {
+        std::unique_lock lock(key_shard.lock);
+        key_shard.map.emplace(key_id, std::move(value));
+    }
 
     LOG(LS_INFO) << "Key with id " << key_id << " added to pool";
     return key_id;
@@ -72,50 +134,75 @@ uint32_t SharedPool::Pool::addKey(SessionKey&& session_key)
 
 bool SharedPool::Pool::removeKey(uint32_t key_id)
 {
-    std::scoped_lock lock(pool_lock_);
+    std::shared_ptr<const SessionKey> removed_key;
+    Shard& key_shard = shard(key_id);
 
-    auto result = map_.find(key_id);
-    if (result != map_.end())
     {
-        map_.erase(result);
+        std::unique_lock lock(key_shard.lock);
+
+        auto result = key_shard.map.find(key_id);
+        if (result == key_shard.map.end())
+            return false;
 
-        LOG(LS_INFO) << "Key with id " << key_id << " removed from pool";
-        return true;
+        // The key is destroyed outside of the lock.
+        removed_key = std::move(result->second);
+        key_shard.map.erase(result);
     }
 
-    return false;
+    LOG(LS_INFO) << "Key with id " << key_id << " removed from pool";
+    return true;
 }
 
-void SharedPool::Pool::setKeyExpired(uint32_t key_id)
+void SharedPool::Pool::setKeysExpired(const std::vector<uint32_t>& key_ids)
 {
-    if (removeKey(key_id))
-    {
-        LOG(LS_INFO) << "Key with ID " << key_id << " expired. It has been removed";
+    std::vector<uint32_t> expired_keys;
+    expired_keys.reserve(key_ids.size());
 
-        if (delegate_)
-            delegate_->onPoolKeyExpired(key_id);
+    for (uint32_t key_id : key_ids)
+    {
+        if (removeKey(key_id))
+            expired_keys.push_back(key_id);
     }
+
+    if (expired_keys.empty())
+        return;
+
+    LOG(LS_INFO) << expired_keys.size() << " key(s) expired. They have been removed";
+
+    Delegate* delegate = delegate_;
+    if (delegate)
+        delegate->onPoolKeysExpired(expired_keys);
 }
 
 std::optional<SharedPool::Key> SharedPool::Pool::key(
     uint32_t key_id, std::string_view peer_public_key) const
 {
-    std::scoped_lock lock(pool_lock_);
+    std::shared_ptr<const SessionKey> session_key;
+    const Shard& key_shard = shard(key_id);
+
+    {
+        std::shared_lock lock(key_shard.lock);
 
-    auto result = map_.find(key_id);
-    if (result == map_.end())
-        return std::nullopt;
+        auto result = key_shard.map.find(key_id);
+        if (result == key_shard.map.end())
+            return std::nullopt;
 
-    const SessionKey& session_key = result->second;
-    return std::make_pair(session_key.sessionKey(peer_public_key), session_key.iv());
+        session_key = result->second;
+    }
+
+    // Calculating the session key is expensive, so it is done without holding the lock.
+    return std::make_pair(session_key->sessionKey(peer_public_key), session_key->iv());
 }
 
 void SharedPool::Pool::clear()
 {
-    std::scoped_lock lock(pool_lock_);
+    for (Shard& key_shard : shards_)
+    {
+        std::unique_lock lock(key_shard.lock);
+        key_shard.map.clear();
+    }
 
     LOG(LS_INFO) << "Key pool cleared";
-    map_.clear();
 }
 
 SharedPool::SharedPool(Delegate* delegate)
@@ -153,9 +240,9 @@ bool SharedPool::removeKey(uint32_t key_id)
     return pool_->removeKey(key_id);
 }
 
-void SharedPool::setKeyExpired(uint32_t key_id)
+void SharedPool::setKeysExpired(const std::vector<uint32_t>& key_ids)
 {
-    return pool_->setKeyExpired(key_id);
+    pool_->setKeysExpired(key_ids);
 }
 
 std::optional<SharedPool::Key> SharedPool::key(
@@ -164,6 +251,24 @@ std::optional<SharedPool::Key> SharedPool::key(
     return pool_->key(key_id, peer_public_key);
 }
 
+base::ByteArray SharedPool::decryptSecret(const proto::PeerToRelay& message) const
+{
+    // Looking for a key with the specified identifier.
+    std::optional<Key> session_key = key(message.key_id(), message.public_key());
+    if (!session_key.has_value())
+    {
+        LOG(LS_WARNING) << "Key with id " << message.key_id() << " NOT found!";
+        return base::ByteArray();
+    }
+
+    // Decrypt the identifiers of peers.
+    base::ByteArray secret = decryptWithKey(message, *session_key);
+    if (secret.empty())
+        LOG(LS_WARNING) << "Failed to decrypt shared secret. Connection will be completed";
+
+    return secret;
+}
+
 void SharedPool::clear()
 {
     pool_->clear();
@@ -19,9 +19,11 @@
 #ifndef RELAY__SHARED_POOL_H
 #define RELAY__SHARED_POOL_H
 
+#include "proto/relay_peer.pb.h"
 #include "relay/session_key.h"
 
 #include <optional>
+#include <vector>
 
 namespace relay {
 
@@ -33,7 +35,8 @@ public:
     public:
         virtual ~Delegate() = default;
 
-        virtual void onPoolKeyExpired(uint32_t key_id) = 0;
+        // Called once for all keys removed by a single setKeysExpired() call.
+        virtual void onPoolKeysExpired(const std::vector<uint32_t>& key_ids) = 0;
     };
 
     using Key = std::pair<base::ByteArray, base::ByteArray>;
@@ -45,8 +48,17 @@ public:
 
     uint32_t addKey(SessionKey&& session_key);
     bool removeKey(uint32_t key_id);
-    void setKeyExpired(uint32_t key_id);
+    void setKeysExpired(const std::vector<uint32_t>& key_ids);
+
+    // Can be called from any thread. Lookups of different keys do not block each other, and the
+    // session key is calculated outside of the pool lock.
     std::optional<Key> key(uint32_t key_id, std::string_view peer_public_key) const;
+
+    // Looks up the key specified in |message| and decrypts the pair of peer identifiers with it.
+    // Returns an empty array if the key is not found or the data could not be decrypted.
+    // Can be called from any thread.
+    base::ByteArray decryptSecret(const proto::PeerToRelay& message) const;
+
     void clear();
 
 private:
@@ -0,0 +1,111 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "relay/statistics.h"
+
+#include "base/logging.h"
+
+namespace relay {
+
+namespace {
+
+// Upper bounds of the histogram buckets in milliseconds.
+const uint32_t kUpperBounds[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000 };
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram()
+{
+    static_assert(std::size(kUpperBounds) + 1 == kBucketCount);
+    count_.fill(0);
+}
+
+void LatencyHistogram::add(const std::chrono::microseconds& latency)
+{
+    size_t index = 0;
+
+    for (; index < std::size(kUpperBounds); ++index)
+    {
+        if (latency < std::chrono::milliseconds(kUpperBounds[index]))
+            break;
+    }
+
+    ++count_[index];
+}
+
+void LatencyHistogram::take(proto::RelayLatencyHistogram* histogram)
+{
+    DCHECK(histogram);
+
+    if (!histogram->upper_bound_size())
+    {
+        for (size_t i = 0; i < std::size(kUpperBounds); ++i)
+            histogram->add_upper_bound(kUpperBounds[i]);
+
+        for (size_t i = 0; i < kBucketCount; ++i)
+            histogram->add_count(0);
+    }
+
+    DCHECK_EQ(histogram->count_size(), static_cast<int>(kBucketCount));
+
+    for (int i = 0; i < histogram->count_size(); ++i)
+        histogram->set_count(i, histogram->count(i) + count_[static_cast<size_t>(i)]);
+
+    count_.fill(0);
+}
+
+// static
+void LatencyHistogram::merge(
+    const proto::RelayLatencyHistogram& from, proto::RelayLatencyHistogram* to)
+{
+    DCHECK(to);
+
+    if (!to->count_size())
+    {
+        *to = from;
+        return;
+    }
+
+    if (from.count_size() != to->count_size())
+    {
+        LOG(LS_ERROR) << "Histograms have different buckets";
+        return;
+    }
+
+    for (int i = 0; i < from.count_size(); ++i)
+        to->set_count(i, to->count(i) + from.count(i));
+}
+
+void mergeStatistics(const proto::RelayStat& from, proto::RelayStat* to)
+{
+    DCHECK(to);
+
+    to->set_session_count(to->session_count() + from.session_count());
+    to->set_rx_bytes(to->rx_bytes() + from.rx_bytes());
+    to->set_tx_bytes(to->tx_bytes() + from.tx_bytes());
+    to->set_rx_speed(to->rx_speed() + from.rx_speed());
+    to->set_tx_speed(to->tx_speed() + from.tx_speed());
+    to->set_pending_bytes(to->pending_bytes() + from.pending_bytes());
+
+    LatencyHistogram::merge(from.forward_latency(), to->mutable_forward_latency());
+
+    for (int i = 0; i < from.session_size(); ++i)
+        to->add_session()->CopyFrom(from.session(i));
+}
+
+} // namespace relay
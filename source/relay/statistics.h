@@ -0,0 +1,58 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef RELAY__STATISTICS_H
+#define RELAY__STATISTICS_H
+
+#include "base/macros_magic.h"
+#include "proto/router_relay.pb.h"
+
+#include <array>
+#include <chrono>
+
+namespace relay {
+
+// Histogram of the time between receiving data from one peer and sending it to the other.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+    ~LatencyHistogram() = default;
+
+    void add(const std::chrono::microseconds& latency);
+
+    // Adds the collected values to |histogram| and resets the histogram.
+    void take(proto::RelayLatencyHistogram* histogram);
+
+    // Adds values of |from| to |to|. Both histograms must have the same buckets or |to| must be
+    // empty.
+    static void merge(const proto::RelayLatencyHistogram& from, proto::RelayLatencyHistogram* to);
+
+private:
+    static const size_t kBucketCount = 11;
+    std::array<uint64_t, kBucketCount> count_;
+
+    DISALLOW_COPY_AND_ASSIGN(LatencyHistogram);
+};
+
+// Adds the aggregated values and sessions of |from| to |to|.
+void mergeStatistics(const proto::RelayStat& from, proto::RelayStat* to);
+
+} // namespace relay
+
+#endif // RELAY__STATISTICS_H
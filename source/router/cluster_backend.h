@@ -0,0 +1,60 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER__CLUSTER_BACKEND_H
+#define ROUTER__CLUSTER_BACKEND_H
+
+#include "base/peer/host_id.h"
+#include "proto/router_peer.pb.h"
+
+namespace router {
+
+// Host presence shared by the router nodes of a cluster. Each node registers the hosts connected
+// to it. A client connected to any node can reach a host connected to another node: the
+// connection offer for the host is forwarded to the node holding it.
+class ClusterBackend
+{
+public:
+    virtual ~ClusterBackend() = default;
+
+    class Delegate
+    {
+    public:
+        virtual ~Delegate() = default;
+
+        // Called when another node forwards a connection offer for a host of this node.
+        virtual void onConnectionOfferForwarded(
+            base::HostId host_id, const proto::ConnectionOffer& offer) = 0;
+    };
+
+    virtual void start(Delegate* delegate) = 0;
+
+    virtual void setHostOnline(base::HostId host_id) = 0;
+    virtual void setHostOffline(base::HostId host_id) = 0;
+
+    // Returns true if the host is connected to another node of the cluster.
+    virtual bool hasRemoteHost(base::HostId host_id) = 0;
+
+    // Sends the offer to the node holding the host.
+    virtual bool forwardConnectionOffer(
+        base::HostId host_id, const proto::ConnectionOffer& offer) = 0;
+};
+
+} // namespace router
+
+#endif // ROUTER__CLUSTER_BACKEND_H
@@ -0,0 +1,332 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/cluster_backend_sqlite.h"
+
+#include "base/logging.h"
+
+#include <ctime>
+#include <utility>
+#include <vector>
+
+namespace router {
+
+namespace {
+
+const std::chrono::milliseconds kPollInterval{ 100 };
+
+// The heartbeat of the node is updated every 5 seconds. A node without the heartbeat for 30
+// seconds is considered stopped, its hosts are not reachable.
+const int kPollsPerHeartbeat = 50;
+const int64_t kNodeTimeout = 30;
+
+// Offers that are not picked up are removed after a minute.
+const int64_t kOfferTimeout = 60;
+
+const char kCreateQuery[] = "BEGIN TRANSACTION;"
+    "CREATE TABLE IF NOT EXISTS \"nodes\" ("
+        "\"id\" TEXT NOT NULL PRIMARY KEY,"
+        "\"heartbeat\" INTEGER NOT NULL);"
+    "CREATE TABLE IF NOT EXISTS \"presence\" ("
+        "\"host_id\" INTEGER NOT NULL PRIMARY KEY,"
+        "\"node_id\" TEXT NOT NULL);"
+    "CREATE TABLE IF NOT EXISTS \"offers\" ("
+        "\"id\" INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "\"node_id\" TEXT NOT NULL,"
+        "\"host_id\" INTEGER NOT NULL,"
+        "\"offer\" BLOB NOT NULL,"
+        "\"created\" INTEGER NOT NULL);"
+    "COMMIT;";
+
+// In the queries ?1 is the ID of this node, ?2 is the host ID, ?3 is the current time and ?4 is
+// the number passed to the query.
+const char kRegisterNodeQuery[] = "INSERT OR REPLACE INTO nodes (id, heartbeat) VALUES (?1, ?3)";
+const char kUnregisterNodeQuery[] = "DELETE FROM nodes WHERE id=?1";
+const char kHeartbeatQuery[] = "UPDATE nodes SET heartbeat=?3 WHERE id=?1";
+const char kClearPresenceQuery[] = "DELETE FROM presence WHERE node_id=?1";
+const char kClearOffersQuery[] = "DELETE FROM offers WHERE node_id=?1";
+const char kRemoveOldOffersQuery[] = "DELETE FROM offers WHERE created < ?4";
+const char kHostOnlineQuery[] =
+    "INSERT OR REPLACE INTO presence (host_id, node_id) VALUES (?2, ?1)";
+const char kHostOfflineQuery[] = "DELETE FROM presence WHERE host_id=?2 AND node_id=?1";
+const char kHostNodeQuery[] =
+    "SELECT presence.node_id FROM presence JOIN nodes ON nodes.id=presence.node_id "
+    "WHERE presence.host_id=?2 AND nodes.heartbeat >= ?4";
+const char kAddOfferQuery[] =
+    "INSERT INTO offers (node_id, host_id, offer, created) VALUES (?5, ?2, ?6, ?3)";
+const char kSelectOffersQuery[] =
+    "SELECT id, host_id, offer FROM offers WHERE node_id=?1 ORDER BY id";
+const char kRemoveOffersQuery[] = "DELETE FROM offers WHERE node_id=?1 AND id <= ?4";
+
+int64_t currentTime()
+{
+    return static_cast<int64_t>(std::time(nullptr));
+}
+
+sqlite3_stmt* prepare(sqlite3* db, const char* query, const std::string& node_id,
+                      base::HostId host_id, int64_t number)
+{
+    sqlite3_stmt* statement = nullptr;
+    int error_code = sqlite3_prepare_v2(db, query, -1, &statement, nullptr);
+    if (error_code != SQLITE_OK)
+    {
+        LOG(LS_ERROR) << "sqlite3_prepare_v2 failed: " << sqlite3_errstr(error_code)
+                      << " (" << error_code << ")";
+        return nullptr;
+    }
+
+    const int count = sqlite3_bind_parameter_count(statement);
+
+    if (count >= 1)
+        sqlite3_bind_text(statement, 1, node_id.c_str(), node_id.size(), SQLITE_STATIC);
+    if (count >= 2)
+        sqlite3_bind_int64(statement, 2, static_cast<sqlite3_int64>(host_id));
+    if (count >= 3)
+        sqlite3_bind_int64(statement, 3, currentTime());
+    if (count >= 4)
+        sqlite3_bind_int64(statement, 4, number);
+
+    return statement;
+}
+
+} // namespace
+
+ClusterBackendSqlite::ClusterBackendSqlite(sqlite3* db,
+                                           const std::string& node_id,
+                                           std::shared_ptr<base::TaskRunner> task_runner)
+    : db_(db),
+      node_id_(node_id),
+      poll_timer_(base::WaitableTimer::Type::REPEATED, std::move(task_runner))
+{
+    DCHECK(db_);
+}
+
+ClusterBackendSqlite::~ClusterBackendSqlite()
+{
+    poll_timer_.stop();
+
+    // The hosts of this node are no longer reachable.
+    execute(kClearPresenceQuery);
+    execute(kUnregisterNodeQuery);
+
+    sqlite3_close(db_);
+}
+
+// static
+std::unique_ptr<ClusterBackendSqlite> ClusterBackendSqlite::open(
+    const std::filesystem::path& file_path,
+    const std::string& node_id,
+    std::shared_ptr<base::TaskRunner> task_runner)
+{
+    if (file_path.empty() || node_id.empty())
+    {
+        LOG(LS_WARNING) << "Invalid cluster database path or node ID";
+        return nullptr;
+    }
+
+    std::string file_path_utf8 = file_path.u8string();
+    LOG(LS_INFO) << "Opening cluster database: " << file_path_utf8;
+
+    sqlite3* db = nullptr;
+
+    // Sessions on different threads query the presence through the same connection.
+    int error_code = sqlite3_open_v2(file_path_utf8.c_str(), &db,
+        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, nullptr);
+    if (error_code != SQLITE_OK)
+    {
+        LOG(LS_WARNING) << "sqlite3_open_v2 failed: " << sqlite3_errstr(error_code)
+                        << " (" << error_code << ")";
+        sqlite3_close(db);
+        return nullptr;
+    }
+
+    // The database is shared with other nodes. Wait for their writes instead of failing.
+    sqlite3_busy_timeout(db, 1000);
+
+    char* error_string = nullptr;
+    if (sqlite3_exec(db, kCreateQuery, nullptr, nullptr, &error_string) != SQLITE_OK)
+    {
+        LOG(LS_ERROR) << "sqlite3_exec failed: " << error_string;
+        sqlite3_free(error_string);
+        sqlite3_close(db);
+        return nullptr;
+    }
+
+    return std::unique_ptr<ClusterBackendSqlite>(
+        new ClusterBackendSqlite(db, node_id, std::move(task_runner)));
+}
+
+void ClusterBackendSqlite::start(Delegate* delegate)
+{
+    delegate_ = delegate;
+    DCHECK(delegate_);
+
+    // The previous run of the node could stop without removing its hosts and offers.
+    execute(kClearPresenceQuery);
+    execute(kClearOffersQuery);
+    execute(kRegisterNodeQuery);
+
+    LOG(LS_INFO) << "Cluster node '" << node_id_ << "' started";
+
+    poll_timer_.start(kPollInterval, std::bind(&ClusterBackendSqlite::onPollTimer, this));
+}
+
+void ClusterBackendSqlite::setHostOnline(base::HostId host_id)
+{
+    if (!execute(kHostOnlineQuery, host_id))
+        LOG(LS_WARNING) << "Unable to register host " << host_id << " in the cluster";
+}
+
+void ClusterBackendSqlite::setHostOffline(base::HostId host_id)
+{
+    if (!execute(kHostOfflineQuery, host_id))
+        LOG(LS_WARNING) << "Unable to unregister host " << host_id << " in the cluster";
+}
+
+bool ClusterBackendSqlite::hasRemoteHost(base::HostId host_id)
+{
+    std::optional<std::string> node_id = hostNode(host_id);
+    return node_id.has_value() && *node_id != node_id_;
+}
+
+bool ClusterBackendSqlite::forwardConnectionOffer(
+    base::HostId host_id, const proto::ConnectionOffer& offer)
+{
+    std::optional<std::string> node_id = hostNode(host_id);
+    if (!node_id.has_value() || *node_id == node_id_)
+    {
+        LOG(LS_WARNING) << "Host " << host_id << " is not connected to another node";
+        return false;
+    }
+
+    sqlite3_stmt* statement = prepare(db_, kAddOfferQuery, node_id_, host_id, 0);
+    if (!statement)
+        return false;
+
+    const std::string data = offer.SerializeAsString();
+
+    sqlite3_bind_text(statement, 5, node_id->c_str(), node_id->size(), SQLITE_STATIC);
+    sqlite3_bind_blob(statement, 6, data.data(), data.size(), SQLITE_STATIC);
+
+    int error_code = sqlite3_step(statement);
+    sqlite3_finalize(statement);
+
+    if (error_code != SQLITE_DONE)
+    {
+        LOG(LS_ERROR) << "sqlite3_step failed: " << sqlite3_errstr(error_code)
+                      << " (" << error_code << ")";
+        return false;
+    }
+
+    LOG(LS_INFO) << "Connection offer for host " << host_id << " forwarded to node '"
+                 << *node_id << "'";
+    return true;
+}
+
+bool ClusterBackendSqlite::execute(const char* query, base::HostId host_id, int64_t number)
+{
+    sqlite3_stmt* statement = prepare(db_, query, node_id_, host_id, number);
+    if (!statement)
+        return false;
+
+    int error_code = sqlite3_step(statement);
+    sqlite3_finalize(statement);
+
+    if (error_code != SQLITE_DONE)
+    {
+        LOG(LS_ERROR) << "sqlite3_step failed: " << sqlite3_errstr(error_code)
+                      << " (" << error_code << ")";
+        return false;
+    }
+
+    return true;
+}
+
+std::optional<std::string> ClusterBackendSqlite::hostNode(base::HostId host_id)
+{
+    sqlite3_stmt* statement =
+        prepare(db_, kHostNodeQuery, node_id_, host_id, currentTime() - kNodeTimeout);
+    if (!statement)
+        return std::nullopt;
+
+    std::optional<std::string> result;
+
+    if (sqlite3_step(statement) == SQLITE_ROW)
+    {
+        const unsigned char* text = sqlite3_column_text(statement, 0);
+        if (text)
+            result.emplace(reinterpret_cast<const char*>(text));
+    }
+
+    sqlite3_finalize(statement);
+    return result;
+}
+
+void ClusterBackendSqlite::onPollTimer()
+{
+    if (++polls_since_heartbeat_ >= kPollsPerHeartbeat)
+    {
+        polls_since_heartbeat_ = 0;
+
+        execute(kHeartbeatQuery);
+        execute(kRemoveOldOffersQuery, base::kInvalidHostId, currentTime() - kOfferTimeout);
+    }
+
+    readOffers();
+}
+
+void ClusterBackendSqlite::readOffers()
+{
+    sqlite3_stmt* statement =
+        prepare(db_, kSelectOffersQuery, node_id_, base::kInvalidHostId, 0);
+    if (!statement)
+        return;
+
+    std::vector<std::pair<base::HostId, proto::ConnectionOffer>> offers;
+    sqlite3_int64 last_id = 0;
+
+    while (sqlite3_step(statement) == SQLITE_ROW)
+    {
+        last_id = sqlite3_column_int64(statement, 0);
+
+        base::HostId host_id = static_cast<base::HostId>(sqlite3_column_int64(statement, 1));
+        const void* data = sqlite3_column_blob(statement, 2);
+        int size = sqlite3_column_bytes(statement, 2);
+
+        proto::ConnectionOffer offer;
+        if (!data || !offer.ParseFromArray(data, size))
+        {
+            LOG(LS_WARNING) << "Invalid connection offer for host " << host_id;
+            continue;
+        }
+
+        offers.emplace_back(host_id, std::move(offer));
+    }
+
+    sqlite3_finalize(statement);
+
+    if (!last_id)
+        return;
+
+    execute(kRemoveOffersQuery, base::kInvalidHostId, last_id);
+
+    for (const auto& offer : offers)
+        delegate_->onConnectionOfferForwarded(offer.first, offer.second);
+}
+
+} // namespace router
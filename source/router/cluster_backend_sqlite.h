@@ -0,0 +1,76 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER__CLUSTER_BACKEND_SQLITE_H
+#define ROUTER__CLUSTER_BACKEND_SQLITE_H
+
+#include "base/macros_magic.h"
+#include "base/waitable_timer.h"
+#include "router/cluster_backend.h"
+
+#include <filesystem>
+#include <optional>
+
+#include <sqlite3.h>
+
+namespace router {
+
+// Cluster backend that keeps the presence and the forwarded offers in an SQLite database on
+// storage shared by all nodes. The nodes poll the database for the offers addressed to them.
+class ClusterBackendSqlite : public ClusterBackend
+{
+public:
+    ~ClusterBackendSqlite() override;
+
+    static std::unique_ptr<ClusterBackendSqlite> open(
+        const std::filesystem::path& file_path,
+        const std::string& node_id,
+        std::shared_ptr<base::TaskRunner> task_runner);
+
+    // ClusterBackend implementation.
+    void start(Delegate* delegate) override;
+    void setHostOnline(base::HostId host_id) override;
+    void setHostOffline(base::HostId host_id) override;
+    bool hasRemoteHost(base::HostId host_id) override;
+    bool forwardConnectionOffer(
+        base::HostId host_id, const proto::ConnectionOffer& offer) override;
+
+private:
+    ClusterBackendSqlite(sqlite3* db,
+                         const std::string& node_id,
+                         std::shared_ptr<base::TaskRunner> task_runner);
+
+    bool execute(const char* query,
+                 base::HostId host_id = base::kInvalidHostId,
+                 int64_t number = 0);
+    std::optional<std::string> hostNode(base::HostId host_id);
+    void onPollTimer();
+    void readOffers();
+
+    sqlite3* db_;
+    const std::string node_id_;
+    base::WaitableTimer poll_timer_;
+    Delegate* delegate_ = nullptr;
+    int polls_since_heartbeat_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(ClusterBackendSqlite);
+};
+
+} // namespace router
+
+#endif // ROUTER__CLUSTER_BACKEND_SQLITE_H
@@ -30,6 +30,10 @@ class DatabaseFactory
 public:
     virtual ~DatabaseFactory() = default;
 
+    // Creates the factory for the database type specified in the router settings. Returns nullptr
+    // if the type is not supported.
+    static std::unique_ptr<DatabaseFactory> create();
+
     virtual std::unique_ptr<Database> createDatabase() const = 0;
     virtual std::unique_ptr<Database> openDatabase() const = 0;
 };
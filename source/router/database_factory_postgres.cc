@@ -0,0 +1,250 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/database_factory_postgres.h"
+
+#include "router/database_postgres.h"
+#include "router/user_cache.h"
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace router {
+
+namespace {
+
+// Connections that are not used at the moment are kept open up to this number. Every session
+// thread holds at most one connection at a time, so the server sees a bounded number of
+// connections from each router node.
+const size_t kMaxIdleConnections = 8;
+
+// Upper bound for the number of cached host IDs (about 150 bytes per entry).
+const size_t kMaxCachedHostIds = 100000;
+
+// Users changed by another router sharing the database are noticed after this time.
+const std::chrono::seconds kUserCacheLifetime{ 30 };
+
+} // namespace
+
+class DatabaseFactoryPostgres::Pool : public std::enable_shared_from_this<Pool>
+{
+public:
+    explicit Pool(const std::string& connection)
+        : connection_(connection),
+          user_cache_(kUserCacheLifetime)
+    {
+        // Nothing
+    }
+
+    std::unique_ptr<Database> create();
+    std::unique_ptr<Database> acquire();
+    void release(std::unique_ptr<DatabasePostgres> db);
+
+    // Host keys do not change once assigned, so the host IDs found in the database are kept in
+    // memory. The other router nodes sharing the database only add new keys, so the cache stays
+    // valid for them as well.
+    bool cachedHostId(const base::ByteArray& key_hash, base::HostId* host_id);
+    void cacheHostId(const base::ByteArray& key_hash, base::HostId host_id);
+    void uncacheHostId(const base::ByteArray& key_hash);
+
+    UserCache& userCache() { return user_cache_; }
+
+private:
+    class Connection;
+
+    const std::string connection_;
+
+    std::mutex lock_;
+    std::vector<std::unique_ptr<DatabasePostgres>> idle_;
+
+    std::mutex host_ids_lock_;
+    std::map<base::ByteArray, base::HostId> host_ids_;
+
+    UserCache user_cache_;
+
+    DISALLOW_COPY_AND_ASSIGN(Pool);
+};
+
+// Database returned to the caller. It owns a pooled connection and returns it on destruction.
+class DatabaseFactoryPostgres::Pool::Connection : public Database
+{
+public:
+    Connection(std::shared_ptr<Pool> pool, std::unique_ptr<DatabasePostgres> db)
+        : pool_(std::move(pool)),
+          db_(std::move(db))
+    {
+        // Nothing
+    }
+
+    ~Connection() override
+    {
+        pool_->release(std::move(db_));
+    }
+
+    // Database implementation.
+    std::vector<base::User> userList() const override { return db_->userList(); }
+    bool addUser(const base::User& user) override { return db_->addUser(user); }
+
+    bool modifyUser(const base::User& user) override
+    {
+        bool result = db_->modifyUser(user);
+        pool_->userCache().clear();
+        return result;
+    }
+
+    bool removeUser(int64_t entry_id) override
+    {
+        bool result = db_->removeUser(entry_id);
+        pool_->userCache().clear();
+        return result;
+    }
+
+    base::User findUser(std::u16string_view username) override
+    {
+        base::User user;
+        if (pool_->userCache().find(username, &user))
+            return user;
+
+        uint64_t generation = pool_->userCache().generation();
+        user = db_->findUser(username);
+        pool_->userCache().add(user, generation);
+        return user;
+    }
+
+    ErrorCode hostId(const base::ByteArray& key_hash, base::HostId* host_id) const override
+    {
+        if (pool_->cachedHostId(key_hash, host_id))
+            return ErrorCode::SUCCESS;
+
+        ErrorCode result = db_->hostId(key_hash, host_id);
+        if (result == ErrorCode::SUCCESS)
+            pool_->cacheHostId(key_hash, *host_id);
+
+        return result;
+    }
+
+    bool addHost(const base::ByteArray& key_hash) override
+    {
+        pool_->uncacheHostId(key_hash);
+        return db_->addHost(key_hash);
+    }
+
+private:
+    std::shared_ptr<Pool> pool_;
+    std::unique_ptr<DatabasePostgres> db_;
+
+    DISALLOW_COPY_AND_ASSIGN(Connection);
+};
+
+std::unique_ptr<Database> DatabaseFactoryPostgres::Pool::create()
+{
+    return DatabasePostgres::create(connection_);
+}
+
+std::unique_ptr<Database> DatabaseFactoryPostgres::Pool::acquire()
+{
+    std::unique_ptr<DatabasePostgres> db;
+
+    {
+        std::scoped_lock lock(lock_);
+        if (!idle_.empty())
+        {
+            db = std::move(idle_.back());
+            idle_.pop_back();
+        }
+    }
+
+    if (!db)
+    {
+        db = DatabasePostgres::open(connection_);
+        if (!db)
+            return nullptr;
+    }
+
+    return std::make_unique<Connection>(shared_from_this(), std::move(db));
+}
+
+void DatabaseFactoryPostgres::Pool::release(std::unique_ptr<DatabasePostgres> db)
+{
+    // A connection lost (for example, when the server was restarted) is closed. The next caller
+    // gets a new one.
+    if (!db->isConnected())
+        return;
+
+    std::scoped_lock lock(lock_);
+    if (idle_.size() < kMaxIdleConnections)
+        idle_.emplace_back(std::move(db));
+}
+
+bool DatabaseFactoryPostgres::Pool::cachedHostId(
+    const base::ByteArray& key_hash, base::HostId* host_id)
+{
+    if (key_hash.empty() || !host_id)
+        return false;
+
+    std::scoped_lock lock(host_ids_lock_);
+
+    auto it = host_ids_.find(key_hash);
+    if (it == host_ids_.end())
+        return false;
+
+    *host_id = it->second;
+    return true;
+}
+
+void DatabaseFactoryPostgres::Pool::cacheHostId(
+    const base::ByteArray& key_hash, base::HostId host_id)
+{
+    if (host_id == base::kInvalidHostId)
+        return;
+
+    std::scoped_lock lock(host_ids_lock_);
+
+    // The cache is simply started over when full. Hosts that reconnect fill it again.
+    if (host_ids_.size() >= kMaxCachedHostIds)
+        host_ids_.clear();
+
+    host_ids_.emplace(key_hash, host_id);
+}
+
+void DatabaseFactoryPostgres::Pool::uncacheHostId(const base::ByteArray& key_hash)
+{
+    std::scoped_lock lock(host_ids_lock_);
+    host_ids_.erase(key_hash);
+}
+
+DatabaseFactoryPostgres::DatabaseFactoryPostgres(const std::string& connection)
+    : pool_(std::make_shared<Pool>(connection))
+{
+    // Nothing
+}
+
+DatabaseFactoryPostgres::~DatabaseFactoryPostgres() = default;
+
+std::unique_ptr<Database> DatabaseFactoryPostgres::createDatabase() const
+{
+    return pool_->create();
+}
+
+std::unique_ptr<Database> DatabaseFactoryPostgres::openDatabase() const
+{
+    return pool_->acquire();
+}
+
+} // namespace router
@@ -0,0 +1,51 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER__DATABASE_FACTORY_POSTGRES_H
+#define ROUTER__DATABASE_FACTORY_POSTGRES_H
+
+#include "base/macros_magic.h"
+#include "router/database_factory.h"
+
+#include <string>
+
+namespace router {
+
+class DatabaseFactoryPostgres : public DatabaseFactory
+{
+public:
+    // |connection| is a libpq connection string.
+    explicit DatabaseFactoryPostgres(const std::string& connection);
+    ~DatabaseFactoryPostgres();
+
+    std::unique_ptr<Database> createDatabase() const override;
+    // Connections are taken from a pool. When the returned object is destroyed, the connection
+    // (together with its prepared statements) goes back to the pool instead of being closed.
+    // Host IDs and users looked up through any of the connections are cached by the factory.
+    std::unique_ptr<Database> openDatabase() const override;
+
+private:
+    class Pool;
+    std::shared_ptr<Pool> pool_;
+
+    DISALLOW_COPY_AND_ASSIGN(DatabaseFactoryPostgres);
+};
+
+} // namespace router
+
+#endif // ROUTER__DATABASE_FACTORY_POSTGRES_H
@@ -19,10 +19,197 @@
 #include "router/database_factory_sqlite.h"
 
 #include "router/database_sqlite.h"
+#include "router/user_cache.h"
+
+#include <map>
+#include <mutex>
+#include <vector>
 
 namespace router {
 
-DatabaseFactorySqlite::DatabaseFactorySqlite() = default;
+namespace {
+
+// Connections that are not used at the moment are kept open up to this number.
+const size_t kMaxIdleConnections = 8;
+
+// Upper bound for the number of cached host IDs (about 150 bytes per entry).
+const size_t kMaxCachedHostIds = 100000;
+
+} // namespace
+
+class DatabaseFactorySqlite::Pool : public std::enable_shared_from_this<Pool>
+{
+public:
+    Pool() = default;
+
+    std::unique_ptr<Database> acquire();
+    void release(std::unique_ptr<DatabaseSqlite> db);
+
+    // Host keys do not change once assigned, so the host IDs found in the database are kept in
+    // memory. Reconnecting hosts (all of them at once after a router restart) are then served
+    // without a database query.
+    bool cachedHostId(const base::ByteArray& key_hash, base::HostId* host_id);
+    void cacheHostId(const base::ByteArray& key_hash, base::HostId host_id);
+    void uncacheHostId(const base::ByteArray& key_hash);
+
+    UserCache& userCache() { return user_cache_; }
+
+private:
+    class Connection;
+
+    std::mutex lock_;
+    std::vector<std::unique_ptr<DatabaseSqlite>> idle_;
+
+    std::mutex host_ids_lock_;
+    std::map<base::ByteArray, base::HostId> host_ids_;
+
+    UserCache user_cache_;
+
+    DISALLOW_COPY_AND_ASSIGN(Pool);
+};
+
+// Database returned to the caller. It owns a pooled connection and returns it on destruction.
+class DatabaseFactorySqlite::Pool::Connection : public Database
+{
+public:
+    Connection(std::shared_ptr<Pool> pool, std::unique_ptr<DatabaseSqlite> db)
+        : pool_(std::move(pool)),
+          db_(std::move(db))
+    {
+        // Nothing
+    }
+
+    ~Connection() override
+    {
+        pool_->release(std::move(db_));
+    }
+
+    // Database implementation.
+    std::vector<base::User> userList() const override { return db_->userList(); }
+    bool addUser(const base::User& user) override { return db_->addUser(user); }
+
+    bool modifyUser(const base::User& user) override
+    {
+        bool result = db_->modifyUser(user);
+        pool_->userCache().clear();
+        return result;
+    }
+
+    bool removeUser(int64_t entry_id) override
+    {
+        bool result = db_->removeUser(entry_id);
+        pool_->userCache().clear();
+        return result;
+    }
+
+    base::User findUser(std::u16string_view username) override
+    {
+        base::User user;
+        if (pool_->userCache().find(username, &user))
+            return user;
+
+        uint64_t generation = pool_->userCache().generation();
+        user = db_->findUser(username);
+        pool_->userCache().add(user, generation);
+        return user;
+    }
+
+    ErrorCode hostId(const base::ByteArray& key_hash, base::HostId* host_id) const override
+    {
+        if (pool_->cachedHostId(key_hash, host_id))
+            return ErrorCode::SUCCESS;
+
+        ErrorCode result = db_->hostId(key_hash, host_id);
+        if (result == ErrorCode::SUCCESS)
+            pool_->cacheHostId(key_hash, *host_id);
+
+        return result;
+    }
+
+    bool addHost(const base::ByteArray& key_hash) override
+    {
+        pool_->uncacheHostId(key_hash);
+        return db_->addHost(key_hash);
+    }
+
+private:
+    std::shared_ptr<Pool> pool_;
+    std::unique_ptr<DatabaseSqlite> db_;
+
+    DISALLOW_COPY_AND_ASSIGN(Connection);
+};
+
+std::unique_ptr<Database> DatabaseFactorySqlite::Pool::acquire()
+{
+    std::unique_ptr<DatabaseSqlite> db;
+
+    {
+        std::scoped_lock lock(lock_);
+        if (!idle_.empty())
+        {
+            db = std::move(idle_.back());
+            idle_.pop_back();
+        }
+    }
+
+    if (!db)
+    {
+        db = DatabaseSqlite::open();
+        if (!db)
+            return nullptr;
+    }
+
+    return std::make_unique<Connection>(shared_from_this(), std::move(db));
+}
+
+void DatabaseFactorySqlite::Pool::release(std::unique_ptr<DatabaseSqlite> db)
+{
+    std::scoped_lock lock(lock_);
+    if (idle_.size() < kMaxIdleConnections)
+        idle_.emplace_back(std::move(db));
+}
+
+bool DatabaseFactorySqlite::Pool::cachedHostId(
+    const base::ByteArray& key_hash, base::HostId* host_id)
+{
+    if (key_hash.empty() || !host_id)
+        return false;
+
+    std::scoped_lock lock(host_ids_lock_);
+
+    auto it = host_ids_.find(key_hash);
+    if (it == host_ids_.end())
+        return false;
+
+    *host_id = it->second;
+    return true;
+}
+
+void DatabaseFactorySqlite::Pool::cacheHostId(const base::ByteArray& key_hash, base::HostId host_id)
+{
+    if (host_id == base::kInvalidHostId)
+        return;
+
+    std::scoped_lock lock(host_ids_lock_);
+
+    // The cache is simply started over when full. Hosts that reconnect fill it again.
+    if (host_ids_.size() >= kMaxCachedHostIds)
+        host_ids_.clear();
+
+    host_ids_.emplace(key_hash, host_id);
+}
+
+void DatabaseFactorySqlite::Pool::uncacheHostId(const base::ByteArray& key_hash)
+{
+    std::scoped_lock lock(host_ids_lock_);
+    host_ids_.erase(key_hash);
+}
+
+DatabaseFactorySqlite::DatabaseFactorySqlite()
+    : pool_(std::make_shared<Pool>())
+{
+    // Nothing
+}
 
 DatabaseFactorySqlite::~DatabaseFactorySqlite() = default;
 
@@ -33,7 +220,7 @@ std::unique_ptr<Database> DatabaseFactorySqlite::createDatabase() const
 
 std::unique_ptr<Database> DatabaseFactorySqlite::openDatabase() const
 {
-    return DatabaseSqlite::open();
+    return pool_->acquire();
 }
 
 } // namespace router
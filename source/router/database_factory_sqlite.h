@@ -31,9 +31,15 @@ public:
     ~DatabaseFactorySqlite();
 
     std::unique_ptr<Database> createDatabase() const override;
+    // Connections are taken from a pool. When the returned object is destroyed, the connection
+    // (together with its prepared statements) goes back to the pool instead of being closed.
+    // Host IDs and users looked up through any of the connections are cached by the factory.
     std::unique_ptr<Database> openDatabase() const override;
 
 private:
+    class Pool;
+    std::shared_ptr<Pool> pool_;
+
     DISALLOW_COPY_AND_ASSIGN(DatabaseFactorySqlite);
 };
 
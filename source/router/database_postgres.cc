@@ -0,0 +1,521 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/database_postgres.h"
+
+#include "base/endian_util.h"
+#include "base/logging.h"
+#include "base/strings/unicode.h"
+
+#include <cstring>
+#include <deque>
+#include <optional>
+
+namespace router {
+
+namespace {
+
+// The parameters and the results are passed in binary format, the numbers of the result columns
+// are in network byte order.
+const int kBinaryFormat = 1;
+const int kTextFormat = 0;
+
+const char kCreateTablesQuery[] =
+    "CREATE TABLE users ("
+        "id BIGSERIAL PRIMARY KEY,"
+        "name TEXT NOT NULL UNIQUE,"
+        "\"group\" TEXT NOT NULL,"
+        "salt BYTEA NOT NULL,"
+        "verifier BYTEA NOT NULL,"
+        "sessions INTEGER DEFAULT 0,"
+        "flags INTEGER DEFAULT 0);"
+    "CREATE TABLE hosts ("
+        "id BIGSERIAL PRIMARY KEY,"
+        "key BYTEA NOT NULL UNIQUE);";
+
+template <typename T>
+std::optional<T> readInteger(const PGresult* result, int row, int column)
+{
+    if (PQgetisnull(result, row, column))
+    {
+        LOG(LS_ERROR) << "Field is NULL (column: " << column << ")";
+        return std::nullopt;
+    }
+
+    const char* value = PQgetvalue(result, row, column);
+    int length = PQgetlength(result, row, column);
+
+    if (length == sizeof(uint64_t))
+    {
+        uint64_t number;
+        memcpy(&number, value, sizeof(number));
+        return static_cast<T>(static_cast<int64_t>(base::EndianUtil::fromBig(number)));
+    }
+
+    if (length == sizeof(uint32_t))
+    {
+        uint32_t number;
+        memcpy(&number, value, sizeof(number));
+        return static_cast<T>(static_cast<int32_t>(base::EndianUtil::fromBig(number)));
+    }
+
+    LOG(LS_ERROR) << "Field is not an integer: " << length << " bytes (column: " << column << ")";
+    return std::nullopt;
+}
+
+std::optional<std::string> readText(const PGresult* result, int row, int column)
+{
+    if (PQgetisnull(result, row, column))
+    {
+        LOG(LS_ERROR) << "Field is NULL (column: " << column << ")";
+        return std::nullopt;
+    }
+
+    int length = PQgetlength(result, row, column);
+    if (length <= 0)
+    {
+        LOG(LS_ERROR) << "Field has an invalid size: " << length;
+        return std::nullopt;
+    }
+
+    return std::string(PQgetvalue(result, row, column), static_cast<size_t>(length));
+}
+
+std::optional<base::ByteArray> readBlob(const PGresult* result, int row, int column)
+{
+    std::optional<std::string> blob = readText(result, row, column);
+    if (!blob.has_value())
+        return std::nullopt;
+
+    return base::fromStdString(*blob);
+}
+
+std::optional<base::User> readUser(const PGresult* result, int row)
+{
+    std::optional<int64_t> entry_id = readInteger<int64_t>(result, row, 0);
+    if (!entry_id.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'id'";
+        return std::nullopt;
+    }
+
+    std::optional<std::string> name = readText(result, row, 1);
+    if (!name.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'name'";
+        return std::nullopt;
+    }
+
+    std::optional<std::string> group = readText(result, row, 2);
+    if (!group.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'group'";
+        return std::nullopt;
+    }
+
+    std::optional<base::ByteArray> salt = readBlob(result, row, 3);
+    if (!salt.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'salt'";
+        return std::nullopt;
+    }
+
+    std::optional<base::ByteArray> verifier = readBlob(result, row, 4);
+    if (!verifier.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'verifier'";
+        return std::nullopt;
+    }
+
+    std::optional<uint32_t> sessions = readInteger<uint32_t>(result, row, 5);
+    if (!sessions.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'sessions'";
+        return std::nullopt;
+    }
+
+    std::optional<uint32_t> flags = readInteger<uint32_t>(result, row, 6);
+    if (!flags.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'flags'";
+        return std::nullopt;
+    }
+
+    base::User user;
+
+    user.entry_id  = *entry_id;
+    user.name      = base::utf16FromUtf8(*name);
+    user.group     = std::move(*group);
+    user.salt      = std::move(*salt);
+    user.verifier  = std::move(*verifier);
+    user.sessions  = *sessions;
+    user.flags     = *flags;
+
+    return std::move(user);
+}
+
+} // namespace
+
+// Parameters of a query. Text and numbers are passed in text format (the server converts them to
+// the column type), blobs in binary format. The added data must outlive the query.
+class DatabasePostgres::Params
+{
+public:
+    Params() = default;
+
+    void addText(const std::string& text)
+    {
+        add(text.c_str(), 0, kTextFormat);
+    }
+
+    void addInt64(int64_t number)
+    {
+        numbers_.emplace_back(std::to_string(number));
+        addText(numbers_.back());
+    }
+
+    void addBlob(const base::ByteArray& blob)
+    {
+        add(reinterpret_cast<const char*>(blob.data()), static_cast<int>(blob.size()),
+            kBinaryFormat);
+    }
+
+    int count() const { return static_cast<int>(values_.size()); }
+    const char* const* values() const { return values_.data(); }
+    const int* lengths() const { return lengths_.data(); }
+    const int* formats() const { return formats_.data(); }
+
+private:
+    void add(const char* value, int length, int format)
+    {
+        values_.emplace_back(value);
+        lengths_.emplace_back(length);
+        formats_.emplace_back(format);
+    }
+
+    std::vector<const char*> values_;
+    std::vector<int> lengths_;
+    std::vector<int> formats_;
+    std::deque<std::string> numbers_;
+
+    DISALLOW_COPY_AND_ASSIGN(Params);
+};
+
+// Owns the result of a query.
+class DatabasePostgres::Result
+{
+public:
+    explicit Result(PGresult* result = nullptr)
+        : result_(result)
+    {
+        // Nothing
+    }
+
+    Result(Result&& other) noexcept
+        : result_(other.result_)
+    {
+        other.result_ = nullptr;
+    }
+
+    ~Result()
+    {
+        if (result_)
+            PQclear(result_);
+    }
+
+    // Returns true if the query succeeded.
+    bool isValid() const
+    {
+        if (!result_)
+            return false;
+
+        ExecStatusType status = PQresultStatus(result_);
+        return status == PGRES_COMMAND_OK || status == PGRES_TUPLES_OK;
+    }
+
+    const PGresult* get() const { return result_; }
+    int rowCount() const { return result_ ? PQntuples(result_) : 0; }
+
+private:
+    PGresult* result_;
+
+    DISALLOW_COPY_AND_ASSIGN(Result);
+};
+
+DatabasePostgres::DatabasePostgres(PGconn* db)
+    : db_(db)
+{
+    DCHECK(db_);
+}
+
+DatabasePostgres::~DatabasePostgres()
+{
+    PQfinish(db_);
+}
+
+// static
+std::unique_ptr<DatabasePostgres> DatabasePostgres::create(const std::string& connection)
+{
+    std::unique_ptr<DatabasePostgres> db = open(connection);
+    if (!db)
+        return nullptr;
+
+    Result result(PQexec(db->db_, "SELECT to_regclass('users') IS NOT NULL"));
+    if (!result.isValid() || result.rowCount() != 1)
+    {
+        LOG(LS_ERROR) << "Unable to check the tables: " << PQerrorMessage(db->db_);
+        return nullptr;
+    }
+
+    // The result of a simple query is in text format.
+    if (PQgetvalue(result.get(), 0, 0)[0] == 't')
+    {
+        LOG(LS_WARNING) << "Database tables already exist";
+        return nullptr;
+    }
+
+    // Both tables are created in a single transaction: a simple query with several statements
+    // is executed as one transaction.
+    Result create_result(PQexec(db->db_, kCreateTablesQuery));
+    if (!create_result.isValid())
+    {
+        LOG(LS_ERROR) << "Unable to create the tables: " << PQerrorMessage(db->db_);
+        return nullptr;
+    }
+
+    return db;
+}
+
+// static
+std::unique_ptr<DatabasePostgres> DatabasePostgres::open(const std::string& connection)
+{
+    if (connection.empty())
+    {
+        LOG(LS_WARNING) << "Connection string for PostgreSQL is not specified";
+        return nullptr;
+    }
+
+    PGconn* db = PQconnectdb(connection.c_str());
+    if (!db)
+    {
+        LOG(LS_WARNING) << "PQconnectdb failed";
+        return nullptr;
+    }
+
+    if (PQstatus(db) != CONNECTION_OK)
+    {
+        LOG(LS_WARNING) << "Unable to connect to PostgreSQL: " << PQerrorMessage(db);
+        PQfinish(db);
+        return nullptr;
+    }
+
+    LOG(LS_INFO) << "Connected to PostgreSQL database '" << PQdb(db) << "' on '" << PQhost(db)
+                 << "'";
+    return std::unique_ptr<DatabasePostgres>(new DatabasePostgres(db));
+}
+
+bool DatabasePostgres::isConnected() const
+{
+    return PQstatus(db_) == CONNECTION_OK;
+}
+
+std::vector<base::User> DatabasePostgres::userList() const
+{
+    static const char kQuery[] =
+        "SELECT id, name, \"group\", salt, verifier, sessions, flags FROM users";
+
+    Params params;
+    Result result = execute("user_list", kQuery, params);
+    if (!result.isValid())
+        return {};
+
+    std::vector<base::User> users;
+    for (int row = 0; row < result.rowCount(); ++row)
+    {
+        std::optional<base::User> user = readUser(result.get(), row);
+        if (user.has_value())
+            users.emplace_back(std::move(*user));
+    }
+
+    return users;
+}
+
+bool DatabasePostgres::addUser(const base::User& user)
+{
+    if (!user.isValid())
+    {
+        LOG(LS_ERROR) << "Not valid user";
+        return false;
+    }
+
+    static const char kQuery[] =
+        "INSERT INTO users (name, \"group\", salt, verifier, sessions, flags) "
+        "VALUES ($1, $2, $3, $4, $5, $6)";
+
+    std::string username = base::utf8FromUtf16(user.name);
+
+    Params params;
+    params.addText(username);
+    params.addText(user.group);
+    params.addBlob(user.salt);
+    params.addBlob(user.verifier);
+    params.addInt64(user.sessions);
+    params.addInt64(user.flags);
+
+    return execute("add_user", kQuery, params).isValid();
+}
+
+bool DatabasePostgres::modifyUser(const base::User& user)
+{
+    if (!user.isValid())
+    {
+        LOG(LS_ERROR) << "Not valid user";
+        return false;
+    }
+
+    static const char kQuery[] =
+        "UPDATE users SET (name, \"group\", salt, verifier, sessions, flags) = "
+        "($1, $2, $3, $4, $5, $6) WHERE id=$7";
+
+    std::string username = base::utf8FromUtf16(user.name);
+
+    Params params;
+    params.addText(username);
+    params.addText(user.group);
+    params.addBlob(user.salt);
+    params.addBlob(user.verifier);
+    params.addInt64(user.sessions);
+    params.addInt64(user.flags);
+    params.addInt64(user.entry_id);
+
+    return execute("modify_user", kQuery, params).isValid();
+}
+
+bool DatabasePostgres::removeUser(int64_t entry_id)
+{
+    static const char kQuery[] = "DELETE FROM users WHERE id=$1";
+
+    Params params;
+    params.addInt64(entry_id);
+
+    return execute("remove_user", kQuery, params).isValid();
+}
+
+base::User DatabasePostgres::findUser(std::u16string_view username)
+{
+    static const char kQuery[] =
+        "SELECT id, name, \"group\", salt, verifier, sessions, flags FROM users WHERE name=$1";
+
+    std::string username_utf8 = base::utf8FromUtf16(username);
+
+    Params params;
+    params.addText(username_utf8);
+
+    Result result = execute("find_user", kQuery, params);
+    if (!result.isValid() || result.rowCount() != 1)
+        return base::User::kInvalidUser;
+
+    return readUser(result.get(), 0).value_or(base::User::kInvalidUser);
+}
+
+Database::ErrorCode DatabasePostgres::hostId(
+    const base::ByteArray& key_hash, base::HostId* host_id) const
+{
+    if (key_hash.empty())
+    {
+        LOG(LS_ERROR) << "Invalid key hash";
+        return ErrorCode::UNKNOWN;
+    }
+
+    if (!host_id)
+    {
+        LOG(LS_ERROR) << "Invalid host id";
+        return ErrorCode::UNKNOWN;
+    }
+
+    *host_id = base::kInvalidHostId;
+
+    static const char kQuery[] = "SELECT id FROM hosts WHERE key=$1";
+
+    Params params;
+    params.addBlob(key_hash);
+
+    Result result = execute("host_id", kQuery, params);
+    if (!result.isValid())
+        return ErrorCode::UNKNOWN;
+
+    if (result.rowCount() != 1)
+    {
+        LOG(LS_ERROR) << "Host not found";
+        return ErrorCode::NO_HOST_FOUND;
+    }
+
+    std::optional<int64_t> entry_id = readInteger<int64_t>(result.get(), 0, 0);
+    if (!entry_id.has_value())
+    {
+        LOG(LS_ERROR) << "Failed to get field 'id'";
+        return ErrorCode::UNKNOWN;
+    }
+
+    *host_id = static_cast<base::HostId>(*entry_id);
+    return ErrorCode::SUCCESS;
+}
+
+bool DatabasePostgres::addHost(const base::ByteArray& key_hash)
+{
+    if (key_hash.empty())
+    {
+        LOG(LS_ERROR) << "Invalid parameters";
+        return false;
+    }
+
+    static const char kQuery[] = "INSERT INTO hosts (key) VALUES ($1)";
+
+    Params params;
+    params.addBlob(key_hash);
+
+    return execute("add_host", kQuery, params).isValid();
+}
+
+DatabasePostgres::Result DatabasePostgres::execute(
+    const char* name, const char* query, const Params& params) const
+{
+    if (statements_.find(name) == statements_.end())
+    {
+        Result result(PQprepare(db_, name, query, params.count(), nullptr));
+        if (!result.isValid())
+        {
+            LOG(LS_ERROR) << "PQprepare failed: " << PQerrorMessage(db_);
+            return Result();
+        }
+
+        statements_.emplace(name);
+    }
+
+    Result result(PQexecPrepared(db_, name, params.count(), params.values(), params.lengths(),
+                                 params.formats(), kBinaryFormat));
+    if (!result.isValid())
+    {
+        LOG(LS_ERROR) << "PQexecPrepared failed: " << PQerrorMessage(db_);
+        return Result();
+    }
+
+    return result;
+}
+
+} // namespace router
@@ -0,0 +1,75 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER__DATABASE_POSTGRES_H
+#define ROUTER__DATABASE_POSTGRES_H
+
+#include "base/macros_magic.h"
+#include "router/database.h"
+
+#include <set>
+
+#include <libpq-fe.h>
+
+namespace router {
+
+// Database on a PostgreSQL server. Unlike the SQLite file, the server can be shared by several
+// router nodes.
+class DatabasePostgres : public Database
+{
+public:
+    ~DatabasePostgres();
+
+    // Creates the tables. Fails if they already exist.
+    static std::unique_ptr<DatabasePostgres> create(const std::string& connection);
+
+    // |connection| is a libpq connection string, for example
+    // "host=db.example.com dbname=aspia user=router password=secret".
+    static std::unique_ptr<DatabasePostgres> open(const std::string& connection);
+
+    // Returns false if the connection to the server is lost.
+    bool isConnected() const;
+
+    // Database implementation.
+    std::vector<base::User> userList() const override;
+    bool addUser(const base::User& user) override;
+    bool modifyUser(const base::User& user) override;
+    bool removeUser(int64_t entry_id) override;
+    base::User findUser(std::u16string_view username) override;
+    ErrorCode hostId(const base::ByteArray& key_hash, base::HostId* host_id) const override;
+    bool addHost(const base::ByteArray& key_hash) override;
+
+private:
+    class Params;
+    class Result;
+
+    explicit DatabasePostgres(PGconn* db);
+
+    // Executes the prepared statement |name| for |query|. Statements are prepared once per
+    // connection, |name| must be a string with static storage duration (it is used as the key).
+    Result execute(const char* name, const char* query, const Params& params) const;
+
+    PGconn* db_;
+    mutable std::set<const char*> statements_;
+
+    DISALLOW_COPY_AND_ASSIGN(DatabasePostgres);
+};
+
+} // namespace router
+
+#endif // ROUTER__DATABASE_POSTGRES_H
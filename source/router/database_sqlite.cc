@@ -29,6 +29,8 @@ namespace router {
 
 namespace {
 
+const int kBusyTimeoutMs = 5000;
+
 const char* columnTypeToString(int type)
 {
     switch (type)
@@ -183,6 +185,14 @@ std::optional<std::u16string> readText16(sqlite3_stmt* statement, int column)
     return base::utf16FromUtf8(*str);
 }
 
+// Cached statements are reset after use instead of being finalized. The bindings refer to the
+// caller's data (SQLITE_STATIC), so they are cleared as well.
+void resetStatement(sqlite3_stmt* statement)
+{
+    sqlite3_reset(statement);
+    sqlite3_clear_bindings(statement);
+}
+
 std::optional<base::User> readUser(sqlite3_stmt* statement)
 {
     std::optional<int64_t> entry_id = readInteger<int64_t>(statement, 0);
@@ -257,6 +267,9 @@ DatabaseSqlite::DatabaseSqlite(sqlite3* db)
 
 DatabaseSqlite::~DatabaseSqlite()
 {
+    for (const auto& statement : statements_)
+        sqlite3_finalize(statement.second);
+
     sqlite3_close(db_);
 }
 
@@ -355,9 +368,28 @@ std::unique_ptr<DatabaseSqlite> DatabaseSqlite::open()
     {
         LOG(LS_WARNING) << "sqlite3_open failed: " << sqlite3_errstr(error_code)
                         << " (" << error_code << ")";
+        sqlite3_close(db);
         return nullptr;
     }
 
+    // Several connections are open at the same time (one per session thread). Wait for the
+    // writes of other connections instead of failing with SQLITE_BUSY.
+    sqlite3_busy_timeout(db, kBusyTimeoutMs);
+
+    // With write-ahead logging readers do not block the writer and a transaction commit only
+    // appends to the log. In NORMAL mode the log is synced to disk at checkpoints rather than on
+    // every commit, so registering many hosts at once does not turn into one fsync per host.
+    static const char kPragmas[] = "PRAGMA journal_mode=WAL;"
+                                   "PRAGMA synchronous=NORMAL;";
+
+    char* error_string = nullptr;
+    if (sqlite3_exec(db, kPragmas, nullptr, nullptr, &error_string) != SQLITE_OK)
+    {
+        // The database remains usable with the default journal.
+        LOG(LS_WARNING) << "Unable to enable WAL journal: " << error_string;
+        sqlite3_free(error_string);
+    }
+
     return std::unique_ptr<DatabaseSqlite>(new DatabaseSqlite(db));
 }
 
@@ -374,13 +406,13 @@ std::filesystem::path DatabaseSqlite::filePath()
 
 std::vector<base::User> DatabaseSqlite::userList() const
 {
-    const char kQuery[] = "SELECT * FROM users";
+    static const char kQuery[] = "SELECT * FROM users";
 
-    sqlite3_stmt* statement;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
+    sqlite3_stmt* statement = nullptr;
+    int error_code = prepareStatement(kQuery, &statement);
     if (error_code != SQLITE_OK)
     {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code)
+        LOG(LS_ERROR) << "sqlite3_prepare_v3 failed: " << sqlite3_errstr(error_code)
                       << " (" << error_code << ")";
         return {};
     }
@@ -397,7 +429,7 @@ std::vector<base::User> DatabaseSqlite::userList() const
             users.emplace_back(std::move(*user));
     }
 
-    sqlite3_finalize(statement);
+    resetStatement(statement);
     return users;
 }
 
@@ -414,10 +446,10 @@ bool DatabaseSqlite::addUser(const base::User& user)
         "VALUES (NULL, ?, ?, ?, ?, ?, ?)";
 
     sqlite3_stmt* statement = nullptr;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
+    int error_code = prepareStatement(kQuery, &statement);
     if (error_code != SQLITE_OK)
     {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code)
+        LOG(LS_ERROR) << "sqlite3_prepare_v3 failed: " << sqlite3_errstr(error_code)
                       << " (" << error_code << ")";
         return false;
     }
@@ -457,7 +489,7 @@ bool DatabaseSqlite::addUser(const base::User& user)
     }
     while (false);
 
-    sqlite3_finalize(statement);
+    resetStatement(statement);
     return result;
 }
 
@@ -474,10 +506,10 @@ bool DatabaseSqlite::modifyUser(const base::User& user)
         "(?, ?, ?, ?, ?, ?) WHERE id=?";
 
     sqlite3_stmt* statement = nullptr;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
+    int error_code = prepareStatement(kQuery, &statement);
     if (error_code != SQLITE_OK)
     {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code)
+        LOG(LS_ERROR) << "sqlite3_prepare_v3 failed: " << sqlite3_errstr(error_code)
                       << " (" << error_code << ")";
         return false;
     }
@@ -520,7 +552,7 @@ bool DatabaseSqlite::modifyUser(const base::User& user)
     }
     while (false);
 
-    sqlite3_finalize(statement);
+    resetStatement(statement);
     return result;
 }
 
@@ -529,10 +561,10 @@ bool DatabaseSqlite::removeUser(int64_t entry_id)
     static const char kQuery[] = "DELETE FROM users WHERE id=?";
 
     sqlite3_stmt* statement = nullptr;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
+    int error_code = prepareStatement(kQuery, &statement);
     if (error_code != SQLITE_OK)
     {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code);
+        LOG(LS_ERROR) << "sqlite3_prepare_v3 failed: " << sqlite3_errstr(error_code);
         return false;
     }
 
@@ -555,19 +587,19 @@ bool DatabaseSqlite::removeUser(int64_t entry_id)
     }
     while (false);
 
-    sqlite3_finalize(statement);
+    resetStatement(statement);
     return result;
 }
 
 base::User DatabaseSqlite::findUser(std::u16string_view username)
 {
-    const char kQuery[] = "SELECT * FROM users WHERE name=?";
+    static const char kQuery[] = "SELECT * FROM users WHERE name=?";
 
     sqlite3_stmt* statement = nullptr;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
+    int error_code = prepareStatement(kQuery, &statement);
     if (error_code != SQLITE_OK)
     {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code)
+        LOG(LS_ERROR) << "sqlite3_prepare_v3 failed: " << sqlite3_errstr(error_code)
                       << " (" << error_code << ")";
         return base::User::kInvalidUser;
     }
@@ -587,7 +619,7 @@ base::User DatabaseSqlite::findUser(std::u16string_view username)
     }
     while (false);
 
-    sqlite3_finalize(statement);
+    resetStatement(statement);
     return user.value_or(base::User::kInvalidUser);
 }
 
@@ -608,13 +640,13 @@ Database::ErrorCode DatabaseSqlite::hostId(
 
     *host_id = base::kInvalidHostId;
 
-    const char kQuery[] = "SELECT * FROM hosts WHERE key=?";
+    static const char kQuery[] = "SELECT * FROM hosts WHERE key=?";
 
-    sqlite3_stmt* statement;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
+    sqlite3_stmt* statement = nullptr;
+    int error_code = prepareStatement(kQuery, &statement);
     if (error_code != SQLITE_OK)
     {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code)
+        LOG(LS_ERROR) << "sqlite3_prepare_v3 failed: " << sqlite3_errstr(error_code)
                       << " (" << error_code << ")";
         return ErrorCode::UNKNOWN;
     }
@@ -647,7 +679,7 @@ Database::ErrorCode DatabaseSqlite::hostId(
     }
     while (false);
 
-    sqlite3_finalize(statement);
+    resetStatement(statement);
     return result;
 }
 
@@ -659,13 +691,13 @@ bool DatabaseSqlite::addHost(const base::ByteArray& keyHash)
         return false;
     }
 
-    const char kQuery[] = "INSERT INTO hosts ('id', 'key') VALUES (NULL, ?)";
+    static const char kQuery[] = "INSERT INTO hosts ('id', 'key') VALUES (NULL, ?)";
 
     sqlite3_stmt* statement = nullptr;
-    int error_code = sqlite3_prepare(db_, kQuery, std::size(kQuery), &statement, nullptr);
+    int error_code = prepareStatement(kQuery, &statement);
     if (error_code != SQLITE_OK)
     {
-        LOG(LS_ERROR) << "sqlite3_prepare failed: " << sqlite3_errstr(error_code)
+        LOG(LS_ERROR) << "sqlite3_prepare_v3 failed: " << sqlite3_errstr(error_code)
                       << " (" << error_code << ")";
         return false;
     }
@@ -689,10 +721,28 @@ bool DatabaseSqlite::addHost(const base::ByteArray& keyHash)
     }
     while (false);
 
-    sqlite3_finalize(statement);
+    resetStatement(statement);
     return result;
 }
 
+int DatabaseSqlite::prepareStatement(const char* query, sqlite3_stmt** statement) const
+{
+    auto it = statements_.find(query);
+    if (it != statements_.end())
+    {
+        *statement = it->second;
+        return SQLITE_OK;
+    }
+
+    int error_code = sqlite3_prepare_v3(
+        db_, query, -1, SQLITE_PREPARE_PERSISTENT, statement, nullptr);
+    if (error_code != SQLITE_OK)
+        return error_code;
+
+    statements_.emplace(query, *statement);
+    return SQLITE_OK;
+}
+
 // static
 std::filesystem::path DatabaseSqlite::databaseDirectory()
 {
@@ -23,6 +23,7 @@
 #include "router/database.h"
 
 #include <filesystem>
+#include <map>
 
 #include <sqlite3.h>
 
@@ -50,7 +51,13 @@ private:
     explicit DatabaseSqlite(sqlite3* db);
     static std::filesystem::path databaseDirectory();
 
+    // Returns a prepared statement for |query|. Statements are prepared once per connection and
+    // cached, |query| must be a string with static storage duration (it is used as the key).
+    // After use the statement must be reset instead of finalized.
+    int prepareStatement(const char* query, sqlite3_stmt** statement) const;
+
     sqlite3* db_;
+    mutable std::map<const char*, sqlite3_stmt*> statements_;
 
     DISALLOW_COPY_AND_ASSIGN(DatabaseSqlite);
 };
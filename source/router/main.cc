@@ -41,6 +41,9 @@
 
 namespace {
 
+const char16_t kUserName[] = u"admin";
+const char16_t kPassword[] = u"admin";
+
 bool generateKeys(base::ByteArray* private_key, base::ByteArray* public_key)
 {
     base::KeyPair key_pair = base::KeyPair::create(base::KeyPair::Type::X25519);
@@ -74,6 +77,48 @@ void generateAndPrintKeys()
     std::cout << "Public key: " << base::toHex(public_key) << std::endl;
 }
 
+// Creates the database and adds the default user to it.
+bool createDatabase(const router::DatabaseFactory& factory)
+{
+    std::unique_ptr<router::Database> db = factory.createDatabase();
+    if (!db)
+    {
+        db = factory.openDatabase();
+        if (db)
+        {
+            std::cout << "Database already exists. Continuation is impossible." << std::endl;
+        }
+        else
+        {
+            std::cout << "Failed to create new database." << std::endl;
+        }
+        return false;
+    }
+
+    std::cout << "Creating a user..." << std::endl;
+
+    base::User user = base::User::create(kUserName, kPassword);
+    if (!user.isValid())
+    {
+        std::cout << "Failed to create user." << std::endl;
+        return false;
+    }
+
+    std::cout << "User has been created. Adding a user to the database..." << std::endl;
+
+    user.sessions = proto::ROUTER_SESSION_ADMIN | proto::ROUTER_SESSION_CLIENT;
+    user.flags = base::User::ENABLED;
+
+    if (!db->addUser(user))
+    {
+        std::cout << "Failed to add user to database." << std::endl;
+        return false;
+    }
+
+    std::cout << "User was successfully added to the database." << std::endl;
+    return true;
+}
+
 void createConfig()
 {
     std::cout << "Creation of initial configuration started." << std::endl;
@@ -138,45 +183,9 @@ void createConfig()
         std::cout << "Public key does not exist yet." << std::endl;
     }
 
-    std::unique_ptr<router::Database> db = router::DatabaseFactorySqlite().createDatabase();
-    if (!db)
-    {
-        db = router::DatabaseFactorySqlite().openDatabase();
-        if (db)
-        {
-            std::cout << "Database already exists. Continuation is impossible." << std::endl;
-        }
-        else
-        {
-            std::cout << "Failed to create new database." << std::endl;
-        }
-        return;
-    }
-
-    std::cout << "Creating a user..." << std::endl;
-
-    const char16_t kUserName[] = u"admin";
-    const char16_t kPassword[] = u"admin";
-
-    base::User user = base::User::create(kUserName, kPassword);
-    if (!user.isValid())
-    {
-        std::cout << "Failed to create user." << std::endl;
-        return;
-    }
-
-    std::cout << "User has been created. Adding a user to the database..." << std::endl;
-
-    user.sessions = proto::ROUTER_SESSION_ADMIN | proto::ROUTER_SESSION_CLIENT;
-    user.flags = base::User::ENABLED;
-
-    if (!db->addUser(user))
-    {
-        std::cout << "Failed to add user to database." << std::endl;
+    if (!createDatabase(router::DatabaseFactorySqlite()))
         return;
-    }
 
-    std::cout << "User was successfully added to the database." << std::endl;
     std::cout << "Generating encryption keys..." << std::endl;
 
     base::ByteArray private_key;
@@ -206,6 +215,26 @@ void createConfig()
     std::cout << "Public key file: " << public_key_file << std::endl;
 }
 
+// Creates the database of the type specified in the configuration. Used when the router is moved
+// to a database server: the configuration is created first and then changed to use the server.
+void createDatabaseFromConfig()
+{
+    std::unique_ptr<router::DatabaseFactory> factory = router::DatabaseFactory::create();
+    if (!factory)
+    {
+        std::cout << "Unsupported database type in configuration." << std::endl;
+        return;
+    }
+
+    if (!createDatabase(*factory))
+        return;
+
+    std::cout << "Database successfully created. Don't forget to change your password!"
+              << std::endl;
+    std::cout << "User name: " << base::local8BitFromUtf16(kUserName) << std::endl;
+    std::cout << "Password: " << base::local8BitFromUtf16(kPassword) << std::endl;
+}
+
 void showHelp()
 {
     std::cout << "aspia_router [switch]" << std::endl
@@ -217,6 +246,8 @@ void showHelp()
         << '\t' << "--stop" << '\t' << "Stop service" << std::endl
 #endif // defined(OS_WIN)
         << '\t' << "--create-config" << '\t' << "Creates a configuration" << std::endl
+        << '\t' << "--create-database" << '\t' << "Creates a database of the configured type"
+        << std::endl
         << '\t' << "--keygen" << '\t' << "Generating public and private keys" << std::endl
         << '\t' << "--help" << '\t' << "Show help" << std::endl;
 }
@@ -259,6 +290,10 @@ int wmain()
     {
         createConfig();
     }
+    else if (command_line->hasSwitch(u"create-database"))
+    {
+        createDatabaseFromConfig();
+    }
     else if (command_line->hasSwitch(u"help"))
     {
         showHelp();
@@ -293,6 +328,10 @@ int main(int argc, const char* const* argv)
     {
         createConfig();
     }
+    else if (command_line->hasSwitch(u"create-database"))
+    {
+        createDatabaseFromConfig();
+    }
     else if (command_line->hasSwitch(u"help"))
     {
         showHelp();
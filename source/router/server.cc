@@ -22,22 +22,33 @@
 #include "base/stl_util.h"
 #include "base/task_runner.h"
 #include "base/crypto/key_pair.h"
+#include "base/crypto/random.h"
 #include "base/files/base_paths.h"
 #include "base/files/file_util.h"
 #include "base/net/network_channel.h"
-#include "router/database_factory_sqlite.h"
-#include "router/database_sqlite.h"
+#include "base/strings/string_util.h"
+#include "base/threading/thread_pool.h"
+#include "router/cluster_backend_sqlite.h"
+#include "router/database.h"
+#include "router/database_factory.h"
 #include "router/session_admin.h"
 #include "router/session_client.h"
 #include "router/session_host.h"
 #include "router/session_relay.h"
+#include "router/session_shard.h"
 #include "router/settings.h"
 #include "router/user_list_db.h"
 
+#include <algorithm>
+#include <thread>
+
 namespace router {
 
 namespace {
 
+const size_t kTicketKeySize = 32;
+const size_t kMaxRemovedSessions = 4096;
+
 const char* sessionTypeToString(proto::RouterSession session_type)
 {
     switch (session_type)
@@ -59,22 +70,51 @@ const char* sessionTypeToString(proto::RouterSession session_type)
     }
 }
 
+bool isSessionMatched(const Session* session, const proto::SessionListRequest& request,
+                      std::string_view filter)
+{
+    if (request.session_type_size() != 0 &&
+        !base::contains(request.session_type(), session->sessionType()))
+    {
+        return false;
+    }
+
+    if (filter.empty())
+        return true;
+
+    return base::toLowerASCII(session->computerName()).find(filter) != std::string::npos ||
+           session->address().find(filter) != std::string::npos;
+}
+
 } // namespace
 
 Server::Server(std::shared_ptr<base::TaskRunner> task_runner)
     : task_runner_(std::move(task_runner)),
-      database_factory_(std::make_shared<DatabaseFactorySqlite>())
+      list_version_(static_cast<uint64_t>(time(nullptr)) << 32),
+      removed_trimmed_version_(list_version_)
 {
     DCHECK(task_runner_);
 }
 
-Server::~Server() = default;
+Server::~Server()
+{
+    // The shards stop their sessions and remove them from the lists.
+    server_.reset();
+    shards_.clear();
+}
 
 bool Server::start()
 {
     if (server_)
         return false;
 
+    database_factory_ = DatabaseFactory::create();
+    if (!database_factory_)
+    {
+        LOG(LS_ERROR) << "Failed to create the database factory";
+        return false;
+    }
+
     std::unique_ptr<Database> database = database_factory_->openDatabase();
     if (!database)
     {
@@ -84,8 +124,8 @@ bool Server::start()
 
     Settings settings;
 
-    base::ByteArray private_key = settings.privateKey();
-    if (private_key.empty())
+    private_key_ = settings.privateKey();
+    if (private_key_.empty())
     {
         LOG(LS_INFO) << "The private key is not specified in the configuration file";
         return false;
@@ -150,31 +190,146 @@ bool Server::start()
             LOG(LS_INFO) << "#" << (i + 1) << ": " << relay_white_list_[i];
     }
 
-    std::unique_ptr<base::UserListBase> user_list = UserListDb::open(*database_factory_);
+    relay_key_pool_ = std::make_unique<SharedKeyPool>(this);
 
-    authenticator_manager_ =
-        std::make_unique<base::ServerAuthenticatorManager>(task_runner_, this);
-    authenticator_manager_->setPrivateKey(private_key);
-    authenticator_manager_->setUserList(std::move(user_list));
-    authenticator_manager_->setAnonymousAccess(
-        base::ServerAuthenticator::AnonymousAccess::ENABLE,
-        proto::ROUTER_SESSION_HOST | proto::ROUTER_SESSION_RELAY);
+    std::string cluster_node_id = settings.clusterNodeId();
+    if (!cluster_node_id.empty())
+    {
+        cluster_backend_ = ClusterBackendSqlite::open(
+            settings.clusterDatabase(), cluster_node_id, task_runner_);
+        if (!cluster_backend_)
+        {
+            LOG(LS_ERROR) << "Failed to open the cluster database";
+            return false;
+        }
 
-    relay_key_pool_ = std::make_unique<SharedKeyPool>(this);
+        cluster_backend_->start(this);
+    }
+
+    // The tickets allow hosts and relays to reconnect after a short network failure without the
+    // key exchange. They become invalid when the router is restarted.
+    ticket_key_ = base::Random::byteArray(kTicketKeySize);
+
+    // All shards share one pool for the SRP calculations of new connections.
+    crypto_pool_ = std::make_shared<base::ThreadPool>(settings.cryptoThreadCount());
+
+    LOG(LS_INFO) << "Crypto thread count: " << crypto_pool_->threadCount();
+
+    size_t session_thread_count = settings.sessionThreadCount();
+    if (!session_thread_count)
+        session_thread_count = std::max(std::thread::hardware_concurrency(), 1U);
+
+    LOG(LS_INFO) << "Session thread count: " << session_thread_count;
+
+    std::vector<base::Thread*> threads;
+
+    // Authentication and session I/O of the connections are spread over the shards.
+    for (size_t i = 0; i < session_thread_count; ++i)
+    {
+        shards_.emplace_back(std::make_unique<SessionShard>(i, this));
+        shards_.back()->start();
+
+        threads.emplace_back(shards_.back()->thread());
+    }
+
+    std::vector<base::NetworkServer::Listener> listeners;
+
+    // Each interface has its own accept thread if there are several of them.
+    const Settings::AddressList addresses = settings.listenAddresses();
+    for (const auto& address : addresses)
+    {
+        base::NetworkServer::Listener listener;
+        listener.address = address;
+        listener.port = port;
+        listener.own_thread = addresses.size() > 1;
+
+        listeners.emplace_back(std::move(listener));
+    }
 
     server_ = std::make_unique<base::NetworkServer>();
-    server_->start(port, this);
+    server_->setChannelThreads(threads);
+
+    if (listeners.empty())
+    {
+        server_->start(port, this);
+    }
+    else if (!server_->start(listeners, this))
+    {
+        LOG(LS_ERROR) << "Failed to start listening";
+        server_.reset();
+        return false;
+    }
 
     LOG(LS_INFO) << "Server started";
     return true;
 }
 
-std::unique_ptr<proto::SessionList> Server::sessionList() const
+std::unique_ptr<proto::SessionList> Server::sessionList(
+    const proto::SessionListRequest& request) const
 {
     std::unique_ptr<proto::SessionList> result = std::make_unique<proto::SessionList>();
 
-    for (const auto& session : sessions_)
+    const std::string filter = base::toLowerASCII(request.filter());
+    const uint64_t since_version = request.since_version();
+
+    std::scoped_lock lock(sessions_lock_);
+
+    const bool delta = since_version != 0 &&
+        since_version >= removed_trimmed_version_ && since_version <= list_version_;
+
+    result->set_version(list_version_);
+    result->set_delta(delta);
+
+    std::vector<const Session*> sessions;
+    uint32_t total_count = 0;
+
+    for (const auto& [session_id, entry] : sessions_)
+    {
+        const Session* session = entry.session;
+
+        if (!isSessionMatched(session, request, filter))
+            continue;
+
+        ++total_count;
+
+        if (!delta || entry.version > since_version ||
+            session->sessionType() == proto::ROUTER_SESSION_RELAY)
+        {
+            sessions.emplace_back(session);
+        }
+    }
+
+    result->set_total_count(total_count);
+
+    // The order of the hash map changes with the contents. Pages are taken from the list sorted by
+    // ID so that they stay stable between requests.
+    std::sort(sessions.begin(), sessions.end(), [](const Session* a, const Session* b)
+    {
+        return a->sessionId() < b->sessionId();
+    });
+
+    auto begin = sessions.cbegin();
+    auto end = sessions.cend();
+
+    if (delta)
+    {
+        for (const auto& [version, session_id] : removed_sessions_)
+        {
+            if (version > since_version)
+                result->add_removed_session_id(session_id);
+        }
+    }
+    else
+    {
+        begin += std::min(static_cast<size_t>(request.offset()), sessions.size());
+        if (request.limit() != 0 && static_cast<size_t>(end - begin) > request.limit())
+            end = begin + request.limit();
+    }
+
+    for (auto it = begin; it != end; ++it)
     {
+        const Session* session = *it;
+
         proto::Session* item = result->add_session();
 
         item->set_session_id(session->sessionId());
@@ -191,7 +346,7 @@ std::unique_ptr<proto::SessionList> Server::sessionList() const
             {
                 proto::HostSessionData session_data;
 
-                for (const auto& host_id : static_cast<SessionHost*>(session.get())->hostIdList())
+                for (const auto& host_id : static_cast<const SessionHost*>(session)->hostIdList())
                     session_data.add_host_id(host_id);
 
                 item->set_session_data(session_data.SerializeAsString());
@@ -202,6 +357,16 @@ std::unique_ptr<proto::SessionList> Server::sessionList() const
             {
                 proto::RelaySessionData session_data;
                 session_data.set_pool_size(relay_key_pool_->countForRelay(session->sessionId()));
+
+                std::optional<proto::RelayStat> relay_stat =
+                    static_cast<const SessionRelay*>(session)->relayStat();
+                if (relay_stat.has_value())
+                {
+                    session_data.set_session_count(relay_stat->session_count());
+                    session_data.set_rx_speed(relay_stat->rx_speed());
+                    session_data.set_tx_speed(relay_stat->tx_speed());
+                }
+
                 item->set_session_data(session_data.SerializeAsString());
             }
             break;
@@ -215,95 +380,165 @@ std::unique_ptr<proto::SessionList> Server::sessionList() const
     return result;
 }
 
+uint64_t Server::sessionListVersion() const
+{
+    std::scoped_lock lock(sessions_lock_);
+    return list_version_;
+}
+
 bool Server::stopSession(Session::SessionId session_id)
 {
-    for (auto it = sessions_.begin(); it != sessions_.end(); ++it)
+    SessionShard* shard;
+
     {
-        if (it->get()->sessionId() == session_id)
-        {
-            sessions_.erase(it);
-            return true;
-        }
+        std::scoped_lock lock(sessions_lock_);
+        shard = removeSessionLocked(session_id);
     }
 
-    return false;
+    if (!shard)
+        return false;
+
+    shard->stopSession(session_id);
+    return true;
 }
 
 void Server::onHostSessionWithId(SessionHost* session)
 {
-    for (auto it = sessions_.begin(); it != sessions_.end();)
+    std::vector<std::pair<SessionShard*, Session::SessionId>> previous_sessions;
+
     {
-        if (it->get()->sessionType() == proto::ROUTER_SESSION_HOST)
+        std::scoped_lock lock(sessions_lock_);
+
+        for (const auto& host_id : session->hostIdList())
         {
-            SessionHost* other_session = reinterpret_cast<SessionHost*>(it->get());
-            if (other_session != session)
+            SessionHost*& host_session = host_sessions_[host_id];
+
+            if (host_session && host_session != session)
             {
-                for (const auto& host_id : session->hostIdList())
-                {
-                    if (other_session->hasHostId(host_id))
-                    {
-                        LOG(LS_INFO) << "Detected previous connection with ID " << host_id;
+                LOG(LS_INFO) << "Detected previous connection with ID " << host_id;
 
-                        it = sessions_.erase(it);
-                        continue;
-                    }
-                }
+                // The previous session is removed with all its IDs, the entry is assigned after
+                // it.
+                const Session::SessionId previous_id = host_session->sessionId();
+
+                SessionShard* shard = removeSessionLocked(previous_id);
+                if (shard)
+                    previous_sessions.emplace_back(shard, previous_id);
+
+                host_sessions_[host_id] = session;
             }
+            else if (!host_session)
+            {
+                host_session = session;
+            }
+            else
+            {
+                continue;
+            }
+
+            if (cluster_backend_)
+                cluster_backend_->setHostOnline(host_id);
         }
 
-        ++it;
+        sessionChangedLocked(session->sessionId());
     }
+
+    for (const auto& previous_session : previous_sessions)
+        previous_session.first->stopSession(previous_session.second);
 }
 
-SessionHost* Server::hostSessionById(base::HostId host_id)
+void Server::onHostIdRemoved(SessionHost* session, base::HostId host_id)
 {
-    for (auto it = sessions_.begin(); it != sessions_.end(); ++it)
+    std::scoped_lock lock(sessions_lock_);
+
+    auto it = host_sessions_.find(host_id);
+    if (it != host_sessions_.end() && it->second == session)
     {
-        Session* entry = it->get();
+        host_sessions_.erase(it);
 
-        if (entry->sessionType() == proto::ROUTER_SESSION_HOST &&
-            static_cast<SessionHost*>(entry)->hasHostId(host_id))
-        {
-            return static_cast<SessionHost*>(entry);
-        }
+        if (cluster_backend_)
+            cluster_backend_->setHostOffline(host_id);
     }
 
-    return nullptr;
+    sessionChangedLocked(session->sessionId());
 }
 
-Session* Server::sessionById(Session::SessionId session_id)
+bool Server::hasHost(base::HostId host_id) const
 {
-    for (auto& session : sessions_)
-    {
-        if (session->sessionId() == session_id)
-            return session.get();
-    }
+    std::scoped_lock lock(sessions_lock_);
+    return host_sessions_.find(host_id) != host_sessions_.end();
+}
+
+bool Server::sendConnectionOffer(base::HostId host_id, const proto::ConnectionOffer& offer)
+{
+    std::scoped_lock lock(sessions_lock_);
 
-    return nullptr;
+    auto it = host_sessions_.find(host_id);
+    if (it == host_sessions_.end())
+        return false;
+
+    // The session is not deleted while it is in the list.
+    it->second->sendConnectionOffer(offer);
+    return true;
 }
 
-void Server::onNewConnection(std::unique_ptr<base::NetworkChannel> channel)
+SessionHost::CandidateList Server::hostCandidates(base::HostId host_id) const
 {
-    LOG(LS_INFO) << "New connection: " << channel->peerAddress();
+    std::scoped_lock lock(sessions_lock_);
 
-    channel->setOwnKeepAlive(true);
-    channel->setNoDelay(true);
+    auto it = host_sessions_.find(host_id);
+    if (it == host_sessions_.end())
+        return SessionHost::CandidateList();
 
-    if (authenticator_manager_)
-        authenticator_manager_->addNewChannel(std::move(channel));
+    return it->second->candidates();
 }
 
-void Server::onPoolKeyUsed(Session::SessionId session_id, uint32_t key_id)
+std::optional<SessionRelay::PeerData> Server::relayPeerData(Session::SessionId session_id) const
 {
-    for (const auto& session : sessions_)
-    {
-        SessionRelay* relay_session = static_cast<SessionRelay*>(session.get());
-        if (relay_session->sessionId() == session_id)
-            relay_session->sendKeyUsed(key_id);
-    }
+    std::scoped_lock lock(sessions_lock_);
+
+    auto it = sessions_.find(session_id);
+    if (it == sessions_.end() || it->second.session->sessionType() != proto::ROUTER_SESSION_RELAY)
+        return std::nullopt;
+
+    return static_cast<SessionRelay*>(it->second.session)->peerData();
+}
+
+bool Server::hasRemoteHost(base::HostId host_id)
+{
+    if (!cluster_backend_)
+        return false;
+
+    return cluster_backend_->hasRemoteHost(host_id);
+}
+
+bool Server::forwardConnectionOffer(base::HostId host_id, const proto::ConnectionOffer& offer)
+{
+    if (!cluster_backend_)
+        return false;
+
+    return cluster_backend_->forwardConnectionOffer(host_id, offer);
 }
 
-void Server::onNewSession(base::ServerAuthenticatorManager::SessionInfo&& session_info)
+std::unique_ptr<base::ServerAuthenticatorManager> Server::createAuthenticatorManager(
+    std::shared_ptr<base::TaskRunner> task_runner,
+    base::ServerAuthenticatorManager::Delegate* delegate) const
+{
+    std::unique_ptr<base::ServerAuthenticatorManager> authenticator_manager =
+        std::make_unique<base::ServerAuthenticatorManager>(std::move(task_runner), delegate);
+    authenticator_manager->setPrivateKey(private_key_);
+    authenticator_manager->setUserList(UserListDb::open(*database_factory_));
+    authenticator_manager->setAnonymousAccess(
+        base::ServerAuthenticator::AnonymousAccess::ENABLE,
+        proto::ROUTER_SESSION_HOST | proto::ROUTER_SESSION_RELAY);
+    authenticator_manager->setCryptoPool(crypto_pool_);
+    authenticator_manager->setTicketKey(ticket_key_);
+
+    return authenticator_manager;
+}
+
+std::unique_ptr<Session> Server::createSession(
+    base::ServerAuthenticatorManager::SessionInfo&& session_info)
 {
     std::u16string address = session_info.channel->peerAddress();
     proto::RouterSession session_type =
@@ -362,7 +597,7 @@ void Server::onNewSession(base::ServerAuthenticatorManager::SessionInfo&& sessio
     if (!session)
     {
         LOG(LS_ERROR) << "Connection rejected for '" << address << "'";
-        return;
+        return nullptr;
     }
 
     session->setChannel(std::move(session_info.channel));
@@ -373,24 +608,103 @@ void Server::onNewSession(base::ServerAuthenticatorManager::SessionInfo&& sessio
     session->setOsName(session_info.os_name);
     session->setComputerName(session_info.computer_name);
 
-    sessions_.emplace_back(std::move(session));
-    sessions_.back()->start(this);
+    return session;
+}
+
+void Server::addSession(Session* session, SessionShard* shard)
+{
+    std::scoped_lock lock(sessions_lock_);
+    sessions_.emplace(session->sessionId(), SessionEntry{ session, shard, ++list_version_ });
 }
 
-void Server::onSessionFinished(Session::SessionId session_id, proto::RouterSession /* session_type */)
+void Server::removeSession(Session::SessionId session_id)
 {
-    for (auto it = sessions_.begin(); it != sessions_.end(); ++it)
+    std::scoped_lock lock(sessions_lock_);
+    removeSessionLocked(session_id);
+}
+
+void Server::onNewConnection(std::unique_ptr<base::NetworkChannel> channel)
+{
+    LOG(LS_INFO) << "New connection: " << channel->peerAddress();
+
+    channel->setOwnKeepAlive(true);
+    channel->setKeepAliveOnIdleOnly(true);
+    channel->setNoDelay(true);
+
+    // The channel is created on the thread of one of the shards.
+    for (const auto& shard : shards_)
     {
-        if (it->get()->sessionId() == session_id)
+        if (shard->belongsToCurrentThread())
         {
-            // Session will be destroyed after completion of the current call.
-            task_runner_->deleteSoon(std::move(*it));
+            shard->addChannel(std::move(channel));
+            return;
+        }
+    }
 
-            // Delete a session from the list.
-            sessions_.erase(it);
-            break;
+    NOTREACHED();
+}
+
+void Server::onPoolKeyUsed(Session::SessionId session_id, uint32_t key_id)
+{
+    std::scoped_lock lock(sessions_lock_);
+
+    auto it = sessions_.find(session_id);
+    if (it != sessions_.end() && it->second.session->sessionType() == proto::ROUTER_SESSION_RELAY)
+        static_cast<SessionRelay*>(it->second.session)->sendKeyUsed(key_id);
+}
+
+void Server::onConnectionOfferForwarded(
+    base::HostId host_id, const proto::ConnectionOffer& offer)
+{
+    LOG(LS_INFO) << "Sending forwarded connection offer to host " << host_id;
+
+    if (!sendConnectionOffer(host_id, offer))
+        LOG(LS_WARNING) << "Host with id " << host_id << " NOT found for forwarded offer";
+}
+
+SessionShard* Server::removeSessionLocked(Session::SessionId session_id)
+{
+    auto it = sessions_.find(session_id);
+    if (it == sessions_.end())
+        return nullptr;
+
+    Session* session = it->second.session;
+    SessionShard* shard = it->second.shard;
+
+    sessions_.erase(it);
+
+    removed_sessions_.emplace_back(++list_version_, session_id);
+    if (removed_sessions_.size() > kMaxRemovedSessions)
+    {
+        removed_trimmed_version_ = removed_sessions_.front().first;
+        removed_sessions_.pop_front();
+    }
+
+    if (session->sessionType() == proto::ROUTER_SESSION_HOST)
+    {
+        SessionHost* host_session = static_cast<SessionHost*>(session);
+
+        for (const auto& host_id : host_session->hostIdList())
+        {
+            auto host_it = host_sessions_.find(host_id);
+            if (host_it == host_sessions_.end() || host_it->second != host_session)
+                continue;
+
+            host_sessions_.erase(host_it);
+
+            if (cluster_backend_)
+                cluster_backend_->setHostOffline(host_id);
         }
     }
+
+    return shard;
+}
+
+void Server::sessionChangedLocked(Session::SessionId session_id)
+{
+    auto it = sessions_.find(session_id);
+    if (it != sessions_.end())
+        it->second.version = ++list_version_;
 }
 
 } // namespace router
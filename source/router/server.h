@@ -24,20 +24,31 @@
 #include "base/peer/server_authenticator_manager.h"
 #include "build/build_config.h"
 #include "proto/router_admin.pb.h"
+#include "router/cluster_backend.h"
 #include "router/session.h"
+#include "router/session_host.h"
+#include "router/session_relay.h"
 #include "router/shared_key_pool.h"
 
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace base {
+class ThreadPool;
+} // namespace base
+
 namespace router {
 
 class DatabaseFactory;
-class SessionHost;
-class SessionRelay;
+class SessionShard;
 
+// The sessions run on the threads of the session shards. The methods of the server that are used
+// by the sessions can be called from any thread.
 class Server
     : public base::NetworkServer::Delegate,
       public SharedKeyPool::Delegate,
-      public base::ServerAuthenticatorManager::Delegate,
-      public Session::Delegate
+      public ClusterBackend::Delegate
 {
 public:
     explicit Server(std::shared_ptr<base::TaskRunner> task_runner);
@@ -45,12 +56,33 @@ public:
 
     bool start();
 
-    std::unique_ptr<proto::SessionList> sessionList() const;
+    std::unique_ptr<proto::SessionList> sessionList(
+        const proto::SessionListRequest& request) const;
+    uint64_t sessionListVersion() const;
     bool stopSession(Session::SessionId session_id);
     void onHostSessionWithId(SessionHost* session);
+    void onHostIdRemoved(SessionHost* session, base::HostId host_id);
+
+    // Hosts connected to this router.
+    bool hasHost(base::HostId host_id) const;
+    bool sendConnectionOffer(base::HostId host_id, const proto::ConnectionOffer& offer);
+    SessionHost::CandidateList hostCandidates(base::HostId host_id) const;
+
+    std::optional<SessionRelay::PeerData> relayPeerData(Session::SessionId session_id) const;
 
-    SessionHost* hostSessionById(base::HostId host_id);
-    Session* sessionById(Session::SessionId session_id);
+    // Hosts connected to other nodes of the cluster. Always false if the router is not a node of
+    // a cluster.
+    bool hasRemoteHost(base::HostId host_id);
+    bool forwardConnectionOffer(base::HostId host_id, const proto::ConnectionOffer& offer);
+
+    // Called by the session shards on their threads.
+    std::unique_ptr<base::ServerAuthenticatorManager> createAuthenticatorManager(
+        std::shared_ptr<base::TaskRunner> task_runner,
+        base::ServerAuthenticatorManager::Delegate* delegate) const;
+    std::unique_ptr<Session> createSession(
+        base::ServerAuthenticatorManager::SessionInfo&& session_info);
+    void addSession(Session* session, SessionShard* shard);
+    void removeSession(Session::SessionId session_id);
 
 protected:
     // base::NetworkServer::Delegate implementation.
@@ -59,20 +91,51 @@ protected:
     // SharedKeyPool::Delegate implementation.
     void onPoolKeyUsed(Session::SessionId session_id, uint32_t key_id) override;
 
-    // base::ServerAuthenticatorManager::Delegate implementation.
-    void onNewSession(base::ServerAuthenticatorManager::SessionInfo&& session_info) override;
-
-    // Session::Delegate implementation.
-    void onSessionFinished(Session::SessionId session_id,
-                           proto::RouterSession session_type) override;
+    // ClusterBackend::Delegate implementation.
+    void onConnectionOfferForwarded(
+        base::HostId host_id, const proto::ConnectionOffer& offer) override;
 
 private:
+    struct SessionEntry
+    {
+        Session* session;
+        SessionShard* shard;
+        uint64_t version; // Version of the list at which the session was added or changed.
+    };
+
+    // Removes the session and its host IDs from the lists. Returns the shard of the session or
+    // nullptr if there is no session with the ID. |sessions_lock_| must be held.
+    SessionShard* removeSessionLocked(Session::SessionId session_id);
+
+    // Marks the session as changed for the deltas of the session list. |sessions_lock_| must be
+    // held.
+    void sessionChangedLocked(Session::SessionId session_id);
+
     std::shared_ptr<base::TaskRunner> task_runner_;
     std::shared_ptr<DatabaseFactory> database_factory_;
     std::unique_ptr<base::NetworkServer> server_;
-    std::unique_ptr<base::ServerAuthenticatorManager> authenticator_manager_;
+    std::shared_ptr<base::ThreadPool> crypto_pool_;
+    std::vector<std::unique_ptr<SessionShard>> shards_;
     std::unique_ptr<SharedKeyPool> relay_key_pool_;
-    std::vector<std::unique_ptr<Session>> sessions_;
+    std::unique_ptr<ClusterBackend> cluster_backend_;
+    base::ByteArray private_key_;
+    base::ByteArray ticket_key_;
+
+    // Guards the lists of sessions. The sessions are added and removed by their shards.
+    mutable std::mutex sessions_lock_;
+    std::unordered_map<Session::SessionId, SessionEntry> sessions_;
+
+    // Incremented on every change of the list. It starts from the start time of the router so that
+    // the versions known to the admins are not reused after a restart.
+    uint64_t list_version_;
+
+    // Recently removed sessions with the versions of the list at removal. The versions not newer
+    // than |removed_trimmed_version_| are dropped and a delta cannot be built from them.
+    std::deque<std::pair<uint64_t, Session::SessionId>> removed_sessions_;
+    uint64_t removed_trimmed_version_;
+
+    // Host sessions by the host IDs assigned to them.
+    std::unordered_map<base::HostId, SessionHost*> host_sessions_;
 
     std::vector<std::u16string> client_white_list_;
     std::vector<std::u16string> host_white_list_;
@@ -20,25 +20,34 @@
 
 #include "base/logging.h"
 #include "base/net/network_channel.h"
+#include "base/net/network_channel_proxy.h"
 #include "base/strings/unicode.h"
 #include "router/database.h"
 #include "router/database_factory.h"
 #include "router/shared_key_pool.h"
 
+#include <atomic>
+
 namespace router {
 
 Session::SessionId createSessionId()
 {
-    static Session::SessionId last_session_id = 0;
-    ++last_session_id;
-    return last_session_id;
+    // Sessions are created on several threads.
+    static std::atomic<Session::SessionId> last_session_id = 0;
+    return ++last_session_id;
 }
 
 Session::Session(proto::RouterSession session_type)
     : session_type_(session_type),
-      session_id_(createSessionId())
+      session_id_(createSessionId()),
+      incoming_block_(std::make_unique<char[]>(kIncomingArenaBlockSize))
 {
-    // Nothing
+    google::protobuf::ArenaOptions incoming_options;
+    incoming_options.initial_block = incoming_block_.get();
+    incoming_options.initial_block_size = kIncomingArenaBlockSize;
+    incoming_options.max_block_size = kIncomingArenaBlockSize;
+
+    incoming_arena_ = std::make_unique<google::protobuf::Arena>(incoming_options);
 }
 
 Session::~Session() = default;
@@ -46,6 +55,9 @@ Session::~Session() = default;
 void Session::setChannel(std::unique_ptr<base::NetworkChannel> channel)
 {
     channel_ = std::move(channel);
+
+    if (channel_)
+        channel_proxy_ = channel_->channelProxy();
 }
 
 void Session::setRelayKeyPool(std::unique_ptr<SharedKeyPool> relay_key_pool)
@@ -137,10 +149,18 @@ std::chrono::seconds Session::duration() const
         std::chrono::system_clock::now() - time_point);
 }
 
-void Session::sendMessage(const google::protobuf::MessageLite& message)
+void Session::trimMemory()
 {
     if (channel_)
-        channel_->send(base::serialize(message));
+        channel_->trimMemory();
+}
+
+void Session::sendMessage(const google::protobuf::MessageLite& message)
+{
+    // Other sessions send messages to this session from their threads. The proxy passes them to
+    // the thread of the channel in order.
+    if (channel_proxy_)
+        channel_proxy_->send(base::serialize(message));
 }
 
 void Session::onConnected()
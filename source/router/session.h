@@ -23,6 +23,12 @@
 #include "base/net/network_channel.h"
 #include "proto/router_common.pb.h"
 
+#include <google/protobuf/arena.h>
+
+namespace base {
+class NetworkChannelProxy;
+} // namespace base
+
 namespace router {
 
 class Database;
@@ -69,12 +75,26 @@ public:
     time_t startTime() const { return start_time_; }
     std::chrono::seconds duration() const;
 
+    // Frees the buffers of the network channel that are not in use right now.
+    void trimMemory();
+
 protected:
+    // Can be called from any thread.
     void sendMessage(const google::protobuf::MessageLite& message);
     std::unique_ptr<Database> openDatabase() const;
 
     virtual void onSessionReady() = 0;
 
+    // Returns a message to parse an incoming message into. Incoming messages are allocated in an
+    // arena of the session that is cleared for each new message, so the previous incoming message
+    // must not be used after the call.
+    template<class T>
+    T* incomingMessage()
+    {
+        incoming_arena_->Reset();
+        return google::protobuf::Arena::CreateMessage<T>(incoming_arena_.get());
+    }
+
     // base::NetworkChannel::Listener implementation.
     void onConnected() override;
     void onDisconnected(base::NetworkChannel::ErrorCode error_code) override;
@@ -86,11 +106,15 @@ protected:
     const Server& server() const { return *server_; }
 
 private:
+    // The router has many sessions and their messages are small.
+    static const size_t kIncomingArenaBlockSize = 4 * 1024; // 4 kB
+
     const proto::RouterSession session_type_;
     const SessionId session_id_;
     time_t start_time_ = 0;
 
     std::unique_ptr<base::NetworkChannel> channel_;
+    std::shared_ptr<base::NetworkChannelProxy> channel_proxy_;
     std::shared_ptr<DatabaseFactory> database_factory_;
     std::unique_ptr<SharedKeyPool> relay_key_pool_;
     Server* server_ = nullptr;
@@ -101,6 +125,9 @@ private:
     std::string os_name_;
     std::string computer_name_;
 
+    std::unique_ptr<char[]> incoming_block_;
+    std::unique_ptr<google::protobuf::Arena> incoming_arena_;
+
     Delegate* delegate_ = nullptr;
 };
 
@@ -19,6 +19,8 @@
 #include "router/session_admin.h"
 
 #include "base/logging.h"
+#include "base/waitable_timer.h"
+#include "base/message_loop/message_loop.h"
 #include "base/net/network_channel.h"
 #include "base/peer/user.h"
 #include "base/strings/unicode.h"
@@ -27,6 +29,13 @@
 
 namespace router {
 
+namespace {
+
+// The changes of the session list are collected during this interval and sent in one message.
+const std::chrono::seconds kSubscriptionInterval{ 1 };
+
+} // namespace
+
 SessionAdmin::SessionAdmin()
     : Session(proto::ROUTER_SESSION_ADMIN)
 {
@@ -42,9 +51,9 @@ void SessionAdmin::onSessionReady()
 
 void SessionAdmin::onMessageReceived(const base::ByteArray& buffer)
 {
-    std::unique_ptr<proto::AdminToRouter> message = std::make_unique<proto::AdminToRouter>();
+    proto::AdminToRouter* message = incomingMessage<proto::AdminToRouter>();
 
-    if (!base::parse(buffer, message.get()))
+    if (!base::parse(buffer, message))
     {
         LOG(LS_ERROR) << "Could not read message from manager";
         return;
@@ -66,6 +75,10 @@ void SessionAdmin::onMessageReceived(const base::ByteArray& buffer)
     {
         doUserRequest(message->user_request());
     }
+    else if (message->has_session_subscription())
+    {
+        doSessionSubscription(message->session_subscription());
+    }
     else
     {
         LOG(LS_WARNING) << "Unhandled message from manager";
@@ -124,17 +137,54 @@ void SessionAdmin::doUserRequest(const proto::UserRequest& request)
     sendMessage(*message);
 }
 
-void SessionAdmin::doSessionListRequest(const proto::SessionListRequest& /* request */)
+void SessionAdmin::doSessionListRequest(const proto::SessionListRequest& request)
 {
     std::unique_ptr<proto::RouterToAdmin> message = std::make_unique<proto::RouterToAdmin>();
 
-    message->set_allocated_session_list(server().sessionList().release());
+    message->set_allocated_session_list(server().sessionList(request).release());
     if (!message->has_session_list())
         message->mutable_session_list()->set_error_code(proto::SessionList::UNKNOWN_ERROR);
 
     sendMessage(*message);
 }
 
+void SessionAdmin::doSessionSubscription(const proto::SessionSubscription& subscription)
+{
+    LOG(LS_INFO) << "Session subscription: " << subscription.enable();
+
+    subscription_timer_.reset();
+    subscription_request_.Clear();
+
+    if (!subscription.enable())
+        return;
+
+    subscription_request_.mutable_session_type()->CopyFrom(subscription.session_type());
+    subscription_request_.set_filter(subscription.filter());
+
+    // The admin receives the full list first, the following messages contain the changes only.
+    proto::RouterToAdmin message;
+    message.set_allocated_session_list(server().sessionList(subscription_request_).release());
+    subscription_request_.set_since_version(message.session_list().version());
+    sendMessage(message);
+
+    subscription_timer_ = std::make_unique<base::WaitableTimer>(
+        base::WaitableTimer::Type::REPEATED, base::MessageLoop::current()->taskRunner());
+    subscription_timer_->start(std::chrono::duration_cast<std::chrono::milliseconds>(
+        kSubscriptionInterval), std::bind(&SessionAdmin::onSubscriptionTimer, this));
+}
+
+void SessionAdmin::onSubscriptionTimer()
+{
+    // The list is built only if something has changed since the last message.
+    if (server().sessionListVersion() == subscription_request_.since_version())
+        return;
+
+    proto::RouterToAdmin message;
+    message.set_allocated_session_list(server().sessionList(subscription_request_).release());
+    subscription_request_.set_since_version(message.session_list().version());
+    sendMessage(message);
+}
+
 void SessionAdmin::doSessionRequest(const proto::SessionRequest& request)
 {
     std::unique_ptr<proto::RouterToAdmin> message = std::make_unique<proto::RouterToAdmin>();
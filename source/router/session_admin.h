@@ -22,6 +22,10 @@
 #include "proto/router_admin.pb.h"
 #include "router/session.h"
 
+namespace base {
+class WaitableTimer;
+} // namespace base
+
 namespace router {
 
 class ServerProxy;
@@ -45,11 +49,17 @@ private:
     void doUserRequest(const proto::UserRequest& request);
     void doSessionListRequest(const proto::SessionListRequest& request);
     void doSessionRequest(const proto::SessionRequest& request);
+    void doSessionSubscription(const proto::SessionSubscription& subscription);
+    void onSubscriptionTimer();
 
     proto::UserResult::ErrorCode addUser(const proto::User& user);
     proto::UserResult::ErrorCode modifyUser(const proto::User& user);
     proto::UserResult::ErrorCode deleteUser(const proto::User& user);
 
+    // Filter of the subscription and the version of the list last sent to the admin.
+    std::unique_ptr<base::WaitableTimer> subscription_timer_;
+    proto::SessionListRequest subscription_request_;
+
     DISALLOW_COPY_AND_ASSIGN(SessionAdmin);
 };
 
@@ -25,8 +25,17 @@
 #include "router/session_host.h"
 #include "router/session_relay.h"
 
+#include <algorithm>
+
 namespace router {
 
+namespace {
+
+// Limits the work of the router for one message.
+const int kMaxHostStatusListSize = 1000;
+
+} // namespace
+
 SessionClient::SessionClient()
     : Session(proto::ROUTER_SESSION_CLIENT)
 {
@@ -42,8 +51,8 @@ void SessionClient::onSessionReady()
 
 void SessionClient::onMessageReceived(const base::ByteArray& buffer)
 {
-    std::unique_ptr<proto::PeerToRouter> message = std::make_unique<proto::PeerToRouter>();
-    if (!base::parse(buffer, message.get()))
+    proto::PeerToRouter* message = incomingMessage<proto::PeerToRouter>();
+    if (!base::parse(buffer, message))
     {
         LOG(LS_ERROR) << "Could not read message from client";
         return;
@@ -57,6 +66,10 @@ void SessionClient::onMessageReceived(const base::ByteArray& buffer)
     {
         readCheckHostStatus(message->check_host_status());
     }
+    else if (message->has_check_host_status_list())
+    {
+        readCheckHostStatusList(message->check_host_status_list());
+    }
     else
     {
         LOG(LS_WARNING) << "Unhandled message from client";
@@ -75,15 +88,20 @@ void SessionClient::readConnectionRequest(const proto::ConnectionRequest& reques
     std::unique_ptr<proto::RouterToPeer> message = std::make_unique<proto::RouterToPeer>();
     proto::ConnectionOffer* offer = message->mutable_connection_offer();
 
-    SessionHost* host = server().hostSessionById(request.host_id());
-    if (!host)
+    const bool host_found = server().hasHost(request.host_id());
+
+    // The host can be connected to another node of the cluster. The offer is sent through it.
+    const bool remote_host = !host_found && server().hasRemoteHost(request.host_id());
+
+    if (!host_found && !remote_host)
     {
         LOG(LS_WARNING) << "Host with id " << request.host_id() << " NOT found!";
         offer->set_error_code(proto::ConnectionOffer::PEER_NOT_FOUND);
     }
     else
     {
-        LOG(LS_INFO) << "Host with id " << request.host_id() << " found";
+        LOG(LS_INFO) << "Host with id " << request.host_id() << " found"
+                     << (remote_host ? " on another node" : "");
 
         std::optional<SharedKeyPool::Credentials> credentials = relayKeyPool().takeCredentials();
         if (!credentials.has_value())
@@ -93,36 +111,44 @@ void SessionClient::readConnectionRequest(const proto::ConnectionRequest& reques
         }
         else
         {
-            SessionRelay* relay = static_cast<SessionRelay*>(
-                server().sessionById(credentials->session_id));
-            if (!relay)
+            // The relay session may run on another thread, so its data is requested as a copy.
+            std::optional<SessionRelay::PeerData> peer_data =
+                server().relayPeerData(credentials->session_id);
+            if (!peer_data.has_value())
             {
-                LOG(LS_ERROR) << "No relay with session id " << credentials->session_id;
+                LOG(LS_ERROR) << "No peer data for relay with session id "
+                              << credentials->session_id;
                 offer->set_error_code(proto::ConnectionOffer::KEY_POOL_EMPTY);
             }
             else
             {
-                const std::optional<SessionRelay::PeerData>& peer_data = relay->peerData();
-                if (!peer_data.has_value())
-                {
-                    LOG(LS_ERROR) << "No peer data for relay with session id "
-                                  << credentials->session_id;
-                    offer->set_error_code(proto::ConnectionOffer::KEY_POOL_EMPTY);
-                }
-                else
-                {
-                    offer->set_error_code(proto::ConnectionOffer::SUCCESS);
+                offer->set_error_code(proto::ConnectionOffer::SUCCESS);
+
+                proto::RelayCredentials* offer_credentials = offer->mutable_relay();
+
+                offer_credentials->set_host(peer_data->first);
+                offer_credentials->set_port(peer_data->second);
+                offer_credentials->mutable_key()->Swap(&credentials->key);
+                offer_credentials->set_secret(base::Random::string(16));
+
+                LOG(LS_INFO) << "Sending connection offer to host";
+                offer->set_peer_role(proto::ConnectionOffer::HOST);
 
-                    proto::RelayCredentials* offer_credentials = offer->mutable_relay();
+                bool sent;
+                if (!remote_host)
+                    sent = server().sendConnectionOffer(request.host_id(), *offer);
+                else
+                    sent = server().forwardConnectionOffer(request.host_id(), *offer);
 
-                    offer_credentials->set_host(relay->peerData()->first);
-                    offer_credentials->set_port(relay->peerData()->second);
-                    offer_credentials->mutable_key()->Swap(&credentials->key);
-                    offer_credentials->set_secret(base::Random::string(16));
+                if (!sent)
+                    offer->set_error_code(proto::ConnectionOffer::PEER_NOT_FOUND);
 
-                    LOG(LS_INFO) << "Sending connection offer to host";
-                    offer->set_peer_role(proto::ConnectionOffer::HOST);
-                    host->sendConnectionOffer(*offer);
+                // The candidates of the hosts connected to other nodes are not known. The
+                // connection to them always goes through the relay.
+                if (sent && !remote_host)
+                {
+                    for (auto& candidate : server().hostCandidates(request.host_id()))
+                        offer->add_candidate()->Swap(&candidate);
                 }
             }
         }
@@ -138,7 +164,8 @@ void SessionClient::readCheckHostStatus(const proto::CheckHostStatus& check_host
     std::unique_ptr<proto::RouterToPeer> message = std::make_unique<proto::RouterToPeer>();
     proto::HostStatus* host_status = message->mutable_host_status();
 
-    if (server().hostSessionById(check_host_status.host_id()))
+    if (server().hasHost(check_host_status.host_id()) ||
+        server().hasRemoteHost(check_host_status.host_id()))
         host_status->set_status(proto::HostStatus::STATUS_ONLINE);
     else
         host_status->set_status(proto::HostStatus::STATUS_OFFLINE);
@@ -148,4 +175,30 @@ void SessionClient::readCheckHostStatus(const proto::CheckHostStatus& check_host
     sendMessage(*message);
 }
 
+void SessionClient::readCheckHostStatusList(
+    const proto::CheckHostStatusList& check_host_status_list)
+{
+    std::unique_ptr<proto::RouterToPeer> message = std::make_unique<proto::RouterToPeer>();
+    proto::HostStatusList* host_status_list = message->mutable_host_status_list();
+
+    const int count = std::min(check_host_status_list.host_id_size(), kMaxHostStatusListSize);
+    if (count < check_host_status_list.host_id_size())
+    {
+        LOG(LS_WARNING) << "Too many hosts in status request: "
+                        << check_host_status_list.host_id_size();
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        const base::HostId host_id = check_host_status_list.host_id(i);
+
+        if (server().hasHost(host_id) || server().hasRemoteHost(host_id))
+            host_status_list->add_online_host_id(host_id);
+    }
+
+    LOG(LS_INFO) << "Sending status of " << count << " hosts ("
+                 << host_status_list->online_host_id_size() << " online)";
+    sendMessage(*message);
+}
+
 } // namespace router
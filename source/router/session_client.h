@@ -44,6 +44,7 @@ protected:
 private:
     void readConnectionRequest(const proto::ConnectionRequest& request);
     void readCheckHostStatus(const proto::CheckHostStatus& check_host_status);
+    void readCheckHostStatusList(const proto::CheckHostStatusList& check_host_status_list);
 
     DISALLOW_COPY_AND_ASSIGN(SessionClient);
 };
@@ -31,6 +31,7 @@ namespace router {
 namespace {
 
 const size_t kHostKeySize = 512;
+const int kMaxCandidates = 8;
 
 } // namespace
 
@@ -42,8 +43,15 @@ SessionHost::SessionHost()
 
 SessionHost::~SessionHost() = default;
 
+SessionHost::HostIdList SessionHost::hostIdList() const
+{
+    std::scoped_lock lock(host_id_list_lock_);
+    return host_id_list_;
+}
+
 bool SessionHost::hasHostId(base::HostId host_id) const
 {
+    std::scoped_lock lock(host_id_list_lock_);
     return base::contains(host_id_list_, host_id);
 }
 
@@ -54,6 +62,12 @@ void SessionHost::sendConnectionOffer(const proto::ConnectionOffer& offer)
     sendMessage(*message);
 }
 
+SessionHost::CandidateList SessionHost::candidates() const
+{
+    std::scoped_lock lock(candidates_lock_);
+    return candidates_;
+}
+
 void SessionHost::onSessionReady()
 {
     // Nothing
@@ -61,8 +75,8 @@ void SessionHost::onSessionReady()
 
 void SessionHost::onMessageReceived(const base::ByteArray& buffer)
 {
-    std::unique_ptr<proto::PeerToRouter> message = std::make_unique<proto::PeerToRouter>();
-    if (!base::parse(buffer, message.get()))
+    proto::PeerToRouter* message = incomingMessage<proto::PeerToRouter>();
+    if (!base::parse(buffer, message))
     {
         LOG(LS_ERROR) << "Could not read message from host";
         return;
@@ -76,6 +90,10 @@ void SessionHost::onMessageReceived(const base::ByteArray& buffer)
     {
         readResetHostId(message->reset_host_id());
     }
+    else if (message->has_host_candidates())
+    {
+        readHostCandidates(message->host_candidates());
+    }
     else
     {
         LOG(LS_WARNING) << "Unhandled message from host";
@@ -139,9 +157,12 @@ void SessionHost::readHostIdRequest(const proto::HostIdRequest& host_id_request)
                 host_id_response->set_error_code(proto::HostIdResponse::SUCCESS);
                 host_id_response->set_host_id(host_id);
 
-                if (!base::contains(host_id_list_, host_id))
+                if (!hasHostId(host_id))
                 {
-                    host_id_list_.emplace_back(host_id);
+                    {
+                        std::scoped_lock lock(host_id_list_lock_);
+                        host_id_list_.emplace_back(host_id);
+                    }
 
                     // Notify the server that the ID has been assigned.
                     server().onHostSessionWithId(this);
@@ -176,23 +197,90 @@ void SessionHost::readResetHostId(const proto::ResetHostId& reset_host_id)
         return;
     }
 
-    if (host_id_list_.empty())
+    bool removed = false;
+
     {
-        LOG(LS_ERROR) << "Empty host ID list";
-        return;
+        std::scoped_lock lock(host_id_list_lock_);
+
+        if (host_id_list_.empty())
+        {
+            LOG(LS_ERROR) << "Empty host ID list";
+            return;
+        }
+
+        for (auto it = host_id_list_.begin(); it != host_id_list_.end(); ++it)
+        {
+            if (*it == host_id)
+            {
+                LOG(LS_INFO) << "Host ID " << host_id << " remove from list";
+                host_id_list_.erase(it);
+                removed = true;
+                break;
+            }
+        }
     }
 
-    for (auto it = host_id_list_.begin(); it != host_id_list_.end(); ++it)
+    // The server is notified without holding the lock, it reads the list under its own lock.
+    if (removed)
+        server().onHostIdRemoved(this, host_id);
+    else
+        LOG(LS_WARNING) << "Host ID " << host_id << " NOT found in list";
+}
+
+void SessionHost::readHostCandidates(const proto::HostCandidates& host_candidates)
+{
+    CandidateList candidates;
+    uint32_t port = 0;
+
+    for (int i = 0; i < host_candidates.candidate_size() && i < kMaxCandidates; ++i)
     {
-        if (*it == host_id)
+        const proto::PeerCandidate& candidate = host_candidates.candidate(i);
+
+        // The host only knows its local addresses. The reflexive address is added below.
+        if (candidate.type() != proto::PeerCandidate::TYPE_LOCAL || candidate.host().empty() ||
+            candidate.port() == 0 || candidate.port() > 65535)
         {
-            LOG(LS_INFO) << "Host ID " << host_id << " remove from list";
-            host_id_list_.erase(it);
-            return;
+            LOG(LS_WARNING) << "Invalid candidate from host: " << candidate.host() << ":"
+                            << candidate.port() << " (type: " << candidate.type() << ")";
+            continue;
+        }
+
+        if (!port)
+            port = candidate.port();
+
+        candidates.emplace_back(candidate);
+    }
+
+    // If the host is not behind NAT or a port is forwarded to it, it can be reached at the
+    // address from which it is connected to the router. The port is assumed to be the same.
+    if (port && !address().empty())
+    {
+        bool is_local = false;
+
+        for (const auto& candidate : candidates)
+        {
+            if (candidate.host() == address())
+            {
+                is_local = true;
+                break;
+            }
+        }
+
+        if (!is_local)
+        {
+            proto::PeerCandidate reflexive;
+            reflexive.set_type(proto::PeerCandidate::TYPE_REFLEXIVE);
+            reflexive.set_host(address());
+            reflexive.set_port(port);
+
+            candidates.emplace_back(std::move(reflexive));
         }
     }
 
-    LOG(LS_WARNING) << "Host ID " << host_id << " NOT found in list";
+    LOG(LS_INFO) << "Host candidates received: " << candidates.size();
+
+    std::scoped_lock lock(candidates_lock_);
+    candidates_.swap(candidates);
 }
 
 } // namespace router
@@ -23,6 +23,8 @@
 #include "proto/router_peer.pb.h"
 #include "router/session.h"
 
+#include <mutex>
+
 namespace router {
 
 class ServerProxy;
@@ -35,11 +37,19 @@ public:
 
     using HostIdList = std::vector<base::HostId>;
 
-    const HostIdList& hostIdList() const { return host_id_list_; }
+    // The list is read by the server on other threads.
+    HostIdList hostIdList() const;
     bool hasHostId(base::HostId host_id) const;
 
+    // Can be called from any thread.
     void sendConnectionOffer(const proto::ConnectionOffer& offer);
 
+    using CandidateList = std::vector<proto::PeerCandidate>;
+
+    // Addresses for a direct connection to the host. The list is read by the server on other
+    // threads.
+    CandidateList candidates() const;
+
 protected:
     // Session implementation.
     void onSessionReady() override;
@@ -51,8 +61,13 @@ protected:
 private:
     void readHostIdRequest(const proto::HostIdRequest& host_id_request);
     void readResetHostId(const proto::ResetHostId& reset_host_id);
+    void readHostCandidates(const proto::HostCandidates& host_candidates);
 
     HostIdList host_id_list_;
+    mutable std::mutex host_id_list_lock_;
+
+    CandidateList candidates_;
+    mutable std::mutex candidates_lock_;
 
     DISALLOW_COPY_AND_ASSIGN(SessionHost);
 };
@@ -34,6 +34,18 @@ SessionRelay::~SessionRelay()
     relayKeyPool().removeKeysForRelay(sessionId());
 }
 
+std::optional<SessionRelay::PeerData> SessionRelay::peerData() const
+{
+    std::scoped_lock lock(lock_);
+    return peer_data_;
+}
+
+std::optional<proto::RelayStat> SessionRelay::relayStat() const
+{
+    std::scoped_lock lock(lock_);
+    return relay_stat_;
+}
+
 void SessionRelay::sendKeyUsed(uint32_t key_id)
 {
     std::unique_ptr<proto::RouterToRelay> message = std::make_unique<proto::RouterToRelay>();
@@ -48,9 +60,9 @@ void SessionRelay::onSessionReady()
 
 void SessionRelay::onMessageReceived(const base::ByteArray& buffer)
 {
-    std::unique_ptr<proto::RelayToRouter> message = std::make_unique<proto::RelayToRouter>();
+    proto::RelayToRouter* message = incomingMessage<proto::RelayToRouter>();
 
-    if (!base::parse(buffer, message.get()))
+    if (!base::parse(buffer, message))
     {
         LOG(LS_ERROR) << "Could not read message from relay server";
         return;
@@ -60,6 +72,26 @@ void SessionRelay::onMessageReceived(const base::ByteArray& buffer)
     {
         readKeyPool(message->key_pool());
     }
+    else if (message->has_relay_stat())
+    {
+        const proto::RelayStat& relay_stat = message->relay_stat();
+
+        relayKeyPool().setRelayLoad(sessionId(), relay_stat.session_count(),
+                                    relay_stat.rx_speed() + relay_stat.tx_speed());
+
+        std::scoped_lock lock(lock_);
+        relay_stat_ = std::move(*message->mutable_relay_stat());
+    }
+    else if (message->has_drain())
+    {
+        LOG(LS_INFO) << "Relay is draining, timeout: " << message->drain().timeout()
+                     << " (" << address() << ")";
+
+        // Peers are no longer sent to the relay. The keys that have already been given out are
+        // still accepted by it.
+        is_draining_ = true;
+        relayKeyPool().removeKeysForRelay(sessionId());
+    }
     else
     {
         LOG(LS_WARNING) << "Unhandled message from relay server";
@@ -73,12 +105,21 @@ void SessionRelay::onMessageWritten(size_t /* pending */)
 
 void SessionRelay::readKeyPool(const proto::RelayKeyPool& key_pool)
 {
+    if (is_draining_)
+    {
+        LOG(LS_WARNING) << "Key pool from draining relay ignored (" << address() << ")";
+        return;
+    }
+
     SharedKeyPool& pool = relayKeyPool();
 
     LOG(LS_INFO) << "Received key pool: " << key_pool.key_size() << " (" << address() << ")";
 
-    peer_data_.emplace(std::make_pair(
-        key_pool.peer_host(), static_cast<uint16_t>(key_pool.peer_port())));
+    {
+        std::scoped_lock lock(lock_);
+        peer_data_.emplace(std::make_pair(
+            key_pool.peer_host(), static_cast<uint16_t>(key_pool.peer_port())));
+    }
 
     for (int i = 0; i < key_pool.key_size(); ++i)
         pool.addKey(sessionId(), key_pool.key(i));
@@ -23,6 +23,9 @@
 #include "router/session.h"
 #include "router/shared_key_pool.h"
 
+#include <mutex>
+#include <optional>
+
 namespace router {
 
 class SessionRelay : public Session
@@ -33,7 +36,13 @@ public:
 
     using PeerData = std::pair<std::string, uint16_t>;
 
-    const std::optional<PeerData>& peerData() const { return peer_data_; }
+    // The data is read by the server on other threads.
+    std::optional<PeerData> peerData() const;
+
+    // Last statistics received from the relay.
+    std::optional<proto::RelayStat> relayStat() const;
+
+    // Can be called from any thread.
     void sendKeyUsed(uint32_t key_id);
 
 protected:
@@ -47,7 +56,10 @@ protected:
 private:
     void readKeyPool(const proto::RelayKeyPool& key_pool);
 
+    bool is_draining_ = false;
     std::optional<PeerData> peer_data_;
+    std::optional<proto::RelayStat> relay_stat_;
+    mutable std::mutex lock_;
 
     DISALLOW_COPY_AND_ASSIGN(SessionRelay);
 };
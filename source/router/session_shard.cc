@@ -0,0 +1,136 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/session_shard.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/net/network_channel.h"
+#include "router/server.h"
+
+namespace router {
+
+namespace {
+
+// Sessions periodically free the network buffers they do not use. Most hosts are idle between
+// connection requests, keep-alive messages do not need the buffers.
+constexpr std::chrono::minutes kTrimInterval { 1 };
+
+} // namespace
+
+SessionShard::SessionShard(size_t index, Server* server)
+    : index_(index),
+      server_(server),
+      thread_(std::make_unique<base::Thread>())
+{
+    DCHECK(server_);
+}
+
+SessionShard::~SessionShard()
+{
+    thread_->stop();
+}
+
+void SessionShard::start()
+{
+    LOG(LS_INFO) << "Starting session shard #" << index_;
+    thread_->start(base::MessageLoop::Type::ASIO, this);
+}
+
+bool SessionShard::belongsToCurrentThread() const
+{
+    return task_runner_ && task_runner_->belongsToCurrentThread();
+}
+
+void SessionShard::addChannel(std::unique_ptr<base::NetworkChannel> channel)
+{
+    DCHECK(belongsToCurrentThread());
+
+    if (authenticator_manager_)
+        authenticator_manager_->addNewChannel(std::move(channel));
+}
+
+void SessionShard::stopSession(Session::SessionId session_id)
+{
+    task_runner_->postTask(std::bind(&SessionShard::deleteSession, this, session_id));
+}
+
+void SessionShard::onBeforeThreadRunning()
+{
+    task_runner_ = thread_->taskRunner();
+    DCHECK(task_runner_);
+
+    // Each shard authenticates its connections with its own user list.
+    authenticator_manager_ = server_->createAuthenticatorManager(task_runner_, this);
+
+    trim_timer_ = std::make_unique<base::WaitableTimer>(
+        base::WaitableTimer::Type::REPEATED, task_runner_);
+    trim_timer_->start(kTrimInterval, [this]()
+    {
+        for (const auto& session : sessions_)
+            session.second->trimMemory();
+    });
+}
+
+void SessionShard::onAfterThreadRunning()
+{
+    trim_timer_.reset();
+    authenticator_manager_.reset();
+
+    for (const auto& session : sessions_)
+        server_->removeSession(session.first);
+
+    sessions_.clear();
+}
+
+void SessionShard::onNewSession(base::ServerAuthenticatorManager::SessionInfo&& session_info)
+{
+    std::unique_ptr<Session> session = server_->createSession(std::move(session_info));
+    if (!session)
+        return;
+
+    Session* session_ptr = session.get();
+    sessions_.emplace(session_ptr->sessionId(), std::move(session));
+
+    session_ptr->start(this);
+
+    // The session becomes visible to other threads when it is completely started.
+    server_->addSession(session_ptr, this);
+}
+
+void SessionShard::onSessionFinished(Session::SessionId session_id,
+                                     proto::RouterSession /* session_type */)
+{
+    server_->removeSession(session_id);
+    deleteSession(session_id);
+}
+
+void SessionShard::deleteSession(Session::SessionId session_id)
+{
+    auto it = sessions_.find(session_id);
+    if (it == sessions_.end())
+        return;
+
+    // Session will be destroyed after completion of the current call.
+    task_runner_->deleteSoon(std::move(it->second));
+
+    // Delete a session from the list.
+    sessions_.erase(it);
+}
+
+} // namespace router
@@ -0,0 +1,86 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER__SESSION_SHARD_H
+#define ROUTER__SESSION_SHARD_H
+
+#include "base/peer/server_authenticator_manager.h"
+#include "base/waitable_timer.h"
+#include "base/threading/thread.h"
+#include "router/session.h"
+
+#include <atomic>
+#include <unordered_map>
+
+namespace router {
+
+class Server;
+
+// Runs a part of the router sessions on its own I/O thread. The connections are accepted by the
+// server on the shard thread, then the shard authenticates them and runs the sessions.
+class SessionShard
+    : public base::Thread::Delegate,
+      public base::ServerAuthenticatorManager::Delegate,
+      public Session::Delegate
+{
+public:
+    SessionShard(size_t index, Server* server);
+    ~SessionShard() override;
+
+    void start();
+
+    base::Thread* thread() const { return thread_.get(); }
+    bool belongsToCurrentThread() const;
+
+    // Starts the authentication of the channel. Called on the shard thread.
+    void addChannel(std::unique_ptr<base::NetworkChannel> channel);
+
+    // Stops the session. The server has already removed it from its lists. Can be called from any
+    // thread.
+    void stopSession(Session::SessionId session_id);
+
+protected:
+    // base::Thread::Delegate implementation.
+    void onBeforeThreadRunning() override;
+    void onAfterThreadRunning() override;
+
+    // base::ServerAuthenticatorManager::Delegate implementation.
+    void onNewSession(base::ServerAuthenticatorManager::SessionInfo&& session_info) override;
+
+    // Session::Delegate implementation.
+    void onSessionFinished(Session::SessionId session_id,
+                           proto::RouterSession session_type) override;
+
+private:
+    void deleteSession(Session::SessionId session_id);
+
+    const size_t index_;
+    Server* server_;
+
+    std::unique_ptr<base::Thread> thread_;
+    std::shared_ptr<base::TaskRunner> task_runner_;
+    std::unique_ptr<base::ServerAuthenticatorManager> authenticator_manager_;
+    std::unordered_map<Session::SessionId, std::unique_ptr<Session>> sessions_;
+    std::unique_ptr<base::WaitableTimer> trim_timer_;
+
+    DISALLOW_COPY_AND_ASSIGN(SessionShard);
+};
+
+} // namespace router
+
+#endif // ROUTER__SESSION_SHARD_H
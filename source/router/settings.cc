@@ -30,6 +30,7 @@ namespace {
 const base::JsonSettings::Scope kScope = base::JsonSettings::Scope::SYSTEM;
 const char kApplicationName[] = "aspia";
 const char kFileName[] = "router";
+const char kDefaultDatabaseType[] = "sqlite";
 
 } // namespace
 
@@ -50,11 +51,18 @@ std::filesystem::path Settings::filePath()
 void Settings::reset()
 {
     setPort(DEFAULT_ROUTER_TCP_PORT);
+    setListenAddresses(AddressList());
     setPrivateKey(base::ByteArray());
     setClientWhiteList(WhiteList());
     setHostWhiteList(WhiteList());
     setAdminWhiteList(WhiteList());
     setRelayWhiteList(WhiteList());
+    setSessionThreadCount(0);
+    setCryptoThreadCount(0);
+    setClusterNodeId(std::string());
+    setClusterDatabase(std::filesystem::path());
+    setDatabaseType(kDefaultDatabaseType);
+    setDatabaseConnection(std::string());
 }
 
 void Settings::flush()
@@ -72,6 +80,16 @@ uint16_t Settings::port() const
     return impl_.get<uint16_t>("Port", DEFAULT_ROUTER_TCP_PORT);
 }
 
+void Settings::setListenAddresses(const AddressList& list)
+{
+    setWhiteList("ListenAddresses", list);
+}
+
+Settings::AddressList Settings::listenAddresses() const
+{
+    return whiteList("ListenAddresses");
+}
+
 void Settings::setPrivateKey(const base::ByteArray& private_key)
 {
     impl_.set<std::string>("PrivateKey", base::toHex(private_key));
@@ -122,6 +140,66 @@ Settings::WhiteList Settings::relayWhiteList() const
     return whiteList("RelayWhiteList");
 }
 
+void Settings::setSessionThreadCount(uint32_t count)
+{
+    impl_.set<uint32_t>("SessionThreadCount", count);
+}
+
+uint32_t Settings::sessionThreadCount() const
+{
+    return impl_.get<uint32_t>("SessionThreadCount", 0);
+}
+
+void Settings::setCryptoThreadCount(uint32_t count)
+{
+    impl_.set<uint32_t>("CryptoThreadCount", count);
+}
+
+uint32_t Settings::cryptoThreadCount() const
+{
+    return impl_.get<uint32_t>("CryptoThreadCount", 0);
+}
+
+void Settings::setClusterNodeId(const std::string& node_id)
+{
+    impl_.set<std::string>("ClusterNodeId", node_id);
+}
+
+std::string Settings::clusterNodeId() const
+{
+    return impl_.get<std::string>("ClusterNodeId");
+}
+
+void Settings::setClusterDatabase(const std::filesystem::path& path)
+{
+    impl_.set<std::string>("ClusterDatabase", path.u8string());
+}
+
+std::filesystem::path Settings::clusterDatabase() const
+{
+    return std::filesystem::u8path(impl_.get<std::string>("ClusterDatabase"));
+}
+
+void Settings::setDatabaseType(const std::string& type)
+{
+    impl_.set<std::string>("DatabaseType", type);
+}
+
+std::string Settings::databaseType() const
+{
+    return impl_.get<std::string>("DatabaseType", kDefaultDatabaseType);
+}
+
+void Settings::setDatabaseConnection(const std::string& connection)
+{
+    impl_.set<std::string>("DatabaseConnection", connection);
+}
+
+std::string Settings::databaseConnection() const
+{
+    return impl_.get<std::string>("DatabaseConnection");
+}
+
 void Settings::setWhiteList(std::string_view key, const WhiteList& value)
 {
     std::u16string result;
@@ -37,6 +37,13 @@ public:
     void setPort(uint16_t port);
     uint16_t port() const;
 
+    // Addresses of the interfaces to accept connections on, IPv4 or IPv6. If the list is empty,
+    // connections are accepted on all IPv4 interfaces.
+    using AddressList = std::vector<std::u16string>;
+
+    void setListenAddresses(const AddressList& list);
+    AddressList listenAddresses() const;
+
     void setPrivateKey(const base::ByteArray& private_key);
     base::ByteArray privateKey() const;
 
@@ -54,6 +61,34 @@ public:
     void setRelayWhiteList(const WhiteList& list);
     WhiteList relayWhiteList() const;
 
+    // Number of threads for the authentication and I/O of the sessions. If 0, the number of
+    // processor cores is used.
+    void setSessionThreadCount(uint32_t count);
+    uint32_t sessionThreadCount() const;
+
+    // Number of threads for the SRP calculations of new connections. If 0, the number of processor
+    // cores is used.
+    void setCryptoThreadCount(uint32_t count);
+    uint32_t cryptoThreadCount() const;
+
+    // The router runs as a node of a cluster if the node ID is not empty. The nodes share the
+    // cluster database.
+    void setClusterNodeId(const std::string& node_id);
+    std::string clusterNodeId() const;
+
+    void setClusterDatabase(const std::filesystem::path& path);
+    std::filesystem::path clusterDatabase() const;
+
+    // Type of the database with the users and the hosts: "sqlite" (the default) or "postgresql".
+    // A PostgreSQL database can be shared by several routers.
+    void setDatabaseType(const std::string& type);
+    std::string databaseType() const;
+
+    // Connection string for the database server, for example
+    // "host=db.example.com dbname=aspia user=router password=secret". Not used for SQLite.
+    void setDatabaseConnection(const std::string& connection);
+    std::string databaseConnection() const;
+
 private:
     void setWhiteList(std::string_view key, const WhiteList& value);
     WhiteList whiteList(std::string_view key) const;
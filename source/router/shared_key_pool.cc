@@ -20,6 +20,8 @@
 
 #include "base/logging.h"
 
+#include <mutex>
+
 namespace router {
 
 class SharedKeyPool::Impl
@@ -31,6 +33,7 @@ public:
     void dettach();
 
     void addKey(Session::SessionId session_id, const proto::RelayKey& key);
+    void setRelayLoad(Session::SessionId session_id, uint32_t session_count, uint64_t bandwidth);
     std::optional<Credentials> takeCredentials();
     void removeKeysForRelay(Session::SessionId session_id);
     void clear();
@@ -41,7 +44,33 @@ public:
 private:
     using Keys = std::vector<proto::RelayKey>;
 
+    struct Load
+    {
+        // Values from the last relay report.
+        uint32_t session_count = 0;
+        uint64_t bandwidth = 0;
+
+        // Number of keys given out since the last report. The sessions for them are not yet
+        // included in the report.
+        uint32_t keys_taken = 0;
+
+        // Estimated bandwidth (bytes per second) after all given out keys are used.
+        uint64_t estimatedBandwidth() const
+        {
+            if (!session_count)
+                return bandwidth;
+
+            return bandwidth + (bandwidth / session_count) * keys_taken;
+        }
+
+        uint32_t estimatedSessionCount() const { return session_count + keys_taken; }
+    };
+
+    // The pool is shared by the sessions on all session threads.
+    mutable std::mutex lock_;
+
     std::map<Session::SessionId, Keys> pool_;
+    std::map<Session::SessionId, Load> load_;
     Delegate* delegate_;
 
     DISALLOW_COPY_AND_ASSIGN(Impl);
@@ -55,11 +84,14 @@ SharedKeyPool::Impl::Impl(Delegate* delegate)
 
 void SharedKeyPool::Impl::dettach()
 {
+    std::scoped_lock lock(lock_);
     delegate_ = nullptr;
 }
 
 void SharedKeyPool::Impl::addKey(Session::SessionId session_id, const proto::RelayKey& key)
 {
+    std::scoped_lock lock(lock_);
+
     auto relay = pool_.find(session_id);
     if (relay == pool_.end())
     {
@@ -71,8 +103,22 @@ void SharedKeyPool::Impl::addKey(Session::SessionId session_id, const proto::Rel
     relay->second.emplace_back(key);
 }
 
+void SharedKeyPool::Impl::setRelayLoad(
+    Session::SessionId session_id, uint32_t session_count, uint64_t bandwidth)
+{
+    std::scoped_lock lock(lock_);
+
+    Load& load = load_[session_id];
+
+    load.session_count = session_count;
+    load.bandwidth = bandwidth;
+    load.keys_taken = 0;
+}
+
 std::optional<SharedKeyPool::Credentials> SharedKeyPool::Impl::takeCredentials()
 {
+    std::unique_lock lock(lock_);
+
     if (pool_.empty())
     {
         LOG(LS_WARNING) << "Empty key pool";
@@ -80,14 +126,47 @@ std::optional<SharedKeyPool::Credentials> SharedKeyPool::Impl::takeCredentials()
     }
 
     auto preffered_relay = pool_.end();
+    Load preffered_load;
     size_t max_count = 0;
 
+    // The least loaded relay is preferred: first by the estimated bandwidth, then by the number
+    // of sessions and then by the number of free keys. Relays that have not yet sent reports have
+    // zero load.
     for (auto it = pool_.begin(); it != pool_.end(); ++it)
     {
         size_t count = it->second.size();
-        if (count > max_count)
+        if (!count)
+            continue;
+
+        Load load;
+
+        auto load_it = load_.find(it->first);
+        if (load_it != load_.end())
+            load = load_it->second;
+
+        bool is_better = false;
+
+        if (preffered_relay == pool_.end())
+        {
+            is_better = true;
+        }
+        else if (load.estimatedBandwidth() != preffered_load.estimatedBandwidth())
+        {
+            is_better = load.estimatedBandwidth() < preffered_load.estimatedBandwidth();
+        }
+        else if (load.estimatedSessionCount() != preffered_load.estimatedSessionCount())
+        {
+            is_better = load.estimatedSessionCount() < preffered_load.estimatedSessionCount();
+        }
+        else
+        {
+            is_better = count > max_count;
+        }
+
+        if (is_better)
         {
             preffered_relay = it;
+            preffered_load = load;
             max_count = count;
         }
     }
@@ -114,32 +193,47 @@ std::optional<SharedKeyPool::Credentials> SharedKeyPool::Impl::takeCredentials()
     // Removing the key from the pool.
     keys.pop_back();
 
+    ++load_[credentials.session_id].keys_taken;
+
     if (keys.empty())
     {
         LOG(LS_INFO) << "Last key in the pool for relay. The relay will be removed from the pool";
         pool_.erase(preffered_relay->first);
     }
 
-    if (delegate_)
-        delegate_->onPoolKeyUsed(credentials.session_id, credentials.key.key_id());
+    Delegate* delegate = delegate_;
+
+    // The delegate takes the lock of the server. The server reads the pool under its lock.
+    lock.unlock();
+
+    if (delegate)
+        delegate->onPoolKeyUsed(credentials.session_id, credentials.key.key_id());
 
     return std::move(credentials);
 }
 
 void SharedKeyPool::Impl::removeKeysForRelay(Session::SessionId session_id)
 {
+    std::scoped_lock lock(lock_);
+
     LOG(LS_INFO) << "All keys for relay '" << session_id << "' removed";
     pool_.erase(session_id);
+    load_.erase(session_id);
 }
 
 void SharedKeyPool::Impl::clear()
 {
+    std::scoped_lock lock(lock_);
+
     LOG(LS_INFO) << "Key pool cleared";
     pool_.clear();
+    load_.clear();
 }
 
 size_t SharedKeyPool::Impl::countForRelay(Session::SessionId session_id) const
 {
+    std::scoped_lock lock(lock_);
+
     auto result = pool_.find(session_id);
     if (result == pool_.end())
         return 0;
@@ -149,6 +243,8 @@ size_t SharedKeyPool::Impl::countForRelay(Session::SessionId session_id) const
 
 size_t SharedKeyPool::Impl::count() const
 {
+    std::scoped_lock lock(lock_);
+
     size_t result = 0;
 
     for (const auto& relay : pool_)
@@ -159,6 +255,8 @@ size_t SharedKeyPool::Impl::count() const
 
 bool SharedKeyPool::Impl::isEmpty() const
 {
+    std::scoped_lock lock(lock_);
+
     return pool_.empty();
 }
 
@@ -192,6 +290,12 @@ void SharedKeyPool::addKey(Session::SessionId session_id, const proto::RelayKey&
     impl_->addKey(session_id, key);
 }
 
+void SharedKeyPool::setRelayLoad(
+    Session::SessionId session_id, uint32_t session_count, uint64_t bandwidth)
+{
+    impl_->setRelayLoad(session_id, session_count, bandwidth);
+}
+
 std::optional<SharedKeyPool::Credentials> SharedKeyPool::takeCredentials()
 {
     return impl_->takeCredentials();
@@ -52,6 +52,10 @@ public:
     };
 
     void addKey(Session::SessionId session_id, const proto::RelayKey& key);
+
+    // Updates the load reported by the relay. It is used to choose the relay for new sessions.
+    void setRelayLoad(Session::SessionId session_id, uint32_t session_count, uint64_t bandwidth);
+
     std::optional<Credentials> takeCredentials();
     void removeKeysForRelay(Session::SessionId session_id);
     void clear();
@@ -0,0 +1,96 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "router/user_cache.h"
+
+#include "base/strings/string_util.h"
+
+namespace router {
+
+namespace {
+
+// Upper bound for the number of cached users.
+const size_t kMaxCachedUsers = 10000;
+
+} // namespace
+
+UserCache::UserCache(std::chrono::milliseconds lifetime)
+    : lifetime_(lifetime)
+{
+    // Nothing
+}
+
+UserCache::~UserCache() = default;
+
+bool UserCache::find(std::u16string_view username, base::User* user)
+{
+    if (username.empty() || !user)
+        return false;
+
+    std::u16string key = base::toLower(username);
+
+    std::scoped_lock lock(lock_);
+
+    auto it = users_.find(key);
+    if (it == users_.end())
+        return false;
+
+    if (lifetime_ != std::chrono::milliseconds::zero() &&
+        Clock::now() - it->second.time >= lifetime_)
+    {
+        users_.erase(it);
+        return false;
+    }
+
+    *user = it->second.user;
+    return true;
+}
+
+uint64_t UserCache::generation()
+{
+    std::scoped_lock lock(lock_);
+    return generation_;
+}
+
+void UserCache::add(const base::User& user, uint64_t generation)
+{
+    if (!user.isValid())
+        return;
+
+    std::u16string key = base::toLower(user.name);
+
+    std::scoped_lock lock(lock_);
+
+    if (generation != generation_)
+        return;
+
+    // The cache is simply started over when full.
+    if (users_.size() >= kMaxCachedUsers)
+        users_.clear();
+
+    users_.insert_or_assign(std::move(key), Entry{ user, Clock::now() });
+}
+
+void UserCache::clear()
+{
+    std::scoped_lock lock(lock_);
+    users_.clear();
+    ++generation_;
+}
+
+} // namespace router
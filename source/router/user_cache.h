@@ -0,0 +1,72 @@
+//
+// Aspia Project
+// Copyright (C) 2016-2022 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef ROUTER__USER_CACHE_H
+#define ROUTER__USER_CACHE_H
+
+#include "base/macros_magic.h"
+#include "base/peer/user.h"
+
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
+namespace router {
+
+// Users found in the database, by case-insensitive name. Authentication of a known user is then
+// served from memory. Any change of the users in the database must clear the cache.
+// The class is thread-safe.
+class UserCache
+{
+public:
+    // Entries older than |lifetime| are not returned. This bounds the time a change made by
+    // another router sharing the database remains unnoticed. Zero means that entries do not
+    // expire.
+    explicit UserCache(std::chrono::milliseconds lifetime = std::chrono::milliseconds::zero());
+    ~UserCache();
+
+    bool find(std::u16string_view username, base::User* user);
+
+    // The user read from the database is added only if the cache was not cleared since
+    // |generation| was taken. Otherwise the user could be read before a change and added after it.
+    uint64_t generation();
+    void add(const base::User& user, uint64_t generation);
+
+    void clear();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        base::User user;
+        Clock::time_point time;
+    };
+
+    const std::chrono::milliseconds lifetime_;
+
+    std::mutex lock_;
+    std::unordered_map<std::u16string, Entry> users_;
+    uint64_t generation_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(UserCache);
+};
+
+} // namespace router
+
+#endif // ROUTER__USER_CACHE_H
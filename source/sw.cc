@@ -143,6 +143,11 @@ void build(Solution &s)
     router += base;
     router += "org.sw.demo.sqlite3"_dep;
 
+    auto &load_test = aspia.addExecutable("load_test");
+    load_test += cppstd;
+    load_test += "load_test/.*"_rr;
+    load_test += base;
+
     auto qt_progs = [](auto &t, const String &name_override = {}, const path &path_override = {})
     {
         auto name = name_override.empty() ? t.getPackage().getPath().back() : name_override;